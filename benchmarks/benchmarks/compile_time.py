@@ -0,0 +1,95 @@
+# SPDX-FileCopyrightText: 2023 Intel Corporation
+#
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+"""
+Compile time benchmarks, generated for every numba-mlir npbench and polybench
+kernel, and compile time scaling benchmarks on generated functions.
+"""
+
+import importlib
+import pkgutil
+from os import path
+
+import numba as nb
+
+from numba_mlir import njit
+from numba_mlir.mlir.benchmarking import CompileBenchmarkBase
+
+_SUITES = ["npbench", "polybench"]
+
+
+def _iter_kernels():
+    root = path.dirname(__file__)
+    for suite in _SUITES:
+        prefix = f"{__package__}.{suite}."
+        for info in pkgutil.walk_packages([path.join(root, suite)], prefix):
+            if info.ispkg or not info.name.endswith(".numba_mlir"):
+                continue
+
+            yield suite + "." + info.name[len(prefix) :]
+
+
+def _make_benchmark(name):
+    module = importlib.import_module(f"{__package__}.{name}")
+    runtime_bench = module.Benchmark
+
+    class Benchmark(CompileBenchmarkBase):
+        params = runtime_bench.params
+        param_names = runtime_bench.param_names
+
+        def get_benchmark(self):
+            return runtime_bench()
+
+    bench_name = name.replace(".numba_mlir", "").replace(".", "_")
+    Benchmark.__name__ = bench_name
+    Benchmark.__qualname__ = bench_name
+    return bench_name, Benchmark
+
+
+for _name in _iter_kernels():
+    _bench_name, _bench = _make_benchmark(_name)
+    globals()[_bench_name] = _bench
+
+
+def _gen_cfg_func(size):
+    # Long if-elif chain with early exits inside nested loops, which produces
+    # large irregular CFG for the CFG to SCF structurization.
+    lines = [
+        "def cfg_func(a, n):",
+        "    res = 0.0",
+        "    for i in range(n):",
+        "        for j in range(n):",
+        "            v = a[(i + j) % n]",
+    ]
+    for k in range(size):
+        cond = "if" if k == 0 else "elif"
+        lines.append(f"            {cond} v < {k}:")
+        if k % 3 == 1:
+            lines.append(f"                if res > {k * 10}:")
+            lines.append("                    break")
+        elif k % 3 == 2:
+            lines.append(f"                if res < {-k}:")
+            lines.append("                    continue")
+        lines.append(f"                res += v * {k}")
+    lines.append("            else:")
+    lines.append("                return res")
+    lines.append("    return res")
+
+    globs = {}
+    exec(compile("\n".join(lines), "<cfg_func>", "exec"), globs)
+    return globs["cfg_func"]
+
+
+class cfg_structurize(CompileBenchmarkBase):
+    """
+    Compile time scaling on the generated functions with big if-elif chains
+    and nested loops, `size` is the number of branches.
+    """
+
+    params = [[16, 64, 256]]
+    param_names = ["size"]
+
+    def setup(self, size):
+        self.func = njit(_gen_cfg_func(size))
+        self.sig = (nb.float64[:], nb.int64)
@@ -0,0 +1,221 @@
+# SPDX-FileCopyrightText: 2023 Intel Corporation
+#
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+"""
+Service-like load: jitted functions are called from multiple Python threads or
+processes at once, each worker does a fixed number of calls. Reports total
+throughput and per-call latency percentiles, so contention in the shared
+runtime state (parallel runtime arena, GPU queue event pool, function
+contexts, GIL) shows up as throughput, which doesn't scale with the workers
+count, and as latency tail.
+
+Modes:
+- "threads": functions hold the GIL.
+- "threads-nogil": functions are compiled with `nogil=True`.
+- "processes": forked processes, each with its own runtime, as a baseline.
+"""
+
+import os
+import threading
+import time
+
+import numba
+import numpy as np
+from asv_runner.benchmarks.mark import SkipNotImplemented
+
+from numba_mlir.decorators import njit
+from numba_mlir.kernel import kernel, get_global_id, DEFAULT_LOCAL_SIZE
+from numba_mlir.mlir.benchmarking import has_dpctl
+from numba_mlir.mlir.utils import readenv
+
+# Calls per worker.
+CALLS = readenv("NUMBA_MLIR_BENCH_CONCURRENT_CALLS", int, 200)
+
+
+def _trivial(a):
+    return a
+
+
+def _parfor(a):
+    res = 0
+    for i in numba.prange(len(a)):
+        res += a[i]
+    return res
+
+
+def _linalg(a):
+    return np.dot(a, a)
+
+
+def _gpu_kernel(a):
+    i = get_global_id(0)
+    a[i] = i
+
+
+class _Workload:
+    def __init__(self, name, nogil):
+        self.name = name
+        if name == "trivial":
+            self.func = njit(_trivial, nogil=nogil)
+        elif name == "parfor":
+            self.func = njit(_parfor, nogil=nogil, parallel=True)
+        elif name == "linalg":
+            self.func = njit(_linalg, nogil=nogil)
+        elif name == "gpu":
+            self.func = kernel(_gpu_kernel)
+        else:
+            assert False, name
+
+    def get_args(self):
+        # Each worker gets its own arguments, so workers don't depend on each
+        # other through the data.
+        if self.name == "trivial":
+            return (1,)
+        if self.name == "parfor":
+            return (np.arange(1024, dtype=np.float64),)
+        if self.name == "linalg":
+            return (np.ones((64, 64), dtype=np.float32),)
+        if self.name == "gpu":
+            import dpctl.tensor as dpt
+
+            return (dpt.empty(1024, dtype=np.int32),)
+
+        assert False, self.name
+
+    def get_call(self, args):
+        if self.name == "gpu":
+            func = self.func[1024, DEFAULT_LOCAL_SIZE]
+        else:
+            func = self.func
+        return lambda: func(*args)
+
+
+def _run_worker(call, barrier):
+    """Returns start and end time and list of call latencies, in seconds."""
+    call()  # Compile and warm up before the measurement.
+    barrier.wait()
+    latencies = []
+    start = time.perf_counter()
+    for _ in range(CALLS):
+        begin = time.perf_counter()
+        call()
+        latencies.append(time.perf_counter() - begin)
+
+    return start, time.perf_counter(), latencies
+
+
+def _run_threads(workload, workers):
+    barrier = threading.Barrier(workers)
+    results = [None] * workers
+    calls = [workload.get_call(workload.get_args()) for _ in range(workers)]
+
+    def worker(i):
+        results[i] = _run_worker(calls[i], barrier)
+
+    threads = [threading.Thread(target=worker, args=(i,)) for i in range(workers)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+    return results
+
+
+def _run_processes(workload, workers):
+    import multiprocessing as mp
+    from numba_mlir.mlir.compiler_context import prefork_warmup
+
+    # Compile, but don't call in the parent, so parallel runtime threads are
+    # not started before the fork.
+    args = workload.get_args()
+    prefork_warmup((workload.func, [tuple(map(numba.typeof, args))]))
+
+    ctx = mp.get_context("fork")
+    barrier = ctx.Barrier(workers)
+    queue = ctx.Queue()
+
+    def worker():
+        queue.put(_run_worker(workload.get_call(args), barrier))
+
+    procs = [ctx.Process(target=worker) for _ in range(workers)]
+    for p in procs:
+        p.start()
+    results = [queue.get() for _ in procs]
+    for p in procs:
+        p.join()
+
+    return results
+
+
+def _run_load(workload, workers, mode):
+    if mode == "processes":
+        results = _run_processes(workload, workers)
+    else:
+        results = _run_threads(workload, workers)
+
+    start = min(r[0] for r in results)
+    end = max(r[1] for r in results)
+    latencies = np.concatenate([r[2] for r in results])
+    return {
+        "throughput": len(latencies) / (end - start),
+        "p50": float(np.percentile(latencies, 50)),
+        "p90": float(np.percentile(latencies, 90)),
+        "p99": float(np.percentile(latencies, 99)),
+    }
+
+
+class ConcurrentCalls:
+    version = "base"
+
+    params = [
+        ["trivial", "parfor", "linalg", "gpu"],
+        [1, 2, 4, 8],
+        ["threads", "threads-nogil", "processes"],
+    ]
+    param_names = ["workload", "workers", "mode"]
+
+    timeout = 600
+
+    def setup(self, workload, workers, mode):
+        if workload == "gpu":
+            if not has_dpctl():
+                raise SkipNotImplemented("dpctl is not available")
+
+            # SYCL runtime doesn't survive fork and kernels don't take GIL
+            # options.
+            if mode != "threads":
+                raise SkipNotImplemented(f"{mode} mode is not supported for gpu")
+
+        if mode == "processes" and not hasattr(os, "fork"):
+            raise SkipNotImplemented("fork is not available")
+
+        self.workload = _Workload(workload, nogil=(mode == "threads-nogil"))
+        self.workers = workers
+        self.mode = mode
+
+    def get_result(self, name):
+        if not hasattr(self, "result"):
+            self.result = _run_load(self.workload, self.workers, self.mode)
+
+        return self.result[name]
+
+    def track_throughput(self, *args):
+        return self.get_result("throughput")
+
+    track_throughput.unit = "calls/s"
+
+    def track_latency_p50(self, *args):
+        return self.get_result("p50")
+
+    track_latency_p50.unit = "seconds"
+
+    def track_latency_p90(self, *args):
+        return self.get_result("p90")
+
+    track_latency_p90.unit = "seconds"
+
+    def track_latency_p99(self, *args):
+        return self.get_result("p99")
+
+    track_latency_p99.unit = "seconds"
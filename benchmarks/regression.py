@@ -0,0 +1,150 @@
+# SPDX-FileCopyrightText: 2023 Intel Corporation
+#
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+"""
+Statistics and reports for `runner.py compare`.
+
+Each benchmark is compared using ratio of head and base medians, confidence
+interval for the ratio is estimated by bootstrap resampling of both sample
+sets. Benchmark is flagged as regression only if the whole interval is above
+`1 + threshold`, so noisy benchmarks are reported as `unstable` instead.
+"""
+
+import json
+import random
+from statistics import median
+
+BOOTSTRAP_ITERS = 2000
+CONFIDENCE = 0.95
+
+# Larger is worse for all collected metrics.
+METRIC_UNITS = {
+    "time_benchmark": "seconds",
+    "peakmem_benchmark": "bytes",
+    "time_compile_cold": "seconds",
+    "peakmem_compile": "bytes",
+}
+
+
+def bootstrap_ratio(base, head, iters=BOOTSTRAP_ITERS, confidence=CONFIDENCE):
+    """Returns (ratio, ci_low, ci_high) for median(head) / median(base)."""
+    # Fixed seed, so reports for the same samples are reproducible.
+    rng = random.Random(0)
+    ratio = median(head) / median(base)
+    ratios = []
+    for _ in range(iters):
+        b = median(rng.choices(base, k=len(base)))
+        h = median(rng.choices(head, k=len(head)))
+        if b > 0:
+            ratios.append(h / b)
+
+    if not ratios:
+        return ratio, ratio, ratio
+
+    ratios.sort()
+    alpha = (1 - confidence) / 2
+    low = ratios[int(alpha * (len(ratios) - 1))]
+    high = ratios[int((1 - alpha) * (len(ratios) - 1))]
+    return ratio, low, high
+
+
+def classify(low, high, threshold):
+    if low > 1 + threshold:
+        return "regression"
+    if high < 1 / (1 + threshold):
+        return "improvement"
+    if high > 1 + threshold and low < 1 / (1 + threshold):
+        return "unstable"
+    return "same"
+
+
+def compare_samples(base, head, threshold):
+    """
+    Compares two `{benchmark: {metric: [samples]}}` dicts, returns list of
+    report entries, sorted by ratio, largest first.
+    """
+    ret = []
+    for bench in sorted(set(base) & set(head)):
+        for metric in sorted(set(base[bench]) & set(head[bench])):
+            b = base[bench][metric]
+            h = head[bench][metric]
+            if not b or not h or median(b) <= 0:
+                continue
+
+            ratio, low, high = bootstrap_ratio(b, h)
+            ret.append(
+                {
+                    "bench": bench,
+                    "metric": metric,
+                    "unit": METRIC_UNITS.get(metric, ""),
+                    "base": median(b),
+                    "head": median(h),
+                    "base_samples": len(b),
+                    "head_samples": len(h),
+                    "ratio": ratio,
+                    "ci": [low, high],
+                    "status": classify(low, high, threshold),
+                }
+            )
+
+    ret.sort(key=lambda e: e["ratio"], reverse=True)
+    return ret
+
+
+def _fmt_value(value, unit):
+    if unit == "seconds":
+        for scale, suffix in ((1, "s"), (1e-3, "ms"), (1e-6, "us")):
+            if value >= scale:
+                return f"{value / scale:.3f}{suffix}"
+        return f"{value * 1e9:.1f}ns"
+    if unit == "bytes":
+        return f"{value / 2**20:.1f}MiB"
+    return f"{value:.4g}"
+
+
+def to_markdown(report):
+    entries = report["results"]
+    counts = {}
+    for e in entries:
+        counts[e["status"]] = counts.get(e["status"], 0) + 1
+
+    lines = [
+        f"# Benchmark comparison {report['base']} -> {report['head']}",
+        "",
+        f"Machine: `{report['machine']}`, presets: "
+        f"{','.join(report['presets'])}, threshold: "
+        f"{report['threshold'] * 100:.1f}%, "
+        f"{CONFIDENCE * 100:.0f}% bootstrap CI",
+        "",
+        ", ".join(f"{k}: {v}" for k, v in sorted(counts.items())),
+        "",
+    ]
+
+    for status in ("regression", "unstable", "improvement"):
+        selected = [e for e in entries if e["status"] == status]
+        if not selected:
+            continue
+
+        lines += [
+            f"## {status.capitalize()}",
+            "",
+            "| benchmark | metric | base | head | ratio | CI |",
+            "|---|---|---|---|---|---|",
+        ]
+        for e in selected:
+            unit = e["unit"]
+            lines.append(
+                f"| {e['bench']} | {e['metric']} | "
+                f"{_fmt_value(e['base'], unit)} | "
+                f"{_fmt_value(e['head'], unit)} | "
+                f"{e['ratio']:.3f} | "
+                f"[{e['ci'][0]:.3f}, {e['ci'][1]:.3f}] |"
+            )
+        lines.append("")
+
+    return "\n".join(lines)
+
+
+def to_json(report):
+    return json.dumps(report, indent=2)
@@ -150,8 +150,15 @@ def convert_results(raw_results):
         res = {k: v for k, v in zip(result_columns, val)}
 
         parts = name.split(".")
-        framework = parts[-3]
-        bench = ".".join(parts[:-3])
+        if parts[0] == "compile_time":
+            # compile_time.<kernel>.<metric>
+            framework = parts[-1]
+            bench = parts[-2]
+        else:
+            framework = parts[-3]
+            bench = ".".join(parts[:-3])
+            if parts[-1] != "time_benchmark":
+                bench += "." + parts[-1]
 
         params = list(itertools.product(*res["params"]))
         result = res["result"]
@@ -276,6 +283,368 @@ def run_bench(params):
     save_report(results, commit, machine, reports_dir)
 
 
+def get_thread_counts():
+    counts = os.environ.get("NUMBA_MLIR_BENCH_RUNNER_THREADS", None)
+    if counts:
+        return [int(c) for c in counts.split(",")]
+
+    max_threads = os.cpu_count()
+    ret = []
+    count = 1
+    while count < max_threads:
+        ret.append(count)
+        count *= 2
+
+    ret.append(max_threads)
+    return ret
+
+
+def flatten_args(args):
+    if isinstance(args, (tuple, list)):
+        for arg in args:
+            yield from flatten_args(arg)
+    else:
+        yield args
+
+
+_data_sizes = {}
+
+
+def get_data_size(name, params):
+    """Returns total size of the runtime benchmark arguments in bytes."""
+    import ast
+    import importlib
+
+    parts = name.split(".")
+    if parts[-1] != "time_benchmark":
+        return None
+
+    # Arguments are the same for all frameworks.
+    key = (".".join(parts[:-3]), params)
+    if key in _data_sizes:
+        return _data_sizes[key]
+
+    try:
+        module = importlib.import_module(".".join(["benchmarks"] + parts[:-2]))
+        bench = getattr(module, parts[-2])()
+        args = bench.initialize(*[ast.literal_eval(p) for p in params])
+        size = sum(getattr(a, "nbytes", 0) for a in flatten_args(args))
+    except Exception:
+        size = None
+
+    _data_sizes[key] = size
+    return size
+
+
+def convert_scaling_results(raw_results, threads):
+    ret = {}
+    for count, res in zip(threads, raw_results):
+        result_columns = res["result_columns"]
+        for name, val in res["results"].items():
+            r = {k: v for k, v in zip(result_columns, val)}
+            if r["result"] is None:
+                continue
+
+            parts = name.split(".")
+            if parts[-1] != "time_benchmark":
+                continue
+
+            bench = ".".join(parts[:-3])
+            framework = parts[-3]
+            params = list(itertools.product(*r["params"]))
+            for t, p in zip(r["result"], params):
+                if t is None or isnan(t):
+                    continue
+
+                full_bench = bench + str(list(p)).replace("'", "").replace(",", ";")
+                entry = ret.setdefault(full_bench, {}).setdefault(
+                    framework, {"times": {}, "data_size": get_data_size(name, p)}
+                )
+                entry["times"][count] = t
+
+    for frameworks in ret.values():
+        for entry in frameworks.values():
+            times = entry["times"]
+            base = times.get(threads[0])
+            size = entry["data_size"]
+            entry["speedup"] = {}
+            entry["efficiency"] = {}
+            entry["bandwidth"] = {}
+            for count, t in times.items():
+                if base is not None:
+                    speedup = base / t
+                    entry["speedup"][count] = speedup
+                    entry["efficiency"][count] = speedup * threads[0] / count
+
+                if size:
+                    # Estimate, assumes every argument is accessed once.
+                    entry["bandwidth"][count] = size / t
+
+    return ret
+
+
+def run_scaling(params):
+    bench = get_bench_arg(params)
+    os.environ["NUMBA_MLIR_BENCH_PRESETS"] = os.environ.get(
+        "NUMBA_MLIR_BENCH_RUNNER_SCALING_PRESETS", "S,M,paper"
+    )
+    os.environ["NUMBA_MLIR_BENCH_VALIDATE"] = "0"
+    commit = get_head_hash()
+    machine = get_machine_name()
+    threads = get_thread_counts()
+
+    raw_results = []
+    for count in threads:
+        print(f"Running with {count} threads")
+        os.environ["NUMBA_NUM_THREADS"] = str(count)
+        asv_run(
+            add_bench_arg(
+                [
+                    "--environment=existing:python",
+                    "--show-stderr",
+                    f"--set-commit-hash={commit}",
+                ],
+                bench,
+            ),
+            ignore_failures=True,
+        )
+        raw_results.append(load_results(commit, machine))
+
+    report = {
+        "commit": commit,
+        "machine": machine,
+        "threads": threads,
+        "presets": os.environ["NUMBA_MLIR_BENCH_PRESETS"].split(","),
+        "results": convert_scaling_results(raw_results, threads),
+    }
+    data = json.dumps(report, indent=2)
+    print("scaling report:")
+    print(data)
+
+    reports_dir = os.path.join(get_results_dir(), "scaling_reports")
+    ensure_dir(reports_dir)
+    file_name = sanitize_filename(f"{commit}_{machine}_{str(datetime.now())}")
+    with open(os.path.join(reports_dir, file_name + ".json"), "w") as file:
+        file.write(data)
+
+
+COMPARE_BENCH = (
+    r"(npbench|polybench)\..*\.numba_mlir\.Benchmark\.(time|peakmem)_benchmark"
+    r"|compile_time\..*\.(time_compile_cold|peakmem_compile)"
+)
+
+
+def get_samples_file(commit, machine):
+    return os.path.join(get_results_dir(), "samples", f"{commit}_{machine}.json")
+
+
+def extract_samples(raw_results, samples):
+    """Appends samples for every benchmark and metric from asv results."""
+    result_columns = raw_results["result_columns"]
+    for name, val in raw_results["results"].items():
+        res = {k: v for k, v in zip(result_columns, val)}
+        if res["result"] is None:
+            continue
+
+        parts = name.split(".")
+        if parts[0] == "compile_time":
+            # compile_time.<kernel>.<metric>
+            bench = ".".join(parts[:-1])
+        else:
+            # <suite>.<kernel>.<framework>.Benchmark.<metric>
+            bench = ".".join(parts[:-2])
+        metric = parts[-1]
+
+        params = list(itertools.product(*res["params"]))
+        raw_samples = res.get("samples") or [None] * len(params)
+        for r, s, p in zip(res["result"], raw_samples, params):
+            if r is None or (isinstance(r, float) and isnan(r)):
+                continue
+
+            full_bench = bench + str(list(p)).replace("'", "").replace(",", ";")
+            dst = samples.setdefault(full_bench, {}).setdefault(metric, [])
+            # peakmem and single-shot benchmarks only have the result.
+            dst.extend(s if s else [r])
+
+
+def run_collect(params):
+    """
+    Run comparison benchmarks for the current HEAD, repeating asv run multiple
+    times, and store all samples for `compare` cmd.
+
+    Usage: runner.py collect [bench regex]
+    """
+    bench = get_bench_arg(params) or COMPARE_BENCH
+    os.environ["NUMBA_MLIR_BENCH_PRESETS"] = os.environ.get(
+        "NUMBA_MLIR_BENCH_RUNNER_COMPARE_PRESETS", "S,M"
+    )
+    os.environ["NUMBA_MLIR_BENCH_VALIDATE"] = "0"
+    rounds = int(os.environ.get("NUMBA_MLIR_BENCH_RUNNER_COMPARE_ROUNDS", "5"))
+    commit = get_head_hash()
+    machine = get_machine_name()
+
+    samples = {}
+    for i in range(rounds):
+        print(f"Round {i + 1}/{rounds}")
+        asv_run(
+            add_bench_arg(
+                [
+                    "--environment=existing:python",
+                    "--show-stderr",
+                    "--record-samples",
+                    f"--set-commit-hash={commit}",
+                ],
+                bench,
+            ),
+            ignore_failures=True,
+        )
+        extract_samples(load_results(commit, machine), samples)
+
+    data = {
+        "commit": commit,
+        "machine": machine,
+        "presets": os.environ["NUMBA_MLIR_BENCH_PRESETS"].split(","),
+        "rounds": rounds,
+        "samples": samples,
+    }
+    file_path = get_samples_file(commit, machine)
+    ensure_dir(os.path.dirname(file_path))
+    with open(file_path, "w") as file:
+        file.write(json.dumps(data))
+
+    print(f"Samples saved to {file_path}")
+
+
+def run_compare(params):
+    """
+    Compare samples, collected by `collect` cmd for two commits on the same
+    machine, and write markdown and JSON regression reports. Exits with code 1
+    if any regressions were found.
+
+    Usage: runner.py compare <base commit> <head commit> [threshold]
+    """
+    import regression
+
+    base_commit, head_commit = params[0], params[1]
+    threshold = float(
+        params[2]
+        if len(params) > 2
+        else os.environ.get("NUMBA_MLIR_BENCH_RUNNER_COMPARE_THRESHOLD", "0.05")
+    )
+    machine = get_machine_name()
+
+    def load(commit):
+        with open(get_samples_file(commit, machine)) as file:
+            return json.loads(file.read())
+
+    base = load(base_commit)
+    head = load(head_commit)
+    if base["presets"] != head["presets"]:
+        print(f"Warning: presets mismatch {base['presets']} vs {head['presets']}")
+
+    report = {
+        "base": base_commit,
+        "head": head_commit,
+        "machine": machine,
+        "presets": head["presets"],
+        "threshold": threshold,
+        "results": regression.compare_samples(
+            base["samples"], head["samples"], threshold
+        ),
+    }
+    markdown = regression.to_markdown(report)
+    print(markdown)
+
+    reports_dir = os.path.join(get_results_dir(), "regression_reports")
+    ensure_dir(reports_dir)
+    file_name = sanitize_filename(f"{base_commit}_{head_commit}_{machine}")
+    with open(os.path.join(reports_dir, file_name + ".md"), "w") as file:
+        file.write(markdown)
+    with open(os.path.join(reports_dir, file_name + ".json"), "w") as file:
+        file.write(regression.to_json(report))
+
+    if any(e["status"] == "regression" for e in report["results"]):
+        sys.exit(1)
+
+
+DUMP_IR_PASSES = [
+    "PlierToNtensorPass",
+    "FuseAdjacentGenericsPass",
+    "ShapeIntegerRangePropagationPass",
+    "CommonOptsPass",
+]
+
+
+def split_ir_dumps(text):
+    import re
+
+    # Header is "<pass name> (<pass argument>) ('<op>' operation) //----- //".
+    header = "// -----// IR Dump Before "
+    for dump in text.split(header)[1:]:
+        line, _, body = dump.partition("\n")
+        match = re.match(r"(.*?) \(\S*\)", line)
+        name = match.group(1) if match else line
+        yield name.split("::")[-1], body
+
+
+def dump_kernel_ir(name, passes):
+    import importlib
+    import numba as nb
+    from numba_mlir.mlir.benchmarking import _compile_fresh
+    from numba_mlir.mlir.passes import print_pass_ir, get_print_buffer
+
+    bench = importlib.import_module(f"benchmarks.{name}").Benchmark()
+    if len(bench.params) == 0:
+        return {}
+
+    bench.is_validate = False
+    args = bench.initialize(bench.params[0])
+    if bench.is_expected_failure:
+        return {}
+
+    func = bench.get_func()
+    sig = tuple(map(nb.typeof, args))
+    with print_pass_ir(passes, []):
+        _compile_fresh(func, sig)
+        text = get_print_buffer()
+
+    # Passes can be run multiple times, keep the largest module for each.
+    ret = {}
+    for pass_name, body in split_ir_dumps(text):
+        if len(body) > len(ret.get(pass_name, "")):
+            ret[pass_name] = body
+
+    return ret
+
+
+def dump_ir(params):
+    """
+    Dump IR before the selected passes for every numba-mlir npbench and
+    polybench kernel, to be used as `numba-mlir-opt --numba-benchmark` input.
+
+    Usage: runner.py dump_ir <output dir> [pass1,pass2,...]
+    """
+    from benchmarks.compile_time import _iter_kernels
+
+    out_dir = params[0]
+    passes = params[1].split(",") if len(params) > 1 else DUMP_IR_PASSES
+    for name in _iter_kernels():
+        kernel = name.replace(".numba_mlir", "").replace(".", "_")
+        try:
+            dumps = dump_kernel_ir(name, passes)
+        except Exception as e:
+            print(f"{kernel}: failed to dump IR: {e}")
+            continue
+
+        for pass_name, body in dumps.items():
+            pass_dir = os.path.join(out_dir, pass_name)
+            ensure_dir(pass_dir)
+            with open(os.path.join(pass_dir, kernel + ".mlir"), "w") as file:
+                file.write(body)
+
+        print(f"{kernel}: {', '.join(sorted(dumps))}")
+
+
 def setup_machine(params):
     import cpuinfo
 
@@ -313,6 +682,10 @@ def run_cmd(cmd, params):
     cmds = [
         ("test", run_test),
         ("bench", run_bench),
+        ("scaling", run_scaling),
+        ("collect", run_collect),
+        ("compare", run_compare),
+        ("dump_ir", dump_ir),
         ("machine", setup_machine),
         ("publish", publish),
     ]
@@ -41,6 +41,11 @@ public:
   Node *createPhi(mlir::Operation *op, llvm::ArrayRef<Node *> args);
 
   void eraseNode(Node *node);
+
+  /// Incrementally remove nodes of the operation, which is about to be erased.
+  /// Returns false if SSA cannot be updated for this op and must be rebuilt.
+  bool eraseOperation(mlir::Operation *op);
+
   NodeType getNodeType(Node *node) const;
   mlir::Operation *getNodeOperation(Node *node) const;
   Node *getNodeDef(Node *node) const;
@@ -6,6 +6,7 @@
 
 #include "numba/Analysis/MemorySsa.hpp"
 
+#include <mlir/IR/PatternMatch.h>
 #include <mlir/Pass/AnalysisManager.h>
 
 namespace mlir {
@@ -26,4 +27,26 @@ public:
   std::optional<numba::MemorySSA> memssa;
   mlir::AliasAnalysis *aliasAnalysis = nullptr;
 };
+
+/// Rewriter listener, keeping cached MemorySSA analysis in sync with IR
+/// changes, so it doesn't need to be rebuilt after cleanups.
+/// Erased memory ops are removed from SSA incrementally and ops without memory
+/// effects are ignored. Any other memory change marks analysis as invalid.
+class MemorySSAUpdater : public mlir::RewriterBase::Listener {
+public:
+  MemorySSAUpdater(mlir::AnalysisManager &am);
+
+  /// Returns true if analysis wasn't cached or was invalidated by rewrites.
+  bool isInvalidated() const { return nullptr == analysis; }
+
+  void notifyOperationInserted(mlir::Operation *op,
+                               mlir::OpBuilder::InsertPoint previous) override;
+  void notifyBlockInserted(mlir::Block *block, mlir::Region *previous,
+                           mlir::Region::iterator previousIt) override;
+  void notifyOperationModified(mlir::Operation *op) override;
+  void notifyOperationErased(mlir::Operation *op) override;
+
+private:
+  MemorySSAAnalysis *analysis = nullptr;
+};
 } // namespace numba
@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <llvm/ADT/STLExtras.h>
+#include <llvm/ADT/StringRef.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+namespace numba {
+/// Compile time profile, entries are grouped by compilation phase (e.g. MLIR
+/// passes, LLVM passes, codegen) and accumulate time and number of runs.
+/// Can be updated from multiple threads.
+class CompileProfile {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Entry {
+    double seconds = 0;
+    uint64_t count = 0;
+  };
+
+  CompileProfile() = default;
+  CompileProfile(const CompileProfile &) = delete;
+
+  /// Add `seconds` spent in `name` of the `group`.
+  void add(llvm::StringRef group, llvm::StringRef name, double seconds,
+           uint64_t count = 1);
+
+  /// Add time elapsed since `begin`.
+  void addSince(llvm::StringRef group, llvm::StringRef name,
+                Clock::time_point begin);
+
+  /// Remove all entries.
+  void clear();
+
+  /// Accumulate all entries of the `other` profile.
+  void merge(const CompileProfile &other);
+
+  /// Call `func` for each entry, sorted by group and name.
+  void
+  forEach(llvm::function_ref<void(llvm::StringRef group, llvm::StringRef name,
+                                  const Entry &entry)>
+              func) const;
+
+private:
+  mutable std::mutex mutex;
+  std::map<std::pair<std::string, std::string>, Entry> entries;
+};
+
+/// Trace events sink, `nmrtTraceEvent` signature, timestamps are steady clock
+/// nanoseconds.
+using CompileTraceFunc = void (*)(const char *name, const char *category,
+                                  uint64_t beginNs, uint64_t endNs);
+
+/// Sets process-wide sink, which receives all `CompileProfileScope` scopes as
+/// trace events with the profile group as category. Null disables tracing.
+void setCompileTraceFunc(CompileTraceFunc func);
+
+CompileTraceFunc getCompileTraceFunc();
+
+/// Sends scope from `begin` until now to the trace `func`.
+void addCompileTraceEvent(CompileTraceFunc func, llvm::StringRef group,
+                          llvm::StringRef name,
+                          CompileProfile::Clock::time_point begin);
+
+/// Adds time spent in the scope to the profile and to the trace, does nothing
+/// if profile is null and tracing is disabled.
+class CompileProfileScope {
+public:
+  CompileProfileScope(CompileProfile *profile, llvm::StringRef group,
+                      llvm::StringRef name)
+      : profile(profile), traceFunc(getCompileTraceFunc()), group(group),
+        name(name) {
+    if (profile || traceFunc)
+      begin = CompileProfile::Clock::now();
+  }
+
+  ~CompileProfileScope() {
+    if (profile)
+      profile->addSince(group, name, begin);
+
+    if (traceFunc)
+      addCompileTraceEvent(traceFunc, group, name, begin);
+  }
+
+  CompileProfileScope(const CompileProfileScope &) = delete;
+
+private:
+  CompileProfile *profile;
+  CompileTraceFunc traceFunc;
+  llvm::StringRef group;
+  llvm::StringRef name;
+  CompileProfile::Clock::time_point begin;
+};
+} // namespace numba
@@ -22,10 +22,19 @@ class ModuleOp;
 } // namespace mlir
 
 namespace numba {
+class CompileProfile;
 class PipelineRegistry;
 
 class CompilerContext {
 public:
+  /// Optimization remark, emitted by the pipeline pass via MLIR remark
+  /// diagnostic.
+  struct Remark {
+    std::string pass;
+    std::string reason;
+    std::string location;
+  };
+
   struct Settings {
     struct IRPrintingSettings {
       llvm::SmallVector<std::string, 1> printBefore;
@@ -39,7 +48,19 @@ public:
     bool irDumpStderr = false;
     bool diagDumpStderr = false;
 
+    /// Keep MLIR context multithreading enabled, context must have thread
+    /// pool set.
+    bool multithreading = false;
+
     std::optional<IRPrintingSettings> irPrinting;
+
+    /// If set, time spent in each pipeline stage and pass is added to the
+    /// profile.
+    CompileProfile *profile = nullptr;
+
+    /// If set, remarks, emitted by the pipeline passes, are appended here,
+    /// duplicated remarks are dropped.
+    llvm::SmallVector<Remark> *remarks = nullptr;
   };
 
   class CompilerContextImpl;
@@ -24,11 +24,21 @@ std::unique_ptr<mlir::Pass> createSetSPIRVCapabilitiesPass(
     std::function<mlir::spirv::TargetEnvAttr(mlir::gpu::GPUModuleOp)> mapper =
         nullptr);
 std::unique_ptr<mlir::Pass> createGPUToSpirvPass();
+
+/// For GPU modules with `"auto"` 64-bit index attribute, create 32-bit index
+/// module clone and launch it instead of 64-bit one, when launch grid, index
+/// operands and memref operand spans fit into i32, checked on host before
+/// each launch.
+std::unique_ptr<mlir::Pass> createGpuIndexVariantsPass();
 std::unique_ptr<mlir::Pass> createGpuIndexCastPass();
 std::unique_ptr<mlir::Pass> createConvertGPUDeallocsPass();
 std::unique_ptr<mlir::Pass> createSerializeSPIRVPass();
 std::unique_ptr<mlir::Pass> createGPUExPass();
 
+/// Insert `gpu_runtime.prefetch` for host shared allocs before the kernel
+/// launches, which read them. Intended to be run after GPUExPass.
+std::unique_ptr<mlir::Pass> createInsertGPUPrefetchPass();
+
 /// This pass replaces calls to host functions with calls to device functions
 /// inside env regions;
 std::unique_ptr<mlir::Pass> createGenDeviceFuncsPass();
@@ -39,7 +49,23 @@ std::unique_ptr<mlir::Pass> createParallelLoopGPUMappingPass();
 /// `suggest_block_size`.
 std::unique_ptr<mlir::Pass> createTileParallelLoopsForGPUPass();
 
+/// Split outermost dimension of the parallel loops inside GPU regions into
+/// equal chunks, one per device in the `gpu_runtime.devices` function
+/// attribute. Each chunk gets its own GPU region (and so its own queue and
+/// module), chunks are executed concurrently. Only loops without reductions,
+/// which use shared or host USM are split, as these are accessible from all
+/// devices, so neighbour and broadcast reads and in-place outputs don't need
+/// explicit copies.
+///
+/// If host device is in the list, leading part of the loop is executed on the
+/// host threads, concurrently with the device chunks, and its share is
+/// adapted by the runtime from the measured host and device times.
+std::unique_ptr<mlir::Pass> createSplitParallelLoopsForDevicesPass();
+
 /// For devices without f64 support, truncate all operations to f32.
+/// In "mixed" mode loop-carried f64 sums are additionally rewritten into
+/// compensated summation before truncation. Demoted kernels are reported via
+/// remarks.
 std::unique_ptr<mlir::Pass> createTruncateF64ForGPUPass();
 
 /// Update scf.parallel loops with reductions to use gpu_runtime.global_reduce.
@@ -47,7 +73,8 @@ std::unique_ptr<mlir::Pass> createTruncateF64ForGPUPass();
 std::unique_ptr<mlir::Pass> createInsertGPUGlobalReducePass();
 
 /// Lowers `global_reduce` op to trhe series of workgroup reduces, barriers and
-/// global memory accesses. Intended to be run before gpu kernel outlining.
+/// global memory accesses. Partial results are combined in the same kernel by
+/// the last finished workgroup. Intended to be run before gpu kernel outlining.
 std::unique_ptr<mlir::Pass> createLowerGPUGlobalReducePass();
 
 /// This pass tries to rearrange nested stc.parallel loops for more gpu-friendly
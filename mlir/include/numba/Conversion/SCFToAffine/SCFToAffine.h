@@ -14,4 +14,10 @@ class Pass;
 /// 1. scf.parallel to affine.parallel.
 std::unique_ptr<Pass> createSCFToAffinePass();
 
+/// Uplifts scf.parallel and scf.for loop nests with affine bounds and memory
+/// accesses to sequential affine.for nests, so they can be processed by
+/// affine loop transformations. Parallelism must be recovered later by
+/// affine-parallelize. Nests, which can't be raised entirely, are left as is.
+std::unique_ptr<Pass> createSCFToAffineForPass();
+
 } // namespace mlir
@@ -35,9 +35,17 @@ mlir::StringRef getFp64TruncateAttrName();
 mlir::StringRef getUse64BitIndexAttrName();
 mlir::StringRef getDeviceFuncAttrName();
 mlir::StringRef getHostAllocAttrName();
+mlir::StringRef getAotTargetsAttrName();
+mlir::StringRef getDevicesAttrName();
+mlir::StringRef getSpecConstantsAttrName();
+mlir::StringRef getVectorBitwidthAttrName();
+mlir::StringRef getPackArgsAttrName();
+mlir::StringRef getPackedArgsAttrName();
 
 enum class FenceFlags : int64_t {
   local = 1,
   global = 2,
+  /// Global memory, ordered with the other workgroups on the device.
+  device = 4,
 };
 } // namespace gpu_runtime
@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace gpu_runtime {
+/// Fuses adjacent `gpu.launch` ops with the same grid and block sizes, if
+/// all the memory, shared between them, is only accessed by each thread at
+/// its own position. Intended to be run before kernel outlining.
+std::unique_ptr<mlir::Pass> createFuseGpuLaunchesPass();
+} // namespace gpu_runtime
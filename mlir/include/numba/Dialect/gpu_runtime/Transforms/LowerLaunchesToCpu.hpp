@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace llvm {
+class StringRef;
+template <typename T> class SmallVectorImpl;
+} // namespace llvm
+
+namespace mlir {
+class OpBuilder;
+class Pass;
+struct LogicalResult;
+namespace gpu {
+class LaunchOp;
+}
+namespace scf {
+class ParallelOp;
+}
+} // namespace mlir
+
+namespace gpu_runtime {
+class GPURegionDescAttr;
+
+/// Device name for the GPU regions, created for kernels, called with host
+/// arrays.
+llvm::StringRef getHostDeviceName();
+
+/// Returns true if launches from the GPU region with `env` are lowered to
+/// the host loops instead of the device kernels: host device or CPU SYCL
+/// device.
+bool isCpuRegion(GPURegionDescAttr env);
+
+/// Lowers `gpu.launch` to the host loops: outer `scf.parallel` over the
+/// work-groups and inner `scf.parallel` loops over the work-items, so group
+/// loop can be distributed between threads and item loops can be vectorized.
+///
+/// Barriers are handled by loop fission: launch body is split into the
+/// separate item loops at each barrier and scalar values, used across the
+/// barrier, are spilled into the per-group stack buffers. Workgroup memory is
+/// allocated once per group on stack. Barriers must be in the uniform control
+/// flow (see `createMakeBarriersUniformPass`), i.e. at launch body top level
+/// or inside `scf.for` and `scf.if` ops with uniform operands.
+///
+/// Created item loops are appended to `itemLoops`, if provided.
+///
+/// Returns failure and leaves launch unchanged if it cannot be lowered.
+mlir::LogicalResult
+lowerLaunchToCpu(mlir::OpBuilder &builder, mlir::gpu::LaunchOp launch,
+                 llvm::SmallVectorImpl<mlir::scf::ParallelOp> *itemLoops =
+                     nullptr);
+
+/// Lowers `gpu.launch` ops outside GPU regions or inside regions, for which
+/// `isCpuRegion` is true, to the host loops.
+std::unique_ptr<mlir::Pass> createLowerLaunchesToCpuPass();
+} // namespace gpu_runtime
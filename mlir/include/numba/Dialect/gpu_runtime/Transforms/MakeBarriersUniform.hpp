@@ -5,6 +5,9 @@
 #pragma once
 
 #include <memory>
+#include <optional>
+
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
 
 namespace mlir {
 class MLIRContext;
@@ -13,6 +16,11 @@ class RewritePatternSet;
 } // namespace mlir
 
 namespace gpu_runtime {
+/// Returns neutral value attribute of the reduction `op` for the
+/// `resultType`, i.e. value, which doesn't change the reduction result.
+std::optional<mlir::TypedAttr>
+getReduceNeutralValue(mlir::Type resultType, mlir::gpu::AllReduceOperation op);
+
 void populateMakeBarriersUniformPatterns(mlir::RewritePatternSet &patterns);
 
 /// gpu barriers ops require uniform control flow, this pass tries to rearrange
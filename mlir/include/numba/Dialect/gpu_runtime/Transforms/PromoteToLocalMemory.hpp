@@ -0,0 +1,18 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace gpu_runtime {
+/// Stages read-only global memory tiles, accessed by the neighbouring threads
+/// with constant offsets (stencils), into workgroup memory. Intended to be run
+/// on `gpu.launch` ops before kernel outlining.
+std::unique_ptr<mlir::Pass> createPromoteToLocalMemoryPass();
+} // namespace gpu_runtime
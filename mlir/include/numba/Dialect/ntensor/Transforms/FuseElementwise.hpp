@@ -0,0 +1,23 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+class RewritePatternSet;
+} // namespace mlir
+
+namespace numba {
+namespace ntensor {
+void populateFuseElementwisePatterns(mlir::RewritePatternSet &patterns);
+
+/// This pass fuses chains of `ntensor.elementwise` ops, possibly connected
+/// through `ntensor.cast`, into the single `ntensor.elementwise` op before
+/// lowering to linalg.
+std::unique_ptr<mlir::Pass> createFuseElementwisePass();
+} // namespace ntensor
+} // namespace numba
@@ -0,0 +1,22 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+namespace ntensor {
+/// This pass hoists loop-invariant primitive array ops (`elementwise`,
+/// `broadcast`, `primitive`, etc.) out of `scf.for` and `scf.while` loops and
+/// replaces identical ones with the single op. Ops are only moved if their
+/// input arrays are never written in the function and results are never
+/// written or escape, so results are effectively immutable.
+std::unique_ptr<mlir::Pass> createHoistArrayOpsPass();
+} // namespace ntensor
+} // namespace numba
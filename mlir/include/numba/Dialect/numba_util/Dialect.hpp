@@ -48,6 +48,23 @@ llvm::StringRef getForceInlineName();
 llvm::StringRef getOptLevelName();
 llvm::StringRef getShapeRangeName();
 llvm::StringRef getVectorLengthName();
+llvm::StringRef getVectorizedName();
+llvm::StringRef getParallelScheduleName();
+llvm::StringRef getParallelGrainName();
+llvm::StringRef getParallelCostName();
+llvm::StringRef getParallelProfileName();
+llvm::StringRef getParallelRegionName();
+llvm::StringRef getParallelBackendName();
+llvm::StringRef getDeterministicReduceName();
+llvm::StringRef getParforLoweredName();
+llvm::StringRef getCudaThreadsPerBlockName();
+llvm::StringRef getCudaOccupancyLaunchName();
+llvm::StringRef getAffineOptName();
+llvm::StringRef getPrefetchName();
+llvm::StringRef getMemoryProfileName();
+llvm::StringRef getPackBoolArraysName();
+llvm::StringRef getNonatomicRefcountName();
+llvm::StringRef getSharedCalleeName();
 } // namespace attributes
 } // namespace util
 } // namespace numba
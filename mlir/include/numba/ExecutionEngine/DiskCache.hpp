@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/CachePruning.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace llvm {
+class MemoryBuffer;
+}
+
+namespace numba {
+/// On-disk cache of binary blobs, keyed by the caller-computed hash string,
+/// so entries can be shared between processes. Entries are written
+/// atomically via temp file + rename and directory size is bounded using llvm
+/// cache pruning, which evicts least recently accessed files.
+class DiskCache {
+public:
+  /// `extension` is appended to entries file names, so different caches can
+  /// share the same directory. `maxSize` is in bytes, 0 means no limit.
+  DiskCache(llvm::StringRef dir, uint64_t maxSize, llvm::StringRef extension);
+
+  /// Compute cache key as hex SHA256 of the `parts`.
+  static std::string getKey(llvm::ArrayRef<llvm::StringRef> parts);
+
+  /// Returns null if entry is not present. Entry access time is updated, so
+  /// it is evicted later.
+  std::unique_ptr<llvm::MemoryBuffer> load(llvm::StringRef key,
+                                           bool requiresNullTerminator);
+
+  void store(llvm::StringRef key, llvm::StringRef data);
+
+  /// Remove entry, e.g. if it cannot be parsed.
+  void remove(llvm::StringRef key);
+
+private:
+  std::string cacheDir;
+  std::string ext;
+  llvm::CachePruningPolicy policy;
+  std::mutex pruneMutex;
+
+  std::string getPath(llvm::StringRef key) const;
+};
+} // namespace numba
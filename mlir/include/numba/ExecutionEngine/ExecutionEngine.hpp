@@ -4,13 +4,24 @@
 
 #pragma once
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLFunctionalExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ExecutionEngine/Orc/Core.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/Support/CodeGen.h"
 #include "llvm/Support/Error.h"
 
+#include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
 
 namespace mlir {
 class ModuleOp;
@@ -21,12 +32,47 @@ template <typename T> class Expected;
 class JITEventListener;
 
 namespace orc {
+class JITDylib;
 class LLJIT;
 class MangleAndInterner;
 } // namespace orc
 } // namespace llvm
 
 namespace numba {
+class CompileProfile;
+
+/// Tapir target, used for LLVM-level parallelization of the loops.
+enum class TapirTarget {
+  /// Parallel loops are lowered to the native runtime calls, no Tapir
+  /// transformations.
+  None,
+  OpenCilk,
+  Cuda,
+};
+
+/// Vector math library, used to map vectorized math functions calls. Library
+/// must be loaded into the process before compiled code is executed.
+enum class VectorLibrary {
+  None,
+  /// Intel Short Vector Math Library.
+  SVML,
+  /// GLIBC vector math library, x86 only.
+  LIBMVEC,
+  /// SLEEF GNU ABI, AArch64 only.
+  SLEEF,
+};
+
+/// Object linker, used by the JIT.
+enum class JITLinker {
+  /// JITLink `ObjectLinkingLayer`. Objects are allocated from the reserved
+  /// slabs and symbols outside of the object are accessed through GOT/PLT
+  /// stubs, so small and medium code models can be used.
+  JITLink,
+  /// RuntimeDyld with `SectionMemoryManager`. Sections can be allocated far
+  /// from each other, so large code model is always used.
+  RTDyld,
+};
+
 struct ExecutionEngineOptions {
   /// `jitCodeGenOptLevel`, when provided, is used as the optimization level for
   /// target code generation.
@@ -37,6 +83,69 @@ struct ExecutionEngineOptions {
   /// be dumped to a file via the `dumpToObjectfile` method.
   bool enableObjectCache = false;
 
+  /// If `objectCacheDir` is set, compiled objects are additionally stored in
+  /// this directory, keyed by the hash of the LLVM IR and target configuration,
+  /// and reused across processes without running optimization pipeline.
+  std::string objectCacheDir;
+
+  /// Maximum size of the persistent object cache directory in bytes, least
+  /// recently used entries are evicted when it is exceeded. 0 means unbounded.
+  uint64_t objectCacheMaxSize = 0;
+
+  /// If `tieredCompilation` is set, `loadModule` returns quickly compiled
+  /// version of the module (O1, no Tapir transformations) and full
+  /// optimization pipeline is run on the background thread. External functions
+  /// are called through the indirection, which is switched to the optimized
+  /// version when it is ready.
+  bool tieredCompilation = false;
+
+  /// If `pgoCallThreshold` is non-zero, first tier of `tieredCompilation` is
+  /// instrumented with basic block counters and background optimization of the
+  /// module is started only after any of its functions was called this many
+  /// times. Collected counts are attached to the optimized version as function
+  /// entry counts and branch weights.
+  unsigned pgoCallThreshold = 0;
+
+  /// If `lazyCompilation` is set, modules are partitioned per function and
+  /// each function is compiled on its first call, through the lazy reexports.
+  /// Functions are optimized separately, so no inlining happens across them.
+  /// Compile profile doesn't cover lazily compiled functions.
+  bool lazyCompilation = false;
+
+  /// If `numCompileThreads` is non-zero, LLVM code generation is dispatched to
+  /// the pool of this many threads, so modules, loaded from the different
+  /// threads, are compiled concurrently.
+  unsigned numCompileThreads = 0;
+
+  /// Object linker. `RTDyld` is used instead of `JITLink` for COFF targets and
+  /// when perf listener is available, as it is only supported by RuntimeDyld.
+  JITLinker jitLinker = JITLinker::JITLink;
+
+  /// Code model of the generated code, only used with `JITLink`, `RTDyld`
+  /// always uses large code model.
+  llvm::CodeModel::Model codeModel = llvm::CodeModel::Small;
+
+  /// Tapir target for the loops parallelization. If `None`, loops are not
+  /// tapirified and Kitsune runtime is not loaded.
+  TapirTarget tapirTarget = TapirTarget::None;
+
+  /// Path to the OpenCilk ABI bitcode file, used by `OpenCilk` target.
+  std::string tapirAbiBitcodePath;
+
+  /// Vector math library for the vector math intrinsics and vectorized libm
+  /// calls. If `None`, vector math is scalarized by the codegen.
+  VectorLibrary vectorLibrary = VectorLibrary::None;
+
+  /// If `llvmVectorization` is set, LLVM loop and SLP vectorizers are run for
+  /// the code, not handled by MLIR vectorizer. Loops, vectorized by MLIR, are
+  /// never vectorized again.
+  bool llvmVectorization = true;
+
+  /// Directory with Kitsune runtime libraries (libkitrt.so, libopencilk.so,
+  /// ...). Libraries are also searched in `<dir>/<host triple>`, following
+  /// Kitsune install layout. If empty, default dynamic loader search is used.
+  std::string tapirRuntimePath;
+
   /// If enable `enableGDBNotificationListener` is set, the JIT compiler will
   /// notify the llvm's global GDB notification listener.
   bool enableGDBNotificationListener = true;
@@ -64,18 +173,26 @@ struct ExecutionEngineOptions {
 
 class ExecutionEngine {
   class SimpleObjectCache;
+  class BackgroundCompiler;
+  struct PgoState;
 
 public:
+  class PersistentObjectCache;
+
   using ModuleHandle = void *;
 
   ExecutionEngine(ExecutionEngineOptions options);
   ~ExecutionEngine();
 
   /// Compiles given module, adds it to execution engine and run its contructors
-  /// if any.
-  llvm::Expected<ModuleHandle> loadModule(mlir::ModuleOp m);
+  /// if any. If `profile` is provided, LLVM translation, optimization and
+  /// codegen time is added to it (background compilation of tiered modules is
+  /// not profiled).
+  llvm::Expected<ModuleHandle> loadModule(mlir::ModuleOp m,
+                                          CompileProfile *profile = nullptr);
 
-  /// Runs module desctructors and removes it from execution engine.
+  /// Runs module desctructors and removes it from execution engine, freeing
+  /// its code and data memory.
   void releaseModule(ModuleHandle handle);
 
   /// Looks up the original function with the given name and returns a
@@ -86,7 +203,80 @@ public:
   /// Dump object code to output file `filename`.
   void dumpToObjectFile(llvm::StringRef filename);
 
+  /// Compiles given module through the same translation and optimization
+  /// pipeline as `loadModule` and writes resulting relocatable object to
+  /// `filename`, without adding it to the execution engine. If `cpu` is not
+  /// empty, object is compiled for this CPU and its default features instead
+  /// of the host one.
+  llvm::Error emitObjectFile(mlir::ModuleOp m, llvm::StringRef filename,
+                             llvm::StringRef cpu = {});
+
+  /// Adds object, produced by `emitObjectFile`, to execution engine and run
+  /// its constructors. Object must be compiled for the same host and engine
+  /// options. Its external symbols are resolved the same way as for
+  /// `loadModule`.
+  llvm::Expected<ModuleHandle> loadObjectFile(llvm::StringRef filename);
+
+  /// Finishes all deferred compilation of the loaded modules: lazily compiled
+  /// functions are materialized and background compilation of the tiered
+  /// modules, including ones still waiting for the PGO call threshold, is run
+  /// and waited for. Used before `fork`, so child processes inherit compiled
+  /// code instead of compiling it again.
+  llvm::Error finishCompilation();
+
+  /// Must be called before `fork`. Waits for the running background
+  /// compilation, if any, and stops starting the queued ones, so compile
+  /// thread doesn't hold any locks in the child. Queued compilations are
+  /// inherited by the child instead of being waited for.
+  void beforeFork();
+
+  /// Must be called in the parent process after `fork`, resumes background
+  /// compilation.
+  void afterForkParent();
+
+  /// Must be called in the child process after `fork`. Recreates background
+  /// compilation thread, which doesn't exist in the child, and resumes queued
+  /// compilations on it.
+  void afterForkChild();
+
+  /// Adds runtime symbol `name`, visible to all subsequently loaded modules.
+  /// If symbol is already defined, existing definition is kept.
+  void defineSymbol(llvm::StringRef name, void *ptr);
+
 private:
+  /// Translates module to LLVM IR with given module identifier and applies
+  /// `transformer`.
+  llvm::Expected<llvm::orc::ThreadSafeModule>
+  translateModule(mlir::ModuleOp m, llvm::StringRef name,
+                  CompileProfile *profile);
+
+  /// Profiles of the modules being compiled, keyed by module identifier.
+  void registerProfile(llvm::StringRef name, CompileProfile *profile);
+  void unregisterProfile(llvm::StringRef name);
+  CompileProfile *getProfile(llvm::StringRef name);
+
+  /// Adds module to the dylib, lazily if `lazyCompilation` is set.
+  llvm::Error addIRModule(llvm::orc::JITDylib &dylib,
+                          llvm::orc::ThreadSafeModule tsm);
+
+  /// Creates new module dylib, linked against the runtime dylib.
+  llvm::Expected<llvm::orc::JITDylib *> createDylib();
+
+  /// Removes dylib and all its resources.
+  void removeDylib(llvm::orc::JITDylib &dylib);
+
+  /// Shared callees, already compiled by the other modules, are replaced with
+  /// declarations and the module is linked against the dylibs defining them.
+  /// Dylibs, defining new shared callees, are kept loaded. Linked module is
+  /// passed to `addModule` under the same lock.
+  llvm::Error linkSharedCallees(
+      llvm::orc::ThreadSafeModule tsm, llvm::orc::JITDylib &dylib,
+      llvm::function_ref<llvm::Error(llvm::orc::ThreadSafeModule)> addModule);
+
+  /// Called by instrumented first tier code, when call threshold is reached,
+  /// submits background compilation of the module.
+  static void triggerPgo(void *state);
+
   /// Ordering of llvmContext and jit is important for destruction purposes: the
   /// jit must be destroyed before the context.
   llvm::LLVMContext llvmContext;
@@ -97,20 +287,76 @@ private:
   /// Underlying cache.
   std::unique_ptr<SimpleObjectCache> cache;
 
+  /// Underlying on-disk cache.
+  std::unique_ptr<PersistentObjectCache> persistentCache;
+
   /// GDB notification listener.
   llvm::JITEventListener *gdbListener;
 
   /// Perf notification listener.
   llvm::JITEventListener *perfListener;
 
-  /// Callback to get additional symbol definitions.
-  std::function<llvm::orc::SymbolMap(llvm::orc::MangleAndInterner)> symbolMap;
-
   /// If `transformer` is provided, it will be called on the LLVM module during
   /// JIT-compilation and can be used, e.g., for reporting or optimization.
   std::function<llvm::Error(llvm::Module &)> transformer;
 
-  /// Id for unique module name generation.
-  int uniqueNameCounter = 0;
+  /// Id for unique module name generation, modules can be loaded from
+  /// multiple threads.
+  std::atomic<int> uniqueNameCounter{0};
+
+  /// Codegen is running on the multiple threads.
+  bool concurrentCompile = false;
+
+  /// Functions are compiled on the first call, `jit` is `LLLazyJIT`.
+  bool lazyCompile = false;
+
+  /// Objects are linked with JITLink instead of RuntimeDyld.
+  bool useJITLink = false;
+
+  /// Code model, used for JIT and emitted objects.
+  llvm::CodeModel::Model codeModel = llvm::CodeModel::Large;
+
+  /// Tapir target and OpenCilk ABI bitcode path.
+  TapirTarget tapirTarget = TapirTarget::None;
+  std::string tapirAbiBitcodePath;
+
+  /// Vector math library, used by compilers.
+  VectorLibrary vectorLibrary = VectorLibrary::None;
+
+  /// LLVM loop and SLP vectorizers are enabled, used by compilers.
+  bool llvmVectorization = true;
+
+  /// Dylib with process symbols, `symbolMap` and Kitsune runtime symbols,
+  /// shared by all modules.
+  llvm::orc::JITDylib *runtimeDylib = nullptr;
+
+  /// Profiles of the modules being compiled, accessed from compile threads.
+  std::mutex profilesMutex;
+  llvm::StringMap<CompileProfile *> profiles;
+
+  /// Codegen opt level, used for background compilation.
+  std::optional<llvm::CodeGenOptLevel> jitCodeGenOptLevel;
+
+  /// Call threshold for the profile guided background compilation.
+  unsigned pgoCallThreshold = 0;
+
+  /// Shared callees, keyed by symbol name, and dylibs defining them, which
+  /// are never released.
+  std::mutex sharedMutex;
+  llvm::StringMap<llvm::orc::JITDylib *> sharedCallees;
+  llvm::DenseSet<llvm::orc::JITDylib *> pinnedDylibs;
+
+  /// Functions of the lazily compiled modules, materialized by
+  /// `finishCompilation`.
+  std::mutex lazyMutex;
+  llvm::DenseMap<ModuleHandle, llvm::orc::SymbolLookupSet> lazySymbols;
+
+  /// Deferred background compilations of the instrumented modules.
+  std::mutex pgoMutex;
+  llvm::DenseMap<ModuleHandle, std::unique_ptr<PgoState>> pgoStates;
+
+  /// Background compilation thread, if tiered compilation is enabled. Declared
+  /// last, so it is destroyed (and joined) before the jit.
+  std::unique_ptr<BackgroundCompiler> backgroundCompiler;
 };
 } // namespace numba
@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Repartition 1D `scf.parallel` loops over CSR rows by the number of
+/// nonzeros instead of rows. Loop is recognized by the row extent loads
+/// `indptr[i]` and `indptr[i + 1]` in its body. New parallel loop runs over
+/// the chunks with equal number of nonzeros, each chunk finds its rows range by
+/// binary search in `indptr` and processes rows sequentially. `indptr` is
+/// assumed to be non-decreasing, as for any valid CSR matrix.
+///
+/// `cpuNnzPerChunk` and `gpuNnzPerChunk` - target number of nonzeros per
+/// chunk for host loops and loops inside GPU regions.
+std::unique_ptr<mlir::Pass>
+createBalanceCsrLoopsPass(unsigned cpuNnzPerChunk = 16 * 1024,
+                          unsigned gpuNnzPerChunk = 64);
+} // namespace numba
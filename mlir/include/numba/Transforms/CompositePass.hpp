@@ -7,6 +7,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace mlir {
 class OpPassManager;
@@ -14,9 +15,22 @@ class Pass;
 } // namespace mlir
 
 namespace numba {
+using CompositePassPopulateFunc = std::function<void(mlir::OpPassManager &)>;
+
 /// Create composite pass, which runs selected set of passes until fixed point
 /// or maximum number of iterations reached.
 std::unique_ptr<mlir::Pass>
+createCompositePass(std::string name, CompositePassPopulateFunc populateFunc);
+
+/// Create composite pass from the list of sub-pipelines, which are run in
+/// order until fixed point or maximum number of iterations reached.
+/// Sub-pipeline is skipped if it didn't change IR on its previous run and IR
+/// wasn't changed since then.
+std::unique_ptr<mlir::Pass>
 createCompositePass(std::string name,
-                    std::function<void(mlir::OpPassManager &)> populateFunc);
+                    std::vector<CompositePassPopulateFunc> subPipelines);
+
+/// Maximum number of iterations for all composite passes, default is 10.
+void setCompositePassMaxIterations(unsigned maxIters);
+unsigned getCompositePassMaxIterations();
 } // namespace numba
@@ -0,0 +1,19 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Fuse `scf.parallel` into the following parallel loop with more dimensions
+/// and same leading bounds, if consumer only reads producer results at the
+/// leading indices, e.g. row reduction and its broadcasting consumer. Consumer
+/// becomes nested parallel loop over remaining dimensions.
+std::unique_ptr<mlir::Pass> createFuseParallelLoopsPass();
+} // namespace numba
@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Hoist loop-invariant part of multidimensional memref accesses out of
+/// `scf.for`/`scf.parallel` loops. Access `a[i, j]`, where only `j` depends on
+/// the loop, is rewritten into 1D `subview` `a[i, :]` created before the loop,
+/// so row offset and descriptor values are computed once and the loop body
+/// only advances along the innermost dimension.
+std::unique_ptr<mlir::Pass> createHoistMemrefOffsetsPass();
+} // namespace numba
@@ -7,8 +7,15 @@
 namespace mlir {
 class RewritePatternSet;
 class MLIRContext;
+class DataFlowSolver;
 } // namespace mlir
 
 namespace numba {
 void populateIndexPropagatePatterns(mlir::RewritePatternSet &patterns);
-}
+
+/// Compute index arithmetic and `scf.for` induction variables in i32 if
+/// `solver` integer ranges prove values fit. Solver must have integer range
+/// analysis loaded and run.
+void populateIndexNarrowingPatterns(mlir::RewritePatternSet &patterns,
+                                    mlir::DataFlowSolver &solver);
+} // namespace numba
@@ -11,5 +11,13 @@ class Pass;
 }
 
 namespace numba {
+/// Inline calls marked with force-inline attribute, either on call or on
+/// callee. Such calls must be inlined for correctness, pass fails otherwise.
 std::unique_ptr<mlir::Pass> createForceInlinePass();
-}
+
+/// Inline private leaf functions based on the cost model: callee size minus
+/// bonuses for the constant args, call site loop depth and fusion
+/// opportunities must not exceed the `threshold`. Callees with the single
+/// call site and calls inside environment regions are always inlined.
+std::unique_ptr<mlir::Pass> createCostModelInlinePass(unsigned threshold = 50);
+} // namespace numba
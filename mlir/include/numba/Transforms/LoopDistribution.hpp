@@ -0,0 +1,21 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Split `scf.parallel` loops, which cannot be vectorized because of few
+/// non-vectorizable ops (calls, nested loops, etc.), into vectorizable loop
+/// and residual loop with the remaining ops, if vectorized loop and residual
+/// loop are estimated to be cheaper than the original one.
+///
+/// Only runs for functions with `numba.vector_length` attribute.
+std::unique_ptr<mlir::Pass> createLoopDistributionPass();
+} // namespace numba
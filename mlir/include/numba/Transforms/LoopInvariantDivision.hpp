@@ -0,0 +1,28 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Strength-reduce integer division and remainder by loop-invariant values.
+///
+/// For `arith.divsi/divui/remsi/remui/floordivsi` inside loops, whose divisor
+/// is defined outside of the loop and is not a constant, magic multiplier and
+/// shifts (Granlund-Montgomery round-up method) are computed once before the
+/// outermost such loop, and the division is replaced with mul-high, add and
+/// shifts sequence. Signed ops are computed on absolute values with the sign
+/// fixup. Zero divisor is replaced with 1 in the precomputation, so it never
+/// traps if the loop is not executed.
+///
+/// Magic computation needs double-width division, so only types up to
+/// `maxBitwidth` bits are processed, `index` is processed as 64-bit integer.
+std::unique_ptr<mlir::Pass>
+createLoopInvariantDivisionPass(unsigned maxBitwidth = 64);
+} // namespace numba
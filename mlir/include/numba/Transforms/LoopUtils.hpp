@@ -17,4 +17,8 @@ mlir::LogicalResult naivelyFuseParallelOps(mlir::Region &region);
 mlir::LogicalResult
 prepareForFusion(mlir::Region &region,
                  llvm::function_ref<bool(mlir::Operation &)> needPrepare);
+
+/// Returns true if loop will run on CPU, i.e. it is outside of any env region
+/// or only inside parallel regions.
+bool isCPULoop(mlir::Operation *loop);
 } // namespace numba
@@ -4,11 +4,13 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 
 namespace mlir {
 class AnalysisManager;
+class Operation;
 class Pass;
 struct LogicalResult;
 } // namespace mlir
@@ -18,7 +20,28 @@ std::optional<mlir::LogicalResult> optimizeMemoryOps(mlir::AnalysisManager &am);
 
 std::unique_ptr<mlir::Pass> createMemoryOptPass();
 
+/// Replaces loads of array elements, already loaded on previous iterations
+/// of `scf.for` loop (e.g. `a[i - 1]` and `a[i]` in stencils), with values
+/// carried through loop iter args. Returns success if IR was changed.
+mlir::LogicalResult forwardLoopCarriedLoads(mlir::Operation *root);
+
+/// Returns true if buffer, allocated by `op`, is used by anything except
+/// loads, stores, dims, deallocs and views, which are used the same way.
+bool canAllocEscape(mlir::Operation *op);
+
+/// Returns true if `use` is in the same block as allocation `op` and all
+/// other uses of the buffer come after it.
+bool isFirstAllocUse(mlir::Operation *op, mlir::Operation *use);
+
 /// Normalizes memref types shape and layout to most static one across func
 /// call boudaries.
 std::unique_ptr<mlir::Pass> createNormalizeMemrefArgsPass();
+
+/// Hoists non-escaping allocations with loop-invariant sizes out of sequential
+/// loops and promotes static ones, not larger than `maxStackAllocSize` bytes,
+/// to the stack. Allocations inside parallel loops and non-CPU regions are not
+/// touched. Must be run after buffer deallocation, allocations with
+/// conditional ownership are considered escaping.
+std::unique_ptr<mlir::Pass>
+createOptimizeAllocsPass(uint64_t maxStackAllocSize = 1024);
 } // namespace numba
@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Move error paths out of the hot code of the LLVM dialect functions.
+///
+/// Blocks, terminated by `llvm.unreachable` (failed `cf.assert` and other
+/// error reporting paths), and blocks, which only branch into them, are cold.
+/// Conditional branches into the cold blocks get branch weights, marking them
+/// unlikely. Cold blocks with at least `minOps` ops are outlined into
+/// separate `noinline cold noreturn` internal functions, so they don't bloat
+/// the loop bodies and don't affect register allocation of the hot code.
+///
+/// Only top-level module functions are processed, GPU device code has no such
+/// paths, as asserts are converted to assumptions there.
+std::unique_ptr<mlir::Pass> createOutlineColdBlocksPass(unsigned minOps = 4);
+} // namespace numba
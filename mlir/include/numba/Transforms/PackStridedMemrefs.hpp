@@ -0,0 +1,21 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Repack memrefs, read with non-unit innermost stride inside CPU
+/// `scf.parallel` loops, into the contiguous temporary before the loop, if
+/// every access is reused across some loop dimension. This converts field
+/// columns of array-of-structs data (e.g. `pos[:, 0:1]` of the N x 3 array) to
+/// the struct-of-arrays form, so loops over them can use unit-stride vector
+/// loads. Memrefs, which may be written inside the loop, are not packed.
+std::unique_ptr<mlir::Pass> createPackStridedMemrefsPass();
+} // namespace numba
@@ -18,5 +18,7 @@ void populatePromoteBoolMemrefConversionRewritesAndTarget(
     mlir::TypeConverter &typeConverter, mlir::RewritePatternSet &patterns,
     mlir::ConversionTarget &target);
 
+/// Promote `i1` memrefs to `i8`. In functions with pack-bool-arrays attribute
+/// local 1D bool temporaries are bit-packed instead, 8 values per byte.
 std::unique_ptr<mlir::Pass> createPromoteBoolMemrefPass();
 } // namespace numba
@@ -0,0 +1,26 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Optimize meminfo refcounting before lowering to LLVM.
+///
+/// `numba_util.retain` is cancelled with the next `memref.dealloc` of the same
+/// meminfo (retain source or any view of it) in the same block, if nothing in
+/// between may release it. This also removes per-iteration retain/release of
+/// views inside loop bodies.
+///
+/// Remaining retains and deallocs of the fresh allocations, which never
+/// escape to calls or unknown ops and are executed outside of parallel loops
+/// and env regions, are marked with `numba.nonatomic_refcnt`, so they can be
+/// lowered to the non-atomic refcount updates.
+std::unique_ptr<mlir::Pass> createRefcountOptsPass();
+} // namespace numba
@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Reuse locally allocated buffers, which are dead after the elementwise
+/// `linalg.generic`, as its output instead of the freshly allocated one. Input
+/// of the same op is reused if it is accessed with the same indexing map as
+/// output, otherwise any earlier temporary of the same type, no longer used.
+/// Must be run on bufferized IR, before deallocation.
+std::unique_ptr<mlir::Pass> createReuseBuffersPass();
+} // namespace numba
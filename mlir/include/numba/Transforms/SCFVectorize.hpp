@@ -18,6 +18,49 @@ class ParallelOp;
 
 namespace numba {
 
+/// Target costs for the vectorization decisions, relative to the cost of
+/// the scalar arithmetic op.
+struct SCFVectorizeCostModel {
+  /// Maximum vector size, in bits.
+  unsigned vectorBitwidth = 0;
+
+  /// Number of vector registers, used to select interleave count.
+  unsigned numVectorRegs = 16;
+
+  /// Maximum number of vector iterations, processed at once.
+  unsigned maxInterleave = 1;
+
+  /// Vector arithmetic op.
+  unsigned vectorOpCost = 1;
+
+  /// Contiguous vector load/store.
+  unsigned memOpCost = 1;
+
+  /// Contiguous masked vector load/store.
+  unsigned maskedMemOpCost = 1;
+
+  /// Gather, per element.
+  unsigned gatherCost = 1;
+
+  /// Scatter, per element, it is emulated on targets without native scatter.
+  unsigned scatterCost = 1;
+
+  /// Vector element insert/extract, when op is replicated per element.
+  unsigned insertExtractCost = 1;
+
+  /// Single step of `vector.reduction`, it takes log2(factor) steps.
+  unsigned reductionStepCost = 1;
+
+  /// Vectorize complex loads, stores and arithmetic, keeping real and
+  /// imaginary parts in separate vectors. Complex memrefs are accessed through
+  /// `numba_util.memref_bitcast` view, which is only lowered to LLVM.
+  bool complexTypes = false;
+
+  /// Costs table for the `vectorBitwidth` (derived from the target features
+  /// by the caller, e.g. 128 for SSE/NEON, 256 for AVX2, 512 for AVX-512).
+  static SCFVectorizeCostModel get(unsigned vectorBitwidth);
+};
+
 /// Loop vectorization info
 struct SCFVectorizeInfo {
   /// Loop dimension on which to vectorize.
@@ -31,6 +74,33 @@ struct SCFVectorizeInfo {
 
   /// Can use masked vector ops for our of bounds memory accesses.
   bool masked = false;
+
+  /// Number of memory accesses, lowered to gather/scatter.
+  unsigned gathers = 0;
+
+  /// Number of ops, which will be replicated per vector element, including
+  /// non-contiguous memory accesses.
+  unsigned replicated = 0;
+
+  /// Number of reductions.
+  unsigned reductions = 0;
+
+  /// Number of if-converted `scf.if` ops.
+  unsigned predicates = 0;
+
+  /// Estimated cost of the single scalar iteration.
+  unsigned scalarCost = 0;
+
+  /// Estimated cost of the single vector iteration, processing `factor`
+  /// elements.
+  unsigned vectorCost = 0;
+
+  /// Number of vector iterations to process at once.
+  unsigned interleave = 1;
+
+  /// Estimated speedup over scalar loop, vectorization is only profitable if
+  /// it is greater than 1.
+  double getSpeedup() const;
 };
 
 /// Collect vectorization statistics on specified `scf.parallel` dimension.
@@ -42,6 +112,11 @@ std::optional<SCFVectorizeInfo> getLoopVectorizeInfo(mlir::scf::ParallelOp loop,
                                                      unsigned dim,
                                                      unsigned vectorBitwidth);
 
+/// Same as above, but with explicit cost model.
+std::optional<SCFVectorizeInfo>
+getLoopVectorizeInfo(mlir::scf::ParallelOp loop, unsigned dim,
+                     const SCFVectorizeCostModel &costModel);
+
 /// Vectorization params
 struct SCFVectorizeParams {
   /// Loop dimension on which to vectorize.
@@ -52,6 +127,17 @@ struct SCFVectorizeParams {
 
   /// Use masked vector ops for memory access outside loop bounds.
   bool masked = false;
+
+  /// Loop dimension to unroll-and-jam after vectorization, must be different
+  /// from `dim`.
+  unsigned unrollDim = 0;
+
+  /// Unroll factor for `unrollDim`, unroll-and-jam is not done if less than 2.
+  unsigned unrollFactor = 0;
+
+  /// Vectorize complex ops, must match `SCFVectorizeCostModel::complexTypes`,
+  /// used for the analysis.
+  bool complexTypes = false;
 };
 
 /// Vectorize loop on specified dimension with specified factor.
@@ -59,9 +145,37 @@ struct SCFVectorizeParams {
 /// If `masked` is `true` and loop bound is not divisible by `factor`, instead
 /// of generating second loop to process remainig iterations, extend loop count
 /// and generate masked vector ops to handle out-of bounds memory accesses.
+///
+/// If `unrollFactor` is set, vectorized loop is additionally unrolled and
+/// jammed on `unrollDim`, so accesses to adjacent rows can reuse loaded
+/// vectors.
+///
+/// If `complexTypes` is set, complex values are kept as separate vectors of
+/// real and imaginary parts, contiguous complex accesses are deinterleaved and
+/// interleaved with shuffles.
+///
+/// `scf.if` ops in the loop body are if-converted: both branches are executed
+/// for all lanes, memory accesses inside them are masked by the condition and
+/// results are blended with `arith.select`.
+///
+/// Non-contiguous accesses are lowered to `vector.gather`/`vector.scatter`,
+/// multidimensional indices are linearized. Read-modify-write updates through
+/// scatter (e.g. `hist[bin[i]] += w[i]`) are processed in a loop over subsets
+/// of lanes without duplicated indices, so conflicting lanes are updated in
+/// order.
+///
+/// Resulting loops are marked with `numba.vectorized` attribute, so they are
+/// skipped by LLVM loop vectorizer.
 mlir::LogicalResult vectorizeLoop(mlir::OpBuilder &builder,
                                   mlir::scf::ParallelOp loop,
                                   const SCFVectorizeParams &params);
 
+/// Unroll loop on specified dimension with specified factor and jam unrolled
+/// iterations into single loop body. Remaining iterations are processed by
+/// the original loop with updated bounds.
+mlir::LogicalResult unrollAndJamLoop(mlir::OpBuilder &builder,
+                                     mlir::scf::ParallelOp loop, unsigned dim,
+                                     unsigned factor);
+
 std::unique_ptr<mlir::Pass> createSCFVectorizePass();
 } // namespace numba
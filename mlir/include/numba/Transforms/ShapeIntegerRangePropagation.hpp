@@ -13,5 +13,11 @@ class Pass;
 namespace numba {
 /// Propagate integer range info through the IR and optimize ops based on this
 /// info.
+/// When run on module, private callees are cloned for the call sites, which
+/// provide stronger argument facts than the join over all callers.
 std::unique_ptr<mlir::Pass> createShapeIntegerRangePropagationPass();
+
+/// Compute index values in i32 where shape and integer range info proves it
+/// is safe. Should be run late, as it narrows `scf.for` induction variables.
+std::unique_ptr<mlir::Pass> createNarrowIndexTypePass();
 } // namespace numba
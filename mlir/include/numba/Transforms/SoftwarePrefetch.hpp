@@ -0,0 +1,21 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Insert `memref.prefetch` for indirect (`a[b[i]]`) and large-stride loads
+/// inside innermost CPU `scf.for`/`scf.parallel` loops. Prefetch distance, in
+/// iterations, is computed from the estimated loop body cost, so prefetch is
+/// issued `latency` cycles ahead of the load.
+///
+/// `latency` - estimated memory access latency, in cycles.
+std::unique_ptr<mlir::Pass> createSoftwarePrefetchPass(unsigned latency = 200);
+} // namespace numba
@@ -0,0 +1,24 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Out-of-core streaming for parallel loops over the arrays larger than RAM,
+/// like `np.memmap` inputs. Outer dim of the outermost host parallel loops is
+/// iterated in chunks, which access about `chunkSize` bytes of memory, and
+/// before each chunk is computed, `nmrtStreamPrefetch` asks the OS to read
+/// ahead the memory of the next one. If the streamed dim of the array is not
+/// its outermost dim, prefetch covers it for every row of the outer dims.
+///
+/// `chunkSize` - chunk size in bytes, pass does nothing if it is 0.
+std::unique_ptr<mlir::Pass> createStreamParallelLoopsPass(int64_t chunkSize);
+} // namespace numba
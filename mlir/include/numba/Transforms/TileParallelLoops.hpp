@@ -0,0 +1,22 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Tile multidimensional `scf.parallel` loops with non-contiguous (e.g.
+/// transposed) memory accesses for CPU cache locality. Tile loop is outermost,
+/// so it is parallelized by the runtime, point loop is innermost for the
+/// vectorization.
+///
+/// `cacheSize` - target memory footprint of the single tile, in bytes.
+std::unique_ptr<mlir::Pass>
+createTileParallelLoopsPass(unsigned cacheSize = 256 * 1024);
+} // namespace numba
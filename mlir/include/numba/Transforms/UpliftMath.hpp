@@ -16,5 +16,7 @@ namespace numba {
 void populateUpliftMathPatterns(mlir::RewritePatternSet &patterns);
 
 /// This pass tries to uplift libm-style func call to math dialect ops.
+/// It also strength-reduces `pow` with constant exponent and, under fastmath,
+/// rewrites single variable polynomials into the Horner form.
 std::unique_ptr<mlir::Pass> createUpliftMathPass();
 } // namespace numba
@@ -0,0 +1,27 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Version CPU `scf.parallel` loops, writing to the memref function argument
+/// while accessing another memref argument. Arguments are assumed not to alias
+/// (`numba.restrict`), parallel version is guarded by the runtime check that
+/// accessed memrefs extents don't overlap. Fallback is a serial `scf.for` loop
+/// nest, executing iterations in the original order.
+///
+/// Pass only guards the races between iterations of the single loop. It runs
+/// after loop fusion and `scf.for` promotion in `PostLinalgOptPass`, which
+/// already relied on `numba.restrict`, so the fallback executes the fused
+/// loop body and doesn't restore the original order between fused loops.
+/// Running it earlier is not an option: `scf.if` guards block the fusion and
+/// serial fallback loops would be promoted back to `scf.parallel`.
+std::unique_ptr<mlir::Pass> createVersionAliasingLoopsPass();
+} // namespace numba
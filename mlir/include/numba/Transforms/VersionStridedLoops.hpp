@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <memory>
+
+namespace mlir {
+class Pass;
+} // namespace mlir
+
+namespace numba {
+/// Version CPU `scf.parallel` loops accessing memrefs with dynamic innermost
+/// stride. Fast version is guarded by the runtime check that all such strides
+/// are 1 and accesses memrefs through the contiguous layout, which allows
+/// vectorization with unit-stride loads and stores. Original strided loop is
+/// kept as a fallback.
+std::unique_ptr<mlir::Pass> createVersionStridedLoopsPass();
+} // namespace numba
@@ -195,6 +195,74 @@ void numba::MemorySSA::eraseNode(numba::MemorySSA::Node *node) {
   node->~Node();
 }
 
+static std::pair<bool, bool> hasMemEffect(mlir::Operation &op) {
+  bool read = false;
+  bool write = false;
+
+  if (auto effects = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(op)) {
+    if (effects.hasEffect<mlir::MemoryEffects::Write>())
+      write = true;
+
+    if (effects.hasEffect<mlir::MemoryEffects::Read>())
+      read = true;
+  } else if (op.hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>()) {
+    for (mlir::Region &reg : op.getRegions()) {
+      for (mlir::Block &block : reg) {
+        for (auto &innerOp : block) {
+          auto [r, w] = hasMemEffect(innerOp);
+          read = read || r;
+          write = write || w;
+        }
+      }
+    }
+  } else if (mlir::isa<mlir::CallOpInterface>(op)) {
+    for (auto arg : op.getOperands()) {
+      if (mlir::isa<mlir::MemRefType>(arg.getType())) {
+        read = true;
+        write = true;
+        break;
+      }
+    }
+  }
+  return {read, write};
+}
+
+bool numba::MemorySSA::eraseOperation(mlir::Operation *op) {
+  assert(nullptr != op);
+  auto node = getNode(op);
+  if (nullptr == node) {
+    // Nodes of the nested ops must be already removed.
+    if (op->getNumRegions() == 0)
+      return true;
+
+    auto hasNode = [&](mlir::Operation *nested) {
+      return nodesMap.count(nested) ? mlir::WalkResult::interrupt()
+                                    : mlir::WalkResult::advance();
+    };
+    return !op->walk(hasNode).wasInterrupted();
+  }
+
+  // Phis have complex structure, bail out.
+  if (op->getNumRegions() != 0)
+    return false;
+
+  switch (node->getType()) {
+  case NodeType::Def:
+    break;
+  case NodeType::Use:
+    // Ops with both read and write effects have separate Def node, which is
+    // not tracked in nodesMap.
+    if (hasMemEffect(*op).second)
+      return false;
+    break;
+  default:
+    return false;
+  }
+
+  eraseNode(node);
+  return true;
+}
+
 numba::MemorySSA::NodeType
 numba::MemorySSA::getNodeType(numba::MemorySSA::Node *node) const {
   assert(nullptr != node);
@@ -389,38 +457,6 @@ mlir::LogicalResult numba::MemorySSA::optimizeUses(
 }
 
 namespace {
-static std::pair<bool, bool> hasMemEffect(mlir::Operation &op) {
-  bool read = false;
-  bool write = false;
-
-  if (auto effects = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(op)) {
-    if (effects.hasEffect<mlir::MemoryEffects::Write>())
-      write = true;
-
-    if (effects.hasEffect<mlir::MemoryEffects::Read>())
-      read = true;
-  } else if (op.hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>()) {
-    for (mlir::Region &reg : op.getRegions()) {
-      for (mlir::Block &block : reg) {
-        for (auto &innerOp : block) {
-          auto [r, w] = hasMemEffect(innerOp);
-          read = read || r;
-          write = write || w;
-        }
-      }
-    }
-  } else if (mlir::isa<mlir::CallOpInterface>(op)) {
-    for (auto arg : op.getOperands()) {
-      if (mlir::isa<mlir::MemRefType>(arg.getType())) {
-        read = true;
-        write = true;
-        break;
-      }
-    }
-  }
-  return {read, write};
-}
-
 numba::MemorySSA::Node *memSSAProcessRegion(mlir::Region &region,
                                             numba::MemorySSA::Node *entryNode,
                                             numba::MemorySSA &memSSA) {
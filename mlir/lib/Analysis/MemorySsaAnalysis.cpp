@@ -6,6 +6,7 @@
 
 #include <mlir/Analysis/AliasAnalysis.h>
 #include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
 
 namespace {
 struct Meminfo {
@@ -66,3 +67,41 @@ bool numba::MemorySSAAnalysis::isInvalidated(
   return !pa.isPreserved<MemorySSAAnalysis>() ||
          !pa.isPreserved<mlir::AliasAnalysis>();
 }
+
+numba::MemorySSAUpdater::MemorySSAUpdater(mlir::AnalysisManager &am) {
+  if (auto cached = am.getCachedAnalysis<MemorySSAAnalysis>())
+    if (cached->get().memssa)
+      analysis = &cached->get();
+}
+
+void numba::MemorySSAUpdater::notifyOperationInserted(
+    mlir::Operation *op, mlir::OpBuilder::InsertPoint /*previous*/) {
+  // New and moved memory ops need their reaching defs recomputed.
+  if (analysis && !mlir::isMemoryEffectFree(op))
+    analysis = nullptr;
+}
+
+void numba::MemorySSAUpdater::notifyBlockInserted(
+    mlir::Block *block, mlir::Region * /*previous*/,
+    mlir::Region::iterator /*previousIt*/) {
+  if (!analysis)
+    return;
+
+  for (auto &op : *block) {
+    if (!mlir::isMemoryEffectFree(&op)) {
+      analysis = nullptr;
+      return;
+    }
+  }
+}
+
+void numba::MemorySSAUpdater::notifyOperationModified(mlir::Operation *op) {
+  // In-place updates can change both accessed memref and op position.
+  if (analysis && !mlir::isMemoryEffectFree(op))
+    analysis = nullptr;
+}
+
+void numba::MemorySSAUpdater::notifyOperationErased(mlir::Operation *op) {
+  if (analysis && !analysis->memssa->eraseOperation(op))
+    analysis = nullptr;
+}
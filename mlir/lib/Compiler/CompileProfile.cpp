@@ -0,0 +1,70 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Compiler/CompileProfile.hpp"
+
+#include <atomic>
+
+static std::atomic<numba::CompileTraceFunc> compileTraceFunc{nullptr};
+
+void numba::setCompileTraceFunc(CompileTraceFunc func) {
+  compileTraceFunc.store(func, std::memory_order_relaxed);
+}
+
+numba::CompileTraceFunc numba::getCompileTraceFunc() {
+  return compileTraceFunc.load(std::memory_order_relaxed);
+}
+
+void numba::addCompileTraceEvent(CompileTraceFunc func, llvm::StringRef group,
+                                 llvm::StringRef name,
+                                 CompileProfile::Clock::time_point begin) {
+  auto toNs = [](CompileProfile::Clock::time_point time) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            time.time_since_epoch())
+            .count());
+  };
+  auto end = CompileProfile::Clock::now();
+  func(name.str().c_str(), group.str().c_str(), toNs(begin), toNs(end));
+}
+
+void numba::CompileProfile::add(llvm::StringRef group, llvm::StringRef name,
+                                double seconds, uint64_t count) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto &entry = entries[{group.str(), name.str()}];
+  entry.seconds += seconds;
+  entry.count += count;
+}
+
+void numba::CompileProfile::addSince(llvm::StringRef group,
+                                     llvm::StringRef name,
+                                     Clock::time_point begin) {
+  std::chrono::duration<double> elapsed = Clock::now() - begin;
+  add(group, name, elapsed.count());
+}
+
+void numba::CompileProfile::clear() {
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.clear();
+}
+
+void numba::CompileProfile::merge(const CompileProfile &other) {
+  if (&other == this)
+    return;
+
+  std::scoped_lock lock(mutex, other.mutex);
+  for (auto &&[key, val] : other.entries) {
+    auto &entry = entries[key];
+    entry.seconds += val.seconds;
+    entry.count += val.count;
+  }
+}
+
+void numba::CompileProfile::forEach(
+    llvm::function_ref<void(llvm::StringRef, llvm::StringRef, const Entry &)>
+        func) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto &&[key, val] : entries)
+    func(key.first, key.second, val);
+}
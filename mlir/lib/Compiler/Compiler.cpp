@@ -4,6 +4,7 @@
 
 #include "numba/Compiler/Compiler.hpp"
 
+#include "numba/Compiler/CompileProfile.hpp"
 #include "numba/Compiler/PipelineRegistry.hpp"
 #include "numba/Transforms/PipelineUtils.hpp"
 #include "numba/Utils.hpp"
@@ -12,21 +13,114 @@
 #include <mlir/IR/Diagnostics.h>
 #include <mlir/IR/Verifier.h>
 #include <mlir/Pass/Pass.h>
+#include <mlir/Pass/PassInstrumentation.h>
 #include <mlir/Pass/PassManager.h>
 
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringSet.h>
 #include <llvm/Support/raw_ostream.h>
 
+#include <mutex>
 #include <unordered_map>
 
 namespace {
+static llvm::StringRef getPassName(mlir::Pass *pass) {
+  auto name = pass->getName();
+  name.consume_front("`anonymous-namespace'::");
+  name.consume_front("{anonymous}::");
+  name.consume_front("(anonymous namespace)::");
+  return name;
+}
+
+/// Nested pass managers time and remarks are accounted by their passes.
+static bool isAdaptor(mlir::Pass *pass) {
+  return pass->getName() == "mlir::detail::OpToOpPassAdaptor";
+}
+
+/// Adds time of each pass run to the compile profile. Passes may be run on
+/// the multiple threads, so runs are tracked per (pass, op) pair.
+class ProfileInstrumentation : public mlir::PassInstrumentation {
+public:
+  ProfileInstrumentation(numba::CompileProfile &profile) : profile(profile) {}
+
+  void runBeforePass(mlir::Pass *pass, mlir::Operation *op) override {
+    if (isAdaptor(pass))
+      return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    running[{pass, op}] = numba::CompileProfile::Clock::now();
+  }
+
+  void runAfterPass(mlir::Pass *pass, mlir::Operation *op) override {
+    finish(pass, op);
+  }
+
+  void runAfterPassFailed(mlir::Pass *pass, mlir::Operation *op) override {
+    finish(pass, op);
+  }
+
+private:
+  numba::CompileProfile &profile;
+  std::mutex mutex;
+  llvm::DenseMap<std::pair<mlir::Pass *, mlir::Operation *>,
+                 numba::CompileProfile::Clock::time_point>
+      running;
+
+  void finish(mlir::Pass *pass, mlir::Operation *op) {
+    if (isAdaptor(pass))
+      return;
+
+    numba::CompileProfile::Clock::time_point begin;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = running.find({pass, op});
+      if (it == running.end())
+        return;
+
+      begin = it->second;
+      running.erase(it);
+    }
+    profile.addSince("mlir_pass", getPassName(pass), begin);
+  }
+};
+
+/// Passes, currently running on this thread, innermost last. Diagnostics are
+/// emitted on the thread running the pass, so the last one is the remark
+/// source.
+static thread_local llvm::SmallVector<llvm::StringRef, 4> runningPasses;
+
+class RemarksInstrumentation : public mlir::PassInstrumentation {
+public:
+  void runBeforePass(mlir::Pass *pass, mlir::Operation * /*op*/) override {
+    if (!isAdaptor(pass))
+      runningPasses.emplace_back(getPassName(pass));
+  }
+
+  void runAfterPass(mlir::Pass *pass, mlir::Operation * /*op*/) override {
+    finish(pass);
+  }
+
+  void runAfterPassFailed(mlir::Pass *pass,
+                          mlir::Operation * /*op*/) override {
+    finish(pass);
+  }
+
+private:
+  static void finish(mlir::Pass *pass) {
+    if (!isAdaptor(pass) && !runningPasses.empty())
+      runningPasses.pop_back();
+  }
+};
+
 struct PassManagerStage {
   template <typename F>
   PassManagerStage(mlir::MLIRContext &ctx,
                    const numba::CompilerContext::Settings &settings,
-                   F &&initFunc)
-      : pm(&ctx) {
+                   llvm::StringRef name, F &&initFunc)
+      : pm(&ctx), name(name.str()), profile(settings.profile) {
     // TODO: investigate
-    ctx.disableMultithreading();
+    if (!settings.multithreading)
+      ctx.disableMultithreading();
 
     pm.enableVerifier(settings.verify);
 
@@ -36,6 +130,12 @@ struct PassManagerStage {
     if (settings.passTimings)
       pm.enableTiming();
 
+    if (profile)
+      pm.addInstrumentation(std::make_unique<ProfileInstrumentation>(*profile));
+
+    if (settings.remarks)
+      pm.addInstrumentation(std::make_unique<RemarksInstrumentation>());
+
     if (settings.irDumpStderr) {
       ctx.disableMultithreading();
       pm.enableIRPrinting();
@@ -45,11 +145,7 @@ struct PassManagerStage {
         llvm::SmallVector<std::string, 1> names;
 
         bool operator()(mlir::Pass *pass, mlir::Operation *) const {
-          auto name = pass->getName();
-          name.consume_front("`anonymous-namespace'::");
-          name.consume_front("{anonymous}::");
-          name.consume_front("(anonymous namespace)::");
-          return llvm::is_contained(names, name);
+          return llvm::is_contained(names, getPassName(pass));
         }
       };
 
@@ -93,10 +189,15 @@ struct PassManagerStage {
 
   PassManagerStage *getNextStage() const { return nextStage; }
 
-  mlir::LogicalResult run(mlir::ModuleOp op) { return pm.run(op); }
+  mlir::LogicalResult run(mlir::ModuleOp op) {
+    numba::CompileProfileScope scope(profile, "mlir_stage", name);
+    return pm.run(op);
+  }
 
 private:
   mlir::PassManager pm;
+  std::string name;
+  numba::CompileProfile *profile = nullptr;
   llvm::SmallVector<std::pair<mlir::StringAttr, PassManagerStage *>, 1> jumps;
   PassManagerStage *nextStage = nullptr;
 };
@@ -124,7 +225,8 @@ struct PassManagerSchedule {
             (stagesMap.empty() ? nullptr : stagesTemp.back().stage.get());
         stagesTemp.push_back(
             {name, jumps,
-             std::make_unique<PassManagerStage>(ctx, settings, pmInitFunc)});
+             std::make_unique<PassManagerStage>(ctx, settings, name,
+                                                pmInitFunc)});
         assert(stagesMap.count(name.data()) == 0);
         stagesMap.insert({name.data(), stagesTemp.back().stage.get()});
         if (nullptr != prevStage)
@@ -183,6 +285,27 @@ static void printDiag(llvm::raw_ostream &os, const mlir::Diagnostic &diag) {
     os << "\n" << note;
 }
 
+/// Returns first file location in `loc` as `file:line:col`, or the whole
+/// location printed if there is none.
+static std::string getRemarkLocation(mlir::Location loc) {
+  std::string ret;
+  llvm::raw_string_ostream os(ret);
+  auto res = loc->walk([&](mlir::Location l) {
+    auto fileLoc = mlir::dyn_cast<mlir::FileLineColLoc>(l);
+    if (!fileLoc)
+      return mlir::WalkResult::advance();
+
+    os << fileLoc.getFilename().getValue() << ":" << fileLoc.getLine() << ":"
+       << fileLoc.getColumn();
+    return mlir::WalkResult::interrupt();
+  });
+  if (!res.wasInterrupted())
+    os << loc;
+
+  os.flush();
+  return ret;
+}
+
 } // namespace
 
 class numba::CompilerContext::CompilerContextImpl {
@@ -191,7 +314,7 @@ public:
                       const CompilerContext::Settings &settings,
                       const numba::PipelineRegistry &registry)
       : schedule(ctx, settings, registry), verify(settings.verify),
-        dumpDiag(settings.diagDumpStderr) {}
+        dumpDiag(settings.diagDumpStderr), remarks(settings.remarks) {}
 
   void run(mlir::ModuleOp module) {
     std::string err;
@@ -202,6 +325,9 @@ public:
 
       if (diag.getSeverity() == mlir::DiagnosticSeverity::Error)
         printDiag(errStream, diag);
+
+      if (remarks && diag.getSeverity() == mlir::DiagnosticSeverity::Remark)
+        addRemark(diag);
     };
 
     auto getErr = [&]() -> const std::string & {
@@ -224,6 +350,22 @@ private:
   PassManagerSchedule schedule;
   bool verify = false;
   bool dumpDiag = false;
+  llvm::SmallVector<CompilerContext::Remark> *remarks = nullptr;
+  llvm::StringSet<> seenRemarks;
+
+  void addRemark(const mlir::Diagnostic &diag) {
+    CompilerContext::Remark remark;
+    remark.pass = runningPasses.empty() ? "" : runningPasses.back().str();
+    remark.reason = diag.str();
+    remark.location = getRemarkLocation(diag.getLocation());
+
+    // Passes can be run multiple times in the pipeline.
+    auto key = remark.pass + "\n" + remark.reason + "\n" + remark.location;
+    if (!seenRemarks.insert(key).second)
+      return;
+
+    remarks->emplace_back(std::move(remark));
+  }
 };
 
 numba::CompilerContext::CompilerContext(mlir::MLIRContext &ctx,
@@ -531,14 +531,52 @@ struct CFGToSCFPass
     registry.insert<mlir::ub::UBDialect>();
   }
 
+  virtual mlir::LogicalResult initialize(mlir::MLIRContext *context) override {
+    mlir::RewritePatternSet p(context);
+
+    p.insert<
+        // clang-format off
+        WhileReductionSelect,
+        WhileUndefArgs,
+        WhileMoveToAfter,
+        CondBrSameTarget,
+        OrOfXor,
+        HoistSelects,
+        WhileHoistFromBefore,
+        LowerIndexSwitch
+        // clang-format on
+        >(context);
+
+    mlir::scf::ExecuteRegionOp::getCanonicalizationPatterns(p, context);
+    mlir::scf::IfOp::getCanonicalizationPatterns(p, context);
+    mlir::scf::IndexSwitchOp::getCanonicalizationPatterns(p, context);
+    mlir::scf::WhileOp::getCanonicalizationPatterns(p, context);
+    mlir::arith::SelectOp::getCanonicalizationPatterns(p, context);
+
+    numba::populatePoisonOptsPatterns(p);
+
+    patterns = std::move(p);
+    return mlir::success();
+  }
+
   void runOnOperation() override {
     auto &dom = getAnalysis<mlir::DominanceInfo>();
 
+    // Structurization itself is a single dominance tree driven pass over
+    // each region, greedy patterns below are only cleaning up its results.
     mlir::ControlFlowToSCFTransformation transformation;
+    bool changed = false;
     auto visitor = [&](mlir::Operation *op) -> mlir::WalkResult {
       for (mlir::Region &reg : op->getRegions()) {
-        if (mlir::failed(mlir::transformCFGToSCF(reg, transformation, dom)))
+        // Single block regions don't have any control flow to structurize.
+        if (reg.empty() || reg.hasOneBlock())
+          continue;
+
+        auto res = mlir::transformCFGToSCF(reg, transformation, dom);
+        if (mlir::failed(res))
           return mlir::WalkResult::interrupt();
+
+        changed = changed || *res;
       }
       return mlir::WalkResult::advance();
     };
@@ -547,33 +585,15 @@ struct CFGToSCFPass
     if (op->walk<mlir::WalkOrder::PostOrder>(visitor).wasInterrupted())
       return signalPassFailure();
 
-    auto context = &getContext();
-
-    mlir::RewritePatternSet patterns(context);
-
-    patterns.insert<
-        // clang-format off
-        WhileReductionSelect,
-        WhileUndefArgs,
-        WhileMoveToAfter,
-        CondBrSameTarget,
-        OrOfXor,
-        HoistSelects,
-        WhileHoistFromBefore,
-        LowerIndexSwitch
-        // clang-format on
-        >(context);
-
-    mlir::scf::ExecuteRegionOp::getCanonicalizationPatterns(patterns, context);
-    mlir::scf::IfOp::getCanonicalizationPatterns(patterns, context);
-    mlir::scf::IndexSwitchOp::getCanonicalizationPatterns(patterns, context);
-    mlir::scf::WhileOp::getCanonicalizationPatterns(patterns, context);
-    mlir::arith::SelectOp::getCanonicalizationPatterns(patterns, context);
-
-    numba::populatePoisonOptsPatterns(patterns);
+    // Function was already structured, nothing to cleanup.
+    if (!changed)
+      return markAllAnalysesPreserved();
 
-    if (mlir::failed(
-            mlir::applyPatternsAndFoldGreedily(op, std::move(patterns))))
+    // Visit outer loops and ifs before their bodies, so hoisting patterns
+    // see already simplified parents.
+    mlir::GreedyRewriteConfig config;
+    config.useTopDownTraversal = true;
+    if (mlir::failed(mlir::applyPatternsAndFoldGreedily(op, patterns, config)))
       return signalPassFailure();
 
     op->walk([&](mlir::Operation *o) -> mlir::WalkResult {
@@ -585,6 +605,9 @@ struct CFGToSCFPass
       return mlir::WalkResult::advance();
     });
   }
+
+private:
+  mlir::FrozenRewritePatternSet patterns;
 };
 } // namespace
 
@@ -19,6 +19,7 @@
 #include <mlir/Dialect/Func/Transforms/FuncConversions.h>
 #include <mlir/Dialect/GPU/Transforms/Passes.h>
 #include <mlir/Dialect/LLVMIR/LLVMDialect.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
 
 namespace {
 struct FunctionCallBuilder {
@@ -147,6 +148,22 @@ protected:
           llvmGpuParamPointerType, // params (null-term)
       }};
 
+  FunctionCallBuilder launchKernelPackedCallBuilder = {
+      "gpuxLaunchKernelPacked",
+      llvmPointerType, // dep
+      {
+          llvmPointerType,         // queue
+          llvmPointerType,         // kernel
+          llvmIndexType,           // gridXDim
+          llvmIndexType,           // gridyDim
+          llvmIndexType,           // gridZDim
+          llvmIndexType,           // blockXDim
+          llvmIndexType,           // blockYDim
+          llvmIndexType,           // blockZDim
+          llvmPointerPointerType,  // deps (null-term)
+          llvmGpuParamPointerType, // params (null-term)
+      }};
+
   FunctionCallBuilder waitEventCallBuilder = {"gpuxWait",
                                               llvmVoidType,
                                               {
@@ -161,6 +178,25 @@ protected:
                                                      llvmPointerType, // dep
                                                  }};
 
+  FunctionCallBuilder concurrentBeginCallBuilder = {"gpuxConcurrentBegin",
+                                                    llvmVoidType,
+                                                    {}};
+
+  FunctionCallBuilder concurrentEndCallBuilder = {"gpuxConcurrentEnd",
+                                                  llvmVoidType,
+                                                  {}};
+
+  FunctionCallBuilder coexecBeginCallBuilder = {
+      "gpuxCoexecBegin",
+      mlir::Float64Type::get(context), // host ratio
+      {
+          llvmPointerType, // key
+      }};
+
+  FunctionCallBuilder coexecEndCallBuilder = {"gpuxCoexecEnd",
+                                              llvmVoidType,
+                                              {}};
+
   FunctionCallBuilder allocCallBuilder = {
       "gpuxAlloc",
       llvmVoidType,
@@ -181,6 +217,15 @@ protected:
           llvmPointerType, // memory pointer
       }};
 
+  FunctionCallBuilder prefetchCallBuilder = {
+      "gpuxPrefetch",
+      llvmVoidType,
+      {
+          llvmPointerType, // queue
+          llvmPointerType, // memory pointer
+          llvmIndexType,   // size
+      }};
+
   FunctionCallBuilder suggestBlockSizeBuilder = {
       "gpuxSuggestBlockSize",
       llvmVoidType,
@@ -394,6 +439,93 @@ private:
   }
 };
 
+class ConvertGpuConcurrentBeginPattern
+    : public ConvertOpToGpuRuntimeCallPattern<gpu_runtime::ConcurrentBeginOp> {
+public:
+  ConvertGpuConcurrentBeginPattern(mlir::LLVMTypeConverter &converter)
+      : ConvertOpToGpuRuntimeCallPattern<gpu_runtime::ConcurrentBeginOp>(
+            converter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(gpu_runtime::ConcurrentBeginOp op,
+                  gpu_runtime::ConcurrentBeginOp::Adaptor /*adaptor*/,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    concurrentBeginCallBuilder.create(op.getLoc(), rewriter, {});
+    rewriter.eraseOp(op);
+    return mlir::success();
+  }
+};
+
+class ConvertGpuConcurrentEndPattern
+    : public ConvertOpToGpuRuntimeCallPattern<gpu_runtime::ConcurrentEndOp> {
+public:
+  ConvertGpuConcurrentEndPattern(mlir::LLVMTypeConverter &converter)
+      : ConvertOpToGpuRuntimeCallPattern<gpu_runtime::ConcurrentEndOp>(
+            converter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(gpu_runtime::ConcurrentEndOp op,
+                  gpu_runtime::ConcurrentEndOp::Adaptor /*adaptor*/,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    concurrentEndCallBuilder.create(op.getLoc(), rewriter, {});
+    rewriter.eraseOp(op);
+    return mlir::success();
+  }
+};
+
+class ConvertGpuCoexecBeginPattern
+    : public ConvertOpToGpuRuntimeCallPattern<gpu_runtime::CoexecBeginOp> {
+public:
+  ConvertGpuCoexecBeginPattern(mlir::LLVMTypeConverter &converter)
+      : ConvertOpToGpuRuntimeCallPattern<gpu_runtime::CoexecBeginOp>(
+            converter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(gpu_runtime::CoexecBeginOp op,
+                  gpu_runtime::CoexecBeginOp::Adaptor /*adaptor*/,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto mod = op->getParentOfType<mlir::ModuleOp>();
+    if (!mod)
+      return mlir::failure();
+
+    // Runtime keeps host share per global address, global content is only
+    // used for the diagnostics.
+    llvm::SmallString<64> name;
+    if (auto func = op->getParentOfType<mlir::FunctionOpInterface>())
+      name = func.getName();
+    name.push_back('\0');
+
+    auto loc = op.getLoc();
+    auto varName = numba::getUniqueLLVMGlobalName(mod, "coexec_key");
+    auto key = mlir::LLVM::createGlobalString(loc, rewriter, varName, name,
+                                              mlir::LLVM::Linkage::Internal);
+    auto res = coexecBeginCallBuilder.create(loc, rewriter, key);
+    rewriter.replaceOp(op, res.getResults());
+    return mlir::success();
+  }
+};
+
+class ConvertGpuCoexecEndPattern
+    : public ConvertOpToGpuRuntimeCallPattern<gpu_runtime::CoexecEndOp> {
+public:
+  ConvertGpuCoexecEndPattern(mlir::LLVMTypeConverter &converter)
+      : ConvertOpToGpuRuntimeCallPattern<gpu_runtime::CoexecEndOp>(
+            converter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(gpu_runtime::CoexecEndOp op,
+                  gpu_runtime::CoexecEndOp::Adaptor /*adaptor*/,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    coexecEndCallBuilder.create(op.getLoc(), rewriter, {});
+    rewriter.eraseOp(op);
+    return mlir::success();
+  }
+};
+
 template <unsigned Size> static bool isInt(mlir::Type type) {
   auto intType = mlir::dyn_cast<mlir::IntegerType>(type);
   if (!intType)
@@ -613,8 +745,12 @@ private:
         paramsArrayVoidPtr,
         // clang-format on
     };
-    auto event =
-        launchKernelCallBuilder.create(loc, rewriter, params)->getResult(0);
+    // Packed kernels get all params in the single buffer.
+    auto &launchBuilder =
+        op->hasAttr(gpu_runtime::getPackedArgsAttrName())
+            ? launchKernelPackedCallBuilder
+            : launchKernelCallBuilder;
+    auto event = launchBuilder.create(loc, rewriter, params)->getResult(0);
     if (op.getNumResults() == 0) {
       waitEventCallBuilder.create(loc, rewriter, {queue, event});
       destroyEventCallBuilder.create(loc, rewriter, {queue, event});
@@ -776,6 +912,39 @@ private:
   }
 };
 
+class ConvertGpuPrefetchPattern
+    : public ConvertOpToGpuRuntimeCallPattern<gpu_runtime::GPUPrefetchOp> {
+public:
+  ConvertGpuPrefetchPattern(mlir::LLVMTypeConverter &converter)
+      : ConvertOpToGpuRuntimeCallPattern<gpu_runtime::GPUPrefetchOp>(
+            converter) {}
+
+private:
+  mlir::LogicalResult
+  matchAndRewrite(gpu_runtime::GPUPrefetchOp op,
+                  gpu_runtime::GPUPrefetchOp::Adaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto memrefType = mlir::cast<mlir::MemRefType>(op.getMemref().getType());
+    if (!memrefType.getLayout().isIdentity())
+      return rewriter.notifyMatchFailure(op, "Expected identity layout");
+
+    auto loc = op.getLoc();
+    mlir::MemRefDescriptor desc(adaptor.getMemref());
+    mlir::Value size =
+        getSizeInBytes(loc, memrefType.getElementType(), rewriter);
+    for (auto i : llvm::seq(0u, static_cast<unsigned>(memrefType.getRank())))
+      size = rewriter.create<mlir::LLVM::MulOp>(loc, llvmIndexType, size,
+                                                desc.size(rewriter, loc, i));
+
+    auto pointer = rewriter.create<mlir::LLVM::BitcastOp>(
+        loc, llvmPointerType, desc.alignedPtr(rewriter, loc));
+    mlir::Value params[] = {adaptor.getQueue(), pointer, size};
+    prefetchCallBuilder.create(loc, rewriter, params);
+    rewriter.eraseOp(op);
+    return mlir::success();
+  }
+};
+
 class ConvertGpuSuggestBlockSizePattern
     : public ConvertOpToGpuRuntimeCallPattern<
           gpu_runtime::GPUSuggestBlockSizeOp> {
@@ -916,9 +1085,14 @@ void gpu_runtime::populateGpuToLLVMPatternsAndLegality(
       ConvertGpuModuleDestroyPattern,
       ConvertGpuKernelGetPattern,
       ConvertGpuKernelDestroyPattern,
+      ConvertGpuConcurrentBeginPattern,
+      ConvertGpuConcurrentEndPattern,
+      ConvertGpuCoexecBeginPattern,
+      ConvertGpuCoexecEndPattern,
       ConvertGpuKernelLaunchPattern,
       ConvertGpuAllocPattern,
       ConvertGpuDeAllocPattern,
+      ConvertGpuPrefetchPattern,
       ConvertGpuSuggestBlockSizePattern
       // clang-format on
       >(converter);
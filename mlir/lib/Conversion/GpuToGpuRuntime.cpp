@@ -8,6 +8,7 @@
 
 #include "numba/Analysis/AliasAnalysis.hpp"
 #include "numba/Dialect/gpu_runtime/IR/GpuRuntimeOps.hpp"
+#include "numba/Dialect/gpu_runtime/Transforms/LowerLaunchesToCpu.hpp"
 #include "numba/Dialect/math_ext/IR/MathExt.hpp"
 #include "numba/Dialect/numba_util/Dialect.hpp"
 #include "numba/Transforms/CastUtils.hpp"
@@ -45,8 +46,13 @@
 #include <mlir/Transforms/DialectConversion.h>
 #include <mlir/Transforms/GreedyPatternRewriteDriver.h>
 
+#include <llvm/ADT/ScopeExit.h>
 #include <llvm/ADT/SmallBitVector.h>
+#include <llvm/Support/FileSystem.h>
 #include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Program.h>
 
 namespace {
 static gpu_runtime::GPURegionDescAttr getGpuRegionEnv(mlir::Operation *op) {
@@ -272,6 +278,13 @@ struct ConvertAtomicRMW
     const std::pair<RMWK, func_t> handlers[] = {
         {RMWK::addi, &lowerIntAtomic<mlir::spirv::AtomicIAddOp>},
         {RMWK::addf, &lowerFloatAtomic<mlir::spirv::EXTAtomicFAddOp>},
+        {RMWK::andi, &lowerIntAtomic<mlir::spirv::AtomicAndOp>},
+        {RMWK::ori, &lowerIntAtomic<mlir::spirv::AtomicOrOp>},
+        {RMWK::maxs, &lowerIntAtomic<mlir::spirv::AtomicSMaxOp>},
+        {RMWK::maxu, &lowerIntAtomic<mlir::spirv::AtomicUMaxOp>},
+        {RMWK::mins, &lowerIntAtomic<mlir::spirv::AtomicSMinOp>},
+        {RMWK::minu, &lowerIntAtomic<mlir::spirv::AtomicUMinOp>},
+        {RMWK::assign, &lowerFloatAtomic<mlir::spirv::AtomicExchangeOp>},
     };
 
     auto kind = adaptor.getKind();
@@ -289,6 +302,224 @@ struct ConvertAtomicRMW
   }
 };
 
+/// Matches compare-and-swap `memref.generic_atomic_rmw` body:
+/// `select(cmpi eq(current, cmp), val, current)`. Returns `(cmp, val)`.
+static std::optional<std::pair<mlir::Value, mlir::Value>>
+matchAtomicCAS(mlir::memref::GenericAtomicRMWOp op) {
+  auto body = op.getBody();
+  if (!llvm::hasNItems(*body, 3))
+    return std::nullopt;
+
+  auto yield = mlir::cast<mlir::memref::AtomicYieldOp>(body->getTerminator());
+  auto select = yield.getResult().getDefiningOp<mlir::arith::SelectOp>();
+  if (!select)
+    return std::nullopt;
+
+  auto current = op.getCurrentValue();
+  auto cmp = select.getCondition().getDefiningOp<mlir::arith::CmpIOp>();
+  if (!cmp || cmp.getPredicate() != mlir::arith::CmpIPredicate::eq ||
+      cmp.getLhs() != current || select.getFalseValue() != current)
+    return std::nullopt;
+
+  auto isOutside = [&](mlir::Value val) {
+    return !op.getAtomicBody().isAncestor(val.getParentRegion());
+  };
+  auto expected = cmp.getRhs();
+  auto val = select.getTrueValue();
+  if (!isOutside(expected) || !isOutside(val))
+    return std::nullopt;
+
+  return std::pair(expected, val);
+}
+
+static mlir::Value createAtomicCAS(mlir::OpBuilder &builder,
+                                   mlir::Location loc, mlir::Value memref,
+                                   mlir::ValueRange indices, mlir::Value cmp,
+                                   mlir::Value val) {
+  auto op =
+      builder.create<mlir::memref::GenericAtomicRMWOp>(loc, memref, indices);
+  mlir::OpBuilder::InsertionGuard g(builder);
+  builder.setInsertionPointToStart(op.getBody());
+  auto current = op.getCurrentValue();
+  auto eq = builder.create<mlir::arith::CmpIOp>(
+      loc, mlir::arith::CmpIPredicate::eq, current, cmp);
+  mlir::Value res =
+      builder.create<mlir::arith::SelectOp>(loc, eq, val, current);
+  builder.create<mlir::memref::AtomicYieldOp>(loc, res);
+  return op.getResult();
+}
+
+struct ConvertAtomicCAS
+    : public mlir::OpConversionPattern<mlir::memref::GenericAtomicRMWOp> {
+  using OpConversionPattern::OpConversionPattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::memref::GenericAtomicRMWOp op,
+                  mlir::memref::GenericAtomicRMWOp::Adaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    if (!llvm::all_of(op.getIndices(),
+                      [](auto v) { return mlir::isConstantIntValue(v, 0); }))
+      return mlir::failure();
+
+    auto cas = matchAtomicCAS(op);
+    if (!cas)
+      return mlir::failure();
+
+    auto mem = adaptor.getMemref();
+    auto memType = mlir::dyn_cast<mlir::spirv::PointerType>(mem.getType());
+    if (!memType)
+      return mlir::failure();
+
+    auto resType = getTypeConverter()->convertType(op.getType());
+    if (!mlir::isa_and_present<mlir::IntegerType>(resType))
+      return mlir::failure();
+
+    auto storageClass = memType.getStorageClass();
+    auto scope = mlir::spirv::StorageClass::Workgroup == storageClass
+                     ? mlir::spirv::Scope::Workgroup
+                     : mlir::spirv::Scope::Device;
+
+    auto cmp = rewriter.getRemappedValue(cas->first);
+    auto val = rewriter.getRemappedValue(cas->second);
+    if (!cmp || !val)
+      return mlir::failure();
+
+    auto semantics = mlir::spirv::MemorySemantics::SequentiallyConsistent;
+    rewriter.replaceOpWithNewOp<mlir::spirv::AtomicCompareExchangeOp>(
+        op, resType, mem, scope, semantics, semantics, val, cmp);
+    return mlir::success();
+  }
+};
+
+/// Float atomic add requires SPV_EXT_shader_atomic_float_add capability for
+/// the specific type width, use generic op, lowered to the CAS loop, if it's
+/// not available.
+struct ExpandUnsupportedAtomicRMW
+    : public mlir::OpRewritePattern<mlir::memref::AtomicRMWOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::memref::AtomicRMWOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto kind = op.getKind();
+    if (kind != mlir::arith::AtomicRMWKind::addf)
+      return mlir::failure();
+
+    auto floatType = mlir::dyn_cast<mlir::FloatType>(op.getType());
+    if (!floatType)
+      return mlir::failure();
+
+    namespace spirv = mlir::spirv;
+    spirv::TargetEnv env(spirv::lookupTargetEnvOrDefault(op));
+    auto cap = [&]() -> std::optional<spirv::Capability> {
+      switch (floatType.getWidth()) {
+      case 16:
+        return spirv::Capability::AtomicFloat16AddEXT;
+      case 32:
+        return spirv::Capability::AtomicFloat32AddEXT;
+      case 64:
+        return spirv::Capability::AtomicFloat64AddEXT;
+      }
+      return std::nullopt;
+    }();
+    if (cap && env.allows(*cap) &&
+        env.allows(spirv::Extension::SPV_EXT_shader_atomic_float_add))
+      return mlir::failure();
+
+    auto val = op.getValue();
+    auto newOp = rewriter.create<mlir::memref::GenericAtomicRMWOp>(
+        op.getLoc(), op.getMemref(), op.getIndices());
+    {
+      mlir::OpBuilder::InsertionGuard g(rewriter);
+      rewriter.setInsertionPointToStart(newOp.getBody());
+      auto res = mlir::arith::getReductionOp(kind, rewriter, op.getLoc(),
+                                             newOp.getCurrentValue(), val);
+      rewriter.create<mlir::memref::AtomicYieldOp>(op.getLoc(), res);
+    }
+    rewriter.replaceOp(op, newOp.getResult());
+    return mlir::success();
+  }
+};
+
+/// Lowers `memref.generic_atomic_rmw` to the loop over compare-and-swap ops:
+///
+/// ```
+/// old = load(mem)
+/// do {
+///   prev = old
+///   old = cas(mem, prev, body(prev))
+/// } while (old != prev)
+/// ```
+///
+/// Floats are compared by bits.
+struct ExpandGenericAtomicRMW
+    : public mlir::OpRewritePattern<mlir::memref::GenericAtomicRMWOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::memref::GenericAtomicRMWOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    if (matchAtomicCAS(op))
+      return mlir::failure();
+
+    auto memref = op.getMemref();
+    auto memrefType = op.getMemRefType();
+    auto elemType = memrefType.getElementType();
+    if (!elemType.isIntOrFloat())
+      return mlir::failure();
+
+    auto loc = op.getLoc();
+    auto intType = rewriter.getIntegerType(elemType.getIntOrFloatBitWidth());
+    auto intMemrefType = memrefType.clone(intType);
+    mlir::Value intMemref = memref;
+    if (intMemrefType != memrefType)
+      intMemref = rewriter.create<numba::util::MemrefBitcastOp>(
+          loc, intMemrefType, memref);
+
+    auto toInt = [&](mlir::OpBuilder &b, mlir::Value val) -> mlir::Value {
+      if (val.getType() != intType)
+        val = b.create<mlir::arith::BitcastOp>(loc, intType, val);
+      return val;
+    };
+
+    auto indices = op.getIndices();
+    mlir::Value init =
+        rewriter.create<mlir::memref::LoadOp>(loc, memref, indices);
+
+    auto beforeBuilder = [&](mlir::OpBuilder &b, mlir::Location l,
+                             mlir::ValueRange args) {
+      auto prev = args.front();
+      mlir::IRMapping mapping;
+      mapping.map(op.getCurrentValue(), prev);
+      for (auto &bodyOp : op.getBody()->without_terminator())
+        b.clone(bodyOp, mapping);
+
+      auto term = op.getBody()->getTerminator();
+      auto yield = mlir::cast<mlir::memref::AtomicYieldOp>(term);
+      auto newVal = mapping.lookupOrDefault(yield.getResult());
+
+      auto prevInt = toInt(b, prev);
+      mlir::Value old = createAtomicCAS(b, l, intMemref, indices, prevInt,
+                                        toInt(b, newVal));
+      mlir::Value retry = b.create<mlir::arith::CmpIOp>(
+          l, mlir::arith::CmpIPredicate::ne, old, prevInt);
+      if (old.getType() != elemType)
+        old = b.create<mlir::arith::BitcastOp>(l, elemType, old);
+
+      b.create<mlir::scf::ConditionOp>(l, retry, old);
+    };
+    auto afterBuilder = [&](mlir::OpBuilder &b, mlir::Location l,
+                            mlir::ValueRange args) {
+      b.create<mlir::scf::YieldOp>(l, args);
+    };
+
+    auto loop = rewriter.create<mlir::scf::WhileOp>(
+        loc, elemType, init, beforeBuilder, afterBuilder);
+    rewriter.replaceOp(op, loop.getResults());
+    return mlir::success();
+  }
+};
+
 static bool isBoolScalarOrVector(mlir::Type type) {
   assert(type && "Not a valid type");
   if (type.isInteger(1))
@@ -471,9 +702,20 @@ getSpirvMemSematics(gpu_runtime::FenceFlags flags) {
     return mlir::spirv::MemorySemantics::SequentiallyConsistent |
            mlir::spirv::MemorySemantics::WorkgroupMemory;
   }
+  if (flags == gpu_runtime::FenceFlags::device) {
+    return mlir::spirv::MemorySemantics::AcquireRelease |
+           mlir::spirv::MemorySemantics::CrossWorkgroupMemory;
+  }
   return std::nullopt;
 }
 
+static mlir::spirv::Scope getSpirvMemScope(gpu_runtime::FenceFlags flags) {
+  if (flags == gpu_runtime::FenceFlags::device)
+    return mlir::spirv::Scope::Device;
+
+  return mlir::spirv::Scope::Workgroup;
+}
+
 class ConvertBarrierOp
     : public mlir::OpConversionPattern<mlir::gpu::BarrierOp> {
 public:
@@ -493,8 +735,8 @@ public:
       return mlir::failure();
 
     auto scope = mlir::spirv::Scope::Workgroup;
-    rewriter.replaceOpWithNewOp<mlir::spirv::ControlBarrierOp>(op, scope, scope,
-                                                               *semantics);
+    rewriter.replaceOpWithNewOp<mlir::spirv::ControlBarrierOp>(
+        op, scope, getSpirvMemScope(flags), *semantics);
     return mlir::success();
   }
 };
@@ -513,9 +755,8 @@ public:
     if (!semantics)
       return mlir::failure();
 
-    auto scope = mlir::spirv::Scope::Workgroup;
-    rewriter.replaceOpWithNewOp<mlir::spirv::MemoryBarrierOp>(op, scope,
-                                                              *semantics);
+    rewriter.replaceOpWithNewOp<mlir::spirv::MemoryBarrierOp>(
+        op, getSpirvMemScope(flags), *semantics);
     return mlir::success();
   }
 };
@@ -736,6 +977,148 @@ public:
   }
 };
 
+/// Subgroup builtins are 32bit in OpenCL, convert them to the index type.
+template <typename SourceOp, mlir::spirv::BuiltIn builtin>
+class SubgroupConfigConversion : public mlir::OpConversionPattern<SourceOp> {
+public:
+  // Set benefit higher than upstream lowering.
+  SubgroupConfigConversion(mlir::TypeConverter &converter,
+                           mlir::MLIRContext *context)
+      : mlir::OpConversionPattern<SourceOp>(converter, context,
+                                            /*benefit*/ 10) {}
+
+  mlir::LogicalResult
+  matchAndRewrite(SourceOp op, typename SourceOp::Adaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto *typeConverter = this->getTypeConverter();
+    auto indexType = typeConverter->convertType(op.getType());
+    if (!mlir::isa_and_present<mlir::IntegerType>(indexType))
+      return rewriter.notifyMatchFailure(op, "Invalid index type");
+
+    auto int32Type = rewriter.getIntegerType(32);
+    mlir::Value val =
+        mlir::spirv::getBuiltinVariableValue(op, builtin, int32Type, rewriter);
+    if (indexType != int32Type)
+      val = rewriter.create<mlir::spirv::UConvertOp>(op.getLoc(), indexType,
+                                                     val);
+
+    rewriter.replaceOp(op, val);
+    return mlir::success();
+  }
+};
+
+/// Shuffle to the exact lane, ignoring the width, as subgroup size is not known
+/// during compilation. Upstream lowering requires width to be equal to the
+/// target env subgroup size.
+class ConvertShuffleOp
+    : public mlir::OpConversionPattern<mlir::gpu::ShuffleOp> {
+public:
+  // Set benefit higher than upstream lowering.
+  ConvertShuffleOp(mlir::TypeConverter &typeConverter,
+                   mlir::MLIRContext *context)
+      : mlir::OpConversionPattern<mlir::gpu::ShuffleOp>(typeConverter, context,
+                                                        /*benefit*/ 10) {}
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::gpu::ShuffleOp op,
+                  mlir::gpu::ShuffleOp::Adaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto loc = op.getLoc();
+    auto scope = mlir::spirv::ScopeAttr::get(rewriter.getContext(),
+                                             mlir::spirv::Scope::Subgroup);
+    auto value = adaptor.getValue();
+    auto offset = adaptor.getOffset();
+    mlir::Value res;
+    switch (op.getMode()) {
+    case mlir::gpu::ShuffleMode::XOR:
+      res = rewriter.create<mlir::spirv::GroupNonUniformShuffleXorOp>(
+          loc, value.getType(), scope, value, offset);
+      break;
+    case mlir::gpu::ShuffleMode::IDX:
+      res = rewriter.create<mlir::spirv::GroupNonUniformShuffleOp>(
+          loc, value.getType(), scope, value, offset);
+      break;
+    default:
+      return rewriter.notifyMatchFailure(op, "Unsupported shuffle mode");
+    }
+
+    auto i1 = rewriter.getI1Type();
+    mlir::Value valid = rewriter.create<mlir::spirv::ConstantOp>(
+        loc, i1, rewriter.getBoolAttr(true));
+    rewriter.replaceOp(op, {res, valid});
+    return mlir::success();
+  }
+};
+
+template <typename Op>
+static mlir::Value createGroupNonUniformOp(mlir::OpBuilder &builder,
+                                           mlir::Location loc, mlir::Type type,
+                                           mlir::spirv::GroupOperation groupOp,
+                                           mlir::Value value) {
+  auto ctx = builder.getContext();
+  auto scope = mlir::spirv::ScopeAttr::get(ctx, mlir::spirv::Scope::Subgroup);
+  auto groupOpAttr = mlir::spirv::GroupOperationAttr::get(ctx, groupOp);
+  return builder.create<Op>(loc, type, scope, groupOpAttr, value,
+                            /*cluster_size*/ mlir::Value{});
+}
+
+class ConvertSubgroupScanOp
+    : public mlir::OpConversionPattern<gpu_runtime::GPUSubgroupScanOp> {
+public:
+  using OpConversionPattern::OpConversionPattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(gpu_runtime::GPUSubgroupScanOp op,
+                  gpu_runtime::GPUSubgroupScanOp::Adaptor adaptor,
+                  mlir::ConversionPatternRewriter &rewriter) const override {
+    auto value = adaptor.getValue();
+    auto type = value.getType();
+    if (!type.isIntOrFloat())
+      return mlir::failure();
+
+    using funcptr_t =
+        mlir::Value (*)(mlir::OpBuilder &, mlir::Location, mlir::Type,
+                        mlir::spirv::GroupOperation, mlir::Value);
+    using Op = mlir::gpu::AllReduceOperation;
+    namespace spirv = mlir::spirv;
+    const std::tuple<Op, funcptr_t, funcptr_t> handlers[] = {
+        {Op::ADD, &createGroupNonUniformOp<spirv::GroupNonUniformIAddOp>,
+         &createGroupNonUniformOp<spirv::GroupNonUniformFAddOp>},
+        {Op::MUL, &createGroupNonUniformOp<spirv::GroupNonUniformIMulOp>,
+         &createGroupNonUniformOp<spirv::GroupNonUniformFMulOp>},
+        {Op::MINSI, &createGroupNonUniformOp<spirv::GroupNonUniformSMinOp>,
+         nullptr},
+        {Op::MINUI, &createGroupNonUniformOp<spirv::GroupNonUniformUMinOp>,
+         nullptr},
+        {Op::MAXSI, &createGroupNonUniformOp<spirv::GroupNonUniformSMaxOp>,
+         nullptr},
+        {Op::MAXUI, &createGroupNonUniformOp<spirv::GroupNonUniformUMaxOp>,
+         nullptr},
+        {Op::MINIMUMF, nullptr,
+         &createGroupNonUniformOp<spirv::GroupNonUniformFMinOp>},
+        {Op::MAXIMUMF, nullptr,
+         &createGroupNonUniformOp<spirv::GroupNonUniformFMaxOp>},
+    };
+
+    auto groupOp = op.getExclusive() ? spirv::GroupOperation::ExclusiveScan
+                                     : spirv::GroupOperation::InclusiveScan;
+    auto isFloat = mlir::isa<mlir::FloatType>(type);
+    for (auto &&[reduceOp, intFunc, floatFunc] : handlers) {
+      if (reduceOp != op.getOp())
+        continue;
+
+      auto func = isFloat ? floatFunc : intFunc;
+      if (!func)
+        return mlir::failure();
+
+      rewriter.replaceOp(op, func(rewriter, op.getLoc(), type, groupOp, value));
+      return mlir::success();
+    }
+
+    return mlir::failure();
+  }
+};
+
 namespace {
 using namespace mlir;
 
@@ -826,6 +1209,137 @@ struct CheckedElementwiseOpPattern final
 };
 } // namespace
 
+// Must be kept in sync with GpuModule.cpp.
+static constexpr llvm::StringLiteral SpecConstantPrefix("__nmspec.");
+static constexpr llvm::StringLiteral SpecConstantSetPrefix("__nmspecset.");
+static constexpr unsigned MaxSpecArgs = 8;
+
+/// Replace `index` kernel arguments (shapes, strides and offsets after memref
+/// decomposition) with `isSet ? spec : arg`, where `spec` and `isSet` are
+/// specialization constants, value and i32 flag, both with default value 0,
+/// so generic kernel still uses runtime value. Constants are named
+/// `<prefix><arg index>.<kernel name>`, runtime maps them to launch arguments
+/// and builds kernel variants for specific values, including 0.
+static void addArgSpecConstants(mlir::spirv::ModuleOp spvMod,
+                                mlir::gpu::GPUModuleOp gpuMod) {
+  mlir::OpBuilder builder(spvMod.getContext());
+  auto i32 = builder.getI32Type();
+  uint32_t specId = 0;
+  unsigned numArgs = 0;
+  for (auto gpuFunc : gpuMod.getOps<mlir::gpu::GPUFuncOp>()) {
+    if (!gpuFunc.isKernel())
+      continue;
+
+    auto spvFunc = spvMod.lookupSymbol<mlir::spirv::FuncOp>(gpuFunc.getName());
+    if (!spvFunc || spvFunc.isExternal() ||
+        spvFunc.getNumArguments() != gpuFunc.getNumArguments())
+      continue;
+
+    auto &entry = spvFunc.getBody().front();
+    for (auto &&[i, gpuArg] : llvm::enumerate(gpuFunc.getArguments())) {
+      if (numArgs >= MaxSpecArgs)
+        return;
+
+      if (!mlir::isa<mlir::IndexType>(gpuArg.getType()))
+        continue;
+
+      auto arg = entry.getArgument(static_cast<unsigned>(i));
+      auto type = mlir::dyn_cast<mlir::IntegerType>(arg.getType());
+      if (!type || arg.use_empty())
+        continue;
+
+      auto loc = spvFunc.getLoc();
+      auto createSpecConst = [&](llvm::StringRef prefix, mlir::Type constType) {
+        auto name =
+            (prefix + llvm::Twine(i) + "." + gpuFunc.getName()).str();
+        builder.setInsertionPointToStart(spvMod.getBody());
+        auto specConst = builder.create<mlir::spirv::SpecConstantOp>(
+            loc, builder.getStringAttr(name),
+            builder.getIntegerAttr(constType, 0));
+        specConst->setAttr("spec_id", builder.getI32IntegerAttr(specId++));
+        return specConst;
+      };
+      auto specConst = createSpecConst(SpecConstantPrefix, type);
+      auto flagConst = createSpecConst(SpecConstantSetPrefix, i32);
+      ++numArgs;
+
+      builder.setInsertionPointToStart(&entry);
+      mlir::Value spec = builder.create<mlir::spirv::ReferenceOfOp>(
+          loc, type, mlir::SymbolRefAttr::get(specConst));
+      mlir::Value flag = builder.create<mlir::spirv::ReferenceOfOp>(
+          loc, i32, mlir::SymbolRefAttr::get(flagConst));
+      mlir::Value zero = mlir::spirv::ConstantOp::getZero(i32, loc, builder);
+      mlir::Value isSet =
+          builder.create<mlir::spirv::INotEqualOp>(loc, flag, zero);
+      mlir::Value val =
+          builder.create<mlir::spirv::SelectOp>(loc, isSet, spec, arg);
+      arg.replaceAllUsesExcept(val, val.getDefiningOp());
+    }
+  }
+}
+
+/// Checks if kernel argument of `type` can be loaded from the packed
+/// arguments buffer.
+static bool isPackableArgType(mlir::Type type) {
+  if (auto ptrType = mlir::dyn_cast<mlir::spirv::PointerType>(type))
+    return ptrType.getStorageClass() ==
+           mlir::spirv::StorageClass::CrossWorkgroup;
+
+  if (auto intType = mlir::dyn_cast<mlir::IntegerType>(type))
+    return intType.getWidth() >= 8;
+
+  return mlir::isa<mlir::FloatType>(type);
+}
+
+/// Replace arguments of kernels with more than `threshold` arguments with the
+/// single pointer to the struct of them. Struct has natural layout, runtime
+/// packs launch arguments in the same order. Packed kernels are marked on the
+/// host side gpu.func, so launches can be lowered accordingly.
+static void packKernelArgs(mlir::spirv::ModuleOp spvMod,
+                           mlir::gpu::GPUModuleOp gpuMod, int64_t threshold) {
+  namespace spirv = mlir::spirv;
+  auto ctx = spvMod.getContext();
+  mlir::OpBuilder builder(ctx);
+  for (auto gpuFunc : gpuMod.getOps<mlir::gpu::GPUFuncOp>()) {
+    if (!gpuFunc.isKernel() ||
+        static_cast<int64_t>(gpuFunc.getNumArguments()) <= threshold)
+      continue;
+
+    auto spvFunc = spvMod.lookupSymbol<spirv::FuncOp>(gpuFunc.getName());
+    if (!spvFunc || spvFunc.isExternal() ||
+        spvFunc.getNumArguments() != gpuFunc.getNumArguments())
+      continue;
+
+    auto argTypes = spvFunc.getArgumentTypes();
+    if (!llvm::all_of(argTypes, &isPackableArgType))
+      continue;
+
+    auto structType = spirv::StructType::get(argTypes);
+    auto ptrType = spirv::PointerType::get(
+        structType, spirv::StorageClass::CrossWorkgroup);
+
+    auto loc = spvFunc.getLoc();
+    auto &entry = spvFunc.getBody().front();
+    auto numArgs = entry.getNumArguments();
+    auto packed = entry.addArgument(ptrType, loc);
+    builder.setInsertionPointToStart(&entry);
+    auto i32 = builder.getI32Type();
+    for (auto i : llvm::seq(0u, numArgs)) {
+      mlir::Value idx = builder.create<spirv::ConstantOp>(
+          loc, i32, builder.getI32IntegerAttr(static_cast<int32_t>(i)));
+      mlir::Value ptr = builder.create<spirv::AccessChainOp>(loc, packed, idx);
+      mlir::Value val = builder.create<spirv::LoadOp>(loc, ptr);
+      entry.getArgument(i).replaceAllUsesWith(val);
+    }
+    entry.eraseArguments(0, numArgs);
+
+    spvFunc.removeArgAttrsAttr();
+    spvFunc.setFunctionType(mlir::FunctionType::get(ctx, ptrType, {}));
+    gpuFunc->setAttr(gpu_runtime::getPackedArgsAttrName(),
+                     mlir::UnitAttr::get(ctx));
+  }
+}
+
 struct GPUToSpirvPass
     : public mlir::PassWrapper<GPUToSpirvPass,
                                mlir::OperationPass<mlir::ModuleOp>> {
@@ -854,6 +1368,15 @@ struct GPUToSpirvPass
     });
 
     for (auto kernelModule : kernelModules) {
+      {
+        mlir::RewritePatternSet patterns(context);
+        patterns.insert<ExpandUnsupportedAtomicRMW, ExpandGenericAtomicRMW>(
+            context);
+        if (mlir::failed(mlir::applyPatternsAndFoldGreedily(
+                kernelModule, std::move(patterns))))
+          return signalPassFailure();
+      }
+
       auto targetAttr = mlir::spirv::lookupTargetEnvOrDefault(kernelModule);
       auto target = mlir::SPIRVConversionTarget::get(targetAttr);
 
@@ -913,9 +1436,20 @@ struct GPUToSpirvPass
           ConvertBitcastOp<numba::util::BitcastOp>,
           ConvertBitcastOp<numba::util::MemrefApplyOffsetOp>,
           ConvertBitcastOp<numba::util::MemrefBitcastOp>, ConvertAtomicRMW,
+          ConvertAtomicCAS,
           ConvertI1SIndexCast, ConvertI1UIndexCast, AllocaOpPattern,
           ConvertFunc, ConvertAssert, ConvertBarrierOp, ConvertMemFenceOp,
-          ConvertPoison, ConvertGlobalOp, ConvertGetGlobalOp,
+          ConvertPoison, ConvertGlobalOp, ConvertGetGlobalOp, ConvertShuffleOp,
+          ConvertSubgroupScanOp,
+          SubgroupConfigConversion<
+              mlir::gpu::LaneIdOp,
+              mlir::spirv::BuiltIn::SubgroupLocalInvocationId>,
+          SubgroupConfigConversion<mlir::gpu::SubgroupSizeOp,
+                                   mlir::spirv::BuiltIn::SubgroupSize>,
+          SubgroupConfigConversion<mlir::gpu::SubgroupIdOp,
+                                   mlir::spirv::BuiltIn::SubgroupId>,
+          SubgroupConfigConversion<mlir::gpu::NumSubgroupsOp,
+                                   mlir::spirv::BuiltIn::NumSubgroups>,
           LaunchConfigConversion<mlir::gpu::BlockIdOp,
                                  mlir::spirv::BuiltIn::WorkgroupId>,
           LaunchConfigConversion<mlir::gpu::GridDimOp,
@@ -964,6 +1498,14 @@ struct GPUToSpirvPass
         spvMod->setAttr(attr.getName(), attr.getValue());
       }
 
+      if (spvMod->hasAttr(gpu_runtime::getSpecConstantsAttrName()))
+        addArgSpecConstants(spvMod, it->second);
+
+      if (auto packArgs = spvMod->getAttrOfType<mlir::IntegerAttr>(
+              gpu_runtime::getPackArgsAttrName()))
+        if (packArgs.getInt() > 0)
+          packKernelArgs(spvMod, it->second, packArgs.getInt());
+
       return mlir::WalkResult::advance();
     };
 
@@ -972,6 +1514,156 @@ struct GPUToSpirvPass
   }
 };
 
+/// Returns strided memref, kernel operand `memref` was decomposed from, or
+/// null if it is unknown.
+static mlir::Value getSpanSource(mlir::Value memref) {
+  if (auto extract =
+          memref.getDefiningOp<mlir::memref::ExtractStridedMetadataOp>())
+    if (memref == extract.getBaseBuffer())
+      memref = extract.getSource();
+
+  auto type = mlir::dyn_cast<mlir::MemRefType>(memref.getType());
+  if (!type || !mlir::isStrided(type))
+    return {};
+
+  return memref;
+}
+
+/// Upper bound of the linear element offset, which kernel can access through
+/// `memref` operand.
+static mlir::Value getMemrefSpan(mlir::OpBuilder &builder, mlir::Location loc,
+                                 mlir::Value memref) {
+  memref = getSpanSource(memref);
+  assert(memref && "Unknown memref span");
+  auto metadata =
+      builder.create<mlir::memref::ExtractStridedMetadataOp>(loc, memref);
+  mlir::Value zero = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  mlir::Value span = metadata.getOffset();
+  for (auto &&[size, stride] :
+       llvm::zip(metadata.getSizes(), metadata.getStrides())) {
+    mlir::Value neg = builder.create<mlir::arith::SubIOp>(loc, zero, stride);
+    mlir::Value absStride =
+        builder.create<mlir::arith::MaxSIOp>(loc, stride, neg);
+    mlir::Value extent =
+        builder.create<mlir::arith::MulIOp>(loc, size, absStride);
+    span = builder.create<mlir::arith::AddIOp>(loc, span, extent);
+  }
+  return span;
+}
+
+/// Checks, that index kernel operands, launch grid and memref operand spans
+/// fit into i32.
+static mlir::Value checkFitsInt32(mlir::OpBuilder &builder,
+                                  mlir::gpu::LaunchFuncOp launch) {
+  auto loc = launch.getLoc();
+  auto max = builder.create<mlir::arith::ConstantIndexOp>(
+      loc, std::numeric_limits<int32_t>::max());
+  auto min = builder.create<mlir::arith::ConstantIndexOp>(
+      loc, std::numeric_limits<int32_t>::min());
+  mlir::Value ret = builder.create<mlir::arith::ConstantIntOp>(loc, 1, 1);
+  auto addCheck = [&](mlir::arith::CmpIPredicate pred, mlir::Value lhs,
+                      mlir::Value rhs) {
+    mlir::Value cond = builder.create<mlir::arith::CmpIOp>(loc, pred, lhs, rhs);
+    ret = builder.create<mlir::arith::AndIOp>(loc, ret, cond);
+  };
+  auto addRangeCheck = [&](mlir::Value val) {
+    addCheck(mlir::arith::CmpIPredicate::sle, val, max);
+    addCheck(mlir::arith::CmpIPredicate::sge, val, min);
+  };
+
+  auto grid = launch.getGridSizeOperandValues();
+  auto block = launch.getBlockSizeOperandValues();
+  for (auto &&[g, b] : {std::pair(grid.x, block.x), std::pair(grid.y, block.y),
+                        std::pair(grid.z, block.z)}) {
+    mlir::Value size = builder.create<mlir::arith::MulIOp>(loc, g, b);
+    addCheck(mlir::arith::CmpIPredicate::ule, size, max);
+  }
+
+  for (auto arg : launch.getKernelOperands()) {
+    auto type = arg.getType();
+    if (mlir::isa<mlir::IndexType>(type)) {
+      addRangeCheck(arg);
+    } else if (mlir::isa<mlir::MemRefType>(type)) {
+      addRangeCheck(getMemrefSpan(builder, loc, arg));
+    }
+  }
+  return ret;
+}
+
+struct GpuIndexVariantsPass
+    : public mlir::PassWrapper<GpuIndexVariantsPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(GpuIndexVariantsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    auto module = getOperation();
+    auto *ctx = &getContext();
+    auto attrName = gpu_runtime::getUse64BitIndexAttrName();
+
+    llvm::SmallVector<mlir::gpu::LaunchFuncOp> launches;
+    module.walk([&](mlir::gpu::LaunchFuncOp launch) {
+      auto gpuMod = module.lookupSymbol<mlir::gpu::GPUModuleOp>(
+          launch.getKernelModuleName());
+      if (!gpuMod)
+        return;
+
+      auto attr = gpuMod->getAttrOfType<mlir::StringAttr>(attrName);
+      if (!attr || attr.getValue() != "auto")
+        return;
+
+      auto isKnownSpan = [](mlir::Value arg) {
+        return !mlir::isa<mlir::MemRefType>(arg.getType()) ||
+               getSpanSource(arg);
+      };
+      if (llvm::all_of(launch.getKernelOperands(), isKnownSpan))
+        launches.emplace_back(launch);
+    });
+
+    mlir::SymbolTable symbolTable(module);
+    mlir::OpBuilder builder(ctx);
+    auto use64 = builder.getBoolAttr(true);
+    auto use32 = builder.getBoolAttr(false);
+
+    // 32-bit variant is created once per GPU module and shared between all
+    // its launches.
+    llvm::DenseMap<mlir::Operation *, mlir::StringAttr> variants;
+    for (auto launch : launches) {
+      auto gpuMod = symbolTable.lookup<mlir::gpu::GPUModuleOp>(
+          launch.getKernelModuleName());
+      auto &newName = variants[gpuMod];
+      if (!newName) {
+        builder.setInsertionPoint(gpuMod);
+        auto gpuMod32 =
+            mlir::cast<mlir::gpu::GPUModuleOp>(builder.clone(*gpuMod));
+        gpuMod32->setAttr(attrName, use32);
+        gpuMod->setAttr(attrName, use64);
+        mlir::SymbolTable::setSymbolName(gpuMod32,
+                                         (gpuMod.getName() + "_i32").str());
+        newName = symbolTable.insert(gpuMod32);
+      }
+      auto kernel = mlir::SymbolRefAttr::get(
+          newName, mlir::FlatSymbolRefAttr::get(launch.getKernelName()));
+
+      builder.setInsertionPoint(launch);
+      auto fits = checkFitsInt32(builder, launch);
+      auto ifOp = builder.create<mlir::scf::IfOp>(launch.getLoc(), fits,
+                                                  /*withElseRegion*/ true);
+      launch->moveBefore(ifOp.elseBlock()->getTerminator());
+      builder.setInsertionPoint(ifOp.thenBlock()->getTerminator());
+      auto launch32 =
+          mlir::cast<mlir::gpu::LaunchFuncOp>(builder.clone(*launch));
+      launch32.setKernelAttr(kernel);
+    }
+  }
+};
+
 struct GpuIndexCastPass
     : public mlir::PassWrapper<GpuIndexCastPass,
                                mlir::OperationPass<mlir::ModuleOp>> {
@@ -1069,9 +1761,18 @@ struct ExpandLaunchOp : public mlir::OpRewritePattern<mlir::gpu::LaunchFuncOp> {
         rewriter, op,
         [&](mlir::OpBuilder &builder, mlir::Location loc, mlir::Value queue,
             mlir::Value kernel) {
-          return builder.create<gpu_runtime::LaunchGpuKernelOp>(
+          auto launch = builder.create<gpu_runtime::LaunchGpuKernelOp>(
               loc, queue, kernel, op.getGridSizeOperandValues(),
               op.getBlockSizeOperandValues(), op.getKernelOperands());
+
+          auto packedAttrName = gpu_runtime::getPackedArgsAttrName();
+          auto gpuFunc =
+              mlir::SymbolTable::lookupNearestSymbolFrom<mlir::gpu::GPUFuncOp>(
+                  op, op.getKernel());
+          if (gpuFunc && gpuFunc->hasAttr(packedAttrName))
+            launch->setAttr(packedAttrName, builder.getUnitAttr());
+
+          return launch;
         });
   }
 };
@@ -1176,6 +1877,9 @@ static mlir::spirv::TargetEnvAttr defaultCapsMapper(mlir::gpu::GPUModuleOp op) {
       spirv::Capability::Float16Buffer,
       spirv::Capability::Float64,
       spirv::Capability::GenericPointer,
+      spirv::Capability::GroupNonUniform,
+      spirv::Capability::GroupNonUniformArithmetic,
+      spirv::Capability::GroupNonUniformShuffle,
       spirv::Capability::Groups,
       spirv::Capability::Int16,
       spirv::Capability::Int64,
@@ -1230,6 +1934,102 @@ private:
   std::function<mlir::spirv::TargetEnvAttr(mlir::gpu::GPUModuleOp)> mapper;
 };
 
+/// AOT image layout, must be kept in sync with gpu runtime module loader:
+/// magic, number of native binaries, then target name size, binary size,
+/// target name and binary data for each of them and SPIR-V module at the end.
+static constexpr llvm::StringLiteral kAotImageMagic("NMGPUAOT");
+
+static void appendU32(std::string &out, uint32_t val) {
+  out.append(reinterpret_cast<const char *>(&val), sizeof(val));
+}
+
+/// Compiles SPIR-V to the native device binary using `ocloc`.
+static mlir::FailureOr<std::string>
+compileNativeBinary(llvm::StringRef ocloc, llvm::StringRef spirv,
+                    llvm::StringRef target, std::string &errMsg) {
+  llvm::SmallString<128> dir;
+  if (auto ec = llvm::sys::fs::createUniqueDirectory("numba-mlir-aot", dir)) {
+    errMsg = ec.message();
+    return mlir::failure();
+  }
+  auto cleanup =
+      llvm::make_scope_exit([&]() { llvm::sys::fs::remove_directories(dir); });
+
+  llvm::SmallString<128> input(dir);
+  llvm::sys::path::append(input, "module.spv");
+  {
+    std::error_code ec;
+    llvm::raw_fd_ostream os(input, ec, llvm::sys::fs::OF_None);
+    if (ec) {
+      errMsg = ec.message();
+      return mlir::failure();
+    }
+    os << spirv;
+  }
+
+  llvm::StringRef args[] = {ocloc,     "compile", "-q",      "-spirv_input",
+                            "-file",   input,     "-device", target,
+                            "-out_dir", dir,      "-output", "module",
+                            "-output_no_suffix"};
+  if (llvm::sys::ExecuteAndWait(ocloc, args, /*Env*/ std::nullopt,
+                                /*Redirects*/ {}, /*SecondsToWait*/ 0,
+                                /*MemoryLimit*/ 0, &errMsg) != 0)
+    return mlir::failure();
+
+  llvm::SmallString<128> output(dir);
+  llvm::sys::path::append(output, "module.bin");
+  auto buffer = llvm::MemoryBuffer::getFile(output);
+  if (!buffer) {
+    errMsg = buffer.getError().message();
+    return mlir::failure();
+  }
+  return (*buffer)->getBuffer().str();
+}
+
+/// Builds AOT image for comma-separated list of `ocloc` device targets.
+/// Targets, which failed to compile, are skipped with warning, returns empty
+/// string if no native binaries were produced.
+static std::string buildAotImage(mlir::Operation *op, llvm::StringRef spirv,
+                                 llvm::StringRef targets) {
+  auto ocloc = llvm::sys::findProgramByName("ocloc");
+  if (!ocloc) {
+    op->emitWarning("ocloc not found, AOT compilation disabled");
+    return {};
+  }
+
+  llvm::SmallVector<std::pair<llvm::StringRef, std::string>> binaries;
+  llvm::SmallVector<llvm::StringRef> targetsList;
+  targets.split(targetsList, ',', /*MaxSplit*/ -1, /*KeepEmpty*/ false);
+  for (auto target : targetsList) {
+    target = target.trim();
+    if (target.empty())
+      continue;
+
+    std::string errMsg;
+    auto binary = compileNativeBinary(*ocloc, spirv, target, errMsg);
+    if (mlir::failed(binary)) {
+      op->emitWarning("AOT compilation failed for target \"")
+          << target << "\": " << errMsg;
+      continue;
+    }
+    binaries.emplace_back(target, std::move(*binary));
+  }
+
+  if (binaries.empty())
+    return {};
+
+  auto image = kAotImageMagic.str();
+  appendU32(image, static_cast<uint32_t>(binaries.size()));
+  for (auto &&[target, binary] : binaries) {
+    appendU32(image, static_cast<uint32_t>(target.size()));
+    appendU32(image, static_cast<uint32_t>(binary.size()));
+    image.append(target.data(), target.size());
+    image += binary;
+  }
+  image.append(spirv.data(), spirv.size());
+  return image;
+}
+
 struct SerializeSPIRVPass
     : public mlir::PassWrapper<SerializeSPIRVPass,
                                mlir::OperationPass<mlir::ModuleOp>> {
@@ -1266,7 +2066,13 @@ struct SerializeSPIRVPass
       auto spvData =
           llvm::StringRef(reinterpret_cast<const char *>(spvBinary.data()),
                           spvBinary.size() * sizeof(uint32_t));
-      auto spvAttr = mlir::StringAttr::get(&getContext(), spvData);
+      std::string image;
+      if (auto targets = gpuMod->getAttrOfType<mlir::StringAttr>(
+              gpu_runtime::getAotTargetsAttrName()))
+        image = buildAotImage(gpuMod, spvData, targets.getValue());
+
+      auto spvAttr = mlir::StringAttr::get(
+          &getContext(), image.empty() ? spvData : llvm::StringRef(image));
       gpuMod->setAttr(gpu::getDefaultGpuBinaryAnnotation(), spvAttr);
       spvMod->erase();
     }
@@ -1296,6 +2102,215 @@ struct GPUExPass
   }
 };
 
+/// Returns host shared alloc, `memref` is the view of.
+static gpu_runtime::GPUAllocOp getSharedAllocSource(mlir::Value memref) {
+  while (auto def = memref.getDefiningOp()) {
+    if (auto alloc = mlir::dyn_cast<gpu_runtime::GPUAllocOp>(def)) {
+      if (!alloc.getHostShared() || !alloc.getType().getLayout().isIdentity())
+        return nullptr;
+
+      return alloc;
+    }
+
+    if (auto view = mlir::dyn_cast<mlir::ViewLikeOpInterface>(def)) {
+      memref = view.getViewSource();
+    } else if (auto meta =
+                   mlir::dyn_cast<mlir::memref::ExtractStridedMetadataOp>(
+                       def)) {
+      memref = meta.getSource();
+    } else {
+      break;
+    }
+  }
+  return nullptr;
+}
+
+/// Checks if kernel memref argument is only used as store destination.
+static bool isWriteOnlyArg(mlir::Value arg) {
+  llvm::SmallVector<mlir::Value> worklist;
+  worklist.emplace_back(arg);
+  while (!worklist.empty()) {
+    auto memref = worklist.pop_back_val();
+    for (auto user : memref.getUsers()) {
+      if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(user)) {
+        if (store.getValue() == memref)
+          return false;
+
+        continue;
+      }
+
+      if (auto view = mlir::dyn_cast<mlir::ViewLikeOpInterface>(user)) {
+        if (view.getViewSource() != memref)
+          return false;
+
+        worklist.emplace_back(view->getResult(0));
+        continue;
+      }
+
+      if (auto meta =
+              mlir::dyn_cast<mlir::memref::ExtractStridedMetadataOp>(user)) {
+        worklist.emplace_back(meta.getBaseBuffer());
+        continue;
+      }
+
+      if (mlir::isa<mlir::memref::DimOp>(user))
+        continue;
+
+      return false;
+    }
+  }
+  return true;
+}
+
+struct InsertGPUPrefetchPass
+    : public mlir::PassWrapper<InsertGPUPrefetchPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(InsertGPUPrefetchPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<gpu_runtime::GpuRuntimeDialect>();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<gpu_runtime::LaunchGpuKernelOp> launches;
+    getOperation()->walk([&](gpu_runtime::LaunchGpuKernelOp launch) {
+      launches.emplace_back(launch);
+    });
+
+    mlir::OpBuilder builder(&getContext());
+    llvm::SmallSetVector<mlir::Value, 4> toPrefetch;
+    llvm::DenseMap<mlir::Value, llvm::SmallPtrSet<mlir::Value, 4>> aliasesMap;
+    bool changed = false;
+    for (auto launch : launches) {
+      // Kernel body is used to skip write-only arguments, prefetch everything
+      // if it is not available.
+      mlir::gpu::GPUFuncOp kernelFunc;
+      if (auto kernelOp =
+              launch.getKernel().getDefiningOp<gpu_runtime::GetGpuKernelOp>())
+        kernelFunc = mlir::SymbolTable::lookupNearestSymbolFrom<
+            mlir::gpu::GPUFuncOp>(launch, kernelOp.getKernel());
+
+      if (kernelFunc && (kernelFunc.isExternal() ||
+                         kernelFunc.getNumArguments() !=
+                             launch.getKernelOperands().size()))
+        kernelFunc = nullptr;
+
+      toPrefetch.clear();
+      for (auto &&[i, arg] : llvm::enumerate(launch.getKernelOperands())) {
+        if (!mlir::isa<mlir::MemRefType>(arg.getType()))
+          continue;
+
+        auto alloc = getSharedAllocSource(arg);
+        if (!alloc)
+          continue;
+
+        if (kernelFunc && isWriteOnlyArg(kernelFunc.getArgument(i)))
+          continue;
+
+        toPrefetch.insert(alloc.getMemref());
+      }
+
+      auto queue = launch.getQueue();
+      for (auto memref : toPrefetch) {
+        auto it = aliasesMap.find(memref);
+        if (it == aliasesMap.end())
+          it = aliasesMap.try_emplace(memref, getAliases(memref)).first;
+
+        auto &aliases = it->second;
+
+        // Data stays on device until host touches it, so prefetch is hoisted
+        // out of the loops, which don't access it on host.
+        mlir::Operation *point = launch;
+        while (auto loop = mlir::dyn_cast<mlir::LoopLikeOpInterface>(
+                   point->getParentOp())) {
+          if (!mlir::isa<mlir::scf::ForOp, mlir::scf::WhileOp>(loop) ||
+              !loop.isDefinedOutsideOfLoop(memref) ||
+              !loop.isDefinedOutsideOfLoop(queue) ||
+              hasHostAccess(loop, aliases))
+            break;
+
+          point = loop;
+        }
+
+        // Skip if data was already prefetched earlier in the block and host
+        // didn't touch it since.
+        if (isPrefetched(point, queue, memref, aliases))
+          continue;
+
+        builder.setInsertionPoint(point);
+        builder.create<gpu_runtime::GPUPrefetchOp>(launch.getLoc(), queue,
+                                                   memref);
+        changed = true;
+      }
+    }
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+
+private:
+  /// Returns `memref` and all its views.
+  static llvm::SmallPtrSet<mlir::Value, 4> getAliases(mlir::Value memref) {
+    llvm::SmallPtrSet<mlir::Value, 4> ret;
+    llvm::SmallVector<mlir::Value> worklist;
+    worklist.emplace_back(memref);
+    while (!worklist.empty()) {
+      auto current = worklist.pop_back_val();
+      if (!ret.insert(current).second)
+        continue;
+
+      for (auto user : current.getUsers()) {
+        if (auto view = mlir::dyn_cast<mlir::ViewLikeOpInterface>(user)) {
+          if (view.getViewSource() == current)
+            worklist.emplace_back(view->getResult(0));
+        } else if (auto meta =
+                       mlir::dyn_cast<mlir::memref::ExtractStridedMetadataOp>(
+                           user)) {
+          worklist.emplace_back(meta.getBaseBuffer());
+        }
+      }
+    }
+    return ret;
+  }
+
+  /// Checks if `op` or any of its nested ops can access `aliases` data on
+  /// host. Kernel launches, prefetches, views and dims don't.
+  static bool hasHostAccess(mlir::Operation *op,
+                            const llvm::SmallPtrSet<mlir::Value, 4> &aliases) {
+    auto res = op->walk([&](mlir::Operation *nested) {
+      if (mlir::isa<gpu_runtime::LaunchGpuKernelOp,
+                    gpu_runtime::GPUPrefetchOp, mlir::ViewLikeOpInterface,
+                    mlir::memref::ExtractStridedMetadataOp,
+                    mlir::memref::DimOp>(nested))
+        return mlir::WalkResult::advance();
+
+      for (auto arg : nested->getOperands())
+        if (aliases.contains(arg))
+          return mlir::WalkResult::interrupt();
+
+      return mlir::WalkResult::advance();
+    });
+    return res.wasInterrupted();
+  }
+
+  /// Checks if there is prefetch of `memref` to the `queue` before `point` in
+  /// the same block with no host accesses in between.
+  static bool
+  isPrefetched(mlir::Operation *point, mlir::Value queue, mlir::Value memref,
+               const llvm::SmallPtrSet<mlir::Value, 4> &aliases) {
+    for (auto op = point->getPrevNode(); op; op = op->getPrevNode()) {
+      if (auto prefetch = mlir::dyn_cast<gpu_runtime::GPUPrefetchOp>(op))
+        if (prefetch.getQueue() == queue && prefetch.getMemref() == memref)
+          return true;
+
+      if (hasHostAccess(op, aliases))
+        return false;
+    }
+    return false;
+  }
+};
+
 struct ExpandDeviceFuncCallOp
     : public mlir::OpRewritePattern<mlir::func::CallOp> {
   using OpRewritePattern::OpRewritePattern;
@@ -1608,6 +2623,242 @@ struct TileParallelLoopsForGPUPass
   }
 };
 
+/// Returns the only top-level `scf.parallel` loop without reductions inside the
+/// GPU region, if the rest of the region is free of side effects.
+static mlir::scf::ParallelOp
+getSplittableLoop(numba::util::EnvironmentRegionOp envOp) {
+  if (envOp->getNumResults() != 0 || !envOp.getArgs().empty())
+    return {};
+
+  mlir::scf::ParallelOp loop;
+  auto visitor = [&](mlir::Operation *op) -> mlir::WalkResult {
+    if (auto parallel = mlir::dyn_cast<mlir::scf::ParallelOp>(op)) {
+      if (loop || parallel->getNumResults() != 0 ||
+          !mlir::isa<numba::util::EnvironmentRegionOp>(parallel->getParentOp()))
+        return mlir::WalkResult::interrupt();
+
+      loop = parallel;
+      return mlir::WalkResult::skip();
+    }
+
+    if (mlir::isa<numba::util::EnvironmentRegionOp,
+                  numba::util::EnvironmentRegionYieldOp>(op))
+      return mlir::WalkResult::advance();
+
+    if (!mlir::isMemoryEffectFree(op))
+      return mlir::WalkResult::interrupt();
+
+    return mlir::WalkResult::skip();
+  };
+
+  auto &region = envOp.getRegion();
+  if (region.walk<mlir::WalkOrder::PreOrder>(visitor).wasInterrupted())
+    return {};
+
+  return loop;
+}
+
+/// Returns the number of iterations of the outermost loop dimension.
+static mlir::Value getOuterNumIters(mlir::OpBuilder &builder,
+                                    mlir::scf::ParallelOp loop) {
+  auto loc = loop.getLoc();
+  auto lower = loop.getLowerBound().front();
+  auto upper = loop.getUpperBound().front();
+  auto step = loop.getStep().front();
+
+  auto zero = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  mlir::Value size = builder.create<mlir::arith::SubIOp>(loc, upper, lower);
+  size = builder.create<mlir::arith::MaxSIOp>(loc, size, zero);
+  return builder.create<mlir::arith::CeilDivSIOp>(loc, size, step);
+}
+
+/// Restricts outermost loop dimension to the iterations [`begin`, `end`),
+/// clamped to `numIters`.
+static void setOuterIters(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
+                          mlir::Value numIters, mlir::Value begin,
+                          mlir::Value end) {
+  auto loc = loop.getLoc();
+  auto lower = loop.getLowerBound().front();
+  auto upper = loop.getUpperBound().front();
+  auto step = loop.getStep().front();
+
+  auto getBound = [&](mlir::Value iter) -> mlir::Value {
+    iter = builder.create<mlir::arith::MinSIOp>(loc, iter, numIters);
+    iter = builder.create<mlir::arith::MulIOp>(loc, iter, step);
+    iter = builder.create<mlir::arith::AddIOp>(loc, lower, iter);
+    return builder.create<mlir::arith::MinSIOp>(loc, iter, upper);
+  };
+
+  auto newLower = getBound(begin);
+  auto newUpper = getBound(end);
+  loop.getLowerBoundMutable().slice(0, 1).assign(newLower);
+  loop.getUpperBoundMutable().slice(0, 1).assign(newUpper);
+}
+
+/// Returns the number of leading iterations, executed on the host, for the
+/// `hostRatio` share of the work.
+static mlir::Value getHostIters(mlir::OpBuilder &builder, mlir::Location loc,
+                                mlir::Value numIters, mlir::Value hostRatio) {
+  auto i64 = builder.getI64Type();
+  auto f64 = builder.getF64Type();
+  auto zero = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  mlir::Value iters =
+      builder.create<mlir::arith::IndexCastOp>(loc, i64, numIters);
+  iters = builder.create<mlir::arith::SIToFPOp>(loc, f64, iters);
+  iters = builder.create<mlir::arith::MulFOp>(loc, iters, hostRatio);
+  iters = builder.create<mlir::arith::FPToSIOp>(loc, i64, iters);
+  iters = builder.create<mlir::arith::IndexCastOp>(
+      loc, builder.getIndexType(), iters);
+  iters = builder.create<mlir::arith::MaxSIOp>(loc, iters, zero);
+  return builder.create<mlir::arith::MinSIOp>(loc, iters, numIters);
+}
+
+/// Restricts outermost loop dimension to the `index`-th of `count` equal
+/// chunks. If `hostRatio` is set, leading `hostRatio` share of iterations is
+/// left for the host and the rest is split into chunks.
+static void setLoopChunk(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
+                         unsigned index, unsigned count,
+                         mlir::Value hostRatio) {
+  mlir::OpBuilder::InsertionGuard g(builder);
+  builder.setInsertionPoint(loop);
+  auto loc = loop.getLoc();
+  auto numIters = getOuterNumIters(builder, loop);
+
+  mlir::Value offset = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  if (hostRatio)
+    offset = getHostIters(builder, loc, numIters, hostRatio);
+
+  auto countVal = builder.create<mlir::arith::ConstantIndexOp>(loc, count);
+  mlir::Value remaining =
+      builder.create<mlir::arith::SubIOp>(loc, numIters, offset);
+  mlir::Value chunk =
+      builder.create<mlir::arith::CeilDivSIOp>(loc, remaining, countVal);
+
+  auto getIter = [&](unsigned i) -> mlir::Value {
+    auto idx = builder.create<mlir::arith::ConstantIndexOp>(loc, i);
+    mlir::Value iter = builder.create<mlir::arith::MulIOp>(loc, chunk, idx);
+    return builder.create<mlir::arith::AddIOp>(loc, offset, iter);
+  };
+
+  setOuterIters(builder, loop, numIters, getIter(index), getIter(index + 1));
+}
+
+/// Restricts outermost loop dimension to the leading `hostRatio` share of
+/// iterations.
+static void setHostChunk(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
+                         mlir::Value hostRatio) {
+  mlir::OpBuilder::InsertionGuard g(builder);
+  builder.setInsertionPoint(loop);
+  auto loc = loop.getLoc();
+  auto numIters = getOuterNumIters(builder, loop);
+  auto zero = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  auto hostIters = getHostIters(builder, loc, numIters, hostRatio);
+  setOuterIters(builder, loop, numIters, zero, hostIters);
+}
+
+struct SplitParallelLoopsForDevicesPass
+    : public mlir::PassWrapper<SplitParallelLoopsForDevicesPass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(
+      SplitParallelLoopsForDevicesPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<gpu_runtime::GpuRuntimeDialect>();
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+    registry.insert<numba::util::NumbaUtilDialect>();
+  }
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    auto devicesAttr = func->getAttrOfType<mlir::StringAttr>(
+        gpu_runtime::getDevicesAttrName());
+    if (!devicesAttr)
+      return markAllAnalysesPreserved();
+
+    llvm::SmallVector<llvm::StringRef> devices;
+    devicesAttr.getValue().split(devices, ',', /*MaxSplit*/ -1,
+                                 /*KeepEmpty*/ false);
+    for (auto &device : devices)
+      device = device.trim();
+
+    // Host in the devices list enables co-execution: host part of the loop
+    // is lowered to the host loops and runs in parallel with the device
+    // parts, host share is adapted by the runtime.
+    auto hostName = gpu_runtime::getHostDeviceName();
+    bool coexec = llvm::is_contained(devices, hostName);
+    llvm::erase_if(devices,
+                   [&](llvm::StringRef device) { return device == hostName; });
+
+    if (devices.empty() || (devices.size() < 2 && !coexec))
+      return markAllAnalysesPreserved();
+
+    llvm::SmallVector<
+        std::pair<numba::util::EnvironmentRegionOp, mlir::scf::ParallelOp>>
+        regions;
+    func->walk([&](numba::util::EnvironmentRegionOp envOp) {
+      auto env = mlir::dyn_cast<gpu_runtime::GPURegionDescAttr>(
+          envOp.getEnvironment());
+      // Device USM is only accessible from its own device.
+      if (!env || env.getUsmType().getValue() == "device")
+        return;
+
+      if (envOp->getParentOfType<mlir::scf::ParallelOp>() ||
+          envOp->getParentOfType<numba::util::EnvironmentRegionOp>())
+        return;
+
+      if (auto loop = getSplittableLoop(envOp))
+        regions.emplace_back(envOp, loop);
+    });
+
+    if (regions.empty())
+      return markAllAnalysesPreserved();
+
+    auto *ctx = &getContext();
+    mlir::OpBuilder builder(ctx);
+    auto count = static_cast<unsigned>(devices.size());
+    for (auto &&[envOp, loop] : regions) {
+      auto env =
+          mlir::cast<gpu_runtime::GPURegionDescAttr>(envOp.getEnvironment());
+      auto loc = envOp.getLoc();
+      auto cloneForDevice = [&](llvm::StringRef device) {
+        mlir::IRMapping mapping;
+        auto newEnvOp = mlir::cast<numba::util::EnvironmentRegionOp>(
+            builder.clone(*envOp, mapping));
+        newEnvOp.setEnvironmentAttr(gpu_runtime::GPURegionDescAttr::get(
+            ctx, builder.getStringAttr(device), env.getUsmType(),
+            env.getSpirvMajorVersion(), env.getSpirvMinorVersion(),
+            env.getHasFp16(), env.getHasFp64(), env.getSubgroupSize()));
+        return mlir::cast<mlir::scf::ParallelOp>(
+            mapping.lookup(loop.getOperation()));
+      };
+
+      builder.setInsertionPoint(envOp);
+      mlir::Value hostRatio;
+      if (coexec) {
+        hostRatio = builder.create<gpu_runtime::CoexecBeginOp>(loc);
+      } else {
+        builder.create<gpu_runtime::ConcurrentBeginOp>(loc);
+      }
+
+      for (auto &&[i, device] : llvm::enumerate(devices))
+        setLoopChunk(builder, cloneForDevice(device), static_cast<unsigned>(i),
+                     count, hostRatio);
+
+      // Host part is executed synchronously, so it goes after the device
+      // launches.
+      if (coexec) {
+        setHostChunk(builder, cloneForDevice(hostName), hostRatio);
+        builder.create<gpu_runtime::CoexecEndOp>(loc);
+      } else {
+        builder.create<gpu_runtime::ConcurrentEndOp>(loc);
+      }
+      envOp->erase();
+    }
+  }
+};
+
 // Some manual fp conversion, denormals and nan/infs are not supported.
 static mlir::Value f64Tof32(mlir::OpBuilder &builder, mlir::Location loc,
                             mlir::Value src) {
@@ -1820,6 +3071,73 @@ public:
   }
 };
 
+/// Rewrites f64 loop-carried sums `acc = acc + x` into Kahan summation, so
+/// after truncation accumulator becomes f32 sum and f32 error term pair.
+/// Sums with `reassoc` flag are skipped, as reassociation is allowed to fold
+/// error term to zero.
+static void compensateF64Accumulators(mlir::Operation *root) {
+  llvm::SmallVector<mlir::scf::ForOp> loops;
+  root->walk([&](mlir::scf::ForOp loop) { loops.emplace_back(loop); });
+
+  using Accumulator = std::pair<mlir::arith::AddFOp, mlir::Value>;
+  auto getAccumulator = [](mlir::scf::ForOp loop) -> Accumulator {
+    auto yield = loop.getBody()->getTerminator();
+    for (auto &&[arg, res] :
+         llvm::zip(loop.getRegionIterArgs(), yield->getOperands())) {
+      if (!arg.getType().isF64() || !arg.hasOneUse())
+        continue;
+
+      auto add = res.getDefiningOp<mlir::arith::AddFOp>();
+      if (!add || add->getBlock() != loop.getBody() || !res.hasOneUse() ||
+          *arg.getUsers().begin() != add || add.getLhs() == add.getRhs())
+        continue;
+
+      if (mlir::arith::bitEnumContainsAny(
+              add.getFastmath(), mlir::arith::FastMathFlags::reassoc))
+        continue;
+
+      return {add, arg};
+    }
+    return {};
+  };
+
+  mlir::IRRewriter rewriter(root->getContext());
+  for (auto loop : loops) {
+    while (true) {
+      auto accumulator = getAccumulator(loop);
+      auto add = accumulator.first;
+      if (!add)
+        break;
+
+      mlir::Value acc = accumulator.second;
+
+      mlir::Value val = (add.getLhs() == acc ? add.getRhs() : add.getLhs());
+      auto loc = add.getLoc();
+      rewriter.setInsertionPoint(loop);
+      mlir::Value zero = rewriter.create<mlir::arith::ConstantFloatOp>(
+          loc, llvm::APFloat(0.0), rewriter.getF64Type());
+
+      auto yieldFn = [&](mlir::OpBuilder & /*builder*/, mlir::Location /*loc*/,
+                         llvm::ArrayRef<mlir::BlockArgument> newArgs) {
+        rewriter.setInsertionPoint(add);
+        mlir::Value err = newArgs.front();
+        mlir::Value y = rewriter.create<mlir::arith::SubFOp>(loc, val, err);
+        mlir::Value sum = rewriter.create<mlir::arith::AddFOp>(loc, acc, y);
+        mlir::Value diff = rewriter.create<mlir::arith::SubFOp>(loc, sum, acc);
+        mlir::Value newErr = rewriter.create<mlir::arith::SubFOp>(loc, diff, y);
+        rewriter.replaceOp(add, sum);
+        return llvm::SmallVector<mlir::Value>{newErr};
+      };
+      auto res = loop.replaceWithAdditionalYields(
+          rewriter, zero, /*replaceInitOperandUsesInLoop*/ false, yieldFn);
+      if (mlir::failed(res))
+        break;
+
+      loop = mlir::cast<mlir::scf::ForOp>(res->getOperation());
+    }
+  }
+}
+
 struct TruncateF64ForGPUPass
     : public mlir::PassWrapper<TruncateF64ForGPUPass,
                                mlir::OperationPass<mlir::ModuleOp>> {
@@ -1922,18 +3240,25 @@ struct TruncateF64ForGPUPass
     llvm::SmallVector<mlir::Value> newArgs;
     mlir::OpBuilder builder(ctx);
     for (auto gpuModule : module.getOps<mlir::gpu::GPUModuleOp>()) {
-      auto truncAttr = gpuModule->getAttrOfType<mlir::BoolAttr>(
+      // Attr is either bool (always/never truncate) or "mixed" string
+      // (truncate if device doesn't support f64, but keep compensated
+      // accumulators), no attr means truncate if needed.
+      auto truncAttr = gpuModule->getAttr(
           gpu_runtime::getFp64TruncateAttrName());
-      if (truncAttr && !truncAttr.getValue())
+      auto truncFlag = mlir::dyn_cast_or_null<mlir::BoolAttr>(truncAttr);
+      if (truncFlag && !truncFlag.getValue())
         continue;
 
+      auto truncMode = mlir::dyn_cast_or_null<mlir::StringAttr>(truncAttr);
+      bool mixed = truncMode && truncMode.getValue() == "mixed";
+
       auto targetEnv = mlir::spirv::lookupTargetEnv(gpuModule);
       if (!targetEnv) {
         gpuModule->emitError("TargetEnv not found");
         return signalPassFailure();
       }
 
-      if (!truncAttr || !truncAttr.getValue()) {
+      if (!truncFlag) {
         auto caps = targetEnv.getCapabilities();
         if (llvm::is_contained(caps, mlir::spirv::Capability::Float64))
           continue;
@@ -1941,10 +3266,29 @@ struct TruncateF64ForGPUPass
 
       for (auto gpuFunc : gpuModule.getOps<mlir::gpu::GPUFuncOp>()) {
         auto origSig = gpuFunc.getFunctionType();
+        auto hasF64 = [&]() -> bool {
+          if (!converter.isSignatureLegal(origSig))
+            return true;
+
+          auto res = gpuFunc.getBody().walk([&](mlir::Operation *op) {
+            return converter.isLegal(op) ? mlir::WalkResult::advance()
+                                         : mlir::WalkResult::interrupt();
+          });
+          return res.wasInterrupted();
+        };
+        if (!hasF64())
+          continue;
+
+        if (mixed)
+          compensateF64Accumulators(gpuFunc);
+
         if (mlir::failed(
                 mlir::applyPartialConversion(gpuFunc, target, frozenPatterns)))
           return signalPassFailure();
 
+        gpuFunc.emitRemark("f64 kernel demoted to f32")
+            << (mixed ? " with compensated accumulators" : "");
+
         auto newSig = gpuFunc.getFunctionType();
         if (origSig == newSig)
           continue;
@@ -2214,59 +3558,137 @@ struct LowerGPUGlobalReduce
     mlir::gpu::KernelDim3 threadIds = launch.getThreadIds();
     mlir::gpu::KernelDim3 blockIds = launch.getBlockIds();
     mlir::gpu::KernelDim3 gridSizes = launch.getGridSize();
+    mlir::gpu::KernelDim3 blockSizes = launch.getBlockSize();
 
     mlir::Value linearBlockId =
         computeLinearBlockId(rewriter, loc, gridSizes, blockIds);
 
     mlir::Value isZeroThread = isZeroIds(rewriter, loc, threadIds);
 
+    // Single pass combine: each workgroup writes its partial result and
+    // increments the counter, the last finished workgroup reduces partial
+    // results and writes the final value.
+    auto i32 = rewriter.getI32Type();
+    auto counterType = mlir::MemRefType::get(std::nullopt, i32);
+    mlir::Value counter;
+    {
+      mlir::OpBuilder::InsertionGuard g1(rewriter);
+      rewriter.setInsertionPoint(launch);
+      counter = rewriter
+                    .create<mlir::gpu::AllocOp>(
+                        launchLoc, counterType, /*asyncToken*/ nullptr,
+                        /*asyncDeps*/ std::nullopt, /*dynSizes*/ std::nullopt,
+                        /*symbols*/ std::nullopt, /*hostShared*/ true)
+                    .getMemref();
+      mlir::Value zero =
+          rewriter.create<mlir::arith::ConstantIntOp>(launchLoc, 0, i32);
+      rewriter.create<mlir::memref::StoreOp>(launchLoc, zero, counter);
+    }
+
+    // Partial result store must be visible to the last workgroup before it
+    // sees the counter increment.
+    auto deviceFence = [&](mlir::OpBuilder &b, mlir::Location l) {
+      b.create<gpu_runtime::GPUMemFenceOp>(
+          l, static_cast<int64_t>(gpu_runtime::FenceFlags::device));
+    };
+
     auto condWriteBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
       mlir::Value result = allReduce.getResult();
       b.create<mlir::memref::StoreOp>(l, result, reduceArray, linearBlockId);
-      b.create<mlir::scf::YieldOp>(l);
+      deviceFence(b, l);
+      mlir::Value one = b.create<mlir::arith::ConstantIntOp>(l, 1, i32);
+      mlir::Value prev = b.create<mlir::memref::AtomicRMWOp>(
+          l, mlir::arith::AtomicRMWKind::addi, one, counter,
+          mlir::ValueRange());
+      b.create<mlir::scf::YieldOp>(l, prev);
+    };
+    auto condSkipBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+      mlir::Value prev = b.create<mlir::arith::ConstantIntOp>(l, -1, i32);
+      b.create<mlir::scf::YieldOp>(l, prev);
     };
 
-    rewriter.create<mlir::scf::IfOp>(loc, isZeroThread, condWriteBuilder);
+    mlir::Value prev = rewriter
+                           .create<mlir::scf::IfOp>(loc, isZeroThread,
+                                                    condWriteBuilder,
+                                                    condSkipBuilder)
+                           .getResult(0);
 
-    rewriter.setInsertionPointAfter(launch);
-    mlir::Value zero =
-        rewriter.create<mlir::arith::ConstantIndexOp>(launchLoc, 0);
-    mlir::Value one =
-        rewriter.create<mlir::arith::ConstantIndexOp>(launchLoc, 1);
-
-    auto finalReduceBodyBuilder = [&](mlir::OpBuilder &b, mlir::Location l,
-                                      mlir::ValueRange iters,
-                                      mlir::ValueRange) {
-      assert(iters.size() == 1);
-      mlir::Value value =
-          b.create<mlir::memref::LoadOp>(l, reduceArray, iters.front());
-      auto reduce = b.create<mlir::scf::ReduceOp>(l, value);
-      mlir::Block &finalReduceBlock = reduce.getReductions().front().front();
+    mlir::Value numWorkGroups = computeGPUDimsProd(
+        rewriter, loc, gridSizes.x, gridSizes.y, gridSizes.z);
+    mlir::Value one = rewriter.create<mlir::arith::ConstantIndexOp>(loc, 1);
+    mlir::Value lastId =
+        rewriter.create<mlir::arith::SubIOp>(loc, numWorkGroups, one);
+    lastId = rewriter.create<mlir::arith::IndexCastOp>(loc, i32, lastId);
+    mlir::Value isLast = rewriter.create<mlir::arith::CmpIOp>(
+        loc, mlir::arith::CmpIPredicate::eq, prev, lastId);
+
+    // Broadcast flag to the entire workgroup.
+    isLast = rewriter.create<mlir::arith::ExtUIOp>(loc, i32, isLast);
+    isLast = rewriter.create<mlir::gpu::AllReduceOp>(
+        loc, isLast,
+        mlir::gpu::AllReduceOperationAttr::get(
+            getContext(), mlir::gpu::AllReduceOperation::MAXSI),
+        /*uniform*/ true);
+    mlir::Value zero32 =
+        rewriter.create<mlir::arith::ConstantIntOp>(loc, 0, i32);
+    isLast = rewriter.create<mlir::arith::CmpIOp>(
+        loc, mlir::arith::CmpIPredicate::ne, isLast, zero32);
 
+    auto cloneReduce = [&](mlir::OpBuilder &b, mlir::Value lhs,
+                           mlir::Value rhs) -> mlir::Value {
       mlir::IRMapping mapper;
-      mapper.map(reduceBlock.getArguments(), finalReduceBlock.getArguments());
+      mapper.map(reduceBlock.getArgument(0), lhs);
+      mapper.map(reduceBlock.getArgument(1), rhs);
+      for (auto &innerOp : reduceBlock.without_terminator())
+        b.clone(innerOp, mapper);
 
-      {
-        mlir::OpBuilder::InsertionGuard g1(b);
-        b.setInsertionPointToStart(&finalReduceBlock);
-        for (auto &op : reduceBlock.without_terminator())
-          b.clone(op, mapper);
-
-        auto term = mlir::cast<mlir::gpu::YieldOp>(reduceBlock.getTerminator());
-        auto result = mapper.lookupOrDefault(term.getValues().front());
-        b.create<mlir::scf::ReduceReturnOp>(l, result);
-      }
+      auto term = mlir::cast<mlir::gpu::YieldOp>(reduceBlock.getTerminator());
+      return mapper.lookupOrDefault(term.getValues().front());
     };
 
-    mlir::Value initVal = rewriter.create<mlir::arith::ConstantOp>(
-        launchLoc, mlir::cast<mlir::TypedAttr>(*initAttr));
-    auto loopOp = rewriter.create<mlir::scf::ParallelOp>(
-        launchLoc, zero, numWorkGroupsExternal, one, initVal,
-        finalReduceBodyBuilder);
+    auto finalReduceBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+      // Pairs with the fence before the counter increment.
+      deviceFence(b, l);
+      mlir::Value numThreads =
+          computeGPUDimsProd(b, l, blockSizes.x, blockSizes.y, blockSizes.z);
+      mlir::Value linearThreadId =
+          computeLinearBlockId(b, l, blockSizes, threadIds);
+
+      auto loopBodyBuilder = [&](mlir::OpBuilder &lb, mlir::Location ll,
+                                 mlir::Value iv, mlir::ValueRange iters) {
+        assert(iters.size() == 1);
+        mlir::Value value =
+            lb.create<mlir::memref::LoadOp>(ll, reduceArray, iv);
+        mlir::Value res = cloneReduce(lb, iters.front(), value);
+        lb.create<mlir::scf::YieldOp>(ll, res);
+      };
 
-    rewriter.create<mlir::memref::StoreOp>(launchLoc, loopOp->getResult(0),
-                                           resultArray);
+      mlir::Value initVal = b.create<mlir::arith::ConstantOp>(
+          l, mlir::cast<mlir::TypedAttr>(*initAttr));
+      mlir::Value partial =
+          b.create<mlir::scf::ForOp>(l, linearThreadId, numWorkGroups,
+                                     numThreads, initVal, loopBodyBuilder)
+              .getResult(0);
+
+      auto finalReduce = b.create<mlir::gpu::AllReduceOp>(
+          l, partial, mlir::gpu::AllReduceOperationAttr{}, /*uniform*/ true);
+      auto &finalRegion = finalReduce.getRegion();
+      b.cloneRegionBefore(newRegion, finalRegion, finalRegion.end());
+
+      auto finalWriteBuilder = [&](mlir::OpBuilder &wb, mlir::Location wl) {
+        wb.create<mlir::memref::StoreOp>(wl, finalReduce.getResult(),
+                                         resultArray);
+        wb.create<mlir::scf::YieldOp>(wl);
+      };
+      b.create<mlir::scf::IfOp>(l, isZeroThread, finalWriteBuilder);
+      b.create<mlir::scf::YieldOp>(l);
+    };
+    rewriter.create<mlir::scf::IfOp>(loc, isLast, finalReduceBuilder);
 
+    rewriter.setInsertionPointAfter(launch);
+    rewriter.create<mlir::gpu::DeallocOp>(
+        launchLoc, /*asyncToken*/ mlir::Type(), /*asyncDeps*/ std::nullopt,
+        counter);
     rewriter.create<mlir::gpu::DeallocOp>(
         launchLoc, /*asyncToken*/ mlir::Type(), /*asyncDeps*/ std::nullopt,
         reduceArray);
@@ -2644,6 +4066,10 @@ std::unique_ptr<mlir::Pass> gpu_runtime::createGPUToSpirvPass() {
   return std::make_unique<GPUToSpirvPass>();
 }
 
+std::unique_ptr<mlir::Pass> gpu_runtime::createGpuIndexVariantsPass() {
+  return std::make_unique<GpuIndexVariantsPass>();
+}
+
 std::unique_ptr<mlir::Pass> gpu_runtime::createGpuIndexCastPass() {
   return std::make_unique<GpuIndexCastPass>();
 }
@@ -2660,6 +4086,10 @@ std::unique_ptr<mlir::Pass> gpu_runtime::createGPUExPass() {
   return std::make_unique<GPUExPass>();
 }
 
+std::unique_ptr<mlir::Pass> gpu_runtime::createInsertGPUPrefetchPass() {
+  return std::make_unique<InsertGPUPrefetchPass>();
+}
+
 std::unique_ptr<mlir::Pass> gpu_runtime::createGenDeviceFuncsPass() {
   return std::make_unique<GenDeviceFuncsPass>();
 }
@@ -2672,6 +4102,11 @@ std::unique_ptr<mlir::Pass> gpu_runtime::createTileParallelLoopsForGPUPass() {
   return std::make_unique<TileParallelLoopsForGPUPass>();
 }
 
+std::unique_ptr<mlir::Pass>
+gpu_runtime::createSplitParallelLoopsForDevicesPass() {
+  return std::make_unique<SplitParallelLoopsForDevicesPass>();
+}
+
 std::unique_ptr<mlir::Pass> gpu_runtime::createTruncateF64ForGPUPass() {
   return std::make_unique<TruncateF64ForGPUPass>();
 }
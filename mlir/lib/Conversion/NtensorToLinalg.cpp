@@ -863,6 +863,8 @@ struct NtensorLowerToTensorCopyPass
             builder.create<numba::ntensor::ToTensorOp>(loc, resType, src);
         toTensor->replaceAllUsesWith(res->getResults());
         toTensor->erase();
+      } else {
+        toTensor.emitRemark("array copy is required, source may be modified");
       }
     }
   }
@@ -9,6 +9,8 @@
 #include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
 #include "mlir/Dialect/SCF/IR/SCF.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
+#include "mlir/IR/IRMapping.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
@@ -139,9 +141,347 @@ struct SCFToAffinePass
   }
 };
 
+/// Builds affine expressions from index computations inside raised loop nest.
+/// Raised loops induction variables become dims, values defined outside the
+/// nest become symbols.
+class AffineExprBuilder {
+public:
+  AffineExprBuilder(Operation *root) : root(root) {}
+
+  void addIv(Value iv) { ivs.push_back(iv); }
+
+  std::optional<AffineExpr> get(Value val) {
+    auto ctx = val.getContext();
+    if (auto it = llvm::find(ivs, val); it != ivs.end())
+      return getDim(val, ctx);
+
+    if (auto cst = getConstantIntValue(val))
+      return getAffineConstantExpr(*cst, ctx);
+
+    if (auto add = val.getDefiningOp<arith::AddIOp>())
+      return getBinary(add.getLhs(), add.getRhs(),
+                       [](auto lhs, auto rhs) { return lhs + rhs; });
+
+    if (auto sub = val.getDefiningOp<arith::SubIOp>())
+      return getBinary(sub.getLhs(), sub.getRhs(),
+                       [](auto lhs, auto rhs) { return lhs - rhs; });
+
+    if (auto mul = val.getDefiningOp<arith::MulIOp>()) {
+      // Only multiplication by constant is affine.
+      if (!getConstantIntValue(mul.getLhs()) &&
+          !getConstantIntValue(mul.getRhs()))
+        return std::nullopt;
+
+      return getBinary(mul.getLhs(), mul.getRhs(),
+                       [](auto lhs, auto rhs) { return lhs * rhs; });
+    }
+
+    if (!val.getType().isIndex() ||
+        root->isAncestor(val.getParentRegion()->getParentOp()) ||
+        !affine::isValidSymbol(val))
+      return std::nullopt;
+
+    auto it = llvm::find(symbols, val);
+    auto pos = static_cast<unsigned>(it - symbols.begin());
+    if (it == symbols.end())
+      symbols.push_back(val);
+
+    return getAffineSymbolExpr(pos, ctx);
+  }
+
+  /// Return map operands, mapped into new loop nest.
+  SmallVector<Value> getOperands(IRMapping &mapping) const {
+    SmallVector<Value> ret;
+    for (auto dim : dims)
+      ret.push_back(mapping.lookup(dim));
+
+    for (auto sym : symbols)
+      ret.push_back(mapping.lookupOrDefault(sym));
+
+    return ret;
+  }
+
+  AffineMap getMap(ArrayRef<AffineExpr> exprs, MLIRContext *ctx) const {
+    return AffineMap::get(dims.size(), symbols.size(), exprs, ctx);
+  }
+
+  /// Reset operands for the next map, keeping known ivs.
+  void resetOperands() {
+    dims.clear();
+    symbols.clear();
+  }
+
+private:
+  Operation *root;
+  SmallVector<Value> ivs;
+  SmallVector<Value> dims;
+  SmallVector<Value> symbols;
+
+  AffineExpr getDim(Value val, MLIRContext *ctx) {
+    auto it = llvm::find(dims, val);
+    auto pos = static_cast<unsigned>(it - dims.begin());
+    if (it == dims.end())
+      dims.push_back(val);
+
+    return getAffineDimExpr(pos, ctx);
+  }
+
+  template <typename F>
+  std::optional<AffineExpr> getBinary(Value lhs, Value rhs, F &&func) {
+    auto lhsExpr = get(lhs);
+    if (!lhsExpr)
+      return std::nullopt;
+
+    auto rhsExpr = get(rhs);
+    if (!rhsExpr)
+      return std::nullopt;
+
+    return func(*lhsExpr, *rhsExpr);
+  }
+};
+
+struct LoopInfo {
+  ValueRange lowerBounds;
+  ValueRange upperBounds;
+  ValueRange steps;
+  ValueRange ivs;
+  Block *body;
+};
+
+static std::optional<LoopInfo> getLoopInfo(Operation *op) {
+  if (auto loop = dyn_cast<scf::ParallelOp>(op)) {
+    if (!loop.getInitVals().empty())
+      return std::nullopt;
+
+    return LoopInfo{loop.getLowerBound(), loop.getUpperBound(),
+                    loop.getStep(), loop.getInductionVars(), loop.getBody()};
+  }
+
+  if (auto loop = dyn_cast<scf::ForOp>(op)) {
+    if (!loop.getInductionVar().getType().isIndex())
+      return std::nullopt;
+
+    auto operands = loop->getOperands();
+    return LoopInfo{operands.slice(0, 1), operands.slice(1, 1),
+                    operands.slice(2, 1),
+                    loop.getBody()->getArguments().take_front(),
+                    loop.getBody()};
+  }
+
+  return std::nullopt;
+}
+
+static bool canRaiseLoop(Operation *loop, AffineExprBuilder &exprBuilder);
+
+static bool canRaiseIndices(ValueRange indices,
+                            AffineExprBuilder &exprBuilder) {
+  exprBuilder.resetOperands();
+  return llvm::all_of(indices,
+                      [&](Value idx) { return !!exprBuilder.get(idx); });
+}
+
+static bool canRaiseBody(Block &body, AffineExprBuilder &exprBuilder) {
+  for (auto &op : body.without_terminator()) {
+    if (isa<scf::ParallelOp, scf::ForOp>(op)) {
+      if (!canRaiseLoop(&op, exprBuilder))
+        return false;
+
+      continue;
+    }
+
+    if (auto load = dyn_cast<memref::LoadOp>(op)) {
+      if (!canRaiseIndices(load.getIndices(), exprBuilder))
+        return false;
+
+      continue;
+    }
+
+    if (auto store = dyn_cast<memref::StoreOp>(op)) {
+      if (!canRaiseIndices(store.getIndices(), exprBuilder))
+        return false;
+
+      continue;
+    }
+
+    if (op.getNumRegions() != 0 || !isMemoryEffectFree(&op))
+      return false;
+  }
+  return true;
+}
+
+static bool canRaiseLoop(Operation *loop, AffineExprBuilder &exprBuilder) {
+  auto info = getLoopInfo(loop);
+  if (!info)
+    return false;
+
+  for (auto &&[lb, ub, step, iv] : llvm::zip(
+           info->lowerBounds, info->upperBounds, info->steps, info->ivs)) {
+    auto stepVal = getConstantIntValue(step);
+    if (!stepVal || *stepVal <= 0)
+      return false;
+
+    exprBuilder.resetOperands();
+    if (!exprBuilder.get(lb))
+      return false;
+
+    exprBuilder.resetOperands();
+    if (!exprBuilder.get(ub))
+      return false;
+
+    exprBuilder.addIv(iv);
+  }
+  return canRaiseBody(*info->body, exprBuilder);
+}
+
+static AffineMap getIndicesMap(Operation *op, ValueRange indices,
+                               AffineExprBuilder &exprBuilder,
+                               SmallVectorImpl<Value> &operands,
+                               IRMapping &mapping) {
+  exprBuilder.resetOperands();
+  SmallVector<AffineExpr> exprs;
+  for (auto idx : indices)
+    exprs.push_back(*exprBuilder.get(idx));
+
+  operands = exprBuilder.getOperands(mapping);
+  return exprBuilder.getMap(exprs, op->getContext());
+}
+
+static void raiseLoop(OpBuilder &builder, Operation *loop,
+                      AffineExprBuilder &exprBuilder, IRMapping &mapping);
+
+static void raiseBody(OpBuilder &builder, Block &body,
+                      AffineExprBuilder &exprBuilder, IRMapping &mapping) {
+  SmallVector<Value> operands;
+  for (auto &op : body.without_terminator()) {
+    auto loc = op.getLoc();
+    if (isa<scf::ParallelOp, scf::ForOp>(op)) {
+      raiseLoop(builder, &op, exprBuilder, mapping);
+    } else if (auto load = dyn_cast<memref::LoadOp>(op)) {
+      auto map = getIndicesMap(load, load.getIndices(), exprBuilder, operands,
+                               mapping);
+      auto newLoad = builder.create<affine::AffineLoadOp>(
+          loc, mapping.lookupOrDefault(load.getMemRef()), map, operands);
+      mapping.map(load.getResult(), newLoad.getResult());
+    } else if (auto store = dyn_cast<memref::StoreOp>(op)) {
+      auto map = getIndicesMap(store, store.getIndices(), exprBuilder,
+                               operands, mapping);
+      builder.create<affine::AffineStoreOp>(
+          loc, mapping.lookupOrDefault(store.getValueToStore()),
+          mapping.lookupOrDefault(store.getMemRef()), map, operands);
+    } else {
+      builder.clone(op, mapping);
+    }
+  }
+}
+
+static void raiseLoop(OpBuilder &builder, Operation *loop,
+                      AffineExprBuilder &exprBuilder, IRMapping &mapping) {
+  OpBuilder::InsertionGuard g(builder);
+  auto info = *getLoopInfo(loop);
+  auto loc = loop->getLoc();
+  auto ctx = loop->getContext();
+  auto forOp = dyn_cast<scf::ForOp>(loop);
+
+  SmallVector<affine::AffineForOp> newLoops;
+  for (auto &&[lb, ub, step, iv] :
+       llvm::zip(info.lowerBounds, info.upperBounds, info.steps, info.ivs)) {
+    exprBuilder.resetOperands();
+    auto lbMap = exprBuilder.getMap(*exprBuilder.get(lb), ctx);
+    auto lbOperands = exprBuilder.getOperands(mapping);
+
+    exprBuilder.resetOperands();
+    auto ubMap = exprBuilder.getMap(*exprBuilder.get(ub), ctx);
+    auto ubOperands = exprBuilder.getOperands(mapping);
+
+    ValueRange iterArgs;
+    SmallVector<Value> inits;
+    if (forOp) {
+      for (auto init : forOp.getInitArgs())
+        inits.push_back(mapping.lookupOrDefault(init));
+      iterArgs = inits;
+    }
+
+    auto bodyBuilder = [](OpBuilder &, Location, Value, ValueRange) {};
+    auto newLoop = builder.create<affine::AffineForOp>(
+        loc, lbOperands, lbMap, ubOperands, ubMap, *getConstantIntValue(step),
+        iterArgs, bodyBuilder);
+    mapping.map(iv, newLoop.getInductionVar());
+    exprBuilder.addIv(iv);
+    newLoops.push_back(newLoop);
+    builder.setInsertionPointToEnd(newLoop.getBody());
+  }
+
+  if (forOp)
+    mapping.map(forOp.getRegionIterArgs(),
+                newLoops.front().getRegionIterArgs());
+
+  raiseBody(builder, *info.body, exprBuilder, mapping);
+
+  SmallVector<Value> yieldArgs;
+  if (forOp)
+    for (auto arg : forOp.getBody()->getTerminator()->getOperands())
+      yieldArgs.push_back(mapping.lookupOrDefault(arg));
+
+  builder.create<affine::AffineYieldOp>(loc, yieldArgs);
+  for (auto newLoop : llvm::ArrayRef(newLoops).drop_back()) {
+    builder.setInsertionPointToEnd(newLoop.getBody());
+    builder.create<affine::AffineYieldOp>(loc);
+  }
+
+  if (forOp)
+    mapping.map(forOp.getResults(), newLoops.front().getResults());
+}
+
+struct SCFToAffineForPass
+    : public mlir::PassWrapper<SCFToAffineForPass, mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(SCFToAffineForPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::affine::AffineDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    SmallVector<Operation *> roots;
+    getOperation()->walk<WalkOrder::PreOrder>(
+        [&](Operation *op) -> WalkResult {
+          if (!isa<scf::ParallelOp, scf::ForOp>(op))
+            return WalkResult::advance();
+
+          // Nest can't be raised entirely, try nested loops.
+          AffineExprBuilder exprBuilder(op);
+          if (!canRaiseLoop(op, exprBuilder))
+            return WalkResult::advance();
+
+          roots.push_back(op);
+          return WalkResult::skip();
+        });
+
+    if (roots.empty())
+      return markAllAnalysesPreserved();
+
+    OpBuilder builder(&getContext());
+    for (auto root : roots) {
+      builder.setInsertionPoint(root);
+      AffineExprBuilder exprBuilder(root);
+      IRMapping mapping;
+      raiseLoop(builder, root, exprBuilder, mapping);
+      for (auto res : root->getResults())
+        res.replaceAllUsesWith(mapping.lookup(res));
+
+      root->erase();
+    }
+  }
+};
+
 } // namespace
 
 /// Uplifts scf operations within a function into affine representation
 std::unique_ptr<Pass> mlir::createSCFToAffinePass() {
   return std::make_unique<SCFToAffinePass>();
 }
+
+std::unique_ptr<Pass> mlir::createSCFToAffineForPass() {
+  return std::make_unique<SCFToAffineForPass>();
+}
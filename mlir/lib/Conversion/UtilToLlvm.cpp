@@ -121,8 +121,30 @@ struct LowerMemrefBitcastOp
     dst.setAllocatedPtr(rewriter, loc, allocatedPtr);
     dst.setAlignedPtr(rewriter, loc, alignedPtr);
 
+    auto rank = static_cast<unsigned>(memrefType.getRank());
+    auto srcType = mlir::cast<mlir::MemRefType>(op.getSource().getType());
+    if (mlir::isa<mlir::ComplexType>(srcType.getElementType())) {
+      // View of interleaved real and imaginary parts, offset and outer strides
+      // are doubled, innermost dimension is doubled and stays contiguous.
+      auto twoAttr = rewriter.getIntegerAttr(dst.getIndexType(), 2);
+      mlir::Value two = rewriter.create<mlir::LLVM::ConstantOp>(loc, twoAttr);
+      auto doubled = [&](mlir::Value val) -> mlir::Value {
+        return rewriter.create<mlir::LLVM::MulOp>(loc, val, two);
+      };
+      dst.setOffset(rewriter, loc, doubled(src.offset(rewriter, loc)));
+      for (auto i : llvm::seq(0u, rank)) {
+        auto size = src.size(rewriter, loc, i);
+        auto stride = src.stride(rewriter, loc, i);
+        bool last = (i + 1 == rank);
+        dst.setSize(rewriter, loc, i, last ? doubled(size) : size);
+        dst.setStride(rewriter, loc, i, last ? stride : doubled(stride));
+      }
+      rewriter.replaceOp(op, static_cast<mlir::Value>(dst));
+      return mlir::success();
+    }
+
     dst.setOffset(rewriter, loc, src.offset(rewriter, loc));
-    for (auto i : llvm::seq(0u, static_cast<unsigned>(memrefType.getRank()))) {
+    for (auto i : llvm::seq(0u, rank)) {
       dst.setSize(rewriter, loc, i, src.size(rewriter, loc, i));
       dst.setStride(rewriter, loc, i, src.stride(rewriter, loc, i));
     }
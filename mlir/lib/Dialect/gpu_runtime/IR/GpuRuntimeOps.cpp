@@ -54,7 +54,8 @@ struct GpuRuntimeMergeEnvInterface : public numba::util::DialectEnvInterface {
         gpuEnv1.getSpirvMajorVersion() != gpuEnv2.getSpirvMajorVersion() ||
         gpuEnv1.getSpirvMinorVersion() != gpuEnv2.getSpirvMinorVersion() ||
         gpuEnv1.getHasFp16() != gpuEnv2.getHasFp16() ||
-        gpuEnv1.getHasFp64() != gpuEnv2.getHasFp64())
+        gpuEnv1.getHasFp64() != gpuEnv2.getHasFp64() ||
+        gpuEnv1.getSubgroupSize() != gpuEnv2.getSubgroupSize())
       return std::nullopt;
 
     auto ctx = env1.getContext();
@@ -302,6 +303,22 @@ mlir::StringRef getDeviceFuncAttrName() { return "gpu_runtime.device_func"; }
 
 llvm::StringRef getHostAllocAttrName() { return "gpu_runtime.host_alloc"; }
 
+mlir::StringRef getAotTargetsAttrName() { return "gpu_runtime.aot_targets"; }
+
+mlir::StringRef getDevicesAttrName() { return "gpu_runtime.devices"; }
+
+mlir::StringRef getSpecConstantsAttrName() {
+  return "gpu_runtime.spec_constants";
+}
+
+mlir::StringRef getVectorBitwidthAttrName() {
+  return "gpu_runtime.vector_bitwidth";
+}
+
+mlir::StringRef getPackArgsAttrName() { return "gpu_runtime.pack_args"; }
+
+mlir::StringRef getPackedArgsAttrName() { return "gpu_runtime.packed_args"; }
+
 } // namespace gpu_runtime
 
 // TODO: unify with upstream
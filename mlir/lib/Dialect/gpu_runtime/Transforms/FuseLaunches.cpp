@@ -0,0 +1,214 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Dialect/gpu_runtime/Transforms/FuseLaunches.hpp"
+
+#include "numba/Analysis/AliasAnalysis.hpp"
+
+#include "LaunchUtils.hpp"
+
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+namespace {
+struct Access {
+  mlir::Operation *op;
+  mlir::Value memref;
+  bool write;
+};
+} // namespace
+
+/// Collects launch memory accesses, returns false if any of the accessed
+/// values cannot be determined.
+static bool collectAccesses(mlir::gpu::LaunchOp launch,
+                            llvm::SmallVectorImpl<Access> &ret) {
+  auto visitor = [&](mlir::Operation *op) -> mlir::WalkResult {
+    if (op->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>())
+      return mlir::WalkResult::advance();
+
+    auto iface = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(op);
+    if (!iface)
+      return mlir::WalkResult::interrupt();
+
+    llvm::SmallVector<mlir::MemoryEffects::EffectInstance> effects;
+    iface.getEffects(effects);
+    for (auto &effect : effects) {
+      auto val = effect.getValue();
+      if (!val)
+        return mlir::WalkResult::interrupt();
+
+      bool write = mlir::isa<mlir::MemoryEffects::Write>(effect.getEffect());
+      ret.push_back({op, val, write});
+    }
+    return mlir::WalkResult::advance();
+  };
+  return !launch.getBody().walk(visitor).wasInterrupted();
+}
+
+static bool isUnitSize(mlir::Value val) {
+  return mlir::isConstantIntValue(val, 1);
+}
+
+/// Checks that memory is accessed at the thread own global position and
+/// each element is accessed by the single thread only. Returns launch dims,
+/// corresponding to each index.
+static std::optional<llvm::SmallVector<unsigned>>
+getOwnPositionAccess(mlir::Operation *op, mlir::gpu::LaunchOp launch) {
+  mlir::ValueRange indices;
+  if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op)) {
+    indices = load.getIndices();
+  } else if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(op)) {
+    indices = store.getIndices();
+  } else {
+    return std::nullopt;
+  }
+
+  gpu_runtime::LaunchDims dims(launch);
+  llvm::SmallVector<unsigned> ret;
+  for (auto idx : indices) {
+    auto dim = gpu_runtime::getThreadPos(idx, dims);
+    if (!dim || llvm::is_contained(ret, *dim))
+      return std::nullopt;
+
+    ret.emplace_back(*dim);
+  }
+
+  // Threads, differing only in unused dims, will access the same element.
+  auto gridSizes = launch.getGridSizeOperandValues();
+  std::array<mlir::Value, 3> grid = {gridSizes.x, gridSizes.y, gridSizes.z};
+  for (auto i : llvm::seq(0u, 3u)) {
+    if (llvm::is_contained(ret, i))
+      continue;
+
+    if (!isUnitSize(grid[i]) || !isUnitSize(dims.sizeOperand[i]))
+      return std::nullopt;
+  }
+  return ret;
+}
+
+static bool isEqual(mlir::Value lhs, mlir::Value rhs) {
+  if (lhs == rhs)
+    return true;
+
+  auto lhsConst = mlir::getConstantIntValue(lhs);
+  auto rhsConst = mlir::getConstantIntValue(rhs);
+  return lhsConst && rhsConst && *lhsConst == *rhsConst;
+}
+
+static bool isSimpleLaunch(mlir::gpu::LaunchOp launch) {
+  return !launch.getAsyncToken() && launch.getAsyncDependencies().empty() &&
+         !launch.getDynamicSharedMemorySize() &&
+         launch.getNumWorkgroupAttributions() == 0 &&
+         launch.getNumPrivateAttributions() == 0 &&
+         llvm::hasSingleElement(launch.getBody());
+}
+
+static bool canFuse(mlir::gpu::LaunchOp first, mlir::gpu::LaunchOp second,
+                    numba::LocalAliasAnalysis &aa) {
+  if (!isSimpleLaunch(first) || !isSimpleLaunch(second))
+    return false;
+
+  auto firstSizes = first.getOperands();
+  auto secondSizes = second.getOperands();
+  if (firstSizes.size() != secondSizes.size())
+    return false;
+
+  for (auto &&[lhs, rhs] : llvm::zip(firstSizes, secondSizes))
+    if (!isEqual(lhs, rhs))
+      return false;
+
+  llvm::SmallVector<Access> firstAccesses;
+  llvm::SmallVector<Access> secondAccesses;
+  if (!collectAccesses(first, firstAccesses) ||
+      !collectAccesses(second, secondAccesses))
+    return false;
+
+  // Dependent accesses are only allowed to the same elements from the same
+  // thread.
+  for (auto &lhs : firstAccesses) {
+    for (auto &rhs : secondAccesses) {
+      if (!lhs.write && !rhs.write)
+        continue;
+
+      if (aa.alias(lhs.memref, rhs.memref).isNo())
+        continue;
+
+      if (lhs.memref != rhs.memref)
+        return false;
+
+      auto lhsDims = getOwnPositionAccess(lhs.op, first);
+      auto rhsDims = getOwnPositionAccess(rhs.op, second);
+      if (!lhsDims || !rhsDims || *lhsDims != *rhsDims)
+        return false;
+    }
+  }
+  return true;
+}
+
+static void fuse(mlir::gpu::LaunchOp first, mlir::gpu::LaunchOp second) {
+  // Only memory effect free ops are allowed between launches and launch op
+  // has no results, so they can be moved before the first one.
+  for (auto &op : llvm::make_early_inc_range(llvm::make_range(
+           std::next(first->getIterator()), second->getIterator())))
+    op.moveBefore(first);
+
+  auto &firstBlock = first.getBody().front();
+  auto &secondBlock = second.getBody().front();
+  for (auto &&[src, dst] :
+       llvm::zip(secondBlock.getArguments(), firstBlock.getArguments()))
+    src.replaceAllUsesWith(dst);
+
+  firstBlock.getTerminator()->erase();
+  firstBlock.getOperations().splice(firstBlock.end(),
+                                    secondBlock.getOperations());
+  second->erase();
+}
+
+static mlir::gpu::LaunchOp getNextLaunch(mlir::gpu::LaunchOp launch) {
+  auto block = launch->getBlock();
+  for (auto it = std::next(launch->getIterator()); it != block->end(); ++it) {
+    if (auto next = mlir::dyn_cast<mlir::gpu::LaunchOp>(*it))
+      return next;
+
+    if (!mlir::isMemoryEffectFree(&*it))
+      break;
+  }
+  return nullptr;
+}
+
+namespace {
+struct FuseGpuLaunchesPass
+    : public mlir::PassWrapper<FuseGpuLaunchesPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FuseGpuLaunchesPass)
+
+  void runOnOperation() override {
+    numba::LocalAliasAnalysis aa;
+    bool changed = false;
+    while (true) {
+      auto visitor = [&](mlir::gpu::LaunchOp launch) -> mlir::WalkResult {
+        auto next = getNextLaunch(launch);
+        if (!next || !canFuse(launch, next, aa))
+          return mlir::WalkResult::advance();
+
+        fuse(launch, next);
+        return mlir::WalkResult::interrupt();
+      };
+      if (!getOperation()->walk(visitor).wasInterrupted())
+        break;
+
+      changed = true;
+    }
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> gpu_runtime::createFuseGpuLaunchesPass() {
+  return std::make_unique<FuseGpuLaunchesPass>();
+}
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+
+#include <array>
+#include <optional>
+
+namespace gpu_runtime {
+/// Launch body ids and sizes, indexed by dimension.
+struct LaunchDims {
+  LaunchDims(mlir::gpu::LaunchOp launch) : launch(launch) {
+    auto blockIds = launch.getBlockIds();
+    auto threadIds = launch.getThreadIds();
+    auto blockSizes = launch.getBlockSize();
+    auto blockSizeOperands = launch.getBlockSizeOperandValues();
+    block = {blockIds.x, blockIds.y, blockIds.z};
+    thread = {threadIds.x, threadIds.y, threadIds.z};
+    size = {blockSizes.x, blockSizes.y, blockSizes.z};
+    sizeOperand = {blockSizeOperands.x, blockSizeOperands.y,
+                   blockSizeOperands.z};
+  }
+
+  mlir::gpu::LaunchOp launch;
+  std::array<mlir::Value, 3> block;
+  std::array<mlir::Value, 3> thread;
+  std::array<mlir::Value, 3> size;
+  std::array<mlir::Value, 3> sizeOperand;
+};
+
+template <typename Op>
+inline std::optional<unsigned> getDim(mlir::Value val,
+                                      llvm::ArrayRef<mlir::Value> args) {
+  auto it = llvm::find(args, val);
+  if (it != args.end())
+    return static_cast<unsigned>(it - args.begin());
+
+  if (auto op = val.getDefiningOp<Op>())
+    return static_cast<unsigned>(op.getDimension());
+
+  return std::nullopt;
+}
+
+inline bool isBlockSize(mlir::Value val, unsigned dim,
+                        const LaunchDims &dims) {
+  if (val == dims.size[dim] || val == dims.sizeOperand[dim])
+    return true;
+
+  return getDim<mlir::gpu::BlockDimOp>(val, {}) == dim;
+}
+
+/// Matches `blockId * blockSize + threadId` and returns launch dimension.
+inline std::optional<unsigned> getThreadPos(mlir::Value val,
+                                            const LaunchDims &dims) {
+  auto add = val.getDefiningOp<mlir::arith::AddIOp>();
+  if (!add)
+    return std::nullopt;
+
+  for (auto [mulVal, threadVal] : {std::pair(add.getLhs(), add.getRhs()),
+                                   std::pair(add.getRhs(), add.getLhs())}) {
+    auto dim = getDim<mlir::gpu::ThreadIdOp>(threadVal, dims.thread);
+    auto mul = mulVal.getDefiningOp<mlir::arith::MulIOp>();
+    if (!dim || !mul)
+      continue;
+
+    for (auto [blockVal, sizeVal] : {std::pair(mul.getLhs(), mul.getRhs()),
+                                     std::pair(mul.getRhs(), mul.getLhs())})
+      if (getDim<mlir::gpu::BlockIdOp>(blockVal, dims.block) == dim &&
+          isBlockSize(sizeVal, *dim, dims))
+        return dim;
+  }
+  return std::nullopt;
+}
+
+/// Matches thread position with optional constant offset.
+inline std::optional<std::pair<unsigned, int64_t>>
+getThreadAccess(mlir::Value val, const LaunchDims &dims) {
+  if (auto dim = getThreadPos(val, dims))
+    return std::pair(*dim, int64_t(0));
+
+  if (auto add = val.getDefiningOp<mlir::arith::AddIOp>()) {
+    for (auto [posVal, offsetVal] : {std::pair(add.getLhs(), add.getRhs()),
+                                     std::pair(add.getRhs(), add.getLhs())}) {
+      auto offset = mlir::getConstantIntValue(offsetVal);
+      auto dim = getThreadPos(posVal, dims);
+      if (offset && dim)
+        return std::pair(*dim, *offset);
+    }
+  }
+
+  if (auto sub = val.getDefiningOp<mlir::arith::SubIOp>()) {
+    auto offset = mlir::getConstantIntValue(sub.getRhs());
+    auto dim = getThreadPos(sub.getLhs(), dims);
+    if (offset && dim)
+      return std::pair(*dim, -*offset);
+  }
+  return std::nullopt;
+}
+} // namespace gpu_runtime
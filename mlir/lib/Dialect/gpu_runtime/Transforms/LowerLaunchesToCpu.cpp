@@ -0,0 +1,850 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Dialect/gpu_runtime/Transforms/LowerLaunchesToCpu.hpp"
+
+#include "numba/Dialect/gpu_runtime/IR/GpuRuntimeOps.hpp"
+#include "numba/Dialect/gpu_runtime/Transforms/MakeBarriersUniform.hpp"
+#include "numba/Dialect/numba_util/Dialect.hpp"
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/IR/IRMapping.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+#include <array>
+
+llvm::StringRef gpu_runtime::getHostDeviceName() { return "host"; }
+
+bool gpu_runtime::isCpuRegion(GPURegionDescAttr env) {
+  auto device = env.getDevice().getValue();
+  return device == getHostDeviceName() || device.contains(":cpu");
+}
+
+static gpu_runtime::GPURegionDescAttr getGpuRegionEnv(mlir::Operation *op) {
+  assert(op && "Invalid op");
+  while (auto region =
+             op->getParentOfType<numba::util::EnvironmentRegionOp>()) {
+    if (auto env = mlir::dyn_cast<gpu_runtime::GPURegionDescAttr>(
+            region.getEnvironment()))
+      return env;
+
+    op = region;
+  }
+  return {};
+}
+
+static mlir::Type stripGpuMemorySpace(mlir::Type type) {
+  auto memrefType = mlir::dyn_cast<mlir::MemRefType>(type);
+  if (!memrefType || !mlir::isa_and_present<mlir::gpu::AddressSpaceAttr>(
+                         memrefType.getMemorySpace()))
+    return type;
+
+  return mlir::MemRefType::get(memrefType.getShape(),
+                               memrefType.getElementType(),
+                               memrefType.getLayout());
+}
+
+/// Host code has no separate address spaces, workgroup and private memory
+/// are allocated on stack.
+static void stripGpuMemorySpaces(mlir::Operation *root) {
+  root->walk([](mlir::Operation *op) {
+    for (auto res : op->getResults())
+      res.setType(stripGpuMemorySpace(res.getType()));
+
+    for (auto &region : op->getRegions())
+      for (auto &block : region)
+        for (auto arg : block.getArguments())
+          arg.setType(stripGpuMemorySpace(arg.getType()));
+  });
+}
+
+static bool isBarrierOp(mlir::Operation *op) {
+  return mlir::isa<mlir::gpu::BarrierOp, mlir::gpu::AllReduceOp,
+                   gpu_runtime::GPUGroupScanOp>(op);
+}
+
+static bool containsBarrier(mlir::Operation *op) {
+  auto visitor = [](mlir::Operation *nested) -> mlir::WalkResult {
+    return isBarrierOp(nested) ? mlir::WalkResult::interrupt()
+                               : mlir::WalkResult::advance();
+  };
+  return op->walk(visitor).wasInterrupted();
+}
+
+static bool isWorkgroupAlloca(mlir::Operation *op) {
+  auto alloca = mlir::dyn_cast<mlir::memref::AllocaOp>(op);
+  if (!alloca)
+    return false;
+
+  auto space = mlir::dyn_cast_or_null<mlir::gpu::AddressSpaceAttr>(
+      alloca.getType().getMemorySpace());
+  return space && space.getValue() ==
+                      mlir::gpu::GPUDialect::getWorkgroupAddressSpace();
+}
+
+/// Each host item is executed as a separate subgroup of size 1, so subgroup
+/// size and lane id are uniform for the group.
+static bool isGroupDimOp(mlir::Operation *op) {
+  return mlir::isa<mlir::gpu::BlockIdOp, mlir::gpu::GridDimOp,
+                   mlir::gpu::BlockDimOp, mlir::gpu::LaneIdOp,
+                   mlir::gpu::SubgroupSizeOp, mlir::gpu::NumSubgroupsOp>(op);
+}
+
+static bool isItemIdOp(mlir::Operation *op) {
+  return mlir::isa<mlir::gpu::ThreadIdOp, mlir::gpu::GlobalIdOp,
+                   mlir::gpu::SubgroupIdOp>(op);
+}
+
+static bool isSupportedGpuOp(mlir::Operation *op) {
+  if (mlir::isa<mlir::gpu::BarrierOp, mlir::gpu::TerminatorOp,
+                mlir::gpu::SubgroupReduceOp, mlir::gpu::ShuffleOp>(op) ||
+      isGroupDimOp(op) || isItemIdOp(op))
+    return true;
+
+  if (auto reduce = mlir::dyn_cast<mlir::gpu::AllReduceOp>(op))
+    return reduce.getOp() && reduce.getBody().empty() &&
+           reduce.getType().isIntOrFloat();
+
+  return false;
+}
+
+/// Values of these types can be spilled into memory between item loops.
+static bool isSpillableType(mlir::Type type) {
+  return type.isIntOrIndexOrFloat() ||
+         mlir::isa<mlir::VectorType, mlir::ComplexType>(type);
+}
+
+using CombineFunc = mlir::Value (*)(mlir::OpBuilder &, mlir::Location,
+                                    mlir::Value, mlir::Value);
+
+template <typename Op>
+static mlir::Value combineOp(mlir::OpBuilder &builder, mlir::Location loc,
+                             mlir::Value lhs, mlir::Value rhs) {
+  return builder.create<Op>(loc, lhs, rhs);
+}
+
+static CombineFunc getCombineFunc(mlir::gpu::AllReduceOperation op,
+                                  bool isFloat) {
+  namespace arith = mlir::arith;
+  using Op = mlir::gpu::AllReduceOperation;
+  switch (op) {
+  case Op::ADD:
+    return isFloat ? &combineOp<arith::AddFOp> : &combineOp<arith::AddIOp>;
+  case Op::MUL:
+    return isFloat ? &combineOp<arith::MulFOp> : &combineOp<arith::MulIOp>;
+  case Op::MINSI:
+    return isFloat ? nullptr : &combineOp<arith::MinSIOp>;
+  case Op::MINUI:
+    return isFloat ? nullptr : &combineOp<arith::MinUIOp>;
+  case Op::MAXSI:
+    return isFloat ? nullptr : &combineOp<arith::MaxSIOp>;
+  case Op::MAXUI:
+    return isFloat ? nullptr : &combineOp<arith::MaxUIOp>;
+  case Op::MINIMUMF:
+    return isFloat ? &combineOp<arith::MinimumFOp> : nullptr;
+  case Op::MAXIMUMF:
+    return isFloat ? &combineOp<arith::MaximumFOp> : nullptr;
+  case Op::MINNUMF:
+    return isFloat ? &combineOp<arith::MinNumFOp> : nullptr;
+  case Op::MAXNUMF:
+    return isFloat ? &combineOp<arith::MaxNumFOp> : nullptr;
+  case Op::AND:
+    return isFloat ? nullptr : &combineOp<arith::AndIOp>;
+  case Op::OR:
+    return isFloat ? nullptr : &combineOp<arith::OrIOp>;
+  case Op::XOR:
+    return isFloat ? nullptr : &combineOp<arith::XOrIOp>;
+  }
+  return nullptr;
+}
+
+static bool isSubgroupOp(mlir::Operation *op) {
+  return mlir::isa<mlir::gpu::SubgroupReduceOp, mlir::gpu::ShuffleOp,
+                   gpu_runtime::GPUSubgroupScanOp>(op);
+}
+
+/// Replaces subgroup op results for the subgroup of size 1: reductions and
+/// inclusive scans return the item value, exclusive scans return the neutral
+/// value and shuffles return the item value.
+static mlir::LogicalResult lowerSubgroupOp(mlir::OpBuilder &builder,
+                                           mlir::Operation *op) {
+  auto loc = op->getLoc();
+  if (auto reduce = mlir::dyn_cast<mlir::gpu::SubgroupReduceOp>(op)) {
+    reduce.getResult().replaceAllUsesWith(reduce.getValue());
+    return mlir::success();
+  }
+
+  if (auto shuffle = mlir::dyn_cast<mlir::gpu::ShuffleOp>(op)) {
+    mlir::Value valid =
+        builder.create<mlir::arith::ConstantIntOp>(loc, 1, /*width*/ 1);
+    shuffle.getShuffleResult().replaceAllUsesWith(shuffle.getValue());
+    shuffle.getValid().replaceAllUsesWith(valid);
+    return mlir::success();
+  }
+
+  if (auto scan = mlir::dyn_cast<gpu_runtime::GPUSubgroupScanOp>(op)) {
+    if (!scan.getExclusive()) {
+      scan.getResult().replaceAllUsesWith(scan.getValue());
+      return mlir::success();
+    }
+
+    auto neutral =
+        gpu_runtime::getReduceNeutralValue(scan.getType(), scan.getOp());
+    if (!neutral)
+      return mlir::failure();
+
+    mlir::Value val = builder.create<mlir::arith::ConstantOp>(loc, *neutral);
+    scan.getResult().replaceAllUsesWith(val);
+    return mlir::success();
+  }
+
+  return mlir::failure();
+}
+
+namespace {
+/// Builds host loops for the single launch. New ops are only created inside
+/// the group loop, so it can be erased on failure without affecting the
+/// original launch.
+class LaunchToCpu {
+public:
+  LaunchToCpu(mlir::gpu::LaunchOp launch) : launch(launch) {}
+
+  mlir::LogicalResult lower(mlir::OpBuilder &builder);
+
+  llvm::StringRef getError() const { return error; }
+
+  llvm::ArrayRef<mlir::scf::ParallelOp> getItemLoops() const {
+    return itemLoops;
+  }
+
+private:
+  mlir::gpu::LaunchOp launch;
+  std::string error;
+
+  /// Launch body to group level values mapping.
+  mlir::IRMapping mapping;
+
+  /// Launch body values, which are the same for all items in group.
+  llvm::DenseSet<mlir::Value> uniform;
+
+  /// Item values, used across barriers, to per-group buffers with
+  /// `blockSizeZ x blockSizeY x blockSizeX` shape.
+  llvm::DenseMap<mlir::Value, mlir::Value> spills;
+
+  std::array<mlir::Value, 3> groupIds;
+  std::array<mlir::Value, 3> gridSize;
+  std::array<mlir::Value, 3> blockSize;
+  mlir::Value zero;
+  mlir::Value one;
+
+  /// Group body block, spill buffers are allocated at its start.
+  mlir::Block *groupBlock = nullptr;
+
+  /// Created loops over the group items.
+  llvm::SmallVector<mlir::scf::ParallelOp> itemLoops;
+
+  mlir::LogicalResult fail(const llvm::Twine &msg) {
+    error = msg.str();
+    return mlir::failure();
+  }
+
+  bool isUniform(mlir::Value val) const {
+    if (!launch.getBody().isAncestor(val.getParentRegion()))
+      return true;
+
+    return uniform.contains(val);
+  }
+
+  bool hasUniformOperands(mlir::Operation *op) const {
+    return llvm::all_of(op->getOperands(),
+                        [&](mlir::Value arg) { return isUniform(arg); });
+  }
+
+  mlir::Value getDimValue(mlir::OpBuilder &builder, mlir::Operation *op,
+                          llvm::ArrayRef<mlir::Value> threadIds) const;
+
+  mlir::Value createSpillBuffer(mlir::OpBuilder &builder, mlir::Location loc,
+                                mlir::Type type) const;
+
+  mlir::LogicalResult lowerBlock(mlir::OpBuilder &builder, mlir::Block &block);
+
+  mlir::LogicalResult lowerSegment(mlir::OpBuilder &builder,
+                                   mlir::Block &block,
+                                   llvm::ArrayRef<mlir::Operation *> ops);
+
+  mlir::LogicalResult lowerReduce(mlir::OpBuilder &builder,
+                                  mlir::gpu::AllReduceOp op);
+
+  mlir::LogicalResult lowerScan(mlir::OpBuilder &builder,
+                                gpu_runtime::GPUGroupScanOp op);
+};
+} // namespace
+
+mlir::Value
+LaunchToCpu::getDimValue(mlir::OpBuilder &builder, mlir::Operation *op,
+                         llvm::ArrayRef<mlir::Value> threadIds) const {
+  auto dim = [](auto dimOp) {
+    return static_cast<unsigned>(dimOp.getDimension());
+  };
+  if (auto idOp = mlir::dyn_cast<mlir::gpu::BlockIdOp>(op))
+    return groupIds[dim(idOp)];
+
+  if (auto dimOp = mlir::dyn_cast<mlir::gpu::GridDimOp>(op))
+    return gridSize[dim(dimOp)];
+
+  if (auto dimOp = mlir::dyn_cast<mlir::gpu::BlockDimOp>(op))
+    return blockSize[dim(dimOp)];
+
+  auto loc = op->getLoc();
+  if (mlir::isa<mlir::gpu::LaneIdOp>(op))
+    return zero;
+
+  if (mlir::isa<mlir::gpu::SubgroupSizeOp>(op))
+    return one;
+
+  if (mlir::isa<mlir::gpu::NumSubgroupsOp>(op)) {
+    mlir::Value res =
+        builder.create<mlir::arith::MulIOp>(loc, blockSize[0], blockSize[1]);
+    return builder.create<mlir::arith::MulIOp>(loc, res, blockSize[2]);
+  }
+
+  if (threadIds.empty())
+    return {};
+
+  if (auto idOp = mlir::dyn_cast<mlir::gpu::ThreadIdOp>(op))
+    return threadIds[dim(idOp)];
+
+  if (mlir::isa<mlir::gpu::SubgroupIdOp>(op)) {
+    // Linear local id, x is the fastest changing dim.
+    mlir::Value res =
+        builder.create<mlir::arith::MulIOp>(loc, threadIds[2], blockSize[1]);
+    res = builder.create<mlir::arith::AddIOp>(loc, res, threadIds[1]);
+    res = builder.create<mlir::arith::MulIOp>(loc, res, blockSize[0]);
+    return builder.create<mlir::arith::AddIOp>(loc, res, threadIds[0]);
+  }
+
+  if (auto idOp = mlir::dyn_cast<mlir::gpu::GlobalIdOp>(op)) {
+    auto d = dim(idOp);
+    mlir::Value res =
+        builder.create<mlir::arith::MulIOp>(loc, groupIds[d], blockSize[d]);
+    return builder.create<mlir::arith::AddIOp>(loc, res, threadIds[d]);
+  }
+
+  return {};
+}
+
+mlir::Value LaunchToCpu::createSpillBuffer(mlir::OpBuilder &builder,
+                                           mlir::Location loc,
+                                           mlir::Type type) const {
+  mlir::OpBuilder::InsertionGuard g(builder);
+  builder.setInsertionPointToStart(groupBlock);
+  auto dyn = mlir::ShapedType::kDynamic;
+  auto memrefType = mlir::MemRefType::get({dyn, dyn, dyn}, type);
+  mlir::Value sizes[] = {blockSize[2], blockSize[1], blockSize[0]};
+  return builder.create<mlir::memref::AllocaOp>(loc, memrefType, sizes);
+}
+
+mlir::LogicalResult LaunchToCpu::lowerBlock(mlir::OpBuilder &builder,
+                                            mlir::Block &block) {
+  llvm::SmallVector<mlir::Operation *> segment;
+  auto flush = [&]() -> mlir::LogicalResult {
+    auto res = lowerSegment(builder, block, segment);
+    segment.clear();
+    return res;
+  };
+
+  for (auto &op : block) {
+    if (op.hasTrait<mlir::OpTrait::IsTerminator>())
+      continue;
+
+    if (isGroupDimOp(&op)) {
+      mapping.map(op.getResult(0), getDimValue(builder, &op, {}));
+      uniform.insert(op.getResult(0));
+      continue;
+    }
+
+    if (!containsBarrier(&op)) {
+      if (isWorkgroupAlloca(&op)) {
+        if (!hasUniformOperands(&op))
+          return fail("local array size is not uniform");
+
+        builder.clone(op, mapping);
+        uniform.insert(op.getResult(0));
+        continue;
+      }
+
+      // Compute uniform values once per group.
+      if (!isItemIdOp(&op) && op.getNumRegions() == 0 && mlir::isPure(&op) &&
+          hasUniformOperands(&op)) {
+        builder.clone(op, mapping);
+        uniform.insert(op.getResults().begin(), op.getResults().end());
+        continue;
+      }
+
+      segment.emplace_back(&op);
+      continue;
+    }
+
+    if (mlir::failed(flush()))
+      return mlir::failure();
+
+    // All items are finished at the end of item loop.
+    if (mlir::isa<mlir::gpu::BarrierOp>(op))
+      continue;
+
+    if (auto reduce = mlir::dyn_cast<mlir::gpu::AllReduceOp>(op)) {
+      if (mlir::failed(lowerReduce(builder, reduce)))
+        return mlir::failure();
+
+      continue;
+    }
+
+    if (auto scan = mlir::dyn_cast<gpu_runtime::GPUGroupScanOp>(op)) {
+      if (mlir::failed(lowerScan(builder, scan)))
+        return mlir::failure();
+
+      continue;
+    }
+
+    auto loc = op.getLoc();
+    if (auto forOp = mlir::dyn_cast<mlir::scf::ForOp>(op)) {
+      if (forOp.getNumRegionIterArgs() != 0 || !hasUniformOperands(forOp))
+        return fail("barrier inside non-uniform loop");
+
+      auto newFor = builder.create<mlir::scf::ForOp>(
+          loc, mapping.lookupOrDefault(forOp.getLowerBound()),
+          mapping.lookupOrDefault(forOp.getUpperBound()),
+          mapping.lookupOrDefault(forOp.getStep()));
+      mapping.map(forOp.getInductionVar(), newFor.getInductionVar());
+      uniform.insert(forOp.getInductionVar());
+
+      mlir::OpBuilder::InsertionGuard g(builder);
+      builder.setInsertionPoint(newFor.getBody()->getTerminator());
+      if (mlir::failed(lowerBlock(builder, *forOp.getBody())))
+        return mlir::failure();
+
+      continue;
+    }
+
+    if (auto ifOp = mlir::dyn_cast<mlir::scf::IfOp>(op)) {
+      if (ifOp->getNumResults() != 0 || !isUniform(ifOp.getCondition()))
+        return fail("barrier inside non-uniform condition");
+
+      bool hasElse = !ifOp.getElseRegion().empty();
+      auto newIf = builder.create<mlir::scf::IfOp>(
+          loc, mapping.lookupOrDefault(ifOp.getCondition()), hasElse);
+
+      mlir::OpBuilder::InsertionGuard g(builder);
+      builder.setInsertionPoint(newIf.thenBlock()->getTerminator());
+      if (mlir::failed(lowerBlock(builder, *ifOp.thenBlock())))
+        return mlir::failure();
+
+      if (hasElse) {
+        builder.setInsertionPoint(newIf.elseBlock()->getTerminator());
+        if (mlir::failed(lowerBlock(builder, *ifOp.elseBlock())))
+          return mlir::failure();
+      }
+      continue;
+    }
+
+    // Loop fission can't split other ops, e.g. `scf.while`, at the barrier.
+    // Launch is left as is and runs on the GPU launch path instead.
+    return fail("barrier inside unsupported op: " +
+                op.getName().getStringRef());
+  }
+
+  return flush();
+}
+
+mlir::LogicalResult
+LaunchToCpu::lowerSegment(mlir::OpBuilder &builder, mlir::Block &block,
+                          llvm::ArrayRef<mlir::Operation *> ops) {
+  if (ops.empty())
+    return mlir::success();
+
+  auto loc = ops.front()->getLoc();
+  mlir::Value lowerBounds[] = {zero, zero, zero};
+  mlir::Value upperBounds[] = {blockSize[2], blockSize[1], blockSize[0]};
+  mlir::Value steps[] = {one, one, one};
+  auto loop = builder.create<mlir::scf::ParallelOp>(loc, lowerBounds,
+                                                    upperBounds, steps);
+  itemLoops.emplace_back(loop);
+
+  mlir::OpBuilder::InsertionGuard g(builder);
+  builder.setInsertionPoint(loop.getBody()->getTerminator());
+
+  // Private arrays are allocated for each item, keep stack size bounded.
+  auto hasAllocas = llvm::any_of(ops, [](mlir::Operation *op) {
+    return op
+        ->walk([](mlir::memref::AllocaOp) {
+          return mlir::WalkResult::interrupt();
+        })
+        .wasInterrupted();
+  });
+  if (hasAllocas) {
+    auto scope =
+        builder.create<mlir::memref::AllocaScopeOp>(loc, mlir::TypeRange());
+    builder.createBlock(&scope.getBodyRegion());
+    auto term = builder.create<mlir::memref::AllocaScopeReturnOp>(loc);
+    builder.setInsertionPoint(term);
+  }
+
+  auto ivs = loop.getInductionVars();
+  mlir::Value threadIds[] = {ivs[2], ivs[1], ivs[0]};
+  mlir::ValueRange indices = ivs;
+
+  mlir::IRMapping itemMapping = mapping;
+  auto launchThreadIds = launch.getThreadIds();
+  itemMapping.map(launchThreadIds.x, threadIds[0]);
+  itemMapping.map(launchThreadIds.y, threadIds[1]);
+  itemMapping.map(launchThreadIds.z, threadIds[2]);
+
+  // Reload values, spilled by the previous item loops.
+  for (auto op : ops) {
+    op->walk([&](mlir::Operation *nested) {
+      for (auto arg : nested->getOperands()) {
+        auto it = spills.find(arg);
+        if (it == spills.end() || itemMapping.contains(arg))
+          continue;
+
+        mlir::Value val =
+            builder.create<mlir::memref::LoadOp>(loc, it->second, indices);
+        itemMapping.map(arg, val);
+      }
+    });
+  }
+
+  llvm::SmallPtrSet<mlir::Operation *, 16> opsSet(ops.begin(), ops.end());
+  auto isUsedOutside = [&](mlir::Value val) {
+    return llvm::any_of(val.getUsers(), [&](mlir::Operation *user) {
+      auto owner = block.findAncestorOpInBlock(*user);
+      return !owner || !opsSet.contains(owner);
+    });
+  };
+
+  for (auto op : ops) {
+    auto newOp = builder.clone(*op, itemMapping);
+    for (auto &&[res, newRes] :
+         llvm::zip(op->getResults(), newOp->getResults())) {
+      if (!isUsedOutside(res))
+        continue;
+
+      if (!isSpillableType(res.getType()))
+        return fail("non-scalar value is used across barrier");
+
+      auto buffer = createSpillBuffer(builder, loc, res.getType());
+      builder.create<mlir::memref::StoreOp>(loc, newRes, buffer, indices);
+      spills.try_emplace(res, buffer);
+    }
+  }
+
+  // Replace launch dims ops inside cloned ops. Fences are no-op as all items
+  // of the group are executed sequentially by a single thread.
+  builder.setInsertionPointToStart(loop.getBody());
+  llvm::SmallVector<mlir::Operation *> toErase;
+  mlir::Operation *unsupported = nullptr;
+  loop.getBody()->walk([&](mlir::Operation *nested) {
+    if (mlir::isa<gpu_runtime::GPUMemFenceOp>(nested)) {
+      toErase.emplace_back(nested);
+      return;
+    }
+
+    if (auto val = getDimValue(builder, nested, threadIds)) {
+      nested->getResult(0).replaceAllUsesWith(val);
+      toErase.emplace_back(nested);
+      return;
+    }
+
+    if (!isSubgroupOp(nested))
+      return;
+
+    if (mlir::failed(lowerSubgroupOp(builder, nested))) {
+      unsupported = nested;
+      return;
+    }
+    toErase.emplace_back(nested);
+  });
+
+  for (auto op : toErase)
+    op->erase();
+
+  if (unsupported)
+    return fail("unsupported subgroup op: " +
+                unsupported->getName().getStringRef());
+
+  return mlir::success();
+}
+
+mlir::LogicalResult LaunchToCpu::lowerReduce(mlir::OpBuilder &builder,
+                                             mlir::gpu::AllReduceOp op) {
+  auto val = op.getValue();
+  auto isFloat = mlir::isa<mlir::FloatType>(val.getType());
+  auto combine = getCombineFunc(*op.getOp(), isFloat);
+  if (!combine)
+    return fail("unsupported group reduction");
+
+  auto loc = op.getLoc();
+  mlir::Value flat;
+  if (!isUniform(val)) {
+    auto it = spills.find(val);
+    if (it == spills.end())
+      return fail("group reduction operand is not available");
+
+    mlir::ReassociationIndices dims[] = {{0, 1, 2}};
+    flat = builder.create<mlir::memref::CollapseShapeOp>(loc, it->second,
+                                                         dims);
+  }
+
+  auto getElem = [&](mlir::OpBuilder &b, mlir::Location l,
+                     mlir::Value idx) -> mlir::Value {
+    if (!flat)
+      return mapping.lookupOrDefault(val);
+
+    return b.create<mlir::memref::LoadOp>(l, flat, idx);
+  };
+
+  mlir::Value count =
+      builder.create<mlir::arith::MulIOp>(loc, blockSize[0], blockSize[1]);
+  count = builder.create<mlir::arith::MulIOp>(loc, count, blockSize[2]);
+
+  auto init = getElem(builder, loc, zero);
+  auto bodyBuilder = [&](mlir::OpBuilder &b, mlir::Location l, mlir::Value i,
+                         mlir::ValueRange args) {
+    auto res = combine(b, l, args.front(), getElem(b, l, i));
+    b.create<mlir::scf::YieldOp>(l, res);
+  };
+  auto loop =
+      builder.create<mlir::scf::ForOp>(loc, one, count, one, init, bodyBuilder);
+
+  mapping.map(op.getResult(), loop.getResult(0));
+  uniform.insert(op.getResult());
+  return mlir::success();
+}
+
+mlir::LogicalResult LaunchToCpu::lowerScan(mlir::OpBuilder &builder,
+                                           gpu_runtime::GPUGroupScanOp op) {
+  auto val = op.getValue();
+  auto type = val.getType();
+  auto isFloat = mlir::isa<mlir::FloatType>(type);
+  auto combine = getCombineFunc(op.getOp(), isFloat);
+  if (!combine)
+    return fail("unsupported group scan");
+
+  auto loc = op.getLoc();
+  mlir::ReassociationIndices dims[] = {{0, 1, 2}};
+  mlir::Value flat;
+  if (!isUniform(val)) {
+    auto it = spills.find(val);
+    if (it == spills.end())
+      return fail("group scan operand is not available");
+
+    flat = builder.create<mlir::memref::CollapseShapeOp>(loc, it->second,
+                                                         dims);
+  }
+
+  auto getElem = [&](mlir::OpBuilder &b, mlir::Location l,
+                     mlir::Value idx) -> mlir::Value {
+    if (!flat)
+      return mapping.lookupOrDefault(val);
+
+    return b.create<mlir::memref::LoadOp>(l, flat, idx);
+  };
+
+  // Results are stored into the spill buffer, so the following item loops
+  // can load them.
+  auto result = createSpillBuffer(builder, loc, type);
+  mlir::Value resultFlat =
+      builder.create<mlir::memref::CollapseShapeOp>(loc, result, dims);
+
+  bool exclusive = op.getExclusive();
+  mlir::Value init;
+  mlir::Value lower;
+  if (exclusive) {
+    auto neutral = gpu_runtime::getReduceNeutralValue(type, op.getOp());
+    if (!neutral)
+      return fail("unsupported group scan");
+
+    init = builder.create<mlir::arith::ConstantOp>(loc, *neutral);
+    lower = zero;
+  } else {
+    init = getElem(builder, loc, zero);
+    builder.create<mlir::memref::StoreOp>(loc, init, resultFlat, zero);
+    lower = one;
+  }
+
+  mlir::Value count =
+      builder.create<mlir::arith::MulIOp>(loc, blockSize[0], blockSize[1]);
+  count = builder.create<mlir::arith::MulIOp>(loc, count, blockSize[2]);
+
+  auto bodyBuilder = [&](mlir::OpBuilder &b, mlir::Location l, mlir::Value i,
+                         mlir::ValueRange args) {
+    auto acc = args.front();
+    if (exclusive)
+      b.create<mlir::memref::StoreOp>(l, acc, resultFlat, i);
+
+    auto res = combine(b, l, acc, getElem(b, l, i));
+    if (!exclusive)
+      b.create<mlir::memref::StoreOp>(l, res, resultFlat, i);
+
+    b.create<mlir::scf::YieldOp>(l, res);
+  };
+  builder.create<mlir::scf::ForOp>(loc, lower, count, one, init, bodyBuilder);
+
+  spills.try_emplace(op.getResult(), result);
+  return mlir::success();
+}
+
+mlir::LogicalResult LaunchToCpu::lower(mlir::OpBuilder &builder) {
+  if (launch.getAsyncToken() || !launch.getAsyncDependencies().empty())
+    return fail("async launches are not supported");
+
+  if (launch.getDynamicSharedMemorySize())
+    return fail("dynamic shared memory is not supported");
+
+  if (!launch.getPrivateAttributions().empty())
+    return fail("private attributions are not supported");
+
+  auto &body = launch.getBody();
+  if (!llvm::hasSingleElement(body))
+    return fail("unstructured control flow is not supported");
+
+  mlir::Operation *unsupported = nullptr;
+  body.walk([&](mlir::Operation *op) -> mlir::WalkResult {
+    if (!mlir::isa_and_present<mlir::gpu::GPUDialect>(op->getDialect()) ||
+        isSupportedGpuOp(op))
+      return mlir::WalkResult::advance();
+
+    unsupported = op;
+    return mlir::WalkResult::interrupt();
+  });
+  if (unsupported)
+    return fail("unsupported op: " + unsupported->getName().getStringRef());
+
+  auto loc = launch.getLoc();
+  mlir::OpBuilder::InsertionGuard g(builder);
+  builder.setInsertionPoint(launch);
+  auto zeroOp = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  auto oneOp = builder.create<mlir::arith::ConstantIndexOp>(loc, 1);
+  zero = zeroOp;
+  one = oneOp;
+
+  auto gridOperands = launch.getGridSizeOperandValues();
+  auto blockOperands = launch.getBlockSizeOperandValues();
+  gridSize = {gridOperands.x, gridOperands.y, gridOperands.z};
+  blockSize = {blockOperands.x, blockOperands.y, blockOperands.z};
+
+  // Loops dims are in (z, y, x) order, so x is the innermost one.
+  mlir::Value lowerBounds[] = {zero, zero, zero};
+  mlir::Value upperBounds[] = {gridSize[2], gridSize[1], gridSize[0]};
+  mlir::Value steps[] = {one, one, one};
+  auto groupLoop = builder.create<mlir::scf::ParallelOp>(loc, lowerBounds,
+                                                         upperBounds, steps);
+  auto ivs = groupLoop.getInductionVars();
+  groupIds = {ivs[2], ivs[1], ivs[0]};
+
+  // Spill buffers and local arrays are allocated per group.
+  builder.setInsertionPoint(groupLoop.getBody()->getTerminator());
+  auto scope =
+      builder.create<mlir::memref::AllocaScopeOp>(loc, mlir::TypeRange());
+  groupBlock = builder.createBlock(&scope.getBodyRegion());
+  auto scopeTerm = builder.create<mlir::memref::AllocaScopeReturnOp>(loc);
+  builder.setInsertionPoint(scopeTerm);
+
+  auto mapDims = [&](mlir::gpu::KernelDim3 args,
+                     llvm::ArrayRef<mlir::Value> values) {
+    mlir::Value src[] = {args.x, args.y, args.z};
+    for (auto &&[arg, val] : llvm::zip(src, values)) {
+      mapping.map(arg, val);
+      uniform.insert(arg);
+    }
+  };
+  mapDims(launch.getBlockIds(), groupIds);
+  mapDims(launch.getGridSize(), gridSize);
+  mapDims(launch.getBlockSize(), blockSize);
+
+  auto cleanup = [&]() {
+    groupLoop->erase();
+    oneOp->erase();
+    zeroOp->erase();
+  };
+
+  for (auto attr : launch.getWorkgroupAttributions()) {
+    auto type = mlir::cast<mlir::MemRefType>(
+        stripGpuMemorySpace(attr.getType()));
+    if (!type.hasStaticShape()) {
+      cleanup();
+      return fail("dynamic workgroup attributions are not supported");
+    }
+
+    mlir::OpBuilder::InsertionGuard g(builder);
+    builder.setInsertionPointToStart(groupBlock);
+    mlir::Value alloca = builder.create<mlir::memref::AllocaOp>(loc, type);
+    mapping.map(attr, alloca);
+    uniform.insert(attr);
+  }
+
+  if (mlir::failed(lowerBlock(builder, body.front()))) {
+    cleanup();
+    return mlir::failure();
+  }
+
+  stripGpuMemorySpaces(groupLoop);
+  launch->erase();
+  return mlir::success();
+}
+
+mlir::LogicalResult gpu_runtime::lowerLaunchToCpu(
+    mlir::OpBuilder &builder, mlir::gpu::LaunchOp launch,
+    llvm::SmallVectorImpl<mlir::scf::ParallelOp> *itemLoops) {
+  LaunchToCpu lowering(launch);
+  if (mlir::succeeded(lowering.lower(builder))) {
+    if (itemLoops)
+      llvm::append_range(*itemLoops, lowering.getItemLoops());
+
+    return mlir::success();
+  }
+
+  launch.emitRemark("gpu.launch is not lowered to CPU: ")
+      << lowering.getError();
+  return mlir::failure();
+}
+
+namespace {
+struct LowerLaunchesToCpuPass
+    : public mlir::PassWrapper<LowerLaunchesToCpuPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(LowerLaunchesToCpuPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<mlir::gpu::LaunchOp> launches;
+    getOperation()->walk([&](mlir::gpu::LaunchOp launch) {
+      auto env = getGpuRegionEnv(launch);
+      if (!env || gpu_runtime::isCpuRegion(env))
+        launches.emplace_back(launch);
+    });
+
+    if (launches.empty())
+      return markAllAnalysesPreserved();
+
+    mlir::OpBuilder builder(&getContext());
+    for (auto launch : launches)
+      (void)gpu_runtime::lowerLaunchToCpu(builder, launch);
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> gpu_runtime::createLowerLaunchesToCpuPass() {
+  return std::make_unique<LowerLaunchesToCpuPass>();
+}
@@ -33,8 +33,9 @@ static int64_t getMinVal(unsigned bits) {
 static int64_t getMaxVal(unsigned bits) { return getMinVal(bits) - 1; }
 
 // TODO: Upstream
-static std::optional<mlir::Attribute>
-getNeutralValue(mlir::Type resultType, mlir::gpu::AllReduceOperation op) {
+std::optional<mlir::TypedAttr>
+gpu_runtime::getReduceNeutralValue(mlir::Type resultType,
+                                   mlir::gpu::AllReduceOperation op) {
   using Op = mlir::gpu::AllReduceOperation;
   // Builder only used as helper for attribute creation.
   mlir::OpBuilder b(resultType.getContext());
@@ -73,15 +74,20 @@ getNeutralValue(mlir::gpu::AllReduceOp reduceOp) {
     return res;
 
   if (auto op = reduceOp.getOp())
-    if (auto res = getNeutralValue(reduceOp.getResult().getType(), *op))
-      return res;
+    if (auto res =
+            gpu_runtime::getReduceNeutralValue(reduceOp.getType(), *op))
+      return *res;
 
   return std::nullopt;
 }
 
 static std::optional<mlir::Attribute>
 getNeutralValue(mlir::gpu::SubgroupReduceOp reduceOp) {
-  return getNeutralValue(reduceOp.getResult().getType(), reduceOp.getOp());
+  if (auto res = gpu_runtime::getReduceNeutralValue(reduceOp.getType(),
+                                                    reduceOp.getOp()))
+    return *res;
+
+  return std::nullopt;
 }
 
 static mlir::LogicalResult convertBlockingOp(mlir::Operation *op,
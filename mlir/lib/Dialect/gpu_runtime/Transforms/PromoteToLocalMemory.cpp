@@ -0,0 +1,379 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Dialect/gpu_runtime/Transforms/PromoteToLocalMemory.hpp"
+
+#include "numba/Analysis/AliasAnalysis.hpp"
+#include "numba/Dialect/gpu_runtime/IR/GpuRuntimeOps.hpp"
+
+#include "LaunchUtils.hpp"
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/GPU/IR/GPUDialect.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+/// Max difference between min and max offsets along single dimension.
+static constexpr int64_t MaxHalo = 8;
+
+/// Max number of promoted buffers per launch, to limit workgroup memory use.
+static constexpr unsigned MaxPromotedBuffers = 4;
+
+namespace {
+/// Memref access pattern. Each memref dimension is either thread position
+/// along launch dimension (`dims[i] >= 0`) or value, uniform across launch.
+struct AccessPattern {
+  mlir::Value memref;
+  llvm::SmallVector<int> dims;
+  llvm::SmallVector<mlir::Value> uniforms;
+
+  bool operator==(const AccessPattern &rhs) const {
+    return memref == rhs.memref && dims == rhs.dims &&
+           uniforms == rhs.uniforms;
+  }
+};
+
+struct LoadsGroup {
+  AccessPattern pattern;
+  llvm::SmallVector<mlir::memref::LoadOp> loads;
+
+  /// Constant offsets for each load, for thread dimensions only.
+  llvm::SmallVector<llvm::SmallVector<int64_t>> offsets;
+};
+} // namespace
+
+static bool isDefinedOutside(mlir::Value val, mlir::Operation *op) {
+  return !op->isAncestor(val.getParentBlock()->getParentOp());
+}
+
+static std::optional<std::pair<AccessPattern, llvm::SmallVector<int64_t>>>
+getAccessPattern(mlir::memref::LoadOp load,
+                 const gpu_runtime::LaunchDims &dims) {
+  AccessPattern pattern;
+  pattern.memref = load.getMemRef();
+  llvm::SmallVector<int64_t> offsets;
+  bool hasThreadDims = false;
+  for (auto idx : load.getIndices()) {
+    if (isDefinedOutside(idx, dims.launch)) {
+      pattern.dims.emplace_back(-1);
+      pattern.uniforms.emplace_back(idx);
+      continue;
+    }
+
+    auto access = gpu_runtime::getThreadAccess(idx, dims);
+    if (!access)
+      return std::nullopt;
+
+    auto dim = static_cast<int>(access->first);
+    if (llvm::is_contained(pattern.dims, dim))
+      return std::nullopt;
+
+    pattern.dims.emplace_back(dim);
+    offsets.emplace_back(access->second);
+    hasThreadDims = true;
+  }
+
+  if (!hasThreadDims)
+    return std::nullopt;
+
+  return std::pair(std::move(pattern), std::move(offsets));
+}
+
+/// Collects memrefs, which can be written inside launch. Returns false if
+/// written memrefs cannot be determined.
+static bool collectWrites(mlir::gpu::LaunchOp launch,
+                          llvm::SmallVectorImpl<mlir::Value> &writes) {
+  auto visitor = [&](mlir::Operation *op) -> mlir::WalkResult {
+    if (op->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>())
+      return mlir::WalkResult::advance();
+
+    auto iface = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(op);
+    if (!iface)
+      return mlir::WalkResult::interrupt();
+
+    llvm::SmallVector<mlir::MemoryEffects::EffectInstance> effects;
+    iface.getEffects(effects);
+    for (auto &effect : effects) {
+      if (!mlir::isa<mlir::MemoryEffects::Write>(effect.getEffect()))
+        continue;
+
+      auto val = effect.getValue();
+      if (!val)
+        return mlir::WalkResult::interrupt();
+
+      writes.emplace_back(val);
+    }
+    return mlir::WalkResult::advance();
+  };
+  return !launch.getBody().walk(visitor).wasInterrupted();
+}
+
+static llvm::SmallVector<LoadsGroup> collectLoads(mlir::gpu::LaunchOp launch) {
+  llvm::SmallVector<mlir::Value> writes;
+  if (!collectWrites(launch, writes))
+    return {};
+
+  gpu_runtime::LaunchDims dims(launch);
+  numba::LocalAliasAnalysis aa;
+  llvm::SmallVector<LoadsGroup> groups;
+  launch.getBody().walk([&](mlir::memref::LoadOp load) {
+    auto memref = load.getMemRef();
+    if (!isDefinedOutside(memref, launch) ||
+        !load.getType().isIntOrIndexOrFloat())
+      return;
+
+    auto access = getAccessPattern(load, dims);
+    if (!access)
+      return;
+
+    if (llvm::any_of(writes, [&](mlir::Value write) {
+          return !aa.alias(write, memref).isNo();
+        }))
+      return;
+
+    auto &[pattern, offsets] = *access;
+    auto it = llvm::find_if(groups, [&](const LoadsGroup &group) {
+      return group.pattern == pattern;
+    });
+    if (it == groups.end()) {
+      groups.push_back({pattern, {}, {}});
+      it = std::prev(groups.end());
+    }
+    it->loads.emplace_back(load);
+    it->offsets.emplace_back(offsets);
+  });
+
+  // Promote only groups with reuse between neighbouring threads.
+  llvm::erase_if(groups, [](const LoadsGroup &group) {
+    if (llvm::all_equal(group.offsets))
+      return true;
+
+    auto numDims = group.offsets.front().size();
+    for (auto i : llvm::seq<size_t>(0, numDims)) {
+      auto [minIt, maxIt] = llvm::minmax_element(
+          group.offsets, [&](auto &lhs, auto &rhs) { return lhs[i] < rhs[i]; });
+      if ((*maxIt)[i] - (*minIt)[i] > MaxHalo)
+        return true;
+    }
+    return false;
+  });
+
+  if (groups.size() > MaxPromotedBuffers)
+    groups.resize(MaxPromotedBuffers);
+
+  return groups;
+}
+
+static void promote(mlir::OpBuilder &builder,
+                    const gpu_runtime::LaunchDims &dims, LoadsGroup &group) {
+  auto launch = dims.launch;
+  auto loc = launch.getLoc();
+  auto &pattern = group.pattern;
+  auto memref = pattern.memref;
+  auto numDims = group.offsets.front().size();
+
+  llvm::SmallVector<int64_t> minOffsets(numDims);
+  llvm::SmallVector<int64_t> halo(numDims);
+  for (auto i : llvm::seq<size_t>(0, numDims)) {
+    auto [minIt, maxIt] = llvm::minmax_element(
+        group.offsets, [&](auto &lhs, auto &rhs) { return lhs[i] < rhs[i]; });
+    minOffsets[i] = (*minIt)[i];
+    halo[i] = (*maxIt)[i] - minOffsets[i];
+  }
+
+  auto getLocalSizes = [&](llvm::ArrayRef<mlir::Value> blockSizes) {
+    llvm::SmallVector<mlir::Value> ret;
+    unsigned i = 0;
+    for (auto dim : pattern.dims) {
+      if (dim < 0)
+        continue;
+
+      mlir::Value haloVal =
+          builder.create<mlir::arith::ConstantIndexOp>(loc, halo[i++]);
+      ret.emplace_back(
+          builder.create<mlir::arith::AddIOp>(loc, blockSizes[dim], haloVal));
+    }
+    return ret;
+  };
+
+  // Allocate workgroup buffer, covering the block tile with halo.
+  builder.setInsertionPoint(launch);
+  auto elemType =
+      mlir::cast<mlir::MemRefType>(memref.getType()).getElementType();
+  auto storageClass = mlir::gpu::AddressSpaceAttr::get(
+      builder.getContext(), mlir::gpu::GPUDialect::getWorkgroupAddressSpace());
+  auto localType = mlir::MemRefType::get(
+      llvm::SmallVector<int64_t>(numDims, mlir::ShapedType::kDynamic),
+      elemType, nullptr, storageClass);
+  mlir::Value local =
+      builder
+          .create<mlir::gpu::AllocOp>(loc, localType,
+                                      /*asyncToken*/ mlir::Type(),
+                                      /*asyncDependencies*/ std::nullopt,
+                                      getLocalSizes(dims.sizeOperand),
+                                      /*symbolOperands*/ std::nullopt)
+          .getMemref();
+  builder.setInsertionPointAfter(launch);
+  builder.create<mlir::gpu::DeallocOp>(loc, /*asyncToken*/ mlir::Type(),
+                                       /*asyncDependencies*/ std::nullopt,
+                                       local);
+
+  // Cooperatively load the tile, each thread loads elements strided by block
+  // size. Out of bounds elements are never read by the replaced loads.
+  builder.setInsertionPointToStart(&launch.getBody().front());
+  auto localSizes = getLocalSizes(dims.size);
+  mlir::Value zero = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+
+  llvm::SmallVector<mlir::Value> localIndices;
+  auto genBody = [&](mlir::OpBuilder &b) {
+    llvm::SmallVector<mlir::Value> indices;
+    mlir::Value inBounds;
+    auto checkBounds = [&](mlir::Value idx, unsigned memrefDim) {
+      mlir::Value dimSize =
+          b.create<mlir::memref::DimOp>(loc, memref, memrefDim);
+      mlir::Value lower = b.create<mlir::arith::CmpIOp>(
+          loc, mlir::arith::CmpIPredicate::sge, idx, zero);
+      mlir::Value upper = b.create<mlir::arith::CmpIOp>(
+          loc, mlir::arith::CmpIPredicate::slt, idx, dimSize);
+      mlir::Value in = b.create<mlir::arith::AndIOp>(loc, lower, upper);
+      if (inBounds)
+        in = b.create<mlir::arith::AndIOp>(loc, inBounds, in);
+
+      inBounds = in;
+    };
+
+    unsigned localDim = 0;
+    unsigned uniformDim = 0;
+    for (auto &&[i, dim] : llvm::enumerate(pattern.dims)) {
+      mlir::Value idx;
+      if (dim < 0) {
+        idx = pattern.uniforms[uniformDim++];
+      } else {
+        mlir::Value offset = b.create<mlir::arith::ConstantIndexOp>(
+            loc, minOffsets[localDim]);
+        idx = b.create<mlir::arith::MulIOp>(loc, dims.block[dim],
+                                            dims.size[dim]);
+        idx = b.create<mlir::arith::AddIOp>(loc, idx, localIndices[localDim]);
+        idx = b.create<mlir::arith::AddIOp>(loc, idx, offset);
+        ++localDim;
+      }
+      checkBounds(idx, static_cast<unsigned>(i));
+      indices.emplace_back(idx);
+    }
+
+    auto thenBuilder = [&](mlir::OpBuilder &thenB, mlir::Location l) {
+      mlir::Value val = thenB.create<mlir::memref::LoadOp>(l, memref, indices);
+      thenB.create<mlir::memref::StoreOp>(l, val, local, localIndices);
+      thenB.create<mlir::scf::YieldOp>(l);
+    };
+    b.create<mlir::scf::IfOp>(loc, inBounds, thenBuilder);
+  };
+
+  std::function<void(mlir::OpBuilder &, unsigned)> genLoops =
+      [&](mlir::OpBuilder &b, unsigned localDim) {
+        if (localDim == numDims) {
+          genBody(b);
+          return;
+        }
+
+        unsigned dim = 0;
+        for (unsigned i = 0, j = 0; i < pattern.dims.size(); ++i) {
+          if (pattern.dims[i] < 0)
+            continue;
+
+          if (j++ == localDim) {
+            dim = static_cast<unsigned>(pattern.dims[i]);
+            break;
+          }
+        }
+
+        auto bodyBuilder = [&](mlir::OpBuilder &bodyB, mlir::Location l,
+                               mlir::Value iv, mlir::ValueRange) {
+          localIndices.emplace_back(iv);
+          genLoops(bodyB, localDim + 1);
+          localIndices.pop_back();
+          bodyB.create<mlir::scf::YieldOp>(l);
+        };
+        b.create<mlir::scf::ForOp>(loc, dims.thread[dim], localSizes[localDim],
+                                   dims.size[dim], mlir::ValueRange(),
+                                   bodyBuilder);
+      };
+  genLoops(builder, 0);
+
+  auto barrier = builder.create<mlir::gpu::BarrierOp>(loc);
+  barrier->setAttr(gpu_runtime::getFenceFlagsAttrName(),
+                   builder.getI64IntegerAttr(
+                       static_cast<int64_t>(gpu_runtime::FenceFlags::local)));
+
+  // Replace global loads with the workgroup buffer loads.
+  for (auto &&[load, offsets] : llvm::zip(group.loads, group.offsets)) {
+    builder.setInsertionPoint(load);
+    auto loadLoc = load.getLoc();
+    llvm::SmallVector<mlir::Value> indices;
+    unsigned localDim = 0;
+    for (auto dim : pattern.dims) {
+      if (dim < 0)
+        continue;
+
+      auto offset = offsets[localDim] - minOffsets[localDim];
+      ++localDim;
+      mlir::Value idx = dims.thread[dim];
+      if (offset != 0) {
+        mlir::Value offsetVal =
+            builder.create<mlir::arith::ConstantIndexOp>(loadLoc, offset);
+        idx = builder.create<mlir::arith::AddIOp>(loadLoc, idx, offsetVal);
+      }
+      indices.emplace_back(idx);
+    }
+    auto newLoad =
+        builder.create<mlir::memref::LoadOp>(loadLoc, local, indices);
+    load.getResult().replaceAllUsesWith(newLoad.getResult());
+    load->erase();
+  }
+}
+
+namespace {
+struct PromoteToLocalMemoryPass
+    : public mlir::PassWrapper<PromoteToLocalMemoryPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(PromoteToLocalMemoryPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::gpu::GPUDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<mlir::gpu::LaunchOp> launches;
+    getOperation()->walk(
+        [&](mlir::gpu::LaunchOp launch) { launches.emplace_back(launch); });
+
+    bool changed = false;
+    mlir::OpBuilder builder(&getContext());
+    for (auto launch : launches) {
+      auto groups = collectLoads(launch);
+      if (groups.empty())
+        continue;
+
+      gpu_runtime::LaunchDims dims(launch);
+      for (auto &group : groups)
+        promote(builder, dims, group);
+
+      changed = true;
+    }
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> gpu_runtime::createPromoteToLocalMemoryPass() {
+  return std::make_unique<PromoteToLocalMemoryPass>();
+}
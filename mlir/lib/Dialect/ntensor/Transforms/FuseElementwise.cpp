@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Dialect/ntensor/Transforms/FuseElementwise.hpp"
+
+#include "numba/Dialect/ntensor/IR/NTensorOps.hpp"
+
+#include <mlir/IR/IRMapping.h>
+#include <mlir/IR/PatternMatch.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+#include <mlir/Transforms/GreedyPatternRewriteDriver.h>
+
+/// Checks there are no memory writes between `begin` and `end`, so producer
+/// inputs can be read at the consumer position instead.
+static bool noWritesBetween(mlir::Operation *begin, mlir::Operation *end) {
+  assert(begin->getBlock() == end->getBlock());
+  for (auto &op : llvm::make_range(std::next(begin->getIterator()),
+                                   end->getIterator())) {
+    if (mlir::isMemoryEffectFree(&op))
+      continue;
+
+    auto iface = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(op);
+    if (!iface || iface.hasEffect<mlir::MemoryEffects::Write>() ||
+        iface.hasEffect<mlir::MemoryEffects::Free>())
+      return false;
+  }
+  return true;
+}
+
+static bool isCompatibleType(mlir::Type type, mlir::Type expected) {
+  auto nt = mlir::dyn_cast<numba::ntensor::NTensorType>(type);
+  auto expectedNt = mlir::dyn_cast<numba::ntensor::NTensorType>(expected);
+  return nt && expectedNt && nt.getRank() == expectedNt.getRank() &&
+         nt.getEnvironment() == expectedNt.getEnvironment();
+}
+
+/// Returns single result elementwise producer of the consumer input, looking
+/// through casts.
+static numba::ntensor::ElementwiseOp getProducer(mlir::Value input) {
+  auto val = input;
+  if (auto cast = val.getDefiningOp<numba::ntensor::CastOp>()) {
+    if (!cast->hasOneUse())
+      return nullptr;
+
+    val = cast.getSource();
+  }
+
+  auto producer = val.getDefiningOp<numba::ntensor::ElementwiseOp>();
+  if (!producer || producer->getNumResults() != 1 || !val.hasOneUse())
+    return nullptr;
+
+  return producer;
+}
+
+namespace {
+struct FuseElementwiseOps
+    : public mlir::OpRewritePattern<numba::ntensor::ElementwiseOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(numba::ntensor::ElementwiseOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto inputs = op.getInputs();
+    if (inputs.empty())
+      return mlir::failure();
+
+    auto expectedType = inputs.front().getType();
+    numba::ntensor::ElementwiseOp producer;
+    unsigned fusedIndex = 0;
+    for (auto &&[i, input] : llvm::enumerate(inputs)) {
+      auto candidate = getProducer(input);
+      if (!candidate || candidate->getBlock() != op->getBlock())
+        continue;
+
+      if (!llvm::all_of(candidate.getInputs().getTypes(), [&](mlir::Type t) {
+            return isCompatibleType(t, expectedType);
+          }))
+        continue;
+
+      if (!noWritesBetween(candidate, op))
+        continue;
+
+      producer = candidate;
+      fusedIndex = static_cast<unsigned>(i);
+      break;
+    }
+
+    if (!producer)
+      return mlir::failure();
+
+    llvm::SmallVector<mlir::Value> newInputs;
+    auto getInputIndex = [&](mlir::Value val) -> unsigned {
+      auto it = llvm::find(newInputs, val);
+      if (it != newInputs.end())
+        return static_cast<unsigned>(it - newInputs.begin());
+
+      newInputs.emplace_back(val);
+      return static_cast<unsigned>(newInputs.size() - 1);
+    };
+
+    llvm::SmallVector<unsigned> producerArgs;
+    llvm::SmallVector<unsigned> consumerArgs;
+    for (auto &&[i, input] : llvm::enumerate(inputs)) {
+      if (i == fusedIndex) {
+        for (auto producerInput : producer.getInputs())
+          producerArgs.emplace_back(getInputIndex(producerInput));
+
+        consumerArgs.emplace_back(0);
+        continue;
+      }
+      consumerArgs.emplace_back(getInputIndex(input));
+    }
+
+    auto &producerBody = producer.getRegion().front();
+    auto &consumerBody = op.getRegion().front();
+    auto bodyBuilder = [&](mlir::OpBuilder &builder, mlir::Location loc,
+                           mlir::ValueRange args) {
+      mlir::IRMapping mapping;
+      for (auto &&[arg, index] :
+           llvm::zip(producerBody.getArguments(), producerArgs))
+        mapping.map(arg, args[index]);
+
+      for (auto &bodyOp : producerBody.without_terminator())
+        builder.clone(bodyOp, mapping);
+
+      auto producerTerm = mlir::cast<numba::ntensor::ElementwiseYieldOp>(
+          producerBody.getTerminator());
+      auto fused = mapping.lookupOrDefault(producerTerm.getValues().front());
+
+      for (auto &&[i, arg] : llvm::enumerate(consumerBody.getArguments()))
+        mapping.map(arg, i == fusedIndex ? fused : args[consumerArgs[i]]);
+
+      for (auto &bodyOp : consumerBody.without_terminator())
+        builder.clone(bodyOp, mapping);
+
+      auto consumerTerm = mlir::cast<numba::ntensor::ElementwiseYieldOp>(
+          consumerBody.getTerminator());
+      llvm::SmallVector<mlir::Value> results;
+      for (auto val : consumerTerm.getValues())
+        results.emplace_back(mapping.lookupOrDefault(val));
+
+      builder.create<numba::ntensor::ElementwiseYieldOp>(loc, results);
+    };
+
+    auto fusedInput = inputs[fusedIndex];
+    auto newOp = rewriter.create<numba::ntensor::ElementwiseOp>(
+        op.getLoc(), op.getResultTypes(), newInputs, bodyBuilder);
+    rewriter.replaceOp(op, newOp.getResults());
+
+    if (auto cast = fusedInput.getDefiningOp<numba::ntensor::CastOp>())
+      rewriter.eraseOp(cast);
+
+    rewriter.eraseOp(producer);
+    return mlir::success();
+  }
+};
+
+struct FuseElementwisePass
+    : public mlir::PassWrapper<FuseElementwisePass, mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FuseElementwisePass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<numba::ntensor::NTensorDialect>();
+  }
+
+  void runOnOperation() override {
+    auto &ctx = getContext();
+    mlir::RewritePatternSet patterns(&ctx);
+
+    numba::ntensor::populateFuseElementwisePatterns(patterns);
+
+    if (mlir::failed(mlir::applyPatternsAndFoldGreedily(getOperation(),
+                                                        std::move(patterns))))
+      signalPassFailure();
+  }
+};
+} // namespace
+
+void numba::ntensor::populateFuseElementwisePatterns(
+    mlir::RewritePatternSet &patterns) {
+  patterns.insert<FuseElementwiseOps>(patterns.getContext());
+}
+
+std::unique_ptr<mlir::Pass> numba::ntensor::createFuseElementwisePass() {
+  return std::make_unique<FuseElementwisePass>();
+}
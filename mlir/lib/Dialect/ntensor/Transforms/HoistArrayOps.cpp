@@ -0,0 +1,261 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Dialect/ntensor/Transforms/HoistArrayOps.hpp"
+
+#include "numba/Analysis/AliasAnalysis.hpp"
+#include "numba/Dialect/ntensor/IR/NTensorOps.hpp"
+
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/IR/Dominance.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
+#include <mlir/Interfaces/LoopLikeInterface.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+#include <mlir/Transforms/LoopInvariantCodeMotionUtils.h>
+
+#include <llvm/ADT/SetVector.h>
+
+/// Checks if op only reads its inputs and returns freshly allocated arrays.
+/// Such ops are skipped by the regular CSE and LICM because of allocations.
+static bool isPureArrayOp(mlir::Operation *op) {
+  if (!mlir::isa_and_nonnull<numba::ntensor::NTensorDialect>(op->getDialect()))
+    return false;
+
+  auto iface = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(op);
+  if (!iface || !mlir::isSpeculatable(op))
+    return false;
+
+  llvm::SmallVector<mlir::MemoryEffects::EffectInstance> effects;
+  iface.getEffects(effects);
+  bool allocates = false;
+  for (auto &effect : effects) {
+    auto val = effect.getValue();
+    if (!val)
+      return false;
+
+    if (mlir::isa<mlir::MemoryEffects::Allocate>(effect.getEffect()) &&
+        val.getDefiningOp() == op) {
+      allocates = true;
+      continue;
+    }
+
+    if (!mlir::isa<mlir::MemoryEffects::Read>(effect.getEffect()))
+      return false;
+  }
+
+  if (!allocates)
+    return false;
+
+  for (auto &region : op->getRegions())
+    for (auto &nested : region.getOps())
+      if (!mlir::isMemoryEffectFree(&nested))
+        return false;
+
+  return true;
+}
+
+static bool isScalarType(mlir::Type type) {
+  return type.isIntOrIndexOrFloat() || mlir::isa<mlir::ComplexType>(type);
+}
+
+namespace {
+/// Tracks arrays, which are not modified inside the function.
+class ImmutableArrays {
+public:
+  ImmutableArrays(mlir::Operation *func) : analysis(func) {
+    llvm::SmallVector<mlir::Value> args;
+    func->walk([&](mlir::Operation *op) {
+      args.clear();
+      if (numba::isWriter(*op, args))
+        writers.insert(args.begin(), args.end());
+    });
+  }
+
+  /// Value is not written by any op in the function, directly or through
+  /// aliases.
+  bool isNotWritten(mlir::Value val) {
+    auto type = val.getType();
+    if (isScalarType(type))
+      return true;
+
+    // Other values (e.g. tuples) can contain arrays, which are not tracked.
+    if (!mlir::isa<numba::ntensor::NTensorType, mlir::MemRefType,
+                   mlir::TensorType>(type))
+      return false;
+
+    return llvm::none_of(writers, [&](mlir::Value writer) {
+      return !analysis.alias(val, writer).isNo();
+    });
+  }
+
+  /// All uses of the freshly allocated array, directly or through the derived
+  /// values, only read it and it doesn't escape the function.
+  bool isOnlyRead(mlir::Value array) {
+    auto it = onlyRead.find(array);
+    if (it != onlyRead.end())
+      return it->second;
+
+    auto ret = isOnlyReadImpl(array);
+    onlyRead[array] = ret;
+    return ret;
+  }
+
+private:
+  numba::AliasAnalysis analysis;
+  llvm::SmallSetVector<mlir::Value, 8> writers;
+  llvm::DenseMap<mlir::Value, bool> onlyRead;
+
+  bool isOnlyReadImpl(mlir::Value array) {
+    llvm::SmallVector<mlir::Value> worklist;
+    llvm::SmallDenseSet<mlir::Value> visited;
+    worklist.emplace_back(array);
+    visited.insert(array);
+    llvm::SmallVector<mlir::MemoryEffects::EffectInstance> effects;
+    while (!worklist.empty()) {
+      auto val = worklist.pop_back_val();
+      for (auto user : val.getUsers()) {
+        // Yielded or returned values can be modified through the aliases.
+        if (user->hasTrait<mlir::OpTrait::IsTerminator>())
+          return false;
+
+        auto iface = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(user);
+        if (!iface)
+          return false;
+
+        effects.clear();
+        iface.getEffects(effects);
+        for (auto &effect : effects) {
+          if (!mlir::isa<mlir::MemoryEffects::Write,
+                         mlir::MemoryEffects::Free>(effect.getEffect()))
+            continue;
+
+          auto effectVal = effect.getValue();
+          if (!effectVal || effectVal == val)
+            return false;
+        }
+
+        // Results, which are not fresh allocations, can be views of the array.
+        for (auto res : user->getResults()) {
+          if (isScalarType(res.getType()) ||
+              iface.getEffectOnValue<mlir::MemoryEffects::Allocate>(res))
+            continue;
+
+          if (visited.insert(res).second)
+            worklist.emplace_back(res);
+        }
+      }
+    }
+    return true;
+  }
+};
+
+struct ArrayOpInfo : public llvm::DenseMapInfo<mlir::Operation *> {
+  static unsigned getHashValue(const mlir::Operation *opC) {
+    return static_cast<unsigned>(mlir::OperationEquivalence::computeHash(
+        const_cast<mlir::Operation *>(opC),
+        mlir::OperationEquivalence::directHashValue,
+        mlir::OperationEquivalence::ignoreHashValue,
+        mlir::OperationEquivalence::IgnoreLocations));
+  }
+  static bool isEqual(const mlir::Operation *lhsC,
+                      const mlir::Operation *rhsC) {
+    auto *lhs = const_cast<mlir::Operation *>(lhsC);
+    auto *rhs = const_cast<mlir::Operation *>(rhsC);
+    if (lhs == rhs)
+      return true;
+    if (lhs == getTombstoneKey() || lhs == getEmptyKey() ||
+        rhs == getTombstoneKey() || rhs == getEmptyKey())
+      return false;
+    return mlir::OperationEquivalence::isEquivalentTo(
+        lhs, rhs, mlir::OperationEquivalence::IgnoreLocations);
+  }
+};
+
+struct HoistArrayOpsPass
+    : public mlir::PassWrapper<HoistArrayOpsPass,
+                               mlir::InterfacePass<mlir::FunctionOpInterface>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(HoistArrayOpsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<numba::ntensor::NTensorDialect>();
+  }
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    ImmutableArrays arrays(func);
+
+    // Inputs must not change between original and new op positions and
+    // results must not be modified, as they are now shared between loop
+    // iterations or replaced ops users.
+    auto canMove = [&](mlir::Operation *op) -> bool {
+      if (!isPureArrayOp(op))
+        return false;
+
+      auto notWritten = [&](mlir::Value arg) {
+        return arrays.isNotWritten(arg);
+      };
+      auto onlyRead = [&](mlir::Value res) { return arrays.isOnlyRead(res); };
+      return llvm::all_of(op->getOperands(), notWritten) &&
+             llvm::all_of(op->getResults(), onlyRead);
+    };
+
+    bool changed = false;
+    func->walk([&](mlir::LoopLikeOpInterface loop) {
+      if (!mlir::isa<mlir::scf::ForOp, mlir::scf::WhileOp>(loop))
+        return;
+
+      auto isDefinedOutside = [&](mlir::Value value, mlir::Region *) {
+        return loop.isDefinedOutsideOfLoop(value);
+      };
+      auto shouldMove = [&](mlir::Operation *op, mlir::Region *) {
+        if (mlir::isMemoryEffectFree(op) && mlir::isSpeculatable(op))
+          return true;
+
+        return canMove(op);
+      };
+      auto moveOut = [&](mlir::Operation *op, mlir::Region *) {
+        loop.moveOutOfLoop(op);
+      };
+      if (mlir::moveLoopInvariantCode(loop.getLoopRegions(), isDefinedOutside,
+                                      shouldMove, moveOut) != 0)
+        changed = true;
+    });
+
+    mlir::DominanceInfo dom(func);
+    llvm::SmallDenseMap<mlir::Operation *, llvm::SmallVector<mlir::Operation *>,
+                        4, ArrayOpInfo>
+        candidates;
+    llvm::SmallVector<std::pair<mlir::Operation *, mlir::Operation *>>
+        toReplace;
+    func->walk<mlir::WalkOrder::PreOrder>([&](mlir::Operation *op) {
+      if (!canMove(op))
+        return;
+
+      auto &ops = candidates[op];
+      for (auto prev : ops) {
+        if (dom.properlyDominates(prev, op)) {
+          toReplace.emplace_back(op, prev);
+          return;
+        }
+      }
+      ops.emplace_back(op);
+    });
+
+    for (auto &&[op, prev] : toReplace) {
+      op->replaceAllUsesWith(prev);
+      op->erase();
+      changed = true;
+    }
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> numba::ntensor::createHoistArrayOpsPass() {
+  return std::make_unique<HoistArrayOpsPass>();
+}
@@ -68,6 +68,74 @@ llvm::StringRef numba::util::attributes::getVectorLengthName() {
   return "numba.vector_length";
 }
 
+llvm::StringRef numba::util::attributes::getVectorizedName() {
+  return "numba.vectorized";
+}
+
+llvm::StringRef numba::util::attributes::getParallelScheduleName() {
+  return "numba.parallel_schedule";
+}
+
+llvm::StringRef numba::util::attributes::getParallelGrainName() {
+  return "numba.parallel_grain";
+}
+
+llvm::StringRef numba::util::attributes::getParallelCostName() {
+  return "numba.parallel_cost";
+}
+
+llvm::StringRef numba::util::attributes::getParallelProfileName() {
+  return "numba.parallel_profile";
+}
+
+llvm::StringRef numba::util::attributes::getParallelRegionName() {
+  return "numba.parallel_region";
+}
+
+llvm::StringRef numba::util::attributes::getParallelBackendName() {
+  return "numba.parallel_backend";
+}
+
+llvm::StringRef numba::util::attributes::getDeterministicReduceName() {
+  return "numba.deterministic_reduce";
+}
+
+llvm::StringRef numba::util::attributes::getParforLoweredName() {
+  return "numba.parfor_lowered";
+}
+
+llvm::StringRef numba::util::attributes::getCudaThreadsPerBlockName() {
+  return "numba.cuda_threads_per_block";
+}
+
+llvm::StringRef numba::util::attributes::getCudaOccupancyLaunchName() {
+  return "numba.cuda_occupancy_launch";
+}
+
+llvm::StringRef numba::util::attributes::getAffineOptName() {
+  return "numba.affine_opt";
+}
+
+llvm::StringRef numba::util::attributes::getPrefetchName() {
+  return "numba.prefetch";
+}
+
+llvm::StringRef numba::util::attributes::getMemoryProfileName() {
+  return "numba.memory_profile";
+}
+
+llvm::StringRef numba::util::attributes::getPackBoolArraysName() {
+  return "numba.pack_bool_arrays";
+}
+
+llvm::StringRef numba::util::attributes::getNonatomicRefcountName() {
+  return "numba.nonatomic_refcnt";
+}
+
+llvm::StringRef numba::util::attributes::getSharedCalleeName() {
+  return "numba.shared_callee";
+}
+
 namespace numba {
 namespace util {
 
@@ -1385,6 +1453,147 @@ struct ChangeLayout1DReshape
   }
 };
 
+/// Tries to express reshape of the strided memref as a new strided view,
+/// following numpy `_attempt_nocopy_reshape`. Returns new strides or
+/// std::nullopt if new shape cannot be represented without copy.
+static std::optional<llvm::SmallVector<int64_t>>
+computeReshapeStrides(llvm::ArrayRef<int64_t> srcShape,
+                      llvm::ArrayRef<int64_t> srcStrides,
+                      llvm::ArrayRef<int64_t> dstShape) {
+  assert(srcShape.size() == srcStrides.size());
+  // Unit dims do not affect data layout.
+  llvm::SmallVector<int64_t> oldShape;
+  llvm::SmallVector<int64_t> oldStrides;
+  int64_t srcSize = 1;
+  for (auto &&[size, stride] : llvm::zip(srcShape, srcStrides)) {
+    srcSize *= size;
+    if (size == 1)
+      continue;
+
+    oldShape.emplace_back(size);
+    oldStrides.emplace_back(stride);
+  }
+
+  int64_t dstSize = 1;
+  for (auto size : dstShape)
+    dstSize *= size;
+
+  if (srcSize == 0 || srcSize != dstSize)
+    return std::nullopt;
+
+  auto oldRank = oldShape.size();
+  auto newRank = dstShape.size();
+  llvm::SmallVector<int64_t> newStrides(newRank, 1);
+  size_t oi = 0, oj = 1, ni = 0, nj = 1;
+  while (ni < newRank && oi < oldRank) {
+    auto newSize = dstShape[ni];
+    auto oldSize = oldShape[oi];
+    while (newSize != oldSize) {
+      if (newSize < oldSize) {
+        newSize *= dstShape[nj++];
+      } else {
+        oldSize *= oldShape[oj++];
+      }
+    }
+
+    // Source dims, merged into the single group, must be contiguous.
+    for (auto ok = oi; ok + 1 < oj; ++ok)
+      if (oldStrides[ok] != oldShape[ok + 1] * oldStrides[ok + 1])
+        return std::nullopt;
+
+    newStrides[nj - 1] = oldStrides[oj - 1];
+    for (auto nk = nj - 1; nk > ni; --nk)
+      newStrides[nk - 1] = newStrides[nk] * dstShape[nk];
+
+    ni = nj++;
+    oi = oj++;
+  }
+
+  // Remaining trailing dims are unit, their strides are arbitrary.
+  auto lastStride = (ni > 0 ? newStrides[ni - 1] : 1);
+  for (auto nk = ni; nk < newRank; ++nk)
+    newStrides[nk] = lastStride;
+
+  return newStrides;
+}
+
+/// Replaces reshape of the strided memref with the new strided view if
+/// memref layout allows this.
+///
+/// Example:
+/// %0 = numba_util.change_layout %arg : memref<4x8xf32, strided<[16, 1]>>
+///        to memref<4x8xf32>
+/// %1 = numba_util.reshape %0(%c4, %c2, %c4) : ...
+///
+/// Becomes:
+/// %0 = memref.reinterpret_cast %arg to offset: [0], sizes: [4, 2, 4],
+///        strides: [16, 4, 1]
+/// %1 = numba_util.change_layout %0
+struct ChangeLayoutReshape
+    : public mlir::OpRewritePattern<numba::util::ReshapeOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(numba::util::ReshapeOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto cl = op.getSource().getDefiningOp<numba::util::ChangeLayoutOp>();
+    if (!cl)
+      return mlir::failure();
+
+    auto dstType = mlir::dyn_cast<mlir::MemRefType>(op.getType());
+    if (!dstType || !dstType.getLayout().isIdentity())
+      return mlir::failure();
+
+    auto src = cl.getSource();
+    auto srcType = mlir::cast<mlir::MemRefType>(src.getType());
+    if (!srcType.hasStaticShape())
+      return mlir::failure();
+
+    int64_t offset;
+    llvm::SmallVector<int64_t> strides;
+    if (mlir::failed(mlir::getStridesAndOffset(srcType, strides, offset)) ||
+        llvm::any_of(strides, mlir::ShapedType::isDynamic))
+      return mlir::failure();
+
+    llvm::SmallVector<mlir::OpFoldResult> sizes = op.getShape();
+    llvm::SmallVector<int64_t> dstShape;
+    for (auto size : sizes) {
+      auto val = mlir::getConstantIntValue(size);
+      if (!val)
+        return mlir::failure();
+
+      dstShape.emplace_back(*val);
+    }
+
+    auto newStrides =
+        computeReshapeStrides(srcType.getShape(), strides, dstShape);
+    if (!newStrides)
+      return mlir::failure();
+
+    auto loc = op.getLoc();
+    mlir::OpFoldResult newOffset = rewriter.getIndexAttr(offset);
+    if (mlir::ShapedType::isDynamic(offset))
+      newOffset =
+          rewriter.create<mlir::memref::ExtractStridedMetadataOp>(loc, src)
+              .getOffset();
+
+    for (auto &&[i, size] : llvm::enumerate(dstType.getShape()))
+      if (!mlir::ShapedType::isDynamic(size))
+        sizes[i] = rewriter.getIndexAttr(size);
+
+    auto ctx = rewriter.getContext();
+    auto newStridesVals = mlir::getAsIndexOpFoldResult(ctx, *newStrides);
+    auto layout = mlir::StridedLayoutAttr::get(ctx, offset, *newStrides);
+    auto viewType =
+        mlir::MemRefType::get(dstType.getShape(), dstType.getElementType(),
+                              layout, dstType.getMemorySpace());
+    mlir::Value view = rewriter.create<mlir::memref::ReinterpretCastOp>(
+        loc, viewType, src, newOffset, sizes, newStridesVals);
+    rewriter.replaceOpWithNewOp<numba::util::ChangeLayoutOp>(op, dstType, view);
+    return mlir::success();
+  }
+};
+
 struct ChangeLayoutSliceGetItem
     : public mlir::OpRewritePattern<plier::SliceGetItemOp> {
   using OpRewritePattern::OpRewritePattern;
@@ -1619,8 +1828,9 @@ void ChangeLayoutOp::getCanonicalizationPatterns(
                  ChangeLayoutLinalgGeneric, ChangeLayoutLinalgFill,
                  ChangeLayoutIf, ChangeLayoutFor, ChangeLayoutWhileBefore,
                  ChangeLayoutWhileAfter, ChangeLayoutWhileInit,
-                 ChangeLayout1DReshape, ChangeLayoutSliceGetItem,
-                 ChangeLayoutCopy, ChangeLayoutExpandShape, ChangeLayoutSelect,
+                 ChangeLayout1DReshape, ChangeLayoutReshape,
+                 ChangeLayoutSliceGetItem, ChangeLayoutCopy,
+                 ChangeLayoutExpandShape, ChangeLayoutSelect,
                  ChangeLayoutEnvRegion, ChangeLayoutAtomicRMW>(context);
 }
 
@@ -2295,6 +2505,7 @@ struct EnvRegionPropagateOutsideValues
     auto newOp = rewriter.create<EnvironmentRegionOp>(
         op->getLoc(), newYieldArgsRange.getTypes(), op.getEnvironment(),
         op.getArgs());
+    newOp->setDiscardableAttrs(op->getDiscardableAttrDictionary());
     mlir::Region &newRegion = newOp.getRegion();
     rewriter.inlineRegionBefore(op.getRegion(), newRegion, newRegion.end());
     {
@@ -2320,7 +2531,8 @@ struct EnvRegionPropagateOutsideValues
   }
 };
 
-/// Merge nested env region if parent have same environment and args.
+/// Merge nested env region if parent have same environment, args and
+/// attributes.
 struct MergeNestedEnvRegion
     : public mlir::OpRewritePattern<EnvironmentRegionOp> {
   using OpRewritePattern::OpRewritePattern;
@@ -2333,7 +2545,9 @@ struct MergeNestedEnvRegion
       return mlir::failure();
 
     if (parent.getEnvironment() != op.getEnvironment() ||
-        parent.getArgs() != op.getArgs())
+        parent.getArgs() != op.getArgs() ||
+        parent->getDiscardableAttrDictionary() !=
+            op->getDiscardableAttrDictionary())
       return mlir::failure();
 
     EnvironmentRegionOp::inlineIntoParent(rewriter, op);
@@ -2391,6 +2605,7 @@ struct CleanupRegionYieldArgs
     auto newOp = rewriter.create<EnvironmentRegionOp>(
         op->getLoc(), newYieldArgsRange.getTypes(), op.getEnvironment(),
         op.getArgs());
+    newOp->setDiscardableAttrs(op->getDiscardableAttrDictionary());
     mlir::Region &newRegion = newOp.getRegion();
     rewriter.inlineRegionBefore(op.getRegion(), newRegion, newRegion.end());
     {
@@ -2413,7 +2628,7 @@ struct CleanupRegionYieldArgs
   }
 };
 
-/// Merge adjacent env regions.
+/// Merge adjacent env regions with same environment, args and attributes.
 struct MergeAdjacentRegions
     : public mlir::OpRewritePattern<EnvironmentRegionOp> {
   using OpRewritePattern::OpRewritePattern;
@@ -2429,7 +2644,9 @@ struct MergeAdjacentRegions
       return mlir::failure();
 
     if (nextOp.getEnvironment() != op.getEnvironment() ||
-        nextOp.getArgs() != op.getArgs())
+        nextOp.getArgs() != op.getArgs() ||
+        nextOp->getDiscardableAttrDictionary() !=
+            op->getDiscardableAttrDictionary())
       return mlir::failure();
 
     mlir::Block *body = &op.getRegion().front();
@@ -2478,6 +2695,7 @@ struct MergeAdjacentRegions
     auto newOp = rewriter.create<EnvironmentRegionOp>(
         op->getLoc(), newYieldArgsRange.getTypes(), op.getEnvironment(),
         op.getArgs());
+    newOp->setDiscardableAttrs(op->getDiscardableAttrDictionary());
     mlir::Region &newRegion = newOp.getRegion();
     rewriter.inlineRegionBefore(op.getRegion(), newRegion, newRegion.end());
 
@@ -2553,6 +2771,31 @@ mlir::LogicalResult MemrefBitcastOp::verify() {
 
   auto srcElem = srcType.getElementType();
   auto dstElem = dstType.getElementType();
+
+  // Complex memref can be viewed as memref of interleaved real and imaginary
+  // parts with doubled innermost dimension.
+  if (auto complexType = mlir::dyn_cast<mlir::ComplexType>(srcElem)) {
+    if (complexType.getElementType() != dstElem)
+      return emitError("Bitcast complex element type mismatch.");
+    if (!srcType.getLayout().isIdentity())
+      return emitError("Bitcast of complex memref requires identity layout.");
+
+    auto srcShape = srcType.getShape();
+    auto dstShape = dstType.getShape();
+    if (srcShape.empty() || srcShape.size() != dstShape.size() ||
+        srcShape.drop_back() != dstShape.drop_back())
+      return emitError("Bitcast complex shape mismatch.");
+
+    auto srcLast = srcShape.back();
+    auto dstLast = dstShape.back();
+    if (mlir::ShapedType::isDynamic(srcLast) !=
+            mlir::ShapedType::isDynamic(dstLast) ||
+        (!mlir::ShapedType::isDynamic(srcLast) && dstLast != srcLast * 2))
+      return emitError("Bitcast complex innermost dimension mismatch.");
+
+    return mlir::success();
+  }
+
   if (srcElem.isIntOrFloat() && dstElem.isIntOrFloat() &&
       srcElem.getIntOrFloatBitWidth() != dstElem.getIntOrFloatBitWidth())
     return emitError("Bitcast element size mismatch.");
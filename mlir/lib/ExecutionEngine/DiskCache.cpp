@@ -0,0 +1,98 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/ExecutionEngine/DiskCache.hpp"
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/Twine.h>
+#include <llvm/Support/Debug.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Support/raw_ostream.h>
+
+#define DEBUG_TYPE "numba-disk-cache"
+
+numba::DiskCache::DiskCache(llvm::StringRef dir, uint64_t maxSize,
+                            llvm::StringRef extension)
+    : cacheDir(dir.str()), ext(extension.str()) {
+  policy.Interval = std::chrono::seconds(0);
+  policy.Expiration = std::chrono::seconds(0);
+  policy.MaxSizeBytes = maxSize;
+  // Errors are ignored, entries just won't be stored.
+  if (auto err = llvm::sys::fs::create_directories(cacheDir))
+    LLVM_DEBUG(llvm::dbgs() << "Failed to create cache dir " << cacheDir
+                            << ": " << err.message() << "\n");
+}
+
+std::string numba::DiskCache::getKey(llvm::ArrayRef<llvm::StringRef> parts) {
+  llvm::SHA256 hasher;
+  for (auto part : parts) {
+    hasher.update(part);
+    hasher.update(llvm::StringRef("\0", 1));
+  }
+  return llvm::toHex(hasher.result(), /*LowerCase*/ true);
+}
+
+std::unique_ptr<llvm::MemoryBuffer>
+numba::DiskCache::load(llvm::StringRef key, bool requiresNullTerminator) {
+  auto path = getPath(key);
+  int fd;
+  if (llvm::sys::fs::openFileForRead(path, fd)) {
+    LLVM_DEBUG(llvm::dbgs() << "No entry for " << key << " in cache\n");
+    return nullptr;
+  }
+
+  // Large entries without null terminator are mapped read-only instead of
+  // copied and processes, loading the same entry, share its pages.
+  auto buffer = llvm::MemoryBuffer::getOpenFile(fd, path, /*FileSize*/ -1,
+                                                requiresNullTerminator);
+
+  // Update access time, so pruning will evict least recently used entries.
+  (void)llvm::sys::fs::setLastAccessAndModificationTime(
+      fd, std::chrono::system_clock::now());
+  (void)llvm::sys::fs::closeFile(fd);
+  if (!buffer)
+    return nullptr;
+
+  LLVM_DEBUG(llvm::dbgs() << "Entry for " << key << " loaded from cache\n");
+  return std::move(*buffer);
+}
+
+void numba::DiskCache::store(llvm::StringRef key, llvm::StringRef data) {
+  auto temp = llvm::sys::fs::TempFile::create(llvm::Twine(cacheDir) +
+                                              "/tmp-%%%%%%%%%%%%" + ext);
+  if (!temp) {
+    llvm::consumeError(temp.takeError());
+    return;
+  }
+
+  {
+    llvm::raw_fd_ostream os(temp->FD, /*shouldClose*/ false);
+    os << data;
+  }
+
+  if (auto err = temp->keep(getPath(key))) {
+    llvm::consumeError(std::move(err));
+    llvm::consumeError(temp->discard());
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(pruneMutex);
+  llvm::pruneCache(cacheDir, policy);
+}
+
+void numba::DiskCache::remove(llvm::StringRef key) {
+  LLVM_DEBUG(llvm::dbgs() << "Removing cache entry " << key << "\n");
+  (void)llvm::sys::fs::remove(getPath(key));
+}
+
+std::string numba::DiskCache::getPath(llvm::StringRef key) const {
+  llvm::SmallString<128> path(cacheDir);
+  // pruneCache only considers files with `llvmcache-` prefix.
+  llvm::sys::path::append(path, llvm::Twine("llvmcache-") + key + ext);
+  return path.str().str();
+}
@@ -4,26 +4,41 @@
 
 #include "numba/ExecutionEngine/ExecutionEngine.hpp"
 
+#include "numba/Compiler/CompileProfile.hpp"
+#include "numba/ExecutionEngine/DiskCache.hpp"
+
+#include <llvm/ADT/Any.h>
 #include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/DenseMap.h>
 #include <llvm/ADT/GraphTraits.h>
+#include <llvm/ADT/ScopeExit.h>
 #include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
 #include <llvm/ADT/iterator.h>
 #include <llvm/ADT/iterator_range.h>
 #include <llvm/Analysis/AssumptionCache.h>
-#include <llvm/Analysis/LoopNestAnalysis.h>
 #include <llvm/Analysis/LoopPass.h>
 #include <llvm/Analysis/MemorySSAUpdater.h>
-#include <llvm/Analysis/ScalarEvolution.h>
 #include <llvm/Analysis/TargetLibraryInfo.h>
 #include <llvm/Analysis/TargetTransformInfo.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/CodeGen/ReplaceWithVeclib.h>
 #include <llvm/ExecutionEngine/JITEventListener.h>
 #include <llvm/ExecutionEngine/JITSymbol.h>
 #include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/ExecutionEngine/Orc/DebugObjectManagerPlugin.h>
+#include <llvm/ExecutionEngine/Orc/EPCDebugObjectRegistrar.h>
+#include <llvm/ExecutionEngine/Orc/EPCEHFrameRegistrar.h>
 #include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
 #include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
 #include <llvm/ExecutionEngine/Orc/IRTransformLayer.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/MapperJITLinkMemoryManager.h>
+#include <llvm/ExecutionEngine/Orc/MemoryMapper.h>
+#include <llvm/ExecutionEngine/Orc/ObjectLinkingLayer.h>
 #include <llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h>
 #include <llvm/ExecutionEngine/Orc/Shared/ExecutorAddress.h>
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
@@ -32,9 +47,13 @@
 #include <llvm/IR/Function.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Instruction.h>
+#include <llvm/IR/InstIterator.h>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/IntrinsicInst.h>
+#include <llvm/IR/Intrinsics.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Metadata.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
@@ -45,11 +64,16 @@
 #include <llvm/Passes/PassBuilder.h>
 #include <llvm/Passes/PassPlugin.h>
 #include <llvm/Support/Debug.h>
+#include <llvm/Support/FileSystem.h>
 #include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
 #include <llvm/Support/ToolOutputFile.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
+#include <llvm/TargetParser/Host.h>
+#include <llvm/TargetParser/SubtargetFeature.h>
 #include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <llvm/Transforms/Utils/LoopUtils.h>
 #include <llvm/Transforms/Utils/TapirUtils.h>
 #include <llvm/Transforms/Utils/ValueMapper.h>
 
@@ -63,15 +87,78 @@
 #include <llvm/Passes/PassPlugin.h>
 #include <llvm/Passes/StandardInstrumentations.h>
 
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <dlfcn.h>
+#include <future>
 #include <iterator>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #define DEBUG_TYPE "numba-execution-engine"
 
+static llvm::TapirTargetID getTapirTargetID(numba::TapirTarget target) {
+  switch (target) {
+  case numba::TapirTarget::None:
+    return llvm::TapirTargetID::None;
+  case numba::TapirTarget::OpenCilk:
+    return llvm::TapirTargetID::OpenCilk;
+  case numba::TapirTarget::Cuda:
+    return llvm::TapirTargetID::Cuda;
+  }
+  llvm_unreachable("Invalid tapir target");
+}
+
+static llvm::StringRef getTapirTargetName(numba::TapirTarget target) {
+  switch (target) {
+  case numba::TapirTarget::None:
+    return "none";
+  case numba::TapirTarget::OpenCilk:
+    return "opencilk";
+  case numba::TapirTarget::Cuda:
+    return "cuda";
+  }
+  llvm_unreachable("Invalid tapir target");
+}
+
+static llvm::TargetLibraryInfoImpl::VectorLibrary
+getVectorLibraryID(numba::VectorLibrary lib) {
+  switch (lib) {
+  case numba::VectorLibrary::None:
+    return llvm::TargetLibraryInfoImpl::NoLibrary;
+  case numba::VectorLibrary::SVML:
+    return llvm::TargetLibraryInfoImpl::SVML;
+  case numba::VectorLibrary::LIBMVEC:
+    return llvm::TargetLibraryInfoImpl::LIBMVEC_X86;
+  case numba::VectorLibrary::SLEEF:
+    return llvm::TargetLibraryInfoImpl::SLEEFGNUABI;
+  }
+  llvm_unreachable("Invalid vector library");
+}
+
+static llvm::StringRef getVectorLibraryName(numba::VectorLibrary lib) {
+  switch (lib) {
+  case numba::VectorLibrary::None:
+    return "none";
+  case numba::VectorLibrary::SVML:
+    return "svml";
+  case numba::VectorLibrary::LIBMVEC:
+    return "libmvec";
+  case numba::VectorLibrary::SLEEF:
+    return "sleef";
+  }
+  llvm_unreachable("Invalid vector library");
+}
+
 static llvm::OptimizationLevel mapToLevel(llvm::CodeGenOptLevel level) {
   unsigned optimizeSize = 0; // TODO: unhardcode
 
@@ -117,201 +204,253 @@ getPipelineTuningOptions(llvm::CodeGenOptLevel optLevelVal) {
 }
 
 namespace llvm {
-struct tapirifyLoopPass : PassInfoMixin<tapirifyLoopPass> {
-  bool splitLoop(Loop *l, Function &f, ScalarEvolution &se) {
-    BasicBlock *header = l->getHeader();
-    Module *m = f.getParent();
-    LLVMContext &context = m->getContext();
+/// Marker function for parallel loops of functions with Tapir parallel
+/// backend. Must be kept in sync with `LowerToLlvm.cpp`.
+static constexpr StringLiteral TapirParallelForName("numba_tapir_parallel_for");
+
+/// Expands `numba_tapir_parallel_for(ranges, numLoops, func, ctx, grain,
+/// threadsPerBlock, occupancyLaunch)` calls, emitted from
+/// `numba_util.parallel` ops, into Tapir loops. Outermost dimension is spawned
+/// one iteration per task, inner dimensions are passed to `func` as a whole.
+/// In serial mode `func` is called once for the entire range instead.
+///
+/// For the CUDA target launch hints are passed to the Kitsune runtime right
+/// before the loop. Runtime keeps them until the next update, so loops without
+/// hints reuse the last ones.
+struct expandTapirParallelForPass
+    : PassInfoMixin<expandTapirParallelForPass> {
+  expandTapirParallelForPass(TapirTargetID target, bool serial)
+      : target(target), serial(serial) {}
+
+  PreservedAnalyses run(Module &m, ModuleAnalysisManager &am) {
+    auto *marker = m.getFunction(TapirParallelForName);
+    if (!marker)
+      return PreservedAnalyses::all();
+
+    SmallVector<CallInst *> calls;
+    for (auto *user : marker->users())
+      if (auto *call = dyn_cast<CallInst>(user))
+        if (call->getCalledOperand() == marker)
+          calls.push_back(call);
+
+    for (auto *call : calls)
+      expand(call);
+
+    if (marker->use_empty())
+      marker->eraseFromParent();
 
-    // create list of all phi nodes in the loops header block. one of these
-    // should be the loop induction variable
-    SmallVector<PHINode *> PHICandidates;
-    for (PHINode &pn : header->phis()) {
-      if (pn.getNumIncomingValues() == 2) {
-        for (uint i = 0; i < 2; i++) {
-          if (ConstantInt *CI = dyn_cast<ConstantInt>(pn.getIncomingValue(i))) {
-            // if one of the incoming values is 0, the PHI is potentially the
-            // loop induction variable
-            if (CI->isZero()) {
-              PHICandidates.push_back(&pn);
-            }
-          }
-        }
-      }
-    }
+    return PreservedAnalyses::none();
+  }
 
-    // look at the scaler evolution of each phi node add see if it is add rec
-    // with a constant of one, which would mean it is a canonical induction
-    // variable
-    PHINode *canonInduct = nullptr;
-    for (PHINode *pn : PHICandidates) {
-      const SCEV *phiSCEV = se.getSCEV(pn);
-      if (const SCEVAddRecExpr *ARSCEV = dyn_cast<SCEVAddRecExpr>(phiSCEV)) {
-        const SCEV *stepSCEV = ARSCEV->getStepRecurrence(se);
-        if (const SCEVConstant *constSCEV = dyn_cast<SCEVConstant>(stepSCEV)) {
-          ConstantInt *stepVal = constSCEV->getValue();
-          if (stepVal->isOne()) {
-            canonInduct = pn;
-          }
-        }
-      }
-    }
-    if (!canonInduct) {
-      return false;
-    }
-
-    // if a canonical induction variable is found, it is fine to 'tapirify' and
-    // the loops body can be sepearted from the loop into a tapir region. the
-    // phi nodes and increment, compare, and branch instructions that define the
-    // loop must be outside the tapir region
-
-    // first the increment instruction is found
-    BasicBlock *exit = l->getExitBlock();
-    Instruction *increment = nullptr;
-    for (Use &use : canonInduct->uses()) {
-      auto *user = use.getUser();
-      Instruction *userI = dyn_cast<Instruction>(user);
-      if (userI->getOpcode() == Instruction::Add) {
-        // check if either operand is a ConstantInt of value 1
-        for (uint i = 0; i < 2; i++) {
-          if (auto *opVal = dyn_cast<ConstantInt>(userI->getOperand(i))) {
-            if (opVal->getSExtValue() == 1) {
-              increment = userI;
-            }
-          }
-        }
-      }
-    }
-    if (!increment) {
-      return false;
-    }
+  static bool isRequired() { return true; }
 
-    // find compare instruction that uses the increment instruction
-    Instruction *icmp = nullptr;
-    for (Use &use : increment->uses()) {
-      if (auto *userI = dyn_cast<ICmpInst>(use.getUser())) {
-        icmp = userI;
-      }
-    }
-    if (!icmp) {
-      return false;
+private:
+  TapirTargetID target;
+  bool serial;
+
+  void expand(CallInst *call) {
+    Function &f = *call->getFunction();
+    LLVMContext &context = f.getContext();
+    Value *ranges = call->getArgOperand(0);
+    // Number of loops is always a constant, generated by the compiler.
+    auto numLoops =
+        cast<ConstantInt>(call->getArgOperand(1))->getZExtValue();
+    Value *func = call->getArgOperand(2);
+    Value *ctx = call->getArgOperand(3);
+    auto *grain = dyn_cast<ConstantInt>(call->getArgOperand(4));
+    auto *threadsPerBlock = dyn_cast<ConstantInt>(call->getArgOperand(5));
+    auto *occupancyLaunch = dyn_cast<ConstantInt>(call->getArgOperand(6));
+
+    auto *indexTy = call->getArgOperand(1)->getType();
+    auto *inputRangeTy = StructType::get(context, {indexTy, indexTy, indexTy});
+    auto *rangeTy = StructType::get(context, {indexTy, indexTy});
+    auto *funcTy = FunctionType::get(
+        Type::getVoidTy(context), {ranges->getType(), indexTy, ctx->getType()},
+        false);
+    auto *zero = ConstantInt::get(indexTy, 0);
+    auto *one = ConstantInt::get(indexTy, 1);
+    auto *numLoopsVal = ConstantInt::get(indexTy, numLoops);
+
+    BasicBlock *pre = call->getParent();
+    BasicBlock *cont = pre->splitBasicBlock(call, "pfor.cont");
+    pre->getTerminator()->eraseFromParent();
+
+    IRBuilder<> builder(pre);
+    SmallVector<Value *> lower, upper, step;
+    for (unsigned i = 0; i < numLoops; ++i) {
+      auto load = [&](unsigned field) {
+        auto *ptr =
+            builder.CreateConstInBoundsGEP2_32(inputRangeTy, ranges, i, field);
+        return builder.CreateLoad(indexTy, ptr);
+      };
+      lower.push_back(load(0));
+      upper.push_back(load(1));
+      step.push_back(load(2));
     }
 
-    // find branch instruction that uses compare instruction
-    Instruction *branch = nullptr;
-    for (Use &use : icmp->uses()) {
-      if (auto *userI = dyn_cast<BranchInst>(use.getUser())) {
-        branch = userI;
-      }
-    }
-    if (!branch) {
-      return false;
+    auto storeRange = [&](Value *outRanges, unsigned i, Value *begin,
+                          Value *end) {
+      builder.CreateStore(
+          begin, builder.CreateConstInBoundsGEP2_32(rangeTy, outRanges, i, 0));
+      builder.CreateStore(
+          end, builder.CreateConstInBoundsGEP2_32(rangeTy, outRanges, i, 1));
+    };
+
+    if (serial) {
+      Value *outRanges = [&]() {
+        IRBuilder<> allocaBuilder(&*f.getEntryBlock().getFirstInsertionPt());
+        return allocaBuilder.CreateAlloca(rangeTy, numLoopsVal);
+      }();
+      for (unsigned i = 0; i < numLoops; ++i)
+        storeRange(outRanges, i, lower[i], upper[i]);
+
+      builder.CreateCall(funcTy, func, {outRanges, zero, ctx});
+      builder.CreateBr(cont);
+      call->eraseFromParent();
+      return;
     }
 
-    // now we need to split the blocks so that we can add in the tapir
-    // instructions
-    Instruction *firstSplitPoint;
-    Instruction *secondSplitPoint;
+    if (target == TapirTargetID::Cuda)
+      setLaunchHints(builder, threadsPerBlock, occupancyLaunch);
+
+    // Same iterations count computation as in the runtime.
+    Value *count = builder.CreateSDiv(
+        builder.CreateSub(
+            builder.CreateAdd(builder.CreateSub(upper[0], lower[0]), step[0]),
+            one),
+        step[0]);
+
+    Value *syncReg = [&]() {
+      IRBuilder<> entryBuilder(&*f.getEntryBlock().getFirstInsertionPt());
+      return entryBuilder.CreateCall(
+          Intrinsic::getDeclaration(f.getParent(),
+                                    Intrinsic::syncregion_start),
+          {}, "syncreg");
+    }();
+
+    auto *preheader =
+        BasicBlock::Create(context, "pfor.preheader", &f, cont);
+    auto *header = BasicBlock::Create(context, "pfor.header", &f, cont);
+    auto *body = BasicBlock::Create(context, "pfor.body", &f, cont);
+    auto *latch = BasicBlock::Create(context, "pfor.latch", &f, cont);
+    auto *exit = BasicBlock::Create(context, "pfor.exit", &f, cont);
+
+    builder.CreateCondBr(builder.CreateICmpSGT(count, zero), preheader, cont);
+
+    builder.SetInsertPoint(preheader);
+    builder.CreateBr(header);
+
+    builder.SetInsertPoint(header);
+    auto *iv = builder.CreatePHI(indexTy, 2, "pfor.iv");
+    iv->addIncoming(zero, preheader);
+    DetachInst::Create(body, latch, syncReg, header);
+
+    // Ranges are task-local, so they are allocated at the task entry.
+    builder.SetInsertPoint(body);
+    Value *outRanges = builder.CreateAlloca(rangeTy, numLoopsVal);
+    Value *begin = builder.CreateAdd(lower[0], builder.CreateMul(iv, step[0]));
+    Value *end = builder.CreateAdd(begin, step[0]);
+    storeRange(outRanges, 0, begin, end);
+    for (unsigned i = 1; i < numLoops; ++i)
+      storeRange(outRanges, i, lower[i], upper[i]);
+
+    builder.CreateCall(funcTy, func, {outRanges, zero, ctx});
+    ReattachInst::Create(latch, syncReg, body);
+
+    builder.SetInsertPoint(latch);
+    Value *next = builder.CreateAdd(iv, one, "pfor.iv.next", /*HasNUW*/ true,
+                                    /*HasNSW*/ true);
+    iv->addIncoming(next, latch);
+    auto *branch =
+        builder.CreateCondBr(builder.CreateICmpSLT(next, count), header, exit);
+    branch->setMetadata("llvm.loop", getLoopMD(context, grain));
+
+    SyncInst::Create(cont, syncReg, exit);
+    call->eraseFromParent();
+
+    LLVM_DEBUG(dbgs() << "Tapir loop generated in " << f.getName() << "\n");
+  }
 
-    // if increment comes before loop body, split points end up being
-    // slightly different
-    if (increment->getNextNonDebugInstruction() == icmp) {
-      firstSplitPoint = header->getFirstNonPHI();
-      secondSplitPoint = increment;
-    } else {
-      firstSplitPoint = increment->getNextNonDebugInstruction();
-      secondSplitPoint = icmp;
-    }
-    if (!firstSplitPoint || !secondSplitPoint) {
-      return false;
-    }
-
-    // splitting at the first split point
-    BasicBlock *parent1 = firstSplitPoint->getParent();
-    BasicBlock *body = parent1->splitBasicBlock(firstSplitPoint, "body", false);
-    if (body == nullptr) {
-      return false;
-    }
-
-    auto *parent2 = secondSplitPoint->getParent();
-    BasicBlock *latch =
-        parent2->splitBasicBlock(secondSplitPoint, "latch", false);
-    if (latch == nullptr) {
-      return false;
-    }
-
-    // add in tapir instructions
-    // creating sync region
-    FunctionType *syncType =
-        FunctionType::get(Type::getTokenTy(context), {}, false);
-    FunctionCallee syncStart =
-        m->getOrInsertFunction("llvm.syncregion.start", syncType);
-    BasicBlock &entry = f.getEntryBlock();
-    Instruction *insertPoint = entry.getFirstNonPHI();
-    auto *syncRegInst = CallInst::Create(syncStart, {}, "syncreg", insertPoint);
-    syncRegInst->setTailCall();
-
-    // add detach to block that preceeds the first split point
-    BasicBlock *detachBlock = parent1;
-    Instruction *detachTerm = detachBlock->getTerminator();
-    detachTerm->eraseFromParent();
-    DetachInst::Create(body, latch, syncRegInst, detachBlock);
-
-    // add in reattach to block that preceeds the second split point
-    BasicBlock *latchPred = parent2;
-    Instruction *bodyTerm = latchPred->getTerminator();
-    bodyTerm->eraseFromParent();
-    ReattachInst::Create(latch, syncRegInst, latchPred);
-
-    // add sync inst to block that the latch exits to
-    for (unsigned i = 0; i < branch->getNumOperands(); i++) {
-      Value *op = branch->getOperand(i);
-      if (isa<BasicBlock>(op) && op == exit) {
-        BasicBlock *newExit = BasicBlock::Create(context, "newexit", &f);
-        SyncInst::Create(exit, syncRegInst, newExit);
-        branch->setOperand(i, newExit);
-        exit->replacePhiUsesWith(branch->getParent(), newExit);
-      }
+  static void setLaunchHints(IRBuilder<> &builder, ConstantInt *threads,
+                             ConstantInt *occupancy) {
+    Module *m = builder.GetInsertBlock()->getModule();
+    LLVMContext &context = m->getContext();
+    auto *voidTy = Type::getVoidTy(context);
+    if (threads && threads->getSExtValue() > 0) {
+      auto *int32Ty = Type::getInt32Ty(context);
+      auto callee = m->getOrInsertFunction(
+          "__kitcuda_set_default_threads_per_blk",
+          FunctionType::get(voidTy, int32Ty, false));
+      builder.CreateCall(callee,
+                         ConstantInt::get(int32Ty, threads->getZExtValue()));
     }
-
-    // add neccessary tapir metadata to the loop
-    auto *Int32Ty = Type::getInt32Ty(context);
-    auto *branchMD = MDNode::getDistinct(context, {});
-    auto *tapirSpawnStrat = MDNode::get(
-        context, {MDString::get(context, "tapir.loop.spawn.strategy"),
-                  ConstantAsMetadata::get(ConstantInt::get(
-                      Int32Ty, TapirLoopHints::SpawningStrategy::ST_DAC))});
-    MDNode *targetID;
-    const char* tapirTarget = std::getenv("NM_TAPIRTARGET");
-    if (strcmp(tapirTarget, "opencilk") == 0) {
-      targetID = MDNode::get(context, {MDString::get(context, "tapir.loop.target"), ConstantAsMetadata::get(ConstantInt::get(Int32Ty, (uint64_t) TapirTargetID::OpenCilk))});
-    } else {
-      targetID = MDNode::get(context, {MDString::get(context, "tapir.loop.target"), ConstantAsMetadata::get(ConstantInt::get(Int32Ty, (uint64_t) TapirTargetID::Cuda))});
+    if (occupancy && occupancy->getSExtValue() >= 0) {
+      auto *boolTy = Type::getInt1Ty(context);
+      auto callee = m->getOrInsertFunction(
+          "__kitcuda_use_occupancy_launch",
+          FunctionType::get(voidTy, boolTy, false));
+      auto *c = builder.CreateCall(
+          callee, ConstantInt::get(boolTy, !occupancy->isZero()));
+      c->addParamAttr(0, Attribute::ZExt);
     }
+  }
 
-    branchMD->push_back(branchMD);
-    branchMD->push_back(tapirSpawnStrat);
-    branchMD->push_back(targetID);
-
-    branch->setMetadata("llvm.loop", branchMD);
-    return true;
+  MDNode *getLoopMD(LLVMContext &context, ConstantInt *grain) const {
+    auto *int32Ty = Type::getInt32Ty(context);
+    auto getHint = [&](StringRef name, uint64_t val) {
+      return MDNode::get(context,
+                         {MDString::get(context, name),
+                          ConstantAsMetadata::get(
+                              ConstantInt::get(int32Ty, val))});
+    };
+
+    SmallVector<Metadata *> ops;
+    ops.push_back(nullptr); // Self reference.
+    ops.push_back(getHint("tapir.loop.spawn.strategy",
+                          TapirLoopHints::SpawningStrategy::ST_DAC));
+    ops.push_back(getHint("tapir.loop.target", static_cast<uint64_t>(target)));
+    // Without hint grainsize is selected by Tapir.
+    if (grain && grain->getSExtValue() > 0)
+      ops.push_back(getHint("tapir.loop.grainsize", grain->getZExtValue()));
+
+    auto *md = MDNode::getDistinct(context, ops);
+    md->replaceOperandWith(0, md);
+    return md;
   }
+};
 
-  PreservedAnalyses run(Function &f, FunctionAnalysisManager &am) {
-    auto &li = am.getResult<LoopAnalysis>(f);
-    auto &se = am.getResult<ScalarEvolutionAnalysis>(f);
-    for (auto l : li) {
-      LoopNest ln(*l, se);
-      int numNested = (int)ln.getNumLoops();
-      for (int i = numNested - 1; i >= 0; i--) {
-        auto *nestedLoop = ln.getLoop(i);
-        if (splitLoop(nestedLoop, f, se)) {
-          // if splitLoop returns true, one of the loops in the loop nest has
-          // been tapirified, and we cannot tapirify any of the outer loops
-          break;
-        }
-      }
+/// Marker function for loops, vectorized by MLIR `SCFVectorizePass`. Must be
+/// kept in sync with `LowerToLlvm.cpp`.
+static constexpr StringLiteral VectorizedLoopName("numba_vectorized_loop");
+
+/// Disables LLVM vectorization of the innermost loops, containing
+/// `numba_vectorized_loop()` calls, and removes the calls. Must run before
+/// any other pass, so calls don't block the optimizations.
+struct markVectorizedLoopsPass : PassInfoMixin<markVectorizedLoopsPass> {
+  PreservedAnalyses run(Module &m, ModuleAnalysisManager &am) {
+    auto *marker = m.getFunction(VectorizedLoopName);
+    if (!marker)
+      return PreservedAnalyses::all();
+
+    auto &fam =
+        am.getResult<FunctionAnalysisManagerModuleProxy>(m).getManager();
+    SmallVector<CallInst *> calls;
+    for (auto *user : marker->users())
+      if (auto *call = dyn_cast<CallInst>(user))
+        if (call->getCalledOperand() == marker)
+          calls.push_back(call);
+
+    for (auto *call : calls) {
+      auto &loops = fam.getResult<LoopAnalysis>(*call->getFunction());
+      if (auto *loop = loops.getLoopFor(call->getParent()))
+        addStringMetadataToLoop(loop, "llvm.loop.vectorize.enable", 0);
+
+      call->eraseFromParent();
     }
+
+    if (marker->use_empty())
+      marker->eraseFromParent();
+
     return PreservedAnalyses::none();
   }
 
@@ -319,6 +458,8 @@ struct tapirifyLoopPass : PassInfoMixin<tapirifyLoopPass> {
 };
 
 struct replaceNRTAllocPass : PassInfoMixin<replaceNRTAllocPass> {
+  replaceNRTAllocPass(TapirTargetID target) : target(target) {}
+
   PreservedAnalyses run(Function &f, FunctionAnalysisManager &am) {
     Module *m = f.getParent();
     SmallVector<CallInst *> replaceList;
@@ -340,8 +481,7 @@ struct replaceNRTAllocPass : PassInfoMixin<replaceNRTAllocPass> {
       // replace call
       FunctionType *type = ci->getCalledFunction()->getFunctionType();
       FunctionCallee memCallee;
-      const char* tapirTarget = std::getenv("NM_TAPIRTARGET");
-      if (strcmp(tapirTarget, "opencilk") == 0) {
+      if (target == TapirTargetID::OpenCilk) {
         memCallee = m->getOrInsertFunction("__kitcuda_mem_alloc_managed_numba_oc", type);
       } else {
         memCallee = m->getOrInsertFunction("__kitcuda_mem_alloc_managed_numba_cu", type);
@@ -353,125 +493,442 @@ struct replaceNRTAllocPass : PassInfoMixin<replaceNRTAllocPass> {
   }
 
   static bool isRequired() { return true; }
+
+private:
+  TapirTargetID target;
 };
-} // namespace llvm
 
-static void runOptimizationPasses(llvm::Module &M, llvm::TargetMachine &TM) {
-  llvm::CodeGenOptLevel optLevelVal = TM.getOptLevel();
-  // this needs to be modified for other users/systems
-  std::string bitcodeFile = "/vast/home/josephsarrao/kitinstall_t/lib/clang/18/lib/x86_64-unknown-linux-gnu/libopencilk-abi.bc";
+/// Runs after the CUDA Tapir target lowering:
+///  - Prefetches managed memory of all pointer kernel arguments to the GPU
+///    before `__kitcuda_launch_kernel`, so kernels don't fault pages on the
+///    first touch. Pointers, already prefetched on the launch stream, are
+///    skipped.
+///  - Hoists loop invariant `__kitcuda_sync_thread_stream` calls out of the
+///    loops, which don't use the stream otherwise, and removes repeated syncs
+///    of the same stream, so host code is only synchronized once before it
+///    reads kernels results.
+struct kitcudaPrefetchPass : PassInfoMixin<kitcudaPrefetchPass> {
+  PreservedAnalyses run(Function &f, FunctionAnalysisManager &am) {
+    SmallVector<CallInst *> launches;
+    SmallVector<CallInst *> syncs;
+    for (auto &inst : instructions(f)) {
+      auto *call = dyn_cast<CallInst>(&inst);
+      if (!call || !call->getCalledFunction())
+        continue;
+
+      auto name = call->getCalledFunction()->getName();
+      if (name == LaunchName) {
+        launches.emplace_back(call);
+      } else if (name == SyncName) {
+        syncs.emplace_back(call);
+      }
+    }
 
-  llvm::errs() << "TM CodeGenOptLevel: " << (int) TM.getOptLevel() << '\n';
+    if (launches.empty() && syncs.empty())
+      return PreservedAnalyses::all();
 
-  for (llvm::Function &func : M.functions()) {
-    if (func.getName() == "nmrtCreateAllocToken") {
-      func.addRetAttr(llvm::Attribute::AttrKind::NoAlias);
-      for (llvm::Use &use : func.uses()) {
-        if (auto *call = llvm::dyn_cast<llvm::CallInst>(use.getUser())) {
-          if (call->getCalledFunction() == &func) {
-            call->addRetAttr(llvm::Attribute::AttrKind::NoAlias);
-          }
+    auto &dom = am.getResult<DominatorTreeAnalysis>(f);
+    bool changed = false;
+    for (auto *launch : launches)
+      changed |= prefetchArgs(launch, dom);
+
+    auto &loops = am.getResult<LoopAnalysis>(f);
+    for (auto *sync : syncs)
+      changed |= hoistSync(sync, loops);
+
+    changed |= removeRepeatedSyncs(f);
+    return changed ? PreservedAnalyses::none() : PreservedAnalyses::all();
+  }
+
+private:
+  static constexpr StringLiteral LaunchName = "__kitcuda_launch_kernel";
+  static constexpr StringLiteral PrefetchName = "__kitcuda_mem_gpu_prefetch";
+  static constexpr StringLiteral SyncName = "__kitcuda_sync_thread_stream";
+
+  static bool isCallTo(const Value *val, StringRef name) {
+    auto *call = dyn_cast<CallInst>(val);
+    return call && call->getCalledFunction() &&
+           call->getCalledFunction()->getName() == name;
+  }
+
+  /// Returns values, stored into the kernel args array, which is the array of
+  /// pointers to the argument values.
+  static SmallVector<Value *> getKernelArgs(Value *argsArray) {
+    SmallVector<Value *> slots;
+    SmallVector<Value *> worklist = {argsArray};
+    while (!worklist.empty()) {
+      auto *ptr = worklist.pop_back_val();
+      for (auto *user : ptr->users()) {
+        if (isa<GetElementPtrInst>(user)) {
+          worklist.emplace_back(user);
+        } else if (auto *store = dyn_cast<StoreInst>(user)) {
+          if (store->getPointerOperand() == ptr)
+            slots.emplace_back(store->getValueOperand());
         }
       }
     }
+
+    SmallVector<Value *> args;
+    for (auto *slot : slots) {
+      if (!isa<AllocaInst>(slot))
+        continue;
+
+      for (auto *user : slot->users())
+        if (auto *store = dyn_cast<StoreInst>(user))
+          if (store->getPointerOperand() == slot)
+            args.emplace_back(store->getValueOperand());
+    }
+    return args;
   }
 
-  // create first pass manager which will run O1, replaceNRTAllocPass, and
-  // taprifyLoopPass
-  llvm::PipelineTuningOptions PTO;
-  PTO.LoopUnrolling = false;
-  PTO.LoopVectorization = false;
-  PTO.LoopStripmine = false;
-  llvm::PassBuilder PB1(&TM, PTO);
+  bool prefetchArgs(CallInst *launch, DominatorTree &dom) {
+    auto *argsArray = launch->getArgOperand(2);
+    auto streamIdx = launch->arg_size() - 1;
+    Value *stream = launch->getArgOperand(streamIdx);
+
+    // Prefetch returns the stream it was issued on, creating a new one for
+    // the null stream.
+    SmallPtrSet<Value *, 8> prefetched;
+    if (isCallTo(stream, PrefetchName)) {
+      auto *first = cast<CallInst>(stream);
+      prefetched.insert(first->getArgOperand(0));
+      for (auto *user : first->users())
+        if (isCallTo(user, PrefetchName) &&
+            cast<CallInst>(user)->getArgOperand(1) == first)
+          prefetched.insert(cast<CallInst>(user)->getArgOperand(0));
+    }
 
-  llvm::Triple ModuleTriple(M.getTargetTriple());
-  llvm::TargetLibraryInfoImpl TLII(ModuleTriple);
-  const char* tapirTarget = std::getenv("NM_TAPIRTARGET");
-  if (strcmp(tapirTarget, "opencilk") == 0) {
-    TLII.setTapirTarget(llvm::TapirTargetID::OpenCilk);
-    TLII.setTapirTargetOptions(std::make_unique<llvm::OpenCilkABIOptions>(bitcodeFile));
-  } else {
-    TLII.setTapirTarget(llvm::TapirTargetID::Cuda);
-  }
-  TLII.addTapirTargetLibraryFunctions();
-
-  llvm::LoopAnalysisManager LAM1;
-  llvm::FunctionAnalysisManager FAM1;
-  llvm::CGSCCAnalysisManager CGAM1;
-  llvm::ModuleAnalysisManager MAM1;
-  FAM1.registerPass([&] { return llvm::TargetLibraryAnalysis(TLII); });
-
-  PB1.registerModuleAnalyses(MAM1);
-  PB1.registerCGSCCAnalyses(CGAM1);
-  PB1.registerFunctionAnalyses(FAM1);
-  PB1.registerLoopAnalyses(LAM1);
-  PB1.crossRegisterProxies(LAM1, FAM1, CGAM1, MAM1);
-
-
-  llvm::ModulePassManager MPM1 = PB1.buildPerModuleDefaultPipeline(
-      llvm::OptimizationLevel::O1, false, TLII.hasTapirTarget());
-  MPM1.addPass(
-      llvm::createModuleToFunctionPassAdaptor(llvm::replaceNRTAllocPass()));
-  MPM1.addPass(
-      llvm::createModuleToFunctionPassAdaptor(llvm::tapirifyLoopPass()));
-  MPM1.run(M, MAM1);
-
-  // create second pass manager which will run optimization pass for optLevelVal
-  // (usually O2)
-  llvm::PipelineTuningOptions PTO2 = getPipelineTuningOptions(optLevelVal);
-  if (strcmp(tapirTarget, "opencilk") == 0) {
-    PTO2.LoopUnrolling = true;
-    PTO2.LoopVectorization = false;
-    PTO2.LoopStripmine = true;
-  } else {
-    PTO2.LoopUnrolling = false;
-    PTO2.LoopVectorization = false;
-    PTO2.LoopStripmine = false;
+    auto *m = launch->getModule();
+    auto *ptrType = PointerType::getUnqual(m->getContext());
+    auto prefetchFunc = m->getOrInsertFunction(
+        PrefetchName, FunctionType::get(ptrType, {ptrType, ptrType}, false));
+
+    bool changed = false;
+    IRBuilder<> builder(launch);
+    for (auto *arg : getKernelArgs(argsArray)) {
+      if (!arg->getType()->isPointerTy() || isa<Constant>(arg) ||
+          !prefetched.insert(arg).second)
+        continue;
+
+      if (auto *inst = dyn_cast<Instruction>(arg))
+        if (!dom.dominates(inst, launch))
+          continue;
+
+      stream = builder.CreateCall(prefetchFunc, {arg, stream});
+      changed = true;
+    }
+
+    if (changed)
+      launch->setArgOperand(streamIdx, stream);
+
+    return changed;
   }
-  llvm::PassBuilder PB2(&TM, PTO2);
 
-  llvm::TargetLibraryInfoImpl TLII2(ModuleTriple);
-  if (strcmp(tapirTarget, "opencilk") == 0) {
-    TLII2.setTapirTarget(llvm::TapirTargetID::OpenCilk);
-    TLII2.setTapirTargetOptions(std::make_unique<llvm::OpenCilkABIOptions>(bitcodeFile));
-  } else {
-    TLII2.setTapirTarget(llvm::TapirTargetID::Cuda);
+  static bool hoistSync(CallInst *sync, LoopInfo &loops) {
+    bool changed = false;
+    auto *stream = sync->getArgOperand(0);
+    while (auto *loop = loops.getLoopFor(sync->getParent())) {
+      auto *preheader = loop->getLoopPreheader();
+      if (!preheader || !loop->isLoopInvariant(stream))
+        break;
+
+      // Stream can still get new work inside the loop.
+      auto usedInLoop = llvm::any_of(stream->users(), [&](User *user) {
+        auto *inst = dyn_cast<Instruction>(user);
+        return inst && inst != sync && loop->contains(inst) &&
+               !isCallTo(inst, SyncName);
+      });
+      if (usedInLoop)
+        break;
+
+      sync->moveBefore(preheader->getTerminator());
+      changed = true;
+    }
+    return changed;
+  }
+
+  /// Removes syncs of the stream, which was already synchronized earlier in
+  /// the same block without any calls in between.
+  static bool removeRepeatedSyncs(Function &f) {
+    SmallVector<CallInst *> toErase;
+    for (auto &block : f) {
+      SmallPtrSet<Value *, 4> synced;
+      for (auto &inst : block) {
+        if (isCallTo(&inst, SyncName)) {
+          auto *call = cast<CallInst>(&inst);
+          if (!synced.insert(call->getArgOperand(0)).second)
+            toErase.emplace_back(call);
+        } else if (isa<CallBase>(inst) && !isa<IntrinsicInst>(inst)) {
+          synced.clear();
+        }
+      }
+    }
+
+    for (auto *call : toErase)
+      call->eraseFromParent();
+
+    return !toErase.empty();
+  }
+};
+} // namespace llvm
+
+/// Module flag, marking quickly compiled first tier of the module.
+static constexpr llvm::StringLiteral TierModuleFlag("numba.tier0");
+
+/// Suffix of the global, holding current implementation of tiered function.
+static constexpr llvm::StringLiteral TierSlotSuffix(".tier_slot");
+
+namespace {
+/// LLVM optimization pipeline, built once for the TargetMachine and reused for
+/// all compiled modules. Not thread safe.
+class OptimizationPipeline {
+public:
+  struct Options {
+    numba::TapirTarget tapirTarget = numba::TapirTarget::None;
+    std::string abiBitcodePath;
+    numba::VectorLibrary vectorLibrary = numba::VectorLibrary::None;
+    bool llvmVectorization = true;
+  };
+
+  OptimizationPipeline(llvm::TargetMachine &TM, const Options &options)
+      : optLevel(TM.getOptLevel()),
+        target(getTapirTargetID(options.tapirTarget)),
+        stage1(TM, getStage1Options(), target, options.abiBitcodePath,
+               options.vectorLibrary, getStage1Instrumentation()),
+        stage2(TM,
+               getStage2Options(TM.getOptLevel(), target,
+                                options.llvmVectorization),
+               target,
+               options.abiBitcodePath, options.vectorLibrary,
+               getInstrumentation()) {
+    // First pass manager will run O1, replaceNRTAllocPass and
+    // expandTapirParallelForPass, quick version expands parallel loops
+    // serially, skipping Tapir transformations. Without Tapir target it only
+    // runs O1.
+    bool hasTarget = target != llvm::TapirTargetID::None;
+    quickMPM.addPass(llvm::markVectorizedLoopsPass());
+    quickMPM.addPass(stage1.PB.buildPerModuleDefaultPipeline(
+        llvm::OptimizationLevel::O1, false, stage1.TLII.hasTapirTarget()));
+    if (hasTarget) {
+      quickMPM.addPass(llvm::createModuleToFunctionPassAdaptor(
+          llvm::replaceNRTAllocPass(target)));
+      quickMPM.addPass(llvm::expandTapirParallelForPass(target, true));
+    }
+
+    MPM1.addPass(llvm::markVectorizedLoopsPass());
+    MPM1.addPass(stage1.PB.buildPerModuleDefaultPipeline(
+        llvm::OptimizationLevel::O1, false, stage1.TLII.hasTapirTarget()));
+    if (hasTarget) {
+      MPM1.addPass(llvm::createModuleToFunctionPassAdaptor(
+          llvm::replaceNRTAllocPass(target)));
+      MPM1.addPass(llvm::expandTapirParallelForPass(target, false));
+    }
+
+    // Second pass manager runs full optimization pipeline.
+    MPM2 = stage2.PB.buildPerModuleDefaultPipeline(
+        llvm::OptimizationLevel::O3, false, stage2.TLII.hasTapirTarget());
+    if (target == llvm::TapirTargetID::Cuda)
+      MPM2.addPass(
+          llvm::createModuleToFunctionPassAdaptor(llvm::kitcudaPrefetchPass()));
+
+    // Vector math intrinsics, coming from the MLIR vector code, are not
+    // handled by vectorizers TLI mappings, replace them with vector library
+    // calls directly.
+    if (options.vectorLibrary != numba::VectorLibrary::None)
+      MPM2.addPass(
+          llvm::createModuleToFunctionPassAdaptor(llvm::ReplaceWithVeclib()));
+  }
+
+  /// If `prof` is provided, stages and passes time is added to it.
+  void run(llvm::Module &M, bool quick, numba::CompileProfile *prof) {
+    LLVM_DEBUG(llvm::dbgs() << "TM CodeGenOptLevel: "
+                            << static_cast<int>(optLevel) << "\n");
+
+    profile = prof;
+    auto resetProfile = llvm::make_scope_exit([&]() {
+      profile = nullptr;
+      passStarts.clear();
+    });
+
+    for (llvm::Function &func : M.functions()) {
+      if (func.getName() == "nmrtCreateAllocToken") {
+        func.addRetAttr(llvm::Attribute::AttrKind::NoAlias);
+        for (llvm::Use &use : func.uses()) {
+          if (auto *call = llvm::dyn_cast<llvm::CallInst>(use.getUser())) {
+            if (call->getCalledFunction() == &func) {
+              call->addRetAttr(llvm::Attribute::AttrKind::NoAlias);
+            }
+          }
+        }
+      }
+    }
+
+    // First tier only runs O1 stage without Tapir transformations.
+    if (quick) {
+      numba::CompileProfileScope scope(profile, "llvm", "quick");
+      stage1.run(quickMPM, M);
+      return;
+    }
+
+    {
+      numba::CompileProfileScope scope(profile, "llvm", "stage1");
+      stage1.run(MPM1, M);
+    }
+    {
+      numba::CompileProfileScope scope(profile, "llvm", "stage2");
+      stage2.run(MPM2, M);
+    }
   }
-  TLII2.addTapirTargetLibraryFunctions();
 
-  llvm::LoopAnalysisManager LAM2;
-  llvm::FunctionAnalysisManager FAM2;
-  llvm::CGSCCAnalysisManager CGAM2;
-  llvm::ModuleAnalysisManager MAM2;
-  FAM2.registerPass([&] { return llvm::TargetLibraryAnalysis(TLII2); });
+private:
+  struct Stage {
+    Stage(llvm::TargetMachine &TM, llvm::PipelineTuningOptions PTO,
+          llvm::TapirTargetID target, llvm::StringRef abiBitcodePath,
+          numba::VectorLibrary vectorLibrary,
+          llvm::PassInstrumentationCallbacks *PIC)
+        : TLII(TM.getTargetTriple()), PB(&TM, PTO, std::nullopt, PIC) {
+      if (vectorLibrary != numba::VectorLibrary::None)
+        TLII.addVectorizableFunctionsFromVecLib(
+            getVectorLibraryID(vectorLibrary), TM.getTargetTriple());
+
+      if (target != llvm::TapirTargetID::None) {
+        TLII.setTapirTarget(target);
+        if (target == llvm::TapirTargetID::OpenCilk)
+          TLII.setTapirTargetOptions(
+              std::make_unique<llvm::OpenCilkABIOptions>(abiBitcodePath));
+
+        TLII.addTapirTargetLibraryFunctions();
+      }
+
+      FAM.registerPass([this] { return llvm::TargetLibraryAnalysis(TLII); });
+
+      PB.registerModuleAnalyses(MAM);
+      PB.registerCGSCCAnalyses(CGAM);
+      PB.registerFunctionAnalyses(FAM);
+      PB.registerLoopAnalyses(LAM);
+      PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+    }
+
+    void run(llvm::ModulePassManager &MPM, llvm::Module &M) {
+      MPM.run(M, MAM);
+
+      // Cached analyses are keyed by IR units, drop them before module is
+      // destroyed.
+      LAM.clear();
+      FAM.clear();
+      CGAM.clear();
+      MAM.clear();
+    }
+
+    llvm::TargetLibraryInfoImpl TLII;
+    llvm::PassBuilder PB;
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+  };
+
+  llvm::CodeGenOptLevel optLevel = llvm::CodeGenOptLevel::Default;
+  llvm::TapirTargetID target;
 
+  // Profile of the currently compiled module and start times of the running
+  // passes.
+  numba::CompileProfile *profile = nullptr;
+  llvm::SmallVector<numba::CompileProfile::Clock::time_point> passStarts;
+
+  // Verify-each instrumentation, only enabled in debug builds.
+  // Instrumentation context is only used for pass gating and is not tied to
+  // the compiled modules.
+  llvm::LLVMContext instrumentationContext;
+  llvm::PassInstrumentationCallbacks stage1PIC;
   llvm::PassInstrumentationCallbacks PIC;
-  llvm::PrintPassOptions PPO;
-  PPO.Indent = false;
-  PPO.SkipAnalyses = false;
-  llvm::StandardInstrumentations SI(M.getContext(), /*debugLogging*/ false,
-                                    /*verifyEach*/ true, PPO);
-  SI.registerCallbacks(PIC, &MAM2);
-
-  // Register all the basic analyses with the managers.
-  PB2.registerModuleAnalyses(MAM2);
-  PB2.registerCGSCCAnalyses(CGAM2);
-  PB2.registerFunctionAnalyses(FAM2);
-  PB2.registerLoopAnalyses(LAM2);
-  PB2.crossRegisterProxies(LAM2, FAM2, CGAM2, MAM2);
-
-  llvm::OptimizationLevel level = mapToLevel(optLevelVal);
+  std::optional<llvm::StandardInstrumentations> SI;
+
+  Stage stage1;
+  Stage stage2;
+  llvm::ModulePassManager quickMPM;
+  llvm::ModulePassManager MPM1;
   llvm::ModulePassManager MPM2;
-  MPM2 =
-      PB2.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3, false, TLII2.hasTapirTarget());
-  MPM2.run(M, MAM2);
-}
+
+  static llvm::PipelineTuningOptions getStage1Options() {
+    llvm::PipelineTuningOptions PTO;
+    PTO.LoopUnrolling = false;
+    PTO.LoopVectorization = false;
+    PTO.LoopStripmine = false;
+    return PTO;
+  }
+
+  static llvm::PipelineTuningOptions
+  getStage2Options(llvm::CodeGenOptLevel optLevelVal,
+                   llvm::TapirTargetID target, bool llvmVectorization) {
+    llvm::PipelineTuningOptions PTO = getPipelineTuningOptions(optLevelVal);
+    if (!llvmVectorization) {
+      PTO.LoopVectorization = false;
+      PTO.SLPVectorization = false;
+    }
+    if (target == llvm::TapirTargetID::OpenCilk) {
+      PTO.LoopUnrolling = true;
+      PTO.LoopVectorization = false;
+      PTO.LoopStripmine = true;
+    } else if (target != llvm::TapirTargetID::None) {
+      PTO.LoopUnrolling = false;
+      PTO.LoopVectorization = false;
+      PTO.LoopStripmine = false;
+    }
+    return PTO;
+  }
+
+  /// Adds time of each pass to the profile, if it is set. Pass managers and
+  /// adaptors are skipped, as their time is accounted by nested passes.
+  void registerProfiling(llvm::PassInstrumentationCallbacks &callbacks) {
+    callbacks.registerBeforeNonSkippedPassCallback(
+        [this](llvm::StringRef, llvm::Any) {
+          if (profile)
+            passStarts.emplace_back(numba::CompileProfile::Clock::now());
+        });
+    auto afterPass = [this](llvm::StringRef name) {
+      if (!profile || passStarts.empty())
+        return;
+
+      auto begin = passStarts.pop_back_val();
+      if (!name.contains("PassManager") && !name.contains("PassAdaptor"))
+        profile->addSince("llvm_pass", name, begin);
+    };
+    callbacks.registerAfterPassCallback(
+        [afterPass](llvm::StringRef name, llvm::Any,
+                    const llvm::PreservedAnalyses &) { afterPass(name); });
+    callbacks.registerAfterPassInvalidatedCallback(
+        [afterPass](llvm::StringRef name, const llvm::PreservedAnalyses &) {
+          afterPass(name);
+        });
+  }
+
+  llvm::PassInstrumentationCallbacks *getStage1Instrumentation() {
+    registerProfiling(stage1PIC);
+    return &stage1PIC;
+  }
+
+  llvm::PassInstrumentationCallbacks *getInstrumentation() {
+#ifndef NDEBUG
+    llvm::PrintPassOptions PPO;
+    PPO.Indent = false;
+    PPO.SkipAnalyses = false;
+    SI.emplace(instrumentationContext, /*debugLogging*/ false,
+               /*verifyEach*/ true, PPO);
+    SI->registerCallbacks(PIC);
+#endif
+    registerProfiling(PIC);
+    return &PIC;
+  }
+};
+} // namespace
 
 /// A simple object cache following Lang's LLJITWithObjectCache example.
 class numba::ExecutionEngine::SimpleObjectCache : public llvm::ObjectCache {
 public:
   void notifyObjectCompiled(const llvm::Module *m,
                             llvm::MemoryBufferRef objBuffer) override {
+    std::lock_guard<std::mutex> lock(mutex);
     cachedObjects[m->getModuleIdentifier()] =
         llvm::MemoryBuffer::getMemBufferCopy(objBuffer.getBuffer(),
                                              objBuffer.getBufferIdentifier());
@@ -479,6 +936,7 @@ public:
 
   std::unique_ptr<llvm::MemoryBuffer>
   getObject(const llvm::Module *m) override {
+    std::lock_guard<std::mutex> lock(mutex);
     auto i = cachedObjects.find(m->getModuleIdentifier());
     if (i == cachedObjects.end()) {
       LLVM_DEBUG(llvm::dbgs() << "No object for " << m->getModuleIdentifier()
@@ -490,6 +948,19 @@ public:
     return llvm::MemoryBuffer::getMemBuffer(i->second->getMemBufferRef());
   }
 
+  /// Removes objects of the module `name`, including its lazily compiled
+  /// partitions.
+  void erase(llvm::StringRef name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto prefix = (name + ".").str();
+    for (auto it = cachedObjects.begin(); it != cachedObjects.end();) {
+      auto current = it++;
+      auto key = current->getKey();
+      if (key == name || key.starts_with(prefix))
+        cachedObjects.erase(current);
+    }
+  }
+
   /// Dump cached object to output file `filename`.
   void dumpToObjectFile(llvm::StringRef outputFilename) {
     // Set up the output file.
@@ -508,9 +979,56 @@ public:
   }
 
 private:
+  std::mutex mutex;
   llvm::StringMap<std::unique_ptr<llvm::MemoryBuffer>> cachedObjects;
 };
 
+/// Content-addressed object cache stored in the filesystem directory.
+///
+/// Entries are keyed by the hash of the unoptimized LLVM IR and everything
+/// which affects codegen (target triple, cpu, features, opt level and tapir
+/// target), so cached objects can be safely shared between processes.
+class numba::ExecutionEngine::PersistentObjectCache {
+public:
+  PersistentObjectCache(llvm::StringRef dir, uint64_t maxSize)
+      : cache(dir, maxSize, ".o") {}
+
+  /// Compute cache key for module, must be called before any optimizations.
+  std::string getKey(llvm::Module &m, llvm::TargetMachine &tm,
+                     llvm::StringRef tapirTarget,
+                     llvm::StringRef vectorLibrary, bool llvmVectorization) {
+    llvm::SmallVector<char, 0> bitcode;
+    llvm::raw_svector_ostream os(bitcode);
+    llvm::WriteBitcodeToFile(m, os);
+
+    return numba::DiskCache::getKey({
+        llvm::StringRef(bitcode.data(), bitcode.size()),
+        tm.getTargetTriple().str(),
+        tm.getTargetCPU(),
+        tm.getTargetFeatureString(),
+        std::to_string(static_cast<int>(tm.getOptLevel())),
+        std::to_string(static_cast<int>(tm.getCodeModel())),
+        std::to_string(static_cast<int>(tm.getRelocationModel())),
+        tapirTarget,
+        vectorLibrary,
+        llvmVectorization ? "llvm_vectorize" : "",
+    });
+  }
+
+  std::unique_ptr<llvm::MemoryBuffer> load(llvm::StringRef key) {
+    // Object parsers don't need null terminator, so large entries are mapped
+    // instead of copied.
+    return cache.load(key, /*requiresNullTerminator*/ false);
+  }
+
+  void store(llvm::StringRef key, llvm::MemoryBufferRef obj) {
+    cache.store(key, obj.getBuffer());
+  }
+
+private:
+  numba::DiskCache cache;
+};
+
 /// Wrap a string into an llvm::StringError.
 static llvm::Error makeStringError(const llvm::Twine &message) {
   return llvm::make_error<llvm::StringError>(message.str(),
@@ -539,47 +1057,627 @@ public:
   using Transformer = std::function<llvm::Error(llvm::Module &)>;
   using AsmPrinter = std::function<void(llvm::StringRef)>;
 
-  CustomCompiler(Transformer t, AsmPrinter a,
-                 std::unique_ptr<llvm::TargetMachine> TM,
-                 llvm::ObjectCache *ObjCache = nullptr)
+  using PersistentCache = numba::ExecutionEngine::PersistentObjectCache;
+  using ProfileLookup =
+      std::function<numba::CompileProfile *(llvm::StringRef moduleId)>;
+
+  /// If `tmBuilder` is provided, separate TargetMachine is created for each
+  /// concurrently compiled module, so compiler can be invoked from the
+  /// multiple threads. `profileLookup` returns profile for the module, if any.
+  CustomCompiler(
+      Transformer t, AsmPrinter a, std::unique_ptr<llvm::TargetMachine> TM,
+      OptimizationPipeline::Options pipelineOptions,
+      llvm::ObjectCache *ObjCache = nullptr,
+      PersistentCache *persistentCache = nullptr,
+      std::optional<llvm::orc::JITTargetMachineBuilder> tmBuilder =
+          std::nullopt,
+      ProfileLookup profileLookup = nullptr)
       : SimpleCompiler(*TM, ObjCache), TM(std::move(TM)),
-        transformer(std::move(t)), printer(std::move(a)) {}
+        pipelineOptions(std::move(pipelineOptions)),
+        pipeline(std::make_unique<OptimizationPipeline>(
+            *this->TM, this->pipelineOptions)),
+        transformer(std::move(t)), printer(std::move(a)), objCache(ObjCache),
+        persistentCache(persistentCache), tmBuilder(std::move(tmBuilder)),
+        profileLookup(std::move(profileLookup)) {}
 
   llvm::Expected<CompileResult> operator()(llvm::Module &M) override {
+    auto *profile =
+        profileLookup ? profileLookup(M.getModuleIdentifier()) : nullptr;
+    if (!tmBuilder)
+      return compileCached(M, *TM, *pipeline, profile);
+
+    auto instance = acquireInstance();
+    if (!instance)
+      return instance.takeError();
+
+    auto res =
+        compileCached(M, *(*instance)->tm, (*instance)->pipeline, profile);
+    releaseInstance(std::move(*instance));
+    return res;
+  }
+
+private:
+  /// TargetMachine and pipeline for one of the compile threads.
+  struct Instance {
+    Instance(std::unique_ptr<llvm::TargetMachine> t,
+             const OptimizationPipeline::Options &options)
+        : tm(std::move(t)), pipeline(*tm, options) {}
+
+    std::unique_ptr<llvm::TargetMachine> tm;
+    OptimizationPipeline pipeline;
+  };
+
+  std::shared_ptr<llvm::TargetMachine> TM;
+  OptimizationPipeline::Options pipelineOptions;
+  std::unique_ptr<OptimizationPipeline> pipeline;
+  Transformer transformer;
+  AsmPrinter printer;
+  llvm::ObjectCache *objCache;
+  PersistentCache *persistentCache;
+  std::optional<llvm::orc::JITTargetMachineBuilder> tmBuilder;
+  ProfileLookup profileLookup;
+
+  std::mutex instancesMutex;
+  std::vector<std::unique_ptr<Instance>> freeInstances;
+
+  llvm::Expected<std::unique_ptr<Instance>> acquireInstance() {
+    {
+      std::lock_guard<std::mutex> lock(instancesMutex);
+      if (!freeInstances.empty()) {
+        auto ret = std::move(freeInstances.back());
+        freeInstances.pop_back();
+        return std::move(ret);
+      }
+    }
+
+    auto tm = tmBuilder->createTargetMachine();
+    if (!tm)
+      return tm.takeError();
+
+    return std::make_unique<Instance>(std::move(*tm), pipelineOptions);
+  }
+
+  void releaseInstance(std::unique_ptr<Instance> instance) {
+    std::lock_guard<std::mutex> lock(instancesMutex);
+    freeInstances.emplace_back(std::move(instance));
+  }
+
+  llvm::Expected<CompileResult> compileCached(llvm::Module &M,
+                                              llvm::TargetMachine &tm,
+                                              OptimizationPipeline &opt,
+                                              numba::CompileProfile *profile) {
+    std::string cacheKey;
+    if (persistentCache) {
+      numba::CompileProfileScope scope(profile, "llvm", "object_cache");
+      cacheKey = persistentCache->getKey(
+          M, tm, getTapirTargetName(pipelineOptions.tapirTarget),
+          getVectorLibraryName(pipelineOptions.vectorLibrary),
+          pipelineOptions.llvmVectorization);
+      if (auto obj = persistentCache->load(cacheKey)) {
+        if (profile)
+          profile->add("llvm", "object_cache_hit", 0);
+
+        return std::move(obj);
+      }
+    }
+
+    auto res = compile(M, tm, opt, profile);
+    if (res && persistentCache)
+      persistentCache->store(cacheKey, (*res)->getMemBufferRef());
+
+    return res;
+  }
+
+  llvm::Expected<CompileResult> compile(llvm::Module &M,
+                                        llvm::TargetMachine &tm,
+                                        OptimizationPipeline &opt,
+                                        numba::CompileProfile *profile) {
     if (transformer) {
       auto err = transformer(M);
       if (err)
         return err;
     }
 
-    setupModule(M, *TM);
-    runOptimizationPasses(M, *TM);
+    setupModule(M, tm);
+    opt.run(M, /*quick*/ M.getModuleFlag(TierModuleFlag) != nullptr, profile);
 
     if (printer) {
+      numba::CompileProfileScope scope(profile, "llvm", "asm_print");
       llvm::SmallVector<char, 0> buffer;
       llvm::raw_svector_ostream os(buffer);
 
       llvm::legacy::PassManager PM;
-      if (TM->addPassesToEmitFile(PM, os, nullptr,
-                                  llvm::CodeGenFileType::AssemblyFile))
+      if (tm.addPassesToEmitFile(PM, os, nullptr,
+                                 llvm::CodeGenFileType::AssemblyFile))
         return makeStringError("Target does not support Asm emission");
 
       PM.run(M);
       printer(llvm::StringRef(buffer.data(), buffer.size()));
     }
 
-    return llvm::orc::SimpleCompiler::operator()(M);
+    numba::CompileProfileScope scope(profile, "llvm", "codegen");
+    return llvm::orc::SimpleCompiler(tm, objCache)(M);
+  }
+};
+} // namespace
+
+/// Redirect external functions calls through the global slots, initialized
+/// with the current implementation, so they can be switched to the
+/// optimized version later. Returns names of redirected functions.
+static llvm::SmallVector<std::string> addTierIndirections(llvm::Module &M) {
+  llvm::SmallVector<llvm::Function *> funcs;
+  for (auto &func : M.functions())
+    if (!func.isDeclaration() && !func.hasLocalLinkage() &&
+        !func.isIntrinsic() && !func.isVarArg())
+      funcs.emplace_back(&func);
+
+  llvm::SmallVector<std::string> ret;
+  auto ptrType = llvm::PointerType::get(M.getContext(), 0);
+  for (auto *func : funcs) {
+    auto name = func->getName().str();
+    func->setName(name + ".tier0");
+    auto linkage = func->getLinkage();
+    func->setLinkage(llvm::GlobalValue::InternalLinkage);
+
+    auto slot = new llvm::GlobalVariable(M, ptrType, /*isConstant*/ false,
+                                         llvm::GlobalValue::ExternalLinkage,
+                                         func, name + TierSlotSuffix);
+    slot->setAlignment(llvm::Align(alignof(void *)));
+
+    auto stub = llvm::Function::Create(func->getFunctionType(), linkage, name,
+                                       M);
+    stub->copyAttributesFrom(func);
+
+    auto block = llvm::BasicBlock::Create(M.getContext(), "entry", stub);
+    llvm::IRBuilder<> builder(block);
+    auto target = builder.CreateAlignedLoad(ptrType, slot,
+                                            llvm::Align(alignof(void *)));
+    target->setAtomic(llvm::AtomicOrdering::Monotonic);
+
+    llvm::SmallVector<llvm::Value *> args;
+    for (auto &arg : stub->args())
+      args.emplace_back(&arg);
+
+    auto call = builder.CreateCall(func->getFunctionType(), target, args);
+    call->setCallingConv(func->getCallingConv());
+    call->setAttributes(func->getAttributes());
+    call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+    if (call->getType()->isVoidTy()) {
+      builder.CreateRetVoid();
+    } else {
+      builder.CreateRet(call);
+    }
+    ret.emplace_back(std::move(name));
+  }
+  return ret;
+}
+
+/// Global with basic block counters of the instrumented first tier.
+static constexpr llvm::StringLiteral PgoCountersName("numba.pgo_counters");
+
+/// Runtime callback, called by instrumented code when call threshold is
+/// reached.
+static constexpr llvm::StringLiteral PgoTriggerName("numba_pgo_trigger");
+
+/// Flag, set by the instrumented code, before calling `PgoTriggerName`.
+static constexpr llvm::StringLiteral PgoTriggeredName("numba.pgo_triggered");
+
+/// Adds counter to each basic block of the defined functions, in the module
+/// order. Entry blocks of all functions, including outlined parallel loop
+/// bodies, additionally call `PgoTriggerName(state)` when their count reaches
+/// `threshold`. Returns number of counters.
+///
+/// Counters are updated with plain (monotonic) loads and stores instead of
+/// atomic adds, so parallel loop bodies don't serialize on them. Concurrent
+/// updates can be lost, which is fine for the profile, and trigger condition
+/// is `count >= threshold`, guarded by the flag, so it still fires.
+static size_t addPgoInstrumentation(llvm::Module &M, uint64_t threshold,
+                                    void *state) {
+  assert(threshold > 0);
+  llvm::SmallVector<llvm::BasicBlock *> blocks;
+  for (auto &func : M.functions())
+    for (auto &block : func)
+      blocks.emplace_back(&block);
+
+  if (blocks.empty())
+    return 0;
+
+  auto &context = M.getContext();
+  auto *i8 = llvm::Type::getInt8Ty(context);
+  auto *i64 = llvm::Type::getInt64Ty(context);
+  auto *ptrType = llvm::PointerType::get(context, 0);
+  auto *arrayType = llvm::ArrayType::get(i64, blocks.size());
+  auto *counters = new llvm::GlobalVariable(
+      M, arrayType, /*isConstant*/ false, llvm::GlobalValue::ExternalLinkage,
+      llvm::ConstantAggregateZero::get(arrayType), PgoCountersName);
+  counters->setAlignment(llvm::Align(64));
+
+  // Separate cache line, it is read on each call after threshold is reached.
+  auto *triggered = new llvm::GlobalVariable(
+      M, i8, /*isConstant*/ false, llvm::GlobalValue::InternalLinkage,
+      llvm::ConstantInt::get(i8, 0), PgoTriggeredName);
+  triggered->setAlignment(llvm::Align(64));
+
+  auto trigger = M.getOrInsertFunction(
+      PgoTriggerName,
+      llvm::FunctionType::get(llvm::Type::getVoidTy(context), ptrType, false));
+  auto *stateVal = llvm::ConstantExpr::getIntToPtr(
+      llvm::ConstantInt::get(i64, reinterpret_cast<uintptr_t>(state)),
+      ptrType);
+  for (auto &&[i, block] : llvm::enumerate(blocks)) {
+    // Keep static allocas in the entry block.
+    auto it = block->getFirstInsertionPt();
+    while (llvm::isa<llvm::AllocaInst>(*it))
+      ++it;
+
+    llvm::IRBuilder<> builder(&*it);
+    auto *ptr = builder.CreateConstInBoundsGEP2_64(arrayType, counters, 0, i);
+    auto *prev = builder.CreateAlignedLoad(i64, ptr, llvm::MaybeAlign(8));
+    prev->setAtomic(llvm::AtomicOrdering::Monotonic);
+    auto *count = builder.CreateAdd(prev, llvm::ConstantInt::get(i64, 1));
+    auto *store = builder.CreateAlignedStore(count, ptr, llvm::MaybeAlign(8));
+    store->setAtomic(llvm::AtomicOrdering::Monotonic);
+
+    if (!block->isEntryBlock())
+      continue;
+
+    auto *isFlagSet = builder.CreateAlignedLoad(i8, triggered, llvm::Align(1));
+    isFlagSet->setAtomic(llvm::AtomicOrdering::Monotonic);
+    auto *cond = builder.CreateAnd(
+        builder.CreateICmpUGE(count, llvm::ConstantInt::get(i64, threshold)),
+        builder.CreateICmpEQ(isFlagSet, llvm::ConstantInt::get(i8, 0)));
+    auto *term = llvm::SplitBlockAndInsertIfThen(
+        cond, llvm::cast<llvm::Instruction>(cond)->getNextNode(), false);
+    llvm::IRBuilder<> thenBuilder(term);
+    auto *setFlag = thenBuilder.CreateAlignedStore(
+        llvm::ConstantInt::get(i8, 1), triggered, llvm::Align(1));
+    setFlag->setAtomic(llvm::AtomicOrdering::Monotonic);
+    thenBuilder.CreateCall(trigger, stateVal);
+  }
+  return blocks.size();
+}
+
+/// Attaches collected basic block counts to the original, not instrumented
+/// module. Successors counts are used as branch weights, which is exact for
+/// the successors with single predecessor and overestimated otherwise.
+static void applyPgoCounts(llvm::Module &M,
+                           llvm::ArrayRef<uint64_t> counts) {
+  llvm::DenseMap<llvm::BasicBlock *, uint64_t> blockCounts;
+  size_t i = 0;
+  for (auto &func : M.functions())
+    for (auto &block : func) {
+      if (i == counts.size())
+        return;
+
+      blockCounts[&block] = counts[i++];
+    }
+
+  // Module doesn't match the instrumented one.
+  if (i != counts.size())
+    return;
+
+  llvm::MDBuilder mdBuilder(M.getContext());
+  for (auto &func : M.functions()) {
+    if (func.isDeclaration())
+      continue;
+
+    func.setEntryCount(blockCounts.lookup(&func.getEntryBlock()));
+    for (auto &block : func) {
+      auto *term = block.getTerminator();
+      if (!term || term->getNumSuccessors() < 2 ||
+          !(llvm::isa<llvm::BranchInst, llvm::SwitchInst>(term)))
+        continue;
+
+      uint64_t maxCount = 0;
+      for (auto *succ : llvm::successors(&block))
+        maxCount = std::max(maxCount, blockCounts.lookup(succ));
+
+      if (maxCount == 0)
+        continue;
+
+      // Branch weights are 32 bit.
+      uint64_t scale = maxCount / std::numeric_limits<uint32_t>::max() + 1;
+      llvm::SmallVector<uint32_t> weights;
+      for (auto *succ : llvm::successors(&block))
+        weights.emplace_back(
+            static_cast<uint32_t>(blockCounts.lookup(succ) / scale));
+
+      term->setMetadata(llvm::LLVMContext::MD_prof,
+                        mdBuilder.createBranchWeights(weights));
+    }
+  }
+}
+
+/// Single worker thread, running full optimization pipeline for the tiered
+/// modules.
+class numba::ExecutionEngine::BackgroundCompiler {
+public:
+  BackgroundCompiler() : thread([this]() { run(); }) {}
+
+  ~BackgroundCompiler() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cond.notify_all();
+    thread.join();
+  }
+
+  void submit(ModuleHandle handle, llvm::orc::JITDylib *fullDylib,
+              std::function<void()> job) {
+    std::packaged_task<void()> task(std::move(job));
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      pending[handle] = {task.get_future().share(), fullDylib};
+      jobs.emplace_back(std::move(task));
+    }
+    cond.notify_one();
+  }
+
+  /// Wait for the module background compilation, if any, and returns dylib
+  /// with optimized version.
+  llvm::orc::JITDylib *wait(ModuleHandle handle) {
+    Entry entry;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto it = pending.find(handle);
+      if (it == pending.end())
+        return nullptr;
+
+      entry = std::move(it->second);
+      pending.erase(it);
+    }
+    entry.future.wait();
+    return entry.fullDylib;
+  }
+
+  /// Waits for all submitted compilations, their results are still returned
+  /// by `wait`.
+  void waitAll() {
+    llvm::SmallVector<std::shared_future<void>> futures;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto &it : pending)
+        futures.emplace_back(it.second.future);
+    }
+    for (auto &future : futures)
+      future.wait();
+  }
+
+  /// Stops starting new jobs and waits for the currently running one, if any,
+  /// so compile thread doesn't hold any locks during `fork`. Queued jobs are
+  /// not waited for.
+  void pause() {
+    std::unique_lock<std::mutex> lock(mutex);
+    paused = true;
+    idleCond.wait(lock, [&]() { return !running; });
+  }
+
+  void resume() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      paused = false;
+    }
+    cond.notify_one();
+  }
+
+  /// Takes jobs and pending results of the `other` compiler, which thread
+  /// doesn't exist after `fork`.
+  void takePending(BackgroundCompiler &other) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      for (auto &task : other.jobs)
+        jobs.emplace_back(std::move(task));
+
+      for (auto &it : other.pending)
+        pending.insert(std::move(it));
+    }
+    other.jobs.clear();
+    other.pending.clear();
+    cond.notify_one();
   }
 
 private:
-  std::shared_ptr<llvm::TargetMachine> TM;
-  Transformer transformer;
-  AsmPrinter printer;
+  struct Entry {
+    std::shared_future<void> future;
+    llvm::orc::JITDylib *fullDylib = nullptr;
+  };
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::condition_variable idleCond;
+  std::deque<std::packaged_task<void()>> jobs;
+  std::unordered_map<ModuleHandle, Entry> pending;
+  bool stop = false;
+  bool paused = false;
+  bool running = false;
+  std::thread thread;
+
+  void run() {
+    while (true) {
+      std::packaged_task<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&]() { return stop || (!paused && !jobs.empty()); });
+        if (stop)
+          return;
+
+        task = std::move(jobs.front());
+        jobs.pop_front();
+        running = true;
+      }
+      task();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+      }
+      idleCond.notify_all();
+    }
+  }
 };
-} // namespace
+
+/// Background compilation of the instrumented module, submitted when call
+/// threshold is reached.
+struct numba::ExecutionEngine::PgoState {
+  ExecutionEngine *engine = nullptr;
+  ModuleHandle handle = nullptr;
+  llvm::orc::JITDylib *fullDylib = nullptr;
+  std::function<void()> job;
+  std::atomic<bool> triggered{false};
+};
+
+void numba::ExecutionEngine::triggerPgo(void *state) {
+  auto *pgo = static_cast<PgoState *>(state);
+  if (pgo->triggered.exchange(true))
+    return;
+
+  pgo->engine->backgroundCompiler->submit(pgo->handle, pgo->fullDylib,
+                                          std::move(pgo->job));
+}
+
+static void *openRuntimeLib(llvm::StringRef dir, llvm::StringRef name) {
+  if (dir.empty())
+    return dlopen(name.str().c_str(), RTLD_LAZY);
+
+  // Kitsune puts some of the runtime libraries into the target subdir.
+  llvm::SmallString<256> candidates[2];
+  llvm::sys::path::append(candidates[0], dir, name);
+  llvm::sys::path::append(candidates[1], dir,
+                          llvm::sys::getDefaultTargetTriple(), name);
+  for (auto &path : candidates)
+    if (auto handle = dlopen(path.c_str(), RTLD_LAZY))
+      return handle;
+
+  return nullptr;
+}
+
+/// Resolves Kitsune runtime functions, required by the Tapir target.
+static llvm::orc::SymbolMap
+loadTapirRuntime(numba::TapirTarget target, llvm::StringRef dir,
+                 llvm::orc::MangleAndInterner mangle) {
+  llvm::orc::SymbolMap symMap;
+  auto addLib = [&](llvm::StringRef libName,
+                    llvm::ArrayRef<llvm::StringRef> funcs, bool required) {
+    auto dlHandle = openRuntimeLib(dir, libName);
+    if (!dlHandle) {
+      if (required)
+        llvm::errs() << "Could not find dlHandle for " << libName << "\n";
+
+      return;
+    }
+
+    for (auto fn : funcs) {
+      if (void *funcAddr = dlsym(dlHandle, fn.str().c_str())) {
+        llvm::JITSymbolFlags flags;
+        llvm::orc::ExecutorSymbolDef symDef(
+            llvm::orc::ExecutorAddr::fromPtr(funcAddr), flags);
+        symMap.insert({mangle(fn), std::move(symDef)});
+      } else {
+        llvm::report_fatal_error(llvm::Twine("error finding function ") + fn +
+                                 " in " + libName + "\n");
+      }
+    }
+  };
+
+  // kitsune cuda functions, managed memory allocation functions are used by
+  // all targets.
+  const llvm::StringRef kitcudaFns[] = {
+      "__cudaRegisterFatBinary",
+      "__cudaRegisterFatBinaryEnd",
+      "__cudaUnregisterFatBinary",
+      "__kitcuda_use_occupancy_launch",
+      "__kitcuda_initialize",
+      "__kitcuda_destroy",
+      "__kitcuda_launch_kernel",
+      "__kitcuda_mem_gpu_prefetch",
+      "__kitcuda_set_default_threads_per_blk",
+      "__kitcuda_sync_thread_stream",
+      "__kitcuda_mem_alloc_managed_numba_cu",
+      "__kitcuda_mem_alloc_managed_numba_oc"};
+  addLib("libkitrt.so", kitcudaFns, /*required*/ true);
+
+  if (target == numba::TapirTarget::OpenCilk) {
+    const llvm::StringRef openCilkFns[] = {
+        "Cilk_exception_handler",
+        "Cilk_set_return",
+        "cilkg_nproc",
+        "__pedigree_dprng_m_array",
+        "__cilkrts_check_exception_raise",
+        "__cilkrts_cleanup_fiber",
+        "__cilkrts_internal_exit_cilkified_root",
+        "__cilkrts_internal_invoke_cilkified_root",
+        "__cilkrts_need_to_cilkify",
+        "__cilkrts_sync",
+        "__cilkrts_use_extension",
+        "__emutls_v.__cilkrts_current_fh"};
+    addLib("libopencilk.so", openCilkFns, /*required*/ true);
+
+    const llvm::StringRef openCilkPersFns[] = {"__cilk_personality_v0"};
+    addLib("libopencilk-personality-c.so", openCilkPersFns,
+           /*required*/ true);
+  }
+
+  // Optional kitsune timer functions.
+  const llvm::StringRef timerFns[] = {"startKitTimer", "endKitTimer"};
+  addLib("timerFuncs.so", timerFns, /*required*/ false);
+  return symMap;
+}
+
+/// Size of the address space reservation for the JITLink memory manager. All
+/// sections of the single object are allocated from the same slab, so relative
+/// references between them are always in range of the small code model.
+static constexpr size_t JITLinkSlabSize = 256 * 1024 * 1024;
+
+/// Non-large code models rely on the PC-relative access to GOT/PLT stubs for
+/// the symbols outside of the object.
+static void setCodeModel(llvm::orc::JITTargetMachineBuilder &tmBuilder,
+                         llvm::CodeModel::Model codeModel) {
+  tmBuilder.setCodeModel(codeModel);
+  if (codeModel != llvm::CodeModel::Large)
+    tmBuilder.setRelocationModel(llvm::Reloc::PIC_);
+}
+
+static llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>>
+createJITLinkLayer(llvm::orc::ExecutionSession &session, bool enableGDB) {
+  auto memMgr = llvm::orc::MapperJITLinkMemoryManager::CreateWithMapper<
+      llvm::orc::InProcessMemoryMapper>(JITLinkSlabSize);
+  if (!memMgr)
+    return memMgr.takeError();
+
+  auto objectLayer = std::make_unique<llvm::orc::ObjectLinkingLayer>(
+      session, std::move(*memMgr));
+
+  // Unwind info must be registered, otherwise C++ exceptions thrown from the
+  // runtime functions can't propagate through the jitted frames.
+  auto ehRegistrar = llvm::orc::EPCEHFrameRegistrar::Create(session);
+  if (!ehRegistrar)
+    return ehRegistrar.takeError();
+
+  objectLayer->addPlugin(std::make_unique<llvm::orc::EHFrameRegistrationPlugin>(
+      session, std::move(*ehRegistrar)));
+
+  // GDB registration function is only available if LLVM OrcTargetProcess
+  // symbols are exported from the current process, skip it otherwise.
+  if (enableGDB) {
+    if (auto registrar = llvm::orc::createJITLoaderGDBRegistrar(session)) {
+      objectLayer->addPlugin(
+          std::make_unique<llvm::orc::DebugObjectManagerPlugin>(
+              session, std::move(*registrar)));
+    } else {
+      llvm::consumeError(registrar.takeError());
+    }
+  }
+
+  return std::move(objectLayer);
+}
 
 numba::ExecutionEngine::ExecutionEngine(ExecutionEngineOptions options)
     : cache(options.enableObjectCache ? new SimpleObjectCache() : nullptr),
+      persistentCache(options.objectCacheDir.empty()
+                          ? nullptr
+                          : new PersistentObjectCache(
+                                options.objectCacheDir,
+                                options.objectCacheMaxSize)),
       gdbListener(options.enableGDBNotificationListener
                       ? llvm::JITEventListener::createGDBRegistrationListener()
                       : nullptr),
@@ -595,7 +1693,11 @@ numba::ExecutionEngine::ExecutionEngine(ExecutionEngineOptions options)
   // Callback to create the object layer with symbol resolution to current
   // process and dynamically linked libraries.
   auto objectLinkingLayerCreator = [this](llvm::orc::ExecutionSession &session,
-                                          const llvm::Triple &targetTriple) {
+                                          const llvm::Triple &targetTriple)
+      -> llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>> {
+    if (useJITLink)
+      return createJITLinkLayer(session, gdbListener != nullptr);
+
     auto objectLayer =
         std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(session, []() {
           return std::make_unique<llvm::SectionMemoryManager>();
@@ -615,7 +1717,7 @@ numba::ExecutionEngine::ExecutionEngine(ExecutionEngineOptions options)
       objectLayer->setAutoClaimResponsibilityForObjectSymbols(true);
     }
 
-    return objectLayer;
+    return std::move(objectLayer);
   };
 
   // Callback to inspect the cache and recompile on demand. This follows Lang's
@@ -631,49 +1733,339 @@ numba::ExecutionEngine::ExecutionEngine(ExecutionEngineOptions options)
     auto tm = jtmb.createTargetMachine();
     if (!tm)
       return tm.takeError();
-    return std::make_unique<CustomCompiler>(transformer, asmPrinter,
-                                            std::move(*tm), cache.get());
+
+    std::optional<llvm::orc::JITTargetMachineBuilder> tmBuilder;
+    if (concurrentCompile)
+      tmBuilder = std::move(jtmb);
+
+    return std::make_unique<CustomCompiler>(
+        transformer, asmPrinter, std::move(*tm),
+        OptimizationPipeline::Options{tapirTarget, tapirAbiBitcodePath,
+                                      vectorLibrary, llvmVectorization},
+        cache.get(), persistentCache.get(), std::move(tmBuilder),
+        [this](llvm::StringRef moduleId) { return getProfile(moduleId); });
   };
 
   auto tmBuilder =
       llvm::cantFail(llvm::orc::JITTargetMachineBuilder::detectHost());
 
+  useJITLink = options.jitLinker == JITLinker::JITLink && !perfListener &&
+               !tmBuilder.getTargetTriple().isOSBinFormatCOFF();
+  codeModel = useJITLink ? options.codeModel : llvm::CodeModel::Large;
+  setCodeModel(tmBuilder, codeModel);
+
+  concurrentCompile = options.numCompileThreads > 0;
+  lazyCompile = options.lazyCompilation;
+  tapirTarget = options.tapirTarget;
+  tapirAbiBitcodePath = std::move(options.tapirAbiBitcodePath);
+  vectorLibrary = options.vectorLibrary;
+  llvmVectorization = options.llvmVectorization;
+
   // Create the LLJIT by calling the LLJITBuilder with 2 callbacks.
-  jit = cantFail(llvm::orc::LLJITBuilder()
-                     .setCompileFunctionCreator(compileFunctionCreator)
-                     .setObjectLinkingLayerCreator(objectLinkingLayerCreator)
-                     .setJITTargetMachineBuilder(tmBuilder)
-                     .create());
+  auto createJit = [&](auto &&builder) -> std::unique_ptr<llvm::orc::LLJIT> {
+    return cantFail(builder.setCompileFunctionCreator(compileFunctionCreator)
+                        .setObjectLinkingLayerCreator(objectLinkingLayerCreator)
+                        .setJITTargetMachineBuilder(tmBuilder)
+                        .setNumCompileThreads(options.numCompileThreads)
+                        .create());
+  };
+  if (lazyCompile) {
+    jit = createJit(llvm::orc::LLLazyJITBuilder());
+    // Compile only requested functions, everything else is called through
+    // the lazy reexports.
+    static_cast<llvm::orc::LLLazyJIT &>(*jit).setPartitionFunction(
+        llvm::orc::CompileOnDemandLayer::compileRequested);
+  } else {
+    jit = createJit(llvm::orc::LLJITBuilder());
+  }
+
+  llvm::orc::MangleAndInterner mangler(jit->getExecutionSession(),
+                                       jit->getDataLayout());
+  runtimeDylib = &cantFail(jit->createJITDylib("numba_runtime"));
+  runtimeDylib->addGenerator(
+      cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+          jit->getDataLayout().getGlobalPrefix())));
+
+  if (options.symbolMap)
+    cantFail(runtimeDylib->define(
+        llvm::orc::absoluteSymbols(options.symbolMap(mangler))));
+
+  if (tapirTarget != TapirTarget::None) {
+    auto tapirSymbols =
+        loadTapirRuntime(tapirTarget, options.tapirRuntimePath, mangler);
+    if (!tapirSymbols.empty())
+      cantFail(runtimeDylib->define(
+          llvm::orc::absoluteSymbols(std::move(tapirSymbols))));
+  }
 
-  symbolMap = std::move(options.symbolMap);
   transformer = std::move(options.transformer);
+  jitCodeGenOptLevel = options.jitCodeGenOptLevel;
+  if (options.tieredCompilation) {
+    backgroundCompiler = std::make_unique<BackgroundCompiler>();
+    pgoCallThreshold = options.pgoCallThreshold;
+    if (pgoCallThreshold) {
+      llvm::orc::SymbolMap pgoSymbols;
+      pgoSymbols[mangler(PgoTriggerName)] = llvm::orc::ExecutorSymbolDef(
+          llvm::orc::ExecutorAddr::fromPtr(&triggerPgo),
+          llvm::JITSymbolFlags::Exported);
+      cantFail(runtimeDylib->define(
+          llvm::orc::absoluteSymbols(std::move(pgoSymbols))));
+    }
+  }
 }
 
 numba::ExecutionEngine::~ExecutionEngine() {}
 
-llvm::Expected<numba::ExecutionEngine::ModuleHandle>
-numba::ExecutionEngine::loadModule(mlir::ModuleOp m) {
+llvm::Expected<llvm::orc::ThreadSafeModule>
+numba::ExecutionEngine::translateModule(mlir::ModuleOp m, llvm::StringRef name,
+                                        CompileProfile *profile) {
   assert(m);
 
   std::unique_ptr<llvm::LLVMContext> ctx(new llvm::LLVMContext);
-  auto llvmModule = mlir::translateModuleToLLVMIR(m, *ctx);
-
-  // options that kitsune likes, useful to mess around with these in the
-  // event of strange behavior
-  llvmModule->setCodeModel(llvm::CodeModel::Large);
-  llvmModule->setPICLevel(llvm::PICLevel::BigPIC);
-  llvmModule->setPIELevel(llvm::PIELevel::Large);
-  llvmModule->setDirectAccessExternalData(true);
-
+  auto llvmModule = [&]() {
+    CompileProfileScope scope(profile, "llvm", "translate");
+    return mlir::translateModuleToLLVMIR(m, *ctx, name);
+  }();
   if (!llvmModule)
     return makeStringError("could not convert to LLVM IR");
 
+  llvmModule->setCodeModel(codeModel);
+  llvmModule->setPICLevel(llvm::PICLevel::BigPIC);
+  if (codeModel == llvm::CodeModel::Large) {
+    // options that kitsune likes, useful to mess around with these in the
+    // event of strange behavior
+    llvmModule->setPIELevel(llvm::PIELevel::Large);
+    llvmModule->setDirectAccessExternalData(true);
+  } else {
+    // External data can be outside of the 2GB range, access it through GOT.
+    llvmModule->setDirectAccessExternalData(false);
+  }
+
   // Add a ThreadSafemodule to the engine and return.
   llvm::orc::ThreadSafeModule tsm(std::move(llvmModule), std::move(ctx));
   if (transformer)
     cantFail(tsm.withModuleDo(
         [this](llvm::Module &module) { return transformer(module); }));
 
+  return std::move(tsm);
+}
+
+void numba::ExecutionEngine::registerProfile(llvm::StringRef name,
+                                             CompileProfile *profile) {
+  if (!profile)
+    return;
+
+  std::lock_guard<std::mutex> lock(profilesMutex);
+  profiles[name] = profile;
+}
+
+void numba::ExecutionEngine::unregisterProfile(llvm::StringRef name) {
+  std::lock_guard<std::mutex> lock(profilesMutex);
+  profiles.erase(name);
+}
+
+numba::CompileProfile *
+numba::ExecutionEngine::getProfile(llvm::StringRef name) {
+  std::lock_guard<std::mutex> lock(profilesMutex);
+  return profiles.lookup(name);
+}
+
+llvm::Error
+numba::ExecutionEngine::addIRModule(llvm::orc::JITDylib &dylib,
+                                    llvm::orc::ThreadSafeModule tsm) {
+  if (lazyCompile)
+    return static_cast<llvm::orc::LLLazyJIT &>(*jit).addLazyIRModule(
+        dylib, std::move(tsm));
+
+  return jit->addIRModule(dylib, std::move(tsm));
+}
+
+/// Returns all externally visible functions defined in the module.
+static llvm::orc::SymbolLookupSet
+getDefinedSymbols(llvm::orc::LLJIT &jit, llvm::orc::ThreadSafeModule &tsm) {
+  llvm::orc::SymbolLookupSet ret;
+  tsm.withModuleDo([&](llvm::Module &module) {
+    for (auto &func : module.functions())
+      if (!func.isDeclaration() && !func.hasLocalLinkage())
+        ret.add(jit.mangleAndIntern(func.getName()));
+  });
+  return ret;
+}
+
+llvm::Expected<numba::ExecutionEngine::ModuleHandle>
+numba::ExecutionEngine::loadModule(mlir::ModuleOp m, CompileProfile *profile) {
+  auto dylibOrErr = createDylib();
+  if (!dylibOrErr)
+    return dylibOrErr.takeError();
+
+  auto dylib = *dylibOrErr;
+  auto tsmOrErr = translateModule(m, dylib->getName(), profile);
+  if (!tsmOrErr) {
+    removeDylib(*dylib);
+    return tsmOrErr.takeError();
+  }
+
+  auto tsm = std::move(*tsmOrErr);
+  auto handle = static_cast<ModuleHandle>(dylib);
+
+  // Module is compiled lazily on the first lookup, force it while profile is
+  // registered.
+  registerProfile(dylib->getName(), profile);
+  auto profileGuard = llvm::make_scope_exit([&]() {
+    if (profile)
+      unregisterProfile(dylib->getName());
+  });
+  auto materialize = [&](llvm::orc::SymbolLookupSet symbols) -> llvm::Error {
+    if (!profile || symbols.empty() || lazyCompile)
+      return llvm::Error::success();
+
+    auto res = jit->getExecutionSession().lookup(
+        llvm::orc::makeJITDylibSearchOrder(dylib), std::move(symbols));
+    return res.takeError();
+  };
+
+  auto addLazySymbols = [&](const llvm::orc::SymbolLookupSet &symbols) {
+    if (!lazyCompile || symbols.empty())
+      return;
+
+    std::lock_guard<std::mutex> lock(lazyMutex);
+    lazySymbols[handle] = symbols;
+  };
+
+  if (!backgroundCompiler) {
+    llvm::orc::SymbolLookupSet symbols;
+    llvm::cantFail(linkSharedCallees(
+        std::move(tsm), *dylib, [&](llvm::orc::ThreadSafeModule linked) {
+          symbols = getDefinedSymbols(*jit, linked);
+          addLazySymbols(symbols);
+          return addIRModule(*dylib, std::move(linked));
+        }));
+    llvm::cantFail(jit->initialize(*dylib));
+    if (auto err = materialize(std::move(symbols))) {
+      releaseModule(handle);
+      return std::move(err);
+    }
+    return handle;
+  }
+
+  auto fullDylibOrErr = createDylib();
+  if (!fullDylibOrErr)
+    return fullDylibOrErr.takeError();
+
+  auto fullDylib = *fullDylibOrErr;
+
+  std::unique_ptr<PgoState> pgo;
+  if (pgoCallThreshold) {
+    pgo = std::make_unique<PgoState>();
+    pgo->engine = this;
+    pgo->handle = handle;
+    pgo->fullDylib = fullDylib;
+  }
+
+  // Save original module for the background compilation and add
+  // indirections to the first tier.
+  llvm::SmallVector<char, 0> bitcode;
+  llvm::SmallVector<std::string> tieredFuncs;
+  size_t numCounters = 0;
+  tsm.withModuleDo([&](llvm::Module &module) {
+    llvm::raw_svector_ostream os(bitcode);
+    llvm::WriteBitcodeToFile(module, os);
+    if (pgo)
+      numCounters =
+          addPgoInstrumentation(module, pgoCallThreshold, pgo.get());
+
+    tieredFuncs = addTierIndirections(module);
+    module.addModuleFlag(llvm::Module::Warning, TierModuleFlag, 1);
+  });
+
+  auto symbols = getDefinedSymbols(*jit, tsm);
+  addLazySymbols(symbols);
+  llvm::cantFail(addIRModule(*dylib, std::move(tsm)));
+  llvm::cantFail(jit->initialize(*dylib));
+  if (auto err = materialize(std::move(symbols))) {
+    removeDylib(*fullDylib);
+    releaseModule(handle);
+    return std::move(err);
+  }
+
+  auto job = [this, dylib, fullDylib, bitcode = std::move(bitcode),
+              funcs = std::move(tieredFuncs), numCounters]() {
+    auto err = [&]() -> llvm::Error {
+      llvm::LLVMContext context;
+      auto buffer = llvm::MemoryBuffer::getMemBuffer(
+          llvm::StringRef(bitcode.data(), bitcode.size()), "", false);
+      auto module = llvm::parseBitcodeFile(*buffer, context);
+      if (!module)
+        return module.takeError();
+
+      if (numCounters > 0) {
+        auto counters = jit->lookup(*dylib, PgoCountersName);
+        if (!counters)
+          return counters.takeError();
+
+        applyPgoCounts(**module, llvm::ArrayRef(counters->toPtr<uint64_t *>(),
+                                                numCounters));
+      }
+
+      auto tmBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+      if (!tmBuilder)
+        return tmBuilder.takeError();
+
+      if (jitCodeGenOptLevel)
+        tmBuilder->setCodeGenOptLevel(*jitCodeGenOptLevel);
+
+      auto tm = tmBuilder->createTargetMachine();
+      if (!tm)
+        return tm.takeError();
+
+      // Separate compiler instance, TargetMachine is not thread safe. Printers
+      // are not used as they may call into python.
+      CustomCompiler compiler(
+          nullptr, nullptr, std::move(*tm),
+          OptimizationPipeline::Options{tapirTarget, tapirAbiBitcodePath,
+                                      vectorLibrary, llvmVectorization},
+          nullptr, persistentCache.get());
+      auto obj = compiler(**module);
+      if (!obj)
+        return obj.takeError();
+
+      if (auto err = jit->addObjectFile(*fullDylib, std::move(*obj)))
+        return err;
+
+      if (auto err = jit->initialize(*fullDylib))
+        return err;
+
+      for (auto &name : funcs) {
+        auto func = jit->lookup(*fullDylib, name);
+        if (!func)
+          return func.takeError();
+
+        auto slot = jit->lookup(*dylib, name + TierSlotSuffix.str());
+        if (!slot)
+          return slot.takeError();
+
+        __atomic_store_n(slot->toPtr<void **>(), func->toPtr<void *>(),
+                         __ATOMIC_RELEASE);
+      }
+      return llvm::Error::success();
+    }();
+    // First tier stays in use on failure.
+    if (err)
+      llvm::errs() << "numba: background compilation failed: "
+                   << llvm::toString(std::move(err)) << "\n";
+  };
+  if (!pgo) {
+    backgroundCompiler->submit(handle, fullDylib, std::move(job));
+    return handle;
+  }
+
+  pgo->job = std::move(job);
+  std::lock_guard<std::mutex> lock(pgoMutex);
+  pgoStates[handle] = std::move(pgo);
+  return handle;
+}
+
+llvm::Expected<llvm::orc::JITDylib *> numba::ExecutionEngine::createDylib() {
   llvm::orc::JITDylib *dylib;
   while (true) {
     auto uniqueName =
@@ -690,148 +2082,176 @@ numba::ExecutionEngine::loadModule(mlir::ModuleOp m) {
   }
   assert(dylib);
 
-  auto dataLayout = jit->getDataLayout();
-  dylib->addGenerator(
-      cantFail(llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
-          dataLayout.getGlobalPrefix())));
+  assert(runtimeDylib);
+  dylib->addToLinkOrder(*runtimeDylib);
+  return dylib;
+}
 
-  if (symbolMap)
-    cantFail(
-        dylib->define(absoluteSymbols(symbolMap(llvm::orc::MangleAndInterner(
-            dylib->getExecutionSession(), jit->getDataLayout())))));
+/// Prefix of the callees symbols, shared between modules. Must be kept in sync
+/// with `PlierToStd.cpp`.
+static constexpr llvm::StringLiteral SharedCalleePrefix("numba_shared.");
+
+llvm::Error numba::ExecutionEngine::linkSharedCallees(
+    llvm::orc::ThreadSafeModule tsm, llvm::orc::JITDylib &dylib,
+    llvm::function_ref<llvm::Error(llvm::orc::ThreadSafeModule)> addModule) {
+  // Lock is held until the module is added, so other modules can't link
+  // against the dylib before it defines the callees.
+  std::lock_guard<std::mutex> lock(sharedMutex);
+  tsm.withModuleDo([&](llvm::Module &module) {
+    llvm::SmallPtrSet<llvm::orc::JITDylib *, 4> linked;
+    for (auto &func : module.functions()) {
+      if (func.isDeclaration() ||
+          !func.getName().starts_with(SharedCalleePrefix))
+        continue;
+
+      auto it = sharedCallees.find(func.getName());
+      if (it == sharedCallees.end()) {
+        sharedCallees.try_emplace(func.getName(), &dylib);
+        pinnedDylibs.insert(&dylib);
+        continue;
+      }
 
-  llvm::cantFail(jit->addIRModule(*dylib, std::move(tsm)));
+      if (it->second == &dylib)
+        continue;
 
-  // add kitsune cuda functions to symbol map
-  llvm::SmallVector<std::string> kitcudaFns{
-      "__cudaRegisterFatBinary",
-      "__cudaRegisterFatBinaryEnd",
-      "__cudaUnregisterFatBinary",
-      "__kitcuda_use_occupancy_launch",
-      "__kitcuda_initialize",
-      "__kitcuda_destroy",
-      "__kitcuda_launch_kernel",
-      "__kitcuda_mem_gpu_prefetch",
-      "__kitcuda_set_default_threads_per_blk",
-      "__kitcuda_sync_thread_stream",
-      "__kitcuda_mem_alloc_managed_numba_cu",
-      "__kitcuda_mem_alloc_managed_numba_oc"};
-  llvm::orc::MangleAndInterner Mangle(dylib->getExecutionSession(),
-                                      jit->getDataLayout());
-  static void *dlHandle = nullptr;
-  llvm::DenseMap<llvm::orc::SymbolStringPtr, llvm::orc::ExecutorSymbolDef>
-      symMap;
-  // this needs to be modified for other users/systems
-  if ((dlHandle = dlopen(
-           "/vast/home/josephsarrao/kitinstall_t/lib/clang/18/lib/libkitrt.so",
-           RTLD_LAZY))) {
-    for (auto fn : kitcudaFns) {
-      if (void *funcAddr = dlsym(dlHandle, fn.c_str())) {
-        llvm::JITSymbolFlags flags;
-        llvm::orc::ExecutorSymbolDef symDef(
-            llvm::orc::ExecutorAddr::fromPtr(funcAddr), flags);
-        symMap.insert({Mangle(fn.c_str()), std::move(symDef)});
-      } else {
-        llvm::report_fatal_error(
-            "error finding kitcuda function in libkitrt.so\n");
-      }
-    }
-  } else {
-    llvm::errs() << "Could not find dlHandle for libkitrt.so\n";
-  }
-
-  // add kitsune opencilk functions to symbol map
-  llvm::SmallVector<std::string> openCilkFns{
-      "Cilk_exception_handler",
-      "Cilk_set_return",
-      "cilkg_nproc",
-      "__pedigree_dprng_m_array",
-      "__cilkrts_check_exception_raise",
-      "__cilkrts_cleanup_fiber",
-      "__cilkrts_internal_exit_cilkified_root",
-      "__cilkrts_internal_invoke_cilkified_root",
-      "__cilkrts_need_to_cilkify",
-      "__cilkrts_sync",
-      "__cilkrts_use_extension",
-      "__emutls_v.__cilkrts_current_fh"};
-  dlHandle = nullptr;
-  // this needs to be modified for other users/systems
-  if ((dlHandle = dlopen(
-           "/vast/home/josephsarrao/kitinstall_t/lib/clang/18/lib/x86_64-unknown-linux-gnu/libopencilk.so",
-           RTLD_LAZY))) {
-    for (auto fn : openCilkFns) {
-      if (void *funcAddr = dlsym(dlHandle, fn.c_str())) {
-        llvm::JITSymbolFlags flags;
-        llvm::orc::ExecutorSymbolDef symDef(
-            llvm::orc::ExecutorAddr::fromPtr(funcAddr), flags);
-        symMap.insert({Mangle(fn.c_str()), std::move(symDef)});
-      } else {
-        llvm::report_fatal_error(
-            "error finding opencilk function in libopencilk.so\n");
-      }
-    }
-  } else {
-    llvm::errs() << "Could not find dlHandle for libopencilk.so\n";
-  }
-
-  // add opencilk personality functions to symbol map
-  llvm::SmallVector<std::string> openCilkPersFns{
-      "__cilk_personality_v0"};
-  dlHandle = nullptr;
-  // this needs to be modified for other users/systems
-  if ((dlHandle = dlopen(
-           "/vast/home/josephsarrao/kitinstall_t/lib/clang/18/lib/x86_64-unknown-linux-gnu/libopencilk-personality-c.so",
-           RTLD_LAZY))) {
-    for (auto fn : openCilkPersFns) {
-      if (void *funcAddr = dlsym(dlHandle, fn.c_str())) {
-        llvm::JITSymbolFlags flags;
-        llvm::orc::ExecutorSymbolDef symDef(
-            llvm::orc::ExecutorAddr::fromPtr(funcAddr), flags);
-        symMap.insert({Mangle(fn.c_str()), std::move(symDef)});
-      } else {
-        llvm::report_fatal_error(
-            "error finding opencilk function in libopencilk-personality-c.so\n");
-      }
+      // Already compiled by the other module, drop the body to save codegen
+      // time and memory.
+      func.deleteBody();
+      func.setComdat(nullptr);
+      if (linked.insert(it->second).second)
+        dylib.addToLinkOrder(*it->second);
     }
-  } else {
-    llvm::errs() << "Could not find dlHandle for libopencilk-personality-cpp.so\n";
-  }
-
-  // add kitsune timer functions to symbol map
-  llvm::SmallVector<std::string> timerFns{
-      "startKitTimer",
-      "endKitTimer"};
-  dlHandle = nullptr;
-  // this needs to be modified for other users/systems
-  if ((dlHandle = dlopen(
-           "/vast/home/josephsarrao/python_experiments/numba-mlir/yw_therm/timerFuncs.so",
-           RTLD_LAZY))) {
-    for (auto fn : timerFns) {
-      if (void *funcAddr = dlsym(dlHandle, fn.c_str())) {
-        llvm::JITSymbolFlags flags;
-        llvm::orc::ExecutorSymbolDef symDef(
-            llvm::orc::ExecutorAddr::fromPtr(funcAddr), flags);
-        symMap.insert({Mangle(fn.c_str()), std::move(symDef)});
-      } else {
-        // llvm::errs() << fn << '\n';
-        llvm::report_fatal_error(
-            "error finding timer func\n");
+  });
+  return addModule(std::move(tsm));
+}
+
+void numba::ExecutionEngine::removeDylib(llvm::orc::JITDylib &dylib) {
+  // Failed loads can remove dylib with shared callees.
+  {
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (pinnedDylibs.erase(&dylib)) {
+      for (auto it = sharedCallees.begin(); it != sharedCallees.end();) {
+        auto current = it++;
+        if (current->second == &dylib)
+          sharedCallees.erase(current);
       }
     }
-  } else {
-    llvm::errs() << "Could not find dlHandle for timerFuncs.so\n";
   }
 
-  llvm::cantFail(dylib->define(llvm::orc::absoluteSymbols(symMap)));
-  llvm::cantFail(jit->initialize(*dylib));
-  return static_cast<ModuleHandle>(dylib);
+  // Removing resource tracker releases memory manager allocations of all
+  // objects, linked into the dylib.
+  auto name = dylib.getName();
+  llvm::cantFail(dylib.getDefaultResourceTracker()->remove());
+  if (cache)
+    cache->erase(name);
+
+  llvm::cantFail(jit->getExecutionSession().removeJITDylib(dylib));
+}
+
+void numba::ExecutionEngine::defineSymbol(llvm::StringRef name, void *ptr) {
+  assert(runtimeDylib);
+  llvm::orc::MangleAndInterner mangler(jit->getExecutionSession(),
+                                       jit->getDataLayout());
+  llvm::orc::SymbolMap symbols;
+  symbols[mangler(name)] = llvm::orc::ExecutorSymbolDef(
+      llvm::orc::ExecutorAddr::fromPtr(ptr), llvm::JITSymbolFlags::Exported);
+  llvm::consumeError(
+      runtimeDylib->define(llvm::orc::absoluteSymbols(std::move(symbols))));
 }
 
 void numba::ExecutionEngine::releaseModule(ModuleHandle handle) {
   assert(handle);
+  {
+    // Other modules can link against shared callees of this one.
+    std::lock_guard<std::mutex> lock(sharedMutex);
+    if (pinnedDylibs.contains(static_cast<llvm::orc::JITDylib *>(handle)))
+      return;
+  }
+  if (lazyCompile) {
+    std::lock_guard<std::mutex> lock(lazyMutex);
+    lazySymbols.erase(handle);
+  }
+  if (backgroundCompiler) {
+    std::unique_ptr<PgoState> pgo;
+    {
+      std::lock_guard<std::mutex> lock(pgoMutex);
+      auto it = pgoStates.find(handle);
+      if (it != pgoStates.end()) {
+        pgo = std::move(it->second);
+        pgoStates.erase(it);
+      }
+    }
+    // Module wasn't called enough times, optimized version was never
+    // compiled.
+    if (pgo && !pgo->triggered.exchange(true))
+      removeDylib(*pgo->fullDylib);
+
+    if (auto fullDylib = backgroundCompiler->wait(handle)) {
+      llvm::cantFail(jit->deinitialize(*fullDylib));
+      removeDylib(*fullDylib);
+    }
+  }
+
   auto dylib = static_cast<llvm::orc::JITDylib *>(handle);
   llvm::cantFail(jit->deinitialize(*dylib));
-  llvm::cantFail(jit->getExecutionSession().removeJITDylib(*dylib));
+  removeDylib(*dylib);
+}
+
+llvm::Error numba::ExecutionEngine::finishCompilation() {
+  llvm::SmallVector<std::pair<ModuleHandle, llvm::orc::SymbolLookupSet>> lazy;
+  {
+    std::lock_guard<std::mutex> lock(lazyMutex);
+    for (auto &it : lazySymbols)
+      lazy.emplace_back(it.first, it.second);
+  }
+  for (auto &&[handle, symbols] : lazy) {
+    // Module dylib only contains lazy reexports, CompileOnDemandLayer adds
+    // function bodies to the `<name>.impl` dylib. Reexports are resolved to
+    // the already compiled bodies on the first call.
+    auto dylib = static_cast<llvm::orc::JITDylib *>(handle);
+    auto impl = jit->getJITDylibByName((dylib->getName() + ".impl").str());
+    if (!impl)
+      continue;
+
+    auto res = jit->getExecutionSession().lookup(
+        llvm::orc::makeJITDylibSearchOrder(impl), std::move(symbols));
+    if (!res)
+      return res.takeError();
+  }
+
+  if (!backgroundCompiler)
+    return llvm::Error::success();
+
+  // Optimized versions are compiled with the counts, collected so far.
+  {
+    std::lock_guard<std::mutex> lock(pgoMutex);
+    for (auto &it : pgoStates)
+      triggerPgo(it.second.get());
+  }
+  backgroundCompiler->waitAll();
+  return llvm::Error::success();
+}
+
+void numba::ExecutionEngine::beforeFork() {
+  if (backgroundCompiler)
+    backgroundCompiler->pause();
+}
+
+void numba::ExecutionEngine::afterForkParent() {
+  if (backgroundCompiler)
+    backgroundCompiler->resume();
+}
+
+void numba::ExecutionEngine::afterForkChild() {
+  if (!backgroundCompiler)
+    return;
+
+  auto compiler = std::make_unique<BackgroundCompiler>();
+  compiler->takePending(*backgroundCompiler);
+
+  // Old compiler thread can't be joined in the child, leak it.
+  (void)backgroundCompiler.release();
+  backgroundCompiler = std::move(compiler);
 }
 
 llvm::Expected<void *>
@@ -869,3 +2289,74 @@ void numba::ExecutionEngine::dumpToObjectFile(llvm::StringRef filename) {
   }
   cache->dumpToObjectFile(filename);
 }
+
+llvm::Error numba::ExecutionEngine::emitObjectFile(mlir::ModuleOp m,
+                                                   llvm::StringRef filename,
+                                                   llvm::StringRef cpu) {
+  auto tsmOrErr = translateModule(m, filename, /*profile*/ nullptr);
+  if (!tsmOrErr)
+    return tsmOrErr.takeError();
+
+  auto tmBuilder = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!tmBuilder)
+    return tmBuilder.takeError();
+
+  if (jitCodeGenOptLevel)
+    tmBuilder->setCodeGenOptLevel(*jitCodeGenOptLevel);
+
+  setCodeModel(*tmBuilder, codeModel);
+
+  // Host features are dropped, so CPU defaults are used.
+  if (!cpu.empty()) {
+    tmBuilder->setCPU(cpu.str());
+    tmBuilder->getFeatures() = llvm::SubtargetFeatures();
+  }
+
+  auto tm = tmBuilder->createTargetMachine();
+  if (!tm)
+    return tm.takeError();
+
+  // Printers are not used, object is not loaded into the current process.
+  CustomCompiler compiler(
+      nullptr, nullptr, std::move(*tm),
+      OptimizationPipeline::Options{tapirTarget, tapirAbiBitcodePath,
+                                    vectorLibrary, llvmVectorization});
+  auto obj = tsmOrErr->withModuleDo(
+      [&](llvm::Module &module) { return compiler(module); });
+  if (!obj)
+    return obj.takeError();
+
+  std::error_code ec;
+  llvm::raw_fd_ostream os(filename, ec, llvm::sys::fs::OF_None);
+  if (ec)
+    return makeStringError(llvm::Twine("could not open ") + filename + ": " +
+                           ec.message());
+
+  os << (*obj)->getBuffer();
+  return llvm::Error::success();
+}
+
+llvm::Expected<numba::ExecutionEngine::ModuleHandle>
+numba::ExecutionEngine::loadObjectFile(llvm::StringRef filename) {
+  auto buffer = llvm::MemoryBuffer::getFile(filename);
+  if (!buffer)
+    return makeStringError(llvm::Twine("could not read ") + filename + ": " +
+                           buffer.getError().message());
+
+  auto dylibOrErr = createDylib();
+  if (!dylibOrErr)
+    return dylibOrErr.takeError();
+
+  auto dylib = *dylibOrErr;
+  if (auto err = jit->addObjectFile(*dylib, std::move(*buffer))) {
+    removeDylib(*dylib);
+    return std::move(err);
+  }
+
+  if (auto err = jit->initialize(*dylib)) {
+    removeDylib(*dylib);
+    return std::move(err);
+  }
+
+  return static_cast<ModuleHandle>(dylib);
+}
@@ -0,0 +1,309 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/BalanceCsrLoops.hpp"
+
+#include "numba/Dialect/numba_util/Dialect.hpp"
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/IR/IRMapping.h>
+#include <mlir/Pass/Pass.h>
+
+/// Loops inside GPU regions get smaller chunks, as they are distributed
+/// between much larger number of work items.
+static bool isGPULoop(mlir::scf::ParallelOp loop) {
+  auto parent = loop->getParentOfType<numba::util::EnvironmentRegionOp>();
+  while (parent) {
+    if (!mlir::isa<numba::util::ParallelAttr>(parent.getEnvironment()))
+      return true;
+
+    parent = parent->getParentOfType<numba::util::EnvironmentRegionOp>();
+  }
+  return false;
+}
+
+/// Index arithmetic can be done in the integer type for the Python loops.
+static mlir::Value skipIndexCasts(mlir::Value val) {
+  while (auto op = val.getDefiningOp()) {
+    if (!mlir::isa<mlir::arith::IndexCastOp, mlir::arith::IndexCastUIOp>(op))
+      break;
+
+    val = op->getOperand(0);
+  }
+  return val;
+}
+
+/// Checks if `val` is `iv`.
+static bool isIndex(mlir::Value val, mlir::Value iv) {
+  return skipIndexCasts(val) == iv;
+}
+
+/// Checks if `val` is `iv + 1`.
+static bool isNextIndex(mlir::Value val, mlir::Value iv) {
+  auto add = skipIndexCasts(val).getDefiningOp<mlir::arith::AddIOp>();
+  if (!add)
+    return false;
+
+  auto lhs = add.getLhs();
+  auto rhs = add.getRhs();
+  return (isIndex(lhs, iv) && mlir::isConstantIntValue(rhs, 1)) ||
+         (isIndex(rhs, iv) && mlir::isConstantIntValue(lhs, 1));
+}
+
+/// Max number of casts and arith ops between the row extent load and its use
+/// as loop bound or subview size.
+static constexpr unsigned MaxExtentUseDepth = 4;
+
+/// Checks if `val` is used (possibly through casts and arithmetic) as the
+/// `scf.for` upper bound or `memref.subview` size, i.e. as row extent and not
+/// just as data, like in `b[i] = a[i + 1] - a[i]`.
+static bool isUsedAsExtent(mlir::Value val, unsigned depth = 0) {
+  if (depth > MaxExtentUseDepth)
+    return false;
+
+  for (auto &use : val.getUses()) {
+    auto user = use.getOwner();
+    if (auto forOp = mlir::dyn_cast<mlir::scf::ForOp>(user)) {
+      if (forOp.getUpperBound() == val)
+        return true;
+
+      continue;
+    }
+
+    if (auto subview = mlir::dyn_cast<mlir::memref::SubViewOp>(user)) {
+      if (llvm::is_contained(subview.getSizes(), val))
+        return true;
+
+      continue;
+    }
+
+    if (mlir::isa<mlir::arith::IndexCastOp, mlir::arith::IndexCastUIOp,
+                  mlir::arith::ExtSIOp, mlir::arith::ExtUIOp,
+                  mlir::arith::TruncIOp, mlir::arith::SubIOp,
+                  mlir::arith::MinSIOp, mlir::arith::MinUIOp>(user) &&
+        isUsedAsExtent(user->getResult(0), depth + 1))
+      return true;
+  }
+  return false;
+}
+
+/// Returns `indptr` memref if the loop body reads rows extents
+/// `indptr[i]` and `indptr[i + 1]` and uses them as inner loop bounds or
+/// slice sizes, null otherwise.
+static mlir::Value getRowPtrs(mlir::scf::ParallelOp loop) {
+  if (loop.getNumLoops() != 1 || loop.getNumResults() != 0 ||
+      !mlir::isConstantIntValue(loop.getStep().front(), 1))
+    return {};
+
+  auto iv = loop.getInductionVars().front();
+  mlir::Value ret;
+  loop.getBody()->walk([&](mlir::memref::LoadOp load) {
+    auto memref = load.getMemRef();
+    if (load.getIndices().size() != 1 ||
+        !isNextIndex(load.getIndices().front(), iv) ||
+        loop.getRegion().isAncestor(memref.getParentRegion()) ||
+        !isUsedAsExtent(load.getResult()))
+      return mlir::WalkResult::advance();
+
+    for (auto user : memref.getUsers()) {
+      auto other = mlir::dyn_cast<mlir::memref::LoadOp>(user);
+      if (other && other.getIndices().size() == 1 &&
+          isIndex(other.getIndices().front(), iv) && loop->isAncestor(other)) {
+        ret = memref;
+        return mlir::WalkResult::interrupt();
+      }
+    }
+    return mlir::WalkResult::advance();
+  });
+
+  if (!ret)
+    return {};
+
+  auto elemType = mlir::cast<mlir::MemRefType>(ret.getType()).getElementType();
+  if (!elemType.isSignlessInteger() && !mlir::isa<mlir::IndexType>(elemType))
+    return {};
+
+  // Row pointers must not be modified by the loop.
+  for (auto user : ret.getUsers())
+    if (loop->isAncestor(user) && !mlir::isa<mlir::memref::LoadOp>(user))
+      return {};
+
+  return ret;
+}
+
+static mlir::Value loadIndex(mlir::OpBuilder &builder, mlir::Location loc,
+                             mlir::Value memref, mlir::Value index) {
+  mlir::Value val = builder.create<mlir::memref::LoadOp>(loc, memref, index);
+  if (mlir::isa<mlir::IndexType>(val.getType()))
+    return val;
+
+  // Row pointers are non-negative, so unsigned cast is correct for both
+  // signed and unsigned source types.
+  return builder.create<mlir::arith::IndexCastUIOp>(
+      loc, builder.getIndexType(), val);
+}
+
+/// Returns first row in `[lower, upper]` with `indptr[row] >= target`.
+static mlir::Value findRow(mlir::OpBuilder &builder, mlir::Location loc,
+                           mlir::Value rowPtrs, mlir::Value lower,
+                           mlir::Value upper, mlir::Value target) {
+  mlir::Value inits[] = {lower, upper};
+  mlir::Type types[] = {lower.getType(), upper.getType()};
+  auto beforeBody = [&](mlir::OpBuilder &b, mlir::Location l,
+                        mlir::ValueRange args) {
+    mlir::Value cond = b.create<mlir::arith::CmpIOp>(
+        l, mlir::arith::CmpIPredicate::ult, args[0], args[1]);
+    b.create<mlir::scf::ConditionOp>(l, cond, args);
+  };
+  auto afterBody = [&](mlir::OpBuilder &b, mlir::Location l,
+                       mlir::ValueRange args) {
+    auto lo = args[0];
+    auto hi = args[1];
+    mlir::Value one = b.create<mlir::arith::ConstantIndexOp>(l, 1);
+    mlir::Value sum = b.create<mlir::arith::AddIOp>(l, lo, hi);
+    mlir::Value mid = b.create<mlir::arith::ShRUIOp>(l, sum, one);
+    auto val = loadIndex(b, l, rowPtrs, mid);
+    mlir::Value less = b.create<mlir::arith::CmpIOp>(
+        l, mlir::arith::CmpIPredicate::ult, val, target);
+    mlir::Value next = b.create<mlir::arith::AddIOp>(l, mid, one);
+    mlir::Value newLo = b.create<mlir::arith::SelectOp>(l, less, next, lo);
+    mlir::Value newHi = b.create<mlir::arith::SelectOp>(l, less, hi, mid);
+    b.create<mlir::scf::YieldOp>(l, mlir::ValueRange{newLo, newHi});
+  };
+  auto loop = builder.create<mlir::scf::WhileOp>(loc, types, inits,
+                                                 beforeBody, afterBody);
+  return loop.getResult(0);
+}
+
+static void buildBalancedLoop(mlir::OpBuilder &builder, mlir::Location loc,
+                              mlir::scf::ParallelOp loop, mlir::Value rowPtrs,
+                              unsigned nnzPerChunk) {
+  auto lower = loop.getLowerBound().front();
+  auto upper = loop.getUpperBound().front();
+
+  auto firstNnz = loadIndex(builder, loc, rowPtrs, lower);
+  auto lastNnz = loadIndex(builder, loc, rowPtrs, upper);
+  mlir::Value nnz = builder.create<mlir::arith::SubIOp>(loc, lastNnz, firstNnz);
+  mlir::Value rows = builder.create<mlir::arith::SubIOp>(loc, upper, lower);
+
+  // Number of chunks is clamped to [1, rows].
+  mlir::Value zero = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  mlir::Value one = builder.create<mlir::arith::ConstantIndexOp>(loc, 1);
+  mlir::Value chunkSize =
+      builder.create<mlir::arith::ConstantIndexOp>(loc, nnzPerChunk);
+  mlir::Value numChunks =
+      builder.create<mlir::arith::DivUIOp>(loc, nnz, chunkSize);
+  numChunks = builder.create<mlir::arith::MinUIOp>(loc, numChunks, rows);
+  numChunks = builder.create<mlir::arith::MaxUIOp>(loc, numChunks, one);
+
+  auto getChunkBegin = [&](mlir::OpBuilder &b, mlir::Location l,
+                           mlir::Value chunk) -> mlir::Value {
+    mlir::Value offset = b.create<mlir::arith::MulIOp>(l, nnz, chunk);
+    offset = b.create<mlir::arith::DivUIOp>(l, offset, numChunks);
+    mlir::Value target = b.create<mlir::arith::AddIOp>(l, firstNnz, offset);
+    return findRow(b, l, rowPtrs, lower, upper, target);
+  };
+
+  auto bodyBuilder = [&](mlir::OpBuilder &b, mlir::Location l,
+                         mlir::ValueRange ivs) {
+    auto chunk = ivs.front();
+    auto begin = getChunkBegin(b, l, chunk);
+
+    // Last chunk must include trailing empty rows.
+    mlir::Value nextChunk = b.create<mlir::arith::AddIOp>(l, chunk, one);
+    mlir::Value isLast = b.create<mlir::arith::CmpIOp>(
+        l, mlir::arith::CmpIPredicate::eq, nextChunk, numChunks);
+    auto thenBody = [&](mlir::OpBuilder &ib, mlir::Location il) {
+      ib.create<mlir::scf::YieldOp>(il, upper);
+    };
+    auto elseBody = [&](mlir::OpBuilder &ib, mlir::Location il) {
+      ib.create<mlir::scf::YieldOp>(il, getChunkBegin(ib, il, nextChunk));
+    };
+    mlir::Value end =
+        b.create<mlir::scf::IfOp>(l, isLast, thenBody, elseBody).getResult(0);
+
+    auto rowBody = [&](mlir::OpBuilder &fb, mlir::Location fl, mlir::Value iv,
+                       mlir::ValueRange) {
+      mlir::IRMapping mapping;
+      mapping.map(loop.getInductionVars().front(), iv);
+      for (auto &op : loop.getBody()->without_terminator())
+        fb.clone(op, mapping);
+
+      fb.create<mlir::scf::YieldOp>(fl);
+    };
+    b.create<mlir::scf::ForOp>(l, begin, end, one, std::nullopt, rowBody);
+  };
+
+  auto newLoop = builder.create<mlir::scf::ParallelOp>(
+      loc, mlir::ValueRange(zero), mlir::ValueRange(numChunks),
+      mlir::ValueRange(one), bodyBuilder);
+  newLoop->setDiscardableAttrs(loop->getDiscardableAttrDictionary());
+}
+
+static void balanceLoop(mlir::scf::ParallelOp loop, mlir::Value rowPtrs,
+                        unsigned nnzPerChunk) {
+  mlir::OpBuilder builder(loop);
+  auto loc = loop.getLoc();
+
+  // `indptr[upper]` is only accessed by the original loop if it has any
+  // iterations.
+  mlir::Value notEmpty = builder.create<mlir::arith::CmpIOp>(
+      loc, mlir::arith::CmpIPredicate::ult, loop.getLowerBound().front(),
+      loop.getUpperBound().front());
+  auto thenBody = [&](mlir::OpBuilder &b, mlir::Location l) {
+    buildBalancedLoop(b, l, loop, rowPtrs, nnzPerChunk);
+    b.create<mlir::scf::YieldOp>(l);
+  };
+  builder.create<mlir::scf::IfOp>(loc, notEmpty, thenBody);
+  loop->erase();
+}
+
+namespace {
+struct BalanceCsrLoopsPass
+    : public mlir::PassWrapper<BalanceCsrLoopsPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(BalanceCsrLoopsPass)
+
+  BalanceCsrLoopsPass(unsigned cpuChunk, unsigned gpuChunk)
+      : cpuNnzPerChunk(cpuChunk), gpuNnzPerChunk(gpuChunk) {}
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<std::pair<mlir::scf::ParallelOp, mlir::Value>> toBalance;
+    getOperation()->walk([&](mlir::scf::ParallelOp loop) {
+      if (loop->getParentOfType<mlir::scf::ParallelOp>())
+        return;
+
+      if (auto rowPtrs = getRowPtrs(loop))
+        toBalance.emplace_back(loop, rowPtrs);
+    });
+
+    if (toBalance.empty())
+      return markAllAnalysesPreserved();
+
+    for (auto &&[loop, rowPtrs] : toBalance)
+      balanceLoop(loop, rowPtrs,
+                  isGPULoop(loop) ? gpuNnzPerChunk : cpuNnzPerChunk);
+  }
+
+private:
+  unsigned cpuNnzPerChunk;
+  unsigned gpuNnzPerChunk;
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass>
+numba::createBalanceCsrLoopsPass(unsigned cpuNnzPerChunk,
+                                 unsigned gpuNnzPerChunk) {
+  return std::make_unique<BalanceCsrLoopsPass>(cpuNnzPerChunk, gpuNnzPerChunk);
+}
@@ -4,10 +4,12 @@
 
 #include "numba/Transforms/CommonOpts.hpp"
 
+#include "numba/Analysis/MemorySsaAnalysis.hpp"
 #include "numba/Transforms/IfRewrites.hpp"
 #include "numba/Transforms/IndexTypePropagation.hpp"
 #include "numba/Transforms/LoopRewrites.hpp"
 
+#include <mlir/Analysis/AliasAnalysis.h>
 #include <mlir/Dialect/Arith/IR/Arith.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
 #include <mlir/Dialect/GPU/IR/GPUDialect.h>
@@ -1360,9 +1362,17 @@ struct CommonOptsPass
 
     numba::populateCommonOptsPatterns(patterns);
 
-    if (mlir::failed(mlir::applyPatternsAndFoldGreedily(getOperation(),
-                                                        std::move(patterns))))
+    auto am = getAnalysisManager();
+    numba::MemorySSAUpdater updater(am);
+    mlir::GreedyRewriteConfig config;
+    config.listener = &updater;
+    if (mlir::failed(mlir::applyPatternsAndFoldGreedily(
+            getOperation(), std::move(patterns), config)))
       return signalPassFailure();
+
+    // Don't rebuild memory SSA if cleanups didn't touch memory.
+    if (!updater.isInvalidated())
+      markAnalysesPreserved<numba::MemorySSAAnalysis, mlir::AliasAnalysis>();
   }
 };
 } // namespace
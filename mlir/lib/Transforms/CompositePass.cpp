@@ -7,42 +7,79 @@
 #include "mlir/Pass/PassManager.h"
 #include <mlir/Pass/Pass.h>
 
+#include <algorithm>
+#include <atomic>
+#include <optional>
+
+static std::atomic<unsigned> compositeMaxIters = 10;
+
 namespace {
 struct CompositePass
     : public mlir::PassWrapper<CompositePass, mlir::OperationPass<void>> {
   MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(CompositePass)
 
   CompositePass(std::string name_,
-                std::function<void(mlir::OpPassManager &)> func)
-      : name(std::move(name_)), populateFunc(std::move(func)) {}
+                std::vector<numba::CompositePassPopulateFunc> funcs)
+      : name(std::move(name_)), populateFuncs(std::move(funcs)) {}
+
+  CompositePass(const CompositePass &other)
+      : PassWrapper(other), name(other.name),
+        populateFuncs(other.populateFuncs) {}
 
   void runOnOperation() override {
-    assert(populateFunc);
+    assert(!populateFuncs.empty());
     auto op = getOperation();
     mlir::OperationFingerPrint fp(op);
 
-    int currentIter = 0;
-    int maxIters = 10;
+    llvm::SmallVector<mlir::OpPassManager> pipelines;
+    pipelines.reserve(populateFuncs.size());
+    for (auto &func : populateFuncs) {
+      auto &pm = pipelines.emplace_back(op->getName());
+      func(pm);
+    }
+
+    // IR fingerprint after the last run of each sub-pipeline, if this run
+    // didn't change anything.
+    llvm::SmallVector<std::optional<mlir::OperationFingerPrint>> unchangedAt(
+        pipelines.size());
 
-    mlir::OpPassManager dynamicPM(op->getName());
-    populateFunc(dynamicPM);
+    unsigned maxIters = std::max(numba::getCompositePassMaxIterations(), 1u);
+    unsigned currentIter = 0;
     while (true) {
-      if (mlir::failed(runPipeline(dynamicPM, op)))
-        return signalPassFailure();
+      ++currentIter;
+      bool changed = false;
+      for (auto &&[pm, lastFp] : llvm::zip(pipelines, unchangedAt)) {
+        if (lastFp && *lastFp == fp) {
+          ++numSkipped;
+          continue;
+        }
 
-      if (currentIter++ >= maxIters) {
-        op->emitWarning("Composite pass \"" + llvm::Twine(name) +
-                        "\"+ didn't converge in " + llvm::Twine(maxIters) +
-                        " iterations");
-        break;
+        if (mlir::failed(runPipeline(pm, op)))
+          return signalPassFailure();
+
+        ++numRuns;
+        mlir::OperationFingerPrint newFp(op);
+        if (newFp == fp) {
+          lastFp = newFp;
+        } else {
+          lastFp = std::nullopt;
+          fp = newFp;
+          changed = true;
+        }
       }
 
-      mlir::OperationFingerPrint newFp(op);
-      if (newFp == fp)
+      if (!changed)
         break;
 
-      fp = newFp;
+      if (currentIter >= maxIters) {
+        op->emitWarning("Composite pass \"" + llvm::Twine(name) +
+                        "\" didn't converge in " + llvm::Twine(maxIters) +
+                        " iterations");
+        break;
+      }
     }
+    numIterations += currentIter;
+    maxIterations.updateMax(currentIter);
   }
 
 protected:
@@ -53,14 +90,39 @@ protected:
 
 private:
   std::string name;
-  std::function<void(mlir::OpPassManager &)> populateFunc;
+  std::vector<numba::CompositePassPopulateFunc> populateFuncs;
+
+  Statistic numIterations{this, "num-iterations",
+                          "Total number of fixed point iterations"};
+  Statistic maxIterations{this, "max-iterations",
+                          "Maximum number of iterations in a single run"};
+  Statistic numRuns{this, "num-runs", "Number of sub-pipeline runs"};
+  Statistic numSkipped{this, "num-skipped",
+                       "Number of sub-pipeline runs skipped as IR was "
+                       "unchanged"};
 };
 } // namespace
 
+std::unique_ptr<mlir::Pass>
+numba::createCompositePass(std::string name,
+                           CompositePassPopulateFunc populateFunc) {
+  assert(populateFunc);
+  std::vector<CompositePassPopulateFunc> funcs;
+  funcs.emplace_back(std::move(populateFunc));
+  return createCompositePass(std::move(name), std::move(funcs));
+}
+
 std::unique_ptr<mlir::Pass> numba::createCompositePass(
-    std::string name, std::function<void(mlir::OpPassManager &)> populateFunc) {
+    std::string name, std::vector<CompositePassPopulateFunc> subPipelines) {
   assert(!name.empty());
-  assert(populateFunc);
+  assert(!subPipelines.empty());
+  assert(llvm::all_of(subPipelines, [](auto &func) { return !!func; }));
   return std::make_unique<CompositePass>(std::move(name),
-                                         std::move(populateFunc));
+                                         std::move(subPipelines));
 }
+
+void numba::setCompositePassMaxIterations(unsigned maxIters) {
+  compositeMaxIters = maxIters;
+}
+
+unsigned numba::getCompositePassMaxIterations() { return compositeMaxIters; }
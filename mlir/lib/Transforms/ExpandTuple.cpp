@@ -9,8 +9,12 @@
 
 #include <mlir/Dialect/Arith/IR/Arith.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
 #include <mlir/Transforms/DialectConversion.h>
 #include <mlir/Transforms/Passes.h>
+#include <mlir/Transforms/RegionUtils.h>
+
+#include <llvm/ADT/SetVector.h>
 
 namespace {
 static void flattenTuple(mlir::OpBuilder &builder, mlir::Location loc,
@@ -109,6 +113,52 @@ static std::optional<mlir::Value> tupleToElem(mlir::OpBuilder &builder,
   return result;
 }
 
+/// Regions, which are outlined later and get captured values through the
+/// context structure.
+static bool isOutlinedRegion(mlir::Operation *op) {
+  return mlir::isa<mlir::scf::ParallelOp, numba::util::EnvironmentRegionOp>(
+      op);
+}
+
+/// Capture tuple elements instead of the tuples and rebuild tuples inside
+/// the outlined regions, so `tuple_extract`s are folded and outlined bodies
+/// get flattened arrays and scalars instead of packed tuples.
+static void expandCapturedTuples(mlir::Operation *root) {
+  llvm::SmallVector<mlir::Operation *> regionOps;
+  root->walk([&](mlir::Operation *op) {
+    if (isOutlinedRegion(op))
+      regionOps.emplace_back(op);
+  });
+
+  mlir::OpBuilder builder(root->getContext());
+  for (auto regionOp : regionOps) {
+    llvm::SetVector<mlir::Value> captured;
+    mlir::visitUsedValuesDefinedAbove(
+        regionOp->getRegions(), [&](mlir::OpOperand *operand) {
+          if (mlir::isa<mlir::TupleType>(operand->get().getType()))
+            captured.insert(operand->get());
+        });
+
+    auto loc = regionOp->getLoc();
+    for (auto tuple : captured) {
+      builder.setInsertionPoint(regionOp);
+      llvm::SmallVector<mlir::Value> elems;
+      flattenTuple(builder, loc, tuple, elems);
+
+      auto tupleType = mlir::cast<mlir::TupleType>(tuple.getType());
+      for (auto &region : regionOp->getRegions()) {
+        if (region.empty())
+          continue;
+
+        builder.setInsertionPointToStart(&region.front());
+        auto newTuple = reconstructTuple(builder, loc, tupleType, elems);
+        assert(newTuple && "Failed to rebuild tuple");
+        mlir::replaceAllUsesInRegionWith(tuple, *newTuple, region);
+      }
+    }
+  }
+}
+
 struct ExpandTuplePass
     : public mlir::PassWrapper<ExpandTuplePass, mlir::OperationPass<void>> {
   MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(ExpandTuplePass)
@@ -116,12 +166,14 @@ struct ExpandTuplePass
   virtual void
   getDependentDialects(mlir::DialectRegistry &registry) const override {
     registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
     registry.insert<numba::util::NumbaUtilDialect>();
   }
 
   void runOnOperation() override {
     auto module = getOperation();
     auto *context = &getContext();
+    expandCapturedTuples(module);
 
     mlir::TypeConverter typeConverter;
     // Convert unknown types to itself
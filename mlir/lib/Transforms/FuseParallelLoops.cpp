@@ -0,0 +1,189 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/FuseParallelLoops.hpp"
+
+#include "numba/Analysis/AliasAnalysis.hpp"
+#include "numba/Dialect/numba_util/Dialect.hpp"
+
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/IR/IRMapping.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+namespace {
+struct MemAccesses {
+  llvm::SmallVector<mlir::memref::LoadOp> loads;
+  llvm::SmallVector<mlir::memref::StoreOp> stores;
+};
+} // namespace
+
+/// Collects loop memory accesses, returns false if loop has any memory
+/// effects except plain loads and stores.
+static bool collectAccesses(mlir::scf::ParallelOp loop, MemAccesses &ret) {
+  auto visitor = [&](mlir::Operation *op) -> mlir::WalkResult {
+    if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op)) {
+      ret.loads.emplace_back(load);
+      return mlir::WalkResult::advance();
+    }
+    if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(op)) {
+      ret.stores.emplace_back(store);
+      return mlir::WalkResult::advance();
+    }
+
+    // Nested ops are checked separately.
+    if (op->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>())
+      return mlir::WalkResult::advance();
+
+    if (mlir::isMemoryEffectFree(op))
+      return mlir::WalkResult::advance();
+
+    return mlir::WalkResult::interrupt();
+  };
+  return !loop.getBody()->walk(visitor).wasInterrupted();
+}
+
+static bool isEqual(mlir::Value lhs, mlir::Value rhs) {
+  if (lhs == rhs)
+    return true;
+
+  auto lhsConst = mlir::getConstantIntValue(lhs);
+  auto rhsConst = mlir::getConstantIntValue(rhs);
+  return lhsConst && rhsConst && *lhsConst == *rhsConst;
+}
+
+static bool canFuse(mlir::scf::ParallelOp producer,
+                    mlir::scf::ParallelOp consumer,
+                    numba::LocalAliasAnalysis &aa) {
+  if (producer.getNumResults() != 0 || consumer.getNumResults() != 0)
+    return false;
+
+  // Parfor loops were already fused by Numba parfor pass.
+  auto parforLowered = numba::util::attributes::getParforLoweredName();
+  if (producer->hasAttr(parforLowered) || consumer->hasAttr(parforLowered))
+    return false;
+
+  auto numLoops = producer.getNumLoops();
+  if (consumer.getNumLoops() <= numLoops)
+    return false;
+
+  for (auto i : llvm::seq(0u, numLoops)) {
+    if (!isEqual(producer.getLowerBound()[i], consumer.getLowerBound()[i]) ||
+        !isEqual(producer.getUpperBound()[i], consumer.getUpperBound()[i]) ||
+        !isEqual(producer.getStep()[i], consumer.getStep()[i]))
+      return false;
+  }
+
+  MemAccesses producerAccesses;
+  MemAccesses consumerAccesses;
+  if (!collectAccesses(producer, producerAccesses) ||
+      !collectAccesses(consumer, consumerAccesses))
+    return false;
+
+  // Consumer must not write anything producer touches.
+  for (auto store : consumerAccesses.stores) {
+    auto memref = store.getMemRef();
+    for (auto load : producerAccesses.loads)
+      if (!aa.alias(memref, load.getMemRef()).isNo())
+        return false;
+
+    for (auto other : producerAccesses.stores)
+      if (!aa.alias(memref, other.getMemRef()).isNo())
+        return false;
+  }
+
+  // Consumer can only read producer results, computed on the same iteration
+  // of the leading dimensions.
+  auto producerIvs = producer.getInductionVars();
+  auto consumerIvs = consumer.getInductionVars().take_front(numLoops);
+  for (auto store : producerAccesses.stores) {
+    auto memref = store.getMemRef();
+    for (auto load : consumerAccesses.loads) {
+      if (aa.alias(memref, load.getMemRef()).isNo())
+        continue;
+
+      if (memref != load.getMemRef())
+        return false;
+
+      if (!llvm::equal(store.getIndices(), producerIvs) ||
+          !llvm::equal(load.getIndices(), consumerIvs))
+        return false;
+    }
+  }
+  return true;
+}
+
+static void fuse(mlir::scf::ParallelOp producer,
+                 mlir::scf::ParallelOp consumer) {
+  auto numLoops = producer.getNumLoops();
+
+  // Only memory effect free ops are allowed between producer and consumer.
+  producer->moveBefore(consumer);
+
+  mlir::OpBuilder builder(producer.getBody()->getTerminator());
+  auto inner = builder.create<mlir::scf::ParallelOp>(
+      consumer.getLoc(), consumer.getLowerBound().drop_front(numLoops),
+      consumer.getUpperBound().drop_front(numLoops),
+      consumer.getStep().drop_front(numLoops));
+
+  auto consumerIvs = consumer.getInductionVars();
+  mlir::IRMapping mapping;
+  mapping.map(consumerIvs.take_front(numLoops), producer.getInductionVars());
+  mapping.map(consumerIvs.drop_front(numLoops), inner.getInductionVars());
+
+  builder.setInsertionPoint(inner.getBody()->getTerminator());
+  for (auto &op : consumer.getBody()->without_terminator())
+    builder.clone(op, mapping);
+
+  consumer->erase();
+}
+
+static mlir::scf::ParallelOp getNextLoop(mlir::scf::ParallelOp loop) {
+  auto block = loop->getBlock();
+  for (auto it = std::next(loop->getIterator()); it != block->end(); ++it) {
+    if (auto next = mlir::dyn_cast<mlir::scf::ParallelOp>(*it))
+      return next;
+
+    if (!mlir::isMemoryEffectFree(&*it))
+      break;
+  }
+  return nullptr;
+}
+
+namespace {
+struct FuseParallelLoopsPass
+    : public mlir::PassWrapper<FuseParallelLoopsPass,
+                               mlir::InterfacePass<mlir::FunctionOpInterface>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FuseParallelLoopsPass)
+
+  void runOnOperation() override {
+    numba::LocalAliasAnalysis aa;
+    bool changed = false;
+    while (true) {
+      auto visitor = [&](mlir::scf::ParallelOp loop) -> mlir::WalkResult {
+        auto next = getNextLoop(loop);
+        if (!next || !canFuse(loop, next, aa))
+          return mlir::WalkResult::advance();
+
+        fuse(loop, next);
+        return mlir::WalkResult::interrupt();
+      };
+      if (!getOperation()->walk(visitor).wasInterrupted())
+        break;
+
+      changed = true;
+    }
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> numba::createFuseParallelLoopsPass() {
+  return std::make_unique<FuseParallelLoopsPass>();
+}
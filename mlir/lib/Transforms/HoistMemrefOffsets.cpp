@@ -0,0 +1,147 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/HoistMemrefOffsets.hpp"
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Interfaces/LoopLikeInterface.h>
+#include <mlir/Pass/Pass.h>
+
+namespace {
+struct HoistedView {
+  mlir::Value memref;
+  llvm::SmallVector<mlir::Value> indices;
+  mlir::Value view;
+};
+} // namespace
+
+static bool checkLayout(mlir::MemRefType type) {
+  return type.getLayout().isIdentity() ||
+         mlir::isa<mlir::StridedLayoutAttr>(type.getLayout());
+}
+
+/// Returns true if access must be rewritten, i.e. memref and all indices
+/// except the last one are loop invariant, and the last one is not.
+static bool canHoist(mlir::LoopLikeOpInterface loop, mlir::Operation *op,
+                     mlir::Value memref, mlir::ValueRange indices) {
+  if (op->getParentOfType<mlir::LoopLikeOpInterface>() != loop)
+    return false;
+
+  auto type = mlir::cast<mlir::MemRefType>(memref.getType());
+  if (type.getRank() < 2 || !checkLayout(type))
+    return false;
+
+  if (!loop.isDefinedOutsideOfLoop(memref) ||
+      loop.isDefinedOutsideOfLoop(indices.back()))
+    return false;
+
+  return llvm::all_of(indices.drop_back(), [&](mlir::Value idx) {
+    return loop.isDefinedOutsideOfLoop(idx);
+  });
+}
+
+static mlir::Value createView(mlir::OpBuilder &builder, mlir::Location loc,
+                              mlir::Value memref, mlir::ValueRange indices) {
+  auto srcType = mlir::cast<mlir::MemRefType>(memref.getType());
+  auto rank = srcType.getRank();
+
+  mlir::OpFoldResult zero = builder.getIndexAttr(0);
+  mlir::OpFoldResult one = builder.getIndexAttr(1);
+  llvm::SmallVector<mlir::OpFoldResult> offsets(indices.begin(),
+                                                std::prev(indices.end()));
+  offsets.emplace_back(zero);
+
+  auto innerDim = srcType.getShape().back();
+  mlir::OpFoldResult innerSize;
+  if (mlir::ShapedType::isDynamic(innerDim)) {
+    innerSize =
+        builder.create<mlir::memref::DimOp>(loc, memref, rank - 1).getResult();
+  } else {
+    innerSize = builder.getIndexAttr(innerDim);
+  }
+
+  llvm::SmallVector<mlir::OpFoldResult> sizes(rank, one);
+  sizes.back() = innerSize;
+  llvm::SmallVector<mlir::OpFoldResult> strides(rank, one);
+
+  auto viewType = mlir::memref::SubViewOp::inferRankReducedResultType(
+      innerDim, srcType, offsets, sizes, strides);
+  return builder.create<mlir::memref::SubViewOp>(
+      loc, mlir::cast<mlir::MemRefType>(viewType), memref, offsets, sizes,
+      strides);
+}
+
+static bool hoistOffsets(mlir::LoopLikeOpInterface loop) {
+  llvm::SmallVector<HoistedView> views;
+  auto getView = [&](mlir::Value memref,
+                     mlir::ValueRange indices) -> mlir::Value {
+    auto leading = indices.drop_back();
+    for (auto &view : views)
+      if (view.memref == memref && llvm::equal(view.indices, leading))
+        return view.view;
+
+    mlir::OpBuilder builder(loop);
+    auto view = createView(builder, loop.getLoc(), memref, indices);
+    views.push_back({memref, {leading.begin(), leading.end()}, view});
+    return view;
+  };
+
+  bool changed = false;
+  loop->walk([&](mlir::Operation *op) {
+    if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op)) {
+      auto memref = load.getMemref();
+      auto indices = load.getIndices();
+      if (!canHoist(loop, op, memref, indices))
+        return;
+
+      auto view = getView(memref, indices);
+      mlir::Value idx = indices.back();
+      load.getMemrefMutable().assign(view);
+      load.getIndicesMutable().assign(idx);
+      changed = true;
+    } else if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(op)) {
+      auto memref = store.getMemref();
+      auto indices = store.getIndices();
+      if (!canHoist(loop, op, memref, indices))
+        return;
+
+      auto view = getView(memref, indices);
+      mlir::Value idx = indices.back();
+      store.getMemrefMutable().assign(view);
+      store.getIndicesMutable().assign(idx);
+      changed = true;
+    }
+  });
+  return changed;
+}
+
+namespace {
+struct HoistMemrefOffsetsPass
+    : public mlir::PassWrapper<HoistMemrefOffsetsPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(HoistMemrefOffsetsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::memref::MemRefDialect>();
+  }
+
+  void runOnOperation() override {
+    bool changed = false;
+    getOperation()->walk([&](mlir::LoopLikeOpInterface loop) {
+      if (mlir::isa<mlir::scf::ForOp, mlir::scf::ParallelOp>(loop))
+        changed = hoistOffsets(loop) || changed;
+    });
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> numba::createHoistMemrefOffsetsPass() {
+  return std::make_unique<HoistMemrefOffsetsPass>();
+}
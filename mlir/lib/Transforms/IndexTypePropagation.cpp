@@ -4,9 +4,15 @@
 
 #include "numba/Transforms/IndexTypePropagation.hpp"
 
+#include <mlir/Analysis/DataFlow/IntegerRangeAnalysis.h>
+#include <mlir/Analysis/DataFlowFramework.h>
 #include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/IR/Matchers.h>
 #include <mlir/IR/PatternMatch.h>
 
+#include <limits>
+
 static bool isIndexCompatible(mlir::Type lhsType, mlir::Type rhsType) {
   if (!lhsType.isa<mlir::IntegerType>() || lhsType != rhsType)
     return false;
@@ -135,8 +141,201 @@ struct CmpIndexCastSimplify
     return mlir::failure();
   }
 };
+
+/// Index values, which are proven to fit into this width by the range
+/// analysis, are computed in narrow integers.
+static constexpr unsigned NarrowWidth = 32;
+
+static bool fitsNarrow(int64_t val) {
+  return val >= std::numeric_limits<int32_t>::min() &&
+         val <= std::numeric_limits<int32_t>::max();
+}
+
+static bool fitsNarrow(const mlir::ConstantIntRanges &range) {
+  return fitsNarrow(range.smin().getSExtValue()) &&
+         fitsNarrow(range.smax().getSExtValue());
+}
+
+static std::optional<mlir::ConstantIntRanges>
+getRange(mlir::DataFlowSolver &solver, mlir::Value val) {
+  auto *lattice =
+      solver.lookupState<mlir::dataflow::IntegerValueRangeLattice>(val);
+  if (!lattice || lattice->getValue().isUninitialized())
+    return std::nullopt;
+
+  return lattice->getValue().getValue();
+}
+
+/// Index value, produced by cast from narrow integer.
+static mlir::Value getNarrowSource(mlir::Value val) {
+  auto cast = val.getDefiningOp<mlir::arith::IndexCastOp>();
+  if (!cast || !cast.getIn().getType().isInteger(NarrowWidth))
+    return {};
+
+  return cast.getIn();
+}
+
+/// Values created during rewrite don't have the solver state, so check casts
+/// and constants explicitly.
+static bool fitsNarrow(mlir::DataFlowSolver &solver, mlir::Value val) {
+  if (!mlir::isa<mlir::IndexType>(val.getType()))
+    return false;
+
+  if (getNarrowSource(val))
+    return true;
+
+  llvm::APInt cst;
+  if (mlir::matchPattern(val, mlir::m_ConstantInt(&cst)))
+    return fitsNarrow(cst.getSExtValue());
+
+  auto range = getRange(solver, val);
+  return range && fitsNarrow(*range);
+}
+
+static mlir::Value toNarrow(mlir::OpBuilder &builder, mlir::Location loc,
+                            mlir::Value val) {
+  if (auto src = getNarrowSource(val))
+    return src;
+
+  llvm::APInt cst;
+  if (mlir::matchPattern(val, mlir::m_ConstantInt(&cst)))
+    return builder.create<mlir::arith::ConstantIntOp>(loc, cst.getSExtValue(),
+                                                      NarrowWidth);
+
+  auto type = builder.getIntegerType(NarrowWidth);
+  return builder.create<mlir::arith::IndexCastOp>(loc, type, val);
+}
+
+/// Only narrow ops connected to the already narrowed values, so we don't add
+/// casts around isolated ops.
+static bool hasNarrowSource(mlir::ValueRange values) {
+  return llvm::any_of(values, [](mlir::Value val) {
+    return static_cast<bool>(getNarrowSource(val));
+  });
+}
+
+template <typename Op>
+struct NarrowIndexArith : public mlir::OpRewritePattern<Op> {
+  NarrowIndexArith(mlir::MLIRContext *context, mlir::DataFlowSolver &s)
+      : mlir::OpRewritePattern<Op>(context), solver(s) {}
+
+  mlir::LogicalResult
+  matchAndRewrite(Op op, mlir::PatternRewriter &rewriter) const override {
+    mlir::Value res = op.getResult();
+    if (!mlir::isa<mlir::IndexType>(res.getType()))
+      return mlir::failure();
+
+    // Result must fit too, so narrow op doesn't overflow.
+    auto resRange = getRange(solver, res);
+    if (!resRange || !fitsNarrow(*resRange))
+      return mlir::failure();
+
+    mlir::Value lhs = op.getLhs();
+    mlir::Value rhs = op.getRhs();
+    if (!hasNarrowSource({lhs, rhs}) || !fitsNarrow(solver, lhs) ||
+        !fitsNarrow(solver, rhs))
+      return mlir::failure();
+
+    auto loc = op.getLoc();
+    auto newOp = rewriter.create<Op>(loc, toNarrow(rewriter, loc, lhs),
+                                     toNarrow(rewriter, loc, rhs));
+    rewriter.replaceOpWithNewOp<mlir::arith::IndexCastOp>(
+        op, res.getType(), newOp.getResult());
+    return mlir::success();
+  }
+
+private:
+  mlir::DataFlowSolver &solver;
+};
+
+/// Sign extension preserves both signed and unsigned order, so any predicate
+/// can be narrowed.
+struct NarrowIndexCmp : public mlir::OpRewritePattern<mlir::arith::CmpIOp> {
+  NarrowIndexCmp(mlir::MLIRContext *context, mlir::DataFlowSolver &s)
+      : mlir::OpRewritePattern<mlir::arith::CmpIOp>(context), solver(s) {}
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::arith::CmpIOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto lhs = op.getLhs();
+    auto rhs = op.getRhs();
+    if (!hasNarrowSource({lhs, rhs}) || !fitsNarrow(solver, lhs) ||
+        !fitsNarrow(solver, rhs))
+      return mlir::failure();
+
+    auto loc = op.getLoc();
+    rewriter.replaceOpWithNewOp<mlir::arith::CmpIOp>(
+        op, op.getPredicate(), toNarrow(rewriter, loc, lhs),
+        toNarrow(rewriter, loc, rhs));
+    return mlir::success();
+  }
+
+private:
+  mlir::DataFlowSolver &solver;
+};
+
+/// Narrow induction variable of `scf.for`, index uses are replaced with cast.
+/// Narrowed loop is the source for the narrowing of the index computations in
+/// its body.
+struct NarrowForLoop : public mlir::OpRewritePattern<mlir::scf::ForOp> {
+  NarrowForLoop(mlir::MLIRContext *context, mlir::DataFlowSolver &s)
+      : mlir::OpRewritePattern<mlir::scf::ForOp>(context), solver(s) {}
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::scf::ForOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto iv = op.getInductionVar();
+    if (!mlir::isa<mlir::IndexType>(iv.getType()))
+      return mlir::failure();
+
+    auto lbRange = getRange(solver, op.getLowerBound());
+    auto ubRange = getRange(solver, op.getUpperBound());
+    auto stepRange = getRange(solver, op.getStep());
+    if (!lbRange || !ubRange || !stepRange || !fitsNarrow(*lbRange) ||
+        !fitsNarrow(*ubRange) || !fitsNarrow(*stepRange) ||
+        !stepRange->smin().isStrictlyPositive())
+      return mlir::failure();
+
+    // Last increment must not overflow either.
+    if (!fitsNarrow(ubRange->smax().getSExtValue() +
+                    stepRange->smax().getSExtValue()))
+      return mlir::failure();
+
+    auto loc = op.getLoc();
+    auto lb = toNarrow(rewriter, loc, op.getLowerBound());
+    auto ub = toNarrow(rewriter, loc, op.getUpperBound());
+    auto step = toNarrow(rewriter, loc, op.getStep());
+    rewriter.modifyOpInPlace(op, [&]() {
+      op.setLowerBound(lb);
+      op.setUpperBound(ub);
+      op.setStep(step);
+      iv.setType(lb.getType());
+    });
+
+    mlir::OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPointToStart(op.getBody());
+    auto cast = rewriter.create<mlir::arith::IndexCastOp>(
+        loc, rewriter.getIndexType(), iv);
+    rewriter.replaceAllUsesExcept(iv, cast.getResult(), cast);
+    return mlir::success();
+  }
+
+private:
+  mlir::DataFlowSolver &solver;
+};
 } // namespace
 
+void numba::populateIndexNarrowingPatterns(mlir::RewritePatternSet &patterns,
+                                           mlir::DataFlowSolver &solver) {
+  patterns.insert<NarrowForLoop, NarrowIndexCmp,
+                  NarrowIndexArith<mlir::arith::AddIOp>,
+                  NarrowIndexArith<mlir::arith::SubIOp>,
+                  NarrowIndexArith<mlir::arith::MulIOp>,
+                  NarrowIndexArith<mlir::arith::DivSIOp>,
+                  NarrowIndexArith<mlir::arith::RemSIOp>>(
+      patterns.getContext(), solver);
+}
+
 void numba::populateIndexPropagatePatterns(mlir::RewritePatternSet &patterns) {
   patterns
       .insert<CmpIndexCastSimplify, ArithIndexCastSimplify<mlir::arith::SubIOp>,
@@ -4,15 +4,22 @@
 
 #include "numba/Transforms/InlineUtils.hpp"
 
+#include "numba/Dialect/ntensor/IR/NTensorOps.hpp"
 #include "numba/Dialect/numba_util/Dialect.hpp"
+#include "numba/Transforms/LoopUtils.hpp"
 
 #include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/Linalg/IR/Linalg.h>
 #include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/IR/Matchers.h>
 #include <mlir/IR/PatternMatch.h>
+#include <mlir/Interfaces/LoopLikeInterface.h>
 #include <mlir/Pass/Pass.h>
 #include <mlir/Transforms/GreedyPatternRewriteDriver.h>
 #include <mlir/Transforms/InliningUtils.h>
 
+#include <llvm/ADT/DenseSet.h>
+
 namespace {
 static bool mustInline(mlir::func::CallOp call, mlir::func::FuncOp func) {
   auto attr = mlir::StringAttr::get(
@@ -20,6 +27,40 @@ static bool mustInline(mlir::func::CallOp call, mlir::func::FuncOp func) {
   return call->hasAttr(attr) || func->hasAttr(attr);
 }
 
+/// Inline call into `scf.execute_region`, so multi-block callees can be
+/// inlined into any region.
+static mlir::LogicalResult
+inlineCallIntoRegion(mlir::func::CallOp op, mlir::func::FuncOp func,
+                     mlir::PatternRewriter &rewriter) {
+  auto loc = op.getLoc();
+  auto reg =
+      rewriter.create<mlir::scf::ExecuteRegionOp>(loc, op.getResultTypes());
+  auto newCall = [&]() -> mlir::CallOpInterface {
+    auto &regBlock = reg.getRegion().emplaceBlock();
+    mlir::OpBuilder::InsertionGuard g(rewriter);
+    rewriter.setInsertionPointToStart(&regBlock);
+    auto call = rewriter.clone(*op);
+    rewriter.create<mlir::scf::YieldOp>(loc, call->getResults());
+    return mlir::cast<mlir::CallOpInterface>(call);
+  }();
+
+  mlir::InlinerInterface inlinerInterface(op->getContext());
+  auto parent = op->getParentOp();
+  rewriter.startOpModification(parent);
+  auto res =
+      mlir::inlineCall(inlinerInterface, newCall, func, &func.getRegion());
+  if (mlir::succeeded(res)) {
+    assert(newCall->getUsers().empty());
+    rewriter.eraseOp(newCall);
+    rewriter.replaceOp(op, reg.getResults());
+    rewriter.finalizeOpModification(parent);
+  } else {
+    rewriter.eraseOp(reg);
+    rewriter.cancelOpModification(parent);
+  }
+  return res;
+}
+
 struct ForceInline : public mlir::OpRewritePattern<mlir::func::CallOp> {
   using OpRewritePattern::OpRewritePattern;
 
@@ -36,36 +77,189 @@ struct ForceInline : public mlir::OpRewritePattern<mlir::func::CallOp> {
     if (!mustInline(op, func))
       return mlir::failure();
 
-    auto loc = op.getLoc();
-    auto reg =
-        rewriter.create<mlir::scf::ExecuteRegionOp>(loc, op.getResultTypes());
-    auto newCall = [&]() -> mlir::CallOpInterface {
-      auto &regBlock = reg.getRegion().emplaceBlock();
-      mlir::OpBuilder::InsertionGuard g(rewriter);
-      rewriter.setInsertionPointToStart(&regBlock);
-      auto call = rewriter.clone(*op);
-      rewriter.create<mlir::scf::YieldOp>(loc, call->getResults());
-      return mlir::cast<mlir::CallOpInterface>(call);
-    }();
-
-    mlir::InlinerInterface inlinerInterface(op->getContext());
-    auto parent = op->getParentOp();
-    rewriter.startOpModification(parent);
-    auto res =
-        mlir::inlineCall(inlinerInterface, newCall, func, &func.getRegion());
-    if (mlir::succeeded(res)) {
-      assert(newCall->getUsers().empty());
-      rewriter.eraseOp(newCall);
-      rewriter.replaceOp(op, reg.getResults());
-      rewriter.finalizeOpModification(parent);
-    } else {
-      rewriter.eraseOp(reg);
-      rewriter.cancelOpModification(parent);
+    return inlineCallIntoRegion(op, func, rewriter);
+  }
+};
+
+/// Cost model bonuses, subtracted from the callee size.
+static constexpr int64_t ConstArgBonus = 10;
+static constexpr int64_t LoopDepthBonus = 25;
+static constexpr int64_t FusionBonus = 50;
+
+static int64_t getFuncSize(mlir::func::FuncOp func) {
+  int64_t size = 0;
+  func.getBody().walk([&](mlir::Operation *op) {
+    if (!op->hasTrait<mlir::OpTrait::IsTerminator>() &&
+        !op->hasTrait<mlir::OpTrait::ConstantLike>())
+      ++size;
+  });
+  return size;
+}
+
+static int64_t getLoopDepth(mlir::Operation *op) {
+  int64_t depth = 0;
+  while ((op = op->getParentOp()) && !mlir::isa<mlir::func::FuncOp>(op))
+    if (mlir::isa<mlir::LoopLikeOpInterface>(op))
+      ++depth;
+
+  return depth;
+}
+
+static bool isFusible(mlir::Operation *op) {
+  return mlir::isa<mlir::linalg::LinalgOp, numba::ntensor::ElementwiseOp>(op);
+}
+
+/// Inlining enables fusion if callee has fusible ops and call operands or
+/// results are also connected to the fusible ops in caller.
+static bool enablesFusion(mlir::func::CallOp call, mlir::func::FuncOp func) {
+  auto hasFusible = func.getBody()
+                        .walk([&](mlir::Operation *op) {
+                          return isFusible(op) ? mlir::WalkResult::interrupt()
+                                               : mlir::WalkResult::advance();
+                        })
+                        .wasInterrupted();
+  if (!hasFusible)
+    return false;
+
+  for (auto arg : call.getOperands())
+    if (auto def = arg.getDefiningOp(); def && isFusible(def))
+      return true;
+
+  for (auto user : call->getUsers())
+    if (isFusible(user))
+      return true;
+
+  return false;
+}
+
+/// Only leaf functions are considered, so recursive functions are never
+/// inlined and callees are inlined bottom-up.
+static bool isLeaf(mlir::func::FuncOp func, mlir::ModuleOp mod) {
+  return !func.getBody()
+              .walk([&](mlir::func::CallOp call) {
+                auto callee =
+                    mod.lookupSymbol<mlir::func::FuncOp>(call.getCallee());
+                return (callee && !callee.isExternal())
+                           ? mlir::WalkResult::interrupt()
+                           : mlir::WalkResult::advance();
+              })
+              .wasInterrupted();
+}
+
+/// Module-wide info, collected once per pass run, instead of rescanning the
+/// whole module for each call.
+struct InlineState {
+  /// Number of symbol uses of each function.
+  llvm::DenseMap<mlir::StringAttr, int64_t> useCounts;
+
+  /// Functions, which can reach themselves through the calls.
+  llvm::DenseSet<mlir::StringAttr> recursive;
+
+  void init(mlir::ModuleOp mod) {
+    useCounts.clear();
+    recursive.clear();
+    if (auto uses = mlir::SymbolTable::getSymbolUses(&mod.getBodyRegion()))
+      for (auto &use : *uses)
+        ++useCounts[use.getSymbolRef().getRootReference()];
+
+    llvm::DenseMap<mlir::StringAttr, llvm::SmallVector<mlir::StringAttr>>
+        callees;
+    for (auto func : mod.getOps<mlir::func::FuncOp>()) {
+      auto &funcCallees = callees[func.getSymNameAttr()];
+      func.getBody().walk([&](mlir::func::CallOp call) {
+        funcCallees.emplace_back(call.getCalleeAttr().getAttr());
+      });
     }
-    return res;
+
+    for (auto &&it : callees) {
+      auto name = it.first;
+      llvm::SmallVector<mlir::StringAttr> stack(it.second);
+      llvm::DenseSet<mlir::StringAttr> visited;
+      while (!stack.empty()) {
+        auto current = stack.pop_back_val();
+        if (current == name) {
+          recursive.insert(name);
+          break;
+        }
+        if (!visited.insert(current).second)
+          continue;
+
+        auto next = callees.find(current);
+        if (next != callees.end())
+          stack.append(next->second.begin(), next->second.end());
+      }
+    }
+  }
+
+  /// Update use counts after `func` was inlined into one of its callers.
+  void onInlined(mlir::func::FuncOp func) {
+    --useCounts[func.getSymNameAttr()];
+    func.getBody().walk([&](mlir::func::CallOp call) {
+      ++useCounts[call.getCalleeAttr().getAttr()];
+    });
   }
 };
 
+static bool shouldInline(mlir::func::CallOp call, mlir::func::FuncOp func,
+                         const InlineState &state, mlir::ModuleOp mod,
+                         int64_t threshold) {
+  if (func.isExternal() || !func.isPrivate() ||
+      call->getParentOfType<mlir::func::FuncOp>() == func ||
+      state.recursive.contains(func.getSymNameAttr()))
+    return false;
+
+  // Device code cannot call host functions, env regions, other than the
+  // parallel ones, are offloaded to device.
+  if (!numba::isCPULoop(call))
+    return true;
+
+  if (!isLeaf(func, mod))
+    return false;
+
+  // Single call site, no code growth.
+  if (state.useCounts.lookup(func.getSymNameAttr()) == 1)
+    return true;
+
+  auto cost = getFuncSize(func);
+  for (auto arg : call.getOperands())
+    if (mlir::matchPattern(arg, mlir::m_Constant()))
+      cost -= ConstArgBonus;
+
+  cost -= LoopDepthBonus * getLoopDepth(call);
+  if (enablesFusion(call, func))
+    cost -= FusionBonus;
+
+  return cost <= threshold;
+}
+
+struct CostModelInline : public mlir::OpRewritePattern<mlir::func::CallOp> {
+  CostModelInline(mlir::MLIRContext *context, int64_t threshold,
+                  InlineState &state)
+      : mlir::OpRewritePattern<mlir::func::CallOp>(context),
+        threshold(threshold), state(state) {}
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::func::CallOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto mod = op->getParentOfType<mlir::ModuleOp>();
+    assert(mod);
+
+    auto func = mod.lookupSymbol<mlir::func::FuncOp>(op.getCallee());
+    if (!func || !shouldInline(op, func, state, mod, threshold))
+      return mlir::failure();
+
+    if (mlir::failed(inlineCallIntoRegion(op, func, rewriter)))
+      return mlir::failure();
+
+    state.onInlined(func);
+    return mlir::success();
+  }
+
+private:
+  int64_t threshold;
+  InlineState &state;
+};
+
 struct ForceInlinePass
     : public mlir::PassWrapper<ForceInlinePass,
                                mlir::OperationPass<mlir::ModuleOp>> {
@@ -106,3 +300,41 @@ private:
 std::unique_ptr<mlir::Pass> numba::createForceInlinePass() {
   return std::make_unique<ForceInlinePass>();
 }
+
+namespace {
+struct CostModelInlinePass
+    : public mlir::PassWrapper<CostModelInlinePass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(CostModelInlinePass)
+
+  CostModelInlinePass(unsigned threshold) : threshold(threshold) {}
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::func::FuncDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  virtual mlir::LogicalResult initialize(mlir::MLIRContext *context) override {
+    mlir::RewritePatternSet p(context);
+    p.insert<CostModelInline>(context, threshold, state);
+    patterns = std::move(p);
+    return mlir::success();
+  }
+
+  virtual void runOnOperation() override {
+    state.init(getOperation());
+    (void)mlir::applyPatternsAndFoldGreedily(getOperation(), patterns);
+  }
+
+private:
+  unsigned threshold;
+  InlineState state;
+  mlir::FrozenRewritePatternSet patterns;
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass>
+numba::createCostModelInlinePass(unsigned threshold) {
+  return std::make_unique<CostModelInlinePass>(threshold);
+}
@@ -0,0 +1,348 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/LoopDistribution.hpp"
+
+#include "numba/Analysis/AliasAnalysis.hpp"
+#include "numba/Dialect/numba_util/Dialect.hpp"
+#include "numba/Transforms/SCFVectorize.hpp"
+
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/IR/IRMapping.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/SmallPtrSet.h>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+namespace {
+/// Memory, accessed by the loop body op, including nested ops.
+struct OpAccesses {
+  llvm::SmallVector<mlir::Value, 2> read;
+  llvm::SmallVector<mlir::Value, 2> written;
+
+  /// Op has effects on unknown memory (e.g. calls).
+  bool unknown = false;
+
+  bool empty() const { return read.empty() && written.empty() && !unknown; }
+};
+} // namespace
+
+static OpAccesses getAccesses(mlir::Operation *op) {
+  OpAccesses ret;
+  op->walk([&](mlir::Operation *nested) {
+    // Nested ops are visited separately.
+    if (nested->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>())
+      return;
+
+    auto iface = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(nested);
+    if (!iface) {
+      ret.unknown = true;
+      return;
+    }
+
+    llvm::SmallVector<mlir::MemoryEffects::EffectInstance> effects;
+    iface.getEffects(effects);
+    for (auto &effect : effects) {
+      auto val = effect.getValue();
+      if (!val) {
+        ret.unknown = true;
+      } else if (mlir::isa<mlir::MemoryEffects::Read>(effect.getEffect())) {
+        ret.read.emplace_back(val);
+      } else {
+        ret.written.emplace_back(val);
+      }
+    }
+  });
+  return ret;
+}
+
+static bool mayAlias(numba::LocalAliasAnalysis &aa,
+                     llvm::ArrayRef<mlir::Value> values, mlir::Value val) {
+  return llvm::any_of(values, [&](mlir::Value other) {
+    return !aa.alias(other, val).isNo();
+  });
+}
+
+static bool mayAlias(numba::LocalAliasAnalysis &aa,
+                     llvm::ArrayRef<mlir::Value> lhs,
+                     llvm::ArrayRef<mlir::Value> rhs) {
+  return llvm::any_of(rhs,
+                      [&](mlir::Value val) { return mayAlias(aa, lhs, val); });
+}
+
+/// Checks if ops cannot be reordered, i.e. any of them writes memory, the
+/// other may access.
+static bool hasConflict(numba::LocalAliasAnalysis &aa, const OpAccesses &lhs,
+                        const OpAccesses &rhs) {
+  if (lhs.empty() || rhs.empty())
+    return false;
+
+  if (lhs.unknown || rhs.unknown)
+    return true;
+
+  return mayAlias(aa, lhs.written, rhs.read) ||
+         mayAlias(aa, lhs.written, rhs.written) ||
+         mayAlias(aa, lhs.read, rhs.written);
+}
+
+/// Ops, which can stay in the vectorizable loop, everything else goes to the
+/// residual loop.
+static bool isVectorizableOp(mlir::Operation &op) {
+  if (mlir::isa<mlir::memref::LoadOp, mlir::memref::StoreOp>(op))
+    return true;
+
+  // `scf.if` is if-converted by vectorizer.
+  if (mlir::isa<mlir::scf::IfOp>(op))
+    return llvm::all_of(op.getRegions(), [](mlir::Region &region) {
+      return llvm::all_of(region.getOps(), [](mlir::Operation &nested) {
+        return mlir::isa<mlir::scf::YieldOp>(nested) ||
+               isVectorizableOp(nested);
+      });
+    });
+
+  return op.getNumRegions() == 0 && mlir::isMemoryEffectFree(&op);
+}
+
+/// Estimated cost of the single loop iteration, vectorized if profitable.
+/// Non-vectorizable loops cost is the number of ops.
+static double getIterationCost(mlir::scf::ParallelOp loop,
+                               const numba::SCFVectorizeCostModel &costModel) {
+  unsigned numOps = 0;
+  loop.getBody()->walk([&](mlir::Operation *op) {
+    if (!op->hasTrait<mlir::OpTrait::IsTerminator>())
+      ++numOps;
+  });
+
+  double cost = numOps;
+  for (auto dim : llvm::seq(0u, loop.getNumLoops())) {
+    auto info = numba::getLoopVectorizeInfo(loop, dim, costModel);
+    if (info && info->getSpeedup() > 1)
+      cost = std::min(cost, double(info->vectorCost) / info->factor);
+  }
+  return cost;
+}
+
+/// Split loop body into vectorizable loop and residual loop, executed after
+/// it.
+///
+/// `scf.parallel` iterations are independent, so it is enough to preserve
+/// dependencies inside single iteration: op stays in the vectorizable loop if
+/// it doesn't use residual ops results and doesn't conflict with preceding
+/// residual ops memory accesses. Pure ops and loads, which results are used by
+/// the residual ops, are repeated in the residual loop, loads only if loaded
+/// memory is not overwritten by the vectorizable loop.
+///
+/// Loop is only split if estimated cost of the vectorized loop and residual
+/// loop is lower than the original one.
+static bool distributeLoop(mlir::scf::ParallelOp loop,
+                           numba::LocalAliasAnalysis &aa,
+                           const numba::SCFVectorizeCostModel &costModel) {
+  auto body = loop.getBody();
+  auto term = body->getTerminator();
+  llvm::SmallVector<mlir::Operation *> ops;
+  llvm::SmallVector<OpAccesses> accesses;
+  llvm::SmallPtrSet<mlir::Operation *, 8> serial;
+  for (auto &op : body->without_terminator()) {
+    ops.emplace_back(&op);
+    accesses.emplace_back(getAccesses(&op));
+    if (!isVectorizableOp(op))
+      serial.insert(&op);
+  }
+
+  if (serial.empty())
+    return false;
+
+  // Vectorizable ops, which are also repeated in the residual loop.
+  llvm::SmallPtrSet<mlir::Operation *, 8> repeated;
+
+  auto usesSerial = [&](mlir::Operation *op) {
+    return op
+        ->walk([&](mlir::Operation *nested) {
+          for (auto arg : nested->getOperands()) {
+            auto def = arg.getDefiningOp();
+            if (!def)
+              continue;
+
+            auto bodyOp = body->findAncestorOpInBlock(*def);
+            if (bodyOp && bodyOp != op && serial.contains(bodyOp))
+              return mlir::WalkResult::interrupt();
+          }
+          return mlir::WalkResult::advance();
+        })
+        .wasInterrupted();
+  };
+
+  // Reductions stay in the residual loop.
+  auto hasSerialUser = [&](mlir::Operation *op) {
+    return llvm::any_of(op->getUsers(), [&](mlir::Operation *user) {
+      auto bodyOp = body->findAncestorOpInBlock(*user);
+      return bodyOp == term || serial.contains(bodyOp) ||
+             repeated.contains(bodyOp);
+    });
+  };
+
+  auto canReload = [&](size_t idx) {
+    auto load = mlir::dyn_cast<mlir::memref::LoadOp>(ops[idx]);
+    if (!load)
+      return false;
+
+    auto memref = load.getMemRef();
+    for (auto i : llvm::seq(idx + 1, ops.size())) {
+      if (serial.contains(ops[i]))
+        continue;
+
+      if (mayAlias(aa, accesses[i].written, memref))
+        return false;
+    }
+    return true;
+  };
+
+  auto conflictsWithSerial = [&](size_t idx) {
+    for (auto i : llvm::seq(size_t(0), idx))
+      if (serial.contains(ops[i]) &&
+          hasConflict(aa, accesses[i], accesses[idx]))
+        return true;
+
+    return false;
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto i : llvm::seq(size_t(0), ops.size())) {
+      auto op = ops[i];
+      if (serial.contains(op))
+        continue;
+
+      bool move = usesSerial(op) || conflictsWithSerial(i);
+      if (!move && !repeated.contains(op) && hasSerialUser(op)) {
+        if (mlir::isMemoryEffectFree(op) || canReload(i)) {
+          repeated.insert(op);
+          changed = true;
+          continue;
+        }
+        move = true;
+      }
+
+      if (move) {
+        serial.insert(op);
+        repeated.erase(op);
+        changed = true;
+      }
+    }
+  }
+
+  // Vectorizable loop without stores is dead.
+  bool hasStores = false;
+  for (auto i : llvm::seq(size_t(0), ops.size()))
+    if (!serial.contains(ops[i]) && !accesses[i].written.empty())
+      hasStores = true;
+
+  if (!hasStores)
+    return false;
+
+  auto bodyBuilder = [&](mlir::OpBuilder &b, mlir::Location /*loc*/,
+                         mlir::ValueRange ivs) {
+    mlir::IRMapping mapping;
+    mapping.map(loop.getInductionVars(), ivs);
+    for (auto op : ops)
+      if (!serial.contains(op))
+        b.clone(*op, mapping);
+  };
+
+  // Vectorizable loop doesn't have reductions.
+  mlir::OpBuilder builder(loop);
+  auto vectorLoop = builder.create<mlir::scf::ParallelOp>(
+      loop.getLoc(), loop.getLowerBound(), loop.getUpperBound(),
+      loop.getStep(), bodyBuilder);
+  vectorLoop->setDiscardableAttrs(loop->getDiscardableAttrDictionary());
+
+  // Remove values, only needed by the residual loop.
+  for (auto &op : llvm::make_early_inc_range(
+           llvm::reverse(vectorLoop.getBody()->without_terminator())))
+    if (mlir::isOpTriviallyDead(&op))
+      op.erase();
+
+  auto residualLoop = mlir::cast<mlir::scf::ParallelOp>(builder.clone(*loop));
+  llvm::SmallVector<mlir::Operation *> residualOps;
+  for (auto &op : residualLoop.getBody()->without_terminator())
+    residualOps.emplace_back(&op);
+
+  for (auto i : llvm::reverse(llvm::seq(size_t(0), ops.size())))
+    if (!serial.contains(ops[i]) && !repeated.contains(ops[i]))
+      residualOps[i]->erase();
+
+  auto cost = getIterationCost(loop, costModel);
+  auto newCost = getIterationCost(vectorLoop, costModel) +
+                 getIterationCost(residualLoop, costModel);
+  if (newCost >= cost) {
+    vectorLoop->erase();
+    residualLoop->erase();
+    return false;
+  }
+
+  loop->replaceAllUsesWith(residualLoop.getResults());
+  loop->erase();
+  return true;
+}
+
+static std::optional<unsigned> getVectorLength(mlir::Operation *op) {
+  auto func = op->getParentOfType<mlir::FunctionOpInterface>();
+  if (!func)
+    return std::nullopt;
+
+  auto attr = func->getAttrOfType<mlir::IntegerAttr>(
+      numba::util::attributes::getVectorLengthName());
+  if (!attr)
+    return std::nullopt;
+
+  auto val = attr.getInt();
+  if (val <= 0 || val > std::numeric_limits<unsigned>::max())
+    return std::nullopt;
+
+  return static_cast<unsigned>(val);
+}
+
+namespace {
+struct LoopDistributionPass
+    : public mlir::PassWrapper<LoopDistributionPass, mlir::OperationPass<>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(LoopDistributionPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    // Inner loops are visited first, distributed inner loop is a residual op
+    // of the outer one.
+    llvm::SmallVector<std::pair<mlir::scf::ParallelOp, unsigned>> loops;
+    getOperation()->walk([&](mlir::scf::ParallelOp loop) {
+      if (auto len = getVectorLength(loop))
+        loops.emplace_back(loop, *len);
+    });
+
+    numba::LocalAliasAnalysis aa;
+    bool changed = false;
+    for (auto &&[loop, len] : loops) {
+      auto costModel = numba::SCFVectorizeCostModel::get(len);
+      costModel.complexTypes = true;
+      changed = distributeLoop(loop, aa, costModel) || changed;
+    }
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> numba::createLoopDistributionPass() {
+  return std::make_unique<LoopDistributionPass>();
+}
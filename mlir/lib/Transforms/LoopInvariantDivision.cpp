@@ -0,0 +1,331 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/LoopInvariantDivision.hpp"
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/Math/IR/Math.h>
+#include <mlir/IR/Matchers.h>
+#include <mlir/Interfaces/LoopLikeInterface.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/DenseMap.h>
+
+#include <optional>
+#include <tuple>
+
+namespace {
+enum class DivKind {
+  DivS,
+  RemS,
+  FloorDivS,
+  DivU,
+  RemU,
+};
+
+/// Multiplier and shifts for the unsigned division by the invariant value.
+struct DivMagic {
+  mlir::Value multiplier;
+  mlir::Value shift1;
+  mlir::Value shift2;
+};
+
+struct DivInfo {
+  mlir::Operation *op = nullptr;
+  DivKind kind;
+
+  /// Outermost loop, divisor is invariant in.
+  mlir::Operation *loop = nullptr;
+};
+} // namespace
+
+static std::optional<DivKind> getDivKind(mlir::Operation *op) {
+  if (mlir::isa<mlir::arith::DivSIOp>(op))
+    return DivKind::DivS;
+
+  if (mlir::isa<mlir::arith::RemSIOp>(op))
+    return DivKind::RemS;
+
+  if (mlir::isa<mlir::arith::FloorDivSIOp>(op))
+    return DivKind::FloorDivS;
+
+  if (mlir::isa<mlir::arith::DivUIOp>(op))
+    return DivKind::DivU;
+
+  if (mlir::isa<mlir::arith::RemUIOp>(op))
+    return DivKind::RemU;
+
+  return std::nullopt;
+}
+
+static bool isSigned(DivKind kind) {
+  return kind == DivKind::DivS || kind == DivKind::RemS ||
+         kind == DivKind::FloorDivS;
+}
+
+static unsigned getBitwidth(mlir::Type type) {
+  if (mlir::isa<mlir::IndexType>(type))
+    return 64;
+
+  if (auto intType = mlir::dyn_cast<mlir::IntegerType>(type))
+    return intType.getWidth();
+
+  return 0;
+}
+
+static std::optional<DivInfo> getDivInfo(mlir::Operation *op,
+                                         unsigned maxBitwidth) {
+  auto kind = getDivKind(op);
+  if (!kind)
+    return std::nullopt;
+
+  // 1-bit division is trivial and doesn't need the wide multiplication.
+  auto bitwidth = getBitwidth(op->getResult(0).getType());
+  if (bitwidth < 2 || bitwidth > maxBitwidth)
+    return std::nullopt;
+
+  // Division by constant is already handled by LLVM.
+  auto divisor = op->getOperand(1);
+  if (mlir::matchPattern(divisor, mlir::m_Constant()))
+    return std::nullopt;
+
+  mlir::Operation *loop = nullptr;
+  for (auto parent = op->getParentOp(); parent;
+       parent = parent->getParentOp()) {
+    if (parent->hasTrait<mlir::OpTrait::IsIsolatedFromAbove>())
+      break;
+
+    auto loopLike = mlir::dyn_cast<mlir::LoopLikeOpInterface>(parent);
+    if (!loopLike)
+      continue;
+
+    if (!loopLike.isDefinedOutsideOfLoop(divisor))
+      break;
+
+    loop = parent;
+  }
+
+  if (!loop)
+    return std::nullopt;
+
+  // Fully invariant ops are left to LICM.
+  auto dividend = op->getOperand(0);
+  if (mlir::cast<mlir::LoopLikeOpInterface>(loop).isDefinedOutsideOfLoop(
+          dividend))
+    return std::nullopt;
+
+  return DivInfo{op, *kind, loop};
+}
+
+static mlir::Value createConst(mlir::OpBuilder &builder, mlir::Location loc,
+                               mlir::Type type, int64_t val) {
+  return builder.create<mlir::arith::ConstantIntOp>(loc, val, type);
+}
+
+/// Returns absolute value, interpreted as unsigned.
+static mlir::Value createAbs(mlir::OpBuilder &builder, mlir::Location loc,
+                             mlir::Value val) {
+  auto zero = createConst(builder, loc, val.getType(), 0);
+  mlir::Value isNeg = builder.create<mlir::arith::CmpIOp>(
+      loc, mlir::arith::CmpIPredicate::slt, val, zero);
+  mlir::Value neg = builder.create<mlir::arith::SubIOp>(loc, zero, val);
+  return builder.create<mlir::arith::SelectOp>(loc, isNeg, neg, val);
+}
+
+/// Computes Granlund-Montgomery round-up magic for unsigned `divisor`:
+/// `l = ceil(log2(d))`, `m = floor(2^N * (2^l - d) / d) + 1`,
+/// `sh1 = min(l, 1)`, `sh2 = l - sh1`. Valid for all `1 <= d < 2^N`.
+static DivMagic createMagic(mlir::OpBuilder &builder, mlir::Location loc,
+                            mlir::Value divisor) {
+  auto type = mlir::cast<mlir::IntegerType>(divisor.getType());
+  auto bitwidth = type.getWidth();
+  auto wideType = builder.getIntegerType(bitwidth * 2);
+
+  // Division by zero is UB inside the loop anyway, but precomputation must
+  // not trap if loop is never executed.
+  auto zero = createConst(builder, loc, type, 0);
+  auto one = createConst(builder, loc, type, 1);
+  mlir::Value isZero = builder.create<mlir::arith::CmpIOp>(
+      loc, mlir::arith::CmpIPredicate::eq, divisor, zero);
+  mlir::Value d =
+      builder.create<mlir::arith::SelectOp>(loc, isZero, one, divisor);
+
+  mlir::Value dm1 = builder.create<mlir::arith::SubIOp>(loc, d, one);
+  mlir::Value lz = builder.create<mlir::math::CountLeadingZerosOp>(loc, dm1);
+  mlir::Value l = builder.create<mlir::arith::SubIOp>(
+      loc, createConst(builder, loc, type, bitwidth), lz);
+
+  mlir::Value dWide = builder.create<mlir::arith::ExtUIOp>(loc, wideType, d);
+  mlir::Value lWide = builder.create<mlir::arith::ExtUIOp>(loc, wideType, l);
+  auto oneWide = createConst(builder, loc, wideType, 1);
+  mlir::Value pow = builder.create<mlir::arith::ShLIOp>(loc, oneWide, lWide);
+  mlir::Value diff = builder.create<mlir::arith::SubIOp>(loc, pow, dWide);
+  mlir::Value num = builder.create<mlir::arith::ShLIOp>(
+      loc, diff, createConst(builder, loc, wideType, bitwidth));
+  mlir::Value m = builder.create<mlir::arith::DivUIOp>(loc, num, dWide);
+  m = builder.create<mlir::arith::AddIOp>(loc, m, oneWide);
+  m = builder.create<mlir::arith::TruncIOp>(loc, type, m);
+
+  mlir::Value sh1 = builder.create<mlir::arith::MinUIOp>(loc, l, one);
+  mlir::Value sh2 = builder.create<mlir::arith::SubIOp>(loc, l, sh1);
+  return {m, sh1, sh2};
+}
+
+static mlir::Value createMulHigh(mlir::OpBuilder &builder, mlir::Location loc,
+                                 mlir::Value lhs, mlir::Value rhs) {
+  auto type = mlir::cast<mlir::IntegerType>(lhs.getType());
+  auto bitwidth = type.getWidth();
+  auto wideType = builder.getIntegerType(bitwidth * 2);
+  mlir::Value lhsWide =
+      builder.create<mlir::arith::ExtUIOp>(loc, wideType, lhs);
+  mlir::Value rhsWide =
+      builder.create<mlir::arith::ExtUIOp>(loc, wideType, rhs);
+  mlir::Value res =
+      builder.create<mlir::arith::MulIOp>(loc, lhsWide, rhsWide);
+  res = builder.create<mlir::arith::ShRUIOp>(
+      loc, res, createConst(builder, loc, wideType, bitwidth));
+  return builder.create<mlir::arith::TruncIOp>(loc, type, res);
+}
+
+/// `q = (t + ((n - t) >> sh1)) >> sh2`, `t = mulhi(m, n)`.
+static mlir::Value createUDiv(mlir::OpBuilder &builder, mlir::Location loc,
+                              const DivMagic &magic, mlir::Value n) {
+  auto t = createMulHigh(builder, loc, magic.multiplier, n);
+  mlir::Value res = builder.create<mlir::arith::SubIOp>(loc, n, t);
+  res = builder.create<mlir::arith::ShRUIOp>(loc, res, magic.shift1);
+  res = builder.create<mlir::arith::AddIOp>(loc, t, res);
+  return builder.create<mlir::arith::ShRUIOp>(loc, res, magic.shift2);
+}
+
+static mlir::Value createDiv(mlir::OpBuilder &builder, mlir::Location loc,
+                             DivKind kind, const DivMagic &magic,
+                             mlir::Value n, mlir::Value d) {
+  if (!isSigned(kind)) {
+    auto q = createUDiv(builder, loc, magic, n);
+    if (kind == DivKind::DivU)
+      return q;
+
+    mlir::Value qd = builder.create<mlir::arith::MulIOp>(loc, q, d);
+    return builder.create<mlir::arith::SubIOp>(loc, n, qd);
+  }
+
+  auto type = n.getType();
+  auto zero = createConst(builder, loc, type, 0);
+  auto qAbs = createUDiv(builder, loc, magic, createAbs(builder, loc, n));
+
+  // Quotient is negative if signs are different.
+  mlir::Value signs = builder.create<mlir::arith::XOrIOp>(loc, n, d);
+  mlir::Value isNeg = builder.create<mlir::arith::CmpIOp>(
+      loc, mlir::arith::CmpIPredicate::slt, signs, zero);
+  mlir::Value qNeg = builder.create<mlir::arith::SubIOp>(loc, zero, qAbs);
+  mlir::Value q =
+      builder.create<mlir::arith::SelectOp>(loc, isNeg, qNeg, qAbs);
+  if (kind == DivKind::DivS)
+    return q;
+
+  mlir::Value qd = builder.create<mlir::arith::MulIOp>(loc, q, d);
+  mlir::Value r = builder.create<mlir::arith::SubIOp>(loc, n, qd);
+  if (kind == DivKind::RemS)
+    return r;
+
+  // Round towards negative infinity if remainder is not zero and quotient is
+  // negative.
+  assert(kind == DivKind::FloorDivS);
+  mlir::Value rNonZero = builder.create<mlir::arith::CmpIOp>(
+      loc, mlir::arith::CmpIPredicate::ne, r, zero);
+  mlir::Value adjust =
+      builder.create<mlir::arith::AndIOp>(loc, rNonZero, isNeg);
+  mlir::Value qm1 = builder.create<mlir::arith::SubIOp>(
+      loc, q, createConst(builder, loc, type, 1));
+  return builder.create<mlir::arith::SelectOp>(loc, adjust, qm1, q);
+}
+
+static mlir::Value castToInt(mlir::OpBuilder &builder, mlir::Location loc,
+                             mlir::Value val, bool isSigned) {
+  if (!mlir::isa<mlir::IndexType>(val.getType()))
+    return val;
+
+  auto type = builder.getI64Type();
+  if (isSigned)
+    return builder.create<mlir::arith::IndexCastOp>(loc, type, val);
+
+  return builder.create<mlir::arith::IndexCastUIOp>(loc, type, val);
+}
+
+static mlir::Value castFromInt(mlir::OpBuilder &builder, mlir::Location loc,
+                               mlir::Value val, mlir::Type type,
+                               bool isSigned) {
+  if (val.getType() == type)
+    return val;
+
+  if (isSigned)
+    return builder.create<mlir::arith::IndexCastOp>(loc, type, val);
+
+  return builder.create<mlir::arith::IndexCastUIOp>(loc, type, val);
+}
+
+namespace {
+struct LoopInvariantDivisionPass
+    : public mlir::PassWrapper<LoopInvariantDivisionPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(LoopInvariantDivisionPass)
+
+  LoopInvariantDivisionPass(unsigned bitwidth) : maxBitwidth(bitwidth) {}
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::math::MathDialect>();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<DivInfo> divs;
+    getOperation()->walk([&](mlir::Operation *op) {
+      if (auto info = getDivInfo(op, maxBitwidth))
+        divs.emplace_back(*info);
+    });
+
+    if (divs.empty())
+      return markAllAnalysesPreserved();
+
+    // Same divisor is usually used for both quotient and remainder.
+    using MagicKey = std::tuple<mlir::Value, mlir::Operation *, bool>;
+    llvm::DenseMap<MagicKey, std::pair<DivMagic, mlir::Value>> magics;
+
+    mlir::OpBuilder builder(&getContext());
+    for (auto &info : divs) {
+      auto op = info.op;
+      auto loc = op->getLoc();
+      bool isSignedDiv = isSigned(info.kind);
+      auto divisor = op->getOperand(1);
+      MagicKey key{divisor, info.loop, isSignedDiv};
+      auto it = magics.find(key);
+      if (it == magics.end()) {
+        builder.setInsertionPoint(info.loop);
+        auto d = castToInt(builder, loc, divisor, isSignedDiv);
+        auto dAbs = isSignedDiv ? createAbs(builder, loc, d) : d;
+        auto magic = createMagic(builder, loc, dAbs);
+        it = magics.insert({key, {magic, d}}).first;
+      }
+
+      auto &[magic, d] = it->second;
+      builder.setInsertionPoint(op);
+      auto n = castToInt(builder, loc, op->getOperand(0), isSignedDiv);
+      auto res = createDiv(builder, loc, info.kind, magic, n, d);
+      res = castFromInt(builder, loc, res, op->getResult(0).getType(),
+                        isSignedDiv);
+      op->replaceAllUsesWith(mlir::ValueRange(res));
+      op->erase();
+    }
+  }
+
+private:
+  unsigned maxBitwidth;
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass>
+numba::createLoopInvariantDivisionPass(unsigned maxBitwidth) {
+  return std::make_unique<LoopInvariantDivisionPass>(maxBitwidth);
+}
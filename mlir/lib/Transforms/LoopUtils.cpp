@@ -5,6 +5,7 @@
 #include "numba/Transforms/LoopUtils.hpp"
 
 #include "numba/Analysis/AliasAnalysis.hpp"
+#include "numba/Dialect/numba_util/Dialect.hpp"
 
 #include <llvm/ADT/SmallVector.h>
 
@@ -341,3 +342,14 @@ LogicalResult numba::prepareForFusion(
   }
   return mlir::success(changed);
 }
+
+bool numba::isCPULoop(mlir::Operation *loop) {
+  auto parent = loop->getParentOfType<numba::util::EnvironmentRegionOp>();
+  while (parent) {
+    if (!mlir::isa<numba::util::ParallelAttr>(parent.getEnvironment()))
+      return false;
+
+    parent = parent->getParentOfType<numba::util::EnvironmentRegionOp>();
+  }
+  return true;
+}
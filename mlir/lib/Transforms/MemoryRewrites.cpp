@@ -4,13 +4,20 @@
 
 #include "numba/Transforms/MemoryRewrites.hpp"
 
+#include "numba/Analysis/AliasAnalysis.hpp"
 #include "numba/Analysis/MemorySsaAnalysis.hpp"
+#include "numba/Dialect/numba_util/Dialect.hpp"
+#include "numba/Transforms/FuncUtils.hpp"
 
+#include <mlir/Dialect/Arith/IR/Arith.h>
 #include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
 #include <mlir/Dialect/Vector/IR/VectorOps.h>
 #include <mlir/IR/BuiltinOps.h>
 #include <mlir/IR/Dominance.h>
 #include <mlir/Interfaces/FunctionInterfaces.h>
+#include <mlir/Interfaces/LoopLikeInterface.h>
 #include <mlir/Pass/Pass.h>
 #include <mlir/Transforms/GreedyPatternRewriteDriver.h>
 
@@ -152,6 +159,84 @@ deadStoreElemination(numba::MemorySSAAnalysis &memSSAAnalysis) {
   return mlir::success(changed);
 }
 
+static bool isLocalAlloc(mlir::Value memref) {
+  auto op = memref.getDefiningOp();
+  if (!mlir::isa_and_nonnull<mlir::memref::AllocOp, mlir::memref::AllocaOp>(
+          op))
+    return false;
+
+  return !numba::canAllocEscape(op);
+}
+
+/// Removes stores to non-escaping buffers, which are not read on any path
+/// until function exit or until full overwrite. Unlike simple DSE it follows
+/// memory SSA through loops and regions phis.
+static mlir::LogicalResult
+deadLocalStoreElemination(numba::MemorySSAAnalysis &memSSAAnalysis) {
+  assert(memSSAAnalysis.memssa);
+  assert(memSSAAnalysis.aliasAnalysis);
+  auto &memSSA = *memSSAAnalysis.memssa;
+  auto &aa = *memSSAAnalysis.aliasAnalysis;
+  using NodeType = numba::MemorySSA::NodeType;
+  using Node = numba::MemorySSA::Node;
+
+  auto isLive = [&](Node *node, mlir::Operation *store, mlir::Value memref) {
+    // Indices may change on loop back edges, so overwrites are only checked
+    // until first phi.
+    llvm::SmallVector<std::pair<Node *, bool>> worklist;
+    llvm::SmallPtrSet<Node *, 8> visited[2];
+    worklist.emplace_back(node, false);
+    while (!worklist.empty()) {
+      auto [current, passedPhi] = worklist.pop_back_val();
+      for (auto user : memSSA.getUsers(current)) {
+        if (!visited[passedPhi].insert(user).second)
+          continue;
+
+        auto type = memSSA.getNodeType(user);
+        if (NodeType::Term == type)
+          continue;
+
+        auto op = memSSA.getNodeOperation(user);
+        if (NodeType::Use == type) {
+          assert(op);
+          auto info = getMeminfo(op);
+          if (!info || !aa.alias(info->memref, memref).isNo())
+            return true;
+
+          continue;
+        }
+
+        // Value was overwritten on this path.
+        if (NodeType::Def == type && !passedPhi && MustAlias()(store, op))
+          continue;
+
+        worklist.emplace_back(user, passedPhi || NodeType::Phi == type);
+      }
+    }
+    return false;
+  };
+
+  bool changed = false;
+  for (auto &node : llvm::make_early_inc_range(memSSA.getNodes())) {
+    if (NodeType::Def != memSSA.getNodeType(&node))
+      continue;
+
+    auto op = memSSA.getNodeOperation(&node);
+    assert(op);
+    if (!mlir::isa<mlir::memref::StoreOp, mlir::vector::StoreOp>(op))
+      continue;
+
+    auto memref = getMeminfo(op)->memref;
+    if (!isLocalAlloc(memref) || isLive(&node, op, memref))
+      continue;
+
+    op->erase();
+    memSSA.eraseNode(&node);
+    changed = true;
+  }
+  return mlir::success(changed);
+}
+
 struct SimpleOperationInfo : public llvm::DenseMapInfo<mlir::Operation *> {
   static unsigned getHashValue(const mlir::Operation *opC) {
     return static_cast<unsigned>(mlir::OperationEquivalence::computeHash(
@@ -240,6 +325,7 @@ numba::optimizeMemoryOps(mlir::AnalysisManager &am) {
       &optimizeUses,
       &foldLoads,
       &deadStoreElemination,
+      &deadLocalStoreElemination,
       &loadCSE,
   };
 
@@ -259,6 +345,258 @@ numba::optimizeMemoryOps(mlir::AnalysisManager &am) {
   return mlir::success(changed);
 }
 
+static bool canAllocEscapeImpl(mlir::Operation *op, bool original) {
+  for (auto user : op->getUsers()) {
+    if (mlir::isa<mlir::memref::LoadOp, mlir::memref::StoreOp,
+                  mlir::memref::DimOp>(user))
+      continue;
+
+    if (original && mlir::isa<mlir::memref::DeallocOp>(user))
+      continue;
+
+    if (auto view = mlir::dyn_cast<mlir::ViewLikeOpInterface>(user)) {
+      if (canAllocEscapeImpl(user, false))
+        return true;
+
+      continue;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+bool numba::canAllocEscape(mlir::Operation *op) {
+  return canAllocEscapeImpl(op, /*original*/ true);
+}
+
+bool numba::isFirstAllocUse(mlir::Operation *op, mlir::Operation *use) {
+  auto block = op->getBlock();
+  if (use->getBlock() != block)
+    return false;
+
+  for (auto user : op->getUsers()) {
+    if (user == use)
+      continue;
+
+    auto ancestor = block->findAncestorOpInBlock(*user);
+    if (!ancestor || !use->isBeforeInBlock(ancestor))
+      return false;
+  }
+  return true;
+}
+
+namespace {
+/// Loads from the same array, which only differ by constant number of
+/// iterations in one of the indices.
+struct LoadsGroup {
+  mlir::memref::LoadOp first;
+  unsigned ivIndex;
+  llvm::SmallVector<std::pair<int64_t, mlir::memref::LoadOp>> loads;
+};
+} // namespace
+
+static std::optional<int64_t> getIvOffset(mlir::Value idx, mlir::Value iv) {
+  if (idx == iv)
+    return 0;
+
+  if (auto add = idx.getDefiningOp<mlir::arith::AddIOp>()) {
+    if (add.getLhs() == iv)
+      return mlir::getConstantIntValue(add.getRhs());
+
+    if (add.getRhs() == iv)
+      return mlir::getConstantIntValue(add.getLhs());
+  }
+
+  if (auto sub = idx.getDefiningOp<mlir::arith::SubIOp>()) {
+    if (sub.getLhs() == iv)
+      if (auto val = mlir::getConstantIntValue(sub.getRhs()))
+        return -*val;
+  }
+  return std::nullopt;
+}
+
+static llvm::SmallVector<LoadsGroup> collectLoadsGroups(mlir::scf::ForOp loop,
+                                                        int64_t step) {
+  llvm::SmallVector<LoadsGroup> groups;
+  auto iv = loop.getInductionVar();
+  for (auto &op : loop.getBody()->without_terminator()) {
+    auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op);
+    if (!load || !loop.isDefinedOutsideOfLoop(load.getMemref()))
+      continue;
+
+    std::optional<unsigned> ivIndex;
+    int64_t offset = 0;
+    bool valid = true;
+    for (auto &&[i, idx] : llvm::enumerate(load.getIndices())) {
+      if (loop.isDefinedOutsideOfLoop(idx))
+        continue;
+
+      auto idxOffset = getIvOffset(idx, iv);
+      if (ivIndex || !idxOffset || *idxOffset % step != 0) {
+        valid = false;
+        break;
+      }
+      ivIndex = static_cast<unsigned>(i);
+      offset = *idxOffset / step;
+    }
+    if (!valid || !ivIndex)
+      continue;
+
+    auto it = llvm::find_if(groups, [&](const LoadsGroup &group) {
+      if (group.first.getMemref() != load.getMemref() ||
+          group.ivIndex != *ivIndex)
+        return false;
+
+      for (auto &&[i, idx] : llvm::enumerate(load.getIndices()))
+        if (i != *ivIndex && idx != group.first.getIndices()[i])
+          return false;
+
+      return true;
+    });
+    if (it == groups.end()) {
+      groups.push_back({load, *ivIndex, {}});
+      it = std::prev(groups.end());
+    }
+    it->loads.emplace_back(offset, load);
+  }
+  return groups;
+}
+
+static bool hasAliasingWrites(mlir::scf::ForOp loop, mlir::Value memref,
+                              numba::LocalAliasAnalysis &aa) {
+  auto visitor = [&](mlir::Operation *op) -> mlir::WalkResult {
+    if (mlir::isMemoryEffectFree(op) ||
+        op->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>())
+      return mlir::WalkResult::advance();
+
+    if (auto meminfo = getMeminfo(op)) {
+      if (mlir::isa<mlir::memref::LoadOp, mlir::vector::LoadOp>(op) ||
+          aa.alias(meminfo->memref, memref).isNo())
+        return mlir::WalkResult::advance();
+
+      return mlir::WalkResult::interrupt();
+    }
+
+    auto memInterface = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(op);
+    if (memInterface && !memInterface.hasEffect<mlir::MemoryEffects::Write>())
+      return mlir::WalkResult::advance();
+
+    return mlir::WalkResult::interrupt();
+  };
+  return loop.getBody()->walk(visitor).wasInterrupted();
+}
+
+/// Loads `[minOffset, maxOffset)` elements before the loop and rotates them
+/// through iter args, only `maxOffset` element is loaded on each iteration.
+static void forwardLoads(mlir::scf::ForOp loop, const LoadsGroup &group,
+                         int64_t minOffset, int64_t maxOffset, int64_t step) {
+  mlir::IRRewriter rewriter(loop.getContext());
+  auto loc = loop.getLoc();
+  auto lowerBound = loop.getLowerBound();
+  auto upperBound = loop.getUpperBound();
+
+  // Initial loads are only valid if loop executes at least one iteration.
+  auto lbConst = mlir::getConstantIntValue(lowerBound);
+  auto ubConst = mlir::getConstantIntValue(upperBound);
+  if (!lbConst || !ubConst || *lbConst >= *ubConst) {
+    rewriter.setInsertionPointAfter(loop);
+    mlir::Value cond = rewriter.create<mlir::arith::CmpIOp>(
+        loc, mlir::arith::CmpIPredicate::slt, lowerBound, upperBound);
+    auto thenBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+      b.create<mlir::scf::YieldOp>(l, loop.getResults());
+    };
+    auto elseBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+      b.create<mlir::scf::YieldOp>(l, loop.getInitArgs());
+    };
+    auto ifOp = rewriter.create<mlir::scf::IfOp>(loc, cond, thenBuilder,
+                                                 elseBuilder);
+    auto thenYield = ifOp.thenYield();
+    for (auto &&[oldRes, newRes] :
+         llvm::zip(loop.getResults(), ifOp.getResults()))
+      oldRes.replaceAllUsesExcept(newRes, thenYield);
+
+    loop->moveBefore(thenYield);
+  }
+
+  rewriter.setInsertionPoint(loop);
+  llvm::SmallVector<mlir::Value> indices(group.first.getIndices());
+  llvm::SmallVector<mlir::Value> inits;
+  for (auto offset : llvm::seq(minOffset, maxOffset)) {
+    mlir::Value idx = lowerBound;
+    if (offset != 0) {
+      mlir::Value diff =
+          rewriter.create<mlir::arith::ConstantIndexOp>(loc, offset * step);
+      idx = rewriter.create<mlir::arith::AddIOp>(loc, lowerBound, diff);
+    }
+    indices[group.ivIndex] = idx;
+    inits.emplace_back(rewriter.create<mlir::memref::LoadOp>(
+        loc, group.first.getMemref(), indices));
+  }
+
+  auto yieldFn = [&](mlir::OpBuilder & /*builder*/, mlir::Location /*loc*/,
+                     llvm::ArrayRef<mlir::BlockArgument> newArgs) {
+    mlir::Value last;
+    for (auto &&[offset, load] : group.loads) {
+      if (offset == maxOffset) {
+        if (!last)
+          last = load.getResult();
+
+        continue;
+      }
+      rewriter.replaceOp(load, newArgs[offset - minOffset]);
+    }
+    llvm::SmallVector<mlir::Value> ret(newArgs.drop_front());
+    ret.emplace_back(last);
+    return ret;
+  };
+  (void)loop.replaceWithAdditionalYields(
+      rewriter, inits, /*replaceInitOperandUsesInLoop*/ false, yieldFn);
+}
+
+mlir::LogicalResult numba::forwardLoopCarriedLoads(mlir::Operation *root) {
+  const int64_t maxCarriedValues = 8;
+
+  llvm::SmallVector<mlir::scf::ForOp> loops;
+  root->walk([&](mlir::scf::ForOp loop) { loops.emplace_back(loop); });
+
+  numba::LocalAliasAnalysis aa;
+  bool changed = false;
+  for (auto loop : loops) {
+    auto step = mlir::getConstantIntValue(loop.getStep());
+    if (!step || *step <= 0)
+      continue;
+
+    for (auto &group : collectLoadsGroups(loop, *step)) {
+      llvm::sort(group.loads, [](auto &lhs, auto &rhs) {
+        return lhs.first < rhs.first;
+      });
+      auto minOffset = group.loads.front().first;
+      auto maxOffset = group.loads.back().first;
+      if (minOffset == maxOffset || maxOffset - minOffset > maxCarriedValues)
+        continue;
+
+      // Intermediate elements must be loaded by the original loop too.
+      bool contiguous = true;
+      for (auto &&[prev, next] :
+           llvm::zip(group.loads, llvm::drop_begin(group.loads)))
+        if (next.first - prev.first > 1)
+          contiguous = false;
+
+      if (!contiguous ||
+          hasAliasingWrites(loop, group.first.getMemref(), aa))
+        continue;
+
+      // Loop is replaced, remaining groups will be handled on the next run.
+      forwardLoads(loop, group, minOffset, maxOffset, *step);
+      changed = true;
+      break;
+    }
+  }
+  return mlir::success(changed);
+}
+
 namespace {
 struct RemoveDeadAllocs
     : public mlir::OpInterfaceRewritePattern<mlir::MemoryEffectOpInterface> {
@@ -303,7 +641,9 @@ struct MemoryOptPass
 
   virtual void
   getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
     registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
     registry.insert<mlir::vector::VectorDialect>();
   }
 
@@ -316,19 +656,35 @@ struct MemoryOptPass
     mlir::FrozenRewritePatternSet fPatterns(std::move(patterns));
     auto am = getAnalysisManager();
     while (true) {
-      if (mlir::failed(
-              mlir::applyPatternsAndFoldGreedily(getOperation(), fPatterns)))
+      // Memory SSA is updated incrementally by listener and by memory opts
+      // itself, rebuild it only if rewrites touched memory in unsupported way.
+      numba::MemorySSAUpdater updater(am);
+      mlir::GreedyRewriteConfig config;
+      config.listener = &updater;
+      if (mlir::failed(mlir::applyPatternsAndFoldGreedily(getOperation(),
+                                                          fPatterns, config)))
         return signalPassFailure();
 
-      am.invalidate({});
+      if (updater.isInvalidated())
+        am.invalidate({});
+
       auto res = numba::optimizeMemoryOps(am);
       if (!res) {
         getOperation()->emitError("Failed to build memory SSA analysis");
         return signalPassFailure();
       }
-      if (mlir::failed(*res))
+      bool changed = mlir::succeeded(*res);
+      if (mlir::succeeded(numba::forwardLoopCarriedLoads(getOperation()))) {
+        am.invalidate({});
+        changed = true;
+      }
+
+      if (!changed)
         break;
     }
+
+    // Analysis is up to date, keep it for subsequent passes.
+    markAnalysesPreserved<numba::MemorySSAAnalysis, mlir::AliasAnalysis>();
   }
 };
 
@@ -531,6 +887,140 @@ struct NormalizeMemrefArgs
       markAllAnalysesPreserved();
   }
 };
+
+/// Allocations are not moved across function boundary, parallel loop bodies
+/// (buffers must stay per-thread) and non-CPU regions.
+static bool isHoistingBarrier(mlir::Operation *op) {
+  if (op->hasTrait<mlir::OpTrait::IsIsolatedFromAbove>())
+    return true;
+
+  if (mlir::isa<mlir::scf::ParallelOp, numba::util::ParallelOp>(op))
+    return true;
+
+  if (auto region = mlir::dyn_cast<numba::util::EnvironmentRegionOp>(op))
+    return !mlir::isa<numba::util::ParallelAttr>(region.getEnvironment());
+
+  return false;
+}
+
+/// Returns outermost sequential loop, alloc can be hoisted from.
+static mlir::Operation *getOutermostLoop(mlir::memref::AllocOp op) {
+  mlir::Operation *ret = nullptr;
+  auto parent = op->getParentOp();
+  while (parent && !isHoistingBarrier(parent)) {
+    if (llvm::any_of(op->getOperands(), [&](mlir::Value arg) {
+          return parent->isAncestor(arg.getParentRegion()->getParentOp());
+        }))
+      break;
+
+    if (mlir::isa<mlir::scf::ForOp, mlir::scf::WhileOp>(parent))
+      ret = parent;
+
+    parent = parent->getParentOp();
+  }
+  return ret;
+}
+
+static bool canPromoteToStack(mlir::memref::AllocOp op, uint64_t maxSize) {
+  auto type = op.getType();
+  if (!type.hasStaticShape() || type.getMemorySpace())
+    return false;
+
+  auto elemType = type.getElementType();
+  uint64_t elemBits;
+  if (mlir::isa<mlir::IndexType>(elemType)) {
+    elemBits = 64;
+  } else if (elemType.isIntOrFloat()) {
+    elemBits = elemType.getIntOrFloatBitWidth();
+  } else {
+    return false;
+  }
+
+  auto size = static_cast<uint64_t>(type.getNumElements()) *
+              std::max<uint64_t>(elemBits / 8, 1);
+  if (size > maxSize)
+    return false;
+
+  // Stack allocation inside the loop will grow the stack on each iteration.
+  auto parent = op->getParentOp();
+  while (!parent->hasTrait<mlir::OpTrait::IsIsolatedFromAbove>()) {
+    if (isHoistingBarrier(parent) ||
+        mlir::isa<mlir::LoopLikeOpInterface>(parent))
+      return false;
+
+    parent = parent->getParentOp();
+  }
+  return true;
+}
+
+static void eraseDeallocs(mlir::memref::AllocOp op) {
+  for (auto user : llvm::make_early_inc_range(op->getUsers()))
+    if (mlir::isa<mlir::memref::DeallocOp>(user))
+      user->erase();
+}
+
+struct OptimizeAllocsPass
+    : public mlir::PassWrapper<OptimizeAllocsPass,
+                               mlir::InterfacePass<mlir::FunctionOpInterface>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(OptimizeAllocsPass)
+
+  OptimizeAllocsPass(uint64_t maxSize) : maxStackAllocSize(maxSize) {}
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::memref::MemRefDialect>();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<mlir::memref::AllocOp> allocs;
+    getOperation()->walk([&](mlir::memref::AllocOp op) {
+      if (op.getSymbolOperands().empty() && !numba::canAllocEscape(op))
+        allocs.emplace_back(op);
+    });
+
+    if (allocs.empty())
+      return markAllAnalysesPreserved();
+
+    bool changed = false;
+    mlir::OpBuilder builder(&getContext());
+    for (auto alloc : allocs) {
+      auto loop = getOutermostLoop(alloc);
+      if (!loop)
+        continue;
+
+      // Buffer contents are undefined on each iteration, so it can be reused.
+      eraseDeallocs(alloc);
+      alloc->moveBefore(loop);
+      builder.setInsertionPointAfter(loop);
+      builder.create<mlir::memref::DeallocOp>(alloc.getLoc(), alloc);
+      changed = true;
+    }
+
+    if (maxStackAllocSize != 0) {
+      for (auto alloc : allocs) {
+        if (!canPromoteToStack(alloc, maxStackAllocSize))
+          continue;
+
+        eraseDeallocs(alloc);
+        builder.setInsertionPoint(alloc);
+        numba::AllocaInsertionPoint insertionPoint(alloc);
+        auto alloca = insertionPoint.insert(builder, [&]() {
+          return builder.create<mlir::memref::AllocaOp>(
+              alloc.getLoc(), alloc.getType(), alloc.getAlignmentAttr());
+        });
+        alloc->replaceAllUsesWith(alloca);
+        alloc->erase();
+        changed = true;
+      }
+    }
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+
+private:
+  uint64_t maxStackAllocSize;
+};
 } // namespace
 
 std::unique_ptr<mlir::Pass> numba::createMemoryOptPass() {
@@ -540,3 +1030,8 @@ std::unique_ptr<mlir::Pass> numba::createMemoryOptPass() {
 std::unique_ptr<mlir::Pass> numba::createNormalizeMemrefArgsPass() {
   return std::make_unique<NormalizeMemrefArgs>();
 }
+
+std::unique_ptr<mlir::Pass>
+numba::createOptimizeAllocsPass(uint64_t maxStackAllocSize) {
+  return std::make_unique<OptimizeAllocsPass>(maxStackAllocSize);
+}
@@ -0,0 +1,186 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/OutlineColdBlocks.hpp"
+
+#include <mlir/Dialect/LLVMIR/LLVMDialect.h>
+#include <mlir/Dialect/LLVMIR/LLVMTypes.h>
+#include <mlir/IR/Builders.h>
+#include <mlir/IR/BuiltinOps.h>
+#include <mlir/IR/SymbolTable.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/SetVector.h>
+#include <llvm/ADT/SmallPtrSet.h>
+
+namespace {
+/// Same weights as `__builtin_expect` lowering uses.
+static constexpr int32_t LikelyWeight = 2000;
+static constexpr int32_t UnlikelyWeight = 1;
+
+/// Returns cold blocks of the function: blocks, terminated by unreachable, and
+/// blocks, whose all successors are cold. Entry block is never cold.
+static llvm::SmallPtrSet<mlir::Block *, 8>
+getColdBlocks(mlir::LLVM::LLVMFuncOp func) {
+  llvm::SmallPtrSet<mlir::Block *, 8> cold;
+  auto &entry = func.getBody().front();
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto &block : func.getBody()) {
+      if (&block == &entry || cold.contains(&block))
+        continue;
+
+      auto term = block.getTerminator();
+      bool isCold = mlir::isa<mlir::LLVM::UnreachableOp>(term);
+      if (!isCold && term->getNumSuccessors() > 0)
+        isCold = llvm::all_of(term->getSuccessors(), [&](mlir::Block *succ) {
+          return cold.contains(succ);
+        });
+
+      if (isCold) {
+        cold.insert(&block);
+        changed = true;
+      }
+    }
+  }
+  return cold;
+}
+
+static void
+setBranchWeights(mlir::LLVM::LLVMFuncOp func,
+                 const llvm::SmallPtrSetImpl<mlir::Block *> &cold) {
+  mlir::OpBuilder builder(func.getContext());
+  func.walk([&](mlir::LLVM::CondBrOp op) {
+    if (cold.contains(op->getBlock()) || op.getBranchWeightsAttr())
+      return;
+
+    bool trueCold = cold.contains(op.getTrueDest());
+    bool falseCold = cold.contains(op.getFalseDest());
+    if (trueCold == falseCold)
+      return;
+
+    auto trueWeight = trueCold ? UnlikelyWeight : LikelyWeight;
+    auto falseWeight = falseCold ? UnlikelyWeight : LikelyWeight;
+    op.setBranchWeightsAttr(
+        builder.getDenseI32ArrayAttr({trueWeight, falseWeight}));
+  });
+}
+
+/// Values, used by the block, but defined outside of it, including the block
+/// arguments, or nullopt if block can't be outlined.
+static std::optional<llvm::SmallSetVector<mlir::Value, 8>>
+getBlockInputs(mlir::Block &block) {
+  llvm::SmallSetVector<mlir::Value, 8> inputs;
+  for (auto arg : block.getArguments())
+    inputs.insert(arg);
+
+  for (auto &op : block) {
+    if (op.getNumRegions() != 0)
+      return std::nullopt;
+
+    for (auto arg : op.getOperands()) {
+      auto def = arg.getDefiningOp();
+      if (def && def->getBlock() == &block)
+        continue;
+
+      if (!mlir::LLVM::isCompatibleType(arg.getType()))
+        return std::nullopt;
+
+      inputs.insert(arg);
+    }
+  }
+  return inputs;
+}
+
+/// Moves block ops into the new function, added to the `symbolTable`, and
+/// replaces them with its call.
+static bool outlineBlock(mlir::OpBuilder &builder,
+                         mlir::SymbolTable &symbolTable, mlir::Block &block,
+                         llvm::StringRef name) {
+  auto inputs = getBlockInputs(block);
+  if (!inputs)
+    return false;
+
+  auto ctx = builder.getContext();
+  auto loc = block.getTerminator()->getLoc();
+  llvm::SmallVector<mlir::Type> argTypes;
+  for (auto input : *inputs)
+    argTypes.emplace_back(input.getType());
+
+  auto funcType = mlir::LLVM::LLVMFunctionType::get(
+      mlir::LLVM::LLVMVoidType::get(ctx), argTypes);
+  builder.clearInsertionPoint();
+  auto outlined = builder.create<mlir::LLVM::LLVMFuncOp>(
+      loc, name, funcType, mlir::LLVM::Linkage::Internal);
+  outlined.setPassthroughAttr(builder.getStrArrayAttr(
+      {"noinline", "cold", "noreturn", "nounwind"}));
+
+  // Renames function if name is already used.
+  symbolTable.insert(outlined);
+
+  auto body = outlined.addEntryBlock();
+  body->getOperations().splice(body->end(), block.getOperations());
+  for (auto &&[input, arg] : llvm::zip(*inputs, body->getArguments()))
+    input.replaceUsesWithIf(arg, [&](mlir::OpOperand &use) {
+      return use.getOwner()->getBlock() == body;
+    });
+
+  builder.setInsertionPointToEnd(&block);
+  builder.create<mlir::LLVM::CallOp>(loc, outlined, inputs->getArrayRef());
+  builder.create<mlir::LLVM::UnreachableOp>(loc);
+  return true;
+}
+
+struct OutlineColdBlocksPass
+    : public mlir::PassWrapper<OutlineColdBlocksPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(OutlineColdBlocksPass)
+
+  OutlineColdBlocksPass(unsigned minOps) : minOps(minOps) {}
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::LLVM::LLVMDialect>();
+  }
+
+  void runOnOperation() override {
+    auto mod = getOperation();
+    mlir::OpBuilder builder(&getContext());
+    mlir::SymbolTable symbolTable(mod);
+
+    // Collect functions first, outlining adds new ones.
+    auto funcs = llvm::to_vector(mod.getOps<mlir::LLVM::LLVMFuncOp>());
+    for (auto func : funcs) {
+      if (func.isExternal())
+        continue;
+
+      auto cold = getColdBlocks(func);
+      if (cold.empty())
+        continue;
+
+      setBranchWeights(func, cold);
+
+      auto name = (func.getSymName() + ".cold").str();
+      for (auto &block : func.getBody()) {
+        // Terminator is not counted.
+        if (!cold.contains(&block) ||
+            !mlir::isa<mlir::LLVM::UnreachableOp>(block.getTerminator()) ||
+            block.getOperations().size() <= minOps)
+          continue;
+
+        outlineBlock(builder, symbolTable, block, name);
+      }
+    }
+  }
+
+private:
+  unsigned minOps;
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass>
+numba::createOutlineColdBlocksPass(unsigned minOps) {
+  return std::make_unique<OutlineColdBlocksPass>(minOps);
+}
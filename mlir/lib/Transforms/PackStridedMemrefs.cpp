@@ -0,0 +1,232 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/PackStridedMemrefs.hpp"
+
+#include "numba/Analysis/AliasAnalysis.hpp"
+#include "numba/Transforms/LoopUtils.hpp"
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Interfaces/ViewLikeInterface.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/MapVector.h>
+
+/// Max number of memrefs packed before the single loop.
+static constexpr unsigned MaxPackedMemrefs = 4;
+
+static bool hasNonUnitInnerStride(mlir::MemRefType type) {
+  if (type.getRank() == 0 || !type.getElementType().isIntOrIndexOrFloat())
+    return false;
+
+  llvm::SmallVector<int64_t> strides;
+  int64_t offset;
+  if (mlir::failed(mlir::getStridesAndOffset(type, strides, offset)))
+    return false;
+
+  return strides.back() != 1;
+}
+
+static bool isDefinedInside(mlir::Operation *op, mlir::Value val) {
+  return op->isAncestor(val.getParentRegion()->getParentOp());
+}
+
+/// Returns the value, memref is the view of.
+static mlir::Value getRoot(mlir::Value memref) {
+  while (auto view = memref.getDefiningOp<mlir::ViewLikeOpInterface>())
+    memref = view.getViewSource();
+
+  return memref;
+}
+
+static bool isAlloc(mlir::Value val) {
+  return mlir::isa_and_present<mlir::memref::AllocOp, mlir::memref::AllocaOp>(
+      val.getDefiningOp());
+}
+
+static bool isFuncArg(mlir::Value val) {
+  auto arg = mlir::dyn_cast<mlir::BlockArgument>(val);
+  return arg && mlir::isa<mlir::func::FuncOp>(arg.getOwner()->getParentOp());
+}
+
+/// Don't rely on the restrict args here, loop can be the fallback version
+/// of the runtime overlap check. Different roots are only considered
+/// non-aliasing if one of them is the fresh allocation and other is the
+/// allocation or function argument. Other values (e.g. `scf.if` results) can
+/// be the same allocation, yielded from the region.
+static bool mayAlias(mlir::Value lhs, mlir::Value rhs) {
+  lhs = getRoot(lhs);
+  rhs = getRoot(rhs);
+  if (lhs == rhs)
+    return true;
+
+  if (isAlloc(lhs))
+    return !isAlloc(rhs) && !isFuncArg(rhs);
+
+  if (isAlloc(rhs))
+    return !isFuncArg(lhs);
+
+  return true;
+}
+
+/// Access is reused if its innermost index is the loop induction variable
+/// and some of the enclosing loops induction variables, up to the `loop`, are
+/// not used by the indices, i.e. same element is read on multiple iterations.
+static bool isReusedAccess(mlir::scf::ParallelOp loop,
+                           mlir::memref::LoadOp load) {
+  llvm::SmallVector<mlir::Value> ivs;
+  auto parent = load->getParentOp();
+  while (true) {
+    if (auto par = mlir::dyn_cast<mlir::scf::ParallelOp>(parent)) {
+      llvm::append_range(ivs, par.getInductionVars());
+    } else if (auto forOp = mlir::dyn_cast<mlir::scf::ForOp>(parent)) {
+      ivs.emplace_back(forOp.getInductionVar());
+    }
+
+    if (parent == loop)
+      break;
+
+    parent = parent->getParentOp();
+  }
+
+  auto indices = load.getIndices();
+  if (!llvm::is_contained(ivs, indices.back()))
+    return false;
+
+  return llvm::any_of(
+      ivs, [&](mlir::Value iv) { return !llvm::is_contained(indices, iv); });
+}
+
+using Candidates = llvm::SmallVector<
+    std::pair<mlir::Value, llvm::SmallVector<mlir::memref::LoadOp>>>;
+
+static Candidates getCandidates(mlir::scf::ParallelOp loop) {
+  llvm::SmallMapVector<mlir::Value, llvm::SmallVector<mlir::memref::LoadOp>,
+                       4>
+      loads;
+  llvm::SmallVector<mlir::Value> written;
+  loop.getBody()->walk([&](mlir::Operation *op) {
+    if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op)) {
+      auto memref = load.getMemRef();
+      if (!isDefinedInside(loop, memref) &&
+          hasNonUnitInnerStride(load.getMemRefType()))
+        loads[memref].emplace_back(load);
+
+      return;
+    }
+
+    if (op->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>() ||
+        mlir::isa<mlir::memref::AllocOp, mlir::memref::AllocaOp,
+                  mlir::memref::DeallocOp>(op))
+      return;
+
+    numba::isWriter(*op, written);
+  });
+
+  Candidates ret;
+  for (auto &&[memref, memrefLoads] : loads) {
+    if (ret.size() >= MaxPackedMemrefs)
+      break;
+
+    if (!llvm::all_of(memrefLoads, [&](mlir::memref::LoadOp load) {
+          return isReusedAccess(loop, load);
+        }))
+      continue;
+
+    if (llvm::any_of(written, [&](mlir::Value val) {
+          return mlir::isa<mlir::MemRefType>(val.getType()) &&
+                 mayAlias(memref, val);
+        }))
+      continue;
+
+    ret.emplace_back(memref, std::move(memrefLoads));
+  }
+  return ret;
+}
+
+/// Copies `memref` into the new identity layout buffer.
+static mlir::Value packMemref(mlir::OpBuilder &builder, mlir::Location loc,
+                              mlir::Value memref) {
+  auto srcType = mlir::cast<mlir::MemRefType>(memref.getType());
+  auto rank = srcType.getRank();
+
+  llvm::SmallVector<mlir::Value> sizes;
+  llvm::SmallVector<mlir::Value> dynSizes;
+  for (auto i : llvm::seq<int64_t>(0, rank)) {
+    mlir::Value size =
+        builder.createOrFold<mlir::memref::DimOp>(loc, memref, i);
+    sizes.emplace_back(size);
+    if (srcType.isDynamicDim(i))
+      dynSizes.emplace_back(size);
+  }
+
+  auto dstType = mlir::MemRefType::get(srcType.getShape(),
+                                       srcType.getElementType(),
+                                       mlir::MemRefLayoutAttrInterface{},
+                                       srcType.getMemorySpace());
+  mlir::Value dst =
+      builder.create<mlir::memref::AllocOp>(loc, dstType, dynSizes);
+
+  mlir::Value zero = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  mlir::Value one = builder.create<mlir::arith::ConstantIndexOp>(loc, 1);
+  llvm::SmallVector<mlir::Value> lower(rank, zero);
+  llvm::SmallVector<mlir::Value> steps(rank, one);
+  auto bodyBuilder = [&](mlir::OpBuilder &b, mlir::Location l,
+                         mlir::ValueRange ivs) {
+    mlir::Value val = b.create<mlir::memref::LoadOp>(l, memref, ivs);
+    b.create<mlir::memref::StoreOp>(l, val, dst, ivs);
+  };
+  builder.create<mlir::scf::ParallelOp>(loc, lower, sizes, steps, bodyBuilder);
+  return dst;
+}
+
+namespace {
+struct PackStridedMemrefsPass
+    : public mlir::PassWrapper<PackStridedMemrefsPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(PackStridedMemrefsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<std::pair<mlir::scf::ParallelOp, Candidates>> toPack;
+    getOperation()->walk([&](mlir::scf::ParallelOp loop) {
+      if (loop->getParentOfType<mlir::scf::ParallelOp>() ||
+          !numba::isCPULoop(loop))
+        return;
+
+      auto candidates = getCandidates(loop);
+      if (!candidates.empty())
+        toPack.emplace_back(loop, std::move(candidates));
+    });
+
+    if (toPack.empty())
+      return markAllAnalysesPreserved();
+
+    mlir::OpBuilder builder(&getContext());
+    for (auto &&[loop, candidates] : toPack) {
+      builder.setInsertionPoint(loop);
+      for (auto &&[memref, loads] : candidates) {
+        auto packed = packMemref(builder, loop.getLoc(), memref);
+
+        // Only replace loads, other users may rely on the original type.
+        for (auto load : loads)
+          load.getMemrefMutable().assign(packed);
+      }
+    }
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> numba::createPackStridedMemrefsPass() {
+  return std::make_unique<PackStridedMemrefsPass>();
+}
@@ -9,6 +9,10 @@
 
 #include <mlir/Dialect/Arith/IR/Arith.h>
 #include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Vector/IR/VectorOps.h>
+#include <mlir/IR/Matchers.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
 #include <mlir/Pass/Pass.h>
 #include <mlir/Transforms/DialectConversion.h>
 
@@ -269,6 +273,208 @@ void numba::populatePromoteBoolMemrefConversionRewritesAndTarget(
                   ConvertRetainOp>(typeConverter, context);
 }
 
+/// Number of bools in packed storage element.
+static constexpr int64_t BitsPerByte = 8;
+
+static bool isMultipleOfByte(mlir::Value idx) {
+  llvm::APInt cst;
+  if (mlir::matchPattern(idx, mlir::m_ConstantInt(&cst)))
+    return cst.getSExtValue() % BitsPerByte == 0;
+
+  if (auto mul = idx.getDefiningOp<mlir::arith::MulIOp>())
+    return isMultipleOfByte(mul.getLhs()) || isMultipleOfByte(mul.getRhs());
+
+  return false;
+}
+
+/// Vector access is only packed if it covers whole bytes.
+static bool isPackableVectorAccess(mlir::VectorType type,
+                                   mlir::ValueRange indices) {
+  return type.getRank() == 1 && type.getDimSize(0) % BitsPerByte == 0 &&
+         isMultipleOfByte(indices.front());
+}
+
+/// Only 1D contiguous temporaries, which are accessed only by loads and
+/// stores, so packed layout never escapes to the caller or to the device code.
+static bool isPackable(mlir::memref::AllocOp alloc) {
+  auto type = alloc.getType();
+  if (type.getRank() != 1 || !isI1(type.getElementType()) ||
+      !type.getLayout().isIdentity())
+    return false;
+
+  mlir::Value mem = alloc.getResult();
+  for (auto &use : mem.getUses()) {
+    auto user = use.getOwner();
+    if (user->getParentOfType<numba::util::EnvironmentRegionOp>())
+      return false;
+
+    if (mlir::isa<mlir::memref::LoadOp, mlir::memref::DimOp,
+                  mlir::memref::DeallocOp>(user))
+      continue;
+
+    if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(user)) {
+      if (store.getMemref() != mem)
+        return false;
+
+      continue;
+    }
+
+    if (auto load = mlir::dyn_cast<mlir::vector::LoadOp>(user)) {
+      if (!isPackableVectorAccess(load.getVectorType(), load.getIndices()))
+        return false;
+
+      continue;
+    }
+
+    if (auto store = mlir::dyn_cast<mlir::vector::StoreOp>(user)) {
+      if (store.getBase() != mem ||
+          !isPackableVectorAccess(store.getVectorType(), store.getIndices()))
+        return false;
+
+      continue;
+    }
+
+    return false;
+  }
+  return true;
+}
+
+/// Stores from the different parallel loop iterations can modify the same
+/// byte.
+static bool needAtomicStore(mlir::Operation *store,
+                            mlir::memref::AllocOp alloc) {
+  auto parallel = store->getParentOfType<mlir::scf::ParallelOp>();
+  return parallel && !parallel->isAncestor(alloc);
+}
+
+/// Replace `i1` alloc with `i8` alloc, storing 8 values per byte, lowest bit
+/// first, so bits order is the same as for the `vector.bitcast` lanes.
+static void packBoolAlloc(mlir::memref::AllocOp alloc) {
+  mlir::OpBuilder builder(alloc);
+  auto loc = alloc.getLoc();
+  auto type = alloc.getType();
+  auto i8 = builder.getIntegerType(8);
+  auto idxShift = builder.create<mlir::arith::ConstantIndexOp>(loc, 3);
+  auto idxMask =
+      builder.create<mlir::arith::ConstantIndexOp>(loc, BitsPerByte - 1);
+
+  mlir::Value size;
+  int64_t packedDim = mlir::ShapedType::kDynamic;
+  llvm::SmallVector<mlir::Value, 1> packedSizes;
+  if (type.isDynamicDim(0)) {
+    size = alloc.getDynamicSizes().front();
+    mlir::Value rounded =
+        builder.create<mlir::arith::AddIOp>(loc, size, idxMask);
+    packedSizes.emplace_back(
+        builder.create<mlir::arith::ShRUIOp>(loc, rounded, idxShift));
+  } else {
+    auto dim = type.getDimSize(0);
+    size = builder.create<mlir::arith::ConstantIndexOp>(loc, dim);
+    packedDim = (dim + BitsPerByte - 1) / BitsPerByte;
+  }
+
+  auto packedType =
+      mlir::MemRefType::get(packedDim, i8, mlir::MemRefLayoutAttrInterface{},
+                            type.getMemorySpace());
+  mlir::Value packed = builder.create<mlir::memref::AllocOp>(
+      loc, packedType, packedSizes, alloc.getAlignmentAttr());
+
+  auto getBytePos = [&](mlir::Location loc, mlir::Value idx)
+      -> std::pair<mlir::Value, mlir::Value> {
+    mlir::Value byteIdx =
+        builder.create<mlir::arith::ShRUIOp>(loc, idx, idxShift);
+    mlir::Value bit = builder.create<mlir::arith::AndIOp>(loc, idx, idxMask);
+    bit = builder.create<mlir::arith::IndexCastOp>(loc, i8, bit);
+    return {byteIdx, bit};
+  };
+
+  for (auto user : llvm::make_early_inc_range(alloc->getUsers())) {
+    builder.setInsertionPoint(user);
+    auto userLoc = user->getLoc();
+    if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(user)) {
+      auto [byteIdx, bit] = getBytePos(userLoc, load.getIndices().front());
+      mlir::Value byte =
+          builder.create<mlir::memref::LoadOp>(userLoc, packed, byteIdx);
+      byte = builder.create<mlir::arith::ShRUIOp>(userLoc, byte, bit);
+      mlir::Value res = builder.create<mlir::arith::TruncIOp>(
+          userLoc, builder.getI1Type(), byte);
+      load.replaceAllUsesWith(res);
+      load->erase();
+    } else if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(user)) {
+      auto [byteIdx, bit] = getBytePos(userLoc, store.getIndices().front());
+      mlir::Value one =
+          builder.create<mlir::arith::ConstantIntOp>(userLoc, 1, 8);
+      mlir::Value allOnes =
+          builder.create<mlir::arith::ConstantIntOp>(userLoc, -1, 8);
+      mlir::Value mask = builder.create<mlir::arith::ShLIOp>(userLoc, one, bit);
+      mlir::Value notMask =
+          builder.create<mlir::arith::XOrIOp>(userLoc, mask, allOnes);
+      mlir::Value val =
+          builder.create<mlir::arith::ExtUIOp>(userLoc, i8, store.getValue());
+      val = builder.create<mlir::arith::ShLIOp>(userLoc, val, bit);
+      if (needAtomicStore(store, alloc)) {
+        builder.create<mlir::memref::AtomicRMWOp>(
+            userLoc, mlir::arith::AtomicRMWKind::andi, notMask, packed,
+            byteIdx);
+        builder.create<mlir::memref::AtomicRMWOp>(
+            userLoc, mlir::arith::AtomicRMWKind::ori, val, packed, byteIdx);
+      } else {
+        mlir::Value byte =
+            builder.create<mlir::memref::LoadOp>(userLoc, packed, byteIdx);
+        byte = builder.create<mlir::arith::AndIOp>(userLoc, byte, notMask);
+        byte = builder.create<mlir::arith::OrIOp>(userLoc, byte, val);
+        builder.create<mlir::memref::StoreOp>(userLoc, byte, packed, byteIdx);
+      }
+      store->erase();
+    } else if (auto load = mlir::dyn_cast<mlir::vector::LoadOp>(user)) {
+      auto vecType = load.getVectorType();
+      auto packedVecType =
+          mlir::VectorType::get(vecType.getDimSize(0) / BitsPerByte, i8);
+      mlir::Value byteIdx = builder.create<mlir::arith::ShRUIOp>(
+          userLoc, load.getIndices().front(), idxShift);
+      mlir::Value res = builder.create<mlir::vector::LoadOp>(
+          userLoc, packedVecType, packed, byteIdx);
+      res = builder.create<mlir::vector::BitCastOp>(userLoc, vecType, res);
+      load.replaceAllUsesWith(res);
+      load->erase();
+    } else if (auto store = mlir::dyn_cast<mlir::vector::StoreOp>(user)) {
+      auto vecType = store.getVectorType();
+      auto packedVecType =
+          mlir::VectorType::get(vecType.getDimSize(0) / BitsPerByte, i8);
+      mlir::Value byteIdx = builder.create<mlir::arith::ShRUIOp>(
+          userLoc, store.getIndices().front(), idxShift);
+      mlir::Value val = builder.create<mlir::vector::BitCastOp>(
+          userLoc, packedVecType, store.getValueToStore());
+      builder.create<mlir::vector::StoreOp>(userLoc, val, packed, byteIdx);
+      store->erase();
+    } else if (auto dim = mlir::dyn_cast<mlir::memref::DimOp>(user)) {
+      dim.replaceAllUsesWith(size);
+      dim->erase();
+    } else if (auto dealloc = mlir::dyn_cast<mlir::memref::DeallocOp>(user)) {
+      builder.create<mlir::memref::DeallocOp>(userLoc, packed);
+      dealloc->erase();
+    } else {
+      llvm_unreachable("Invalid user");
+    }
+  }
+  alloc->erase();
+}
+
+/// Pack bool temporaries in functions marked with pack-bool-arrays attribute.
+static void packBoolArrays(mlir::Operation *root) {
+  auto attrName = mlir::StringAttr::get(
+      root->getContext(), numba::util::attributes::getPackBoolArraysName());
+  llvm::SmallVector<mlir::memref::AllocOp> allocs;
+  root->walk([&](mlir::memref::AllocOp alloc) {
+    auto func = alloc->getParentOfType<mlir::FunctionOpInterface>();
+    if (func && func->hasAttr(attrName) && isPackable(alloc))
+      allocs.emplace_back(alloc);
+  });
+
+  for (auto alloc : allocs)
+    packBoolAlloc(alloc);
+}
+
 namespace {
 struct PromoteBoolMemrefPass
     : public mlir::PassWrapper<PromoteBoolMemrefPass, mlir::OperationPass<>> {
@@ -282,6 +488,7 @@ struct PromoteBoolMemrefPass
 
   void runOnOperation() override {
     auto &context = getContext();
+    packBoolArrays(getOperation());
 
     mlir::TypeConverter typeConverter;
     // Convert unknown types to itself
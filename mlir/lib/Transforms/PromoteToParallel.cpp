@@ -9,10 +9,14 @@
 #include "numba/Transforms/ConstUtils.hpp"
 
 #include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
 #include <mlir/Dialect/SCF/IR/SCF.h>
 #include <mlir/IR/Dominance.h>
 #include <mlir/IR/IRMapping.h>
 #include <mlir/Interfaces/CallInterfaces.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
+#include <mlir/Interfaces/LoopLikeInterface.h>
+#include <mlir/Interfaces/ViewLikeInterface.h>
 #include <mlir/Pass/Pass.h>
 #include <mlir/Transforms/GreedyPatternRewriteDriver.h>
 
@@ -44,6 +48,138 @@ static bool canParallelizeLoop(mlir::Operation *op, bool hasParallelAttr) {
   return hasParallelAttr || !hasSideEffects(op);
 }
 
+namespace {
+/// Histogram-like memory update `m[idx] = m[idx] + val`.
+struct MemUpdate {
+  mlir::memref::LoadOp load;
+  mlir::Operation *addOp;
+  mlir::memref::StoreOp store;
+  mlir::Value value;
+};
+} // namespace
+
+static std::optional<mlir::arith::AtomicRMWKind>
+getAtomicKind(mlir::Operation *op) {
+  if (mlir::isa<mlir::arith::AddIOp>(op))
+    return mlir::arith::AtomicRMWKind::addi;
+
+  if (mlir::isa<mlir::arith::AddFOp>(op))
+    return mlir::arith::AtomicRMWKind::addf;
+
+  return std::nullopt;
+}
+
+static std::optional<MemUpdate> getMemUpdate(mlir::memref::StoreOp store) {
+  auto addOp = store.getValueToStore().getDefiningOp();
+  if (!addOp || !getAtomicKind(addOp) || !addOp->hasOneUse())
+    return std::nullopt;
+
+  for (bool reverse : {false, true}) {
+    auto load = addOp->getOperand(reverse ? 1 : 0)
+                    .getDefiningOp<mlir::memref::LoadOp>();
+    if (!load || !load->hasOneUse() || load->getBlock() != store->getBlock())
+      continue;
+
+    if (load.getMemRef() != store.getMemRef() ||
+        load.getIndices() != store.getIndices())
+      continue;
+
+    return MemUpdate{load, addOp, store, addOp->getOperand(reverse ? 0 : 1)};
+  }
+  return std::nullopt;
+}
+
+/// Checks all users of the allocation, including views, inside the loop are
+/// the specified updates.
+static bool checkAllocUsers(mlir::Value memref, mlir::Operation *loop,
+                            const llvm::SmallDenseSet<mlir::Operation *> &ops) {
+  for (auto user : memref.getUsers()) {
+    if (ops.contains(user))
+      continue;
+
+    if (auto view = mlir::dyn_cast<mlir::ViewLikeOpInterface>(user)) {
+      if (view.getViewSource() == memref &&
+          !checkAllocUsers(view->getResult(0), loop, ops))
+        return false;
+
+      continue;
+    }
+
+    if (loop->isAncestor(user))
+      return false;
+  }
+  return true;
+}
+
+/// Collects memory updates, which can be done atomically, to run the loop in
+/// parallel. Returns false if there are any other side effects in the loop.
+/// Updates are only allowed to the local allocations, as function arguments
+/// can alias other arrays, accessed from the loop.
+static bool collectAtomicUpdates(mlir::scf::ForOp loop,
+                                 llvm::SmallVectorImpl<MemUpdate> &updates) {
+  auto visitor = [&](mlir::Operation *bodyOp) -> mlir::WalkResult {
+    if (bodyOp->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>() ||
+        bodyOp->hasTrait<mlir::OpTrait::IsTerminator>())
+      return mlir::WalkResult::advance();
+
+    if (mlir::isa<mlir::CallOpInterface>(bodyOp))
+      return mlir::WalkResult::interrupt();
+
+    auto memEffects = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(bodyOp);
+    if (!memEffects)
+      return mlir::WalkResult::interrupt();
+
+    if (!memEffects.hasEffect<mlir::MemoryEffects::Write>())
+      return mlir::WalkResult::advance();
+
+    auto store = mlir::dyn_cast<mlir::memref::StoreOp>(bodyOp);
+    if (!store)
+      return mlir::WalkResult::interrupt();
+
+    auto update = getMemUpdate(store);
+    if (!update)
+      return mlir::WalkResult::interrupt();
+
+    auto memref = store.getMemRef();
+    if (!memref.getDefiningOp<mlir::memref::AllocOp>() &&
+        !memref.getDefiningOp<mlir::memref::AllocaOp>())
+      return mlir::WalkResult::interrupt();
+
+    updates.emplace_back(*update);
+    return mlir::WalkResult::advance();
+  };
+  if (loop.getBody()->walk(visitor).wasInterrupted() || updates.empty())
+    return false;
+
+  llvm::SmallDenseSet<mlir::Operation *> ops;
+  for (auto &update : updates) {
+    ops.insert(update.load);
+    ops.insert(update.store);
+  }
+
+  for (auto &update : updates)
+    if (!checkAllocUsers(update.store.getMemRef(), loop, ops))
+      return false;
+
+  return true;
+}
+
+/// Replace memory updates with atomic ops.
+static void genAtomicUpdates(mlir::PatternRewriter &rewriter,
+                             llvm::ArrayRef<MemUpdate> updates) {
+  mlir::OpBuilder::InsertionGuard g(rewriter);
+  for (auto &update : updates) {
+    auto store = update.store;
+    rewriter.setInsertionPoint(store);
+    rewriter.create<mlir::memref::AtomicRMWOp>(
+        store.getLoc(), *getAtomicKind(update.addOp), update.value,
+        store.getMemRef(), store.getIndices());
+    rewriter.eraseOp(store);
+    rewriter.eraseOp(update.addOp);
+    rewriter.eraseOp(update.load);
+  }
+}
+
 using CheckFunc = bool (*)(mlir::Operation *, mlir::Value);
 using LowerFunc = mlir::Value (*)(mlir::OpBuilder &, mlir::Location,
                                   mlir::Value, mlir::Operation *);
@@ -174,6 +310,41 @@ static bool isInsideParallelRegion(mlir::Operation *op) {
   }
 }
 
+/// Atomic updates only pay off if the loop will actually run in parallel:
+/// function is compiled with more than one thread, or loop is inside the
+/// explicit parallel region. Otherwise loop stays serial anyway, and atomics
+/// only add the overhead and make float accumulation order-dependent.
+static bool canUseAtomicUpdates(mlir::Operation *op) {
+  if (isInsideParallelRegion(op))
+    return true;
+
+  auto func = op->getParentOfType<mlir::FunctionOpInterface>();
+  if (!func)
+    return false;
+
+  auto mc = func->getAttrOfType<mlir::IntegerAttr>(
+      numba::util::attributes::getMaxConcurrencyName());
+  return mc && mc.getInt() > 1;
+}
+
+static bool isParforLoop(mlir::Operation *op) {
+  return op->hasAttr(numba::util::attributes::getParforLoweredName());
+}
+
+/// Numba parfor pass already decided which loops inside the parfor are
+/// parallel, nested loops, not coming from parfors, are left as is.
+static bool isInsideParforLoop(mlir::Operation *op) {
+  auto parent = op->getParentOp();
+  while (parent) {
+    if (mlir::isa<mlir::scf::ForOp, mlir::scf::ParallelOp>(parent) &&
+        isParforLoop(parent))
+      return true;
+
+    parent = parent->getParentOp();
+  }
+  return false;
+}
+
 static bool checkIndexType(mlir::arith::CmpIOp op) {
   auto type = op.getLhs().getType();
   if (mlir::isa<mlir::IndexType>(type))
@@ -379,7 +550,12 @@ struct PromoteToParallel : public mlir::OpRewritePattern<mlir::scf::ForOp> {
     if (!op.getLowerBound().getType().isIndex())
       return mlir::failure();
 
-    if (!canParallelizeLoop(op, isInsideParallelRegion(op)))
+    if (!isParforLoop(op) && isInsideParforLoop(op))
+      return mlir::failure();
+
+    llvm::SmallVector<MemUpdate> atomicUpdates;
+    if (!canParallelizeLoop(op, isInsideParallelRegion(op)) &&
+        (!canUseAtomicUpdates(op) || !collectAtomicUpdates(op, atomicUpdates)))
       return mlir::failure();
 
     mlir::Block *loopBody = op.getBody();
@@ -421,6 +597,10 @@ struct PromoteToParallel : public mlir::OpRewritePattern<mlir::scf::ForOp> {
         if (reductionOpsSet.count(user) == 0)
           return mlir::failure();
 
+    // Reductions through memory are done with atomics, as iterations can
+    // update the same element.
+    genAtomicUpdates(rewriter, atomicUpdates);
+
     auto bodyBuilder = [&](mlir::OpBuilder &builder, mlir::Location loc,
                            mlir::ValueRange iterVals, mlir::ValueRange) {
       assert(1 == iterVals.size());
@@ -453,9 +633,12 @@ struct PromoteToParallel : public mlir::OpRewritePattern<mlir::scf::ForOp> {
       }
     };
 
-    rewriter.replaceOpWithNewOp<mlir::scf::ParallelOp>(
+    auto newOp = rewriter.replaceOpWithNewOp<mlir::scf::ParallelOp>(
         op, op.getLowerBound(), op.getUpperBound(), op.getStep(),
         op.getInitArgs(), bodyBuilder);
+    if (isParforLoop(op))
+      newOp->setAttr(numba::util::attributes::getParforLoweredName(),
+                     rewriter.getUnitAttr());
 
     return mlir::success();
   }
@@ -475,6 +658,12 @@ struct MergeNestedForIntoParallel
     if (!parent.getLowerBound().getType().isIndex())
       return mlir::failure();
 
+    // Don't merge parfor loops with the surrounding user loops and vice versa.
+    bool isParfor = isParforLoop(op);
+    if (isParfor != isParforLoop(parent) ||
+        (!isParfor && isInsideParforLoop(parent)))
+      return mlir::failure();
+
     auto block = parent.getBody();
     if (!llvm::hasSingleElement(block->without_terminator()))
       return mlir::failure();
@@ -532,9 +721,12 @@ struct MergeNestedForIntoParallel
     };
 
     rewriter.setInsertionPoint(parent);
-    rewriter.replaceOpWithNewOp<mlir::scf::ParallelOp>(
+    auto newOp = rewriter.replaceOpWithNewOp<mlir::scf::ParallelOp>(
         parent, lowerBounds, upperBounds, steps, parent.getInitArgs(),
         bodyBuilder);
+    if (isParfor)
+      newOp->setAttr(numba::util::attributes::getParforLoweredName(),
+                     rewriter.getUnitAttr());
 
     return mlir::success();
   }
@@ -584,7 +776,28 @@ struct PromoteToParallelPass
 
     if (mlir::failed(mlir::applyPatternsAndFoldGreedily(getOperation(),
                                                         std::move(patterns))))
-      signalPassFailure();
+      return signalPassFailure();
+
+    // Report outermost loops, which were left sequential. Skip the same loops
+    // `PromoteToParallel` doesn't consider.
+    getOperation()->walk([](mlir::scf::ForOp loop) {
+      if (!loop.getLowerBound().getType().isIndex() ||
+          loop->getParentOfType<mlir::LoopLikeOpInterface>() ||
+          (!isParforLoop(loop) && isInsideParforLoop(loop)))
+        return;
+
+      llvm::SmallVector<MemUpdate> atomicUpdates;
+      if (!canParallelizeLoop(loop, isInsideParallelRegion(loop)) &&
+          (!canUseAtomicUpdates(loop) ||
+           !collectAtomicUpdates(loop, atomicUpdates))) {
+        loop.emitRemark("Loop is not parallelized: loop body has side "
+                        "effects, which may depend on other iterations");
+        return;
+      }
+
+      loop.emitRemark("Loop is not parallelized: loop-carried values are "
+                      "not supported reductions");
+    });
   }
 };
 } // namespace
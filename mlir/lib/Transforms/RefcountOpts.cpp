@@ -0,0 +1,204 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/RefcountOpts.hpp"
+
+#include "numba/Dialect/numba_util/Dialect.hpp"
+
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Vector/IR/VectorOps.h>
+#include <mlir/Interfaces/ViewLikeInterface.h>
+#include <mlir/Pass/Pass.h>
+
+/// Returns the value, memref is the view of. All views share the meminfo
+/// with the root.
+static mlir::Value getRoot(mlir::Value memref) {
+  while (auto view = memref.getDefiningOp<mlir::ViewLikeOpInterface>())
+    memref = view.getViewSource();
+
+  return memref;
+}
+
+static bool isAlloc(mlir::Value val) {
+  return mlir::isa_and_present<mlir::memref::AllocOp>(val.getDefiningOp());
+}
+
+/// Different roots can still share the meminfo (e.g. `scf.if` result can be
+/// the allocation, yielded from its region), unless both of them are distinct
+/// allocations.
+static bool mayShareMeminfo(mlir::Value lhs, mlir::Value rhs) {
+  if (lhs == rhs)
+    return true;
+
+  return !isAlloc(lhs) || !isAlloc(rhs);
+}
+
+/// Returns true if `op` or any of its nested ops may release the meminfo of
+/// `root`.
+static bool mayRelease(mlir::Operation *op, mlir::Value root) {
+  auto res = op->walk([&](mlir::memref::DeallocOp dealloc) {
+    if (mayShareMeminfo(getRoot(dealloc.getMemref()), root))
+      return mlir::WalkResult::interrupt();
+
+    return mlir::WalkResult::advance();
+  });
+  return res.wasInterrupted();
+}
+
+/// Cancels `retain` with the next dealloc of the same meminfo in the block.
+/// Refcount between them is lower by one than before, which is still safe as
+/// retain source must be alive at the retain and nothing releases it before
+/// the dealloc.
+static bool cancelRetain(numba::util::RetainOp retain) {
+  mlir::Value src = retain.getSource();
+  mlir::Type srcType = src.getType();
+  mlir::Type dstType = retain.getType();
+  if (srcType != dstType &&
+      !mlir::memref::CastOp::areCastCompatible(srcType, dstType))
+    return false;
+
+  auto root = getRoot(src);
+  mlir::memref::DeallocOp dealloc;
+  for (auto it = std::next(retain->getIterator()),
+            end = retain->getBlock()->end();
+       it != end; ++it) {
+    auto &op = *it;
+    if (auto d = mlir::dyn_cast<mlir::memref::DeallocOp>(op)) {
+      auto deallocRoot = getRoot(d.getMemref());
+      if (deallocRoot == root) {
+        dealloc = d;
+        break;
+      }
+    }
+
+    if (mayRelease(&op, root))
+      return false;
+  }
+
+  if (!dealloc)
+    return false;
+
+  if (srcType != dstType) {
+    mlir::OpBuilder builder(retain);
+    src = builder.create<mlir::memref::CastOp>(retain.getLoc(), dstType, src);
+  }
+
+  retain->replaceAllUsesWith(mlir::ValueRange(src));
+  retain->erase();
+  dealloc->erase();
+  return true;
+}
+
+/// Ops, which can use the meminfo, but never capture it.
+static bool isNonCapturingUser(mlir::OpOperand &use) {
+  auto owner = use.getOwner();
+  if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(owner))
+    return use.get() == store.getMemref();
+
+  if (auto store = mlir::dyn_cast<mlir::vector::StoreOp>(owner))
+    return use.get() == store.getBase();
+
+  return mlir::isa<mlir::memref::LoadOp, mlir::memref::DimOp,
+                   mlir::memref::DeallocOp, mlir::memref::CopyOp,
+                   mlir::memref::PrefetchOp,
+                   mlir::memref::ExtractStridedMetadataOp,
+                   mlir::memref::ExtractAlignedPointerAsIndexOp,
+                   mlir::vector::LoadOp, mlir::vector::MaskedLoadOp,
+                   mlir::func::ReturnOp>(owner);
+}
+
+/// Only host code outside of parallel loops is guaranteed to be executed by
+/// the single thread.
+static bool isSerialHostOp(mlir::Operation *op) {
+  return !op->getParentOfType<mlir::scf::ParallelOp>() &&
+         !op->getParentOfType<numba::util::ParallelOp>() &&
+         !op->getParentOfType<numba::util::EnvironmentRegionOp>();
+}
+
+/// Collects refcount ops of the `alloc` meminfo, returns false if it may
+/// escape to other threads.
+static bool
+collectLocalRefcountOps(mlir::memref::AllocOp alloc,
+                        llvm::SmallVectorImpl<mlir::Operation *> &ops) {
+  llvm::SmallVector<mlir::Value> worklist;
+  worklist.emplace_back(alloc.getResult());
+  while (!worklist.empty()) {
+    auto val = worklist.pop_back_val();
+    for (auto &use : val.getUses()) {
+      auto owner = use.getOwner();
+      auto env = owner->getParentOfType<numba::util::EnvironmentRegionOp>();
+      if (env && !mlir::isa<numba::util::ParallelAttr>(env.getEnvironment()))
+        return false;
+
+      if (auto view = mlir::dyn_cast<mlir::ViewLikeOpInterface>(owner)) {
+        if (view.getViewSource() != val)
+          return false;
+
+        if (mlir::isa<numba::util::RetainOp>(owner))
+          ops.emplace_back(owner);
+
+        for (auto res : owner->getResults())
+          worklist.emplace_back(res);
+
+        continue;
+      }
+
+      if (!isNonCapturingUser(use))
+        return false;
+
+      if (mlir::isa<mlir::memref::DeallocOp>(owner))
+        ops.emplace_back(owner);
+    }
+  }
+  return true;
+}
+
+namespace {
+struct RefcountOptsPass
+    : public mlir::PassWrapper<RefcountOptsPass, mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(RefcountOptsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::memref::MemRefDialect>();
+  }
+
+  void runOnOperation() override {
+    bool changed = false;
+
+    llvm::SmallVector<numba::util::RetainOp> retains;
+    getOperation()->walk(
+        [&](numba::util::RetainOp op) { retains.emplace_back(op); });
+
+    for (auto retain : retains)
+      changed = cancelRetain(retain) || changed;
+
+    auto attrName = numba::util::attributes::getNonatomicRefcountName();
+    auto unitAttr = mlir::UnitAttr::get(&getContext());
+    llvm::SmallVector<mlir::Operation *> ops;
+    getOperation()->walk([&](mlir::memref::AllocOp alloc) {
+      ops.clear();
+      if (!collectLocalRefcountOps(alloc, ops))
+        return;
+
+      for (auto op : ops) {
+        if (!isSerialHostOp(op) || op->hasAttr(attrName))
+          continue;
+
+        op->setAttr(attrName, unitAttr);
+        changed = true;
+      }
+    });
+
+    if (!changed)
+      return markAllAnalysesPreserved();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> numba::createRefcountOptsPass() {
+  return std::make_unique<RefcountOptsPass>();
+}
@@ -0,0 +1,198 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/ReuseBuffers.hpp"
+
+#include <mlir/Dialect/Linalg/IR/Linalg.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+/// Returns alloc op if value is a buffer, allocated in the `block`.
+static mlir::memref::AllocOp getLocalAlloc(mlir::Value value,
+                                           mlir::Block *block) {
+  auto alloc = value.getDefiningOp<mlir::memref::AllocOp>();
+  if (!alloc || alloc->getBlock() != block ||
+      !alloc.getSymbolOperands().empty())
+    return nullptr;
+
+  return alloc;
+}
+
+/// Buffer users, for which we can track liveness. Views and casts can outlive
+/// the last direct use, so they are not supported.
+static bool isSupportedUser(mlir::Operation *op) {
+  return mlir::isa<mlir::linalg::LinalgOp, mlir::memref::LoadOp,
+                   mlir::memref::StoreOp, mlir::memref::DimOp,
+                   mlir::memref::CopyOp>(op);
+}
+
+/// Checks that buffer is not used after `op` (and, if `inclusive` is false,
+/// by `op` itself).
+static bool isDeadAfter(mlir::memref::AllocOp alloc, mlir::Operation *op,
+                        bool inclusive) {
+  auto block = op->getBlock();
+  for (auto user : alloc->getUsers()) {
+    if (!isSupportedUser(user))
+      return false;
+
+    auto ancestor = block->findAncestorOpInBlock(*user);
+    if (!ancestor)
+      return false;
+
+    if (ancestor == op) {
+      if (!inclusive || user != op)
+        return false;
+
+      continue;
+    }
+
+    if (op->isBeforeInBlock(ancestor))
+      return false;
+  }
+  return true;
+}
+
+/// Checks that buffer is not used before `op`.
+static bool isUnusedBefore(mlir::memref::AllocOp alloc, mlir::Operation *op) {
+  auto block = op->getBlock();
+  for (auto user : alloc->getUsers()) {
+    auto ancestor = block->findAncestorOpInBlock(*user);
+    if (!ancestor)
+      return false;
+
+    if (ancestor != op && ancestor->isBeforeInBlock(op))
+      return false;
+  }
+  return true;
+}
+
+static bool isSameBuffer(mlir::memref::AllocOp alloc1,
+                         mlir::memref::AllocOp alloc2) {
+  return alloc1.getType() == alloc2.getType() &&
+         alloc1.getDynamicSizes() == alloc2.getDynamicSizes();
+}
+
+/// Checks that op overwrites the entire output buffer without reading it.
+static bool isElementwiseInit(mlir::linalg::GenericOp op) {
+  if (!op.hasBufferSemantics() || op.getNumDpsInits() != 1 ||
+      op.getNumReductionLoops() != 0)
+    return false;
+
+  auto init = op.getDpsInitOperand(0);
+  if (op.payloadUsesValueFromOperand(init))
+    return false;
+
+  return op.getMatchingIndexingMap(init).isPermutation();
+}
+
+static bool isCopyBody(mlir::linalg::GenericOp op) {
+  auto body = op.getBody();
+  if (!llvm::hasSingleElement(*body) || op.getNumDpsInputs() != 1)
+    return false;
+
+  auto yield = mlir::cast<mlir::linalg::YieldOp>(body->getTerminator());
+  return yield.getValues().front() == body->getArgument(0);
+}
+
+/// Returns dead input buffer, accessed with the same map as output.
+static mlir::memref::AllocOp getReusableInput(mlir::linalg::GenericOp op,
+                                              mlir::memref::AllocOp init) {
+  auto block = op->getBlock();
+  auto initMap = op.getMatchingIndexingMap(op.getDpsInitOperand(0));
+  for (auto input : op.getDpsInputOperands()) {
+    auto alloc = getLocalAlloc(input->get(), block);
+    if (!alloc || alloc == init || !isSameBuffer(alloc, init))
+      continue;
+
+    // All accesses to the buffer must be at the same position as output
+    // write to not override still needed elements.
+    bool sameMaps = llvm::all_of(op.getDpsInputOperands(), [&](auto operand) {
+      return operand->get() != input->get() ||
+             op.getMatchingIndexingMap(operand) == initMap;
+    });
+    if (!sameMaps)
+      continue;
+
+    if (!isDeadAfter(alloc, op, /*inclusive*/ true))
+      continue;
+
+    return alloc;
+  }
+  return nullptr;
+}
+
+namespace {
+struct ReuseBuffersPass
+    : public mlir::PassWrapper<ReuseBuffersPass,
+                               mlir::InterfacePass<mlir::FunctionOpInterface>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(ReuseBuffersPass)
+
+  void runOnOperation() override {
+    llvm::SmallVector<mlir::linalg::GenericOp> ops;
+    getOperation()->walk([&](mlir::linalg::GenericOp op) {
+      if (isElementwiseInit(op))
+        ops.emplace_back(op);
+    });
+
+    bool changed = false;
+    llvm::SmallVector<mlir::memref::AllocOp> deadCandidates;
+    llvm::SmallVector<mlir::Operation *> toErase;
+    for (auto op : ops) {
+      auto block = op->getBlock();
+      auto init = getLocalAlloc(op.getDpsInitOperand(0)->get(), block);
+      if (!init || !isUnusedBefore(init, op))
+        continue;
+
+      bool isInput = false;
+      auto reuse = getReusableInput(op, init);
+      if (reuse) {
+        isInput = true;
+      } else {
+        // Try any earlier temporary, which is not used anymore.
+        deadCandidates.clear();
+        for (auto &other : *block) {
+          if (&other == op)
+            break;
+
+          auto alloc = mlir::dyn_cast<mlir::memref::AllocOp>(other);
+          if (alloc && alloc != init && isSameBuffer(alloc, init))
+            deadCandidates.emplace_back(alloc);
+        }
+        for (auto alloc : llvm::reverse(deadCandidates)) {
+          if (!alloc.getSymbolOperands().empty() ||
+              !isDeadAfter(alloc, op, /*inclusive*/ false))
+            continue;
+
+          reuse = alloc;
+          break;
+        }
+      }
+
+      if (!reuse)
+        continue;
+
+      init->replaceAllUsesWith(reuse);
+      init->erase();
+      changed = true;
+
+      // Copy into itself.
+      if (isInput && isCopyBody(op) &&
+          op.getMatchingIndexingMap(op.getDpsInputOperand(0)) ==
+              op.getMatchingIndexingMap(op.getDpsInitOperand(0)))
+        toErase.emplace_back(op);
+    }
+
+    for (auto op : toErase)
+      op->erase();
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> numba::createReuseBuffersPass() {
+  return std::make_unique<ReuseBuffersPass>();
+}
@@ -5,14 +5,21 @@
 #include "numba/Transforms/SCFVectorize.hpp"
 
 #include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/Complex/IR/Complex.h>
 #include <mlir/Dialect/MemRef/IR/MemRef.h>
 #include <mlir/Dialect/SCF/IR/SCF.h>
 #include <mlir/Dialect/UB/IR/UBOps.h>
 #include <mlir/Dialect/Vector/IR/VectorOps.h>
 #include <mlir/IR/IRMapping.h>
 #include <mlir/Interfaces/FunctionInterfaces.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
 #include <mlir/Pass/Pass.h>
 
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/bit.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/MathExtras.h>
+
 #include "numba/Dialect/numba_util/Dialect.hpp"
 
 /// Return type bitwidth for vectorization purposes or 0 if type cannot be
@@ -46,40 +53,87 @@ static bool isSupportedVecElem(mlir::Type type) {
   return type.isIntOrIndexOrFloat();
 }
 
-/// Check if one `ValueRange` is permutation of another, i.e. contains same
-/// values, potentially in different order.
-static bool isRangePermutation(mlir::ValueRange val1, mlir::ValueRange val2) {
-  if (val1.size() != val2.size())
-    return false;
+/// Returns parts type if `type` is complex with float parts, null otherwise.
+static mlir::FloatType getComplexElemType(mlir::Type type) {
+  auto complexType = mlir::dyn_cast<mlir::ComplexType>(type);
+  if (!complexType)
+    return nullptr;
 
-  for (auto v1 : val1) {
-    auto it = llvm::find(val2, v1);
-    if (it == val2.end())
-      return false;
+  return mlir::dyn_cast<mlir::FloatType>(complexType.getElementType());
+}
+
+static bool isComplexVecElem(mlir::Type type) {
+  return !!getComplexElemType(type);
+}
+
+/// Return memref element bitwidth for contiguous access or 0. Complex elements
+/// are accessed as interleaved parts, part bitwidth is returned for them.
+static unsigned getMemElemBitWidth(mlir::Type type, bool complexTypes) {
+  if (complexTypes)
+    if (auto elemType = getComplexElemType(type))
+      return elemType.getWidth();
+
+  return getTypeBitWidth(type);
+}
+
+using UniformValues = llvm::SmallDenseSet<mlir::Value>;
+
+/// Collect loop body values, which are the same for all vector lanes when
+/// vectorizing on `dim`: loop indices of other dimensions and results of side
+/// effects free ops, which only depend on such values.
+static UniformValues getUniformValues(mlir::scf::ParallelOp loop,
+                                      unsigned dim) {
+  UniformValues ret;
+  auto body = loop.getBody();
+  auto isUniform = [&](mlir::Value val) {
+    return val.getParentBlock() != body || ret.contains(val);
+  };
+
+  for (auto &&[i, iv] : llvm::enumerate(loop.getInductionVars()))
+    if (i != dim)
+      ret.insert(iv);
+
+  for (mlir::Operation &op : body->without_terminator()) {
+    if (op.getNumRegions() > 0 || !mlir::isPure(&op))
+      continue;
+
+    if (llvm::all_of(op.getOperands(), isUniform))
+      ret.insert(op.getResults().begin(), op.getResults().end());
   }
-  return true;
+  return ret;
+}
+
+static bool isUniformValue(mlir::scf::ParallelOp loop,
+                           const UniformValues &uniform, mlir::Value val) {
+  return !loop.getRegion().isAncestor(val.getParentRegion()) ||
+         uniform.contains(val);
 }
 
 template <typename Op>
 static std::optional<unsigned>
 cavTriviallyVectorizeMemOpImpl(mlir::scf::ParallelOp loop, unsigned dim,
-                               Op memOp) {
+                               const UniformValues &uniform, Op memOp,
+                               bool complexTypes = false) {
   auto loopIndexVars = loop.getInductionVars();
   assert(dim < loopIndexVars.size());
   auto memref = memOp.getMemRef();
   auto type = mlir::cast<mlir::MemRefType>(memref.getType());
-  auto width = getTypeBitWidth(type.getElementType());
+  auto width = getMemElemBitWidth(type.getElementType(), complexTypes);
   if (width == 0)
     return std::nullopt;
 
   if (!type.getLayout().isIdentity())
     return std::nullopt;
 
-  if (!isRangePermutation(memOp.getIndices(), loopIndexVars))
+  auto indices = memOp.getIndices();
+  if (indices.empty() || indices.back() != loopIndexVars[dim])
     return std::nullopt;
 
-  if (memOp.getIndices().back() != loopIndexVars[dim])
-    return std::nullopt;
+  // Other indices must be the same for all vector lanes, e.g. `a[i + 1, j]`
+  // when vectorizing on `j`.
+  for (auto idx : indices.drop_back())
+    if (!isUniformValue(loop, uniform, idx))
+      return std::nullopt;
 
   mlir::DominanceInfo dom;
   if (!dom.properlyDominates(memref, loop))
@@ -94,17 +148,35 @@ cavTriviallyVectorizeMemOpImpl(mlir::scf::ParallelOp loop, unsigned dim,
 /// vectorized.
 static std::optional<unsigned>
 cavTriviallyVectorizeMemOp(mlir::scf::ParallelOp loop, unsigned dim,
-                           mlir::Operation &op) {
+                           const UniformValues &uniform, mlir::Operation &op,
+                           bool complexTypes) {
   assert(dim < loop.getInductionVars().size());
   if (auto storeOp = mlir::dyn_cast<mlir::memref::StoreOp>(op))
-    return cavTriviallyVectorizeMemOpImpl(loop, dim, storeOp);
+    return cavTriviallyVectorizeMemOpImpl(loop, dim, uniform, storeOp,
+                                          complexTypes);
 
   if (auto loadOp = mlir::dyn_cast<mlir::memref::LoadOp>(op))
-    return cavTriviallyVectorizeMemOpImpl(loop, dim, loadOp);
+    return cavTriviallyVectorizeMemOpImpl(loop, dim, uniform, loadOp,
+                                          complexTypes);
 
   return std::nullopt;
 }
 
+static bool isComplexMemOp(mlir::Operation &op) {
+  mlir::Value memref;
+  if (auto storeOp = mlir::dyn_cast<mlir::memref::StoreOp>(op))
+    memref = storeOp.getMemRef();
+
+  if (auto loadOp = mlir::dyn_cast<mlir::memref::LoadOp>(op))
+    memref = loadOp.getMemRef();
+
+  if (!memref)
+    return false;
+
+  auto type = mlir::cast<mlir::MemRefType>(memref.getType());
+  return isComplexVecElem(type.getElementType());
+}
+
 template <typename T> static bool isOp(mlir::Operation &op) {
   return mlir::isa<T>(op);
 }
@@ -126,6 +198,14 @@ getReductionKind(mlir::Block &body) {
       {&isOp<mlir::arith::AddFOp>, CC::ADD},
       {&isOp<mlir::arith::MulIOp>, CC::MUL},
       {&isOp<mlir::arith::MulFOp>, CC::MUL},
+      {&isOp<mlir::arith::MinSIOp>, CC::MINSI},
+      {&isOp<mlir::arith::MinUIOp>, CC::MINUI},
+      {&isOp<mlir::arith::MaxSIOp>, CC::MAXSI},
+      {&isOp<mlir::arith::MaxUIOp>, CC::MAXUI},
+      {&isOp<mlir::arith::MinimumFOp>, CC::MINIMUMF},
+      {&isOp<mlir::arith::MaximumFOp>, CC::MAXIMUMF},
+      {&isOp<mlir::arith::AndIOp>, CC::AND},
+      {&isOp<mlir::arith::OrIOp>, CC::OR},
       // clang-format on
   };
 
@@ -137,10 +217,267 @@ getReductionKind(mlir::Block &body) {
   return std::nullopt;
 }
 
+/// Get fastmath flags if ops support them or default (none).
+static mlir::arith::FastMathFlags getFMF(mlir::Operation &op) {
+  if (auto fmf = mlir::dyn_cast<mlir::arith::ArithFastMathInterface>(op))
+    return fmf.getFastMathFlagsAttr().getValue();
+
+  return mlir::arith::FastMathFlags::none;
+}
+
+/// Complex multiplication parts are computed with `vector.fma` if contraction
+/// is allowed.
+static bool canUseComplexFma(mlir::Operation &op) {
+  return mlir::arith::bitEnumContainsAll(getFMF(op),
+                                         mlir::arith::FastMathFlags::contract);
+}
+
+/// Simplified complex division `a * conj(b) / |b|^2` can overflow for large
+/// `b` parts, so it is only used if infinities are ignored and reciprocal is
+/// allowed. Otherwise division is replicated and uses full-range scalar
+/// lowering.
+static bool canUseFastComplexDiv(mlir::Operation &op) {
+  using FMF = mlir::arith::FastMathFlags;
+  return mlir::arith::bitEnumContainsAll(getFMF(op), FMF::ninf | FMF::arcp);
+}
+
+/// Returns number of real vector ops, complex op is expanded into, or
+/// `std::nullopt` if op cannot be vectorized as real and imaginary parts
+/// vectors.
+static std::optional<unsigned> getComplexOpCost(mlir::Operation &op) {
+  if (!mlir::isa_and_nonnull<mlir::complex::ComplexDialect>(op.getDialect()))
+    return std::nullopt;
+
+  auto isValidType = [](mlir::Type type) {
+    return isComplexVecElem(type) || mlir::isa<mlir::FloatType>(type);
+  };
+  if (!llvm::all_of(op.getOperandTypes(), isValidType) ||
+      !llvm::all_of(op.getResultTypes(), isValidType))
+    return std::nullopt;
+
+  if (mlir::isa<mlir::complex::CreateOp, mlir::complex::ReOp,
+                mlir::complex::ImOp>(op))
+    return 0;
+
+  if (mlir::isa<mlir::complex::ConjOp>(op))
+    return 1;
+
+  if (mlir::isa<mlir::complex::AddOp, mlir::complex::SubOp,
+                mlir::complex::NegOp>(op))
+    return 2;
+
+  if (mlir::isa<mlir::complex::MulOp>(op))
+    return canUseComplexFma(op) ? 5 : 6;
+
+  if (mlir::isa<mlir::complex::DivOp>(op) && canUseFastComplexDiv(op))
+    return canUseComplexFma(op) ? 10 : 12;
+
+  return std::nullopt;
+}
+
+/// Returns max bitwidth of complex parts and floats, used by complex op.
+static unsigned getComplexArgsTypeWidth(mlir::Operation &op) {
+  auto getWidth = [](mlir::Type type) -> unsigned {
+    if (auto elemType = getComplexElemType(type))
+      return elemType.getWidth();
+
+    return getTypeBitWidth(type);
+  };
+
+  unsigned ret = 0;
+  for (auto type : op.getOperandTypes())
+    ret = std::max(ret, getWidth(type));
+
+  for (auto type : op.getResultTypes())
+    ret = std::max(ret, getWidth(type));
+
+  return ret;
+}
+
+/// Check if reduction can keep vector accumulator across all loop iterations,
+/// combined with single `vector.reduction` after the loop. It changes order of
+/// operations, so float addition and multiplication require `reassoc`
+/// fastmath flag.
+static bool canUseVectorAccumulator(mlir::Block &body) {
+  auto kind = getReductionKind(body);
+  if (!kind)
+    return false;
+
+  mlir::Operation &redOp = body.front();
+  if (!mlir::isa<mlir::arith::AddFOp, mlir::arith::MulFOp>(redOp))
+    return true;
+
+  return mlir::arith::bitEnumContainsAll(getFMF(redOp),
+                                         mlir::arith::FastMathFlags::reassoc);
+}
+
+numba::SCFVectorizeCostModel
+numba::SCFVectorizeCostModel::get(unsigned vectorBitwidth) {
+  SCFVectorizeCostModel ret;
+  ret.vectorBitwidth = vectorBitwidth;
+  if (vectorBitwidth >= 512) {
+    // AVX-512: native masking, 32 registers, gather and scatter.
+    ret.numVectorRegs = 32;
+    ret.maxInterleave = 4;
+    ret.gatherCost = 2;
+    ret.scatterCost = 2;
+  } else if (vectorBitwidth >= 256) {
+    // AVX2: masked load/store, gather is microcoded, no scatter.
+    ret.maxInterleave = 2;
+    ret.maskedMemOpCost = 2;
+    ret.gatherCost = 3;
+    ret.scatterCost = 4;
+  } else {
+    // SSE/NEON: masked ops, gathers and scatters are emulated.
+    ret.maxInterleave = vectorBitwidth >= 128 ? 2 : 1;
+    ret.maskedMemOpCost = 4;
+    ret.gatherCost = 4;
+    ret.scatterCost = 4;
+  }
+  return ret;
+}
+
+double numba::SCFVectorizeInfo::getSpeedup() const {
+  if (vectorCost == 0)
+    return 0;
+
+  return double(scalarCost) * factor / vectorCost;
+}
+
+/// Check if memref access can be converted into gather/scatter.
+template <typename Op>
+static std::optional<unsigned> canGatherScatterImpl(mlir::scf::ParallelOp loop,
+                                                    Op memOp) {
+  auto memref = memOp.getMemRef();
+  auto type = mlir::cast<mlir::MemRefType>(memref.getType());
+  if (!isSupportedVecElem(type.getElementType()))
+    return std::nullopt;
+
+  // Multidimensional accesses are linearized, which requires identity layout.
+  mlir::DominanceInfo dom;
+  if (!dom.properlyDominates(memref, loop) || memOp.getIndices().empty() ||
+      !type.getLayout().isIdentity())
+    return std::nullopt;
+
+  auto width = getTypeBitWidth(type.getElementType());
+  if (width == 0)
+    return std::nullopt;
+
+  return width;
+}
+
+/// Returns memref element bitwidth if access can be converted to
+/// gather/scatter, `std::nullopt` otherwise.
+static std::optional<unsigned> canGatherScatter(mlir::scf::ParallelOp loop,
+                                                mlir::Operation &op) {
+  if (auto storeOp = mlir::dyn_cast<mlir::memref::StoreOp>(op))
+    return canGatherScatterImpl(loop, storeOp);
+
+  if (auto loadOp = mlir::dyn_cast<mlir::memref::LoadOp>(op))
+    return canGatherScatterImpl(loop, loadOp);
+
+  return std::nullopt;
+}
+
+static bool hasWriteEffect(mlir::Operation &op) {
+  if (auto effects = mlir::dyn_cast<mlir::MemoryEffectOpInterface>(op))
+    return effects.hasEffect<mlir::MemoryEffects::Write>();
+
+  return !mlir::isMemoryEffectFree(&op);
+}
+
+/// Read-modify-write of memref element through gather and scatter, e.g.
+/// `hist[bin[i]] += w[i]`.
+struct ScatterUpdate {
+  /// Load of the updated element.
+  mlir::memref::LoadOp load;
+
+  /// Ops computing stored value from the loaded one, in block order.
+  llvm::SmallVector<mlir::Operation *> ops;
+
+  bool contains(mlir::Value val) const {
+    return val == load.getResult() ||
+           llvm::is_contained(ops, val.getDefiningOp());
+  }
+};
+
+/// Returns update info if `store` writes element, which was loaded earlier in
+/// the same iteration. Vector lanes with the same index conflict and must be
+/// processed one after another to see updates of the previous lanes.
+static std::optional<ScatterUpdate>
+getScatterUpdate(mlir::memref::StoreOp store) {
+  auto block = store->getBlock();
+  mlir::memref::LoadOp load;
+  for (auto it = store->getIterator(); it != block->begin();) {
+    auto candidate = mlir::dyn_cast<mlir::memref::LoadOp>(*(--it));
+    if (candidate && candidate.getMemRef() == store.getMemRef() &&
+        candidate.getIndices() == store.getIndices()) {
+      load = candidate;
+      break;
+    }
+  }
+  if (!load)
+    return std::nullopt;
+
+  ScatterUpdate ret{load, {}};
+  for (auto &op : llvm::make_range(std::next(load->getIterator()),
+                                   store->getIterator())) {
+    if (llvm::none_of(op.getOperands(),
+                      [&](mlir::Value arg) { return ret.contains(arg); })) {
+      // Unrelated ops are vectorized before the update, they must not write
+      // to memory.
+      if (hasWriteEffect(op))
+        return std::nullopt;
+
+      continue;
+    }
+
+    if (op.getNumRegions() > 0 || !isSupportedVectorOp(op) ||
+        !mlir::isPure(&op) ||
+        !llvm::all_of(op.getResultTypes(), isSupportedVecElem))
+      return std::nullopt;
+
+    ret.ops.emplace_back(&op);
+  }
+
+  if (!ret.contains(store.getValueToStore()))
+    return std::nullopt;
+
+  // Intermediate values must not be used outside of the update.
+  auto isUpdateUser = [&](mlir::Operation *user) {
+    return user == store || llvm::is_contained(ret.ops, user);
+  };
+  if (!llvm::all_of(load->getUsers(), isUpdateUser))
+    return std::nullopt;
+
+  for (auto op : ret.ops)
+    if (!llvm::all_of(op->getUsers(), isUpdateUser))
+      return std::nullopt;
+
+  return ret;
+}
+
+/// Ops without vector instructions, which are scalarized by the backend.
+static bool isScalarizedVectorOp(mlir::Operation &op) {
+  return mlir::isa<mlir::arith::DivSIOp, mlir::arith::DivUIOp,
+                   mlir::arith::RemSIOp, mlir::arith::RemUIOp,
+                   mlir::arith::CeilDivSIOp, mlir::arith::CeilDivUIOp,
+                   mlir::arith::FloorDivSIOp>(op);
+}
+
 std::optional<numba::SCFVectorizeInfo>
 numba::getLoopVectorizeInfo(mlir::scf::ParallelOp loop, unsigned dim,
                             unsigned vectorBitwidth) {
+  assert(vectorBitwidth > 0);
+  return getLoopVectorizeInfo(loop, dim,
+                              SCFVectorizeCostModel::get(vectorBitwidth));
+}
+
+std::optional<numba::SCFVectorizeInfo>
+numba::getLoopVectorizeInfo(mlir::scf::ParallelOp loop, unsigned dim,
+                            const SCFVectorizeCostModel &costModel) {
   assert(dim < loop.getStep().size());
+  auto vectorBitwidth = costModel.vectorBitwidth;
   assert(vectorBitwidth > 0);
   unsigned factor = vectorBitwidth / 8;
   if (factor <= 1)
@@ -153,66 +490,253 @@ numba::getLoopVectorizeInfo(mlir::scf::ParallelOp loop, unsigned dim,
   unsigned count = 0;
   bool masked = true;
 
+  unsigned scalarCost = 0;
+  unsigned contiguous = 0;
+  unsigned gathers = 0;
+  unsigned scatters = 0;
+  unsigned scatterUpdates = 0;
+  unsigned scalarized = 0;
+  unsigned vectorOps = 0;
+  unsigned uniformOps = 0;
+
+  // If-converted `scf.if` ops, each needs condition mask, and memory
+  // accesses inside them, which are masked by it.
+  unsigned predicates = 0;
+  unsigned predicatedMemOps = 0;
+
+  // Replicated ops and their number of operands and results, to be
+  // extracted/inserted.
+  unsigned replicated = 0;
+  unsigned replicatedArgs = 0;
+
   /// Check if `scf.reduce` can be handled by `vector.reduce`.
   /// If not we still can vectorize the loop but we cannot use masked
   /// vectorize.
+  unsigned reductions = 0;
+  unsigned vectorReductions = 0;
+  unsigned accumulators = 0;
   auto reduce =
       mlir::cast<mlir::scf::ReduceOp>(loop.getBody()->getTerminator());
   for (mlir::Region &reg : reduce.getReductions()) {
-    if (!getReductionKind(reg.front()))
-      masked = false;
+    ++reductions;
+    ++scalarCost;
+    if (canUseVectorAccumulator(reg.front())) {
+      ++accumulators;
+      continue;
+    }
+    if (getReductionKind(reg.front())) {
+      ++vectorReductions;
+      continue;
+    }
 
-    continue;
+    masked = false;
   }
 
-  for (mlir::Operation &op : loop.getBody()->without_terminator()) {
-    /// Ops with nested regions are not supported yet.
+  auto uniform = getUniformValues(loop, dim);
+
+  /// Check single op, ops inside `scf.if` branches are `predicated`, they are
+  /// if-converted and executed for all lanes under the condition mask.
+  /// Returns false if op cannot be vectorized.
+  auto visitOp = [&](mlir::Operation &op, bool predicated,
+                     auto &&visitOp) -> bool {
+    if (auto ifOp = mlir::dyn_cast<mlir::scf::IfOp>(op)) {
+      if (!llvm::all_of(ifOp.getResultTypes(), isSupportedVecElem))
+        return false;
+
+      auto visitBranch = [&](mlir::Block *block) -> std::optional<unsigned> {
+        auto prevCost = scalarCost;
+        for (mlir::Operation &nested : block->without_terminator())
+          if (!visitOp(nested, /*predicated*/ true, visitOp))
+            return std::nullopt;
+
+        return scalarCost - prevCost;
+      };
+
+      auto prevCost = scalarCost;
+      auto thenCost = visitBranch(ifOp.thenBlock());
+      if (!thenCost)
+        return false;
+
+      std::optional<unsigned> elseCost = 0;
+      if (ifOp.elseBlock()) {
+        elseCost = visitBranch(ifOp.elseBlock());
+        if (!elseCost)
+          return false;
+      }
+
+      // Scalar loop only executes one of the branches, while vector loop
+      // executes both and blends results with `arith.select`.
+      scalarCost = prevCost + 1 + std::max(*thenCost, *elseCost);
+      ++predicates;
+      vectorOps += ifOp.getNumResults();
+      count += ifOp.getNumResults();
+      return true;
+    }
+
+    /// Ops with other nested regions are not supported yet.
     if (op.getNumRegions() > 0)
-      return std::nullopt;
+      return false;
+
+    ++scalarCost;
 
     /// Check mem ops.
-    if (auto w = cavTriviallyVectorizeMemOp(loop, dim, op)) {
+    if (auto w = cavTriviallyVectorizeMemOp(loop, dim, uniform, op,
+                                            costModel.complexTypes)) {
       auto newFactor = vectorBitwidth / *w;
       if (newFactor > 1) {
         factor = std::min(factor, newFactor);
         ++count;
       }
-      continue;
+
+      if (predicated) {
+        // Complex accesses use the interleaved parts mask, which cannot be
+        // combined with condition mask.
+        if (isComplexMemOp(op))
+          return false;
+
+        ++predicatedMemOps;
+        return true;
+      }
+
+      ++contiguous;
+
+      // Complex values are accessed as 2 vectors of interleaved parts, which
+      // are deinterleaved/interleaved by shuffles.
+      if (isComplexMemOp(op)) {
+        ++scalarCost;
+        ++contiguous;
+        vectorOps += 2;
+      }
+      return true;
+    }
+
+    /// Non-contiguous accesses are lowered to gather/scatter.
+    if (auto w = canGatherScatter(loop, op)) {
+      auto newFactor = vectorBitwidth / *w;
+      if (newFactor > 1)
+        factor = std::min(factor, newFactor);
+
+      ++gathers;
+      if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(op)) {
+        ++scatters;
+        if (getScatterUpdate(store))
+          ++scatterUpdates;
+      }
+      return true;
+    }
+
+    /// Other ops are executed for inactive lanes too, so they must not trap.
+    if (predicated && !mlir::isSpeculatable(&op))
+      return false;
+
+    /// Non-vectorizable ops, uniform across vector lanes, are kept scalar.
+    if (!isSupportedVectorOp(op) && op.getNumResults() > 0 &&
+        uniform.contains(op.getResult(0))) {
+      ++uniformOps;
+      return true;
+    }
+
+    /// Complex ops are expanded into real arithmetic on parts vectors.
+    if (costModel.complexTypes) {
+      if (auto cost = getComplexOpCost(op)) {
+        scalarCost += std::max(*cost, 1u) - 1;
+        vectorOps += *cost;
+        auto newFactor = vectorBitwidth / getComplexArgsTypeWidth(op);
+        if (newFactor > 1) {
+          factor = std::min(factor, newFactor);
+          ++count;
+        }
+        return true;
+      }
     }
 
     /// If met the op which cannot be vectorized, we can replicate it and still
     /// potentially vectorize other ops, but we cannot use masked vectorize.
     if (!isSupportedVectorOp(op)) {
+      if (predicated)
+        return false;
+
       masked = false;
-      continue;
+      ++replicated;
+      replicatedArgs += op.getNumOperands() + op.getNumResults();
+      return true;
     }
 
     auto width = getArgsTypeWidth(op);
     if (width == 0)
-      return std::nullopt;
+      return false;
+
+    if (isScalarizedVectorOp(op)) {
+      ++scalarized;
+    } else {
+      ++vectorOps;
+    }
 
     auto newFactor = vectorBitwidth / width;
     if (newFactor <= 1)
-      continue;
+      return true;
 
     factor = std::min(factor, newFactor);
 
     ++count;
-  }
+    return true;
+  };
+
+  for (mlir::Operation &op : loop.getBody()->without_terminator())
+    if (!visitOp(op, /*predicated*/ false, visitOp))
+      return std::nullopt;
 
   /// No ops to vectorize.
   if (count == 0)
     return std::nullopt;
 
-  return SCFVectorizeInfo{dim, factor, count, masked};
-}
-
-/// Get fastmath flags if ops support them or default (none).
-static mlir::arith::FastMathFlags getFMF(mlir::Operation &op) {
-  if (auto fmf = mlir::dyn_cast<mlir::arith::ArithFastMathInterface>(op))
-    return fmf.getFastMathFlagsAttr().getValue();
+  unsigned vectorCost = 0;
+  vectorCost += contiguous *
+                (masked ? costModel.maskedMemOpCost : costModel.memOpCost);
+  vectorCost += predicatedMemOps * costModel.maskedMemOpCost;
+  vectorCost += predicates * costModel.vectorOpCost;
+  vectorCost += (gathers - scatters) * factor * costModel.gatherCost;
+  vectorCost += scatters * factor * costModel.scatterCost;
+
+  // Conflicting lanes detection, each lane index is compared with all previous
+  // lanes.
+  vectorCost += scatterUpdates *
+                (3 * (factor - 1) * costModel.vectorOpCost +
+                 llvm::Log2_32_Ceil(factor) * costModel.reductionStepCost);
+  vectorCost += vectorOps * costModel.vectorOpCost;
+  vectorCost += uniformOps;
+  vectorCost += scalarized * factor * (1 + 2 * costModel.insertExtractCost);
+  vectorCost += replicated * factor;
+  vectorCost += replicatedArgs * factor * costModel.insertExtractCost;
+  vectorCost += vectorReductions *
+                (1 + llvm::Log2_32_Ceil(factor) * costModel.reductionStepCost);
+  vectorCost += accumulators;
+  vectorCost += (reductions - vectorReductions - accumulators) * factor *
+                (1 + costModel.insertExtractCost);
+
+  // Interleave vector iterations for small loops without replicated ops, as
+  // long as live values fit into the vector registers.
+  unsigned interleave = 1;
+  if (replicated == 0 && scalarized == 0 && gathers == 0) {
+    auto live = std::max(count + reductions, 1u);
+    interleave = std::clamp(costModel.numVectorRegs / live, 1u,
+                            std::max(costModel.maxInterleave, 1u));
+    interleave = llvm::bit_floor(interleave);
+  }
 
-  return mlir::arith::FastMathFlags::none;
+  SCFVectorizeInfo ret;
+  ret.dim = dim;
+  ret.factor = factor;
+  ret.count = count;
+  ret.masked = masked;
+  ret.gathers = gathers;
+  ret.replicated = replicated + scalarized;
+  ret.reductions = reductions;
+  ret.predicates = predicates;
+  ret.scalarCost = scalarCost;
+  ret.vectorCost = vectorCost;
+  ret.interleave = interleave;
+  return ret;
 }
 
 mlir::LogicalResult
@@ -260,19 +784,51 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
   lower[dim] = zero;
   upper[dim] = newCount;
 
-  // Vectorized loop.
-  auto newLoop = builder.create<mlir::scf::ParallelOp>(loc, lower, upper, step,
-                                                       loop.getInitVals());
-  auto newIndexVar = newLoop.getInductionVars()[dim];
-
   auto toVectorType = [&](mlir::Type elemType) -> mlir::VectorType {
     int64_t f = factor;
     return mlir::VectorType::get(f, elemType);
   };
 
+  // Reductions, which keep vector accumulator across the loop iterations,
+  // initialized with the neutral value, and are reduced to scalar only once
+  // after the loop.
+  auto reduceOp =
+      mlir::cast<mlir::scf::ReduceOp>(loop.getBody()->getTerminator());
+  auto newInitVals = llvm::to_vector(loop.getInitVals());
+  llvm::SmallVector<mlir::Value> accNeutral(newInitVals.size());
+  for (auto &&[i, body] : llvm::enumerate(reduceOp.getReductions())) {
+    auto type = newInitVals[i].getType();
+    mlir::Block &reduceBody = body.front();
+    if (!isSupportedVecElem(type) || !canUseVectorAccumulator(reduceBody))
+      continue;
+
+    auto neutral = mlir::arith::getNeutralElement(&reduceBody.front());
+    assert(neutral);
+    mlir::Value neutralVal =
+        builder.create<mlir::arith::ConstantOp>(loc, *neutral);
+    mlir::Value neutralVec = builder.create<mlir::vector::SplatOp>(
+        loc, neutralVal, toVectorType(type));
+    accNeutral[i] = neutralVec;
+    newInitVals[i] = neutralVec;
+  }
+
+  // Vectorized loop.
+  auto newLoop = builder.create<mlir::scf::ParallelOp>(loc, lower, upper, step,
+                                                       newInitVals);
+  auto newIndexVar = newLoop.getInductionVars()[dim];
+
+  // Both vectorized and remainder loops are not vectorized again by LLVM.
+  auto vectorizedAttrName = numba::util::attributes::getVectorizedName();
+  auto unitAttr = builder.getUnitAttr();
+  newLoop->setAttr(vectorizedAttrName, unitAttr);
+
   mlir::IRMapping mapping;
   mlir::IRMapping scalarMapping;
 
+  // Vectorized complex values, as pairs of real and imaginary parts vectors.
+  using ComplexVec = std::pair<mlir::Value, mlir::Value>;
+  llvm::DenseMap<mlir::Value, ComplexVec> complexMapping;
+
   auto createPosionVec = [&](mlir::VectorType vecType) -> mlir::Value {
     return builder.create<mlir::ub::PoisonOp>(loc, vecType, nullptr);
   };
@@ -339,6 +895,24 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
 
     auto &ret = unpackedVals[val];
     assert(ret.empty());
+
+    // Vectorized complex value, extract parts and combine them.
+    auto complexIt = complexMapping.find(val);
+    if (complexIt != complexMapping.end()) {
+      auto [re, im] = complexIt->second;
+      ret.resize(factor);
+      for (auto i : llvm::seq(0u, factor)) {
+        mlir::Value idx = builder.create<mlir::arith::ConstantIndexOp>(loc, i);
+        mlir::Value reElem =
+            builder.create<mlir::vector::ExtractElementOp>(loc, re, idx);
+        mlir::Value imElem =
+            builder.create<mlir::vector::ExtractElementOp>(loc, im, idx);
+        ret[i] = builder.create<mlir::complex::CreateOp>(loc, val.getType(),
+                                                         reElem, imElem);
+      }
+      return ret;
+    }
+
     if (!isSupportedVecElem(val.getType())) {
       // Non vectorizable value, it must be a value defined outside the loop,
       // just replicate it.
@@ -363,6 +937,27 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
     unpackedVals[origVal].append(newVals.begin(), newVals.end());
 
     auto type = origVal.getType();
+
+    // Complex values are split into parts vectors.
+    auto complexElemType = getComplexElemType(type);
+    if (params.complexTypes && complexElemType) {
+      auto vecType = toVectorType(complexElemType);
+      mlir::Value re = createPosionVec(vecType);
+      mlir::Value im = createPosionVec(vecType);
+      for (auto i : llvm::seq(0u, factor)) {
+        mlir::Value idx = builder.create<mlir::arith::ConstantIndexOp>(loc, i);
+        mlir::Value val = newVals[i];
+        mlir::Value reElem = builder.create<mlir::complex::ReOp>(loc, val);
+        mlir::Value imElem = builder.create<mlir::complex::ImOp>(loc, val);
+        re =
+            builder.create<mlir::vector::InsertElementOp>(loc, reElem, re, idx);
+        im =
+            builder.create<mlir::vector::InsertElementOp>(loc, imElem, im, idx);
+      }
+      complexMapping[origVal] = {re, im};
+      return;
+    }
+
     if (!isSupportedVecElem(type))
       return;
 
@@ -402,17 +997,56 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
     return mask;
   };
 
-  mlir::DominanceInfo dom;
+  // Condition mask of the if-converted `scf.if` branch, which is currently
+  // being vectorized, null outside of branches.
+  mlir::Value predicate;
+
+  // Get mask for memory accesses, combining out of bounds mask with the
+  // branch condition.
+  auto getMemMask = [&]() -> mlir::Value {
+    if (!predicate)
+      return getMask();
+
+    if (!masked)
+      return predicate;
+
+    return builder.create<mlir::arith::AndIOp>(loc, getMask(), predicate);
+  };
+
+  mlir::Value complexMask;
+
+  // Contruct mask for interleaved complex parts and cache it, each element
+  // mask is duplicated. Only used in masked mode.
+  auto getComplexMask = [&]() -> mlir::Value {
+    if (complexMask)
+      return complexMask;
+
+    assert(masked);
+    mlir::Value size =
+        builder.create<mlir::arith::MulIOp>(loc, factorVal, newIndexVar);
+    size = builder.create<mlir::arith::SubIOp>(loc, count, size);
+    mlir::Value two = builder.create<mlir::arith::ConstantIndexOp>(loc, 2);
+    size = builder.create<mlir::arith::MulIOp>(loc, size, two);
+    auto vecType =
+        mlir::VectorType::get(int64_t(factor) * 2, builder.getI1Type());
+    complexMask = builder.create<mlir::vector::CreateMaskOp>(
+        loc, vecType, mlir::OpFoldResult(size));
+
+    return complexMask;
+  };
+
+  // Values, which are the same for all vector lanes, are additionally kept
+  // scalar to be used as memref indices.
+  auto uniform = getUniformValues(loop, dim);
+  mlir::IRMapping uniformMapping;
+  uniformMapping.map(loop.getInductionVars(), newLoop.getInductionVars());
 
   auto canTriviallyVectorizeMemOp = [&](auto op) -> bool {
-    return !!::cavTriviallyVectorizeMemOpImpl(loop, dim, op);
+    return !!::cavTriviallyVectorizeMemOpImpl(loop, dim, uniform, op);
   };
 
   // Get idices for vectorized memref load/store.
   auto getMemrefVecIndices = [&](mlir::ValueRange indices) {
-    scalarMapping.clear();
-    scalarMapping.map(loop.getInductionVars(), newLoop.getInductionVars());
-
     llvm::SmallVector<mlir::Value> ret(indices.size());
     for (auto &&[i, val] : llvm::enumerate(indices)) {
       if (val == origIndexVar) {
@@ -422,21 +1056,323 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
         ret[i] = idx;
         continue;
       }
-      ret[i] = scalarMapping.lookup(val);
+      ret[i] = uniformMapping.lookupOrDefault(val);
     }
 
     return ret;
   };
 
+  // Get real and imaginary parts vectors for provided complex `orig` value in
+  // source loop. Uniform values and values defined outside the loop are
+  // splatted.
+  auto getComplexVec = [&](mlir::Value orig) -> ComplexVec {
+    auto it = complexMapping.find(orig);
+    if (it != complexMapping.end())
+      return it->second;
+
+    auto vecType = toVectorType(getComplexElemType(orig.getType()));
+    mlir::Value val = uniformMapping.lookupOrDefault(orig);
+    mlir::Value re = builder.create<mlir::complex::ReOp>(loc, val);
+    mlir::Value im = builder.create<mlir::complex::ImOp>(loc, val);
+    re = builder.create<mlir::vector::SplatOp>(loc, re, vecType);
+    im = builder.create<mlir::vector::SplatOp>(loc, im, vecType);
+    ComplexVec ret(re, im);
+    complexMapping[orig] = ret;
+    return ret;
+  };
+
+  llvm::DenseMap<mlir::Value, mlir::Value> complexViews;
+
+  // Get view of complex memref as memref of interleaved parts, created before
+  // the vectorized loop.
+  auto getComplexView = [&](mlir::Value memref) -> mlir::Value {
+    auto it = complexViews.find(memref);
+    if (it != complexViews.end())
+      return it->second;
+
+    auto type = mlir::cast<mlir::MemRefType>(memref.getType());
+    auto shape = llvm::to_vector(type.getShape());
+    if (!mlir::ShapedType::isDynamic(shape.back()))
+      shape.back() *= 2;
+
+    auto viewType = mlir::MemRefType::get(
+        shape, getComplexElemType(type.getElementType()),
+        mlir::MemRefLayoutAttrInterface{}, type.getMemorySpace());
+
+    mlir::OpBuilder::InsertionGuard g(builder);
+    builder.setInsertionPoint(newLoop);
+    mlir::Value view = builder.create<numba::util::MemrefBitcastOp>(
+        newLoop.getLoc(), viewType, memref);
+    complexViews[memref] = view;
+    return view;
+  };
+
+  // Get indices for complex memref view, innermost index is doubled.
+  auto getComplexVecIndices = [&](mlir::ValueRange indices) {
+    auto ret = getMemrefVecIndices(indices);
+    mlir::Value two = builder.create<mlir::arith::ConstantIndexOp>(loc, 2);
+    ret.back() = builder.create<mlir::arith::MulIOp>(loc, ret.back(), two);
+    return ret;
+  };
+
+  auto getComplexViewVecType = [&](mlir::Value view) -> mlir::VectorType {
+    auto viewType = mlir::cast<mlir::MemRefType>(view.getType());
+    auto elemType = viewType.getElementType();
+    return mlir::VectorType::get(int64_t(factor) * 2, elemType);
+  };
+
+  // Create vectorized load of interleaved parts for complex memref load and
+  // deinterleave it into parts vectors.
+  auto genComplexLoad = [&](mlir::memref::LoadOp loadOp) {
+    auto view = getComplexView(loadOp.getMemRef());
+    auto indices = getComplexVecIndices(loadOp.getIndices());
+    auto vecType = getComplexViewVecType(view);
+    mlir::Value vec;
+    if (masked) {
+      auto init = createPosionVec(vecType);
+      vec = builder.create<mlir::vector::MaskedLoadOp>(
+          loc, vecType, view, indices, getComplexMask(), init);
+    } else {
+      vec = builder.create<mlir::vector::LoadOp>(loc, vecType, view, indices);
+    }
+
+    llvm::SmallVector<int64_t> reIndices(factor);
+    llvm::SmallVector<int64_t> imIndices(factor);
+    for (auto i : llvm::seq(0u, factor)) {
+      reIndices[i] = i * 2;
+      imIndices[i] = i * 2 + 1;
+    }
+    mlir::Value re =
+        builder.create<mlir::vector::ShuffleOp>(loc, vec, vec, reIndices);
+    mlir::Value im =
+        builder.create<mlir::vector::ShuffleOp>(loc, vec, vec, imIndices);
+    complexMapping[loadOp.getResult()] = {re, im};
+  };
+
+  // Interleave parts vectors and create vectorized store for complex memref
+  // store.
+  auto genComplexStore = [&](mlir::memref::StoreOp storeOp) {
+    auto [re, im] = getComplexVec(storeOp.getValueToStore());
+    auto view = getComplexView(storeOp.getMemRef());
+    auto indices = getComplexVecIndices(storeOp.getIndices());
+
+    llvm::SmallVector<int64_t> shuffleIndices(factor * 2);
+    for (auto i : llvm::seq(0u, factor)) {
+      shuffleIndices[i * 2] = i;
+      shuffleIndices[i * 2 + 1] = i + factor;
+    }
+    mlir::Value vec =
+        builder.create<mlir::vector::ShuffleOp>(loc, re, im, shuffleIndices);
+    if (masked) {
+      builder.create<mlir::vector::MaskedStoreOp>(loc, view, indices,
+                                                  getComplexMask(), vec);
+    } else {
+      builder.create<mlir::vector::StoreOp>(loc, vec, view, indices);
+    }
+  };
+
+  // Expand complex op into real arithmetic on parts vectors.
+  auto genComplexOp = [&](mlir::Operation &op) {
+    auto fmf = getFMF(op);
+    bool useFma = canUseComplexFma(op);
+    auto mul = [&](mlir::Value lhs, mlir::Value rhs) -> mlir::Value {
+      return builder.create<mlir::arith::MulFOp>(loc, lhs, rhs, fmf);
+    };
+    auto add = [&](mlir::Value lhs, mlir::Value rhs) -> mlir::Value {
+      return builder.create<mlir::arith::AddFOp>(loc, lhs, rhs, fmf);
+    };
+    auto sub = [&](mlir::Value lhs, mlir::Value rhs) -> mlir::Value {
+      return builder.create<mlir::arith::SubFOp>(loc, lhs, rhs, fmf);
+    };
+    auto neg = [&](mlir::Value val) -> mlir::Value {
+      return builder.create<mlir::arith::NegFOp>(loc, val, fmf);
+    };
+    // `lhs * rhs + acc`
+    auto fma = [&](mlir::Value lhs, mlir::Value rhs,
+                   mlir::Value acc) -> mlir::Value {
+      if (useFma)
+        return builder.create<mlir::vector::FMAOp>(loc, lhs, rhs, acc);
+
+      return add(mul(lhs, rhs), acc);
+    };
+
+    if (auto createOp = mlir::dyn_cast<mlir::complex::CreateOp>(op)) {
+      complexMapping[createOp.getResult()] = {
+          getVecVal(createOp.getReal()), getVecVal(createOp.getImaginary())};
+      return;
+    }
+    if (auto reOp = mlir::dyn_cast<mlir::complex::ReOp>(op)) {
+      mapping.map(reOp.getResult(), getComplexVec(reOp.getComplex()).first);
+      return;
+    }
+    if (auto imOp = mlir::dyn_cast<mlir::complex::ImOp>(op)) {
+      mapping.map(imOp.getResult(), getComplexVec(imOp.getComplex()).second);
+      return;
+    }
+    if (auto conjOp = mlir::dyn_cast<mlir::complex::ConjOp>(op)) {
+      auto [re, im] = getComplexVec(conjOp.getComplex());
+      complexMapping[conjOp.getResult()] = {re, neg(im)};
+      return;
+    }
+    if (auto negOp = mlir::dyn_cast<mlir::complex::NegOp>(op)) {
+      auto [re, im] = getComplexVec(negOp.getComplex());
+      complexMapping[negOp.getResult()] = {neg(re), neg(im)};
+      return;
+    }
+
+    assert(op.getNumOperands() == 2);
+    auto [lhsRe, lhsIm] = getComplexVec(op.getOperand(0));
+    auto [rhsRe, rhsIm] = getComplexVec(op.getOperand(1));
+    auto res = op.getResult(0);
+    if (mlir::isa<mlir::complex::AddOp>(op)) {
+      complexMapping[res] = {add(lhsRe, rhsRe), add(lhsIm, rhsIm)};
+      return;
+    }
+    if (mlir::isa<mlir::complex::SubOp>(op)) {
+      complexMapping[res] = {sub(lhsRe, rhsRe), sub(lhsIm, rhsIm)};
+      return;
+    }
+
+    // Textbook formula without C99 Annex G inf/nan recovery, same as NumPy.
+    if (mlir::isa<mlir::complex::MulOp>(op)) {
+      auto re = fma(lhsRe, rhsRe, neg(mul(lhsIm, rhsIm)));
+      auto im = fma(lhsRe, rhsIm, mul(lhsIm, rhsRe));
+      complexMapping[res] = {re, im};
+      return;
+    }
+
+    // Fastmath only, `a * conj(b) / |b|^2`.
+    assert(mlir::isa<mlir::complex::DivOp>(op));
+    auto elemType = getComplexElemType(res.getType());
+    mlir::Value one = builder.create<mlir::arith::ConstantOp>(
+        loc, builder.getFloatAttr(elemType, 1.0));
+    one = builder.create<mlir::vector::SplatOp>(loc, one, rhsRe.getType());
+    auto denom = fma(rhsRe, rhsRe, mul(rhsIm, rhsIm));
+    mlir::Value scale =
+        builder.create<mlir::arith::DivFOp>(loc, one, denom, fmf);
+    auto re = mul(fma(lhsRe, rhsRe, mul(lhsIm, rhsIm)), scale);
+    auto im = mul(fma(lhsIm, rhsRe, neg(mul(lhsRe, rhsIm))), scale);
+    complexMapping[res] = {re, im};
+  };
+
   // Check if memref access can be converted into gather/scatter.
-  auto canGatherScatter = [&](auto op) {
-    auto memref = op.getMemRef();
-    auto memrefType = mlir::cast<mlir::MemRefType>(memref.getType());
-    if (!isSupportedVecElem(memrefType.getElementType()))
-      return false;
+  auto canGatherScatter = [&](auto op) -> bool {
+    return !!::canGatherScatterImpl(loop, op);
+  };
+
+  // Get base indices and offsets vector for gather/scatter. Multidimensional
+  // indices are linearized using memref sizes, as memref has identity layout.
+  auto getGatherIndices = [&](mlir::Value memref, mlir::ValueRange indices)
+      -> std::pair<llvm::SmallVector<mlir::Value>, mlir::Value> {
+    llvm::SmallVector<mlir::Value> base(indices.size(), zero);
+    mlir::Value offsets = getVecVal(indices.front());
+    for (auto &&[i, idx] : llvm::enumerate(indices.drop_front())) {
+      mlir::Value size =
+          builder.createOrFold<mlir::memref::DimOp>(loc, memref, i + 1);
+      size = builder.create<mlir::vector::SplatOp>(loc, size,
+                                                   offsets.getType());
+      offsets = builder.create<mlir::arith::MulIOp>(loc, offsets, size);
+      offsets = builder.create<mlir::arith::AddIOp>(loc, offsets,
+                                                    getVecVal(idx));
+    }
+    return {base, offsets};
+  };
+
+  // Read-modify-write updates through gather/scatter, keyed by store. Update
+  // ops are skipped and generated together with the store.
+  llvm::DenseMap<mlir::Operation *, ScatterUpdate> scatterUpdates;
+  llvm::SmallDenseSet<mlir::Operation *> updateOps;
+  loop.getBody()->walk([&](mlir::memref::StoreOp storeOp) {
+    if (!canGatherScatter(storeOp) ||
+        ::cavTriviallyVectorizeMemOpImpl(loop, dim, uniform, storeOp))
+      return;
+
+    auto update = getScatterUpdate(storeOp);
+    if (!update)
+      return;
+
+    updateOps.insert(update->load);
+    updateOps.insert(update->ops.begin(), update->ops.end());
+    scatterUpdates.try_emplace(storeOp, std::move(*update));
+  });
+
+  // Generate scatter update in a loop, each iteration processes active lanes,
+  // which don't have the same index as any of the previous remaining lanes,
+  // so duplicated indices are updated sequentially in lanes order.
+  auto genScatterUpdate = [&](mlir::memref::StoreOp storeOp,
+                              const ScatterUpdate &update) {
+    auto memref = storeOp.getMemRef();
+    auto [base, offsets] = getGatherIndices(memref, storeOp.getIndices());
+    auto mask = getMemMask();
+
+    // Values, defined outside of the update, are materialized before the
+    // loop.
+    for (auto op : update.ops)
+      for (auto arg : op->getOperands())
+        if (!update.contains(arg))
+          getVecVal(arg);
+
+    auto maskType = mlir::cast<mlir::VectorType>(mask.getType());
+    mlir::Attribute falseAttr = builder.getBoolAttr(false);
+    mlir::Attribute trueAttr = builder.getBoolAttr(true);
+    mlir::Value falseVec = builder.create<mlir::arith::ConstantOp>(
+        loc, maskType, mlir::DenseElementsAttr::get(maskType, falseAttr));
+    mlir::Value trueVec = builder.create<mlir::arith::ConstantOp>(
+        loc, maskType, mlir::DenseElementsAttr::get(maskType, trueAttr));
+
+    auto whileOp = builder.create<mlir::scf::WhileOp>(loc, maskType, mask,
+                                                      nullptr, nullptr);
+    mlir::OpBuilder::InsertionGuard g(builder);
+    mlir::Block *before = whileOp.getBeforeBody();
+    builder.setInsertionPointToStart(before);
+    mlir::Value remaining = before->getArgument(0);
+    mlir::Value any = builder.create<mlir::vector::ReductionOp>(
+        loc, mlir::vector::CombiningKind::OR, remaining);
+    builder.create<mlir::scf::ConditionOp>(loc, any, remaining);
+
+    mlir::Block *after = whileOp.getAfterBody();
+    builder.setInsertionPointToStart(after);
+    remaining = after->getArgument(0);
+
+    // Compare lanes indices with indices of previous lanes, shifted by `i`.
+    mlir::Value conflicts = falseVec;
+    for (auto i : llvm::seq(1u, factor)) {
+      llvm::SmallVector<int64_t> offsetsShuffle(factor);
+      llvm::SmallVector<int64_t> maskShuffle(factor);
+      for (auto j : llvm::seq(0u, factor)) {
+        offsetsShuffle[j] = j < i ? j : j - i;
+        maskShuffle[j] = j < i ? factor + j : j - i;
+      }
+      mlir::Value prevOffsets = builder.create<mlir::vector::ShuffleOp>(
+          loc, offsets, offsets, offsetsShuffle);
+      mlir::Value prevRemaining = builder.create<mlir::vector::ShuffleOp>(
+          loc, remaining, falseVec, maskShuffle);
+      mlir::Value same = builder.create<mlir::arith::CmpIOp>(
+          loc, mlir::arith::CmpIPredicate::eq, offsets, prevOffsets);
+      same = builder.create<mlir::arith::AndIOp>(loc, same, prevRemaining);
+      conflicts = builder.create<mlir::arith::OrIOp>(loc, conflicts, same);
+    }
+    conflicts = builder.create<mlir::arith::XOrIOp>(loc, conflicts, trueVec);
+    mlir::Value active =
+        builder.create<mlir::arith::AndIOp>(loc, remaining, conflicts);
+
+    auto load = update.load;
+    auto resType = toVectorType(load.getResult().getType());
+    mlir::Value gather = builder.create<mlir::vector::GatherOp>(
+        loc, resType, memref, base, offsets, active, createPosionVec(resType));
+    mapping.map(load.getResult(), gather);
+    for (auto op : update.ops) {
+      auto newOp = builder.clone(*op, mapping);
+      for (auto res : newOp->getResults())
+        res.setType(toVectorType(res.getType()));
+    }
 
-    return dom.properlyDominates(memref, loop) && op.getIndices().size() == 1 &&
-           memrefType.getLayout().isIdentity();
+    auto value = mapping.lookup(storeOp.getValueToStore());
+    builder.create<mlir::vector::ScatterOp>(loc, memref, base, offsets, active,
+                                            value);
+    mlir::Value next =
+        builder.create<mlir::arith::XOrIOp>(loc, remaining, active);
+    builder.create<mlir::scf::YieldOp>(loc, next);
   };
 
   // Create vectorized memref load for specified non-vectorized load.
@@ -445,8 +1381,8 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
     auto resType = toVectorType(loadOp.getResult().getType());
     auto memref = loadOp.getMemRef();
     mlir::Value vecLoad;
-    if (masked) {
-      auto mask = getMask();
+    if (masked || predicate) {
+      auto mask = getMemMask();
       auto init = createPosionVec(resType);
       vecLoad = builder.create<mlir::vector::MaskedLoadOp>(loc, resType, memref,
                                                            indices, mask, init);
@@ -462,8 +1398,8 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
     auto indices = getMemrefVecIndices(storeOp.getIndices());
     auto value = getVecVal(storeOp.getValueToStore());
     auto memref = storeOp.getMemRef();
-    if (masked) {
-      auto mask = getMask();
+    if (masked || predicate) {
+      auto mask = getMemMask();
       builder.create<mlir::vector::MaskedStoreOp>(loc, memref, indices, mask,
                                                   value);
     } else {
@@ -474,9 +1410,103 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
   llvm::SmallVector<mlir::Value> duplicatedArgs;
   llvm::SmallVector<mlir::Value> duplicatedResults;
 
-  builder.setInsertionPointToStart(newLoop.getBody());
-  for (mlir::Operation &op : loop.getBody()->without_terminator()) {
+  // Vectorize single op from the source loop body. `scf.if` ops are
+  // if-converted: both branches are vectorized under their condition masks
+  // and results are blended with `arith.select`.
+  auto vectorizeOp = [&](mlir::Operation &op,
+                         auto &&vectorizeOp) -> mlir::LogicalResult {
     loc = op.getLoc();
+    if (updateOps.contains(&op))
+      return mlir::success();
+
+    if (auto ifOp = mlir::dyn_cast<mlir::scf::IfOp>(op)) {
+      mlir::Value cond = getVecVal(ifOp.getCondition());
+      auto prevPredicate = predicate;
+      auto vectorizeBranch =
+          [&](mlir::Block *block,
+              mlir::Value branchCond) -> mlir::FailureOr<mlir::ValueRange> {
+        predicate = branchCond;
+        if (prevPredicate)
+          predicate = builder.create<mlir::arith::AndIOp>(loc, prevPredicate,
+                                                          branchCond);
+
+        for (mlir::Operation &nested : block->without_terminator())
+          if (mlir::failed(vectorizeOp(nested, vectorizeOp)))
+            return mlir::failure();
+
+        return mlir::ValueRange(block->getTerminator()->getOperands());
+      };
+
+      auto thenResults = vectorizeBranch(ifOp.thenBlock(), cond);
+      if (mlir::failed(thenResults))
+        return mlir::failure();
+
+      mlir::ValueRange elseResults;
+      if (auto elseBlock = ifOp.elseBlock()) {
+        auto maskType = toVectorType(builder.getI1Type());
+        mlir::Attribute trueAttr = builder.getBoolAttr(true);
+        mlir::Value trueVec = builder.create<mlir::arith::ConstantOp>(
+            loc, maskType, mlir::DenseElementsAttr::get(maskType, trueAttr));
+        mlir::Value notCond =
+            builder.create<mlir::arith::XOrIOp>(loc, cond, trueVec);
+        auto res = vectorizeBranch(elseBlock, notCond);
+        if (mlir::failed(res))
+          return mlir::failure();
+
+        elseResults = *res;
+      }
+      predicate = prevPredicate;
+
+      loc = op.getLoc();
+      for (auto &&[res, thenVal, elseVal] :
+           llvm::zip(ifOp.getResults(), *thenResults, elseResults)) {
+        mlir::Value blend = builder.create<mlir::arith::SelectOp>(
+            loc, cond, getVecVal(thenVal), getVecVal(elseVal));
+        mapping.map(res, blend);
+      }
+      return mlir::success();
+    }
+
+    if (op.getNumResults() > 0 && uniform.contains(op.getResult(0))) {
+      auto newOp = builder.clone(op, uniformMapping);
+
+      // Non-vectorizable uniform ops are not replicated, their results are
+      // broadcasted if needed.
+      if (!isSupportedVectorOp(op)) {
+        for (auto &&[res, newRes] :
+             llvm::zip(op.getResults(), newOp->getResults())) {
+          unpackedVals[res].assign(factor, newRes);
+          if (isSupportedVecElem(res.getType()))
+            mapping.map(res, builder.create<mlir::vector::SplatOp>(
+                                 loc, newRes, toVectorType(res.getType())));
+        }
+        return mlir::success();
+      }
+    }
+
+    if (params.complexTypes) {
+      if (getComplexOpCost(op)) {
+        genComplexOp(op);
+        return mlir::success();
+      }
+
+      auto canVectorizeComplexMemOp = [&](auto memOp) -> bool {
+        return !predicate && isComplexMemOp(op) &&
+               ::cavTriviallyVectorizeMemOpImpl(loop, dim, uniform, memOp,
+                                                /*complexTypes*/ true);
+      };
+      auto loadOp = mlir::dyn_cast<mlir::memref::LoadOp>(op);
+      if (loadOp && canVectorizeComplexMemOp(loadOp)) {
+        genComplexLoad(loadOp);
+        return mlir::success();
+      }
+      auto storeOp = mlir::dyn_cast<mlir::memref::StoreOp>(op);
+      if (storeOp && canVectorizeComplexMemOp(storeOp)) {
+        genComplexStore(storeOp);
+        return mlir::success();
+      }
+    }
+
     if (isSupportedVectorOp(op)) {
       // If op can be vectorized, clone it with vectorized inputs and  update
       // resuls to vectorized types.
@@ -487,7 +1517,7 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
       for (auto res : newOp->getResults())
         res.setType(toVectorType(res.getType()));
 
-      continue;
+      return mlir::success();
     }
 
     // Vectorize memref load/store ops, vector load/store are preffered over
@@ -495,35 +1525,41 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
     if (auto loadOp = mlir::dyn_cast<mlir::memref::LoadOp>(op)) {
       if (canTriviallyVectorizeMemOp(loadOp)) {
         genLoad(loadOp);
-        continue;
+        return mlir::success();
       }
       if (canGatherScatter(loadOp)) {
         auto resType = toVectorType(loadOp.getResult().getType());
         auto memref = loadOp.getMemRef();
-        auto mask = getMask();
-        auto indexVec = getVecVal(loadOp.getIndices()[0]);
+        auto mask = getMemMask();
+        auto [base, offsets] = getGatherIndices(memref, loadOp.getIndices());
         auto init = createPosionVec(resType);
 
         auto gather = builder.create<mlir::vector::GatherOp>(
-            loc, resType, memref, zero, indexVec, mask, init);
+            loc, resType, memref, base, offsets, mask, init);
         mapping.map(loadOp.getResult(), gather.getResult());
-        continue;
+        return mlir::success();
       }
     }
 
     if (auto storeOp = mlir::dyn_cast<mlir::memref::StoreOp>(op)) {
       if (canTriviallyVectorizeMemOp(storeOp)) {
         genStore(storeOp);
-        continue;
+        return mlir::success();
+      }
+      auto it = scatterUpdates.find(storeOp);
+      if (it != scatterUpdates.end()) {
+        genScatterUpdate(storeOp, it->second);
+        return mlir::success();
       }
       if (canGatherScatter(storeOp)) {
         auto memref = storeOp.getMemRef();
         auto value = getVecVal(storeOp.getValueToStore());
-        auto mask = getMask();
-        auto indexVec = getVecVal(storeOp.getIndices()[0]);
+        auto mask = getMemMask();
+        auto [base, offsets] = getGatherIndices(memref, storeOp.getIndices());
 
-        builder.create<mlir::vector::ScatterOp>(loc, memref, zero, indexVec,
+        builder.create<mlir::vector::ScatterOp>(loc, memref, base, offsets,
                                                 mask, value);
+        return mlir::success();
       }
     }
 
@@ -531,6 +1567,9 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
     if (masked)
       return op.emitError("Cannot vectorize op in masked mode");
 
+    if (predicate)
+      return op.emitError("Cannot vectorize op in if-converted branch");
+
     scalarMapping.clear();
 
     auto numArgs = op.getNumOperands();
@@ -562,22 +1601,31 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
                          .take_front(factor);
       setUnpackedVals(op.getResult(i), results);
     }
-  }
+    return mlir::success();
+  };
+
+  builder.setInsertionPointToStart(newLoop.getBody());
+  for (mlir::Operation &op : loop.getBody()->without_terminator())
+    if (mlir::failed(vectorizeOp(op, vectorizeOp)))
+      return mlir::failure();
 
   // Vectorize `scf.reduce` op.
-  auto reduceOp =
-      mlir::cast<mlir::scf::ReduceOp>(loop.getBody()->getTerminator());
   llvm::SmallVector<mlir::Value> reduceVals;
   reduceVals.reserve(reduceOp.getNumOperands());
 
-  for (auto &&[body, arg] :
-       llvm::zip(reduceOp.getReductions(), reduceOp.getOperands())) {
+  for (auto &&[body, arg, neutralVec] : llvm::zip(
+           reduceOp.getReductions(), reduceOp.getOperands(), accNeutral)) {
     scalarMapping.clear();
     mlir::Block &reduceBody = body.front();
     assert(reduceBody.getNumArguments() == 2);
 
     mlir::Value reduceVal;
-    if (auto redKind = getReductionKind(reduceBody)) {
+    if (neutralVec) {
+      // Vector accumulator, out of bounds lanes are replaced with neutral
+      // value.
+      reduceVal = builder.create<mlir::arith::SelectOp>(
+          loc, getMask(), getVecVal(arg), neutralVec);
+    } else if (auto redKind = getReductionKind(reduceBody)) {
       // Generate `vector.reduce` if possible.
       mlir::Value redArg = getVecVal(arg);
       if (redArg) {
@@ -622,14 +1670,46 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
     reduceVals.emplace_back(reduceVal);
   }
 
-  // Clone `scf.reduce` op to reduce across loop iterations.
-  if (!reduceVals.empty())
-    builder.clone(*reduceOp)->setOperands(reduceVals);
+  // Clone `scf.reduce` op to reduce across loop iterations, vector
+  // accumulators are reduced with vectorized reduction bodies.
+  if (!reduceVals.empty()) {
+    auto newReduce =
+        mlir::cast<mlir::scf::ReduceOp>(builder.clone(*reduceOp));
+    newReduce->setOperands(reduceVals);
+    for (auto &&[body, neutralVec] :
+         llvm::zip(newReduce.getReductions(), accNeutral)) {
+      if (!neutralVec)
+        continue;
+
+      mlir::Block &reduceBody = body.front();
+      for (auto arg : reduceBody.getArguments())
+        arg.setType(neutralVec.getType());
+
+      for (mlir::Operation &op : reduceBody.without_terminator())
+        for (auto res : op.getResults())
+          res.setType(toVectorType(res.getType()));
+    }
+  }
+
+  // Reduce vector accumulators after the loop.
+  llvm::SmallVector<mlir::Value> results(newLoop.getResults());
+  builder.setInsertionPointAfter(newLoop);
+  for (auto &&[i, body] : llvm::enumerate(reduceOp.getReductions())) {
+    if (!accNeutral[i])
+      continue;
+
+    mlir::Block &reduceBody = body.front();
+    auto redKind = getReductionKind(reduceBody);
+    assert(redKind);
+    auto fmf = getFMF(reduceBody.front());
+    results[i] = builder.create<mlir::vector::ReductionOp>(
+        loc, *redKind, newLoop.getResult(i), loop.getInitVals()[i], fmf);
+  }
 
   // If in masked mode remove old loop, otherwise update loop bounds to
   // repurpose it for handling remaining values.
   if (masked) {
-    loop->replaceAllUsesWith(newLoop.getResults());
+    loop->replaceAllUsesWith(results);
     loop->erase();
   } else {
     builder.setInsertionPoint(loop);
@@ -640,9 +1720,125 @@ numba::vectorizeLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
     auto lowerCopy = llvm::to_vector(loop.getLowerBound());
     lowerCopy[dim] = newLower;
     loop.getLowerBoundMutable().assign(lowerCopy);
-    loop.getInitValsMutable().assign(newLoop.getResults());
+    loop.getInitValsMutable().assign(results);
+    loop->setAttr(vectorizedAttrName, unitAttr);
   }
 
+  if (params.unrollFactor > 1)
+    return numba::unrollAndJamLoop(builder, newLoop, params.unrollDim,
+                                   params.unrollFactor);
+
+  return mlir::success();
+}
+
+mlir::LogicalResult numba::unrollAndJamLoop(mlir::OpBuilder &builder,
+                                            mlir::scf::ParallelOp loop,
+                                            unsigned dim, unsigned factor) {
+  assert(dim < loop.getStep().size());
+  assert(factor > 1);
+  if (!mlir::isConstantIntValue(loop.getStep()[dim], 1))
+    return loop.emitError("Only unit step is supported for unroll-and-jam");
+
+  mlir::OpBuilder::InsertionGuard g(builder);
+  builder.setInsertionPoint(loop);
+
+  auto lower = llvm::to_vector(loop.getLowerBound());
+  auto upper = llvm::to_vector(loop.getUpperBound());
+  auto step = llvm::to_vector(loop.getStep());
+
+  auto loc = loop.getLoc();
+  auto origIndexVar = loop.getInductionVars()[dim];
+
+  mlir::Value factorVal =
+      builder.create<mlir::arith::ConstantIndexOp>(loc, factor);
+
+  auto origLower = lower[dim];
+  auto origUpper = upper[dim];
+  mlir::Value count =
+      builder.create<mlir::arith::SubIOp>(loc, origUpper, origLower);
+  mlir::Value newCount =
+      builder.create<mlir::arith::DivSIOp>(loc, count, factorVal);
+
+  mlir::Value zero = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  lower[dim] = zero;
+  upper[dim] = newCount;
+
+  // Unrolled loop.
+  auto newLoop = builder.create<mlir::scf::ParallelOp>(loc, lower, upper, step,
+                                                       loop.getInitVals());
+  auto vectorizedAttrName = numba::util::attributes::getVectorizedName();
+  if (auto attr = loop->getAttr(vectorizedAttrName))
+    newLoop->setAttr(vectorizedAttrName, attr);
+  auto newIndexVar = newLoop.getInductionVars()[dim];
+
+  auto reduceOp =
+      mlir::cast<mlir::scf::ReduceOp>(loop.getBody()->getTerminator());
+
+  // Reduce args for each unrolled iteration.
+  llvm::SmallVector<llvm::SmallVector<mlir::Value>> reduceArgs(
+      reduceOp.getNumOperands());
+
+  builder.setInsertionPointToStart(newLoop.getBody());
+  mlir::Value base =
+      builder.create<mlir::arith::MulIOp>(loc, newIndexVar, factorVal);
+  base = builder.create<mlir::arith::AddIOp>(loc, base, origLower);
+
+  mlir::IRMapping mapping;
+  for (auto i : llvm::seq(0u, factor)) {
+    mapping.clear();
+    mapping.map(loop.getInductionVars(), newLoop.getInductionVars());
+    mlir::Value idx = base;
+    if (i != 0) {
+      mlir::Value offset = builder.create<mlir::arith::ConstantIndexOp>(loc, i);
+      idx = builder.create<mlir::arith::AddIOp>(loc, base, offset);
+    }
+    mapping.map(origIndexVar, idx);
+
+    for (mlir::Operation &op : loop.getBody()->without_terminator())
+      builder.clone(op, mapping);
+
+    for (auto &&[args, arg] : llvm::zip(reduceArgs, reduceOp.getOperands()))
+      args.emplace_back(mapping.lookupOrDefault(arg));
+  }
+
+  // Combine values from unrolled iterations using reduction bodies.
+  llvm::SmallVector<mlir::Value> reduceVals;
+  reduceVals.reserve(reduceArgs.size());
+  for (auto &&[body, args] : llvm::zip(reduceOp.getReductions(), reduceArgs)) {
+    mlir::Block &reduceBody = body.front();
+    assert(reduceBody.getNumArguments() == 2);
+    auto reduceTerm =
+        mlir::cast<mlir::scf::ReduceReturnOp>(reduceBody.getTerminator());
+    auto lhs = reduceBody.getArgument(0);
+    auto rhs = reduceBody.getArgument(1);
+
+    mlir::Value reduceVal = args.front();
+    for (auto val : llvm::ArrayRef(args).drop_front()) {
+      mapping.clear();
+      mapping.map(lhs, reduceVal);
+      mapping.map(rhs, val);
+      for (auto &redOp : reduceBody.without_terminator())
+        builder.clone(redOp, mapping);
+
+      reduceVal = mapping.lookupOrDefault(reduceTerm.getResult());
+    }
+    reduceVals.emplace_back(reduceVal);
+  }
+
+  // Clone `scf.reduce` op to reduce across loop iterations.
+  if (!reduceVals.empty())
+    builder.clone(*reduceOp)->setOperands(reduceVals);
+
+  // Repurpose original loop for remaining iterations.
+  builder.setInsertionPoint(loop);
+  mlir::Value newLower =
+      builder.create<mlir::arith::MulIOp>(loc, newCount, factorVal);
+  newLower = builder.create<mlir::arith::AddIOp>(loc, origLower, newLower);
+
+  auto lowerCopy = llvm::to_vector(loop.getLowerBound());
+  lowerCopy[dim] = newLower;
+  loop.getLowerBoundMutable().assign(lowerCopy);
+  loop.getInitValsMutable().assign(newLoop.getResults());
   return mlir::success();
 }
 
@@ -663,6 +1859,63 @@ static std::optional<unsigned> getVectorLength(mlir::Operation *op) {
   return static_cast<unsigned>(val);
 }
 
+/// Returns constant offset `c` if `val` is `iv + c`.
+static std::optional<int64_t> getIndexOffset(mlir::Value val, mlir::Value iv) {
+  if (val == iv)
+    return 0;
+
+  if (auto add = val.getDefiningOp<mlir::arith::AddIOp>()) {
+    if (add.getLhs() == iv)
+      return mlir::getConstantIntValue(add.getRhs());
+    if (add.getRhs() == iv)
+      return mlir::getConstantIntValue(add.getLhs());
+  }
+
+  if (auto sub = val.getDefiningOp<mlir::arith::SubIOp>()) {
+    if (sub.getLhs() == iv)
+      if (auto c = mlir::getConstantIntValue(sub.getRhs()))
+        return -*c;
+  }
+  return std::nullopt;
+}
+
+/// Select dimension for unroll-and-jam, on which the same memref is loaded
+/// with different constant offsets (e.g. `a[i - 1, j]`, `a[i + 1, j]` in
+/// stencils), so unrolled iterations can reuse loaded values.
+static std::optional<unsigned> getUnrollAndJamDim(mlir::scf::ParallelOp loop,
+                                                  unsigned vecDim) {
+  std::optional<unsigned> ret;
+  unsigned bestReuse = 0;
+  for (auto &&[dim, iv] : llvm::enumerate(loop.getInductionVars())) {
+    if (dim == vecDim || !mlir::isConstantIntValue(loop.getStep()[dim], 1))
+      continue;
+
+    llvm::DenseMap<std::pair<mlir::Value, unsigned>,
+                   llvm::SmallDenseSet<int64_t>>
+        offsets;
+    for (mlir::Operation &op : loop.getBody()->without_terminator()) {
+      auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op);
+      if (!load)
+        continue;
+
+      for (auto &&[i, idx] : llvm::enumerate(load.getIndices()))
+        if (auto offset = getIndexOffset(idx, iv))
+          offsets[{load.getMemRef(), unsigned(i)}].insert(*offset);
+    }
+
+    unsigned reuse = 0;
+    for (auto &&[key, set] : offsets)
+      if (set.size() > 1)
+        reuse += set.size();
+
+    if (reuse > bestReuse) {
+      bestReuse = reuse;
+      ret = static_cast<unsigned>(dim);
+    }
+  }
+  return ret;
+}
+
 namespace {
 struct SCFVectorizePass
     : public mlir::PassWrapper<SCFVectorizePass, mlir::OperationPass<>> {
@@ -671,9 +1924,11 @@ struct SCFVectorizePass
   virtual void
   getDependentDialects(mlir::DialectRegistry &registry) const override {
     registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::complex::ComplexDialect>();
     registry.insert<mlir::scf::SCFDialect>();
     registry.insert<mlir::ub::UBDialect>();
     registry.insert<mlir::vector::VectorDialect>();
+    registry.insert<numba::util::NumbaUtilDialect>();
   }
 
   void runOnOperation() override {
@@ -681,10 +1936,16 @@ struct SCFVectorizePass
         std::pair<mlir::scf::ParallelOp, numba::SCFVectorizeParams>>
         toVectorize;
 
-    // Simple heuristic: total number of elements processed by vector ops, but
-    // prefer masked mode over non-masked.
-    auto getBenefit = [](const numba::SCFVectorizeInfo &info) {
-      return info.factor * info.count * (int(info.masked) + 1);
+    // Select dimension with the best estimated speedup, prefer masked mode
+    // as it doesn't need remainder loop.
+    auto isBetter = [](const numba::SCFVectorizeInfo &lhs,
+                       const numba::SCFVectorizeInfo &rhs) {
+      auto lhsSpeedup = lhs.getSpeedup();
+      auto rhsSpeedup = rhs.getSpeedup();
+      if (lhsSpeedup != rhsSpeedup)
+        return lhsSpeedup > rhsSpeedup;
+
+      return lhs.masked && !rhs.masked;
     };
 
     getOperation()->walk([&](mlir::scf::ParallelOp loop) {
@@ -692,27 +1953,65 @@ struct SCFVectorizePass
       if (!len)
         return;
 
+      auto costModel = numba::SCFVectorizeCostModel::get(*len);
+      costModel.complexTypes = true;
       std::optional<numba::SCFVectorizeInfo> best;
       for (auto dim : llvm::seq(0u, loop.getNumLoops())) {
-        auto info = numba::getLoopVectorizeInfo(loop, dim, *len);
+        auto info = numba::getLoopVectorizeInfo(loop, dim, costModel);
         if (!info)
           continue;
 
-        if (!best) {
+        if (!best || isBetter(*info, *best))
           best = *info;
-          continue;
-        }
+      }
 
-        if (getBenefit(*info) > getBenefit(*best))
-          best = *info;
+      if (!best) {
+        loop.emitRemark("Loop is not vectorized: no vectorizable dimension");
+        return;
       }
 
-      if (!best)
+      // Register-block stencil-like loops: unroll-and-jam outer dimension
+      // instead of interleaving the vectorized one.
+      numba::SCFVectorizeParams params{best->dim, best->factor, best->masked};
+      params.complexTypes = costModel.complexTypes;
+      if (best->replicated == 0 && best->gathers == 0) {
+        if (auto unrollDim = getUnrollAndJamDim(loop, best->dim)) {
+          auto live = std::max(best->count + best->reductions, 1u);
+          auto unroll = std::min(costModel.numVectorRegs / live,
+                                 costModel.maxInterleave);
+          unroll = llvm::bit_floor(unroll);
+          if (unroll > 1) {
+            params.unrollDim = *unrollDim;
+            params.unrollFactor = unroll;
+            best->interleave = 1;
+          }
+        }
+      }
+      params.factor *= best->interleave;
+
+      auto speedup = best->getSpeedup();
+      auto describe = [&]() {
+        return llvm::formatv("dim {0}, factor {1}, interleave {2}, masked {3}, "
+                             "unroll-and-jam dim {4} by {5}, {6} gathers, "
+                             "{7} replicated, {8} reductions, "
+                             "{9} if-converted, cost {10} scalar vs {11} "
+                             "vector, speedup {12:F2}",
+                             best->dim, best->factor, best->interleave,
+                             best->masked, params.unrollDim,
+                             params.unrollFactor, best->gathers,
+                             best->replicated, best->reductions,
+                             best->predicates, best->scalarCost,
+                             best->vectorCost, speedup)
+            .str();
+      };
+      if (speedup <= 1) {
+        loop.emitRemark("Loop is not vectorized, not profitable: ")
+            << describe();
         return;
+      }
 
-      toVectorize.emplace_back(
-          loop,
-          numba::SCFVectorizeParams{best->dim, best->factor, best->masked});
+      loop.emitRemark("Loop vectorized: ") << describe();
+      toVectorize.emplace_back(loop, params);
     });
 
     if (toVectorize.empty())
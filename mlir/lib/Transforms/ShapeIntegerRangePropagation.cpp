@@ -6,16 +6,21 @@
 
 #include "numba/Dialect/ntensor/IR/NTensorOps.hpp"
 #include "numba/Dialect/numba_util/Dialect.hpp"
+#include "numba/Transforms/IndexTypePropagation.hpp"
 
+#include <llvm/ADT/MapVector.h>
 #include <llvm/Support/Debug.h>
 #include <mlir/Analysis/DataFlow/ConstantPropagationAnalysis.h>
 #include <mlir/Analysis/DataFlow/DeadCodeAnalysis.h>
 #include <mlir/Analysis/DataFlow/IntegerRangeAnalysis.h>
 #include <mlir/Dialect/Arith/IR/Arith.h>
 #include <mlir/Dialect/Arith/Transforms/Passes.h>
+#include <mlir/Dialect/Func/IR/FuncOps.h>
 #include <mlir/Dialect/Linalg/IR/Linalg.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
 #include <mlir/Dialect/Tensor/IR/Tensor.h>
 #include <mlir/IR/PatternMatch.h>
+#include <mlir/IR/SymbolTable.h>
 #include <mlir/Interfaces/FunctionInterfaces.h>
 #include <mlir/Interfaces/ShapedOpInterfaces.h>
 #include <mlir/Pass/Pass.h>
@@ -614,8 +619,83 @@ public:
 
     mlir::dataflow::IntegerRangeAnalysis::visitOperation(op, operands, results);
   }
+
+  void visitNonControlFlowArguments(
+      mlir::Operation *op, const mlir::RegionSuccessor &successor,
+      llvm::ArrayRef<mlir::dataflow::IntegerValueRangeLattice *> argLattices,
+      unsigned firstIndex) override {
+    // Upstream only handles loops with the single induction variable.
+    // TODO: upstream
+    if (auto parallel = mlir::dyn_cast<mlir::scf::ParallelOp>(op)) {
+      for (auto &&[iv, lower, upper, step] :
+           llvm::zip(parallel.getInductionVars(), parallel.getLowerBound(),
+                     parallel.getUpperBound(), parallel.getStep())) {
+        auto argNumber = iv.getArgNumber();
+        if (argNumber >= argLattices.size())
+          continue;
+
+        auto *lattice = argLattices[argNumber];
+        auto range = getParallelIVRange(op, lower, upper, step);
+        LLVM_DEBUG({
+          llvm::dbgs() << "IntegerRangeAnalysisEx: parallel iv range: ";
+          range.print(llvm::dbgs());
+          llvm::dbgs() << "\n";
+        });
+        propagateIfChanged(lattice, lattice->join(range));
+      }
+      return;
+    }
+
+    mlir::dataflow::IntegerRangeAnalysis::visitNonControlFlowArguments(
+        op, successor, argLattices, firstIndex);
+  }
+
+private:
+  /// Induction var is in `[lower, upper - 1]` range for positive step.
+  mlir::dataflow::IntegerValueRange getParallelIVRange(mlir::Operation *op,
+                                                       mlir::Value lower,
+                                                       mlir::Value upper,
+                                                       mlir::Value step) {
+    auto getRange =
+        [&](mlir::Value val) -> std::optional<mlir::ConstantIntRanges> {
+      auto *state =
+          getOrCreateFor<mlir::dataflow::IntegerValueRangeLattice>(op, val);
+      if (!state || state->getValue().isUninitialized())
+        return std::nullopt;
+
+      return state->getValue().getValue();
+    };
+
+    auto maxRange = mlir::dataflow::IntegerValueRange::getMaxRange(lower);
+    auto lowerRange = getRange(lower);
+    auto upperRange = getRange(upper);
+    auto stepRange = getRange(step);
+    if (!lowerRange || !upperRange || !stepRange ||
+        !stepRange->smin().isStrictlyPositive())
+      return maxRange;
+
+    auto min = lowerRange->smin().getSExtValue();
+    auto max = upperRange->smax().getSExtValue();
+    if (max == std::numeric_limits<int64_t>::min())
+      return maxRange;
+
+    // Loop body is never executed otherwise, any range is valid.
+    max = std::max(max - 1, min);
+    return mlir::dataflow::IntegerValueRange{getIndexRange(min, max)};
+  }
 };
 
+/// Counts index comparisons, which are remaining wraparound and bounds checks
+/// after negative indices resolution.
+static unsigned countIndexChecks(mlir::Operation *root) {
+  unsigned count = 0;
+  root->walk([&](mlir::arith::CmpIOp cmp) {
+    if (mlir::isa<mlir::IndexType>(cmp.getLhs().getType()))
+      ++count;
+  });
+  return count;
+}
+
 static void printShapeAnalysisState(mlir::DataFlowSolver &solver,
                                     mlir::Operation *root) {
   assert(root && "Invalid root");
@@ -653,6 +733,139 @@ static void printShapeAnalysisState(mlir::DataFlowSolver &solver,
   root->walk(removeAttr);
 }
 
+/// Shape and integer range facts for the call operands or function
+/// arguments.
+using ArgFacts = llvm::SmallVector<
+    std::pair<ShapeValue, std::optional<mlir::ConstantIntRanges>>>;
+
+static ArgFacts getArgFacts(mlir::DataFlowSolver &solver,
+                            mlir::ValueRange values) {
+  ArgFacts ret;
+  ret.reserve(values.size());
+  for (auto val : values) {
+    auto &facts = ret.emplace_back();
+    if (auto *shape = solver.lookupState<ShapeValueLattice>(val))
+      facts.first = shape->getValue();
+
+    auto *range =
+        solver.lookupState<mlir::dataflow::IntegerValueRangeLattice>(val);
+    if (range && !range->getValue().isUninitialized())
+      facts.second = range->getValue().getValue();
+  }
+  return ret;
+}
+
+/// Attach call site shape facts to the specialized function args, so they are
+/// available to the subsequent runs even if the callers were changed.
+static void setArgShapeRanges(mlir::func::FuncOp func, const ArgFacts &facts) {
+  auto ctx = func.getContext();
+  auto attrName =
+      mlir::StringAttr::get(ctx, numba::util::attributes::getShapeRangeName());
+  for (auto &&[i, arg] : llvm::enumerate(func.getArguments())) {
+    auto shaped = mlir::dyn_cast<mlir::ShapedType>(arg.getType());
+    if (!shaped || facts[i].first.isUninitialized())
+      continue;
+
+    auto ind = static_cast<unsigned>(i);
+    auto shape = ShapeValue::intersect({shaped}, facts[i].first);
+    if (auto attr = func.getArgAttrOfType<mlir::ArrayAttr>(ind, attrName))
+      shape = ShapeValue::intersect(shape, {attr});
+
+    llvm::SmallVector<mlir::Attribute> ranges;
+    for (auto &range : shape.getShape())
+      ranges.emplace_back(numba::util::IndexRangeAttr::get(
+          ctx, range.smin().getSExtValue(), range.smax().getSExtValue()));
+
+    func.setArgAttr(ind, attrName, mlir::ArrayAttr::get(ctx, ranges));
+  }
+}
+
+/// Max number of specialized clones per function.
+static constexpr unsigned MaxSpecializations = 4;
+
+/// Private callees arguments facts are the join of facts from all call sites,
+/// so callers, which pass e.g. arrays of different sizes, pessimize each
+/// other. Clone callee for the call sites providing stronger facts than this
+/// join. Returns number of the created clones.
+static unsigned specializeCallees(mlir::DataFlowSolver &solver,
+                                  mlir::ModuleOp mod) {
+  llvm::MapVector<mlir::func::FuncOp, llvm::SmallVector<mlir::func::CallOp>>
+      calls;
+  mod.walk([&](mlir::func::CallOp call) {
+    auto callee = mod.lookupSymbol<mlir::func::FuncOp>(call.getCallee());
+    if (!callee || !callee.isPrivate() || callee.isExternal())
+      return;
+
+    // Skip recursive calls.
+    if (call->getParentOfType<mlir::func::FuncOp>() == callee)
+      return;
+
+    calls[callee].emplace_back(call);
+  });
+
+  mlir::SymbolTable symbolTable(mod);
+  llvm::SmallVector<mlir::func::FuncOp> maybeDead;
+  unsigned count = 0;
+  for (auto &&[callee, calleeCalls] : calls) {
+    if (calleeCalls.size() < 2)
+      continue;
+
+    auto calleeFacts = getArgFacts(solver, callee.getArguments());
+    llvm::SmallVector<std::pair<ArgFacts, mlir::func::FuncOp>> clones;
+    for (auto call : calleeCalls) {
+      auto facts = getArgFacts(solver, call.getOperands());
+      if (facts == calleeFacts)
+        continue;
+
+      auto it = llvm::find_if(
+          clones, [&](auto &clone) { return clone.first == facts; });
+      mlir::func::FuncOp clone;
+      if (it != clones.end()) {
+        clone = it->second;
+      } else {
+        if (clones.size() >= MaxSpecializations)
+          continue;
+
+        clone = callee.clone();
+        clone.setName(
+            (callee.getName() + "_spec" + llvm::Twine(clones.size())).str());
+        // Specialized clone is not interchangeable with the other modules
+        // copies of the callee.
+        clone->removeAttr(numba::util::attributes::getSharedCalleeName());
+        mlir::Operation *prev =
+            clones.empty() ? callee.getOperation() : clones.back().second;
+        symbolTable.insert(clone, std::next(prev->getIterator()));
+        setArgShapeRanges(clone, facts);
+        LLVM_DEBUG(llvm::dbgs() << "ShapeIntegerRangePropagationPass: "
+                                << "specialized " << callee.getName()
+                                << " as " << clone.getName() << "\n");
+        clones.emplace_back(std::move(facts), clone);
+        ++count;
+      }
+      call.setCalleeAttr(mlir::FlatSymbolRefAttr::get(clone.getSymNameAttr()));
+    }
+
+    if (!clones.empty())
+      maybeDead.emplace_back(callee);
+  }
+
+  // Erase after all calls were processed, as dead callee can contain calls to
+  // the other callees.
+  for (auto callee : maybeDead)
+    if (mlir::SymbolTable::symbolKnownUseEmpty(callee, mod))
+      callee->erase();
+
+  return count;
+}
+
+static mlir::LogicalResult runSolver(mlir::DataFlowSolver &solver,
+                                     mlir::Operation *op) {
+  solver.load<mlir::dataflow::DeadCodeAnalysis>();
+  solver.load<ShapeValueAnalysis>();
+  solver.load<IntegerRangeAnalysisEx>();
+  return solver.initializeAndRun(op);
+}
+
 struct ShapeIntegerRangePropagationPass
     : public mlir::PassWrapper<ShapeIntegerRangePropagationPass,
                                mlir::OperationPass<void>> {
@@ -670,11 +883,16 @@ struct ShapeIntegerRangePropagationPass
   void runOnOperation() override {
     LLVM_DEBUG(llvm::dbgs() << "ShapeIntegerRangePropagationPass:\n");
     auto op = getOperation();
+    if (auto mod = mlir::dyn_cast<mlir::ModuleOp>(op)) {
+      mlir::DataFlowSolver solver;
+      if (mlir::failed(runSolver(solver, mod)))
+        return signalPassFailure();
+
+      numSpecializations += specializeCallees(solver, mod);
+    }
+
     mlir::DataFlowSolver solver;
-    solver.load<mlir::dataflow::DeadCodeAnalysis>();
-    solver.load<ShapeValueAnalysis>();
-    solver.load<IntegerRangeAnalysisEx>();
-    if (failed(solver.initializeAndRun(op)))
+    if (mlir::failed(runSolver(solver, op)))
       return signalPassFailure();
 
     LLVM_DEBUG(printShapeAnalysisState(solver, op));
@@ -684,6 +902,51 @@ struct ShapeIntegerRangePropagationPass
 
     mlir::arith::populateIntRangeOptimizationsPatterns(patterns, solver);
 
+    auto checksBefore = countIndexChecks(op);
+    if (mlir::failed(
+            mlir::applyPatternsAndFoldGreedily(op, std::move(patterns))))
+      return signalPassFailure();
+
+    auto checksAfter = countIndexChecks(op);
+    if (checksAfter < checksBefore)
+      numChecksRemoved += checksBefore - checksAfter;
+
+    numChecksRemaining += checksAfter;
+    LLVM_DEBUG(op->walk([&](mlir::FunctionOpInterface func) {
+      llvm::dbgs() << "ShapeIntegerRangePropagationPass: "
+                   << func.getName() << " index checks remaining: "
+                   << countIndexChecks(func) << "\n";
+    }));
+  }
+
+private:
+  Statistic numChecksRemoved{this, "num-checks-removed",
+                             "Number of index checks proven redundant"};
+  Statistic numChecksRemaining{this, "num-checks-remaining",
+                               "Number of index checks remaining"};
+  Statistic numSpecializations{
+      this, "num-specializations",
+      "Number of callees specialized for the call site facts"};
+};
+
+struct NarrowIndexTypePass
+    : public mlir::PassWrapper<NarrowIndexTypePass, mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(NarrowIndexTypePass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+  }
+
+  void runOnOperation() override {
+    auto op = getOperation();
+    mlir::DataFlowSolver solver;
+    if (mlir::failed(runSolver(solver, op)))
+      return signalPassFailure();
+
+    mlir::RewritePatternSet patterns(&getContext());
+    numba::populateIndexNarrowingPatterns(patterns, solver);
+
     if (mlir::failed(
             mlir::applyPatternsAndFoldGreedily(op, std::move(patterns))))
       return signalPassFailure();
@@ -694,3 +957,7 @@ struct ShapeIntegerRangePropagationPass
 std::unique_ptr<mlir::Pass> numba::createShapeIntegerRangePropagationPass() {
   return std::make_unique<ShapeIntegerRangePropagationPass>();
 }
+
+std::unique_ptr<mlir::Pass> numba::createNarrowIndexTypePass() {
+  return std::make_unique<NarrowIndexTypePass>();
+}
@@ -0,0 +1,318 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/SoftwarePrefetch.hpp"
+
+#include "numba/Transforms/LoopUtils.hpp"
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/IR/IRMapping.h>
+#include <mlir/Interfaces/LoopLikeInterface.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/SetVector.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+static constexpr unsigned CacheLineSize = 64;
+
+/// Max prefetch distance, in iterations.
+static constexpr int64_t MaxDistance = 64;
+
+static unsigned getElementBytes(mlir::Type type) {
+  if (mlir::isa<mlir::IndexType>(type))
+    return 8;
+
+  if (type.isIntOrFloat())
+    return std::max(type.getIntOrFloatBitWidth() / 8, 1u);
+
+  return 0;
+}
+
+static bool isInnermostLoop(mlir::Operation *loop) {
+  auto res = loop->walk([&](mlir::LoopLikeOpInterface nested) {
+    if (nested != loop)
+      return mlir::WalkResult::interrupt();
+
+    return mlir::WalkResult::advance();
+  });
+  return !res.wasInterrupted();
+}
+
+static bool isDefinedInside(mlir::Operation *op, mlir::Value val) {
+  return op->isAncestor(val.getParentRegion()->getParentOp());
+}
+
+/// Loop and its induction variable, loads are prefetched along. Step is
+/// always 1.
+struct LoopInfo {
+  mlir::Operation *loop = nullptr;
+  mlir::Value iv;
+  mlir::Value upper;
+};
+
+static std::optional<LoopInfo> getLoopInfo(mlir::Operation *op) {
+  if (auto loop = mlir::dyn_cast<mlir::scf::ForOp>(op)) {
+    if (!mlir::isConstantIntValue(loop.getStep(), 1))
+      return std::nullopt;
+
+    return LoopInfo{op, loop.getInductionVar(), loop.getUpperBound()};
+  }
+
+  if (auto loop = mlir::dyn_cast<mlir::scf::ParallelOp>(op)) {
+    // Innermost dimension iterates fastest.
+    if (!mlir::isConstantIntValue(loop.getStep().back(), 1))
+      return std::nullopt;
+
+    return LoopInfo{op, loop.getInductionVars().back(),
+                    loop.getUpperBound().back()};
+  }
+
+  return std::nullopt;
+}
+
+/// Rough body cost estimation, in cycles.
+static int64_t estimateCost(mlir::Block &body) {
+  int64_t cost = 0;
+  body.walk([&](mlir::Operation *op) {
+    if (op->hasTrait<mlir::OpTrait::IsTerminator>() ||
+        op->hasTrait<mlir::OpTrait::ConstantLike>())
+      return;
+
+    cost += mlir::isa<mlir::memref::LoadOp, mlir::memref::StoreOp>(op) ? 4 : 1;
+  });
+  return std::max<int64_t>(cost, 1);
+}
+
+/// `iv` or `iv + invariant`.
+static bool isIvOffset(const LoopInfo &info, mlir::Value val) {
+  if (val == info.iv)
+    return true;
+
+  auto add = val.getDefiningOp<mlir::arith::AddIOp>();
+  if (!add)
+    return false;
+
+  auto lhs = add.getLhs();
+  auto rhs = add.getRhs();
+  return (lhs == info.iv && !isDefinedInside(info.loop, rhs)) ||
+         (rhs == info.iv && !isDefinedInside(info.loop, lhs));
+}
+
+/// Ops, computing the load index from the induction variable, in topological
+/// order.
+struct IndexChain {
+  llvm::SmallSetVector<mlir::Operation *, 8> ops;
+  bool dependsOnIv = false;
+  bool indirect = false;
+};
+
+static bool collectChain(const LoopInfo &info, mlir::Value val,
+                         IndexChain &chain) {
+  if (!isDefinedInside(info.loop, val))
+    return true;
+
+  if (val == info.iv) {
+    chain.dependsOnIv = true;
+    return true;
+  }
+
+  // Other parallel loop induction variables are invariant along `iv`.
+  auto arg = mlir::dyn_cast<mlir::BlockArgument>(val);
+  if (arg && arg.getOwner() == info.iv.getParentBlock() &&
+      mlir::isa<mlir::scf::ParallelOp>(info.loop))
+    return true;
+
+  auto op = val.getDefiningOp();
+  if (!op || op->getBlock() != info.iv.getParentBlock())
+    return false;
+
+  if (chain.ops.contains(op))
+    return true;
+
+  if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op)) {
+    // Index load is executed ahead of time, so it must only access elements,
+    // which will be accessed by the loop itself: `b[iv + c]` with
+    // clamped `iv`. Only a single level of indirection is supported.
+    if (chain.indirect || isDefinedInside(info.loop, load.getMemRef()))
+      return false;
+
+    bool hasIv = false;
+    for (auto idx : load.getIndices()) {
+      if (!isDefinedInside(info.loop, idx))
+        continue;
+
+      if (!isIvOffset(info, idx))
+        return false;
+
+      hasIv = true;
+    }
+    if (!hasIv)
+      return false;
+
+    chain.indirect = true;
+  } else if (op->getNumRegions() != 0 || !mlir::isMemoryEffectFree(op)) {
+    return false;
+  }
+
+  for (auto arg : op->getOperands())
+    if (!collectChain(info, arg, chain))
+      return false;
+
+  chain.ops.insert(op);
+  return true;
+}
+
+/// Stride along dimension is larger than cache line, so hardware prefetcher
+/// is unlikely to help. Dynamic strides are assumed large for all but the
+/// innermost dimension.
+static bool isLargeStride(mlir::MemRefType type, unsigned dim) {
+  llvm::SmallVector<int64_t> strides;
+  int64_t offset;
+  if (mlir::failed(mlir::getStridesAndOffset(type, strides, offset)))
+    return false;
+
+  auto stride = strides[dim];
+  if (mlir::ShapedType::isDynamic(stride))
+    return dim + 1 != strides.size();
+
+  return std::abs(stride) * getElementBytes(type.getElementType()) >=
+         CacheLineSize;
+}
+
+/// Returns ops, computing load indices, or nullopt if the load doesn't need
+/// prefetch.
+static std::optional<IndexChain> getPrefetchChain(const LoopInfo &info,
+                                                  mlir::memref::LoadOp load) {
+  auto type = load.getMemRefType();
+  if (isDefinedInside(info.loop, load.getMemRef()) ||
+      getElementBytes(type.getElementType()) == 0)
+    return std::nullopt;
+
+  IndexChain ret;
+  bool strided = true;
+  for (auto &&[i, idx] : llvm::enumerate(load.getIndices())) {
+    IndexChain chain;
+    if (!collectChain(info, idx, chain))
+      return std::nullopt;
+
+    if (chain.dependsOnIv && !chain.indirect && !isLargeStride(type, i))
+      strided = false;
+
+    ret.dependsOnIv = ret.dependsOnIv || chain.dependsOnIv;
+    ret.indirect = ret.indirect || chain.indirect;
+    ret.ops.insert(chain.ops.begin(), chain.ops.end());
+  }
+
+  if (!ret.dependsOnIv || !(ret.indirect || strided))
+    return std::nullopt;
+
+  return ret;
+}
+
+static bool prefetchLoop(const LoopInfo &info, unsigned latency) {
+  auto body = info.iv.getParentBlock();
+  using Candidate = std::pair<mlir::memref::LoadOp, IndexChain>;
+  llvm::SmallVector<Candidate> candidates;
+  for (auto &op : body->without_terminator()) {
+    auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op);
+    if (!load)
+      continue;
+
+    auto isSame = [&](const Candidate &other) {
+      auto otherLoad = other.first;
+      return otherLoad.getMemRef() == load.getMemRef() &&
+             llvm::equal(otherLoad.getIndices(), load.getIndices());
+    };
+    if (llvm::any_of(candidates, isSame))
+      continue;
+
+    if (auto chain = getPrefetchChain(info, load))
+      candidates.emplace_back(load, std::move(*chain));
+  }
+
+  if (candidates.empty())
+    return false;
+
+  auto distance =
+      std::clamp<int64_t>(llvm::divideCeil(latency, estimateCost(*body)), 1,
+                          MaxDistance);
+
+  // Clamp prefetched iteration to the last one, so index loads stay in
+  // bounds.
+  auto loc = info.loop->getLoc();
+  mlir::OpBuilder builder(info.loop);
+  mlir::Value one = builder.create<mlir::arith::ConstantIndexOp>(loc, 1);
+  mlir::Value last = builder.create<mlir::arith::SubIOp>(loc, info.upper, one);
+
+  builder.setInsertionPointToStart(body);
+  mlir::Value dist =
+      builder.create<mlir::arith::ConstantIndexOp>(loc, distance);
+  mlir::Value next = builder.create<mlir::arith::AddIOp>(loc, info.iv, dist);
+  next = builder.create<mlir::arith::MinSIOp>(loc, next, last);
+
+  for (auto &&[load, chain] : candidates) {
+    builder.setInsertionPoint(load);
+    mlir::IRMapping mapping;
+    mapping.map(info.iv, next);
+    for (auto op : chain.ops)
+      builder.clone(*op, mapping);
+
+    llvm::SmallVector<mlir::Value> indices;
+    for (auto idx : load.getIndices())
+      indices.emplace_back(mapping.lookupOrDefault(idx));
+
+    builder.create<mlir::memref::PrefetchOp>(
+        load.getLoc(), load.getMemRef(), indices, /*isWrite*/ false,
+        /*localityHint*/ 3, /*isDataCache*/ true);
+  }
+  return true;
+}
+
+namespace {
+struct SoftwarePrefetchPass
+    : public mlir::PassWrapper<SoftwarePrefetchPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(SoftwarePrefetchPass)
+
+  SoftwarePrefetchPass(unsigned lat) : latency(lat) {}
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<LoopInfo> loops;
+    getOperation()->walk([&](mlir::Operation *op) {
+      auto info = getLoopInfo(op);
+      if (!info || !isInnermostLoop(op) || !numba::isCPULoop(op))
+        return;
+
+      loops.emplace_back(*info);
+    });
+
+    bool changed = false;
+    for (auto &info : loops)
+      changed = prefetchLoop(info, latency) || changed;
+
+    if (!changed)
+      return markAllAnalysesPreserved();
+  }
+
+private:
+  unsigned latency;
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass>
+numba::createSoftwarePrefetchPass(unsigned latency) {
+  return std::make_unique<SoftwarePrefetchPass>(latency);
+}
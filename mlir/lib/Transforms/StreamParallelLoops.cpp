@@ -0,0 +1,274 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/StreamParallelLoops.hpp"
+
+#include "numba/Transforms/FuncUtils.hpp"
+#include "numba/Transforms/LoopUtils.hpp"
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/Func/IR/FuncOps.h>
+#include <mlir/Dialect/Math/IR/Math.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Pass/Pass.h>
+
+#include <functional>
+
+/// Returns memrefs, defined outside of the parallel loop and indexed directly
+/// by its first induction variable, with the indexed dim.
+static llvm::SmallVector<std::pair<mlir::Value, unsigned>>
+getStreamedAccesses(mlir::scf::ParallelOp op) {
+  auto iv = op.getInductionVars().front();
+  llvm::SmallVector<std::pair<mlir::Value, unsigned>> ret;
+  auto visit = [&](mlir::Value memref, mlir::ValueRange indices) {
+    auto type = mlir::cast<mlir::MemRefType>(memref.getType());
+    if (type.getMemorySpace() || !type.getElementType().isIntOrFloat() ||
+        !op.isDefinedOutsideOfLoop(memref))
+      return;
+
+    for (auto &&[i, index] : llvm::enumerate(indices)) {
+      if (index != iv)
+        continue;
+
+      std::pair<mlir::Value, unsigned> access(memref, static_cast<unsigned>(i));
+      if (!llvm::is_contained(ret, access))
+        ret.emplace_back(access);
+
+      return;
+    }
+  };
+  op.getBody()->walk([&](mlir::Operation *nested) {
+    if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(nested)) {
+      visit(load.getMemRef(), load.getIndices());
+    } else if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(nested)) {
+      visit(store.getMemRef(), store.getIndices());
+    }
+  });
+  return ret;
+}
+
+namespace {
+/// Memory range, streamed by the loop, all sizes and strides are in bytes.
+struct StreamedRange {
+  /// Address of the first element.
+  mlir::Value ptr;
+
+  /// Stride of the streamed dim.
+  mlir::Value stride;
+
+  /// Stride and size of the dim, directly outside the streamed one, or 0 and
+  /// 1 if streamed dim is the outermost one.
+  mlir::Value rowStride;
+  mlir::Value numRows;
+
+  /// Sizes and strides of the remaining outer dims, prefetch is issued for
+  /// each of their elements.
+  llvm::SmallVector<std::pair<mlir::Value, mlir::Value>> outerDims;
+};
+
+struct StreamParallelLoopsPass
+    : public mlir::PassWrapper<StreamParallelLoopsPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(StreamParallelLoopsPass)
+
+  StreamParallelLoopsPass(int64_t size) : chunkSize(size) {}
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::func::FuncDialect>();
+    registry.insert<mlir::math::MathDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    if (chunkSize <= 0)
+      return markAllAnalysesPreserved();
+
+    auto mod = getOperation();
+    using Accesses = llvm::SmallVector<std::pair<mlir::Value, unsigned>>;
+    llvm::SmallVector<std::pair<mlir::scf::ParallelOp, Accesses>> loops;
+    mod.walk([&](mlir::scf::ParallelOp op) {
+      if (op->getParentOfType<mlir::scf::ParallelOp>() ||
+          !numba::isCPULoop(op))
+        return;
+
+      auto accesses = getStreamedAccesses(op);
+      if (!accesses.empty())
+        loops.emplace_back(op, std::move(accesses));
+    });
+
+    if (loops.empty())
+      return markAllAnalysesPreserved();
+
+    mlir::OpBuilder builder(&getContext());
+    auto indexType = builder.getIndexType();
+    auto prefetchFunc = [&]() {
+      llvm::StringRef name = "nmrtStreamPrefetch";
+      if (auto func = mod.lookupSymbol<mlir::func::FuncOp>(name))
+        return func;
+
+      // data, stride, begin, end, row stride, rows count
+      llvm::SmallVector<mlir::Type> args(6, indexType);
+      auto type = builder.getFunctionType(args, {});
+      return numba::addFunction(builder, mod, name, type);
+    }();
+
+    for (auto &&[op, accesses] : loops) {
+      auto loc = op.getLoc();
+      builder.setInsertionPoint(op);
+      auto createIndex = [&](int64_t val) -> mlir::Value {
+        return builder.create<mlir::arith::ConstantIndexOp>(loc, val);
+      };
+      auto mul = [&](mlir::Value lhs, mlir::Value rhs) -> mlir::Value {
+        return builder.createOrFold<mlir::arith::MulIOp>(loc, lhs, rhs);
+      };
+
+      llvm::SmallVector<StreamedRange> ranges;
+      mlir::Value rowBytes = createIndex(0);
+      for (auto &&[memref, dim] : accesses) {
+        auto type = mlir::cast<mlir::MemRefType>(memref.getType());
+        auto elemSize =
+            createIndex(llvm::divideCeil(type.getElementTypeBitWidth(), 8));
+        auto meta = builder.create<mlir::memref::ExtractStridedMetadataOp>(
+            loc, memref);
+        auto sizes = meta.getSizes();
+        auto strides = meta.getStrides();
+
+        StreamedRange range;
+        range.ptr =
+            builder.create<mlir::memref::ExtractAlignedPointerAsIndexOp>(
+                loc, memref);
+        range.ptr = builder.createOrFold<mlir::arith::AddIOp>(
+            loc, range.ptr, mul(meta.getOffset(), elemSize));
+        range.stride = mul(strides[dim], elemSize);
+        if (dim == 0) {
+          range.rowStride = createIndex(0);
+          range.numRows = createIndex(1);
+        } else {
+          range.rowStride = mul(strides[dim - 1], elemSize);
+          range.numRows = sizes[dim - 1];
+          for (auto i : llvm::seq(0u, dim - 1))
+            range.outerDims.emplace_back(sizes[i], mul(strides[i], elemSize));
+        }
+
+        // Single iteration of the loop touches one element for each row of
+        // the outer dims.
+        mlir::Value bytes =
+            builder.createOrFold<mlir::math::AbsIOp>(loc, range.stride);
+        for (auto i : llvm::seq(0u, dim))
+          bytes = mul(bytes, sizes[i]);
+
+        rowBytes =
+            builder.createOrFold<mlir::arith::AddIOp>(loc, rowBytes, bytes);
+        ranges.emplace_back(std::move(range));
+      }
+
+      auto one = createIndex(1);
+      rowBytes = builder.createOrFold<mlir::arith::MaxUIOp>(loc, rowBytes, one);
+      mlir::Value chunkIters = builder.createOrFold<mlir::arith::DivUIOp>(
+          loc, createIndex(chunkSize), rowBytes);
+      chunkIters =
+          builder.createOrFold<mlir::arith::MaxUIOp>(loc, chunkIters, one);
+
+      auto lower = op.getLowerBound().front();
+      auto upper = op.getUpperBound().front();
+      auto step = op.getStep().front();
+      auto chunkLen = mul(chunkIters, step);
+      auto zero = createIndex(0);
+
+      auto prefetchRange = [&](mlir::OpBuilder &b, mlir::Location l,
+                               const StreamedRange &range, mlir::Value begin,
+                               mlir::Value end) {
+        auto call = [&](mlir::OpBuilder &callB, mlir::Location callL,
+                        mlir::Value ptr) {
+          callB.create<mlir::func::CallOp>(
+              callL, prefetchFunc,
+              mlir::ValueRange{ptr, range.stride, begin, end, range.rowStride,
+                               range.numRows});
+        };
+
+        // Runtime handles the dim directly outside the streamed one, remaining
+        // outer dims are iterated here.
+        std::function<void(mlir::OpBuilder &, mlir::Location, unsigned,
+                           mlir::Value)>
+            genLoops = [&](mlir::OpBuilder &loopB, mlir::Location loopL,
+                           unsigned i, mlir::Value ptr) {
+              if (i == range.outerDims.size())
+                return call(loopB, loopL, ptr);
+
+              auto size = range.outerDims[i].first;
+              auto stride = range.outerDims[i].second;
+              auto bodyBuilder = [&](mlir::OpBuilder &bodyB,
+                                     mlir::Location bodyL, mlir::Value iv,
+                                     mlir::ValueRange) {
+                auto offset =
+                    bodyB.createOrFold<mlir::arith::MulIOp>(bodyL, iv, stride);
+                auto newPtr =
+                    bodyB.createOrFold<mlir::arith::AddIOp>(bodyL, ptr, offset);
+                genLoops(bodyB, bodyL, i + 1, newPtr);
+                bodyB.create<mlir::scf::YieldOp>(bodyL);
+              };
+              loopB.create<mlir::scf::ForOp>(loopL, zero, size, one,
+                                             std::nullopt, bodyBuilder);
+            };
+        genLoops(b, l, 0, range.ptr);
+      };
+
+      auto prefetch = [&](mlir::OpBuilder &b, mlir::Location l,
+                          mlir::Value begin) {
+        auto end = b.createOrFold<mlir::arith::AddIOp>(l, begin, chunkLen);
+        end = b.createOrFold<mlir::arith::MinSIOp>(l, end, upper);
+        for (auto &range : ranges)
+          prefetchRange(b, l, range, begin, end);
+      };
+      auto prefetchIf = [&](mlir::OpBuilder &b, mlir::Location l,
+                            mlir::Value begin, mlir::Value end) {
+        auto cond = b.create<mlir::arith::CmpIOp>(
+            l, mlir::arith::CmpIPredicate::slt, end, upper);
+        auto thenBuilder = [&](mlir::OpBuilder &thenB, mlir::Location thenL) {
+          prefetch(thenB, thenL, begin);
+          thenB.create<mlir::scf::YieldOp>(thenL);
+        };
+        b.create<mlir::scf::IfOp>(l, cond, thenBuilder);
+      };
+
+      // First chunk is only prefetched if there is more than one.
+      auto firstEnd =
+          builder.createOrFold<mlir::arith::AddIOp>(loc, lower, chunkLen);
+      prefetchIf(builder, loc, lower, firstEnd);
+
+      auto numLoops = static_cast<unsigned>(op.getNumLoops());
+      auto bodyBuilder = [&](mlir::OpBuilder &b, mlir::Location l,
+                             mlir::Value begin, mlir::ValueRange iterArgs) {
+        auto end = b.createOrFold<mlir::arith::AddIOp>(l, begin, chunkLen);
+        end = b.createOrFold<mlir::arith::MinSIOp>(l, end, upper);
+        prefetchIf(b, l, end, end);
+
+        auto chunk = mlir::cast<mlir::scf::ParallelOp>(b.clone(*op));
+        chunk->setOperand(0, begin);
+        chunk->setOperand(numLoops, end);
+        for (auto &&[i, arg] : llvm::enumerate(iterArgs))
+          chunk->setOperand(3 * numLoops + static_cast<unsigned>(i), arg);
+
+        b.create<mlir::scf::YieldOp>(l, chunk.getResults());
+      };
+      auto loop = builder.create<mlir::scf::ForOp>(
+          loc, lower, upper, chunkLen, op.getInitVals(), bodyBuilder);
+      op->replaceAllUsesWith(loop.getResults());
+      op->erase();
+    }
+  }
+
+private:
+  int64_t chunkSize = 0;
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass>
+numba::createStreamParallelLoopsPass(int64_t chunkSize) {
+  return std::make_unique<StreamParallelLoopsPass>(chunkSize);
+}
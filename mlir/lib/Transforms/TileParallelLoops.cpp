@@ -0,0 +1,158 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/TileParallelLoops.hpp"
+
+#include "numba/Transforms/LoopUtils.hpp"
+
+#include <mlir/Dialect/Affine/IR/AffineOps.h>
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/SCF/Transforms/Transforms.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/bit.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+/// Minimal and maximal tile size, in elements, for each tiled dimension.
+static constexpr unsigned MinTileSize = 8;
+static constexpr unsigned MaxTileSize = 128;
+
+static unsigned getElementBytes(mlir::Type type) {
+  if (mlir::isa<mlir::IndexType>(type))
+    return 8;
+
+  if (type.isIntOrFloat())
+    return std::max(type.getIntOrFloatBitWidth() / 8, 1u);
+
+  return 0;
+}
+
+/// Returns tile sizes for the loop or empty vector if the loop doesn't need
+/// tiling.
+static llvm::SmallVector<int64_t> getTileSizes(mlir::scf::ParallelOp loop,
+                                               unsigned cacheSize) {
+  auto numLoops = loop.getNumLoops();
+  if (numLoops < 2 || loop.getNumResults() != 0)
+    return {};
+
+  for (auto step : loop.getStep())
+    if (!mlir::isConstantIntValue(step, 1))
+      return {};
+
+  auto ivs = loop.getInductionVars();
+  auto innerIv = ivs.back();
+
+  // Check memory accesses strides: tiling is only needed if some access is
+  // not contiguous along the innermost loop dimension, e.g. `a[j, i]`, so
+  // successive iterations touch different cache lines.
+  bool strided = false;
+  bool unsupported = false;
+  unsigned elemBytes = 0;
+  llvm::SmallPtrSet<mlir::Value, 4> memrefs;
+  auto checkAccess = [&](mlir::Value memref, mlir::ValueRange indices) {
+    auto type = mlir::cast<mlir::MemRefType>(memref.getType());
+    auto bytes = getElementBytes(type.getElementType());
+    if (bytes == 0) {
+      unsupported = true;
+      return;
+    }
+    elemBytes = std::max(elemBytes, bytes);
+    memrefs.insert(memref);
+
+    if (indices.empty())
+      return;
+
+    auto it = llvm::find(indices, innerIv);
+    if (it != indices.end() && it != std::prev(indices.end()))
+      strided = true;
+  };
+
+  loop.getBody()->walk([&](mlir::Operation *op) {
+    if (mlir::isa<mlir::scf::ParallelOp>(op)) {
+      // Already nested parallel loops.
+      unsupported = true;
+    } else if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op)) {
+      checkAccess(load.getMemRef(), load.getIndices());
+    } else if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(op)) {
+      checkAccess(store.getMemRef(), store.getIndices());
+    }
+  });
+
+  if (unsupported || !strided || memrefs.empty())
+    return {};
+
+  // Square tile on two innermost dimensions, which fits all accessed arrays
+  // into cache.
+  auto elems = cacheSize / (elemBytes * memrefs.size());
+  auto tile = static_cast<unsigned>(std::sqrt(double(elems)));
+  tile = llvm::bit_floor(std::clamp(tile, MinTileSize, MaxTileSize));
+
+  // Do not tile loops, which already fit into the single tile.
+  auto fitsTile = [&](unsigned dim) {
+    auto lower = mlir::getConstantIntValue(loop.getLowerBound()[dim]);
+    auto upper = mlir::getConstantIntValue(loop.getUpperBound()[dim]);
+    return lower && upper && (*upper - *lower) <= int64_t(tile);
+  };
+  if (fitsTile(numLoops - 1) && fitsTile(numLoops - 2))
+    return {};
+
+  llvm::SmallVector<int64_t> ret(numLoops, 1);
+  ret[numLoops - 1] = tile;
+  ret[numLoops - 2] = tile;
+  return ret;
+}
+
+namespace {
+struct TileParallelLoopsPass
+    : public mlir::PassWrapper<TileParallelLoopsPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(TileParallelLoopsPass)
+
+  TileParallelLoopsPass(unsigned size) : cacheSize(size) {}
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::affine::AffineDialect>();
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    using TileSizes = llvm::SmallVector<int64_t>;
+    llvm::SmallVector<std::pair<mlir::scf::ParallelOp, TileSizes>> toTile;
+    getOperation()->walk([&](mlir::scf::ParallelOp loop) {
+      if (loop->getParentOfType<mlir::scf::ParallelOp>() ||
+          !numba::isCPULoop(loop))
+        return;
+
+      auto tileSizes = getTileSizes(loop, cacheSize);
+      if (tileSizes.empty())
+        return;
+
+      toTile.emplace_back(loop, std::move(tileSizes));
+    });
+
+    if (toTile.empty())
+      return markAllAnalysesPreserved();
+
+    for (auto &&[loop, tileSizes] : toTile)
+      mlir::scf::tileParallelLoop(loop, tileSizes, /*noMinMaxBounds*/ false);
+  }
+
+private:
+  unsigned cacheSize;
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass>
+numba::createTileParallelLoopsPass(unsigned cacheSize) {
+  return std::make_unique<TileParallelLoopsPass>(cacheSize);
+}
@@ -5,15 +5,29 @@
 #include "numba/Transforms/UpliftMath.hpp"
 
 #include "numba/Dialect/math_ext/IR/MathExt.hpp"
+#include "numba/Dialect/numba_util/Dialect.hpp"
 
 #include <mlir/Dialect/Arith/IR/Arith.h>
 #include <mlir/Dialect/Complex/IR/Complex.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
 #include <mlir/Dialect/Math/IR/Math.h>
+#include <mlir/IR/Matchers.h>
 #include <mlir/IR/PatternMatch.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
 #include <mlir/Pass/Pass.h>
 #include <mlir/Transforms/GreedyPatternRewriteDriver.h>
 
+#include <llvm/ADT/MapVector.h>
+
+#include <cmath>
+#include <optional>
+
+/// Max absolute integer exponent, expanded into the multiplication chain.
+static constexpr uint64_t MaxPowMulExponent = 16;
+
+/// Max polynomial degree, converted to the Horner form.
+static constexpr unsigned MaxHornerDegree = 16;
+
 template <typename Op>
 static mlir::Operation *replaceOp1(mlir::OpBuilder &builder, mlir::Location loc,
                                    mlir::ValueRange args) {
@@ -32,6 +46,89 @@ static mlir::Operation *replaceOp2(mlir::OpBuilder &builder, mlir::Location loc,
   return builder.create<Op>(loc, args[0], args[1]);
 }
 
+static mlir::Operation *replacePow(mlir::OpBuilder &builder, mlir::Location loc,
+                                  mlir::ValueRange args) {
+  if (args.size() != 2 || args[0].getType() != args[1].getType() ||
+      !mlir::isa<mlir::FloatType>(args[0].getType()))
+    return nullptr;
+
+  return builder.create<mlir::math::PowFOp>(loc, args[0], args[1]);
+}
+
+static mlir::Value createFloatConst(mlir::OpBuilder &builder,
+                                    mlir::Location loc, mlir::Type type,
+                                    double val) {
+  auto elemType =
+      mlir::cast<mlir::FloatType>(mlir::getElementTypeOrSelf(type));
+  mlir::TypedAttr attr = builder.getFloatAttr(elemType, val);
+  if (auto shaped = mlir::dyn_cast<mlir::ShapedType>(type))
+    attr = mlir::DenseElementsAttr::get(shaped, mlir::Attribute(attr));
+
+  return builder.create<mlir::arith::ConstantOp>(loc, attr);
+}
+
+/// Computes `val ** exp` by repeated squaring, `exp` must be positive.
+static mlir::Value
+createPowChain(llvm::function_ref<mlir::Value(mlir::Value, mlir::Value)> mul,
+               mlir::Value val, uint64_t exp) {
+  assert(exp > 0);
+  mlir::Value res;
+  while (true) {
+    if (exp & 1)
+      res = res ? mul(res, val) : val;
+
+    exp >>= 1;
+    if (exp == 0)
+      break;
+
+    val = mul(val, val);
+  }
+  return res;
+}
+
+/// Computes `val ** exp` for float `val` and integer `exp`, if `exp` is small
+/// enough.
+static mlir::Value createFloatPowChain(mlir::OpBuilder &builder,
+                                       mlir::Location loc, mlir::Value val,
+                                       int64_t exp,
+                                       mlir::arith::FastMathFlags fmf) {
+  uint64_t absExp = exp < 0 ? -static_cast<uint64_t>(exp) : exp;
+  if (absExp > MaxPowMulExponent)
+    return {};
+
+  auto type = val.getType();
+  if (absExp == 0)
+    return createFloatConst(builder, loc, type, 1.0);
+
+  auto mul = [&](mlir::Value lhs, mlir::Value rhs) -> mlir::Value {
+    return builder.create<mlir::arith::MulFOp>(loc, lhs, rhs, fmf);
+  };
+  auto res = createPowChain(mul, val, absExp);
+  if (exp < 0) {
+    auto one = createFloatConst(builder, loc, type, 1.0);
+    res = builder.create<mlir::arith::DivFOp>(loc, one, res, fmf);
+  }
+  return res;
+}
+
+static bool hasFlag(mlir::arith::FastMathFlags fmf,
+                    mlir::arith::FastMathFlags flag) {
+  return mlir::arith::bitEnumContainsAll(fmf, flag);
+}
+
+/// Ops don't have fastmath flags yet when uplifting is running, also check the
+/// parent function attribute.
+static mlir::arith::FastMathFlags getFastmathFlags(mlir::Operation *op) {
+  auto func = op->getParentOfType<mlir::FunctionOpInterface>();
+  if (func && func->hasAttr(numba::util::attributes::getFastmathName()))
+    return mlir::arith::FastMathFlags::fast;
+
+  if (auto fmi = mlir::dyn_cast<mlir::arith::ArithFastMathInterface>(op))
+    return fmi.getFastMathFlagsAttr().getValue();
+
+  return mlir::arith::FastMathFlags::none;
+}
+
 namespace {
 struct UpliftMathCalls : public mlir::OpRewritePattern<mlir::func::CallOp> {
   using OpRewritePattern::OpRewritePattern;
@@ -63,6 +160,8 @@ struct UpliftMathCalls : public mlir::OpRewritePattern<mlir::func::CallOp> {
         {"ceil", &replaceOp1<mlir::math::CeilOp>},
         {"log", &replaceOp1<mlir::math::LogOp>},
         {"sqrt", &replaceOp1<mlir::math::SqrtOp>},
+        {"cbrt", &replaceOp1<mlir::math::CbrtOp>},
+        {"pow", &replacePow},
         {"exp", &replaceOp1<mlir::math::ExpOp>},
         {"sin", &replaceOp1<mlir::math::SinOp>},
         {"cos", &replaceOp1<mlir::math::CosOp>},
@@ -247,6 +346,330 @@ struct UpliftMinMax : public mlir::OpRewritePattern<mlir::arith::SelectOp> {
   }
 };
 
+/// Replaces `powf` with constant exponent with cheaper ops. Without `afn` only
+/// exponents `-1`, `0`, `1` and `2` are expanded, as results are exactly the
+/// same. Under `afn` other integer exponents are expanded into multiplication
+/// chains, `0.5` and `-0.5` into `sqrt` and `rsqrt`, `1/3` into `cbrt`.
+struct PowFStrengthReduction
+    : public mlir::OpRewritePattern<mlir::math::PowFOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::math::PowFOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    llvm::APFloat expVal(0.0);
+    if (!mlir::matchPattern(op.getRhs(), mlir::m_ConstantFloat(&expVal)))
+      return mlir::failure();
+
+    auto origExpVal = expVal;
+    bool losesInfo = false;
+    expVal.convert(llvm::APFloat::IEEEdouble(),
+                   llvm::APFloat::rmNearestTiesToEven, &losesInfo);
+    double exp = expVal.convertToDouble();
+
+    auto loc = op.getLoc();
+    auto val = op.getLhs();
+    auto type = val.getType();
+    auto fmf = op.getFastmath();
+    auto allowedFmf = fmf | getFastmathFlags(op);
+    using FMF = mlir::arith::FastMathFlags;
+    bool afn = hasFlag(allowedFmf, FMF::afn);
+
+    // Longer chains accumulate rounding error, so results differ from libm.
+    bool exact = exp == -1.0 || exp == 0.0 || exp == 1.0 || exp == 2.0;
+    if (std::trunc(exp) == exp && std::abs(exp) <= MaxPowMulExponent &&
+        (exact || afn)) {
+      auto res = createFloatPowChain(rewriter, loc, val,
+                                     static_cast<int64_t>(exp), fmf);
+      assert(res);
+      rewriter.replaceOp(op, res);
+      return mlir::success();
+    }
+
+    auto guardNegInf = [&](mlir::Value res, double infResult) -> mlir::Value {
+      if (hasFlag(allowedFmf, FMF::ninf))
+        return res;
+
+      // pow(-inf, +-0.5) is +inf/0, but sqrt(-inf) is nan.
+      auto negInf = createFloatConst(rewriter, loc, type, -INFINITY);
+      mlir::Value isNegInf = rewriter.create<mlir::arith::CmpFOp>(
+          loc, mlir::arith::CmpFPredicate::OEQ, val, negInf);
+      auto infRes = createFloatConst(rewriter, loc, type, infResult);
+      return rewriter.create<mlir::arith::SelectOp>(loc, isNegInf, infRes,
+                                                    res);
+    };
+
+    if (!afn)
+      return mlir::failure();
+
+    if (exp == 0.5 || exp == -0.5) {
+      bool recip = exp < 0;
+      mlir::Value res;
+      if (recip) {
+        res = rewriter.create<mlir::math::RsqrtOp>(loc, val, fmf);
+      } else {
+        res = rewriter.create<mlir::math::SqrtOp>(loc, val, fmf);
+      }
+
+      // pow(-0.0, 0.5) is +0.0, but sqrt(-0.0) is -0.0.
+      if (!hasFlag(allowedFmf, FMF::nsz))
+        res = rewriter.create<mlir::math::AbsFOp>(loc, res, fmf);
+
+      rewriter.replaceOp(op, guardNegInf(res, recip ? 0.0 : INFINITY));
+      return mlir::success();
+    }
+
+    llvm::APFloat third(1.0 / 3.0);
+    third.convert(origExpVal.getSemantics(), llvm::APFloat::rmNearestTiesToEven,
+                  &losesInfo);
+    if (origExpVal.bitwiseIsEqual(third)) {
+      // pow of negative value is nan, but cbrt is not.
+      mlir::Value res = rewriter.create<mlir::math::CbrtOp>(loc, val, fmf);
+      if (!hasFlag(allowedFmf, FMF::nnan)) {
+        auto zero = createFloatConst(rewriter, loc, type, 0.0);
+        mlir::Value isNeg = rewriter.create<mlir::arith::CmpFOp>(
+            loc, mlir::arith::CmpFPredicate::OLT, val, zero);
+        auto nan = createFloatConst(rewriter, loc, type, NAN);
+        res = rewriter.create<mlir::arith::SelectOp>(loc, isNeg, nan, res);
+      }
+      rewriter.replaceOp(op, res);
+      return mlir::success();
+    }
+
+    return mlir::failure();
+  }
+};
+
+/// Expands `fpowi` with small constant exponent into multiplication chain.
+struct FPowIStrengthReduction
+    : public mlir::OpRewritePattern<mlir::math::FPowIOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::math::FPowIOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    llvm::APInt exp;
+    if (!mlir::matchPattern(op.getRhs(), mlir::m_ConstantInt(&exp)) ||
+        exp.getSignificantBits() > 64)
+      return mlir::failure();
+
+    auto res = createFloatPowChain(rewriter, op.getLoc(), op.getLhs(),
+                                   exp.getSExtValue(), op.getFastmath());
+    if (!res)
+      return mlir::failure();
+
+    rewriter.replaceOp(op, res);
+    return mlir::success();
+  }
+};
+
+/// Expands `ipowi` with small non-negative constant exponent into
+/// multiplication chain.
+struct IPowIStrengthReduction
+    : public mlir::OpRewritePattern<mlir::math::IPowIOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::math::IPowIOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    llvm::APInt exp;
+    if (!mlir::matchPattern(op.getRhs(), mlir::m_ConstantInt(&exp)) ||
+        exp.isNegative() || exp.ugt(MaxPowMulExponent))
+      return mlir::failure();
+
+    auto loc = op.getLoc();
+    auto val = op.getLhs();
+    auto absExp = exp.getZExtValue();
+    if (absExp == 0) {
+      auto one = rewriter.getOneAttr(val.getType());
+      rewriter.replaceOpWithNewOp<mlir::arith::ConstantOp>(
+          op, mlir::cast<mlir::TypedAttr>(one));
+      return mlir::success();
+    }
+
+    auto mul = [&](mlir::Value lhs, mlir::Value rhs) -> mlir::Value {
+      return rewriter.create<mlir::arith::MulIOp>(loc, lhs, rhs);
+    };
+    rewriter.replaceOp(op, createPowChain(mul, val, absExp));
+    return mlir::success();
+  }
+};
+
+/// Polynomial term `sign * prod(coeffs) * x ** degree`.
+struct PolyTerm {
+  bool negative = false;
+  unsigned degree = 0;
+  llvm::SmallVector<mlir::Value> coeffs;
+};
+
+/// Values, which cannot depend on the polynomial variable: constants and values
+/// defined outside of current block.
+static bool isPolyCoeff(mlir::Value val, mlir::Block *block) {
+  if (mlir::matchPattern(val, mlir::m_Constant()))
+    return true;
+
+  return val.getParentBlock() != block;
+}
+
+/// Splits `val` into the coefficient factors and the power of variable `x`.
+/// Updates `x` if it wasn't set yet. Returns number of multiplications.
+static std::optional<unsigned> collectPolyFactors(mlir::Value val,
+                                                  mlir::Block *block,
+                                                  mlir::Value &x,
+                                                  PolyTerm &term) {
+  if (auto mul = val.getDefiningOp<mlir::arith::MulFOp>()) {
+    auto lhs = collectPolyFactors(mul.getLhs(), block, x, term);
+    if (!lhs)
+      return std::nullopt;
+
+    auto rhs = collectPolyFactors(mul.getRhs(), block, x, term);
+    if (!rhs)
+      return std::nullopt;
+
+    return *lhs + *rhs + 1;
+  }
+
+  if (auto neg = val.getDefiningOp<mlir::arith::NegFOp>()) {
+    term.negative = !term.negative;
+    return collectPolyFactors(neg.getOperand(), block, x, term);
+  }
+
+  if (val != x && isPolyCoeff(val, block)) {
+    term.coeffs.emplace_back(val);
+    return 0;
+  }
+
+  if (!x)
+    x = val;
+
+  if (val != x)
+    return std::nullopt;
+
+  ++term.degree;
+  return 0;
+}
+
+/// Collects terms of the sum, intermediate sums must have single use.
+/// Returns number of multiplications.
+static std::optional<unsigned>
+collectPolyTerms(mlir::Value val, bool negative, bool root, mlir::Block *block,
+                 mlir::Value &x, llvm::SmallVectorImpl<PolyTerm> &terms) {
+  auto def = val.getDefiningOp();
+  if (def && (root || val.hasOneUse()) &&
+      mlir::isa<mlir::arith::AddFOp, mlir::arith::SubFOp>(def)) {
+    auto lhs = collectPolyTerms(def->getOperand(0), negative, false, block, x,
+                                terms);
+    if (!lhs)
+      return std::nullopt;
+
+    bool rhsNegative = negative != mlir::isa<mlir::arith::SubFOp>(def);
+    auto rhs = collectPolyTerms(def->getOperand(1), rhsNegative, false, block,
+                                x, terms);
+    if (!rhs)
+      return std::nullopt;
+
+    return *lhs + *rhs;
+  }
+
+  PolyTerm term;
+  term.negative = negative;
+  auto muls = collectPolyFactors(val, block, x, term);
+  if (!muls)
+    return std::nullopt;
+
+  terms.emplace_back(std::move(term));
+  return muls;
+}
+
+/// Rewrites polynomial sum of monomials of the single variable
+/// `c0 + c1 * x + c2 * x * x + ...` into the Horner form
+/// `c0 + x * (c1 + x * (c2 + ...))`. Reassociation changes rounding, so it's
+/// only done under `reassoc`.
+struct HornerForm : public mlir::OpRewritePattern<mlir::arith::AddFOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::arith::AddFOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    using FMF = mlir::arith::FastMathFlags;
+    if (!hasFlag(op.getFastmath() | getFastmathFlags(op), FMF::reassoc))
+      return mlir::failure();
+
+    // Only start from the root of the sum.
+    if (op->hasOneUse() &&
+        mlir::isa<mlir::arith::AddFOp, mlir::arith::SubFOp>(
+            *op->user_begin()))
+      return mlir::failure();
+
+    mlir::Value x;
+    llvm::SmallVector<PolyTerm> terms;
+    auto origMuls = collectPolyTerms(op.getResult(), false, true,
+                                     op->getBlock(), x, terms);
+    if (!origMuls || !x)
+      return mlir::failure();
+
+    // Group coefficients by degree.
+    llvm::SmallMapVector<unsigned, llvm::SmallVector<PolyTerm *>, 4> degrees;
+    unsigned maxDegree = 0;
+    unsigned coeffMuls = 0;
+    for (auto &term : terms) {
+      degrees[term.degree].emplace_back(&term);
+      maxDegree = std::max(maxDegree, term.degree);
+      if (!term.coeffs.empty())
+        coeffMuls += term.coeffs.size() - 1;
+    }
+
+    if (maxDegree < 2 || maxDegree > MaxHornerDegree || degrees.size() < 2)
+      return mlir::failure();
+
+    // Horner form needs `maxDegree` multiplications by `x`.
+    if (maxDegree + coeffMuls >= *origMuls)
+      return mlir::failure();
+
+    auto loc = op.getLoc();
+    auto fmf = op.getFastmath();
+    auto type = op.getType();
+    auto getCoeff = [&](unsigned degree) -> mlir::Value {
+      auto it = degrees.find(degree);
+      if (it == degrees.end())
+        return {};
+
+      mlir::Value res;
+      for (auto term : it->second) {
+        mlir::Value val;
+        for (auto coeff : term->coeffs)
+          val = val ? rewriter.create<mlir::arith::MulFOp>(loc, val, coeff, fmf)
+                    : coeff;
+
+        if (!val)
+          val = createFloatConst(rewriter, loc, type, 1.0);
+
+        if (!res) {
+          res = term->negative
+                    ? rewriter.create<mlir::arith::NegFOp>(loc, val, fmf)
+                    : val;
+        } else if (term->negative) {
+          res = rewriter.create<mlir::arith::SubFOp>(loc, res, val, fmf);
+        } else {
+          res = rewriter.create<mlir::arith::AddFOp>(loc, res, val, fmf);
+        }
+      }
+      return res;
+    };
+
+    mlir::Value res = getCoeff(maxDegree);
+    assert(res);
+    for (unsigned degree = maxDegree; degree-- > 0;) {
+      res = rewriter.create<mlir::arith::MulFOp>(loc, res, x, fmf);
+      if (auto coeff = getCoeff(degree))
+        res = rewriter.create<mlir::arith::AddFOp>(loc, res, coeff, fmf);
+    }
+
+    rewriter.replaceOp(op, res);
+    return mlir::success();
+  }
+};
+
 struct UpliftMathPass
     : public mlir::PassWrapper<UpliftMathPass, mlir::OperationPass<>> {
   MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(UpliftMathPass)
@@ -272,7 +695,9 @@ struct UpliftMathPass
 
 void numba::populateUpliftMathPatterns(mlir::RewritePatternSet &patterns) {
   patterns.insert<UpliftMathCalls, UpliftFabsCalls, UpliftCabsCalls,
-                  UpliftMinMax, UpliftComplexCalls>(patterns.getContext());
+                  UpliftMinMax, UpliftComplexCalls, PowFStrengthReduction,
+                  FPowIStrengthReduction, IPowIStrengthReduction, HornerForm>(
+      patterns.getContext());
 }
 
 std::unique_ptr<mlir::Pass> numba::createUpliftMathPass() {
@@ -0,0 +1,276 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/VersionAliasingLoops.hpp"
+
+#include "numba/Dialect/numba_util/Dialect.hpp"
+#include "numba/Transforms/LoopUtils.hpp"
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/IR/IRMapping.h>
+#include <mlir/Interfaces/DataLayoutInterfaces.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
+#include <mlir/Interfaces/SideEffectInterfaces.h>
+#include <mlir/Interfaces/ViewLikeInterface.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/SetVector.h>
+
+/// Max number of memref pairs checked by the single loop version guard.
+static constexpr unsigned MaxCheckedPairs = 8;
+
+/// Returns function argument, memref is the view of, or null.
+static mlir::Value getRootArg(mlir::Value memref) {
+  while (auto view = memref.getDefiningOp<mlir::ViewLikeOpInterface>())
+    memref = view.getViewSource();
+
+  auto arg = mlir::dyn_cast<mlir::BlockArgument>(memref);
+  if (!arg || !arg.getOwner()->isEntryBlock() ||
+      !mlir::isa<mlir::FunctionOpInterface>(arg.getOwner()->getParentOp()))
+    return {};
+
+  return arg;
+}
+
+static bool isDefinedInside(mlir::Operation *op, mlir::Value val) {
+  return op->isAncestor(val.getParentRegion()->getParentOp());
+}
+
+/// Memrefs, defined outside the loop and accessed from the loop body, directly
+/// or through the views, created inside the loop.
+struct LoopAccesses {
+  llvm::SmallSetVector<mlir::Value, 4> read;
+  llvm::SmallSetVector<mlir::Value, 4> written;
+};
+
+static std::optional<LoopAccesses> getAccesses(mlir::scf::ParallelOp loop) {
+  LoopAccesses ret;
+  auto res = loop.getBody()->walk([&](mlir::Operation *op) {
+    if (op->hasTrait<mlir::OpTrait::HasRecursiveMemoryEffects>() ||
+        mlir::isMemoryEffectFree(op))
+      return mlir::WalkResult::advance();
+
+    mlir::Value memref;
+    bool isWrite = false;
+    if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op)) {
+      memref = load.getMemRef();
+    } else if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(op)) {
+      memref = store.getMemRef();
+      isWrite = true;
+    } else if (mlir::isa<mlir::memref::AllocOp, mlir::memref::AllocaOp,
+                         mlir::memref::DeallocOp>(op)) {
+      return mlir::WalkResult::advance();
+    } else {
+      // Unknown memory access.
+      return mlir::WalkResult::interrupt();
+    }
+
+    while (isDefinedInside(loop, memref)) {
+      auto defOp = memref.getDefiningOp();
+      if (mlir::isa_and_nonnull<mlir::memref::AllocOp, mlir::memref::AllocaOp>(
+              defOp))
+        return mlir::WalkResult::advance();
+
+      auto view = mlir::dyn_cast_or_null<mlir::ViewLikeOpInterface>(defOp);
+      if (!view)
+        return mlir::WalkResult::interrupt();
+
+      memref = view.getViewSource();
+    }
+
+    (isWrite ? ret.written : ret.read).insert(memref);
+    return mlir::WalkResult::advance();
+  });
+  if (res.wasInterrupted())
+    return std::nullopt;
+
+  return ret;
+}
+
+using MemrefPair = std::pair<mlir::Value, mlir::Value>;
+
+/// Returns pairs of memrefs, which are views of the different function
+/// arguments and at least one of them is written. Views of the same argument
+/// and local allocations are assumed not to require the check.
+static llvm::SmallVector<MemrefPair>
+getCheckedPairs(const LoopAccesses &accesses) {
+  llvm::SmallVector<MemrefPair> ret;
+  auto addPair = [&](mlir::Value lhs, mlir::Value rhs) {
+    auto lhsRoot = getRootArg(lhs);
+    auto rhsRoot = getRootArg(rhs);
+    if (!lhsRoot || !rhsRoot || lhsRoot == rhsRoot)
+      return;
+
+    ret.emplace_back(lhs, rhs);
+  };
+
+  auto written = accesses.written.getArrayRef();
+  for (auto &&[i, lhs] : llvm::enumerate(written)) {
+    for (auto rhs : written.drop_front(i + 1))
+      addPair(lhs, rhs);
+
+    for (auto rhs : accesses.read)
+      if (!accesses.written.contains(rhs))
+        addPair(lhs, rhs);
+  }
+  return ret;
+}
+
+static bool canComputeExtent(mlir::Value memref) {
+  auto type = mlir::cast<mlir::MemRefType>(memref.getType());
+  if (!type.getElementType().isIntOrIndexOrFloat())
+    return false;
+
+  llvm::SmallVector<int64_t> strides;
+  int64_t offset;
+  return mlir::succeeded(mlir::getStridesAndOffset(type, strides, offset));
+}
+
+/// Returns `[begin, end)` addresses range, covering all memref elements.
+/// Strides can be negative, empty memrefs get a conservative single element
+/// range.
+static MemrefPair getExtent(mlir::OpBuilder &builder, mlir::Location loc,
+                            mlir::Value memref, const mlir::DataLayout &dl) {
+  auto type = mlir::cast<mlir::MemRefType>(memref.getType());
+  auto meta =
+      builder.create<mlir::memref::ExtractStridedMetadataOp>(loc, memref);
+  mlir::Value zero = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  mlir::Value one = builder.create<mlir::arith::ConstantIndexOp>(loc, 1);
+
+  mlir::Value lo = meta.getOffset();
+  mlir::Value hi = lo;
+  for (auto &&[size, stride] : llvm::zip(meta.getSizes(), meta.getStrides())) {
+    mlir::Value last = builder.create<mlir::arith::SubIOp>(loc, size, one);
+    mlir::Value span = builder.create<mlir::arith::MulIOp>(loc, last, stride);
+    lo = builder.create<mlir::arith::AddIOp>(
+        loc, lo, builder.create<mlir::arith::MinSIOp>(loc, span, zero));
+    hi = builder.create<mlir::arith::AddIOp>(
+        loc, hi, builder.create<mlir::arith::MaxSIOp>(loc, span, zero));
+  }
+  hi = builder.create<mlir::arith::AddIOp>(loc, hi, one);
+
+  auto size = static_cast<int64_t>(dl.getTypeSize(type.getElementType()));
+  mlir::Value elemSize =
+      builder.create<mlir::arith::ConstantIndexOp>(loc, size);
+  mlir::Value base =
+      builder.create<mlir::memref::ExtractAlignedPointerAsIndexOp>(loc,
+                                                                    memref);
+  auto toAddr = [&](mlir::Value idx) -> mlir::Value {
+    mlir::Value bytes =
+        builder.create<mlir::arith::MulIOp>(loc, idx, elemSize);
+    return builder.create<mlir::arith::AddIOp>(loc, base, bytes);
+  };
+  return {toAddr(lo), toAddr(hi)};
+}
+
+static void versionLoop(mlir::scf::ParallelOp loop,
+                        llvm::ArrayRef<MemrefPair> pairs,
+                        const mlir::DataLayout &dl) {
+  mlir::OpBuilder builder(loop);
+  auto loc = loop.getLoc();
+
+  llvm::SmallDenseMap<mlir::Value, MemrefPair> extents;
+  auto getCachedExtent = [&](mlir::Value memref) {
+    auto it = extents.find(memref);
+    if (it != extents.end())
+      return it->second;
+
+    auto extent = getExtent(builder, loc, memref, dl);
+    extents.try_emplace(memref, extent);
+    return extent;
+  };
+
+  mlir::Value cond;
+  for (auto &&[lhs, rhs] : pairs) {
+    auto [lhsBegin, lhsEnd] = getCachedExtent(lhs);
+    auto [rhsBegin, rhsEnd] = getCachedExtent(rhs);
+    using Pred = mlir::arith::CmpIPredicate;
+    mlir::Value before =
+        builder.create<mlir::arith::CmpIOp>(loc, Pred::ule, lhsEnd, rhsBegin);
+    mlir::Value after =
+        builder.create<mlir::arith::CmpIOp>(loc, Pred::ule, rhsEnd, lhsBegin);
+    mlir::Value disjoint =
+        builder.create<mlir::arith::OrIOp>(loc, before, after);
+    if (cond)
+      disjoint = builder.create<mlir::arith::AndIOp>(loc, cond, disjoint);
+
+    cond = disjoint;
+  }
+
+  auto thenBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+    b.clone(*loop);
+    b.create<mlir::scf::YieldOp>(l);
+  };
+
+  auto elseBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+    mlir::IRMapping mapping;
+    mlir::scf::buildLoopNest(
+        b, l, loop.getLowerBound(), loop.getUpperBound(), loop.getStep(),
+        [&](mlir::OpBuilder &nested, mlir::Location, mlir::ValueRange ivs) {
+          mapping.map(loop.getInductionVars(), ivs);
+          for (auto &op : loop.getBody()->without_terminator())
+            nested.clone(op, mapping);
+        });
+    b.create<mlir::scf::YieldOp>(l);
+  };
+
+  builder.create<mlir::scf::IfOp>(loc, cond, thenBuilder, elseBuilder);
+  loop->erase();
+}
+
+namespace {
+struct VersionAliasingLoopsPass
+    : public mlir::PassWrapper<VersionAliasingLoopsPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(VersionAliasingLoopsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    using Pairs = llvm::SmallVector<MemrefPair>;
+    llvm::SmallVector<std::pair<mlir::scf::ParallelOp, Pairs>> toVersion;
+    getOperation()->walk([&](mlir::scf::ParallelOp loop) {
+      // Serial fallback doesn't support reductions. Numba parfor pass already
+      // ruled out races between iterations of parfor loops.
+      if (loop->getParentOfType<mlir::scf::ParallelOp>() ||
+          !numba::isCPULoop(loop) || loop.getNumResults() != 0 ||
+          loop->hasAttr(numba::util::attributes::getParforLoweredName()))
+        return;
+
+      auto accesses = getAccesses(loop);
+      if (!accesses)
+        return;
+
+      auto pairs = getCheckedPairs(*accesses);
+      if (pairs.empty() || pairs.size() > MaxCheckedPairs)
+        return;
+
+      if (!llvm::all_of(pairs, [](auto &&pair) {
+            return canComputeExtent(pair.first) &&
+                   canComputeExtent(pair.second);
+          }))
+        return;
+
+      toVersion.emplace_back(loop, std::move(pairs));
+    });
+
+    if (toVersion.empty())
+      return markAllAnalysesPreserved();
+
+    for (auto &&[loop, pairs] : toVersion)
+      versionLoop(loop, pairs, mlir::DataLayout::closest(loop));
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> numba::createVersionAliasingLoopsPass() {
+  return std::make_unique<VersionAliasingLoopsPass>();
+}
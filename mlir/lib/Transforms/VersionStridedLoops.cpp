@@ -0,0 +1,190 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include "numba/Transforms/VersionStridedLoops.hpp"
+
+#include "numba/Transforms/LoopUtils.hpp"
+
+#include <mlir/Dialect/Arith/IR/Arith.h>
+#include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Pass/Pass.h>
+
+#include <llvm/ADT/SetVector.h>
+
+/// Max number of memrefs checked by the single loop version guard.
+static constexpr unsigned MaxVersionedMemrefs = 8;
+
+static bool hasDynamicInnerStride(mlir::MemRefType type) {
+  if (type.getRank() == 0)
+    return false;
+
+  llvm::SmallVector<int64_t> strides;
+  int64_t offset;
+  if (mlir::failed(mlir::getStridesAndOffset(type, strides, offset)))
+    return false;
+
+  return mlir::ShapedType::isDynamic(strides.back());
+}
+
+static mlir::Value getMemref(mlir::Operation *op) {
+  if (auto load = mlir::dyn_cast<mlir::memref::LoadOp>(op))
+    return load.getMemRef();
+
+  if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(op))
+    return store.getMemRef();
+
+  return {};
+}
+
+/// Collects memrefs, defined outside the loop and accessed from the loop body
+/// with dynamic innermost stride.
+static llvm::SmallSetVector<mlir::Value, 4>
+getStridedMemrefs(mlir::scf::ParallelOp loop) {
+  llvm::SmallSetVector<mlir::Value, 4> ret;
+  loop.getBody()->walk([&](mlir::Operation *op) {
+    auto memref = getMemref(op);
+    if (!memref || loop->isAncestor(memref.getParentRegion()->getParentOp()))
+      return;
+
+    if (hasDynamicInnerStride(mlir::cast<mlir::MemRefType>(memref.getType())))
+      ret.insert(memref);
+  });
+  return ret;
+}
+
+/// Returns memref type with the same shape and layout, except the unit
+/// innermost stride.
+static mlir::MemRefType getContiguousType(mlir::MemRefType type) {
+  llvm::SmallVector<int64_t> strides;
+  int64_t offset;
+  auto res = mlir::getStridesAndOffset(type, strides, offset);
+  assert(mlir::succeeded(res) && "Invalid strides");
+  (void)res;
+  strides.back() = 1;
+  auto layout =
+      mlir::StridedLayoutAttr::get(type.getContext(), offset, strides);
+  return mlir::MemRefType::get(type.getShape(), type.getElementType(), layout,
+                               type.getMemorySpace());
+}
+
+static mlir::OpFoldResult getMixed(mlir::OpBuilder &builder, int64_t val,
+                                   mlir::Value dyn) {
+  if (mlir::ShapedType::isDynamic(val))
+    return dyn;
+
+  return builder.getIndexAttr(val);
+}
+
+static void versionLoop(mlir::scf::ParallelOp loop,
+                        llvm::ArrayRef<mlir::Value> memrefs) {
+  mlir::OpBuilder builder(loop);
+  auto loc = loop.getLoc();
+  mlir::Value one = builder.create<mlir::arith::ConstantIndexOp>(loc, 1);
+
+  mlir::Value cond;
+  llvm::SmallVector<mlir::memref::ExtractStridedMetadataOp> metadata;
+  for (auto memref : memrefs) {
+    auto meta =
+        builder.create<mlir::memref::ExtractStridedMetadataOp>(loc, memref);
+    mlir::Value isUnit = builder.create<mlir::arith::CmpIOp>(
+        loc, mlir::arith::CmpIPredicate::eq, meta.getStrides().back(), one);
+    if (cond)
+      isUnit = builder.create<mlir::arith::AndIOp>(loc, cond, isUnit);
+
+    cond = isUnit;
+    metadata.emplace_back(meta);
+  }
+
+  auto thenBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+    llvm::SmallDenseMap<mlir::Value, mlir::Value> casted;
+    for (auto &&[memref, meta] : llvm::zip(memrefs, metadata)) {
+      auto srcType = mlir::cast<mlir::MemRefType>(memref.getType());
+      auto dstType = getContiguousType(srcType);
+
+      llvm::SmallVector<int64_t> strides;
+      int64_t offset;
+      (void)mlir::getStridesAndOffset(dstType, strides, offset);
+
+      llvm::SmallVector<mlir::OpFoldResult> sizes;
+      llvm::SmallVector<mlir::OpFoldResult> mixedStrides;
+      for (auto i : llvm::seq<int64_t>(0, srcType.getRank())) {
+        sizes.emplace_back(
+            getMixed(b, srcType.getDimSize(i), meta.getSizes()[i]));
+        mixedStrides.emplace_back(
+            getMixed(b, strides[i], meta.getStrides()[i]));
+      }
+      auto mixedOffset = getMixed(b, offset, meta.getOffset());
+      mlir::Value cast = b.create<mlir::memref::ReinterpretCastOp>(
+          l, dstType, memref, mixedOffset, sizes, mixedStrides);
+      casted.try_emplace(memref, cast);
+    }
+
+    auto fast = mlir::cast<mlir::scf::ParallelOp>(b.clone(*loop));
+    fast.getBody()->walk([&](mlir::Operation *op) {
+      if (!getMemref(op))
+        return;
+
+      // Only replace load/store memrefs, other users may rely on the original
+      // type.
+      for (auto &operand : op->getOpOperands()) {
+        auto it = casted.find(operand.get());
+        if (it != casted.end())
+          operand.set(it->second);
+      }
+    });
+    b.create<mlir::scf::YieldOp>(l, fast.getResults());
+  };
+
+  auto elseBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+    auto slow = mlir::cast<mlir::scf::ParallelOp>(b.clone(*loop));
+    b.create<mlir::scf::YieldOp>(l, slow.getResults());
+  };
+
+  auto ifOp = builder.create<mlir::scf::IfOp>(loc, cond, thenBuilder,
+                                              elseBuilder);
+  loop->replaceAllUsesWith(ifOp.getResults());
+  loop->erase();
+}
+
+namespace {
+struct VersionStridedLoopsPass
+    : public mlir::PassWrapper<VersionStridedLoopsPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(VersionStridedLoopsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    using Memrefs = llvm::SmallVector<mlir::Value>;
+    llvm::SmallVector<std::pair<mlir::scf::ParallelOp, Memrefs>> toVersion;
+    getOperation()->walk([&](mlir::scf::ParallelOp loop) {
+      if (loop->getParentOfType<mlir::scf::ParallelOp>() ||
+          !numba::isCPULoop(loop))
+        return;
+
+      auto memrefs = getStridedMemrefs(loop);
+      if (memrefs.empty() || memrefs.size() > MaxVersionedMemrefs)
+        return;
+
+      toVersion.emplace_back(loop, memrefs.takeVector());
+    });
+
+    if (toVersion.empty())
+      return markAllAnalysesPreserved();
+
+    for (auto &&[loop, memrefs] : toVersion)
+      versionLoop(loop, memrefs);
+  }
+};
+} // namespace
+
+std::unique_ptr<mlir::Pass> numba::createVersionStridedLoopsPass() {
+  return std::make_unique<VersionStridedLoopsPass>();
+}
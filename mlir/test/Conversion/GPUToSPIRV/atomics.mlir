@@ -0,0 +1,83 @@
+// RUN: numba-mlir-opt -allow-unregistered-dialect --gpux-to-spirv -split-input-file %s | FileCheck %s
+
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int64, Kernel], []>, #spirv.resource_limits<>>} {
+  gpu.module @kernels {
+    // CHECK-LABEL: spirv.func @atomic_int
+    //       CHECK: spirv.AtomicSMax <Device> <SequentiallyConsistent>
+    //       CHECK: spirv.AtomicUMin <Device> <SequentiallyConsistent>
+    //       CHECK: spirv.AtomicAnd <Device> <SequentiallyConsistent>
+    //       CHECK: spirv.AtomicOr <Device> <SequentiallyConsistent>
+    //       CHECK: spirv.AtomicExchange <Device> <SequentiallyConsistent>
+    gpu.func @atomic_int(%arg0: memref<i32>, %arg1: i32) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = memref.atomic_rmw maxs %arg1, %arg0[] : (i32, memref<i32>) -> i32
+      %1 = memref.atomic_rmw minu %arg1, %arg0[] : (i32, memref<i32>) -> i32
+      %2 = memref.atomic_rmw andi %arg1, %arg0[] : (i32, memref<i32>) -> i32
+      %3 = memref.atomic_rmw ori %arg1, %arg0[] : (i32, memref<i32>) -> i32
+      %4 = memref.atomic_rmw assign %arg1, %arg0[] : (i32, memref<i32>) -> i32
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int64, Kernel], []>, #spirv.resource_limits<>>} {
+  gpu.module @kernels {
+    // CHECK-LABEL: spirv.func @atomic_cas
+    //  CHECK-SAME: (%[[ARG0:.*]]: !spirv.ptr<i32, CrossWorkgroup>, %[[ARG1:.*]]: i32, %[[ARG2:.*]]: i32)
+    //       CHECK: spirv.AtomicCompareExchange <Device> <SequentiallyConsistent> <SequentiallyConsistent> %[[ARG0]], %[[ARG2]], %[[ARG1]]
+    //   CHECK-NOT: spirv.mlir.loop
+    gpu.func @atomic_cas(%arg0: memref<i32>, %arg1: i32, %arg2: i32) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = memref.generic_atomic_rmw %arg0[] : memref<i32> {
+      ^bb0(%current: i32):
+        %eq = arith.cmpi eq, %current, %arg1 : i32
+        %res = arith.select %eq, %arg2, %current : i32
+        memref.atomic_yield %res : i32
+      }
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+// No float min/max atomics and no float add capability, lowered to CAS loops.
+
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int64, Kernel], []>, #spirv.resource_limits<>>} {
+  gpu.module @kernels {
+    // CHECK-LABEL: spirv.func @atomic_float
+    //       CHECK: spirv.mlir.loop
+    //       CHECK: spirv.AtomicCompareExchange <Device> <SequentiallyConsistent> <SequentiallyConsistent>
+    //       CHECK: spirv.mlir.loop
+    //       CHECK: spirv.FAdd
+    //       CHECK: spirv.AtomicCompareExchange <Device> <SequentiallyConsistent> <SequentiallyConsistent>
+    //   CHECK-NOT: spirv.EXT.AtomicFAdd
+    gpu.func @atomic_float(%arg0: memref<f32>, %arg1: f32) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = memref.generic_atomic_rmw %arg0[] : memref<f32> {
+      ^bb0(%current: f32):
+        %res = arith.maximumf %current, %arg1 : f32
+        memref.atomic_yield %res : f32
+      }
+      %1 = memref.atomic_rmw addf %arg1, %arg0[] : (f32, memref<f32>) -> f32
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int64, Kernel, AtomicFloat32AddEXT], [SPV_EXT_shader_atomic_float_add]>, #spirv.resource_limits<>>} {
+  gpu.module @kernels {
+    // CHECK-LABEL: spirv.func @atomic_float_add
+    //       CHECK: spirv.EXT.AtomicFAdd <Device> <SequentiallyConsistent>
+    //   CHECK-NOT: spirv.mlir.loop
+    gpu.func @atomic_float_add(%arg0: memref<f32>, %arg1: f32) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = memref.atomic_rmw addf %arg1, %arg0[] : (f32, memref<f32>) -> f32
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,39 @@
+// RUN: numba-mlir-opt -allow-unregistered-dialect --gpux-to-spirv -split-input-file %s | FileCheck %s
+
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int64, Kernel], []>, #spirv.resource_limits<>>} {
+  // CHECK-LABEL: spirv.module @{{.*}}
+  //       CHECK: spirv.func @packed
+  //  CHECK-SAME: (%[[ARG:.*]]: !spirv.ptr<!spirv.struct<(!spirv.ptr<f32, CrossWorkgroup>, !spirv.ptr<f32, CrossWorkgroup>, i64)>, CrossWorkgroup>)
+  //   CHECK-DAG: %[[C0:.*]] = spirv.Constant 0 : i32
+  //   CHECK-DAG: %[[C1:.*]] = spirv.Constant 1 : i32
+  //   CHECK-DAG: %[[C2:.*]] = spirv.Constant 2 : i32
+  //   CHECK-DAG: %[[P0:.*]] = spirv.AccessChain %[[ARG]][%[[C0]]]
+  //   CHECK-DAG: %[[P1:.*]] = spirv.AccessChain %[[ARG]][%[[C1]]]
+  //   CHECK-DAG: %[[P2:.*]] = spirv.AccessChain %[[ARG]][%[[C2]]]
+  //   CHECK-DAG: %[[A:.*]] = spirv.Load "CrossWorkgroup" %[[P0]]
+  //   CHECK-DAG: %[[B:.*]] = spirv.Load "CrossWorkgroup" %[[P1]]
+  //   CHECK-DAG: %[[I:.*]] = spirv.Load "CrossWorkgroup" %[[P2]]
+  //       CHECK: spirv.func @unpacked
+  //  CHECK-SAME: (%{{.*}}: !spirv.ptr<f32, CrossWorkgroup>, %{{.*}}: i64)
+
+  // CHECK-LABEL: gpu.module @kernels
+  //       CHECK: gpu.func @packed
+  //  CHECK-SAME: gpu_runtime.packed_args
+  //       CHECK: gpu.func @unpacked
+  //   CHECK-NOT: gpu_runtime.packed_args
+  gpu.module @kernels attributes {gpu_runtime.pack_args = 2 : i64} {
+    gpu.func @packed(%arg0: memref<?xf32>, %arg1: memref<?xf32>, %arg2: index) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = memref.load %arg0[%arg2] : memref<?xf32>
+      memref.store %0, %arg1[%arg2] : memref<?xf32>
+      gpu.return
+    }
+
+    gpu.func @unpacked(%arg0: memref<?xf32>, %arg1: index) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = memref.load %arg0[%arg1] : memref<?xf32>
+      memref.store %0, %arg0[%arg1] : memref<?xf32>
+      gpu.return
+    }
+  }
+}
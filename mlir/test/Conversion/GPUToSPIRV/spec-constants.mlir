@@ -0,0 +1,41 @@
+// RUN: numba-mlir-opt -allow-unregistered-dialect --gpux-to-spirv -split-input-file %s | FileCheck %s
+
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int64, Kernel], []>, #spirv.resource_limits<>>} {
+  // Each index argument gets value and flag constants, so the variant,
+  // specialized for 0, is distinct from the generic kernel.
+  // CHECK-LABEL: spirv.module @{{.*}}
+  //   CHECK-DAG: spirv.SpecConstant @{{"?}}__nmspec.1.kernel{{"?}} spec_id(0) = 0 : i64
+  //   CHECK-DAG: spirv.SpecConstant @{{"?}}__nmspecset.1.kernel{{"?}} spec_id(1) = 0 : i32
+  //   CHECK-NOT: __nmspec.2.kernel
+  //       CHECK: spirv.func @kernel
+  //  CHECK-SAME: (%{{.*}}: !spirv.ptr<f32, CrossWorkgroup>, %[[ARG:.*]]: i64, %{{.*}}: f32)
+  //   CHECK-DAG: %[[SPEC:.*]] = spirv.mlir.referenceof @{{"?}}__nmspec.1.kernel{{"?}} : i64
+  //   CHECK-DAG: %[[FLAG:.*]] = spirv.mlir.referenceof @{{"?}}__nmspecset.1.kernel{{"?}} : i32
+  //   CHECK-DAG: %[[ZERO:.*]] = spirv.Constant 0 : i32
+  //       CHECK: %[[IS_SET:.*]] = spirv.INotEqual %[[FLAG]], %[[ZERO]] : i32
+  //       CHECK: %[[VAL:.*]] = spirv.Select %[[IS_SET]], %[[SPEC]], %[[ARG]] : i1, i64
+  //       CHECK: spirv.AccessChain %{{.*}}[%[[VAL]]]
+  gpu.module @kernels attributes {gpu_runtime.spec_constants} {
+    gpu.func @kernel(%arg0: memref<?xf32>, %arg1: index, %arg2: f32) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      memref.store %arg2, %arg0[%arg1] : memref<?xf32>
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int64, Kernel], []>, #spirv.resource_limits<>>} {
+  // CHECK-LABEL: spirv.module @{{.*}}
+  //   CHECK-NOT: spirv.SpecConstant
+  //       CHECK: spirv.func @kernel
+  //   CHECK-NOT: spirv.Select
+  gpu.module @kernels {
+    gpu.func @kernel(%arg0: memref<?xf32>, %arg1: index, %arg2: f32) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      memref.store %arg2, %arg0[%arg1] : memref<?xf32>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,50 @@
+// RUN: numba-mlir-opt -allow-unregistered-dialect --gpux-to-spirv -split-input-file %s | FileCheck %s
+
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.3, [Addresses, Int64, Kernel, GroupNonUniform, GroupNonUniformArithmetic, GroupNonUniformShuffle], []>, #spirv.resource_limits<>>} {
+  gpu.module @kernels {
+    // CHECK-LABEL: spirv.func @subgroup_scan
+    //       CHECK: spirv.GroupNonUniformIAdd {{.*}}Subgroup{{.*}}InclusiveScan
+    //       CHECK: spirv.GroupNonUniformFMax {{.*}}Subgroup{{.*}}ExclusiveScan
+    gpu.func @subgroup_scan(%arg0: i32, %arg1: f32) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu_runtime.subgroup_scan add %arg0 : i32
+      %1 = gpu_runtime.subgroup_scan maximumf %arg1 exclusive : f32
+      "test.test"(%0, %1) : (i32, f32) -> ()
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.3, [Addresses, Int64, Kernel, GroupNonUniform, GroupNonUniformArithmetic, GroupNonUniformShuffle], []>, #spirv.resource_limits<>>} {
+  gpu.module @kernels {
+    // CHECK-LABEL: spirv.func @subgroup_shuffle
+    //       CHECK: spirv.GroupNonUniformShuffleXor {{.*}}Subgroup
+    //       CHECK: spirv.GroupNonUniformShuffle {{.*}}Subgroup
+    gpu.func @subgroup_shuffle(%arg0: f32, %arg1: i32, %arg2: i32) kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0, %1 = gpu.shuffle xor %arg0, %arg1, %arg2 : f32
+      %2, %3 = gpu.shuffle idx %arg0, %arg1, %arg2 : f32
+      "test.test"(%0, %2) : (f32, f32) -> ()
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.3, [Addresses, Int64, Kernel, GroupNonUniform, GroupNonUniformArithmetic, GroupNonUniformShuffle], []>, #spirv.resource_limits<>>} {
+  gpu.module @kernels {
+    // CHECK-DAG: spirv.GlobalVariable {{.*}} built_in("SubgroupLocalInvocationId")
+    // CHECK-DAG: spirv.GlobalVariable {{.*}} built_in("SubgroupSize")
+    // CHECK-LABEL: spirv.func @subgroup_ids
+    gpu.func @subgroup_ids() kernel
+      attributes {spirv.entry_point_abi = #spirv.entry_point_abi<>} {
+      %0 = gpu.lane_id
+      %1 = gpu.subgroup_size : index
+      "test.test"(%0, %1) : (index, index) -> ()
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,70 @@
+// RUN: numba-mlir-opt %s --scf-to-affine-for -split-input-file | FileCheck %s
+
+// CHECK-LABEL: func @matmul
+//  CHECK-SAME: (%[[A:.*]]: memref<?x?xf64>, %[[B:.*]]: memref<?x?xf64>, %[[C:.*]]: memref<?x?xf64>)
+//       CHECK: affine.for %[[I:.*]] = 0 to %{{.*}} {
+//       CHECK:   affine.for %[[J:.*]] = 0 to %{{.*}} {
+//       CHECK:     affine.for %[[K:.*]] = 0 to %{{.*}} {
+//       CHECK:       %[[V1:.*]] = affine.load %[[A]][%[[I]], %[[K]]]
+//       CHECK:       %[[V2:.*]] = affine.load %[[B]][%[[K]], %[[J]]]
+//       CHECK:       %[[V3:.*]] = affine.load %[[C]][%[[I]], %[[J]]]
+//       CHECK:       affine.store %{{.*}}, %[[C]][%[[I]], %[[J]]]
+//   CHECK-NOT: scf.parallel
+//   CHECK-NOT: scf.for
+func.func @matmul(%arg0: memref<?x?xf64>, %arg1: memref<?x?xf64>, %arg2: memref<?x?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg0, %c0 : memref<?x?xf64>
+  %1 = memref.dim %arg1, %c1 : memref<?x?xf64>
+  %2 = memref.dim %arg0, %c1 : memref<?x?xf64>
+  scf.parallel (%i, %j) = (%c0, %c0) to (%0, %1) step (%c1, %c1) {
+    scf.for %k = %c0 to %2 step %c1 {
+      %3 = memref.load %arg0[%i, %k] : memref<?x?xf64>
+      %4 = memref.load %arg1[%k, %j] : memref<?x?xf64>
+      %5 = memref.load %arg2[%i, %j] : memref<?x?xf64>
+      %6 = arith.mulf %3, %4 : f64
+      %7 = arith.addf %5, %6 : f64
+      memref.store %7, %arg2[%i, %j] : memref<?x?xf64>
+    }
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @stencil
+//       CHECK: affine.for %[[I:.*]] = 1 to {{.*}} {
+//       CHECK:   affine.load %{{.*}}[%[[I]] - 1]
+//       CHECK:   affine.load %{{.*}}[%[[I]] + 1]
+func.func @stencil(%arg0: memref<?xf64>, %arg1: memref<?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg0, %c0 : memref<?xf64>
+  %1 = arith.subi %0, %c1 : index
+  scf.for %i = %c1 to %1 step %c1 {
+    %2 = arith.subi %i, %c1 : index
+    %3 = arith.addi %i, %c1 : index
+    %4 = memref.load %arg0[%2] : memref<?xf64>
+    %5 = memref.load %arg0[%3] : memref<?xf64>
+    %6 = arith.addf %4, %5 : f64
+    memref.store %6, %arg1[%i] : memref<?xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @non_affine
+//       CHECK: scf.parallel
+//   CHECK-NOT: affine.for
+func.func @non_affine(%arg0: memref<?xf64>, %arg1: memref<?xindex>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg0, %c0 : memref<?xf64>
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    %1 = memref.load %arg1[%i] : memref<?xindex>
+    %2 = memref.load %arg0[%1] : memref<?xf64>
+    memref.store %2, %arg0[%i] : memref<?xf64>
+  }
+  return
+}
@@ -0,0 +1,67 @@
+// RUN: numba-mlir-opt --ntensor-fuse-elementwise --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test
+//  CHECK-SAME:   (%[[ARG1:.*]]: !ntensor.ntensor<?xf32>, %[[ARG2:.*]]: !ntensor.ntensor<?xf32>)
+//       CHECK:   %[[RES:.*]] = ntensor.elementwise %[[ARG1]], %[[ARG2]] : !ntensor.ntensor<?xf32>, !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+//       CHECK:   ^bb0(%[[A:.*]]: f32, %[[B:.*]]: f32):
+//       CHECK:     %[[V1:.*]] = arith.addf %[[A]], %[[A]] : f32
+//       CHECK:     %[[V2:.*]] = arith.mulf %[[V1]], %[[B]] : f32
+//       CHECK:     ntensor.elementwise_yield %[[V2]] : f32
+//   CHECK-NOT:   ntensor.elementwise
+//       CHECK:   return %[[RES]]
+func.func @test(%arg1: !ntensor.ntensor<?xf32>, %arg2: !ntensor.ntensor<?xf32>) -> !ntensor.ntensor<?xf32> {
+  %0 = ntensor.elementwise %arg1 : !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+  ^bb0(%arg3: f32):
+    %1 = arith.addf %arg3, %arg3 : f32
+    ntensor.elementwise_yield %1 : f32
+  }
+  %2 = ntensor.elementwise %0, %arg2 : !ntensor.ntensor<?xf32>, !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+  ^bb0(%arg3: f32, %arg4: f32):
+    %3 = arith.mulf %arg3, %arg4 : f32
+    ntensor.elementwise_yield %3 : f32
+  }
+  return %2 : !ntensor.ntensor<?xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @test_cast
+//  CHECK-SAME:   (%[[ARG1:.*]]: !ntensor.ntensor<10xf32>)
+//       CHECK:   %[[RES:.*]] = ntensor.elementwise %[[ARG1]] : !ntensor.ntensor<10xf32> -> !ntensor.ntensor<?xf32>
+//   CHECK-NOT:   ntensor.cast
+//       CHECK:   return %[[RES]]
+func.func @test_cast(%arg1: !ntensor.ntensor<10xf32>) -> !ntensor.ntensor<?xf32> {
+  %0 = ntensor.elementwise %arg1 : !ntensor.ntensor<10xf32> -> !ntensor.ntensor<10xf32> {
+  ^bb0(%arg3: f32):
+    %1 = arith.addf %arg3, %arg3 : f32
+    ntensor.elementwise_yield %1 : f32
+  }
+  %1 = ntensor.cast %0 : !ntensor.ntensor<10xf32> to !ntensor.ntensor<?xf32>
+  %2 = ntensor.elementwise %1 : !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+  ^bb0(%arg3: f32):
+    %3 = arith.mulf %arg3, %arg3 : f32
+    ntensor.elementwise_yield %3 : f32
+  }
+  return %2 : !ntensor.ntensor<?xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @test_write
+//       CHECK:   ntensor.elementwise
+//       CHECK:   ntensor.store
+//       CHECK:   ntensor.elementwise
+func.func @test_write(%arg1: !ntensor.ntensor<?xf32>, %val: f32, %idx: index) -> !ntensor.ntensor<?xf32> {
+  %0 = ntensor.elementwise %arg1 : !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+  ^bb0(%arg3: f32):
+    %1 = arith.addf %arg3, %arg3 : f32
+    ntensor.elementwise_yield %1 : f32
+  }
+  ntensor.store %val, %arg1[%idx] : !ntensor.ntensor<?xf32>
+  %2 = ntensor.elementwise %0, %arg1 : !ntensor.ntensor<?xf32>, !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+  ^bb0(%arg3: f32, %arg4: f32):
+    %3 = arith.mulf %arg3, %arg4 : f32
+    ntensor.elementwise_yield %3 : f32
+  }
+  return %2 : !ntensor.ntensor<?xf32>
+}
@@ -0,0 +1,89 @@
+// RUN: numba-mlir-opt --ntensor-hoist-array-ops --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_cse
+//  CHECK-SAME:   (%[[ARG1:.*]]: !ntensor.ntensor<?xf32>, %[[IDX:.*]]: index)
+//       CHECK:   %[[RES:.*]] = ntensor.elementwise %[[ARG1]]
+//   CHECK-NOT:   ntensor.elementwise
+//       CHECK:   %[[V1:.*]] = ntensor.load %[[RES]][%[[IDX]]]
+//       CHECK:   %[[V2:.*]] = ntensor.load %[[RES]][%[[IDX]]]
+func.func @test_cse(%arg1: !ntensor.ntensor<?xf32>, %idx: index) -> f32 {
+  %0 = ntensor.elementwise %arg1 : !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+  ^bb0(%arg2: f32):
+    %1 = arith.mulf %arg2, %arg2 : f32
+    ntensor.elementwise_yield %1 : f32
+  }
+  %2 = ntensor.elementwise %arg1 : !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+  ^bb0(%arg2: f32):
+    %3 = arith.mulf %arg2, %arg2 : f32
+    ntensor.elementwise_yield %3 : f32
+  }
+  %4 = ntensor.load %0[%idx] : !ntensor.ntensor<?xf32>
+  %5 = ntensor.load %2[%idx] : !ntensor.ntensor<?xf32>
+  %6 = arith.addf %4, %5 : f32
+  return %6 : f32
+}
+
+// -----
+
+// CHECK-LABEL: func @test_cse_escape
+//       CHECK:   ntensor.elementwise
+//       CHECK:   ntensor.elementwise
+func.func @test_cse_escape(%arg1: !ntensor.ntensor<?xf32>) -> (!ntensor.ntensor<?xf32>, !ntensor.ntensor<?xf32>) {
+  %0 = ntensor.elementwise %arg1 : !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+  ^bb0(%arg2: f32):
+    %1 = arith.mulf %arg2, %arg2 : f32
+    ntensor.elementwise_yield %1 : f32
+  }
+  %2 = ntensor.elementwise %arg1 : !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+  ^bb0(%arg2: f32):
+    %3 = arith.mulf %arg2, %arg2 : f32
+    ntensor.elementwise_yield %3 : f32
+  }
+  return %0, %2 : !ntensor.ntensor<?xf32>, !ntensor.ntensor<?xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @test_hoist
+//  CHECK-SAME:   (%[[ARG1:.*]]: !ntensor.ntensor<?xf32>, %[[N:.*]]: index, %[[INIT:.*]]: f32)
+//       CHECK:   %[[RES:.*]] = ntensor.elementwise %[[ARG1]]
+//       CHECK:   scf.for %[[I:.*]] =
+//   CHECK-NOT:   ntensor.elementwise
+//       CHECK:   ntensor.load %[[RES]][%[[I]]]
+func.func @test_hoist(%arg1: !ntensor.ntensor<?xf32>, %n: index, %init: f32) -> f32 {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = scf.for %i = %c0 to %n step %c1 iter_args(%acc = %init) -> (f32) {
+    %1 = ntensor.elementwise %arg1 : !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+    ^bb0(%arg2: f32):
+      %2 = arith.mulf %arg2, %arg2 : f32
+      ntensor.elementwise_yield %2 : f32
+    }
+    %3 = ntensor.load %1[%i] : !ntensor.ntensor<?xf32>
+    %4 = arith.addf %acc, %3 : f32
+    scf.yield %4 : f32
+  }
+  return %0 : f32
+}
+
+// -----
+
+// CHECK-LABEL: func @test_hoist_write
+//       CHECK:   scf.for
+//       CHECK:   ntensor.elementwise
+//       CHECK:   ntensor.store
+func.func @test_hoist_write(%arg1: !ntensor.ntensor<?xf32>, %n: index, %val: f32) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.for %i = %c0 to %n step %c1 {
+    %1 = ntensor.elementwise %arg1 : !ntensor.ntensor<?xf32> -> !ntensor.ntensor<?xf32> {
+    ^bb0(%arg2: f32):
+      %2 = arith.mulf %arg2, %arg2 : f32
+      ntensor.elementwise_yield %2 : f32
+    }
+    %3 = ntensor.load %1[%i] : !ntensor.ntensor<?xf32>
+    %4 = arith.addf %val, %3 : f32
+    ntensor.store %4, %arg1[%i] : !ntensor.ntensor<?xf32>
+  }
+  return
+}
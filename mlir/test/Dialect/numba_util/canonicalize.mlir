@@ -252,3 +252,32 @@ func.func @test(%arg0: !ntensor.ntensor<?xf32>, %arg1: index) -> !ntensor.ntenso
   %0 = numba_util.reshape %arg0(%arg1) : (!ntensor.ntensor<?xf32>, index) -> !ntensor.ntensor<?xf32>
   return %0: !ntensor.ntensor<?xf32>
 }
+
+// -----
+
+// CHECK-LABEL: func @test_reshape_strided
+//  CHECK-SAME:   (%[[ARG:.*]]: memref<4x8xf32, strided<[16, 1]>>)
+//       CHECK:   %[[VIEW:.*]] = memref.reinterpret_cast %[[ARG]] to offset: [0], sizes: [4, 2, 4], strides: [16, 4, 1] : memref<4x8xf32, strided<[16, 1]>> to memref<4x2x4xf32, strided<[16, 4, 1]>>
+//       CHECK:   %[[RES:.*]] = numba_util.change_layout %[[VIEW]] : memref<4x2x4xf32, strided<[16, 4, 1]>> to memref<4x2x4xf32>
+//       CHECK:   return %[[RES]]
+func.func @test_reshape_strided(%arg: memref<4x8xf32, strided<[16, 1]>>) -> memref<4x2x4xf32> {
+  %c2 = arith.constant 2 : index
+  %c4 = arith.constant 4 : index
+  %0 = numba_util.change_layout %arg : memref<4x8xf32, strided<[16, 1]>> to memref<4x8xf32>
+  %1 = numba_util.reshape %0(%c4, %c2, %c4) : (memref<4x8xf32>, index, index, index) -> memref<4x2x4xf32>
+  return %1 : memref<4x2x4xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @test_reshape_strided_copy
+//  CHECK-SAME:   (%[[ARG:.*]]: memref<4x8xf32, strided<[10, 1]>>)
+//       CHECK:   %[[CL:.*]] = numba_util.change_layout %[[ARG]]
+//       CHECK:   %[[RES:.*]] = numba_util.reshape %[[CL]]
+//       CHECK:   return %[[RES]]
+func.func @test_reshape_strided_copy(%arg: memref<4x8xf32, strided<[10, 1]>>) -> memref<32xf32> {
+  %c32 = arith.constant 32 : index
+  %0 = numba_util.change_layout %arg : memref<4x8xf32, strided<[10, 1]>> to memref<4x8xf32>
+  %1 = numba_util.reshape %0(%c32) : (memref<4x8xf32>, index) -> memref<32xf32>
+  return %1 : memref<32xf32>
+}
@@ -136,3 +136,14 @@ func.func @test(%arg: memref<?xf32>) -> index {
 //  CHECK-SAME:   (%[[ARG:.*]]: memref<?xf32>)
 //  CHECK-NEXT:   %[[RES:.*]] = numba_util.get_alloc_token %[[ARG]] : memref<?xf32> -> index
 //  CHECK-NEXT:   return %[[RES]] : index
+
+// -----
+
+func.func @test(%arg: memref<?xf32>) {
+  numba_util.zero_init %arg : memref<?xf32>
+  return
+}
+// CHECK-LABEL: func @test
+//  CHECK-SAME:   (%[[ARG:.*]]: memref<?xf32>)
+//  CHECK-NEXT:   numba_util.zero_init %[[ARG]] : memref<?xf32>
+//  CHECK-NEXT:   return
@@ -0,0 +1,25 @@
+// RUN: level_zero_runner %s -e main -entry-point-result=void --bench-repeat=3 --bench-warmup=2 -shared-libs=%mlir_wrappers_dir/%shlibprefixmlir_c_runner_utils%shlibext -shared-libs=%mlir_wrappers_dir/%shlibprefixmlir_runner_utils%shlibext -shared-libs=%numba_runtime_dir/%shlibprefixnumba-mlir-runtime%shlibext -shared-libs=%numba_igpu_runtime_dir/%shlibprefixnumba-mlir-gpu-runtime%shlibext | FileCheck %s
+
+//      CHECK: Benchmark: warmup 2, runs 3
+// CHECK-NEXT: host time (us): min {{.*}}, median {{.*}}, mean {{.*}}, max {{.*}}
+  func.func @main() {
+    %arg0 = memref.alloc() : memref<8xf32>
+    %arg1 = memref.alloc() : memref<8xf32>
+    %value1 = arith.constant 1.1 : f32
+    %arg3 = memref.cast %arg0 : memref<8xf32> to memref<?xf32>
+    call @fillResource1DFloat(%arg3, %value1) : (memref<?xf32>, f32) -> ()
+
+    %cst1 = arith.constant 1 : index
+    %cst8 = arith.constant 8 : index
+    gpu.launch blocks(%arg7, %arg8, %arg9) in (%arg10 = %cst8, %arg11 = %cst1, %arg12 = %cst1) threads(%arg13, %arg14, %arg15) in (%arg16 = %cst1, %arg17 = %cst1, %arg18 = %cst1) {
+       %5 = gpu.block_id x
+       %6 = memref.load %arg0[%5] : memref<8xf32>
+       %8 = arith.addf %6, %6 : f32
+      memref.store %8, %arg1[%5] : memref<8xf32>
+      gpu.terminator
+    }
+    memref.dealloc %arg0 : memref<8xf32>
+    memref.dealloc %arg1 : memref<8xf32>
+    return
+  }
+  func.func private @fillResource1DFloat(%0 : memref<?xf32>, %1 : f32)
@@ -0,0 +1,78 @@
+// RUN: numba-mlir-opt --numba-balance-csr-loops --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_csr_loop
+//  CHECK-SAME: (%[[PTR:.*]]: memref<?xi32>, %{{.*}}: memref<?xi32>, %{{.*}}: memref<?xf64>, %{{.*}}: memref<?xf64>, %[[Y:.*]]: memref<?xf64>, %[[N:.*]]: index)
+//       CHECK:   scf.if
+//       CHECK:     %[[FIRST:.*]] = memref.load %[[PTR]]
+//       CHECK:     %[[LAST:.*]] = memref.load %[[PTR]][%[[N]]]
+//       CHECK:     scf.parallel (%[[C:.*]]) =
+//       CHECK:       scf.while
+//       CHECK:       scf.if
+//       CHECK:       scf.for %[[I:.*]] =
+//       CHECK:         memref.load %[[PTR]][%[[I]]]
+//       CHECK:         scf.for
+//       CHECK:         memref.store %{{.*}}, %[[Y]][%[[I]]]
+func.func @test_csr_loop(%rows: memref<?xi32>, %cols: memref<?xi32>, %vals: memref<?xf64>, %x: memref<?xf64>, %y: memref<?xf64>, %n: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 0.0 : f64
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %i1 = arith.addi %i, %c1 : index
+    %begin = memref.load %rows[%i] : memref<?xi32>
+    %end = memref.load %rows[%i1] : memref<?xi32>
+    %b = arith.index_cast %begin : i32 to index
+    %e = arith.index_cast %end : i32 to index
+    %res = scf.for %j = %b to %e step %c1 iter_args(%acc = %cst) -> f64 {
+      %col = memref.load %cols[%j] : memref<?xi32>
+      %colIdx = arith.index_cast %col : i32 to index
+      %v = memref.load %vals[%j] : memref<?xf64>
+      %xv = memref.load %x[%colIdx] : memref<?xf64>
+      %m = arith.mulf %v, %xv : f64
+      %s = arith.addf %acc, %m : f64
+      scf.yield %s : f64
+    }
+    memref.store %res, %y[%i] : memref<?xf64>
+  }
+  return
+}
+
+// -----
+
+// Neighbour elements difference is not a CSR loop.
+
+// CHECK-LABEL: func @test_diff
+//       CHECK:   scf.parallel
+//   CHECK-NOT:   scf.while
+func.func @test_diff(%a: memref<?xi64>, %b: memref<?xi64>, %n: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %i1 = arith.addi %i, %c1 : index
+    %0 = memref.load %a[%i] : memref<?xi64>
+    %1 = memref.load %a[%i1] : memref<?xi64>
+    %2 = arith.subi %1, %0 : i64
+    memref.store %2, %b[%i] : memref<?xi64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_rows_modified
+//       CHECK:   scf.parallel
+//   CHECK-NOT:   scf.while
+func.func @test_rows_modified(%rows: memref<?xindex>, %y: memref<?xf64>, %n: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 1.0 : f64
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %i1 = arith.addi %i, %c1 : index
+    %begin = memref.load %rows[%i] : memref<?xindex>
+    %end = memref.load %rows[%i1] : memref<?xindex>
+    scf.for %j = %begin to %end step %c1 {
+      memref.store %cst, %y[%j] : memref<?xf64>
+    }
+    memref.store %c0, %rows[%i] : memref<?xindex>
+  }
+  return
+}
@@ -0,0 +1,17 @@
+// RUN: numba-mlir-opt --numba-benchmark="pipeline=numba-common-opts repeat=3" %s 2>&1 | FileCheck %s
+
+// CHECK: Benchmark: numba-common-opts
+// CHECK-NEXT: runs: 3
+// CHECK-NEXT: ops: 5 -> 3
+// CHECK-NEXT: time (ms): min {{.*}}, median {{.*}}, mean {{.*}}, max {{.*}}
+// CHECK-NEXT: retained malloc per run (KB): {{.*}}
+// CHECK-NEXT: peak rss (KB): {{[0-9]+}}
+
+// CHECK-LABEL: func @test
+//  CHECK-SAME: (%[[ARG:.*]]: index)
+//  CHECK-NEXT: return %[[ARG]] : index
+func.func @test(%arg0: index) -> index {
+  %c0 = arith.constant 0 : index
+  %0 = arith.addi %arg0, %c0 : index
+  return %0 : index
+}
@@ -0,0 +1,149 @@
+// RUN: numba-mlir-opt --numba-cost-model-inline --split-input-file %s | FileCheck %s
+
+// Single call site is always inlined.
+
+// CHECK-LABEL: func @test_single_call
+//   CHECK-NOT:   call
+//       CHECK:   arith.addi
+func.func private @callee(%arg1: index) -> index {
+  %0 = arith.addi %arg1, %arg1 : index
+  return %0 : index
+}
+
+func.func @test_single_call(%arg1: index) -> index {
+  %0 = func.call @callee(%arg1) : (index) -> index
+  return %0 : index
+}
+
+// -----
+
+// CHECK-LABEL: func @test_small
+//   CHECK-NOT:   call
+//       CHECK:   arith.addi
+//       CHECK:   arith.addi
+func.func private @callee(%arg1: index) -> index {
+  %0 = arith.addi %arg1, %arg1 : index
+  return %0 : index
+}
+
+func.func @test_small(%arg1: index, %arg2: index) -> (index, index) {
+  %0 = func.call @callee(%arg1) : (index) -> index
+  %1 = func.call @callee(%arg2) : (index) -> index
+  return %0, %1 : index, index
+}
+
+// -----
+
+// Public functions are never inlined.
+
+// CHECK-LABEL: func @test_public
+//       CHECK:   call @callee
+//       CHECK:   call @callee
+func.func @callee(%arg1: index) -> index {
+  %0 = arith.addi %arg1, %arg1 : index
+  return %0 : index
+}
+
+func.func @test_public(%arg1: index, %arg2: index) -> (index, index) {
+  %0 = func.call @callee(%arg1) : (index) -> index
+  %1 = func.call @callee(%arg2) : (index) -> index
+  return %0, %1 : index, index
+}
+
+// -----
+
+// CHECK-LABEL: func @test_recursive
+//       CHECK:   call @callee
+//       CHECK:   call @callee
+func.func private @callee(%arg1: index) -> index {
+  %0 = func.call @callee(%arg1) : (index) -> index
+  return %0 : index
+}
+
+func.func @test_recursive(%arg1: index, %arg2: index) -> (index, index) {
+  %0 = func.call @callee(%arg1) : (index) -> index
+  %1 = func.call @callee(%arg2) : (index) -> index
+  return %0, %1 : index, index
+}
+
+// -----
+
+// Parallel regions run on host, so cost model still applies.
+
+// CHECK-LABEL: func @test_parallel_region
+//       CHECK:   numba_util.env_region #numba_util.parallel
+//       CHECK:     call @callee
+//       CHECK:     call @callee
+func.func @external(%arg1: index) -> index {
+  %0 = arith.addi %arg1, %arg1 : index
+  return %0 : index
+}
+
+func.func private @callee(%arg1: index) -> index {
+  %0 = func.call @external(%arg1) : (index) -> index
+  %1 = arith.muli %0, %0 : index
+  return %1 : index
+}
+
+func.func @test_parallel_region(%arg1: index, %arg2: index) -> (index, index) {
+  %0:2 = numba_util.env_region #numba_util.parallel -> index, index {
+    %1 = func.call @callee(%arg1) : (index) -> index
+    %2 = func.call @callee(%arg2) : (index) -> index
+    numba_util.env_region_yield %1, %2 : index, index
+  }
+  return %0#0, %0#1 : index, index
+}
+
+// -----
+
+// Device code cannot call host functions, so everything is inlined.
+
+// CHECK-LABEL: func @test_device_region
+//       CHECK:   numba_util.env_region "test"
+//   CHECK-NOT:     call @callee
+//       CHECK:     arith.muli
+//       CHECK:     arith.muli
+func.func @external(%arg1: index) -> index {
+  %0 = arith.addi %arg1, %arg1 : index
+  return %0 : index
+}
+
+func.func private @callee(%arg1: index) -> index {
+  %0 = func.call @external(%arg1) : (index) -> index
+  %1 = arith.muli %0, %0 : index
+  return %1 : index
+}
+
+func.func @test_device_region(%arg1: index, %arg2: index) -> (index, index) {
+  %0:2 = numba_util.env_region "test" -> index, index {
+    %1 = func.call @callee(%arg1) : (index) -> index
+    %2 = func.call @callee(%arg2) : (index) -> index
+    numba_util.env_region_yield %1, %2 : index, index
+  }
+  return %0#0, %0#1 : index, index
+}
+
+// -----
+
+// Mutually recursive functions are never inlined, even into device code.
+
+// CHECK-LABEL: func @test_mutual_recursion
+//       CHECK:   numba_util.env_region "test"
+//       CHECK:     call @callee1
+func.func private @callee1(%arg1: index) -> index {
+  %0 = func.call @callee2(%arg1) : (index) -> index
+  return %0 : index
+}
+
+func.func private @callee2(%arg1: index) -> index {
+  %0 = func.call @callee1(%arg1) : (index) -> index
+  return %0 : index
+}
+
+func.func @test_mutual_recursion(%arg1: index) -> index {
+  %0 = numba_util.env_region "test" -> index {
+    %1 = func.call @callee1(%arg1) : (index) -> index
+    numba_util.env_region_yield %1 : index
+  }
+  return %0 : index
+}
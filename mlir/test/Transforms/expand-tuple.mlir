@@ -48,3 +48,40 @@ func.func @test() -> tuple<index, i64> {
 //       CHECK: numba_util.env_region_yield %[[E1]], %[[E2]] : index, i64
 //       CHECK: }
 //       CHECK: return %[[RES]]#0, %[[RES]]#1 : index, i64
+
+// -----
+
+func.func @test(%arg1: tuple<memref<?xf32>, index>, %arg2: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.parallel (%i) = (%c0) to (%arg2) step (%c1) {
+    %0 = numba_util.tuple_extract %arg1 : tuple<memref<?xf32>, index>, %c0 -> memref<?xf32>
+    %1 = numba_util.tuple_extract %arg1 : tuple<memref<?xf32>, index>, %c1 -> index
+    "test.test"(%0, %1, %i) : (memref<?xf32>, index, index) -> ()
+  }
+  return
+}
+
+// CHECK-LABEL: func @test
+//  CHECK-SAME:   (%[[ARG1:.*]]: memref<?xf32>, %[[ARG2:.*]]: index, %[[ARG3:.*]]: index)
+//       CHECK:   scf.parallel (%[[I:.*]]) =
+//   CHECK-NOT:   numba_util.tuple_extract
+//       CHECK:   "test.test"(%[[ARG1]], %[[ARG2]], %[[I]])
+
+// -----
+
+func.func @test(%arg1: tuple<index, i64>, %arg2: index) -> tuple<index, i64> {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = scf.for %i = %c0 to %arg2 step %c1 iter_args(%arg3 = %arg1) -> tuple<index, i64> {
+    %1 = "test.test"(%arg3) : (tuple<index, i64>) -> tuple<index, i64>
+    scf.yield %1 : tuple<index, i64>
+  }
+  return %0 : tuple<index, i64>
+}
+
+// CHECK-LABEL: func @test
+//  CHECK-SAME:   (%[[ARG1:.*]]: index, %[[ARG2:.*]]: i64, %[[ARG3:.*]]: index)
+//       CHECK:   %[[RES:.*]]:2 = scf.for %{{.*}} = %{{.*}} to %[[ARG3]] step %{{.*}} iter_args(%{{.*}} = %[[ARG1]], %{{.*}} = %[[ARG2]]) -> (index, i64) {
+//       CHECK:   scf.yield %{{.*}}, %{{.*}} : index, i64
+//       CHECK:   return %[[RES]]#0, %[[RES]]#1 : index, i64
@@ -0,0 +1,91 @@
+// RUN: numba-mlir-opt --numba-fuse-parallel-loops --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_reduce_broadcast
+//  CHECK-SAME: (%[[SRC:.*]]: memref<?x?xf64> {numba.restrict}, %[[DST:.*]]: memref<?x?xf64> {numba.restrict})
+//       CHECK:   %[[TMP:.*]] = memref.alloc
+//       CHECK:   scf.parallel (%[[I:.*]]) =
+//       CHECK:     scf.for
+//       CHECK:     memref.store %{{.*}}, %[[TMP]][%[[I]]]
+//       CHECK:     scf.parallel (%[[J:.*]]) =
+//       CHECK:       %[[V1:.*]] = memref.load %[[SRC]][%[[I]], %[[J]]]
+//       CHECK:       %[[V2:.*]] = memref.load %[[TMP]][%[[I]]]
+//       CHECK:       %[[V3:.*]] = arith.divf %[[V1]], %[[V2]]
+//       CHECK:       memref.store %[[V3]], %[[DST]][%[[I]], %[[J]]]
+//   CHECK-NOT:   scf.parallel
+func.func @test_reduce_broadcast(%arg0: memref<?x?xf64> {numba.restrict}, %arg1: memref<?x?xf64> {numba.restrict}) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 0.0 : f64
+  %0 = memref.dim %arg0, %c0 : memref<?x?xf64>
+  %tmp = memref.alloc(%0) : memref<?xf64>
+  %1 = memref.dim %arg0, %c1 : memref<?x?xf64>
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    %2 = scf.for %j = %c0 to %1 step %c1 iter_args(%acc = %cst) -> (f64) {
+      %3 = memref.load %arg0[%i, %j] : memref<?x?xf64>
+      %4 = arith.addf %acc, %3 : f64
+      scf.yield %4 : f64
+    }
+    memref.store %2, %tmp[%i] : memref<?xf64>
+  }
+  scf.parallel (%i, %j) = (%c0, %c0) to (%0, %1) step (%c1, %c1) {
+    %2 = memref.load %arg0[%i, %j] : memref<?x?xf64>
+    %3 = memref.load %tmp[%i] : memref<?xf64>
+    %4 = arith.divf %2, %3 : f64
+    memref.store %4, %arg1[%i, %j] : memref<?x?xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_transposed_read
+//       CHECK:   scf.parallel (%{{.*}}) =
+//       CHECK:   scf.parallel (%{{.*}}, %{{.*}}) =
+func.func @test_transposed_read(%arg0: memref<?x?xf64> {numba.restrict}, %arg1: memref<?x?xf64> {numba.restrict}) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 1.0 : f64
+  %0 = memref.dim %arg0, %c0 : memref<?x?xf64>
+  %tmp = memref.alloc(%0) : memref<?xf64>
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    memref.store %cst, %tmp[%i] : memref<?xf64>
+  }
+  scf.parallel (%i, %j) = (%c0, %c0) to (%0, %0) step (%c1, %c1) {
+    %2 = memref.load %arg0[%i, %j] : memref<?x?xf64>
+    %3 = memref.load %tmp[%j] : memref<?xf64>
+    %4 = arith.divf %2, %3 : f64
+    memref.store %4, %arg1[%i, %j] : memref<?x?xf64>
+  }
+  return
+}
+
+// -----
+
+// Parfor loops were already fused by Numba.
+// CHECK-LABEL: func @test_parfor_loop
+//       CHECK:   scf.parallel (%{{.*}}) =
+//       CHECK:   } {numba.parfor_lowered}
+//       CHECK:   scf.parallel (%{{.*}}, %{{.*}}) =
+func.func @test_parfor_loop(%arg0: memref<?x?xf64> {numba.restrict}, %arg1: memref<?x?xf64> {numba.restrict}) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 0.0 : f64
+  %0 = memref.dim %arg0, %c0 : memref<?x?xf64>
+  %tmp = memref.alloc(%0) : memref<?xf64>
+  %1 = memref.dim %arg0, %c1 : memref<?x?xf64>
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    %2 = scf.for %j = %c0 to %1 step %c1 iter_args(%acc = %cst) -> (f64) {
+      %3 = memref.load %arg0[%i, %j] : memref<?x?xf64>
+      %4 = arith.addf %acc, %3 : f64
+      scf.yield %4 : f64
+    }
+    memref.store %2, %tmp[%i] : memref<?xf64>
+  } {numba.parfor_lowered}
+  scf.parallel (%i, %j) = (%c0, %c0) to (%0, %1) step (%c1, %c1) {
+    %2 = memref.load %arg0[%i, %j] : memref<?x?xf64>
+    %3 = memref.load %tmp[%i] : memref<?xf64>
+    %4 = arith.divf %2, %3 : f64
+    memref.store %4, %arg1[%i, %j] : memref<?x?xf64>
+  }
+  return
+}
@@ -0,0 +1,62 @@
+// RUN: numba-mlir-opt --gpux-fuse-launches --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_fuse
+//  CHECK-SAME: (%[[A:.*]]: memref<?xf32>, %[[B:.*]]: memref<?xf32> {numba.restrict}, %[[GS:.*]]: index, %[[BS:.*]]: index)
+//       CHECK: %[[TMP:.*]] = memref.alloc
+//       CHECK: gpu.launch
+//       CHECK: %[[V1:.*]] = memref.load %[[A]]
+//       CHECK: memref.store %{{.*}}, %[[TMP]]
+//       CHECK: %[[V2:.*]] = memref.load %[[TMP]]
+//       CHECK: memref.store %{{.*}}, %[[B]]
+//       CHECK: gpu.terminator
+//   CHECK-NOT: gpu.launch
+func.func @test_fuse(%arg0: memref<?xf32>, %arg1: memref<?xf32> {numba.restrict}, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  %tmp = memref.alloc(%gs) : memref<?xf32>
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %0 = arith.muli %bx, %bs : index
+    %1 = arith.addi %0, %tx : index
+    %2 = memref.load %arg0[%1] : memref<?xf32>
+    %3 = arith.addf %2, %2 : f32
+    memref.store %3, %tmp[%1] : memref<?xf32>
+    gpu.terminator
+  }
+  %cst = arith.constant 2.0 : f32
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %0 = arith.muli %bx, %bs : index
+    %1 = arith.addi %0, %tx : index
+    %2 = memref.load %tmp[%1] : memref<?xf32>
+    %3 = arith.mulf %2, %cst : f32
+    memref.store %3, %arg1[%1] : memref<?xf32>
+    gpu.terminator
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_neighbour
+//       CHECK: gpu.launch
+//       CHECK: gpu.terminator
+//       CHECK: gpu.launch
+//       CHECK: gpu.terminator
+func.func @test_neighbour(%arg0: memref<?xf32>, %arg1: memref<?xf32> {numba.restrict}, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  %tmp = memref.alloc(%gs) : memref<?xf32>
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %0 = arith.muli %bx, %bs : index
+    %1 = arith.addi %0, %tx : index
+    %2 = memref.load %arg0[%1] : memref<?xf32>
+    memref.store %2, %tmp[%1] : memref<?xf32>
+    gpu.terminator
+  }
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %0 = arith.muli %bx, %bs : index
+    %1 = arith.addi %0, %tx : index
+    %2 = arith.addi %1, %c1 : index
+    %3 = memref.load %tmp[%2] : memref<?xf32>
+    memref.store %3, %arg1[%1] : memref<?xf32>
+    gpu.terminator
+  }
+  return
+}
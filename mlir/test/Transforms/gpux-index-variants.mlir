@@ -0,0 +1,63 @@
+// RUN: numba-mlir-opt --gpux-index-variants --split-input-file %s | FileCheck %s
+
+// Launches of the same kernel module share its 32-bit variant.
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: func @test_shared_variant
+  //       CHECK: scf.if
+  //       CHECK:   gpu.launch_func @kernels_i32::@fill
+  //       CHECK: else
+  //       CHECK:   gpu.launch_func @kernels::@fill
+  //       CHECK: scf.if
+  //       CHECK:   gpu.launch_func @kernels_i32::@fill
+  //       CHECK: else
+  //       CHECK:   gpu.launch_func @kernels::@fill
+  func.func @test_shared_variant(%arg0: memref<?xf32>, %arg1: index) {
+    %c1 = arith.constant 1 : index
+    gpu.launch_func @kernels::@fill
+        blocks in (%arg1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%arg0 : memref<?xf32>)
+    gpu.launch_func @kernels::@fill
+        blocks in (%arg1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%arg0 : memref<?xf32>)
+    return
+  }
+
+  //       CHECK: gpu.module @kernels_i32 attributes {gpu_runtime.use_64bit_index = false}
+  //   CHECK-NOT: gpu.module @kernels_i32
+  //       CHECK: gpu.module @kernels attributes {gpu_runtime.use_64bit_index = true}
+  //   CHECK-NOT: gpu.module
+  gpu.module @kernels attributes {gpu_runtime.use_64bit_index = "auto"} {
+    gpu.func @fill(%arg0: memref<?xf32>) kernel {
+      %0 = gpu.block_id x
+      %cst = arith.constant 1.0 : f32
+      memref.store %cst, %arg0[%0] : memref<?xf32>
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+// Modules without "auto" setting are left as is.
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: func @test_no_auto
+  //   CHECK-NOT: scf.if
+  //       CHECK: gpu.launch_func @kernels::@fill
+  //   CHECK-NOT: _i32
+  func.func @test_no_auto(%arg0: memref<?xf32>, %arg1: index) {
+    %c1 = arith.constant 1 : index
+    gpu.launch_func @kernels::@fill
+        blocks in (%arg1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%arg0 : memref<?xf32>)
+    return
+  }
+
+  gpu.module @kernels attributes {gpu_runtime.use_64bit_index = true} {
+    gpu.func @fill(%arg0: memref<?xf32>) kernel {
+      %0 = gpu.block_id x
+      %cst = arith.constant 1.0 : f32
+      memref.store %cst, %arg0[%0] : memref<?xf32>
+      gpu.return
+    }
+  }
+}
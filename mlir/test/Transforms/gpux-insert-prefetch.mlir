@@ -0,0 +1,149 @@
+// RUN: numba-mlir-opt --gpu-to-gpux --gpux-insert-prefetch --split-input-file %s | FileCheck %s
+
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: func @test_read
+  //       CHECK: %[[Q:.*]] = gpu_runtime.create_gpu_queue
+  //       CHECK: %[[A:.*]] = gpu_runtime.alloc %[[Q]] host_shared () : memref<16xf32>
+  //       CHECK: %[[B:.*]] = gpu_runtime.alloc %[[Q]] host_shared () : memref<16xf32>
+  //       CHECK: %[[C:.*]] = gpu_runtime.alloc %[[Q]] () : memref<16xf32>
+  //       CHECK: gpu_runtime.prefetch %[[Q]] %[[A]] : memref<16xf32>
+  //   CHECK-NOT: gpu_runtime.prefetch
+  //       CHECK: "gpu_runtime.launch_gpu_kernel"
+  func.func @test_read() {
+    %c1 = arith.constant 1 : index
+    %0 = gpu.alloc host_shared () : memref<16xf32>
+    %1 = gpu.alloc host_shared () : memref<16xf32>
+    %2 = gpu.alloc () : memref<16xf32>
+    gpu.launch_func @kernels::@copy
+        blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%0 : memref<16xf32>, %1 : memref<16xf32>, %2 : memref<16xf32>)
+    return
+  }
+
+  gpu.module @kernels {
+    gpu.func @copy(%arg0: memref<16xf32>, %arg1: memref<16xf32>,
+                   %arg2: memref<16xf32>) kernel {
+      %0 = gpu.block_id x
+      %1 = memref.load %arg0[%0] : memref<16xf32>
+      %2 = memref.load %arg2[%0] : memref<16xf32>
+      %3 = arith.addf %1, %2 : f32
+      memref.store %3, %arg1[%0] : memref<16xf32>
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+module attributes {gpu.container_module} {
+  // CHECK-LABEL: func @test_view
+  //       CHECK: %[[Q:.*]] = gpu_runtime.create_gpu_queue
+  //       CHECK: %[[A:.*]] = gpu_runtime.alloc %[[Q]] host_shared () : memref<16xf32>
+  //       CHECK: %[[V:.*]] = memref.subview %[[A]]
+  //       CHECK: gpu_runtime.prefetch %[[Q]] %[[A]] : memref<16xf32>
+  //   CHECK-NOT: gpu_runtime.prefetch
+  //       CHECK: "gpu_runtime.launch_gpu_kernel"
+  func.func @test_view() {
+    %c1 = arith.constant 1 : index
+    %0 = gpu.alloc host_shared () : memref<16xf32>
+    %1 = memref.subview %0[0] [8] [1] : memref<16xf32> to memref<8xf32, strided<[1]>>
+    gpu.launch_func @kernels::@twice
+        blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%1 : memref<8xf32, strided<[1]>>, %0 : memref<16xf32>)
+    return
+  }
+
+  gpu.module @kernels {
+    gpu.func @twice(%arg0: memref<8xf32, strided<[1]>>,
+                    %arg1: memref<16xf32>) kernel {
+      %0 = gpu.block_id x
+      %1 = memref.load %arg0[%0] : memref<8xf32, strided<[1]>>
+      memref.store %1, %arg1[%0] : memref<16xf32>
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+module attributes {gpu.container_module} {
+  // Loop doesn't touch the data on host, prefetch is hoisted out of it and
+  // the second launch reuses it.
+  // CHECK-LABEL: func @test_loop
+  //       CHECK: %[[Q:.*]] = gpu_runtime.create_gpu_queue
+  //       CHECK: %[[A:.*]] = gpu_runtime.alloc %[[Q]] host_shared () : memref<16xf32>
+  //       CHECK: gpu_runtime.prefetch %[[Q]] %[[A]] : memref<16xf32>
+  //   CHECK-NOT: gpu_runtime.prefetch
+  //       CHECK: scf.for
+  //   CHECK-NOT: gpu_runtime.prefetch
+  //       CHECK: "gpu_runtime.launch_gpu_kernel"
+  //   CHECK-NOT: gpu_runtime.prefetch
+  //       CHECK: "gpu_runtime.launch_gpu_kernel"
+  func.func @test_loop(%n: index) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %0 = gpu.alloc host_shared () : memref<16xf32>
+    scf.for %i = %c0 to %n step %c1 {
+      gpu.launch_func @kernels::@inc
+          blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+          args(%0 : memref<16xf32>)
+    }
+    gpu.launch_func @kernels::@inc
+        blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%0 : memref<16xf32>)
+    return
+  }
+
+  gpu.module @kernels {
+    gpu.func @inc(%arg0: memref<16xf32>) kernel {
+      %0 = gpu.block_id x
+      %1 = memref.load %arg0[%0] : memref<16xf32>
+      %2 = arith.addf %1, %1 : f32
+      memref.store %2, %arg0[%0] : memref<16xf32>
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+module attributes {gpu.container_module} {
+  // Host access migrates data back, so prefetch stays in the loop and is
+  // repeated after it.
+  // CHECK-LABEL: func @test_loop_host_access
+  //       CHECK: %[[Q:.*]] = gpu_runtime.create_gpu_queue
+  //       CHECK: %[[A:.*]] = gpu_runtime.alloc %[[Q]] host_shared () : memref<16xf32>
+  //       CHECK: scf.for
+  //       CHECK:   gpu_runtime.prefetch %[[Q]] %[[A]] : memref<16xf32>
+  //       CHECK:   "gpu_runtime.launch_gpu_kernel"
+  //       CHECK:   memref.store %{{.*}}, %[[A]]
+  //       CHECK: memref.load %[[A]]
+  //       CHECK: gpu_runtime.prefetch %[[Q]] %[[A]] : memref<16xf32>
+  //       CHECK: "gpu_runtime.launch_gpu_kernel"
+  func.func @test_loop_host_access(%n: index, %val: f32) {
+    %c0 = arith.constant 0 : index
+    %c1 = arith.constant 1 : index
+    %0 = gpu.alloc host_shared () : memref<16xf32>
+    scf.for %i = %c0 to %n step %c1 {
+      gpu.launch_func @kernels::@inc
+          blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+          args(%0 : memref<16xf32>)
+      memref.store %val, %0[%c0] : memref<16xf32>
+    }
+    %1 = memref.load %0[%c1] : memref<16xf32>
+    gpu.launch_func @kernels::@inc
+        blocks in (%c1, %c1, %c1) threads in (%c1, %c1, %c1)
+        args(%0 : memref<16xf32>)
+    return
+  }
+
+  gpu.module @kernels {
+    gpu.func @inc(%arg0: memref<16xf32>) kernel {
+      %0 = gpu.block_id x
+      %1 = memref.load %arg0[%0] : memref<16xf32>
+      %2 = arith.addf %1, %1 : f32
+      memref.store %2, %arg0[%0] : memref<16xf32>
+      gpu.return
+    }
+  }
+}
@@ -0,0 +1,37 @@
+// RUN: numba-mlir-opt --gpux-lower-global-reduce --split-input-file %s | FileCheck %s
+
+// Partial results must be visible to the last workgroup: release fence
+// between the partial store and the counter increment, acquire fence before
+// the partials are read.
+
+// CHECK-LABEL: func @test
+//  CHECK-SAME:   (%[[VAL:.*]]: f32, %[[RES:.*]]: memref<f32>, %[[N:.*]]: index)
+//       CHECK:   %[[PARTIALS:.*]] = gpu.alloc host_shared (%{{.*}}) : memref<?xf32>
+//       CHECK:   %[[COUNTER:.*]] = gpu.alloc host_shared () : memref<i32>
+//       CHECK:   gpu.launch
+//       CHECK:     %[[LOCAL:.*]] = gpu.all_reduce {{.*}}%[[VAL]]
+//       CHECK:     %[[PREV:.*]] = scf.if
+//       CHECK:       memref.store %[[LOCAL]], %[[PARTIALS]][%{{.*}}] : memref<?xf32>
+//  CHECK-NEXT:       gpu_runtime.mem_fence 4
+//  CHECK-NEXT:       memref.atomic_rmw addi %{{.*}}, %[[COUNTER]][] : (i32, memref<i32>) -> i32
+//       CHECK:     scf.if
+//  CHECK-NEXT:       gpu_runtime.mem_fence 4
+//       CHECK:       scf.for
+//       CHECK:         memref.load %[[PARTIALS]][%{{.*}}] : memref<?xf32>
+//       CHECK:       gpu.all_reduce
+//       CHECK:       memref.store %{{.*}}, %[[RES]][] : memref<f32>
+//       CHECK:   gpu.dealloc {{.*}}%[[COUNTER]] : memref<i32>
+//       CHECK:   gpu.dealloc {{.*}}%[[PARTIALS]] : memref<?xf32>
+func.func @test(%val: f32, %res: memref<f32>, %n: index) {
+  %c1 = arith.constant 1 : index
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %n, %gy = %c1, %gz = %c1)
+             threads(%tx, %ty, %tz) in (%sx = %n, %sy = %c1, %sz = %c1) {
+    gpu_runtime.global_reduce %val, %res : memref<f32> {
+    ^bb0(%lhs: f32, %rhs: f32):
+      %0 = arith.addf %lhs, %rhs : f32
+      gpu_runtime.global_reduce_yield %0 : f32
+    }
+    gpu.terminator
+  }
+  return
+}
@@ -0,0 +1,186 @@
+// RUN: numba-mlir-opt --gpux-lower-launches-to-cpu --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_simple
+//  CHECK-SAME: (%[[A:.*]]: memref<?xf32>, %[[GS:.*]]: index, %[[BS:.*]]: index)
+//       CHECK: %[[C0:.*]] = arith.constant 0 : index
+//       CHECK: scf.parallel (%{{.*}}, %{{.*}}, %[[BX:.*]]) = (%[[C0]], %[[C0]], %[[C0]]) to (%{{.*}}, %{{.*}}, %[[GS]])
+//       CHECK: memref.alloca_scope
+//       CHECK: %[[OFF:.*]] = arith.muli %[[BX]], %[[BS]] : index
+//       CHECK: scf.parallel (%{{.*}}, %{{.*}}, %[[TX:.*]]) = (%[[C0]], %[[C0]], %[[C0]]) to (%{{.*}}, %{{.*}}, %[[BS]])
+//       CHECK: %[[I:.*]] = arith.addi %[[OFF]], %[[TX]] : index
+//       CHECK: %[[V:.*]] = memref.load %[[A]][%[[I]]] : memref<?xf32>
+//       CHECK: %[[R:.*]] = arith.addf %[[V]], %[[V]] : f32
+//       CHECK: memref.store %[[R]], %[[A]][%[[I]]] : memref<?xf32>
+//   CHECK-NOT: gpu.
+func.func @test_simple(%arg0: memref<?xf32>, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %0 = arith.muli %bx, %bs : index
+    %1 = arith.addi %0, %tx : index
+    %2 = memref.load %arg0[%1] : memref<?xf32>
+    %3 = arith.addf %2, %2 : f32
+    memref.store %3, %arg0[%1] : memref<?xf32>
+    gpu.terminator
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_barrier
+//  CHECK-SAME: (%[[A:.*]]: memref<?xf32>, %[[GS:.*]]: index, %[[BS:.*]]: index)
+//       CHECK: memref.alloca_scope
+//   CHECK-DAG: %[[SPILL1:.*]] = memref.alloca(%{{.*}}, %{{.*}}, %[[BS]]) : memref<?x?x?xindex>
+//   CHECK-DAG: %[[SPILL2:.*]] = memref.alloca(%{{.*}}, %{{.*}}, %[[BS]]) : memref<?x?x?xf32>
+//   CHECK-DAG: %[[LM:.*]] = memref.alloca() : memref<64xf32>
+//       CHECK: scf.parallel (%[[TZ1:.*]], %[[TY1:.*]], %[[TX1:.*]]) =
+//       CHECK: %[[I1:.*]] = arith.addi %{{.*}}, %[[TX1]] : index
+//       CHECK: memref.store %[[I1]], %[[SPILL1]][%[[TZ1]], %[[TY1]], %[[TX1]]]
+//       CHECK: %[[V1:.*]] = memref.load %[[A]][%[[I1]]] : memref<?xf32>
+//       CHECK: memref.store %[[V1]], %[[SPILL2]][%[[TZ1]], %[[TY1]], %[[TX1]]]
+//       CHECK: memref.store %[[V1]], %[[LM]][%[[TX1]]] : memref<64xf32>
+//       CHECK: scf.parallel (%[[TZ2:.*]], %[[TY2:.*]], %[[TX2:.*]]) =
+//   CHECK-DAG: %[[I2:.*]] = memref.load %[[SPILL1]][%[[TZ2]], %[[TY2]], %[[TX2]]]
+//   CHECK-DAG: %[[V2:.*]] = memref.load %[[SPILL2]][%[[TZ2]], %[[TY2]], %[[TX2]]]
+//       CHECK: %[[J:.*]] = arith.subi %[[BS]], %[[TX2]] : index
+//       CHECK: %[[K:.*]] = arith.subi %[[J]], %{{.*}} : index
+//       CHECK: %[[V3:.*]] = memref.load %[[LM]][%[[K]]] : memref<64xf32>
+//       CHECK: %[[R:.*]] = arith.addf %[[V3]], %[[V2]] : f32
+//       CHECK: memref.store %[[R]], %[[A]][%[[I2]]] : memref<?xf32>
+//   CHECK-NOT: gpu.
+func.func @test_barrier(%arg0: memref<?xf32>, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %lm = memref.alloca() : memref<64xf32, #gpu.address_space<workgroup>>
+    %0 = arith.muli %bx, %bs : index
+    %1 = arith.addi %0, %tx : index
+    %2 = memref.load %arg0[%1] : memref<?xf32>
+    memref.store %2, %lm[%tx] : memref<64xf32, #gpu.address_space<workgroup>>
+    gpu.barrier
+    %3 = arith.subi %bs, %tx : index
+    %4 = arith.subi %3, %c1 : index
+    %5 = memref.load %lm[%4] : memref<64xf32, #gpu.address_space<workgroup>>
+    %6 = arith.addf %5, %2 : f32
+    memref.store %6, %arg0[%1] : memref<?xf32>
+    gpu.terminator
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_reduce
+//  CHECK-SAME: (%[[A:.*]]: memref<?xf32>, %[[B:.*]]: memref<?xf32>, %[[GS:.*]]: index, %[[BS:.*]]: index)
+//       CHECK: %[[C0:.*]] = arith.constant 0 : index
+//       CHECK: scf.parallel (%{{.*}}, %{{.*}}, %[[BX:.*]]) =
+//       CHECK: %[[SPILL:.*]] = memref.alloca(%{{.*}}, %{{.*}}, %[[BS]]) : memref<?x?x?xf32>
+//       CHECK: scf.parallel
+//       CHECK: memref.store %{{.*}}, %[[SPILL]]
+//       CHECK: %[[FLAT:.*]] = memref.collapse_shape %[[SPILL]] {{\[\[}}0, 1, 2]] : memref<?x?x?xf32> into memref<?xf32>
+//       CHECK: %[[INIT:.*]] = memref.load %[[FLAT]][%[[C0]]] : memref<?xf32>
+//       CHECK: %[[RES:.*]] = scf.for %[[I:.*]] = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%[[ACC:.*]] = %[[INIT]]) -> (f32)
+//       CHECK: %[[E:.*]] = memref.load %[[FLAT]][%[[I]]] : memref<?xf32>
+//       CHECK: %[[N:.*]] = arith.addf %[[ACC]], %[[E]] : f32
+//       CHECK: scf.yield %[[N]] : f32
+//       CHECK: scf.parallel
+//       CHECK: memref.store %[[RES]], %[[B]][%[[BX]]] : memref<?xf32>
+//   CHECK-NOT: gpu.
+func.func @test_reduce(%arg0: memref<?xf32>, %arg1: memref<?xf32>, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %0 = arith.muli %bx, %bs : index
+    %1 = arith.addi %0, %tx : index
+    %2 = memref.load %arg0[%1] : memref<?xf32>
+    %3 = gpu.all_reduce add %2 {} : (f32) -> (f32)
+    memref.store %3, %arg1[%bx] : memref<?xf32>
+    gpu.terminator
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_uniform_loop
+//       CHECK: scf.parallel
+//       CHECK: scf.for
+//       CHECK: scf.parallel
+//       CHECK: memref.store
+//       CHECK: scf.parallel
+//       CHECK: memref.load
+//       CHECK: scf.yield
+//   CHECK-NOT: gpu.
+func.func @test_uniform_loop(%arg0: memref<?xf32>, %arg1: memref<64xf32>, %gs: index, %bs: index, %n: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    scf.for %i = %c0 to %n step %c1 {
+      %0 = memref.load %arg0[%i] : memref<?xf32>
+      memref.store %0, %arg1[%tx] : memref<64xf32>
+      gpu.barrier
+      %1 = memref.load %arg1[%c0] : memref<64xf32>
+      memref.store %1, %arg0[%tx] : memref<?xf32>
+      gpu.barrier
+    }
+    gpu.terminator
+  }
+  return
+}
+
+// -----
+
+// Barrier in the non-uniform control flow, kept as is.
+
+// CHECK-LABEL: func @test_non_uniform
+//       CHECK: gpu.launch
+//       CHECK: gpu.barrier
+//       CHECK: gpu.terminator
+func.func @test_non_uniform(%arg0: memref<?xf32>, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %0 = arith.cmpi slt, %tx, %c1 : index
+    scf.if %0 {
+      gpu.barrier
+    }
+    gpu.terminator
+  }
+  return
+}
+
+// -----
+
+// Launch for the GPU device, kept as is.
+
+// CHECK-LABEL: func @test_gpu_region
+//       CHECK: numba_util.env_region
+//       CHECK: gpu.launch
+//       CHECK: gpu.terminator
+func.func @test_gpu_region(%arg0: memref<?xf32>, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  numba_util.env_region #gpu_runtime.region_desc<device = "level_zero:gpu:0", usm_type = "device", spirv_major_version = 1, spirv_minor_version = 1, has_fp16 = true, has_fp64 = false> {
+    gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+      %0 = memref.load %arg0[%tx] : memref<?xf32>
+      memref.store %0, %arg0[%bx] : memref<?xf32>
+      gpu.terminator
+    }
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_cpu_region
+//       CHECK: numba_util.env_region
+//   CHECK-NOT: gpu.launch
+//       CHECK: scf.parallel
+//       CHECK: scf.parallel
+func.func @test_cpu_region(%arg0: memref<?xf32>, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  numba_util.env_region #gpu_runtime.region_desc<device = "opencl:cpu:0", usm_type = "device", spirv_major_version = 1, spirv_minor_version = 1, has_fp16 = true, has_fp64 = true> {
+    gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+      %0 = memref.load %arg0[%tx] : memref<?xf32>
+      memref.store %0, %arg0[%bx] : memref<?xf32>
+      gpu.terminator
+    }
+  }
+  return
+}
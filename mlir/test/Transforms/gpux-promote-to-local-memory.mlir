@@ -0,0 +1,71 @@
+// RUN: numba-mlir-opt --gpux-promote-to-local-memory --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_stencil
+//  CHECK-SAME: (%[[SRC:.*]]: memref<?xf32> {numba.restrict}, %[[DST:.*]]: memref<?xf32> {numba.restrict}, %[[GS:.*]]: index, %[[BS:.*]]: index)
+//       CHECK: %[[C2:.*]] = arith.constant 2 : index
+//       CHECK: %[[SIZE:.*]] = arith.addi %[[BS]], %[[C2]] : index
+//       CHECK: %[[LOCAL:.*]] = gpu.alloc (%[[SIZE]]) : memref<?xf32, #gpu.address_space<workgroup>>
+//       CHECK: gpu.launch
+//       CHECK: scf.for
+//       CHECK: scf.if
+//       CHECK: %[[V:.*]] = memref.load %[[SRC]]
+//       CHECK: memref.store %[[V]], %[[LOCAL]]
+//       CHECK: gpu.barrier
+//   CHECK-NOT: memref.load %[[SRC]]
+//       CHECK: memref.load %[[LOCAL]]
+//       CHECK: memref.load %[[LOCAL]]
+//       CHECK: memref.load %[[LOCAL]]
+//       CHECK: gpu.dealloc %[[LOCAL]]
+func.func @test_stencil(%arg0: memref<?xf32> {numba.restrict}, %arg1: memref<?xf32> {numba.restrict}, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %0 = arith.muli %bx, %bs : index
+    %1 = arith.addi %0, %tx : index
+    %2 = arith.subi %1, %c1 : index
+    %3 = arith.addi %1, %c1 : index
+    %4 = memref.load %arg0[%2] : memref<?xf32>
+    %5 = memref.load %arg0[%1] : memref<?xf32>
+    %6 = memref.load %arg0[%3] : memref<?xf32>
+    %7 = arith.addf %4, %5 : f32
+    %8 = arith.addf %7, %6 : f32
+    memref.store %8, %arg1[%1] : memref<?xf32>
+    gpu.terminator
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_no_reuse
+//   CHECK-NOT: gpu.alloc
+//   CHECK-NOT: gpu.barrier
+func.func @test_no_reuse(%arg0: memref<?xf32> {numba.restrict}, %arg1: memref<?xf32> {numba.restrict}, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %0 = arith.muli %bx, %bs : index
+    %1 = arith.addi %0, %tx : index
+    %2 = memref.load %arg0[%1] : memref<?xf32>
+    memref.store %2, %arg1[%1] : memref<?xf32>
+    gpu.terminator
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_aliased
+//   CHECK-NOT: gpu.alloc
+func.func @test_aliased(%arg0: memref<?xf32>, %gs: index, %bs: index) {
+  %c1 = arith.constant 1 : index
+  gpu.launch blocks(%bx, %by, %bz) in (%gx = %gs, %gy = %c1, %gz = %c1) threads(%tx, %ty, %tz) in (%sx = %bs, %sy = %c1, %sz = %c1) {
+    %0 = arith.muli %bx, %bs : index
+    %1 = arith.addi %0, %tx : index
+    %2 = arith.addi %1, %c1 : index
+    %3 = memref.load %arg0[%1] : memref<?xf32>
+    %4 = memref.load %arg0[%2] : memref<?xf32>
+    %5 = arith.addf %3, %4 : f32
+    memref.store %5, %arg0[%1] : memref<?xf32>
+    gpu.terminator
+  }
+  return
+}
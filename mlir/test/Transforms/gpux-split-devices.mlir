@@ -0,0 +1,110 @@
+// RUN: numba-mlir-opt --gpux-split-parallel-loops-for-devices --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_split
+//  CHECK-SAME: (%[[A:.*]]: memref<?xf32>, %[[B:.*]]: memref<?xf32>, %[[N:.*]]: index)
+//       CHECK:   gpu_runtime.concurrent_begin
+//       CHECK:   numba_util.env_region #gpu_runtime.region_desc<device = "gpu0", usm_type = "shared"
+//       CHECK:     %[[LB1:.*]] = arith.minsi %{{.*}}, %[[N]] : index
+//       CHECK:     %[[UB1:.*]] = arith.minsi %{{.*}}, %[[N]] : index
+//       CHECK:     scf.parallel (%[[I1:.*]], %{{.*}}) = (%[[LB1]], %{{.*}}) to (%[[UB1]], %{{.*}})
+//       CHECK:       memref.load %[[A]][%[[I1]]]
+//       CHECK:   numba_util.env_region #gpu_runtime.region_desc<device = "gpu1", usm_type = "shared"
+//       CHECK:     %[[LB2:.*]] = arith.minsi %{{.*}}, %[[N]] : index
+//       CHECK:     %[[UB2:.*]] = arith.minsi %{{.*}}, %[[N]] : index
+//       CHECK:     scf.parallel (%[[I2:.*]], %{{.*}}) = (%[[LB2]], %{{.*}}) to (%[[UB2]], %{{.*}})
+//       CHECK:       memref.load %[[A]][%[[I2]]]
+//       CHECK:   gpu_runtime.concurrent_end
+//   CHECK-NOT:   numba_util.env_region
+//       CHECK:   return
+func.func @test_split(%a: memref<?xf32>, %b: memref<?xf32>, %n: index) attributes {gpu_runtime.devices = "gpu0, gpu1"} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c4 = arith.constant 4 : index
+  numba_util.env_region #gpu_runtime.region_desc<device = "gpu0", usm_type = "shared", spirv_major_version = 1, spirv_minor_version = 2, has_fp16 = true, has_fp64 = true> {
+    scf.parallel (%i, %j) = (%c0, %c0) to (%n, %c4) step (%c1, %c1) {
+      %0 = memref.load %a[%i] : memref<?xf32>
+      memref.store %0, %b[%i] : memref<?xf32>
+    }
+  }
+  return
+}
+
+// -----
+
+// Device USM is not accessible from the other devices.
+
+// CHECK-LABEL: func @test_device_usm
+//   CHECK-NOT:   gpu_runtime.concurrent_begin
+//       CHECK:   numba_util.env_region
+//   CHECK-NOT:   numba_util.env_region
+func.func @test_device_usm(%a: memref<?xf32>, %n: index) attributes {gpu_runtime.devices = "gpu0,gpu1"} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 1.0 : f32
+  numba_util.env_region #gpu_runtime.region_desc<device = "gpu0", usm_type = "device", spirv_major_version = 1, spirv_minor_version = 2, has_fp16 = true, has_fp64 = true> {
+    scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+      memref.store %cst, %a[%i] : memref<?xf32>
+    }
+  }
+  return
+}
+
+// -----
+
+// Loops with reductions are not split.
+
+// CHECK-LABEL: func @test_reduction
+//   CHECK-NOT:   gpu_runtime.concurrent_begin
+//       CHECK:   numba_util.env_region
+//   CHECK-NOT:   numba_util.env_region
+func.func @test_reduction(%a: memref<?xf32>, %n: index) -> f32 attributes {gpu_runtime.devices = "gpu0,gpu1"} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 0.0 : f32
+  %res = numba_util.env_region #gpu_runtime.region_desc<device = "gpu0", usm_type = "shared", spirv_major_version = 1, spirv_minor_version = 2, has_fp16 = true, has_fp64 = true> -> f32 {
+    %0 = scf.parallel (%i) = (%c0) to (%n) step (%c1) init (%cst) -> f32 {
+      %1 = memref.load %a[%i] : memref<?xf32>
+      scf.reduce(%1 : f32) {
+      ^bb0(%lhs: f32, %rhs: f32):
+        %2 = arith.addf %lhs, %rhs : f32
+        scf.reduce.return %2 : f32
+      }
+    }
+    numba_util.env_region_yield %0 : f32
+  }
+  return %res : f32
+}
+
+// -----
+
+// Host part goes after the device launches and gets the adaptive share.
+
+// CHECK-LABEL: func @test_coexec
+//  CHECK-SAME: (%[[A:.*]]: memref<?xf32>, %[[B:.*]]: memref<?xf32>, %[[N:.*]]: index)
+//       CHECK:   %[[RATIO:.*]] = gpu_runtime.coexec_begin
+//       CHECK:   numba_util.env_region #gpu_runtime.region_desc<device = "gpu0", usm_type = "shared"
+//       CHECK:     arith.mulf %{{.*}}, %[[RATIO]] : f64
+//       CHECK:     %[[LB1:.*]] = arith.minsi %{{.*}}, %[[N]] : index
+//       CHECK:     %[[UB1:.*]] = arith.minsi %{{.*}}, %[[N]] : index
+//       CHECK:     scf.parallel (%[[I1:.*]]) = (%[[LB1]]) to (%[[UB1]])
+//       CHECK:       memref.load %[[A]][%[[I1]]]
+//       CHECK:   numba_util.env_region #gpu_runtime.region_desc<device = "host", usm_type = "shared"
+//       CHECK:     arith.mulf %{{.*}}, %[[RATIO]] : f64
+//       CHECK:     %[[LB2:.*]] = arith.minsi %{{.*}}, %[[N]] : index
+//       CHECK:     %[[UB2:.*]] = arith.minsi %{{.*}}, %[[N]] : index
+//       CHECK:     scf.parallel (%[[I2:.*]]) = (%[[LB2]]) to (%[[UB2]])
+//       CHECK:       memref.load %[[A]][%[[I2]]]
+//       CHECK:   gpu_runtime.coexec_end
+//   CHECK-NOT:   numba_util.env_region
+//       CHECK:   return
+func.func @test_coexec(%a: memref<?xf32>, %b: memref<?xf32>, %n: index) attributes {gpu_runtime.devices = "host, gpu0"} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  numba_util.env_region #gpu_runtime.region_desc<device = "gpu0", usm_type = "shared", spirv_major_version = 1, spirv_minor_version = 2, has_fp16 = true, has_fp64 = true> {
+    scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+      %0 = memref.load %a[%i] : memref<?xf32>
+      memref.store %0, %b[%i] : memref<?xf32>
+    }
+  }
+  return
+}
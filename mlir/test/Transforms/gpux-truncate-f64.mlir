@@ -0,0 +1,77 @@
+// RUN: numba-mlir-opt --gpux-truncate-f64 --split-input-file %s | FileCheck %s
+// RUN: numba-mlir-opt --gpux-truncate-f64 --split-input-file %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=REMARK
+
+// Mixed mode keeps f32 error term for the loop-carried sum.
+// REMARK: remark: f64 kernel demoted to f32 with compensated accumulators
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int64, Kernel], []>, #spirv.resource_limits<>>} {
+  // CHECK-LABEL: gpu.func @sum
+  //       CHECK: %{{.*}}:2 = scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%[[ACC:.*]] = %{{.*}}, %[[ERR:.*]] = %{{.*}}) -> (f32, f32) {
+  //       CHECK:   %[[Y:.*]] = arith.subf %{{.*}}, %[[ERR]] : f32
+  //       CHECK:   %[[SUM:.*]] = arith.addf %[[ACC]], %[[Y]] : f32
+  //       CHECK:   %[[DIFF:.*]] = arith.subf %[[SUM]], %[[ACC]] : f32
+  //       CHECK:   %[[NEW_ERR:.*]] = arith.subf %[[DIFF]], %[[Y]] : f32
+  //       CHECK:   scf.yield %[[SUM]], %[[NEW_ERR]] : f32, f32
+  gpu.module @kernels attributes {gpu_runtime.fp64_truncate = "mixed"} {
+    gpu.func @sum(%arg0: memref<?xf64>, %arg1: memref<?xf64>, %arg2: index) kernel {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %cst = arith.constant 0.0 : f64
+      %0 = scf.for %i = %c0 to %arg2 step %c1 iter_args(%acc = %cst) -> (f64) {
+        %1 = memref.load %arg0[%i] : memref<?xf64>
+        %2 = arith.addf %acc, %1 : f64
+        scf.yield %2 : f64
+      }
+      memref.store %0, %arg1[%c0] : memref<?xf64>
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+// Sum, which allows reassociation, is not compensated.
+// REMARK: remark: f64 kernel demoted to f32
+// REMARK-NOT: compensated
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Int64, Kernel], []>, #spirv.resource_limits<>>} {
+  // CHECK-LABEL: gpu.func @sum_reassoc
+  //       CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%{{.*}} = %{{.*}}) -> (f32) {
+  //   CHECK-NOT:   arith.subf
+  //       CHECK:   scf.yield %{{.*}} : f32
+  gpu.module @kernels attributes {gpu_runtime.fp64_truncate = "mixed"} {
+    gpu.func @sum_reassoc(%arg0: memref<?xf64>, %arg1: memref<?xf64>, %arg2: index) kernel {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %cst = arith.constant 0.0 : f64
+      %0 = scf.for %i = %c0 to %arg2 step %c1 iter_args(%acc = %cst) -> (f64) {
+        %1 = memref.load %arg0[%i] : memref<?xf64>
+        %2 = arith.addf %acc, %1 fastmath<reassoc> : f64
+        scf.yield %2 : f64
+      }
+      memref.store %0, %arg1[%c0] : memref<?xf64>
+      gpu.return
+    }
+  }
+}
+
+// -----
+
+// Devices with native fp64 keep f64 kernels.
+module attributes {gpu.container_module, spirv.target_env = #spirv.target_env<#spirv.vce<v1.0, [Addresses, Float64, Int64, Kernel], []>, #spirv.resource_limits<>>} {
+  // CHECK-LABEL: gpu.func @sum_native
+  //       CHECK: scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}} iter_args(%{{.*}} = %{{.*}}) -> (f64) {
+  //   CHECK-NOT:   arith.subf
+  gpu.module @kernels attributes {gpu_runtime.fp64_truncate = "mixed"} {
+    gpu.func @sum_native(%arg0: memref<?xf64>, %arg1: memref<?xf64>, %arg2: index) kernel {
+      %c0 = arith.constant 0 : index
+      %c1 = arith.constant 1 : index
+      %cst = arith.constant 0.0 : f64
+      %0 = scf.for %i = %c0 to %arg2 step %c1 iter_args(%acc = %cst) -> (f64) {
+        %1 = memref.load %arg0[%i] : memref<?xf64>
+        %2 = arith.addf %acc, %1 : f64
+        scf.yield %2 : f64
+      }
+      memref.store %0, %arg1[%c0] : memref<?xf64>
+      gpu.return
+    }
+  }
+}
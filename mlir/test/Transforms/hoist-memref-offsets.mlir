@@ -0,0 +1,61 @@
+// RUN: numba-mlir-opt --numba-hoist-memref-offsets --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_for
+//  CHECK-SAME: (%[[SRC:.*]]: memref<?x?xf64>, %[[DST:.*]]: memref<?x?xf64>, %[[I:.*]]: index)
+//       CHECK:   %[[D1:.*]] = memref.dim %[[SRC]], %{{.*}} : memref<?x?xf64>
+//       CHECK:   %[[SV:.*]] = memref.subview %[[SRC]][%[[I]], 0] [1, %[[D1]]] [1, 1]
+//       CHECK:   %[[D2:.*]] = memref.dim %[[DST]], %{{.*}} : memref<?x?xf64>
+//       CHECK:   %[[DV:.*]] = memref.subview %[[DST]][%[[I]], 0] [1, %[[D2]]] [1, 1]
+//       CHECK:   scf.for %[[J:.*]] =
+//       CHECK:     %[[V:.*]] = memref.load %[[SV]][%[[J]]]
+//       CHECK:     memref.store %[[V]], %[[DV]][%[[J]]]
+func.func @test_for(%arg0: memref<?x?xf64>, %arg1: memref<?x?xf64>, %i: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg1, %c1 : memref<?x?xf64>
+  scf.for %j = %c0 to %0 step %c1 {
+    %1 = memref.load %arg0[%i, %j] : memref<?x?xf64>
+    memref.store %1, %arg1[%i, %j] : memref<?x?xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_nested
+//       CHECK:   scf.parallel (%[[I:.*]]) =
+//       CHECK:     %[[SV:.*]] = memref.subview %{{.*}}[%[[I]], 0] [1, 16] [1, 1]
+//       CHECK:     scf.for %[[J:.*]] =
+//       CHECK:       memref.load %[[SV]][%[[J]]] : memref<16xf32, strided<[1], offset: ?>>
+func.func @test_nested(%arg0: memref<8x16xf32>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c8 = arith.constant 8 : index
+  %c16 = arith.constant 16 : index
+  %cst = arith.constant 1.0 : f32
+  scf.parallel (%i) = (%c0) to (%c8) step (%c1) {
+    scf.for %j = %c0 to %c16 step %c1 {
+      %1 = memref.load %arg0[%i, %j] : memref<8x16xf32>
+      %2 = arith.addf %1, %cst : f32
+      memref.store %2, %arg0[%i, %j] : memref<8x16xf32>
+    }
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_transposed
+//   CHECK-NOT:   memref.subview
+func.func @test_transposed(%arg0: memref<?x?xf64>, %i: index) -> f64 {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 0.0 : f64
+  %0 = memref.dim %arg0, %c0 : memref<?x?xf64>
+  %1 = scf.for %j = %c0 to %0 step %c1 iter_args(%acc = %cst) -> f64 {
+    %2 = memref.load %arg0[%j, %i] : memref<?x?xf64>
+    %3 = arith.addf %acc, %2 : f64
+    scf.yield %3 : f64
+  }
+  return %1 : f64
+}
@@ -0,0 +1,80 @@
+// RUN: numba-mlir-opt --numba-loop-distribution --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_nested_loop
+//  CHECK-SAME:  (%[[A:.*]]: memref<?xf32> {numba.restrict}, %[[B:.*]]: memref<?xf32> {numba.restrict}, %[[C:.*]]: memref<?xf32> {numba.restrict}, %[[N:.*]]: index)
+//       CHECK:  scf.parallel (%[[I:.*]]) =
+//       CHECK:  %[[V1:.*]] = memref.load %[[A]][%[[I]]] : memref<?xf32>
+//       CHECK:  %[[R:.*]] = arith.mulf %[[V1]], %[[V1]] : f32
+//       CHECK:  memref.store %[[R]], %[[B]][%[[I]]] : memref<?xf32>
+//   CHECK-NOT:  scf.for
+//       CHECK:  scf.reduce
+//       CHECK:  scf.parallel (%[[J:.*]]) =
+//       CHECK:  %[[V2:.*]] = memref.load %[[A]][%[[J]]] : memref<?xf32>
+//   CHECK-NOT:  memref.store
+//       CHECK:  %[[S:.*]] = scf.for {{.*}} iter_args(%{{.*}} = %[[V2]]) -> (f32)
+//       CHECK:  memref.store %[[S]], %[[C]][%[[J]]] : memref<?xf32>
+//       CHECK:  scf.reduce
+func.func @test_nested_loop(%a: memref<?xf32> {numba.restrict}, %b: memref<?xf32> {numba.restrict}, %c: memref<?xf32> {numba.restrict}, %n: index)
+    attributes {numba.vector_length = 256 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %a[%i] : memref<?xf32>
+    %1 = arith.mulf %0, %0 : f32
+    memref.store %1, %b[%i] : memref<?xf32>
+    %2 = scf.for %j = %c0 to %i step %c1 iter_args(%acc = %0) -> (f32) {
+      %3 = memref.load %a[%j] : memref<?xf32>
+      %4 = arith.addf %acc, %3 : f32
+      scf.yield %4 : f32
+    }
+    memref.store %2, %c[%i] : memref<?xf32>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+func.func private @foo(f32)
+
+// Store after the call must stay in the same loop.
+// CHECK-LABEL: func @test_call_before_store
+//       CHECK:  scf.parallel
+//       CHECK:  func.call @foo
+//       CHECK:  memref.store
+//   CHECK-NOT:  scf.parallel
+func.func @test_call_before_store(%a: memref<?xf32>, %b: memref<?xf32> {numba.restrict}, %n: index)
+    attributes {numba.vector_length = 256 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %a[%i] : memref<?xf32>
+    func.call @foo(%0) : (f32) -> ()
+    %1 = arith.mulf %0, %0 : f32
+    memref.store %1, %b[%i] : memref<?xf32>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+func.func private @foo(f32)
+
+// CHECK-LABEL: func @test_no_vector_length
+//       CHECK:  scf.parallel
+//       CHECK:  memref.store
+//       CHECK:  func.call @foo
+//   CHECK-NOT:  scf.parallel
+func.func @test_no_vector_length(%a: memref<?xf32>, %b: memref<?xf32> {numba.restrict}, %n: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %a[%i] : memref<?xf32>
+    %1 = arith.mulf %0, %0 : f32
+    memref.store %1, %b[%i] : memref<?xf32>
+    func.call @foo(%0) : (f32) -> ()
+    scf.reduce
+  }
+  return
+}
@@ -0,0 +1,70 @@
+// RUN: numba-mlir-opt --numba-loop-invariant-division --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_divsi
+//  CHECK-SAME: (%[[N:.*]]: i32, %[[D:.*]]: i32, %[[OUT:.*]]: memref<?xi32>)
+//       CHECK:   math.ctlz
+//       CHECK:   arith.divui %{{.*}}, %{{.*}} : i64
+//       CHECK:   scf.for
+//   CHECK-NOT:     arith.divsi
+//   CHECK-NOT:     arith.divui
+//       CHECK:     arith.muli %{{.*}}, %{{.*}} : i64
+//       CHECK:     arith.shrui
+//       CHECK:     memref.store
+func.func @test_divsi(%arg0: i32, %arg1: i32, %arg2: memref<?xi32>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = arith.index_cast %arg0 : i32 to index
+  scf.for %i = %c0 to %n step %c1 {
+    %0 = arith.index_cast %i : index to i32
+    %1 = arith.divsi %0, %arg1 : i32
+    memref.store %1, %arg2[%i] : memref<?xi32>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_delinearize
+//  CHECK-SAME: (%[[N:.*]]: index, %[[D:.*]]: index, %[[OUT:.*]]: memref<?x?xf32>)
+//       CHECK:   %[[DI:.*]] = arith.index_cast %[[D]] : index to i64
+//       CHECK:   math.ctlz
+//       CHECK:   arith.divui %{{.*}}, %{{.*}} : i128
+//       CHECK:   scf.parallel
+//   CHECK-NOT:     arith.floordivsi
+//   CHECK-NOT:     arith.remsi
+//   CHECK-NOT:     arith.divui
+//       CHECK:     arith.muli %{{.*}}, %{{.*}} : i128
+//       CHECK:     memref.store
+func.func @test_delinearize(%arg0: index, %arg1: index, %arg2: memref<?x?xf32>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 1.0 : f32
+  scf.parallel (%i) = (%c0) to (%arg0) step (%c1) {
+    %0 = arith.floordivsi %i, %arg1 : index
+    %1 = arith.remsi %i, %arg1 : index
+    memref.store %cst, %arg2[%0, %1] : memref<?x?xf32>
+    scf.yield
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_skip
+//       CHECK:   scf.for
+//       CHECK:     arith.divsi
+//       CHECK:     arith.remui
+func.func @test_skip(%arg0: index, %arg1: memref<?xi64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c7 = arith.constant 7 : i64
+  scf.for %i = %c0 to %arg0 step %c1 {
+    %0 = arith.index_cast %i : index to i64
+    %1 = memref.load %arg1[%i] : memref<?xi64>
+    %2 = arith.divsi %0, %c7 : i64
+    %3 = arith.remui %0, %1 : i64
+    %4 = arith.addi %2, %3 : i64
+    memref.store %4, %arg1[%i] : memref<?xi64>
+  }
+  return
+}
@@ -157,3 +157,90 @@ func.func @vector_forwarding(%in : memref<512xf32>, %out : memref<512xf32>) {
   }
   return
 }
+
+// -----
+
+// CHECK-LABEL: func @dead_store_region
+//  CHECK-SAME: (%[[ARG:.*]]: f32)
+//       CHECK: scf.for
+//       CHECK:   memref.store %[[ARG]]
+//       CHECK: scf.for
+//       CHECK:   memref.load
+//       CHECK:   "test.test"
+//       CHECK: numba_util.env_region "test" {
+//   CHECK-NOT:   memref.store
+//       CHECK: }
+//       CHECK: memref.dealloc
+func.func @dead_store_region(%arg0: f32) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c10 = arith.constant 10 : index
+  %m = memref.alloc() : memref<10xf32>
+  scf.for %i = %c0 to %c10 step %c1 {
+    memref.store %arg0, %m[%i] : memref<10xf32>
+  }
+  scf.for %i = %c0 to %c10 step %c1 {
+    %v = memref.load %m[%i] : memref<10xf32>
+    "test.test"(%v) : (f32) -> ()
+  }
+  numba_util.env_region "test" {
+    memref.store %arg0, %m[%c0] : memref<10xf32>
+  }
+  memref.dealloc %m : memref<10xf32>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @stencil_forwarding
+//  CHECK-SAME: (%[[SRC:.*]]: memref<?xf32> {numba.restrict}, %[[DST:.*]]: memref<?xf32> {numba.restrict})
+//       CHECK: %[[C1:.*]] = arith.constant 1 : index
+//       CHECK: %[[COND:.*]] = arith.cmpi slt, %[[C1]], %{{.*}} : index
+//       CHECK: scf.if %[[COND]] {
+//       CHECK:   %[[A0:.*]] = memref.load %[[SRC]][%{{.*}}] : memref<?xf32>
+//       CHECK:   %[[A1:.*]] = memref.load %[[SRC]][%[[C1]]] : memref<?xf32>
+//       CHECK:   scf.for %[[I:.*]] = %[[C1]] to %{{.*}} step %[[C1]] iter_args(%[[P0:.*]] = %[[A0]], %[[P1:.*]] = %[[A1]]) -> (f32, f32) {
+//       CHECK:     %[[IP:.*]] = arith.addi %[[I]], %[[C1]] : index
+//       CHECK:     %[[V:.*]] = memref.load %[[SRC]][%[[IP]]] : memref<?xf32>
+//       CHECK:     %[[S1:.*]] = arith.addf %[[P0]], %[[P1]] : f32
+//       CHECK:     %[[S2:.*]] = arith.addf %[[S1]], %[[V]] : f32
+//       CHECK:     memref.store %[[S2]], %[[DST]][%[[I]]] : memref<?xf32>
+//       CHECK:     scf.yield %[[P1]], %[[V]] : f32, f32
+func.func @stencil_forwarding(%arg0: memref<?xf32> {numba.restrict}, %arg1: memref<?xf32> {numba.restrict}) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg0, %c0 : memref<?xf32>
+  %1 = arith.subi %0, %c1 : index
+  scf.for %i = %c1 to %1 step %c1 {
+    %2 = arith.subi %i, %c1 : index
+    %3 = arith.addi %i, %c1 : index
+    %4 = memref.load %arg0[%2] : memref<?xf32>
+    %5 = memref.load %arg0[%i] : memref<?xf32>
+    %6 = memref.load %arg0[%3] : memref<?xf32>
+    %7 = arith.addf %4, %5 : f32
+    %8 = arith.addf %7, %6 : f32
+    memref.store %8, %arg1[%i] : memref<?xf32>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @dead_alloc_after_forwarding
+// CHECK-SAME:  (%[[ARG:.*]]: memref<10xf32>, %[[C:.*]]: f32)
+// CHECK-NOT:   memref.alloc
+// CHECK:       memref.store %[[C]], %[[ARG]][%{{.*}}]
+// CHECK-NEXT:  %[[R:.*]] = arith.addf %[[C]], %[[C]] : f32
+// CHECK-NEXT:  "test.test"(%[[R]]) : (f32) -> ()
+// CHECK-NEXT:  return
+func.func @dead_alloc_after_forwarding(%arg : memref<10xf32>, %cf : f32) {
+  %c0 = arith.constant 0 : index
+  %m = memref.alloc() : memref<10xf32>
+  memref.store %cf, %arg[%c0] : memref<10xf32>
+  %v0 = memref.load %arg[%c0] : memref<10xf32>
+  memref.store %v0, %m[%c0] : memref<10xf32>
+  %v1 = arith.addf %v0, %v0 : f32
+  "test.test"(%v1) : (f32) -> ()
+  memref.dealloc %m : memref<10xf32>
+  return
+}
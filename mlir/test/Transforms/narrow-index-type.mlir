@@ -0,0 +1,34 @@
+// RUN: numba-mlir-opt --numba-narrow-index-type --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_loop
+//       CHECK:   scf.for %[[I:.*]] = %{{.*}} to %{{.*}} step %{{.*}} : i32 {
+//       CHECK:     %[[A:.*]] = arith.addi %[[I]], %{{.*}} : i32
+//       CHECK:     %[[R:.*]] = arith.index_cast %[[A]] : i32 to index
+//       CHECK:     memref.store %{{.*}}, %{{.*}}[%[[R]]]
+func.func @test_loop(%arg1: memref<?xf32>, %arg2: f32) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c100 = arith.constant 100 : index
+  scf.for %i = %c0 to %c100 step %c1 {
+    %0 = arith.addi %i, %c1 : index
+    memref.store %arg2, %arg1[%0] : memref<?xf32>
+  }
+  return
+}
+
+// -----
+
+// Upper bound is unknown.
+
+// CHECK-LABEL: func @test_unknown
+//       CHECK:   scf.for %{{.*}} = %{{.*}} to %{{.*}} step %{{.*}} {
+//       CHECK:     arith.addi %{{.*}}, %{{.*}} : index
+func.func @test_unknown(%arg1: memref<?xf32>, %arg2: f32, %arg3: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.for %i = %c0 to %arg3 step %c1 {
+    %0 = arith.addi %i, %c1 : index
+    memref.store %arg2, %arg1[%0] : memref<?xf32>
+  }
+  return
+}
@@ -0,0 +1,97 @@
+// RUN: numba-mlir-opt --numba-optimize-allocs --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_hoist
+//  CHECK-SAME: (%[[N:.*]]: index, %[[S:.*]]: index)
+//       CHECK:   %[[A:.*]] = memref.alloc(%[[S]]) : memref<?xf64>
+//       CHECK:   scf.for
+//       CHECK:     memref.store %{{.*}}, %[[A]]
+//   CHECK-NOT:     memref.dealloc
+//       CHECK:   }
+//       CHECK:   memref.dealloc %[[A]] : memref<?xf64>
+func.func @test_hoist(%arg0: index, %arg1: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 1.0 : f64
+  scf.for %i = %c0 to %arg0 step %c1 {
+    %0 = memref.alloc(%arg1) : memref<?xf64>
+    memref.store %cst, %0[%i] : memref<?xf64>
+    memref.dealloc %0 : memref<?xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_promote
+//       CHECK:   %[[A:.*]] = memref.alloca() : memref<4xf64>
+//       CHECK:   scf.for
+//       CHECK:     memref.store %{{.*}}, %[[A]]
+//   CHECK-NOT:   memref.alloc(
+//   CHECK-NOT:   memref.dealloc
+func.func @test_promote(%arg0: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 1.0 : f64
+  scf.for %i = %c0 to %arg0 step %c1 {
+    %0 = memref.alloc() : memref<4xf64>
+    memref.store %cst, %0[%c0] : memref<4xf64>
+    memref.dealloc %0 : memref<4xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_escape
+//       CHECK:   scf.for
+//       CHECK:     %[[A:.*]] = memref.alloc() : memref<4xf64>
+//       CHECK:     func.call @use(%[[A]])
+//       CHECK:     memref.dealloc %[[A]] : memref<4xf64>
+func.func private @use(memref<4xf64>)
+
+func.func @test_escape(%arg0: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.for %i = %c0 to %arg0 step %c1 {
+    %0 = memref.alloc() : memref<4xf64>
+    func.call @use(%0) : (memref<4xf64>) -> ()
+    memref.dealloc %0 : memref<4xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_parallel
+//       CHECK:   scf.parallel
+//       CHECK:     %[[A:.*]] = memref.alloc() : memref<4xf64>
+//       CHECK:     memref.dealloc %[[A]] : memref<4xf64>
+func.func @test_parallel(%arg0: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 1.0 : f64
+  scf.parallel (%i) = (%c0) to (%arg0) step (%c1) {
+    %0 = memref.alloc() : memref<4xf64>
+    memref.store %cst, %0[%c0] : memref<4xf64>
+    memref.dealloc %0 : memref<4xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_large
+//       CHECK:   %[[A:.*]] = memref.alloc() : memref<1024xf64>
+//       CHECK:   scf.for
+//       CHECK:   memref.dealloc %[[A]] : memref<1024xf64>
+func.func @test_large(%arg0: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 1.0 : f64
+  scf.for %i = %c0 to %arg0 step %c1 {
+    %0 = memref.alloc() : memref<1024xf64>
+    memref.store %cst, %0[%c0] : memref<1024xf64>
+    memref.dealloc %0 : memref<1024xf64>
+  }
+  return
+}
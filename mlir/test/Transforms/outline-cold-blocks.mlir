@@ -0,0 +1,57 @@
+// RUN: numba-mlir-opt --numba-outline-cold-blocks --split-input-file %s | FileCheck %s
+
+llvm.func @abort()
+llvm.func @puts(!llvm.ptr) -> i32
+llvm.func @report(i64)
+llvm.mlir.global internal constant @msg("error\00") {addr_space = 0 : i32}
+
+// CHECK-LABEL: llvm.func @test_outline
+//  CHECK-SAME: (%[[COND:.*]]: i1, %[[VAL:.*]]: i64)
+//       CHECK:   llvm.cond_br %[[COND]] weights([2000, 1]), ^[[OK:.*]], ^[[ERR:.*]]
+//       CHECK: ^[[OK]]:
+//       CHECK:   llvm.return %[[VAL]] : i64
+//       CHECK: ^[[ERR]]:
+//  CHECK-NEXT:   llvm.call @test_outline.cold(%[[VAL]]) : (i64) -> ()
+//  CHECK-NEXT:   llvm.unreachable
+// CHECK-LABEL: llvm.func internal @test_outline.cold
+//  CHECK-SAME: (%[[ARG:.*]]: i64)
+//  CHECK-SAME: passthrough = ["noinline", "cold", "noreturn", "nounwind"]
+//       CHECK:   llvm.call @puts
+//       CHECK:   llvm.call @report(%[[ARG]]) : (i64) -> ()
+//       CHECK:   llvm.call @abort() : () -> ()
+//       CHECK:   llvm.unreachable
+llvm.func @test_outline(%arg0: i1, %arg1: i64) -> i64 {
+  llvm.cond_br %arg0, ^bb1, ^bb2
+^bb1:
+  llvm.return %arg1 : i64
+^bb2:
+  %0 = llvm.mlir.addressof @msg : !llvm.ptr
+  %1 = llvm.call @puts(%0) : (!llvm.ptr) -> i32
+  llvm.call @report(%arg1) : (i64) -> ()
+  llvm.call @abort() : () -> ()
+  llvm.unreachable
+}
+
+// -----
+
+llvm.func @abort()
+
+// Small block is not outlined, branch through the intermediate block is still
+// marked unlikely.
+// CHECK-LABEL: llvm.func @test_weights_only
+//       CHECK:   llvm.cond_br %{{.*}} weights([1, 2000]), ^[[ERR:.*]], ^[[OK:.*]]
+//       CHECK: ^[[ERR]]:
+//  CHECK-NEXT:   llvm.br
+//       CHECK:   llvm.call @abort() : () -> ()
+//  CHECK-NEXT:   llvm.unreachable
+//   CHECK-NOT: llvm.func internal
+llvm.func @test_weights_only(%arg0: i1) {
+  llvm.cond_br %arg0, ^bb1, ^bb3
+^bb1:
+  llvm.br ^bb2
+^bb2:
+  llvm.call @abort() : () -> ()
+  llvm.unreachable
+^bb3:
+  llvm.return
+}
@@ -0,0 +1,83 @@
+// RUN: numba-mlir-opt --numba-pack-strided-memrefs --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_reused
+//  CHECK-SAME: (%[[SRC:.*]]: memref<?xf64, strided<[3], offset: ?>>, %{{.*}}: index, %{{.*}}: index)
+//       CHECK:   %[[DST:.*]] = memref.alloc
+//       CHECK:   %[[SIZE:.*]] = memref.dim %[[SRC]], %{{.*}} : memref<?xf64, strided<[3], offset: ?>>
+//       CHECK:   %[[BUF:.*]] = memref.alloc(%[[SIZE]]) : memref<?xf64>
+//       CHECK:   scf.parallel (%[[K:.*]]) = (%{{.*}}) to (%[[SIZE]])
+//       CHECK:     %[[V:.*]] = memref.load %[[SRC]][%[[K]]] : memref<?xf64, strided<[3], offset: ?>>
+//       CHECK:     memref.store %[[V]], %[[BUF]][%[[K]]] : memref<?xf64>
+//       CHECK:   scf.parallel (%[[I:.*]], %[[J:.*]]) =
+//       CHECK:     memref.load %[[BUF]][%[[J]]] : memref<?xf64>
+//       CHECK:   return %[[DST]]
+func.func @test_reused(%arg0: memref<?xf64, strided<[3], offset: ?>>, %arg1: index, %arg2: index) -> memref<?x?xf64> {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.alloc(%arg1, %arg2) : memref<?x?xf64>
+  scf.parallel (%i, %j) = (%c0, %c0) to (%arg1, %arg2) step (%c1, %c1) {
+    %1 = memref.load %arg0[%j] : memref<?xf64, strided<[3], offset: ?>>
+    memref.store %1, %0[%i, %j] : memref<?x?xf64>
+  }
+  return %0 : memref<?x?xf64>
+}
+
+// -----
+
+// CHECK-LABEL: func @test_not_reused
+//   CHECK-NOT:   memref.alloc
+//       CHECK:   scf.parallel
+//       CHECK:     memref.load %{{.*}}[%{{.*}}] : memref<?xf64, strided<[3], offset: ?>>
+func.func @test_not_reused(%arg0: memref<?xf64, strided<[3], offset: ?>>, %arg1: memref<?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg1, %c0 : memref<?xf64>
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    %1 = memref.load %arg0[%i] : memref<?xf64, strided<[3], offset: ?>>
+    memref.store %1, %arg1[%i] : memref<?xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_may_alias
+//   CHECK-NOT:   memref.alloc
+//       CHECK:   scf.parallel
+//       CHECK:     memref.load %{{.*}}[%{{.*}}] : memref<?xf64, strided<[3], offset: ?>>
+func.func @test_may_alias(%arg0: memref<?xf64, strided<[3], offset: ?>>, %arg1: memref<?x?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg1, %c0 : memref<?x?xf64>
+  %1 = memref.dim %arg1, %c1 : memref<?x?xf64>
+  scf.parallel (%i, %j) = (%c0, %c0) to (%0, %1) step (%c1, %c1) {
+    %2 = memref.load %arg0[%j] : memref<?xf64, strided<[3], offset: ?>>
+    memref.store %2, %arg1[%i, %j] : memref<?x?xf64>
+    memref.store %2, %arg0[%i] : memref<?xf64, strided<[3], offset: ?>>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_region_result_alias
+//   CHECK-NOT:   memref.alloc(
+//       CHECK:   scf.parallel
+//       CHECK:     memref.load %{{.*}}[%{{.*}}] : memref<?xf64, strided<[3], offset: ?>>
+func.func @test_region_result_alias(%arg0: memref<?x3xf64>, %arg1: i1, %arg2: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c3 = arith.constant 3 : index
+  %0 = memref.alloc(%arg2) : memref<?x3xf64>
+  %1 = scf.if %arg1 -> memref<?x3xf64> {
+    scf.yield %0 : memref<?x3xf64>
+  } else {
+    scf.yield %arg0 : memref<?x3xf64>
+  }
+  %2 = memref.subview %1[0, 0] [%arg2, 1] [1, 1] : memref<?x3xf64> to memref<?xf64, strided<[3], offset: ?>>
+  scf.parallel (%i, %j) = (%c0, %c0) to (%c3, %arg2) step (%c1, %c1) {
+    %3 = memref.load %2[%j] : memref<?xf64, strided<[3], offset: ?>>
+    memref.store %3, %0[%j, %i] : memref<?x3xf64>
+  }
+  return
+}
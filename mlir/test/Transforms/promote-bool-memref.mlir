@@ -0,0 +1,73 @@
+// RUN: numba-mlir-opt --numba-promote-bool-memref --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_promote
+//       CHECK:   %[[M:.*]] = memref.alloc(%{{.*}}) : memref<?xi8>
+//       CHECK:   %[[V:.*]] = arith.extui %{{.*}} : i1 to i8
+//       CHECK:   memref.store %[[V]], %[[M]][%{{.*}}] : memref<?xi8>
+func.func @test_promote(%arg1: index, %arg2: i1) {
+  %0 = memref.alloc(%arg1) : memref<?xi1>
+  memref.store %arg2, %0[%arg1] : memref<?xi1>
+  memref.dealloc %0 : memref<?xi1>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_pack
+//  CHECK-SAME: (%[[SIZE:.*]]: index, %[[IDX:.*]]: index, %[[VAL:.*]]: i1)
+//       CHECK:   %[[M:.*]] = memref.alloc(%{{.*}}) : memref<?xi8>
+//       CHECK:   %[[B:.*]] = memref.load %[[M]]
+//       CHECK:   %[[B1:.*]] = arith.andi %[[B]]
+//       CHECK:   %[[B2:.*]] = arith.ori %[[B1]]
+//       CHECK:   memref.store %[[B2]], %[[M]]
+//       CHECK:   %[[R:.*]] = memref.load %[[M]]
+//       CHECK:   %[[R1:.*]] = arith.shrui %[[R]]
+//       CHECK:   %[[R2:.*]] = arith.trunci %[[R1]] : i8 to i1
+//       CHECK:   memref.dealloc %[[M]] : memref<?xi8>
+//       CHECK:   return %[[R2]], %[[SIZE]]
+func.func @test_pack(%arg1: index, %arg2: index, %arg3: i1) -> (i1, index) attributes {numba.pack_bool_arrays} {
+  %c0 = arith.constant 0 : index
+  %0 = memref.alloc(%arg1) : memref<?xi1>
+  memref.store %arg3, %0[%arg2] : memref<?xi1>
+  %1 = memref.load %0[%arg2] : memref<?xi1>
+  %2 = memref.dim %0, %c0 : memref<?xi1>
+  memref.dealloc %0 : memref<?xi1>
+  return %1, %2 : i1, index
+}
+
+// -----
+
+// CHECK-LABEL: func @test_pack_parallel
+//       CHECK:   %[[M:.*]] = memref.alloc() : memref<2xi8>
+//       CHECK:   scf.parallel
+//       CHECK:     memref.atomic_rmw andi %{{.*}}, %[[M]]
+//       CHECK:     memref.atomic_rmw ori %{{.*}}, %[[M]]
+func.func @test_pack_parallel(%arg1: i1) attributes {numba.pack_bool_arrays} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c10 = arith.constant 10 : index
+  %0 = memref.alloc() : memref<10xi1>
+  scf.parallel (%i) = (%c0) to (%c10) step (%c1) {
+    memref.store %arg1, %0[%i] : memref<10xi1>
+  }
+  memref.dealloc %0 : memref<10xi1>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_pack_vector
+//       CHECK:   %[[M:.*]] = memref.alloc() : memref<4xi8>
+//       CHECK:   %[[V:.*]] = vector.bitcast %{{.*}} : vector<16xi1> to vector<2xi8>
+//       CHECK:   vector.store %[[V]], %[[M]]
+//       CHECK:   %[[L:.*]] = vector.load %[[M]][%{{.*}}] : memref<4xi8>, vector<2xi8>
+//       CHECK:   %[[R:.*]] = vector.bitcast %[[L]] : vector<2xi8> to vector<16xi1>
+//       CHECK:   return %[[R]]
+func.func @test_pack_vector(%arg1: vector<16xi1>) -> vector<16xi1> attributes {numba.pack_bool_arrays} {
+  %c16 = arith.constant 16 : index
+  %0 = memref.alloc() : memref<32xi1>
+  vector.store %arg1, %0[%c16] : memref<32xi1>, vector<16xi1>
+  %1 = vector.load %0[%c16] : memref<32xi1>, vector<16xi1>
+  memref.dealloc %0 : memref<32xi1>
+  return %1 : vector<16xi1>
+}
@@ -0,0 +1,19 @@
+// RUN: numba-mlir-opt --numba-promote-to-parallel %s -o /dev/null 2>&1 | FileCheck %s
+
+// Only the outermost sequential loop is reported, not the nested ones.
+// CHECK: remark: Loop is not parallelized
+// CHECK-NOT: remark:
+func.func @test_nested(%a: memref<?x?xf64>, %n: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.for %i = %c1 to %n step %c1 {
+    %prev = arith.subi %i, %c1 : index
+    scf.for %j = %c0 to %n step %c1 {
+      scf.for %k = %c0 to %n step %c1 {
+        %0 = memref.load %a[%prev, %k] : memref<?x?xf64>
+        memref.store %0, %a[%i, %j] : memref<?x?xf64>
+      }
+    }
+  }
+  return
+}
@@ -373,3 +373,143 @@ func.func @test(%arg: f32, %val: f32) -> f32 {
   }
   return %0 : f32
 }
+
+// -----
+
+// CHECK-LABEL: func @test_hist
+//  CHECK-SAME: (%[[IDX:.*]]: memref<?xindex>)
+//       CHECK:  %[[C1:.*]] = arith.constant 1 : i64
+//       CHECK:  %[[HIST:.*]] = memref.alloc() : memref<16xi64>
+//       CHECK:  scf.parallel (%[[I:.*]]) =
+//       CHECK:  %[[J:.*]] = memref.load %[[IDX]][%[[I]]] : memref<?xindex>
+//       CHECK:  memref.atomic_rmw addi %[[C1]], %[[HIST]][%[[J]]] : (i64, memref<16xi64>) -> i64
+//       CHECK:  return %[[HIST]]
+func.func @test_hist(%idx: memref<?xindex>) -> memref<16xi64> attributes {numba.max_concurrency = 4 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %one = arith.constant 1 : i64
+  %hist = memref.alloc() : memref<16xi64>
+  %n = memref.dim %idx, %c0 : memref<?xindex>
+  scf.for %i = %c0 to %n step %c1 {
+    %j = memref.load %idx[%i] : memref<?xindex>
+    %0 = memref.load %hist[%j] : memref<16xi64>
+    %1 = arith.addi %0, %one : i64
+    memref.store %1, %hist[%j] : memref<16xi64>
+  }
+  return %hist : memref<16xi64>
+}
+
+// -----
+
+// Serial function, atomics would only add overhead.
+// CHECK-LABEL: func @test_hist_serial
+//   CHECK-NOT:  scf.parallel
+//   CHECK-NOT:  memref.atomic_rmw
+//       CHECK:  scf.for
+//       CHECK:  memref.load
+//       CHECK:  %[[V:.*]] = memref.load
+//       CHECK:  %[[R:.*]] = arith.addf %[[V]]
+//       CHECK:  memref.store %[[R]]
+func.func @test_hist_serial(%idx: memref<?xindex>, %val: f32) -> memref<16xf32> attributes {numba.max_concurrency = 1 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %hist = memref.alloc() : memref<16xf32>
+  %n = memref.dim %idx, %c0 : memref<?xindex>
+  scf.for %i = %c0 to %n step %c1 {
+    %j = memref.load %idx[%i] : memref<?xindex>
+    %0 = memref.load %hist[%j] : memref<16xf32>
+    %1 = arith.addf %0, %val : f32
+    memref.store %1, %hist[%j] : memref<16xf32>
+  }
+  return %hist : memref<16xf32>
+}
+
+// -----
+
+// CHECK-LABEL: func @test_hist_no_concurrency
+//   CHECK-NOT:  scf.parallel
+//   CHECK-NOT:  memref.atomic_rmw
+//       CHECK:  scf.for
+func.func @test_hist_no_concurrency(%idx: memref<?xindex>) -> memref<16xi64> {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %one = arith.constant 1 : i64
+  %hist = memref.alloc() : memref<16xi64>
+  %n = memref.dim %idx, %c0 : memref<?xindex>
+  scf.for %i = %c0 to %n step %c1 {
+    %j = memref.load %idx[%i] : memref<?xindex>
+    %0 = memref.load %hist[%j] : memref<16xi64>
+    %1 = arith.addi %0, %one : i64
+    memref.store %1, %hist[%j] : memref<16xi64>
+  }
+  return %hist : memref<16xi64>
+}
+
+// -----
+
+// CHECK-LABEL: func @test_hist_arg
+//   CHECK-NOT:  scf.parallel
+//       CHECK:  scf.for
+func.func @test_hist_arg(%idx: memref<?xindex>, %hist: memref<16xi64>) attributes {numba.max_concurrency = 4 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %one = arith.constant 1 : i64
+  %n = memref.dim %idx, %c0 : memref<?xindex>
+  scf.for %i = %c0 to %n step %c1 {
+    %j = memref.load %idx[%i] : memref<?xindex>
+    %0 = memref.load %hist[%j] : memref<16xi64>
+    %1 = arith.addi %0, %one : i64
+    memref.store %1, %hist[%j] : memref<16xi64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_hist_read
+//   CHECK-NOT:  scf.parallel
+//       CHECK:  scf.for
+func.func @test_hist_read(%idx: memref<?xindex>) -> memref<16xi64> attributes {numba.max_concurrency = 4 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %hist = memref.alloc() : memref<16xi64>
+  %n = memref.dim %idx, %c0 : memref<?xindex>
+  scf.for %i = %c0 to %n step %c1 {
+    %j = memref.load %idx[%i] : memref<?xindex>
+    %0 = memref.load %hist[%j] : memref<16xi64>
+    %1 = memref.load %hist[%c0] : memref<16xi64>
+    %2 = arith.addi %0, %1 : i64
+    memref.store %2, %hist[%j] : memref<16xi64>
+  }
+  return %hist : memref<16xi64>
+}
+
+// -----
+
+// Parfor loop is promoted and keeps its tag, loops nested in it are left
+// as decided by Numba, other loops in the function are still promoted.
+// CHECK-LABEL: func @test_parfor_loop
+//       CHECK:  scf.parallel
+//       CHECK:    scf.for
+//   CHECK-NOT:    scf.parallel
+//       CHECK:  } {numba.parfor_lowered}
+//       CHECK:  scf.parallel
+//   CHECK-NOT:  numba.parfor_lowered
+//       CHECK:  return
+func.func @test_parfor_loop(%n: index, %m: index, %init: index) -> (index, index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = scf.for %i = %c0 to %n step %c1 iter_args(%acc = %init) -> (index) {
+    %1 = scf.for %j = %c0 to %m step %c1 iter_args(%acc1 = %i) -> (index) {
+      %2 = arith.addi %acc1, %j : index
+      scf.yield %2 : index
+    }
+    %3 = arith.addi %acc, %1 : index
+    scf.yield %3 : index
+  } {numba.parfor_lowered}
+  %4 = scf.for %i = %c0 to %n step %c1 iter_args(%acc = %init) -> (index) {
+    %5 = arith.addi %acc, %i : index
+    scf.yield %5 : index
+  }
+  return %0, %4 : index, index
+}
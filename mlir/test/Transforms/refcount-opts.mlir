@@ -0,0 +1,86 @@
+// RUN: numba-mlir-opt --numba-refcount-opts --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_loop_cancel
+//  CHECK-SAME: (%[[ARG:.*]]: memref<?xf32>, %{{.*}}: index)
+//       CHECK:   scf.for
+//   CHECK-NOT:     numba_util.retain
+//       CHECK:     memref.load %[[ARG]]
+//   CHECK-NOT:     memref.dealloc
+//       CHECK:   return
+func.func @test_loop_cancel(%arg0: memref<?xf32>, %arg1: index) -> f32 {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 0.0 : f32
+  %0 = scf.for %i = %c0 to %arg1 step %c1 iter_args(%acc = %cst) -> f32 {
+    %1 = numba_util.retain %arg0 : memref<?xf32> to memref<?xf32>
+    %2 = memref.load %1[%i] : memref<?xf32>
+    %3 = arith.addf %acc, %2 : f32
+    memref.dealloc %1 : memref<?xf32>
+    scf.yield %3 : f32
+  }
+  return %0 : f32
+}
+
+// -----
+
+// CHECK-LABEL: func @test_nested_release
+//       CHECK:   numba_util.retain
+//       CHECK:   scf.if
+//       CHECK:     memref.dealloc
+//       CHECK:   memref.dealloc
+func.func @test_nested_release(%arg0: memref<?xf32>, %arg1: i1) -> f32 {
+  %c0 = arith.constant 0 : index
+  %0 = numba_util.retain %arg0 : memref<?xf32> to memref<?xf32>
+  scf.if %arg1 {
+    memref.dealloc %arg0 : memref<?xf32>
+  }
+  %1 = memref.load %0[%c0] : memref<?xf32>
+  memref.dealloc %0 : memref<?xf32>
+  return %1 : f32
+}
+
+// -----
+
+// CHECK-LABEL: func @test_local_nonatomic
+//       CHECK:   %[[A:.*]] = memref.alloc
+//       CHECK:   %[[B:.*]] = memref.alloc
+//       CHECK:   numba_util.retain %[[B]] {numba.nonatomic_refcnt}
+//       CHECK:   memref.dealloc %[[A]] {numba.nonatomic_refcnt}
+func.func @test_local_nonatomic(%arg0: index, %arg1: f32) -> memref<?xf32> {
+  %c0 = arith.constant 0 : index
+  %0 = memref.alloc(%arg0) : memref<?xf32>
+  memref.store %arg1, %0[%c0] : memref<?xf32>
+  %1 = memref.alloc(%arg0) : memref<?xf32>
+  %2 = numba_util.retain %1 : memref<?xf32> to memref<?xf32>
+  memref.copy %0, %1 : memref<?xf32> to memref<?xf32>
+  memref.dealloc %0 : memref<?xf32>
+  return %2 : memref<?xf32>
+}
+
+// -----
+
+func.func private @consume(memref<?xf32>)
+
+// CHECK-LABEL: func @test_escape_call
+//   CHECK-NOT:   numba.nonatomic_refcnt
+func.func @test_escape_call(%arg0: index) {
+  %0 = memref.alloc(%arg0) : memref<?xf32>
+  func.call @consume(%0) : (memref<?xf32>) -> ()
+  memref.dealloc %0 : memref<?xf32>
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_parallel
+//   CHECK-NOT:   numba.nonatomic_refcnt
+func.func @test_parallel(%arg0: index, %arg1: f32) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.parallel (%i) = (%c0) to (%arg0) step (%c1) {
+    %0 = memref.alloc(%arg0) : memref<?xf32>
+    memref.store %arg1, %0[%i] : memref<?xf32>
+    memref.dealloc %0 : memref<?xf32>
+  }
+  return
+}
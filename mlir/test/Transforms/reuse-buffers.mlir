@@ -0,0 +1,75 @@
+// RUN: numba-mlir-opt --numba-reuse-buffers --split-input-file %s | FileCheck %s
+
+#map = affine_map<(d0) -> (d0)>
+
+// CHECK-LABEL: func @test_reuse_input
+//  CHECK-SAME: (%[[ARG:.*]]: memref<?xf64>, %[[N:.*]]: index)
+//       CHECK:   %[[A:.*]] = memref.alloc(%[[N]]) : memref<?xf64>
+//       CHECK:   linalg.generic {{.*}} ins(%[[ARG]] : memref<?xf64>) outs(%[[A]] : memref<?xf64>)
+//   CHECK-NOT:   memref.alloc
+//       CHECK:   linalg.generic {{.*}} ins(%[[A]], %[[ARG]] : memref<?xf64>, memref<?xf64>) outs(%[[A]] : memref<?xf64>)
+//       CHECK:   return %[[A]]
+func.func @test_reuse_input(%arg0: memref<?xf64>, %arg1: index) -> memref<?xf64> {
+  %0 = memref.alloc(%arg1) : memref<?xf64>
+  linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : memref<?xf64>) outs(%0 : memref<?xf64>) {
+  ^bb0(%in: f64, %out: f64):
+    %2 = arith.addf %in, %in : f64
+    linalg.yield %2 : f64
+  }
+  %1 = memref.alloc(%arg1) : memref<?xf64>
+  linalg.generic {indexing_maps = [#map, #map, #map], iterator_types = ["parallel"]} ins(%0, %arg0 : memref<?xf64>, memref<?xf64>) outs(%1 : memref<?xf64>) {
+  ^bb0(%in: f64, %in_1: f64, %out: f64):
+    %2 = arith.addf %in, %in_1 : f64
+    linalg.yield %2 : f64
+  }
+  return %1 : memref<?xf64>
+}
+
+// -----
+
+#map = affine_map<(d0) -> (d0)>
+
+// CHECK-LABEL: func @test_reuse_dead
+//       CHECK:   %[[A:.*]] = memref.alloc() : memref<16xf64>
+//       CHECK:   linalg.generic {{.*}} outs(%[[A]] : memref<16xf64>)
+//       CHECK:   %[[V:.*]] = memref.load %[[A]]
+//   CHECK-NOT:   memref.alloc
+//       CHECK:   linalg.generic {{.*}} ins(%{{.*}} : memref<16xf64>) outs(%[[A]] : memref<16xf64>)
+//       CHECK:   return %[[V]], %[[A]]
+func.func @test_reuse_dead(%arg0: memref<16xf64>) -> (f64, memref<16xf64>) {
+  %c0 = arith.constant 0 : index
+  %0 = memref.alloc() : memref<16xf64>
+  linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : memref<16xf64>) outs(%0 : memref<16xf64>) {
+  ^bb0(%in: f64, %out: f64):
+    %2 = arith.addf %in, %in : f64
+    linalg.yield %2 : f64
+  }
+  %v = memref.load %0[%c0] : memref<16xf64>
+  %1 = memref.alloc() : memref<16xf64>
+  linalg.generic {indexing_maps = [#map, #map], iterator_types = ["parallel"]} ins(%arg0 : memref<16xf64>) outs(%1 : memref<16xf64>) {
+  ^bb0(%in: f64, %out: f64):
+    %2 = arith.mulf %in, %in : f64
+    linalg.yield %2 : f64
+  }
+  return %v, %1 : f64, memref<16xf64>
+}
+
+// -----
+
+#map = affine_map<(d0, d1) -> (d0, d1)>
+#map1 = affine_map<(d0, d1) -> (d1, d0)>
+
+// CHECK-LABEL: func @test_no_reuse_transposed
+//       CHECK:   %[[A:.*]] = memref.alloc() : memref<16x16xf64>
+//       CHECK:   %[[B:.*]] = memref.alloc() : memref<16x16xf64>
+//       CHECK:   linalg.generic {{.*}} ins(%[[A]] : memref<16x16xf64>) outs(%[[B]] : memref<16x16xf64>)
+func.func @test_no_reuse_transposed(%arg0: memref<16x16xf64>) -> memref<16x16xf64> {
+  %0 = memref.alloc() : memref<16x16xf64>
+  memref.copy %arg0, %0 : memref<16x16xf64> to memref<16x16xf64>
+  %1 = memref.alloc() : memref<16x16xf64>
+  linalg.generic {indexing_maps = [#map1, #map], iterator_types = ["parallel", "parallel"]} ins(%0 : memref<16x16xf64>) outs(%1 : memref<16x16xf64>) {
+  ^bb0(%in: f64, %out: f64):
+    linalg.yield %in : f64
+  }
+  return %1 : memref<16x16xf64>
+}
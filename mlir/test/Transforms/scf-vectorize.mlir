@@ -0,0 +1,461 @@
+// RUN: numba-mlir-opt --numba-scf-vectorize --split-input-file %s | FileCheck %s
+// RUN: numba-mlir-opt --numba-scf-vectorize --split-input-file %s -o /dev/null 2>&1 | FileCheck %s --check-prefix=REMARK
+
+// Histogram update, lanes with the same bin are updated one after another.
+// CHECK-LABEL: func @test_scatter_update
+//  CHECK-SAME:  (%[[A:.*]]: memref<?xf32>, %[[HIST:.*]]: memref<?xf32>, %[[SCALE:.*]]: f32)
+//       CHECK:  scf.parallel
+//       CHECK:  %[[MASK:.*]] = vector.create_mask %{{.*}} : vector<8xi1>
+//       CHECK:  vector.maskedload %[[A]]
+//       CHECK:  %[[IDX:.*]] = arith.index_cast %{{.*}} : vector<8xi32> to vector<8xindex>
+//       CHECK:  %[[W:.*]] = arith.addf %{{.*}}, %{{.*}} : vector<8xf32>
+//       CHECK:  %[[FALSE:.*]] = arith.constant dense<false> : vector<8xi1>
+//       CHECK:  %[[TRUE:.*]] = arith.constant dense<true> : vector<8xi1>
+//       CHECK:  scf.while (%[[REM:.*]] = %[[MASK]]) : (vector<8xi1>) -> vector<8xi1> {
+//       CHECK:  %[[ANY:.*]] = vector.reduction <or>, %[[REM]] : vector<8xi1> into i1
+//       CHECK:  scf.condition(%[[ANY]]) %[[REM]] : vector<8xi1>
+//       CHECK:  } do {
+//       CHECK:  ^bb0(%[[REM2:.*]]: vector<8xi1>):
+//       CHECK:  %[[PREV:.*]] = vector.shuffle %[[IDX]], %[[IDX]] [0, 0, 1, 2, 3, 4, 5, 6] : vector<8xindex>, vector<8xindex>
+//       CHECK:  %[[PREV_REM:.*]] = vector.shuffle %[[REM2]], %[[FALSE]] [8, 0, 1, 2, 3, 4, 5, 6] : vector<8xi1>, vector<8xi1>
+//       CHECK:  %[[SAME:.*]] = arith.cmpi eq, %[[IDX]], %[[PREV]] : vector<8xindex>
+//       CHECK:  arith.andi %[[SAME]], %[[PREV_REM]] : vector<8xi1>
+//       CHECK:  vector.shuffle %[[IDX]], %[[IDX]] [0, 1, 2, 3, 4, 5, 6, 0] : vector<8xindex>, vector<8xindex>
+//       CHECK:  vector.shuffle %[[REM2]], %[[FALSE]] [8, 9, 10, 11, 12, 13, 14, 0] : vector<8xi1>, vector<8xi1>
+//       CHECK:  %[[CONF:.*]] = arith.ori %{{.*}}, %{{.*}} : vector<8xi1>
+//       CHECK:  %[[FREE:.*]] = arith.xori %[[CONF]], %[[TRUE]] : vector<8xi1>
+//       CHECK:  %[[ACTIVE:.*]] = arith.andi %[[REM2]], %[[FREE]] : vector<8xi1>
+//       CHECK:  %[[OLD:.*]] = vector.gather %[[HIST]][%{{.*}}] [%[[IDX]]], %[[ACTIVE]], %{{.*}} : memref<?xf32>, vector<8xindex>, vector<8xi1>, vector<8xf32> into vector<8xf32>
+//       CHECK:  %[[NEW:.*]] = arith.addf %[[OLD]], %[[W]] : vector<8xf32>
+//       CHECK:  vector.scatter %[[HIST]][%{{.*}}] [%[[IDX]]], %[[ACTIVE]], %[[NEW]] : memref<?xf32>, vector<8xindex>, vector<8xi1>, vector<8xf32>
+//       CHECK:  %[[NEXT:.*]] = arith.xori %[[REM2]], %[[ACTIVE]] : vector<8xi1>
+//       CHECK:  scf.yield %[[NEXT]] : vector<8xi1>
+//   CHECK-NOT:  memref.store
+//       CHECK:  scf.reduce
+func.func @test_scatter_update(%a: memref<?xf32>, %hist: memref<?xf32>, %scale: f32)
+    attributes {numba.vector_length = 512 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %a, %c0 : memref<?xf32>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %v = memref.load %a[%i] : memref<?xf32>
+    %0 = arith.mulf %v, %scale : f32
+    %1 = arith.fptosi %0 : f32 to i32
+    %j = arith.index_cast %1 : i32 to index
+    %2 = arith.mulf %v, %v : f32
+    %w = arith.addf %2, %scale : f32
+    %3 = memref.load %hist[%j] : memref<?xf32>
+    %4 = arith.addf %3, %w : f32
+    memref.store %4, %hist[%j] : memref<?xf32>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+// Multidimensional gather, indices are linearized with the memref sizes.
+// CHECK-LABEL: func @test_gather_2d
+//  CHECK-SAME:  (%[[A:.*]]: memref<?x?xf32>, %[[I0:.*]]: memref<?xindex>, %[[I1:.*]]: memref<?xindex>, %[[RES:.*]]: memref<?xf32>)
+//       CHECK:  scf.parallel
+//       CHECK:  %[[X:.*]] = vector.maskedload %[[I0]]
+//       CHECK:  %[[Y:.*]] = vector.maskedload %[[I1]]
+//       CHECK:  %[[DIM:.*]] = memref.dim %[[A]], %{{.*}} : memref<?x?xf32>
+//       CHECK:  %[[SIZE:.*]] = vector.splat %[[DIM]] : vector<8xindex>
+//       CHECK:  %[[ROW:.*]] = arith.muli %[[X]], %[[SIZE]] : vector<8xindex>
+//       CHECK:  %[[OFF:.*]] = arith.addi %[[ROW]], %[[Y]] : vector<8xindex>
+//       CHECK:  %[[V:.*]] = vector.gather %[[A]][%[[Z:.*]], %[[Z]]] [%[[OFF]]], %{{.*}}, %{{.*}} : memref<?x?xf32>, vector<8xindex>, vector<8xi1>, vector<8xf32> into vector<8xf32>
+//       CHECK:  %[[R:.*]] = arith.mulf %[[V]], %[[V]] : vector<8xf32>
+//       CHECK:  vector.maskedstore %[[RES]][%{{.*}}], %{{.*}}, %[[R]]
+func.func @test_gather_2d(%a: memref<?x?xf32>, %i0: memref<?xindex>, %i1: memref<?xindex>, %res: memref<?xf32>)
+    attributes {numba.vector_length = 512 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %res, %c0 : memref<?xf32>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %x = memref.load %i0[%i] : memref<?xindex>
+    %y = memref.load %i1[%i] : memref<?xindex>
+    %0 = memref.load %a[%x, %y] : memref<?x?xf32>
+    %1 = arith.mulf %0, %0 : f32
+    memref.store %1, %res[%i] : memref<?xf32>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+// Dimension with contiguous accesses is selected, the other one would need
+// gather and scatter. Small loop is interleaved to fill vector registers.
+// REMARK: remark: Loop vectorized: dim 0, factor 16, interleave 4, masked true, {{.*}} cost 3 scalar vs 3 vector
+// CHECK-LABEL: func @test_select_dim
+//  CHECK-SAME:  (%[[A:.*]]: memref<?x?xf32>, %[[B:.*]]: memref<?x?xf32>)
+//       CHECK:  scf.parallel
+//       CHECK:  vector.maskedload %[[A]]{{.*}} into vector<64xf32>
+//       CHECK:  vector.maskedstore %[[B]]{{.*}} : memref<?x?xf32>, vector<64xi1>, vector<64xf32>
+//   CHECK-NOT:  vector.gather
+//       CHECK:  } {numba.vectorized}
+func.func @test_select_dim(%a: memref<?x?xf32>, %b: memref<?x?xf32>)
+    attributes {numba.vector_length = 512 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 1.0 : f32
+  %m = memref.dim %a, %c0 : memref<?x?xf32>
+  %n = memref.dim %a, %c1 : memref<?x?xf32>
+  scf.parallel (%i, %j) = (%c0, %c0) to (%n, %m) step (%c1, %c1) {
+    %0 = memref.load %a[%j, %i] : memref<?x?xf32>
+    %1 = arith.addf %0, %cst : f32
+    memref.store %1, %b[%j, %i] : memref<?x?xf32>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+// Gather is cheap enough on AVX-512.
+// REMARK: remark: Loop vectorized: dim 0, factor 8, {{.*}} 1 gathers, {{.*}} cost 3 scalar vs 18 vector
+// CHECK-LABEL: func @test_gather_avx512
+//  CHECK-SAME:  (%[[A:.*]]: memref<?xf32>, %[[I:.*]]: memref<?xindex>, %[[RES:.*]]: memref<?xf32>)
+//       CHECK:  scf.parallel
+//       CHECK:  vector.gather %[[A]]{{.*}} into vector<8xf32>
+func.func @test_gather_avx512(%a: memref<?xf32>, %idx: memref<?xindex>, %res: memref<?xf32>)
+    attributes {numba.vector_length = 512 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %res, %c0 : memref<?xf32>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %j = memref.load %idx[%i] : memref<?xindex>
+    %0 = memref.load %a[%j] : memref<?xf32>
+    memref.store %0, %res[%i] : memref<?xf32>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+// Same loop is not profitable with emulated gather and masked accesses.
+// REMARK: remark: Loop is not vectorized, not profitable: dim 0, factor 2, {{.*}} 1 gathers, {{.*}} cost 3 scalar vs 16 vector
+// CHECK-LABEL: func @test_gather_sse
+//   CHECK-NOT:  vector.
+//       CHECK:  return
+func.func @test_gather_sse(%a: memref<?xf32>, %idx: memref<?xindex>, %res: memref<?xf32>)
+    attributes {numba.vector_length = 128 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %res, %c0 : memref<?xf32>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %j = memref.load %idx[%i] : memref<?xindex>
+    %0 = memref.load %a[%j] : memref<?xf32>
+    memref.store %0, %res[%i] : memref<?xf32>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+// Stencil rows are unrolled and jammed, instead of interleaving the
+// vectorized dimension. Remaining rows are processed by the vectorized loop.
+// REMARK: remark: Loop vectorized: dim 1, factor 8, interleave 1, masked true, unroll-and-jam dim 0 by 4,
+// CHECK-LABEL: func @test_stencil_unroll_and_jam
+//  CHECK-SAME:  (%[[A:.*]]: memref<?x?xf64>, %[[B:.*]]: memref<?x?xf64>)
+//       CHECK:  %[[C4:.*]] = arith.constant 4 : index
+//       CHECK:  scf.parallel (%[[I:.*]], %{{.*}}) =
+//       CHECK:    arith.muli %[[I]], %[[C4]] : index
+// CHECK-COUNT-4:    vector.maskedstore %[[B]]{{.*}} : memref<?x?xf64>, vector<8xi1>, vector<8xf64>
+//       CHECK:    scf.reduce
+//       CHECK:  } {numba.vectorized}
+//       CHECK:  scf.parallel
+//       CHECK:    vector.maskedstore %[[B]]
+//   CHECK-NOT:    vector.maskedstore
+//       CHECK:  } {numba.vectorized}
+func.func @test_stencil_unroll_and_jam(%a: memref<?x?xf64>, %b: memref<?x?xf64>)
+    attributes {numba.vector_length = 512 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %m = memref.dim %a, %c0 : memref<?x?xf64>
+  %n = memref.dim %a, %c1 : memref<?x?xf64>
+  %m1 = arith.subi %m, %c1 : index
+  scf.parallel (%i, %j) = (%c1, %c0) to (%m1, %n) step (%c1, %c1) {
+    %im1 = arith.subi %i, %c1 : index
+    %ip1 = arith.addi %i, %c1 : index
+    %0 = memref.load %a[%im1, %j] : memref<?x?xf64>
+    %1 = memref.load %a[%i, %j] : memref<?x?xf64>
+    %2 = memref.load %a[%ip1, %j] : memref<?x?xf64>
+    %3 = arith.addf %0, %1 : f64
+    %4 = arith.addf %3, %2 : f64
+    memref.store %4, %b[%i, %j] : memref<?x?xf64>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+// Reassociating sum keeps vector accumulator and is reduced once after the
+// loop.
+// CHECK-LABEL: func @test_reduce_accumulator
+//  CHECK-SAME:  (%[[A:.*]]: memref<?xf32>)
+//       CHECK:  %[[INIT:.*]] = arith.constant 1.000000e+00 : f32
+//       CHECK:  %[[ZERO:.*]] = arith.constant 0.000000e+00 : f32
+//       CHECK:  %[[NEUTRAL:.*]] = vector.splat %[[ZERO]] : vector<16xf32>
+//       CHECK:  %[[RES:.*]] = scf.parallel ({{.*}}) = ({{.*}}) to ({{.*}}) step ({{.*}}) init (%[[NEUTRAL]]) -> vector<16xf32> {
+//       CHECK:    %[[V:.*]] = vector.maskedload %[[A]]
+//       CHECK:    %[[SEL:.*]] = arith.select %{{.*}}, %[[V]], %[[NEUTRAL]] : vector<16xi1>, vector<16xf32>
+//   CHECK-NOT:    vector.reduction
+//       CHECK:    scf.reduce(%[[SEL]] : vector<16xf32>) {
+//       CHECK:      arith.addf %{{.*}}, %{{.*}} fastmath<reassoc> : vector<16xf32>
+//       CHECK:  } {numba.vectorized}
+//       CHECK:  %[[SUM:.*]] = vector.reduction <add>, %[[RES]], %[[INIT]] fastmath<reassoc> : vector<16xf32> into f32
+//       CHECK:  return %[[SUM]]
+func.func @test_reduce_accumulator(%a: memref<?xf32>) -> f32
+    attributes {numba.vector_length = 256 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %init = arith.constant 1.0 : f32
+  %n = memref.dim %a, %c0 : memref<?xf32>
+  %res = scf.parallel (%i) = (%c0) to (%n) step (%c1) init(%init) -> f32 {
+    %0 = memref.load %a[%i] : memref<?xf32>
+    scf.reduce(%0 : f32) {
+    ^bb0(%lhs: f32, %rhs: f32):
+      %1 = arith.addf %lhs, %rhs fastmath<reassoc> : f32
+      scf.reduce.return %1 : f32
+    }
+  }
+  return %res : f32
+}
+
+// -----
+
+// Float sum without reassoc flag is reduced in order every iteration.
+// CHECK-LABEL: func @test_reduce_ordered
+//       CHECK:  scf.parallel ({{.*}}) = ({{.*}}) to ({{.*}}) step ({{.*}}) init (%{{.*}}) -> f32 {
+//       CHECK:    %[[R:.*]] = vector.reduction <add>, %{{.*}} : vector<16xf32> into f32
+//       CHECK:    scf.reduce(%[[R]] : f32) {
+//       CHECK:  } {numba.vectorized}
+//   CHECK-NOT:  vector.reduction
+//       CHECK:  return
+func.func @test_reduce_ordered(%a: memref<?xf32>) -> f32
+    attributes {numba.vector_length = 256 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %init = arith.constant 1.0 : f32
+  %n = memref.dim %a, %c0 : memref<?xf32>
+  %res = scf.parallel (%i) = (%c0) to (%n) step (%c1) init(%init) -> f32 {
+    %0 = memref.load %a[%i] : memref<?xf32>
+    scf.reduce(%0 : f32) {
+    ^bb0(%lhs: f32, %rhs: f32):
+      %1 = arith.addf %lhs, %rhs : f32
+      scf.reduce.return %1 : f32
+    }
+  }
+  return %res : f32
+}
+
+// -----
+
+// Min reduction keeps vector accumulator, initialized with +inf.
+// CHECK-LABEL: func @test_reduce_min
+//  CHECK-SAME:  (%[[A:.*]]: memref<?xf32>, %[[INIT:.*]]: f32)
+//       CHECK:  %[[INF:.*]] = arith.constant 0x7F800000 : f32
+//       CHECK:  %[[NEUTRAL:.*]] = vector.splat %[[INF]] : vector<16xf32>
+//       CHECK:  %[[RES:.*]] = scf.parallel ({{.*}}) = ({{.*}}) to ({{.*}}) step ({{.*}}) init (%[[NEUTRAL]]) -> vector<16xf32> {
+//       CHECK:      arith.minimumf %{{.*}}, %{{.*}} : vector<16xf32>
+//       CHECK:  } {numba.vectorized}
+//       CHECK:  %[[MIN:.*]] = vector.reduction <minimumf>, %[[RES]], %[[INIT]] : vector<16xf32> into f32
+//       CHECK:  return %[[MIN]]
+func.func @test_reduce_min(%a: memref<?xf32>, %init: f32) -> f32
+    attributes {numba.vector_length = 256 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %a, %c0 : memref<?xf32>
+  %res = scf.parallel (%i) = (%c0) to (%n) step (%c1) init(%init) -> f32 {
+    %0 = memref.load %a[%i] : memref<?xf32>
+    scf.reduce(%0 : f32) {
+    ^bb0(%lhs: f32, %rhs: f32):
+      %1 = arith.minimumf %lhs, %rhs : f32
+      scf.reduce.return %1 : f32
+    }
+  }
+  return %res : f32
+}
+
+// -----
+
+// Complex values are kept as separate vectors of real and imaginary parts,
+// interleaved parts are accessed through the memref bitcast view. Complex
+// multiplication with `contract` flag uses fma.
+// REMARK: remark: Loop vectorized: dim 0, factor 8, interleave 2, masked true, {{.*}} 0 replicated
+// CHECK-LABEL: func @test_complex_mul_add
+//  CHECK-SAME:  (%[[A:.*]]: memref<?xcomplex<f32>>, %[[B:.*]]: memref<?xcomplex<f32>>, %[[C:.*]]: complex<f32>, %[[RES:.*]]: memref<?xcomplex<f32>>)
+//       CHECK:  %[[VIEW_A:.*]] = numba_util.memref_bitcast %[[A]] : memref<?xcomplex<f32>> to memref<?xf32>
+//       CHECK:  %[[VIEW_B:.*]] = numba_util.memref_bitcast %[[B]] : memref<?xcomplex<f32>> to memref<?xf32>
+//       CHECK:  %[[VIEW_RES:.*]] = numba_util.memref_bitcast %[[RES]] : memref<?xcomplex<f32>> to memref<?xf32>
+//       CHECK:  scf.parallel
+//       CHECK:    %[[MASK:.*]] = vector.create_mask %{{.*}} : vector<32xi1>
+//       CHECK:    %[[VA:.*]] = vector.maskedload %[[VIEW_A]][%{{.*}}], %[[MASK]], %{{.*}} : memref<?xf32>, vector<32xi1>, vector<32xf32> into vector<32xf32>
+//       CHECK:    %[[A_RE:.*]] = vector.shuffle %[[VA]], %[[VA]] [0, 2, 4, {{.*}}, 30] : vector<32xf32>, vector<32xf32>
+//       CHECK:    %[[A_IM:.*]] = vector.shuffle %[[VA]], %[[VA]] [1, 3, 5, {{.*}}, 31] : vector<32xf32>, vector<32xf32>
+//       CHECK:    %[[VB:.*]] = vector.maskedload %[[VIEW_B]][%{{.*}}], %[[MASK]], %{{.*}} : memref<?xf32>, vector<32xi1>, vector<32xf32> into vector<32xf32>
+//       CHECK:    %[[B_RE:.*]] = vector.shuffle %[[VB]], %[[VB]] [0, 2, 4, {{.*}}, 30] : vector<32xf32>, vector<32xf32>
+//       CHECK:    %[[B_IM:.*]] = vector.shuffle %[[VB]], %[[VB]] [1, 3, 5, {{.*}}, 31] : vector<32xf32>, vector<32xf32>
+//       CHECK:    %[[IM_IM:.*]] = arith.mulf %[[A_IM]], %[[B_IM]] fastmath<contract> : vector<16xf32>
+//       CHECK:    %[[NEG:.*]] = arith.negf %[[IM_IM]] fastmath<contract> : vector<16xf32>
+//       CHECK:    %[[MUL_RE:.*]] = vector.fma %[[A_RE]], %[[B_RE]], %[[NEG]] : vector<16xf32>
+//       CHECK:    %[[IM_RE:.*]] = arith.mulf %[[A_IM]], %[[B_RE]] fastmath<contract> : vector<16xf32>
+//       CHECK:    %[[MUL_IM:.*]] = vector.fma %[[A_RE]], %[[B_IM]], %[[IM_RE]] : vector<16xf32>
+//       CHECK:    %[[C_RE:.*]] = complex.re %[[C]] : complex<f32>
+//       CHECK:    %[[C_IM:.*]] = complex.im %[[C]] : complex<f32>
+//       CHECK:    %[[C_RE_VEC:.*]] = vector.splat %[[C_RE]] : vector<16xf32>
+//       CHECK:    %[[C_IM_VEC:.*]] = vector.splat %[[C_IM]] : vector<16xf32>
+//       CHECK:    %[[RE:.*]] = arith.addf %[[MUL_RE]], %[[C_RE_VEC]] : vector<16xf32>
+//       CHECK:    %[[IM:.*]] = arith.addf %[[MUL_IM]], %[[C_IM_VEC]] : vector<16xf32>
+//       CHECK:    %[[V:.*]] = vector.shuffle %[[RE]], %[[IM]] [0, 16, 1, 17, {{.*}}, 15, 31] : vector<16xf32>, vector<16xf32>
+//       CHECK:    vector.maskedstore %[[VIEW_RES]][%{{.*}}], %[[MASK]], %[[V]] : memref<?xf32>, vector<32xi1>, vector<32xf32>
+//       CHECK:  } {numba.vectorized}
+//   CHECK-NOT:  complex.mul
+//       CHECK:  return
+func.func @test_complex_mul_add(%a: memref<?xcomplex<f32>>, %b: memref<?xcomplex<f32>>, %c: complex<f32>, %res: memref<?xcomplex<f32>>)
+    attributes {numba.vector_length = 256 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %a, %c0 : memref<?xcomplex<f32>>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %a[%i] : memref<?xcomplex<f32>>
+    %1 = memref.load %b[%i] : memref<?xcomplex<f32>>
+    %2 = complex.mul %0, %1 fastmath<contract> : complex<f32>
+    %3 = complex.add %2, %c : complex<f32>
+    memref.store %3, %res[%i] : memref<?xcomplex<f32>>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+// Fast division `a * conj(b) / |b|^2` is only used with `ninf` and `arcp`
+// flags.
+// REMARK: remark: Loop vectorized: dim 0, factor 8, interleave 2, masked true, {{.*}} 0 replicated
+// CHECK-LABEL: func @test_complex_div_fast
+//       CHECK:  scf.parallel
+//       CHECK:    %[[MASK:.*]] = vector.create_mask %{{.*}} : vector<32xi1>
+//       CHECK:    vector.maskedload %{{.*}}, %[[MASK]], %{{.*}} into vector<32xf32>
+//       CHECK:    %[[VB:.*]] = vector.maskedload %{{.*}}, %[[MASK]], %{{.*}} into vector<32xf32>
+//       CHECK:    %[[B_RE:.*]] = vector.shuffle %[[VB]], %[[VB]] [0, 2, 4, {{.*}}] : vector<32xf32>, vector<32xf32>
+//       CHECK:    %[[B_IM:.*]] = vector.shuffle %[[VB]], %[[VB]] [1, 3, 5, {{.*}}] : vector<32xf32>, vector<32xf32>
+//       CHECK:    %[[ONE:.*]] = vector.splat %{{.*}} : vector<16xf32>
+//       CHECK:    %[[IM2:.*]] = arith.mulf %[[B_IM]], %[[B_IM]] fastmath<ninf,arcp> : vector<16xf32>
+//       CHECK:    %[[RE2:.*]] = arith.mulf %[[B_RE]], %[[B_RE]] fastmath<ninf,arcp> : vector<16xf32>
+//       CHECK:    %[[DENOM:.*]] = arith.addf %[[RE2]], %[[IM2]] fastmath<ninf,arcp> : vector<16xf32>
+//       CHECK:    %[[SCALE:.*]] = arith.divf %[[ONE]], %[[DENOM]] fastmath<ninf,arcp> : vector<16xf32>
+//       CHECK:    arith.mulf %{{.*}}, %[[SCALE]] fastmath<ninf,arcp> : vector<16xf32>
+//       CHECK:    arith.mulf %{{.*}}, %[[SCALE]] fastmath<ninf,arcp> : vector<16xf32>
+//       CHECK:    vector.maskedstore %{{.*}}, %[[MASK]], %{{.*}} : memref<?xf32>, vector<32xi1>, vector<32xf32>
+//       CHECK:  } {numba.vectorized}
+//   CHECK-NOT:  complex.div
+//       CHECK:  return
+func.func @test_complex_div_fast(%a: memref<?xcomplex<f32>>, %b: memref<?xcomplex<f32>>, %res: memref<?xcomplex<f32>>)
+    attributes {numba.vector_length = 256 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %a, %c0 : memref<?xcomplex<f32>>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %a[%i] : memref<?xcomplex<f32>>
+    %1 = memref.load %b[%i] : memref<?xcomplex<f32>>
+    %2 = complex.div %0, %1 fastmath<ninf,arcp> : complex<f32>
+    memref.store %2, %res[%i] : memref<?xcomplex<f32>>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+// Division without fastmath flags is replicated and keeps the full-range
+// scalar lowering, so the loop is not masked and the original loop handles
+// the remainder.
+// REMARK: remark: Loop vectorized: dim 0, factor 8, interleave 1, masked false, {{.*}} 1 replicated
+// CHECK-LABEL: func @test_complex_div_slow
+//  CHECK-SAME:  (%[[A:.*]]: memref<?xcomplex<f32>>, %[[B:.*]]: memref<?xcomplex<f32>>, %[[RES:.*]]: memref<?xcomplex<f32>>)
+//       CHECK:  %[[VIEW_A:.*]] = numba_util.memref_bitcast %[[A]] : memref<?xcomplex<f32>> to memref<?xf32>
+//       CHECK:  scf.parallel
+//   CHECK-NOT:    vector.create_mask
+//       CHECK:    %[[VA:.*]] = vector.load %[[VIEW_A]][%{{.*}}] : memref<?xf32>, vector<16xf32>
+//       CHECK:    vector.shuffle %[[VA]], %[[VA]] [0, 2, 4, 6, 8, 10, 12, 14] : vector<16xf32>, vector<16xf32>
+//       CHECK:    vector.shuffle %[[VA]], %[[VA]] [1, 3, 5, 7, 9, 11, 13, 15] : vector<16xf32>, vector<16xf32>
+//       CHECK:    vector.load %{{.*}}[%{{.*}}] : memref<?xf32>, vector<16xf32>
+//       CHECK:    complex.create %{{.*}}, %{{.*}} : complex<f32>
+// CHECK-COUNT-8:    complex.div %{{.*}}, %{{.*}} : complex<f32>
+//   CHECK-NOT:    complex.div
+//       CHECK:    vector.shuffle %{{.*}}, %{{.*}} [0, 8, 1, 9, 2, 10, 3, 11, 4, 12, 5, 13, 6, 14, 7, 15] : vector<8xf32>, vector<8xf32>
+//       CHECK:    vector.store %{{.*}}, %{{.*}}[%{{.*}}] : memref<?xf32>, vector<16xf32>
+//       CHECK:  } {numba.vectorized}
+//       CHECK:  scf.parallel
+//       CHECK:    %[[X:.*]] = memref.load %[[A]][%{{.*}}] : memref<?xcomplex<f32>>
+//       CHECK:    %[[Y:.*]] = memref.load %[[B]][%{{.*}}] : memref<?xcomplex<f32>>
+//       CHECK:    %[[Z:.*]] = complex.div %[[X]], %[[Y]] : complex<f32>
+//       CHECK:    memref.store %[[Z]], %[[RES]][%{{.*}}] : memref<?xcomplex<f32>>
+//       CHECK:  } {numba.vectorized}
+func.func @test_complex_div_slow(%a: memref<?xcomplex<f32>>, %b: memref<?xcomplex<f32>>, %res: memref<?xcomplex<f32>>)
+    attributes {numba.vector_length = 256 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %a, %c0 : memref<?xcomplex<f32>>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %a[%i] : memref<?xcomplex<f32>>
+    %1 = memref.load %b[%i] : memref<?xcomplex<f32>>
+    %2 = complex.div %0, %1 : complex<f32>
+    memref.store %2, %res[%i] : memref<?xcomplex<f32>>
+    scf.reduce
+  }
+  return
+}
+
+// -----
+
+// Complex ops without vector expansion are replicated, lanes are extracted
+// from the parts vectors and the results are inserted back into them.
+// REMARK: remark: Loop vectorized: dim 0, factor 4, interleave 1, masked false, {{.*}} 1 replicated
+// CHECK-LABEL: func @test_complex_replicated
+//       CHECK:  scf.parallel
+//       CHECK:    %[[VA:.*]] = vector.load %{{.*}}[%{{.*}}] : memref<?xf64>, vector<8xf64>
+//       CHECK:    %[[A_RE:.*]] = vector.shuffle %[[VA]], %[[VA]] [0, 2, 4, 6] : vector<8xf64>, vector<8xf64>
+//       CHECK:    %[[A_IM:.*]] = vector.shuffle %[[VA]], %[[VA]] [1, 3, 5, 7] : vector<8xf64>, vector<8xf64>
+//       CHECK:    %[[RE0:.*]] = vector.extractelement %[[A_RE]][{{.*}}] : vector<4xf64>
+//       CHECK:    %[[IM0:.*]] = vector.extractelement %[[A_IM]][{{.*}}] : vector<4xf64>
+//       CHECK:    %[[LANE0:.*]] = complex.create %[[RE0]], %[[IM0]] : complex<f64>
+// CHECK-COUNT-3:    complex.create
+//       CHECK:    %[[EXP0:.*]] = complex.exp %[[LANE0]] : complex<f64>
+// CHECK-COUNT-3:    complex.exp
+//   CHECK-NOT:    complex.exp
+//       CHECK:    %[[EXP0_RE:.*]] = complex.re %[[EXP0]] : complex<f64>
+//       CHECK:    %[[EXP0_IM:.*]] = complex.im %[[EXP0]] : complex<f64>
+//       CHECK:    vector.insertelement %[[EXP0_RE]]
+//       CHECK:    vector.insertelement %[[EXP0_IM]]
+//       CHECK:    vector.load %{{.*}}[%{{.*}}] : memref<?xf64>, vector<8xf64>
+//       CHECK:    vector.fma %{{.*}}, %{{.*}}, %{{.*}} : vector<4xf64>
+//       CHECK:    vector.fma %{{.*}}, %{{.*}}, %{{.*}} : vector<4xf64>
+//   CHECK-NOT:    complex.mul
+//       CHECK:    vector.store %{{.*}}, %{{.*}}[%{{.*}}] : memref<?xf64>, vector<8xf64>
+//       CHECK:  } {numba.vectorized}
+//       CHECK:  scf.parallel
+//       CHECK:    complex.exp %{{.*}} : complex<f64>
+//       CHECK:    complex.mul %{{.*}}, %{{.*}} fastmath<contract> : complex<f64>
+//       CHECK:  } {numba.vectorized}
+func.func @test_complex_replicated(%a: memref<?xcomplex<f64>>, %b: memref<?xcomplex<f64>>, %res: memref<?xcomplex<f64>>)
+    attributes {numba.vector_length = 256 : i64} {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %a, %c0 : memref<?xcomplex<f64>>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %a[%i] : memref<?xcomplex<f64>>
+    %1 = complex.exp %0 : complex<f64>
+    %2 = memref.load %b[%i] : memref<?xcomplex<f64>>
+    %3 = complex.mul %1, %2 fastmath<contract> : complex<f64>
+    memref.store %3, %res[%i] : memref<?xcomplex<f64>>
+    scf.reduce
+  }
+  return
+}
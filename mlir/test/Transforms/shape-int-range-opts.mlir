@@ -308,3 +308,53 @@ func.func @test(%arg1: tensor<?xf32> {numba.shape_range = [#numba_util.index_ran
   %3 = arith.cmpi eq, %2, %cst0 : index
   return %3: i1
 }
+
+// -----
+
+// CHECK-LABEL: func @test_parallel_wraparound
+//  CHECK-SAME: (%[[ARG:.*]]: memref<?xf32>)
+//       CHECK:   scf.parallel (%[[I:.*]]) =
+//   CHECK-NOT:   arith.cmpi
+//   CHECK-NOT:   arith.select
+//       CHECK:   memref.load %[[ARG]][%[[I]]]
+func.func @test_parallel_wraparound(%arg1: memref<?xf32>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg1, %c0 : memref<?xf32>
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    %1 = arith.cmpi slt, %i, %c0 : index
+    %2 = arith.addi %0, %i : index
+    %3 = arith.select %1, %2, %i : index
+    %4 = memref.load %arg1[%3] : memref<?xf32>
+    "test.test"(%4) : (f32) -> ()
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func private @callee_spec0
+//  CHECK-SAME: numba.shape_range = [#numba_util.index_range<[1, 4]>]
+//       CHECK:   %[[C:.*]] = arith.constant true
+//       CHECK:   return %[[C]]
+// CHECK-LABEL: func private @callee_spec1
+//  CHECK-SAME: numba.shape_range = [#numba_util.index_range<[6, 10]>]
+//       CHECK:   %[[C:.*]] = arith.constant false
+//       CHECK:   return %[[C]]
+// CHECK-LABEL: func @test
+//       CHECK:   call @callee_spec0
+//       CHECK:   call @callee_spec1
+func.func private @callee(%arg1: tensor<?xf32>) -> i1 {
+  %cst = arith.constant 0 : index
+  %cst1 = arith.constant 5 : index
+  %0 = tensor.dim %arg1, %cst : tensor<?xf32>
+  %1 = arith.cmpi slt, %0, %cst1 : index
+  return %1: i1
+}
+
+func.func @test(%arg1: tensor<?xf32> {numba.shape_range = [#numba_util.index_range<[1,4]>]},
+                %arg2: tensor<?xf32> {numba.shape_range = [#numba_util.index_range<[6,10]>]}) -> (i1, i1) {
+  %0 = func.call @callee(%arg1) : (tensor<?xf32>) -> i1
+  %1 = func.call @callee(%arg2) : (tensor<?xf32>) -> i1
+  return %0, %1: i1, i1
+}
@@ -0,0 +1,65 @@
+// RUN: numba-mlir-opt --numba-software-prefetch --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_indirect
+//  CHECK-SAME: (%[[DATA:.*]]: memref<?xf64>, %[[IND:.*]]: memref<?xi32>, %[[BEGIN:.*]]: index, %[[END:.*]]: index)
+//       CHECK:   %[[C1:.*]] = arith.constant 1 : index
+//       CHECK:   %[[LAST:.*]] = arith.subi %[[END]], %[[C1]] : index
+//       CHECK:   scf.for %[[I:.*]] = %[[BEGIN]] to %[[END]]
+//       CHECK:     %[[DIST:.*]] = arith.constant {{[0-9]+}} : index
+//       CHECK:     %[[NEXT1:.*]] = arith.addi %[[I]], %[[DIST]] : index
+//       CHECK:     %[[NEXT:.*]] = arith.minsi %[[NEXT1]], %[[LAST]] : index
+//       CHECK:     %[[V1:.*]] = memref.load %[[IND]][%[[I]]] : memref<?xi32>
+//       CHECK:     %[[J1:.*]] = arith.index_cast %[[V1]] : i32 to index
+//       CHECK:     %[[V2:.*]] = memref.load %[[IND]][%[[NEXT]]] : memref<?xi32>
+//       CHECK:     %[[J2:.*]] = arith.index_cast %[[V2]] : i32 to index
+//       CHECK:     memref.prefetch %[[DATA]][%[[J2]]], read, locality<3>, data : memref<?xf64>
+//       CHECK:     memref.load %[[DATA]][%[[J1]]] : memref<?xf64>
+func.func @test_indirect(%arg0: memref<?xf64>, %arg1: memref<?xi32>, %arg2: index, %arg3: index) -> f64 {
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 0.0 : f64
+  %0 = scf.for %i = %arg2 to %arg3 step %c1 iter_args(%acc = %cst) -> f64 {
+    %1 = memref.load %arg1[%i] : memref<?xi32>
+    %2 = arith.index_cast %1 : i32 to index
+    %3 = memref.load %arg0[%2] : memref<?xf64>
+    %4 = arith.addf %acc, %3 : f64
+    scf.yield %4 : f64
+  }
+  return %0 : f64
+}
+
+// -----
+
+// CHECK-LABEL: func @test_strided
+//  CHECK-SAME: (%[[SRC:.*]]: memref<?x?xf64>, %[[DST:.*]]: memref<?x?xf64>, %[[N:.*]]: index, %[[M:.*]]: index)
+//       CHECK:   scf.parallel (%[[I:.*]], %[[J:.*]]) =
+//       CHECK:     %[[NEXT1:.*]] = arith.addi %[[J]], %{{.*}} : index
+//       CHECK:     %[[NEXT:.*]] = arith.minsi %[[NEXT1]], %{{.*}} : index
+//       CHECK:     memref.prefetch %[[SRC]][%[[NEXT]], %[[I]]], read, locality<3>, data : memref<?x?xf64>
+//       CHECK:     memref.load %[[SRC]][%[[J]], %[[I]]] : memref<?x?xf64>
+//   CHECK-NOT:     memref.prefetch
+//       CHECK:     memref.store
+func.func @test_strided(%arg0: memref<?x?xf64>, %arg1: memref<?x?xf64>, %arg2: index, %arg3: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.parallel (%i, %j) = (%c0, %c0) to (%arg2, %arg3) step (%c1, %c1) {
+    %0 = memref.load %arg0[%j, %i] : memref<?x?xf64>
+    memref.store %0, %arg1[%i, %j] : memref<?x?xf64>
+  }
+  return
+}
+
+// -----
+
+// Contiguous accesses are left to the hardware prefetcher.
+
+// CHECK-LABEL: func @test_contiguous
+//   CHECK-NOT:   memref.prefetch
+func.func @test_contiguous(%arg0: memref<?xf64>, %arg1: memref<?xf64>, %arg2: index) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  scf.for %i = %c0 to %arg2 step %c1 {
+    %0 = memref.load %arg0[%i] : memref<?xf64>
+    memref.store %0, %arg1[%i] : memref<?xf64>
+  }
+  return
+}
@@ -0,0 +1,100 @@
+// RUN: numba-mlir-opt --numba-stream-parallel-loops --split-input-file %s | FileCheck %s
+
+// Outer dim is streamed, each chunk is a single range.
+// CHECK-LABEL: func @test_outer_dim
+//  CHECK-SAME:  (%[[A:.*]]: memref<?xf64>, %[[B:.*]]: memref<?xf64>)
+//       CHECK:  memref.extract_aligned_pointer_as_index %[[A]]
+//       CHECK:  memref.extract_aligned_pointer_as_index %[[B]]
+//       CHECK:  scf.if
+//   CHECK-NOT:  scf.for
+//       CHECK:  call @nmrtStreamPrefetch
+//       CHECK:  call @nmrtStreamPrefetch
+//       CHECK:  scf.for %[[BEGIN:.*]] = %{{.*}} to %{{.*}} step %{{.*}} {
+//       CHECK:    scf.if
+//       CHECK:    call @nmrtStreamPrefetch
+//       CHECK:    scf.parallel (%[[I:.*]]) = (%[[BEGIN]]) to
+//       CHECK:      memref.load %[[A]][%[[I]]]
+//       CHECK:      memref.store %{{.*}}, %[[B]][%[[I]]]
+//       CHECK:  func private @nmrtStreamPrefetch(index, index, index, index, index, index)
+func.func @test_outer_dim(%a: memref<?xf64>, %b: memref<?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %a, %c0 : memref<?xf64>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %a[%i] : memref<?xf64>
+    memref.store %0, %b[%i] : memref<?xf64>
+    scf.yield
+  }
+  return
+}
+
+// -----
+
+// Inner dim is streamed, prefetch covers it for every row of the outer dim.
+// CHECK-LABEL: func @test_inner_dim
+//  CHECK-SAME:  (%[[A:.*]]: memref<?x?xf64>, %[[B:.*]]: memref<?xf64>)
+//   CHECK-DAG:  %[[C8:.*]] = arith.constant 8 : index
+//       CHECK:  %{{.*}}, %{{.*}}, %[[SIZES:.*]]:2, %[[STRIDES:.*]]:2 = memref.extract_strided_metadata %[[A]]
+//       CHECK:  %[[ROW_STRIDE:.*]] = arith.muli %[[STRIDES]]#0, %[[C8]] : index
+//       CHECK:  scf.if
+//       CHECK:  call @nmrtStreamPrefetch(%{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %[[ROW_STRIDE]], %[[SIZES]]#0)
+//       CHECK:  scf.for
+//       CHECK:    scf.parallel
+func.func @test_inner_dim(%a: memref<?x?xf64>, %b: memref<?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 0.0 : f64
+  %m = memref.dim %a, %c0 : memref<?x?xf64>
+  %n = memref.dim %a, %c1 : memref<?x?xf64>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = scf.for %j = %c0 to %m step %c1 iter_args(%acc = %cst) -> f64 {
+      %1 = memref.load %a[%j, %i] : memref<?x?xf64>
+      %2 = arith.addf %acc, %1 : f64
+      scf.yield %2 : f64
+    }
+    memref.store %0, %b[%i] : memref<?xf64>
+    scf.yield
+  }
+  return
+}
+
+// -----
+
+// Remaining outer dims are iterated before the runtime call.
+// CHECK-LABEL: func @test_inner_dim_3d
+//  CHECK-SAME:  (%[[A:.*]]: memref<?x?x?xf32>, %[[B:.*]]: memref<?xf32>)
+//       CHECK:  %{{.*}}, %{{.*}}, %[[SIZES:.*]]:3, %[[STRIDES:.*]]:3 = memref.extract_strided_metadata %[[A]]
+//       CHECK:  scf.if
+//       CHECK:    scf.for %{{.*}} = %{{.*}} to %[[SIZES]]#0 step
+//       CHECK:      call @nmrtStreamPrefetch(%{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %{{.*}}, %[[SIZES]]#1)
+func.func @test_inner_dim_3d(%a: memref<?x?x?xf32>, %b: memref<?xf32>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c2 = arith.constant 2 : index
+  %n = memref.dim %a, %c2 : memref<?x?x?xf32>
+  scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+    %0 = memref.load %a[%c0, %c1, %i] : memref<?x?x?xf32>
+    memref.store %0, %b[%i] : memref<?xf32>
+    scf.yield
+  }
+  return
+}
+
+// -----
+
+// Loops inside GPU regions are not streamed.
+// CHECK-LABEL: func @test_gpu_region
+//   CHECK-NOT:  nmrtStreamPrefetch
+func.func @test_gpu_region(%a: memref<?xf64>, %b: memref<?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %n = memref.dim %a, %c0 : memref<?xf64>
+  numba_util.env_region #gpu_runtime.region_desc<device = "test", usm_type = "device", spirv_major_version = 1, spirv_minor_version = 1, has_fp16 = true, has_fp64 = false> {
+    scf.parallel (%i) = (%c0) to (%n) step (%c1) {
+      %0 = memref.load %a[%i] : memref<?xf64>
+      memref.store %0, %b[%i] : memref<?xf64>
+      scf.yield
+    }
+  }
+  return
+}
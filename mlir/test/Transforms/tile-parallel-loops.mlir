@@ -0,0 +1,57 @@
+// RUN: numba-mlir-opt --numba-tile-parallel-loops --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_transpose
+//  CHECK-SAME: (%[[SRC:.*]]: memref<?x?xf64>, %[[DST:.*]]: memref<?x?xf64>)
+//       CHECK:   %[[C128:.*]] = arith.constant 128 : index
+//       CHECK:   scf.parallel (%[[I:.*]], %[[J:.*]]) = {{.*}} step (%[[C128]], %[[C128]])
+//       CHECK:     %[[MI:.*]] = affine.min
+//       CHECK:     %[[MJ:.*]] = affine.min
+//       CHECK:     scf.parallel
+//       CHECK:       %[[V:.*]] = memref.load %[[SRC]][%{{.*}}, %{{.*}}]
+//       CHECK:       memref.store %[[V]], %[[DST]][%{{.*}}, %{{.*}}]
+func.func @test_transpose(%arg0: memref<?x?xf64>, %arg1: memref<?x?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg1, %c0 : memref<?x?xf64>
+  %1 = memref.dim %arg1, %c1 : memref<?x?xf64>
+  scf.parallel (%i, %j) = (%c0, %c0) to (%0, %1) step (%c1, %c1) {
+    %2 = memref.load %arg0[%j, %i] : memref<?x?xf64>
+    memref.store %2, %arg1[%i, %j] : memref<?x?xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_contiguous
+//       CHECK:   scf.parallel
+//   CHECK-NOT:   scf.parallel
+//   CHECK-NOT:   affine.min
+func.func @test_contiguous(%arg0: memref<?x?xf64>, %arg1: memref<?x?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg1, %c0 : memref<?x?xf64>
+  %1 = memref.dim %arg1, %c1 : memref<?x?xf64>
+  scf.parallel (%i, %j) = (%c0, %c0) to (%0, %1) step (%c1, %c1) {
+    %2 = memref.load %arg0[%i, %j] : memref<?x?xf64>
+    memref.store %2, %arg1[%i, %j] : memref<?x?xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_small
+//       CHECK:   scf.parallel
+//   CHECK-NOT:   scf.parallel
+//   CHECK-NOT:   affine.min
+func.func @test_small(%arg0: memref<16x16xf64>, %arg1: memref<16x16xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %c16 = arith.constant 16 : index
+  scf.parallel (%i, %j) = (%c0, %c0) to (%c16, %c16) step (%c1, %c1) {
+    %2 = memref.load %arg0[%j, %i] : memref<16x16xf64>
+    memref.store %2, %arg1[%i, %j] : memref<16x16xf64>
+  }
+  return
+}
@@ -0,0 +1,91 @@
+// RUN: numba-mlir-opt --numba-uplift-math --split-input-file %s | FileCheck %s
+
+// Longer chains round differently from libm, keep powf without afn.
+// CHECK-LABEL: func @test_pow_chain_no_afn
+//  CHECK-SAME:  (%[[A:.*]]: f64)
+//       CHECK:  %[[RES:.*]] = math.powf %[[A]], %{{.*}} : f64
+//   CHECK-NOT:  arith.mulf
+//       CHECK:  return %[[RES]] : f64
+func.func @test_pow_chain_no_afn(%a: f64) -> f64 {
+  %c = arith.constant 5.0 : f64
+  %0 = math.powf %a, %c : f64
+  return %0 : f64
+}
+
+// -----
+
+// CHECK-LABEL: func @test_pow_chain_afn
+//  CHECK-SAME:  (%[[A:.*]]: f64)
+//       CHECK:  %[[SQ:.*]] = arith.mulf %[[A]], %[[A]] fastmath<afn> : f64
+//       CHECK:  %[[P4:.*]] = arith.mulf %[[SQ]], %[[SQ]] fastmath<afn> : f64
+//       CHECK:  %[[RES:.*]] = arith.mulf %[[A]], %[[P4]] fastmath<afn> : f64
+//   CHECK-NOT:  math.powf
+//       CHECK:  return %[[RES]] : f64
+func.func @test_pow_chain_afn(%a: f64) -> f64 {
+  %c = arith.constant 5.0 : f64
+  %0 = math.powf %a, %c fastmath<afn> : f64
+  return %0 : f64
+}
+
+// -----
+
+// CHECK-LABEL: func @test_pow_chain_fastmath_func
+//   CHECK-NOT:  math.powf
+//       CHECK:  arith.mulf
+func.func @test_pow_chain_fastmath_func(%a: f64) -> f64
+    attributes {numba.fastmath} {
+  %c = arith.constant 5.0 : f64
+  %0 = math.powf %a, %c : f64
+  return %0 : f64
+}
+
+// -----
+
+// Exponents with exactly the same results are expanded without afn.
+// CHECK-LABEL: func @test_pow_exact
+//  CHECK-SAME:  (%[[A:.*]]: f64)
+//   CHECK-DAG:  %[[ONE:.*]] = arith.constant 1.000000e+00 : f64
+//   CHECK-DAG:  %[[SQ:.*]] = arith.mulf %[[A]], %[[A]] : f64
+//   CHECK-DAG:  %[[RCP:.*]] = arith.divf %[[ONE]], %[[A]] : f64
+//   CHECK-NOT:  math.powf
+//       CHECK:  return %[[SQ]], %[[RCP]], %[[A]], %[[ONE]] : f64, f64, f64, f64
+func.func @test_pow_exact(%a: f64) -> (f64, f64, f64, f64) {
+  %c2 = arith.constant 2.0 : f64
+  %cm1 = arith.constant -1.0 : f64
+  %c1 = arith.constant 1.0 : f64
+  %c0 = arith.constant 0.0 : f64
+  %0 = math.powf %a, %c2 : f64
+  %1 = math.powf %a, %cm1 : f64
+  %2 = math.powf %a, %c1 : f64
+  %3 = math.powf %a, %c0 : f64
+  return %0, %1, %2, %3 : f64, f64, f64, f64
+}
+
+// -----
+
+// CHECK-LABEL: func @test_pow_sqrt_no_afn
+//   CHECK-NOT:  math.sqrt
+//   CHECK-NOT:  math.rsqrt
+//       CHECK:  math.powf
+//       CHECK:  math.powf
+func.func @test_pow_sqrt_no_afn(%a: f64) -> (f64, f64) {
+  %c = arith.constant 0.5 : f64
+  %cm = arith.constant -0.5 : f64
+  %0 = math.powf %a, %c : f64
+  %1 = math.powf %a, %cm : f64
+  return %0, %1 : f64, f64
+}
+
+// -----
+
+// CHECK-LABEL: func @test_pow_sqrt_afn
+//  CHECK-SAME:  (%[[A:.*]]: f64)
+//       CHECK:  %[[S:.*]] = math.sqrt %[[A]] fastmath<afn> : f64
+//       CHECK:  math.absf %[[S]] fastmath<afn> : f64
+//       CHECK:  arith.select
+//   CHECK-NOT:  math.powf
+func.func @test_pow_sqrt_afn(%a: f64) -> f64 {
+  %c = arith.constant 0.5 : f64
+  %0 = math.powf %a, %c fastmath<afn> : f64
+  return %0 : f64
+}
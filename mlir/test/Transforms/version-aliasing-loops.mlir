@@ -0,0 +1,104 @@
+// RUN: numba-mlir-opt --numba-version-aliasing-loops --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_version
+//  CHECK-SAME: (%[[SRC:.*]]: memref<?xf64, strided<[?], offset: ?>>, %[[DST:.*]]: memref<?xf64>)
+//   CHECK-DAG:   memref.extract_strided_metadata %[[SRC]]
+//   CHECK-DAG:   memref.extract_aligned_pointer_as_index %[[SRC]]
+//   CHECK-DAG:   memref.extract_strided_metadata %[[DST]]
+//   CHECK-DAG:   memref.extract_aligned_pointer_as_index %[[DST]]
+//       CHECK:   %[[BEFORE:.*]] = arith.cmpi ule
+//       CHECK:   %[[AFTER:.*]] = arith.cmpi ule
+//       CHECK:   %[[COND:.*]] = arith.ori %[[BEFORE]], %[[AFTER]] : i1
+//       CHECK:   scf.if %[[COND]] {
+//       CHECK:     scf.parallel (%[[I:.*]]) =
+//       CHECK:       %[[V1:.*]] = memref.load %[[SRC]][%[[I]]]
+//       CHECK:       memref.store %[[V1]], %[[DST]][%[[I]]]
+//       CHECK:   } else {
+//       CHECK:     scf.for %[[J:.*]] =
+//       CHECK:       %[[V2:.*]] = memref.load %[[SRC]][%[[J]]]
+//       CHECK:       memref.store %[[V2]], %[[DST]][%[[J]]]
+//   CHECK-NOT:     scf.parallel
+//       CHECK:   }
+//       CHECK:   return
+func.func @test_version(%arg0: memref<?xf64, strided<[?], offset: ?>>, %arg1: memref<?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg1, %c0 : memref<?xf64>
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    %1 = memref.load %arg0[%i] : memref<?xf64, strided<[?], offset: ?>>
+    memref.store %1, %arg1[%i] : memref<?xf64>
+  }
+  return
+}
+
+// -----
+
+// Views of the same argument are not checked.
+
+// CHECK-LABEL: func @test_same_arg
+//   CHECK-NOT:   scf.if
+//       CHECK:   scf.parallel
+//   CHECK-NOT:   scf.for
+func.func @test_same_arg(%arg0: memref<?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg0, %c0 : memref<?xf64>
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    %1 = memref.load %arg0[%i] : memref<?xf64>
+    %2 = arith.addf %1, %1 : f64
+    memref.store %2, %arg0[%i] : memref<?xf64>
+  }
+  return
+}
+
+// -----
+
+// Loops with reductions are not versioned.
+
+// CHECK-LABEL: func @test_reduction
+//   CHECK-NOT:   scf.if
+//       CHECK:   scf.parallel
+//   CHECK-NOT:   scf.for
+func.func @test_reduction(%arg0: memref<?xf64>, %arg1: memref<?xf64>) -> f64 {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %cst = arith.constant 0.0 : f64
+  %0 = memref.dim %arg0, %c0 : memref<?xf64>
+  %1 = scf.parallel (%i) = (%c0) to (%0) step (%c1) init (%cst) -> f64 {
+    %2 = memref.load %arg0[%i] : memref<?xf64>
+    memref.store %2, %arg1[%i] : memref<?xf64>
+    scf.reduce(%2 : f64) {
+    ^bb0(%lhs: f64, %rhs: f64):
+      %3 = arith.addf %lhs, %rhs : f64
+      scf.reduce.return %3 : f64
+    }
+  }
+  return %1 : f64
+}
+
+// -----
+
+// Numba parfor pass already checked parfor loops for races, other loops in
+// the function are still versioned.
+// CHECK-LABEL: func @test_parfor_loop
+//   CHECK-NOT:   scf.if
+//       CHECK:   scf.parallel
+//       CHECK:   } {numba.parfor_lowered}
+//       CHECK:   scf.if
+//       CHECK:     scf.parallel
+//       CHECK:   } else {
+//       CHECK:     scf.for
+func.func @test_parfor_loop(%arg0: memref<?xf64, strided<[?], offset: ?>>, %arg1: memref<?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg1, %c0 : memref<?xf64>
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    %1 = memref.load %arg0[%i] : memref<?xf64, strided<[?], offset: ?>>
+    memref.store %1, %arg1[%i] : memref<?xf64>
+  } {numba.parfor_lowered}
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    %1 = memref.load %arg0[%i] : memref<?xf64, strided<[?], offset: ?>>
+    memref.store %1, %arg1[%i] : memref<?xf64>
+  }
+  return
+}
@@ -0,0 +1,42 @@
+// RUN: numba-mlir-opt --numba-version-strided-loops --split-input-file %s | FileCheck %s
+
+// CHECK-LABEL: func @test_strided
+//  CHECK-SAME: (%[[SRC:.*]]: memref<?xf64, strided<[?], offset: ?>>, %[[DST:.*]]: memref<?xf64>)
+//       CHECK:   %[[C1:.*]] = arith.constant 1 : index
+//       CHECK:   %{{.*}}, %[[OFF:.*]], %[[SIZE:.*]], %[[STRIDE:.*]] = memref.extract_strided_metadata %[[SRC]]
+//       CHECK:   %[[COND:.*]] = arith.cmpi eq, %[[STRIDE]], %[[C1]] : index
+//       CHECK:   scf.if %[[COND]] {
+//       CHECK:     %[[CAST:.*]] = memref.reinterpret_cast %[[SRC]] to offset: [%[[OFF]]], sizes: [%[[SIZE]]], strides: [1]
+//       CHECK:     scf.parallel
+//       CHECK:       memref.load %[[CAST]][%{{.*}}] : memref<?xf64, strided<[1], offset: ?>>
+//       CHECK:   } else {
+//       CHECK:     scf.parallel
+//       CHECK:       memref.load %[[SRC]][%{{.*}}] : memref<?xf64, strided<[?], offset: ?>>
+func.func @test_strided(%arg0: memref<?xf64, strided<[?], offset: ?>>, %arg1: memref<?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg1, %c0 : memref<?xf64>
+  scf.parallel (%i) = (%c0) to (%0) step (%c1) {
+    %1 = memref.load %arg0[%i] : memref<?xf64, strided<[?], offset: ?>>
+    memref.store %1, %arg1[%i] : memref<?xf64>
+  }
+  return
+}
+
+// -----
+
+// CHECK-LABEL: func @test_contiguous
+//   CHECK-NOT:   scf.if
+//       CHECK:   scf.parallel
+//   CHECK-NOT:   scf.parallel
+func.func @test_contiguous(%arg0: memref<?xf64, strided<[?, 1], offset: ?>>, %arg1: memref<?x?xf64>) {
+  %c0 = arith.constant 0 : index
+  %c1 = arith.constant 1 : index
+  %0 = memref.dim %arg1, %c0 : memref<?x?xf64>
+  %1 = memref.dim %arg1, %c1 : memref<?x?xf64>
+  scf.parallel (%i, %j) = (%c0, %c0) to (%0, %1) step (%c1, %c1) {
+    %2 = memref.load %arg0[%i, %j] : memref<?x?xf64, strided<[?, 1], offset: ?>>
+    memref.store %2, %arg1[%i, %j] : memref<?x?xf64>
+  }
+  return
+}
@@ -2,6 +2,10 @@
 //
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+#include <llvm/ExecutionEngine/Orc/Mangling.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/DynamicLibrary.h>
+#include <llvm/Support/Format.h>
 #include <llvm/Support/InitLLVM.h>
 #include <llvm/Support/TargetSelect.h>
 #include <mlir/Conversion/LLVMCommon/LoweringOptions.h>
@@ -14,6 +18,7 @@
 #include <mlir/Dialect/LLVMIR/LLVMDialect.h>
 #include <mlir/Dialect/LLVMIR/Transforms/RequestCWrappers.h>
 #include <mlir/Dialect/MemRef/IR/MemRef.h>
+#include <mlir/Dialect/SCF/Transforms/Passes.h>
 #include <mlir/Dialect/SPIRV/IR/SPIRVDialect.h>
 #include <mlir/Dialect/SPIRV/IR/SPIRVOps.h>
 #include <mlir/Dialect/SPIRV/Transforms/Passes.h>
@@ -29,11 +34,159 @@
 #include "numba/Conversion/GpuToGpuRuntime.hpp"
 #include "numba/Conversion/UtilToLlvm.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
 using namespace mlir;
 
+static llvm::cl::OptionCategory benchCategory("Benchmark options");
+
+static llvm::cl::opt<unsigned> benchRepeat(
+    "bench-repeat",
+    llvm::cl::desc("Run entry function N times and print host and device "
+                   "time statistics, entry must not have arguments and "
+                   "results"),
+    llvm::cl::init(0), llvm::cl::cat(benchCategory));
+
+static llvm::cl::opt<unsigned>
+    benchWarmup("bench-warmup",
+                llvm::cl::desc("Number of entry function runs before "
+                               "benchmarking"),
+                llvm::cl::init(1), llvm::cl::cat(benchCategory));
+
+static llvm::cl::list<int64_t> gpuTileSizes(
+    "gpu-tile-sizes",
+    llvm::cl::desc("Tile parallel loops before mapping them to GPU, tile "
+                   "sizes become GPU block sizes"),
+    llvm::cl::CommaSeparated, llvm::cl::cat(benchCategory));
+
+static constexpr llvm::StringLiteral benchFuncName("levelZeroRunnerBenchmark");
+
+/// SYCL runtime profiling hooks, resolved from the loaded runtime library.
+using ProfileGetNumKernelsT = int (*)();
+using ProfileGetKernelT = const char *(*)(int, uint64_t *);
+using ProfileResetT = void (*)();
+
+template <typename T> static T getRuntimeFunc(const char *name) {
+  return reinterpret_cast<T>(
+      llvm::sys::DynamicLibrary::SearchForAddressOfSymbol(name));
+}
+
+static void printKernelsProfile(unsigned runs) {
+  auto getNumKernels =
+      getRuntimeFunc<ProfileGetNumKernelsT>("gpuxProfileGetNumKernels");
+  auto getKernel = getRuntimeFunc<ProfileGetKernelT>("gpuxProfileGetKernel");
+  auto &os = llvm::outs();
+  if (!getNumKernels || !getKernel) {
+    os << "  device time: not available\n";
+    return;
+  }
+
+  for (int i = 0, n = getNumKernels(); i < n; ++i) {
+    uint64_t stats[5] = {};
+    auto name = getKernel(i, stats);
+    if (!name)
+      continue;
+
+    os << "  kernel " << name << ": calls " << (stats[0] / runs) << "/run";
+    os << llvm::format(", device time (us): mean %.3f, p99 %.3f, "
+                       "total %.3f/run, queue latency %.3f/run\n",
+                       stats[2] * 1e-3, stats[3] * 1e-3,
+                       stats[1] * 1e-3 / runs, stats[4] * 1e-3 / runs);
+  }
+}
+
+/// Called from the generated entry function with the original entry.
+extern "C" void levelZeroRunnerBenchmark(void (*func)()) {
+  for (unsigned i = 0; i < benchWarmup; ++i)
+    func();
+
+  if (auto reset = getRuntimeFunc<ProfileResetT>("gpuxProfileReset"))
+    reset();
+
+  using Clock = std::chrono::steady_clock;
+  std::vector<double> times;
+  for (unsigned i = 0; i < benchRepeat; ++i) {
+    auto begin = Clock::now();
+    func();
+    auto end = Clock::now();
+    times.emplace_back(std::chrono::duration<double>(end - begin).count());
+  }
+
+  auto runs = static_cast<unsigned>(times.size());
+  auto mean = std::accumulate(times.begin(), times.end(), 0.0) / runs;
+  std::sort(times.begin(), times.end());
+
+  auto &os = llvm::outs();
+  os << "Benchmark: warmup " << benchWarmup << ", runs " << runs << "\n";
+  os << llvm::format("  host time (us): min %.3f, median %.3f, mean %.3f, "
+                     "max %.3f\n",
+                     times.front() * 1e6, times[runs / 2] * 1e6, mean * 1e6,
+                     times.back() * 1e6);
+  printKernelsProfile(runs);
+  os.flush();
+}
+
+/// Rename entry function and create new one, passing it to the benchmark
+/// driver.
+static LogicalResult addBenchmarkWrapper(ModuleOp module,
+                                         llvm::StringRef entryName) {
+  auto entry = module.lookupSymbol<func::FuncOp>(entryName);
+  if (!entry)
+    return module.emitError("Entry function not found: ") << entryName;
+
+  auto funcType = entry.getFunctionType();
+  if (funcType.getNumInputs() != 0 || funcType.getNumResults() != 0)
+    return entry.emitError(
+        "Benchmark entry function must not have arguments and results");
+
+  auto implName = (entryName + "_bench_impl").str();
+  entry.setSymName(implName);
+
+  auto loc = entry.getLoc();
+  OpBuilder builder(module.getBodyRegion());
+  builder.setInsertionPointToEnd(module.getBody());
+  auto benchType = builder.getFunctionType({funcType}, {});
+  auto benchFunc = builder.create<func::FuncOp>(loc, benchFuncName, benchType);
+  benchFunc.setPrivate();
+
+  auto wrapper = builder.create<func::FuncOp>(loc, entryName, funcType);
+  builder.setInsertionPointToStart(wrapper.addEntryBlock());
+  mlir::Value impl = builder.create<func::ConstantOp>(loc, funcType, implName);
+  builder.create<func::CallOp>(loc, benchFunc, impl);
+  builder.create<func::ReturnOp>(loc);
+  return mlir::success();
+}
+
+static llvm::orc::SymbolMap runtimeSymbols(llvm::orc::MangleAndInterner m) {
+  llvm::orc::SymbolMap ret;
+  llvm::orc::ExecutorSymbolDef sym{
+      llvm::orc::ExecutorAddr::fromPtr(&levelZeroRunnerBenchmark),
+      llvm::JITSymbolFlags::Exported};
+  // Declaration will have C interface wrapper requested, which will call
+  // `_mlir_ciface_` symbol.
+  ret.insert({m((llvm::Twine("_mlir_ciface_") + benchFuncName).str()), sym});
+  return ret;
+}
+
 static LogicalResult runMLIRPasses(mlir::Operation *op,
-                                   mlir::JitRunnerOptions & /*options*/) {
+                                   mlir::JitRunnerOptions &options) {
   auto module = mlir::cast<mlir::ModuleOp>(op);
+  if (benchRepeat > 0) {
+    if (failed(addBenchmarkWrapper(module, options.mainFuncName)))
+      return mlir::failure();
+
+    // Collect kernels device time in SYCL runtime.
+#ifdef _WIN32
+    _putenv_s("NUMBA_MLIR_GPU_PROFILE", "1");
+#else
+    setenv("NUMBA_MLIR_GPU_PROFILE", "1", /*overwrite*/ 1);
+#endif
+  }
+
   PassManager passManager(module.getContext());
   if (failed(applyPassManagerCLOptions(passManager)))
     return mlir::failure();
@@ -54,6 +207,13 @@ static LogicalResult runMLIRPasses(mlir::Operation *op,
   //     bufferization::createBufferDeallocationPass());
   passManager.addNestedPass<mlir::func::FuncOp>(
       createConvertLinalgToParallelLoopsPass());
+  if (!gpuTileSizes.empty()) {
+    llvm::SmallVector<int64_t> tileSizes(gpuTileSizes.begin(),
+                                         gpuTileSizes.end());
+    passManager.addNestedPass<mlir::func::FuncOp>(
+        createParallelLoopTilingPass(tileSizes));
+  }
+
   passManager.addNestedPass<mlir::func::FuncOp>(
       createGpuMapParallelLoopsPass());
   passManager.addNestedPass<mlir::func::FuncOp>(createParallelLoopToGpuPass());
@@ -107,6 +267,7 @@ int main(int argc, char **argv) {
 
   mlir::JitRunnerConfig jitRunnerConfig;
   jitRunnerConfig.mlirTransformer = runMLIRPasses;
+  jitRunnerConfig.runtimesymbolMap = runtimeSymbols;
 
   mlir::DialectRegistry registry;
   registry.insert<mlir::cf::ControlFlowDialect, mlir::arith::ArithDialect,
@@ -0,0 +1,151 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <mlir/IR/BuiltinOps.h>
+#include <mlir/Pass/Pass.h>
+#include <mlir/Pass/PassManager.h>
+#include <mlir/Pass/PassRegistry.h>
+
+#include <llvm/Support/Format.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+struct BenchmarkOptions : public mlir::PassPipelineOptions<BenchmarkOptions> {
+  Option<std::string> pipeline{*this, "pipeline",
+                               llvm::cl::desc("Pass pipeline to benchmark")};
+  Option<unsigned> repeat{*this, "repeat",
+                          llvm::cl::desc("Number of benchmark runs"),
+                          llvm::cl::init(10)};
+};
+
+/// Runs nested pipeline `repeat` times on the fresh copies of the input module
+/// and prints timing and memory statistics to stderr, then runs it once more
+/// on the input module itself, so pass can be used as drop-in replacement for
+/// the benchmarked pipeline.
+struct BenchmarkPass
+    : public mlir::PassWrapper<BenchmarkPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(BenchmarkPass)
+
+  BenchmarkPass(const BenchmarkOptions &options)
+      : pipelineStr(options.pipeline), repeat(options.repeat) {}
+
+  mlir::LogicalResult initialize(mlir::MLIRContext * /*context*/) override {
+    pm = std::make_shared<mlir::OpPassManager>(
+        mlir::ModuleOp::getOperationName(),
+        mlir::OpPassManager::Nesting::Implicit);
+    return mlir::parsePassPipeline(pipelineStr, *pm, llvm::errs());
+  }
+
+  void getDependentDialects(mlir::DialectRegistry &registry) const override {
+    mlir::OpPassManager tmp(mlir::ModuleOp::getOperationName(),
+                            mlir::OpPassManager::Nesting::Implicit);
+    if (mlir::succeeded(mlir::parsePassPipeline(pipelineStr, tmp)))
+      tmp.getDependentDialects(registry);
+  }
+
+  void runOnOperation() override {
+    auto mod = getOperation();
+    auto inputOps = countOps(mod);
+
+    using Clock = std::chrono::steady_clock;
+    llvm::SmallVector<double> times;
+    llvm::SmallVector<double> mallocDeltas;
+    size_t resultOps = 0;
+    for (unsigned i = 0; i < repeat; ++i) {
+      // Dynamic pipelines can only be run on ops nested in the current one,
+      // so copy is temporarily inserted into the input module.
+      auto copy = mlir::cast<mlir::ModuleOp>(mod->clone());
+      mod.getBody()->push_back(copy);
+
+      auto mallocBefore = llvm::sys::Process::GetMallocUsage();
+      auto begin = Clock::now();
+      auto res = runPipeline(*pm, copy);
+      auto end = Clock::now();
+      auto mallocAfter = llvm::sys::Process::GetMallocUsage();
+
+      resultOps = countOps(copy);
+      copy->erase();
+      if (mlir::failed(res))
+        return signalPassFailure();
+
+      times.emplace_back(std::chrono::duration<double>(end - begin).count());
+      mallocDeltas.emplace_back(static_cast<double>(mallocAfter) -
+                                static_cast<double>(mallocBefore));
+    }
+
+    if (!times.empty())
+      printStats(inputOps, resultOps, times, mallocDeltas);
+
+    if (mlir::failed(runPipeline(*pm, mod)))
+      return signalPassFailure();
+  }
+
+private:
+  std::string pipelineStr;
+  unsigned repeat;
+  std::shared_ptr<mlir::OpPassManager> pm;
+
+  static size_t countOps(mlir::Operation *root) {
+    size_t ret = 0;
+    root->walk([&](mlir::Operation *) { ++ret; });
+    return ret;
+  }
+
+  static uint64_t getPeakRSSKb() {
+#if defined(__linux__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+      return static_cast<uint64_t>(usage.ru_maxrss);
+#elif defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+      return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#endif
+    return 0;
+  }
+
+  void printStats(size_t inputOps, size_t resultOps,
+                  llvm::MutableArrayRef<double> times,
+                  llvm::ArrayRef<double> mallocDeltas) const {
+    auto n = static_cast<double>(times.size());
+    auto mean = std::accumulate(times.begin(), times.end(), 0.0) / n;
+    auto [minIt, maxIt] = std::minmax_element(times.begin(), times.end());
+    auto min = *minIt;
+    auto max = *maxIt;
+    std::sort(times.begin(), times.end());
+    auto median = times[times.size() / 2];
+    auto mallocMean =
+        std::accumulate(mallocDeltas.begin(), mallocDeltas.end(), 0.0) / n;
+
+    auto &os = llvm::errs();
+    os << "Benchmark: " << pipelineStr << "\n";
+    os << "  runs: " << times.size() << "\n";
+    os << "  ops: " << inputOps << " -> " << resultOps << "\n";
+    os << llvm::format("  time (ms): min %.3f, median %.3f, mean %.3f, "
+                       "max %.3f\n",
+                       min * 1e3, median * 1e3, mean * 1e3, max * 1e3);
+    os << llvm::format("  retained malloc per run (KB): %.1f\n",
+                       mallocMean / 1024.0);
+    os << "  peak rss (KB): " << getPeakRSSKb() << "\n";
+  }
+};
+} // namespace
+
+static mlir::PassPipelineRegistration<BenchmarkOptions> benchmark(
+    "numba-benchmark",
+    "Benchmark pass pipeline on large IR, usage: "
+    "--numba-benchmark=\"pipeline=<pipeline> repeat=<N>\"",
+    [](mlir::OpPassManager &pm, const BenchmarkOptions &options) {
+      pm.addPass(std::make_unique<BenchmarkPass>(options));
+    });
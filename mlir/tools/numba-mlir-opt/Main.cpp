@@ -10,6 +10,7 @@
 #include "numba/Dialect/gpu_runtime/IR/GpuRuntimeOps.hpp"
 #include "numba/Dialect/ntensor/IR/NTensorOps.hpp"
 #include "numba/Dialect/numba_util/Dialect.hpp"
+#include "numba/Dialect/plier/Dialect.hpp"
 
 int main(int argc, char **argv) {
   mlir::registerAllPasses();
@@ -18,6 +19,7 @@ int main(int argc, char **argv) {
   registry.insert<gpu_runtime::GpuRuntimeDialect>();
   registry.insert<numba::ntensor::NTensorDialect>();
   registry.insert<numba::util::NumbaUtilDialect>();
+  registry.insert<plier::PlierDialect>();
   return mlir::failed(MlirOptMain(
       argc, argv, "numba-mlir modular optimizer driver\n", registry));
 }
@@ -19,18 +19,41 @@
 #include "numba/Conversion/NtensorToLinalg.hpp"
 #include "numba/Conversion/NtensorToMemref.hpp"
 #include "numba/Conversion/SCFToAffine/SCFToAffine.h"
+#include "numba/Dialect/gpu_runtime/Transforms/FuseLaunches.hpp"
+#include "numba/Dialect/gpu_runtime/Transforms/LowerLaunchesToCpu.hpp"
 #include "numba/Dialect/gpu_runtime/Transforms/MakeBarriersUniform.hpp"
+#include "numba/Dialect/gpu_runtime/Transforms/PromoteToLocalMemory.hpp"
+#include "numba/Dialect/ntensor/Transforms/FuseElementwise.hpp"
+#include "numba/Dialect/ntensor/Transforms/HoistArrayOps.hpp"
 #include "numba/Dialect/ntensor/Transforms/PropagateEnvironment.hpp"
 #include "numba/Dialect/ntensor/Transforms/ResolveArrayOps.hpp"
+#include "numba/Transforms/BalanceCsrLoops.hpp"
 #include "numba/Transforms/CanonicalizeReductions.hpp"
 #include "numba/Transforms/CommonOpts.hpp"
 #include "numba/Transforms/CopyRemoval.hpp"
 #include "numba/Transforms/ExpandTuple.hpp"
 #include "numba/Transforms/FuncTransforms.hpp"
+#include "numba/Transforms/FuseParallelLoops.hpp"
+#include "numba/Transforms/HoistMemrefOffsets.hpp"
+#include "numba/Transforms/InlineUtils.hpp"
+#include "numba/Transforms/LoopDistribution.hpp"
+#include "numba/Transforms/LoopInvariantDivision.hpp"
 #include "numba/Transforms/MakeSignless.hpp"
 #include "numba/Transforms/MemoryRewrites.hpp"
+#include "numba/Transforms/OutlineColdBlocks.hpp"
+#include "numba/Transforms/PackStridedMemrefs.hpp"
+#include "numba/Transforms/PromoteBoolMemref.hpp"
 #include "numba/Transforms/PromoteToParallel.hpp"
+#include "numba/Transforms/RefcountOpts.hpp"
+#include "numba/Transforms/ReuseBuffers.hpp"
+#include "numba/Transforms/SCFVectorize.hpp"
 #include "numba/Transforms/ShapeIntegerRangePropagation.hpp"
+#include "numba/Transforms/SoftwarePrefetch.hpp"
+#include "numba/Transforms/StreamParallelLoops.hpp"
+#include "numba/Transforms/TileParallelLoops.hpp"
+#include "numba/Transforms/UpliftMath.hpp"
+#include "numba/Transforms/VersionAliasingLoops.hpp"
+#include "numba/Transforms/VersionStridedLoops.hpp"
 
 // Passes registration.
 
@@ -78,6 +101,27 @@ static mlir::PassPipelineRegistration<> GpuToGpuRuntime(
       pm.addNestedPass<mlir::func::FuncOp>(gpu_runtime::createGPUExPass());
     });
 
+static mlir::PassPipelineRegistration<> insertGPUPrefetch(
+    "gpux-insert-prefetch",
+    "Prefetch host shared buffers before kernel launches",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          gpu_runtime::createInsertGPUPrefetchPass());
+    });
+
+static mlir::PassPipelineRegistration<> truncateF64(
+    "gpux-truncate-f64", "Truncate f64 ops to f32 for devices without fp64",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(gpu_runtime::createTruncateF64ForGPUPass());
+    });
+
+static mlir::PassPipelineRegistration<> gpuIndexVariants(
+    "gpux-index-variants",
+    "Add 32-bit index kernel variants, selected at launch time",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(gpu_runtime::createGpuIndexVariantsPass());
+    });
+
 static mlir::PassPipelineRegistration<>
     GpuToLlvm("convert-gpu-to-llvm",
               "Converts Gpu runtime dialect to llvm runtime calls",
@@ -91,6 +135,12 @@ static mlir::PassPipelineRegistration<> scfToAffineReg(
       pm.addNestedPass<mlir::func::FuncOp>(mlir::createSCFToAffinePass());
     });
 
+static mlir::PassPipelineRegistration<> scfToAffineForReg(
+    "scf-to-affine-for", "Raises SCF loop nests into Affine for loops",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(mlir::createSCFToAffineForPass());
+    });
+
 static mlir::PassPipelineRegistration<> cfgToScf(
     "cfg-to-scf", "Convert function from CFG form to SCF ops",
     [](mlir::OpPassManager &pm) {
@@ -109,6 +159,20 @@ static mlir::PassPipelineRegistration<> ntensorResolveArrayOps(
       pm.addPass(numba::ntensor::createResolveArrayOpsPass());
     });
 
+static mlir::PassPipelineRegistration<> ntensorFuseElementwise(
+    "ntensor-fuse-elementwise", "Fuse chains of ntensor elementwise ops",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(numba::ntensor::createFuseElementwisePass());
+    });
+
+static mlir::PassPipelineRegistration<> ntensorHoistArrayOps(
+    "ntensor-hoist-array-ops",
+    "Hoist loop invariant and CSE identical pure ntensor array ops",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          numba::ntensor::createHoistArrayOpsPass());
+    });
+
 static mlir::PassPipelineRegistration<> ntensorPropagateEnv(
     "ntensor-propagate-env", "Propagate ntensor environment",
     [](mlir::OpPassManager &pm) {
@@ -155,12 +219,39 @@ static mlir::PassPipelineRegistration<> makeBarriersUniform(
       pm.addPass(gpu_runtime::createMakeBarriersUniformPass());
     });
 
+static mlir::PassPipelineRegistration<> fuseGpuLaunches(
+    "gpux-fuse-launches", "Fuse adjacent gpu.launch ops",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(gpu_runtime::createFuseGpuLaunchesPass());
+    });
+
+static mlir::PassPipelineRegistration<> lowerLaunchesToCpu(
+    "gpux-lower-launches-to-cpu", "Lower gpu.launch ops to host loops",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(gpu_runtime::createLowerLaunchesToCpuPass());
+    });
+
+static mlir::PassPipelineRegistration<> promoteToLocalMemory(
+    "gpux-promote-to-local-memory",
+    "Stage stencil input tiles into workgroup memory",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(gpu_runtime::createPromoteToLocalMemoryPass());
+    });
+
 static mlir::PassPipelineRegistration<> tileParallelLoopsGPU(
     "gpux-tile-parallel-loops", "Naively tile parallel loops for gpu",
     [](mlir::OpPassManager &pm) {
       pm.addPass(gpu_runtime::createTileParallelLoopsForGPUPass());
     });
 
+static mlir::PassPipelineRegistration<> splitParallelLoopsForDevices(
+    "gpux-split-parallel-loops-for-devices",
+    "Split parallel loops inside GPU regions across multiple devices",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          gpu_runtime::createSplitParallelLoopsForDevicesPass());
+    });
+
 static mlir::PassPipelineRegistration<> memoryOpts(
     "numba-memory-opts", "Apply memory optimizations",
     [](mlir::OpPassManager &pm) { pm.addPass(numba::createMemoryOptPass()); });
@@ -180,6 +271,14 @@ static mlir::PassPipelineRegistration<> insertGPUGlobalReduce(
       pm.addPass(gpu_runtime::createInsertGPUGlobalReducePass());
     });
 
+static mlir::PassPipelineRegistration<> lowerGPUGlobalReduce(
+    "gpux-lower-global-reduce",
+    "Lower gpu_runtime.global_reduce inside gpu.launch to the single pass "
+    "workgroups combine",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(gpu_runtime::createLowerGPUGlobalReducePass());
+    });
+
 static mlir::PassPipelineRegistration<>
     promoteToParallel("numba-promote-to-parallel",
                       "Promotes scf.for to scf.parallel",
@@ -193,6 +292,143 @@ static mlir::PassPipelineRegistration<> shapeIntegerRangePropagation(
       pm.addPass(numba::createShapeIntegerRangePropagationPass());
     });
 
+static mlir::PassPipelineRegistration<> promoteBoolMemref(
+    "numba-promote-bool-memref", "Promote i1 memrefs to i8 storage",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(numba::createPromoteBoolMemrefPass());
+    });
+
+static mlir::PassPipelineRegistration<> narrowIndexType(
+    "numba-narrow-index-type", "Compute index values in i32 when they fit",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(numba::createNarrowIndexTypePass());
+    });
+
+static mlir::PassPipelineRegistration<> loopDistribution(
+    "numba-loop-distribution",
+    "Split non-vectorizable ops out of parallel loops into separate loops",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          numba::createLoopDistributionPass());
+    });
+
+static mlir::PassPipelineRegistration<> loopInvariantDivision(
+    "numba-loop-invariant-division",
+    "Replace division by loop-invariant values with multiplication",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          numba::createLoopInvariantDivisionPass());
+    });
+
+static mlir::PassPipelineRegistration<> scfVectorize(
+    "numba-scf-vectorize", "Vectorize scf.parallel loops",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(numba::createSCFVectorizePass());
+    });
+
+static mlir::PassPipelineRegistration<> outlineColdBlocks(
+    "numba-outline-cold-blocks",
+    "Outline unreachable-terminated error paths into cold functions",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(numba::createOutlineColdBlocksPass());
+    });
+
+static mlir::PassPipelineRegistration<>
+    reuseBuffers("numba-reuse-buffers", "Reuse dead buffers for linalg outputs",
+                 [](mlir::OpPassManager &pm) {
+                   pm.addNestedPass<mlir::func::FuncOp>(
+                       numba::createReuseBuffersPass());
+                 });
+
+static mlir::PassPipelineRegistration<> optimizeAllocs(
+    "numba-optimize-allocs", "Hoist and promote to stack temporary buffers",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(numba::createOptimizeAllocsPass());
+    });
+
+static mlir::PassPipelineRegistration<> fuseParallelLoops(
+    "numba-fuse-parallel-loops",
+    "Fuse parallel loops into the consumer loops with more dimensions",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          numba::createFuseParallelLoopsPass());
+    });
+
+static mlir::PassPipelineRegistration<>
+    costModelInline("numba-cost-model-inline",
+                    "Inline private functions based on the cost model",
+                    [](mlir::OpPassManager &pm) {
+                      pm.addPass(numba::createCostModelInlinePass());
+                    });
+
+static mlir::PassPipelineRegistration<> balanceCsrLoops(
+    "numba-balance-csr-loops",
+    "Partition parallel loops over CSR rows by the number of nonzeros",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          numba::createBalanceCsrLoopsPass());
+    });
+
+static mlir::PassPipelineRegistration<> tileParallelLoops(
+    "numba-tile-parallel-loops", "Tile parallel loops for CPU cache locality",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          numba::createTileParallelLoopsPass());
+    });
+
+static mlir::PassPipelineRegistration<> versionAliasingLoops(
+    "numba-version-aliasing-loops",
+    "Version parallel loops on the runtime arguments overlap check",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          numba::createVersionAliasingLoopsPass());
+    });
+
+static mlir::PassPipelineRegistration<> versionStridedLoops(
+    "numba-version-strided-loops",
+    "Version parallel loops on the unit innermost stride",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          numba::createVersionStridedLoopsPass());
+    });
+
+static mlir::PassPipelineRegistration<> packStridedMemrefs(
+    "numba-pack-strided-memrefs",
+    "Pack reused strided memrefs into contiguous buffers before loops",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          numba::createPackStridedMemrefsPass());
+    });
+
+static mlir::PassPipelineRegistration<> refcountOpts(
+    "numba-refcount-opts",
+    "Cancel redundant retain/dealloc pairs and mark thread-local refcounts",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(numba::createRefcountOptsPass());
+    });
+
+static mlir::PassPipelineRegistration<> softwarePrefetch(
+    "numba-software-prefetch",
+    "Prefetch indirect and large-stride loads inside loops",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(numba::createSoftwarePrefetchPass());
+    });
+
+static mlir::PassPipelineRegistration<> streamParallelLoops(
+    "numba-stream-parallel-loops",
+    "Iterate host parallel loops in 4KB chunks and prefetch the next chunk",
+    [](mlir::OpPassManager &pm) {
+      pm.addPass(numba::createStreamParallelLoopsPass(4096));
+    });
+
+static mlir::PassPipelineRegistration<> hoistMemrefOffsets(
+    "numba-hoist-memref-offsets",
+    "Hoist loop invariant memref access offsets out of loops",
+    [](mlir::OpPassManager &pm) {
+      pm.addNestedPass<mlir::func::FuncOp>(
+          numba::createHoistMemrefOffsetsPass());
+    });
+
 static mlir::PassPipelineRegistration<>
     funcRemoveUnusedArgs("numba-remove-unused-args",
                          "Remove unused functions arguments",
@@ -210,3 +446,7 @@ static mlir::PassPipelineRegistration<>
 static mlir::PassPipelineRegistration<> commonOpts(
     "numba-common-opts", "Common optimization patterns",
     [](mlir::OpPassManager &pm) { pm.addPass(numba::createCommonOptsPass()); });
+
+static mlir::PassPipelineRegistration<> upliftMath(
+    "numba-uplift-math", "Uplift math calls and reduce pow strength",
+    [](mlir::OpPassManager &pm) { pm.addPass(numba::createUpliftMathPass()); });
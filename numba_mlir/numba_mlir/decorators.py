@@ -6,6 +6,7 @@
 Define @jit and related decorators.
 """
 
+import inspect
 import warnings
 
 from .mlir.compiler import (
@@ -13,7 +14,12 @@ from .mlir.compiler import (
     mlir_compiler_replace_parfors_pipeline,
 )
 
-from .mlir.target import numba_mlir_jit, target_name
+from .mlir.target import (
+    numba_mlir_jit,
+    target_name,
+    ShapeSpecializingDispatcher,
+    ValueSpecializingDispatcher,
+)
 from .mlir.vectorize import vectorize as mlir_vectorize
 from .mlir.settings import USE_MLIR
 
@@ -40,6 +46,35 @@ def mlir_jit(
         )
 
     pipeline = mlir_compiler_pipeline
+    shape_specialize = options.pop("mlir_shape_specialize", 0)
+    specialize_args = options.pop("mlir_specialize_args", ())
+    if shape_specialize and specialize_args:
+        raise ValueError(
+            "mlir_shape_specialize and mlir_specialize_args cannot be used together"
+        )
+
+    if specialize_args:
+        return _value_specializing_jit(
+            signature_or_function,
+            locals,
+            cache,
+            pipeline,
+            boundscheck,
+            specialize_args,
+            options,
+        )
+
+    if shape_specialize:
+        return _shape_specializing_jit(
+            signature_or_function,
+            locals,
+            cache,
+            pipeline,
+            boundscheck,
+            shape_specialize,
+            options,
+        )
+
     options["_target"] = target_name
     return orig_jit(
         signature_or_function=signature_or_function,
@@ -51,6 +86,63 @@ def mlir_jit(
     )
 
 
+def _shape_specializing_jit(
+    func, locals, cache, pipeline, boundscheck, shape_specialize, options
+):
+    """
+    Creates dispatcher, compiling static shape variants for the argument
+    shapes, seen at least `shape_specialize` times.
+    """
+    if func is not None and not inspect.isfunction(func):
+        raise TypeError("mlir_shape_specialize doesn't support explicit signatures")
+
+    def wrapper(py_func):
+        targetoptions = options.copy()
+        targetoptions["boundscheck"] = boundscheck
+        disp = ShapeSpecializingDispatcher(
+            py_func=py_func,
+            locals=locals,
+            targetoptions=targetoptions,
+            pipeline_class=pipeline,
+            shape_specialize=shape_specialize,
+        )
+        if cache:
+            disp.enable_caching()
+        return disp
+
+    return wrapper if func is None else wrapper(func)
+
+
+def _value_specializing_jit(
+    func, locals, cache, pipeline, boundscheck, specialize_args, options
+):
+    """
+    Creates dispatcher, compiling separate variant for each set of values of
+    the `specialize_args` arguments, values are folded as constants.
+    """
+    if func is not None and not inspect.isfunction(func):
+        raise TypeError("mlir_specialize_args doesn't support explicit signatures")
+
+    if isinstance(specialize_args, str):
+        specialize_args = (specialize_args,)
+
+    def wrapper(py_func):
+        targetoptions = options.copy()
+        targetoptions["boundscheck"] = boundscheck
+        disp = ValueSpecializingDispatcher(
+            py_func=py_func,
+            locals=locals,
+            targetoptions=targetoptions,
+            pipeline_class=pipeline,
+            specialize_args=tuple(specialize_args),
+        )
+        if cache:
+            disp.enable_caching()
+        return disp
+
+    return wrapper if func is None else wrapper(func)
+
+
 def mlir_njit(*args, **kws):
     """
     Equivalent to jit(nopython=True)
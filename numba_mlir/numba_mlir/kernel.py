@@ -19,5 +19,6 @@ from .mlir.kernel_impl import (
     local,
     private,
     group,
+    subgroup,
 )
 from .mlir.kernel_sim import kernel as kernel_sim
@@ -2,9 +2,19 @@
 //
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
 #include <stdio.h>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include "Common.hpp"
 #include "numba-mlir-math-runtime_export.h"
@@ -51,16 +61,49 @@ template <typename T> static bool isRowm(const Memref<2, T> *arr) {
   return arr->strides[1] == 1;
 };
 
-#ifdef NUMBA_MLIR_USE_MKL
+/// Returns thread-local scratch memory for `count` elements. Memory is reused
+/// between calls and only valid until the next call.
+template <typename T> static T *getScratch(size_t count) {
+  static thread_local std::vector<std::max_align_t> buffer;
+  auto size = (count * sizeof(T) + sizeof(std::max_align_t) - 1) /
+              sizeof(std::max_align_t);
+  if (buffer.size() < size)
+    buffer.resize(size);
+
+  return reinterpret_cast<T *>(buffer.data());
+}
+
+/// Copies arbitrary strided array into contiguous row-major scratch buffer.
+/// Used for arrays which will be overwritten by lapack, so caller doesn't
+/// need to copy them.
 template <typename T>
+static Memref<2, T> copyToScratch(const Memref<2, T> *arr) {
+  auto rows = arr->dims[0];
+  auto cols = arr->dims[1];
+  auto stride0 = static_cast<std::ptrdiff_t>(arr->strides[0]);
+  auto stride1 = static_cast<std::ptrdiff_t>(arr->strides[1]);
+  auto src = getMemrefData(arr);
+  auto dst = getScratch<T>(rows * cols);
+  for (size_t i = 0; i < rows; ++i)
+    for (size_t j = 0; j < cols; ++j)
+      dst[i * cols + j] = src[std::ptrdiff_t(i) * stride0 +
+                              std::ptrdiff_t(j) * stride1];
+
+  return {nullptr, dst, 0, {rows, cols}, {cols, 1}};
+}
+
+#ifdef NUMBA_MLIR_USE_MKL
+/// `TC` - type of the result and scalars, if different from inputs type.
+template <typename T, typename TC = T>
 using GemmFunc = void(const CBLAS_LAYOUT, const CBLAS_TRANSPOSE,
                       const CBLAS_TRANSPOSE, const MKL_INT, const MKL_INT,
-                      const MKL_INT, const T, const T *, const MKL_INT,
-                      const T *, const MKL_INT, const T, T *, const MKL_INT);
+                      const MKL_INT, const TC, const T *, const MKL_INT,
+                      const T *, const MKL_INT, const TC, TC *, const MKL_INT);
 
-template <typename T>
-static void gemmImpl(GemmFunc<T> Gemm, const Memref<2, T> *a,
-                     const Memref<2, T> *b, Memref<2, T> *c, T alpha, T beta) {
+template <typename T, typename TC = T>
+static void gemmImpl(GemmFunc<T, TC> Gemm, const Memref<2, T> *a,
+                     const Memref<2, T> *b, Memref<2, TC> *c, TC alpha,
+                     TC beta) {
   assert(a);
   assert(b);
   assert(c);
@@ -106,6 +149,262 @@ static void gemmImpl(GemmFunc<T> Gemm, const Memref<2, T> *a,
   );
 }
 
+static float halfToFloat(uint16_t val) {
+  uint32_t sign = uint32_t(val & 0x8000) << 16;
+  uint32_t exp = (val >> 10) & 0x1f;
+  uint32_t mant = val & 0x3ff;
+  uint32_t bits;
+  if (exp == 0x1f) {
+    // Inf/NaN.
+    bits = sign | 0x7f800000 | (mant << 13);
+  } else if (exp == 0 && mant == 0) {
+    bits = sign;
+  } else if (exp == 0) {
+    // Subnormal, normalize it.
+    exp = 127 - 15 + 1;
+    while (!(mant & 0x400)) {
+      mant <<= 1;
+      --exp;
+    }
+    bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+  } else {
+    bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+  }
+
+  float ret;
+  std::memcpy(&ret, &bits, sizeof(ret));
+  return ret;
+}
+
+/// Converts float to half, rounding to nearest even.
+static uint16_t floatToHalf(float val) {
+  uint32_t bits;
+  std::memcpy(&bits, &val, sizeof(bits));
+  auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  uint32_t exp = (bits >> 23) & 0xff;
+  uint32_t mant = bits & 0x7fffff;
+  if (exp == 0xff)
+    return sign | 0x7c00 | (mant ? 0x200 : 0);
+
+  auto halfExp = int32_t(exp) - 127 + 15;
+  if (halfExp >= 0x1f)
+    return sign | 0x7c00;
+
+  auto round = [](uint32_t val, uint32_t shift) -> uint32_t {
+    uint32_t ret = val >> shift;
+    uint32_t rem = val & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rem > halfway || (rem == halfway && (ret & 1)))
+      ++ret;
+
+    return ret;
+  };
+
+  if (halfExp <= 0) {
+    // Subnormal or zero.
+    if (halfExp < -10)
+      return sign;
+
+    auto shift = static_cast<uint32_t>(14 - halfExp);
+    return sign | static_cast<uint16_t>(round(mant | 0x800000, shift));
+  }
+
+  // Rounding carry propagates into exponent, overflowing to inf if needed.
+  auto ret = (uint32_t(halfExp) << 23) | mant;
+  return sign | static_cast<uint16_t>(round(ret, 13));
+}
+
+/// Half precision gemm with f32 accumulation, result is computed into f32
+/// scratch buffer and rounded to half once.
+static void gemmF16Impl(GemmFunc<MKL_F16, float> Gemm,
+                        const Memref<2, MKL_F16> *a,
+                        const Memref<2, MKL_F16> *b, Memref<2, MKL_F16> *c,
+                        float alpha, float beta) {
+  if (isEmpty2d(a, 'a') && isEmpty2d(b, 'b'))
+    return;
+
+  auto rows = c->dims[0];
+  auto cols = c->dims[1];
+  auto stride0 = static_cast<std::ptrdiff_t>(c->strides[0]);
+  auto stride1 = static_cast<std::ptrdiff_t>(c->strides[1]);
+  auto cData = getMemrefData(c);
+  auto acc = getScratch<float>(rows * cols);
+  auto elem = [&](size_t i, size_t j) -> MKL_F16 & {
+    return cData[std::ptrdiff_t(i) * stride0 + std::ptrdiff_t(j) * stride1];
+  };
+  if (beta != 0)
+    for (size_t i = 0; i < rows; ++i)
+      for (size_t j = 0; j < cols; ++j)
+        acc[i * cols + j] = halfToFloat(elem(i, j));
+
+  Memref<2, float> accArr{nullptr, acc, 0, {rows, cols}, {cols, 1}};
+  gemmImpl<MKL_F16, float>(Gemm, a, b, &accArr, alpha, beta);
+
+  for (size_t i = 0; i < rows; ++i)
+    for (size_t j = 0; j < cols; ++j)
+      elem(i, j) = floatToHalf(acc[i * cols + j]);
+}
+
+/// Half precision gemm with half accumulation.
+static void hgemmImpl(GemmFunc<MKL_F16> Gemm, const Memref<2, MKL_F16> *a,
+                      const Memref<2, MKL_F16> *b, Memref<2, MKL_F16> *c,
+                      float alpha, float beta) {
+  gemmImpl<MKL_F16>(Gemm, a, b, c, floatToHalf(alpha), floatToHalf(beta));
+}
+
+// Must be in sync with compiler matmul epilogue activations.
+enum class MatmulActivation : int64_t { None = 0, Relu = 1 };
+
+template <typename T>
+static void applyEpilogue(Memref<2, T> *c, const Memref<1, T> *bias,
+                          MatmulActivation activation) {
+  auto rows = c->dims[0];
+  auto cols = c->dims[1];
+  auto cData = getMemrefData(c);
+  auto biasData = getMemrefData(bias);
+  auto biasStride = (bias->dims[0] == 1 ? 0 : bias->strides[0]);
+  bool relu = (activation == MatmulActivation::Relu);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      auto &val = cData[i * c->strides[0] + j * c->strides[1]];
+      val = val + biasData[j * biasStride];
+      if (relu)
+        val = (val < T(0) ? T(0) : val);
+    }
+  }
+}
+
+template <typename T>
+static Memref<2, T> getRowsBlock(const Memref<2, T> *arr, size_t begin,
+                                 size_t size) {
+  return {arr->userData,
+          arr->data,
+          arr->offset + begin * arr->strides[0],
+          {size, arr->dims[1]},
+          arr->strides};
+}
+
+/// Computes `act(a @ b + bias)`, result is computed in row blocks, so the
+/// epilogue is applied while the block is still in cache.
+template <typename T>
+static void gemmEpilogueImpl(GemmFunc<T> Gemm, const Memref<2, T> *a,
+                             const Memref<2, T> *b, const Memref<1, T> *bias,
+                             int64_t activation, Memref<2, T> *c) {
+  assert(a);
+  assert(b);
+  assert(bias);
+  assert(c);
+
+  auto m = c->dims[0];
+  auto n = c->dims[1];
+  if (bias->dims[0] != n && bias->dims[0] != 1) {
+    fatal_failure("Bias size mismatch: %d and %d.\n", int(bias->dims[0]),
+                  int(n));
+  }
+
+  if (m == 0 || n == 0)
+    return;
+
+  const size_t blockBytes = 256 * 1024;
+  const size_t minBlockRows = 16;
+  auto blockRows = std::max(blockBytes / (n * sizeof(T)), minBlockRows);
+  auto act = static_cast<MatmulActivation>(activation);
+  for (size_t begin = 0; begin < m; begin += blockRows) {
+    auto size = std::min(blockRows, m - begin);
+    auto aBlock = getRowsBlock(a, begin, size);
+    auto cBlock = getRowsBlock(c, begin, size);
+    gemmImpl(Gemm, &aBlock, b, &cBlock, T(1), T(0));
+    applyEpilogue(&cBlock, bias, act);
+  }
+}
+
+template <typename T>
+using GemmBatchFunc = void(const CBLAS_LAYOUT, const CBLAS_TRANSPOSE,
+                           const CBLAS_TRANSPOSE, const MKL_INT, const MKL_INT,
+                           const MKL_INT, const T, const T *, const MKL_INT,
+                           const MKL_INT, const T *, const MKL_INT,
+                           const MKL_INT, const T, T *, const MKL_INT,
+                           const MKL_INT, const MKL_INT);
+
+template <typename T>
+static Memref<2, T> getBatchItem(const Memref<3, T> *arr) {
+  return {arr->userData,
+          arr->data,
+          arr->offset,
+          {arr->dims[1], arr->dims[2]},
+          {arr->strides[1], arr->strides[2]}};
+}
+
+template <typename T>
+static void gemmBatchImpl(GemmBatchFunc<T> Gemm, const Memref<3, T> *a,
+                          const Memref<3, T> *b, Memref<3, T> *c, T alpha,
+                          T beta) {
+  assert(a);
+  assert(b);
+  assert(c);
+
+  if (a->dims[0] != b->dims[0] || a->dims[0] != c->dims[0]) {
+    fatal_failure("Batch sizes mismatch: %d, %d and %d.\n", int(a->dims[0]),
+                  int(b->dims[0]), int(c->dims[0]));
+  }
+
+  auto batchSize = static_cast<MKL_INT>(a->dims[0]);
+  auto aItem = getBatchItem(a);
+  auto bItem = getBatchItem(b);
+  auto cItem = getBatchItem(c);
+
+  // Nothing to do for empty arrays.
+  if (batchSize == 0 || (isEmpty2d(&aItem, 'a') && isEmpty2d(&bItem, 'b')))
+    return;
+
+  isContiguous2d(&aItem, 'a');
+  isContiguous2d(&bItem, 'b');
+  isContiguous2d(&cItem, 'c');
+
+  auto layout = isRowm(&cItem) ? CblasRowMajor : CblasColMajor;
+  auto transA = isRowm(&aItem) == isRowm(&cItem) ? CblasNoTrans : CblasTrans;
+  auto transB = isRowm(&bItem) == isRowm(&cItem) ? CblasNoTrans : CblasTrans;
+
+  auto m = static_cast<MKL_INT>(aItem.dims[0]);
+  auto n = static_cast<MKL_INT>(bItem.dims[1]);
+  auto k = static_cast<MKL_INT>(aItem.dims[1]);
+
+  auto lda = static_cast<MKL_INT>(isRowm(&aItem) ? aItem.strides[0]
+                                                   : aItem.strides[1]);
+  auto ldb = static_cast<MKL_INT>(isRowm(&bItem) ? bItem.strides[0]
+                                                   : bItem.strides[1]);
+  auto ldc = static_cast<MKL_INT>(isRowm(&cItem) ? cItem.strides[0]
+                                                   : cItem.strides[1]);
+
+  auto strideA = static_cast<MKL_INT>(a->strides[0]);
+  auto strideB = static_cast<MKL_INT>(b->strides[0]);
+  auto strideC = static_cast<MKL_INT>(c->strides[0]);
+
+  auto aData = getMemrefData(a);
+  auto bData = getMemrefData(b);
+  auto cData = getMemrefData(c);
+
+  Gemm(layout,   /*layout*/
+       transA,   /*transa*/
+       transB,   /*transb*/
+       m,        /*m*/
+       n,        /*n*/
+       k,        /*k*/
+       alpha,    /*alpha*/
+       aData,    /*a*/
+       lda,      /*lda*/
+       strideA,  /*stridea*/
+       bData,    /*b*/
+       ldb,      /*ldb*/
+       strideB,  /*strideb*/
+       beta,     /*beta*/
+       cData,    /*c*/
+       ldc,      /*ldc*/
+       strideC,  /*stridec*/
+       batchSize /*batch_size*/
+  );
+}
+
 template <typename T>
 using GetrfFunc = lapack_int(int, lapack_int, lapack_int, T *, lapack_int,
                              lapack_int *);
@@ -144,17 +443,21 @@ using GesvFunc = lapack_int(int, lapack_int, lapack_int, T *, lapack_int,
                             lapack_int *, T *, lapack_int);
 
 template <typename T>
-static int solveImpl(GesvFunc<T> gesv, Memref<2, T> *a, Memref<2, T> *b,
-                     Memref<1, MKL_INT> *ipiv) {
-  assert(a);
+static int solveImpl(GesvFunc<T> gesv, const Memref<2, T> *src,
+                     Memref<2, T> *b, Memref<1, MKL_INT> *ipiv) {
+  assert(src);
   assert(b);
   assert(ipiv);
 
   // Nothing to do for empty arrays.
-  if (isEmpty2d(a, 'a'))
+  if (isEmpty2d(src, 'a'))
     return 0;
 
-  checkSquare(a, 'a');
+  checkSquare(src, 'a');
+
+  // gesv overwrites 'a' with its factorization.
+  auto aCopy = copyToScratch(src);
+  auto a = &aCopy;
 
   auto n = static_cast<MKL_INT>(a->dims[0]);
   auto nrhs = static_cast<MKL_INT>(b->dims[1]);
@@ -200,19 +503,23 @@ using GeevRealFunc = lapack_int(int, char, char, lapack_int, T *, lapack_int,
 
 template <typename T>
 static int eigImplReal(GeevRealFunc<T> geev, char jobvl, char jobvr,
-                       Memref<2, T> *a, Memref<1, T> *wr, Memref<1, T> *wi,
-                       Memref<2, T> *vl, Memref<2, T> *vr) {
-  assert(a);
+                       const Memref<2, T> *src, Memref<1, T> *wr,
+                       Memref<1, T> *wi, Memref<2, T> *vl, Memref<2, T> *vr) {
+  assert(src);
   assert(wr);
   assert(wi);
   assert(vl);
   assert(vr);
 
   // Nothing to do for empty arrays.
-  if (isEmpty2d(a, 'a'))
+  if (isEmpty2d(src, 'a'))
     return 0;
 
-  checkSquare(a, 'a');
+  checkSquare(src, 'a');
+
+  // geev overwrites 'a'.
+  auto aCopy = copyToScratch(src);
+  auto a = &aCopy;
 
   auto n = static_cast<MKL_INT>(a->dims[0]);
   auto layout = CblasColMajor;
@@ -238,18 +545,22 @@ using GeevComplexFunc = lapack_int(int, char, char, lapack_int, T *, lapack_int,
 
 template <typename T>
 static int eigImplComplex(GeevComplexFunc<T> geev, char jobvl, char jobvr,
-                          Memref<2, T> *a, Memref<1, T> *w, Memref<2, T> *vl,
-                          Memref<2, T> *vr) {
-  assert(a);
+                          const Memref<2, T> *src, Memref<1, T> *w,
+                          Memref<2, T> *vl, Memref<2, T> *vr) {
+  assert(src);
   assert(w);
   assert(vl);
   assert(vr);
 
   // Nothing to do for empty arrays.
-  if (isEmpty2d(a, 'a'))
+  if (isEmpty2d(src, 'a'))
     return 0;
 
-  checkSquare(a, 'a');
+  checkSquare(src, 'a');
+
+  // geev overwrites 'a'.
+  auto aCopy = copyToScratch(src);
+  auto a = &aCopy;
 
   auto n = static_cast<MKL_INT>(a->dims[0]);
   auto layout = CblasColMajor;
@@ -294,14 +605,190 @@ static int eighImpl(XxxevdFunc<T, TW> xxxevd, char jobz, char uplo,
   return static_cast<int>(xxxevd(layout, jobz, uplo, n, data, lda, wData));
 }
 
+static void checkDfti(MKL_LONG status) {
+  if (status && !DftiErrorClass(status, DFTI_NO_ERROR))
+    fatal_failure("DFTI call failed: %s\n", DftiErrorMessage(status));
+}
+
+/// Committed DFTI descriptors, cached per thread by transform shape,
+/// precision and domain, so repeated transforms don't recommit them.
+/// Descriptors support both directions, backward transform is scaled by
+/// `1/n`, same as in numpy.
+class DftiCache {
+public:
+  DftiCache() = default;
+  DftiCache(const DftiCache &) = delete;
+  DftiCache &operator=(const DftiCache &) = delete;
+
+  ~DftiCache() {
+    for (auto &&it : cache)
+      DftiFreeDescriptor(&it.second);
+  }
+
+  DFTI_DESCRIPTOR_HANDLE get(DFTI_CONFIG_VALUE precision,
+                             DFTI_CONFIG_VALUE domain, MKL_LONG rows,
+                             MKL_LONG cols) {
+    auto key = std::make_tuple(precision, domain, rows, cols);
+    auto it = cache.find(key);
+    if (it != cache.end())
+      return it->second;
+
+    // 1D transforms are stored with 0 rows.
+    DFTI_DESCRIPTOR_HANDLE handle = nullptr;
+    MKL_LONG dims[] = {rows, cols};
+    if (rows == 0) {
+      checkDfti(DftiCreateDescriptor(&handle, precision, domain, 1, cols));
+    } else {
+      checkDfti(DftiCreateDescriptor(&handle, precision, domain, 2, dims));
+    }
+
+    auto size = static_cast<double>(std::max<MKL_LONG>(rows, 1) * cols);
+    checkDfti(DftiSetValue(handle, DFTI_PLACEMENT, DFTI_NOT_INPLACE));
+    checkDfti(DftiSetValue(handle, DFTI_BACKWARD_SCALE, 1.0 / size));
+    if (domain == DFTI_REAL)
+      checkDfti(DftiSetValue(handle, DFTI_CONJUGATE_EVEN_STORAGE,
+                             DFTI_COMPLEX_COMPLEX));
+
+    checkDfti(DftiCommitDescriptor(handle));
+    cache.emplace(key, handle);
+    return handle;
+  }
+
+private:
+  using Key = std::tuple<DFTI_CONFIG_VALUE, DFTI_CONFIG_VALUE, MKL_LONG,
+                         MKL_LONG>;
+  std::map<Key, DFTI_DESCRIPTOR_HANDLE> cache;
+};
+
+static DftiCache &getDftiCache() {
+  static thread_local DftiCache cache;
+  return cache;
+}
+
+template <typename C> using ComplexReal = decltype(C::real);
+
+template <typename C> static DFTI_CONFIG_VALUE getDftiPrecision() {
+  return std::is_same_v<ComplexReal<C>, float> ? DFTI_SINGLE : DFTI_DOUBLE;
+}
+
+/// Complex to complex transform of contiguous 1D or 2D array.
+template <typename C, size_t NumDims>
+static void fftImpl(const Memref<NumDims, C> *src, int64_t inverse,
+                    Memref<NumDims, C> *dst) {
+  assert(src);
+  assert(dst);
+  MKL_LONG rows = NumDims == 1 ? 0 : static_cast<MKL_LONG>(src->dims[0]);
+  auto cols = static_cast<MKL_LONG>(src->dims[NumDims - 1]);
+  if (cols == 0 || (NumDims == 2 && rows == 0))
+    return;
+
+  auto handle =
+      getDftiCache().get(getDftiPrecision<C>(), DFTI_COMPLEX, rows, cols);
+  auto in = const_cast<C *>(getMemrefData(src));
+  auto out = getMemrefData(dst);
+  checkDfti(inverse ? DftiComputeBackward(handle, in, out)
+                    : DftiComputeForward(handle, in, out));
+}
+
+/// Real to complex transform of contiguous 1D array, only `n/2 + 1`
+/// non-negative frequency terms are stored.
+template <typename C>
+static void rfftImpl(const Memref<1, ComplexReal<C>> *src, Memref<1, C> *dst) {
+  assert(src);
+  assert(dst);
+  auto n = static_cast<MKL_LONG>(src->dims[0]);
+  if (n == 0)
+    return;
+
+  auto handle = getDftiCache().get(getDftiPrecision<C>(), DFTI_REAL, 0, n);
+  auto in = const_cast<ComplexReal<C> *>(getMemrefData(src));
+  auto out = getMemrefData(dst);
+  checkDfti(DftiComputeForward(handle, in, out));
+}
+
+#endif
+
+using ParallelIsInRegionFptr = int (*)();
+using ParallelExecuteFptr = void (*)(void (*)(void *), void *);
+
+/// Parallel runtime hooks, set from python after both runtimes are loaded.
+static ParallelIsInRegionFptr parallelIsInRegion = nullptr;
+static ParallelExecuteFptr parallelExecute = nullptr;
+
+#ifdef NUMBA_MLIR_USE_MKL
+/// MKL thread limit, used by the last MKL call, for tests.
+static std::atomic<int> lastMklNumThreads{0};
+
+/// Limits MKL to the single thread on the current thread, restores previous
+/// limit on destruction.
+struct MKLSequentialScope {
+  MKLSequentialScope() : prev(mkl_set_num_threads_local(1)) {}
+  ~MKLSequentialScope() { mkl_set_num_threads_local(prev); }
+
+  int prev;
+};
+
+/// Runs MKL call, taking parallel runtime state into account.
+///
+/// Inside parallel loop body all workers are already busy, so MKL runs
+/// sequentially instead of oversubscribing cores with its own threads.
+/// Outside of it MKL is threaded and, with TBB threading layer, its nested
+/// parallelism runs in the parallel runtime arena, sharing its workers.
+template <typename F> static auto callMkl(F &&func) -> decltype(func()) {
+  if (parallelIsInRegion && parallelIsInRegion()) {
+    MKLSequentialScope scope;
+    lastMklNumThreads.store(mkl_get_max_threads(), std::memory_order_relaxed);
+    return func();
+  }
+
+  lastMklNumThreads.store(mkl_get_max_threads(), std::memory_order_relaxed);
+  if (!parallelExecute)
+    return func();
+
+  using Ret = decltype(func());
+  if constexpr (std::is_void_v<Ret>) {
+    auto wrapper = [](void *ctx) { (*static_cast<F *>(ctx))(); };
+    parallelExecute(wrapper, &func);
+  } else {
+    std::pair<F *, Ret> data{&func, Ret{}};
+    auto wrapper = [](void *ctx) {
+      auto &d = *static_cast<std::pair<F *, Ret> *>(ctx);
+      d.second = (*d.first)();
+    };
+    parallelExecute(wrapper, &data);
+    return data.second;
+  }
+}
 #endif
 } // namespace
 
 extern "C" {
+/// `isInRegion` returns non-zero when called from parallel loop body,
+/// `execute` runs function in the current parallel runtime arena. Null values
+/// reset hooks.
+NUMBA_MLIR_MATH_RUNTIME_EXPORT void
+nmrtMathRuntimeSetParallelHooks(ParallelIsInRegionFptr isInRegion,
+                                ParallelExecuteFptr execute) {
+  parallelIsInRegion = isInRegion;
+  parallelExecute = execute;
+}
+
+/// Returns MKL thread limit, used by the last MKL call, 0 if MKL wasn't
+/// called or is not available.
+NUMBA_MLIR_MATH_RUNTIME_EXPORT int nmrtMathRuntimeGetLastMklNumThreads() {
 #ifdef NUMBA_MLIR_USE_MKL
-#define MKL_CALL(f, ...) f(__VA_ARGS__)
+  return lastMklNumThreads.load(std::memory_order_relaxed);
+#else
+  return 0;
+#endif
+}
+
+#ifdef NUMBA_MLIR_USE_MKL
+#define MKL_CALL(f, ...) callMkl([&]() { return f(__VA_ARGS__); })
 
 #define MKL_GEMM(Prefix) cblas_##Prefix##gemm
+#define MKL_GEMM_BATCH(Prefix) cblas_##Prefix##gemm_batch_strided
+#define MKL_GEMM_F16_F32ACC cblas_gemm_f16f16f32
 
 #define MKL_GETRF(Prefix) LAPACKE_##Prefix##getrf
 #define MKL_GETRI(Prefix) LAPACKE_##Prefix##getri
@@ -317,6 +804,8 @@ static inline void ALL_UNUSED(int dummy, ...) { (void)dummy; }
   fatal_failure("Math runtime was compiled without MKL support\n");
 
 #define MKL_GEMM(Prefix) 0
+#define MKL_GEMM_BATCH(Prefix) 0
+#define MKL_GEMM_F16_F32ACC 0
 
 #define MKL_GETRF(Prefix) 0
 #define MKL_GETRI(Prefix) 0
@@ -339,6 +828,47 @@ GEMM_VARIANT(double, d, float64)
 
 #undef GEMM_VARIANT
 
+/// Half precision gemm, `alpha` and `beta` are passed as f32. Accumulates in
+/// f32, MKL uses AMX-FP16/AVX512-FP16 if supported by the host.
+NUMBA_MLIR_MATH_RUNTIME_EXPORT void
+mkl_gemm_float16(const Memref<2, uint16_t> *a, const Memref<2, uint16_t> *b,
+                 float alpha, float beta, Memref<2, uint16_t> *c) {
+  MKL_CALL(gemmF16Impl, MKL_GEMM_F16_F32ACC, a, b, c, alpha, beta);
+}
+
+/// Same as above, but accumulates in half precision.
+NUMBA_MLIR_MATH_RUNTIME_EXPORT void
+mkl_gemm_f16acc_float16(const Memref<2, uint16_t> *a,
+                        const Memref<2, uint16_t> *b, float alpha, float beta,
+                        Memref<2, uint16_t> *c) {
+  MKL_CALL(hgemmImpl, MKL_GEMM(h), a, b, c, alpha, beta);
+}
+
+#define GEMM_EPILOGUE_VARIANT(T, Prefix, Suff)                                 \
+  NUMBA_MLIR_MATH_RUNTIME_EXPORT void mkl_gemm_epilogue_##Suff(                \
+      const Memref<2, T> *a, const Memref<2, T> *b, const Memref<1, T> *bias,  \
+      int64_t activation, Memref<2, T> *c) {                                   \
+    MKL_CALL(gemmEpilogueImpl<T>, MKL_GEMM(Prefix), a, b, bias, activation,    \
+             c);                                                               \
+  }
+
+GEMM_EPILOGUE_VARIANT(float, s, float32)
+GEMM_EPILOGUE_VARIANT(double, d, float64)
+
+#undef GEMM_EPILOGUE_VARIANT
+
+#define GEMM_BATCH_VARIANT(T, Prefix, Suff)                                    \
+  NUMBA_MLIR_MATH_RUNTIME_EXPORT void mkl_gemm_batch_##Suff(                   \
+      const Memref<3, T> *a, const Memref<3, T> *b, T alpha, T beta,           \
+      Memref<3, T> *c) {                                                       \
+    MKL_CALL(gemmBatchImpl<T>, MKL_GEMM_BATCH(Prefix), a, b, c, alpha, beta);  \
+  }
+
+GEMM_BATCH_VARIANT(float, s, float32)
+GEMM_BATCH_VARIANT(double, d, float64)
+
+#undef GEMM_BATCH_VARIANT
+
 #define INV_VARIANT(T, Prefix, Suff)                                           \
   NUMBA_MLIR_MATH_RUNTIME_EXPORT int mkl_inv_##Suff(                           \
       Memref<2, T> *a, Memref<1, MKL_INT> *ipiv) {                             \
@@ -355,7 +885,7 @@ INV_VARIANT(MKL_Complex16, z, complex128)
 
 #define SOLVE_VARIANT(T, Prefix, Suff)                                         \
   NUMBA_MLIR_MATH_RUNTIME_EXPORT int mkl_solve_##Suff(                         \
-      Memref<2, T> *a, Memref<2, T> *b, Memref<1, MKL_INT> *ipiv) {            \
+      const Memref<2, T> *a, Memref<2, T> *b, Memref<1, MKL_INT> *ipiv) {      \
     return MKL_CALL(solveImpl<T>, MKL_GETSV(Prefix), a, b, ipiv);              \
   }
 
@@ -380,14 +910,14 @@ CHOLESKY_VARIANT(MKL_Complex16, z, complex128)
 
 #define EIG_VARIANT_REAL(T, Prefix, Suff)                                      \
   NUMBA_MLIR_MATH_RUNTIME_EXPORT int mkl_eig_##Suff(                           \
-      char jobvl, char jobvr, Memref<2, T> *a, Memref<1, T> *wr,               \
+      char jobvl, char jobvr, const Memref<2, T> *a, Memref<1, T> *wr,         \
       Memref<1, T> *wi, Memref<2, T> *vl, Memref<2, T> *vr) {                  \
     return MKL_CALL(eigImplReal<T>, MKL_GEEV(Prefix), jobvl, jobvr, a, wr, wi, \
                     vl, vr);                                                   \
   }
 #define EIG_VARIANT_COMPLEX(T, Prefix, Suff)                                   \
   NUMBA_MLIR_MATH_RUNTIME_EXPORT int mkl_eig_##Suff(                           \
-      char jobvl, char jobvr, Memref<2, T> *a, Memref<1, T> *w,                \
+      char jobvl, char jobvr, const Memref<2, T> *a, Memref<1, T> *w,          \
       Memref<2, T> *vl, Memref<2, T> *vr) {                                    \
     return MKL_CALL(eigImplComplex<T>, MKL_GEEV(Prefix), jobvl, jobvr, a, w,   \
                     vl, vr);                                                   \
@@ -420,4 +950,23 @@ EIGH_VARIANT_COMPLEX(MKL_Complex16, double, z, complex128)
 
 #undef EIGH_VARIANT_REAL
 #undef EIGH_VARIANT_COMPLEX
+
+#define FFT_VARIANT(T, R, Suff)                                                \
+  NUMBA_MLIR_MATH_RUNTIME_EXPORT void mkl_fft_##Suff(                          \
+      const Memref<1, T> *src, int64_t inverse, Memref<1, T> *dst) {           \
+    MKL_CALL(fftImpl<T>, src, inverse, dst);                                   \
+  }                                                                            \
+  NUMBA_MLIR_MATH_RUNTIME_EXPORT void mkl_fft2_##Suff(                         \
+      const Memref<2, T> *src, int64_t inverse, Memref<2, T> *dst) {           \
+    MKL_CALL(fftImpl<T>, src, inverse, dst);                                   \
+  }                                                                            \
+  NUMBA_MLIR_MATH_RUNTIME_EXPORT void mkl_rfft_##Suff(                         \
+      const Memref<1, R> *src, Memref<1, T> *dst) {                            \
+    MKL_CALL(rfftImpl<T>, src, dst);                                           \
+  }
+
+FFT_VARIANT(MKL_Complex8, float, complex64)
+FFT_VARIANT(MKL_Complex16, double, complex128)
+
+#undef FFT_VARIANT
 }
@@ -2,10 +2,19 @@
 //
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
 #include <unordered_map>
+#include <vector>
 
 #include "Common.hpp"
 #include "numba-mlir-math-sycl-runtime_export.h"
@@ -145,16 +154,614 @@ static void deviceGemm(void *queueObj, const Memref<2, T> *a,
         .wait();
   }
 }
+
+template <typename T>
+static void deviceGemmBatch(void *queueObj, const Memref<3, T> *a,
+                            const Memref<3, T> *b, Memref<3, T> *c, T alpha,
+                            T beta) {
+  auto queueIface = static_cast<numba::GPUQueueInterface *>(queueObj);
+
+  if (a->dims[0] != b->dims[0] || a->dims[0] != c->dims[0]) {
+    fatal_failure("Batch sizes mismatch: %d, %d and %d.\n", int(a->dims[0]),
+                  int(b->dims[0]), int(c->dims[0]));
+  }
+
+  auto isContiguous = [](const Memref<3, T> *arr, char arr_name) {
+    if (arr->strides[1] != 1 && arr->strides[2] != 1) {
+      fatal_failure(
+          "mkl gemm suports only arrays contiguous on inner dimension.\n"
+          "stride for at least one dimension should be equal to 1.\n"
+          "'%c' parameter is not contiguous. '%c' strides are %d and %d.\n",
+          arr_name, arr_name, int(arr->strides[1]), int(arr->strides[2]));
+    }
+  };
+
+  isContiguous(a, 'a');
+  isContiguous(b, 'b');
+  isContiguous(c, 'c');
+
+  auto isRowm = [](const Memref<3, T> *arr) { return arr->strides[2] == 1; };
+  auto transA = isRowm(a) == isRowm(c) ? oneapi::mkl::transpose::N
+                                       : oneapi::mkl::transpose::T;
+  auto transB = isRowm(b) == isRowm(c) ? oneapi::mkl::transpose::N
+                                       : oneapi::mkl::transpose::T;
+
+  auto m = static_cast<std::int64_t>(a->dims[1]);
+  auto n = static_cast<std::int64_t>(b->dims[2]);
+  auto k = static_cast<std::int64_t>(a->dims[2]);
+  auto batchSize = static_cast<std::int64_t>(a->dims[0]);
+
+  auto getLd = [&](const Memref<3, T> *arr) {
+    return static_cast<std::int64_t>(isRowm(arr) ? arr->strides[1]
+                                                 : arr->strides[2]);
+  };
+  auto lda = getLd(a);
+  auto ldb = getLd(b);
+  auto ldc = getLd(c);
+
+  auto strideA = static_cast<std::int64_t>(a->strides[0]);
+  auto strideB = static_cast<std::int64_t>(b->strides[0]);
+  auto strideC = static_cast<std::int64_t>(c->strides[0]);
+
+  auto aData = getMemrefData(a);
+  auto bData = getMemrefData(b);
+  auto cData = getMemrefData(c);
+
+  auto queue = getQueue(queueIface);
+
+  if (isRowm(c)) {
+    oneapi::mkl::blas::row_major::gemm_batch(queue,     /*queue*/
+                                             transA,    /*transa*/
+                                             transB,    /*transb*/
+                                             m,         /*m*/
+                                             n,         /*n*/
+                                             k,         /*k*/
+                                             alpha,     /*alpha*/
+                                             aData,     /*a*/
+                                             lda,       /*lda*/
+                                             strideA,   /*stridea*/
+                                             bData,     /*b*/
+                                             ldb,       /*ldb*/
+                                             strideB,   /*strideb*/
+                                             beta,      /*beta*/
+                                             cData,     /*c*/
+                                             ldc,       /*ldc*/
+                                             strideC,   /*stridec*/
+                                             batchSize, /*batch_size*/
+                                             {}         /*dependencies*/
+                                             )
+        .wait();
+  } else {
+    oneapi::mkl::blas::column_major::gemm_batch(queue,     /*queue*/
+                                                transA,    /*transa*/
+                                                transB,    /*transb*/
+                                                m,         /*m*/
+                                                n,         /*n*/
+                                                k,         /*k*/
+                                                alpha,     /*alpha*/
+                                                aData,     /*a*/
+                                                lda,       /*lda*/
+                                                strideA,   /*stridea*/
+                                                bData,     /*b*/
+                                                ldb,       /*ldb*/
+                                                strideB,   /*strideb*/
+                                                beta,      /*beta*/
+                                                cData,     /*c*/
+                                                ldc,       /*ldc*/
+                                                strideC,   /*stridec*/
+                                                batchSize, /*batch_size*/
+                                                {}         /*dependencies*/
+                                                )
+        .wait();
+  }
+}
+
+template <typename T>
+static void deviceGemmEpilogue(void *queueObj, const Memref<2, T> *a,
+                               const Memref<2, T> *b, const Memref<1, T> *bias,
+                               int64_t activation, Memref<2, T> *c) {
+  auto n = c->dims[1];
+  if (bias->dims[0] != n && bias->dims[0] != 1) {
+    fatal_failure("Bias size mismatch: %d and %d.\n", int(bias->dims[0]),
+                  int(n));
+  }
+
+  deviceGemm<T>(queueObj, a, b, c, T(1), T(0));
+
+  auto queueIface = static_cast<numba::GPUQueueInterface *>(queueObj);
+  auto queue = getQueue(queueIface);
+
+  // Must be in sync with compiler matmul epilogue activations.
+  bool relu = (activation == 1);
+  auto cData = getMemrefData(c);
+  auto biasData = getMemrefData(bias);
+  auto stride0 = c->strides[0];
+  auto stride1 = c->strides[1];
+  auto biasStride = (bias->dims[0] == 1 ? 0 : bias->strides[0]);
+  cl::sycl::range<2> range(c->dims[0], n);
+  queue
+      .parallel_for(range,
+                    [=](cl::sycl::id<2> id) {
+                      auto &val = cData[id[0] * stride0 + id[1] * stride1];
+                      val = val + biasData[id[1] * biasStride];
+                      if (relu)
+                        val = (val < T(0) ? T(0) : val);
+                    })
+      .wait();
+}
+
+/// Committed oneMKL DFT descriptors, cached by queue and transform shape.
+/// Backward transform is scaled by `1/n`, same as in numpy.
+template <typename R, oneapi::mkl::dft::domain Domain> struct DftCache {
+  using Desc = oneapi::mkl::dft::descriptor<
+      std::is_same_v<R, float> ? oneapi::mkl::dft::precision::SINGLE
+                               : oneapi::mkl::dft::precision::DOUBLE,
+      Domain>;
+  using Key = std::tuple<cl::sycl::queue, std::int64_t, std::int64_t>;
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      auto h = std::hash<cl::sycl::queue>()(std::get<0>(key));
+      h = h * 31 + std::hash<std::int64_t>()(std::get<1>(key));
+      h = h * 31 + std::hash<std::int64_t>()(std::get<2>(key));
+      return h;
+    }
+  };
+
+  std::unordered_map<Key, std::unique_ptr<Desc>, KeyHash> map;
+  std::mutex m;
+
+  // 1D transforms are stored with 0 rows.
+  Desc &get(cl::sycl::queue queue, std::int64_t rows, std::int64_t cols) {
+    std::lock_guard<std::mutex> guard(m);
+    auto key = std::make_tuple(queue, rows, cols);
+    auto it = map.find(key);
+    if (it != map.end())
+      return *it->second;
+
+    namespace dft = oneapi::mkl::dft;
+    std::unique_ptr<Desc> desc;
+    if (rows == 0) {
+      desc = std::make_unique<Desc>(cols);
+    } else {
+      desc = std::make_unique<Desc>(std::vector<std::int64_t>{rows, cols});
+    }
+
+    auto size = std::max<std::int64_t>(rows, 1) * cols;
+    desc->set_value(dft::config_param::PLACEMENT,
+                    dft::config_value::NOT_INPLACE);
+    desc->set_value(dft::config_param::BACKWARD_SCALE,
+                    R(1) / static_cast<R>(size));
+    if constexpr (Domain == dft::domain::REAL)
+      desc->set_value(dft::config_param::CONJUGATE_EVEN_STORAGE,
+                      dft::config_value::COMPLEX_COMPLEX);
+
+    desc->commit(queue);
+    return *map.emplace(key, std::move(desc)).first->second;
+  }
+};
+
+template <typename R, oneapi::mkl::dft::domain Domain>
+static DftCache<R, Domain> &getDftCache() {
+  static DftCache<R, Domain> cache;
+  return cache;
+}
+
+template <typename R, size_t NumDims>
+static void deviceFft(void *queueObj,
+                      const Memref<NumDims, std::complex<R>> *src,
+                      int64_t inverse, Memref<NumDims, std::complex<R>> *dst) {
+  std::int64_t rows = NumDims == 1 ? 0 : src->dims[0];
+  auto cols = static_cast<std::int64_t>(src->dims[NumDims - 1]);
+  if (cols == 0 || (NumDims == 2 && rows == 0))
+    return;
+
+  auto queueIface = static_cast<numba::GPUQueueInterface *>(queueObj);
+  auto queue = getQueue(queueIface);
+  auto &desc = getDftCache<R, oneapi::mkl::dft::domain::COMPLEX>().get(
+      queue, rows, cols);
+
+  auto in = const_cast<std::complex<R> *>(getMemrefData(src));
+  auto out = getMemrefData(dst);
+  if (inverse) {
+    oneapi::mkl::dft::compute_backward(desc, in, out).wait();
+  } else {
+    oneapi::mkl::dft::compute_forward(desc, in, out).wait();
+  }
+}
+
+template <typename R>
+static void deviceRfft(void *queueObj, const Memref<1, R> *src,
+                       Memref<1, std::complex<R>> *dst) {
+  auto n = static_cast<std::int64_t>(src->dims[0]);
+  if (n == 0)
+    return;
+
+  auto queueIface = static_cast<numba::GPUQueueInterface *>(queueObj);
+  auto queue = getQueue(queueIface);
+  auto &desc =
+      getDftCache<R, oneapi::mkl::dft::domain::REAL>().get(queue, 0, n);
+
+  auto in = const_cast<R *>(getMemrefData(src));
+  auto out = getMemrefData(dst);
+  oneapi::mkl::dft::compute_forward(desc, in, out).wait();
+}
+
+/// Device memory for lapack scratchpad and matrix copies. Memory is reused
+/// between calls with the same parameters, `lock` must be held while it's in
+/// use.
+struct DeviceWorkspace {
+  DeviceWorkspace(cl::sycl::queue q, std::int64_t scratchSize, size_t bytes)
+      : queue(std::move(q)), scratchpadSize(scratchSize),
+        data(bytes ? cl::sycl::malloc_device<char>(bytes, queue) : nullptr) {
+    if (bytes && !data)
+      fatal_failure("Failed to allocate %d bytes of device memory\n",
+                    int(bytes));
+  }
+
+  DeviceWorkspace(const DeviceWorkspace &) = delete;
+  DeviceWorkspace &operator=(const DeviceWorkspace &) = delete;
+
+  ~DeviceWorkspace() {
+    if (data)
+      cl::sycl::free(data, queue);
+  }
+
+  /// Workspace starts with `scratchpadSize` elements of lapack scratchpad,
+  /// followed by the matrix copies.
+  template <typename T> T *scratchpad() const {
+    return reinterpret_cast<T *>(data);
+  }
+
+  template <typename T> T *matrix(size_t offset = 0) const {
+    return scratchpad<T>() + scratchpadSize + offset;
+  }
+
+  cl::sycl::queue queue;
+  std::int64_t scratchpadSize;
+  char *data;
+  std::mutex lock;
+};
+
+enum class LinalgOp { Inv, Solve, Cholesky, Eigh };
+
+/// Workspaces cached by queue, operation, element type and problem size.
+/// Scratchpad size is only queried when workspace is created.
+class WorkspaceCache {
+public:
+  template <typename T, typename F>
+  DeviceWorkspace &get(cl::sycl::queue queue, LinalgOp op, std::int64_t n,
+                       std::int64_t m, size_t matrixSize, F &&querySize) {
+    auto key = std::make_tuple(queue, static_cast<int>(op),
+                               typeid(T).hash_code(), n, m);
+    std::lock_guard<std::mutex> guard(mutex);
+    auto it = map.find(key);
+    if (it != map.end())
+      return *it->second;
+
+    std::int64_t scratchSize = querySize();
+    auto bytes = (scratchSize + matrixSize) * sizeof(T);
+    auto ws = std::make_unique<DeviceWorkspace>(queue, scratchSize, bytes);
+    return *map.emplace(key, std::move(ws)).first->second;
+  }
+
+private:
+  using Key = std::tuple<cl::sycl::queue, int, size_t, std::int64_t,
+                         std::int64_t>;
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      auto h = std::hash<cl::sycl::queue>()(std::get<0>(key));
+      h = h * 31 + std::hash<int>()(std::get<1>(key));
+      h = h * 31 + std::get<2>(key);
+      h = h * 31 + std::hash<std::int64_t>()(std::get<3>(key));
+      h = h * 31 + std::hash<std::int64_t>()(std::get<4>(key));
+      return h;
+    }
+  };
+
+  std::unordered_map<Key, std::unique_ptr<DeviceWorkspace>, KeyHash> map;
+  std::mutex mutex;
+};
+
+static std::unique_ptr<WorkspaceCache> wsCachePtr;
+
+template <typename T>
+static bool isEmptyOrCheckSquare(const Memref<2, T> *arr, char arrName) {
+  if (arr->dims[0] == 0 || arr->dims[1] == 0)
+    return true;
+
+  if (arr->dims[0] != arr->dims[1])
+    fatal_failure("Array '%c' is not square,  dims are %d and %d.\n", arrName,
+                  int(arr->dims[0]), int(arr->dims[1]));
+
+  return false;
+}
+
+template <typename T>
+static std::int64_t getLdColMajor(const Memref<2, T> *arr, char arrName) {
+  if (arr->strides[0] != 1 && arr->strides[1] != 1)
+    fatal_failure("Array '%c' is not contiguous on inner dimension, "
+                  "strides are %d and %d.\n",
+                  arrName, int(arr->strides[0]), int(arr->strides[1]));
+
+  // Row-major array is a transposed column-major one.
+  return static_cast<std::int64_t>(arr->strides[1] == 1 ? arr->strides[0]
+                                                        : arr->strides[1]);
+}
+
+/// Copies strided array into contiguous column-major device buffer.
+template <typename T>
+static cl::sycl::event copyToColMajor(cl::sycl::queue &queue,
+                                      const Memref<2, T> *src, T *dst) {
+  auto data = getMemrefData(src);
+  auto rows = src->dims[0];
+  auto stride0 = static_cast<std::ptrdiff_t>(src->strides[0]);
+  auto stride1 = static_cast<std::ptrdiff_t>(src->strides[1]);
+  return queue.parallel_for(
+      cl::sycl::range<2>(src->dims[0], src->dims[1]), [=](cl::sycl::id<2> id) {
+        auto i = static_cast<std::ptrdiff_t>(id[0]);
+        auto j = static_cast<std::ptrdiff_t>(id[1]);
+        dst[i + j * rows] = data[i * stride0 + j * stride1];
+      });
+}
+
+/// Copies contiguous column-major device buffer back into strided array.
+template <typename T>
+static cl::sycl::event copyFromColMajor(cl::sycl::queue &queue, const T *src,
+                                        Memref<2, T> *dst,
+                                        cl::sycl::event dep) {
+  auto data = getMemrefData(dst);
+  auto rows = dst->dims[0];
+  auto stride0 = static_cast<std::ptrdiff_t>(dst->strides[0]);
+  auto stride1 = static_cast<std::ptrdiff_t>(dst->strides[1]);
+  return queue.submit([&](cl::sycl::handler &cgh) {
+    cgh.depends_on(dep);
+    cgh.parallel_for(cl::sycl::range<2>(dst->dims[0], dst->dims[1]),
+                     [=](cl::sycl::id<2> id) {
+                       auto i = static_cast<std::ptrdiff_t>(id[0]);
+                       auto j = static_cast<std::ptrdiff_t>(id[1]);
+                       data[i * stride0 + j * stride1] = src[i + j * rows];
+                     });
+  });
+}
+
+/// Runs lapack calls chain, returns lapack `info` on failure. Only the last
+/// event in the chain is waited for.
+template <typename F> static int runLapack(F &&func) {
+  try {
+    func().wait_and_throw();
+  } catch (const oneapi::mkl::lapack::exception &e) {
+    return static_cast<int>(e.info());
+  }
+  return 0;
+}
+
+template <typename T>
+static int deviceInv(void *queueObj, Memref<2, T> *a,
+                     Memref<1, std::int64_t> *ipiv) {
+  if (isEmptyOrCheckSquare(a, 'a'))
+    return 0;
+
+  namespace lapack = oneapi::mkl::lapack;
+  auto queue = getQueue(static_cast<numba::GPUQueueInterface *>(queueObj));
+  auto n = static_cast<std::int64_t>(a->dims[0]);
+  auto lda = getLdColMajor(a, 'a');
+
+  // inv(A^T) == inv(A)^T, so row-major arrays can be used as is.
+  auto &ws = wsCachePtr->get<T>(queue, LinalgOp::Inv, n, lda, 0, [&]() {
+    return std::max(lapack::getrf_scratchpad_size<T>(queue, n, n, lda),
+                    lapack::getri_scratchpad_size<T>(queue, n, lda));
+  });
+  std::lock_guard<std::mutex> guard(ws.lock);
+
+  auto data = getMemrefData(a);
+  auto ipivData = getMemrefData(ipiv);
+  auto scratch = ws.scratchpad<T>();
+  auto scratchSize = ws.scratchpadSize;
+  return runLapack([&]() {
+    auto e = lapack::getrf(queue, n, n, data, lda, ipivData, scratch,
+                           scratchSize);
+    return lapack::getri(queue, n, data, lda, ipivData, scratch, scratchSize,
+                         {e});
+  });
+}
+
+template <typename T>
+static int deviceSolve(void *queueObj, const Memref<2, T> *a, Memref<2, T> *b,
+                       Memref<1, std::int64_t> *ipiv) {
+  if (isEmptyOrCheckSquare(a, 'a') || b->dims[1] == 0)
+    return 0;
+
+  namespace lapack = oneapi::mkl::lapack;
+  auto queue = getQueue(static_cast<numba::GPUQueueInterface *>(queueObj));
+  auto n = static_cast<std::int64_t>(a->dims[0]);
+  auto nrhs = static_cast<std::int64_t>(b->dims[1]);
+
+  // getrf overwrites 'a', so both matrices are copied into workspace.
+  auto matrixSize = static_cast<size_t>(n * (n + nrhs));
+  auto &ws =
+      wsCachePtr->get<T>(queue, LinalgOp::Solve, n, nrhs, matrixSize, [&]() {
+        return std::max(lapack::getrf_scratchpad_size<T>(queue, n, n, n),
+                        lapack::getrs_scratchpad_size<T>(
+                            queue, oneapi::mkl::transpose::nontrans, n, nrhs,
+                            n, n));
+      });
+  std::lock_guard<std::mutex> guard(ws.lock);
+
+  auto aData = ws.matrix<T>();
+  auto bData = ws.matrix<T>(n * n);
+  auto ipivData = getMemrefData(ipiv);
+  auto scratch = ws.scratchpad<T>();
+  auto scratchSize = ws.scratchpadSize;
+  return runLapack([&]() {
+    auto copyA = copyToColMajor(queue, a, aData);
+    auto copyB = copyToColMajor(queue, b, bData);
+    auto e = lapack::getrf(queue, n, n, aData, n, ipivData, scratch,
+                           scratchSize, {copyA});
+    e = lapack::getrs(queue, oneapi::mkl::transpose::nontrans, n, nrhs, aData,
+                      n, ipivData, bData, n, scratch, scratchSize,
+                      {e, copyB});
+    return copyFromColMajor(queue, bData, b, e);
+  });
+}
+
+template <typename T>
+static int deviceCholesky(void *queueObj, Memref<2, T> *a) {
+  if (isEmptyOrCheckSquare(a, 'a'))
+    return 0;
+
+  namespace lapack = oneapi::mkl::lapack;
+  auto queue = getQueue(static_cast<numba::GPUQueueInterface *>(queueObj));
+  auto n = static_cast<std::int64_t>(a->dims[0]);
+
+  // Same as host version, upper factor of the column-major view is the lower
+  // factor of the row-major array.
+  auto lda = static_cast<std::int64_t>(a->strides[0]);
+  auto uplo = oneapi::mkl::uplo::upper;
+  auto &ws = wsCachePtr->get<T>(queue, LinalgOp::Cholesky, n, lda, 0, [&]() {
+    return lapack::potrf_scratchpad_size<T>(queue, uplo, n, lda);
+  });
+  std::lock_guard<std::mutex> guard(ws.lock);
+
+  auto data = getMemrefData(a);
+  auto scratch = ws.scratchpad<T>();
+  auto scratchSize = ws.scratchpadSize;
+  return runLapack([&]() {
+    return lapack::potrf(queue, uplo, n, data, lda, scratch, scratchSize);
+  });
+}
+
+template <typename T> struct IsComplex : std::false_type {};
+template <typename T> struct IsComplex<std::complex<T>> : std::true_type {};
+
+template <typename T, typename TW>
+static int deviceEigh(void *queueObj, char jobz, char uplo, Memref<2, T> *a,
+                      Memref<1, TW> *w) {
+  if (isEmptyOrCheckSquare(a, 'a'))
+    return 0;
+
+  namespace lapack = oneapi::mkl::lapack;
+  auto queue = getQueue(static_cast<numba::GPUQueueInterface *>(queueObj));
+  auto n = static_cast<std::int64_t>(a->dims[0]);
+  auto job = jobz == 'V' ? oneapi::mkl::job::vec : oneapi::mkl::job::novec;
+  auto upl = uplo == 'U' ? oneapi::mkl::uplo::upper : oneapi::mkl::uplo::lower;
+
+  auto params = (std::int64_t(jobz) << 8) | std::int64_t(uplo);
+  auto matrixSize = static_cast<size_t>(n * n);
+  auto &ws =
+      wsCachePtr->get<T>(queue, LinalgOp::Eigh, n, params, matrixSize, [&]() {
+        if constexpr (IsComplex<T>::value) {
+          return lapack::heevd_scratchpad_size<T>(queue, job, upl, n, n);
+        } else {
+          return lapack::syevd_scratchpad_size<T>(queue, job, upl, n, n);
+        }
+      });
+  std::lock_guard<std::mutex> guard(ws.lock);
+
+  auto data = ws.matrix<T>();
+  auto wData = getMemrefData(w);
+  auto scratch = ws.scratchpad<T>();
+  auto scratchSize = ws.scratchpadSize;
+  return runLapack([&]() {
+    auto e = copyToColMajor(queue, a, data);
+    if constexpr (IsComplex<T>::value) {
+      e = lapack::heevd(queue, job, upl, n, data, n, wData, scratch,
+                        scratchSize, {e});
+    } else {
+      e = lapack::syevd(queue, job, upl, n, data, n, wData, scratch,
+                        scratchSize, {e});
+    }
+    return copyFromColMajor(queue, data, a, e);
+  });
+}
+
+/// Orders NaNs after all other values, same as numpy and host runtime sort.
+template <typename T> static bool sortLess(T a, T b) {
+  if constexpr (std::is_floating_point_v<T>) {
+    return a < b || (std::isnan(b) && !std::isnan(a));
+  } else {
+    return a < b;
+  }
+}
+
+/// Copies 1D strided device array into the host buffer. Device memory cannot
+/// be accessed from the host directly, so strided arrays are gathered into
+/// contiguous device buffer first.
+template <typename T>
+static std::vector<T> copyToHost(cl::sycl::queue &queue,
+                                 const Memref<1, T> *src) {
+  auto size = src->dims[0];
+  std::vector<T> res(size);
+  if (size == 0)
+    return res;
+
+  auto data = getMemrefData(src);
+  auto stride = src->strides[0];
+  if (stride == 1 || size == 1) {
+    queue.memcpy(res.data(), data, size * sizeof(T)).wait();
+    return res;
+  }
+
+  auto tmp = cl::sycl::malloc_device<T>(size, queue);
+  if (!tmp)
+    fatal_failure("Failed to allocate %d bytes of device memory\n",
+                  int(size * sizeof(T)));
+
+  queue
+      .parallel_for(cl::sycl::range<1>(size),
+                    [=](cl::sycl::id<1> id) {
+                      tmp[id[0]] = data[id[0] * stride];
+                    })
+      .wait();
+  queue.memcpy(res.data(), tmp, size * sizeof(T)).wait();
+  cl::sycl::free(tmp, queue);
+  return res;
+}
+
+/// Sort of the device arrays. Data is sorted on the host, `dst` is expected
+/// to be contiguous.
+template <typename T>
+static void deviceSort(void *queueObj, const Memref<1, T> *src,
+                       Memref<1, T> *dst) {
+  auto queue = getQueue(static_cast<numba::GPUQueueInterface *>(queueObj));
+  auto data = copyToHost(queue, src);
+  std::sort(data.begin(), data.end(), &sortLess<T>);
+  if (!data.empty())
+    queue.memcpy(getMemrefData(dst), data.data(), data.size() * sizeof(T))
+        .wait();
+}
+
+/// Equal keys are ordered by index, same as host runtime argsort.
+template <typename T>
+static void deviceArgSort(void *queueObj, const Memref<1, T> *src,
+                          Memref<1, std::int64_t> *dst) {
+  auto queue = getQueue(static_cast<numba::GPUQueueInterface *>(queueObj));
+  auto keys = copyToHost(queue, src);
+  std::vector<std::int64_t> indices(keys.size());
+  std::iota(indices.begin(), indices.end(), std::int64_t(0));
+  std::stable_sort(indices.begin(), indices.end(),
+                   [&](std::int64_t a, std::int64_t b) {
+                     return sortLess(keys[a], keys[b]);
+                   });
+  if (!indices.empty())
+    queue
+        .memcpy(getMemrefData(dst), indices.data(),
+                indices.size() * sizeof(std::int64_t))
+        .wait();
+}
 #endif
 
 void initMap() {
 #ifdef NUMBA_MLIR_USE_SYCL_MKL
   qMapPtr.reset(new QueueMap());
+  wsCachePtr.reset(new WorkspaceCache());
 #endif
 }
 
 void finilizeMap() {
 #ifdef NUMBA_MLIR_USE_SYCL_MKL
+  wsCachePtr.reset();
   qMapPtr.reset();
 #endif
 }
@@ -173,6 +780,91 @@ extern "C" {
 GEMM_VARIANT(float, float32)
 GEMM_VARIANT(double, float64)
 #undef GEMM_VARIANT
+
+#define GEMM_EPILOGUE_VARIANT(T, Suff)                                         \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT void mkl_gemm_epilogue_##Suff##_device(  \
+      void *queue, const Memref<2, T> *a, const Memref<2, T> *b,               \
+      const Memref<1, T> *bias, int64_t activation, Memref<2, T> *c) {         \
+    deviceGemmEpilogue<T>(queue, a, b, bias, activation, c);                   \
+  }
+
+GEMM_EPILOGUE_VARIANT(float, float32)
+GEMM_EPILOGUE_VARIANT(double, float64)
+#undef GEMM_EPILOGUE_VARIANT
+
+#define GEMM_BATCH_VARIANT(T, Suff)                                            \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT void mkl_gemm_batch_##Suff##_device(     \
+      void *queue, const Memref<3, T> *a, const Memref<3, T> *b, T alpha,      \
+      T beta, Memref<3, T> *c) {                                               \
+    deviceGemmBatch<T>(queue, a, b, c, alpha, beta);                           \
+  }
+
+GEMM_BATCH_VARIANT(float, float32)
+GEMM_BATCH_VARIANT(double, float64)
+#undef GEMM_BATCH_VARIANT
+
+#define FFT_VARIANT(R, Suff)                                                   \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT void mkl_fft_##Suff##_device(            \
+      void *queue, const Memref<1, std::complex<R>> *src, int64_t inverse,     \
+      Memref<1, std::complex<R>> *dst) {                                       \
+    deviceFft<R>(queue, src, inverse, dst);                                    \
+  }                                                                            \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT void mkl_fft2_##Suff##_device(           \
+      void *queue, const Memref<2, std::complex<R>> *src, int64_t inverse,     \
+      Memref<2, std::complex<R>> *dst) {                                       \
+    deviceFft<R>(queue, src, inverse, dst);                                    \
+  }                                                                            \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT void mkl_rfft_##Suff##_device(           \
+      void *queue, const Memref<1, R> *src, Memref<1, std::complex<R>> *dst) { \
+    deviceRfft<R>(queue, src, dst);                                            \
+  }
+
+FFT_VARIANT(float, complex64)
+FFT_VARIANT(double, complex128)
+#undef FFT_VARIANT
+
+#define LINALG_VARIANT(T, TW, Suff)                                            \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT int mkl_inv_##Suff##_device(             \
+      void *queue, Memref<2, T> *a, Memref<1, std::int64_t> *ipiv) {           \
+    return deviceInv<T>(queue, a, ipiv);                                       \
+  }                                                                            \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT int mkl_solve_##Suff##_device(           \
+      void *queue, const Memref<2, T> *a, Memref<2, T> *b,                     \
+      Memref<1, std::int64_t> *ipiv) {                                         \
+    return deviceSolve<T>(queue, a, b, ipiv);                                  \
+  }                                                                            \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT int mkl_cholesky_##Suff##_device(        \
+      void *queue, Memref<2, T> *a) {                                          \
+    return deviceCholesky<T>(queue, a);                                        \
+  }                                                                            \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT int mkl_eigh_##Suff##_device(            \
+      void *queue, char jobz, char uplo, Memref<2, T> *a, Memref<1, TW> *w) {  \
+    return deviceEigh<T, TW>(queue, jobz, uplo, a, w);                         \
+  }
+
+LINALG_VARIANT(float, float, float32)
+LINALG_VARIANT(double, double, float64)
+LINALG_VARIANT(std::complex<float>, float, complex64)
+LINALG_VARIANT(std::complex<double>, double, complex128)
+#undef LINALG_VARIANT
+
+#define SORT_VARIANT(T, Suff)                                                  \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT void nmrtSort_##Suff##_device(           \
+      void *queue, const Memref<1, T> *src, Memref<1, T> *dst) {               \
+    deviceSort<T>(queue, src, dst);                                            \
+  }                                                                            \
+  NUMBA_MLIR_MATH_SYCL_RUNTIME_EXPORT void nmrtArgSort_##Suff##_device(        \
+      void *queue, const Memref<1, T> *src, Memref<1, std::int64_t> *dst) {    \
+    deviceArgSort<T>(queue, src, dst);                                         \
+  }
+
+SORT_VARIANT(std::int32_t, int32)
+SORT_VARIANT(std::int64_t, int64)
+SORT_VARIANT(std::uint32_t, uint32)
+SORT_VARIANT(std::uint64_t, uint64)
+SORT_VARIANT(float, float32)
+SORT_VARIANT(double, float64)
+#undef SORT_VARIANT
 #endif
 
 // Not thread safe
@@ -0,0 +1,138 @@
+# SPDX-FileCopyrightText: 2023 Intel Corporation
+#
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+"""
+Ahead-of-time compilation of numba-mlir functions.
+
+`compile_aot` compiles function for the given signatures and stores the
+resulting objects into the directory, `load_aot` creates dispatcher for the
+same signatures, which loads stored objects instead of running MLIR pipeline
+and LLVM optimizations. Numba typing and wrapper generation are still done
+on load.
+
+Function can be compiled for multiple CPU variants, in which case loader
+selects the best one, supported by the host CPU. Without variants objects
+are compiled for the host CPU and must be loaded on the same CPU model.
+
+Objects are keyed by mangled function name and variant and must be loaded by
+the same numba-mlir build and settings.
+"""
+
+import hashlib
+import os
+import threading
+from contextlib import contextmanager
+
+# Variant name -> (LLVM CPU name, vector length in bits, required host
+# features). Variants are ordered from the least to the most capable.
+cpu_variants = {
+    "baseline": ("x86-64", 128, ()),
+    "avx2": ("x86-64-v3", 256, ("avx2", "fma")),
+    "avx512": (
+        "x86-64-v4",
+        512,
+        ("avx512f", "avx512bw", "avx512dq", "avx512vl"),
+    ),
+    "amx": ("sapphirerapids", 512, ("amx-tile", "amx-int8", "amx-bf16")),
+}
+
+# Native variant, compiled for the host CPU.
+_host_variant = "host"
+
+_state = threading.local()
+
+
+@contextmanager
+def _aot_scope(mode, path, variant):
+    old = getattr(_state, "scope", None)
+    _state.scope = (mode, path, variant)
+    try:
+        yield
+    finally:
+        _state.scope = old
+
+
+def get_aot_object(func_name):
+    """
+    Returns `(mode, path, cpu)` of the object for the function being compiled,
+    `mode` is either "emit" or "load", or `None` outside of AOT scope. Empty
+    `cpu` means host CPU.
+    """
+    scope = getattr(_state, "scope", None)
+    if scope is None:
+        return None
+
+    mode, path, variant = scope
+    key = hashlib.sha256(func_name.encode()).hexdigest()
+    cpu = "" if variant == _host_variant else cpu_variants[variant][0]
+    return mode, os.path.join(path, f"{key}-{variant}.o"), cpu
+
+
+def select_variant(variants):
+    """
+    Returns the most capable of `variants`, supported by the host CPU, or
+    `None` if none of them is.
+    """
+    from ..mlir_compiler import get_host_cpu_features
+
+    features = set(get_host_cpu_features())
+    ret = None
+    for name, (_, _, required) in cpu_variants.items():
+        if name in variants and features.issuperset(required):
+            ret = name
+
+    return ret
+
+
+def _check_variants(variants):
+    for name in variants:
+        if name not in cpu_variants:
+            raise ValueError(
+                f"Invalid cpu variant: {name}, expected one of {list(cpu_variants)}"
+            )
+
+
+def _jit(func, signatures, variant, options):
+    from ..decorators import njit
+
+    if variant != _host_variant and options.get("mlir_vectorize", True) is not False:
+        options = dict(options)
+        options["mlir_vectorize"] = cpu_variants[variant][1]
+
+    return njit(list(signatures), **options)(func)
+
+
+def compile_aot(func, signatures, output_dir, variants=None, **options):
+    """
+    Compiles `func` for each of `signatures` and each of CPU `variants` (host
+    CPU, if not specified), storing objects into `output_dir`.
+    """
+    if variants is None:
+        variants = [_host_variant]
+    else:
+        _check_variants(variants)
+
+    os.makedirs(output_dir, exist_ok=True)
+    for variant in variants:
+        with _aot_scope("emit", output_dir, variant):
+            _jit(func, signatures, variant, options)
+
+
+def load_aot(func, signatures, input_dir, variants=None, **options):
+    """
+    Returns dispatcher for `func` with `signatures` loaded from objects in
+    `input_dir`. `variants` must match the ones passed to `compile_aot`.
+    Signatures without stored object, or if host doesn't support any of the
+    variants, are compiled as usual.
+    """
+    if variants is None:
+        variant = _host_variant
+    else:
+        _check_variants(variants)
+        variant = select_variant(variants)
+        if variant is None:
+            return _jit(func, signatures, _host_variant, options)
+
+    with _aot_scope("load", input_dir, variant):
+        return _jit(func, signatures, variant, options)
@@ -161,6 +161,65 @@ def get_dpctl_devices():
     return list(map(lambda d: d.filter_string, dpctl.get_devices()))
 
 
+PERF_COUNTERS = readenv("NUMBA_MLIR_BENCH_PERF_COUNTERS", int, 0)
+
+# Raw, CPU specific perf events configs for vector instructions count, e.g.
+# FP_ARITH_INST_RETIRED umasks on Intel CPUs.
+PERF_VECTOR_EVENTS = [
+    int(e, 0)
+    for e in filter(
+        None, readenv("NUMBA_MLIR_BENCH_PERF_VECTOR_EVENTS", str, "").split(",")
+    )
+]
+
+# perf_event_attr types and configs from linux/perf_event.h.
+_PERF_TYPE_HARDWARE = 0
+_PERF_TYPE_RAW = 4
+_PERF_COUNT_HW_CPU_CYCLES = 0
+_PERF_COUNT_HW_INSTRUCTIONS = 1
+_PERF_COUNT_HW_CACHE_MISSES = 3
+
+_CACHE_LINE_SIZE = 64
+
+
+def _collect_perf_counters(func, args):
+    from .runtime import perf_counters, _get_gpu_runtime
+
+    events = [
+        (_PERF_TYPE_HARDWARE, _PERF_COUNT_HW_CPU_CYCLES),
+        (_PERF_TYPE_HARDWARE, _PERF_COUNT_HW_INSTRUCTIONS),
+        (_PERF_TYPE_HARDWARE, _PERF_COUNT_HW_CACHE_MISSES),
+    ] + [(_PERF_TYPE_RAW, e) for e in PERF_VECTOR_EVENTS]
+
+    gpu_runtime = _get_gpu_runtime()
+    if gpu_runtime:
+        gpu_runtime.reset_kernels_profile()
+
+    with perf_counters(events) as values:
+        start = timeit.default_timer()
+        func(*args)
+        time = timeit.default_timer() - start
+
+    res = {}
+    if values is not None:
+        cycles, instructions, misses = values[:3]
+        res["cycles"] = cycles
+        res["instructions"] = instructions
+        res["llc_misses"] = misses
+        # Estimate, assumes each LLC miss transfers a single cache line.
+        res["memory_bandwidth"] = misses * _CACHE_LINE_SIZE / time
+        if PERF_VECTOR_EVENTS:
+            res["vector_instructions"] = sum(values[3:])
+
+    if gpu_runtime:
+        kernels = gpu_runtime.get_kernels_profile()
+        if kernels:
+            time = sum(k["device_time"] for k in kernels.values())
+            res["gpu_device_time"] = time * 1e-9
+
+    return res
+
+
 class BenchmarkBase:
     timer = timeit.default_timer
     version = "base"
@@ -201,6 +260,25 @@ class BenchmarkBase:
         time_benchmark.pretty_source = inspect.getsource(func)
         self.time_benchmark = time_benchmark
 
+        def peakmem_benchmark(*arg, **kwargs):
+            func(*self.args)
+
+        self.peakmem_benchmark = peakmem_benchmark
+
+        def get_counter(name):
+            if not PERF_COUNTERS:
+                raise SkipNotImplemented("Perf counters are disabled")
+
+            if not hasattr(self, "perf_counters"):
+                self.perf_counters = _collect_perf_counters(func, self.args)
+
+            if name not in self.perf_counters:
+                raise SkipNotImplemented(f"{name} counter is not available")
+
+            return self.perf_counters[name]
+
+        self.get_counter = get_counter
+
     def get_func(self, *args, **kwargs):
         raise SkipNotImplemented("No function was provided")
 
@@ -215,3 +293,122 @@ class BenchmarkBase:
     def time_benchmark(self, *args, **kwargs):
         # Dummy method, will be overriden
         pass
+
+    def peakmem_benchmark(self, *args, **kwargs):
+        # Dummy method, will be overriden
+        pass
+
+    def track_cycles(self, *args, **kwargs):
+        return self.get_counter("cycles")
+
+    track_cycles.unit = "cycles"
+
+    def track_instructions(self, *args, **kwargs):
+        return self.get_counter("instructions")
+
+    track_instructions.unit = "instructions"
+
+    def track_llc_misses(self, *args, **kwargs):
+        return self.get_counter("llc_misses")
+
+    track_llc_misses.unit = "misses"
+
+    def track_memory_bandwidth(self, *args, **kwargs):
+        return self.get_counter("memory_bandwidth")
+
+    track_memory_bandwidth.unit = "bytes/s"
+
+    def track_vector_instructions(self, *args, **kwargs):
+        return self.get_counter("vector_instructions")
+
+    track_vector_instructions.unit = "instructions"
+
+    def track_gpu_device_time(self, *args, **kwargs):
+        return self.get_counter("gpu_device_time")
+
+    track_gpu_device_time.unit = "seconds"
+
+
+def _compile_fresh(func, sig):
+    # Create new dispatcher, so compilation is not served from the dispatcher
+    # overloads cache.
+    new_func = _nm_njit(func.py_func)
+    new_func.compile(sig)
+    return new_func
+
+
+def _get_compile_profile(func, sig):
+    from . import passes
+    from .compiler_context import get_compile_profile, reset_compile_profile
+
+    old_profile = passes.COMPILE_PROFILE
+    passes.COMPILE_PROFILE = 1
+    try:
+        reset_compile_profile()
+        _compile_fresh(func, sig)
+        return get_compile_profile()
+    finally:
+        passes.COMPILE_PROFILE = old_profile
+
+
+def _get_group_time(profile, group):
+    return sum(v["time"] for v in profile.get(group, {}).values())
+
+
+class CompileBenchmarkBase:
+    """
+    Compile time benchmarks for the numba-mlir kernel from runtime benchmark,
+    returned by `get_benchmark`.
+
+    `time_compile_cold` measures the first compilation in the benchmark
+    process, `time_compile_warm` measures recompilation with warmed up
+    compiler state (and object cache, if NUMBA_MLIR_OBJECT_CACHE_DIR is set).
+    """
+
+    timer = timeit.default_timer
+    version = "base"
+    timeout = 600
+
+    def get_benchmark(self):
+        raise SkipNotImplemented("No benchmark was provided")
+
+    def setup(self, *args, **kwargs):
+        bench = self.get_benchmark()
+        bench.is_validate = False
+        args = bench.initialize(*args, **kwargs)
+        if bench.is_expected_failure:
+            raise SkipNotImplemented("Expected failure")
+
+        self.func = bench.get_func()
+        self.sig = tuple(map(nb.typeof, args))
+
+    def teardown(self, *args, **kwargs):
+        if hasattr(self, "func"):
+            del self.func
+
+    def time_compile_cold(self, *args, **kwargs):
+        _compile_fresh(self.func, self.sig)
+
+    time_compile_cold.number = 1
+    time_compile_cold.repeat = 1
+    time_compile_cold.warmup_time = 0
+
+    def time_compile_warm(self, *args, **kwargs):
+        _compile_fresh(self.func, self.sig)
+
+    time_compile_warm.number = 1
+
+    def peakmem_compile(self, *args, **kwargs):
+        _compile_fresh(self.func, self.sig)
+
+    def track_compile_mlir_stages(self, *args, **kwargs):
+        profile = _get_compile_profile(self.func, self.sig)
+        return _get_group_time(profile, "mlir_stage")
+
+    track_compile_mlir_stages.unit = "seconds"
+
+    def track_compile_llvm(self, *args, **kwargs):
+        profile = _get_compile_profile(self.func, self.sig)
+        return _get_group_time(profile, "llvm")
+
+    track_compile_llvm.unit = "seconds"
@@ -2,8 +2,109 @@
 #
 # SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
-from .settings import DEBUG_TYPE, DUMP_LLVM, DUMP_OPTIMIZED, DUMP_ASSEMBLY
+from .settings import (
+    DEBUG_TYPE,
+    DUMP_LLVM,
+    DUMP_OPTIMIZED,
+    DUMP_ASSEMBLY,
+    OBJECT_CACHE_DIR,
+    OBJECT_CACHE_MAX_SIZE,
+    IR_CACHE_DIR,
+    IR_CACHE_MAX_SIZE,
+    TIERED_COMPILATION,
+    PGO_CALL_THRESHOLD,
+    LAZY_COMPILATION,
+    JIT_LINKER,
+    CODE_MODEL,
+    COMPILE_THREADS,
+    TAPIR_TARGET,
+    TAPIR_ABI_BITCODE,
+    TAPIR_RUNTIME_PATH,
+    VECTOR_LIBRARY,
+    VECTORIZER,
+    COMPOSITE_MAX_ITERS,
+    STACK_ALLOC_MAX_SIZE,
+    ARENA_ALLOC,
+    ALLOC_POLICY,
+    ZEROED_ALLOC,
+    PARALLEL_FILL_THRESHOLD,
+    STREAM_CHUNK_SIZE,
+    NONTEMPORAL_STORE_THRESHOLD,
+    NUMA,
+    NUMA_FIRST_TOUCH_THRESHOLD,
+    SHARE_CALLEES,
+    MODULE_ENV_MAX_USES,
+    F16_F32_ACCUMULATE,
+)
+import os
+
 from .. import mlir_compiler
+from .runtime import add_trace_hook
+
+
+_vector_library_names = {
+    "svml": ["libsvml.so", "svml_dispmd.dll"],
+    "libmvec": ["libmvec.so.1"],
+    "sleef": ["libsleefgnuabi.so", "libsleefgnuabi.so.3"],
+}
+
+
+def _load_vector_library(name):
+    """
+    Loads vector math library into the process, so jitted code can resolve its
+    symbols. Returns library name to use, "none" if it cannot be loaded.
+    """
+    if name == "none":
+        return name
+
+    import ctypes
+    import warnings
+
+    lib_names = _vector_library_names.get(name)
+    if lib_names is None:
+        raise ValueError(
+            f"Invalid vector library: {name}, expected one of "
+            f"{['none'] + list(_vector_library_names)}"
+        )
+
+    for lib_name in lib_names:
+        try:
+            ctypes.CDLL(lib_name, mode=ctypes.RTLD_GLOBAL)
+            return name
+        except OSError:
+            pass
+
+    warnings.warn(f"Failed to load vector library {name}, vector math disabled")
+    return "none"
+
+
+_vectorizers = ["hybrid", "mlir", "llvm"]
+
+
+def _use_llvm_vectorizers(vectorizer):
+    """
+    MLIR vectorizer handles loops it can vectorize in "hybrid" mode, LLVM loop
+    and SLP vectorizers are used for the rest of the code. "mlir" and "llvm"
+    modes only use one of them.
+    """
+    if vectorizer not in _vectorizers:
+        raise ValueError(
+            f"Invalid vectorizer: {vectorizer}, expected one of {_vectorizers}"
+        )
+
+    return vectorizer != "mlir"
+
+
+def _get_ir_cache_version():
+    """
+    Pipeline results depend on the compiler build, so IR cache entries are
+    keyed on the package version and the compiler binary identity.
+    """
+    import os
+    from .. import _version
+
+    st = os.stat(mlir_compiler.__file__)
+    return f"{_version.get_versions()['version']}-{st.st_size}-{st.st_mtime_ns}"
 
 
 def _init_compiler():
@@ -18,8 +119,106 @@ def _init_compiler():
     settings["llvm_printer"] = _get_printer(DUMP_LLVM)
     settings["optimized_printer"] = _get_printer(DUMP_OPTIMIZED)
     settings["asm_printer"] = _get_printer(DUMP_ASSEMBLY)
+    settings["object_cache_dir"] = OBJECT_CACHE_DIR
+    settings["object_cache_max_size"] = OBJECT_CACHE_MAX_SIZE
+    settings["ir_cache_dir"] = IR_CACHE_DIR
+    settings["ir_cache_max_size"] = IR_CACHE_MAX_SIZE
+    settings["ir_cache_version"] = _get_ir_cache_version() if IR_CACHE_DIR else ""
+    settings["tiered_compilation"] = TIERED_COMPILATION
+    settings["pgo_call_threshold"] = PGO_CALL_THRESHOLD
+    settings["lazy_compilation"] = LAZY_COMPILATION
+    settings["compile_threads"] = COMPILE_THREADS
+    settings["jit_linker"] = JIT_LINKER
+    settings["code_model"] = CODE_MODEL
+    settings["tapir_target"] = TAPIR_TARGET
+    settings["tapir_abi_bitcode"] = TAPIR_ABI_BITCODE
+    settings["tapir_runtime_path"] = TAPIR_RUNTIME_PATH
+    settings["vector_library"] = _load_vector_library(VECTOR_LIBRARY)
+    settings["llvm_vectorization"] = _use_llvm_vectorizers(VECTORIZER)
+    settings["composite_max_iters"] = COMPOSITE_MAX_ITERS
+    settings["stack_alloc_max_size"] = STACK_ALLOC_MAX_SIZE
+    settings["arena_alloc"] = ARENA_ALLOC
+    # Tapir targets replace NRT allocations with managed memory ones.
+    settings["alloc_policy"] = bool(ALLOC_POLICY) and TAPIR_TARGET == "none"
+    settings["zeroed_alloc"] = bool(ZEROED_ALLOC) and TAPIR_TARGET == "none"
+    settings["parallel_fill_threshold"] = max(PARALLEL_FILL_THRESHOLD, 0)
+    settings["stream_chunk_size"] = max(STREAM_CHUNK_SIZE, 0)
+    settings["nontemporal_store_threshold"] = NONTEMPORAL_STORE_THRESHOLD
+    # First touch calls are only emitted in NUMA mode.
+    settings["first_touch_threshold"] = (
+        max(NUMA_FIRST_TOUCH_THRESHOLD, 1) if NUMA else 0
+    )
+    settings["share_callees"] = bool(SHARE_CALLEES)
+    settings["module_env_max_uses"] = max(MODULE_ENV_MAX_USES, 0)
+    # Only used as IR cache key, matmul lowering depends on it.
+    settings["f16_f32_accumulate"] = bool(F16_F32_ACCUMULATE)
     return mlir_compiler.init_compiler(settings)
 
 
 global_compiler_context = _init_compiler()
 del _init_compiler
+
+
+def _set_compile_trace_func(ptr):
+    mlir_compiler.set_compile_trace_func(ptr or 0)
+
+
+add_trace_hook(_set_compile_trace_func)
+
+
+def get_compile_profile():
+    """Return compile time profile, aggregated over all modules compiled with
+    NUMBA_MLIR_COMPILE_PROFILE=1.
+
+    Result is a dict of group -> name -> {"time": seconds, "count": runs}, with
+    groups "driver", "mlir_stage", "mlir_pass", "llvm" and "llvm_pass". Pass
+    times are inclusive of nested pipelines.
+    """
+    return mlir_compiler.get_compile_profile(global_compiler_context)
+
+
+def reset_compile_profile():
+    mlir_compiler.reset_compile_profile(global_compiler_context)
+
+
+def _before_fork():
+    mlir_compiler.before_fork(global_compiler_context)
+
+
+def _after_fork_parent():
+    mlir_compiler.after_fork_parent(global_compiler_context)
+
+
+def _after_fork_child():
+    mlir_compiler.after_fork_child(global_compiler_context)
+
+
+if hasattr(os, "register_at_fork"):
+    os.register_at_fork(
+        before=_before_fork,
+        after_in_parent=_after_fork_parent,
+        after_in_child=_after_fork_child,
+    )
+
+
+def prefork_warmup(*funcs):
+    """Compile and load `funcs` in the parent process of the forking worker
+    pool, so workers inherit compiled code copy-on-write.
+
+    Each item is either a dispatcher, which is compiled for its already known
+    signatures, or `(dispatcher, signatures)` tuple. All deferred compilation
+    (lazy functions and background tiered compilation) is finished before
+    return, so workers don't compile them again. Parallel runtime threads
+    don't survive fork, if they were already started, they are stopped before
+    fork and restarted on the next parallel loop.
+
+    For the pools, which don't fork, use NUMBA_MLIR_OBJECT_CACHE_DIR, cached
+    objects are mapped read-only and shared between processes.
+    """
+    for func in funcs:
+        if isinstance(func, tuple):
+            func, sigs = func
+            for sig in sigs:
+                func.compile(sig)
+
+    mlir_compiler.finish_compilation(global_compiler_context)
@@ -4,10 +4,21 @@
 
 from .utils import readenv
 
+import atexit
 from collections import namedtuple
 
 DEFAULT_DEVICE = readenv("NUMBA_MLIR_DEFAULT_DEVICE", str, "")
 
+
+def invalidate_device_caps():
+    """Drop device capabilities, cached by the compiler. Must be called if
+    set of the available devices changed, e.g. after changing the devices
+    visibility filter."""
+    from .. import mlir_compiler
+
+    mlir_compiler.invalidate_device_caps()
+
+
 DeviceCaps = namedtuple(
     "DeviceCaps",
     [
@@ -16,6 +27,7 @@ DeviceCaps = namedtuple(
         "spirv_minor_version",
         "has_fp16",
         "has_fp64",
+        "subgroup_size",
     ],
 )
 
@@ -41,7 +53,7 @@ if _is_dpctl_available:
 
     from numba.core.datamodel.models import StructModel
 
-    from .target import typeof_impl
+    from .target import typeof_impl, register_argument_typeof
     from . import array_type
 
     try:
@@ -72,6 +84,7 @@ if _is_dpctl_available:
             spirv_minor_version=2,
             has_fp16=device.has_aspect_fp16,
             has_fp64=device.has_aspect_fp64,
+            subgroup_size=min(device.sub_group_sizes, default=0),
         )
 
     class USMNdArrayBaseType(array_type.FixedArray):
@@ -207,21 +220,77 @@ if _is_dpctl_available:
 
     register_model(USMNdArrayType)(USMNdArrayModel)
 
-    @typeof_impl.register(usm_ndarray)
-    def typeof_usm_ndarray(val, c):
-        """
-        This function creates the Numba type (USMNdArrayType) when a usm_ndarray is passed.
-        """
+    _SyclQueueInfo = namedtuple("_SyclQueueInfo", ["queue", "device", "filter_string"])
+
+    # Queue device info, keyed by the dpctl queue address. Queue object is kept
+    # alive by the cache, so its address can't be reused by another queue.
+    _sycl_queue_info_cache = {}
+    _SYCL_QUEUE_INFO_CACHE_SIZE = 64
+
+    # Queue, currently registered in the runtime for each device filter string.
+    # Queue objects are kept alive, so the same address means the same queue.
+    _registered_sycl_queues = {}
+
+    def _register_sycl_queue(queue, filter_string):
+        # Submit the device work into the caller queue instead of the runtime
+        # created one. Arrays on the same device can use different queues, so
+        # the registration is checked for every argument, and the queue of the
+        # last one wins. GPU runtime is only loaded when the first USM array is
+        # seen.
+        prev = _registered_sycl_queues.get(filter_string)
+        if prev is not None and prev.addressof_ref() == queue.addressof_ref():
+            return
+
+        from .gpu_runtime import register_sycl_queue
+
+        # Runtime copies the queue handle, so it doesn't depend on the Python
+        # object lifetime.
+        register_sycl_queue(filter_string, queue.addressof_ref())
+        _registered_sycl_queues[filter_string] = queue
+
+    @atexit.register
+    def _unregister_sycl_queues():
+        # Release runtime queue copies before the SYCL runtime is destroyed.
+        if not _registered_sycl_queues:
+            return
+
+        from .gpu_runtime import register_sycl_queue
+
+        for filter_string in _registered_sycl_queues:
+            register_sycl_queue(filter_string, None)
+
+        _registered_sycl_queues.clear()
+
+    def _get_sycl_queue_info(queue):
+        key = queue.addressof_ref()
+        ret = _sycl_queue_info_cache.get(key)
+        if ret is None:
+            device = queue.sycl_device
+            ret = _SyclQueueInfo(queue, device, device.filter_string)
+            if len(_sycl_queue_info_cache) >= _SYCL_QUEUE_INFO_CACHE_SIZE:
+                _sycl_queue_info_cache.clear()
+
+            _sycl_queue_info_cache[key] = ret
+
+        _register_sycl_queue(ret.queue, ret.filter_string)
+        return ret
+
+    # Resolved argument types, keyed by the cheap to compute array properties.
+    # Querying the device filter string and constructing the type instance
+    # dominates the dispatch overhead for small kernels.
+    _usm_ndarray_type_cache = {}
+    _USM_NDARRAY_TYPE_CACHE_SIZE = 1024
+
+    def _make_usm_ndarray_type(val, layout, fixed_dims):
         try:
             dtype = numpy_support.from_dtype(val.dtype)
         except NotImplementedError:
             raise ValueError("Unsupported array dtype: %s" % (val.dtype,))
-        layout = numpy_support.map_layout(val)
         readonly = False
 
-        device = val.device.sycl_device
-        filter_string = device.filter_string
-        fixed_dims = array_type.get_fixed_dims(val.shape)
+        info = _get_sycl_queue_info(val.sycl_queue)
+        device = info.device
+        filter_string = info.filter_string
         return USMNdArrayType(
             dtype,
             val.ndim,
@@ -233,6 +302,30 @@ if _is_dpctl_available:
             device=device,
         )
 
+    @register_argument_typeof(usm_ndarray)
+    def _typeof_usm_ndarray_cached(val):
+        layout = numpy_support.map_layout(val)
+        fixed_dims = array_type.get_fixed_dims(val.shape)
+        key = (val.dtype, layout, fixed_dims, val.usm_type, val.sycl_queue)
+        ret = _usm_ndarray_type_cache.get(key)
+        if ret is None:
+            ret = _make_usm_ndarray_type(val, layout, fixed_dims)
+            if len(_usm_ndarray_type_cache) >= _USM_NDARRAY_TYPE_CACHE_SIZE:
+                _usm_ndarray_type_cache.clear()
+
+            _usm_ndarray_type_cache[key] = ret
+        else:
+            _register_sycl_queue(val.sycl_queue, ret.filter_string)
+
+        return ret
+
+    @typeof_impl.register(usm_ndarray)
+    def typeof_usm_ndarray(val, c):
+        """
+        This function creates the Numba type (USMNdArrayType) when a usm_ndarray is passed.
+        """
+        return _typeof_usm_ndarray_cached(val)
+
     def adapt_sycl_array_from_python(pyapi, ary, ptr):
         assert pyapi.context.enable_nrt
         fnty = ir.FunctionType(ir.IntType(32), [pyapi.pyobj, pyapi.voidptr])
@@ -263,7 +356,7 @@ if _is_dpctl_available:
 
     def _get_filter_string(array):
         if isinstance(array, usm_ndarray):
-            return array.device.sycl_device.filter_string
+            return _get_sycl_queue_info(array.sycl_queue).filter_string
 
         return None
 
@@ -274,6 +367,8 @@ if _is_dpctl_available:
             err_str = f"usm_ndarray arguments have incompatibe devices: {dev_names}"
             raise ValueError(err_str)
 
+        return next(iter(devs), None)
+
     def get_default_device():
         if DEFAULT_DEVICE:
             device = dpctl.SyclDevice(DEFAULT_DEVICE)
@@ -288,7 +383,7 @@ else:  # _is_dpctl_available
 
     def check_usm_ndarray_args(args):
         # dpctl is not loaded, nothing to do
-        pass
+        return None
 
     def get_default_device():
         # TODO: deprecated
@@ -303,4 +398,5 @@ else:  # _is_dpctl_available
             spirv_minor_version=2,
             has_fp16=True,
             has_fp64=False,
+            subgroup_size=0,
         )
@@ -0,0 +1,246 @@
+# SPDX-FileCopyrightText: 2023 Intel Corporation
+#
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+"""
+Flat representation of Numba IR, consumed by the C++ lowering.
+
+Function IR is serialized into single int64 array of opcodes and operands,
+so C++ side doesn't need to access python attributes for each instruction.
+Variables, types and python objects (constants, globals, operators, etc.) are
+passed as the separate tables and referenced by index.
+
+Encoding, all values are int64:
+    num_blocks label*
+    (BLOCK label num_insts <inst>*)*
+
+Blocks are listed in label order, first block is the function entry block.
+
+Variables operands are indices into `var_names`/`var_types`, `obj` operands
+are indices into `objects`, `-1` means `None`.
+
+Opcodes must be kept in sync with `FlatOp` in `Lowering.cpp`.
+"""
+
+import array
+
+from numba.core import ir
+
+BLOCK = 0
+ASSIGN_ARG = 1  # target index
+ASSIGN_VAR = 2  # target src
+ASSIGN_CONST = 3  # target obj
+ASSIGN_GLOBAL = 4  # target obj(value) obj(name)
+BINOP = 5  # target obj(fn) lhs rhs
+INPLACE_BINOP = 6  # target obj(immutable_fn) lhs rhs
+UNARY = 7  # target obj(fn) value
+CAST = 8  # target value
+CALL = 9  # target func obj(func_name) vararg nargs args* nkws (obj(name) var)*
+PHI = 10  # target count (var label)*
+BUILD_TUPLE = 11  # target count vars*
+GETITEM = 12  # target value index
+STATIC_GETITEM = 13  # target value obj(index)
+GETITER = 14  # target value
+ITERNEXT = 15  # target value
+PAIR_FIRST = 16  # target value
+PAIR_SECOND = 17  # target value
+GETATTR = 18  # target value obj(attr)
+EXHAUST_ITER = 19  # target value count
+SETITEM = 20  # target index value
+STATIC_SETITEM = 21  # target obj(index) value
+DEL = 22  # value
+RETURN = 23  # value
+BRANCH = 24  # cond truebr falsebr
+JUMP = 25  # target
+
+_SIMPLE_EXPRS = {
+    "cast": CAST,
+    "getiter": GETITER,
+    "iternext": ITERNEXT,
+    "pair_first": PAIR_FIRST,
+    "pair_second": PAIR_SECOND,
+}
+
+
+class FlatIR:
+    def __init__(self, code, var_names, var_types, objects):
+        self.code = code
+        self.var_names = var_names
+        self.var_types = var_types
+        self.objects = objects
+
+
+class _Unsupported(Exception):
+    pass
+
+
+class _Flattener:
+    def __init__(self, typemap, resolve_func):
+        self._typemap = typemap
+        self._resolve_func = resolve_func
+        self._code = []
+        self._var_names = []
+        self._var_types = []
+        self._vars = {}
+        self._types = {}
+        self._objects = []
+        self._objects_ids = {}
+
+    def var(self, var):
+        return self.var_name(var.name)
+
+    def var_name(self, name):
+        ret = self._vars.get(name)
+        if ret is None:
+            ret = len(self._var_names)
+            self._vars[name] = ret
+            self._var_names.append(name)
+            # Types are deduplicated, so C++ converts each type only once.
+            typ = self._typemap.get(name)
+            type_index = self._types.get(typ)
+            if type_index is None:
+                type_index = len(self._types)
+                self._types[typ] = type_index
+            self._var_types.append(type_index)
+
+        return ret
+
+    def obj(self, obj):
+        key = id(obj)
+        ret = self._objects_ids.get(key)
+        if ret is None:
+            ret = len(self._objects)
+            self._objects_ids[key] = ret
+            self._objects.append(obj)
+
+        return ret
+
+    def opt_var(self, var):
+        return -1 if var is None else self.var(var)
+
+    def emit(self, *args):
+        self._code.extend(args)
+
+    def flatten(self, blocks):
+        labels = sorted(blocks.keys())
+        self.emit(len(labels), *labels)
+        for label in labels:
+            body = blocks[label].body
+            self.emit(BLOCK, label, len(body))
+            for inst in body:
+                self.inst(inst)
+
+        types = [None] * len(self._types)
+        for typ, i in self._types.items():
+            types[i] = typ
+
+        var_types = [types[i] for i in self._var_types]
+        return FlatIR(
+            array.array("q", self._code),
+            self._var_names,
+            var_types,
+            self._objects,
+        )
+
+    def inst(self, inst):
+        if isinstance(inst, ir.Assign):
+            self.assign(inst.target, inst.value)
+        elif isinstance(inst, ir.SetItem):
+            self.emit(
+                SETITEM,
+                self.var(inst.target),
+                self.var(inst.index),
+                self.var(inst.value),
+            )
+        elif isinstance(inst, ir.StaticSetItem):
+            self.emit(
+                STATIC_SETITEM,
+                self.var(inst.target),
+                self.obj(inst.index),
+                self.var(inst.value),
+            )
+        elif isinstance(inst, ir.Del):
+            self.emit(DEL, self.var_name(inst.value))
+        elif isinstance(inst, ir.Return):
+            self.emit(RETURN, self.var(inst.value))
+        elif isinstance(inst, ir.Branch):
+            self.emit(BRANCH, self.var(inst.cond), inst.truebr, inst.falsebr)
+        elif isinstance(inst, ir.Jump):
+            self.emit(JUMP, inst.target)
+        else:
+            raise _Unsupported()
+
+    def assign(self, target, value):
+        t = self.var(target)
+        if isinstance(value, ir.Arg):
+            self.emit(ASSIGN_ARG, t, value.index)
+        elif isinstance(value, ir.Expr):
+            self.expr(t, value)
+        elif isinstance(value, ir.Var):
+            self.emit(ASSIGN_VAR, t, self.var(value))
+        elif isinstance(value, ir.Const):
+            self.emit(ASSIGN_CONST, t, self.obj(value.value))
+        elif isinstance(value, (ir.Global, ir.FreeVar)):
+            self.emit(ASSIGN_GLOBAL, t, self.obj(value.value), self.obj(value.name))
+        else:
+            raise _Unsupported()
+
+    def expr(self, t, expr):
+        op = expr.op
+        simple = _SIMPLE_EXPRS.get(op)
+        if simple is not None:
+            self.emit(simple, t, self.var(expr.value))
+        elif op == "binop":
+            lhs = self.var(expr.lhs)
+            rhs = self.var(expr.rhs)
+            self.emit(BINOP, t, self.obj(expr.fn), lhs, rhs)
+        elif op == "inplace_binop":
+            lhs = self.var(expr.lhs)
+            rhs = self.var(expr.rhs)
+            self.emit(INPLACE_BINOP, t, self.obj(expr.immutable_fn), lhs, rhs)
+        elif op == "unary":
+            self.emit(UNARY, t, self.obj(expr.fn), self.var(expr.value))
+        elif op == "call":
+            func = expr.func
+            func_name = self._resolve_func(self._typemap[func.name])
+            self.emit(
+                CALL,
+                t,
+                self.var(func),
+                self.obj(func_name),
+                self.opt_var(expr.vararg),
+                len(expr.args),
+            )
+            self.emit(*[self.var(a) for a in expr.args])
+            self.emit(len(expr.kws))
+            for name, val in expr.kws:
+                self.emit(self.obj(name), self.var(val))
+        elif op == "phi":
+            self.emit(PHI, t, len(expr.incoming_values))
+            for val, block in zip(expr.incoming_values, expr.incoming_blocks):
+                self.emit(self.var(val), block)
+        elif op == "build_tuple":
+            self.emit(BUILD_TUPLE, t, len(expr.items))
+            self.emit(*[self.var(i) for i in expr.items])
+        elif op == "getitem":
+            self.emit(GETITEM, t, self.var(expr.value), self.var(expr.index))
+        elif op == "static_getitem":
+            self.emit(STATIC_GETITEM, t, self.var(expr.value), self.obj(expr.index))
+        elif op == "getattr":
+            self.emit(GETATTR, t, self.var(expr.value), self.obj(expr.attr))
+        elif op == "exhaust_iter":
+            self.emit(EXHAUST_ITER, t, self.var(expr.value), expr.count)
+        else:
+            raise _Unsupported()
+
+
+def flatten_func_ir(func_ir, typemap, resolve_func):
+    """
+    Returns `FlatIR` for the function or `None` if function contains
+    unsupported instructions (e.g. parfors), in which case the generic
+    lowering must be used.
+    """
+    try:
+        return _Flattener(typemap, resolve_func).flatten(func_ir.blocks)
+    except _Unsupported:
+        return None
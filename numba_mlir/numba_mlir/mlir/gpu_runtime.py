@@ -38,8 +38,10 @@ if IS_GPU_RUNTIME_AVAILABLE:
             "gpuxKernelDestroy",
             "gpuxKernelGet",
             "gpuxLaunchKernel",
+            "gpuxLaunchKernelPacked",
             "gpuxModuleDestroy",
             "gpuxModuleLoad",
+            "gpuxPrefetch",
             "gpuxQueueCreate",
             "gpuxQueueDestroy",
             "gpuxSuggestBlockSize",
@@ -53,6 +55,10 @@ if IS_GPU_RUNTIME_AVAILABLE:
             mlir_func_name("kernel_barrier"),
             mlir_func_name("kernel_mem_fence"),
             "gpuxDuplicateQueue",
+            "gpuxConcurrentBegin",
+            "gpuxConcurrentEnd",
+            "gpuxCoexecBegin",
+            "gpuxCoexecEnd",
         ]
 
         from itertools import product
@@ -80,3 +86,174 @@ if IS_GPU_RUNTIME_AVAILABLE:
 
     _register_funcs()
     del _register_funcs
+
+    _profile_num_kernels_func = runtime_lib.gpuxProfileGetNumKernels
+    _profile_num_kernels_func.restype = ctypes.c_int
+
+    _profile_kernel_func = runtime_lib.gpuxProfileGetKernel
+    _profile_kernel_func.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_uint64)]
+    _profile_kernel_func.restype = ctypes.c_char_p
+
+    _profile_reset_func = runtime_lib.gpuxProfileReset
+
+    _mem_profile_num_devices_func = runtime_lib.gpuxMemoryProfileGetNumDevices
+    _mem_profile_num_devices_func.restype = ctypes.c_int
+
+    _mem_profile_device_func = runtime_lib.gpuxMemoryProfileGetDevice
+    _mem_profile_device_func.argtypes = [
+        ctypes.c_int,
+        ctypes.POINTER(ctypes.c_uint64),
+    ]
+    _mem_profile_device_func.restype = ctypes.c_char_p
+
+    _mem_profile_reset_func = runtime_lib.gpuxMemoryProfileReset
+
+    _register_sycl_queue_func = runtime_lib.gpuxRegisterSyclQueue
+    _register_sycl_queue_func.argtypes = [ctypes.c_char_p, ctypes.c_void_p]
+
+    _synchronize_func = runtime_lib.gpuxSynchronize
+
+    _queue_cache_clear_func = runtime_lib.gpuxQueueCacheClear
+
+    _memcpy_func = runtime_lib.gpuxMemcpy
+    _memcpy_func.argtypes = [
+        ctypes.c_char_p,
+        ctypes.c_void_p,
+        ctypes.c_void_p,
+        ctypes.c_size_t,
+    ]
+
+    _set_trace_func = runtime_lib.gpuxSetTraceFunc
+    _set_trace_func.argtypes = [ctypes.c_void_p]
+
+    from .runtime import add_trace_hook
+
+    add_trace_hook(_set_trace_func)
+
+
+@atexit.register
+def _cleanup():
+    # Release the queues, cached by the main thread, before the SYCL runtime
+    # is destroyed.
+    if IS_GPU_RUNTIME_AVAILABLE:
+        _queue_cache_clear_func()
+
+
+def get_kernels_profile():
+    """Return dict of kernel name -> launch stats.
+
+    Stats are "calls", "device_time" (total), "mean", "p99" and
+    "queue_latency" (total time between submission and start), times are in
+    nanoseconds. Only collected with NUMBA_MLIR_GPU_PROFILE=1.
+    """
+    if not IS_GPU_RUNTIME_AVAILABLE:
+        return {}
+
+    keys = ["calls", "device_time", "mean", "p99", "queue_latency"]
+    res = {}
+    for i in range(_profile_num_kernels_func()):
+        stats = (ctypes.c_uint64 * len(keys))()
+        name = _profile_kernel_func(i, stats)
+        if name is None:
+            continue
+
+        res[name.decode()] = dict(zip(keys, stats))
+    return res
+
+
+def print_kernels_profile(file=None):
+    """Print kernels profile table, sorted by total device time."""
+    profile = get_kernels_profile()
+    print(
+        f"{'kernel':<40} {'calls':>8} {'total, ms':>12} {'mean, us':>12} "
+        f"{'p99, us':>12}",
+        file=file,
+    )
+    for name, s in sorted(profile.items(), key=lambda v: -v[1]["device_time"]):
+        print(
+            f"{name:<40} {s['calls']:>8} {s['device_time'] * 1e-6:>12.3f} "
+            f"{s['mean'] * 1e-3:>12.3f} {s['p99'] * 1e-3:>12.3f}",
+            file=file,
+        )
+
+
+def reset_kernels_profile():
+    if IS_GPU_RUNTIME_AVAILABLE:
+        _profile_reset_func()
+
+
+def get_memory_profile():
+    """Return dict of device name -> device memory stats.
+
+    Stats are "allocs", "allocated" (total bytes), "live" and "peak" (max live
+    bytes since the last reset). Only collected with NUMBA_MLIR_MEMORY_PROFILE=1.
+    """
+    if not IS_GPU_RUNTIME_AVAILABLE:
+        return {}
+
+    keys = ["allocs", "allocated", "live", "peak"]
+    res = {}
+    for i in range(_mem_profile_num_devices_func()):
+        stats = (ctypes.c_uint64 * len(keys))()
+        name = _mem_profile_device_func(i, stats)
+        if name is None:
+            continue
+
+        res[name.decode()] = dict(zip(keys, stats))
+    return res
+
+
+def reset_memory_profile():
+    if IS_GPU_RUNTIME_AVAILABLE:
+        _mem_profile_reset_func()
+
+
+def register_sycl_queue(device_name, queue_ptr):
+    """Submit all subsequent GPU work for the `device_name` device into the
+    existing `sycl::queue *` `queue_ptr`, None resets it to the runtime owned
+    queue."""
+    if IS_GPU_RUNTIME_AVAILABLE:
+        _register_sycl_queue_func(device_name.encode(), queue_ptr)
+
+
+def synchronize():
+    """Wait for the GPU work, left running by the jitted calls from the current
+    thread with NUMBA_MLIR_GPU_DEFERRED_SYNC=1. Must be called before device
+    results are read by anything other than the jitted code, e.g. by dpnp or
+    dpctl copies to host."""
+    if IS_GPU_RUNTIME_AVAILABLE:
+        _synchronize_func()
+
+
+def _get_copy_arg(arr):
+    if not arr.flags["C_CONTIGUOUS"]:
+        raise ValueError("Only C-contiguous arrays are supported")
+
+    usm = getattr(arr, "__sycl_usm_array_interface__", None)
+    if usm is None:
+        return arr.ctypes.data, None
+
+    ptr = usm["data"][0] + usm.get("offset", 0) * arr.itemsize
+    return ptr, arr.sycl_device.filter_string
+
+
+def copy(dst, src):
+    """Copy `src` array into `dst` array of the same size, one of them must be
+    dpctl `usm_ndarray` and other can be dpctl or NumPy array.
+
+    Copies of the large NumPy arrays are staged through the pinned host buffers,
+    chunk size is controlled by NUMBA_MLIR_GPU_STAGING_CHUNK_SIZE.
+    """
+    if dst.nbytes != src.nbytes:
+        raise ValueError(f"Size mismatch: {dst.nbytes} and {src.nbytes}")
+
+    dst_ptr, dst_device = _get_copy_arg(dst)
+    src_ptr, src_device = _get_copy_arg(src)
+    device = dst_device or src_device
+    if device is None:
+        raise ValueError("Either src or dst must be usm_ndarray")
+
+    if not IS_GPU_RUNTIME_AVAILABLE:
+        raise RuntimeError("GPU runtime is not available")
+
+    _memcpy_func(device.encode(), dst_ptr, src_ptr, dst.nbytes)
@@ -9,15 +9,36 @@ from numba.core.compiler import (
     CompilerBase,
     DefaultPassBuilder,
     Flags,
+    compile_result,
 )
-from numba.core.compiler_machinery import PassManager
+from numba.core.compiler_machinery import FunctionPass, PassManager, register_pass
 from numba.core import typing, cpu
 
+from collections import OrderedDict
+
 from numba_mlir.mlir.passes import MlirBackendInner, get_mlir_func
 
+from .settings import INNER_FUNC_CACHE_SIZE
 from .target import numba_mlir_target
 
 
+_last_typed_state = None
+
+
+@register_pass(mutates_CFG=False, analysis_only=True)
+class MlirSaveTypedState(FunctionPass):
+    _name = "mlir_save_typed_state"
+
+    def __init__(self):
+        FunctionPass.__init__(self)
+
+    def run_pass(self, state):
+        global _last_typed_state
+        _last_typed_state = state
+        state.cr = compile_result()
+        return False
+
+
 class MlirTempCompiler(CompilerBase):  # custom compiler extends from CompilerBase
     def define_pipelines(self):
         dpb = DefaultPassBuilder
@@ -27,7 +48,7 @@ class MlirTempCompiler(CompilerBase):  # custom compiler extends from CompilerBa
 
         pm.add_pass(ReconstructSSA, "ssa")
         pm.add_pass(NopythonTypeInference, "nopython frontend")
-        pm.add_pass(MlirBackendInner, "mlir backend")
+        pm.add_pass(MlirSaveTypedState, "save typed state")
 
         pm.finalize()
         return [pm]
@@ -55,6 +76,51 @@ def _compile_isolated(func, args, return_type=None, flags=DEFAULT_FLAGS, locals=
     )
 
 
-def compile_func(func, args, flags=DEFAULT_FLAGS):
+# Typed frontend results, shared between all modules compiled in the process,
+# so the same callee is only typed once and just lowered into each module.
+# Least recently used entries are evicted above `INNER_FUNC_CACHE_SIZE`.
+_typed_states_cache = OrderedDict()
+_typed_states_cache_size = INNER_FUNC_CACHE_SIZE
+
+
+def _get_cache_key(func, args, flags):
+    # Flags are recreated for each compilation, so compare them by value.
+    try:
+        key = (
+            func,
+            tuple(args),
+            flags.get_mangle_string(),
+            tuple(sorted(vars(flags).items())),
+        )
+        hash(key)
+        return key
+    except TypeError:
+        return None
+
+
+def _get_typed_state(func, args, flags):
+    key = None
+    if _typed_states_cache_size > 0:
+        key = _get_cache_key(func, args, flags)
+
+    state = _typed_states_cache.get(key) if key is not None else None
+    if state is not None:
+        _typed_states_cache.move_to_end(key)
+        return state
+
+    global _last_typed_state
     _compile_isolated(func, args, flags=flags)
+    state = _last_typed_state
+    _last_typed_state = None
+    if key is not None:
+        _typed_states_cache[key] = state
+        while len(_typed_states_cache) > _typed_states_cache_size:
+            _typed_states_cache.popitem(last=False)
+
+    return state
+
+
+def compile_func(func, args, flags=DEFAULT_FLAGS):
+    state = _get_typed_state(func, args, flags)
+    MlirBackendInner().run_pass(state)
     return get_mlir_func()
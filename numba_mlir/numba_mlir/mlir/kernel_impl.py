@@ -152,6 +152,15 @@ def _decorate_kern_body(body, kwargs):
     return mlir_njit(enable_gpu_pipeline=True, **kwargs)(body)
 
 
+def _is_host_call(args, device):
+    # Kernels for host arrays and CPU SYCL devices are lowered to the host
+    # loops, compile them with the parallel loops support.
+    if device is not None:
+        return ":cpu" in device
+
+    return not any(hasattr(a, "__sycl_usm_array_interface__") for a in args)
+
+
 class Kernel(KernelBase):
     def __init__(self, func, kwargs):
         super().__init__(func)
@@ -173,12 +182,24 @@ class Kernel(KernelBase):
             _decorate_kern_body(_kernel_body_def_size2, kwargs),
             _decorate_kern_body(_kernel_body_def_size3, kwargs),
         )
+        host_kwargs = dict(kwargs, parallel=True)
+        self._host_kern_body = (
+            _decorate_kern_body(_kernel_body1, host_kwargs),
+            _decorate_kern_body(_kernel_body2, host_kwargs),
+            _decorate_kern_body(_kernel_body3, host_kwargs),
+        )
+        self._host_kern_body_def_size = (
+            _decorate_kern_body(_kernel_body_def_size1, host_kwargs),
+            _decorate_kern_body(_kernel_body_def_size2, host_kwargs),
+            _decorate_kern_body(_kernel_body_def_size3, host_kwargs),
+        )
 
     def __call__(self, *args, **kwargs):
         self.check_call_args(args, kwargs)
 
         # kwargs is not supported
-        check_usm_ndarray_args(args)
+        device = check_usm_ndarray_args(args)
+        is_host = _is_host_call(args, device)
 
         func_index = len(self.global_size) - 1
         assert (
@@ -187,13 +208,17 @@ class Kernel(KernelBase):
 
         local_size = self.local_size
         if len(local_size) != 0:
-            self._kern_body[func_index](
+            kern_body = self._host_kern_body if is_host else self._kern_body
+            kern_body[func_index](
                 self.global_size, self.local_size, self._jit_func, *args
             )
         else:
-            self._kern_body_def_size[func_index](
-                self.global_size, self._jit_func, *args
+            kern_body = (
+                self._host_kern_body_def_size
+                if is_host
+                else self._kern_body_def_size
             )
+            kern_body[func_index](self.global_size, self._jit_func, *args)
 
 
 def kernel(func=None, **kwargs):
@@ -265,58 +290,78 @@ class atomic(Stub):
 
 
 def _define_atomic_funcs():
-    funcs = ["add", "sub"]
+    # Python name, runtime name, is integer only
+    funcs = [
+        ("add", "add", False),
+        ("sub", "add", False),
+        ("min", "min", False),
+        ("max", "max", False),
+        ("xchg", "xchg", False),
+        ("and_", "and", True),
+        ("or_", "or", True),
+    ]
 
     def get_func(func_name, sub):
-        if sub:
-
-            def api_func_impl(builder, arr, idx, val):
-                if not (isinstance(idx, int) and literal(idx) == 0):
-                    arr = builder.subview(arr, idx)
+        def api_func_impl(builder, arr, idx, val):
+            if not (isinstance(idx, int) and literal(idx) == 0):
+                arr = builder.subview(arr, idx)
 
-                dtype = arr.dtype
-                val = builder.cast(-val, dtype)
-                fname = f"atomic_add_{dtype_str(builder, dtype)}_{len(arr.shape)}"
-                return builder.external_call(fname, (arr, val), val)
+            dtype = arr.dtype
+            val = builder.cast(-val if sub else val, dtype)
+            fname = f"{func_name}_{dtype_str(builder, dtype)}_{len(arr.shape)}"
+            return builder.external_call(fname, (arr, val), val)
 
-        else:
-
-            def api_func_impl(builder, arr, idx, val):
-                if not (isinstance(idx, int) and literal(idx) == 0):
-                    arr = builder.subview(arr, idx)
+        return api_func_impl
 
-                dtype = arr.dtype
-                val = builder.cast(val, dtype)
-                fname = f"{func_name}_{dtype_str(builder, dtype)}_{len(arr.shape)}"
-                return builder.external_call(fname, (arr, val), val)
+    def cas_impl(builder, arr, idx, cmp, val):
+        if not (isinstance(idx, int) and literal(idx) == 0):
+            arr = builder.subview(arr, idx)
 
-        return api_func_impl
+        dtype = arr.dtype
+        cmp = builder.cast(cmp, dtype)
+        val = builder.cast(val, dtype)
+        fname = f"atomic_cas_{dtype_str(builder, dtype)}_{len(arr.shape)}"
+        return builder.external_call(fname, (arr, cmp, val), val)
 
-    def get_stub_func(func_name):
-        exec(f"def {func_name}(arr, idx, val): _stub_error()")
+    def get_stub_func(func_name, args):
+        exec(f"def {func_name}({args}): _stub_error()")
         return eval(func_name)
 
-    class _AtomicId(AbstractTemplate):
-        def generic(self, args, kws):
-            assert not kws
-            ary, idx, val = args
+    def get_typer(int_only, num_vals):
+        class _AtomicId(AbstractTemplate):
+            def generic(self, args, kws):
+                assert not kws
+                ary, idx = args[:2]
+                if int_only and not isinstance(ary.dtype, types.Integer):
+                    return
+
+                vals = (ary.dtype,) * num_vals
+                if ary.ndim == 1:
+                    return signature(ary.dtype, ary, types.intp, *vals)
+                elif ary.ndim > 1:
+                    return signature(ary.dtype, ary, idx, *vals)
 
-            if ary.ndim == 1:
-                return signature(ary.dtype, ary, types.intp, ary.dtype)
-            elif ary.ndim > 1:
-                return signature(ary.dtype, ary, idx, ary.dtype)
+        return _AtomicId
 
     this_module = sys.modules[__name__]
 
-    for name in funcs:
+    for name, rt_name, int_only in funcs:
         func_name = f"atomic_{name}"
-        func = get_stub_func(func_name)
+        func = get_stub_func(func_name, "arr, idx, val")
         setattr(this_module, func_name, func)
 
-        infer_global(func)(_AtomicId)
-        registry.register_func(func_name, func)(get_func(func_name, name == "sub"))
+        infer_global(func)(get_typer(int_only, 1))
+        impl = get_func(f"atomic_{rt_name}", name == "sub")
+        registry.register_func(func_name, func)(impl)
         setattr(atomic, name, func)
 
+    # Compare-and-swap, returns old value.
+    func = get_stub_func("atomic_cas", "arr, idx, cmp, val")
+    setattr(this_module, "atomic_cas", func)
+    infer_global(func)(get_typer(False, 2))
+    registry.register_func("atomic_cas", func)(cas_impl)
+    setattr(atomic, "cas", func)
+
 
 _define_atomic_funcs()
 del _define_atomic_funcs
@@ -441,8 +486,13 @@ class group(Stub):
     pass
 
 
-def _define_group_funcs():
+class subgroup(Stub):
+    pass
+
+
+def _define_collective_funcs(stub, prefix):
     ops = ["add", "mul", "min", "max"]
+    kinds = ["reduce", "inclusive_scan", "exclusive_scan"]
 
     def get_func(func_name):
         def api_func_impl(builder, value):
@@ -467,16 +517,88 @@ def _define_group_funcs():
 
     this_module = sys.modules[__name__]
 
-    for op in ops:
-        func_name = f"group_reduce_{op}"
-        short_name = f"reduce_{op}"
-        func = get_stub_func(func_name)
+    for kind in kinds:
+        for op in ops:
+            func_name = f"{prefix}_{kind}_{op}"
+            short_name = f"{kind}_{op}"
+            func = get_stub_func(func_name)
+            setattr(this_module, func_name, func)
+
+            infer_global(func)(_GroupId)
+            registry.register_func(func_name, func)(get_func(func_name))
+            setattr(stub, short_name, func)
+
+
+_define_collective_funcs(group, "group")
+_define_collective_funcs(subgroup, "subgroup")
+del _define_collective_funcs
+
+
+def _define_subgroup_funcs():
+    # Python name, arg name
+    shuffle_funcs = [
+        ("shuffle", "lane"),
+        ("shuffle_xor", "mask"),
+        ("broadcast", "lane"),
+    ]
+    id_funcs = ["get_local_id", "get_size", "get_group_id", "get_num_groups"]
+
+    def get_shuffle_func(func_name):
+        def api_func_impl(builder, value, arg):
+            elem_type = value.type
+            api_func_name = f"{func_name}_{dtype_str(builder, elem_type)}"
+            arg = builder.cast(arg, builder.int32)
+            res = builder.cast(0, elem_type)
+            return builder.external_call(
+                api_func_name, inputs=(value, arg), outputs=res
+            )
+
+        return api_func_impl
+
+    def get_id_func(func_name):
+        def api_func_impl(builder):
+            res = builder.cast(0, builder.int64)
+            return builder.external_call(func_name, inputs=(), outputs=res)
+
+        return api_func_impl
+
+    def get_stub_func(func_name, args):
+        exec(f"def {func_name}({args}): _stub_error()")
+        return eval(func_name)
+
+    class _ShuffleId(AbstractTemplate):
+        def generic(self, args, kws):
+            assert not kws
+            assert len(args) == 2
+            elem_type, arg_type = args
+            if not isinstance(arg_type, types.Integer):
+                return
+
+            return signature(elem_type, elem_type, arg_type)
+
+    class _SubgroupApiId(ConcreteTemplate):
+        cases = [signature(types.uint64)]
+
+    this_module = sys.modules[__name__]
+
+    for name, arg in shuffle_funcs:
+        func_name = f"subgroup_{name}"
+        func = get_stub_func(func_name, f"value, {arg}")
         setattr(this_module, func_name, func)
 
-        infer_global(func)(_GroupId)
-        registry.register_func(func_name, func)(get_func(func_name))
-        setattr(group, short_name, func)
+        infer_global(func)(_ShuffleId)
+        registry.register_func(func_name, func)(get_shuffle_func(func_name))
+        setattr(subgroup, name, func)
+
+    for name in id_funcs:
+        func_name = f"subgroup_{name}"
+        func = get_stub_func(func_name, "")
+        setattr(this_module, func_name, func)
+
+        infer_global(func)(_SubgroupApiId)
+        registry.register_func(func_name, func)(get_id_func(func_name))
+        setattr(subgroup, name, func)
 
 
-_define_group_funcs()
-del _define_group_funcs
+_define_subgroup_funcs()
+del _define_subgroup_funcs
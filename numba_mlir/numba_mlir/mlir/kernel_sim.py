@@ -2,6 +2,8 @@
 #
 # SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+import numpy as np
+
 from . import kernel_sim_impl
 
 from .kernel_base import KernelBase
@@ -14,11 +16,18 @@ from .kernel_impl import (
     atomic,
     atomic_add,
     atomic_sub,
+    atomic_min,
+    atomic_max,
+    atomic_xchg,
+    atomic_and_,
+    atomic_or_,
+    atomic_cas,
     barrier,
     mem_fence,
     local,
     private,
     group,
+    subgroup,
 )
 
 
@@ -35,6 +44,39 @@ class atomic_proxy:
         arr[ind] = new_val
         return new_val
 
+    @staticmethod
+    def _update(arr, ind, new_val):
+        old_val = arr[ind]
+        arr[ind] = new_val
+        return old_val
+
+    @staticmethod
+    def min(arr, ind, val):
+        return atomic_proxy._update(arr, ind, min(arr[ind], val))
+
+    @staticmethod
+    def max(arr, ind, val):
+        return atomic_proxy._update(arr, ind, max(arr[ind], val))
+
+    @staticmethod
+    def xchg(arr, ind, val):
+        return atomic_proxy._update(arr, ind, val)
+
+    @staticmethod
+    def and_(arr, ind, val):
+        return atomic_proxy._update(arr, ind, arr[ind] & val)
+
+    @staticmethod
+    def or_(arr, ind, val):
+        return atomic_proxy._update(arr, ind, arr[ind] | val)
+
+    @staticmethod
+    def cas(arr, ind, cmp, val):
+        old_val = arr[ind]
+        if old_val == cmp:
+            arr[ind] = val
+        return old_val
+
 
 def mem_fence_proxy(flags):
     pass  # Nothing
@@ -52,19 +94,78 @@ class private_proxy:
         return kernel_sim_impl.private_array(shape, dtype)
 
 
-class group_proxy:
-    @staticmethod
-    def reduce_add(value):
-        return kernel_sim_impl.group_reduce(value, lambda a, b: a + b)
+def _max_value(value):
+    dtype = np.asarray(value).dtype
+    if np.issubdtype(dtype, np.integer):
+        return dtype.type(np.iinfo(dtype).max)
+    return dtype.type(np.inf)
+
+
+def _min_value(value):
+    dtype = np.asarray(value).dtype
+    if np.issubdtype(dtype, np.integer):
+        return dtype.type(np.iinfo(dtype).min)
+    return dtype.type(-np.inf)
 
-    def reduce_mul(value):
-        return kernel_sim_impl.group_reduce(value, lambda a, b: a * b)
 
-    def reduce_min(value):
-        return kernel_sim_impl.group_reduce(value, lambda a, b: min(a, b))
+# Name, combine func, identity func
+_collective_ops = [
+    ("add", lambda a, b: a + b, lambda v: type(v)(0)),
+    ("mul", lambda a, b: a * b, lambda v: type(v)(1)),
+    ("min", lambda a, b: min(a, b), _max_value),
+    ("max", lambda a, b: max(a, b), _min_value),
+]
+
+_collective_names = [
+    f"{kind}_{name}"
+    for kind in ["reduce", "inclusive_scan", "exclusive_scan"]
+    for name, _, _ in _collective_ops
+]
+
+
+def _define_collective_proxy(reduce_func, scan_func):
+    class proxy:
+        pass
+
+    for name, op, identity in _collective_ops:
+
+        def reduce_impl(value, op=op):
+            return reduce_func(value, op)
+
+        def inclusive_impl(value, op=op):
+            return scan_func(value, op)
+
+        def exclusive_impl(value, op=op, identity=identity):
+            return scan_func(value, op, identity(value))
+
+        setattr(proxy, f"reduce_{name}", staticmethod(reduce_impl))
+        setattr(proxy, f"inclusive_scan_{name}", staticmethod(inclusive_impl))
+        setattr(proxy, f"exclusive_scan_{name}", staticmethod(exclusive_impl))
 
-    def reduce_max(value):
-        return kernel_sim_impl.group_reduce(value, lambda a, b: max(a, b))
+    return proxy
+
+
+group_proxy = _define_collective_proxy(
+    kernel_sim_impl.group_reduce, kernel_sim_impl.group_scan
+)
+
+subgroup_proxy = _define_collective_proxy(
+    kernel_sim_impl.subgroup_reduce, kernel_sim_impl.subgroup_scan
+)
+subgroup_proxy.shuffle = staticmethod(kernel_sim_impl.subgroup_shuffle)
+subgroup_proxy.shuffle_xor = staticmethod(kernel_sim_impl.subgroup_shuffle_xor)
+subgroup_proxy.broadcast = staticmethod(kernel_sim_impl.subgroup_shuffle)
+subgroup_proxy.get_local_id = staticmethod(kernel_sim_impl.subgroup_get_local_id)
+subgroup_proxy.get_size = staticmethod(kernel_sim_impl.subgroup_get_size)
+subgroup_proxy.get_group_id = staticmethod(
+    kernel_sim_impl.subgroup_get_group_id
+)
+subgroup_proxy.get_num_groups = staticmethod(
+    kernel_sim_impl.subgroup_get_num_groups
+)
+
+_subgroup_names = ["shuffle", "shuffle_xor", "broadcast"]
+_subgroup_id_names = ["get_local_id", "get_size", "get_group_id", "get_num_groups"]
 
 
 def barrier_proxy(flags):
@@ -80,6 +181,12 @@ _globals_to_replace = [
     (atomic, atomic_proxy),
     (atomic_add, atomic_proxy.add),
     (atomic_sub, atomic_proxy.sub),
+    (atomic_min, atomic_proxy.min),
+    (atomic_max, atomic_proxy.max),
+    (atomic_xchg, atomic_proxy.xchg),
+    (atomic_and_, atomic_proxy.and_),
+    (atomic_or_, atomic_proxy.or_),
+    (atomic_cas, atomic_proxy.cas),
     (barrier, barrier_proxy),
     (mem_fence, mem_fence_proxy),
     (local, local_proxy),
@@ -87,21 +194,31 @@ _globals_to_replace = [
     (private, private_proxy),
     (private.array, private_proxy.array),
     (group, group_proxy),
-    (group.reduce_add, group_proxy.reduce_add),
-    (group.reduce_mul, group_proxy.reduce_mul),
-    (group.reduce_min, group_proxy.reduce_min),
-    (group.reduce_max, group_proxy.reduce_max),
+    (subgroup, subgroup_proxy),
 ]
 
 _barrier_ops = [
     barrier,
     group,
-    group.reduce_add,
-    group.reduce_mul,
-    group.reduce_min,
-    group.reduce_max,
+    subgroup,
 ]
 
+for _name in _collective_names:
+    for _stub, _proxy in [(group, group_proxy), (subgroup, subgroup_proxy)]:
+        _globals_to_replace.append((getattr(_stub, _name), getattr(_proxy, _name)))
+        _barrier_ops.append(getattr(_stub, _name))
+
+for _name in _subgroup_names:
+    _globals_to_replace.append(
+        (getattr(subgroup, _name), getattr(subgroup_proxy, _name))
+    )
+    _barrier_ops.append(getattr(subgroup, _name))
+
+for _name in _subgroup_id_names:
+    _globals_to_replace.append(
+        (getattr(subgroup, _name), getattr(subgroup_proxy, _name))
+    )
+
 
 def _have_barrier_ops(func):
     for v in func.__globals__.values():
@@ -28,9 +28,13 @@ _ExecutionState = namedtuple(
         "local_arrays",
         "current_local_array",
         "reduce_val",
+        "group_size",
     ],
 )
 
+# Subgroup size, used by the simulator. Real devices can use different sizes.
+SUBGROUP_SIZE = 8
+
 _execution_state = None
 
 
@@ -52,8 +56,9 @@ def _restore_local_state(state, saved_state):
     state.current_local_array[0] = saved_state[1]
 
 
-def _reset_local_state(state, wg_size):
+def _reset_local_state(state, wg_size, group_size):
     state.wg_size[0] = wg_size
+    state.group_size[:] = group_size
     state.current_task[0] = 0
     state.local_arrays.clear()
     state.current_local_array[0] = 0
@@ -82,6 +87,49 @@ def _reduce_impl(state, value, op):
     return state.reduce_val[0]
 
 
+def _linear_local_id(state):
+    # Dimension 0 is the fastest changing one, same as on device.
+    res = 0
+    stride = 1
+    for i, l, s in zip(state.indices, state.local_size, state.group_size):
+        res += (i % l) * stride
+        stride *= s
+    return res
+
+
+def _collective_impl(state, value, func):
+    if state.current_task[0] == 0:
+        state.reduce_val[0] = [None] * state.wg_size[0]
+
+    index = _linear_local_id(state)
+    state.reduce_val[0][index] = value
+    _barrier_impl(state)
+    res = func(state.reduce_val[0], index)
+
+    # Don't let the next collective op overwrite values before all work-items
+    # have computed their results.
+    _barrier_impl(state)
+    return res
+
+
+def _scan(values, index, op, identity):
+    if identity is not None:
+        if index == 0:
+            return identity
+
+        index -= 1
+
+    return reduce(op, values[: index + 1])
+
+
+def _subgroup_func(func):
+    def wrapper(values, index):
+        start = index - index % SUBGROUP_SIZE
+        return func(values[start : start + SUBGROUP_SIZE], index - start)
+
+    return wrapper
+
+
 def _setup_execution_state(global_size, local_size):
     global _execution_state
     assert _execution_state is None
@@ -96,6 +144,7 @@ def _setup_execution_state(global_size, local_size):
         local_arrays=[],
         current_local_array=[0],
         reduce_val=[None],
+        group_size=[0] * len(global_size),
     )
     return _execution_state
 
@@ -152,6 +201,52 @@ def group_reduce(value, op):
     return _reduce_impl(get_exec_state(), value, op)
 
 
+def group_scan(value, op, identity=None):
+    """
+    Inclusive scan if `identity` is None, exclusive otherwise.
+    """
+    func = lambda values, index: _scan(values, index, op, identity)
+    return _collective_impl(get_exec_state(), value, func)
+
+
+def subgroup_reduce(value, op):
+    func = lambda values, index: reduce(op, values)
+    return _collective_impl(get_exec_state(), value, _subgroup_func(func))
+
+
+def subgroup_scan(value, op, identity=None):
+    func = lambda values, index: _scan(values, index, op, identity)
+    return _collective_impl(get_exec_state(), value, _subgroup_func(func))
+
+
+def subgroup_shuffle(value, lane):
+    func = lambda values, index: values[lane]
+    return _collective_impl(get_exec_state(), value, _subgroup_func(func))
+
+
+def subgroup_shuffle_xor(value, mask):
+    func = lambda values, index: values[index ^ mask]
+    return _collective_impl(get_exec_state(), value, _subgroup_func(func))
+
+
+def subgroup_get_local_id():
+    return _linear_local_id(get_exec_state()) % SUBGROUP_SIZE
+
+
+def subgroup_get_size():
+    state = get_exec_state()
+    start = _linear_local_id(state) // SUBGROUP_SIZE * SUBGROUP_SIZE
+    return min(SUBGROUP_SIZE, state.wg_size[0] - start)
+
+
+def subgroup_get_group_id():
+    return _linear_local_id(get_exec_state()) // SUBGROUP_SIZE
+
+
+def subgroup_get_num_groups():
+    return (get_exec_state().wg_size[0] + SUBGROUP_SIZE - 1) // SUBGROUP_SIZE
+
+
 def local_array(shape, dtype):
     state = get_exec_state()
     current = state.current_local_array[0]
@@ -207,7 +302,7 @@ def execute_kernel(
                 min(g - o, l) for o, g, l in zip(offset, global_size, local_size)
             )
             count = reduce(lambda a, b: a * b, size)
-            _reset_local_state(state, count)
+            _reset_local_state(state, count, size)
 
             indices_range = (range(o, o + s) for o, s in zip(offset, size))
 
@@ -21,9 +21,7 @@ from numba.core.typed_passes import NativeLowering as orig_NativeLowering
 # from numba.core.pylowering import PyLower as orig_PyLower
 
 from .runtime import *
-from .math_runtime import *
 from .numba_runtime import *
-from .gpu_runtime import *
 
 from .utils import scoped_time
 
@@ -4,17 +4,27 @@
 
 import ctypes
 import atexit
+import threading
 from .utils import load_lib, mlir_func_name, register_cfunc
 from .settings import MKL_AVAILABLE, SYCL_MKL_AVAILABLE
+from .runtime import runtime_lib as parallel_runtime_lib
 
 runtime_lib = load_lib("numba-mlir-math-runtime")
-runtime_sycl_lib = load_lib("numba-mlir-math-sycl-runtime")
 
 _init_func = runtime_lib.nmrtMathRuntimeInit
 _init_func()
 
-_init_sycl_func = runtime_sycl_lib.nmrtMathRuntimeInit
-_init_sycl_func()
+# SYCL runtime is only loaded by the first GPU pipeline compilation.
+runtime_sycl_lib = None
+_sycl_lock = threading.Lock()
+
+# Make MKL calls aware of the parallel runtime, to avoid oversubscription.
+_set_parallel_hooks_func = runtime_lib.nmrtMathRuntimeSetParallelHooks
+_set_parallel_hooks_func.argtypes = [ctypes.c_void_p, ctypes.c_void_p]
+_set_parallel_hooks_func(
+    ctypes.cast(parallel_runtime_lib.nmrtParallelIsInRegion, ctypes.c_void_p),
+    ctypes.cast(parallel_runtime_lib.nmrtParallelExecute, ctypes.c_void_p),
+)
 
 
 def load_function_variants(runtime_lib, func_name, suffixes):
@@ -26,7 +36,15 @@ def load_function_variants(runtime_lib, func_name, suffixes):
 
 
 if MKL_AVAILABLE:
-    load_function_variants(runtime_lib, "mkl_gemm_%s", ["float32", "float64"])
+    load_function_variants(
+        runtime_lib,
+        "mkl_gemm_%s",
+        ["float32", "float64", "float16", "f16acc_float16"],
+    )
+    load_function_variants(runtime_lib, "mkl_gemm_batch_%s", ["float32", "float64"])
+    load_function_variants(
+        runtime_lib, "mkl_gemm_epilogue_%s", ["float32", "float64"]
+    )
 
     _dtypes = ["float32", "float64", "complex64", "complex128"]
     load_function_variants(runtime_lib, "mkl_inv_%s", _dtypes)
@@ -34,16 +52,57 @@ if MKL_AVAILABLE:
     load_function_variants(runtime_lib, "mkl_cholesky_%s", _dtypes)
     load_function_variants(runtime_lib, "mkl_eig_%s", _dtypes)
     load_function_variants(runtime_lib, "mkl_eigh_%s", _dtypes)
-if SYCL_MKL_AVAILABLE:
+
+    _fft_dtypes = ["complex64", "complex128"]
+    load_function_variants(runtime_lib, "mkl_fft_%s", _fft_dtypes)
+    load_function_variants(runtime_lib, "mkl_fft2_%s", _fft_dtypes)
+    load_function_variants(runtime_lib, "mkl_rfft_%s", _fft_dtypes)
+
+
+def _register_sycl_funcs(lib):
+    load_function_variants(lib, "mkl_gemm_%s_device", ["float32", "float64"])
+    load_function_variants(lib, "mkl_gemm_batch_%s_device", ["float32", "float64"])
     load_function_variants(
-        runtime_sycl_lib, "mkl_gemm_%s_device", ["float32", "float64"]
+        lib, "mkl_gemm_epilogue_%s_device", ["float32", "float64"]
     )
 
+    _dtypes = ["float32", "float64", "complex64", "complex128"]
+    load_function_variants(lib, "mkl_inv_%s_device", _dtypes)
+    load_function_variants(lib, "mkl_solve_%s_device", _dtypes)
+    load_function_variants(lib, "mkl_cholesky_%s_device", _dtypes)
+    load_function_variants(lib, "mkl_eigh_%s_device", _dtypes)
+
+    _fft_dtypes = ["complex64", "complex128"]
+    load_function_variants(lib, "mkl_fft_%s_device", _fft_dtypes)
+    load_function_variants(lib, "mkl_fft2_%s_device", _fft_dtypes)
+    load_function_variants(lib, "mkl_rfft_%s_device", _fft_dtypes)
+
+    _sort_dtypes = ["int32", "int64", "uint32", "uint64", "float32", "float64"]
+    load_function_variants(lib, "nmrtSort_%s_device", _sort_dtypes)
+    load_function_variants(lib, "nmrtArgSort_%s_device", _sort_dtypes)
+
+
+def load_sycl_runtime():
+    """Load SYCL math runtime and register its functions, if not loaded yet."""
+    global runtime_sycl_lib
+    with _sycl_lock:
+        if runtime_sycl_lib is not None:
+            return
+
+        lib = load_lib("numba-mlir-math-sycl-runtime")
+        lib.nmrtMathRuntimeInit()
+        if SYCL_MKL_AVAILABLE:
+            _register_sycl_funcs(lib)
+
+        runtime_sycl_lib = lib
+
+
 _finalize_func = runtime_lib.nmrtMathRuntimeFinalize
-_finalize_sycl_func = runtime_sycl_lib.nmrtMathRuntimeFinalize
 
 
 @atexit.register
 def _cleanup():
+    _set_parallel_hooks_func(None, None)
     _finalize_func()
-    _finalize_sycl_func()
+    if runtime_sycl_lib is not None:
+        runtime_sycl_lib.nmrtMathRuntimeFinalize()
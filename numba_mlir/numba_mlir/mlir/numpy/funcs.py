@@ -24,6 +24,7 @@ from ..func_registry import add_func
 
 import numpy
 import math
+import string
 from numba import prange
 
 from numba.core import types
@@ -33,7 +34,7 @@ from collections import namedtuple
 
 from ..target import infer_global
 from ..builtin import helper_funcs
-from ..settings import MKL_AVAILABLE
+from ..settings import MKL_AVAILABLE, F16_F32_ACCUMULATE
 
 
 def performance_warning(message):
@@ -236,6 +237,270 @@ def prod_impl(builder, arg, dtype=None, axis=None, keepdims=False):
     )
 
 
+# Arrays smaller than this are scanned sequentially.
+_SCAN_PARALLEL_THRESHOLD = 1 << 16
+_SCAN_BLOCK_SIZE = 1 << 13
+
+_scan_template = """
+def scan(a):
+    n = a.size
+    res = numpy.empty((n,), a.dtype)
+    if n < {threshold}:
+        if n > 0:
+            acc = a[0]
+            res[0] = acc
+            for i in range(1, n):
+                acc = acc {op} a[i]
+                res[i] = acc
+        return res
+
+    # Two-pass blocked scan: scan blocks in parallel, scan block totals
+    # sequentially and then apply them to the subsequent blocks in parallel.
+    num_blocks = (n + {block} - 1) // {block}
+    totals = numpy.empty((num_blocks,), a.dtype)
+    for b in prange(num_blocks):
+        begin = b * {block}
+        end = min(begin + {block}, n)
+        acc = a[begin]
+        res[begin] = acc
+        for i in range(begin + 1, end):
+            acc = acc {op} a[i]
+            res[i] = acc
+        totals[b] = acc
+
+    for b in range(1, num_blocks):
+        totals[b] = totals[b - 1] {op} totals[b]
+
+    for b in prange(1, num_blocks):
+        begin = b * {block}
+        end = min(begin + {block}, n)
+        offset = totals[b - 1]
+        for i in range(begin, end):
+            res[i] = offset {op} res[i]
+    return res
+"""
+
+
+def _gen_scan_func(op):
+    src = _scan_template.format(
+        op=op, threshold=_SCAN_PARALLEL_THRESHOLD, block=_SCAN_BLOCK_SIZE
+    )
+    res = {}
+    exec(src, {"__name__": __name__, "numpy": numpy, "prange": prange}, res)
+    return res["scan"]
+
+
+_cumsum_func = _gen_scan_func("+")
+_cumprod_func = _gen_scan_func("*")
+
+
+def _array_scan(builder, arg, dtype, axis, func):
+    axis = literal(axis)
+    if axis is not None:
+        if not isinstance(axis, int) or len(arg.shape) != 1:
+            return
+
+        _fix_axis(axis, 1)
+
+    if dtype is None:
+        dtype = promote_int(arg.dtype, builder)
+
+    arg = convert_array(builder, flatten_impl(builder, arg), dtype)
+    res_type = builder.array_type([DYNAMIC_DIM], dtype)
+    return builder.inline_func(func, res_type, arg)
+
+
+@register_func("array.cumsum")
+@register_func("numpy.cumsum", numpy.cumsum)
+def cumsum_impl(builder, arg, axis=None, dtype=None):
+    return _array_scan(builder, arg, dtype, axis, _cumsum_func)
+
+
+@register_func("array.cumprod")
+@register_func("numpy.cumprod", numpy.cumprod)
+def cumprod_impl(builder, arg, axis=None, dtype=None):
+    return _array_scan(builder, arg, dtype, axis, _cumprod_func)
+
+
+_sort_dtypes = ["int32", "int64", "uint32", "uint64", "float32", "float64"]
+
+
+def _get_sort_input(builder, arg, axis):
+    axis = literal(axis)
+    if axis is None:
+        return flatten_impl(builder, arg)
+
+    if not isinstance(axis, int) or len(arg.shape) != 1:
+        return None
+
+    _fix_axis(axis, 1)
+    return arg
+
+
+def _get_sort_dtype(builder, dtype):
+    for name in _sort_dtypes:
+        if dtype == getattr(builder, name):
+            return name
+
+    return None
+
+
+@register_func("numpy.sort", numpy.sort)
+def sort_impl(builder, arg, axis=-1):
+    arg = _get_sort_input(builder, arg, axis)
+    if arg is None:
+        return
+
+    dtype = _get_sort_dtype(builder, arg.dtype)
+    if dtype is None:
+        return
+
+    res = builder.init_tensor(arg.shape, arg.dtype)
+    func_name = f"nmrtSort_{dtype}"
+    return builder.external_call(
+        func_name,
+        (arg,),
+        res,
+        attrs={"gpu_runtime.device_func": func_name + "_device"},
+    )
+
+
+@register_func("array.argsort")
+@register_func("numpy.argsort", numpy.argsort)
+def argsort_impl(builder, arg, axis=-1):
+    arg = _get_sort_input(builder, arg, axis)
+    if arg is None:
+        return
+
+    dtype = _get_sort_dtype(builder, arg.dtype)
+    if dtype is None:
+        return
+
+    res = builder.init_tensor(arg.shape, builder.int64)
+    func_name = f"nmrtArgSort_{dtype}"
+    return builder.external_call(
+        func_name,
+        (arg,),
+        res,
+        attrs={"gpu_runtime.device_func": func_name + "_device"},
+    )
+
+
+# Masks smaller than this are compacted sequentially.
+_COMPRESS_PARALLEL_THRESHOLD = 1 << 16
+_COMPRESS_BLOCK_SIZE = 1 << 13
+
+_compress_template = """
+def compress({args}):
+    n = mask.size
+    if n < {threshold}:
+        res = numpy.empty((n,), {dtype})
+        count = 0
+        for i in range(n):
+            if mask[i]:
+                res[count] = {value}
+                count += 1
+        return res[0:count]
+
+    # Stream compaction: count selected elements per block in parallel, do
+    # exclusive scan of the block counts sequentially and then scatter blocks
+    # to their offsets in parallel.
+    num_blocks = (n + {block} - 1) // {block}
+    offsets = numpy.empty((num_blocks + 1,), numpy.int64)
+    offsets[0] = 0
+    for b in prange(num_blocks):
+        begin = b * {block}
+        end = min(begin + {block}, n)
+        count = 0
+        for i in range(begin, end):
+            if mask[i]:
+                count += 1
+        offsets[b + 1] = count
+
+    for b in range(num_blocks):
+        offsets[b + 1] += offsets[b]
+
+    res = numpy.empty((offsets[num_blocks],), {dtype})
+    for b in prange(num_blocks):
+        begin = b * {block}
+        end = min(begin + {block}, n)
+        curr = offsets[b]
+        for i in range(begin, end):
+            if mask[i]:
+                res[curr] = {value}
+                curr += 1
+    return res
+"""
+
+
+def _gen_compress_func(args, dtype, value):
+    src = _compress_template.format(
+        args=args,
+        dtype=dtype,
+        value=value,
+        threshold=_COMPRESS_PARALLEL_THRESHOLD,
+        block=_COMPRESS_BLOCK_SIZE,
+    )
+    res = {}
+    exec(src, {"__name__": __name__, "numpy": numpy, "prange": prange}, res)
+    return res["compress"]
+
+
+# Selects elements of `a` where `mask` is true, both arrays are 1D.
+_compress_values_func = _gen_compress_func("a, mask", "a.dtype", "a[i]")
+
+# Returns indices of the nonzero elements of 1D `mask`.
+_compress_indices_func = _gen_compress_func("mask", "numpy.int64", "i")
+
+
+@register_func("array.nonzero")
+@register_func("numpy.nonzero", numpy.nonzero)
+def nonzero_impl(builder, arg):
+    shape = arg.shape
+    num_dims = len(shape)
+    if num_dims == 0:
+        return
+
+    mask = flatten_impl(builder, arg)
+    res_type = builder.array_type([DYNAMIC_DIM], builder.int64)
+    indices = builder.inline_func(_compress_indices_func, res_type, mask)
+    if num_dims == 1:
+        return (indices,)
+
+    def body(i, s, n, r):
+        return (i // s) % n
+
+    res = []
+    stride = builder.cast(1, builder.int64)
+    for i in reversed(range(num_dims)):
+        size = builder.cast(shape[i], builder.int64)
+        res.append(eltwise(builder, (indices, stride, size), body))
+        stride = stride * size
+
+    return tuple(reversed(res))
+
+
+def _unique_func(a):
+    n = a.size
+    res = numpy.empty((n,), a.dtype)
+    count = 0
+    for i in range(n):
+        if i == 0 or a[i] != a[i - 1]:
+            res[count] = a[i]
+            count += 1
+    return res[0:count]
+
+
+@register_func("numpy.unique", numpy.unique)
+def unique_impl(builder, arg):
+    arg = sort_impl(builder, arg, None)
+    if arg is None:
+        return
+
+    res_type = builder.array_type([DYNAMIC_DIM], arg.dtype)
+    return builder.inline_func(_unique_func, res_type, arg)
+
+
 @register_func("numpy.flip", numpy.flip)
 def flip_impl(builder, arg, axis=None):
     shape = arg.shape
@@ -615,6 +880,14 @@ def ones_impl(builder, shape, dtype=None):
     return _init_impl(builder, shape, dtype, 1)
 
 
+@register_func("numpy.full", numpy.full)
+def full_impl(builder, shape, fill_value, dtype=None):
+    if dtype is None:
+        dtype = get_array_type(builder, fill_value)
+
+    return _init_impl(builder, shape, dtype, fill_value)
+
+
 def _init_like_impl(builder, arr, shape, dtype, init=None):
     shape = arr.shape if shape is None else shape
     dtype = arr.dtype if dtype is None else dtype
@@ -636,6 +909,11 @@ def ones_like_impl(builder, arr, dtype=None, shape=None):
     return _init_like_impl(builder, arr, shape, dtype, 1)
 
 
+@register_func("numpy.full_like", numpy.full_like)
+def full_like_impl(builder, arr, fill_value, dtype=None, shape=None):
+    return _init_like_impl(builder, arr, shape, dtype, fill_value)
+
+
 _is_np_long64 = numpy.int_ == numpy.int64
 
 
@@ -681,6 +959,50 @@ def arange_impl(builder, start, stop=None, step=None, dtype=None):
     return builder.linalg_generic((start, step), init, iterators, maps, body)
 
 
+@register_func("numpy.linspace", numpy.linspace)
+def linspace_impl(builder, start, stop, num=50, endpoint=True, dtype=None):
+    num = literal(num)
+    endpoint = literal(endpoint)
+
+    if dtype is None:
+        dtype = builder.float64
+
+    num = builder.cast(num, builder.int64)
+    num = builder.select(num < 0, 0, num)
+
+    # Last element is set to `stop` exactly, as numpy does, -1 if none.
+    last = builder.select(num > 1, num - 1, -1)
+    if is_literal(endpoint):
+        div = num - 1 if endpoint else num
+        if not endpoint:
+            last = -1
+    else:
+        div = builder.select(endpoint, num - 1, num)
+        last = builder.select(endpoint, last, -1)
+
+    start = builder.cast(start, builder.float64)
+    stop = builder.cast(stop, builder.float64)
+    div = builder.cast(builder.select(div > 0, div, 1), builder.float64)
+    step = (stop - start) / div
+
+    inputs = (
+        builder.from_elements(start),
+        builder.from_elements(step),
+        builder.from_elements(stop),
+        builder.from_elements(last, builder.int64),
+    )
+    init = builder.init_tensor([num], dtype)
+
+    iterators = ["parallel"]
+    maps = ["(d0) -> (0)"] * len(inputs) + ["(d0) -> (d0)"]
+
+    def body(a, b, c, d, e):
+        i = _linalg_index(0)
+        return c if i == d else a + b * i
+
+    return builder.linalg_generic(inputs, init, iterators, maps, body)
+
+
 @register_func("numpy.eye", numpy.eye)
 def eye_impl(builder, N, M=None, k=0, dtype=None):
     if M is None:
@@ -774,8 +1096,15 @@ def _mkl_gemm(builder, a, b, alpha, beta, shape1, shape2, out=None):
     else:
         c = out
 
-    alpha = builder.cast(alpha, dtype)
-    beta = builder.cast(beta, dtype)
+    # Half precision gemm takes f32 scalars.
+    scalar_dtype = dtype
+    if dtype == builder.float16:
+        scalar_dtype = builder.float32
+        if not F16_F32_ACCUMULATE:
+            func_name = "mkl_gemm_f16acc_float16"
+
+    alpha = builder.cast(alpha, scalar_dtype)
+    beta = builder.cast(beta, scalar_dtype)
 
     return builder.external_call(
         func_name,
@@ -801,17 +1130,175 @@ def _linalg_matmul2d(builder, a, b, shape1, shape2):
     return builder.linalg_generic((a, b), init, iterators, maps, body)
 
 
-def _matmul2d(builder, a, b, shape1, shape2):
-    if (
+# Max static dim size for matmul to be generated inline instead of mkl call.
+_SMALL_MATMUL_MAX_DIM = 8
+
+
+def _is_small_static_matmul(m, k, n):
+    dims = (literal(m), literal(k), literal(n))
+    return all(is_literal(d) and d <= _SMALL_MATMUL_MAX_DIM for d in dims)
+
+
+def _use_mkl_matmul(builder, a, b, allow_f16=False):
+    # Only plain 2D gemm has half precision variant.
+    is_f16 = a.dtype == builder.float16 or b.dtype == builder.float16
+    if is_f16 and not (allow_f16 and a.dtype == b.dtype):
+        return False
+
+    return (
         MKL_AVAILABLE
         and not is_complex(a.dtype, builder)
         and not is_complex(b.dtype, builder)
-    ):
+    )
+
+
+def _matmul2d(builder, a, b, shape1, shape2):
+    small = _is_small_static_matmul(shape1[0], shape1[1], shape2[1])
+    if _use_mkl_matmul(builder, a, b, allow_f16=True) and not small:
         return _mkl_gemm(builder, a, b, 1, 0, shape1, shape2)
     else:
         return _linalg_matmul2d(builder, a, b, shape1, shape2)
 
 
+# Matmul epilogue activations, must be in sync with compiler and math runtime.
+_MATMUL_ACTIVATION_NONE = 0
+_MATMUL_ACTIVATION_RELU = 1
+
+
+@_mkl_func
+def _mkl_gemm_epilogue(builder, a, b, bias, activation, shape1, shape2):
+    copy_a = _check_mkl_strides(a)
+    copy_b = _check_mkl_strides(b)
+
+    a = builder.ifop(copy_a, lambda: builder.force_copy(a), lambda: a)
+    b = builder.ifop(copy_b, lambda: builder.force_copy(b), lambda: b)
+
+    dtype = a.dtype
+    func_name = f"mkl_gemm_epilogue_{dtype_str(builder, dtype)}"
+    device_func_name = func_name + "_device"
+
+    res_shape = (shape1[0], shape2[1])
+    c = builder.init_tensor(res_shape, dtype)
+
+    activation = builder.cast(activation, builder.int64)
+
+    return builder.external_call(
+        func_name,
+        (a, b, bias, activation),
+        c,
+        attrs={"gpu_runtime.device_func": device_func_name},
+    )
+
+
+# Generated by the compiler for `act(a @ b + bias)` chains.
+@register_func("__internal_matmul_epilogue")
+def matmul_epilogue_impl(builder, a, b, bias, activation):
+    activation = literal(activation)
+    assert activation in (_MATMUL_ACTIVATION_NONE, _MATMUL_ACTIVATION_RELU)
+
+    shape1 = a.shape
+    shape2 = b.shape
+    small = _is_small_static_matmul(shape1[0], shape1[1], shape2[1])
+    if _use_mkl_matmul(builder, a, b) and not small:
+        return _mkl_gemm_epilogue(builder, a, b, bias, activation, shape1, shape2)
+
+    dtype = a.dtype
+    res = _linalg_matmul2d(builder, a, b, shape1, shape2)
+    res = eltwise(builder, (res, bias), lambda a, b, c: a + b, dtype)
+    if activation == _MATMUL_ACTIVATION_RELU:
+        zero = builder.cast(0, dtype)
+        res = eltwise(builder, (res, zero), lambda a, b, c: max(a, b), dtype)
+
+    return res
+
+
+def _check_mkl_batch_strides(arr):
+    strides = arr.strides
+    res = (strides[0] <= 0).or_op(strides[1] <= 0).or_op(strides[2] <= 0)
+    res = ((strides[1] != 1).and_op(strides[2] != 1)).or_op(res)
+    return res
+
+
+@_mkl_func
+def _mkl_gemm_batch(builder, a, b, shape1, shape2):
+    copy_a = _check_mkl_batch_strides(a)
+    copy_b = _check_mkl_batch_strides(b)
+
+    a = builder.ifop(copy_a, lambda: builder.force_copy(a), lambda: a)
+    b = builder.ifop(copy_b, lambda: builder.force_copy(b), lambda: b)
+
+    dtype = a.dtype
+    func_name = f"mkl_gemm_batch_{dtype_str(builder, dtype)}"
+    device_func_name = func_name + "_device"
+
+    res_shape = (shape1[0], shape1[1], shape2[2])
+    c = builder.init_tensor(res_shape, dtype)
+
+    alpha = builder.cast(1, dtype)
+    beta = builder.cast(0, dtype)
+
+    return builder.external_call(
+        func_name,
+        (a, b, alpha, beta),
+        c,
+        attrs={"gpu_runtime.device_func": device_func_name},
+    )
+
+
+def _linalg_matmul3d(builder, a, b, shape1, shape2):
+    iterators = ["parallel", "parallel", "parallel", "reduction"]
+    expr1 = "(d0,d1,d2,d3) -> (d0,d1,d3)"
+    expr2 = "(d0,d1,d2,d3) -> (d0,d3,d2)"
+    expr3 = "(d0,d1,d2,d3) -> (d0,d1,d2)"
+    maps = [expr1, expr2, expr3]
+    res_shape = (shape1[0], shape1[1], shape2[2])
+    dtype = broadcast_type_arrays(builder, (a, b))
+    init = builder.init_tensor(res_shape, dtype, 0)
+
+    def body(a, b, c):
+        return a * b + c
+
+    return builder.linalg_generic((a, b), init, iterators, maps, body)
+
+
+def _matmul3d(builder, a, b, shape1, shape2):
+    """Batch dims must be equal."""
+    small = _is_small_static_matmul(shape1[1], shape1[2], shape2[2])
+    if _use_mkl_matmul(builder, a, b) and not small:
+        return _mkl_gemm_batch(builder, a, b, shape1, shape2)
+    else:
+        return _linalg_matmul3d(builder, a, b, shape1, shape2)
+
+
+def _matmul3d_broadcast(builder, a, b, shape1, shape2):
+    # Broadcast batch dims against size-only (B, 1, 1) tensors, broadcast will
+    # fail at runtime for incompatible batch dims.
+    batch_a = builder.init_tensor((shape1[0], 1, 1), a.dtype)
+    batch_b = builder.init_tensor((shape2[0], 1, 1), b.dtype)
+    a, _ = builder.broadcast(a, batch_b, result_type=None)
+    b, _ = builder.broadcast(b, batch_a, result_type=None)
+    return _linalg_matmul3d(builder, a, b, a.shape, b.shape)
+
+
+def _matmul3d_any_batch(builder, a, b, shape1, shape2):
+    batch1 = literal(shape1[0])
+    batch2 = literal(shape2[0])
+    if is_literal(batch1) and is_literal(batch2):
+        if batch1 == batch2:
+            return _matmul3d(builder, a, b, shape1, shape2)
+
+        if batch1 != 1 and batch2 != 1:
+            return
+
+        return _matmul3d_broadcast(builder, a, b, shape1, shape2)
+
+    return builder.ifop(
+        shape1[0] == shape2[0],
+        lambda: _matmul3d(builder, a, b, shape1, shape2),
+        lambda: _matmul3d_broadcast(builder, a, b, shape1, shape2),
+    )
+
+
 def _dot1d(builder, a, b):
     iterators = ["reduction"]
     expr1 = "(d0) -> (d0)"
@@ -894,6 +1381,9 @@ def matmul_impl(builder, a, b):
     shape2 = b.shape
     dim1 = len(shape1)
     dim2 = len(shape2)
+    if dim1 == 3 and dim2 == 3:
+        return _matmul3d_any_batch(builder, a, b, shape1, shape2)
+
     if dim1 > 2 or dim2 > 2:
         return
 
@@ -906,6 +1396,360 @@ def matmul_impl(builder, a, b):
     return _matmul2d(builder, a, b, shape1, shape2)
 
 
+# Contractions with all dims static and total loop size not exceeding this are
+# generated as a single linalg.generic instead of GEMM calls.
+_EINSUM_SMALL_LOOP_SIZE = _SMALL_MATMUL_MAX_DIM**3
+
+# Dynamic dim size estimate, used to select contraction order.
+_EINSUM_DYNAMIC_DIM_SIZE = 256
+
+
+def _parse_einsum_subscripts(subscripts, num_operands):
+    # TODO: ellipsis and repeated labels (diagonals) are not supported.
+    if not isinstance(subscripts, str) or "." in subscripts:
+        return None
+
+    subscripts = subscripts.replace(" ", "")
+    if "->" in subscripts:
+        inputs, output = subscripts.split("->", 1)
+    else:
+        inputs, output = subscripts, None
+
+    inputs = inputs.split(",")
+    if len(inputs) != num_operands:
+        return None
+
+    for labels in inputs:
+        if not all(l.isalpha() for l in labels) or len(set(labels)) != len(labels):
+            return None
+
+    all_labels = "".join(inputs)
+    if output is None:
+        # Implicit mode: labels, which appear exactly once, in alphabetical order.
+        output = "".join(sorted(l for l in set(all_labels) if all_labels.count(l) == 1))
+
+    if not all(l in all_labels for l in output) or len(set(output)) != len(output):
+        return None
+
+    return inputs, output
+
+
+_einsum_bodies = {}
+
+
+def _get_einsum_body(num_inputs):
+    body = _einsum_bodies.get(num_inputs)
+    if body is None:
+        args = ", ".join(f"a{i}" for i in range(num_inputs))
+        prod = " * ".join(f"a{i}" for i in range(num_inputs))
+        src = f"def body({args}, c):\n    return {prod} + c\n"
+        res = {}
+        exec(src, {"__name__": __name__}, res)
+        body = res["body"]
+        _einsum_bodies[num_inputs] = body
+
+    return body
+
+
+def _einsum_generic(builder, operands, inputs, output, dims, dtype):
+    loops = list(output)
+    for labels in inputs:
+        loops += [l for l in labels if l not in loops]
+
+    idx = {l: f"d{i}" for i, l in enumerate(loops)}
+    src = ",".join(idx[l] for l in loops)
+    maps = [f"({src}) -> ({','.join(idx[l] for l in labels)})" for labels in inputs]
+    iterators = ["parallel" if l in output else "reduction" for l in loops]
+    body = _get_einsum_body(len(operands))
+    if not output:
+        maps.append(f"({src}) -> (0)")
+        init = builder.from_elements(0, dtype)
+        res = builder.linalg_generic(tuple(operands), init, iterators, maps, body)
+        return builder.extract(res, 0)
+
+    maps.append(f"({src}) -> ({','.join(idx[l] for l in output)})")
+    init = builder.init_tensor(tuple(dims[l] for l in output), dtype, 0)
+    return builder.linalg_generic(tuple(operands), init, iterators, maps, body)
+
+
+def _einsum_loop_size(labels, dims):
+    size = 1
+    static = True
+    for l in labels:
+        d = literal(dims[l])
+        if is_literal(d):
+            size *= d
+        else:
+            size *= _EINSUM_DYNAMIC_DIM_SIZE
+            static = False
+
+    return size, static
+
+
+def _einsum_group_size(group, dims):
+    res = 1
+    for l in group:
+        res = res * dims[l]
+    return res
+
+
+def _einsum_to_matrix(builder, a, labels, groups, dims):
+    axes = tuple(labels.index(l) for l in "".join(groups))
+    if axes != tuple(range(len(labels))):
+        a = transpose_impl(builder, a, axes)
+
+    shape = tuple(_einsum_group_size(g, dims) for g in groups)
+    return builder.reshape(a, shape)
+
+
+def _einsum_contract(builder, a, la, b, lb, keep, dims):
+    """
+    Contracts two operands as a (batched) matmul: operands are transposed and
+    reshaped to the [batch, m, k] and [batch, k, n] forms, result has labels
+    `batch + m + n`.
+    """
+    batch = "".join(l for l in la if l in lb and l in keep)
+    contr = "".join(l for l in la if l in lb and l not in keep)
+    m = "".join(l for l in la if l not in lb)
+    n = "".join(l for l in lb if l not in la)
+    res_labels = batch + m + n
+    if not res_labels:
+        a = _einsum_to_matrix(builder, a, la, (contr,), dims)
+        b = _einsum_to_matrix(builder, b, lb, (contr,), dims)
+        return _dot1d(builder, a, b), res_labels
+
+    if batch:
+        a = _einsum_to_matrix(builder, a, la, (batch, m, contr), dims)
+        b = _einsum_to_matrix(builder, b, lb, (batch, contr, n), dims)
+        res = _matmul3d(builder, a, b, a.shape, b.shape)
+    else:
+        a = _einsum_to_matrix(builder, a, la, (m, contr), dims)
+        b = _einsum_to_matrix(builder, b, lb, (contr, n), dims)
+        res = _matmul2d(builder, a, b, a.shape, b.shape)
+
+    res_shape = tuple(dims[l] for l in res_labels)
+    return builder.reshape(res, res_shape), res_labels
+
+
+def _einsum_select_pair(ops, dims):
+    # Greedy order: contract the pair with the smallest loop nest first.
+    best = None
+    for i in range(len(ops)):
+        for j in range(i + 1, len(ops)):
+            labels = set(ops[i][1]) | set(ops[j][1])
+            cost, _ = _einsum_loop_size(labels, dims)
+            if best is None or cost < best[0]:
+                best = (cost, i, j)
+
+    return best[1], best[2]
+
+
+def _einsum(builder, operands, inputs, output):
+    dims = {}
+    for a, labels in zip(operands, inputs):
+        shape = a.shape
+        if len(shape) != len(labels):
+            return None
+
+        for l, s in zip(labels, shape):
+            prev = dims.setdefault(l, s)
+            if not is_literal(literal(s)):
+                continue
+
+            if not is_literal(literal(prev)):
+                # Prefer static size.
+                dims[l] = s
+            elif literal(prev) != literal(s):
+                raise ValueError(
+                    f"einsum: size of label '{l}' mismatch: "
+                    f"{literal(prev)} vs {literal(s)}"
+                )
+
+    dtype = broadcast_type_arrays(builder, operands)
+    operands = [convert_array(builder, a, dtype) for a in operands]
+
+    # Small contractions are emitted as a single fused generic op.
+    size, static = _einsum_loop_size(set("".join(inputs)), dims)
+    if len(operands) == 1 or (static and size <= _EINSUM_SMALL_LOOP_SIZE):
+        return _einsum_generic(builder, operands, inputs, output, dims, dtype)
+
+    # Sum out labels, which appear only in a single operand, 0-d operands are
+    # multiplied with the result as scalars.
+    ops = []
+    scalars = []
+    for i, (a, labels) in enumerate(zip(operands, inputs)):
+        if not labels:
+            scalars.append(_einsum_generic(builder, (a,), (labels,), "", dims, dtype))
+            continue
+
+        others = "".join(l for j, l in enumerate(inputs) if j != i)
+        kept = "".join(l for l in labels if l in output or l in others)
+        if kept != labels:
+            a = _einsum_generic(builder, (a,), (labels,), kept, dims, dtype)
+
+        ops.append((a, kept))
+
+    while len(ops) > 1:
+        i, j = _einsum_select_pair(ops, dims)
+        (a, la), (b, lb) = ops[i], ops[j]
+        ops = [op for k, op in enumerate(ops) if k not in (i, j)]
+        keep = set(output).union(*(l for _, l in ops))
+        res, labels = _einsum_contract(builder, a, la, b, lb, keep, dims)
+        if labels:
+            ops.append((res, labels))
+        else:
+            scalars.append(res)
+
+    if not ops:
+        res = scalars[0]
+        for s in scalars[1:]:
+            res = res * s
+        return res
+
+    res, labels = ops[0]
+    if labels != output:
+        res = transpose_impl(builder, res, tuple(labels.index(l) for l in output))
+
+    for s in scalars:
+        res = eltwise(builder, (res, s), lambda a, b, c: a * b, dtype)
+
+    return res
+
+
+@register_func("numpy.einsum", numpy.einsum)
+def einsum_impl(builder, subscripts, *operands):
+    parsed = _parse_einsum_subscripts(literal(subscripts), len(operands))
+    if parsed is None:
+        return
+
+    inputs, output = parsed
+    return _einsum(builder, operands, inputs, output)
+
+
+@register_func("numpy.tensordot", numpy.tensordot)
+def tensordot_impl(builder, a, b, axes=2):
+    ndim_a = len(a.shape)
+    ndim_b = len(b.shape)
+    axes = literal(axes)
+    if isinstance(axes, int):
+        axes_a = tuple(range(ndim_a - axes, ndim_a))
+        axes_b = tuple(range(axes))
+    elif isinstance(axes, tuple) and len(axes) == 2:
+        axes_a, axes_b = (
+            tuple(x) if isinstance(x, tuple) else (x,) for x in map(literal, axes)
+        )
+    else:
+        return
+
+    if len(axes_a) != len(axes_b) or not all(
+        isinstance(x, int) for x in axes_a + axes_b
+    ):
+        return
+
+    axes_a = tuple(_fix_axis(x, ndim_a) for x in axes_a)
+    axes_b = tuple(_fix_axis(x, ndim_b) for x in axes_b)
+
+    la = list(string.ascii_letters[:ndim_a])
+    lb = list(string.ascii_letters[ndim_a : ndim_a + ndim_b])
+    for x, y in zip(axes_a, axes_b):
+        lb[y] = la[x]
+
+    output = [l for i, l in enumerate(la) if i not in axes_a]
+    output += [l for i, l in enumerate(lb) if i not in axes_b]
+    inputs = ("".join(la), "".join(lb))
+    return _einsum(builder, (a, b), inputs, "".join(output))
+
+
+# Generated by the compiler for `np.sum(a * b, axis)`.
+@register_func("__internal_sum_product")
+def sum_product_impl(builder, a, b, dtype=None, axis=None, keepdims=False):
+    def fallback():
+        prod = eltwise(builder, (a, b), lambda a, b, c: a * b)
+        return sum_impl(builder, prod, dtype, axis, keepdims)
+
+    axis = literal(axis)
+    keepdims = literal(keepdims)
+    if dtype is not None or keepdims:
+        return fallback()
+
+    rank = max(len(a.shape), len(b.shape))
+    if axis is None:
+        axis = tuple(range(rank))
+    elif isinstance(axis, int):
+        axis = (axis,)
+
+    if not isinstance(axis, tuple) or not all(isinstance(x, int) for x in axis):
+        return fallback()
+
+    axis = tuple(_fix_axis(x, rank) for x in axis)
+
+    # Assign contraction label to each broadcasted dim. Dims of size 1,
+    # broadcasted against the other operand, are dropped from that operand.
+    def get_dims(arr):
+        shape = arr.shape
+        return [None] * (rank - len(shape)) + [shape[i] for i in range(len(shape))]
+
+    def is_one(d):
+        return literal(d) == 1
+
+    dims_a = get_dims(a)
+    dims_b = get_dims(b)
+    la = lb = output = ""
+    shape_a = []
+    shape_b = []
+    res_shape = []
+    cond = None
+    for i, (da, db) in enumerate(zip(dims_a, dims_b)):
+        l = string.ascii_letters[i]
+        if da is not None and db is not None and is_one(da) and is_one(db):
+            if i not in axis:
+                res_shape.append(1)
+            continue
+
+        use_a = da is not None and (db is None or not is_one(da) or is_one(db))
+        use_b = db is not None and (da is None or not is_one(db) or is_one(da))
+        if use_a:
+            la += l
+            shape_a.append(da)
+        if use_b:
+            lb += l
+            shape_b.append(db)
+        if use_a and use_b:
+            if not (is_literal(literal(da)) and is_literal(literal(db))):
+                # Dynamic dims can still be broadcasted at runtime, check they
+                # are equal and use original expression otherwise.
+                eq = da == db
+                cond = eq if cond is None else cond.and_op(eq)
+            elif literal(da) != literal(db):
+                return fallback()
+
+        if i not in axis:
+            output += l
+            res_shape.append(da if use_a else db)
+
+    if set(la) == set(lb):
+        # No broadcasting, nothing to gain from GEMM.
+        return fallback()
+
+    def squeeze(arr, shape):
+        if len(shape) == len(arr.shape):
+            return arr
+
+        return builder.reshape(arr, tuple(shape))
+
+    def contract():
+        args = (squeeze(a, shape_a), squeeze(b, shape_b))
+        res = _einsum(builder, args, (la, lb), output)
+        if len(res_shape) != len(output):
+            res = builder.reshape(res, tuple(res_shape))
+        return res
+
+    if cond is None:
+        return contract()
+
+    return builder.ifop(cond, contract, fallback)
+
+
 @_mkl_func
 def _mkl_inv(builder, a):
     n = a.shape[0]
@@ -978,8 +1822,6 @@ def _mkl_eig(builder, a, is_vals):
     func_name = f"mkl_eig_{dtype_str(builder, dtype)}"
     device_func_name = func_name + "_device"
 
-    a = builder.force_copy(a)
-
     JOBVL = builder.cast(ord("N"), builder.int8)
     if is_vals:
         JOBVR = builder.cast(ord("N"), builder.int8)
@@ -1102,6 +1944,87 @@ def eigvalsh_impl(builder, a):
     return _mkl_eigh(builder, a, True)
 
 
+def _get_fft_input(builder, a, dtype):
+    # Runtime expects contiguous input, `convert_array` already makes a new one.
+    if a.dtype == dtype:
+        return builder.force_copy(a)
+
+    return convert_array(builder, a, dtype)
+
+
+@_mkl_func
+def _mkl_fft(builder, a, inverse):
+    # Same as numpy, always compute in double precision.
+    dtype = builder.complex128
+    ndim = len(a.shape)
+    if ndim == 1:
+        func_name = f"mkl_fft_{dtype_str(builder, dtype)}"
+    else:
+        func_name = f"mkl_fft2_{dtype_str(builder, dtype)}"
+
+    device_func_name = func_name + "_device"
+
+    a = _get_fft_input(builder, a, dtype)
+    res = builder.init_tensor(a.shape, dtype)
+    inverse = builder.cast(int(inverse), builder.int64)
+
+    return builder.external_call(
+        func_name,
+        (a, inverse),
+        res,
+        attrs={"gpu_runtime.device_func": device_func_name},
+    )
+
+
+@_mkl_func
+def _mkl_rfft(builder, a):
+    dtype = builder.complex128
+    func_name = f"mkl_rfft_{dtype_str(builder, dtype)}"
+    device_func_name = func_name + "_device"
+
+    a = _get_fft_input(builder, a, builder.float64)
+    res = builder.init_tensor((a.shape[0] // 2 + 1,), dtype)
+
+    return builder.external_call(
+        func_name,
+        (a,),
+        res,
+        attrs={"gpu_runtime.device_func": device_func_name},
+    )
+
+
+@register_func("numpy.fft.fft", numpy.fft.fft)
+def fft_impl(builder, a):
+    if len(a.shape) != 1:
+        return
+
+    return _mkl_fft(builder, a, False)
+
+
+@register_func("numpy.fft.ifft", numpy.fft.ifft)
+def ifft_impl(builder, a):
+    if len(a.shape) != 1:
+        return
+
+    return _mkl_fft(builder, a, True)
+
+
+@register_func("numpy.fft.fft2", numpy.fft.fft2)
+def fft2_impl(builder, a):
+    if len(a.shape) != 2:
+        return
+
+    return _mkl_fft(builder, a, False)
+
+
+@register_func("numpy.fft.rfft", numpy.fft.rfft)
+def rfft_impl(builder, a):
+    if len(a.shape) != 1 or is_complex(a.dtype, builder):
+        return
+
+    return _mkl_rfft(builder, a)
+
+
 @_mkl_func
 def _mkl_solve(builder, a, b):
     a_shape = a.shape
@@ -1113,7 +2036,7 @@ def _mkl_solve(builder, a, b):
 
     n = a_shape[0]
 
-    a = builder.force_copy(a)
+    # Runtime copies `a` into its own scratch buffer, only `b` is overwritten.
     b = builder.force_copy(b)
     if len(b_shape) == 1:
         nrhs = 1
@@ -1151,7 +2074,13 @@ def solve_impl(builder, a, b):
 
 
 @register_func("numpy.where", numpy.where)
-def where_impl(builder, cond, x, y):
+def where_impl(builder, cond, x=None, y=None):
+    if x is None and y is None:
+        return nonzero_impl(builder, cond)
+
+    if x is None or y is None:
+        return
+
     cond, x, y = builder.broadcast(cond, x, y, result_type=None)
     x, y = builder.broadcast(x, y, result_type=broadcast_type_arrays(builder, (x, y)))
 
@@ -1334,18 +2263,7 @@ def getitem_impl(builder, arr, index):
     if index.dtype == builder.bool:
         arr = flatten_impl(builder, arr)
         index = flatten_impl(builder, index)
-
-        def func(a, ind):
-            s = a.size
-            res = numpy.empty((s,), a.dtype)
-            curr = 0
-            for i in range(s):
-                if ind[i]:
-                    res[curr] = a[i]
-                    curr += 1
-            return res[0:curr]
-
-        return builder.inline_func(func, arr.type, arr, index)
+        return builder.inline_func(_compress_values_func, arr.type, arr, index)
     elif is_int(index.dtype, builder):
         arr = flatten_impl(builder, arr)
         index = flatten_impl(builder, index)
@@ -1551,3 +2469,193 @@ def cov_impl(builder, m, y=None, rowvar=True, bias=False, ddof=None):
     if _cov_scalar_result_expected(m, y):
         res = res[0, 0]
     return res
+
+
+# Counter-based Philox4x32-10 generator. Each element is computed from the
+# global key and its own counter, so generation is stateless per element and
+# results don't depend on the loop schedule. Runtime only reserves counter
+# ranges for each call.
+_PHILOX_CONSTANTS = {
+    "_PHILOX_M0": numpy.uint64(0xD2511F53),
+    "_PHILOX_M1": numpy.uint64(0xCD9E8D57),
+    "_PHILOX_W0": numpy.uint64(0x9E3779B9),
+    "_PHILOX_W1": numpy.uint64(0xBB67AE85),
+    "_M32": numpy.uint64(0xFFFFFFFF),
+    "_S32": numpy.uint64(32),
+    "_S11": numpy.uint64(11),
+    "_ZERO": numpy.uint64(0),
+    "_TWO_M53": 1.0 / 9007199254740992.0,
+    "_TWO_PI": 2.0 * math.pi,
+}
+
+_PHILOX_ROUNDS = 10
+
+_philox_round = """
+    p0 = _PHILOX_M0 * c0
+    p1 = _PHILOX_M1 * c2
+    c0, c1, c2, c3 = (
+        (p1 >> _S32) ^ c1 ^ k0,
+        p1 & _M32,
+        (p0 >> _S32) ^ c3 ^ k1,
+        p0 & _M32,
+    )
+    k0 = (k0 + _PHILOX_W0) & _M32
+    k1 = (k1 + _PHILOX_W1) & _M32
+"""
+
+_philox_template = """
+def body(key, base, {params}_):
+    c0 = base + numpy.uint64(_linalg_index(0))
+    c1 = c0 >> _S32
+    c0 = c0 & _M32
+    c2 = _ZERO
+    c3 = _ZERO
+    k0 = key & _M32
+    k1 = key >> _S32
+{rounds}
+{tail}
+"""
+
+# Tails convert 4x32 bit counter block into the result value. Floats use the
+# upper 53 bits of a 64 bit word, same as numpy.
+_philox_tails = {
+    "random": """
+    return numpy.float64(((c1 << _S32) | c0) >> _S11) * _TWO_M53
+""",
+    "uniform": """
+    u = numpy.float64(((c1 << _S32) | c0) >> _S11) * _TWO_M53
+    return low + (high - low) * u
+""",
+    "normal": """
+    u1 = (numpy.float64(((c1 << _S32) | c0) >> _S11) + 1.0) * _TWO_M53
+    u2 = numpy.float64(((c3 << _S32) | c2) >> _S11) * _TWO_M53
+    return loc + scale * (math.sqrt(-2.0 * math.log(u1)) * math.cos(_TWO_PI * u2))
+""",
+    "randint": """
+    x = (c1 << _S32) | c0
+    return low + numpy.int64(x % numpy.uint64(high - low))
+""",
+}
+
+
+def _gen_philox_body(kind, params):
+    src = _philox_template.format(
+        params="".join(p + ", " for p in params),
+        rounds=_philox_round * _PHILOX_ROUNDS,
+        tail=_philox_tails[kind],
+    )
+    glob = {
+        "__name__": __name__,
+        "numpy": numpy,
+        "math": math,
+        "_linalg_index": _linalg_index,
+    }
+    glob.update(_PHILOX_CONSTANTS)
+    res = {}
+    exec(src, glob, res)
+    return res["body"]
+
+
+_philox_bodies = {
+    "random": _gen_philox_body("random", ()),
+    "uniform": _gen_philox_body("uniform", ("low", "high")),
+    "normal": _gen_philox_body("normal", ("loc", "scale")),
+    "randint": _gen_philox_body("randint", ("low", "high")),
+}
+
+
+def _random_impl(builder, size, dtype, kind, params=()):
+    scalar = size is None
+    shape = (1,) if scalar else size
+    try:
+        len(shape)  # will raise if not available
+    except:
+        shape = (shape,)
+
+    count = 1
+    for s in shape:
+        count = count * s
+    count = builder.cast(count, builder.int64)
+
+    u64 = builder.uint64
+    key = builder.external_call(
+        "nmrtRandomKey", (), builder.cast(0, u64), decorate=False
+    )
+    base = builder.external_call(
+        "nmrtRandomAdvance", count, builder.cast(0, u64), decorate=False
+    )
+    state = builder.from_elements((key, base), u64)
+    inputs = [state, state]
+    maps = ["(d0) -> (0)", "(d0) -> (1)"]
+    if params:
+        params = builder.from_elements(params, dtype)
+        inputs += [params] * len(maps)
+        maps += ["(d0) -> (0)", "(d0) -> (1)"]
+
+    maps.append("(d0) -> (d0)")
+    init = builder.init_tensor([count], dtype)
+    res = builder.linalg_generic(
+        inputs, init, ["parallel"], maps, _philox_bodies[kind]
+    )
+    if scalar:
+        return builder.extract(res, 0)
+
+    if len(shape) == 1:
+        return res
+
+    return builder.reshape(res, shape)
+
+
+@register_func(
+    "numpy.random.seed", numpy.random.seed, primitive_type=PrimitiveType.SideEffect
+)
+def random_seed_impl(builder, seed):
+    seed = builder.cast(seed, builder.uint64)
+    builder.external_call("nmrtRandomSeed", seed, (), decorate=False)
+    return builder.cast(0, builder.int64)
+
+
+@register_func(
+    "numpy.random.random", numpy.random.random, primitive_type=PrimitiveType.SideEffect
+)
+def random_random_impl(builder, size=None):
+    return _random_impl(builder, size, builder.float64, "random")
+
+
+@register_func(
+    "numpy.random.uniform",
+    numpy.random.uniform,
+    primitive_type=PrimitiveType.SideEffect,
+)
+def random_uniform_impl(builder, low=0.0, high=1.0, size=None):
+    return _random_impl(builder, size, builder.float64, "uniform", (low, high))
+
+
+@register_func(
+    "numpy.random.normal", numpy.random.normal, primitive_type=PrimitiveType.SideEffect
+)
+def random_normal_impl(builder, loc=0.0, scale=1.0, size=None):
+    return _random_impl(builder, size, builder.float64, "normal", (loc, scale))
+
+
+@register_func(
+    "numpy.random.randint",
+    numpy.random.randint,
+    primitive_type=PrimitiveType.SideEffect,
+)
+def random_randint_impl(builder, low, high=None, size=None):
+    if high is None:
+        high = low
+        low = 0
+
+    low = literal(low)
+    high = literal(high)
+    if is_literal(low) and is_literal(high):
+        if high <= low:
+            raise ValueError("low >= high")
+    else:
+        # Generated code can't raise, empty range returns `low` instead of
+        # taking remainder by zero.
+        high = builder.select(high > low, high, low + 1)
+
+    return _random_impl(builder, size, builder.int64, "randint", (low, high))
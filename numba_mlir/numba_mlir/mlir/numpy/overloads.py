@@ -312,3 +312,33 @@ class GemmId(get_abstract_template(_gemm_pattern)):
         return_type = out
 
         return signature(return_type, a, b, out, a.dtype, a.dtype)
+
+
+def _fft_pattern(a):
+    return a
+
+
+def get_fft_id(ndim, allow_complex=True):
+    class FftId(get_abstract_template(_fft_pattern)):
+        def generic_impl(self, a):
+            if not isinstance(a, Array) or a.ndim != ndim:
+                return
+
+            is_complex = isinstance(a.dtype, types.Complex)
+            if not allow_complex and is_complex:
+                return
+
+            if not is_complex and not isinstance(a.dtype, Number):
+                return
+
+            return_type = Array(types.complex128, ndim, "C")
+            return signature(return_type, a)
+
+    return FftId
+
+
+for func in [np.fft.fft, np.fft.ifft]:
+    infer_global(func)(get_fft_id(1))
+
+infer_global(np.fft.fft2)(get_fft_id(2))
+infer_global(np.fft.rfft)(get_fft_id(1, allow_complex=False))
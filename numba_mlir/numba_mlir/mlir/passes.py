@@ -3,6 +3,7 @@
 # SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
 import functools
+import os
 
 import llvmlite.ir
 from numba.core import types, cgutils
@@ -16,8 +17,26 @@ import numba.core.ir as ir
 from numba.core.ir_utils import mk_unique_var
 from contextlib import contextmanager
 
-from .settings import DUMP_IR, OPT_LEVEL, DUMP_DIAGNOSTICS
+from .settings import (
+    DUMP_IR,
+    OPT_LEVEL,
+    DUMP_DIAGNOSTICS,
+    PARALLEL_PROFILE,
+    COMPILE_PROFILE,
+    PASS_STATISTICS,
+    TAPIR_TARGET,
+    AFFINE_OPT,
+    PREFETCH,
+    DETERMINISTIC_REDUCE,
+    GPU_AOT_TARGETS,
+    GPU_SPEC_CONSTANTS,
+    GPU_VECTOR_BITWIDTH,
+    GPU_PACK_ARGS,
+    MEMORY_PROFILE,
+)
 from . import func_registry
+from .aot import get_aot_object
+from .flat_ir import flatten_func_ir
 from .. import mlir_compiler
 from .compiler_context import global_compiler_context
 from .utils import scoped_time
@@ -90,7 +109,17 @@ def _init_flags(src):
     custom_flags = [
         ("gpu_fp64_truncate", False),
         ("gpu_use_64bit_index", True),
+        ("gpu_devices", None),
         ("mlir_force_inline", False),
+        ("mlir_parallel_schedule", None),
+        ("mlir_parallel_grain", 0),
+        ("mlir_parallel_backend", None),
+        ("mlir_cuda_threads_per_block", None),
+        ("mlir_cuda_occupancy_launch", None),
+        ("mlir_affine_opt", None),
+        ("mlir_prefetch", None),
+        ("mlir_deterministic_reduce", None),
+        ("mlir_pack_bool_arrays", False),
     ]
     for name, default in custom_flags:
         if hasattr(src, name):
@@ -103,6 +132,22 @@ def _init_flags(src):
     return flags
 
 
+def _get_parallel_backend(flags):
+    backend = _get_flag(flags, "mlir_parallel_backend", None)
+    if backend is None:
+        return "tbb" if TAPIR_TARGET == "none" else TAPIR_TARGET
+
+    if backend in ("tbb", "serial"):
+        return backend
+
+    if backend != TAPIR_TARGET:
+        raise ValueError(
+            f'mlir_parallel_backend="{backend}" requires NUMBA_MLIR_TAPIR_TARGET={backend}, got "{TAPIR_TARGET}"'
+        )
+
+    return backend
+
+
 def _get_cellvars(func):
     ret = {}
     closure = func.__closure__
@@ -177,6 +222,21 @@ class MlirBackendBase(FunctionPass):
             if mlir_force_inline is not None:
                 new_flags.mlir_force_inline = mlir_force_inline
 
+            for name in (
+                "mlir_parallel_schedule",
+                "mlir_parallel_grain",
+                "mlir_parallel_backend",
+                "mlir_cuda_threads_per_block",
+                "mlir_cuda_occupancy_launch",
+                "mlir_affine_opt",
+                "mlir_prefetch",
+                "mlir_deterministic_reduce",
+                "mlir_pack_bool_arrays",
+            ):
+                value = targetoptions.get(name, None)
+                if value is not None:
+                    setattr(new_flags, name, value)
+
             return (func.__module__ + "." + func.__qualname__, func, new_flags)
         if isinstance(obj, types.NumberClass):
             return (
@@ -200,10 +260,11 @@ class MlirBackendBase(FunctionPass):
         ctx = {}
         ctx["compiler_settings"] = {
             "verify": True,
-            "pass_statistics": False,
+            "pass_statistics": PASS_STATISTICS,
             "pass_timings": False,
             "ir_printing": DUMP_IR,
             "diag_printing": DUMP_DIAGNOSTICS,
+            "compile_profile": COMPILE_PROFILE,
             "print_before": _print_before,
             "print_after": _print_after,
             "print_callback": write_print_buffer,
@@ -213,9 +274,17 @@ class MlirBackendBase(FunctionPass):
         ctx["restype"] = lambda: state.return_type
         ctx["fnname"] = lambda: fn_name
         ctx["resolve_func"] = lambda obj: self._resolve_func_name(state, obj)
+        ctx["flat_ir"] = lambda: flatten_func_ir(
+            state.func_ir, state.typemap, ctx["resolve_func"]
+        )
         ctx["globals"] = lambda: orig_func.__globals__
         ctx["cellvars"] = lambda: _get_cellvars(orig_func)
 
+        # Arguments values, folded into the function body as constants.
+        const_args = _get_flag(state.flags, "mlir_const_args", None)
+        if const_args:
+            ctx["const_args"] = dict(const_args)
+
         func_attrs = {}
         if state.targetctx.fastmath:
             func_attrs["numba.fastmath"] = None
@@ -229,8 +298,60 @@ class MlirBackendBase(FunctionPass):
         if flags.auto_parallel.enabled:
             func_attrs["numba.max_concurrency"] = get_thread_count()
 
+            schedule = _get_flag(flags, "mlir_parallel_schedule", None)
+            if schedule is not None:
+                func_attrs["numba.parallel_schedule"] = schedule
+
+            grain = _get_flag(flags, "mlir_parallel_grain", 0)
+            if grain:
+                func_attrs["numba.parallel_grain"] = grain
+
+            if PARALLEL_PROFILE:
+                func_attrs["numba.parallel_profile"] = None
+
+            deterministic = _get_flag(flags, "mlir_deterministic_reduce", None)
+            if deterministic is None:
+                deterministic = DETERMINISTIC_REDUCE
+
+            if deterministic:
+                func_attrs["numba.deterministic_reduce"] = None
+
+        func_attrs["numba.parallel_backend"] = _get_parallel_backend(flags)
+
+        # Sequences are split between prange loops in the source order, hints
+        # are ignored by non-CUDA backends.
+        threads = _get_flag(flags, "mlir_cuda_threads_per_block", None)
+        if threads is not None:
+            func_attrs["numba.cuda_threads_per_block"] = threads
+
+        occupancy = _get_flag(flags, "mlir_cuda_occupancy_launch", None)
+        if occupancy is not None:
+            func_attrs["numba.cuda_occupancy_launch"] = occupancy
+
         func_attrs["numba.opt_level"] = OPT_LEVEL
 
+        # Tapir targets replace NRT allocations with managed memory ones
+        # during LLVM compilation, profiling wrapper would bypass it.
+        if MEMORY_PROFILE and TAPIR_TARGET == "none":
+            func_attrs["numba.memory_profile"] = None
+
+        affine_opt = _get_flag(flags, "mlir_affine_opt", None)
+        if affine_opt is None:
+            affine_opt = AFFINE_OPT
+
+        if affine_opt and OPT_LEVEL > 0:
+            func_attrs["numba.affine_opt"] = None
+
+        prefetch = _get_flag(flags, "mlir_prefetch", None)
+        if prefetch is None:
+            prefetch = PREFETCH
+
+        if prefetch and OPT_LEVEL > 0:
+            func_attrs["numba.prefetch"] = None
+
+        if _get_flag(flags, "mlir_pack_bool_arrays", False):
+            func_attrs["numba.pack_bool_arrays"] = None
+
         if _get_flag(flags, "gpu_fp64_truncate", "auto") != "auto":
             func_attrs["gpu_runtime.fp64_truncate"] = flags.gpu_fp64_truncate
 
@@ -238,6 +359,22 @@ class MlirBackendBase(FunctionPass):
             flags, "gpu_use_64bit_index", True
         )
 
+        gpu_devices = _get_flag(flags, "gpu_devices", None)
+        if gpu_devices:
+            func_attrs["gpu_runtime.devices"] = gpu_devices
+
+        if GPU_AOT_TARGETS:
+            func_attrs["gpu_runtime.aot_targets"] = GPU_AOT_TARGETS
+
+        if GPU_SPEC_CONSTANTS:
+            func_attrs["gpu_runtime.spec_constants"] = None
+
+        if GPU_VECTOR_BITWIDTH > 0:
+            func_attrs["gpu_runtime.vector_bitwidth"] = GPU_VECTOR_BITWIDTH
+
+        if GPU_PACK_ARGS > 0:
+            func_attrs["gpu_runtime.pack_args"] = GPU_PACK_ARGS
+
         func_attrs["numba.vector_length"] = _get_flag(flags, "mlir_vectorize", 0)
 
         ctx["func_attrs"] = func_attrs
@@ -264,6 +401,37 @@ def get_mlir_func():
     return _mlir_last_compiled_func
 
 
+def _has_device_type(typ):
+    # USM array types provide device caps, numba-dpex ones are patched to.
+    if isinstance(typ, types.BaseTuple):
+        return any(_has_device_type(t) for t in typ.types)
+
+    return hasattr(typ, "get_device_caps")
+
+
+def _needs_gpu_runtimes(state):
+    # GPU pipeline is enabled by default for every function, but GPU regions
+    # are only created for USM arrays or explicit device split.
+    if not _get_flag(state.flags, "enable_gpu_pipeline", True):
+        return False
+
+    if _get_flag(state.flags, "gpu_devices", None):
+        return True
+
+    return any(_has_device_type(t) for t in state.typemap.values())
+
+
+def _load_runtimes(gpu):
+    # Runtime libraries register their symbols on import, only do it on the
+    # first compilation which actually needs them.
+    from . import math_runtime
+
+    if gpu:
+        from . import gpu_runtime
+
+        math_runtime.load_sycl_runtime()
+
+
 @register_pass(mutates_CFG=True, analysis_only=False)
 class MlirBackend(MlirBackendBase):
     _name = "mlir_backend"
@@ -276,19 +444,38 @@ class MlirBackend(MlirBackendBase):
         old_module = _mlir_active_module
 
         try:
-            mod_settings = {"enable_gpu_pipeline": state.flags.enable_gpu_pipeline}
-            module = mlir_compiler.create_module(mod_settings)
-            _mlir_active_module = module
-            global _mlir_last_compiled_func
             ctx = self._get_func_context(state)
-            _mlir_last_compiled_func = mlir_compiler.lower_function(
-                ctx, module, state.func_ir
-            )
-
-            compiled_mod = mlir_compiler.compile_module(
-                global_compiler_context, ctx, module
-            )
             func_name = ctx["fnname"]()
+            aot = get_aot_object(func_name)
+            _load_runtimes(_needs_gpu_runtimes(state))
+            if aot is not None and aot[0] == "load" and os.path.isfile(aot[1]):
+                compiled_mod = mlir_compiler.load_module_object(
+                    global_compiler_context, aot[1]
+                )
+                remarks = []
+                profile = None
+            else:
+                mod_settings = {
+                    "enable_gpu_pipeline": state.flags.enable_gpu_pipeline
+                }
+                module = mlir_compiler.create_module(mod_settings)
+                _mlir_active_module = module
+                global _mlir_last_compiled_func
+                _mlir_last_compiled_func = mlir_compiler.lower_function(
+                    ctx, module, state.func_ir
+                )
+
+                if aot is not None and aot[0] == "emit":
+                    compiled_mod = mlir_compiler.emit_module_object(
+                        global_compiler_context, ctx, module, aot[1], aot[2]
+                    )
+                    profile = None
+                else:
+                    compiled_mod, profile = mlir_compiler.compile_module(
+                        global_compiler_context, ctx, module
+                    )
+                remarks = mlir_compiler.get_module_remarks(module)
+
             func_ptr = mlir_compiler.get_function_pointer(
                 global_compiler_context, compiled_mod, func_name
             )
@@ -296,6 +483,9 @@ class MlirBackend(MlirBackendBase):
             _mlir_active_module = old_module
         state.metadata["mlir_func_ptr"] = func_ptr
         state.metadata["mlir_func_name"] = func_name
+        state.metadata["mlir_remarks"] = remarks
+        if profile is not None:
+            state.metadata["mlir_compile_profile"] = profile
         state.metadata["mlir_module_finalizer"] = self._make_mlir_module_finalizer(
             compiled_mod
         )
@@ -321,6 +511,7 @@ class MlirBackendInner(MlirBackendBase):
         assert not module is None
         global _mlir_last_compiled_func
         ctx = self._get_func_context(state)
+        _load_runtimes(_needs_gpu_runtimes(state))
         _mlir_last_compiled_func = mlir_compiler.lower_function(
             ctx, module, state.func_ir
         )
@@ -336,12 +527,12 @@ class MlirReplaceParfors(MlirBackendBase):
         MlirBackendBase.__init__(self, push_func_stack=False)
         try:
             from numba_dpex.core.types import USMNdArray
-            from .dpctl_interop import _get_device_caps
             import dpctl
 
+            # Patches `USMNdArray.get_device_caps`, used by the compiler.
+            from . import dpctl_interop
+
             self._usmarray_type = USMNdArray
-            self._get_device_caps = _get_device_caps
-            self._device_ctor = dpctl.SyclDevice
             # TODO: Actually parse data models instead of hardcoding index?
             self._sycl_queue_index = 5
         except ImportError:
@@ -359,9 +550,10 @@ class MlirReplaceParfors(MlirBackendBase):
 
             _mlir_active_module = module
 
-            compiled_mod = mlir_compiler.compile_module(
+            compiled_mod, profile = mlir_compiler.compile_module(
                 global_compiler_context, ctx, module
             )
+            remarks = mlir_compiler.get_module_remarks(module)
         finally:
             func_registry.pop_active_funcs_stack()
             _mlir_active_module = old_module
@@ -372,6 +564,12 @@ class MlirReplaceParfors(MlirBackendBase):
             )
             inst.lowerer = functools.partial(self._lower_parfor, func_ptr)
 
+        state.metadata["mlir_remarks"] = (
+            state.metadata.get("mlir_remarks", []) + remarks
+        )
+        if profile is not None:
+            state.metadata["mlir_compile_profile"] = profile
+
         return True
 
     def _gen_module(self, state):
@@ -389,20 +587,23 @@ class MlirReplaceParfors(MlirBackendBase):
                 self._reconstruct_parfor_ssa(inst, typemap)
 
                 if module is None:
+                    _load_runtimes(_needs_gpu_runtimes(state))
                     mod_settings = {"enable_gpu_pipeline": True}
                     module = mlir_compiler.create_module(mod_settings)
 
                 fn_name = f"parfor_impl{inst.id}"
                 arg_types = self._get_parfor_args_types(typemap, inst)
                 res_type, _ = self._get_parfor_return_type(typemap, inst)
-                device_caps = self._get_parfor_device_caps(arg_types)
+                device_type = self._get_parfor_device_type(arg_types)
 
                 ctx = self._get_func_context(state)
                 ctx["fnname"] = lambda: fn_name
                 ctx["fnargs"] = lambda: arg_types
                 ctx["restype"] = lambda: res_type
 
-                ctx["device_caps"] = device_caps
+                # Device capabilities are queried from the type and cached by
+                # the compiler.
+                ctx["device_array_type"] = device_type
 
                 output_arrays = numba.parfors.parfor.get_parfor_outputs(
                     inst, inst.params
@@ -497,13 +698,13 @@ class MlirReplaceParfors(MlirBackendBase):
     def _get_parfor_args_types(self, typemap, parfor):
         return self._enumerate_parfor_args(parfor, lambda v: [typemap[v]])
 
-    def _get_parfor_device_caps(self, types):
+    def _get_parfor_device_type(self, types):
         if self._usmarray_type is None:
             return None
 
         for t in types:
             if isinstance(t, self._usmarray_type):
-                return self._get_device_caps(self._device_ctor(t.device))
+                return t
 
         return None
 
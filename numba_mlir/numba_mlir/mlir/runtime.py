@@ -4,32 +4,566 @@
 
 import ctypes
 import atexit
+import json
+import os
+import warnings
+from contextlib import contextmanager
 from numba.np.ufunc.parallel import get_thread_count
-from .utils import load_lib, register_cfunc
+from .utils import load_lib, mlir_func_name, register_cfunc
+from .settings import (
+    NUMA,
+    NUMA_FIRST_TOUCH_THRESHOLD,
+    PARALLEL_PROFILE,
+    PARALLEL_MAX_DEPTH,
+    PARALLEL_SERIAL_COST,
+    PARALLEL_KEEP_WARM_US,
+    PARALLEL_AFFINITY,
+    ALLOC_POLICY,
+    HUGE_PAGE_THRESHOLD,
+    HUGETLBFS,
+    ALLOC_CACHE_SIZE,
+    TRACE,
+)
 
 runtime_lib = load_lib("numba-mlir-runtime")
 
-_init_func = runtime_lib.nmrtParallelInit
+# Must be kept in sync with `AffinityPolicy` in `TbbParallel.cpp`.
+_AFFINITY_POLICIES = {
+    "none": 0,
+    "compact": 1,
+    "scatter": 2,
+    "cores": 3,
+}
+_AFFINITY_EXPLICIT = 4
+
+
+def _parse_affinity(affinity):
+    """Returns (policy, cpus), `affinity` is the policy name or explicit CPU
+    list like "0,2,4-7". Raises ValueError for invalid CPU list."""
+    affinity = affinity.strip().lower()
+    policy = _AFFINITY_POLICIES.get(affinity)
+    if policy is not None:
+        return policy, []
+
+    cpus = []
+    for part in affinity.split(","):
+        begin, _, end = part.partition("-")
+        begin = int(begin)
+        end = int(end) if end else begin
+        if begin < 0 or end < begin:
+            raise ValueError(f"Invalid CPU range: {part!r}")
+
+        cpus += range(begin, end + 1)
+
+    return _AFFINITY_EXPLICIT, cpus
+
+
+def _get_affinity():
+    try:
+        return _parse_affinity(PARALLEL_AFFINITY)
+    except ValueError:
+        warnings.warn(
+            f"Invalid NUMBA_MLIR_PARALLEL_AFFINITY value {PARALLEL_AFFINITY!r}, "
+            "threads affinity is disabled"
+        )
+        return _AFFINITY_POLICIES["none"], []
+
+
+_set_affinity_func = runtime_lib.nmrtParallelSetAffinity
+_set_affinity_func.argtypes = [
+    ctypes.c_int,
+    ctypes.POINTER(ctypes.c_int),
+    ctypes.c_int,
+]
+
+_affinity_policy, _affinity_cpus = _get_affinity()
+_set_affinity_func(
+    _affinity_policy,
+    (ctypes.c_int * len(_affinity_cpus))(*_affinity_cpus),
+    len(_affinity_cpus),
+)
+
+# TBB threads are only created by the first parallel call.
+_init_func = runtime_lib.nmrtParallelInitDeferred
 _init_func.argtypes = [ctypes.c_int]
-_init_func(get_thread_count())
+
+# Policies, restricting the CPUs, get thread count from the runtime (0), so
+# there is one pinned thread per selected CPU.
+if _affinity_policy in (_AFFINITY_POLICIES["cores"], _AFFINITY_EXPLICIT):
+    _init_func(0)
+else:
+    _init_func(get_thread_count())
+
+_set_max_depth_func = runtime_lib.nmrtParallelSetMaxDepth
+_set_max_depth_func.argtypes = [ctypes.c_int]
+_set_max_depth_func(PARALLEL_MAX_DEPTH)
+
+_set_serial_cost_func = runtime_lib.nmrtParallelSetSerialCostThreshold
+_set_serial_cost_func.argtypes = [ctypes.c_int64]
+_set_serial_cost_func(PARALLEL_SERIAL_COST)
+
+_set_keep_warm_func = runtime_lib.nmrtParallelSetKeepWarm
+_set_keep_warm_func.argtypes = [ctypes.c_int64]
+_set_keep_warm_func(PARALLEL_KEEP_WARM_US)
+
+_warmup_func = runtime_lib.nmrtParallelWarmup
+
+if NUMA:
+    _set_first_touch_func = runtime_lib.nmrtParallelSetFirstTouchThreshold
+    _set_first_touch_func.argtypes = [ctypes.c_int64]
+    _set_first_touch_func(NUMA_FIRST_TOUCH_THRESHOLD)
+
+    _enable_numa_func = runtime_lib.nmrtParallelEnableNuma
+    _enable_numa_func.restype = ctypes.c_int
+    _enable_numa_func()
 
 _finalize_func = runtime_lib.nmrtParallelFinalize
 
+# TBB workers don't survive fork, runtime is shut down before it and recreated
+# on the next parallel loop in both processes.
+if hasattr(os, "register_at_fork"):
+    _before_fork_func = runtime_lib.nmrtParallelBeforeFork
+    _after_fork_func = runtime_lib.nmrtParallelAfterFork
+    os.register_at_fork(
+        before=_before_fork_func,
+        after_in_parent=_after_fork_func,
+        after_in_child=_after_fork_func,
+    )
+
+_create_arena_func = runtime_lib.nmrtParallelCreateArena
+_create_arena_func.argtypes = [ctypes.c_char_p, ctypes.c_int]
+_create_arena_func.restype = ctypes.c_int
+
+_set_current_arena_func = runtime_lib.nmrtParallelSetCurrentArena
+_set_current_arena_func.argtypes = [ctypes.c_int]
+
+_get_current_arena_func = runtime_lib.nmrtParallelGetCurrentArena
+_get_current_arena_func.restype = ctypes.c_int
+
+_get_num_threads_func = runtime_lib.nmrtParallelGetNumThreads
+_get_num_threads_func.restype = ctypes.c_int
+
+
+def create_arena(name, num_threads):
+    """Create named arena (or get existing one) and return its id.
+
+    Arena concurrency cannot exceed the thread count runtime was initialized
+    with.
+    """
+    return _create_arena_func(name.encode(), int(num_threads))
+
+
+@contextmanager
+def use_arena(name, num_threads=None):
+    """Run parallel loops from the current thread in the named arena."""
+    if num_threads is None:
+        num_threads = get_thread_count()
+
+    arena_id = create_arena(name, num_threads)
+    prev = _get_current_arena_func()
+    _set_current_arena_func(arena_id)
+    try:
+        yield
+    finally:
+        _set_current_arena_func(prev)
+
+
+def set_num_threads(num_threads):
+    """Set parallel loops concurrency for the current thread.
+
+    Doesn't reinitialize runtime, arenas are created once per thread count and
+    reused.
+    """
+    _set_current_arena_func(create_arena(f"threads_{num_threads}", num_threads))
+
+
+def get_num_threads():
+    return _get_num_threads_func()
+
+
+def set_keep_warm(us):
+    """Keep workers spinning for `us` microseconds after each parallel loop.
+
+    Trades idle CPU time for lower latency of the next parallel loop, 0
+    disables keep-warm mode.
+    """
+    _set_keep_warm_func(int(us))
+
+
+def parallel_warmup():
+    """Wake up workers ahead of the latency critical parallel loops."""
+    _warmup_func()
+
+
+_profile_enable_func = runtime_lib.nmrtParallelProfileEnable
+_profile_enable_func.argtypes = [ctypes.c_int]
+
+_profile_reset_func = runtime_lib.nmrtParallelProfileReset
+
+_profile_num_regions_func = runtime_lib.nmrtParallelProfileGetNumRegions
+_profile_num_regions_func.restype = ctypes.c_int
+
+_profile_region_name_func = runtime_lib.nmrtParallelProfileGetRegionName
+_profile_region_name_func.argtypes = [ctypes.c_int]
+_profile_region_name_func.restype = ctypes.c_char_p
+
+_profile_region_stats_func = runtime_lib.nmrtParallelProfileGetRegionStats
+_profile_region_stats_func.argtypes = [
+    ctypes.c_int,
+    ctypes.POINTER(ctypes.c_uint64),
+    ctypes.POINTER(ctypes.c_uint64),
+    ctypes.POINTER(ctypes.c_uint64),
+    ctypes.POINTER(ctypes.c_uint64),
+    ctypes.c_int,
+]
+_profile_region_stats_func.restype = ctypes.c_int
+
+if PARALLEL_PROFILE:
+    _profile_enable_func(1)
+
+
+def enable_profiling(enable=True):
+    """Enable or disable collection of parallel regions counters.
+
+    Only regions compiled with NUMBA_MLIR_PARALLEL_PROFILE=1 are tracked.
+    """
+    _profile_enable_func(int(bool(enable)))
+
+
+def reset_profile():
+    _profile_reset_func()
+
+
+def get_profile():
+    """Return dict of region name -> counters.
+
+    Times are in nanoseconds, `busy_time` and `chunks` are per-thread lists.
+    """
+    max_threads = get_thread_count()
+    res = {}
+    for i in range(_profile_num_regions_func()):
+        name = _profile_region_name_func(i).decode()
+        calls = ctypes.c_uint64()
+        wall = ctypes.c_uint64()
+        busy = (ctypes.c_uint64 * max_threads)()
+        chunks = (ctypes.c_uint64 * max_threads)()
+        count = _profile_region_stats_func(
+            i, ctypes.byref(calls), ctypes.byref(wall), busy, chunks, max_threads
+        )
+        if count < 0:
+            continue
+
+        res[name] = {
+            "calls": calls.value,
+            "wall_time": wall.value,
+            "busy_time": list(busy[:count]),
+            "chunks": list(chunks[:count]),
+        }
+    return res
+
+_perf_begin_func = runtime_lib.nmrtPerfCountersBegin
+_perf_begin_func.argtypes = [
+    ctypes.c_int,
+    ctypes.POINTER(ctypes.c_uint32),
+    ctypes.POINTER(ctypes.c_uint64),
+]
+_perf_begin_func.restype = ctypes.c_int
+
+_perf_end_func = runtime_lib.nmrtPerfCountersEnd
+_perf_end_func.argtypes = [ctypes.POINTER(ctypes.c_uint64)]
+_perf_end_func.restype = ctypes.c_int
+
+
+@contextmanager
+def perf_counters(events):
+    """Count hardware events for all process threads inside the context.
+
+    `events` is a list of (perf_event_attr type, config) pairs. Yields list,
+    filled with counter values on exit, or None if counters are not available.
+    """
+    count = len(events)
+    types = (ctypes.c_uint32 * count)(*[e[0] for e in events])
+    configs = (ctypes.c_uint64 * count)(*[e[1] for e in events])
+    if _perf_begin_func(count, types, configs) != 0:
+        yield None
+        return
+
+    res = []
+    try:
+        yield res
+    finally:
+        values = (ctypes.c_uint64 * count)()
+        if _perf_end_func(values) == 0:
+            res.extend(values)
+
+
+_trace_enable_func = runtime_lib.nmrtTraceEnable
+_trace_enable_func.argtypes = [ctypes.c_int]
+
+_trace_now_func = runtime_lib.nmrtTraceNow
+_trace_now_func.restype = ctypes.c_uint64
+
+_trace_event_func = runtime_lib.nmrtTraceEvent
+_trace_event_func.argtypes = [
+    ctypes.c_char_p,
+    ctypes.c_char_p,
+    ctypes.c_uint64,
+    ctypes.c_uint64,
+]
+
+_trace_reset_func = runtime_lib.nmrtTraceReset
+
+_trace_collect_func = runtime_lib.nmrtTraceCollect
+_trace_collect_func.restype = ctypes.c_int
+
+_trace_get_event_func = runtime_lib.nmrtTraceGetEvent
+_trace_get_event_func.argtypes = [
+    ctypes.c_int,
+    ctypes.POINTER(ctypes.c_char_p),
+    ctypes.POINTER(ctypes.c_uint64),
+]
+_trace_get_event_func.restype = ctypes.c_char_p
+
+# `nmrtTraceEvent` address, passed to the compiler and GPU runtime, so all
+# events go into the same buffers.
+_trace_func_ptr = ctypes.cast(_trace_event_func, ctypes.c_void_p).value
+
+_trace_hooks = []
+_trace_enabled = False
+
+
+def add_trace_hook(hook):
+    """Register `hook(func_ptr)`, called with the trace event sink pointer when
+    tracing is enabled and with None when it is disabled."""
+    _trace_hooks.append(hook)
+    if _trace_enabled:
+        hook(_trace_func_ptr)
+
+
+def enable_tracing(enable=True):
+    """Enable or disable recording of compile stages, parallel regions, GPU
+    runtime calls and dispatcher calls trace events."""
+    global _trace_enabled
+    _trace_enabled = bool(enable)
+    _trace_enable_func(int(_trace_enabled))
+    ptr = _trace_func_ptr if _trace_enabled else None
+    for hook in _trace_hooks:
+        hook(ptr)
+
+
+def is_tracing_enabled():
+    return _trace_enabled
+
+
+def trace_now():
+    """Return current trace timestamp in nanoseconds."""
+    return _trace_now_func()
+
+
+def trace_event(name, category, begin, end):
+    """Record event on the current thread, `begin` and `end` are `trace_now`
+    timestamps."""
+    _trace_event_func(name.encode(), category.encode(), begin, end)
+
+
+def reset_trace():
+    _trace_reset_func()
+
+
+def get_trace_events():
+    """Return list of recorded events, sorted by start time.
+
+    Events are (name, category, begin, end, thread) tuples, times are in
+    nanoseconds. Each thread keeps only the most recent events.
+    """
+    res = []
+    category = ctypes.c_char_p()
+    data = (ctypes.c_uint64 * 3)()
+    for i in range(_trace_collect_func()):
+        name = _trace_get_event_func(i, ctypes.byref(category), data)
+        if name is None:
+            continue
+
+        res.append((name.decode(), category.value.decode(), *data))
+    return res
+
+
+def export_trace(path):
+    """Write recorded events as Chrome trace JSON, which can be opened in
+    chrome://tracing or Perfetto UI."""
+    pid = os.getpid()
+    events = [
+        {
+            "name": name,
+            "cat": category,
+            "ph": "X",
+            "ts": begin / 1000,
+            "dur": (end - begin) / 1000,
+            "pid": pid,
+            "tid": thread,
+        }
+        for name, category, begin, end, thread in get_trace_events()
+    ]
+    with open(path, "w") as f:
+        json.dump({"traceEvents": events}, f)
+
+
+@contextmanager
+def trace(path=None):
+    """Record trace events for the code inside the context and write them to
+    `path` on exit, if specified."""
+    prev = _trace_enabled
+    reset_trace()
+    enable_tracing()
+    try:
+        yield
+    finally:
+        enable_tracing(prev)
+        if path is not None:
+            export_trace(path)
+
+
+_alloc_init_func = runtime_lib.nmrtAllocInit
+_alloc_init_func.argtypes = [
+    ctypes.c_void_p,
+    ctypes.c_uint64,
+    ctypes.c_uint64,
+    ctypes.c_int,
+    ctypes.c_int,
+]
+
+_mem_profile_init_func = runtime_lib.nmrtMemProfileInit
+_mem_profile_init_func.argtypes = [ctypes.c_void_p]
+
+
+def _init_memory_profile():
+    from numba.core.runtime import _nrt_python as _nrt
+
+    # Zeroed allocations always go through the runtime allocator, policy
+    # parameters only apply if it is enabled. NUMA first touch is done by the
+    # compiled code after the allocation.
+    _alloc_init_func(
+        _nrt.c_helpers["MemInfo_alloc_safe_aligned_external"],
+        max(HUGE_PAGE_THRESHOLD, 0) if ALLOC_POLICY else 0,
+        max(ALLOC_CACHE_SIZE, 0) if ALLOC_POLICY else 0,
+        int(HUGETLBFS),
+        int(not NUMA),
+    )
+
+    if not ALLOC_POLICY:
+        _mem_profile_init_func(_nrt.c_helpers["MemInfo_alloc_safe_aligned"])
+        return
+
+    alloc_ptr = ctypes.cast(runtime_lib.nmrtAlloc, ctypes.c_void_p)
+    _mem_profile_init_func(alloc_ptr.value)
+
+
+_init_memory_profile()
+del _init_memory_profile
+
+_mem_profile_num_entries_func = runtime_lib.nmrtMemProfileGetNumEntries
+_mem_profile_num_entries_func.restype = ctypes.c_int
+
+_mem_profile_entry_func = runtime_lib.nmrtMemProfileGetEntry
+_mem_profile_entry_func.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_uint64)]
+_mem_profile_entry_func.restype = ctypes.c_char_p
+
+_mem_profile_reset_func = runtime_lib.nmrtMemProfileReset
+
+
+def get_memory_profile():
+    """Return dict of function name -> allocation stats.
+
+    Stats are "allocs", "allocated" (total bytes), "live" and "peak" (max live
+    bytes since the last reset). Empty name is the total over all functions.
+    Only functions, compiled with NUMBA_MLIR_MEMORY_PROFILE=1, are tracked and
+    memory is accounted against the function, which allocated it, even if it
+    was returned to the caller.
+    """
+    keys = ["allocs", "allocated", "live", "peak"]
+    res = {}
+    for i in range(_mem_profile_num_entries_func()):
+        stats = (ctypes.c_uint64 * len(keys))()
+        name = _mem_profile_entry_func(i, stats)
+        if name is None:
+            continue
+
+        res[name.decode()] = dict(zip(keys, stats))
+    return res
+
+
+def reset_memory_profile():
+    """Reset allocation counters and peaks to the currently live bytes."""
+    _mem_profile_reset_func()
+
+
+def _get_gpu_runtime():
+    # Do not load GPU runtime just for profiling.
+    import sys
+
+    return sys.modules.get(__package__ + ".gpu_runtime")
+
+
+@contextmanager
+def memory_profile():
+    """Collect memory profile for the code inside the context.
+
+    Yields dict, filled on exit with "cpu" `get_memory_profile` results and
+    "gpu" per-device results, if GPU runtime is loaded. Peaks are high-water
+    marks inside the context, e.g. of a single jitted function call.
+    """
+    gpu_runtime = _get_gpu_runtime()
+    reset_memory_profile()
+    if gpu_runtime:
+        gpu_runtime.reset_memory_profile()
+
+    res = {}
+    try:
+        yield res
+    finally:
+        res["cpu"] = get_memory_profile()
+        res["gpu"] = gpu_runtime.get_memory_profile() if gpu_runtime else {}
+
+
 _funcs = [
     "memrefCopy",
+    "nmrtParallelFill",
+    "nmrtStreamPrefetch",
     "nmrtParallelFor",
+    "nmrtParallelForSchedule",
+    "nmrtParallelFirstTouch",
     "nmrtPurgeContext",
     "nmrtReleaseContext",
     "nmrtTakeContext",
     "nmrtCreateAllocToken",
     "nmrtDestroyAllocToken",
+    "nmrtArenaSave",
+    "nmrtArenaRestore",
+    "nmrtArenaAlloc",
+    "nmrtMemProfileAlloc",
+    "nmrtAlloc",
+    "nmrtAllocZeroed",
+    "nmrtRandomSeed",
+    "nmrtRandomKey",
+    "nmrtRandomAdvance",
 ]
 
 for name in _funcs:
     func = getattr(runtime_lib, name)
     register_cfunc(name, func)
 
+for dtype in ["int32", "int64", "uint32", "uint64", "float32", "float64"]:
+    for name in [f"nmrtSort_{dtype}", f"nmrtArgSort_{dtype}"]:
+        register_cfunc(mlir_func_name(name), getattr(runtime_lib, name))
+
 
 @atexit.register
 def _cleanup():
     _finalize_func()
+
+
+if TRACE:
+    enable_tracing()
+
+    # Registered after `_cleanup`, so it runs before runtime finalization.
+    atexit.register(export_trace, TRACE)
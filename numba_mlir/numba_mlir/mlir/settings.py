@@ -3,10 +3,34 @@
 # SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
 
+import os
+
 from .utils import readenv
 from ..mlir_compiler import is_mkl_supported, is_sycl_mkl_supported
 
 
+def _get_llc_size():
+    # Largest cache size, reported by Linux sysfs, other platforms use
+    # conservative default.
+    default = 32 * 1024 * 1024
+    path = "/sys/devices/system/cpu/cpu0/cache"
+    try:
+        sizes = []
+        for name in os.listdir(path):
+            if not name.startswith("index"):
+                continue
+
+            with open(os.path.join(path, name, "size")) as f:
+                size = f.read().strip()
+
+            mult = {"K": 1024, "M": 1024 * 1024}.get(size[-1:], 1)
+            sizes.append(int(size.rstrip("KM")) * mult)
+
+        return max(sizes, default=default)
+    except (OSError, ValueError):
+        return default
+
+
 USE_MLIR = readenv("NUMBA_MLIR_ENABLE", int, 1)
 DUMP_PLIER = readenv("NUMBA_MLIR_DUMP_PLIER", int, 0)
 DUMP_IR = readenv("NUMBA_MLIR_DUMP_IR", int, 0)
@@ -19,3 +43,89 @@ MKL_AVAILABLE = is_mkl_supported()
 SYCL_MKL_AVAILABLE = is_sycl_mkl_supported()
 OPT_LEVEL = readenv("NUMBA_MLIR_OPT_LEVEL", int, 3)
 DISABLE_VECTORIZE = readenv("NUMBA_MLIR_DISABLE_VECTORIZE", int, 0)
+VECTORIZER = readenv("NUMBA_MLIR_VECTORIZER", str, "hybrid")
+OBJECT_CACHE_DIR = readenv("NUMBA_MLIR_OBJECT_CACHE_DIR", str, "")
+OBJECT_CACHE_MAX_SIZE = readenv("NUMBA_MLIR_OBJECT_CACHE_MAX_SIZE", int, 0)
+IR_CACHE_DIR = readenv("NUMBA_MLIR_IR_CACHE_DIR", str, "")
+IR_CACHE_MAX_SIZE = readenv("NUMBA_MLIR_IR_CACHE_MAX_SIZE", int, 0)
+TIERED_COMPILATION = readenv("NUMBA_MLIR_TIERED_COMPILATION", int, 0)
+PGO_CALL_THRESHOLD = readenv("NUMBA_MLIR_PGO_CALL_THRESHOLD", int, 0)
+LAZY_COMPILATION = readenv("NUMBA_MLIR_LAZY_COMPILATION", int, 0)
+COMPILE_THREADS = readenv("NUMBA_MLIR_COMPILE_THREADS", int, 0)
+# File, where compiled signatures are recorded at exit, so functions can be
+# compiled for them ahead of the first call in the next runs.
+SIGNATURE_PROFILE = readenv("NUMBA_MLIR_SIGNATURE_PROFILE", str, "")
+# Compile profiled signatures in the background thread, when function is
+# defined, otherwise only by explicit `warmup`.
+SIGNATURE_PRECOMPILE = readenv("NUMBA_MLIR_SIGNATURE_PRECOMPILE", int, 1)
+JIT_LINKER = readenv("NUMBA_MLIR_JIT_LINKER", str, "jitlink")
+CODE_MODEL = readenv("NUMBA_MLIR_CODE_MODEL", str, "small")
+# Tapir is only used when explicitly requested, by default parallel loops are
+# lowered to the native TBB runtime. Empty value means the default.
+TAPIR_TARGET = readenv(
+    "NUMBA_MLIR_TAPIR_TARGET", str, os.environ.get("NM_TAPIRTARGET", "none")
+)
+TAPIR_TARGET = TAPIR_TARGET.strip().lower() or "none"
+TAPIR_ABI_BITCODE = readenv("NUMBA_MLIR_TAPIR_ABI_BITCODE", str, "")
+TAPIR_RUNTIME_PATH = readenv("NUMBA_MLIR_TAPIR_RUNTIME_PATH", str, "")
+VECTOR_LIBRARY = readenv("NUMBA_MLIR_VECTOR_LIBRARY", str, "none")
+NUMA = readenv("NUMBA_MLIR_NUMA", int, 0)
+# Minimal size in bytes of the freshly allocated array, whose pages are touched
+# from NUMA node arenas in NUMA mode, smaller ones are left to the allocating
+# thread.
+NUMA_FIRST_TOUCH_THRESHOLD = readenv(
+    "NUMBA_MLIR_NUMA_FIRST_TOUCH_THRESHOLD", int, 1024 * 1024
+)
+PARALLEL_PROFILE = readenv("NUMBA_MLIR_PARALLEL_PROFILE", int, 0)
+PARALLEL_MAX_DEPTH = readenv("NUMBA_MLIR_PARALLEL_MAX_DEPTH", int, 2)
+PARALLEL_SERIAL_COST = readenv("NUMBA_MLIR_PARALLEL_SERIAL_COST", int, 20000)
+PARALLEL_KEEP_WARM_US = readenv("NUMBA_MLIR_PARALLEL_KEEP_WARM_US", int, 0)
+PARALLEL_AFFINITY = readenv("NUMBA_MLIR_PARALLEL_AFFINITY", str, "none")
+ASYNC_WORKERS = readenv("NUMBA_MLIR_ASYNC_WORKERS", int, 0)
+MEMORY_PROFILE = readenv("NUMBA_MLIR_MEMORY_PROFILE", int, 0)
+COMPILE_PROFILE = readenv("NUMBA_MLIR_COMPILE_PROFILE", int, 0)
+TRACE = readenv("NUMBA_MLIR_TRACE", str, "")
+COMPOSITE_MAX_ITERS = readenv("NUMBA_MLIR_COMPOSITE_MAX_ITERS", int, 10)
+# Max number of typed inner functions, kept between compilations, 0 disables
+# the cache.
+INNER_FUNC_CACHE_SIZE = readenv("NUMBA_MLIR_INNER_FUNC_CACHE_SIZE", int, 1024)
+STACK_ALLOC_MAX_SIZE = readenv("NUMBA_MLIR_STACK_ALLOC_MAX_SIZE", int, 1024)
+ARENA_ALLOC = readenv("NUMBA_MLIR_ARENA_ALLOC", int, 1)
+ALLOC_POLICY = readenv("NUMBA_MLIR_ALLOC_POLICY", int, 0)
+HUGE_PAGE_THRESHOLD = readenv("NUMBA_MLIR_HUGE_PAGE_THRESHOLD", int, 32 * 1024 * 1024)
+HUGETLBFS = readenv("NUMBA_MLIR_HUGETLBFS", int, 0)
+ALLOC_CACHE_SIZE = readenv("NUMBA_MLIR_ALLOC_CACHE_SIZE", int, 64 * 1024 * 1024)
+ZEROED_ALLOC = readenv("NUMBA_MLIR_ZEROED_ALLOC", int, 1)
+PARALLEL_FILL_THRESHOLD = readenv(
+    "NUMBA_MLIR_PARALLEL_FILL_THRESHOLD", int, 4 * 1024 * 1024
+)
+# Memory budget in bytes of a single chunk of the streamed parallel loop, used
+# for out-of-core inputs, like memory-mapped arrays, 0 disables streaming.
+STREAM_CHUNK_SIZE = readenv("NUMBA_MLIR_STREAM_CHUNK_SIZE", int, 0)
+NONTEMPORAL_STORE_THRESHOLD = readenv(
+    "NUMBA_MLIR_NONTEMPORAL_STORE_THRESHOLD", int, _get_llc_size()
+)
+# Compile callees, which weren't inlined, once and link other modules against
+# them, instead of compiling them into each module.
+SHARE_CALLEES = readenv("NUMBA_MLIR_SHARE_CALLEES", int, 0)
+# Number of modules, compiled with the single MLIR context, before it's
+# recreated, contexts never free types and attributes, 0 means no limit.
+MODULE_ENV_MAX_USES = readenv("NUMBA_MLIR_MODULE_ENV_MAX_USES", int, 1000)
+AFFINE_OPT = readenv("NUMBA_MLIR_AFFINE_OPT", int, 0)
+PREFETCH = readenv("NUMBA_MLIR_PREFETCH", int, 0)
+# Parallel reductions results don't depend on thread count and scheduling.
+DETERMINISTIC_REDUCE = readenv("NUMBA_MLIR_DETERMINISTIC_REDUCE", int, 0)
+PASS_STATISTICS = readenv("NUMBA_MLIR_PASS_STATISTICS", int, 0)
+GPU_AOT_TARGETS = readenv("NUMBA_MLIR_GPU_AOT_TARGETS", str, "")
+# Emit kernel index arguments as SPIR-V specialization constants, runtime builds
+# kernel variants for the specific shapes and strides they are launched with.
+GPU_SPEC_CONSTANTS = readenv("NUMBA_MLIR_GPU_SPEC_CONSTANTS", int, 0)
+# Number of bits, GPU work-items process at once in elementwise loops with
+# contiguous accesses (e.g. 128 for 4 x f32), 0 disables coarsening.
+GPU_VECTOR_BITWIDTH = readenv("NUMBA_MLIR_GPU_VECTOR_BITWIDTH", int, 0)
+# Kernels with more arguments than this are compiled to get all of them in the
+# single device-visible buffer, 0 disables packing.
+GPU_PACK_ARGS = readenv("NUMBA_MLIR_GPU_PACK_ARGS", int, 0)
+# Accumulate half precision matmul in f32, rounding result once, otherwise
+# accumulate in f16, which is faster but less precise.
+F16_F32_ACCUMULATE = readenv("NUMBA_MLIR_F16_F32_ACCUMULATE", int, 1)
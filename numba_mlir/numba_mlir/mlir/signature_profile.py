@@ -0,0 +1,304 @@
+# SPDX-FileCopyrightText: 2023 Intel Corporation
+#
+# SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+"""
+Persistent profile of the compiled function signatures.
+
+Signatures, compiled by the dispatchers during the run, are merged into the
+profile file at exit. In the next runs functions are compiled for the profiled
+signatures ahead of the first call: in the background thread, when dispatcher
+is created (NUMBA_MLIR_SIGNATURE_PRECOMPILE=1), or synchronously by `warmup`.
+Precompilation goes through the regular compile path, so it uses the parallel
+module compilation and the object and IR caches, if they are enabled.
+Precompiled signatures are not recorded, only signatures compiled on the call
+gain runs, as calls of the already compiled signatures are not visible to the
+dispatcher. Background precompilation is stopped at exit after the current
+signature.
+
+Functions are keyed by module and qualified name, signatures, which no longer
+compile (e.g. function was changed), are skipped. Dispatchers can record
+separate signature variants, e.g. static shape variants of the shape
+specializing dispatcher.
+
+Signatures are stored pickled, profile file must be trusted, same as numba
+caches.
+"""
+
+import atexit
+import base64
+import json
+import os
+import pickle
+import sys
+import tempfile
+import threading
+import time
+import weakref
+from queue import Queue
+
+from numba.core import sigutils
+
+from .settings import SIGNATURE_PROFILE, SIGNATURE_PRECOMPILE
+
+# Max number of signatures, kept per function and variant. Signatures, seen in
+# the most runs, are kept.
+max_signatures = 64
+
+_profile_version = 1
+
+_lock = threading.Lock()
+
+# Profile file path, None if disabled.
+_path = None
+
+# Func key -> variant -> fingerprint -> (number of runs, types description),
+# loaded from the file.
+_loaded = {}
+
+# (func key, variant, fingerprint) -> types description, seen in the current
+# run.
+_recorded = {}
+
+# Top-level dispatchers, created with active profile, for `warmup`.
+_dispatchers = weakref.WeakSet()
+
+_queue = None
+_worker = None
+
+# Set at exit, background precompilation stops after the current signature.
+_stop = threading.Event()
+
+# Signatures, compiled by `_precompile`, were not necessarily seen in this
+# run, `record` ignores them.
+_precompiling = threading.local()
+
+
+def _get_func_key(py_func):
+    # Generated functions cannot be matched between runs.
+    if py_func.__code__.co_filename.startswith("<"):
+        return None
+
+    return f"{py_func.__module__}:{py_func.__qualname__}"
+
+
+def _get_fingerprint(args):
+    return base64.b64encode(pickle.dumps(tuple(args))).decode("ascii")
+
+
+def _from_fingerprint(fingerprint):
+    return pickle.loads(base64.b64decode(fingerprint))
+
+
+def _read_profile(path):
+    try:
+        with open(path) as f:
+            data = json.load(f)
+    except (OSError, ValueError):
+        return {}
+
+    if not isinstance(data, dict) or data.get("version") != _profile_version:
+        return {}
+
+    ret = {}
+    for key, variants in data.get("functions", {}).items():
+        ret[key] = {
+            variant: {e["sig"]: (e["runs"], e["types"]) for e in entries}
+            for variant, entries in variants.items()
+        }
+    return ret
+
+
+def _write_profile(path, profile):
+    functions = {}
+    for key, variants in profile.items():
+        functions[key] = {}
+        for variant, sigs in variants.items():
+            entries = sorted(sigs.items(), key=lambda e: -e[1][0])
+            functions[key][variant] = [
+                {"sig": sig, "runs": runs, "types": types}
+                for sig, (runs, types) in entries[:max_signatures]
+            ]
+
+    # Processes can save profile concurrently, replace is atomic.
+    dirname = os.path.dirname(os.path.abspath(path))
+    fd, tmp = tempfile.mkstemp(dir=dirname, suffix=".tmp")
+    try:
+        with os.fdopen(fd, "w") as f:
+            json.dump({"version": _profile_version, "functions": functions}, f)
+        os.replace(tmp, path)
+    except OSError:
+        os.unlink(tmp)
+        raise
+
+
+def set_signature_profile(path):
+    """
+    Set profile file, signatures are loaded from and saved into. None disables
+    profiling. Initial file is set by NUMBA_MLIR_SIGNATURE_PROFILE.
+    """
+    global _path, _loaded
+    with _lock:
+        _path = path or None
+        _loaded = _read_profile(path) if path else {}
+        _recorded.clear()
+
+
+def save_signature_profile():
+    """
+    Merge signatures, compiled in the current run, into the profile file.
+    Called automatically at exit.
+    """
+    with _lock:
+        if _path is None or not _recorded:
+            return
+
+        # Merge with the file content, it could be updated by other processes.
+        profile = _read_profile(_path)
+        for (key, variant, fingerprint), types in _recorded.items():
+            sigs = profile.setdefault(key, {}).setdefault(variant, {})
+            runs, _ = sigs.get(fingerprint, (0, types))
+            sigs[fingerprint] = (runs + 1, types)
+
+        _write_profile(_path, profile)
+        _loaded.clear()
+        _loaded.update(profile)
+        _recorded.clear()
+
+
+def record(disp, sig):
+    """
+    Record signature, `disp` was compiled for.
+    """
+    if _path is None or getattr(_precompiling, "active", False):
+        return
+
+    key = _get_func_key(disp.py_func)
+    if key is None:
+        return
+
+    args, _ = sigutils.normalize_signature(sig)
+    try:
+        fingerprint = _get_fingerprint(args)
+    except Exception:
+        # Some types (e.g. with captured Python objects) are not picklable.
+        return
+
+    with _lock:
+        _recorded[(key, disp._profile_variant, fingerprint)] = str(args)
+
+
+def _get_signatures(disp):
+    key = _get_func_key(disp.py_func)
+    with _lock:
+        variants = dict(_loaded.get(key, {}))
+
+    ret = []
+    for variant, sigs in variants.items():
+        for fingerprint, (runs, _) in sigs.items():
+            ret.append((runs, variant, fingerprint))
+
+    # Most common signatures are compiled first.
+    ret.sort(key=lambda e: -e[0])
+    return [(variant, fingerprint) for _, variant, fingerprint in ret]
+
+
+def _precompile(disp):
+    count = 0
+    _precompiling.active = True
+    try:
+        for variant, fingerprint in _get_signatures(disp):
+            if _stop.is_set():
+                break
+
+            target = disp._get_profile_dispatcher(variant)
+            if target is None:
+                continue
+
+            try:
+                target.compile(_from_fingerprint(fingerprint))
+                count += 1
+            except Exception:
+                pass
+    finally:
+        _precompiling.active = False
+
+    return count
+
+
+def _wait_for_import(py_func, timeout=60):
+    # Function is compiled after its module is imported, so globals, defined
+    # after the function, are available. `_initializing` is set by importlib
+    # during module execution.
+    spec = getattr(sys.modules.get(py_func.__module__), "__spec__", None)
+    deadline = time.monotonic() + timeout
+    while getattr(spec, "_initializing", False) and time.monotonic() < deadline:
+        time.sleep(0.01)
+
+
+def _precompile_worker(queue):
+    while not _stop.is_set():
+        ref = queue.get()
+        disp = ref() if ref is not None else None
+        if disp is not None:
+            _wait_for_import(disp.py_func)
+            _precompile(disp)
+
+
+def _stop_worker():
+    # Compiling during the interpreter shutdown can run into already finalized
+    # runtimes, wait for the current signature instead.
+    _stop.set()
+    _queue.put(None)
+    _worker.join()
+
+
+def _get_queue():
+    global _queue, _worker
+    with _lock:
+        if _queue is None:
+            _queue = Queue()
+            # Daemon thread doesn't block the exit if it's stuck waiting for the
+            # module import.
+            _worker = threading.Thread(
+                target=_precompile_worker,
+                args=(_queue,),
+                name="numba_mlir_precompile",
+                daemon=True,
+            )
+            _worker.start()
+            # Runs before the `atexit` handlers, runtime libraries register
+            # their finalizers there.
+            threading._register_atexit(_stop_worker)
+    return _queue
+
+
+def on_dispatcher_created(disp):
+    """
+    Track top-level dispatcher and start its background precompilation, if it
+    has profiled signatures.
+    """
+    if _path is None or _get_func_key(disp.py_func) is None:
+        return
+
+    _dispatchers.add(disp)
+    if SIGNATURE_PRECOMPILE and _get_signatures(disp):
+        _get_queue().put(weakref.ref(disp))
+
+
+def warmup(*funcs):
+    """
+    Compile `funcs` dispatchers (all dispatchers, created so far, if empty)
+    for their profiled signatures and finish deferred compilation. Returns
+    number of compiled signatures.
+    """
+    from .compiler_context import global_compiler_context
+    from .. import mlir_compiler
+
+    count = sum(_precompile(disp) for disp in (funcs or list(_dispatchers)))
+    mlir_compiler.finish_compilation(global_compiler_context)
+    return count
+
+
+set_signature_profile(SIGNATURE_PROFILE)
+atexit.register(save_signature_profile)
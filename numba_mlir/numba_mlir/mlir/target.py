@@ -2,11 +2,14 @@
 #
 # SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+import inspect
 import threading
 from enum import Enum
 from functools import singledispatch, cached_property
 from contextlib import contextmanager
 
+import numpy as np
+
 from numba.core import types, cpu, utils, compiler, options
 from numba.extending import typeof_impl as numba_typeof_impl
 from numba.core.typing import Context
@@ -23,6 +26,8 @@ from numba.core.target_extension import (
     CPU,
 )
 
+from . import signature_profile
+
 
 def typeof(val, purpose=Purpose.argument):
     """
@@ -45,6 +50,24 @@ def typeof_impl(val, c):
     return numba_typeof_impl(val, c)
 
 
+# Argument typing callbacks, keyed by the exact Python type. They are tried
+# before the generic typeof_impl dispatch in the dispatcher fallback path.
+_argument_typeof_fast = {}
+
+
+def register_argument_typeof(cls):
+    """
+    Register fast argument typing function for values of exact type *cls*.
+    Function should return Numba type or None to use generic typeof.
+    """
+
+    def wrapper(func):
+        _argument_typeof_fast[cls] = func
+        return func
+
+    return wrapper
+
+
 @typeof_impl.register(tuple)
 def _typeof_tuple(val, c):
     tys = [typeof_impl(v, c) for v in val]
@@ -128,6 +151,7 @@ class F64Truncate(Enum):
     Always = True
     Never = False
     Auto = "auto"
+    Mixed = "mixed"
 
 
 def _map_f64truncate(val):
@@ -137,14 +161,17 @@ def _map_f64truncate(val):
         return F64Truncate.Never
     elif val == "auto":
         return F64Truncate.Auto
+    elif val == "mixed":
+        return F64Truncate.Mixed
     else:
         raise ValueError(f"Invalid f64 truncate value: {val}")
 
 
 def _get_host_vec_length():
-    from .settings import DISABLE_VECTORIZE
+    from .settings import DISABLE_VECTORIZE, VECTORIZER
 
-    if DISABLE_VECTORIZE:
+    # MLIR vectorizer is skipped for functions with zero vector length.
+    if DISABLE_VECTORIZE or VECTORIZER == "llvm":
         return 0
 
     from ..mlir_compiler import get_vector_length
@@ -168,6 +195,79 @@ def _map_vectorize(val):
     raise ValueError(f"Invalid mlir_vectorize value: {val}")
 
 
+_parallel_schedules = ["auto", "static", "simple", "affinity", "guided", "dynamic"]
+
+
+def _map_parallel_schedule(val):
+    if val is None or val in _parallel_schedules:
+        return val
+
+    raise ValueError(
+        f"Invalid mlir_parallel_schedule value: {val}, expected one of {_parallel_schedules}"
+    )
+
+
+_parallel_backends = ["tbb", "opencilk", "cuda", "serial"]
+
+
+def _map_parallel_backend(val):
+    if val is None or val in _parallel_backends:
+        return val
+
+    raise ValueError(
+        f"Invalid mlir_parallel_backend value: {val}, expected one of {_parallel_backends}"
+    )
+
+
+def _map_cuda_launch_hint(name, val, check, expected):
+    """Map CUDA launch hint, which is either a single value for all prange
+    loops in the function or a sequence with a value per prange loop in the
+    source order, None entries keep runtime defaults."""
+    if val is None or check(val):
+        return val
+
+    if isinstance(val, (list, tuple)) and all(v is None or check(v) for v in val):
+        return tuple(val)
+
+    raise ValueError(
+        f"Invalid {name} value: {val}, expected {expected} or sequence of them"
+    )
+
+
+def _map_cuda_threads_per_block(val):
+    return _map_cuda_launch_hint(
+        "mlir_cuda_threads_per_block",
+        val,
+        lambda v: isinstance(v, int) and not isinstance(v, bool) and 0 < v <= 1024,
+        "integer in [1, 1024]",
+    )
+
+
+def _map_cuda_occupancy_launch(val):
+    return _map_cuda_launch_hint(
+        "mlir_cuda_occupancy_launch",
+        val,
+        lambda v: isinstance(v, bool),
+        "True/False",
+    )
+
+
+def _map_gpu_devices(val):
+    if val is None:
+        return None
+
+    if isinstance(val, str):
+        val = val.split(",")
+
+    if not isinstance(val, (list, tuple)) or not all(isinstance(d, str) for d in val):
+        raise ValueError(
+            f"Invalid gpu_devices value: {val}, expected list of device names"
+        )
+
+    devices = [d.strip() for d in val if d.strip()]
+    return ",".join(devices) if devices else None
+
+
 def _set_option(flags, name, options, default, mapping=lambda a: a):
     value = mapping(options.get(name, default))
     setattr(flags, name, value)
@@ -176,26 +276,58 @@ def _set_option(flags, name, options, default, mapping=lambda a: a):
 class NumbaMLIRTargetOptions(cpu.CPUTargetOptions):
     gpu_fp64_truncate = _option_mapping("gpu_fp64_truncate", _map_f64truncate)
     gpu_use_64bit_index = _option_mapping("gpu_use_64bit_index")
+    gpu_devices = _option_mapping("gpu_devices", _map_gpu_devices)
     enable_gpu_pipeline = _option_mapping("enable_gpu_pipeline")
     mlir_force_inline = _option_mapping("mlir_force_inline")
     mlir_vectorize = _option_mapping("mlir_vectorize", _map_vectorize)
+    mlir_parallel_schedule = _option_mapping(
+        "mlir_parallel_schedule", _map_parallel_schedule
+    )
+    mlir_parallel_grain = _option_mapping("mlir_parallel_grain")
+    mlir_parallel_backend = _option_mapping(
+        "mlir_parallel_backend", _map_parallel_backend
+    )
+    mlir_cuda_threads_per_block = _option_mapping(
+        "mlir_cuda_threads_per_block", _map_cuda_threads_per_block
+    )
+    mlir_cuda_occupancy_launch = _option_mapping(
+        "mlir_cuda_occupancy_launch", _map_cuda_occupancy_launch
+    )
+    mlir_affine_opt = _option_mapping("mlir_affine_opt")
+    mlir_prefetch = _option_mapping("mlir_prefetch")
+    mlir_deterministic_reduce = _option_mapping("mlir_deterministic_reduce")
+    mlir_pack_bool_arrays = _option_mapping("mlir_pack_bool_arrays")
+    mlir_const_args = _option_mapping("mlir_const_args")
 
     def finalize(self, flags, options):
         super().finalize(flags, options)
         _set_option(flags, "gpu_fp64_truncate", options, False)
         _set_option(flags, "gpu_use_64bit_index", options, True)
+        _set_option(flags, "gpu_devices", options, None)
         _set_option(flags, "enable_gpu_pipeline", options, True)
         _set_option(flags, "mlir_force_inline", options, False)
         _set_option(flags, "mlir_vectorize", options, _def_vector_len)
+        _set_option(flags, "mlir_parallel_schedule", options, None)
+        _set_option(flags, "mlir_parallel_grain", options, 0)
+        _set_option(flags, "mlir_parallel_backend", options, None)
+        _set_option(flags, "mlir_cuda_threads_per_block", options, None)
+        _set_option(flags, "mlir_cuda_occupancy_launch", options, None)
+        _set_option(flags, "mlir_affine_opt", options, None)
+        _set_option(flags, "mlir_prefetch", options, None)
+        _set_option(flags, "mlir_deterministic_reduce", options, None)
+        _set_option(flags, "mlir_pack_bool_arrays", options, False)
+        _set_option(flags, "mlir_const_args", options, None)
         assert flags.gpu_fp64_truncate in [
             True,
             False,
             "auto",
-        ], 'gpu_fp64_truncate supported values are True/False/"auto"'
+            "mixed",
+        ], 'gpu_fp64_truncate supported values are True/False/"auto"/"mixed"'
         assert flags.gpu_use_64bit_index in [
             True,
             False,
-        ], "gpu_use_64bit_index supported values are True/False"
+            "auto",
+        ], 'gpu_use_64bit_index supported values are True/False/"auto"'
         assert flags.enable_gpu_pipeline in [
             True,
             False,
@@ -236,6 +368,64 @@ def is_nested_compile():
     return tls_state.compiler_nest > 0
 
 
+def _make_out_variant(disp):
+    """
+    Creates dispatcher for `py_func(*args, out)`, which stores `py_func(*args)`
+    result into `out` and returns nothing.
+    """
+    py_func = disp.py_func
+    code = py_func.__code__
+    if code.co_flags & (inspect.CO_VARARGS | inspect.CO_VARKEYWORDS):
+        raise TypeError("out variant is not supported for functions with varargs")
+
+    args = code.co_varnames[: code.co_argcount]
+    if "out" in args:
+        raise TypeError("out variant function already has an 'out' argument")
+
+    inner_opts = dict(disp.targetoptions)
+    inner_opts["mlir_force_inline"] = True
+    pipeline_class = disp._compiler.pipeline_class
+    inner = type(disp)(
+        py_func,
+        locals=disp.locals,
+        targetoptions=inner_opts,
+        pipeline_class=pipeline_class,
+        profile_variant=None,
+    )
+
+    args_str = ", ".join(args)
+    func_name = f"{py_func.__name__}_out"
+    src = f"def {func_name}({args_str}{', ' if args else ''}out):\n"
+    src += f"    out[:] = inner({args_str})\n"
+    glbls = {"inner": inner}
+    exec(src, glbls)
+    return type(disp)(
+        glbls[func_name],
+        targetoptions=dict(disp.targetoptions),
+        pipeline_class=pipeline_class,
+        profile_variant=None,
+    )
+
+
+_async_executor = None
+_async_executor_lock = threading.Lock()
+
+
+def _get_async_executor():
+    global _async_executor
+    if _async_executor is None:
+        with _async_executor_lock:
+            if _async_executor is None:
+                from concurrent.futures import ThreadPoolExecutor
+                from .settings import ASYNC_WORKERS
+
+                _async_executor = ThreadPoolExecutor(
+                    max_workers=ASYNC_WORKERS or None,
+                    thread_name_prefix="numba_mlir_async",
+                )
+    return _async_executor
+
+
 class NumbaMLIRDispatcher(Dispatcher):
     targetdescr = numba_mlir_target
 
@@ -246,9 +436,15 @@ class NumbaMLIRDispatcher(Dispatcher):
         targetoptions={},
         impl_kind="direct",
         pipeline_class=compiler.Compiler,
+        profile_variant="",
     ):
         super().__init__(py_func, locals, targetoptions, impl_kind, pipeline_class)
 
+        # Variant of signatures, recorded into the signature profile, None
+        # disables recording. Only top-level dispatchers ("" variant) are
+        # precompiled from the profile, they compile other variants.
+        self._profile_variant = profile_variant
+
         # Import locally to avoid circular module dependency
         from .compiler import dummy_compiler_pipeline
 
@@ -257,6 +453,9 @@ class NumbaMLIRDispatcher(Dispatcher):
             py_func, self.targetdescr, targetoptions, locals, dummy_compiler_pipeline
         )
 
+        if profile_variant == "":
+            signature_profile.on_dispatcher_created(self)
+
     def typeof_pyval(self, val):
         """
         Resolve the Numba type of Python value *val*.
@@ -265,22 +464,94 @@ class NumbaMLIRDispatcher(Dispatcher):
         """
         # Not going through the resolve_argument_type() indirection
         # can save a couple µs.
-        try:
-            tp = typeof(val, Purpose.argument)
-        except ValueError:
-            tp = types.pyobject
-        else:
-            if tp is None:
+        fast = _argument_typeof_fast.get(type(val))
+        tp = fast(val) if fast is not None else None
+        if tp is None:
+            try:
+                tp = typeof(val, Purpose.argument)
+            except ValueError:
                 tp = types.pyobject
+            else:
+                if tp is None:
+                    tp = types.pyobject
         self._types_active_call.append(tp)
         return tp
 
+    @cached_property
+    def out_variant(self):
+        """
+        Dispatcher, which takes an additional trailing `out` array argument and
+        writes the function result into it instead of returning a new array.
+
+        Function body is inlined into the wrapper, so the result computation
+        can be fused directly into the `out` writes, skipping the result
+        allocation and boxing entirely.
+        """
+        return _make_out_variant(self)
+
+    def submit(self, *args, **kwargs):
+        """
+        Call function asynchronously, returns `concurrent.futures.Future` with
+        the call result.
+
+        Function is compiled (if needed) synchronously, so typing errors are
+        raised immediately, and the call itself is executed by the worker
+        thread pool. Calls only run concurrently with the caller Python code
+        and with each other if function is compiled with `nogil=True`,
+        otherwise GIL is held for the whole call.
+        """
+        if not kwargs and self._can_compile:
+            self.compile(tuple(typeof(a) for a in args))
+
+        return _get_async_executor().submit(self, *args, **kwargs)
+
+    def optimization_remarks(self, signature=None):
+        """
+        Return optimization remarks, emitted by the compiler pipeline, e.g.
+        loops which were not parallelized or vectorized, arrays which needed a
+        copy, etc.
+
+        Result is a list of {"pass", "reason", "location"} dicts for the
+        `signature` or dict of signature -> list for all compiled signatures
+        if `signature` is None.
+        """
+        if signature is not None:
+            return self.overloads[signature].metadata.get("mlir_remarks", [])
+
+        return {sig: self.optimization_remarks(sig) for sig in self.overloads.keys()}
+
+    def print_optimization_remarks(self, signature=None):
+        """
+        Print optimization remarks, similar to `parallel_diagnostics`.
+        """
+        remarks = self.optimization_remarks(signature)
+        if signature is not None:
+            remarks = {signature: remarks}
+
+        for sig, sig_remarks in remarks.items():
+            print(f"Optimization remarks for {self.py_func.__name__} {sig}:")
+            for remark in sig_remarks:
+                print(
+                    f"  {remark['location']}: [{remark['pass']}] {remark['reason']}"
+                )
+
     def compile(self, *args, **kwargs):
         if is_nested_compile():
             return self._dummy_compile(*args, **kwargs)
 
         with compile_scope() as s:
-            return super().compile(*args, **kwargs)
+            res = super().compile(*args, **kwargs)
+
+        if self._profile_variant is not None and len(args) == 1 and not kwargs:
+            signature_profile.record(self, args[0])
+
+        return res
+
+    def _get_profile_dispatcher(self, variant):
+        """
+        Returns dispatcher, which compiles profiled signatures of `variant`.
+        """
+        return self if variant == "" else None
 
     def _dummy_compile(self, *args, **kwargs):
         old_compiler = self._compiler
@@ -291,6 +562,250 @@ class NumbaMLIRDispatcher(Dispatcher):
             self._compiler = old_compiler
 
 
+_shape_key_scalars = (bool, int, float, complex)
+
+
+def _get_shape_key(args):
+    """
+    Returns hashable key, describing argument types and array shapes, or None
+    if arguments are not suitable for shape specialization.
+    """
+    key = []
+    has_array = False
+    for arg in args:
+        t = type(arg)
+        if t is np.ndarray:
+            flags = arg.flags
+            key.append(
+                (
+                    arg.shape,
+                    arg.dtype,
+                    flags.c_contiguous,
+                    flags.f_contiguous,
+                    flags.writeable,
+                    flags.aligned,
+                )
+            )
+            has_array = True
+        elif t in _shape_key_scalars:
+            key.append(t)
+        else:
+            return None
+
+    return tuple(key) if has_array else None
+
+
+class ShapeSpecializingDispatcher(NumbaMLIRDispatcher):
+    """
+    Dispatcher, which compiles additional variant with fully static array
+    shapes for the argument shapes, seen at least `shape_specialize` times.
+    Variants are selected by the exact shapes match at call time, other calls
+    go through the generic dispatch.
+    """
+
+    # Max number of specialized variants per function.
+    max_variants = 8
+
+    # Stop counting new shapes after this.
+    max_tracked_shapes = 1024
+
+    def __init__(
+        self,
+        py_func,
+        locals={},
+        targetoptions={},
+        impl_kind="direct",
+        pipeline_class=compiler.Compiler,
+        shape_specialize=1,
+        profile_variant="",
+    ):
+        super().__init__(
+            py_func, locals, targetoptions, impl_kind, pipeline_class, profile_variant
+        )
+        self._shape_threshold = shape_specialize
+        self._shape_counts = {}
+        self._shape_variants = {}
+
+    @cached_property
+    def _static_dispatcher(self):
+        # Static variants are compiled into separate dispatcher, so they are
+        # never selected by generic dispatch through type conversions.
+        return NumbaMLIRDispatcher(
+            self.py_func,
+            locals=self.locals,
+            targetoptions=self.targetoptions,
+            pipeline_class=self._compiler.pipeline_class,
+            profile_variant="static",
+        )
+
+    def _get_profile_dispatcher(self, variant):
+        # Precompiled static variants are only selected after the shape is
+        # seen `shape_specialize` times, but they are not compiled again.
+        if variant == "static":
+            return self._static_dispatcher
+
+        return super()._get_profile_dispatcher(variant)
+
+    def __call__(self, *args, **kwargs):
+        key = None if kwargs else _get_shape_key(args)
+        if key is None:
+            return super().__call__(*args, **kwargs)
+
+        entry = self._shape_variants.get(key)
+        if entry is None:
+            entry = self._get_shape_variant(key, args)
+            if entry is None:
+                return super().__call__(*args)
+
+        return entry(*args)
+
+    def _get_shape_variant(self, key, args):
+        if len(self._shape_variants) >= self.max_variants:
+            return None
+
+        count = self._shape_counts.get(key, 0) + 1
+        if count < self._shape_threshold:
+            if key in self._shape_counts or (
+                len(self._shape_counts) < self.max_tracked_shapes
+            ):
+                self._shape_counts[key] = count
+            return None
+
+        self._shape_counts.pop(key, None)
+        sig = tuple(self._get_static_type(arg) for arg in args)
+        entry = self._static_dispatcher.compile(sig)
+        self._shape_variants[key] = entry
+        return entry
+
+    def _get_static_type(self, val):
+        tp = typeof(val, Purpose.argument)
+        if not isinstance(val, np.ndarray):
+            return tp
+
+        from .array_type import FixedArray
+
+        return FixedArray(
+            tp.dtype,
+            tp.ndim,
+            tp.layout,
+            fixed_dims=tuple(val.shape),
+            readonly=not tp.mutable,
+            aligned=tp.aligned,
+        )
+
+
+_value_key_scalars = (bool, int)
+
+
+class ValueSpecializingDispatcher(NumbaMLIRDispatcher):
+    """
+    Dispatcher, which compiles separate variant for each set of values of the
+    `specialize_args` arguments. Values are folded into the function IR as
+    constants, so branches and loops, depending on them, can be resolved at
+    compile time. Only `bool` and `int` values are specialized, calls with
+    other values, keyword args or when `max_variants` limit is reached go
+    through the generic dispatch.
+    """
+
+    # Max number of specialized variants per function.
+    max_variants = 16
+
+    def __init__(
+        self,
+        py_func,
+        locals={},
+        targetoptions={},
+        impl_kind="direct",
+        pipeline_class=compiler.Compiler,
+        specialize_args=(),
+        profile_variant="",
+    ):
+        super().__init__(
+            py_func, locals, targetoptions, impl_kind, pipeline_class, profile_variant
+        )
+        params = list(inspect.signature(py_func).parameters.keys())
+        indices = []
+        for name in specialize_args:
+            if name not in params:
+                raise ValueError(f"Invalid mlir_specialize_args argument: {name}")
+            indices.append(params.index(name))
+
+        self._specialize_indices = tuple(sorted(indices))
+        self._value_variants = {}
+
+    def __call__(self, *args, **kwargs):
+        key = None if kwargs else self._get_value_key(args)
+        if key is None:
+            return super().__call__(*args, **kwargs)
+
+        disp = self._value_variants.get(key)
+        if disp is None:
+            if len(self._value_variants) >= self.max_variants:
+                return super().__call__(*args)
+
+            disp = self._make_value_variant(args)
+            self._value_variants[key] = disp
+
+        return disp(*args)
+
+    def _get_value_key(self, args):
+        key = []
+        for i in self._specialize_indices:
+            if i >= len(args):
+                return None
+
+            val = args[i]
+            t = type(val)
+            if t not in _value_key_scalars:
+                return None
+
+            # Type is part of the key, so `1` and `True` are different variants.
+            key.append((t, val))
+
+        return tuple(key)
+
+    def _make_value_variant(self, args):
+        targetoptions = dict(self.targetoptions)
+        targetoptions["mlir_const_args"] = tuple(
+            (i, args[i]) for i in self._specialize_indices
+        )
+        return NumbaMLIRDispatcher(
+            self.py_func,
+            locals=self.locals,
+            targetoptions=targetoptions,
+            pipeline_class=self._compiler.pipeline_class,
+            profile_variant=None,
+        )
+
+
+def _traced_call(self, *args, **kwargs):
+    from .runtime import trace_now, trace_event
+
+    begin = trace_now()
+    try:
+        return Dispatcher.__call__(self, *args, **kwargs)
+    finally:
+        trace_event(self.py_func.__qualname__, "dispatch", begin, trace_now())
+
+
+def _set_call_tracing(ptr):
+    # Calls go through the native dispatcher directly unless tracing is
+    # enabled, so there is no overhead otherwise.
+    if ptr:
+        NumbaMLIRDispatcher.__call__ = _traced_call
+    elif "__call__" in NumbaMLIRDispatcher.__dict__:
+        del NumbaMLIRDispatcher.__call__
+
+
+def _register_call_tracing():
+    from .runtime import add_trace_hook
+
+    add_trace_hook(_set_call_tracing)
+
+
+_register_call_tracing()
+del _register_call_tracing
+
 dispatcher_registry[target_registry[target_name]] = NumbaMLIRDispatcher
 
 
@@ -327,13 +842,15 @@ class numba_mlir_jit(JitDecorator):
             True,
             False,
             "auto",
-        ], 'gpu_fp64_truncate supported values are True/False/"auto"'
+            "mixed",
+        ], 'gpu_fp64_truncate supported values are True/False/"auto"/"mixed"'
 
         use_64bit_index = options.get("gpu_use_64bit_index", True)
         assert use_64bit_index in [
             True,
             False,
-        ], "gpu_use_64bit_index supported values are True/False"
+            "auto",
+        ], 'gpu_use_64bit_index supported values are True/False/"auto"'
 
         # pipeline_class = mlir_compiler_pipeline
         # pipeline_class = compiler.Compiler
@@ -5,10 +5,15 @@
 import numba
 
 # from numba_mlir import njit
+import json
 import math
+import os
+import platform
+import subprocess
 import sys
 from numpy.testing import assert_equal, assert_allclose
 from numba_mlir.mlir.passes import print_pass_ir, get_print_buffer
+from numba_mlir.mlir.settings import TAPIR_TARGET
 
 import pytest
 import itertools
@@ -272,6 +277,84 @@ def test_math_uplifting_minmax(a, b, body, op):
         assert ir.count(op) == 1, ir
 
 
+@pytest.mark.parametrize("a", [0.0, 1.5, 3.0, 4.25])
+@pytest.mark.parametrize(
+    "body, op",
+    [
+        ("a**2", "arith.mulf"),
+        ("a**-1", "arith.divf"),
+        ("math.pow(a, 2.0)", "arith.mulf"),
+        ("math.pow(a, -1.0)", "arith.divf"),
+    ],
+)
+def test_math_uplifting_pow(a, body, op):
+    py_func = eval(f"lambda a: {body}")
+
+    with print_pass_ir([], ["UpliftMathPass"]):
+        jit_func = njit(py_func)
+
+        assert_equal(_skip_python_errors(py_func)(a), jit_func(a))
+        ir = get_print_buffer()
+        assert ir.count("math.powf") == 0, ir
+        assert ir.count(op) > 0, ir
+
+
+@pytest.mark.parametrize("a", [0.0, 1.5, 3.0, 4.25])
+@pytest.mark.parametrize("body", ["a**0.5", "a**-0.5", "math.pow(a, 5.0)"])
+def test_math_uplifting_pow_no_fastmath(a, body):
+    py_func = eval(f"lambda a: {body}")
+
+    with print_pass_ir([], ["UpliftMathPass"]):
+        jit_func = njit(py_func)
+
+        assert_equal(_skip_python_errors(py_func)(a), jit_func(a))
+        ir = get_print_buffer()
+        assert ir.count("math.powf") > 0, ir
+
+
+@pytest.mark.parametrize("a", [0.0, 1.5, 3.0, 4.25])
+@pytest.mark.parametrize(
+    "body, op",
+    [
+        ("a**3", "arith.mulf"),
+        ("a**-2", "arith.divf"),
+        ("a**0.5", "math.sqrt"),
+        ("a**-0.5", "math.rsqrt"),
+        ("math.pow(a, 5.0)", "arith.mulf"),
+    ],
+)
+def test_math_uplifting_pow_fastmath(a, body, op):
+    py_func = eval(f"lambda a: {body}")
+
+    with print_pass_ir([], ["UpliftMathPass"]):
+        jit_func = njit(py_func, fastmath=True)
+
+        assert_allclose(_skip_python_errors(py_func)(a), jit_func(a), rtol=1e-14)
+        ir = get_print_buffer()
+        assert ir.count("math.powf") == 0, ir
+        assert ir.count(op) > 0, ir
+
+
+def test_math_uplifting_horner():
+    def py_func(x):
+        return 1.5 * x * x * x + 2.5 * x * x - 3.0 * x + 4.0
+
+    x = 1.25
+    with print_pass_ir([], ["UpliftMathPass"]):
+        jit_func = njit(py_func, fastmath=False)
+
+        assert_equal(py_func(x), jit_func(x))
+        ir = get_print_buffer()
+        assert ir.count("arith.mulf") == 6, ir
+
+    with print_pass_ir([], ["UpliftMathPass"]):
+        jit_func = njit(py_func, fastmath=True)
+
+        assert_allclose(py_func(x), jit_func(x), rtol=1e-14)
+        ir = get_print_buffer()
+        assert ir.count("arith.mulf") == 3, ir
+
+
 @parametrize_function_variants(
     "py_func",
     [
@@ -864,6 +947,1364 @@ def test_prange_reduce3():
     assert_equal(py_func(10), jit_func(10))
 
 
+@pytest.mark.parametrize("backend", ["tbb", "serial"])
+def test_prange_backend(backend):
+    def py_func(a):
+        res = 0
+        for i in numba.prange(a):
+            res = res + i
+        return res
+
+    with print_pass_ir([], ["ParallelToTbbPass"]):
+        jit_func = njit(py_func, parallel=True, mlir_parallel_backend=backend)
+        assert_equal(py_func(10), jit_func(10))
+        ir = get_print_buffer()
+        assert (ir.count("numba_util.parallel") > 0) == (backend == "tbb"), ir
+
+
+@pytest.mark.parametrize(
+    "dtype, slot",
+    [(np.float32, "x16xf32>"), (np.float64, "x8xf64>"), (np.int64, "x8xi64>")],
+)
+def test_prange_reduce_slots_padding(dtype, slot):
+    def py_func(a):
+        res = a[0]
+        for i in numba.prange(1, a.shape[0]):
+            res = res + a[i]
+        return res
+
+    a = np.arange(1, 1000, dtype=dtype)
+    with print_pass_ir([], ["ParallelToTbbPass"]):
+        jit_func = njit(py_func, parallel=True)
+        assert_allclose(jit_func(a), py_func(a), rtol=1e-5)
+        ir = get_print_buffer()
+
+    # Every thread slot is padded to the whole cache line.
+    allocas = [line for line in ir.splitlines() if "memref.alloca" in line]
+    assert any(slot in line for line in allocas), ir
+
+
+# Function-wide values are also printed as the function attributes.
+@pytest.mark.parametrize(
+    "threads, occupancy, expected",
+    [
+        (64, True, {"threads_per_block = 64": 3, "occupancy_launch = true": 3}),
+        (
+            (128, None),
+            (None, False),
+            {"threads_per_block = 128": 1, "occupancy_launch = false": 1},
+        ),
+        ((None, 256), None, {"threads_per_block = 256": 1, "occupancy_launch": 0}),
+    ],
+)
+def test_prange_cuda_launch_hints(threads, occupancy, expected):
+    def py_func(a, b):
+        res = 0
+        for i in numba.prange(a):
+            res = res + i
+        for i in numba.prange(b):
+            res = res + i * 2
+        return res
+
+    with print_pass_ir([], ["ParallelToTbbPass"]):
+        jit_func = njit(
+            py_func,
+            parallel=True,
+            mlir_cuda_threads_per_block=threads,
+            mlir_cuda_occupancy_launch=occupancy,
+        )
+        assert_equal(py_func(10, 20), jit_func(10, 20))
+        ir = get_print_buffer()
+        for attr, count in expected.items():
+            assert ir.count("numba.cuda_" + attr) == count, ir
+
+
+@pytest.mark.parametrize(
+    "option, value",
+    [
+        ("mlir_cuda_threads_per_block", 0),
+        ("mlir_cuda_threads_per_block", (64, 2048)),
+        ("mlir_cuda_occupancy_launch", 1),
+    ],
+)
+def test_prange_cuda_launch_hints_invalid(option, value):
+    def py_func(a):
+        res = 0
+        for i in numba.prange(a):
+            res = res + i
+        return res
+
+    jit_func = njit(py_func, parallel=True, **{option: value})
+    with pytest.raises(ValueError, match=option):
+        jit_func(10)
+
+
+@pytest.mark.parametrize("size", [1, 7, 100000])
+def test_prange_serial_cutoff(size):
+    def py_func(a):
+        res = 0
+        for i in numba.prange(a):
+            res = res + i * 2
+        return res
+
+    with print_pass_ir([], ["ParallelToTbbPass"]):
+        jit_func = njit(py_func, parallel=True)
+        assert_equal(py_func(size), jit_func(size))
+        ir = get_print_buffer()
+        assert ir.count("numba.parallel_cost") > 0, ir
+
+
+def test_prange_keep_warm():
+    from numba_mlir.mlir.runtime import set_keep_warm, parallel_warmup
+
+    def py_func(a):
+        res = 0
+        for i in numba.prange(a):
+            res = res + i
+        return res
+
+    jit_func = njit(py_func, parallel=True)
+    set_keep_warm(1000)
+    try:
+        parallel_warmup()
+        for a in [100000, 200000, 300000]:
+            assert_equal(py_func(a), jit_func(a))
+    finally:
+        set_keep_warm(0)
+
+
+def test_perf_counters():
+    from numba_mlir.mlir.runtime import perf_counters
+
+    def py_func(a):
+        res = 0
+        for i in numba.prange(a):
+            res = res + i
+        return res
+
+    jit_func = njit(py_func, parallel=True)
+    jit_func(10)
+
+    # Generic hardware events from linux/perf_event.h: cycles, instructions
+    # and cache misses.
+    events = [(0, 0), (0, 1), (0, 3)]
+    with perf_counters(events) as values:
+        assert_equal(jit_func(1000000), py_func(1000000))
+
+    if values is None:
+        pytest.skip("Perf counters are not available")
+
+    assert len(values) == len(events)
+    assert any(v > 0 for v in values), values
+
+
+def test_benchmark_perf_counters():
+    pytest.importorskip("asv_runner")
+    from numba_mlir.mlir.benchmarking import _collect_perf_counters, PERF_VECTOR_EVENTS
+
+    def py_func(a):
+        return np.sum(a * 2)
+
+    jit_func = njit(py_func)
+    a = np.arange(100000, dtype=np.float64)
+    jit_func(a)
+    res = _collect_perf_counters(jit_func, (a,))
+    if not res:
+        pytest.skip("Perf counters are not available")
+
+    for name in ["cycles", "instructions", "llc_misses", "memory_bandwidth"]:
+        assert name in res and res[name] >= 0, res
+
+    assert ("vector_instructions" in res) == bool(PERF_VECTOR_EVENTS), res
+
+
+@pytest.mark.parametrize(
+    "affinity, expected",
+    [
+        ("none", (0, [])),
+        ("Compact", (1, [])),
+        ("scatter", (2, [])),
+        ("cores", (3, [])),
+        ("3", (4, [3])),
+        ("0,2,4-6", (4, [0, 2, 4, 5, 6])),
+    ],
+)
+def test_parse_affinity(affinity, expected):
+    from numba_mlir.mlir.runtime import _parse_affinity
+
+    assert _parse_affinity(affinity) == expected
+
+
+@pytest.mark.parametrize("affinity", ["abc", "1-", "3-1", "-1"])
+def test_parse_affinity_invalid(affinity):
+    from numba_mlir.mlir.runtime import _parse_affinity
+
+    with pytest.raises(ValueError):
+        _parse_affinity(affinity)
+
+
+_AFFINITY_SCRIPT = """
+import os
+
+import numba
+import numpy as np
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir.runtime import runtime_lib, get_num_threads
+
+
+@njit(parallel=True)
+def func(a):
+    res = np.empty_like(a)
+    for i in numba.prange(a.shape[0]):
+        res[i] = a[i] * 2
+    return res
+
+
+a = np.arange(10000)
+assert_equal(func(a), a * 2)
+
+# Policies, restricting the CPUs, use one thread per selected CPU.
+if os.environ["NUMBA_MLIR_PARALLEL_AFFINITY"] in ("cores", "0"):
+    assert get_num_threads() == runtime_lib.nmrtParallelGetDefaultNumThreads()
+"""
+
+
+@pytest.mark.parametrize("affinity", ["compact", "scatter", "cores", "0", "abc"])
+def test_parallel_affinity(tmp_path, affinity):
+    script = tmp_path / "affinity_script.py"
+    script.write_text(_AFFINITY_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_PARALLEL_AFFINITY"] = affinity
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+    # Invalid value is reported, but doesn't break the import.
+    if affinity == "abc":
+        assert "NUMBA_MLIR_PARALLEL_AFFINITY" in res.stderr, res.stderr
+
+
+@pytest.mark.parametrize("schedule", [None, "affinity", "guided", "dynamic"])
+def test_prange_nogil_threads(schedule):
+    from concurrent.futures import ThreadPoolExecutor
+
+    def py_func(a):
+        res = 0
+        for i in numba.prange(a):
+            res = res + i
+        return res
+
+    jit_func = njit(py_func, parallel=True, nogil=True, mlir_parallel_schedule=schedule)
+    args = list(range(1000, 1064))
+    with ThreadPoolExecutor(max_workers=8) as pool:
+        results = list(pool.map(jit_func, args))
+
+    assert_equal(results, [py_func(a) for a in args])
+
+
+def test_take_context_threads():
+    import ctypes
+    import time
+    from concurrent.futures import ThreadPoolExecutor
+    from numba_mlir.mlir.runtime import runtime_lib
+
+    init_func_t = ctypes.CFUNCTYPE(None, ctypes.c_void_p)
+    take_context = runtime_lib.nmrtTakeContext
+    take_context.restype = ctypes.c_void_p
+    take_context.argtypes = [
+        ctypes.POINTER(ctypes.c_void_p),
+        ctypes.c_size_t,
+        init_func_t,
+        init_func_t,
+    ]
+    purge_context = runtime_lib.nmrtPurgeContext
+    purge_context.restype = None
+    purge_context.argtypes = [ctypes.POINTER(ctypes.c_void_p)]
+
+    counts = {"init": 0, "release": 0}
+
+    def init(data):
+        counts["init"] += 1
+        # Give other threads a chance to race the first call.
+        time.sleep(0.1)
+
+    def release(data):
+        counts["release"] += 1
+
+    init_cb = init_func_t(init)
+    release_cb = init_func_t(release)
+    handle = ctypes.c_void_p()
+
+    def take(_):
+        return take_context(ctypes.byref(handle), 64, init_cb, release_cb)
+
+    with ThreadPoolExecutor(max_workers=8) as pool:
+        results = list(pool.map(take, range(32)))
+
+    assert counts == {"init": 1, "release": 0}
+    assert len(set(results)) == 1 and results[0]
+
+    purge_context(ctypes.byref(handle))
+    assert counts == {"init": 1, "release": 1}
+    assert not handle.value
+
+    # Purged context is initialized again on the next call.
+    take(0)
+    assert counts["init"] == 2
+    purge_context(ctypes.byref(handle))
+    assert counts["release"] == 2
+
+
+@pytest.mark.parametrize("schedule", ["guided", "dynamic"])
+@pytest.mark.parametrize("grain", [0, 3])
+def test_prange_ragged_schedule(schedule, grain):
+    def py_func(a, b):
+        res = 0
+        for i in numba.prange(a):
+            acc = 0
+            for j in range(i % 17 * 10):
+                acc = acc + j
+            for j in numba.prange(b):
+                acc = acc + i * j
+            res = res + acc
+        return res
+
+    jit_func = njit(
+        py_func,
+        parallel=True,
+        mlir_parallel_schedule=schedule,
+        mlir_parallel_grain=grain,
+    )
+    assert_equal(py_func(1001, 7), jit_func(1001, 7))
+
+
+@pytest.mark.parametrize("nogil", [False, True])
+def test_submit(nogil):
+    def py_func(a):
+        res = 0
+        for i in numba.prange(a):
+            res = res + i
+        return res
+
+    jit_func = njit(py_func, parallel=True, nogil=nogil)
+    args = list(range(1000, 1016))
+    futures = [jit_func.submit(a) for a in args]
+    assert_equal([f.result() for f in futures], [py_func(a) for a in args])
+
+
+def test_submit_typing_error():
+    def py_func(a):
+        return a.foo
+
+    jit_func = njit(py_func)
+    with pytest.raises(numba.core.errors.TypingError, match="foo"):
+        jit_func.submit(1)
+
+
+@pytest.mark.skipif(not hasattr(os, "fork"), reason="fork is not available")
+def test_prefork_warmup():
+    from numba_mlir.mlir.compiler_context import prefork_warmup
+
+    def py_func(a, b):
+        res = 0
+        for i in range(a):
+            res = res + i * b
+        return res
+
+    jit_func = njit(py_func)
+    prefork_warmup((jit_func, ["int64(int64, int64)"]))
+    assert len(jit_func.overloads) == 1
+
+    pid = os.fork()
+    if pid == 0:
+        ok = jit_func(10, 3) == py_func(10, 3) and len(jit_func.overloads) == 1
+        os._exit(0 if ok else 1)
+
+    _, status = os.waitpid(pid, 0)
+    assert os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0
+
+
+_FORK_SCRIPT = """
+import os
+
+import numba
+import numpy as np
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir.compiler_context import prefork_warmup
+
+
+def py_func(a, b):
+    res = 0
+    for i in range(a):
+        res = res + i * b
+    return res
+
+
+def py_par_func(a):
+    res = np.empty_like(a)
+    for i in numba.prange(a.shape[0]):
+        res[i] = a[i] * 2
+    return res
+
+
+def fork_and_check(check):
+    pid = os.fork()
+    if pid == 0:
+        try:
+            check()
+        except BaseException:
+            os._exit(1)
+        os._exit(0)
+
+    _, status = os.waitpid(pid, 0)
+    assert os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0, status
+
+
+a = np.arange(1000)
+jit_func = njit(py_func)
+jit_par_func = njit(py_par_func, parallel=True)
+
+# Parallel runtime workers are already running in the parent.
+assert_equal(jit_par_func(a), a * 2)
+prefork_warmup((jit_func, ["int64(int64, int64)"]))
+
+
+def check_warm():
+    assert jit_func(10, 3) == py_func(10, 3)
+    assert len(jit_func.overloads) == 1
+    assert_equal(jit_par_func(a), a * 2)
+
+
+fork_and_check(check_warm)
+
+# Fork without warmup, background compilations may still be queued.
+jit_func2 = njit(py_func)
+assert jit_func2(5, 2) == py_func(5, 2)
+
+
+def check_cold():
+    assert jit_func2(10, 3) == py_func(10, 3)
+    assert_equal(jit_par_func(a + 1), (a + 1) * 2)
+
+
+fork_and_check(check_cold)
+
+# Parent runtime and compiler still work after forks.
+assert jit_func2(7, 3) == py_func(7, 3)
+assert_equal(jit_par_func(a), a * 2)
+"""
+
+
+@pytest.mark.skipif(not hasattr(os, "fork"), reason="fork is not available")
+@pytest.mark.parametrize(
+    "mode",
+    [
+        {},
+        {"NUMBA_MLIR_LAZY_COMPILATION": "1"},
+        {"NUMBA_MLIR_TIERED_COMPILATION": "1"},
+        {"NUMBA_MLIR_TIERED_COMPILATION": "1", "NUMBA_MLIR_PGO_CALL_THRESHOLD": "3"},
+    ],
+)
+def test_fork_compile_modes(tmp_path, mode):
+    script = tmp_path / "fork_script.py"
+    script.write_text(_FORK_SCRIPT)
+    env = os.environ.copy()
+    env.update(mode)
+    res = subprocess.run(
+        [sys.executable, str(script)],
+        capture_output=True,
+        text=True,
+        env=env,
+        timeout=600,
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+def test_signature_profile(tmp_path):
+    from numba_mlir.mlir.signature_profile import (
+        set_signature_profile,
+        save_signature_profile,
+        warmup,
+    )
+
+    def py_func(a, b):
+        return a + b
+
+    path = str(tmp_path / "profile.json")
+    set_signature_profile(path)
+    try:
+        jit_func = njit(py_func)
+        assert_equal(jit_func(1, 2), py_func(1, 2))
+        assert_equal(jit_func(1.5, 2), py_func(1.5, 2))
+        save_signature_profile()
+
+        # Simulate next run.
+        set_signature_profile(path)
+        new_func = njit(py_func)
+        assert warmup(new_func) == 2
+        assert len(new_func.overloads) == 2
+
+        # Precompiled signatures are not counted as seen in this run.
+        assert_equal(new_func(1, 2), py_func(1, 2))
+        assert_equal(new_func(1, 2.5), py_func(1, 2.5))
+        save_signature_profile()
+        with open(path) as f:
+            profile = json.load(f)
+
+        key = f"{py_func.__module__}:{py_func.__qualname__}"
+        entries = profile["functions"][key][""]
+        assert sorted(e["runs"] for e in entries) == [1, 1, 1]
+    finally:
+        set_signature_profile(None)
+
+
+_COMPILE_MODE_SCRIPT = """
+import json
+
+import numba
+import numpy as np
+from numpy.testing import assert_allclose
+
+from numba_mlir import njit, mlir_compiler
+from numba_mlir.mlir.compiler_context import (
+    global_compiler_context,
+    get_compile_profile,
+)
+
+
+def add(a, b):
+    return a + b
+
+
+def loop_sum(n):
+    res = 0
+    for i in range(n):
+        res += i * i
+    return res
+
+
+def arr_func(a):
+    return np.sum(a * 2 + 1)
+
+
+def prange_func(a):
+    res = 0
+    for i in numba.prange(a.shape[0]):
+        res += a[i]
+    return res
+
+
+jit_add = njit(add)
+
+
+def caller(a, b):
+    return jit_add(a, b) * 2
+
+
+funcs = [
+    (njit(add), add, (1, 2)),
+    (njit(add), add, (1.5, 2.5)),
+    (njit(loop_sum), loop_sum, (10,)),
+    (njit(arr_func), arr_func, (np.arange(10.0),)),
+    (njit(prange_func, parallel=True), prange_func, (np.arange(100),)),
+    (njit(caller), caller, (3, 4)),
+]
+
+for i in range(2):
+    for jit_func, py_func, args in funcs:
+        assert_allclose(jit_func(*args), py_func(*args))
+
+    # Second iteration runs after all deferred compilation is finished.
+    mlir_compiler.finish_compilation(global_compiler_context)
+
+profile = get_compile_profile().get("driver", {})
+print(json.dumps({name: val["count"] for name, val in profile.items()}))
+"""
+
+
+def _run_compile_mode_script(tmp_path, env):
+    """
+    Run test functions in the new process, as compiler settings are only read
+    at startup. Returns driver compile profile counts.
+    """
+    script = tmp_path / "compile_mode_script.py"
+    script.write_text(_COMPILE_MODE_SCRIPT)
+    res = subprocess.run(
+        [sys.executable, str(script)],
+        env={**os.environ, **env},
+        capture_output=True,
+        text=True,
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+    return json.loads(res.stdout.splitlines()[-1])
+
+
+def test_tiered_compilation(tmp_path):
+    _run_compile_mode_script(tmp_path, {"NUMBA_MLIR_TIERED_COMPILATION": "1"})
+
+
+# Threshold 1 triggers on the first call, 2 on the second one and the large
+# one never triggers, so the unused second tier is dropped on release.
+@pytest.mark.parametrize("threshold", ["1", "2", "1000000"])
+def test_tiered_compilation_pgo(tmp_path, threshold):
+    env = {
+        "NUMBA_MLIR_TIERED_COMPILATION": "1",
+        "NUMBA_MLIR_PGO_CALL_THRESHOLD": threshold,
+    }
+    _run_compile_mode_script(tmp_path, env)
+
+
+@pytest.mark.skipif(TAPIR_TARGET != "opencilk", reason="OpenCilk is not enabled")
+def test_tiered_compilation_opencilk_reduce(tmp_path):
+    # First tier expands Tapir loops serially and calls the body once for the
+    # entire range, so the body must reduce all the chunks.
+    env = {
+        "NUMBA_MLIR_TIERED_COMPILATION": "1",
+        "NUMBA_MLIR_TAPIR_TARGET": "opencilk",
+    }
+    _run_compile_mode_script(tmp_path, env)
+
+
+def test_jit_linker_rtdyld(tmp_path):
+    _run_compile_mode_script(tmp_path, {"NUMBA_MLIR_JIT_LINKER": "rtdyld"})
+
+
+@pytest.mark.parametrize("code_model", ["small", "medium", "large"])
+def test_jit_code_model(tmp_path, code_model):
+    _run_compile_mode_script(tmp_path, {"NUMBA_MLIR_CODE_MODEL": code_model})
+
+
+def test_compile_threads(tmp_path):
+    _run_compile_mode_script(tmp_path, {"NUMBA_MLIR_COMPILE_THREADS": "4"})
+
+
+def test_lazy_compilation(tmp_path):
+    _run_compile_mode_script(tmp_path, {"NUMBA_MLIR_LAZY_COMPILATION": "1"})
+
+
+_CPU_RUNTIMES_SCRIPT = """
+import sys
+
+import numpy as np
+
+from numba_mlir import njit
+from numba_mlir.mlir import math_runtime
+
+
+@njit
+def func(a):
+    return np.sum(a * 2 + 1)
+
+
+assert func(np.arange(10.0)) == 100
+assert math_runtime.runtime_sycl_lib is None
+assert "numba_mlir.mlir.gpu_runtime" not in sys.modules
+"""
+
+
+def test_cpu_compile_skips_gpu_runtimes(tmp_path):
+    script = tmp_path / "cpu_runtimes_script.py"
+    script.write_text(_CPU_RUNTIMES_SCRIPT)
+    res = subprocess.run([sys.executable, str(script)], capture_output=True, text=True)
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_TAPIR_CONFIG_SCRIPT = """
+from numba_mlir import njit
+
+
+@njit
+def func(a, b):
+    return a + b
+
+
+assert func(1, 2) == 3
+"""
+
+
+@pytest.mark.parametrize(
+    "env, error",
+    [
+        ({"NUMBA_MLIR_TAPIR_TARGET": ""}, None),
+        ({"NUMBA_MLIR_TAPIR_TARGET": "None"}, None),
+        ({"NUMBA_MLIR_TAPIR_TARGET": "opencilk"}, "NUMBA_MLIR_TAPIR_ABI_BITCODE"),
+        (
+            {
+                "NUMBA_MLIR_TAPIR_TARGET": "opencilk",
+                "NUMBA_MLIR_TAPIR_ABI_BITCODE": "/nonexistent/abi.bc",
+            },
+            "Tapir ABI bitcode not found",
+        ),
+        ({"NUMBA_MLIR_TAPIR_TARGET": "foo"}, "Invalid tapir target"),
+    ],
+)
+def test_tapir_config(tmp_path, env, error):
+    script = tmp_path / "tapir_config_script.py"
+    script.write_text(_TAPIR_CONFIG_SCRIPT)
+    new_env = os.environ.copy()
+    new_env.pop("NM_TAPIRTARGET", None)
+    new_env.update(env)
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=new_env
+    )
+    if error is None:
+        assert res.returncode == 0, res.stdout + res.stderr
+    else:
+        assert res.returncode != 0, res.stdout + res.stderr
+        assert error in res.stdout + res.stderr
+
+
+_TAPIR_CUDA_PREFETCH_SCRIPT = """
+import numba
+import numpy as np
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+
+
+def py_func(a, b, n):
+    for _ in range(n):
+        for i in numba.prange(a.shape[0]):
+            b[i] = b[i] + a[i]
+
+
+jit_func = njit(py_func, parallel=True)
+
+a = np.arange(1024, dtype=np.float32)
+b = np.zeros_like(a)
+jit_func(a, b, 3)
+assert_equal(b, a * 3)
+"""
+
+
+@pytest.mark.skipif(TAPIR_TARGET != "cuda", reason="Kitsune CUDA is not enabled")
+def test_tapir_cuda_prefetch(tmp_path):
+    script = tmp_path / "tapir_cuda_prefetch_script.py"
+    script.write_text(_TAPIR_CUDA_PREFETCH_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_TAPIR_TARGET"] = "cuda"
+    env["NUMBA_MLIR_DUMP_OPTIMIZED"] = "1"
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+    # Kernel arguments are prefetched before the launch and the stream is synced
+    # once after the host loop instead of on every iteration.
+    ir = res.stdout
+
+    def count_calls(name):
+        return sum(
+            1 for line in ir.splitlines() if " call " in line and f"@{name}(" in line
+        )
+
+    launches = count_calls("__kitcuda_launch_kernel")
+    assert launches > 0, ir
+    assert count_calls("__kitcuda_mem_gpu_prefetch") >= launches, ir
+    assert count_calls("__kitcuda_sync_thread_stream") <= launches, ir
+
+
+_VECTOR_LIBRARY_SCRIPT = """
+import numpy as np
+from numpy.testing import assert_allclose
+
+from numba_mlir import njit
+
+
+def py_func(a, b):
+    for i in range(a.shape[0]):
+        b[i] = np.exp(a[i]) + np.sin(a[i])
+
+
+jit_func = njit(py_func)
+
+a = np.linspace(-3, 3, 1031)
+b = np.zeros_like(a)
+jit_func(a, b)
+assert_allclose(b, np.exp(a) + np.sin(a), rtol=1e-12)
+"""
+
+_vector_library_prefixes = {
+    "svml": "__svml_",
+    "libmvec": "_ZGV",
+    "sleef": "_ZGV",
+}
+
+
+@pytest.mark.parametrize("library", ["none", "svml", "libmvec", "sleef", "abc"])
+def test_vector_library(tmp_path, library):
+    script = tmp_path / "vector_library_script.py"
+    script.write_text(_VECTOR_LIBRARY_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_VECTOR_LIBRARY"] = library
+    env["NUMBA_MLIR_DUMP_OPTIMIZED"] = "1"
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    if library == "abc":
+        assert res.returncode != 0
+        assert "Invalid vector library" in res.stderr, res.stderr
+        return
+
+    assert res.returncode == 0, res.stdout + res.stderr
+
+    # Unavailable library is reported and vector math stays scalarized.
+    if "Failed to load vector library" in res.stderr:
+        library = "none"
+
+    ir = res.stdout
+    if library == "none":
+        assert "__svml_" not in ir and "_ZGV" not in ir, ir
+    elif platform.machine() in ("x86_64", "AMD64", "aarch64", "arm64"):
+        # libmvec is x86 only and SLEEF is AArch64 only, they are not used on
+        # other architectures, even if loaded.
+        is_x86 = platform.machine() in ("x86_64", "AMD64")
+        if (library == "sleef") != is_x86:
+            assert _vector_library_prefixes[library] in ir, ir
+
+
+_LAZY_PARALLEL_SCRIPT = """
+import numpy as np
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir.runtime import runtime_lib
+
+# TBB is initialized on the first use, but runtime functions must still take
+# their parallel paths before any parallel loop was run.
+assert runtime_lib.nmrtParallelIsInitialized()
+
+
+@njit
+def func(a):
+    return np.sort(a)
+
+
+a = np.random.rand(1 << 20)
+assert_equal(func(a), np.sort(a))
+assert runtime_lib.nmrtParallelIsInitialized()
+"""
+
+
+def test_lazy_parallel_init(tmp_path):
+    script = tmp_path / "lazy_parallel_script.py"
+    script.write_text(_LAZY_PARALLEL_SCRIPT)
+    res = subprocess.run([sys.executable, str(script)], capture_output=True, text=True)
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_STREAM_PARALLEL_SCRIPT = """
+import numba
+import numpy as np
+from numpy.testing import assert_allclose
+
+from numba_mlir import njit
+from numba_mlir.mlir.passes import print_pass_ir, get_print_buffer
+
+
+def outer_dim(a):
+    res = np.empty(a.shape[0])
+    for i in numba.prange(a.shape[0]):
+        s = 0.0
+        for j in range(a.shape[1]):
+            s += a[i, j]
+        res[i] = s
+    return res
+
+
+def inner_dim(a):
+    res = np.empty(a.shape[1])
+    for j in numba.prange(a.shape[1]):
+        s = 0.0
+        for i in range(a.shape[0]):
+            s += a[i, j]
+        res[j] = s
+    return res
+
+
+a = np.random.rand(300, 500)
+for py_func in (outer_dim, inner_dim):
+    with print_pass_ir([], ["StreamParallelLoopsPass"]):
+        jit_func = njit(parallel=True)(py_func)
+        assert_allclose(jit_func(a), py_func(a), rtol=1e-7)
+        ir = get_print_buffer()
+        assert "nmrtStreamPrefetch" in ir, ir
+
+    # Non-contiguous views stream with their actual strides.
+    assert_allclose(jit_func(a[::2, ::3]), py_func(a[::2, ::3]), rtol=1e-7)
+"""
+
+
+def test_stream_parallel_loops(tmp_path):
+    script = tmp_path / "stream_parallel_script.py"
+    script.write_text(_STREAM_PARALLEL_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_STREAM_CHUNK_SIZE"] = "4096"
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_SHARE_CALLEES_SCRIPT = """
+import math
+import threading
+
+import numpy as np
+from numpy.testing import assert_allclose
+
+from numba_mlir import njit
+from numba_mlir.mlir.passes import print_pass_ir, get_print_buffer
+
+
+def py_callee(a):
+    res = 0.0
+    for i in range(a.shape[0]):
+        x = a[i]
+        y = x * 1.5 + x * x * 2.5 - x / 3.5 + math.sqrt(abs(x) + 1.0)
+        z = math.exp(-x * x) * math.cos(x) + math.sin(y) / (1.0 + y * y)
+        res += y * z - math.log(1.0 + abs(z)) + (x - y) * (y - z) * (z - x)
+    return res
+
+
+callee = njit(py_callee)
+
+
+def make_caller(k):
+    def py_caller(a, b):
+        return callee(a) * k + callee(b)
+
+    return py_caller
+
+
+a = np.random.rand(100)
+b = np.random.rand(50)
+with print_pass_ir([], ["ExportSharedCalleesPass"]):
+    jit_caller = njit(make_caller(0))
+    assert_allclose(jit_caller(a, b), py_callee(a) * 0 + py_callee(b), rtol=1e-7)
+    ir = get_print_buffer()
+    assert "numba_shared." in ir, ir
+
+# Modules, compiled concurrently, link the callee from whichever got it first.
+errors = []
+
+
+def run(k):
+    try:
+        jit_caller = njit(make_caller(k))
+        expected = py_callee(a) * k + py_callee(b)
+        assert_allclose(jit_caller(a, b), expected, rtol=1e-7)
+    except Exception as e:
+        errors.append(e)
+
+
+threads = [threading.Thread(target=run, args=(k,)) for k in range(1, 9)]
+for t in threads:
+    t.start()
+for t in threads:
+    t.join()
+
+assert not errors, errors
+"""
+
+
+def test_share_callees(tmp_path):
+    script = tmp_path / "share_callees_script.py"
+    script.write_text(_SHARE_CALLEES_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_SHARE_CALLEES"] = "1"
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_MODULE_ENVS_SCRIPT = """
+import threading
+
+import numpy as np
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir_compiler import get_module_env_count
+
+
+def make_func(k):
+    def py_func(a):
+        return a * k + 1
+
+    return py_func
+
+
+a = np.arange(10)
+errors = []
+
+
+def run(k):
+    try:
+        assert_equal(njit(make_func(k))(a), a * k + 1)
+    except Exception as e:
+        errors.append(e)
+
+
+# Environments of finished threads are reused by the new ones.
+num_threads = 4
+for i in range(8):
+    threads = [
+        threading.Thread(target=run, args=(i * num_threads + k,))
+        for k in range(num_threads)
+    ]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+
+assert not errors, errors
+count = get_module_env_count()
+assert 0 < count <= 2 * num_threads, count
+"""
+
+
+def test_module_envs_reused(tmp_path):
+    script = tmp_path / "module_envs_script.py"
+    script.write_text(_MODULE_ENVS_SCRIPT)
+    res = subprocess.run([sys.executable, str(script)], capture_output=True, text=True)
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_MODULE_ENVS_RETIRED_SCRIPT = """
+import numpy as np
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir_compiler import (
+    get_module_env_count,
+    get_retired_module_env_count,
+)
+
+
+def make_func(k):
+    def py_func(a):
+        return a * k + 1
+
+    return py_func
+
+
+a = np.arange(10)
+for k in range(20):
+    assert_equal(njit(make_func(k))(a), a * k + 1)
+
+# Environment is recreated every 4 modules, instead of growing forever.
+assert get_retired_module_env_count() >= 4, get_retired_module_env_count()
+assert get_module_env_count() <= 2, get_module_env_count()
+"""
+
+
+def test_module_envs_retired(tmp_path):
+    script = tmp_path / "module_envs_retired_script.py"
+    script.write_text(_MODULE_ENVS_RETIRED_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_MODULE_ENV_MAX_USES"] = "4"
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_NONTEMPORAL_STORES_SCRIPT = """
+import numpy as np
+from numpy.testing import assert_allclose
+
+from numba_mlir import njit
+from numba_mlir.mlir.passes import print_pass_ir, get_print_buffer
+
+
+def py_func(a, b):
+    return a * b + 1
+
+
+with print_pass_ir([], ["NontemporalStoresPass"]):
+    jit_func = njit(py_func, parallel=True)
+
+    # Buffers below the threshold take the regular stores version.
+    for size in (10, 100000):
+        a = np.random.rand(size)
+        b = np.random.rand(size)
+        assert_allclose(jit_func(a, b), py_func(a, b), rtol=1e-7)
+
+    ir = get_print_buffer()
+    if THRESHOLD:
+        assert "nontemporal = true" in ir, ir
+        assert "llvm.fence" in ir, ir
+    else:
+        assert "nontemporal" not in ir, ir
+"""
+
+
+@pytest.mark.parametrize("threshold", [0, 4096])
+def test_nontemporal_stores(tmp_path, threshold):
+    script = tmp_path / "nontemporal_stores_script.py"
+    script.write_text(f"THRESHOLD = {threshold}\n" + _NONTEMPORAL_STORES_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_NONTEMPORAL_STORE_THRESHOLD"] = str(threshold)
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_FIRST_TOUCH_SCRIPT = """
+import os
+
+import numpy as np
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir.passes import print_pass_ir, get_print_buffer
+
+
+def py_func(n):
+    return np.arange(n) * 2
+
+
+with print_pass_ir([], ["LLVMLoweringPass"]):
+    jit_func = njit(py_func)
+    assert_equal(jit_func(1000000), py_func(1000000))
+    ir = get_print_buffer()
+
+if int(os.environ["NUMBA_MLIR_NUMA"]):
+    assert "nmrtParallelFirstTouch" in ir, ir
+else:
+    assert "nmrtParallelFirstTouch" not in ir, ir
+"""
+
+
+@pytest.mark.parametrize("numa", [0, 1])
+def test_numa_first_touch(tmp_path, numa):
+    script = tmp_path / "first_touch_script.py"
+    script.write_text(_FIRST_TOUCH_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_NUMA"] = str(numa)
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_ARENA_ALLOC_SCRIPT = """
+import threading
+
+import numpy as np
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir.passes import print_pass_ir, get_print_buffer
+
+
+def py_func(n):
+    t = np.empty(n)
+    for i in range(n):
+        t[i] = i * 0.5
+
+    s = 0.0
+    for i in range(n):
+        s += t[i]
+    return s
+
+
+with print_pass_ir([], ["ArenaAllocPass"]):
+    jit_func = njit(py_func)
+
+    # Larger sizes need new arena chunks, repeated calls reuse them.
+    for n in (0, 10, 1 << 18, 1 << 21, 10, 1 << 21):
+        assert_equal(jit_func(n), py_func(n))
+
+    ir = get_print_buffer()
+    if ENABLED:
+        assert "numba.arena_alloc" in ir, ir
+        assert "nmrtArenaSave" in ir, ir
+    else:
+        assert "nmrtArenaSave" not in ir, ir
+
+# Each thread has its own arena.
+errors = []
+
+
+def run():
+    try:
+        for n in (100, 1 << 20, 1000):
+            assert_equal(jit_func(n), py_func(n))
+    except Exception as e:
+        errors.append(e)
+
+
+threads = [threading.Thread(target=run) for _ in range(4)]
+for t in threads:
+    t.start()
+for t in threads:
+    t.join()
+
+assert not errors, errors
+"""
+
+
+@pytest.mark.parametrize("enabled", [0, 1])
+def test_arena_alloc(tmp_path, enabled):
+    script = tmp_path / "arena_alloc_script.py"
+    script.write_text(f"ENABLED = {enabled}\n" + _ARENA_ALLOC_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_ARENA_ALLOC"] = str(enabled)
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_ALLOC_POLICY_SCRIPT = """
+import gc
+
+import numpy as np
+from numpy.testing import assert_equal
+from numba.core.runtime import rtsys
+
+from numba_mlir import njit
+from numba_mlir.mlir.runtime import runtime_lib
+
+
+@njit
+def empty_func(n):
+    res = np.empty(n, dtype=np.int64)
+    for i in range(n):
+        res[i] = i
+    return res
+
+
+@njit
+def zeros_func(n):
+    return np.zeros(n, dtype=np.int64)
+
+
+# Size-class cache, malloc and huge pages paths, with cached blocks reuse.
+sizes = [1, 100, 1000, 1 << 15, 1 << 17, 1 << 19, 1 << 15, 1 << 19, 100]
+stats = rtsys.get_allocation_stats()
+for n in sizes:
+    a = empty_func(n)
+    assert_equal(a, np.arange(n))
+    assert a.ctypes.data % 32 == 0
+
+    # Reused blocks must be zeroed again.
+    z = zeros_func(n)
+    assert_equal(z, np.zeros(n))
+    del a, z
+
+gc.collect()
+new_stats = rtsys.get_allocation_stats()
+assert new_stats.alloc - stats.alloc == new_stats.free - stats.free, new_stats
+assert new_stats.mi_alloc - stats.mi_alloc == new_stats.mi_free - stats.mi_free
+
+runtime_lib.nmrtAllocPurgeCache()
+assert_equal(empty_func(100), np.arange(100))
+"""
+
+
+@pytest.mark.parametrize("policy", [0, 1])
+def test_alloc_policy(tmp_path, policy):
+    script = tmp_path / "alloc_policy_script.py"
+    script.write_text(_ALLOC_POLICY_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_NRT_STATS"] = "1"
+    env["NUMBA_MLIR_ALLOC_POLICY"] = str(policy)
+    # 1MB arrays and larger are mapped with huge pages.
+    env["NUMBA_MLIR_HUGE_PAGE_THRESHOLD"] = str(1 << 20)
+    env["NUMBA_MLIR_ALLOC_CACHE_SIZE"] = str(1 << 20)
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+def test_ir_cache(tmp_path):
+    cache_dir = tmp_path / "ir_cache"
+    env = {
+        "NUMBA_MLIR_IR_CACHE_DIR": str(cache_dir),
+        "NUMBA_MLIR_COMPILE_PROFILE": "1",
+    }
+
+    counts = _run_compile_mode_script(tmp_path, env)
+    assert counts.get("ir_cache_store", 0) > 0, counts
+    entries = list(cache_dir.glob("llvmcache-*.mlir"))
+    assert entries
+
+    # All modules are taken from the cache.
+    counts = _run_compile_mode_script(tmp_path, env)
+    assert counts.get("ir_cache_load", 0) > 0, counts
+    assert "ir_cache_store" not in counts, counts
+
+    # Corrupted entries fall back to the regular compilation and are rewritten.
+    for entry in entries:
+        entry.write_text("corrupted")
+
+    counts = _run_compile_mode_script(tmp_path, env)
+    assert counts.get("ir_cache_store", 0) > 0, counts
+    for entry in cache_dir.glob("llvmcache-*.mlir"):
+        assert entry.read_text() != "corrupted", entry
+
+
+def test_aot(tmp_path):
+    from numba_mlir.mlir.aot import compile_aot, load_aot
+
+    def py_func(a, b):
+        res = 0
+        for i in range(a):
+            res = res + i * b
+        return res
+
+    sigs = ["int64(int64, int64)", "float64(int64, float64)"]
+    compile_aot(py_func, sigs, str(tmp_path))
+    assert len(list(tmp_path.glob("*.o"))) == len(sigs)
+
+    jit_func = load_aot(py_func, sigs, str(tmp_path))
+    assert_equal(py_func(10, 3), jit_func(10, 3))
+    assert_equal(py_func(10, 1.5), jit_func(10, 1.5))
+
+
+@pytest.mark.skipif(
+    platform.machine() not in ("x86_64", "AMD64"), reason="x86 only"
+)
+def test_aot_variants(tmp_path):
+    from numba_mlir.mlir.aot import compile_aot, load_aot
+
+    def py_func(a):
+        return a * 2 + 1
+
+    sig = "float64(float64)"
+    variants = ["baseline", "avx2", "avx512"]
+    compile_aot(py_func, [sig], str(tmp_path), variants=variants)
+    assert len(list(tmp_path.glob("*.o"))) == len(variants)
+
+    jit_func = load_aot(py_func, [sig], str(tmp_path), variants=variants)
+    assert_equal(py_func(1.5), jit_func(1.5))
+
+
+def test_prange_nested_reduction():
+    def py_func(a, b):
+        res = 0
+        for i in numba.prange(a):
+            acc = 0
+            for j in numba.prange(b):
+                acc = acc + i * j
+            res = res + acc
+        return res
+
+    jit_func = njit(py_func, parallel=True)
+    assert_equal(py_func(257, 129), jit_func(257, 129))
+
+
 def test_func_call1():
     def py_func1(b):
         return b + 3
@@ -892,6 +2333,33 @@ def test_func_call2():
     assert_equal(py_func2(10), jit_func2(10))
 
 
+def test_inner_func_cache_limit(monkeypatch):
+    from collections import OrderedDict
+    from numba.core import types
+    import numba_mlir.mlir.inner_compiler as inner_compiler
+
+    monkeypatch.setattr(inner_compiler, "_typed_states_cache", OrderedDict())
+    monkeypatch.setattr(inner_compiler, "_typed_states_cache_size", 2)
+
+    def py_func(a):
+        return a + 1
+
+    def get_state(arg_type):
+        return inner_compiler._get_typed_state(
+            py_func, (arg_type,), inner_compiler.DEFAULT_FLAGS
+        )
+
+    state1 = get_state(types.int64)
+    state2 = get_state(types.float64)
+    assert get_state(types.int64) is state1
+
+    # Least recently used entry is evicted.
+    get_state(types.int32)
+    assert len(inner_compiler._typed_states_cache) == 2
+    assert get_state(types.int64) is state1
+    assert get_state(types.float64) is not state2
+
+
 def test_omitted_args_int():
     def py_func(a=3, b=7):
         return a + b
@@ -9,7 +9,10 @@ import numpy as np
 import math
 import numba
 import itertools
+import os
 import re
+import subprocess
+import sys
 
 from numba_mlir.mlir.dpctl_interop import get_default_device
 from numba_mlir.mlir.kernel_impl import Kernel
@@ -361,6 +364,42 @@ def test_empty_kernel():
         assert ir.count("gpu.launch blocks") == 0, ir
 
 
+@require_gpu
+def test_synchronize():
+    from numba_mlir.mlir.gpu_runtime import synchronize
+
+    def func(a, b, c):
+        i = get_global_id(0)
+        c[i] = a[i] + b[i]
+
+    sim_func = kernel_sim(func)
+    gpu_func = kernel_cached(func)
+
+    a = np.arange(16, dtype=np.float32)
+    b = np.arange(16, dtype=np.float32) * 2
+    sim_res = np.zeros(a.shape, a.dtype)
+    sim_func[a.shape, DEFAULT_LOCAL_SIZE](a, b, sim_res)
+
+    gpu_res = np.zeros(a.shape, a.dtype)
+    gpu_func[a.shape, DEFAULT_LOCAL_SIZE](a, b, gpu_res)
+    synchronize()
+    assert_equal(gpu_res, sim_res)
+
+
+@require_gpu
+@pytest.mark.parametrize("size", [17, (3 << 20) + 7])
+def test_copy(size):
+    from numba_mlir.mlir.gpu_runtime import copy
+
+    a = np.arange(size, dtype=np.float32)
+    da = _from_host(np.zeros_like(a), buffer="device")
+    copy(da, a)
+
+    res = np.zeros_like(a)
+    copy(res, da)
+    assert_equal(res, a)
+
+
 @require_gpu
 @require_f64
 def test_f64_truncate():
@@ -954,6 +993,116 @@ def test_atomics_different_dims():
     assert_equal(b_gpu, b_sim)
 
 
+def _test_atomic_ext(func, dtype, spirv_ops):
+    sim_func = kernel_sim(func)
+    gpu_func = kernel_cached(func)
+
+    a = np.array([5, 2, 7, 4, 1, 6, 3, 8, 9], dtype)
+
+    sim_res = np.full([2], 3, dtype)
+    sim_func[a.shape, DEFAULT_LOCAL_SIZE](a, sim_res)
+
+    gpu_res = np.full([2], 3, dtype)
+
+    with print_pass_ir([], ["GPUToSpirvPass"]):
+        gpu_func[a.shape, DEFAULT_LOCAL_SIZE](a, gpu_res)
+        ir = get_print_buffer()
+        assert any(ir.count(op) > 0 for op in spirv_ops), ir
+
+    assert_equal(gpu_res, sim_res)
+
+
+@require_gpu
+@pytest.mark.parametrize("dtype", _atomic_dtypes)
+@pytest.mark.parametrize(
+    "atomic_op, int_ops",
+    [
+        (atomic.min, ["spirv.AtomicSMin"]),
+        (atomic.max, ["spirv.AtomicSMax"]),
+    ],
+)
+def test_atomics_minmax(dtype, atomic_op, int_ops):
+    def func(a, b):
+        i = get_global_id(0)
+        atomic_op(b, i % 2, a[i])
+
+    # No native float min/max, lowered to compare-exchange loop.
+    is_int = np.issubdtype(np.dtype(dtype), np.integer)
+    ops = int_ops if is_int else ["spirv.AtomicCompareExchange"]
+    _test_atomic_ext(func, dtype, ops)
+
+
+@require_gpu
+@pytest.mark.parametrize("dtype", ["int32", "int64"])
+@pytest.mark.parametrize(
+    "atomic_op, spirv_op",
+    [
+        (atomic.and_, "spirv.AtomicAnd"),
+        (atomic.or_, "spirv.AtomicOr"),
+    ],
+)
+def test_atomics_bitwise(dtype, atomic_op, spirv_op):
+    def func(a, b):
+        i = get_global_id(0)
+        atomic_op(b, i % 2, a[i])
+
+    _test_atomic_ext(func, dtype, [spirv_op])
+
+
+@require_gpu
+@pytest.mark.parametrize("dtype", _atomic_dtypes)
+def test_atomics_xchg_ret(dtype):
+    atomic_op = atomic.xchg
+
+    def func(a, b, c):
+        i = get_global_id(0)
+        c[i] = atomic_op(b, 0, a[i])
+
+    sim_func = kernel_sim(func)
+    gpu_func = kernel_cached(func)
+
+    a = np.arange(1, 10, dtype=dtype)
+
+    sim_b = np.zeros([1], dtype)
+    sim_c = np.zeros_like(a)
+    sim_func[a.shape, DEFAULT_LOCAL_SIZE](a, sim_b, sim_c)
+
+    gpu_b = np.zeros([1], dtype)
+    gpu_c = np.zeros_like(a)
+    gpu_func[a.shape, DEFAULT_LOCAL_SIZE](a, gpu_b, gpu_c)
+
+    # Order is not defined, but all values must be exchanged exactly once.
+    values = np.sort(np.concatenate((gpu_b, gpu_c)))
+    assert_equal(values, np.sort(np.concatenate((sim_b, sim_c))))
+
+
+@require_gpu
+@pytest.mark.parametrize("dtype", _atomic_dtypes)
+def test_atomics_cas(dtype):
+    atomic_op = atomic.cas
+
+    def func(a, b):
+        i = get_global_id(0)
+        atomic_op(b, 0, 0, a[i])
+
+    sim_func = kernel_sim(func)
+    gpu_func = kernel_cached(func)
+
+    a = np.arange(1, 10, dtype=dtype)
+    sim_res = np.zeros([1], dtype)
+    sim_func[a.shape, DEFAULT_LOCAL_SIZE](a, sim_res)
+
+    gpu_res = np.zeros([1], dtype)
+    with print_pass_ir([], ["GPUToSpirvPass"]):
+        gpu_func[a.shape, DEFAULT_LOCAL_SIZE](a, gpu_res)
+        ir = get_print_buffer()
+        assert ir.count("spirv.AtomicCompareExchange") == 1, ir
+
+    # Only the first thread succeeds, result depends on scheduling.
+    assert gpu_res[0] in a
+    assert sim_res[0] == a[0]
+
+
 @pytest.mark.skip(reason="Fails on CI, investigate")
 @require_gpu
 @pytest.mark.parametrize(
@@ -1393,6 +1542,65 @@ def test_group_func(group_op, global_size, local_size, dtype):
     assert_allclose(gpu_res, sim_res, rtol=1e-5)
 
 
+@require_gpu
+@pytest.mark.parametrize(
+    "group_op",
+    [
+        group.inclusive_scan_add,
+        group.exclusive_scan_add,
+        group.inclusive_scan_max,
+        group.exclusive_scan_min,
+    ],
+)
+@pytest.mark.parametrize("global_size", [1, 2, 27, 67])
+@pytest.mark.parametrize("local_size", [1, 7, 33])
+@pytest.mark.parametrize("dtype", [np.int32, np.float32])
+def test_group_scan(group_op, global_size, local_size, dtype):
+    def func(a, b):
+        i = get_global_id(0)
+        b[i] = group_op(a[i])
+
+    sim_func = kernel_sim(func)
+    gpu_func = kernel_cached(func)
+
+    global_size = (global_size + local_size - 1) // local_size * local_size
+    a = np.arange(global_size, dtype=dtype)[::-1].copy()
+
+    sim_res = np.zeros(global_size, a.dtype)
+    sim_func[(global_size,), (local_size,)](a, sim_res)
+
+    gpu_res = np.zeros(global_size, a.dtype)
+
+    with print_pass_ir([], ["ConvertParallelLoopToGpu"]):
+        gpu_func[(global_size,), (local_size,)](a, gpu_res)
+        ir = get_print_buffer()
+        assert ir.count("gpu.launch blocks") == 1, ir
+
+    assert_allclose(gpu_res, sim_res, rtol=1e-5)
+
+
+@require_gpu
+@pytest.mark.parametrize("global_size", [16, 64, 128])
+def test_subgroup_func(global_size):
+    def func(a, b, c):
+        i = get_global_id(0)
+        a[i] = subgroup.inclusive_scan_add(1) - subgroup.get_local_id()
+        b[i] = subgroup.broadcast(i, 0) + subgroup.get_local_id()
+        c[i] = subgroup.reduce_add(1) - subgroup.get_size()
+
+    gpu_func = kernel_cached(func)
+
+    a = np.zeros(global_size, np.int64)
+    b = np.zeros(global_size, np.int64)
+    c = np.zeros(global_size, np.int64)
+    gpu_func[(global_size,), (global_size,)](a, b, c)
+
+    # Results are independent from the device subgroup size.
+    assert_equal(a, np.ones(global_size, np.int64))
+    assert_equal(b, np.arange(global_size, dtype=np.int64))
+    assert_equal(c, np.zeros(global_size, np.int64))
+
+
 @require_gpu
 def test_pairwise1():
     def func(X1, X2, D):
@@ -1551,6 +1759,118 @@ def test_parfor_simple1():
     assert_equal(gpu_res, sim_res)
 
 
+@require_gpu
+def test_parfor_caller_queue():
+    import dpctl
+    import dpctl.tensor as dpt
+    from numba_mlir.mlir.dpctl_interop import _sycl_queue_info_cache
+
+    def py_func(a, b, c):
+        for i in numba.prange(len(a)):
+            c[i] = a[i] + b[i]
+
+    gpu_func = njit(py_func)
+
+    a = np.arange(1024, dtype=np.float32)
+    b = np.arange(1024, dtype=np.float32) * 3
+    res = np.zeros(a.shape, a.dtype)
+    py_func(a, b, res)
+
+    queue = dpctl.SyclQueue(_def_device)
+    da = dpt.asarray(a, sycl_queue=queue)
+    db = dpt.asarray(b, sycl_queue=queue)
+    for _ in range(3):
+        dgpu_res = dpt.zeros(a.shape, dtype=a.dtype, sycl_queue=queue)
+        gpu_func(da, db, dgpu_res)
+        assert_equal(dpt.asnumpy(dgpu_res), res)
+
+    # Queue device info is cached by the queue address.
+    assert queue.addressof_ref() in _sycl_queue_info_cache
+
+
+@require_gpu
+def test_parfor_caller_queue_switch():
+    import dpctl
+    import dpctl.tensor as dpt
+    from numba_mlir.mlir.dpctl_interop import _registered_sycl_queues
+
+    def py_func(a, b, c):
+        for i in numba.prange(len(a)):
+            c[i] = a[i] + b[i]
+
+    gpu_func = njit(py_func)
+
+    a = np.arange(1024, dtype=np.float32)
+    b = np.arange(1024, dtype=np.float32) * 3
+    res = np.zeros(a.shape, a.dtype)
+    py_func(a, b, res)
+
+    # Different queues on the same device, second and later calls take the
+    # cached argument types path.
+    queues = [dpctl.SyclQueue(_def_device) for _ in range(2)]
+    for _ in range(2):
+        for queue in queues:
+            da = dpt.asarray(a, sycl_queue=queue)
+            db = dpt.asarray(b, sycl_queue=queue)
+            dgpu_res = dpt.zeros(a.shape, dtype=a.dtype, sycl_queue=queue)
+            gpu_func(da, db, dgpu_res)
+            assert_equal(dpt.asnumpy(dgpu_res), res)
+
+            filter_string = queue.sycl_device.filter_string
+            registered = _registered_sycl_queues[filter_string]
+            assert registered.addressof_ref() == queue.addressof_ref()
+
+
+@require_gpu
+def test_invalidate_device_caps(monkeypatch):
+    import dpctl.tensor as dpt
+    from numba_mlir.mlir import dpctl_interop
+
+    # Count capabilities queries from the compiler.
+    calls = []
+    base_type = dpctl_interop.USMNdArrayBaseType
+    orig_get_device_caps = base_type.get_device_caps
+
+    def get_device_caps(self):
+        calls.append(self)
+        return orig_get_device_caps(self)
+
+    monkeypatch.setattr(base_type, "get_device_caps", get_device_caps)
+    dpctl_interop.invalidate_device_caps()
+
+    def py_func(a, b, c):
+        for i in numba.prange(len(a)):
+            c[i] = a[i] + b[i]
+
+    a = np.arange(1024, dtype=np.float32)
+    b = np.arange(1024, dtype=np.float32) * 3
+    res = np.zeros(a.shape, a.dtype)
+    py_func(a, b, res)
+
+    da = dpt.asarray(a, device=_def_device)
+    db = dpt.asarray(b, device=_def_device)
+
+    def check():
+        # New function each time, so capabilities are requested again.
+        gpu_func = njit_wrapper(py_func)
+        dgpu_res = dpt.zeros(a.shape, dtype=a.dtype, device=_def_device)
+        with print_pass_ir([], ["ConvertParallelLoopToGpu"]):
+            gpu_func(da, db, dgpu_res)
+            ir = get_print_buffer()
+            _check_filter_string(dgpu_res, ir)
+
+        assert_equal(dpt.asnumpy(dgpu_res), res)
+
+    # All arrays are on the same device, it is queried only once.
+    check()
+    check()
+    assert len(calls) == 1, calls
+
+    dpctl_interop.invalidate_device_caps()
+    check()
+    assert len(calls) == 2, calls
+
+
 @require_gpu
 @pytest.mark.parametrize("val", _test_values)
 def test_parfor_scalar(val):
@@ -1582,6 +1902,160 @@ def test_parfor_scalar(val):
     assert_equal(gpu_res, sim_res)
 
 
+@require_gpu
+def test_parfor_split_devices():
+    def py_func(a, b, c):
+        for i in numba.prange(len(a)):
+            c[i] = a[i] + b[i]
+
+    a = np.arange(1023, dtype=np.float32)
+    b = np.arange(1023, dtype=np.float32) * 3
+
+    sim_res = np.zeros(a.shape, a.dtype)
+    py_func(a, b, sim_res)
+
+    da = _from_host(a, buffer="shared")
+    db = _from_host(b, buffer="shared")
+
+    gpu_res = np.zeros(a.shape, a.dtype)
+    dgpu_res = _from_host(gpu_res, buffer="shared")
+
+    # Split across the same device twice, so test doesn't need multiple GPUs.
+    device = dgpu_res.device.sycl_device.filter_string
+    gpu_func = njit(py_func, gpu_devices=[device, device])
+
+    with print_pass_ir([], ["ConvertParallelLoopToGpu"]):
+        gpu_func(da, db, dgpu_res)
+        ir = get_print_buffer()
+        assert ir.count("gpu.launch blocks") == 2, ir
+        assert ir.count("gpu_runtime.concurrent_begin") == 1, ir
+
+    _to_host(dgpu_res, gpu_res)
+    assert_equal(gpu_res, sim_res)
+
+
+@require_gpu
+def test_parfor_coexec():
+    def py_func(a, b, c):
+        for i in numba.prange(len(a)):
+            c[i] = a[i] + b[i]
+
+    a = np.arange(1023, dtype=np.float32)
+    b = np.arange(1023, dtype=np.float32) * 3
+
+    sim_res = np.zeros(a.shape, a.dtype)
+    py_func(a, b, sim_res)
+
+    da = _from_host(a, buffer="shared")
+    db = _from_host(b, buffer="shared")
+
+    device = da.device.sycl_device.filter_string
+    gpu_func = njit(py_func, gpu_devices=["host", device])
+
+    with print_pass_ir([], ["ConvertParallelLoopToGpu"]):
+        gpu_res = np.zeros(a.shape, a.dtype)
+        dgpu_res = _from_host(gpu_res, buffer="shared")
+        gpu_func(da, db, dgpu_res)
+        ir = get_print_buffer()
+        assert ir.count("gpu_runtime.coexec_begin") == 1, ir
+
+    _to_host(dgpu_res, gpu_res)
+    assert_equal(gpu_res, sim_res)
+
+    # Host share is updated between calls.
+    for _ in range(3):
+        gpu_res = np.zeros(a.shape, a.dtype)
+        dgpu_res = _from_host(gpu_res, buffer="shared")
+        gpu_func(da, db, dgpu_res)
+        _to_host(dgpu_res, gpu_res)
+        assert_equal(gpu_res, sim_res)
+
+
+_COEXEC_RATIO_SCRIPT = """
+import ctypes
+import sys
+import time
+
+import numba
+import numpy as np
+import dpctl.tensor as dpt
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir.gpu_runtime import runtime_lib
+
+begin = runtime_lib.gpuxCoexecBegin
+begin.argtypes = [ctypes.c_void_p]
+begin.restype = ctypes.c_double
+end = runtime_lib.gpuxCoexecEnd
+
+fixed = float(sys.argv[1]) if len(sys.argv) > 1 else None
+
+# Unbalanced end, without the section, is ignored.
+end()
+
+keys = [ctypes.c_int(0), ctypes.c_int(0)]
+key = ctypes.addressof(keys[0])
+other = ctypes.addressof(keys[1])
+
+ratios = []
+for _ in range(20):
+    ratios.append(begin(key))
+    # No device work, device is idle while host is running.
+    time.sleep(0.01)
+    end()
+
+if fixed is None:
+    assert ratios[0] == 0.5, ratios
+    # Host share goes down until it hits the lower bound.
+    for prev, cur in zip(ratios, ratios[1:]):
+        assert cur <= prev, ratios
+    assert ratios[1] < ratios[0], ratios
+    assert ratios[-1] == 1 / 64, ratios
+    # Sections are adapted independently.
+    assert begin(other) == 0.5
+    end()
+else:
+    expected = min(max(fixed, 0.0), 1.0)
+    assert all(r == expected for r in ratios), ratios
+    assert begin(other) == expected
+    end()
+
+
+@njit(gpu_devices=["host", dpt.zeros(1).device.sycl_device.filter_string])
+def func(a, b, c):
+    for i in numba.prange(len(a)):
+        c[i] = a[i] + b[i]
+
+
+size = 1023
+a = np.arange(size, dtype=np.float32)
+b = np.arange(size, dtype=np.float32) * 3
+da = dpt.asarray(a, usm_type="shared")
+db = dpt.asarray(b, usm_type="shared")
+for _ in range(8):
+    dc = dpt.zeros(size, dtype=np.float32, usm_type="shared")
+    func(da, db, dc)
+    assert_equal(dpt.asnumpy(dc), a + b)
+"""
+
+
+@require_gpu
+@pytest.mark.parametrize("ratio", [None, "0", "0.25", "1", "2"])
+def test_parfor_coexec_ratio(tmp_path, ratio):
+    script = tmp_path / "coexec_ratio_script.py"
+    script.write_text(_COEXEC_RATIO_SCRIPT)
+    env = os.environ.copy()
+    args = [sys.executable, str(script)]
+    env.pop("NUMBA_MLIR_GPU_COEXEC_RATIO", None)
+    if ratio is not None:
+        env["NUMBA_MLIR_GPU_COEXEC_RATIO"] = ratio
+        args.append(ratio)
+
+    res = subprocess.run(args, capture_output=True, text=True, env=env)
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
 @require_gpu
 @pytest.mark.parametrize("val", _test_values)
 def test_parfor_scalar_capture(val):
@@ -1858,6 +2332,74 @@ def test_cfd_use_64bit_index_prange():
     assert_equal(da64_host, da32_host)
 
 
+@require_gpu
+def test_cfd_use_64bit_index_prange_auto():
+    def py_func(a):
+        ah, aw = a.shape
+
+        for h in numba.prange(ah):
+            for w in numba.prange(aw):
+                a[h, w] = w + h * aw
+
+    jit_func = njit(py_func, gpu_use_64bit_index="auto")
+
+    a = np.zeros((6, 8), dtype=np.float32)
+    da = _from_host(a, buffer="device")
+    da_host = np.zeros_like(a)
+
+    with print_pass_ir([], ["GpuIndexVariantsPass"]):
+        jit_func(da)
+        ir = get_print_buffer()
+        assert ir.count("gpu.launch_func") == 2, ir
+        assert re.search("gpu.module @[0-9a-zA-Z_]+_i32", ir), ir
+
+    py_func(a)
+    _to_host(da, da_host)
+    assert_equal(da_host, a)
+
+
+@require_gpu
+@pytest.mark.parametrize("size", [16, 19])
+def test_coarsen_elementwise(monkeypatch, size):
+    import numba_mlir.mlir.passes
+
+    monkeypatch.setattr(numba_mlir.mlir.passes, "GPU_VECTOR_BITWIDTH", 128)
+
+    def py_func(a, b):
+        for i in numba.prange(a.shape[0]):
+            b[i] = a[i] * 2 + 1
+
+    jit_func = njit(py_func)
+
+    a = np.arange(size, dtype=np.float32)
+    b = np.zeros_like(a)
+    da = _from_host(a, buffer="device")
+    db = _from_host(b, buffer="device")
+
+    with print_pass_ir([], ["GpuCoarsenLoopsPass"]):
+        jit_func(da, db)
+        ir = get_print_buffer()
+        # 128 bits of f32 give 4 elements per iteration: the full chunk is
+        # unrolled without bounds checks, the tail is a guarded scf.for.
+        assert ir.count("arith.constant 4 : index") > 0, ir
+        assert ir.count("arith.ceildivsi") == 1, ir
+        match = re.search(
+            r"arith\.cmpi sle.*?scf\.if (.*?)\} else \{(.*?)\n\s*\}", ir, re.S
+        )
+        assert match, ir
+        full, tail = match.groups()
+        assert full.count("memref.load") == 4, ir
+        assert full.count("memref.store") == 4, ir
+        assert "scf.for" not in full, ir
+        assert tail.count("scf.for") == 1, ir
+        assert tail.count("memref.store") == 1, ir
+
+    py_func(a, b)
+    db_host = np.zeros_like(b)
+    _to_host(db, db_host)
+    assert_equal(db_host, b)
+
+
 @require_gpu
 def test_cfd_use_64bit_index_kernel():
     def py_func(a):
@@ -2193,6 +2735,84 @@ def test_internal_gemm(a, b, c, alpha, beta):
     assert_equal(py_c, cc)
 
 
+def _spd_matrix(n, dtype):
+    a = np.arange(n * n, dtype=dtype).reshape(n, n) / (n * n)
+    return (np.dot(a, a.T) + np.eye(n) * n).astype(dtype)
+
+
+@require_gpu
+@pytest.mark.parametrize("n", [1, 4, 17])
+@pytest.mark.parametrize("func", ["inv", "cholesky", "eigvalsh"])
+def test_linalg_device(n, func):
+    func = eval("np.linalg." + func)
+
+    def py_func(a, res):
+        res[:] = func(a)
+
+    jit_func = njit(py_func)
+
+    a = _spd_matrix(n, np.float32)
+    expected = func(a)
+    res = np.zeros_like(expected)
+
+    da = _from_host(a, buffer="device")
+    dres = _from_host(res, buffer="device")
+
+    jit_func(da, dres)
+
+    _to_host(dres, res)
+    np.testing.assert_allclose(res, expected, rtol=1e-4, atol=1e-4)
+
+
+@require_gpu
+@pytest.mark.parametrize("n", [1, 4, 17])
+def test_linalg_solve_device(n):
+    def py_func(a, b, res):
+        res[:] = np.linalg.solve(a, b)
+
+    jit_func = njit(py_func)
+
+    a = _spd_matrix(n, np.float32)
+    b = np.arange(n * 3, dtype=np.float32).reshape(n, 3)
+    expected = np.linalg.solve(a, b)
+    res = np.zeros_like(expected)
+
+    da = _from_host(a, buffer="device")
+    db = _from_host(b, buffer="device")
+    dres = _from_host(res, buffer="device")
+
+    jit_func(da, db, dres)
+
+    _to_host(dres, res)
+    np.testing.assert_allclose(res, expected, rtol=1e-4, atol=1e-4)
+
+
+@require_gpu
+@pytest.mark.parametrize("size", [1, 17, 1000])
+@pytest.mark.parametrize("step", [1, 2])
+@pytest.mark.parametrize("func", ["sort", "argsort"])
+def test_sort_device(size, step, func):
+    func = eval("np." + func)
+
+    def py_func(a, res):
+        res[:] = func(a[::step])
+
+    jit_func = njit(py_func)
+
+    # Repeated keys, argsort must order them by index.
+    a = ((np.arange(size) * 7919) % 13).astype(np.float32)
+    expected = func(a[::step], kind="stable")
+    res = np.zeros_like(expected)
+
+    da = _from_host(a, buffer="device")
+    dres = _from_host(res, buffer="device")
+
+    jit_func(da, dres)
+
+    _to_host(dres, res)
+    assert_equal(res, expected)
+
+
 @pytest.mark.smoke
 @require_gpu
 def test_l2_norm():
@@ -2281,3 +2901,394 @@ def test_sycl_id_fit_in_int():
     func[2**31 + 1,](gpu_arr, b)
     _to_host(gpu_arr, arr)
     assert arr[0] == b
+
+
+@pytest.mark.parametrize("global_size", [1, 7, 64, 101])
+@pytest.mark.parametrize("local_size", [1, 8, 17])
+def test_host_kernel_barrier(global_size, local_size):
+    local_array = local.array
+
+    def func(a, b):
+        lm = local_array(shape=32, dtype=np.int64)
+        i = get_global_id(0)
+        j = get_local_id(0)
+        lm[j] = a[i]
+        barrier(LOCAL_MEM_FENCE)
+        b[i] = lm[get_local_size(0) - 1 - j] + group.reduce_add(a[i])
+
+    sim_func = kernel_sim(func)
+    host_func = Kernel(func, {})
+
+    global_size = (global_size + local_size - 1) // local_size * local_size
+    a = np.arange(global_size, dtype=np.int64)
+
+    sim_res = np.zeros(global_size, a.dtype)
+    sim_func[global_size, local_size](a, sim_res)
+
+    host_res = np.zeros(global_size, a.dtype)
+    host_func[global_size, local_size](a, host_res)
+
+    assert_equal(host_res, sim_res)
+
+
+@pytest.mark.parametrize(
+    "group_op", [group.inclusive_scan_add, group.exclusive_scan_max]
+)
+@pytest.mark.parametrize("local_size", [1, 8, 17])
+def test_host_kernel_group_scan(group_op, local_size):
+    def func(a, b, c):
+        i = get_global_id(0)
+        b[i] = group_op(a[i])
+        c[i] = subgroup.reduce_add(a[i]) + subgroup.get_size()
+
+    sim_func = kernel_sim(func)
+    host_func = Kernel(func, {})
+
+    global_size = local_size * 3
+    a = np.arange(global_size, dtype=np.int64)[::-1].copy()
+
+    host_b = np.zeros(global_size, a.dtype)
+    host_c = np.zeros(global_size, a.dtype)
+    host_func[global_size, local_size](a, host_b, host_c)
+
+    sim_b = np.zeros(global_size, a.dtype)
+    sim_c = np.zeros(global_size, a.dtype)
+    sim_func[global_size, local_size](a, sim_b, sim_c)
+
+    assert_equal(host_b, sim_b)
+    # Host subgroups consist of a single work item.
+    assert_equal(host_c, a + 1)
+
+
+def test_host_kernel_def_local_size():
+    def func(a, b):
+        i = get_global_id(0)
+        b[i] = a[i] * 2
+
+    host_func = Kernel(func, {})
+
+    a = np.arange(1000, dtype=np.float32)
+    res = np.zeros_like(a)
+    host_func[a.shape, DEFAULT_LOCAL_SIZE](a, res)
+
+    assert_equal(res, a * 2)
+
+
+_SPEC_CONSTANTS_SCRIPT = """
+import numba
+import numpy as np
+import dpctl.tensor as dpt
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir.passes import print_pass_ir, get_print_buffer
+
+
+def py_func(a, b):
+    for i in numba.prange(a.shape[0]):
+        b[i] = a[i] * 2 + i
+
+
+jit_func = njit(py_func)
+
+with print_pass_ir([], ["GPUToSpirvPass"]):
+    a = np.arange(64, dtype=np.int32)
+    b = np.zeros_like(a)
+    da = dpt.asarray(a)
+    db = dpt.zeros(a.shape, dtype=a.dtype)
+    jit_func(da, db)
+    py_func(a, b)
+    assert_equal(dpt.asnumpy(db), b)
+
+    ir = get_print_buffer()
+    assert "__nmspecset." in ir, ir
+
+# Repeated launches switch to the variants, once they are built in
+# background, zero offsets of the full arrays and non-zero offsets of the
+# slices are specialized separately.
+for _ in range(50):
+    for size in (64, 100, 1000):
+        a = np.arange(size + 1, dtype=np.int32)
+        for start in (0, 1):
+            b = np.zeros(size, dtype=np.int32)
+            da = dpt.asarray(a)[start : start + size]
+            db = dpt.zeros(size, dtype=a.dtype)
+            jit_func(da, db)
+            py_func(a[start : start + size], b)
+            assert_equal(dpt.asnumpy(db), b)
+"""
+
+
+@require_gpu
+def test_spec_constants(tmp_path):
+    script = tmp_path / "spec_constants_script.py"
+    script.write_text(_SPEC_CONSTANTS_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_GPU_SPEC_CONSTANTS"] = "1"
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_DEFERRED_SYNC_SCRIPT = """
+import numba
+import numpy as np
+import dpctl.tensor as dpt
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir.gpu_runtime import synchronize
+
+
+def py_func1(a, b):
+    for i in numba.prange(a.shape[0]):
+        b[i] = a[i] * 2
+
+
+def py_func2(a, b):
+    for i in numba.prange(a.shape[0]):
+        b[i] = b[i] + a[i]
+
+
+jit_func1 = njit(py_func1)
+jit_func2 = njit(py_func2)
+
+a = np.arange(1024, dtype=np.float32)
+b = np.zeros_like(a)
+py_func1(a, b)
+for _ in range(10):
+    py_func2(a, b)
+
+# Device only launches are not waited, each stage depends on the previous one.
+da = dpt.asarray(a, usm_type="device")
+db = dpt.zeros(a.shape, dtype=a.dtype, usm_type="device")
+jit_func1(da, db)
+for _ in range(10):
+    jit_func2(da, db)
+
+synchronize()
+assert_equal(dpt.asnumpy(db), b)
+
+# Shared memory launches still wait immediately.
+sa = dpt.asarray(a, usm_type="shared")
+sb = dpt.zeros(a.shape, dtype=a.dtype, usm_type="shared")
+jit_func1(sa, sb)
+assert_equal(dpt.asnumpy(sb), a * 2)
+"""
+
+
+@require_gpu
+def test_deferred_sync_device_usm(tmp_path):
+    script = tmp_path / "deferred_sync_script.py"
+    script.write_text(_DEFERRED_SYNC_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_GPU_DEFERRED_SYNC"] = "1"
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+_BLOCK_SIZE_TUNING_SCRIPT = """
+import numba
+import numpy as np
+import dpctl.tensor as dpt
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+
+
+def py_func1(a, b):
+    for i in numba.prange(a.shape[0]):
+        b[i] = a[i] * 2 + i
+
+
+def py_func2(a, b):
+    for i in numba.prange(a.shape[0]):
+        for j in numba.prange(a.shape[1]):
+            b[i, j] = a[i, j] + i * j
+
+
+jit_func1 = njit(py_func1)
+jit_func2 = njit(py_func2)
+
+# Repeated launches with the same grid reuse cached (and tuned) block sizes,
+# different grids are tuned separately.
+for _ in range(20):
+    for shape in [(1000,), (4096,), (37, 53), (64, 256)]:
+        py_func = py_func1 if len(shape) == 1 else py_func2
+        jit_func = jit_func1 if len(shape) == 1 else jit_func2
+        a = np.arange(np.prod(shape), dtype=np.int32).reshape(shape)
+        b = np.zeros_like(a)
+        py_func(a, b)
+
+        da = dpt.asarray(a)
+        db = dpt.zeros(shape, dtype=a.dtype)
+        jit_func(da, db)
+        assert_equal(dpt.asnumpy(db), b)
+"""
+
+
+@require_gpu
+@pytest.mark.parametrize("tuning", ["0", "1"])
+def test_block_size_tuning(tmp_path, tuning):
+    script = tmp_path / "block_size_tuning_script.py"
+    script.write_text(_BLOCK_SIZE_TUNING_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_GPU_BLOCK_SIZE_TUNING"] = tuning
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+@require_gpu
+@pytest.mark.parametrize(
+    "view",
+    [
+        lambda a: a,
+        lambda a: a[1:-1],
+        lambda a: a[:, 2:],
+        lambda a: a[1:4, 3:7],
+        lambda a: a[::2, ::3],
+        lambda a: a[::-1, ::-1],
+        lambda a: a.T,
+    ],
+)
+def test_usm_ndarray_views(view):
+    def py_func(a, b):
+        for i in numba.prange(a.shape[0]):
+            for j in numba.prange(a.shape[1]):
+                b[i, j] = a[i, j] * 2 + 1
+
+    jit_func = njit(py_func)
+
+    # Offsets, shapes and strides of the views are read from the dpctl arrays
+    # directly.
+    a = np.arange(6 * 8, dtype=np.int32).reshape(6, 8)
+    b = np.zeros_like(view(a))
+    py_func(view(a), b)
+
+    da = view(_from_host(a, buffer="device"))
+    db = dpt.zeros(da.shape, dtype=a.dtype, device=_def_device)
+    jit_func(da, db)
+    assert_equal(dpt.asnumpy(db), b)
+
+
+@require_gpu
+def test_usm_ndarray_typeof_cache():
+    from numba_mlir.mlir.target import _argument_typeof_fast
+    from numba_mlir.mlir.dpctl_interop import _usm_ndarray_type_cache
+
+    typeof_fast = _argument_typeof_fast[dpt.usm_ndarray]
+
+    a = dpt.zeros((4, 5), dtype=np.float32, device=_def_device)
+    b = dpt.ones((6, 7), dtype=np.float32, device=_def_device)
+    c = dpt.zeros((4, 5), dtype=np.float32, device=_def_device, order="F")
+    d = dpt.zeros((4, 5), dtype=np.int32, device=_def_device)
+    e = dpt.zeros((4, 5), dtype=np.float32, device=_def_device, usm_type="shared")
+
+    _usm_ndarray_type_cache.clear()
+    ta = typeof_fast(a)
+    assert typeof_fast(a) is ta
+    assert typeof_fast(b) is ta
+    assert len(_usm_ndarray_type_cache) == 1
+
+    tc = typeof_fast(c)
+    td = typeof_fast(d)
+    te = typeof_fast(e)
+    assert tc.layout == "F" and ta.layout == "C"
+    assert len({id(ta), id(tc), id(td), id(te)}) == 4
+    assert len(_usm_ndarray_type_cache) == 4
+
+    def py_func(a, b):
+        for i in numba.prange(a.shape[0]):
+            for j in numba.prange(a.shape[1]):
+                b[i, j] = a[i, j] + 1
+
+    jit_func = njit(py_func)
+
+    src = np.arange(4 * 5, dtype=np.float32).reshape(4, 5)
+    for order in ("C", "F"):
+        host = np.asarray(src, order=order)
+        expected = np.zeros_like(host)
+        py_func(host, expected)
+
+        da = dpt.asarray(host, device=_def_device, order=order)
+        db = dpt.zeros(da.shape, dtype=da.dtype, device=_def_device, order=order)
+        jit_func(da, db)
+        assert_equal(dpt.asnumpy(db), expected)
+
+    assert len(jit_func.overloads) == 2
+
+
+_KERNELS_PROFILE_SCRIPT = """
+import numba
+import numpy as np
+import dpctl.tensor as dpt
+from numpy.testing import assert_equal
+
+from numba_mlir import njit
+from numba_mlir.mlir.gpu_runtime import get_kernels_profile, reset_kernels_profile
+
+
+@njit
+def func(a, b):
+    for i in numba.prange(a.shape[0]):
+        b[i] = a[i] + 1
+
+
+a = dpt.arange(1024, dtype=np.int32)
+b = dpt.zeros(1024, dtype=np.int32)
+reset_kernels_profile()
+for _ in range(3):
+    func(a, b)
+
+assert_equal(dpt.asnumpy(b), np.arange(1024) + 1)
+
+profile = get_kernels_profile()
+assert profile
+for stats in profile.values():
+    assert stats["calls"] == 3, profile
+    assert 0 < stats["mean"] <= stats["p99"] <= stats["device_time"], profile
+
+reset_kernels_profile()
+assert get_kernels_profile() == {}
+"""
+
+
+@require_gpu
+def test_kernels_profile(tmp_path):
+    script = tmp_path / "kernels_profile_script.py"
+    script.write_text(_KERNELS_PROFILE_SCRIPT)
+    env = os.environ.copy()
+    env["NUMBA_MLIR_GPU_PROFILE"] = "1"
+    res = subprocess.run(
+        [sys.executable, str(script)], capture_output=True, text=True, env=env
+    )
+    assert res.returncode == 0, res.stdout + res.stderr
+
+
+@require_gpu
+@pytest.mark.parametrize("size", [100000, 1000003])
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda a: np.cumsum(a)",
+        "lambda a: np.cumprod(a)",
+    ],
+)
+def test_scan_parallel(py_func, size):
+    # Values are close to 1, so the product doesn't overflow.
+    a = 1 + (np.arange(size, dtype=np.float32) % 7 - 3) * 1e-6
+    jit_func = njit(py_func)
+
+    da = _from_host(a, buffer="shared")
+    with print_pass_ir([], ["ConvertParallelLoopToGpu"]):
+        res = jit_func(da)
+        ir = get_print_buffer()
+        # Block scan and block offsets application kernels.
+        assert ir.count("gpu.launch blocks") >= 2, ir
+
+    assert_allclose(dpt.asnumpy(res), py_func(a), rtol=1e-3)
@@ -679,6 +679,33 @@ def test_replace_parfor_prange():
         assert len(ir) > 0  # Check some code was actually generated
 
 
+def test_replace_parfor_no_rediscovery():
+    def py_func(a, b, c):
+        for i in numba.prange(len(c)):
+            c[i] = a[i] + b[i]
+
+    n = 10
+    a = np.arange(n, dtype=np.float32) * 2
+    b = np.arange(n, dtype=np.float32)
+    c1 = np.zeros(n, dtype=np.float32)
+    c2 = np.zeros_like(c1)
+
+    jit_func = njit_replace_parfors(py_func, parallel=True)
+    with print_pass_ir([], ["VersionAliasingLoopsPass"]):
+        py_func(a, b, c1)
+        jit_func(a, b, c2)
+        assert_equal(c1, c2)
+        ir = get_print_buffer()
+        # Only the loops, coming from parfors, are tagged, not the function.
+        assert ir.count("} {numba.parfor_lowered}") > 0, ir
+        assert not any(
+            "func.func" in line and "numba.parfor_lowered" in line
+            for line in ir.splitlines()
+        ), ir
+        # Numba already checked loop for races, no runtime overlap checks.
+        assert ir.count("scf.if") == 0, ir
+
+
 def test_replace_parfor_2prange():
     def py_func(a, b, c, d):
         for i in numba.prange(n):
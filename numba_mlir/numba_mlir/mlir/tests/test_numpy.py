@@ -7,10 +7,12 @@ import numba
 from numba_mlir import njit as orig_njit
 from numba_mlir import vectorize
 from numba_mlir.mlir.passes import print_pass_ir, get_print_buffer
+from numba_mlir.mlir.settings import MKL_AVAILABLE
 from numpy.testing import assert_equal, assert_allclose  # for nans comparison
 import numpy as np
 import itertools
 import math
+import os
 import copy
 from functools import partial
 import pytest
@@ -22,11 +24,12 @@ from .utils import njit_cached as njit
 np.seterr(all="ignore")
 
 
-def _vectorize_reference(func, arg1):
-    ret = np.empty(arg1.shape, arg1.dtype)
-    for ind, val in np.ndenumerate(arg1):
-        ret[ind] = func(val)
-    return ret
+def _vectorize_reference(func, *args):
+    # Use scalar Numba function to match vectorized function types.
+    scalar_func = numba.core.decorators.njit(func)
+    args = np.broadcast_arrays(*args)
+    res = [scalar_func(*vals) for vals in zip(*(a.flat for a in args))]
+    return np.array(res).reshape(args[0].shape)
 
 
 _arr_dtypes = [
@@ -103,6 +106,9 @@ _test_arrays_ids = [
         "lambda a: a.mean()",
         "lambda a: np.sum(a)",
         "lambda a: np.prod(a)",
+        "lambda a: np.cumsum(a)",
+        "lambda a: np.cumprod(a)",
+        "lambda a: a.cumsum()",
         "lambda a: np.amax(a)",
         "lambda a: np.amin(a)",
         "lambda a: np.mean(a)",
@@ -855,6 +861,21 @@ def test_sum_add2():
     assert_equal(py_func(arr1, arr2, arr3), jit_func(arr1, arr2, arr3))
 
 
+def test_resolver_template_reuse():
+    def py_func(a, b, c):
+        return np.sum(a) + np.sum(b) + np.sum(c, axis=0)
+
+    with print_pass_ir([], ["ResolveNtensorPass"]):
+        jit_func = njit(py_func)
+        arr1 = np.arange(10, dtype=np.float64)
+        arr2 = np.arange(5, dtype=np.float64)
+        arr3 = np.arange(7, dtype=np.float64)
+        assert_allclose(py_func(arr1, arr2, arr3), jit_func(arr1, arr2, arr3))
+        ir = get_print_buffer()
+        assert ir.count("func.func private @__resolver.numpy_sum") == 2, ir
+        assert ir.count("call @__resolver.numpy_sum") == 3, ir
+
+
 @pytest.mark.parametrize("arr", _test_arrays)
 @pytest.mark.parametrize("name", ["sqrt", "log", "exp", "sin", "cos"])
 def test_math_uplifting1(arr, name):
@@ -1007,6 +1028,34 @@ def test_prange_lowering():
         assert ir.count('"numba_util.parallel"') == 1, ir
 
 
+@pytest.mark.parametrize("size", [1, 7, 100003])
+def test_prange_deterministic_reduce(size):
+    def py_func(arr):
+        res = 0.0
+        for i in numba.prange(len(arr)):
+            res += arr[i]
+
+        return res
+
+    arr = np.random.RandomState(42).uniform(-1e10, 1e10, size)
+    results = []
+    with print_pass_ir([], ["ParallelToTbbPass"]):
+        for schedule in [None, "static", "dynamic"]:
+            jit_func = njit(
+                py_func,
+                parallel=True,
+                mlir_parallel_schedule=schedule,
+                mlir_deterministic_reduce=True,
+            )
+            results.append(jit_func(arr))
+
+        ir = get_print_buffer()
+        assert ir.count('"numba_util.parallel"') > 0, ir
+
+    assert_allclose(results[0], py_func(arr), rtol=1e-5)
+    assert all(r == results[0] for r in results), results
+
+
 @pytest.mark.skip()
 def test_prange_lowering_indirect():
     def py_func1(arr):
@@ -1125,6 +1174,41 @@ def test_loop_fusion3():
         assert ir.count("memref.load") == 2, ir
 
 
+def test_hoist_array_ops():
+    def py_func(a, n):
+        res = 0.0
+        for i in range(n):
+            b = a * 2 + 1
+            res += b[i % a.shape[0]]
+
+        return res
+
+    with print_pass_ir([], ["HoistArrayOpsPass"]):
+        jit_func = njit(py_func)
+        a = np.arange(1, 11, dtype=np.float64)
+        assert_allclose(py_func(a, 25), jit_func(a, 25))
+        ir = get_print_buffer()
+        loops = [ir.find(l) for l in ("scf.for", "scf.while") if l in ir]
+        assert loops, ir
+        assert ir.count("ntensor.elementwise") > 0, ir
+        assert ir.rfind("ntensor.elementwise") < min(loops), ir
+
+
+def test_hoist_array_ops_write():
+    def py_func(a, n):
+        res = 0.0
+        for i in range(n):
+            b = a * 2 + 1
+            res += b[i % a.shape[0]]
+            a[i % a.shape[0]] = res
+
+        return res
+
+    jit_func = njit(py_func)
+    a = np.arange(1, 11, dtype=np.float64)
+    assert_allclose(py_func(a.copy(), 25), jit_func(a.copy(), 25))
+
+
 @pytest.mark.parametrize(
     "arr",
     [
@@ -1145,6 +1229,19 @@ def test_array_vectorize(arr):
         assert ir.count("vector.maskedstore") > 0, ir
 
 
+def test_array_vectorize_llvm_marker():
+    def py_func(arr):
+        return arr * 2 + 1
+
+    arr = np.arange(1003, dtype=np.float32)
+    with print_pass_ir([], ["MarkVectorizedLoopsPass"]):
+        jit_func = njit(py_func)
+        assert_allclose(py_func(arr), jit_func(arr))
+        ir = get_print_buffer()
+        assert ir.count("call @numba_vectorized_loop") > 0, ir
+        assert ir.count("numba.vectorized") == 0, ir
+
+
 @pytest.mark.parametrize(
     "arr",
     [
@@ -1173,6 +1270,157 @@ def test_array_reduction_vectorize(py_func, arr):
         assert ir.count("vector.reduction") > 0, ir
 
 
+@pytest.mark.parametrize("size", [1, 1000, 100000, 1000003])
+@pytest.mark.parametrize("dtype", [np.int32, np.int64, np.float64])
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda a: np.cumsum(a)",
+        "lambda a: np.cumsum(a, axis=0)",
+    ],
+)
+def test_cumsum_parallel(py_func, size, dtype):
+    arr = np.arange(size, dtype=dtype) % 17
+    jit_func = njit(py_func, parallel=True)
+    assert_allclose(py_func(arr), jit_func(arr))
+
+
+# Sizes around the parallel threshold and the block boundaries.
+@pytest.mark.parametrize("size", [0, 65535, 65536, 65537, 8192 * 9, 8192 * 9 + 1])
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda a: np.cumsum(a)",
+        "lambda a: a.cumsum()",
+        "lambda a: np.cumprod(a)",
+        "lambda a: a.cumprod()",
+    ],
+)
+def test_scan_parallel_blocks(py_func, size):
+    # Values are close to 1, so the product doesn't overflow.
+    arr = 1 + (np.arange(size, dtype=np.float64) % 7 - 3) * 1e-6
+    with print_pass_ir([], ["ParallelToTbbPass"]):
+        jit_func = njit(py_func, parallel=True)
+        assert_allclose(py_func(arr), jit_func(arr), rtol=1e-9)
+        ir = get_print_buffer()
+        # Block scan and block offsets application loops.
+        assert ir.count("numba_util.parallel") >= 2, ir
+
+
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda a: np.cumsum(a)",
+        "lambda a: np.cumsum(a, dtype=np.float64)",
+        "lambda a: np.cumprod(a)",
+    ],
+)
+@pytest.mark.parametrize(
+    "arr",
+    [
+        np.arange(100000, dtype=np.int32).reshape(1000, 100) % 5,
+        (np.arange(100000, dtype=np.int8) % 3).reshape(100, 1000).T,
+    ],
+)
+def test_scan_parallel_nd(py_func, arr):
+    # N-d arrays are scanned in the flattened C order.
+    jit_func = njit(py_func, parallel=True)
+    assert_equal(py_func(arr), jit_func(arr))
+
+
+@pytest.mark.parametrize("size", [0, 1, 1000, 100003])
+@pytest.mark.parametrize("dtype", [np.int32, np.float64])
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda a: a[a % 3 == 0]",
+        "lambda a: np.nonzero(a % 3)",
+        "lambda a: np.where(a % 5 == 0)",
+        "lambda a: a.nonzero()",
+        "lambda a: np.nonzero(a.reshape(-1, 1) % 3)",
+    ],
+)
+def test_compress_parallel(py_func, size, dtype):
+    arr = np.arange(size, dtype=dtype) % 17
+    jit_func = njit(py_func, parallel=True)
+    assert_equal(py_func(arr), jit_func(arr))
+
+
+@pytest.mark.parametrize("size", [0, 1, 1000, 100003])
+@pytest.mark.parametrize("dtype", [np.int32, np.uint64, np.float32, np.float64])
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda a: np.sort(a)",
+        "lambda a: np.sort(a[::2])",
+        "lambda a: a[np.argsort(a)]",
+        "lambda a: a[a.argsort()]",
+        "lambda a: np.unique(a)",
+    ],
+)
+def test_sort(py_func, size, dtype):
+    arr = ((np.arange(size) * 7919) % 1013).astype(dtype)
+    jit_func = njit(py_func, parallel=True)
+    assert_equal(py_func(arr), jit_func(arr))
+
+
+def test_sort_nan():
+    def py_func(a):
+        return np.sort(a)
+
+    arr = np.array([3.0, np.nan, 1.0, -np.inf, np.nan, 2.0])
+    jit_func = njit(py_func)
+    assert_equal(py_func(arr), jit_func(arr))
+
+
+@pytest.mark.parametrize("size", [1, 1000, 100003])
+@pytest.mark.parametrize("dtype", [np.int32, np.float64])
+@pytest.mark.parametrize("step", [1, -3])
+def test_argsort_ties(size, dtype, step):
+    def py_func(a):
+        return np.argsort(a)
+
+    # Only a few distinct keys, equal keys must be ordered by index.
+    arr = ((np.arange(size) * 7919) % 5).astype(dtype)
+    if dtype == np.float64:
+        arr[::7] = np.nan
+
+    arr = arr[::step]
+    jit_func = njit(py_func, parallel=True)
+    assert_equal(jit_func(arr), np.argsort(arr, kind="stable"))
+
+
+@pytest.mark.parametrize("rows", [0, 1, 10, 1000])
+def test_csr_spmv_balanced(rows):
+    def py_func(indptr, indices, data, x):
+        y = np.empty(indptr.size - 1, data.dtype)
+        for i in numba.prange(indptr.size - 1):
+            acc = 0.0
+            for j in range(indptr[i], indptr[i + 1]):
+                acc += data[j] * x[indices[j]]
+            y[i] = acc
+        return y
+
+    # Power-law row lengths with some empty rows.
+    lengths = (np.arange(rows) * 37 % 101) ** 2 // 50
+    lengths[::7] = 0
+    indptr = np.zeros(rows + 1, np.int64)
+    indptr[1:] = np.cumsum(lengths)
+    nnz = indptr[-1]
+    cols = rows + 1
+    indices = (np.arange(nnz) * 13) % cols
+    data = np.arange(nnz, dtype=np.float64) % 11
+    x = np.arange(cols, dtype=np.float64)
+
+    with print_pass_ir([], ["BalanceCsrLoopsPass"]):
+        jit_func = njit(py_func, parallel=True)
+        assert_allclose(
+            py_func(indptr, indices, data, x), jit_func(indptr, indices, data, x)
+        )
+        ir = get_print_buffer()
+        assert ir.count("scf.while") > 0, ir
+
+
 def test_prange_vectorize_1d():
     def py_func(a):
         b = np.zeros_like(a)
@@ -1206,6 +1454,110 @@ def test_prange_vectorize_2d():
         assert ir.count("vector.maskedstore") > 0, ir
 
 
+def test_prange_loop_distribution():
+    def py_func(a, b, c):
+        for i in numba.prange(a.shape[0]):
+            v = a[i]
+            b[i] = v * v + 1
+            acc = v
+            for j in range(i % 8):
+                acc = acc + a[j]
+            c[i] = acc
+
+    # Nested loop is moved into the separate residual loop, so the rest of the
+    # body can be vectorized.
+    arr = np.arange(1, 1000, dtype=np.float32)
+    with print_pass_ir([], ["LoopDistributionPass", "SCFVectorizePass"]):
+        jit_func = njit(py_func)
+        res = (np.zeros_like(arr), np.zeros_like(arr))
+        jit_func(arr, *res)
+        ir = get_print_buffer()
+        dist_ir, vec_ir = ir.split("SCFVectorizePass", 1)
+        assert dist_ir.count("scf.parallel") == 2, ir
+        assert vec_ir.count("vector.maskedstore") > 0, ir
+        assert vec_ir.count("scf.for") > 0, ir
+
+    expected = (np.zeros_like(arr), np.zeros_like(arr))
+    py_func(arr, *expected)
+    assert_allclose(res, expected)
+
+
+def test_prange_vectorize_if():
+    def py_func(a):
+        b = np.zeros_like(a)
+        for i in numba.prange(a.shape[0]):
+            if a[i] > 0:
+                b[i] = np.sqrt(a[i])
+        return b
+
+    with print_pass_ir([], ["SCFVectorizePass"]):
+        arr = np.arange(-6, 7, dtype=np.float32)
+        jit_func = njit(py_func)
+        assert_allclose(py_func(arr), jit_func(arr))
+        ir = get_print_buffer()
+        sqrt = [l for l in ir.splitlines() if "math.sqrt" in l]
+        assert sqrt and all("vector<" in l for l in sqrt), ir
+        assert ir.count("vector.maskedstore") > 0, ir
+
+
+def test_prange_vectorize_scatter_update():
+    def py_func(a, bins, hist):
+        for i in numba.prange(a.shape[0]):
+            hist[bins[i]] += a[i] * a[i] + 1.0
+
+    # Repeated bins inside the same vector and across vectors.
+    bins = np.array([1, 1, 1, 3, 0, 1, 2, 1, 1, 1, 1, 1, 0, 0, 3, 3, 1])
+    a = np.arange(bins.size, dtype=np.float64)
+    with print_pass_ir([], ["SCFVectorizePass"]):
+        jit_func = njit(py_func, mlir_vectorize=512)
+        expected = np.zeros(4)
+        py_func(a, bins, expected)
+        hist = np.zeros(4)
+        jit_func(a, bins, hist)
+        assert_equal(hist, expected)
+        ir = get_print_buffer()
+        assert ir.count("vector.scatter") > 0, ir
+        assert ir.count("scf.while") > 0, ir
+
+
+def test_prange_vectorize_gather_2d():
+    def py_func(a, i0, i1):
+        res = np.empty(i0.shape[0], a.dtype)
+        for i in numba.prange(i0.shape[0]):
+            res[i] = a[i0[i], i1[i]] * 2.0 + 1.0
+        return res
+
+    a = np.arange(5 * 7, dtype=np.float64).reshape(5, 7)
+    i0 = np.array([4, 0, 2, 2, 1, 3, 0, 4, 1, 2, 3])
+    i1 = np.array([6, 0, 3, 1, 5, 2, 6, 0, 4, 3, 1])
+    with print_pass_ir([], ["SCFVectorizePass"]):
+        jit_func = njit(py_func, mlir_vectorize=512)
+        assert_equal(jit_func(a, i0, i1), py_func(a, i0, i1))
+        ir = get_print_buffer()
+        assert ir.count("vector.gather") > 0, ir
+
+
+@pytest.mark.parametrize("dtype", [np.complex64, np.complex128])
+def test_array_vectorize_complex(dtype):
+    def py_func(a, b, c):
+        return a * b + c
+
+    def make_arr(start):
+        re = np.arange(start, start + 13)
+        im = np.arange(start + 13, start + 26)
+        return (re + 1j * im).astype(dtype)
+
+    a = make_arr(0)
+    b = make_arr(5)
+    c = make_arr(-7)
+    with print_pass_ir([], ["SCFVectorizePass"]):
+        jit_func = njit(py_func)
+        assert_allclose(py_func(a, b, c), jit_func(a, b, c), rtol=1e-5)
+        ir = get_print_buffer()
+        assert ir.count("numba_util.memref_bitcast") > 0, ir
+        assert ir.count("vector.shuffle") > 0, ir
+
+
 def test_copy_fusion():
     def py_func(a, b):
         a = a + 1
@@ -1226,6 +1578,68 @@ def test_copy_fusion():
         assert ir.count("scf.parallel") == 1, ir
 
 
+def test_out_variant():
+    def py_func(a, b):
+        return a * 2 + b
+
+    jit_func = njit(py_func).out_variant
+    a = np.arange(13, dtype=np.float64)
+    b = np.arange(13, dtype=np.float64) + 3
+
+    out = np.zeros_like(a)
+    with print_pass_ir([], ["PostLinalgOptPass"]):
+        assert jit_func(a, b, out) is None
+        assert_equal(out, py_func(a, b))
+        ir = get_print_buffer()
+        assert ir.count("scf.parallel") == 1, ir
+        assert ir.count("memref.alloc") == 0, ir
+
+
+def test_shape_specialize():
+    def py_func(a, b):
+        return a + b
+
+    jit_func = njit(py_func, mlir_shape_specialize=2)
+    a = np.arange(12, dtype=np.float32).reshape(3, 4)
+    b = a * 2
+
+    with print_pass_ir([], ["PostLinalgOptPass"]):
+        for _ in range(3):
+            assert_equal(jit_func(a, b), py_func(a, b))
+
+        ir = get_print_buffer()
+        assert ir.count("3x4xf32") > 0, ir
+
+    a1 = np.arange(10, dtype=np.float32).reshape(2, 5)
+    assert_equal(jit_func(a1, a1), py_func(a1, a1))
+    assert len(jit_func._shape_variants) == 1
+    assert len(jit_func.overloads) == 1
+
+
+def test_value_specialize():
+    def py_func(a, n, flag):
+        res = 0
+        for i in range(n):
+            if flag:
+                res += a[i]
+            else:
+                res -= a[i]
+        return res
+
+    jit_func = njit(py_func, mlir_specialize_args=("n", "flag"))
+    a = np.arange(10, dtype=np.int64)
+
+    with print_pass_ir([], ["PostLinalgOptPass"]):
+        assert_equal(jit_func(a, 4, True), py_func(a, 4, True))
+        ir = get_print_buffer()
+        assert ir.count("scf.if") == 0, ir
+
+    assert_equal(jit_func(a, 4, False), py_func(a, 4, False))
+    assert_equal(jit_func(a, 3, True), py_func(a, 3, True))
+    assert_equal(jit_func(a, 4, True), py_func(a, 4, True))
+    assert len(jit_func._value_variants) == 3
+
+
 def test_fusion_conflict1():
     def py_func(a):
         a[:] = np.flip(a)
@@ -1673,6 +2087,22 @@ def test_array_strides(arr):
     assert_equal(py_func(arr), jit_func(arr))
 
 
+@pytest.mark.parametrize("parallel", [False, True])
+def test_strided_columns_broadcast(parallel):
+    def py_func(pos):
+        x = pos[:, 0:1]
+        y = pos[:, 1:2]
+        z = pos[:, 2:3]
+        dx = x.T - x
+        dy = y.T - y
+        dz = z.T - z
+        return dx**2 + dy**2 + dz**2
+
+    jit_func = njit(py_func, parallel=parallel)
+    pos = np.random.random((100, 3))
+    assert_allclose(py_func(pos), jit_func(pos), rtol=1e-7)
+
+
 def test_array_return():
     def py_func(a):
         return a
@@ -1779,6 +2209,179 @@ def test_init4(func):
     assert_equal(py_func((2, 1)), jit_func((2, 1)))
 
 
+@pytest.mark.parametrize("func", [np.zeros, np.ones], ids=["zeros", "ones"])
+@pytest.mark.parametrize("parallel", [False, True])
+def test_init_large(func, parallel):
+    def py_func(d):
+        return func(d)
+
+    jit_func = njit(py_func, parallel=parallel)
+    size = 1024 * 1024
+    assert_equal(py_func(size), jit_func(size))
+
+
+@pytest.mark.parametrize("shape", [5, (2, 3), 1024 * 1024])
+@pytest.mark.parametrize("fill_value", [0, 1, 2.5, True])
+def test_full1(shape, fill_value):
+    def py_func(s, v):
+        return np.full(s, v)
+
+    jit_func = njit(py_func)
+    assert_equal(py_func(shape, fill_value), jit_func(shape, fill_value))
+
+
+@pytest.mark.parametrize("dtype", _arr_dtypes)
+def test_full2(dtype):
+    def py_func(a, v):
+        return np.full(a.shape, v, a.dtype)
+
+    jit_func = njit(py_func)
+    arr = np.empty((3, 4), dtype=dtype)
+    assert_equal(py_func(arr, 1), jit_func(arr, 1))
+
+
+@pytest.mark.parametrize("shape", [2, (3, 4), (5, 6, 7)])
+@pytest.mark.parametrize("dtype", _arr_dtypes)
+def test_full_like(shape, dtype):
+    def py_func(a, v):
+        return np.full_like(a, v)
+
+    a = np.empty(shape=shape, dtype=dtype)
+    jit_func = njit(py_func)
+    assert_equal(py_func(a, 1), jit_func(a, 1))
+
+
+def _philox_random_reference(seed, count):
+    # Philox4x32-10 with splitmix64 key derivation, same as runtime.
+    mask = 0xFFFFFFFF
+    key = (seed + 0x9E3779B97F4A7C15) & 0xFFFFFFFFFFFFFFFF
+    key = ((key ^ (key >> 30)) * 0xBF58476D1CE4E5B9) & 0xFFFFFFFFFFFFFFFF
+    key = ((key ^ (key >> 27)) * 0x94D049BB133111EB) & 0xFFFFFFFFFFFFFFFF
+    key = key ^ (key >> 31)
+
+    res = np.empty(count)
+    for i in range(count):
+        c0, c1, c2, c3 = i & mask, i >> 32, 0, 0
+        k0, k1 = key & mask, key >> 32
+        for _ in range(10):
+            p0 = 0xD2511F53 * c0
+            p1 = 0xCD9E8D57 * c2
+            c0, c1, c2, c3 = (
+                (p1 >> 32) ^ c1 ^ k0,
+                p1 & mask,
+                (p0 >> 32) ^ c3 ^ k1,
+                p0 & mask,
+            )
+            k0 = (k0 + 0x9E3779B9) & mask
+            k1 = (k1 + 0xBB67AE85) & mask
+        res[i] = (((c1 << 32) | c0) >> 11) / 9007199254740992.0
+    return res
+
+
+def test_random_reference():
+    def py_func(n):
+        np.random.seed(42)
+        return np.random.random(n)
+
+    jit_func = njit(py_func)
+    assert_equal(jit_func(100), _philox_random_reference(42, 100))
+
+
+@pytest.mark.parametrize(
+    "py_func",
+    [
+        lambda s: np.random.random(s),
+        lambda s: np.random.uniform(-2.0, 3.0, s),
+        lambda s: np.random.normal(1.0, 2.0, s),
+        lambda s: np.random.randint(-5, 7, s),
+    ],
+    ids=["random", "uniform", "normal", "randint"],
+)
+@pytest.mark.parametrize("size", [1, 1000, (30, 40)])
+def test_random_reproducible(py_func, size):
+    def func(s):
+        np.random.seed(3)
+        a = py_func(s)
+        b = py_func(s)
+        return a, b
+
+    jit_func = njit(func)
+    jit_func_parallel = njit(func, parallel=True)
+    a1, b1 = jit_func(size)
+    a2, b2 = jit_func_parallel(size)
+    assert_equal(a1, a2)
+    assert_equal(b1, b2)
+    assert a1.shape == np.empty(size).shape
+    if a1.size > 1:
+        assert not np.array_equal(a1, b1)
+
+
+def test_random_stats():
+    def py_func(n):
+        return (
+            np.random.random(n),
+            np.random.uniform(-2.0, 3.0, n),
+            np.random.normal(1.0, 2.0, n),
+            np.random.randint(-5, 7, n),
+        )
+
+    jit_func = njit(py_func, parallel=True)
+    r, u, g, i = jit_func(1024 * 1024)
+    assert r.min() >= 0 and r.max() < 1
+    assert_allclose(r.mean(), 0.5, atol=1e-2)
+    assert u.min() >= -2 and u.max() < 3
+    assert_allclose(u.mean(), 0.5, atol=2e-2)
+    assert_allclose(g.mean(), 1.0, atol=2e-2)
+    assert_allclose(g.std(), 2.0, atol=2e-2)
+    assert i.dtype == np.int64
+    assert_equal(np.unique(i), np.arange(-5, 7))
+
+
+def test_random_prange():
+    def py_func(n):
+        np.random.seed(7)
+        res = np.empty(n)
+        for i in numba.prange(n):
+            res[i] = np.random.random()
+        return res
+
+    jit_func = njit(py_func, parallel=True)
+    res = jit_func(1000)
+    assert res.min() >= 0 and res.max() < 1
+    assert np.unique(res).size == res.size
+
+    # Counters are derived from the loop index, so results don't depend on the
+    # iterations schedule.
+    assert_equal(jit_func(1000), res)
+    assert_equal(njit(py_func)(1000), res)
+
+
+def test_random_prange_nested():
+    def py_func(n, m):
+        np.random.seed(11)
+        res = np.empty((n, m))
+        for i in numba.prange(n):
+            for j in range(m):
+                res[i, j] = np.random.uniform(-1.0, 1.0)
+        return res
+
+    jit_func = njit(py_func, parallel=True)
+    res = jit_func(100, 20)
+    assert np.unique(res).size == res.size
+    assert_equal(jit_func(100, 20), res)
+    assert_equal(njit(py_func)(100, 20), res)
+
+
+@pytest.mark.parametrize("low, high", [(5, 5), (7, 3)])
+def test_random_randint_empty_range(low, high):
+    def py_func(n):
+        return np.random.randint(low, high, n)
+
+    # Resolver errors are reported as compilation errors.
+    with pytest.raises(RuntimeError):
+        njit(py_func)(10)
+
+
 @pytest.mark.parametrize("shape", [2, (3, 4), (5, 6, 7)])
 @pytest.mark.parametrize("dtype", _arr_dtypes)
 @pytest.mark.parametrize(
@@ -1863,6 +2466,38 @@ def test_arange(py_func):
     assert_equal(py_func(), jit_func())
 
 
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda : np.linspace(0, 1)",
+        "lambda : np.linspace(0, 1, 0)",
+        "lambda : np.linspace(0, 1, 1)",
+        "lambda : np.linspace(2, 3, 5)",
+        "lambda : np.linspace(3, -2, 7)",
+        "lambda : np.linspace(0.1, 0.7, 13, endpoint=False)",
+        "lambda : np.linspace(0, 1, 1, endpoint=False)",
+        "lambda : np.linspace(-1, 1, 9, dtype=np.float32)",
+    ],
+)
+def test_linspace(py_func):
+    jit_func = njit(py_func)
+    assert_allclose(py_func(), jit_func(), rtol=1e-15, atol=1e-15)
+
+
+@pytest.mark.parametrize("endpoint", [True, False])
+@pytest.mark.parametrize("n", [1, 2, 10, 100001])
+def test_linspace_dynamic(n, endpoint):
+    def py_func(a, b, n, endpoint):
+        return np.linspace(a, b, n, endpoint=endpoint)
+
+    jit_func = njit(py_func)
+    expected = py_func(-1.5, 2.5, n, endpoint)
+    res = jit_func(-1.5, 2.5, n, endpoint)
+    assert_allclose(res, expected, rtol=1e-15, atol=1e-15)
+    if endpoint:
+        assert res[-1] == expected[-1]
+
+
 @pytest.mark.parametrize("dtype", [np.int32, np.int64, np.float32, np.float64])
 def test_dtype_param(dtype):
     def py_func(dt):
@@ -1933,6 +2568,46 @@ def test_vectorize_indirect(arr):
     assert_equal(_vectorize_reference(func, arr), jit_func(arr))
 
 
+@parametrize_function_variants(
+    "func",
+    [
+        "lambda a, b: a + b",
+        "lambda a, b: a * 2 - b",
+        "lambda a, b: math.atan2(a, b)",
+    ],
+)
+@pytest.mark.parametrize(
+    "a, b",
+    [
+        (_arr_1d_int64, _arr_1d_float64),
+        (_arr_2d_float, _arr_1d_float32[:4]),
+        (_arr_2d_int.T, 3),
+        (2.5, _arr_2d_int),
+    ],
+)
+def test_vectorize_nary(func, a, b):
+    vec_func = vectorize(func)
+    assert_allclose(_vectorize_reference(func, a, b), vec_func(a, b), rtol=1e-7)
+
+
+@pytest.mark.parametrize("target", ["cpu", "parallel"])
+def test_vectorize_signatures(target):
+    @vectorize(["float32(float32, float32)", "int64(int64, int64)"], target=target)
+    def func(a, b):
+        return a - b
+
+    a = np.arange(10, dtype=np.int32)
+    b = np.arange(10, dtype=np.float32)
+    assert_equal(func(a, a).dtype, np.int64)
+    assert_equal(func(b, b).dtype, np.float32)
+    assert_equal(func(a, a), a - a)
+    assert_equal(func(a, 1), a - 1)
+
+    c = np.arange(10, dtype=np.float64)
+    with pytest.raises(Exception):
+        func(c, c)
+
+
 @pytest.mark.parametrize(
     "arr",
     [
@@ -2279,6 +2954,114 @@ def test_multidim_slice():
     assert_equal(py_func(a, 0), jit_func(a, 0))
 
 
+@pytest.mark.parametrize(
+    "body, shape",
+    [
+        ("a[:-2] + a[1:-1] + a[2:]", (11,)),
+        ("(a[:-2] - 2 * a[1:-1] + a[2:]) * 0.5", (11,)),
+        ("a[1:-1, :-2] + a[1:-1, 2:] + a[:-2, 1:-1] + a[2:, 1:-1]", (7, 9)),
+    ],
+)
+def test_stencil_slices(body, shape):
+    py_func = eval(f"lambda a: {body}")
+    arr = np.arange(math.prod(shape), dtype=np.float64).reshape(shape)
+
+    with print_pass_ir([], ["LinalgOptPass"]):
+        jit_func = njit(py_func)
+        assert_equal(py_func(arr), jit_func(arr))
+        ir = get_print_buffer()
+        assert ir.count("tensor.extract_slice") == 1, ir
+
+
+@pytest.mark.parametrize("order", ["C", "F"])
+@pytest.mark.parametrize("transpose", [False, True])
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda a, b: a + b",
+        "lambda a, b: a * 2 + b.T.T",
+        "lambda a, b: np.sum(a * b, axis=0)",
+    ],
+)
+def test_strided_loop_interchange(py_func, order, transpose):
+    a = np.arange(5 * 7, dtype=np.float64).reshape(5, 7)
+    b = np.flip(a).copy()
+    if transpose:
+        a = np.array(a.T, order=order).T
+    else:
+        a = np.array(a, order=order)
+
+    jit_func = njit(py_func)
+    assert_allclose(py_func(a, b), jit_func(a, b))
+
+
+@pytest.mark.parametrize("flip", [False, True])
+def test_strided_loop_interchange_negative_strides(flip):
+    def py_func(a, b):
+        return a + b
+
+    a = np.arange(5 * 7, dtype=np.float64).reshape(5, 7)
+    b = np.array(a.T, order="C").T
+    if flip:
+        a = a[::-1, ::-1]
+        b = b[::-1, ::-1]
+
+    jit_func = njit(py_func)
+    with print_pass_ir([], ["InterchangeGenericLoopsPass"]):
+        assert_allclose(py_func(a, b), jit_func(a, b))
+        ir = get_print_buffer()
+        # Dynamic strides are compared by their absolute values.
+        assert ir.count("math.absi") > 0, ir
+        assert ir.count("arith.cmpi ugt") > 0, ir
+
+
+@pytest.mark.parametrize("affine_opt", [False, True])
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda a, b: a + b",
+        "lambda a, b: a * 2 + b.T",
+        "lambda a, b: np.sum(a * b.T, axis=1)",
+    ],
+)
+def test_affine_opt(py_func, affine_opt):
+    a = np.arange(9 * 9, dtype=np.float64).reshape(9, 9)
+    b = np.flip(a).copy()
+
+    with print_pass_ir([], ["AffineLoopInterchangePass"]):
+        jit_func = njit(py_func, mlir_affine_opt=affine_opt)
+        assert_allclose(py_func(a, b), jit_func(a, b))
+        ir = get_print_buffer()
+        # Loop nests are raised to affine.for only if the stage is enabled.
+        assert (ir.count("affine.for") > 0) == affine_opt, ir
+
+
+@pytest.mark.parametrize("shape", [(3, 5), (17, 2050), (4, 3, 1500)])
+@pytest.mark.parametrize("axis", [0, 1, -1])
+@pytest.mark.parametrize("name", ["sum", "amax", "amin"])
+def test_outer_axis_reduction(shape, axis, name):
+    py_func = eval(f"lambda a: np.{name}(a, axis={axis})")
+    arr = np.arange(math.prod(shape), dtype=np.float64).reshape(shape)
+    arr = np.sin(arr)
+    jit_func = njit(py_func)
+    assert_allclose(py_func(arr), jit_func(arr), rtol=1e-12)
+
+
+@pytest.mark.parametrize("shape", [(3, 5), (300, 2050)])
+def test_outer_axis_reduction_size_check(shape):
+    def py_func(a):
+        return np.sum(a, axis=0)
+
+    arr = np.sin(np.arange(math.prod(shape), dtype=np.float64).reshape(shape))
+    with print_pass_ir([], ["TileOuterReductionsPass"]):
+        jit_func = njit(py_func)
+        assert_allclose(py_func(arr), jit_func(arr), rtol=1e-12)
+        ir = get_print_buffer()
+        # Dynamic size is checked at runtime, small reductions are not tiled.
+        assert "arith.cmpi uge" in ir, ir
+        assert "numba_outer_reduction" in ir, ir
+
+
 def test_size_ret():
     def py_func(a, b):
         return a.size / b
@@ -2743,6 +3526,241 @@ def test_matmul2(py_func, a, b, dtype):
     assert_allclose(py_func(a, b), jit_func(a, b), rtol=1e-4, atol=1e-7)
 
 
+@pytest.mark.parametrize("m,k,n", [(4, 3, 5), (40, 50, 30)])
+def test_matmul_float16(m, k, n):
+    def py_func(a, b):
+        return a @ b
+
+    a = (np.arange(m * k).reshape(m, k) / (m * k)).astype(np.float16)
+    b = (np.arange(k * n).reshape(k, n) / (k * n)).astype(np.float16)
+    jit_func = njit(py_func)
+    res = jit_func(a, b)
+    assert res.dtype == np.float16
+    expected = a.astype(np.float32) @ b.astype(np.float32)
+    assert_allclose(expected, res, rtol=1e-2, atol=1e-2)
+
+
+@pytest.mark.parametrize(
+    "a,b",
+    [
+        (np.arange(4 * 3 * 5).reshape(4, 3, 5), np.arange(4 * 5 * 2).reshape(4, 5, 2)),
+        (
+            np.arange(3 * 20 * 25).reshape(3, 20, 25),
+            np.arange(3 * 25 * 10).reshape(3, 25, 10),
+        ),
+    ],
+)
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_matmul3d(a, b, dtype):
+    def py_func(a, b):
+        return a @ b
+
+    a = np.array(a, dtype=dtype)
+    b = np.array(b, dtype=dtype)
+    jit_func = njit(py_func)
+    assert_allclose(py_func(a, b), jit_func(a, b), rtol=1e-4, atol=1e-7)
+
+
+@pytest.mark.parametrize(
+    "shape1, shape2",
+    [
+        ((1, 3, 4), (5, 4, 2)),
+        ((5, 3, 4), (1, 4, 2)),
+        ((1, 20, 25), (3, 25, 10)),
+        ((3, 20, 25), (1, 25, 10)),
+    ],
+)
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_matmul3d_broadcast_batch(shape1, shape2, dtype):
+    def py_func(a, b):
+        return a @ b
+
+    a = np.arange(math.prod(shape1), dtype=dtype).reshape(shape1)
+    b = np.arange(math.prod(shape2), dtype=dtype).reshape(shape2)
+    jit_func = njit(py_func)
+    assert_allclose(py_func(a, b), jit_func(a, b), rtol=1e-4, atol=1e-7)
+
+
+@pytest.mark.parametrize(
+    "shape1, shape2",
+    [
+        ((2, 3, 4), (2, 4, 5)),
+        ((1, 3, 4), (2, 4, 5)),
+        ((2, 3, 4), (1, 4, 5)),
+    ],
+)
+def test_matmul3d_small_static(shape1, shape2):
+    def py_func(x):
+        a = np.ones(shape1) * x
+        b = np.ones(shape2) + x
+        return a @ b
+
+    jit_func = njit(py_func)
+    assert_allclose(py_func(1.5), jit_func(1.5), rtol=1e-7)
+
+
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda a, b, c: a @ b + c",
+        "lambda a, b, c: c + a @ b",
+        "lambda a, b, c: np.maximum(a @ b + c, 0)",
+        "lambda a, b, c: np.maximum(0, a @ b + c)",
+    ],
+)
+@pytest.mark.parametrize("m,k,n", [(4, 3, 5), (40, 50, 30), (1000, 20, 10)])
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_matmul_epilogue(py_func, m, k, n, dtype):
+    a = np.arange(m * k, dtype=dtype).reshape(m, k) / (m * k)
+    b = np.arange(k * n, dtype=dtype).reshape(k, n) / (k * n)
+    c = np.linspace(-k, k, n, dtype=dtype)
+    jit_func = njit(py_func)
+    assert_allclose(py_func(a, b, c), jit_func(a, b, c), rtol=1e-4, atol=1e-5)
+
+
+@pytest.mark.skipif(not MKL_AVAILABLE, reason="MKL is not available")
+@pytest.mark.skipif(os.cpu_count() < 4, reason="Not enough cores")
+def test_mkl_threads_after_prange():
+    from numba_mlir.mlir.math_runtime import runtime_lib
+
+    get_mkl_threads = runtime_lib.nmrtMathRuntimeGetLastMklNumThreads
+
+    def py_func1(a):
+        for i in numba.prange(a.shape[0]):
+            a[i] = i
+
+    def py_func2(a, b):
+        res = np.empty((a.shape[0], a.shape[1], b.shape[1]), a.dtype)
+        for i in numba.prange(a.shape[0]):
+            res[i] = np.dot(a[i], b)
+        return res
+
+    a = np.ones((64, 64))
+    jit_func1 = njit(py_func1, parallel=True)
+    jit_func1(a)
+
+    # Main thread is not in parallel region anymore, MKL is threaded.
+    jit_func = njit(lambda a, b: np.dot(a, b))
+    assert_allclose(jit_func(a, a), np.dot(a, a))
+    assert get_mkl_threads() > 1
+
+    # Inside parallel loop body MKL is sequential.
+    a = np.ones((4, 64, 64))
+    b = np.ones((64, 64))
+    jit_func2 = njit(py_func2, parallel=True)
+    assert_allclose(jit_func2(a, b), py_func2(a, b))
+    assert get_mkl_threads() == 1
+
+    jit_func(b, b)
+    assert get_mkl_threads() > 1
+
+
+@pytest.mark.parametrize(
+    "subscripts,shapes",
+    [
+        ("ij,jk->ik", [(4, 3), (3, 5)]),
+        ("ij,jk", [(40, 50), (50, 30)]),
+        ("ij,kj->ik", [(40, 50), (30, 50)]),
+        ("ji,jk->ki", [(50, 40), (50, 30)]),
+        ("bij,bjk->bik", [(3, 20, 25), (3, 25, 10)]),
+        ("ijk,kl->ijl", [(6, 7, 30), (30, 20)]),
+        ("ij,jk,kl->il", [(30, 40), (40, 50), (50, 10)]),
+        ("i,i->", [(100,), (100,)]),
+        ("ij,j->i", [(50, 60), (60,)]),
+        ("ij->ji", [(7, 9)]),
+        ("ij->", [(7, 9)]),
+        ("i,j->ij", [(30,), (40,)]),
+        (",ij->ij", [(), (7, 9)]),
+        ("ij,,j->i", [(50, 60), (), (60,)]),
+        (",->", [(), ()]),
+    ],
+)
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_einsum(subscripts, shapes, dtype):
+    args = [np.arange(np.prod(s), dtype=dtype).reshape(s) / np.prod(s) for s in shapes]
+    names = ", ".join(f"a{i}" for i in range(len(args)))
+    py_func = eval(f"lambda {names}: np.einsum('{subscripts}', {names})")
+    jit_func = njit(py_func)
+    assert_allclose(py_func(*args), jit_func(*args), rtol=1e-4, atol=1e-5)
+
+
+def test_einsum_dims_mismatch():
+    def py_func():
+        a = np.ones((3, 4))
+        b = np.ones((5, 6))
+        return np.einsum("ij,jk->ik", a, b)
+
+    with pytest.raises(ValueError):
+        py_func()
+
+    # Resolver errors are reported as compilation errors.
+    with pytest.raises(RuntimeError, match="einsum"):
+        njit(py_func)()
+
+
+@pytest.mark.parametrize(
+    "shapes,axes",
+    [
+        ([(40, 50), (50, 30)], 1),
+        ([(6, 7, 30), (7, 30, 20)], 2),
+        ([(30, 6, 7), (7, 30, 20)], ((0, 2), (1, 0))),
+        ([(5, 6), (7, 8)], 0),
+    ],
+)
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_tensordot(shapes, axes, dtype):
+    def py_func(a, b):
+        return np.tensordot(a, b, axes)
+
+    a, b = [np.arange(np.prod(s), dtype=dtype).reshape(s) / np.prod(s) for s in shapes]
+    jit_func = njit(py_func)
+    assert_allclose(py_func(a, b), jit_func(a, b), rtol=1e-4, atol=1e-5)
+
+
+@parametrize_function_variants(
+    "py_func",
+    [
+        "lambda a, b: np.sum(a[:, :, np.newaxis] * b[np.newaxis, :, :], axis=1)",
+        "lambda a, b: np.sum(a[:, np.newaxis, :] * b.T, axis=2)",
+        "lambda a, b: np.sum(a[:, :, np.newaxis] * b, axis=(0, 1))",
+        "lambda a, b: (a[:, :, np.newaxis] * b).sum(axis=1)",
+    ],
+)
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_sum_product(py_func, dtype):
+    a = np.arange(40 * 50, dtype=dtype).reshape(40, 50) / 2000
+    b = np.arange(50 * 30, dtype=dtype).reshape(50, 30) / 1500
+    jit_func = njit(py_func)
+    assert_allclose(py_func(a, b), jit_func(a, b), rtol=1e-4, atol=1e-5)
+
+
+@pytest.mark.parametrize(
+    "N,H,W,C_in,C_out,K", [(2, 8, 8, 3, 4, 3), (4, 20, 18, 8, 16, 5)]
+)
+def test_conv2d_sum_product(N, H, W, C_in, C_out, K):
+    def py_func(input, weights):
+        K = weights.shape[0]
+        N = input.shape[0]
+        H_out = input.shape[1] - K + 1
+        W_out = input.shape[2] - K + 1
+        C_out = weights.shape[3]
+        output = np.empty((N, H_out, W_out, C_out), dtype=np.float32)
+        for i in numba.prange(H_out):
+            for j in numba.prange(W_out):
+                output[:, i, j, :] = np.sum(
+                    input[:, i : i + K, j : j + K, :, np.newaxis]
+                    * weights[np.newaxis, :, :, :],
+                    axis=(1, 2, 3),
+                )
+        return output
+
+    rng = np.random.default_rng(42)
+    input = rng.random((N, H, W, C_in), dtype=np.float32)
+    weights = rng.random((K, K, C_in, C_out), dtype=np.float32)
+    jit_func = njit(py_func, parallel=True)
+    assert_allclose(py_func(input, weights), jit_func(input, weights), rtol=1e-4)
+
+
 def test_batchnorm():
     def py_func(x, eps=1e-5):
         # mean = np.mean(x, axis=0, keepdims=True)
@@ -2864,3 +3882,85 @@ def test_black_scholes_opt():
 
         ir = get_print_buffer()
         assert ir.count("scf.parallel") == 1, ir
+
+
+def test_optimization_remarks():
+    def py_func(a):
+        for i in range(1, a.shape[0]):
+            a[i] = a[i - 1] + 1
+
+    jit_func = orig_njit(py_func)
+
+    a1 = np.zeros(10)
+    a2 = a1.copy()
+    py_func(a1)
+    jit_func(a2)
+    assert_equal(a1, a2)
+
+    remarks = jit_func.optimization_remarks(jit_func.signatures[0])
+    for remark in remarks:
+        assert set(remark.keys()) == {"pass", "reason", "location"}
+
+    assert any(
+        r["pass"] == "PromoteToParallelPass" and "not parallelized" in r["reason"]
+        for r in remarks
+    ), remarks
+
+
+def test_memory_profile(monkeypatch):
+    import numba_mlir.mlir.passes
+    from numba_mlir.mlir.runtime import memory_profile, get_memory_profile
+
+    monkeypatch.setattr(numba_mlir.mlir.passes, "MEMORY_PROFILE", 1)
+
+    def py_func(a):
+        return (a + 1) * 2
+
+    jit_func = orig_njit(py_func)
+
+    a = np.arange(1000, dtype=np.float64)
+    with memory_profile() as profile:
+        res = jit_func(a)
+
+    assert_equal(res, py_func(a))
+
+    total = profile["cpu"][""]
+    assert total["allocs"] > 0
+    assert total["peak"] >= a.nbytes
+    assert total["live"] >= a.nbytes
+    assert any(k != "" and v["allocs"] > 0 for k, v in profile["cpu"].items())
+
+    del res
+    assert get_memory_profile()[""]["live"] == 0
+
+
+def test_trace(tmp_path):
+    import json
+    from numba_mlir.mlir.runtime import trace, get_trace_events
+
+    def py_func(a):
+        res = 0
+        for i in numba.prange(a.size):
+            res += a[i]
+        return res
+
+    jit_func = orig_njit(py_func, parallel=True)
+
+    a = np.arange(1000, dtype=np.float64)
+    path = tmp_path / "trace.json"
+    with trace(path):
+        res = jit_func(a)
+
+    assert_equal(res, py_func(a))
+
+    events = get_trace_events()
+    categories = {e[1] for e in events}
+    assert "mlir_stage" in categories
+    assert "dispatch" in categories
+    assert all(e[2] <= e[3] for e in events)
+
+    with open(path) as f:
+        data = json.load(f)
+
+    assert len(data["traceEvents"]) == len(events)
+    assert all(e["ph"] == "X" for e in data["traceEvents"])
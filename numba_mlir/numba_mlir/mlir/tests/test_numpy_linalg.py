@@ -365,6 +365,21 @@ def test_linalg_solve(a_size, b_size, dtype, a_order, b_order):
     _solve_checker(py_func, jit_func, a, b)
 
 
+@pytest.mark.parametrize("dtype", _linalg_dtypes)
+def test_linalg_solve_strided(dtype):
+    def py_func(a, b):
+        return np.linalg.solve(a, b)
+
+    jit_func = njit(py_func)
+
+    a = _specific_sample_matrix((7, 14), dtype, "C")[:, ::2]
+    b = _specific_sample_matrix((7, 1), dtype, "C").reshape((7,))
+    a_orig = a.copy()
+
+    _solve_checker(py_func, jit_func, a, b)
+    np.testing.assert_array_equal(a, a_orig)
+
+
 def test_linalg_solve_empty():
     def py_func(a, b):
         return np.linalg.solve(a, b)
@@ -475,3 +490,54 @@ def test_linalg_eig(n, dtype, order, func):
 
     a = _sample_matrix(n, dtype, order)
     checker(a)
+
+
+@pytest.mark.parametrize("n", [1, 7, 16, 100])
+@pytest.mark.parametrize("dtype", _linalg_dtypes)
+@pytest.mark.parametrize("func", ["fft", "ifft"])
+def test_fft(n, dtype, func):
+    func = eval("np.fft." + func)
+
+    def py_func(a):
+        return func(a)
+
+    jit_func = njit(py_func)
+
+    a = (np.arange(n) * np.sin(np.arange(n))).astype(dtype)
+    np.testing.assert_allclose(py_func(a), jit_func(a), rtol=1e-5, atol=1e-5)
+    np.testing.assert_allclose(py_func(a[::2]), jit_func(a[::2]), rtol=1e-5, atol=1e-5)
+
+
+@pytest.mark.parametrize("n", [1, 7, 16, 100])
+@pytest.mark.parametrize("dtype", [np.float32, np.float64])
+def test_rfft(n, dtype):
+    def py_func(a):
+        return np.fft.rfft(a)
+
+    jit_func = njit(py_func)
+
+    a = np.cos(np.arange(n, dtype=dtype))
+    np.testing.assert_allclose(py_func(a), jit_func(a), rtol=1e-5, atol=1e-5)
+
+
+@pytest.mark.parametrize("shape", [(1, 1), (4, 7), (16, 16)])
+@pytest.mark.parametrize("dtype", _linalg_dtypes)
+@pytest.mark.parametrize("order", "CF")
+def test_fft2(shape, dtype, order):
+    def py_func(a):
+        return np.fft.fft2(a)
+
+    jit_func = njit(py_func)
+
+    a = np.arange(np.prod(shape), dtype=dtype).reshape(shape, order=order)
+    np.testing.assert_allclose(py_func(a), jit_func(a), rtol=1e-5, atol=1e-5)
+
+
+def test_fft_roundtrip():
+    def py_func(a):
+        return np.fft.ifft(np.fft.fft(a))
+
+    jit_func = njit(py_func)
+
+    a = np.sin(np.arange(1000, dtype=np.float64))
+    np.testing.assert_allclose(jit_func(a), a, rtol=1e-10, atol=1e-10)
@@ -3,30 +3,118 @@
 # SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
 import inspect
-from numba.core.typing.templates import CallableTemplate
-from numba.core import types
+import numpy
+from numba.core.typing.templates import AbstractTemplate, Signature, signature
+from numba.core import types, sigutils
+from numba.np.numpy_support import as_dtype, from_dtype
 
 from .target import infer_global
-from .linalg_builder import eltwise
+from .linalg_builder import (
+    eltwise,
+    convert_array,
+    get_array_type,
+    type_to_numpy,
+    type_from_numpy,
+)
 from .numpy.funcs import register_func
 
 import sys
 
 
-def vectorize(arg_or_function=(), **kws):
-    if inspect.isfunction(arg_or_function):
-        return _gen_vectorize(arg_or_function)
+_targets = {
+    "cpu": {},
+    "parallel": {"parallel": True},
+    "gpu": {"enable_gpu_pipeline": True},
+}
 
-    return _gen_vectorize
 
+def vectorize(ftylist_or_function=(), **kws):
+    if inspect.isfunction(ftylist_or_function):
+        return _gen_vectorize(ftylist_or_function, (), kws)
 
-class _VecFuncTyper(CallableTemplate):
-    def generic(self):
-        def typer(a):
-            if isinstance(a, types.Array):
-                return a
+    sigs = ftylist_or_function
+    if isinstance(sigs, (str, Signature)):
+        sigs = [sigs]
 
-        return typer
+    def wrapper(func):
+        return _gen_vectorize(func, sigs, kws)
+
+    return wrapper
+
+
+def _get_dtype(t):
+    t = types.unliteral(t)
+    if isinstance(t, types.Array):
+        return t.dtype
+
+    return t
+
+
+class _VectorizedFunc:
+    """
+    Scalar function with its explicit signatures.
+
+    All inputs are converted to the common type during broadcasting, so
+    signature is selected for the inputs common type.
+    """
+
+    def __init__(self, jit_func, sigs):
+        self.jit_func = jit_func
+        self.sigs = []
+        for sig in sigs:
+            args, ret = sigutils.normalize_signature(sig)
+            if ret is None:
+                ret = self._compile(args)
+            else:
+                self.jit_func.compile(args)
+
+            self.sigs.append((args, ret))
+
+    def _compile(self, args):
+        self.jit_func.compile(args)
+        return self.jit_func.overloads[args].signature.return_type
+
+    def get_signature(self, arg_types):
+        """
+        Returns `(arg_types, return_type)` for the scalar function call, or
+        `None` if arguments are not supported.
+        """
+        try:
+            dtypes = [as_dtype(_get_dtype(t)) for t in arg_types]
+        except NotImplementedError:
+            return None
+
+        common = numpy.result_type(*dtypes)
+
+        if not self.sigs:
+            args = (from_dtype(common),) * len(arg_types)
+            return args, self._compile(args)
+
+        for args, ret in self.sigs:
+            if len(args) != len(arg_types):
+                continue
+
+            if all(numpy.can_cast(common, as_dtype(a), "safe") for a in args):
+                return args, ret
+
+        return None
+
+
+class _VecFuncTyper(AbstractTemplate):
+    def generic(self, args, kws):
+        if kws or not args:
+            return
+
+        sig = self.key._vectorized_func.get_signature(args)
+        if sig is None:
+            return
+
+        _, res = sig
+        ndims = [a.ndim for a in args if isinstance(a, types.Array)]
+        if ndims:
+            res = types.Array(res, max(ndims), "C")
+
+        return signature(res, *args)
 
 
 def _gen_vectorized_func_name(func, mod):
@@ -42,29 +130,72 @@ def _gen_vectorized_func_name(func, mod):
         i += 1
 
 
-def _gen_vectorize(func):
-    num_args = len(inspect.signature(func).parameters)
-    if num_args == 1:
-        mod = sys.modules[__name__]
-        func_name = _gen_vectorized_func_name(func, mod)
-
-        exec(f"def {func_name}(arg): pass")
-        vec_func_inner = eval(func_name)
-
-        setattr(mod, func_name, vec_func_inner)
-        infer_global(vec_func_inner)(_VecFuncTyper)
+def _gen_func(name, num_args, body, func_globals=None):
+    params = ", ".join(f"a{i}" for i in range(num_args))
+    res = {}
+    exec(f"def {name}({params}):\n    {body}", func_globals or {}, res)
+    return res[name]
 
-        from ..decorators import mlir_njit
 
-        jit_func = mlir_njit(func, mlir_force_inline=True)
+def _gen_vectorize(func, sigs, kws):
+    target = kws.get("target", "cpu")
+    if target not in _targets:
+        raise ValueError(f"Unsupported vectorize target: {target}")
 
-        @register_func(func_name, vec_func_inner)
-        def impl(builder, arg):
-            return eltwise(builder, arg, lambda a, b: jit_func(a))
-
-        def vec_func(arg):
-            return vec_func_inner(arg)
-
-        return mlir_njit(vec_func, mlir_force_inline=True)
-    else:
-        assert False
+    num_args = len(inspect.signature(func).parameters)
+    if num_args == 0:
+        raise ValueError("Vectorized function must have at least one argument")
+
+    mod = sys.modules[__name__]
+    func_name = _gen_vectorized_func_name(func, mod)
+
+    vec_func_inner = _gen_func(func_name, num_args, "pass")
+
+    from ..decorators import mlir_njit
+
+    jit_func = mlir_njit(func, mlir_force_inline=True)
+    vectorized_func = _VectorizedFunc(jit_func, sigs)
+    vec_func_inner._vectorized_func = vectorized_func
+
+    setattr(mod, func_name, vec_func_inner)
+    infer_global(vec_func_inner)(_VecFuncTyper)
+
+    # Linalg body gets extra output element argument.
+    body = _gen_func(
+        "body",
+        num_args + 1,
+        f"return jit_func({', '.join(f'a{i}' for i in range(num_args))})",
+        {"jit_func": jit_func},
+    )
+
+    @register_func(func_name, vec_func_inner)
+    def impl(builder, *args):
+        dtypes = tuple(
+            from_dtype(type_to_numpy(builder, get_array_type(builder, a)))
+            for a in args
+        )
+        sig = vectorized_func.get_signature(dtypes)
+        if sig is None:
+            return None
+
+        arg_types, res_type = sig
+        res_type = type_from_numpy(builder, as_dtype(res_type))
+        new_args = []
+        for arg, t in zip(args, arg_types):
+            t = type_from_numpy(builder, as_dtype(t))
+            if isinstance(arg, (int, float)):
+                new_args.append(builder.cast(arg, t))
+            else:
+                new_args.append(convert_array(builder, arg, t))
+
+        new_args = new_args[0] if num_args == 1 else tuple(new_args)
+        return eltwise(builder, new_args, body, res_type)
+
+    vec_func = _gen_func(
+        "vec_func",
+        num_args,
+        f"return vec_func_inner({', '.join(f'a{i}' for i in range(num_args))})",
+        {"vec_func_inner": vec_func_inner},
+    )
+
+    return mlir_njit(vec_func, mlir_force_inline=True, **_targets[target])
@@ -4,14 +4,34 @@
 
 #include "CheckGpuCaps.hpp"
 
+#include <mutex>
+
 #include <pybind11/pybind11.h>
 
+#include <llvm/ADT/StringMap.h>
+
 namespace py = pybind11;
 
-std::optional<std::pair<std::string, numba::OffloadDeviceCapabilities>>
-numba::getDefaultDevice() {
-  py::object mod = py::module::import("numba_mlir.mlir.dpctl_interop");
-  py::object res = mod.attr("get_default_device")();
+using DeviceCaps = std::pair<std::string, numba::OffloadDeviceCapabilities>;
+
+namespace {
+/// Device filter string and capabilities, keyed by the device string, used
+/// by the array type (it can differ from the normalized filter string). Python
+/// and dpctl are only called outside of the lock, so it doesn't interfere with
+/// the GIL.
+struct DeviceCapsCache {
+  std::mutex mutex;
+  llvm::StringMap<DeviceCaps> caps;
+  std::optional<DeviceCaps> defaultDevice;
+};
+} // namespace
+
+static DeviceCapsCache &getCache() {
+  static DeviceCapsCache cache;
+  return cache;
+}
+
+static std::optional<DeviceCaps> parseCaps(py::handle res) {
   if (res.is_none())
     return std::nullopt;
 
@@ -21,5 +41,68 @@ numba::getDefaultDevice() {
   caps.spirvMinorVersion = res.attr("spirv_minor_version").cast<int16_t>();
   caps.hasFP16 = res.attr("has_fp16").cast<bool>();
   caps.hasFP64 = res.attr("has_fp64").cast<bool>();
+  caps.subgroupSize = res.attr("subgroup_size").cast<int32_t>();
   return std::pair{name, caps};
 }
+
+/// Returns device filter string of the array type, without querying the
+/// device, or nullopt if type doesn't have one.
+static std::optional<std::string> getTypeDevice(py::handle arrayType) {
+  for (auto attr : {"filter_string", "device"}) {
+    if (!py::hasattr(arrayType, attr))
+      continue;
+
+    auto device = arrayType.attr(attr);
+    if (py::isinstance<py::str>(device))
+      return device.cast<std::string>();
+  }
+  return std::nullopt;
+}
+
+std::optional<DeviceCaps> numba::getDefaultDevice() {
+  auto &cache = getCache();
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.defaultDevice)
+      return cache.defaultDevice;
+  }
+
+  py::object mod = py::module::import("numba_mlir.mlir.dpctl_interop");
+  auto res = parseCaps(mod.attr("get_default_device")());
+  if (!res)
+    return std::nullopt;
+
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.caps.try_emplace(res->first, *res);
+  cache.defaultDevice = res;
+  return res;
+}
+
+std::optional<DeviceCaps> numba::getDeviceCaps(py::handle arrayType) {
+  auto &cache = getCache();
+  auto device = getTypeDevice(arrayType);
+  if (device) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.caps.find(*device);
+    if (it != cache.caps.end())
+      return it->second;
+  }
+
+  auto res = parseCaps(arrayType.attr("get_device_caps")());
+  if (!res)
+    return std::nullopt;
+
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.caps.try_emplace(res->first, *res);
+  if (device)
+    cache.caps.try_emplace(*device, *res);
+
+  return res;
+}
+
+void numba::invalidateDeviceCaps() {
+  auto &cache = getCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.caps.clear();
+  cache.defaultDevice.reset();
+}
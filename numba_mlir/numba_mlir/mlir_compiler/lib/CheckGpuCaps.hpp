@@ -8,14 +8,31 @@
 #include <optional>
 #include <string>
 
+namespace pybind11 {
+class handle;
+}
+
 namespace numba {
 struct OffloadDeviceCapabilities {
   uint16_t spirvMajorVersion;
   uint16_t spirvMinorVersion;
   bool hasFP16;
   bool hasFP64;
+  int32_t subgroupSize;
 };
 
+/// Returns default device filter string and capabilities. Result is cached
+/// until `invalidateDeviceCaps` call.
 std::optional<std::pair<std::string, numba::OffloadDeviceCapabilities>>
 getDefaultDevice();
+
+/// Returns device filter string and capabilities for the GPU array type
+/// `arrayType`. Capabilities are queried through the type `get_device_caps`
+/// only once per device and cached until `invalidateDeviceCaps` call.
+std::optional<std::pair<std::string, numba::OffloadDeviceCapabilities>>
+getDeviceCaps(pybind11::handle arrayType);
+
+/// Drops cached devices capabilities, must be called if set of the available
+/// devices changed.
+void invalidateDeviceCaps();
 } // namespace numba
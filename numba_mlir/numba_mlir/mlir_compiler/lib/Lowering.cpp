@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include <array>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -21,32 +22,43 @@
 #include <mlir/Dialect/Func/Extensions/InlinerExtension.h>
 #include <mlir/Dialect/Func/IR/FuncOps.h>
 #include <mlir/Dialect/GPU/Transforms/BufferDeallocationOpInterfaceImpl.h>
+#include <mlir/Dialect/LLVMIR/LLVMDialect.h>
 #include <mlir/Dialect/SCF/IR/SCF.h>
 #include <mlir/Dialect/SCF/Transforms/BufferDeallocationOpInterfaceImpl.h>
 #include <mlir/IR/Builders.h>
 #include <mlir/IR/BuiltinOps.h>
 #include <mlir/IR/BuiltinTypes.h>
+#include <mlir/IR/Diagnostics.h>
+#include <mlir/Parser/Parser.h>
 
 #include <mlir/Target/LLVMIR/Dialect/Builtin/BuiltinToLLVMIRTranslation.h>
 #include <mlir/Target/LLVMIR/Dialect/LLVMIR/LLVMToLLVMIRTranslation.h>
 #include <mlir/Target/LLVMIR/Export.h>
 
+#include <llvm/ADT/StringSwitch.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
 #include <llvm/ExecutionEngine/Orc/Mangling.h>
 #include <llvm/Support/Debug.h>
+#include <llvm/Support/FileSystem.h>
 #include <llvm/Support/ManagedStatic.h>
+#include <llvm/Support/MemoryBuffer.h>
 #include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/ThreadPool.h>
 
 #include "numba/Dialect/gpu_runtime/IR/GpuRuntimeOps.hpp"
 #include "numba/Dialect/ntensor/IR/NTensorOps.hpp"
 #include "numba/Dialect/numba_util/Dialect.hpp"
 #include "numba/Dialect/plier/Dialect.hpp"
 
+#include "numba/Compiler/CompileProfile.hpp"
 #include "numba/Compiler/Compiler.hpp"
 #include "numba/Compiler/PipelineRegistry.hpp"
+#include "numba/ExecutionEngine/DiskCache.hpp"
 #include "numba/ExecutionEngine/ExecutionEngine.hpp"
+#include "numba/Transforms/CompositePass.hpp"
 #include "numba/Utils.hpp"
 
+#include "CheckGpuCaps.hpp"
 #include "PyTypeConverter.hpp"
 #include "pipelines/BasePipeline.hpp"
 #include "pipelines/LowerToGpu.hpp"
@@ -294,6 +306,14 @@ static mlir::Attribute parseAttr(mlir::OpBuilder &builder, py::handle obj) {
   if (py::isinstance<py::int_>(obj))
     return builder.getI64IntegerAttr(getPyInt(obj));
 
+  if (py::isinstance<py::tuple>(obj) || py::isinstance<py::list>(obj)) {
+    llvm::SmallVector<mlir::Attribute> elems;
+    for (auto elem : obj)
+      elems.emplace_back(parseAttr(builder, elem));
+
+    return builder.getArrayAttr(elems);
+  }
+
   numba::reportError(llvm::Twine("Invalid attribute: ") +
                      py::str(obj).cast<std::string>());
 }
@@ -308,6 +328,49 @@ static void parseAttributes(mlir::Operation *op, py::handle dict) {
   }
 }
 
+/// Opcodes of the flat IR, must be kept in sync with `flat_ir.py`.
+enum class FlatOp : int64_t {
+  Block = 0,
+  AssignArg,
+  AssignVar,
+  AssignConst,
+  AssignGlobal,
+  Binop,
+  InplaceBinop,
+  Unary,
+  Cast,
+  Call,
+  Phi,
+  BuildTuple,
+  Getitem,
+  StaticGetitem,
+  Getiter,
+  Iternext,
+  PairFirst,
+  PairSecond,
+  Getattr,
+  ExhaustIter,
+  Setitem,
+  StaticSetitem,
+  Del,
+  Return,
+  Branch,
+  Jump,
+};
+
+struct FlatReader {
+  const int64_t *data = nullptr;
+  size_t size = 0;
+  size_t pos = 0;
+
+  int64_t next() {
+    if (pos >= size)
+      numba::reportError("Unexpected end of flat IR");
+
+    return data[pos++];
+  }
+};
+
 struct PlierLowerer final {
   PlierLowerer(mlir::MLIRContext &context, PyTypeConverter &conv)
       : ctx(context), builder(&ctx), insts(getInstHandles()),
@@ -325,7 +388,12 @@ struct PlierLowerer final {
                            mlir::ModuleOp mod, const py::object &funcIr) {
     TIME_FUNC();
     auto newFunc = createFunc(compilationContext, mod);
-    lowerFuncBody(funcIr);
+    auto flatIr = getFlatIr(compilationContext);
+    if (flatIr.is_none()) {
+      lowerFuncBody(funcIr);
+    } else {
+      lowerFlatFuncBody(flatIr);
+    }
     return newFunc;
   }
 
@@ -362,18 +430,17 @@ struct PlierLowerer final {
       getIndexVal(loop.attr("step"));
     }
 
-    auto caps = compilationContext["device_caps"];
+    auto deviceType = compilationContext["device_array_type"];
     mlir::Attribute env;
-    if (!caps.is_none()) {
-      auto device = caps.attr("filter_string").cast<std::string>();
-      auto usmType = "device";
-      auto spirvMajor = caps.attr("spirv_major_version").cast<int16_t>();
-      auto spirvMinor = caps.attr("spirv_minor_version").cast<int16_t>();
-      auto hasFP16 = caps.attr("has_fp16").cast<bool>();
-      auto hasFP64 = caps.attr("has_fp64").cast<bool>();
-      env = gpu_runtime::GPURegionDescAttr::get(builder.getContext(), device,
-                                                usmType, spirvMajor, spirvMinor,
-                                                hasFP16, hasFP64);
+    if (!deviceType.is_none()) {
+      if (auto deviceCaps = numba::getDeviceCaps(deviceType)) {
+        auto &[device, caps] = *deviceCaps;
+        auto usmType = "device";
+        env = gpu_runtime::GPURegionDescAttr::get(
+            builder.getContext(), device, usmType, caps.spirvMajorVersion,
+            caps.spirvMinorVersion, caps.hasFP16, caps.hasFP64,
+            caps.subgroupSize);
+      }
     }
 
     builder.setInsertionPointToStart(block);
@@ -461,11 +528,22 @@ private:
   py::object funcNameResolver;
   py::object globals;
   py::object cellvars;
+  std::unordered_map<size_t, py::object> constArgs;
 
   std::unordered_map<mlir::Block *, BlockInfo> blockInfos;
 
   PyTypeConverter &typeConverter;
 
+  // Flat IR lowering state, see `flat_ir.py`.
+  py::list flatVarNames;
+  py::list flatVarTypes;
+  py::list flatObjects;
+  std::vector<mlir::Value> flatVars;
+  std::vector<mlir::Type> flatTypes;
+  llvm::DenseMap<PyObject *, mlir::Type> flatTypesCache;
+  llvm::DenseMap<int64_t, std::optional<mlir::Attribute>> flatConsts;
+  llvm::DenseMap<int64_t, llvm::StringRef> flatOps;
+
   void insertBlock(int id, mlir::Block *block) {
     assert(block && "Invalid block");
     if (blocksMap.count(id))
@@ -476,15 +554,18 @@ private:
     blocksMap.insert(std::pair{id, block});
   }
 
-  mlir::Block *getBlock(py::handle id) const {
-    auto i = id.cast<int>();
-    auto it = blocksMap.find(i);
+  mlir::Block *getBlock(int64_t id) const {
+    auto it = blocksMap.find(static_cast<int>(id));
     if (it == blocksMap.end())
-      numba::reportError(llvm::Twine("Invalid block id: ") + llvm::Twine(i));
+      numba::reportError(llvm::Twine("Invalid block id: ") + llvm::Twine(id));
 
     return it->second;
   }
 
+  mlir::Block *getBlock(py::handle id) const {
+    return getBlock(id.cast<int64_t>());
+  }
+
   mlir::func::FuncOp createFunc(const py::object &compilationContext,
                                 mlir::ModuleOp mod) {
     TIME_FUNC();
@@ -501,6 +582,12 @@ private:
     globals = compilationContext["globals"]();
     cellvars = compilationContext["cellvars"]();
 
+    if (compilationContext.contains("const_args")) {
+      auto constArgsDict = compilationContext["const_args"].cast<py::dict>();
+      for (auto &&[index, value] : constArgsDict)
+        constArgs[index.cast<size_t>()] = value.cast<py::object>();
+    }
+
     mod.push_back(func);
     return func;
   }
@@ -534,6 +621,322 @@ private:
     fixupPhis();
   }
 
+  static py::object getFlatIr(const py::object &compilationContext) {
+    if (!compilationContext.contains("flat_ir"))
+      return py::none();
+
+    return compilationContext["flat_ir"]();
+  }
+
+  void lowerFlatFuncBody(py::handle flatIr) {
+    TIME_FUNC();
+    auto code = flatIr.attr("code").cast<py::buffer>().request();
+    if (code.ndim != 1 || code.itemsize != sizeof(int64_t))
+      numba::reportError("Invalid flat IR buffer");
+
+    FlatReader reader{static_cast<const int64_t *>(code.ptr),
+                      static_cast<size_t>(code.size)};
+    flatVarNames = flatIr.attr("var_names").cast<py::list>();
+    flatVarTypes = flatIr.attr("var_types").cast<py::list>();
+    flatObjects = flatIr.attr("objects").cast<py::list>();
+    flatVars.assign(flatVarNames.size(), mlir::Value());
+    flatTypes.assign(flatVarNames.size(), mlir::Type());
+
+    auto numBlocks = static_cast<size_t>(reader.next());
+    if (numBlocks == 0)
+      numba::reportError("Empty function body");
+
+    blocks.reserve(numBlocks);
+    for (auto i : llvm::seq<size_t>(0, numBlocks)) {
+      auto block = (0 == i ? func.addEntryBlock() : func.addBlock());
+      insertBlock(static_cast<int>(reader.next()), block);
+    }
+
+    for (auto i : llvm::seq<size_t>(0, numBlocks)) {
+      (void)i;
+      if (static_cast<FlatOp>(reader.next()) != FlatOp::Block)
+        numba::reportError("Invalid flat IR block header");
+
+      auto block = getBlock(reader.next());
+      auto numInsts = reader.next();
+      mlir::OpBuilder::InsertionGuard g(builder);
+      builder.setInsertionPointToEnd(block);
+      for (auto j : llvm::seq<int64_t>(0, numInsts)) {
+        (void)j;
+        lowerFlatInst(reader);
+      }
+    }
+
+    // Phi nodes refer the incoming vars by name.
+    for (auto &&[i, var] : llvm::enumerate(flatVars))
+      if (var)
+        varsMap[flatVarNames[i].cast<std::string>()] = var;
+
+    fixupPhis();
+  }
+
+  py::object getFlatObject(int64_t index) const {
+    if (index < 0 || static_cast<size_t>(index) >= flatObjects.size())
+      numba::reportError(llvm::Twine("Invalid flat IR object: ") +
+                         llvm::Twine(index));
+
+    return flatObjects[static_cast<size_t>(index)];
+  }
+
+  std::string getFlatObjectStr(int64_t index) const {
+    return getFlatObject(index).cast<std::string>();
+  }
+
+  void checkFlatVar(int64_t index) const {
+    if (index < 0 || static_cast<size_t>(index) >= flatVars.size())
+      numba::reportError(llvm::Twine("Invalid flat IR var: ") +
+                         llvm::Twine(index));
+  }
+
+  mlir::Value flatLoadvar(int64_t index) const {
+    checkFlatVar(index);
+    auto var = flatVars[static_cast<size_t>(index)];
+    if (!var)
+      numba::reportError(llvm::Twine("Invalid var: ") +
+                         flatVarNames[static_cast<size_t>(index)]
+                             .cast<std::string>());
+
+    return var;
+  }
+
+  mlir::Type getFlatType(int64_t index) {
+    checkFlatVar(index);
+    auto &type = flatTypes[static_cast<size_t>(index)];
+    if (!type) {
+      // Types are deduplicated on python side, so cache by object identity.
+      py::object pyType = flatVarTypes[static_cast<size_t>(index)];
+      auto &cached = flatTypesCache[pyType.ptr()];
+      if (!cached)
+        cached = getObjType(pyType);
+
+      type = cached;
+    }
+    return type;
+  }
+
+  void flatStorevar(int64_t index, mlir::Value val) {
+    auto type = getFlatType(index);
+    flatVars[static_cast<size_t>(index)] = setVarType(val, type);
+  }
+
+  std::optional<mlir::Attribute> getFlatConst(int64_t index) {
+    auto it = flatConsts.find(index);
+    if (it != flatConsts.end())
+      return it->second;
+
+    auto attr = resolveConstant(getFlatObject(index));
+    flatConsts.insert({index, attr});
+    return attr;
+  }
+
+  llvm::StringRef getFlatOp(int64_t index) {
+    auto &op = flatOps[index];
+    if (op.empty())
+      op = resolveOp(getFlatObject(index));
+
+    return op;
+  }
+
+  void lowerFlatInst(FlatReader &reader) {
+    auto loc = getCurrentLoc();
+    auto op = static_cast<FlatOp>(reader.next());
+    switch (op) {
+    case FlatOp::Setitem: {
+      auto target = flatLoadvar(reader.next());
+      auto index = flatLoadvar(reader.next());
+      auto value = flatLoadvar(reader.next());
+      builder.create<plier::SetItemOp>(loc, target, index, value);
+      return;
+    }
+    case FlatOp::StaticSetitem: {
+      auto target = flatLoadvar(reader.next());
+      auto index = lowerStaticIndex(loc, getFlatObject(reader.next()));
+      auto value = flatLoadvar(reader.next());
+      builder.create<plier::SetItemOp>(loc, target, index, value);
+      return;
+    }
+    case FlatOp::Del:
+      builder.create<plier::DelOp>(loc, flatLoadvar(reader.next()));
+      return;
+    case FlatOp::Return:
+      retval(flatLoadvar(reader.next()));
+      return;
+    case FlatOp::Branch: {
+      auto cond = flatLoadvar(reader.next());
+      auto trBlock = getBlock(reader.next());
+      auto flBlock = getBlock(reader.next());
+      branch(cond, trBlock, flBlock);
+      return;
+    }
+    case FlatOp::Jump:
+      jump(getBlock(reader.next()));
+      return;
+    default: {
+      auto target = reader.next();
+      auto val = lowerFlatAssign(op, target, reader);
+      flatStorevar(target, val);
+      return;
+    }
+    }
+  }
+
+  mlir::Value lowerFlatAssign(FlatOp op, int64_t target, FlatReader &reader) {
+    auto loc = getCurrentLoc();
+    switch (op) {
+    case FlatOp::AssignArg: {
+      auto index = reader.next();
+      if (index < 0)
+        numba::reportError(llvm::Twine("Invalid arg index: \"") +
+                           llvm::Twine(index) + "\"");
+
+      return getArg(static_cast<size_t>(index));
+    }
+    case FlatOp::AssignVar:
+      return flatLoadvar(reader.next());
+    case FlatOp::AssignConst: {
+      auto index = reader.next();
+      auto attr = getFlatConst(index);
+      if (!attr)
+        numba::reportError(
+            llvm::Twine("getConst unhandled type \"") +
+            py::str(getFlatObject(index).get_type()).cast<std::string>() +
+            "\"");
+
+      return builder.create<plier::ConstOp>(loc, *attr);
+    }
+    case FlatOp::AssignGlobal: {
+      auto attr = getFlatConst(reader.next());
+      auto name = getFlatObjectStr(reader.next());
+      if (attr)
+        return builder.create<plier::ConstOp>(loc, *attr);
+
+      return builder.create<plier::GlobalOp>(loc, name);
+    }
+    case FlatOp::Binop:
+    case FlatOp::InplaceBinop: {
+      auto opName = getFlatOp(reader.next());
+      auto lhs = flatLoadvar(reader.next());
+      auto rhs = flatLoadvar(reader.next());
+      if (op == FlatOp::Binop)
+        return builder.create<plier::BinOp>(loc, lhs, rhs, opName);
+
+      return builder.create<plier::InplaceBinOp>(loc, lhs, rhs, opName);
+    }
+    case FlatOp::Unary: {
+      auto opName = getFlatOp(reader.next());
+      auto val = flatLoadvar(reader.next());
+      return builder.create<plier::UnaryOp>(loc, val, opName);
+    }
+    case FlatOp::Cast: {
+      auto value = flatLoadvar(reader.next());
+      return builder.create<plier::CastOp>(loc, getFlatType(target), value);
+    }
+    case FlatOp::Call: {
+      auto funcIndex = reader.next();
+      auto funcVal = flatLoadvar(funcIndex);
+      auto pyFuncName = getFlatObject(reader.next());
+      auto varargIndex = reader.next();
+      auto varargVar =
+          (varargIndex < 0 ? mlir::Value() : flatLoadvar(varargIndex));
+
+      auto numArgs = reader.next();
+      mlir::SmallVector<mlir::Value> argsList;
+      argsList.reserve(static_cast<size_t>(numArgs));
+      for (auto i : llvm::seq<int64_t>(0, numArgs)) {
+        (void)i;
+        argsList.push_back(flatLoadvar(reader.next()));
+      }
+
+      auto numKws = reader.next();
+      mlir::SmallVector<std::pair<std::string, mlir::Value>> kwargsList;
+      for (auto i : llvm::seq<int64_t>(0, numKws)) {
+        (void)i;
+        auto name = getFlatObjectStr(reader.next());
+        kwargsList.push_back({name, flatLoadvar(reader.next())});
+      }
+
+      if (pyFuncName.is_none())
+        numba::reportError(llvm::Twine("Can't resolve function: ") +
+                           py::str(flatVarTypes[static_cast<size_t>(funcIndex)])
+                               .cast<std::string>());
+
+      auto funcName = pyFuncName.cast<std::string>();
+      return builder.create<plier::PyCallOp>(loc, funcVal, funcName, argsList,
+                                             varargVar, kwargsList);
+    }
+    case FlatOp::Phi: {
+      auto currentBlock = builder.getBlock();
+      assert(nullptr != currentBlock);
+
+      auto argIndex = currentBlock->getNumArguments();
+      auto arg = currentBlock->addArgument(getFlatType(target),
+                                           builder.getUnknownLoc());
+
+      auto count = reader.next();
+      for (auto i : llvm::seq<int64_t>(0, count)) {
+        (void)i;
+        auto varIndex = reader.next();
+        checkFlatVar(varIndex);
+        auto var = flatVarNames[static_cast<size_t>(varIndex)];
+        auto block = getBlock(reader.next());
+        blockInfos[block].outgoingPhiNodes.push_back(
+            {currentBlock, var.cast<std::string>(), argIndex});
+      }
+      return arg;
+    }
+    case FlatOp::BuildTuple: {
+      auto count = reader.next();
+      mlir::SmallVector<mlir::Value> args;
+      for (auto i : llvm::seq<int64_t>(0, count)) {
+        (void)i;
+        args.push_back(flatLoadvar(reader.next()));
+      }
+      return builder.create<plier::BuildTupleOp>(loc, args);
+    }
+    case FlatOp::Getitem: {
+      auto value = flatLoadvar(reader.next());
+      auto index = flatLoadvar(reader.next());
+      return builder.create<plier::GetItemOp>(loc, value, index);
+    }
+    case FlatOp::StaticGetitem: {
+      auto value = flatLoadvar(reader.next());
+      auto index = lowerStaticIndex(loc, getFlatObject(reader.next()));
+      return builder.create<plier::GetItemOp>(loc, value, index);
+    }
+    case FlatOp::Getiter:
+      return builder.create<plier::GetiterOp>(loc,
+                                              flatLoadvar(reader.next()));
+    case FlatOp::Iternext:
+      return builder.create<plier::IternextOp>(loc,
+                                               flatLoadvar(reader.next()));
+    case FlatOp::PairFirst:
+      return builder.create<plier::PairfirstOp>(loc,
+                                                flatLoadvar(reader.next()));
+    case FlatOp::PairSecond:
+      return builder.create<plier::PairsecondOp>(loc,
+                                                 flatLoadvar(reader.next()));
+    case FlatOp::Getattr: {
+      auto value = flatLoadvar(reader.next());
+      auto name = getFlatObjectStr(reader.next());
+      return lowerGetattr(value, name);
+    }
+    case FlatOp::ExhaustIter: {
+      auto value = flatLoadvar(reader.next());
+      auto count = reader.next();
+      return builder.create<plier::ExhaustIterOp>(loc, value, count);
+    }
+    default:
+      break;
+    }
+    numba::reportError(llvm::Twine("Invalid flat IR opcode: ") +
+                       llvm::Twine(static_cast<int64_t>(op)));
+  }
+
   mlir::ValueRange lowerParforBody(py::handle parforInst) {
     TIME_FUNC();
     auto indexType = builder.getIndexType();
@@ -716,6 +1119,11 @@ private:
     auto loop = loopBuilder.create<mlir::scf::ForOp>(
         loc, begins.front(), ends.front(), steps.front(), iterArgs,
         forBodyBuilder);
+
+    // Numba parfor pass already fused loops and checked them for races, MLIR
+    // pipeline doesn't need to rediscover parallelism for them.
+    loop->setAttr(numba::util::attributes::getParforLoweredName(),
+                  loopBuilder.getUnitAttr());
     return loop.getResults();
   }
 
@@ -761,15 +1169,8 @@ private:
 
   mlir::Value lowerAssign(py::handle inst, py::handle target) {
     auto value = inst.attr("value");
-    if (py::isinstance(value, insts.Arg)) {
-      auto index = value.attr("index").cast<std::size_t>();
-      auto args = func.getFunctionBody().front().getArguments();
-      if (index >= args.size())
-        numba::reportError(llvm::Twine("Invalid arg index: \"") +
-                           llvm::Twine(index) + "\"");
-
-      return args[index];
-    }
+    if (py::isinstance(value, insts.Arg))
+      return getArg(value.attr("index").cast<std::size_t>());
 
     if (py::isinstance(value, insts.Expr))
       return lowerExpr(value);
@@ -793,6 +1194,21 @@ private:
                        py::str(value.get_type()).cast<std::string>() + "\"");
   }
 
+  mlir::Value getArg(size_t index) {
+    auto args = func.getFunctionBody().front().getArguments();
+    if (index >= args.size())
+      numba::reportError(llvm::Twine("Invalid arg index: \"") +
+                         llvm::Twine(index) + "\"");
+
+    // Argument value is known at compile time, fold it into the body, actual
+    // argument is left unused.
+    auto it = constArgs.find(index);
+    if (it != constArgs.end())
+      return getConst(it->second);
+
+    return args[index];
+  }
+
   mlir::Value lowerExpr(py::handle expr) {
     auto op = expr.attr("op").cast<std::string>();
     using func_t = mlir::Value (PlierLowerer::*)(py::handle);
@@ -1086,6 +1502,10 @@ private:
   mlir::Value lowerGetattr(py::handle inst) {
     auto value = loadvar(inst.attr("value"));
     auto name = inst.attr("attr").cast<std::string>();
+    return lowerGetattr(value, name);
+  }
+
+  mlir::Value lowerGetattr(mlir::Value value, const std::string &name) {
     auto loc = getCurrentLoc();
     if (auto attr = resolveGlobalAttr(value, name)) {
       // Resolve constant attributes early.
@@ -1113,14 +1533,19 @@ private:
         loc, loadvar(target), lowerStaticIndex(loc, index), loadvar(value));
   }
 
-  void storevar(mlir::Value val, py::handle inst) {
-    auto type = getType(inst);
+  mlir::Value setVarType(mlir::Value val, mlir::Type type) {
     if (val.getDefiningOp()) {
       val.setType(type);
     } else {
       // TODO: unify
       val = builder.create<plier::CastOp>(getCurrentLoc(), type, val);
     }
+    return val;
+  }
+
+  void storevar(mlir::Value val, py::handle inst) {
+    auto type = getType(inst);
+    val = setVarType(val, type);
     varsMap[inst.attr("name").cast<std::string>()] = val;
   }
 
@@ -1141,8 +1566,9 @@ private:
     builder.create<plier::DelOp>(getCurrentLoc(), var);
   }
 
-  void retvar(py::handle inst) {
-    auto var = loadvar(inst);
+  void retvar(py::handle inst) { retval(loadvar(inst)); }
+
+  void retval(mlir::Value var) {
     auto funcType = func.getFunctionType();
     auto retType = funcType.getResult(0);
     auto varType = var.getType();
@@ -1153,17 +1579,19 @@ private:
   }
 
   void branch(py::handle cond, py::handle tr, py::handle fl) {
-    auto c = loadvar(cond);
-    auto trBlock = getBlock(tr);
-    auto flBlock = getBlock(fl);
+    branch(loadvar(cond), getBlock(tr), getBlock(fl));
+  }
+
+  void branch(mlir::Value c, mlir::Block *trBlock, mlir::Block *flBlock) {
     auto condVal = builder.create<plier::CastOp>(
         getCurrentLoc(), mlir::IntegerType::get(&ctx, 1), c);
     builder.create<mlir::cf::CondBranchOp>(getCurrentLoc(), condVal, trBlock,
                                            flBlock);
   }
 
-  void jump(py::handle target) {
-    auto block = getBlock(target);
+  void jump(py::handle target) { jump(getBlock(target)); }
+
+  void jump(mlir::Block *block) {
     builder.create<mlir::cf::BranchOp>(getCurrentLoc(), std::nullopt, block);
   }
 
@@ -1327,22 +1755,153 @@ struct DialectReg {
     mlir::cf::registerBufferDeallocationOpInterfaceExternalModels(registry);
     mlir::gpu::registerBufferDeallocationOpInterfaceExternalModels(registry);
     mlir::scf::registerBufferDeallocationOpInterfaceExternalModels(registry);
+    mlir::registerLLVMDialectTranslation(registry);
+    mlir::registerBuiltinDialectTranslation(registry);
   }
 };
 
-struct Module {
+/// Long-lived context, pipeline registry and type converter, shared between
+/// all modules with the same settings, so small functions compilation doesn't
+/// pay for context creation, dialects loading and pipelines registration.
+/// Each environment is used by a single module at a time and returned to the
+/// pool, when module is destroyed, so modules, created and compiled by
+/// different python threads, never share the context, and environments count
+/// is bounded by the number of simultaneously alive modules.
+/// Context never frees uniqued types and attributes (e.g. symbol names and
+/// locations of the compiled functions), so environment is destroyed instead
+/// of being returned to the pool after it was used for `maxUses` modules.
+struct ModuleEnv {
   DialectReg dialectReg;
   mlir::MLIRContext context;
   numba::PipelineRegistry registry;
-  mlir::ModuleOp module;
   PyTypeConverter typeConverter;
-
-  Module(const ModuleSettings &settings) : context(dialectReg.registry) {
+  bool enableGpuPipeline = false;
+  size_t uses = 0;
+
+  ModuleEnv(const ModuleSettings &settings)
+      : context(dialectReg.registry, mlir::MLIRContext::Threading::DISABLED),
+        enableGpuPipeline(settings.enableGpuPipeline) {
+    context.loadDialect<gpu_runtime::GpuRuntimeDialect>();
+    context.loadDialect<mlir::cf::ControlFlowDialect>();
+    context.loadDialect<mlir::func::FuncDialect>();
+    context.loadDialect<mlir::scf::SCFDialect>();
+    context.loadDialect<mlir::LLVM::LLVMDialect>();
+    context.loadDialect<numba::ntensor::NTensorDialect>();
+    context.loadDialect<numba::util::NumbaUtilDialect>();
+    context.loadDialect<plier::PlierDialect>();
     createPipeline(registry, typeConverter, settings);
   }
+
+  static ModuleEnv &acquire(const ModuleSettings &settings) {
+    auto &pool = getPool();
+    {
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      auto &envs = pool.freeEnvs[settings.enableGpuPipeline ? 1 : 0];
+      if (!envs.empty()) {
+        auto env = envs.pop_back_val();
+        ++env->uses;
+        return *env;
+      }
+
+      ++pool.count;
+    }
+    auto env = new ModuleEnv(settings);
+    env->uses = 1;
+    return *env;
+  }
+
+  static void release(ModuleEnv &env) {
+    auto &pool = getPool();
+    {
+      std::lock_guard<std::mutex> lock(pool.mutex);
+      auto maxUses = pool.maxUses;
+      if (maxUses == 0 || env.uses < maxUses) {
+        pool.freeEnvs[env.enableGpuPipeline ? 1 : 0].emplace_back(&env);
+        return;
+      }
+
+      --pool.count;
+      ++pool.retired;
+    }
+    // Context destruction can be slow, don't hold the lock.
+    delete &env;
+  }
+
+  /// Number of currently existing environments.
+  static size_t getCount() {
+    auto &pool = getPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    return pool.count;
+  }
+
+  /// Number of environments, destroyed after reaching uses limit.
+  static size_t getRetiredCount() {
+    auto &pool = getPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    return pool.retired;
+  }
+
+  /// Set max number of modules, compiled with the single environment, 0 means
+  /// no limit.
+  static void setMaxUses(size_t val) {
+    auto &pool = getPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.maxUses = val;
+  }
+
+private:
+  struct Pool {
+    std::mutex mutex;
+    llvm::SmallVector<ModuleEnv *> freeEnvs[2];
+    size_t count = 0;
+    size_t retired = 0;
+    size_t maxUses = 0;
+  };
+
+  static Pool &getPool() {
+    // Intentionally leaked, type converters hold python objects, which must
+    // not be destroyed after interpreter shutdown.
+    static Pool *pool = new Pool;
+    return *pool;
+  }
 };
 
-static void runCompiler(Module &mod, const py::object &compilationContext) {
+struct Module {
+  ModuleEnv &env;
+  mlir::MLIRContext &context;
+  numba::PipelineRegistry &registry;
+  mlir::ModuleOp module;
+  PyTypeConverter &typeConverter;
+
+  /// Compile time profile of the module, only returned to the user if
+  /// `compile_profile` setting is enabled.
+  numba::CompileProfile profile;
+  bool profileEnabled = false;
+
+  /// Optimization remarks, emitted by the pipeline.
+  llvm::SmallVector<numba::CompilerContext::Remark> remarks;
+
+  bool enableGpuPipeline = false;
+
+  Module(ModuleEnv &e, const ModuleSettings &settings)
+      : env(e), context(e.context), registry(e.registry),
+        typeConverter(e.typeConverter),
+        enableGpuPipeline(settings.enableGpuPipeline) {}
+
+  Module(const Module &) = delete;
+
+  // Context outlives the module, so module must be destroyed explicitly
+  // before returning the environment to the pool.
+  ~Module() {
+    if (module)
+      module.erase();
+
+    ModuleEnv::release(env);
+  }
+};
+
+static void runCompiler(Module &mod, const py::object &compilationContext,
+                        llvm::ThreadPool *threadPool) {
   auto &context = mod.context;
   auto &module = mod.module;
   auto &registry = mod.registry;
@@ -1350,10 +1909,40 @@ static void runCompiler(Module &mod, const py::object &compilationContext) {
   CallbackOstream printStream;
   auto settings =
       getSettings(compilationContext["compiler_settings"], printStream);
+  mod.profileEnabled =
+      compilationContext["compiler_settings"]["compile_profile"].cast<bool>();
+  if (mod.profileEnabled)
+    settings.profile = &mod.profile;
+
+  settings.remarks = &mod.remarks;
+
+  if (threadPool) {
+    if (!context.isMultithreadingEnabled())
+      context.setThreadPool(*threadPool);
+
+    settings.multithreading = true;
+  }
+  numba::CompileProfileScope scope(settings.profile, "driver", "mlir");
   numba::CompilerContext compiler(context, settings, registry);
   compiler.run(module);
 }
 
+static py::dict getProfileDict(const numba::CompileProfile &profile) {
+  py::dict ret;
+  profile.forEach([&](llvm::StringRef group, llvm::StringRef name,
+                      const numba::CompileProfile::Entry &entry) {
+    auto groupName = py::str(group.data(), group.size());
+    if (!ret.contains(groupName))
+      ret[groupName] = py::dict();
+
+    py::dict val;
+    val["time"] = entry.seconds;
+    val["count"] = entry.count;
+    ret[groupName].cast<py::dict>()[py::str(name.data(), name.size())] = val;
+  });
+  return ret;
+}
+
 static auto getLLModulePrinter(py::handle printer) {
   return [func = printer.cast<py::function>()](llvm::Module &m) -> llvm::Error {
     std::string str;
@@ -1361,6 +1950,8 @@ static auto getLLModulePrinter(py::handle printer) {
     m.print(os, nullptr);
     os.flush();
 
+    // May be called from the compile threads.
+    py::gil_scoped_acquire acquire;
     func(py::str(str));
     return llvm::Error::success();
   };
@@ -1368,19 +1959,168 @@ static auto getLLModulePrinter(py::handle printer) {
 
 static auto getPrinter(py::handle printer) {
   return [func = printer.cast<py::function>()](llvm::StringRef str) {
+    py::gil_scoped_acquire acquire;
     func(py::str(str.data(), str.size()));
   };
 }
 
+/// On-disk cache of the MLIR pipeline results, keyed on the input plier
+/// module (including dependent functions, lowered into the same module),
+/// global compiler settings and compiler version, so identical functions,
+/// compiled in different processes, can skip the MLIR pipeline. Only fully
+/// lowered (LLVM dialect) modules are cached.
+class IRCache {
+public:
+  IRCache(llvm::StringRef dir, uint64_t maxSize, std::string salt)
+      : cache(dir, maxSize, ".mlir"), keySalt(std::move(salt)) {}
+
+  /// Compute cache key for module, must be called before running pipeline.
+  std::string getKey(mlir::ModuleOp mod, bool enableGpuPipeline) const {
+    return numba::DiskCache::getKey(
+        {printModule(mod), keySalt, enableGpuPipeline ? "gpu" : "cpu"});
+  }
+
+  mlir::OwningOpRef<mlir::ModuleOp> load(llvm::StringRef key,
+                                         mlir::MLIRContext &ctx) {
+    auto buffer = cache.load(key, /*requiresNullTerminator*/ true);
+    if (!buffer)
+      return nullptr;
+
+    mlir::ScopedDiagnosticHandler diagHandler(
+        &ctx, [](mlir::Diagnostic &) { return mlir::success(); });
+    ctx.loadDialect<mlir::LLVM::LLVMDialect>();
+    auto mod = mlir::parseSourceString<mlir::ModuleOp>(
+        buffer->getBuffer(), mlir::ParserConfig(&ctx));
+
+    // Corrupted or incompatible entries are treated as cache miss and removed,
+    // so they are rewritten after the compilation.
+    if (!mod)
+      cache.remove(key);
+
+    return mod;
+  }
+
+  void store(llvm::StringRef key, mlir::ModuleOp mod) {
+    auto notLowered = mod.walk([](mlir::Operation *op) {
+      auto dialect = op->getName().getDialectNamespace();
+      if (dialect == "llvm" || dialect == "builtin")
+        return mlir::WalkResult::advance();
+
+      return mlir::WalkResult::interrupt();
+    });
+    if (notLowered.wasInterrupted())
+      return;
+
+    cache.store(key, printModule(mod));
+  }
+
+private:
+  numba::DiskCache cache;
+  std::string keySalt;
+
+  static std::string printModule(mlir::ModuleOp mod) {
+    std::string ret;
+    llvm::raw_string_ostream os(ret);
+    mod.print(os, mlir::OpPrintingFlags().enableDebugInfo());
+    os.flush();
+    return ret;
+  }
+};
+
 struct GlobalCompilerContext {
   GlobalCompilerContext(const py::dict &settings)
-      : executionEngine(getOpts(settings)) {}
+      : threadPool(getThreadPool(settings)), irCache(getIRCache(settings)),
+        engineOpts(getOpts(settings)) {}
 
   llvm::llvm_shutdown_obj s;
-  llvm::SmallVector<std::pair<std::string, void *>, 0> symbolList;
-  numba::ExecutionEngine executionEngine;
+
+  /// Thread pool, shared between MLIR contexts, null if multithreaded
+  /// compilation is disabled.
+  std::unique_ptr<llvm::ThreadPool> threadPool;
+
+  /// Aggregated profile of all profiled modules.
+  numba::CompileProfile profile;
+
+  /// MLIR pipeline results cache, null if disabled.
+  std::unique_ptr<IRCache> irCache;
+
+  /// Returns execution engine, creating it on the first call, so importing
+  /// the package doesn't pay for the JIT setup.
+  numba::ExecutionEngine &getExecutionEngine() {
+    std::call_once(engineOnce, [this]() {
+      std::lock_guard<std::mutex> lock(symbolsMutex);
+      executionEngine = std::make_unique<numba::ExecutionEngine>(engineOpts);
+    });
+    return *executionEngine;
+  }
+
+  /// Returns execution engine if it was already created, null otherwise.
+  numba::ExecutionEngine *getExistingExecutionEngine() {
+    std::lock_guard<std::mutex> lock(symbolsMutex);
+    return executionEngine.get();
+  }
+
+  /// Called in the child process after `fork`, only the forking thread exists
+  /// in the child, so locks are not taken. Compile threads pool is leaked, as
+  /// its threads can't be joined, and MLIR pipeline is run single-threaded.
+  void afterForkChild() {
+    (void)threadPool.release();
+    if (executionEngine)
+      executionEngine->afterForkChild();
+  }
+
+  void registerSymbol(std::string name, void *ptr) {
+    std::lock_guard<std::mutex> lock(symbolsMutex);
+    if (executionEngine)
+      executionEngine->defineSymbol(name, ptr);
+
+    symbolList.emplace_back(std::move(name), ptr);
+  }
 
 private:
+  numba::ExecutionEngineOptions engineOpts;
+  std::once_flag engineOnce;
+  std::unique_ptr<numba::ExecutionEngine> executionEngine;
+
+  /// Guards `symbolList` and engine creation, symbols, registered after that,
+  /// are added to the engine directly.
+  std::mutex symbolsMutex;
+  llvm::SmallVector<std::pair<std::string, void *>, 0> symbolList;
+
+  static std::unique_ptr<IRCache> getIRCache(const py::dict &settings) {
+    auto dir = settings["ir_cache_dir"].cast<std::string>();
+    if (dir.empty())
+      return nullptr;
+
+    // Global settings, affecting pipeline results.
+    std::string salt;
+    llvm::raw_string_ostream os(salt);
+    os << settings["ir_cache_version"].cast<std::string>() << ";"
+       << settings["composite_max_iters"].cast<unsigned>() << ";"
+       << settings["stack_alloc_max_size"].cast<uint64_t>() << ";"
+       << settings["arena_alloc"].cast<bool>() << ";"
+       << settings["alloc_policy"].cast<bool>() << ";"
+       << settings["zeroed_alloc"].cast<bool>() << ";"
+       << settings["parallel_fill_threshold"].cast<uint64_t>() << ";"
+       << settings["stream_chunk_size"].cast<uint64_t>() << ";"
+       << settings["nontemporal_store_threshold"].cast<uint64_t>() << ";"
+       << settings["share_callees"].cast<bool>() << ";"
+       << settings["f16_f32_accumulate"].cast<bool>();
+    os.flush();
+    return std::make_unique<IRCache>(
+        dir, settings["ir_cache_max_size"].cast<uint64_t>(), std::move(salt));
+  }
+
+  static std::unique_ptr<llvm::ThreadPool>
+  getThreadPool(const py::dict &settings) {
+    auto numThreads = settings["compile_threads"].cast<unsigned>();
+    if (numThreads == 0)
+      return nullptr;
+
+    return std::make_unique<llvm::ThreadPool>(
+        llvm::hardware_concurrency(numThreads));
+  }
+
   numba::ExecutionEngineOptions getOpts(const py::dict &settings) const {
     llvm::InitializeAllTargets();
     llvm::InitializeAllTargetMCs();
@@ -1413,6 +2153,86 @@ private:
     if (!asmPrinter.is_none())
       opts.asmPrinter = getPrinter(asmPrinter);
 
+    opts.objectCacheDir = settings["object_cache_dir"].cast<std::string>();
+    opts.objectCacheMaxSize =
+        settings["object_cache_max_size"].cast<uint64_t>();
+    opts.tieredCompilation = settings["tiered_compilation"].cast<bool>();
+    opts.pgoCallThreshold = settings["pgo_call_threshold"].cast<unsigned>();
+    opts.lazyCompilation = settings["lazy_compilation"].cast<bool>();
+    opts.numCompileThreads = settings["compile_threads"].cast<unsigned>();
+
+    auto jitLinker = settings["jit_linker"].cast<std::string>();
+    auto linker =
+        llvm::StringSwitch<std::optional<numba::JITLinker>>(jitLinker)
+            .Case("jitlink", numba::JITLinker::JITLink)
+            .Case("rtdyld", numba::JITLinker::RTDyld)
+            .Default(std::nullopt);
+    if (!linker)
+      numba::reportError(llvm::Twine("Invalid JIT linker: ") + jitLinker);
+
+    opts.jitLinker = *linker;
+
+    auto codeModelName = settings["code_model"].cast<std::string>();
+    auto codeModel =
+        llvm::StringSwitch<std::optional<llvm::CodeModel::Model>>(
+            codeModelName)
+            .Case("small", llvm::CodeModel::Small)
+            .Case("medium", llvm::CodeModel::Medium)
+            .Case("large", llvm::CodeModel::Large)
+            .Default(std::nullopt);
+    if (!codeModel)
+      numba::reportError(llvm::Twine("Invalid code model: ") + codeModelName);
+
+    opts.codeModel = *codeModel;
+
+    auto tapirTarget = settings["tapir_target"].cast<std::string>();
+    auto target =
+        llvm::StringSwitch<std::optional<numba::TapirTarget>>(tapirTarget)
+            .Case("none", numba::TapirTarget::None)
+            .Case("opencilk", numba::TapirTarget::OpenCilk)
+            .Case("cuda", numba::TapirTarget::Cuda)
+            .Default(std::nullopt);
+    if (!target)
+      numba::reportError(llvm::Twine("Invalid tapir target: ") + tapirTarget);
+
+    opts.tapirTarget = *target;
+    opts.tapirAbiBitcodePath =
+        settings["tapir_abi_bitcode"].cast<std::string>();
+    opts.tapirRuntimePath = settings["tapir_runtime_path"].cast<std::string>();
+    if (opts.tapirTarget != numba::TapirTarget::None) {
+      // OpenCilk ABI is linked from bitcode, there is no default location.
+      if (opts.tapirTarget == numba::TapirTarget::OpenCilk &&
+          opts.tapirAbiBitcodePath.empty())
+        numba::reportError("NUMBA_MLIR_TAPIR_ABI_BITCODE must be set for "
+                           "opencilk tapir target");
+
+      if (!opts.tapirAbiBitcodePath.empty() &&
+          !llvm::sys::fs::exists(opts.tapirAbiBitcodePath))
+        numba::reportError(llvm::Twine("Tapir ABI bitcode not found: ") +
+                           opts.tapirAbiBitcodePath);
+
+      // Empty runtime path means default loader search.
+      if (!opts.tapirRuntimePath.empty() &&
+          !llvm::sys::fs::is_directory(opts.tapirRuntimePath))
+        numba::reportError(llvm::Twine("Tapir runtime path not found: ") +
+                           opts.tapirRuntimePath);
+    }
+
+    auto vectorLibrary = settings["vector_library"].cast<std::string>();
+    auto vecLib =
+        llvm::StringSwitch<std::optional<numba::VectorLibrary>>(vectorLibrary)
+            .Case("none", numba::VectorLibrary::None)
+            .Case("svml", numba::VectorLibrary::SVML)
+            .Case("libmvec", numba::VectorLibrary::LIBMVEC)
+            .Case("sleef", numba::VectorLibrary::SLEEF)
+            .Default(std::nullopt);
+    if (!vecLib)
+      numba::reportError(llvm::Twine("Invalid vector library: ") +
+                         vectorLibrary);
+
+    opts.vectorLibrary = *vecLib;
+    opts.llvmVectorization = settings["llvm_vectorization"].cast<bool>();
+
     return opts;
   }
 };
@@ -1433,6 +2253,21 @@ py::capsule initCompiler(py::dict settings) {
     llvm::setCurrentDebugTypes(types, static_cast<unsigned>(debugTypeSize));
   }
 
+  numba::setCompositePassMaxIterations(
+      settings["composite_max_iters"].cast<unsigned>());
+  setStackAllocMaxSize(settings["stack_alloc_max_size"].cast<uint64_t>());
+  setArenaAllocEnabled(settings["arena_alloc"].cast<bool>());
+  setAllocPolicyEnabled(settings["alloc_policy"].cast<bool>());
+  setZeroInitAllocEnabled(settings["zeroed_alloc"].cast<bool>());
+  setParallelFillThreshold(
+      settings["parallel_fill_threshold"].cast<uint64_t>());
+  setStreamChunkSize(settings["stream_chunk_size"].cast<uint64_t>());
+  setNontemporalStoreThreshold(
+      settings["nontemporal_store_threshold"].cast<uint64_t>());
+  setFirstTouchThreshold(settings["first_touch_threshold"].cast<uint64_t>());
+  setShareCalleesEnabled(settings["share_callees"].cast<bool>());
+  ModuleEnv::setMaxUses(settings["module_env_max_uses"].cast<size_t>());
+
   auto context = std::make_unique<GlobalCompilerContext>(settings);
   return py::capsule(context.release(), [](void *ptr) {
     delete static_cast<GlobalCompilerContext *>(ptr);
@@ -1454,7 +2289,8 @@ py::capsule createModule(py::dict settings) {
   modSettings.enableGpuPipeline =
       getDictVal(settings, "enable_gpu_pipeline", false);
 
-  auto mod = std::make_unique<Module>(modSettings);
+  auto mod =
+      std::make_unique<Module>(ModuleEnv::acquire(modSettings), modSettings);
   {
     mlir::OpBuilder builder(&mod->context);
     mod->module = mlir::ModuleOp::create(builder.getUnknownLoc());
@@ -1471,6 +2307,7 @@ py::capsule lowerFunction(const py::object &compilationContext,
   auto mod = static_cast<Module *>(pyMod);
   auto &context = mod->context;
   auto &module = mod->module;
+  numba::CompileProfileScope scope(&mod->profile, "driver", "lower_function");
   auto func = PlierLowerer(context, mod->typeConverter)
                   .lower(compilationContext, module, funcIr);
   return py::capsule(func.getOperation()); // no dtor, func owned by the module.
@@ -1483,40 +2320,186 @@ py::capsule lowerParfor(const pybind11::object &compilationContext,
   auto mod = static_cast<Module *>(pyMod);
   auto &context = mod->context;
   auto &module = mod->module;
+  numba::CompileProfileScope scope(&mod->profile, "driver", "lower_parfor");
   auto func = PlierLowerer(context, mod->typeConverter)
                   .lowerParfor(compilationContext, module, parforInst);
   return py::capsule(func.getOperation()); // no dtor, func owned by the module.
 }
 
-py::capsule compileModule(const py::capsule &compiler,
-                          const py::object &compilationContext,
-                          const py::capsule &pyMod) {
+/// Returns module profile, if enabled, and adds it to the aggregated one.
+static numba::CompileProfile *
+finishProfile(GlobalCompilerContext &context, Module &mod,
+              numba::CompileProfile::Clock::time_point begin) {
+  if (!mod.profileEnabled)
+    return nullptr;
+
+  mod.profile.addSince("driver", "compile_module", begin);
+  context.profile.merge(mod.profile);
+  return &mod.profile;
+}
+
+/// Returns true if user requested some pipeline output (IR dumps, timings,
+/// diagnostics), so pipeline cannot be skipped.
+static bool isPipelineObserved(py::handle settings) {
+  return settings["ir_printing"].cast<bool>() ||
+         settings["diag_printing"].cast<bool>() ||
+         settings["pass_statistics"].cast<bool>() ||
+         settings["pass_timings"].cast<bool>() ||
+         !settings["print_before"].cast<py::list>().empty() ||
+         !settings["print_after"].cast<py::list>().empty();
+}
+
+/// Runs MLIR pipeline on the module or takes its result from the IR cache.
+static void runCompilerCached(GlobalCompilerContext &context, Module &mod,
+                              const py::object &compilationContext) {
+  auto cache = context.irCache.get();
+  auto settings = compilationContext["compiler_settings"];
+  if (!cache || isPipelineObserved(settings)) {
+    runCompiler(mod, compilationContext, context.threadPool.get());
+    return;
+  }
+
+  mod.profileEnabled = settings["compile_profile"].cast<bool>();
+  auto profile = mod.profileEnabled ? &mod.profile : nullptr;
+  std::string key;
+  {
+    // Cache key hashing and disk IO don't touch python objects.
+    py::gil_scoped_release release;
+    numba::CompileProfileScope scope(profile, "driver", "ir_cache_load");
+    key = cache->getKey(mod.module, mod.enableGpuPipeline);
+    if (auto cached = cache->load(key, mod.context)) {
+      mod.module.erase();
+      mod.module = cached.release();
+      return;
+    }
+  }
+
+  runCompiler(mod, compilationContext, context.threadPool.get());
+
+  py::gil_scoped_release release;
+  numba::CompileProfileScope scope(profile, "driver", "ir_cache_store");
+  cache->store(key, mod.module);
+}
+
+py::tuple compileModule(const py::capsule &compiler,
+                        const py::object &compilationContext,
+                        const py::capsule &pyMod) {
   TIME_FUNC();
   auto context = static_cast<GlobalCompilerContext *>(compiler);
   assert(context);
   auto mod = static_cast<Module *>(pyMod);
   assert(mod);
 
-  runCompiler(*mod, compilationContext);
+  auto begin = numba::CompileProfile::Clock::now();
+  runCompilerCached(*context, *mod, compilationContext);
 
-  auto &mlirCtx = *mod->module->getContext();
-  mlir::registerLLVMDialectTranslation(mlirCtx);
-  mlir::registerBuiltinDialectTranslation(mlirCtx);
-  auto res = context->executionEngine.loadModule(mod->module);
+  auto res = [&]() {
+    // Printers may be invoked from the compile threads.
+    py::gil_scoped_release release;
+    return context->getExecutionEngine().loadModule(
+        mod->module, mod->profileEnabled ? &mod->profile : nullptr);
+  }();
   if (!res)
     numba::reportError(llvm::Twine("Failed to load MLIR module:\n") +
                        llvm::toString(res.takeError()));
 
+  py::object profile = py::none();
+  if (auto modProfile = finishProfile(*context, *mod, begin))
+    profile = getProfileDict(*modProfile);
+
+  return py::make_tuple(py::capsule(static_cast<void *>(res.get())), profile);
+}
+
+py::capsule emitModuleObject(const py::capsule &compiler,
+                             const py::object &compilationContext,
+                             const py::capsule &pyMod, const py::str &path,
+                             const py::str &cpu) {
+  TIME_FUNC();
+  auto context = static_cast<GlobalCompilerContext *>(compiler);
+  assert(context);
+  auto mod = static_cast<Module *>(pyMod);
+  assert(mod);
+
+  runCompilerCached(*context, *mod, compilationContext);
+
+  auto filename = path.cast<std::string>();
+  auto cpuName = cpu.cast<std::string>();
+  auto res = [&]() -> llvm::Expected<numba::ExecutionEngine::ModuleHandle> {
+    py::gil_scoped_release release;
+    auto &engine = context->getExecutionEngine();
+    if (auto err = engine.emitObjectFile(mod->module, filename, cpuName))
+      return std::move(err);
+
+    // Object for the other CPU may not run on the host, module is compiled
+    // for the host separately in this case.
+    if (!cpuName.empty())
+      return engine.loadModule(mod->module);
+
+    return engine.loadObjectFile(filename);
+  }();
+  if (!res)
+    numba::reportError(llvm::Twine("Failed to emit MLIR module object:\n") +
+                       llvm::toString(res.takeError()));
+
+  return py::capsule(static_cast<void *>(res.get()));
+}
+
+py::capsule loadModuleObject(const py::capsule &compiler,
+                             const py::str &path) {
+  TIME_FUNC();
+  auto context = static_cast<GlobalCompilerContext *>(compiler);
+  assert(context);
+
+  auto filename = path.cast<std::string>();
+  auto res = [&]() {
+    py::gil_scoped_release release;
+    return context->getExecutionEngine().loadObjectFile(filename);
+  }();
+  if (!res)
+    numba::reportError(llvm::Twine("Failed to load MLIR module object:\n") +
+                       llvm::toString(res.takeError()));
+
   return py::capsule(static_cast<void *>(res.get()));
 }
 
+py::list getModuleRemarks(const py::capsule &pyMod) {
+  auto mod = static_cast<Module *>(pyMod);
+  assert(mod);
+  py::list ret;
+  for (auto &remark : mod->remarks) {
+    py::dict val;
+    val["pass"] = remark.pass;
+    val["reason"] = remark.reason;
+    val["location"] = remark.location;
+    ret.append(val);
+  }
+  return ret;
+}
+
+py::dict getCompileProfile(const py::capsule &compiler) {
+  auto context = static_cast<GlobalCompilerContext *>(compiler);
+  assert(context);
+  return getProfileDict(context->profile);
+}
+
+void resetCompileProfile(const py::capsule &compiler) {
+  auto context = static_cast<GlobalCompilerContext *>(compiler);
+  assert(context);
+  context->profile.clear();
+}
+
+void setCompileTraceFunc(const py::int_ &ptr) {
+  auto func = reinterpret_cast<numba::CompileTraceFunc>(ptr.cast<uintptr_t>());
+  numba::setCompileTraceFunc(func);
+}
+
 void registerSymbol(const py::capsule &compiler, const py::str &name,
                     const py::int_ &ptr) {
   auto context = static_cast<GlobalCompilerContext *>(compiler);
   assert(context);
 
   auto ptrValue = reinterpret_cast<void *>(ptr.cast<intptr_t>());
-  context->symbolList.emplace_back(name.cast<std::string>(), ptrValue);
+  context->registerSymbol(name.cast<std::string>(), ptrValue);
 }
 
 py::int_ getFunctionPointer(const py::capsule &compiler,
@@ -1528,7 +2511,7 @@ py::int_ getFunctionPointer(const py::capsule &compiler,
   assert(handle);
 
   auto name = funcName.cast<std::string>();
-  auto res = context->executionEngine.lookup(handle, name);
+  auto res = context->getExecutionEngine().lookup(handle, name);
   if (!res)
     numba::reportError(llvm::Twine("Failed to get function pointer:\n") +
                        llvm::toString(res.takeError()));
@@ -1536,6 +2519,45 @@ py::int_ getFunctionPointer(const py::capsule &compiler,
   return py::int_(reinterpret_cast<intptr_t>(res.get()));
 }
 
+void finishCompilation(const py::capsule &compiler) {
+  TIME_FUNC();
+  auto context = static_cast<GlobalCompilerContext *>(compiler);
+  assert(context);
+  auto engine = context->getExistingExecutionEngine();
+  if (!engine)
+    return;
+
+  auto err = [&]() {
+    py::gil_scoped_release release;
+    return engine->finishCompilation();
+  }();
+  if (err)
+    numba::reportError(llvm::Twine("Failed to finish compilation:\n") +
+                       llvm::toString(std::move(err)));
+}
+
+void beforeFork(const py::capsule &compiler) {
+  auto context = static_cast<GlobalCompilerContext *>(compiler);
+  assert(context);
+  if (auto engine = context->getExistingExecutionEngine()) {
+    py::gil_scoped_release release;
+    engine->beforeFork();
+  }
+}
+
+void afterForkParent(const py::capsule &compiler) {
+  auto context = static_cast<GlobalCompilerContext *>(compiler);
+  assert(context);
+  if (auto engine = context->getExistingExecutionEngine())
+    engine->afterForkParent();
+}
+
+void afterForkChild(const py::capsule &compiler) {
+  auto context = static_cast<GlobalCompilerContext *>(compiler);
+  assert(context);
+  context->afterForkChild();
+}
+
 void releaseModule(const py::capsule &compiler, const py::capsule &module) {
   TIME_FUNC();
   auto context = static_cast<GlobalCompilerContext *>(compiler);
@@ -1543,7 +2565,13 @@ void releaseModule(const py::capsule &compiler, const py::capsule &module) {
   auto handle = static_cast<numba::ExecutionEngine::ModuleHandle *>(module);
   assert(handle);
 
-  context->executionEngine.releaseModule(handle);
+  context->getExecutionEngine().releaseModule(handle);
+}
+
+py::int_ getModuleEnvCount() { return py::int_(ModuleEnv::getCount()); }
+
+py::int_ getRetiredModuleEnvCount() {
+  return py::int_(ModuleEnv::getRetiredCount());
 }
 
 py::str moduleStr(const py::capsule &pyMod) {
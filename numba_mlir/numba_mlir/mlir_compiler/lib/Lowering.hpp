@@ -9,8 +9,10 @@ class bytes;
 class capsule;
 class dict;
 class int_;
+class list;
 class object;
 class str;
+class tuple;
 } // namespace pybind11
 
 pybind11::capsule initCompiler(pybind11::dict settings);
@@ -25,9 +27,26 @@ pybind11::capsule lowerParfor(const pybind11::object &compilationContext,
                               const pybind11::capsule &pyMod,
                               const pybind11::object &parforInst);
 
-pybind11::capsule compileModule(const pybind11::capsule &compiler,
-                                const pybind11::object &compilationContext,
-                                const pybind11::capsule &pyMod);
+pybind11::tuple compileModule(const pybind11::capsule &compiler,
+                              const pybind11::object &compilationContext,
+                              const pybind11::capsule &pyMod);
+
+pybind11::capsule emitModuleObject(const pybind11::capsule &compiler,
+                                   const pybind11::object &compilationContext,
+                                   const pybind11::capsule &pyMod,
+                                   const pybind11::str &path,
+                                   const pybind11::str &cpu);
+
+pybind11::capsule loadModuleObject(const pybind11::capsule &compiler,
+                                   const pybind11::str &path);
+
+pybind11::list getModuleRemarks(const pybind11::capsule &pyMod);
+
+pybind11::dict getCompileProfile(const pybind11::capsule &compiler);
+
+void resetCompileProfile(const pybind11::capsule &compiler);
+
+void setCompileTraceFunc(const pybind11::int_ &ptr);
 
 void registerSymbol(const pybind11::capsule &compiler,
                     const pybind11::str &name, const pybind11::int_ &ptr);
@@ -36,7 +55,19 @@ pybind11::int_ getFunctionPointer(const pybind11::capsule &compiler,
                                   const pybind11::capsule &module,
                                   pybind11::str funcName);
 
+void finishCompilation(const pybind11::capsule &compiler);
+
+void beforeFork(const pybind11::capsule &compiler);
+
+void afterForkParent(const pybind11::capsule &compiler);
+
+void afterForkChild(const pybind11::capsule &compiler);
+
 void releaseModule(const pybind11::capsule &compiler,
                    const pybind11::capsule &module);
 
+pybind11::int_ getModuleEnvCount();
+
+pybind11::int_ getRetiredModuleEnvCount();
+
 pybind11::str moduleStr(const pybind11::capsule &pyMod);
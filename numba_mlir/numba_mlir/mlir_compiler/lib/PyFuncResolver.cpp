@@ -9,17 +9,60 @@
 
 #include <pybind11/pybind11.h>
 
+#include <llvm/ADT/Sequence.h>
+#include <llvm/ADT/StringMap.h>
+
 #include <mlir/Dialect/Func/IR/FuncOps.h>
 #include <mlir/Dialect/UB/IR/UBOps.h>
 #include <mlir/IR/BuiltinOps.h>
 #include <mlir/IR/PatternMatch.h>
 
+#include "numba/Dialect/numba_util/Dialect.hpp"
+
 namespace py = pybind11;
 
+/// Python function, registered in `func_registry`, arguments info is
+/// converted to C++ once per function name.
+struct FuncDesc {
+  py::object func;
+  py::object flags;
+  llvm::SmallVector<std::string> argNames;
+  llvm::SmallVector<bool> argHasDefault;
+  llvm::SmallVector<py::object> argDefaults;
+};
+
 struct PyFuncResolver::Context {
   py::handle resolver;
   py::handle compiler;
   py::handle types;
+
+  /// Resolved functions descriptions, keyed by name.
+  llvm::StringMap<FuncDesc> funcDescs;
+
+  const FuncDesc *getFuncDesc(llvm::StringRef name) {
+    auto it = funcDescs.find(name);
+    if (it != funcDescs.end())
+      return &it->second;
+
+    auto pyDesc = resolver(py::str(name.data(), name.size()));
+    if (pyDesc.is_none())
+      return nullptr;
+
+    auto descTuple = pyDesc.cast<py::tuple>();
+    FuncDesc desc;
+    desc.func = descTuple[0];
+    desc.flags = descTuple[1];
+    for (auto argName : descTuple[2].cast<py::list>())
+      desc.argNames.emplace_back(argName.cast<std::string>());
+
+    for (auto hasDefault : descTuple[3].cast<py::list>())
+      desc.argHasDefault.emplace_back(hasDefault.cast<bool>());
+
+    for (auto def : descTuple[4].cast<py::list>())
+      desc.argDefaults.emplace_back(py::reinterpret_borrow<py::object>(def));
+
+    return &funcDescs.try_emplace(name, std::move(desc)).first->second;
+  }
 };
 
 PyFuncResolver::PyFuncResolver() : context(std::make_unique<Context>()) {
@@ -37,45 +80,27 @@ std::optional<PyFuncResolver::Result> PyFuncResolver::getFunc(
     llvm::StringRef name, mlir::ValueRange args,
     llvm::ArrayRef<llvm::StringRef> kwnames, mlir::ValueRange kwargs) const {
   assert(!name.empty());
-  auto funcDesc = context->resolver(py::str(name.data(), name.size()));
-  if (funcDesc.is_none())
+  auto funcDesc = context->getFuncDesc(name);
+  if (!funcDesc)
     return std::nullopt;
 
-  auto funcDescTuple = funcDesc.cast<py::tuple>();
-
-  auto pyFunc = funcDescTuple[0];
-  auto flags = funcDescTuple[1];
-  auto argNames = funcDescTuple[2].cast<py::list>();
-  auto argHasDefault = funcDescTuple[3].cast<py::list>();
-  auto argDefaults = funcDescTuple[4].cast<py::list>();
-
   Result res;
 
   auto reserveSize = args.size() + kwargs.size();
   res.mappedArgs.reserve(reserveSize);
 
-  bool failedToConvert = false;
-  py::list pyTypes;
-  auto convertTypeToNumba = [&](mlir::Type type) {
-    auto pyType = mapTypeToNumba(context->types, type);
-    if (pyType.is_none()) {
-      failedToConvert = true;
-    } else {
-      pyTypes.append(pyType);
-    }
-  };
-
-  auto omitted = context->types.attr("Omitted");
+  // Omitted args defaults, null for the actual args.
+  llvm::SmallVector<py::handle> omittedArgs;
+  omittedArgs.reserve(reserveSize);
 
   auto addArg = [&](mlir::Value val) {
-    convertTypeToNumba(val.getType());
     res.mappedArgs.emplace_back(val);
+    omittedArgs.emplace_back();
   };
 
-  for (auto it : llvm::zip(argNames, argHasDefault, argDefaults)) {
-    auto arg = std::get<0>(it);
+  for (auto i : llvm::seq<size_t>(0, funcDesc->argNames.size())) {
+    llvm::StringRef argName = funcDesc->argNames[i];
     auto kwarg = [&]() -> mlir::Value {
-      auto argName = arg.cast<std::string>();
       for (auto &&[name, kw] : llvm::zip(kwnames, kwargs)) {
         if (argName == name)
           return kw;
@@ -89,13 +114,11 @@ std::optional<PyFuncResolver::Result> PyFuncResolver::getFunc(
     }
 
     if (args.empty()) {
-      auto hasDefValue = std::get<1>(it);
-      if (hasDefValue.cast<bool>()) {
+      if (funcDesc->argHasDefault[i]) {
         mlir::Value newVal = rewriter.create<mlir::ub::PoisonOp>(
             loc, rewriter.getNoneType(), nullptr);
         res.mappedArgs.emplace_back(newVal);
-        auto def = std::get<2>(it);
-        pyTypes.append(omitted(def));
+        omittedArgs.emplace_back(funcDesc->argDefaults[i]);
         continue;
       }
 
@@ -106,29 +129,50 @@ std::optional<PyFuncResolver::Result> PyFuncResolver::getFunc(
     args = args.drop_front();
   }
 
-  if (failedToConvert)
-    return std::nullopt;
-
   mlir::ValueRange argsRande(res.mappedArgs);
   auto types = argsRande.getTypes();
   auto mangledName = mangle(name, types);
+
+  // Callee was already compiled into this module for the same arg types,
+  // reuse it without converting types to numba.
   auto externalFunc = module.lookupSymbol<mlir::func::FuncOp>(mangledName);
   if (externalFunc) {
     res.func = externalFunc;
-  } else {
-    rewriter.startOpModification(module);
-    auto resOp = static_cast<mlir::Operation *>(
-        context->compiler(pyFunc, pyTypes, flags).cast<py::capsule>());
-    if (!resOp) {
-      rewriter.cancelOpModification(module);
-      return std::nullopt;
+    return res;
+  }
+
+  py::list pyTypes;
+  auto omitted = context->types.attr("Omitted");
+  for (auto &&[type, def] : llvm::zip(types, omittedArgs)) {
+    if (def) {
+      pyTypes.append(omitted(def));
+      continue;
     }
 
-    res.func = mlir::cast<mlir::func::FuncOp>(resOp);
-    res.func.setPrivate();
-    res.func.setName(mangledName);
-    rewriter.finalizeOpModification(module);
+    auto pyType = mapTypeToNumba(context->types, type);
+    if (pyType.is_none())
+      return std::nullopt;
+
+    pyTypes.append(pyType);
   }
 
+  rewriter.startOpModification(module);
+  auto resOp = static_cast<mlir::Operation *>(
+      context->compiler(funcDesc->func, pyTypes, funcDesc->flags)
+          .cast<py::capsule>());
+  if (!resOp) {
+    rewriter.cancelOpModification(module);
+    return std::nullopt;
+  }
+
+  res.func = mlir::cast<mlir::func::FuncOp>(resOp);
+
+  // Original name is unique for the python function, arg types and flags in
+  // the process, so it identifies the same callee across modules.
+  res.func->setAttr(numba::util::attributes::getSharedCalleeName(),
+                    res.func.getSymNameAttr());
+  res.func.setPrivate();
+  res.func.setName(mangledName);
+  rewriter.finalizeOpModification(module);
   return res;
 }
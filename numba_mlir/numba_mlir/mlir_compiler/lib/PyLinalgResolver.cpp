@@ -6,6 +6,10 @@
 
 #include <pybind11/pybind11.h>
 
+#include <llvm/ADT/Hashing.h>
+#include <llvm/ADT/ScopeExit.h>
+#include <llvm/ADT/StringExtras.h>
+
 #include <mlir/AsmParser/AsmParser.h>
 #include <mlir/Dialect/Arith/IR/Arith.h>
 #include <mlir/Dialect/Bufferization/IR/Bufferization.h>
@@ -20,6 +24,7 @@
 #include <mlir/IR/BuiltinAttributes.h>
 #include <mlir/IR/BuiltinOps.h>
 #include <mlir/IR/BuiltinTypes.h>
+#include <mlir/IR/PatternMatch.h>
 #include <mlir/Parser/Parser.h>
 
 #include "numba/Dialect/ntensor/IR/NTensorOps.hpp"
@@ -438,6 +443,9 @@ private:
       return ret;
     }
 
+    if (auto str = val.getDefiningOp<numba::util::StringConstOp>())
+      return py::str(str.getValue().str());
+
     if (auto cast = val.getDefiningOp<numba::util::SignCastOp>())
       val = cast.getSource();
 
@@ -1595,7 +1603,11 @@ static py::object shapeImpl(py::capsule context, py::capsule ssaVal) {
     llvm::SmallVector<mlir::Value> shapeVals(rank);
     for (auto i : llvm::seq(0u, rank)) {
       mlir::Value mlirDim;
-      if (isTensor) {
+      // Use constants for static dims, so they can be used as literals.
+      if (!mlirType.isDynamicDim(i)) {
+        mlirDim = builder.create<mlir::arith::ConstantIndexOp>(
+            loc, mlirType.getDimSize(i));
+      } else if (isTensor) {
         mlirDim = builder.create<mlir::tensor::DimOp>(loc, value, i);
       } else if (isNTensor) {
         mlirDim = builder.create<numba::ntensor::DimOp>(loc, value, i);
@@ -1908,10 +1920,183 @@ static PyLinalgResolver::Values unpackResults(PyBuilderContext &ctx,
   }
   return ret;
 }
+
+static constexpr llvm::StringLiteral ResolverKeyAttrName("numba.resolver_key");
+
+static bool isConstArg(mlir::Operation *op) {
+  return op && op->hasTrait<mlir::OpTrait::ConstantLike>() &&
+         op->getNumOperands() == 0 && op->getNumRegions() == 0 &&
+         op->getNumResults() == 1;
+}
+
+/// Write structural description of resolver argument to the template key.
+/// Constants and tuples are part of key, so builders still see them as
+/// literals, all other values become template arguments and only their types
+/// are part of the key.
+static void describeArg(llvm::raw_ostream &os, mlir::Value val,
+                        llvm::SmallVectorImpl<mlir::Value> &templateArgs) {
+  if (auto tuple = val.getDefiningOp<numba::util::BuildTupleOp>()) {
+    os << "(";
+    for (auto arg : tuple.getArgs()) {
+      describeArg(os, arg, templateArgs);
+      os << ",";
+    }
+    os << ")";
+    return;
+  }
+
+  if (auto cast = val.getDefiningOp<numba::util::SignCastOp>()) {
+    auto src = cast.getSource();
+    if (isConstArg(src.getDefiningOp())) {
+      os << "cast<" << val.getType() << ">";
+      describeArg(os, src, templateArgs);
+      return;
+    }
+  }
+
+  if (auto op = val.getDefiningOp(); isConstArg(op)) {
+    os << op->getName() << op->getAttrDictionary() << ":" << val.getType();
+    return;
+  }
+
+  os << "%:" << val.getType();
+  templateArgs.emplace_back(val);
+}
+
+/// Recreate argument, described by `describeArg`, inside the template body.
+static mlir::Value rematerializeArg(mlir::OpBuilder &builder, mlir::Value val,
+                                    mlir::ValueRange &templateArgs) {
+  if (auto tuple = val.getDefiningOp<numba::util::BuildTupleOp>()) {
+    llvm::SmallVector<mlir::Value> args;
+    for (auto arg : tuple.getArgs())
+      args.emplace_back(rematerializeArg(builder, arg, templateArgs));
+
+    return builder.create<numba::util::BuildTupleOp>(tuple.getLoc(),
+                                                     tuple.getType(), args);
+  }
+
+  if (auto cast = val.getDefiningOp<numba::util::SignCastOp>()) {
+    auto src = cast.getSource();
+    if (isConstArg(src.getDefiningOp())) {
+      auto newSrc = rematerializeArg(builder, src, templateArgs);
+      return builder.create<numba::util::SignCastOp>(cast.getLoc(),
+                                                     cast.getType(), newSrc);
+    }
+  }
+
+  if (auto op = val.getDefiningOp(); isConstArg(op))
+    return builder.clone(*op)->getResult(0);
+
+  assert(!templateArgs.empty());
+  auto ret = templateArgs.front();
+  templateArgs = templateArgs.drop_front();
+  return ret;
+}
+
+static std::string getTemplateName(llvm::StringRef name, llvm::StringRef hash,
+                                   unsigned index) {
+  std::string ret = "__resolver.";
+  for (auto c : name)
+    ret.push_back(llvm::isAlnum(c) ? c : '_');
+
+  ret += ".";
+  ret += hash;
+  if (index != 0)
+    ret += "." + std::to_string(index);
+
+  return ret;
+}
+
+using BuildFunc = llvm::function_ref<std::optional<PyLinalgResolver::Values>(
+    mlir::ValueRange, PyLinalgResolver::KWArgs)>;
+
+/// Emit resolver results as a call to the private function template.
+/// Templates are cached in the module symbol table, keyed by the resolver
+/// name and the arguments structure, so the repeated calls with the same
+/// signature clone the existing template instead of running builder again.
+static std::optional<PyLinalgResolver::Values>
+outlineCall(mlir::ModuleOp mod, mlir::OpBuilder &builder, mlir::Location loc,
+            llvm::StringRef name, mlir::ValueRange args,
+            PyLinalgResolver::KWArgs kwargs, BuildFunc build) {
+  llvm::SmallVector<mlir::Value> templateArgs;
+  std::string key;
+  {
+    llvm::raw_string_ostream os(key);
+    os << name;
+    for (auto arg : args) {
+      os << ";";
+      describeArg(os, arg, templateArgs);
+    }
+    for (auto &&[argName, arg] : kwargs) {
+      os << ";" << argName << "=";
+      describeArg(os, arg, templateArgs);
+    }
+  }
+
+  auto keyAttr = builder.getStringAttr(key);
+  auto hash = llvm::utohexstr(static_cast<size_t>(llvm::hash_value(key)));
+  mlir::func::FuncOp func;
+  std::string funcName;
+  for (unsigned i = 0;; ++i) {
+    funcName = getTemplateName(name, hash, i);
+    auto sym = mod.lookupSymbol(funcName);
+    if (!sym)
+      break;
+
+    // Hash collision, try next name.
+    if (sym->getAttr(ResolverKeyAttrName) != keyAttr)
+      continue;
+
+    func = mlir::dyn_cast<mlir::func::FuncOp>(sym);
+    if (func)
+      break;
+  }
+
+  if (!func) {
+    mlir::ValueRange templateArgsRange(templateArgs);
+    auto funcType =
+        builder.getFunctionType(templateArgsRange.getTypes(), {});
+    func = numba::addFunction(builder, mod, funcName, funcType);
+    auto block = func.addEntryBlock();
+
+    // Erasing through rewriter, so pattern driver is notified.
+    mlir::IRRewriter rewriter(builder);
+    auto eraseFunc = llvm::make_scope_exit([&]() { rewriter.eraseOp(func); });
+
+    mlir::OpBuilder::InsertionGuard g(builder);
+    builder.setInsertionPointToStart(block);
+
+    mlir::ValueRange blockArgs = block->getArguments();
+    llvm::SmallVector<mlir::Value> newArgs;
+    for (auto arg : args)
+      newArgs.emplace_back(rematerializeArg(builder, arg, blockArgs));
+
+    llvm::SmallVector<std::pair<llvm::StringRef, mlir::Value>> newKWArgs;
+    for (auto &&[argName, arg] : kwargs)
+      newKWArgs.emplace_back(argName,
+                             rematerializeArg(builder, arg, blockArgs));
+
+    auto results = build(newArgs, newKWArgs);
+    if (!results)
+      return std::nullopt;
+
+    mlir::ValueRange resultsRange(*results);
+    builder.create<mlir::func::ReturnOp>(loc, resultsRange);
+    func.setFunctionType(builder.getFunctionType(templateArgsRange.getTypes(),
+                                                 resultsRange.getTypes()));
+    func->setAttr(ResolverKeyAttrName, keyAttr);
+    eraseFunc.release();
+  }
+
+  auto call = builder.create<mlir::func::CallOp>(loc, func, templateArgs);
+  auto results = call.getResults();
+  return PyLinalgResolver::Values(results.begin(), results.end());
+}
 } // namespace
 
-PyLinalgResolver::PyLinalgResolver(const char *modName, const char *regName)
-    : context(std::make_unique<Context>()) {
+PyLinalgResolver::PyLinalgResolver(const char *modName, const char *regName,
+                                   bool outline)
+    : context(std::make_unique<Context>()), outline(outline) {
   assert(modName != nullptr);
   assert(regName != nullptr);
   auto builderMod = py::module::import("numba_mlir.mlir.linalg_builder");
@@ -1956,24 +2141,37 @@ PyLinalgResolver::rewrite(llvm::StringRef name, mlir::Location loc,
     if (builderFunc.is_none())
       return {};
 
-    PyBuilderContext pyBuilderContext{loc, builder, *context};
-    auto pyContext = py::capsule(&pyBuilderContext);
-    auto pyArgs = getArgs(
-        context->inspect, builderFunc,
-        [&](auto val) { return context->createVar(pyContext, val); }, args,
-        kwargs);
-    if (pyArgs.is_none())
-      return {};
-
-    auto pyBuilder = context->builder(pyContext);
-    setupPyBuilder(pyBuilder, builder,
-                   [&](auto type) { return context->createType(type); });
+    auto build = [&](mlir::ValueRange buildArgs,
+                     KWArgs buildKWArgs) -> std::optional<Values> {
+      PyBuilderContext pyBuilderContext{loc, builder, *context};
+      auto pyContext = py::capsule(&pyBuilderContext);
+      auto pyArgs = getArgs(
+          context->inspect, builderFunc,
+          [&](auto val) { return context->createVar(pyContext, val); },
+          buildArgs, buildKWArgs);
+      if (pyArgs.is_none())
+        return {};
+
+      auto pyBuilder = context->builder(pyContext);
+      setupPyBuilder(pyBuilder, builder,
+                     [&](auto type) { return context->createType(type); });
+
+      auto result = builderFunc(pyBuilder, *pyArgs);
+      if (result.is_none())
+        return {};
+
+      return unpackResults(pyBuilderContext, result);
+    };
 
-    auto result = builderFunc(pyBuilder, *pyArgs);
-    if (result.is_none())
-      return {};
+    if (outline) {
+      auto block = builder.getInsertionBlock();
+      auto parent = block ? block->getParentOp() : nullptr;
+      if (auto mod = parent ? parent->getParentOfType<mlir::ModuleOp>()
+                            : mlir::ModuleOp())
+        return outlineCall(mod, builder, loc, name, args, kwargs, build);
+    }
 
-    return unpackResults(pyBuilderContext, result);
+    return build(args, kwargs);
   } catch (const std::exception &e) {
     mlir::emitError(loc, e.what());
   }
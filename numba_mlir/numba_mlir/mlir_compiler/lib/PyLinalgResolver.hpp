@@ -29,7 +29,12 @@ class FuncOp;
 
 class PyLinalgResolver {
 public:
-  PyLinalgResolver(const char *modName, const char *regName);
+  /// If `outline` is set, resolver results are emitted as calls to the
+  /// private function templates, cached per module by resolver name and
+  /// arguments signature, so builders are not rerun for the repeated calls.
+  /// Templates are inlined by the cost model inliner.
+  PyLinalgResolver(const char *modName, const char *regName,
+                   bool outline = false);
   ~PyLinalgResolver();
 
   using Values = llvm::SmallVector<mlir::Value, 8>;
@@ -47,6 +52,7 @@ private:
   friend struct PyBuilderContext;
   struct Context;
   std::unique_ptr<Context> context;
+  bool outline = false;
 
   std::optional<Values> rewrite(llvm::StringRef name, mlir::Location loc,
                                 mlir::OpBuilder &builder, mlir::ValueRange args,
@@ -9,6 +9,7 @@
 
 #include "PyModule.hpp"
 
+#include "CheckGpuCaps.hpp"
 #include "Lowering.hpp"
 
 static bool isMKLSupported() {
@@ -46,17 +47,44 @@ static unsigned getVectorLength() {
   return 128;
 }
 
+static pybind11::list getHostCPUFeatures() {
+  pybind11::list ret;
+  llvm::StringMap<bool, llvm::MallocAllocator> features;
+  if (!llvm::sys::getHostCPUFeatures(features))
+    return ret;
+
+  for (auto &it : features)
+    if (it.second)
+      ret.append(pybind11::str(it.getKey().str()));
+
+  return ret;
+}
+
 PYBIND11_MODULE(mlir_compiler, m) {
   m.def("init_compiler", &initCompiler, "No docs");
   m.def("create_module", &createModule, "No docs");
   m.def("lower_function", &lowerFunction, "No docs");
   m.def("lower_parfor", &lowerParfor, "No docs");
   m.def("compile_module", &compileModule, "No docs");
+  m.def("emit_module_object", &emitModuleObject, "No docs");
+  m.def("load_module_object", &loadModuleObject, "No docs");
+  m.def("get_module_remarks", &getModuleRemarks, "No docs");
+  m.def("get_compile_profile", &getCompileProfile, "No docs");
+  m.def("reset_compile_profile", &resetCompileProfile, "No docs");
+  m.def("set_compile_trace_func", &setCompileTraceFunc, "No docs");
   m.def("register_symbol", &registerSymbol, "No docs");
   m.def("get_function_pointer", &getFunctionPointer, "No docs");
+  m.def("finish_compilation", &finishCompilation, "No docs");
+  m.def("before_fork", &beforeFork, "No docs");
+  m.def("after_fork_parent", &afterForkParent, "No docs");
+  m.def("after_fork_child", &afterForkChild, "No docs");
   m.def("release_module", &releaseModule, "No docs");
+  m.def("get_module_env_count", &getModuleEnvCount, "No docs");
+  m.def("get_retired_module_env_count", &getRetiredModuleEnvCount, "No docs");
   m.def("module_str", &moduleStr, "No docs");
   m.def("is_mkl_supported", &isMKLSupported, "No docs");
   m.def("is_sycl_mkl_supported", &isSyclMKLSupported, "No docs");
   m.def("get_vector_length", &getVectorLength, "No docs");
+  m.def("get_host_cpu_features", &getHostCPUFeatures, "No docs");
+  m.def("invalidate_device_caps", &numba::invalidateDeviceCaps, "No docs");
 }
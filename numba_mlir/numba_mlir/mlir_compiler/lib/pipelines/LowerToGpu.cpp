@@ -28,16 +28,19 @@
 #include <mlir/Dialect/SPIRV/IR/TargetAndABI.h>
 #include <mlir/Dialect/SPIRV/Transforms/Passes.h>
 #include <mlir/Dialect/UB/IR/UBOps.h>
+#include <mlir/Dialect/Vector/IR/VectorOps.h>
 #include <mlir/IR/Dominance.h>
 #include <mlir/IR/IRMapping.h>
 #include <mlir/Pass/PassManager.h>
 #include <mlir/Transforms/DialectConversion.h>
+#include <mlir/Transforms/GreedyPatternRewriteDriver.h>
 #include <mlir/Transforms/Passes.h>
 
 #include "BasePipeline.hpp"
 #include "CheckGpuCaps.hpp"
 #include "PyLinalgResolver.hpp"
 #include "pipelines/LowerToLlvm.hpp"
+#include "pipelines/ParallelToTbb.hpp"
 #include "pipelines/PlierToLinalg.hpp"
 #include "pipelines/PlierToScf.hpp"
 #include "pipelines/PlierToStd.hpp"
@@ -48,7 +51,10 @@
 #include "numba/Conversion/GpuToGpuRuntime.hpp"
 #include "numba/Conversion/UtilConversion.hpp"
 #include "numba/Dialect/gpu_runtime/IR/GpuRuntimeOps.hpp"
+#include "numba/Dialect/gpu_runtime/Transforms/FuseLaunches.hpp"
+#include "numba/Dialect/gpu_runtime/Transforms/LowerLaunchesToCpu.hpp"
 #include "numba/Dialect/gpu_runtime/Transforms/MakeBarriersUniform.hpp"
+#include "numba/Dialect/gpu_runtime/Transforms/PromoteToLocalMemory.hpp"
 #include "numba/Dialect/ntensor/IR/NTensorOps.hpp"
 #include "numba/Dialect/numba_util/Dialect.hpp"
 #include "numba/Dialect/plier/Dialect.hpp" // TODO: for slice slice type
@@ -56,8 +62,12 @@
 #include "numba/Transforms/CastUtils.hpp"
 #include "numba/Transforms/CommonOpts.hpp"
 #include "numba/Transforms/CompositePass.hpp"
+#include "numba/Transforms/HoistMemrefOffsets.hpp"
+#include "numba/Transforms/LoopInvariantDivision.hpp"
 #include "numba/Transforms/PipelineUtils.hpp"
 #include "numba/Transforms/RewriteWrapper.hpp"
+#include "numba/Transforms/SCFVectorize.hpp"
+#include "numba/Transforms/ShapeIntegerRangePropagation.hpp"
 #include "numba/Transforms/TypeConversion.hpp"
 
 namespace {
@@ -989,15 +999,6 @@ getDeviceDescFromArgs(mlir::MLIRContext *context, mlir::TypeRange argTypes) {
   return res;
 }
 
-static mlir::FailureOr<mlir::Attribute>
-getDeviceDescFromFunc(mlir::MLIRContext *context, mlir::TypeRange argTypes) {
-  auto res = getDeviceDescFromArgs(context, argTypes);
-  if (mlir::failed(res) || !*res)
-    return mlir::failure();
-
-  return *res;
-}
-
 struct InsertGpuRegionPass
     : public mlir::PassWrapper<InsertGpuRegionPass, mlir::OperationPass<void>> {
   MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(InsertGpuRegionPass)
@@ -1059,13 +1060,21 @@ struct InsertGpuRegionPass
       if (!parent)
         continue;
 
-      auto env = getDeviceDescFromFunc(ctx, parent.getArgumentTypes());
+      auto env = getDeviceDescFromArgs(ctx, parent.getArgumentTypes());
       if (mlir::failed(env))
         continue;
 
+      // Kernels, called with host arrays, are lowered to the host loops.
+      mlir::Attribute regionEnv = *env;
+      if (!regionEnv)
+        regionEnv = gpu_runtime::GPURegionDescAttr::get(
+            ctx, gpu_runtime::getHostDeviceName(), "device",
+            /*spirvMajor*/ 1, /*spirvMinor*/ 2, /*hasFP16*/ true,
+            /*hasFP64*/ true);
+
       builder.setInsertionPoint(nestedRegion);
       auto region = builder.create<numba::util::EnvironmentRegionOp>(
-          loc, *env, /*args*/ std::nullopt, loop->getResultTypes());
+          loc, regionEnv, /*args*/ std::nullopt, loop->getResultTypes());
       mlir::Block &body = region.getRegion().front();
       body.getTerminator()->erase();
       loop.getResults().replaceAllUsesWith(region.getResults());
@@ -1383,20 +1392,38 @@ struct LowerKernelAllocCalls
   }
 };
 
-static bool isValidAtomicSig(mlir::func::CallOp op) {
-  if (op.getNumResults() != 1 || op.getNumOperands() != 2)
+static bool isValidAtomicSig(mlir::func::CallOp op, unsigned numVals) {
+  if (op.getNumResults() != 1 || op.getNumOperands() != numVals + 1)
     return false;
 
   auto res = op.getResult(0);
   auto arr = op.getOperand(0);
-  auto val = op.getOperand(1);
 
   auto arrType = mlir::dyn_cast<numba::ntensor::NTensorType>(arr.getType());
   if (!arrType)
     return false;
 
   auto elemType = arrType.getElementType();
-  return res.getType() == elemType && val.getType() == elemType;
+  return res.getType() == elemType &&
+         llvm::all_of(op.getOperands().drop_front(), [&](mlir::Value val) {
+           return val.getType() == elemType;
+         });
+}
+
+/// Builds `memref.generic_atomic_rmw` with `bodyBuilder(current value)` body.
+static mlir::Value createGenericAtomic(
+    mlir::OpBuilder &builder, mlir::Location loc, mlir::Value memref,
+    mlir::ValueRange indices,
+    llvm::function_ref<mlir::Value(mlir::OpBuilder &, mlir::Location,
+                                   mlir::Value)>
+        bodyBuilder) {
+  auto op =
+      builder.create<mlir::memref::GenericAtomicRMWOp>(loc, memref, indices);
+  mlir::OpBuilder::InsertionGuard g(builder);
+  builder.setInsertionPointToStart(op.getBody());
+  auto res = bodyBuilder(builder, loc, op.getCurrentValue());
+  builder.create<mlir::memref::AtomicYieldOp>(loc, res);
+  return op.getResult();
 }
 
 struct LowerKernelAtomicCalls
@@ -1406,33 +1433,50 @@ struct LowerKernelAtomicCalls
   mlir::LogicalResult
   matchAndRewrite(mlir::func::CallOp op,
                   mlir::PatternRewriter &rewriter) const override {
-    if (!isValidAtomicSig(op))
-      return mlir::failure();
-
     using RMWK = mlir::arith::AtomicRMWKind;
 
-    const std::tuple<mlir::StringRef, RMWK, RMWK> handlers[] = {
-        {"atomic_add_", RMWK::addi, RMWK::addf}};
+    auto name = op.getCallee();
+    bool isCAS = name.starts_with("atomic_cas_");
+    if (!isValidAtomicSig(op, isCAS ? 2 : 1))
+      return mlir::failure();
+
+    auto arr = op.getOperand(0);
+    auto arrType = mlir::cast<numba::ntensor::NTensorType>(arr.getType());
+    auto elemType = arrType.getElementType();
+
+    // Signed int, unsigned int and float kinds.
+    const std::tuple<mlir::StringRef, RMWK, RMWK, std::optional<RMWK>>
+        handlers[] = {
+            {"atomic_add_", RMWK::addi, RMWK::addi, RMWK::addf},
+            {"atomic_min_", RMWK::mins, RMWK::minu, RMWK::minimumf},
+            {"atomic_max_", RMWK::maxs, RMWK::maxu, RMWK::maximumf},
+            {"atomic_xchg_", RMWK::assign, RMWK::assign, RMWK::assign},
+            {"atomic_and_", RMWK::andi, RMWK::andi, std::nullopt},
+            {"atomic_or_", RMWK::ori, RMWK::ori, std::nullopt},
+        };
 
-    auto val = op.getOperand(1);
     auto kind = [&]() -> std::optional<RMWK> {
-      auto name = op.getCallee();
-      for (auto &&[funcName, iKind, fKind] : handlers) {
-        if (name.starts_with(funcName)) {
-          bool isFloat = mlir::isa<mlir::FloatType>(val.getType());
-          return isFloat ? fKind : iKind;
-        }
+      if (isCAS)
+        return std::nullopt;
+
+      for (auto &&[funcName, sKind, uKind, fKind] : handlers) {
+        if (!name.starts_with(funcName))
+          continue;
+
+        if (mlir::isa<mlir::FloatType>(elemType))
+          return fKind;
+
+        return elemType.isUnsignedInteger() ? uKind : sKind;
       }
       return std::nullopt;
     }();
-    if (!kind)
+    if (!kind && !isCAS)
       return mlir::failure();
 
-    auto arr = op.getOperand(0);
+    if (isCAS && !elemType.isIntOrFloat())
+      return mlir::failure();
 
-    auto arrType = mlir::cast<numba::ntensor::NTensorType>(arr.getType());
-    auto memrefType =
-        mlir::MemRefType::get(arrType.getShape(), arrType.getElementType());
+    auto memrefType = mlir::MemRefType::get(arrType.getShape(), elemType);
     auto signlessMemerefType = numba::makeSignlessType(memrefType);
 
     auto loc = op.getLoc();
@@ -1443,15 +1487,58 @@ struct LowerKernelAtomicCalls
           loc, signlessMemerefType, memref);
 
     auto signelessElemType = signlessMemerefType.getElementType();
-    if (val.getType() != signelessElemType)
-      val =
-          rewriter.create<numba::util::SignCastOp>(loc, signelessElemType, val);
+    auto toSignless = [&](mlir::Value val) -> mlir::Value {
+      if (val.getType() != signelessElemType)
+        val = rewriter.create<numba::util::SignCastOp>(loc, signelessElemType,
+                                                       val);
+      return val;
+    };
 
     mlir::Value zero = rewriter.create<mlir::arith::ConstantIndexOp>(loc, 0);
     llvm::SmallVector<mlir::Value> indices(memrefType.getRank(), zero);
 
-    mlir::Value newRes = rewriter.create<mlir::memref::AtomicRMWOp>(
-        loc, *kind, val, memref, indices);
+    mlir::Value newRes;
+    if (isCAS) {
+      // Compare bits for the floats, so NaNs can be swapped too.
+      auto width = signelessElemType.getIntOrFloatBitWidth();
+      auto intType = rewriter.getIntegerType(width);
+      auto intMemrefType = signlessMemerefType.clone(intType);
+      mlir::Value intMemref = memref;
+      auto toInt = [&](mlir::Value val) -> mlir::Value {
+        if (val.getType() != intType)
+          val = rewriter.create<mlir::arith::BitcastOp>(loc, intType, val);
+        return val;
+      };
+      if (intMemrefType != signlessMemerefType)
+        intMemref = rewriter.create<numba::util::MemrefBitcastOp>(
+            loc, intMemrefType, memref);
+
+      auto cmp = toInt(toSignless(op.getOperand(1)));
+      auto val = toInt(toSignless(op.getOperand(2)));
+      newRes = createGenericAtomic(
+          rewriter, loc, intMemref, indices,
+          [&](mlir::OpBuilder &b, mlir::Location l, mlir::Value current) {
+            auto eq = b.create<mlir::arith::CmpIOp>(
+                l, mlir::arith::CmpIPredicate::eq, current, cmp);
+            return b.create<mlir::arith::SelectOp>(l, eq, val, current);
+          });
+      if (newRes.getType() != signelessElemType)
+        newRes = rewriter.create<mlir::arith::BitcastOp>(
+            loc, signelessElemType, newRes);
+    } else if (*kind == RMWK::minimumf || *kind == RMWK::maximumf) {
+      // Not all backends support float min/max natively, use generic op,
+      // which can be lowered to the CAS loop.
+      auto val = toSignless(op.getOperand(1));
+      newRes = createGenericAtomic(
+          rewriter, loc, memref, indices,
+          [&](mlir::OpBuilder &b, mlir::Location l, mlir::Value current) {
+            return mlir::arith::getReductionOp(*kind, b, l, current, val);
+          });
+    } else {
+      auto val = toSignless(op.getOperand(1));
+      newRes = rewriter.create<mlir::memref::AtomicRMWOp>(loc, *kind, val,
+                                                          memref, indices);
+    }
 
     auto resType = op.getResult(0).getType();
     if (newRes.getType() != resType)
@@ -1550,13 +1637,59 @@ public:
   }
 };
 
-template <mlir::gpu::AllReduceOperation ReduceType>
-static void genGroupOp(mlir::Operation *srcOp, mlir::PatternRewriter &rewriter,
-                       mlir::Value arg) {
-  auto ctx = srcOp->getContext();
-  auto reduceAttr = mlir::gpu::AllReduceOperationAttr::get(ctx, ReduceType);
-  rewriter.replaceOpWithNewOp<mlir::gpu::AllReduceOp>(srcOp, arg, reduceAttr,
-                                                      /*uniform*/ false);
+/// Parses `<op>_<dtype>` suffix of the collective function name.
+static std::optional<mlir::gpu::AllReduceOperation>
+parseCollectiveOp(llvm::StringRef name, bool isFloat) {
+  using Op = mlir::gpu::AllReduceOperation;
+  const std::tuple<llvm::StringRef, Op, Op> handlers[] = {
+      {"add_", Op::ADD, Op::ADD},
+      {"mul_", Op::MUL, Op::MUL},
+      {"min_", Op::MINSI, Op::MINIMUMF},
+      {"max_", Op::MAXSI, Op::MAXIMUMF},
+  };
+
+  for (auto &&[prefix, intOp, floatOp] : handlers)
+    if (name.starts_with(prefix))
+      return isFloat ? floatOp : intOp;
+
+  return std::nullopt;
+}
+
+/// Lowers `reduce_<op>_<dtype>` or `{inclusive,exclusive}_scan_<op>_<dtype>`
+/// collective call.
+template <typename ReduceOp, typename ScanOp>
+static mlir::LogicalResult lowerCollectiveCall(mlir::func::CallOp op,
+                                               llvm::StringRef funcName,
+                                               mlir::PatternRewriter &rewriter,
+                                               mlir::Value src) {
+  auto isFloat = mlir::isa<mlir::FloatType>(src.getType());
+  if (funcName.consume_front("reduce_")) {
+    auto reduceOp = parseCollectiveOp(funcName, isFloat);
+    if (!reduceOp)
+      return mlir::failure();
+
+    if constexpr (std::is_same_v<ReduceOp, mlir::gpu::AllReduceOp>) {
+      auto reduceAttr = mlir::gpu::AllReduceOperationAttr::get(
+          rewriter.getContext(), *reduceOp);
+      rewriter.replaceOpWithNewOp<ReduceOp>(op, src, reduceAttr,
+                                            /*uniform*/ false);
+    } else {
+      rewriter.replaceOpWithNewOp<ReduceOp>(op, src, *reduceOp);
+    }
+    return mlir::success();
+  }
+
+  bool exclusive = funcName.consume_front("exclusive_scan_");
+  if (!exclusive && !funcName.consume_front("inclusive_scan_"))
+    return mlir::failure();
+
+  auto scanOp = parseCollectiveOp(funcName, isFloat);
+  if (!scanOp)
+    return mlir::failure();
+
+  rewriter.replaceOpWithNewOp<ScanOp>(op, src.getType(), src, *scanOp,
+                                      exclusive);
+  return mlir::success();
 }
 
 class ConvertGroupOps : public mlir::OpRewritePattern<mlir::func::CallOp> {
@@ -1586,28 +1719,86 @@ public:
     if (!funcName.consume_front("group_"))
       return mlir::failure();
 
-    using funcptr_t =
-        void (*)(mlir::Operation *, mlir::PatternRewriter &, mlir::Value);
-    const std::tuple<llvm::StringRef, funcptr_t, funcptr_t> handlers[] = {
-        {"reduce_add", &genGroupOp<mlir::gpu::AllReduceOperation::ADD>,
-         &genGroupOp<mlir::gpu::AllReduceOperation::ADD>},
-        {"reduce_mul", &genGroupOp<mlir::gpu::AllReduceOperation::MUL>,
-         &genGroupOp<mlir::gpu::AllReduceOperation::MUL>},
-        {"reduce_min", &genGroupOp<mlir::gpu::AllReduceOperation::MINSI>,
-         &genGroupOp<mlir::gpu::AllReduceOperation::MINIMUMF>},
-        {"reduce_max", &genGroupOp<mlir::gpu::AllReduceOperation::MAXSI>,
-         &genGroupOp<mlir::gpu::AllReduceOperation::MAXIMUMF>},
+    return lowerCollectiveCall<mlir::gpu::AllReduceOp,
+                               gpu_runtime::GPUGroupScanOp>(op, funcName,
+                                                            rewriter, src);
+  }
+};
+
+/// Lowers subgroup functions calls to the gpu subgroup ops.
+class ConvertSubgroupOps : public mlir::OpRewritePattern<mlir::func::CallOp> {
+public:
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::func::CallOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    if (!op->getParentOfType<mlir::gpu::LaunchOp>())
+      return mlir::failure();
+
+    if (op.getNumResults() != 1)
+      return mlir::failure();
+
+    auto funcName = op.getCallee();
+    if (!funcName.consume_front("subgroup_"))
+      return mlir::failure();
+
+    auto loc = op.getLoc();
+    auto resType = op.getResult(0).getType();
+    auto operands = op.getOperands();
+    if (operands.empty()) {
+      if (!mlir::isa<mlir::IntegerType>(resType))
+        return mlir::failure();
+
+      mlir::Value res = [&]() -> mlir::Value {
+        if (funcName == "get_local_id")
+          return rewriter.create<mlir::gpu::LaneIdOp>(loc);
+        if (funcName == "get_size")
+          return rewriter.create<mlir::gpu::SubgroupSizeOp>(loc);
+        if (funcName == "get_group_id")
+          return rewriter.create<mlir::gpu::SubgroupIdOp>(loc);
+        if (funcName == "get_num_groups")
+          return rewriter.create<mlir::gpu::NumSubgroupsOp>(loc);
+        return {};
+      }();
+      if (!res)
+        return mlir::failure();
+
+      res = rewriter.create<mlir::arith::IndexCastOp>(loc, resType, res);
+      rewriter.replaceOp(op, res);
+      return mlir::success();
+    }
+
+    auto src = operands[0];
+    if (src.getType() != resType || !resType.isIntOrFloat())
+      return mlir::failure();
+
+    if (operands.size() == 1)
+      return lowerCollectiveCall<mlir::gpu::SubgroupReduceOp,
+                                 gpu_runtime::GPUSubgroupScanOp>(
+          op, funcName, rewriter, src);
+
+    if (operands.size() != 2 || !operands[1].getType().isInteger(32))
+      return mlir::failure();
+
+    using Mode = mlir::gpu::ShuffleMode;
+    const std::pair<llvm::StringRef, Mode> handlers[] = {
+        {"shuffle_xor_", Mode::XOR},
+        {"shuffle_", Mode::IDX},
+        {"broadcast_", Mode::IDX},
     };
 
-    for (auto &&[name, intFunc, floatFunc] : handlers) {
-      if (funcName.starts_with(name)) {
-        if (mlir::isa<mlir::IntegerType>(srcType)) {
-          intFunc(op, rewriter, src);
-        } else {
-          floatFunc(op, rewriter, src);
-        }
-        return mlir::success();
-      }
+    for (auto &&[name, mode] : handlers) {
+      if (!funcName.starts_with(name))
+        continue;
+
+      mlir::Value width = rewriter.create<mlir::gpu::SubgroupSizeOp>(loc);
+      width = rewriter.create<mlir::arith::IndexCastOp>(
+          loc, rewriter.getI32Type(), width);
+      auto shuffle = rewriter.create<mlir::gpu::ShuffleOp>(
+          loc, src, operands[1], width, mode);
+      rewriter.replaceOp(op, shuffle.getShuffleResult());
+      return mlir::success();
     }
 
     return mlir::failure();
@@ -1635,6 +1826,59 @@ static ReduceFuncType getReduceFunc(mlir::gpu::AllReduceOperation op,
   return nullptr;
 }
 
+/// Allocates workgroup buffer with the element per subgroup before the
+/// `launchOp`.
+static mlir::Value createSubgroupsBuffer(mlir::PatternRewriter &rewriter,
+                                         mlir::gpu::LaunchOp launchOp,
+                                         mlir::Type elemType) {
+  mlir::OpBuilder::InsertionGuard g(rewriter);
+  rewriter.setInsertionPoint(launchOp);
+  auto loc = launchOp->getLoc();
+  mlir::Value size = launchOp.getBlockSizeX();
+  size =
+      rewriter.create<mlir::arith::MulIOp>(loc, size, launchOp.getBlockSizeY());
+  size =
+      rewriter.create<mlir::arith::MulIOp>(loc, size, launchOp.getBlockSizeZ());
+
+  // Use min subgroup size, supported by device, to get upper bound for
+  // the subgroups count, actual size is selected by driver.
+  int64_t minSubgroupSize = 8;
+  if (auto env = getGpuRegionEnv(launchOp))
+    if (env.getSubgroupSize() > 0)
+      minSubgroupSize = env.getSubgroupSize();
+
+  mlir::Value subgroupSize =
+      rewriter.create<mlir::arith::ConstantIndexOp>(loc, minSubgroupSize);
+
+  mlir::Value numSubgroups =
+      rewriter.create<mlir::arith::CeilDivSIOp>(loc, size, subgroupSize);
+
+  auto addrSpace = mlir::gpu::GPUDialect::getWorkgroupAddressSpace();
+  auto storageClass =
+      mlir::gpu::AddressSpaceAttr::get(rewriter.getContext(), addrSpace);
+  auto memrefType = mlir::MemRefType::get(mlir::ShapedType::kDynamic,
+                                          elemType, nullptr, storageClass);
+  mlir::Value groupBuffer =
+      rewriter
+          .create<mlir::gpu::AllocOp>(
+              loc, memrefType, /*asyncToken*/ mlir::Type(),
+              /*asyncDependencies*/ std::nullopt, numSubgroups,
+              /*symbolOperands*/ std::nullopt)
+          .getMemref();
+  rewriter.setInsertionPointAfter(launchOp);
+  rewriter.create<mlir::gpu::DeallocOp>(loc, /*asyncToken*/ mlir::Type(),
+                                        /*asyncDependencies*/ std::nullopt,
+                                        groupBuffer);
+  return groupBuffer;
+}
+
+static void createLocalBarrier(mlir::OpBuilder &builder, mlir::Location loc) {
+  auto barrierOp = builder.create<mlir::gpu::BarrierOp>(loc);
+  auto barrierFlagAttr = builder.getI64IntegerAttr(
+      static_cast<int64_t>(gpu_runtime::FenceFlags::local));
+  barrierOp->setAttr(gpu_runtime::getFenceFlagsAttrName(), barrierFlagAttr);
+}
+
 class ConvertGroupOpsToSubgroup
     : public mlir::OpRewritePattern<mlir::gpu::AllReduceOp> {
 public:
@@ -1667,42 +1911,7 @@ public:
     if (!reduceFunc)
       return mlir::failure();
 
-    mlir::Value groupBuffer;
-    {
-      mlir::OpBuilder::InsertionGuard g(rewriter);
-      rewriter.setInsertionPoint(launchOp);
-      auto loc = launchOp->getLoc();
-      mlir::Value size = launchOp.getBlockSizeX();
-      size = rewriter.create<mlir::arith::MulIOp>(loc, size,
-                                                  launchOp.getBlockSizeY());
-      size = rewriter.create<mlir::arith::MulIOp>(loc, size,
-                                                  launchOp.getBlockSizeZ());
-
-      // TODO: Subgroup size is hardcoded for now.
-      mlir::Value subgroupSize =
-          rewriter.create<mlir::arith::ConstantIndexOp>(loc, 8);
-
-      mlir::Value numSubgroups =
-          rewriter.create<mlir::arith::CeilDivSIOp>(loc, size, subgroupSize);
-
-      auto elemType = op.getType();
-
-      auto addrSpace = mlir::gpu::GPUDialect::getWorkgroupAddressSpace();
-      auto storageClass =
-          mlir::gpu::AddressSpaceAttr::get(rewriter.getContext(), addrSpace);
-      auto memrefType = mlir::MemRefType::get(mlir::ShapedType::kDynamic,
-                                              elemType, nullptr, storageClass);
-      groupBuffer = rewriter
-                        .create<mlir::gpu::AllocOp>(
-                            loc, memrefType, /*asyncToken*/ mlir::Type(),
-                            /*asyncDependencies*/ std::nullopt, numSubgroups,
-                            /*symbolOperands*/ std::nullopt)
-                        .getMemref();
-      rewriter.setInsertionPointAfter(launchOp);
-      rewriter.create<mlir::gpu::DeallocOp>(loc, /*asyncToken*/ mlir::Type(),
-                                            /*asyncDependencies*/ std::nullopt,
-                                            groupBuffer);
-    }
+    auto groupBuffer = createSubgroupsBuffer(rewriter, launchOp, op.getType());
 
     mlir::Value subgroupId = [&]() {
       mlir::OpBuilder::InsertionGuard g(rewriter);
@@ -1717,10 +1926,7 @@ public:
     rewriter.create<mlir::memref::StoreOp>(loc, sgResult, groupBuffer,
                                            subgroupId);
 
-    auto barrierOp = rewriter.create<mlir::gpu::BarrierOp>(loc);
-    auto barrierFlagAttr = rewriter.getI64IntegerAttr(
-        static_cast<int64_t>(gpu_runtime::FenceFlags::local));
-    barrierOp->setAttr(gpu_runtime::getFenceFlagsAttrName(), barrierFlagAttr);
+    createLocalBarrier(rewriter, loc);
 
     mlir::Value numSubgroups = [&]() {
       mlir::OpBuilder::InsertionGuard g(rewriter);
@@ -1764,8 +1970,7 @@ public:
 
     rewriter.create<mlir::scf::IfOp>(loc, isFirstSg, ifBodyBuilder);
 
-    barrierOp = rewriter.create<mlir::gpu::BarrierOp>(loc);
-    barrierOp->setAttr(gpu_runtime::getFenceFlagsAttrName(), barrierFlagAttr);
+    createLocalBarrier(rewriter, loc);
 
     mlir::Value result =
         rewriter.create<mlir::memref::LoadOp>(loc, groupBuffer, zero);
@@ -1774,10 +1979,375 @@ public:
   }
 };
 
+static std::optional<mlir::arith::AtomicRMWKind>
+getAtomicRMWKind(mlir::gpu::AllReduceOperation op, bool isFloat) {
+  using Op = mlir::gpu::AllReduceOperation;
+  using RMWK = mlir::arith::AtomicRMWKind;
+  switch (op) {
+  case Op::ADD:
+    return isFloat ? RMWK::addf : RMWK::addi;
+  case Op::MUL:
+    return isFloat ? RMWK::mulf : RMWK::muli;
+  case Op::MINSI:
+    return RMWK::mins;
+  case Op::MAXSI:
+    return RMWK::maxs;
+  case Op::MINIMUMF:
+    return RMWK::minimumf;
+  case Op::MAXIMUMF:
+    return RMWK::maximumf;
+  default:
+    return std::nullopt;
+  }
+}
+
+/// Lowers group scan to the subgroup scans: each subgroup stores its total
+/// into workgroup buffer and items combine subgroup scan result with totals of
+/// the preceding subgroups.
+class ConvertGroupScanToSubgroup
+    : public mlir::OpRewritePattern<gpu_runtime::GPUGroupScanOp> {
+public:
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(gpu_runtime::GPUGroupScanOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto launchOp = op->getParentOfType<mlir::gpu::LaunchOp>();
+    if (!launchOp)
+      return mlir::failure();
+
+    auto kind = getAtomicRMWKind(op.getOp(),
+                                 mlir::isa<mlir::FloatType>(op.getType()));
+    if (!kind)
+      return mlir::failure();
+
+    auto groupBuffer = createSubgroupsBuffer(rewriter, launchOp, op.getType());
+
+    mlir::Value subgroupId = [&]() {
+      mlir::OpBuilder::InsertionGuard g(rewriter);
+      rewriter.setInsertionPointToStart(&launchOp.getBody().front());
+      return rewriter.create<mlir::gpu::SubgroupIdOp>(rewriter.getUnknownLoc());
+    }();
+
+    auto loc = op->getLoc();
+    auto value = op.getValue();
+    auto reduceType = op.getOp();
+    mlir::Value sgScan = rewriter.create<gpu_runtime::GPUSubgroupScanOp>(
+        loc, value.getType(), value, reduceType, op.getExclusive());
+    mlir::Value sgTotal =
+        rewriter.create<mlir::gpu::SubgroupReduceOp>(loc, value, reduceType);
+
+    // All subgroup items store the same value.
+    rewriter.create<mlir::memref::StoreOp>(loc, sgTotal, groupBuffer,
+                                           subgroupId);
+    createLocalBarrier(rewriter, loc);
+
+    auto bodyBuilder = [&](mlir::OpBuilder &b, mlir::Location l, mlir::Value i,
+                           mlir::ValueRange args) {
+      mlir::Value val = b.create<mlir::memref::LoadOp>(l, groupBuffer, i);
+      mlir::Value res =
+          mlir::arith::getReductionOp(*kind, b, l, val, args.front());
+      b.create<mlir::scf::YieldOp>(l, res);
+    };
+
+    mlir::Value zero = rewriter.create<mlir::arith::ConstantIndexOp>(loc, 0);
+    mlir::Value one = rewriter.create<mlir::arith::ConstantIndexOp>(loc, 1);
+    mlir::Value result =
+        rewriter
+            .create<mlir::scf::ForOp>(loc, zero, subgroupId, one, sgScan,
+                                      bodyBuilder)
+            .getResult(0);
+
+    // Buffer can be reused if scan is inside the loop.
+    createLocalBarrier(rewriter, loc);
+    rewriter.replaceOp(op, result);
+    return mlir::success();
+  }
+};
+
 struct LowerGpuBuiltins2Pass
     : public numba::RewriteWrapperPass<
           LowerGpuBuiltins2Pass, void, void, ConvertBarrierOps, ConvertGroupOps,
-          ConvertGroupOpsToSubgroup, LowerBuiltinCalls> {};
+          ConvertSubgroupOps, ConvertGroupOpsToSubgroup,
+          ConvertGroupScanToSubgroup, LowerBuiltinCalls> {};
+
+static bool isHostRegion(numba::util::EnvironmentRegionOp op) {
+  auto env =
+      mlir::dyn_cast<gpu_runtime::GPURegionDescAttr>(op.getEnvironment());
+  return env && env.getDevice() == gpu_runtime::getHostDeviceName();
+}
+
+/// Host launches don't have the kernel to query preferred local size, use
+/// the fixed one, clamped to the global size.
+static void lowerHostSuggestBlockSize(mlir::func::FuncOp func) {
+  auto &region = func.getBody();
+  if (!llvm::hasSingleElement(region))
+    return;
+
+  // Explicitly set local size is handled by GPULowerDefaultLocalSize.
+  mlir::func::CallOp setDefSize;
+  for (auto op : region.front().getOps<mlir::func::CallOp>()) {
+    if (op.getCallee() == "set_default_local_size" &&
+        op->getNumOperands() == 3) {
+      setDefSize = op;
+      break;
+    }
+  }
+
+  const int64_t hostLocalSize[] = {64, 1, 1};
+  mlir::DominanceInfo dom;
+  mlir::OpBuilder builder(func.getContext());
+  func.walk([&](gpu_runtime::GPUSuggestBlockSizeOp op) {
+    auto env = getGpuRegionEnv(op);
+    if (!env || !gpu_runtime::isCpuRegion(env))
+      return;
+
+    if (setDefSize && dom.properlyDominates(setDefSize, op))
+      return;
+
+    auto loc = op.getLoc();
+    builder.setInsertionPoint(op);
+    llvm::SmallVector<mlir::Value, 3> results;
+    for (auto &&[gridSize, localSize] :
+         llvm::zip(op.getGridSize(), hostLocalSize)) {
+      mlir::Value size =
+          builder.create<mlir::arith::ConstantIndexOp>(loc, localSize);
+      if (localSize != 1)
+        size = builder.create<mlir::arith::MinUIOp>(loc, size, gridSize);
+
+      results.emplace_back(size);
+    }
+    op->replaceAllUsesWith(results);
+    op.erase();
+  });
+}
+
+/// Vectorize item loops on the dimension with the best estimated speedup.
+static void vectorizeItemLoops(mlir::func::FuncOp func,
+                               llvm::ArrayRef<mlir::scf::ParallelOp> loops) {
+  auto attr = func->getAttrOfType<mlir::IntegerAttr>(
+      numba::util::attributes::getVectorLengthName());
+  if (!attr || attr.getInt() <= 0)
+    return;
+
+  auto costModel = numba::SCFVectorizeCostModel::get(
+      static_cast<unsigned>(attr.getInt()));
+  mlir::OpBuilder builder(func.getContext());
+  for (auto loop : loops) {
+    std::optional<numba::SCFVectorizeInfo> best;
+    for (auto dim : llvm::seq(0u, loop.getNumLoops())) {
+      auto info = numba::getLoopVectorizeInfo(loop, dim, costModel);
+      if (info && (!best || info->getSpeedup() > best->getSpeedup()))
+        best = *info;
+    }
+
+    if (!best || best->getSpeedup() <= 1.0)
+      continue;
+
+    numba::SCFVectorizeParams params{best->dim, best->factor * best->interleave,
+                                     best->masked};
+    builder.setInsertionPoint(loop);
+    (void)numba::vectorizeLoop(builder, loop, params);
+  }
+}
+
+/// Make each iteration of `loop` process `factor` adjacent elements on `dim`.
+/// Full chunks are unrolled without bounds checks, so adjacent accesses can be
+/// combined into vector and block memory ops by the device compiler, last
+/// incomplete chunk is processed by the tail loop.
+static void coarsenLoop(mlir::OpBuilder &builder, mlir::scf::ParallelOp loop,
+                        unsigned dim, unsigned factor) {
+  auto loc = loop.getLoc();
+  auto lower = llvm::to_vector(loop.getLowerBound());
+  auto upper = llvm::to_vector(loop.getUpperBound());
+  auto origLower = lower[dim];
+  auto origUpper = upper[dim];
+
+  builder.setInsertionPoint(loop);
+  mlir::Value zero = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+  mlir::Value one = builder.create<mlir::arith::ConstantIndexOp>(loc, 1);
+  mlir::Value factorVal =
+      builder.create<mlir::arith::ConstantIndexOp>(loc, factor);
+  mlir::Value count =
+      builder.create<mlir::arith::SubIOp>(loc, origUpper, origLower);
+  lower[dim] = zero;
+  upper[dim] = builder.create<mlir::arith::CeilDivSIOp>(loc, count, factorVal);
+
+  auto newLoop = builder.create<mlir::scf::ParallelOp>(loc, lower, upper,
+                                                       loop.getStep());
+  newLoop->setDiscardableAttrs(loop->getDiscardableAttrDictionary());
+  auto origIndexVar = loop.getInductionVars()[dim];
+
+  mlir::IRMapping mapping;
+  auto cloneBody = [&](mlir::OpBuilder &b, mlir::Value idx) {
+    mapping.clear();
+    mapping.map(loop.getInductionVars(), newLoop.getInductionVars());
+    mapping.map(origIndexVar, idx);
+    for (mlir::Operation &op : loop.getBody()->without_terminator())
+      b.clone(op, mapping);
+  };
+
+  builder.setInsertionPointToStart(newLoop.getBody());
+  mlir::Value base = builder.create<mlir::arith::MulIOp>(
+      loc, newLoop.getInductionVars()[dim], factorVal);
+  base = builder.create<mlir::arith::AddIOp>(loc, base, origLower);
+  mlir::Value chunkEnd =
+      builder.create<mlir::arith::AddIOp>(loc, base, factorVal);
+  mlir::Value isFull = builder.create<mlir::arith::CmpIOp>(
+      loc, mlir::arith::CmpIPredicate::sle, chunkEnd, origUpper);
+
+  auto ifOp = builder.create<mlir::scf::IfOp>(loc, isFull,
+                                              /*withElseRegion*/ true);
+  builder.setInsertionPoint(ifOp.thenBlock()->getTerminator());
+  for (auto i : llvm::seq(0u, factor)) {
+    mlir::Value idx = base;
+    if (i != 0) {
+      mlir::Value offset = builder.create<mlir::arith::ConstantIndexOp>(loc, i);
+      idx = builder.create<mlir::arith::AddIOp>(loc, base, offset);
+    }
+    cloneBody(builder, idx);
+  }
+
+  builder.setInsertionPoint(ifOp.elseBlock()->getTerminator());
+  auto bodyBuilder = [&](mlir::OpBuilder &b, mlir::Location /*loc*/,
+                         mlir::Value idx, mlir::ValueRange /*args*/) {
+    cloneBody(b, idx);
+    b.create<mlir::scf::YieldOp>(loc);
+  };
+  builder.create<mlir::scf::ForOp>(loc, base, origUpper, one, std::nullopt,
+                                   bodyBuilder);
+  loop->erase();
+}
+
+/// Coarsen elementwise GPU loops, which only have contiguous memory accesses
+/// on some dimension, by the number of elements fitting into the function
+/// `gpu_runtime.vector_bitwidth`. Must be run before tiling and mapping.
+struct GpuCoarsenLoopsPass
+    : public mlir::PassWrapper<GpuCoarsenLoopsPass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(GpuCoarsenLoopsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    auto attr = func->getAttrOfType<mlir::IntegerAttr>(
+        gpu_runtime::getVectorBitwidthAttrName());
+    if (!attr || attr.getInt() <= 0)
+      return markAllAnalysesPreserved();
+
+    auto costModel = numba::SCFVectorizeCostModel::get(
+        static_cast<unsigned>(attr.getInt()));
+
+    llvm::SmallVector<std::pair<mlir::scf::ParallelOp, numba::SCFVectorizeInfo>>
+        loops;
+    func.walk([&](mlir::scf::ParallelOp loop) {
+      auto env = getGpuRegionEnv(loop);
+      if (!env || gpu_runtime::isCpuRegion(env) ||
+          loop->getParentOfType<mlir::scf::ParallelOp>() ||
+          !loop.getInitVals().empty())
+        return;
+
+      std::optional<numba::SCFVectorizeInfo> best;
+      for (auto dim : llvm::seq(0u, loop.getNumLoops())) {
+        auto info = numba::getLoopVectorizeInfo(loop, dim, costModel);
+        if (!info || info->count == 0 || info->gathers != 0 ||
+            info->replicated != 0)
+          continue;
+
+        if (!best || info->count > best->count)
+          best = *info;
+      }
+
+      if (best && best->factor > 1)
+        loops.emplace_back(loop, *best);
+    });
+
+    if (loops.empty())
+      return markAllAnalysesPreserved();
+
+    mlir::OpBuilder builder(&getContext());
+    for (auto &&[loop, info] : loops)
+      coarsenLoop(builder, loop, info.dim, info.factor);
+  }
+};
+
+/// Lower launches for the host and CPU SYCL devices to the host loops, so
+/// they go through the same TBB outlining as the regular parallel loops
+/// instead of SPIR-V kernels. Must be run before GPU allocations are
+/// created, as host regions are removed here.
+struct LowerHostLaunchesPass
+    : public mlir::PassWrapper<LowerHostLaunchesPass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(LowerHostLaunchesPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+    registry.insert<mlir::ub::UBDialect>();
+    registry.insert<mlir::vector::VectorDialect>();
+  }
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    auto *ctx = &getContext();
+
+    llvm::SmallVector<mlir::gpu::LaunchOp> launches;
+    func.walk([&](mlir::gpu::LaunchOp launch) {
+      auto env = getGpuRegionEnv(launch);
+      if (env && gpu_runtime::isCpuRegion(env))
+        launches.emplace_back(launch);
+    });
+
+    lowerHostSuggestBlockSize(func);
+
+    // Group reductions are lowered to the item loops directly, don't convert
+    // them to subgroup ops.
+    mlir::RewritePatternSet patterns(ctx);
+    patterns.insert<ConvertBarrierOps, ConvertGroupOps, ConvertSubgroupOps,
+                    LowerBuiltinCalls>(ctx);
+    gpu_runtime::populateMakeBarriersUniformPatterns(patterns);
+    mlir::FrozenRewritePatternSet frozenPatterns(std::move(patterns));
+
+    mlir::GreedyRewriteConfig config;
+    config.useTopDownTraversal = true; // Visit top barriers first.
+
+    mlir::OpBuilder builder(ctx);
+    llvm::SmallVector<mlir::scf::ParallelOp> itemLoops;
+    for (auto launch : launches) {
+      (void)mlir::applyPatternsAndFoldGreedily(launch, frozenPatterns, config);
+
+      auto env = getGpuRegionEnv(launch);
+      if (mlir::succeeded(
+              gpu_runtime::lowerLaunchToCpu(builder, launch, &itemLoops)))
+        continue;
+
+      // CPU SYCL devices can still run the SPIR-V kernel.
+      if (env.getDevice() == gpu_runtime::getHostDeviceName()) {
+        launch.emitError("Kernel cannot be lowered to the host loops");
+        return signalPassFailure();
+      }
+    }
+
+    vectorizeItemLoops(func, itemLoops);
+
+    llvm::SmallVector<numba::util::EnvironmentRegionOp> hostRegions;
+    func.walk([&](numba::util::EnvironmentRegionOp op) {
+      if (isHostRegion(op))
+        hostRegions.emplace_back(op);
+    });
+
+    mlir::PatternRewriter rewriter(ctx);
+    for (auto op : hostRegions)
+      numba::util::EnvironmentRegionOp::inlineIntoParent(rewriter, op);
+  }
+};
 
 class ConvertLocalArrayAllocOps
     : public mlir::OpRewritePattern<mlir::memref::AllocaOp> {
@@ -2098,6 +2668,9 @@ static mlir::spirv::TargetEnvAttr deviceCapsMapper(mlir::gpu::GPUModuleOp op) {
       spirv::Capability::AtomicFloat32AddEXT,
       spirv::Capability::ExpectAssumeKHR,
       spirv::Capability::GenericPointer,
+      spirv::Capability::GroupNonUniform,
+      spirv::Capability::GroupNonUniformArithmetic,
+      spirv::Capability::GroupNonUniformShuffle,
       spirv::Capability::GroupUniformArithmeticKHR,
       spirv::Capability::Groups,
       spirv::Capability::Int16,
@@ -2156,8 +2729,10 @@ static void populateLowerToGPUPipelineMed(mlir::OpPassManager &pm) {
   funcPM.addPass(std::make_unique<PrepareForGPUPass>());
   funcPM.addPass(mlir::createCanonicalizerPass());
   funcPM.addPass(std::make_unique<RemoveNestedParallelPass>());
+  funcPM.addPass(gpu_runtime::createSplitParallelLoopsForDevicesPass());
   funcPM.addPass(mlir::math::createMathUpliftToFMA());
   funcPM.addPass(gpu_runtime::createSortParallelLoopsForGPU());
+  funcPM.addPass(std::make_unique<GpuCoarsenLoopsPass>());
   funcPM.addPass(gpu_runtime::createTileParallelLoopsForGPUPass());
   funcPM.addPass(gpu_runtime::createInsertGPUGlobalReducePass());
   funcPM.addPass(gpu_runtime::createParallelLoopGPUMappingPass());
@@ -2166,9 +2741,13 @@ static void populateLowerToGPUPipelineMed(mlir::OpPassManager &pm) {
   funcPM.addPass(mlir::createCanonicalizerPass());
   funcPM.addPass(gpu_runtime::createLowerGPUGlobalReducePass());
   commonOptPasses(funcPM);
+  funcPM.addPass(std::make_unique<LowerHostLaunchesPass>());
   funcPM.addPass(gpu_runtime::createCreateGPUAllocPass());
   funcPM.addPass(mlir::createCanonicalizerPass());
+  funcPM.addPass(gpu_runtime::createFuseGpuLaunchesPass());
+  funcPM.addPass(gpu_runtime::createPromoteToLocalMemoryPass());
   funcPM.addPass(std::make_unique<LowerGpuBuiltins2Pass>());
+  funcPM.addPass(numba::createHoistMemrefOffsetsPass());
   funcPM.addPass(gpu_runtime::createGpuDecomposeMemrefsPass());
   funcPM.addPass(mlir::memref::createExpandStridedMetadataPass());
   funcPM.addPass(mlir::createLowerAffinePass());
@@ -2188,6 +2767,7 @@ static void populateLowerToGPUPipelineMed(mlir::OpPassManager &pm) {
       std::make_unique<GPULowerDefaultLocalSize>());
   pm.addNestedPass<mlir::func::FuncOp>(mlir::createCanonicalizerPass());
   pm.addPass(mlir::createSymbolDCEPass());
+  pm.addPass(gpu_runtime::createGpuIndexVariantsPass());
 
   auto &gpuFuncPM =
       pm.nest<mlir::gpu::GPUModuleOp>().nest<mlir::gpu::GPUFuncOp>();
@@ -2196,6 +2776,9 @@ static void populateLowerToGPUPipelineMed(mlir::OpPassManager &pm) {
   gpuFuncPM.addPass(std::make_unique<FlattenScfPass>());
   gpuFuncPM.addPass(std::make_unique<LowerGpuBuiltins3Pass>());
   commonOptPasses(gpuFuncPM);
+  gpuFuncPM.addPass(numba::createNarrowIndexTypePass());
+  // Avoid 128-bit division in magic precomputation on devices.
+  gpuFuncPM.addPass(numba::createLoopInvariantDivisionPass(32));
 
   pm.addNestedPass<mlir::gpu::GPUModuleOp>(gpu_runtime::createAbiAttrsPass());
   pm.addPass(gpu_runtime::createSetSPIRVCapabilitiesPass(&deviceCapsMapper));
@@ -2215,6 +2798,8 @@ static void populateLowerToGPUPipelineMed(mlir::OpPassManager &pm) {
   pm.addNestedPass<mlir::func::FuncOp>(
       gpu_runtime::createConvertGPUDeallocsPass());
   pm.addNestedPass<mlir::func::FuncOp>(gpu_runtime::createGPUExPass());
+  pm.addNestedPass<mlir::func::FuncOp>(
+      gpu_runtime::createInsertGPUPrefetchPass());
   pm.addNestedPass<mlir::func::FuncOp>(std::make_unique<RemoveGpuRegionPass>());
   commonOptPasses(pm);
   pm.addNestedPass<mlir::func::FuncOp>(std::make_unique<GPUExDeallocPass>());
@@ -2246,7 +2831,7 @@ void registerLowerToGPUPipeline(numba::PipelineRegistry &registry) {
     auto lowStage = getLowerLoweringStage();
     sink(lowerToGPUPipelineNameMed(), {lowStage.begin, untuplePipelineName()},
          {lowStage.end, lowerToGPUPipelineNameLow(),
-          preLowerToLLVMPipelineName()},
+          preLowerToLLVMPipelineName(), parallelToTBBPipelineName()},
          {}, &populateLowerToGPUPipelineMed);
 
     sink(lowerToGPUPipelineNameLow(),
@@ -4,6 +4,7 @@
 
 #include "LowerToGpuTypeConversion.hpp"
 
+#include "CheckGpuCaps.hpp"
 #include "PyTypeConverter.hpp"
 
 #include "numba/Dialect/gpu_runtime/IR/GpuRuntimeOps.hpp"
@@ -49,19 +50,16 @@ struct Conversion {
           shape[i] = dim.cast<int64_t>();
     }
 
-    auto caps = obj.attr("get_device_caps")();
-    if (caps.is_none())
+    auto deviceCaps = numba::getDeviceCaps(obj);
+    if (!deviceCaps)
       return std::nullopt;
 
     auto usmType = obj.attr("usm_type").cast<std::string>();
 
-    auto device = caps.attr("filter_string").cast<std::string>();
-    auto spirvMajor = caps.attr("spirv_major_version").cast<int16_t>();
-    auto spirvMinor = caps.attr("spirv_minor_version").cast<int16_t>();
-    auto hasFP16 = caps.attr("has_fp16").cast<bool>();
-    auto hasFP64 = caps.attr("has_fp64").cast<bool>();
+    auto &[device, caps] = *deviceCaps;
     auto env = gpu_runtime::GPURegionDescAttr::get(
-        &context, device, usmType, spirvMajor, spirvMinor, hasFP16, hasFP64);
+        &context, device, usmType, caps.spirvMajorVersion,
+        caps.spirvMinorVersion, caps.hasFP16, caps.hasFP64, caps.subgroupSize);
 
     return numba::ntensor::NTensorType::get(shape, elemType, env,
                                             llvm::StringRef(layout));
@@ -30,25 +30,33 @@
 #include <mlir/Dialect/MemRef/Transforms/Passes.h>
 #include <mlir/Dialect/SCF/IR/SCF.h>
 #include <mlir/Dialect/UB/IR/UBOps.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
 #include <mlir/Dialect/Vector/IR/VectorOps.h>
 #include <mlir/Dialect/Vector/Transforms/LoweringPatterns.h>
 #include <mlir/Dialect/Vector/Transforms/VectorRewritePatterns.h>
 #include <mlir/Dialect/Vector/Transforms/VectorTransforms.h>
 #include <mlir/IR/Builders.h>
 #include <mlir/IR/IRMapping.h>
+#include <mlir/IR/Matchers.h>
 #include <mlir/IR/PatternMatch.h>
+#include <mlir/Interfaces/FunctionInterfaces.h>
 #include <mlir/Pass/Pass.h>
 #include <mlir/Pass/PassManager.h>
 #include <mlir/Transforms/GreedyPatternRewriteDriver.h>
 #include <mlir/Transforms/Passes.h>
 
 #include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/StringSwitch.h>
 #include <llvm/ADT/TypeSwitch.h>
 #include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/MathExtras.h>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/TargetParser/Host.h>
 
+#include <atomic>
+
 #include "BasePipeline.hpp"
 
 #include "numba/Compiler/PipelineRegistry.hpp"
@@ -56,12 +64,25 @@
 #include "numba/Conversion/UtilToLlvm.hpp"
 #include "numba/Dialect/numba_util/Dialect.hpp"
 #include "numba/Transforms/FuncUtils.hpp"
+#include "numba/Transforms/LoopInvariantDivision.hpp"
+#include "numba/Transforms/MemoryRewrites.hpp"
+#include "numba/Transforms/OutlineColdBlocks.hpp"
+#include "numba/Transforms/RefcountOpts.hpp"
 #include "numba/Transforms/RewriteWrapper.hpp"
+#include "numba/Transforms/ShapeIntegerRangePropagation.hpp"
 #include "numba/Utils.hpp"
 
 static const bool defineMeminfoFuncs = true;
 static const bool ensureUniqueAllocPtr = true;
 
+static std::atomic<bool> arenaAllocEnabled = true;
+static std::atomic<bool> allocPolicyEnabled = false;
+static std::atomic<uint64_t> nontemporalStoreThreshold = 32 * 1024 * 1024;
+static std::atomic<uint64_t> firstTouchThreshold = 0;
+
+static llvm::StringRef getArenaAllocAttrName() { return "numba.arena_alloc"; }
+static llvm::StringRef getZeroedAllocAttrName() { return "numba.zeroed_alloc"; }
+
 namespace {
 static mlir::LowerToLLVMOptions getLLVMOptions(mlir::MLIRContext &context) {
   static llvm::DataLayout dl = []() {
@@ -563,9 +584,27 @@ static mlir::Type getFunctionResType(mlir::MLIRContext &context,
   return convertTupleTypes(context, converter, newResTypes);
 }
 
+/// Shared callees are exported from the module, but keep the internal calling
+/// convention, as they are only called from the numba-mlir code.
+static bool isSharedCallee(mlir::func::FuncOp func) {
+  return func.isPublic() &&
+         func->hasAttr(numba::util::attributes::getSharedCalleeName());
+}
+
+static bool hasInternalABI(mlir::func::FuncOp func) {
+  return func.isPrivate() || isSharedCallee(func);
+}
+
 static mlir::LogicalResult fixFuncSig(LLVMTypeHelper &typeHelper,
                                       mlir::func::FuncOp func) {
-  if (func.isPrivate())
+  // Same callee can be compiled into multiple modules (e.g. AOT objects),
+  // linker will keep one of them.
+  if (isSharedCallee(func))
+    func->setAttr("llvm.linkage",
+                  mlir::LLVM::LinkageAttr::get(func.getContext(),
+                                               mlir::LLVM::Linkage::WeakODR));
+
+  if (hasInternalABI(func))
     return mlir::success();
 
   if (func->getAttr(numba::util::attributes::getFastmathName()))
@@ -655,7 +694,7 @@ struct ReturnOpLowering : public mlir::OpRewritePattern<mlir::func::ReturnOp> {
   matchAndRewrite(mlir::func::ReturnOp op,
                   mlir::PatternRewriter &rewriter) const override {
     auto parent = op->getParentOfType<mlir::func::FuncOp>();
-    if (nullptr == parent || parent.isPrivate())
+    if (nullptr == parent || hasInternalABI(parent))
       return mlir::failure();
 
     auto mod = op->getParentOfType<mlir::ModuleOp>();
@@ -785,6 +824,12 @@ static mlir::Type getMeminfoType(const mlir::LLVMTypeConverter &converter) {
   return mlir::LLVM::LLVMStructType::getLiteral(context, members);
 }
 
+/// Refcount ops, proven to be thread-local by `RefcountOptsPass`, can use
+/// non-atomic updates.
+static bool isAtomicRefcount(mlir::Operation *op) {
+  return !op->hasAttr(numba::util::attributes::getNonatomicRefcountName());
+}
+
 struct LowerRetainOp
     : public mlir::ConvertOpToLLVMPattern<numba::util::RetainOp> {
   using ConvertOpToLLVMPattern::ConvertOpToLLVMPattern;
@@ -798,7 +843,7 @@ struct LowerRetainOp
 
     auto mod = op->getParentOfType<mlir::ModuleOp>();
     assert(mod);
-    auto increfFunc = getIncrefFunc(rewriter, mod);
+    auto increfFunc = getIncrefFunc(rewriter, mod, isAtomicRefcount(op));
 
     mlir::MemRefDescriptor source(arg);
 
@@ -815,8 +860,9 @@ struct LowerRetainOp
 
 private:
   mlir::LLVM::LLVMFuncOp getIncrefFunc(mlir::OpBuilder &builder,
-                                       mlir::ModuleOp mod) const {
-    llvm::StringRef funcName("NRT_incref");
+                                       mlir::ModuleOp mod, bool atomic) const {
+    atomic = atomic || !defineMeminfoFuncs;
+    llvm::StringRef funcName(atomic ? "NRT_incref" : "NRT_incref_nonatomic");
     auto func = mod.lookupSymbol<mlir::LLVM::LLVMFuncOp>(funcName);
     if (!func) {
       auto loc = builder.getUnknownLoc();
@@ -852,9 +898,16 @@ private:
 
         auto one = builder.create<mlir::LLVM::ConstantOp>(
             loc, indexType, builder.getIntegerAttr(indexType, 1));
-        builder.create<mlir::LLVM::AtomicRMWOp>(
-            loc, mlir::LLVM::AtomicBinOp::add, refcntPtr, one,
-            mlir::LLVM::AtomicOrdering::seq_cst);
+        if (atomic) {
+          builder.create<mlir::LLVM::AtomicRMWOp>(
+              loc, mlir::LLVM::AtomicBinOp::add, refcntPtr, one,
+              mlir::LLVM::AtomicOrdering::seq_cst);
+        } else {
+          mlir::Value refcnt =
+              builder.create<mlir::LLVM::LoadOp>(loc, indexType, refcntPtr);
+          refcnt = builder.create<mlir::LLVM::AddOp>(loc, refcnt, one);
+          builder.create<mlir::LLVM::StoreOp>(loc, refcnt, refcntPtr);
+        }
         builder.create<mlir::func::ReturnOp>(loc);
       }
     }
@@ -1074,21 +1127,113 @@ struct AllocOpLowering : public mlir::AllocLikeOpLLVMLowering {
         loc, rewriter.getIntegerType(32), alignment);
 
     auto mod = allocOp->getParentOfType<mlir::ModuleOp>();
-    auto allocPtr =
-        createAllocCall(loc, "NRT_MemInfo_alloc_safe_aligned", getVoidPtrType(),
-                        {sizeBytes, alignment}, mod, rewriter);
+    bool zeroed = allocOp->hasAttr(getZeroedAllocAttrName());
+
+    // Function-scoped temporary, released by the arena restore on function
+    // exit, no meminfo needed. If arena couldn't allocate, fallback to the
+    // regular allocation, its dealloc is only executed for non-null
+    // allocated pointer.
+    if (allocOp->hasAttr(getArenaAllocAttrName())) {
+      auto ptrType = getVoidPtrType();
+      auto arenaPtr = createAllocCall(loc, "nmrtArenaAlloc", ptrType,
+                                      {sizeBytes, alignment}, mod, rewriter);
+      mlir::Value null = rewriter.create<mlir::LLVM::ZeroOp>(loc, ptrType);
+      mlir::Value isNull = rewriter.create<mlir::LLVM::ICmpOp>(
+          loc, mlir::LLVM::ICmpPredicate::eq, arenaPtr, null);
+
+      auto block = rewriter.getInsertionBlock();
+      auto contBlock =
+          rewriter.splitBlock(block, rewriter.getInsertionPoint());
+      auto allocPtr = contBlock->addArgument(ptrType, loc);
+      auto dataPtr = contBlock->addArgument(ptrType, loc);
+
+      auto fallbackBlock = rewriter.createBlock(contBlock);
+      auto [fallbackAlloc, fallbackData] =
+          allocateRegular(loc, sizeBytes, alignment, op, mod, rewriter);
+      rewriter.create<mlir::LLVM::BrOp>(
+          loc, mlir::ValueRange{fallbackAlloc, fallbackData}, contBlock);
+
+      rewriter.setInsertionPointToEnd(block);
+      rewriter.create<mlir::LLVM::CondBrOp>(
+          loc, isNull, fallbackBlock, mlir::ValueRange(), contBlock,
+          mlir::ValueRange{null, arenaPtr});
+
+      rewriter.setInsertionPointToStart(contBlock);
+      if (zeroed)
+        createZeroFill(loc, dataPtr, sizeBytes, rewriter);
+
+      return std::make_tuple(mlir::Value(allocPtr), mlir::Value(dataPtr));
+    }
+
+    return allocateRegular(loc, sizeBytes, alignment, op, mod, rewriter);
+  }
+
+private:
+  std::tuple<mlir::Value, mlir::Value>
+  allocateRegular(mlir::Location loc, mlir::Value sizeBytes,
+                  mlir::Value alignment, mlir::Operation *op,
+                  mlir::ModuleOp mod,
+                  mlir::ConversionPatternRewriter &rewriter) const {
+    bool zeroed = op->hasAttr(getZeroedAllocAttrName());
+    mlir::Value allocPtr;
+    if (auto name = getMemoryProfileFuncName(op)) {
+      // Meminfo is accounted against the function until its destruction.
+      llvm::SmallString<64> str = *name;
+      str.push_back('\0');
+      auto varName = numba::getUniqueLLVMGlobalName(mod, "memory_profile");
+      mlir::Value namePtr = mlir::LLVM::createGlobalString(
+          loc, rewriter, varName, str, mlir::LLVM::Linkage::Internal);
+      namePtr = rewriter.create<mlir::LLVM::BitcastOp>(loc, getVoidPtrType(),
+                                                       namePtr);
+      allocPtr = createAllocCall(loc, "nmrtMemProfileAlloc", getVoidPtrType(),
+                                 {sizeBytes, alignment, namePtr}, mod,
+                                 rewriter);
+    } else {
+      // Runtime allocation functions have the same signature as NRT.
+      auto allocFunc = zeroed               ? "nmrtAllocZeroed"
+                       : allocPolicyEnabled ? "nmrtAlloc"
+                                            : "NRT_MemInfo_alloc_safe_aligned";
+      allocPtr = createAllocCall(loc, allocFunc, getVoidPtrType(),
+                                 {sizeBytes, alignment}, mod, rewriter);
+      // Already zeroed by the allocator.
+      zeroed = false;
+    }
     auto dataPtr = getDataPtr(loc, rewriter, allocPtr);
+    if (zeroed)
+      createZeroFill(loc, dataPtr, sizeBytes, rewriter);
+
+    if (needFirstTouch(sizeBytes))
+      createFirstTouchCall(loc, dataPtr, sizeBytes, mod, rewriter);
 
     allocPtr = wrapAllocPtr(rewriter, loc, mod, allocPtr);
     return std::make_tuple(allocPtr, dataPtr);
   }
 
-private:
+  /// Returns parent function name, if it was compiled with memory profiling.
+  static std::optional<llvm::StringRef>
+  getMemoryProfileFuncName(mlir::Operation *op) {
+    auto func = op->getParentOfType<mlir::FunctionOpInterface>();
+    auto attrName = numba::util::attributes::getMemoryProfileName();
+    if (!func || !func->hasAttr(attrName))
+      return std::nullopt;
+
+    return func.getName();
+  }
+
   mlir::Value createIndexConstant(mlir::OpBuilder &builder, mlir::Location loc,
                                   int64_t val) const {
     return createIndexAttrConstant(builder, loc, getIndexType(), val);
   }
 
+  /// Zeroes allocations, which are not served by zeroed allocator.
+  static void createZeroFill(mlir::Location loc, mlir::Value ptr,
+                             mlir::Value sizeBytes, mlir::OpBuilder &builder) {
+    auto zero = builder.create<mlir::LLVM::ConstantOp>(
+        loc, builder.getI8Type(), builder.getI8IntegerAttr(0));
+    builder.create<mlir::LLVM::MemsetOp>(loc, ptr, zero, sizeBytes,
+                                         /*isVolatile*/ false);
+  }
+
   mlir::Value createAllocCall(mlir::Location loc, mlir::StringRef name,
                               mlir::Type ptrType,
                               mlir::ArrayRef<mlir::Value> params,
@@ -1117,6 +1262,41 @@ private:
     return rewriter.create<LLVM::BitcastOp>(loc, ptrType, allocatedPtr);
   }
 
+  /// First touch is only emitted in NUMA mode and for buffers, which are not
+  /// statically known to be below the threshold, runtime checks dynamic ones.
+  static bool needFirstTouch(mlir::Value sizeBytes) {
+    uint64_t threshold = firstTouchThreshold;
+    if (threshold == 0)
+      return false;
+
+    llvm::APInt size;
+    if (mlir::matchPattern(sizeBytes, mlir::m_ConstantInt(&size)))
+      return size.getZExtValue() >= threshold;
+
+    return true;
+  }
+
+  void createFirstTouchCall(mlir::Location loc, mlir::Value dataPtr,
+                            mlir::Value sizeBytes, mlir::ModuleOp module,
+                            mlir::ConversionPatternRewriter &rewriter) const {
+    using namespace mlir;
+    StringRef name = "nmrtParallelFirstTouch";
+    auto func = module.lookupSymbol<LLVM::LLVMFuncOp>(name);
+    if (!func) {
+      auto voidType = LLVM::LLVMVoidType::get(rewriter.getContext());
+      auto funcType = LLVM::LLVMFunctionType::get(
+          voidType, {getVoidPtrType(), sizeBytes.getType()});
+      OpBuilder::InsertionGuard guard(rewriter);
+      auto body = module.getBody();
+      rewriter.setInsertionPoint(body, body->end());
+      func = rewriter.create<LLVM::LLVMFuncOp>(rewriter.getUnknownLoc(), name,
+                                               funcType);
+    }
+
+    Value args[] = {dataPtr, sizeBytes};
+    rewriter.create<LLVM::CallOp>(loc, func, args);
+  }
+
   mlir::Value getDataPtr(mlir::Location loc,
                          mlir::ConversionPatternRewriter &rewriter,
                          mlir::Value allocPtr) const {
@@ -1149,11 +1329,32 @@ struct DeallocOpLowering
                   mlir::ConversionPatternRewriter &rewriter) const override {
     auto mod = op->getParentOfType<mlir::ModuleOp>();
     assert(mod);
-    auto freeFunc = getDecrefFunc(rewriter, mod);
+    auto freeFunc = getDecrefFunc(rewriter, mod, isAtomicRefcount(op));
 
     auto loc = op.getLoc();
     mlir::MemRefDescriptor memref(adaptor.getMemref());
     auto ptr = memref.allocatedPtr(rewriter, loc);
+
+    // Arena allocations have null allocated pointer, unless they were served
+    // by the regular allocator fallback.
+    if (op->hasAttr(getArenaAllocAttrName())) {
+      mlir::Value null =
+          rewriter.create<mlir::LLVM::ZeroOp>(loc, ptr.getType());
+      mlir::Value isNull = rewriter.create<mlir::LLVM::ICmpOp>(
+          loc, mlir::LLVM::ICmpPredicate::eq, ptr, null);
+
+      auto block = rewriter.getInsertionBlock();
+      auto contBlock =
+          rewriter.splitBlock(block, rewriter.getInsertionPoint());
+      auto releaseBlock = rewriter.createBlock(contBlock);
+      rewriter.create<mlir::LLVM::BrOp>(loc, mlir::ValueRange(), contBlock);
+
+      rewriter.setInsertionPointToEnd(block);
+      rewriter.create<mlir::LLVM::CondBrOp>(loc, isNull, contBlock,
+                                            releaseBlock);
+      rewriter.setInsertionPointToStart(releaseBlock);
+    }
+
     auto unwrapped = unwrapAllocPtr(rewriter, loc, ptr);
     rewriter.replaceOpWithNewOp<mlir::LLVM::CallOp>(
         op, mlir::TypeRange(), mlir::SymbolRefAttr::get(freeFunc), unwrapped);
@@ -1163,8 +1364,9 @@ struct DeallocOpLowering
 
 private:
   mlir::LLVM::LLVMFuncOp getDecrefFunc(mlir::OpBuilder &builder,
-                                       mlir::ModuleOp mod) const {
-    llvm::StringRef funcName("NRT_decref");
+                                       mlir::ModuleOp mod, bool atomic) const {
+    atomic = atomic || !defineMeminfoFuncs;
+    llvm::StringRef funcName(atomic ? "NRT_decref" : "NRT_decref_nonatomic");
     auto func = mod.lookupSymbol<mlir::LLVM::LLVMFuncOp>(funcName);
     if (!func) {
       auto loc = builder.getUnknownLoc();
@@ -1203,9 +1405,17 @@ private:
 
         auto one = builder.create<mlir::LLVM::ConstantOp>(
             loc, indexType, builder.getIntegerAttr(indexType, 1));
-        auto res = builder.create<mlir::LLVM::AtomicRMWOp>(
-            loc, mlir::LLVM::AtomicBinOp::sub, refcntPtr, one,
-            mlir::LLVM::AtomicOrdering::seq_cst);
+        mlir::Value res;
+        if (atomic) {
+          res = builder.create<mlir::LLVM::AtomicRMWOp>(
+              loc, mlir::LLVM::AtomicBinOp::sub, refcntPtr, one,
+              mlir::LLVM::AtomicOrdering::seq_cst);
+        } else {
+          res = builder.create<mlir::LLVM::LoadOp>(loc, indexType, refcntPtr);
+          mlir::Value newRefcnt =
+              builder.create<mlir::LLVM::SubOp>(loc, res, one);
+          builder.create<mlir::LLVM::StoreOp>(loc, newRefcnt, refcntPtr);
+        }
 
         auto isRelease = builder.create<mlir::LLVM::ICmpOp>(
             loc, mlir::LLVM::ICmpPredicate::eq, res, one);
@@ -1253,16 +1463,92 @@ public:
   mlir::LLVM::LLVMFuncOp getFunction() { return this->getOperation(); }
 };
 
+/// Map `numba.parallel_schedule` attribute to runtime schedule kind, must be
+/// kept in sync with `ScheduleKind` in runtime.
+static std::optional<int64_t> getScheduleKind(mlir::Operation *op) {
+  auto attr = op->getAttrOfType<mlir::StringAttr>(
+      numba::util::attributes::getParallelScheduleName());
+  if (!attr)
+    return std::nullopt;
+
+  return llvm::StringSwitch<std::optional<int64_t>>(attr.getValue())
+      .Case("auto", 0)
+      .Case("static", 1)
+      .Case("simple", 2)
+      .Case("affinity", 3)
+      .Case("guided", 4)
+      .Case("dynamic", 5)
+      .Default(std::nullopt);
+}
+
 static void copyAttrs(mlir::Operation *src, mlir::Operation *dst) {
   const mlir::StringRef attrs[] = {
       numba::util::attributes::getFastmathName(),
       numba::util::attributes::getMaxConcurrencyName(),
+      numba::util::attributes::getMemoryProfileName(),
   };
   for (auto name : attrs)
     if (auto attr = src->getAttr(name))
       dst->setAttr(name, attr);
 }
 
+/// Marker function for parallel loops of Tapir backends, expanded into Tapir
+/// loop by execution engine. Must be kept in sync with `ExecutionEngine.cpp`.
+static constexpr llvm::StringLiteral
+    TapirParallelForName("numba_tapir_parallel_for");
+
+/// Returns Tapir backend name if parallel op belongs to function, which
+/// selected Tapir target as parallel backend.
+static std::optional<llvm::StringRef> getTapirBackend(mlir::Operation *op) {
+  auto func = op->getParentOfType<mlir::func::FuncOp>();
+  if (!func)
+    return std::nullopt;
+
+  auto backend = func->getAttrOfType<mlir::StringAttr>(
+      numba::util::attributes::getParallelBackendName());
+  if (!backend ||
+      (backend.getValue() != "opencilk" && backend.getValue() != "cuda"))
+    return std::nullopt;
+
+  return backend.getValue();
+}
+
+/// Minimal estimated cost of the OpenCilk task, in the number of ops, so
+/// spawn overhead is amortized for cheap loop bodies.
+static constexpr int64_t TapirMinTaskCost = 10000;
+
+/// Max grainsize, computed from the cost estimate, so loops with cheap bodies
+/// and small trip counts still have enough tasks.
+static constexpr int64_t TapirMaxGrainsize = 2048;
+
+/// Computes Tapir grainsize for the outermost dimension from the estimated
+/// iteration cost, as each task runs the whole inner dimensions. Returns 0,
+/// so grainsize is selected by Tapir, if cost is unknown.
+static int64_t getTapirGrainsize(numba::util::ParallelOp op, int64_t cost) {
+  if (cost <= 0)
+    return 0;
+
+  for (auto i : llvm::seq(1u, static_cast<unsigned>(op.getNumLoops()))) {
+    auto lower = mlir::getConstantIntValue(op.getLowerBounds()[i]);
+    auto upper = mlir::getConstantIntValue(op.getUpperBounds()[i]);
+    auto step = mlir::getConstantIntValue(op.getSteps()[i]);
+    if (!lower || !upper || !step || *step <= 0)
+      return 0;
+
+    auto count = std::max<int64_t>(llvm::divideCeil(*upper - *lower, *step), 1);
+    if (count >= TapirMinTaskCost / cost)
+      return 1;
+
+    cost *= count;
+  }
+
+  if (cost >= TapirMinTaskCost)
+    return 1;
+
+  return std::min<int64_t>(llvm::divideCeil(TapirMinTaskCost, cost),
+                           TapirMaxGrainsize);
+}
+
 struct LowerParallel : public mlir::OpRewritePattern<numba::util::ParallelOp> {
   LowerParallel(mlir::MLIRContext *context)
       : OpRewritePattern(context), converter(context) {}
@@ -1481,17 +1767,45 @@ struct LowerParallel : public mlir::OpRewritePattern<numba::util::ParallelOp> {
       return func;
     }();
 
+    auto scheduleKind = getScheduleKind(op);
+    auto grainAttr = op->getAttrOfType<mlir::IntegerAttr>(
+        numba::util::attributes::getParallelGrainName());
+    auto regionAttr = op->getAttrOfType<mlir::StringAttr>(
+        numba::util::attributes::getParallelRegionName());
+    auto costAttr = op->getAttrOfType<mlir::IntegerAttr>(
+        numba::util::attributes::getParallelCostName());
+    auto tapirBackend = getTapirBackend(op);
+    bool hasSchedule =
+        !tapirBackend && (scheduleKind || grainAttr || regionAttr || costAttr);
+
     auto parallelFor = [&]() {
-      auto funcName = "nmrtParallelFor";
+      auto funcName = tapirBackend  ? TapirParallelForName
+                      : hasSchedule ? "nmrtParallelForSchedule"
+                                    : "nmrtParallelFor";
       if (auto sym = mod.lookupSymbol<mlir::func::FuncOp>(funcName))
         return sym;
 
-      const mlir::Type args[] = {
+      llvm::SmallVector<mlir::Type> args = {
           inputRangePtr, // bounds
           indexType,     // num_loops
           funcType,      // func
           voidPtrType    // context
       };
+      if (tapirBackend) {
+        auto i64 = rewriter.getI64Type();
+        args.emplace_back(i64); // grain
+        args.emplace_back(i64); // cuda threads per block
+        args.emplace_back(i64); // cuda occupancy launch
+      }
+
+      if (hasSchedule) {
+        auto i64 = rewriter.getI64Type();
+        args.emplace_back(i64);         // schedule kind
+        args.emplace_back(i64);         // grain
+        args.emplace_back(voidPtrType); // schedule state
+        args.emplace_back(voidPtrType); // region name
+        args.emplace_back(i64);         // iteration cost
+      }
       auto parallelFuncType =
           mlir::FunctionType::get(op.getContext(), args, {});
       return numba::addFunction(rewriter, mod, funcName, parallelFuncType);
@@ -1525,8 +1839,76 @@ struct LowerParallel : public mlir::OpRewritePattern<numba::util::ParallelOp> {
 
     auto numLoopsVar =
         rewriter.create<mlir::arith::ConstantIndexOp>(loc, numLoops);
-    const mlir::Value pfArgs[] = {inputRanges, numLoopsVar, funcAddr,
-                                  contextAbstract};
+    llvm::SmallVector<mlir::Value> pfArgs = {inputRanges, numLoopsVar, funcAddr,
+                                             contextAbstract};
+    if (tapirBackend) {
+      // Explicit grain, set for the loop or function, takes precedence over
+      // the cost estimate.
+      int64_t grainVal = 0;
+      if (grainAttr) {
+        grainVal = grainAttr.getInt();
+      } else if (costAttr && *tapirBackend == "opencilk") {
+        grainVal = getTapirGrainsize(op, costAttr.getInt());
+      }
+      auto grain = rewriter.create<mlir::arith::ConstantIntOp>(
+          loc, grainVal, rewriter.getI64Type());
+      pfArgs.emplace_back(grain);
+
+      // Kitsune CUDA launch hints, 0 threads per block and -1 occupancy
+      // launch keep runtime defaults.
+      auto threadsAttr = op->getAttrOfType<mlir::IntegerAttr>(
+          numba::util::attributes::getCudaThreadsPerBlockName());
+      auto occupancyAttr = op->getAttrOfType<mlir::BoolAttr>(
+          numba::util::attributes::getCudaOccupancyLaunchName());
+      auto threads = rewriter.create<mlir::arith::ConstantIntOp>(
+          loc, threadsAttr ? threadsAttr.getInt() : 0, rewriter.getI64Type());
+      auto occupancy = rewriter.create<mlir::arith::ConstantIntOp>(
+          loc, occupancyAttr ? static_cast<int64_t>(occupancyAttr.getValue())
+                             : -1,
+          rewriter.getI64Type());
+      pfArgs.emplace_back(threads);
+      pfArgs.emplace_back(occupancy);
+      op.emitRemark() << "parallel loop lowered to Tapir (" << *tapirBackend
+                      << ")";
+    }
+    if (hasSchedule) {
+      auto i64 = rewriter.getI64Type();
+      auto kind = rewriter.create<mlir::arith::ConstantIntOp>(
+          loc, scheduleKind.value_or(0), i64);
+      auto grain = rewriter.create<mlir::arith::ConstantIntOp>(
+          loc, grainAttr ? grainAttr.getInt() : 0, i64);
+
+      // Per-call-site storage for the runtime schedule state (e.g. affinity
+      // partitioner), so it can be reused between invocations.
+      auto stateHandle = [&]() {
+        mlir::OpBuilder::InsertionGuard g(rewriter);
+        rewriter.setInsertionPointToStart(mod.getBody());
+        auto name = numba::getUniqueLLVMGlobalName(mod, "parallel_schedule");
+        return rewriter.create<mlir::LLVM::GlobalOp>(
+            rewriter.getUnknownLoc(), i64, /*isConstant*/ false,
+            mlir::LLVM::Linkage::Internal, name, rewriter.getI64IntegerAttr(0));
+      }();
+      mlir::Value state = rewriter.create<mlir::LLVM::AddressOfOp>(
+          loc, getLLVMPointerType(i64), stateHandle.getSymName());
+      state = rewriter.create<mlir::LLVM::BitcastOp>(loc, voidPtrType, state);
+
+      mlir::Value region;
+      if (regionAttr) {
+        llvm::SmallString<64> name = regionAttr.getValue();
+        name.push_back('\0');
+        auto varName = numba::getUniqueLLVMGlobalName(mod, "parallel_region");
+        region = mlir::LLVM::createGlobalString(
+            loc, rewriter, varName, name, mlir::LLVM::Linkage::Internal);
+        region =
+            rewriter.create<mlir::LLVM::BitcastOp>(loc, voidPtrType, region);
+      } else {
+        region = rewriter.create<mlir::LLVM::ZeroOp>(loc, voidPtrType);
+      }
+      // Estimated iteration cost, 0 means unknown.
+      auto cost = rewriter.create<mlir::arith::ConstantIntOp>(
+          loc, costAttr ? costAttr.getInt() : 0, i64);
+      pfArgs.append({kind, grain, state, region, cost});
+    }
     rewriter.replaceOpWithNewOp<mlir::func::CallOp>(op, parallelFor, pfArgs);
     return mlir::success();
   }
@@ -1554,6 +1936,55 @@ struct RemoveParallelRegionPass
     : public numba::RewriteWrapperPass<RemoveParallelRegionPass, void, void,
                                        RemoveParallelRegion> {};
 
+/// Marker function for loops, vectorized by `SCFVectorizePass`. Execution
+/// engine disables LLVM vectorization for the innermost loop, containing the
+/// call, and removes it. Must be kept in sync with `ExecutionEngine.cpp`.
+static constexpr llvm::StringLiteral
+    VectorizedLoopName("numba_vectorized_loop");
+
+/// SCF loops attributes are not propagated to the LLVM loop metadata, so
+/// annotate bodies of the `numba.vectorized` loops with marker calls instead.
+struct MarkVectorizedLoopsPass
+    : public mlir::PassWrapper<MarkVectorizedLoopsPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(MarkVectorizedLoopsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::func::FuncDialect>();
+  }
+
+  void runOnOperation() override final {
+    auto mod = getOperation();
+    auto attrName = numba::util::attributes::getVectorizedName();
+    llvm::SmallVector<mlir::Operation *> loops;
+    mod->walk([&](mlir::Operation *op) {
+      if (mlir::isa<mlir::scf::ParallelOp, mlir::scf::ForOp>(op) &&
+          op->hasAttr(attrName))
+        loops.emplace_back(op);
+    });
+
+    if (loops.empty())
+      return markAllAnalysesPreserved();
+
+    mlir::OpBuilder builder(&getContext());
+    auto marker = mod.lookupSymbol<mlir::func::FuncOp>(VectorizedLoopName);
+    if (!marker) {
+      builder.setInsertionPointToStart(mod.getBody());
+      marker = builder.create<mlir::func::FuncOp>(
+          builder.getUnknownLoc(), VectorizedLoopName,
+          builder.getFunctionType(std::nullopt, std::nullopt));
+      marker.setPrivate();
+    }
+
+    for (auto loop : loops) {
+      loop->removeAttr(attrName);
+      builder.setInsertionPointToStart(&loop->getRegion(0).front());
+      builder.create<mlir::func::CallOp>(loop->getLoc(), marker);
+    }
+  }
+};
+
 struct LowerParallelToCFGPass
     : public mlir::PassWrapper<LowerParallelToCFGPass,
                                mlir::OperationPass<void>> {
@@ -1607,6 +2038,169 @@ struct PreLLVMLowering
   }
 };
 
+/// Zero-initialized allocations are served by the zeroed allocator, the rest
+/// of `zero_init` ops are lowered to loops.
+struct LowerZeroInitPass
+    : public mlir::PassWrapper<LowerZeroInitPass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(LowerZeroInitPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override final {
+    llvm::SmallVector<numba::util::ZeroInitOp> ops;
+    getOperation()->walk(
+        [&](numba::util::ZeroInitOp op) { ops.emplace_back(op); });
+
+    if (ops.empty())
+      return markAllAnalysesPreserved();
+
+    mlir::OpBuilder builder(&getContext());
+    auto attrName = builder.getStringAttr(getZeroedAllocAttrName());
+    for (auto op : ops) {
+      auto dst = op.getDest();
+      auto alloc = dst.getDefiningOp<mlir::memref::AllocOp>();
+      if (alloc && numba::isFirstAllocUse(alloc, op)) {
+        alloc->setAttr(attrName, builder.getUnitAttr());
+        op->erase();
+        continue;
+      }
+
+      builder.setInsertionPoint(op);
+      auto loc = op.getLoc();
+      auto type = mlir::cast<mlir::MemRefType>(dst.getType());
+      auto rank = static_cast<unsigned>(type.getRank());
+      auto elemType = type.getElementType();
+      mlir::Value zero = builder.create<mlir::arith::ConstantOp>(
+          loc, builder.getZeroAttr(elemType));
+      mlir::Value lower = builder.create<mlir::arith::ConstantIndexOp>(loc, 0);
+      mlir::Value step = builder.create<mlir::arith::ConstantIndexOp>(loc, 1);
+      llvm::SmallVector<mlir::Value> lowers(rank, lower);
+      llvm::SmallVector<mlir::Value> steps(rank, step);
+      llvm::SmallVector<mlir::Value> uppers(rank);
+      for (auto i : llvm::seq(0u, rank))
+        uppers[i] = builder.createOrFold<mlir::memref::DimOp>(loc, dst, i);
+
+      mlir::scf::buildLoopNest(
+          builder, loc, lowers, uppers, steps,
+          [&](mlir::OpBuilder &b, mlir::Location l, mlir::ValueRange ivs) {
+            b.create<mlir::memref::StoreOp>(l, zero, dst, ivs);
+          });
+      op->erase();
+    }
+  }
+};
+
+/// Allocations can be served from the arena only if they are executed at most
+/// once per function call on the calling thread.
+static bool isArenaAllocScope(mlir::Operation *op) {
+  if (mlir::isa<mlir::scf::IfOp, mlir::scf::ExecuteRegionOp>(op))
+    return true;
+
+  if (auto region = mlir::dyn_cast<numba::util::EnvironmentRegionOp>(op))
+    return mlir::isa<numba::util::ParallelAttr>(region.getEnvironment());
+
+  return false;
+}
+
+static bool canUseArena(mlir::memref::AllocOp op) {
+  if (!op.getSymbolOperands().empty() || op.getType().getMemorySpace())
+    return false;
+
+  if (numba::canAllocEscape(op))
+    return false;
+
+  auto parent = op->getParentOp();
+  while (!mlir::isa<mlir::func::FuncOp>(parent)) {
+    if (!isArenaAllocScope(parent))
+      return false;
+
+    parent = parent->getParentOp();
+  }
+  return true;
+}
+
+/// Serve non-escaping function-scoped temporaries from the thread-local
+/// arena instead of NRT. Arena position is saved on function entry and
+/// restored before each return.
+struct ArenaAllocPass
+    : public mlir::PassWrapper<ArenaAllocPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(ArenaAllocPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::func::FuncDialect>();
+  }
+
+  void runOnOperation() override final {
+    auto mod = getOperation();
+    mlir::OpBuilder builder(&getContext());
+    auto i64 = builder.getI64Type();
+
+    auto getFunc = [&](llvm::StringRef name, mlir::FunctionType type) {
+      if (auto func = mod.lookupSymbol<mlir::func::FuncOp>(name))
+        return func;
+
+      return numba::addFunction(builder, mod, name, type);
+    };
+
+    bool changed = false;
+    llvm::SmallVector<mlir::memref::AllocOp> allocs;
+    for (auto func : mod.getOps<mlir::func::FuncOp>()) {
+      // Multiple blocks can form loops.
+      if (func.isDeclaration() || !func.getBody().hasOneBlock())
+        continue;
+
+      auto &block = func.getBody().front();
+      auto ret = mlir::dyn_cast<mlir::func::ReturnOp>(block.getTerminator());
+      if (!ret)
+        continue;
+
+      allocs.clear();
+      func.walk([&](mlir::memref::AllocOp op) {
+        if (canUseArena(op))
+          allocs.emplace_back(op);
+      });
+
+      if (allocs.empty())
+        continue;
+
+      auto attrName = builder.getStringAttr(getArenaAllocAttrName());
+      // Deallocs are kept for the regular allocator fallback.
+      for (auto alloc : allocs) {
+        for (auto user : alloc->getUsers())
+          if (mlir::isa<mlir::memref::DeallocOp>(user))
+            user->setAttr(attrName, builder.getUnitAttr());
+
+        alloc->setAttr(attrName, builder.getUnitAttr());
+      }
+
+      auto saveFunc =
+          getFunc("nmrtArenaSave", builder.getFunctionType({}, {i64}));
+      auto restoreFunc =
+          getFunc("nmrtArenaRestore", builder.getFunctionType({i64}, {}));
+
+      builder.setInsertionPointToStart(&block);
+      auto loc = func.getLoc();
+      mlir::Value mark =
+          builder.create<mlir::func::CallOp>(loc, saveFunc).getResult(0);
+
+      builder.setInsertionPoint(ret);
+      builder.create<mlir::func::CallOp>(ret.getLoc(), restoreFunc, mark);
+      changed = true;
+    }
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+};
+
 struct FixLLVMStructABIPass
     : public mlir::PassWrapper<FixLLVMStructABIPass,
                                mlir::OperationPass<mlir::ModuleOp>> {
@@ -1726,6 +2320,165 @@ struct PostLLVMLowering
   }
 };
 
+/// Returns buffer, written by `op`, if it is a store supporting nontemporal
+/// hint.
+static mlir::Value getNontemporalStoreBuffer(mlir::Operation *op) {
+  if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(op))
+    return store.getMemRef();
+
+  if (auto store = mlir::dyn_cast<mlir::vector::StoreOp>(op))
+    return store.getBase();
+
+  return {};
+}
+
+/// Allocations, which are only written inside the parallel region, e.g.
+/// results of elementwise kernels.
+static llvm::SmallVector<mlir::memref::AllocOp>
+getStreamedOutputs(numba::util::ParallelOp op) {
+  llvm::SmallVector<mlir::memref::AllocOp> ret;
+  llvm::SmallPtrSet<mlir::Value, 4> visited;
+  op.getRegion().walk([&](mlir::Operation *inner) {
+    auto memref = getNontemporalStoreBuffer(inner);
+    if (!memref || !visited.insert(memref).second)
+      return;
+
+    auto alloc = memref.getDefiningOp<mlir::memref::AllocOp>();
+    if (!alloc || !alloc.getSymbolOperands().empty())
+      return;
+
+    auto elemType = alloc.getType().getElementType();
+    if (!elemType.isIntOrFloat() || elemType.getIntOrFloatBitWidth() % 8 != 0)
+      return;
+
+    for (auto user : memref.getUsers())
+      if (op->isProperAncestor(user) &&
+          getNontemporalStoreBuffer(user) != memref)
+        return;
+
+    ret.emplace_back(alloc);
+  });
+  return ret;
+}
+
+static mlir::Value getAllocBytes(mlir::OpBuilder &builder, mlir::Location loc,
+                                 mlir::memref::AllocOp alloc) {
+  auto type = alloc.getType();
+  int64_t staticSize = itemSize(type.getElementType());
+  for (auto dim : type.getShape())
+    if (!mlir::ShapedType::isDynamic(dim))
+      staticSize *= dim;
+
+  mlir::Value size =
+      builder.create<mlir::arith::ConstantIndexOp>(loc, staticSize);
+  for (auto dim : alloc.getDynamicSizes())
+    size = builder.create<mlir::arith::MulIOp>(loc, size, dim);
+
+  return size;
+}
+
+/// Use nontemporal stores for the write-only buffers, written by parallel
+/// regions, if total buffers size exceeds threshold (expected to be LLC size),
+/// so they don't pollute the cache and don't need read-for-ownership.
+/// Nontemporal stores are weakly ordered, so each region chunk ends with the
+/// fence. Regions with dynamic buffers sizes are versioned on the runtime size
+/// check.
+struct NontemporalStoresPass
+    : public mlir::PassWrapper<NontemporalStoresPass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(NontemporalStoresPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::LLVM::LLVMDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override final {
+    uint64_t threshold = nontemporalStoreThreshold;
+    if (threshold == 0)
+      return markAllAnalysesPreserved();
+
+    using Outputs = llvm::SmallVector<mlir::memref::AllocOp>;
+    llvm::SmallVector<std::pair<numba::util::ParallelOp, Outputs>> regions;
+    getOperation()->walk([&](numba::util::ParallelOp op) {
+      // Outlined bodies are executed on the GPU.
+      auto tapirBackend = getTapirBackend(op);
+      if (tapirBackend && *tapirBackend == "cuda")
+        return;
+
+      auto outputs = getStreamedOutputs(op);
+      if (!outputs.empty())
+        regions.emplace_back(op, std::move(outputs));
+    });
+
+    if (regions.empty())
+      return markAllAnalysesPreserved();
+
+    mlir::OpBuilder builder(&getContext());
+    for (auto &&[op, outputs] : regions) {
+      auto loc = op.getLoc();
+      builder.setInsertionPoint(op);
+      mlir::Value size;
+      for (auto alloc : outputs) {
+        auto bytes = getAllocBytes(builder, loc, alloc);
+        size = size ? builder.create<mlir::arith::AddIOp>(loc, size, bytes)
+                    : bytes;
+      }
+
+      auto constSize = mlir::getConstantIntValue(size);
+      if (constSize && uint64_t(*constSize) < threshold)
+        continue;
+
+      llvm::SmallPtrSet<mlir::Value, 4> buffers;
+      for (auto alloc : outputs)
+        buffers.insert(alloc.getResult());
+
+      auto markNontemporal = [&](numba::util::ParallelOp region) {
+        region.getRegion().walk([&](mlir::Operation *inner) {
+          auto memref = getNontemporalStoreBuffer(inner);
+          if (!memref || !buffers.contains(memref))
+            return;
+
+          if (auto store = mlir::dyn_cast<mlir::memref::StoreOp>(inner)) {
+            store.setNontemporal(true);
+          } else {
+            mlir::cast<mlir::vector::StoreOp>(inner).setNontemporal(true);
+          }
+        });
+
+        auto term = region.getBodyBlock()->getTerminator();
+        mlir::OpBuilder fenceBuilder(term);
+        fenceBuilder.create<mlir::LLVM::FenceOp>(
+            term->getLoc(), mlir::LLVM::AtomicOrdering::seq_cst,
+            mlir::StringAttr{});
+      };
+
+      if (constSize) {
+        markNontemporal(op);
+        continue;
+      }
+
+      mlir::Value thresholdVal = builder.create<mlir::arith::ConstantIndexOp>(
+          loc, static_cast<int64_t>(threshold));
+      mlir::Value cond = builder.create<mlir::arith::CmpIOp>(
+          loc, mlir::arith::CmpIPredicate::uge, size, thresholdVal);
+      auto thenBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+        auto region = mlir::cast<numba::util::ParallelOp>(b.clone(*op));
+        markNontemporal(region);
+        b.create<mlir::scf::YieldOp>(l);
+      };
+      auto elseBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+        b.clone(*op);
+        b.create<mlir::scf::YieldOp>(l);
+      };
+      builder.create<mlir::scf::IfOp>(loc, cond, thenBuilder, elseBuilder);
+      op->erase();
+    }
+  }
+};
+
 struct LowerVectorOps
     : public mlir::PassWrapper<LowerVectorOps, mlir::OperationPass<>> {
   MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(LowerVectorOps)
@@ -1819,12 +2572,23 @@ struct LLVMLoweringPass
 };
 
 static void populatePreLowerToLlvmPipeline(mlir::OpPassManager &pm) {
+  pm.addNestedPass<mlir::func::FuncOp>(std::make_unique<LowerZeroInitPass>());
+  pm.addNestedPass<mlir::func::FuncOp>(numba::createRefcountOptsPass());
+  if (arenaAllocEnabled)
+    pm.addPass(std::make_unique<ArenaAllocPass>());
+
   pm.addNestedPass<mlir::func::FuncOp>(std::make_unique<PreLLVMLowering>());
 }
 
 static void populateLowerToLlvmPipeline(mlir::OpPassManager &pm) {
+  pm.addNestedPass<mlir::func::FuncOp>(
+      std::make_unique<NontemporalStoresPass>());
+  pm.addNestedPass<mlir::func::FuncOp>(numba::createNarrowIndexTypePass());
+  pm.addNestedPass<mlir::func::FuncOp>(
+      numba::createLoopInvariantDivisionPass());
   pm.addPass(std::make_unique<RemoveParallelRegionPass>());
   pm.addPass(std::make_unique<LowerParallelToCFGPass>());
+  pm.addPass(std::make_unique<MarkVectorizedLoopsPass>());
   pm.addPass(mlir::createConvertSCFToCFPass());
   pm.addPass(mlir::createCanonicalizerPass());
   pm.addPass(mlir::createConvertComplexToStandardPass());
@@ -1843,6 +2607,7 @@ static void populateLowerToLlvmPipeline(mlir::OpPassManager &pm) {
       std::make_unique<PostLLVMLowering>());
   pm.addNestedPass<mlir::LLVM::LLVMFuncOp>(mlir::createCSEPass());
   pm.addPass(mlir::createCanonicalizerPass());
+  pm.addPass(numba::createOutlineColdBlocksPass());
 }
 } // namespace
 
@@ -1863,3 +2628,13 @@ void registerLowerToLLVMPipeline(numba::PipelineRegistry &registry) {
 llvm::StringRef preLowerToLLVMPipelineName() { return "pre_lower_to_llvm"; }
 
 llvm::StringRef lowerToLLVMPipelineName() { return "lower_to_llvm"; }
+
+void setArenaAllocEnabled(bool enabled) { arenaAllocEnabled = enabled; }
+
+void setAllocPolicyEnabled(bool enabled) { allocPolicyEnabled = enabled; }
+
+void setNontemporalStoreThreshold(uint64_t size) {
+  nontemporalStoreThreshold = size;
+}
+
+void setFirstTouchThreshold(uint64_t size) { firstTouchThreshold = size; }
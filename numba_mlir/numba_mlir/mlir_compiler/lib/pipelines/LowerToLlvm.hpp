@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace numba {
 class PipelineRegistry;
 }
@@ -16,3 +18,20 @@ void registerLowerToLLVMPipeline(numba::PipelineRegistry &registry);
 
 llvm::StringRef preLowerToLLVMPipelineName();
 llvm::StringRef lowerToLLVMPipelineName();
+
+/// Serve non-escaping function-scoped temporaries from the thread-local arena
+/// allocator instead of NRT, enabled by default.
+void setArenaAllocEnabled(bool enabled);
+
+/// Allocate arrays via runtime allocation policy (huge pages for large
+/// arrays, size-class cache for small ones) instead of NRT, disabled by
+/// default.
+void setAllocPolicyEnabled(bool enabled);
+
+/// Minimal total size of the write-only parallel region outputs, in bytes, to
+/// be written with nontemporal stores, 0 disables.
+void setNontemporalStoreThreshold(uint64_t size);
+
+/// Minimal size of the freshly allocated buffer, in bytes, to be first-touched
+/// from NUMA node arenas, 0 disables.
+void setFirstTouchThreshold(uint64_t size);
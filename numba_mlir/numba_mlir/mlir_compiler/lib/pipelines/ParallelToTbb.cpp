@@ -8,27 +8,54 @@
 #include <mlir/Dialect/Func/IR/FuncOps.h>
 #include <mlir/Dialect/MemRef/IR/MemRef.h>
 #include <mlir/Dialect/SCF/IR/SCF.h>
+#include <mlir/Dialect/Utils/StaticValueUtils.h>
 #include <mlir/IR/IRMapping.h>
+#include <mlir/Interfaces/CallInterfaces.h>
 #include <mlir/Pass/Pass.h>
 #include <mlir/Pass/PassManager.h>
 #include <mlir/Transforms/GreedyPatternRewriteDriver.h>
 #include <mlir/Transforms/Passes.h>
 
+#include <llvm/Support/MathExtras.h>
+
 #include "pipelines/BasePipeline.hpp"
 #include "pipelines/LowerToLlvm.hpp"
 
 #include "numba/Compiler/PipelineRegistry.hpp"
 #include "numba/Dialect/numba_util/Dialect.hpp"
 #include "numba/Transforms/FuncUtils.hpp"
+#include "numba/Transforms/LoopDistribution.hpp"
 #include "numba/Transforms/RewriteWrapper.hpp"
 #include "numba/Transforms/SCFVectorize.hpp"
 
 namespace {
-static mlir::MemRefType getReduceType(mlir::Type type, int64_t count) {
+/// Per-thread reduction slots are padded to the cache line size to avoid
+/// false sharing between threads, updating adjacent slots.
+static constexpr int64_t CacheLineSize = 64;
+
+static int64_t getReduceElemBytes(mlir::Type type) {
   if (type.isIntOrFloat())
-    return mlir::MemRefType::get(count, type);
+    return std::max<int64_t>(type.getIntOrFloatBitWidth() / 8, 1);
 
-  return {};
+  // Vector accumulators from the vectorizer.
+  auto vecType = mlir::dyn_cast<mlir::VectorType>(type);
+  if (vecType && vecType.getRank() == 1 &&
+      vecType.getElementType().isIntOrFloat())
+    return vecType.getNumElements() *
+           getReduceElemBytes(vecType.getElementType());
+
+  return 0;
+}
+
+/// Returns `count x pad` memref type, where every row is the separate thread
+/// slot, accessed at `[threadIndex, 0]`.
+static mlir::MemRefType getReduceType(mlir::Type type, int64_t count) {
+  auto bytes = getReduceElemBytes(type);
+  if (bytes == 0)
+    return {};
+
+  auto pad = std::max<int64_t>(llvm::divideCeil(CacheLineSize, bytes), 1);
+  return mlir::MemRefType::get({count, pad}, type);
 }
 
 static std::optional<mlir::TypedAttr>
@@ -36,7 +63,25 @@ getReduceInitVal(mlir::Type type, mlir::Block &reduceBlock) {
   if (!llvm::hasSingleElement(reduceBlock.without_terminator()))
     return std::nullopt;
 
-  return mlir::arith::getNeutralElement(&(*reduceBlock.begin()));
+  auto &redOp = *reduceBlock.begin();
+  auto vecType = mlir::dyn_cast<mlir::VectorType>(type);
+  if (!vecType)
+    return mlir::arith::getNeutralElement(&redOp);
+
+  // Neutral element is only defined for scalar ops, get it from the detached
+  // scalar copy and splat.
+  auto scalarOp = redOp.clone();
+  for (auto res : scalarOp->getResults())
+    res.setType(vecType.getElementType());
+
+  auto neutral = mlir::arith::getNeutralElement(scalarOp);
+  scalarOp->destroy();
+  if (!neutral)
+    return std::nullopt;
+
+  mlir::Attribute elem = *neutral;
+  return mlir::cast<mlir::TypedAttr>(
+      mlir::DenseElementsAttr::get(vecType, elem));
 }
 
 static bool isInsideParalleRegion(mlir::Operation *op) {
@@ -47,13 +92,165 @@ static bool isInsideParalleRegion(mlir::Operation *op) {
          mlir::isa<numba::util::ParallelAttr>(region.getEnvironment());
 }
 
+/// Copy scheduling attributes to the new parallel op, loop attributes take
+/// precedence over prange region ones and region ones over function-wide ones.
+/// Function-wide sequences are per-prange values, which are already set on the
+/// regions.
+static void copyScheduleAttrs(mlir::scf::ParallelOp src,
+                              mlir::func::FuncOp func, mlir::Operation *dst) {
+  const mlir::StringRef attrs[] = {
+      numba::util::attributes::getParallelScheduleName(),
+      numba::util::attributes::getParallelGrainName(),
+      numba::util::attributes::getCudaThreadsPerBlockName(),
+      numba::util::attributes::getCudaOccupancyLaunchName(),
+  };
+  auto *region = isInsideParalleRegion(src) ? src->getParentOp() : nullptr;
+  for (auto name : attrs) {
+    if (auto attr = src->getAttr(name)) {
+      dst->setAttr(name, attr);
+    } else if (auto attr = region ? region->getAttr(name) : mlir::Attribute()) {
+      dst->setAttr(name, attr);
+    } else if (auto attr = func->getAttr(name);
+               attr && !mlir::isa<mlir::ArrayAttr>(attr)) {
+      dst->setAttr(name, attr);
+    }
+  }
+}
+
+/// Tag parallel op with region name for the runtime profiler, if profiling is
+/// enabled for the function.
+static void setRegionName(mlir::scf::ParallelOp src, mlir::func::FuncOp func,
+                          mlir::Operation *dst) {
+  if (!func->hasAttr(numba::util::attributes::getParallelProfileName()))
+    return;
+
+  std::string name = func.getName().str();
+  if (auto loc = mlir::dyn_cast<mlir::FileLineColLoc>(src.getLoc()))
+    name += ("@" + loc.getFilename().getValue() + ":" +
+             llvm::Twine(loc.getLine()))
+                .str();
+
+  dst->setAttr(numba::util::attributes::getParallelRegionName(),
+               mlir::StringAttr::get(dst->getContext(), name));
+}
+
+/// Nested loops trip counts are clamped to this value during cost estimation,
+/// so cost doesn't overflow.
+static constexpr int64_t MaxCostTripCount = 1 << 16;
+
+/// Returns estimated cost of the single loop iteration in the number of ops
+/// or `std::nullopt` if body contains calls or loops with unknown trip count.
+static std::optional<int64_t> estimateIterationCost(mlir::Block &body) {
+  int64_t cost = 0;
+  for (auto &op : body.without_terminator()) {
+    if (mlir::isa<mlir::CallOpInterface>(op))
+      return std::nullopt;
+
+    if (auto forOp = mlir::dyn_cast<mlir::scf::ForOp>(op)) {
+      auto lower = mlir::getConstantIntValue(forOp.getLowerBound());
+      auto upper = mlir::getConstantIntValue(forOp.getUpperBound());
+      auto step = mlir::getConstantIntValue(forOp.getStep());
+      if (!lower || !upper || !step || *step <= 0)
+        return std::nullopt;
+
+      auto bodyCost = estimateIterationCost(*forOp.getBody());
+      if (!bodyCost)
+        return std::nullopt;
+
+      auto tripCount = std::min(
+          std::max<int64_t>(llvm::divideCeil(*upper - *lower, *step), 0),
+          MaxCostTripCount);
+      cost += tripCount * std::max<int64_t>(*bodyCost, 1);
+    } else if (op.getNumRegions() != 0) {
+      // Conditionals are counted as if all branches are executed, other
+      // region ops (e.g. while loops) have unknown cost.
+      if (!mlir::isa<mlir::scf::IfOp>(op))
+        return std::nullopt;
+
+      cost += 1;
+      for (auto &region : op.getRegions()) {
+        if (region.empty())
+          continue;
+
+        auto regCost = estimateIterationCost(region.front());
+        if (!regCost)
+          return std::nullopt;
+
+        cost += *regCost;
+      }
+    } else {
+      cost += 1;
+    }
+    cost = std::min(cost, MaxCostTripCount * MaxCostTripCount);
+  }
+  return cost;
+}
+
+/// Parallel loops are outlined to the runtime for TBB backend (default).
+static bool isTbbBackend(mlir::func::FuncOp func) {
+  auto backend = func->getAttrOfType<mlir::StringAttr>(
+      numba::util::attributes::getParallelBackendName());
+  return !backend || backend.getValue() == "tbb";
+}
+
+/// Tapir backends also outline parallel loops, but they are expanded into
+/// Tapir loops during LLVM compilation instead of calling the runtime.
+static bool isTapirBackend(mlir::func::FuncOp func) {
+  auto backend = func->getAttrOfType<mlir::StringAttr>(
+      numba::util::attributes::getParallelBackendName());
+  return backend &&
+         (backend.getValue() == "opencilk" || backend.getValue() == "cuda");
+}
+
+static bool isOpenCilkBackend(mlir::func::FuncOp func) {
+  auto backend = func->getAttrOfType<mlir::StringAttr>(
+      numba::util::attributes::getParallelBackendName());
+  return backend && backend.getValue() == "opencilk";
+}
+
+/// Number of reduction chunks per worker for OpenCilk backend. Tapir tasks
+/// have no stable thread index, so the outermost dimension is split into the
+/// fixed number of chunks instead, each with its own padded reduction slot.
+/// Extra chunks give work-stealing scheduler room for load balancing.
+static constexpr int64_t TapirReduceChunksPerWorker = 4;
+
+/// Number of reduction blocks in deterministic mode. Blocks boundaries only
+/// depend on the trip count, not on the thread count or runtime partitioning,
+/// and per-block results are combined by the fixed pairwise tree, so result
+/// is reproducible between runs. Must be power of 2.
+static constexpr int64_t DeterministicReduceBlocks = 256;
+static_assert(llvm::isPowerOf2_64(DeterministicReduceBlocks));
+
+static bool isDeterministicReduce(mlir::func::FuncOp func) {
+  return func->hasAttr(numba::util::attributes::getDeterministicReduceName());
+}
+
+/// Checks if loop was already outlined to the parallel op body, either
+/// directly or through the chunks loop, iterating over the body range.
+static bool isOutlinedLoop(mlir::scf::ParallelOp op) {
+  auto parent = op->getParentOp();
+  if (mlir::isa<numba::util::ParallelOp>(parent))
+    return true;
+
+  auto chunksLoop = mlir::dyn_cast<mlir::scf::ForOp>(parent);
+  if (!chunksLoop)
+    return false;
+
+  auto parallelOp =
+      mlir::dyn_cast<numba::util::ParallelOp>(chunksLoop->getParentOp());
+  return parallelOp && parallelOp.getNumLoops() == 1 &&
+         chunksLoop.getLowerBound() ==
+             parallelOp.getBodyLowerBounds().front() &&
+         chunksLoop.getUpperBound() == parallelOp.getBodyUpperBounds().front();
+}
+
 struct ParallelToTbb : public mlir::OpRewritePattern<mlir::scf::ParallelOp> {
   using OpRewritePattern::OpRewritePattern;
 
   mlir::LogicalResult
   matchAndRewrite(mlir::scf::ParallelOp op,
                   mlir::PatternRewriter &rewriter) const override {
-    if (mlir::isa<numba::util::ParallelOp>(op->getParentOp()))
+    if (isOutlinedLoop(op))
       return mlir::failure();
 
     bool needParallel = isInsideParalleRegion(op) ||
@@ -63,17 +260,37 @@ struct ParallelToTbb : public mlir::OpRewritePattern<mlir::scf::ParallelOp> {
 
     int64_t maxConcurrency = 0;
     auto func = op->getParentOfType<mlir::func::FuncOp>();
-    if (!func)
+    if (!func || !(isTbbBackend(func) || isTapirBackend(func)))
       return mlir::failure();
     if (auto mc = func->getAttrOfType<mlir::IntegerAttr>(
             numba::util::attributes::getMaxConcurrencyName()))
       maxConcurrency = mc.getInt();
 
-    if (maxConcurrency <= 1)
+    // Deterministic reductions are blocked even for the single thread, so
+    // result doesn't depend on the thread count.
+    bool deterministic = op.getNumResults() != 0 && isDeterministicReduce(func);
+    if (maxConcurrency <= 1 && !deterministic)
       return mlir::failure();
 
+    // Tapir tasks have no stable thread index to address per-thread reduction
+    // slots. For OpenCilk reductions are chunked over the outermost dimension,
+    // other Tapir targets keep such loops serial.
+    bool tapirReduce = op.getNumResults() != 0 && isTapirBackend(func);
+    if (tapirReduce && !isOpenCilkBackend(func)) {
+      op.emitRemark("parallel loop with reductions is not supported by Tapir "
+                    "backend, kept serial");
+      return mlir::failure();
+    }
+
+    bool chunkedReduce = tapirReduce || deterministic;
+    auto numSlots = maxConcurrency;
+    if (deterministic) {
+      numSlots = DeterministicReduceBlocks;
+    } else if (tapirReduce) {
+      numSlots = maxConcurrency * TapirReduceChunksPerWorker;
+    }
     for (auto type : op.getResultTypes())
-      if (!getReduceType(type, maxConcurrency))
+      if (!getReduceType(type, numSlots))
         return mlir::failure();
 
     llvm::SmallVector<mlir::TypedAttr> initVals;
@@ -100,7 +317,7 @@ struct ParallelToTbb : public mlir::OpRewritePattern<mlir::scf::ParallelOp> {
     mlir::IRMapping mapping;
     llvm::SmallVector<mlir::Value> reduceVars(op.getNumResults());
     for (auto &&[i, type] : llvm::enumerate(op.getResultTypes())) {
-      auto reduceType = getReduceType(type, maxConcurrency);
+      auto reduceType = getReduceType(type, numSlots);
       assert(reduceType);
       auto reduce = allocaIP.insert(rewriter, [&]() {
         return rewriter.create<mlir::memref::AllocaOp>(loc, reduceType);
@@ -108,6 +325,8 @@ struct ParallelToTbb : public mlir::OpRewritePattern<mlir::scf::ParallelOp> {
       reduceVars[i] = reduce;
     }
 
+    mlir::Value slotOffset =
+        rewriter.create<mlir::arith::ConstantIndexOp>(loc, 0);
     auto reduceInitBodyBuilder = [&](mlir::OpBuilder &builder,
                                      mlir::Location loc, mlir::Value index,
                                      mlir::ValueRange args) {
@@ -116,7 +335,8 @@ struct ParallelToTbb : public mlir::OpRewritePattern<mlir::scf::ParallelOp> {
       for (auto &&[i, reduce] : llvm::enumerate(reduceVars)) {
         auto initVal = initVals[i];
         auto init = builder.create<mlir::arith::ConstantOp>(loc, initVal);
-        builder.create<mlir::memref::StoreOp>(loc, init, reduce, index);
+        builder.create<mlir::memref::StoreOp>(
+            loc, init, reduce, mlir::ValueRange{index, slotOffset});
       }
       builder.create<mlir::scf::YieldOp>(loc);
     };
@@ -124,72 +344,186 @@ struct ParallelToTbb : public mlir::OpRewritePattern<mlir::scf::ParallelOp> {
     auto reduceLowerBound =
         rewriter.create<mlir::arith::ConstantIndexOp>(loc, 0);
     auto reduceUpperBound =
-        rewriter.create<mlir::arith::ConstantIndexOp>(loc, maxConcurrency);
+        rewriter.create<mlir::arith::ConstantIndexOp>(loc, numSlots);
     auto reduceStep = rewriter.create<mlir::arith::ConstantIndexOp>(loc, 1);
     rewriter.create<mlir::scf::ForOp>(loc, reduceLowerBound, reduceUpperBound,
                                       reduceStep, std::nullopt,
                                       reduceInitBodyBuilder);
 
-    auto origLowerBound = op.getLowerBound();
-    auto origUpperBound = op.getUpperBound();
-    auto origStep = op.getStep();
+    llvm::SmallVector<mlir::Value> origLowerBound(op.getLowerBound());
+    llvm::SmallVector<mlir::Value> origUpperBound(op.getUpperBound());
+    llvm::SmallVector<mlir::Value> origStep(op.getStep());
+
+    // Parallel op iterates over chunks, chunk index is used as slot index.
+    // Runtime may still pass multiple chunks to the single body invocation,
+    // e.g. serially expanded Tapir loops in the first compilation tier call
+    // body once for the entire range, so body iterates over them.
+    mlir::Value chunkSize;
+    if (chunkedReduce) {
+      auto count = rewriter.create<mlir::arith::CeilDivSIOp>(
+          loc,
+          rewriter.create<mlir::arith::SubIOp>(loc, origUpperBound.front(),
+                                               origLowerBound.front()),
+          origStep.front());
+      chunkSize = rewriter.create<mlir::arith::CeilDivSIOp>(loc, count,
+                                                            reduceUpperBound);
+      chunkSize = rewriter.create<mlir::arith::MulIOp>(loc, chunkSize,
+                                                       origStep.front());
+    }
+
     auto bodyBuilder = [&](mlir::OpBuilder &builder, ::mlir::Location loc,
                            mlir::ValueRange lowerBound,
                            mlir::ValueRange upperBound,
                            mlir::Value threadIndex) {
-      llvm::SmallVector<mlir::Value> initVals(op.getInitVals().size());
-      for (auto &&[i, reduceVar] : llvm::enumerate(reduceVars)) {
-        auto val =
-            builder.create<mlir::memref::LoadOp>(loc, reduceVar, threadIndex);
-        initVals[i] = val;
-      }
-      auto newOp =
-          mlir::cast<mlir::scf::ParallelOp>(builder.clone(*op, mapping));
-      assert(newOp->getNumResults() == reduceVars.size());
-      newOp.getLowerBoundMutable().assign(lowerBound);
-      newOp.getUpperBoundMutable().assign(upperBound);
-      newOp.getInitValsMutable().assign(initVals);
-      for (auto &&[i, val] : llvm::enumerate(newOp->getResults())) {
-        auto reduceVar = reduceVars[i];
-        builder.create<mlir::memref::StoreOp>(loc, val, reduceVar, threadIndex);
+      auto genBody = [&](mlir::OpBuilder &builder, mlir::Location loc,
+                         mlir::ValueRange newLowerBound,
+                         mlir::ValueRange newUpperBound,
+                         mlir::Value slotIndex) {
+        llvm::SmallVector<mlir::Value> initVals(op.getInitVals().size());
+        for (auto &&[i, reduceVar] : llvm::enumerate(reduceVars)) {
+          auto val = builder.create<mlir::memref::LoadOp>(
+              loc, reduceVar, mlir::ValueRange{slotIndex, slotOffset});
+          initVals[i] = val;
+        }
+        auto newOp =
+            mlir::cast<mlir::scf::ParallelOp>(builder.clone(*op, mapping));
+        assert(newOp->getNumResults() == reduceVars.size());
+        newOp.getLowerBoundMutable().assign(newLowerBound);
+        newOp.getUpperBoundMutable().assign(newUpperBound);
+        newOp.getInitValsMutable().assign(initVals);
+        for (auto &&[i, val] : llvm::enumerate(newOp->getResults())) {
+          auto reduceVar = reduceVars[i];
+          builder.create<mlir::memref::StoreOp>(
+              loc, val, reduceVar, mlir::ValueRange{slotIndex, slotOffset});
+        }
+      };
+
+      if (!chunkedReduce) {
+        genBody(builder, loc, lowerBound, upperBound, threadIndex);
+        return;
       }
+
+      auto chunkBodyBuilder = [&](mlir::OpBuilder &builder, mlir::Location loc,
+                                  mlir::Value chunkIndex,
+                                  mlir::ValueRange args) {
+        assert(args.empty());
+        (void)args;
+        mlir::Value begin =
+            builder.create<mlir::arith::MulIOp>(loc, chunkIndex, chunkSize);
+        begin = builder.create<mlir::arith::AddIOp>(
+            loc, origLowerBound.front(), begin);
+        mlir::Value end =
+            builder.create<mlir::arith::AddIOp>(loc, begin, chunkSize);
+        end = builder.create<mlir::arith::MinSIOp>(loc, end,
+                                                   origUpperBound.front());
+        llvm::SmallVector<mlir::Value> newLowerBound(origLowerBound);
+        llvm::SmallVector<mlir::Value> newUpperBound(origUpperBound);
+        newLowerBound.front() = begin;
+        newUpperBound.front() = end;
+        genBody(builder, loc, newLowerBound, newUpperBound, chunkIndex);
+        builder.create<mlir::scf::YieldOp>(loc);
+      };
+      builder.create<mlir::scf::ForOp>(loc, lowerBound.front(),
+                                       upperBound.front(), reduceStep,
+                                       std::nullopt, chunkBodyBuilder);
+    };
+
+    auto parallelOp = [&]() {
+      if (!chunkedReduce)
+        return rewriter.create<numba::util::ParallelOp>(
+            loc, origLowerBound, origUpperBound, origStep, bodyBuilder);
+
+      mlir::Value lower = reduceLowerBound;
+      mlir::Value upper = reduceUpperBound;
+      mlir::Value step = reduceStep;
+      return rewriter.create<numba::util::ParallelOp>(loc, lower, upper, step,
+                                                      bodyBuilder);
+    }();
+    copyScheduleAttrs(op, func, parallelOp);
+    setRegionName(op, func, parallelOp);
+
+    // Chunks are already coarse, spawn one task per chunk.
+    if (chunkedReduce)
+      parallelOp->setAttr(numba::util::attributes::getParallelGrainName(),
+                          rewriter.getI64IntegerAttr(1));
+
+    // Runtime uses iteration cost to run small loops on the calling thread.
+    if (auto cost = estimateIterationCost(*op.getBody()))
+      parallelOp->setAttr(numba::util::attributes::getParallelCostName(),
+                          rewriter.getI64IntegerAttr(*cost));
+
+    auto genReduce = [&](mlir::OpBuilder &builder, mlir::Location loc,
+                         unsigned i, mlir::Value lhs,
+                         mlir::Value rhs) -> mlir::Value {
+      mapping.clear();
+      auto &reduceOpBody = reduceOp.getReductions()[i].front();
+      assert(reduceOpBody.getNumArguments() == 2);
+      mapping.map(reduceOpBody.getArgument(0), lhs);
+      mapping.map(reduceOpBody.getArgument(1), rhs);
+      for (auto &oldReduceOp : reduceOpBody.without_terminator())
+        builder.clone(oldReduceOp, mapping);
+
+      auto result =
+          mlir::cast<mlir::scf::ReduceReturnOp>(reduceOpBody.getTerminator())
+              .getResult();
+      result = mapping.lookupOrNull(result);
+      assert(result);
+      return result;
     };
 
-    rewriter.create<numba::util::ParallelOp>(
-        loc, origLowerBound, origUpperBound, origStep, bodyBuilder);
+    // Combine blocks results pairwise, `slot[i] = slot[i] op slot[i + width]`
+    // for every level, so the final result ends up in the first slot.
+    if (deterministic) {
+      for (int64_t width = 1; width < numSlots; width *= 2) {
+        auto treeBodyBuilder = [&](mlir::OpBuilder &builder,
+                                   mlir::Location loc, mlir::Value index,
+                                   mlir::ValueRange args) {
+          assert(args.empty());
+          (void)args;
+          mlir::Value other = builder.create<mlir::arith::AddIOp>(
+              loc, index,
+              builder.create<mlir::arith::ConstantIndexOp>(loc, width));
+          for (auto &&[i, reduceVar] : llvm::enumerate(reduceVars)) {
+            mlir::Value lhs = builder.create<mlir::memref::LoadOp>(
+                loc, reduceVar, mlir::ValueRange{index, slotOffset});
+            mlir::Value rhs = builder.create<mlir::memref::LoadOp>(
+                loc, reduceVar, mlir::ValueRange{other, slotOffset});
+            auto res = genReduce(builder, loc, static_cast<unsigned>(i), lhs,
+                                 rhs);
+            builder.create<mlir::memref::StoreOp>(
+                loc, res, reduceVar, mlir::ValueRange{index, slotOffset});
+          }
+          builder.create<mlir::scf::YieldOp>(loc);
+        };
+        auto treeStep =
+            rewriter.create<mlir::arith::ConstantIndexOp>(loc, width * 2);
+        rewriter.create<mlir::scf::ForOp>(loc, reduceLowerBound,
+                                          reduceUpperBound, treeStep,
+                                          std::nullopt, treeBodyBuilder);
+      }
+    }
 
     auto reduceBodyBuilder = [&](mlir::OpBuilder &builder, mlir::Location loc,
                                  mlir::Value index, mlir::ValueRange args) {
       assert(args.size() == reduceVars.size());
-      mapping.clear();
-
       llvm::SmallVector<mlir::Value> yieldArgs;
       yieldArgs.reserve(args.size());
-      for (auto &&[i, reduceOpRegion] :
-           llvm::enumerate(reduceOp.getReductions())) {
-        auto &reduceVar = reduceVars[i];
+      for (auto &&[i, reduceVar] : llvm::enumerate(reduceVars)) {
         auto arg = args[static_cast<unsigned>(i)];
-        auto &reduceOpBody = reduceOpRegion.front();
-        assert(reduceOpBody.getNumArguments() == 2);
-        auto prevVal =
-            builder.create<mlir::memref::LoadOp>(loc, reduceVar, index);
-        mapping.map(reduceOpBody.getArgument(0), arg);
-        mapping.map(reduceOpBody.getArgument(1), prevVal);
-        for (auto &oldReduceOp : reduceOpBody.without_terminator())
-          builder.clone(oldReduceOp, mapping);
-
-        auto result =
-            mlir::cast<mlir::scf::ReduceReturnOp>(reduceOpBody.getTerminator())
-                .getResult();
-        result = mapping.lookupOrNull(result);
-        assert(result);
-        yieldArgs.emplace_back(result);
+        auto prevVal = builder.create<mlir::memref::LoadOp>(
+            loc, reduceVar, mlir::ValueRange{index, slotOffset});
+        yieldArgs.emplace_back(
+            genReduce(builder, loc, static_cast<unsigned>(i), arg, prevVal));
       }
       builder.create<mlir::scf::YieldOp>(loc, yieldArgs);
     };
 
+    mlir::Value finalUpperBound = reduceUpperBound;
+    if (deterministic)
+      finalUpperBound = rewriter.create<mlir::arith::ConstantIndexOp>(loc, 1);
+
     auto reduceLoop = rewriter.create<mlir::scf::ForOp>(
-        loc, reduceLowerBound, reduceUpperBound, reduceStep, op.getInitVals(),
+        loc, reduceLowerBound, finalUpperBound, reduceStep, op.getInitVals(),
         reduceBodyBuilder);
     rewriter.replaceOp(op, reduceLoop.getResults());
 
@@ -287,6 +621,11 @@ struct HoistBufferAllocs
     if (loopInfo->innermostParallel && !mc)
       return mlir::failure();
 
+    // Per-thread buffers are indexed by thread index, which is not available
+    // for Tapir tasks.
+    if (loopInfo->innermostParallel && isTapirBackend(func))
+      return mlir::failure();
+
     bool needParallel =
         loopInfo->innermostParallel && mc.getValue().getSExtValue() > 0;
 
@@ -376,6 +715,9 @@ struct HoistBufferAllocsPass
           HoistBufferAllocs> {};
 
 static void populateParallelToTbbPipeline(mlir::OpPassManager &pm) {
+  // Only runs for functions with `numba.vector_length` attribute.
+  pm.addNestedPass<mlir::func::FuncOp>(numba::createLoopDistributionPass());
+  pm.addNestedPass<mlir::func::FuncOp>(numba::createSCFVectorizePass());
   pm.addNestedPass<mlir::func::FuncOp>(
       mlir::createLoopInvariantCodeMotionPass());
   pm.addNestedPass<mlir::func::FuncOp>(
@@ -383,6 +725,8 @@ static void populateParallelToTbbPipeline(mlir::OpPassManager &pm) {
   pm.addNestedPass<mlir::func::FuncOp>(mlir::createCanonicalizerPass());
   pm.addNestedPass<mlir::func::FuncOp>(mlir::createCSEPass());
   pm.addNestedPass<mlir::func::FuncOp>(mlir::createCanonicalizerPass());
+  pm.addNestedPass<mlir::func::FuncOp>(std::make_unique<ParallelToTbbPass>());
+  pm.addNestedPass<mlir::func::FuncOp>(mlir::createCanonicalizerPass());
 }
 } // namespace
 
@@ -5,7 +5,11 @@
 #include "pipelines/PlierToLinalg.hpp"
 
 #include <mlir/Analysis/AliasAnalysis.h>
+#include <mlir/Conversion/AffineToStandard/AffineToStandard.h>
 #include <mlir/Conversion/ReconcileUnrealizedCasts/ReconcileUnrealizedCasts.h>
+#include <mlir/Dialect/Affine/IR/AffineOps.h>
+#include <mlir/Dialect/Affine/LoopUtils.h>
+#include <mlir/Dialect/Affine/Passes.h>
 #include <mlir/Dialect/Arith/IR/Arith.h>
 #include <mlir/Dialect/Arith/Transforms/Passes.h>
 #include <mlir/Dialect/Arith/Utils/Utils.h>
@@ -30,6 +34,7 @@
 #include <mlir/Dialect/UB/IR/UBOps.h>
 #include <mlir/IR/Dialect.h>
 #include <mlir/IR/Dominance.h>
+#include <mlir/IR/Matchers.h>
 #include <mlir/Pass/Pass.h>
 #include <mlir/Pass/PassManager.h>
 #include <mlir/Transforms/DialectConversion.h>
@@ -42,33 +47,49 @@
 #include "pipelines/PreLowSimplifications.hpp"
 
 #include "numba/Analysis/AliasAnalysis.hpp"
+#include "numba/Analysis/MemorySsaAnalysis.hpp"
 #include "numba/Compiler/PipelineRegistry.hpp"
 #include "numba/Conversion/NtensorToLinalg.hpp"
 #include "numba/Conversion/NtensorToMemref.hpp"
+#include "numba/Conversion/SCFToAffine/SCFToAffine.h"
 #include "numba/Dialect/gpu_runtime/IR/GpuRuntimeOps.hpp"
 #include "numba/Dialect/ntensor/IR/NTensorOps.hpp"
+#include "numba/Dialect/ntensor/Transforms/FuseElementwise.hpp"
+#include "numba/Dialect/ntensor/Transforms/HoistArrayOps.hpp"
 #include "numba/Dialect/ntensor/Transforms/PropagateEnvironment.hpp"
 #include "numba/Dialect/ntensor/Transforms/ResolveArrayOps.hpp"
 #include "numba/Dialect/numba_util/Dialect.hpp"
 #include "numba/Dialect/plier/Dialect.hpp"
+#include "numba/Transforms/BalanceCsrLoops.hpp"
 #include "numba/Transforms/CanonicalizeReductions.hpp"
 #include "numba/Transforms/CastUtils.hpp"
 #include "numba/Transforms/CommonOpts.hpp"
 #include "numba/Transforms/CompositePass.hpp"
+#include "numba/Transforms/ConstUtils.hpp"
 #include "numba/Transforms/CopyRemoval.hpp"
 #include "numba/Transforms/ExpandTuple.hpp"
 #include "numba/Transforms/FuncTransforms.hpp"
+#include "numba/Transforms/FuncUtils.hpp"
+#include "numba/Transforms/FuseParallelLoops.hpp"
+#include "numba/Transforms/HoistMemrefOffsets.hpp"
 #include "numba/Transforms/InlineUtils.hpp"
 #include "numba/Transforms/LoopUtils.hpp"
 #include "numba/Transforms/MakeSignless.hpp"
 #include "numba/Transforms/MemoryRewrites.hpp"
+#include "numba/Transforms/PackStridedMemrefs.hpp"
 #include "numba/Transforms/PipelineUtils.hpp"
 #include "numba/Transforms/PromoteBoolMemref.hpp"
 #include "numba/Transforms/PromoteToParallel.hpp"
+#include "numba/Transforms/ReuseBuffers.hpp"
 #include "numba/Transforms/RewriteWrapper.hpp"
 #include "numba/Transforms/ShapeIntegerRangePropagation.hpp"
+#include "numba/Transforms/SoftwarePrefetch.hpp"
+#include "numba/Transforms/StreamParallelLoops.hpp"
+#include "numba/Transforms/TileParallelLoops.hpp"
 #include "numba/Transforms/TypeConversion.hpp"
 #include "numba/Transforms/UpliftMath.hpp"
+#include "numba/Transforms/VersionAliasingLoops.hpp"
+#include "numba/Transforms/VersionStridedLoops.hpp"
 
 #include "llvm/ADT/SmallSet.h"
 
@@ -76,8 +97,14 @@
 #include "NumpyResolver.hpp"
 #include "PyLinalgResolver.hpp"
 
+#include <atomic>
 #include <cctype>
 
+static std::atomic<uint64_t> stackAllocMaxSize = 1024;
+static std::atomic<bool> zeroInitAllocEnabled = true;
+static std::atomic<uint64_t> parallelFillThreshold = 4 * 1024 * 1024;
+static std::atomic<uint64_t> streamChunkSize = 0;
+
 namespace {
 static numba::util::EnvironmentRegionOp
 isInsideParallelRegion(mlir::Operation *op) {
@@ -175,8 +202,14 @@ static mlir::LogicalResult applyOptimizations(
   bool repeat = false;
   do {
     repeat = false;
-    (void)mlir::applyPatternsAndFoldGreedily(op, patterns);
+    numba::MemorySSAUpdater updater(am);
+    mlir::GreedyRewriteConfig config;
+    config.listener = &updater;
+    (void)mlir::applyPatternsAndFoldGreedily(op, patterns, config);
+    if (updater.isInvalidated())
+      am.invalidate({});
 
+    // Memory opts keep memssa analysis up to date.
     auto memOptRes = numba::optimizeMemoryOps(am);
     if (!memOptRes)
       return op.emitError() << "Failed to build memssa analysis";
@@ -184,15 +217,20 @@ static mlir::LogicalResult applyOptimizations(
     if (mlir::succeeded(*memOptRes))
       repeat = true;
 
+    bool invalidate = false;
     if (optimizeSimpleLoads(op))
-      repeat = true;
+      invalidate = true;
+
+    if (mlir::succeeded(numba::forwardLoopCarriedLoads(op)))
+      invalidate = true;
 
     if (additionalOpts && mlir::succeeded(additionalOpts(op)))
-      repeat = true;
+      invalidate = true;
 
-    if (repeat)
+    if (invalidate) {
       am.invalidate({});
-
+      repeat = true;
+    }
   } while (repeat);
   return mlir::success();
 }
@@ -423,6 +461,7 @@ struct ReshapeChangeLayout
       builder.create<mlir::scf::YieldOp>(loc, res);
     };
 
+    op.emitRemark("reshape of non-contiguous array may require a copy");
     auto res = rewriter.create<mlir::scf::IfOp>(loc, cmp, trueBody, falseBody)
                    .getResult(0);
     rewriter.replaceOpWithNewOp<numba::util::ReshapeOp>(op, op.getType(), res,
@@ -2103,7 +2142,8 @@ struct NtensorPrimitiveCallsLowering final
     : public mlir::OpRewritePattern<numba::ntensor::PrimitiveOp> {
   NtensorPrimitiveCallsLowering(mlir::MLIRContext *context)
       : OpRewritePattern(context),
-        resolver("numba_mlir.mlir.numpy.funcs", "registry") {}
+        resolver("numba_mlir.mlir.numpy.funcs", "registry",
+                 /*outline*/ true) {}
 
   mlir::LogicalResult
   matchAndRewrite(numba::ntensor::PrimitiveOp op,
@@ -2132,7 +2172,8 @@ struct NtensorPrimitiveSeCallsLowering final
     : public mlir::OpRewritePattern<numba::ntensor::PrimitiveSeOp> {
   NtensorPrimitiveSeCallsLowering(mlir::MLIRContext *context)
       : OpRewritePattern(context),
-        resolver("numba_mlir.mlir.numpy.funcs", "registry") {}
+        resolver("numba_mlir.mlir.numpy.funcs", "registry",
+                 /*outline*/ true) {}
 
   mlir::LogicalResult
   matchAndRewrite(numba::ntensor::PrimitiveSeOp op,
@@ -2161,7 +2202,8 @@ struct NtensorViewPrimitiveCallsLowering final
     : public mlir::OpRewritePattern<numba::ntensor::ViewPrimitiveOp> {
   NtensorViewPrimitiveCallsLowering(mlir::MLIRContext *context)
       : OpRewritePattern(context),
-        resolver("numba_mlir.mlir.numpy.funcs", "registry") {}
+        resolver("numba_mlir.mlir.numpy.funcs", "registry",
+                 /*outline*/ true) {}
 
   mlir::LogicalResult
   matchAndRewrite(numba::ntensor::ViewPrimitiveOp op,
@@ -2786,6 +2828,179 @@ struct PropagateFastmathFlags
   }
 };
 
+static const constexpr llvm::StringLiteral
+    kMatmulEpilogue("__internal_matmul_epilogue");
+
+// Must be in sync with python resolver and math runtime.
+enum class MatmulActivation : int64_t { None = 0, Relu = 1 };
+
+static numba::ntensor::PrimitiveOp getSingleUsePrimitive(mlir::Value val,
+                                                         llvm::StringRef name) {
+  auto op = val.getDefiningOp<numba::ntensor::PrimitiveOp>();
+  if (!op || op.getOp() != name || op->getNumResults() != 1 ||
+      !val.hasOneUse())
+    return nullptr;
+
+  return op;
+}
+
+static bool isFloatNTensor(mlir::Value val, unsigned rank,
+                           mlir::Type elemType) {
+  auto type = mlir::dyn_cast<numba::ntensor::NTensorType>(val.getType());
+  return type && type.getRank() == rank && type.getElementType() == elemType;
+}
+
+static bool isZeroConst(mlir::Value val) {
+  if (auto cast = val.getDefiningOp<numba::util::SignCastOp>())
+    val = cast.getSource();
+
+  auto attr = numba::getConstVal(val);
+  if (auto intAttr = mlir::dyn_cast_or_null<mlir::IntegerAttr>(attr))
+    return intAttr.getValue().isZero();
+
+  if (auto floatAttr = mlir::dyn_cast_or_null<mlir::FloatAttr>(attr))
+    return floatAttr.getValue().isZero();
+
+  return false;
+}
+
+/// Replace `a @ b + bias` with matmul epilogue primitive, so bias can be
+/// applied while matmul result is still hot in cache instead of separate pass
+/// over the result.
+struct FuseMatmulBias
+    : public mlir::OpRewritePattern<numba::ntensor::PrimitiveOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(numba::ntensor::PrimitiveOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    if (op.getOp() != "operator.add" || op.getArgs().size() != 2 ||
+        op->getNumResults() != 1)
+      return mlir::failure();
+
+    auto resType =
+        mlir::dyn_cast<numba::ntensor::NTensorType>(op.getResult(0).getType());
+    if (!resType || resType.getRank() != 2)
+      return mlir::failure();
+
+    auto elemType = resType.getElementType();
+    if (!elemType.isF32() && !elemType.isF64())
+      return mlir::failure();
+
+    for (auto i : {0, 1}) {
+      auto matmul = getSingleUsePrimitive(op.getArgs()[i], "operator.matmul");
+      if (!matmul || matmul.getArgs().size() != 2)
+        continue;
+
+      auto a = matmul.getArgs()[0];
+      auto b = matmul.getArgs()[1];
+      auto bias = op.getArgs()[1 - i];
+      if (!isFloatNTensor(matmul.getResult(0), 2, elemType) ||
+          !isFloatNTensor(a, 2, elemType) || !isFloatNTensor(b, 2, elemType) ||
+          !isFloatNTensor(bias, 1, elemType))
+        continue;
+
+      auto loc = op.getLoc();
+      mlir::Value activation = rewriter.create<mlir::arith::ConstantIntOp>(
+          loc, static_cast<int64_t>(MatmulActivation::None), 64);
+      mlir::Value args[] = {a, b, bias, activation};
+      rewriter.replaceOpWithNewOp<numba::ntensor::PrimitiveOp>(
+          op, op->getResultTypes(), args, kMatmulEpilogue);
+      rewriter.eraseOp(matmul);
+      return mlir::success();
+    }
+    return mlir::failure();
+  }
+};
+
+/// Fold `np.maximum(x, 0)` into matmul epilogue.
+struct FuseMatmulRelu
+    : public mlir::OpRewritePattern<numba::ntensor::PrimitiveOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(numba::ntensor::PrimitiveOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    if (op.getOp() != "numpy.maximum" || op.getArgs().size() != 2 ||
+        op->getNumResults() != 1)
+      return mlir::failure();
+
+    for (auto i : {0, 1}) {
+      auto epilogue = getSingleUsePrimitive(op.getArgs()[i], kMatmulEpilogue);
+      if (!epilogue || !isZeroConst(op.getArgs()[1 - i]))
+        continue;
+
+      auto epilogueArgs = epilogue.getArgs();
+      auto activation = mlir::getConstantIntValue(epilogueArgs.back());
+      if (activation != static_cast<int64_t>(MatmulActivation::None))
+        continue;
+
+      if (op.getResult(0).getType() != epilogue.getResult(0).getType())
+        continue;
+
+      auto loc = op.getLoc();
+      llvm::SmallVector<mlir::Value> args(epilogueArgs.drop_back());
+      args.emplace_back(rewriter.create<mlir::arith::ConstantIntOp>(
+          loc, static_cast<int64_t>(MatmulActivation::Relu), 64));
+      rewriter.replaceOpWithNewOp<numba::ntensor::PrimitiveOp>(
+          op, op->getResultTypes(), args, kMatmulEpilogue);
+      rewriter.eraseOp(epilogue);
+      return mlir::success();
+    }
+    return mlir::failure();
+  }
+};
+
+static const constexpr llvm::StringLiteral
+    kSumProduct("__internal_sum_product");
+
+/// Replace `np.sum(a * b, axis)` with sum product primitive, so python
+/// resolver can lower it as tensor contraction (GEMM) instead of materializing
+/// broadcasted product. Convolutions written as sums over the shifted input
+/// windows, multiplied by the weights, are lowered this way to the im2col
+/// window copy and GEMM.
+struct FuseSumOfProducts
+    : public mlir::OpRewritePattern<numba::ntensor::PrimitiveOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(numba::ntensor::PrimitiveOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    auto name = op.getOp();
+    if ((name != "numpy.sum" && name != "array.sum") ||
+        op.getArgs().size() != 4 || op->getNumResults() != 1)
+      return mlir::failure();
+
+    auto mul = getSingleUsePrimitive(op.getArgs()[0], "operator.mul");
+    if (!mul || mul.getArgs().size() != 2)
+      return mlir::failure();
+
+    auto resType =
+        mlir::dyn_cast<numba::ntensor::NTensorType>(mul.getResult(0).getType());
+    if (!resType)
+      return mlir::failure();
+
+    auto elemType = resType.getElementType();
+    if (!elemType.isF32() && !elemType.isF64())
+      return mlir::failure();
+
+    auto a = mul.getArgs()[0];
+    auto b = mul.getArgs()[1];
+    auto aType = mlir::dyn_cast<numba::ntensor::NTensorType>(a.getType());
+    auto bType = mlir::dyn_cast<numba::ntensor::NTensorType>(b.getType());
+    if (!aType || !bType || aType.getElementType() != elemType ||
+        bType.getElementType() != elemType)
+      return mlir::failure();
+
+    llvm::SmallVector<mlir::Value> args = {a, b};
+    args.append(op.getArgs().begin() + 1, op.getArgs().end());
+    rewriter.replaceOpWithNewOp<numba::ntensor::PrimitiveOp>(
+        op, op->getResultTypes(), args, kSumProduct);
+    rewriter.eraseOp(mul);
+    return mlir::success();
+  }
+};
+
 struct ResolveNumpyFuncsPass
     : public mlir::PassWrapper<ResolveNumpyFuncsPass,
                                mlir::OperationPass<void>> {
@@ -2811,7 +3026,8 @@ struct ResolveNumpyFuncsPass
     patterns.insert<NumpyCallsResolver>(&ctx, *resolver);
 
     patterns.insert<GetitemArrayOpLowering, SetitemArrayOpLowering,
-                    UnaryOpsLowering, BinOpsLowering>(&ctx);
+                    UnaryOpsLowering, BinOpsLowering, FuseMatmulBias,
+                    FuseMatmulRelu, FuseSumOfProducts>(&ctx);
 
     if (mlir::failed(mlir::applyPatternsAndFoldGreedily(getOperation(),
                                                         std::move(patterns))))
@@ -3421,6 +3637,188 @@ static void visitTypeRecursive(mlir::Type type, F &&visitor) {
   }
 }
 
+/// Splits slice offset into `base + const`, `base` is null for static
+/// offsets.
+static std::pair<mlir::Value, int64_t>
+decomposeSliceOffset(mlir::OpFoldResult offset) {
+  if (auto val = mlir::getConstantIntValue(offset))
+    return {nullptr, *val};
+
+  auto val = offset.get<mlir::Value>();
+  if (auto add = val.getDefiningOp<mlir::arith::AddIOp>()) {
+    if (auto rhs = mlir::getConstantIntValue(add.getRhs()))
+      return {add.getLhs(), *rhs};
+
+    if (auto lhs = mlir::getConstantIntValue(add.getLhs()))
+      return {add.getRhs(), *lhs};
+  }
+
+  if (auto sub = val.getDefiningOp<mlir::arith::SubIOp>())
+    if (auto rhs = mlir::getConstantIntValue(sub.getRhs()))
+      return {sub.getLhs(), -*rhs};
+
+  return {val, 0};
+}
+
+/// Replaces multiple unit-stride slices of the same tensor, shifted by
+/// constant offsets (e.g. `a[:-2] + a[1:-1] + a[2:]` after `SliceOfGeneric`
+/// and elementwise fusion), with the single slice, covering all of them, and
+/// shifted indexing maps. Stencil is then computed by the single kernel,
+/// which reads all neighbours from the same base and is tiled as a whole
+/// later, so the halo is reused from cache.
+struct FuseStencilSlices
+    : public mlir::OpRewritePattern<mlir::linalg::GenericOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::linalg::GenericOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    if (!op.hasPureTensorSemantics())
+      return mlir::failure();
+
+    auto maps = op.getIndexingMapsArray();
+    auto numInputs = static_cast<unsigned>(op.getNumDpsInputs());
+    auto isDimExpr = [](mlir::AffineExpr expr) {
+      return mlir::isa<mlir::AffineDimExpr>(expr);
+    };
+    auto isUnitStride = [](mlir::OpFoldResult stride) {
+      return mlir::isConstantIntValue(stride, 1);
+    };
+    auto getSlice = [&](unsigned i) -> mlir::tensor::ExtractSliceOp {
+      auto slice = op.getDpsInputOperand(i)
+                       ->get()
+                       .getDefiningOp<mlir::tensor::ExtractSliceOp>();
+      if (!slice ||
+          slice.getSourceType().getRank() != slice.getType().getRank() ||
+          !llvm::all_of(slice.getMixedStrides(), isUnitStride) ||
+          !llvm::all_of(maps[i].getResults(), isDimExpr))
+        return {};
+
+      return slice;
+    };
+
+    using Offsets = llvm::SmallVector<std::pair<mlir::Value, int64_t>, 4>;
+    auto getOffsets = [](mlir::tensor::ExtractSliceOp slice) {
+      Offsets ret;
+      for (auto offset : slice.getMixedOffsets())
+        ret.emplace_back(decomposeSliceOffset(offset));
+
+      return ret;
+    };
+
+    // Find slices of the same source with the same offset bases, which
+    // differ only by constant shifts.
+    llvm::SmallVector<unsigned> group;
+    llvm::SmallVector<Offsets> groupOffsets;
+    for (auto i : llvm::seq(0u, numInputs)) {
+      auto slice = getSlice(i);
+      if (!slice)
+        continue;
+
+      group.assign(1, i);
+      groupOffsets.assign(1, getOffsets(slice));
+      bool shifted = false;
+      for (auto j : llvm::seq(i + 1, numInputs)) {
+        auto other = getSlice(j);
+        if (!other || other.getSource() != slice.getSource() ||
+            maps[j] != maps[i])
+          continue;
+
+        auto offsets = getOffsets(other);
+        auto &first = groupOffsets.front();
+        bool sameBases = llvm::all_of(llvm::seq<size_t>(0, offsets.size()),
+                                      [&](size_t d) {
+                                        return offsets[d].first ==
+                                               first[d].first;
+                                      });
+        if (!sameBases)
+          continue;
+
+        shifted = shifted || offsets != first;
+        group.emplace_back(j);
+        groupOffsets.emplace_back(std::move(offsets));
+      }
+
+      if (shifted)
+        break;
+
+      group.clear();
+    }
+
+    if (group.empty())
+      return mlir::failure();
+
+    auto slice = getSlice(group.front());
+    auto rank = static_cast<unsigned>(slice.getType().getRank());
+    llvm::SmallVector<int64_t, 4> minShift(rank,
+                                           std::numeric_limits<int64_t>::max());
+    llvm::SmallVector<int64_t, 4> maxShift(rank,
+                                           std::numeric_limits<int64_t>::min());
+    for (auto &offsets : groupOffsets) {
+      for (auto d : llvm::seq(0u, rank)) {
+        minShift[d] = std::min(minShift[d], offsets[d].second);
+        maxShift[d] = std::max(maxShift[d], offsets[d].second);
+      }
+    }
+
+    // Union of the slices is in bounds if all of them are.
+    auto loc = op.getLoc();
+    auto addConst = [&](mlir::Value val, int64_t cst) -> mlir::OpFoldResult {
+      if (!val)
+        return rewriter.getIndexAttr(cst);
+
+      if (cst == 0)
+        return val;
+
+      mlir::Value cstVal =
+          rewriter.create<mlir::arith::ConstantIndexOp>(loc, cst);
+      return rewriter.createOrFold<mlir::arith::AddIOp>(loc, val, cstVal);
+    };
+
+    llvm::SmallVector<mlir::OpFoldResult, 4> hullOffsets;
+    llvm::SmallVector<mlir::OpFoldResult, 4> hullSizes;
+    auto sizes = slice.getMixedSizes();
+    auto &firstOffsets = groupOffsets.front();
+    for (auto d : llvm::seq(0u, rank)) {
+      hullOffsets.emplace_back(addConst(firstOffsets[d].first, minShift[d]));
+
+      auto extent = maxShift[d] - minShift[d];
+      if (auto size = mlir::getConstantIntValue(sizes[d])) {
+        hullSizes.emplace_back(rewriter.getIndexAttr(*size + extent));
+      } else {
+        hullSizes.emplace_back(addConst(sizes[d].get<mlir::Value>(), extent));
+      }
+    }
+    llvm::SmallVector<mlir::OpFoldResult, 4> hullStrides(
+        rank, rewriter.getIndexAttr(1));
+    mlir::Value hull = rewriter.create<mlir::tensor::ExtractSliceOp>(
+        loc, slice.getSource(), hullOffsets, hullSizes, hullStrides);
+
+    auto ctx = getContext();
+    auto getShiftedMap = [&](mlir::AffineMap map, const Offsets &offsets) {
+      llvm::SmallVector<mlir::AffineExpr, 4> exprs;
+      for (auto &&[d, expr] : llvm::enumerate(map.getResults()))
+        exprs.emplace_back(expr + (offsets[d].second - minShift[d]));
+
+      return mlir::AffineMap::get(map.getNumDims(), map.getNumSymbols(), exprs,
+                                  ctx);
+    };
+
+    // Each group member still needs its own operand, as they are read
+    // with the different maps, but all of them now share the same slice.
+    for (auto &&[i, offsets] : llvm::zip(group, groupOffsets))
+      maps[i] = getShiftedMap(maps[i], offsets);
+
+    rewriter.modifyOpInPlace(op, [&]() {
+      for (auto i : group)
+        op.getDpsInputOperand(i)->set(hull);
+
+      op.setIndexingMapsAttr(rewriter.getAffineMapArrayAttr(maps));
+    });
+    return mlir::success();
+  }
+};
+
 struct LinalgOptInnerPass
     : public mlir::PassWrapper<LinalgOptInnerPass, mlir::OperationPass<void>> {
   MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(LinalgOptInnerPass)
@@ -3459,6 +3857,53 @@ static bool defaultControlFusionFn(mlir::OpOperand *fusedOperand) {
   return true;
 }
 
+/// Duplicate cheap elementwise producer for each of its consumers, so
+/// elementwise fusion, which only fuses single-use producers, can fuse it
+/// into all of them.
+struct DuplicateCheapProducer
+    : public mlir::OpRewritePattern<mlir::linalg::GenericOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::linalg::GenericOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    if (!op.hasPureTensorSemantics() || op->getNumResults() != 1 ||
+        op.getNumReductionLoops() != 0)
+      return mlir::failure();
+
+    // Limit recomputation cost.
+    const unsigned maxBodyOps = 4;
+    const unsigned maxConsumers = 4;
+    if (llvm::hasNItemsOrMore(op.getBody()->without_terminator(),
+                              maxBodyOps + 1))
+      return mlir::failure();
+
+    auto result = op->getResult(0);
+    if (result.hasOneUse() ||
+        llvm::hasNItemsOrMore(result.getUses(), maxConsumers + 1))
+      return mlir::failure();
+
+    llvm::SmallVector<mlir::OpOperand *> uses;
+    for (auto &use : result.getUses()) {
+      auto consumer = use.getOwner();
+      if (consumer->getBlock() != op->getBlock() ||
+          !mlir::isa<mlir::linalg::GenericOp>(consumer) ||
+          !mlir::linalg::areElementwiseOpsFusable(&use))
+        return mlir::failure();
+
+      uses.emplace_back(&use);
+    }
+
+    rewriter.setInsertionPoint(op);
+    for (auto use : llvm::ArrayRef(uses).drop_front()) {
+      auto newOp = rewriter.clone(*op);
+      auto newResult = newOp->getResult(0);
+      rewriter.modifyOpInPlace(use->getOwner(), [&]() { use->set(newResult); });
+    }
+    return mlir::success();
+  }
+};
+
 void LinalgOptInnerPass::runOnOperation() {
   auto &context = getContext();
   mlir::RewritePatternSet patterns(&context);
@@ -3471,7 +3916,9 @@ void LinalgOptInnerPass::runOnOperation() {
       LowerEnforceShape,
       GenerateToFill,
       // InsertSliceToPad,
-      SliceOfGeneric
+      SliceOfGeneric,
+      FuseStencilSlices,
+      DuplicateCheapProducer
       // clang-format on
       >(&context);
 
@@ -3694,6 +4141,50 @@ struct FuseAdjacentGenericsPass
     if (mlir::failed(mlir::applyPatternsAndFoldGreedily(getOperation(),
                                                         std::move(patterns))))
       return signalPassFailure();
+
+    // Report generics, sharing an operand with the preceding one, which were
+    // left unfused. Checks are the same as in `FuseAdjacentGenerics`.
+    mlir::DominanceInfo dom;
+    getOperation()->walk([&](mlir::linalg::GenericOp op) {
+      for (auto arg : op->getOperands()) {
+        for (auto user : arg.getUsers()) {
+          auto other = mlir::dyn_cast<mlir::linalg::GenericOp>(user);
+          if (!other || other == op || other->getBlock() != op->getBlock() ||
+              !op->isBeforeInBlock(other))
+            continue;
+
+          auto reason = [&]() -> llvm::StringRef {
+            if (!op.hasPureTensorSemantics() ||
+                !other.hasPureTensorSemantics())
+              return "operates on memrefs";
+
+            if (other.getIteratorTypes() != op.getIteratorTypes())
+              return "different iteration space";
+
+            for (auto otherArg : other->getOperands())
+              if (!dom.properlyDominates(otherArg, op))
+                return "operands are defined in between";
+
+            for (auto &&[otherArg, otherMap] :
+                 llvm::zip(other->getOperands(), other.getIndexingMaps()))
+              for (auto &&[opArg, opMap] :
+                   llvm::zip(op->getOperands(), op.getIndexingMaps()))
+                if (opArg == otherArg && opMap == otherMap)
+                  return "";
+
+            return "different indexing maps";
+          }();
+
+          // All the checks passed, nothing to report.
+          if (reason.empty())
+            continue;
+
+          other.emitRemark("Generic is not fused with the preceding one, "
+                           "sharing the same array: ")
+              << reason;
+        }
+      }
+    });
   }
 };
 
@@ -4387,81 +4878,411 @@ struct LowerCopyOpsPass
     : public numba::RewriteWrapperPass<LowerCopyOpsPass, void, void,
                                        ReplaceMemrefCopy> {};
 
-struct PostLinalgOptInnerPass
-    : public mlir::PassWrapper<PostLinalgOptInnerPass,
-                               mlir::OperationPass<mlir::func::FuncOp>> {
-  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(PostLinalgOptInnerPass)
-
-  void runOnOperation() override;
-};
-
-void PostLinalgOptInnerPass::runOnOperation() {
-  auto func = getOperation();
-  auto optLevel = getOptLevel(func);
-  if (0 == optLevel)
-    return;
-
-  auto &context = getContext();
-  mlir::RewritePatternSet patterns(&context);
+/// Static zero fills smaller than this are kept as is, allocator doesn't
+/// return lazily zeroed pages for them and stored zeros stay visible to the
+/// later optimizations.
+static constexpr int64_t ZeroInitMinSize = 128 * 1024;
 
-  numba::populateCommonOptsPatterns(patterns);
+/// Returns element size in bytes, if element type is supported by the runtime
+/// fill.
+static std::optional<int64_t> getFillElemSize(mlir::Type type) {
+  if (!type.isIntOrFloat())
+    return std::nullopt;
 
-  patterns.insert<OptimizeGlobalsConstsLoad, OptimizeSingleElemCopy,
-                  OptimizeIdentityLayoutStrides>(&context);
+  auto width = type.getIntOrFloatBitWidth();
+  if (width != 8 && width != 16 && width != 32 && width != 64)
+    return std::nullopt;
 
-  auto additionalOpt = [](mlir::func::FuncOp op) {
-    auto check = [](mlir::Operation &op) -> bool {
-      return mlir::isa<mlir::scf::ParallelOp, numba::util::EnvironmentRegionOp>(
-          op);
-    };
-    (void)numba::prepareForFusion(op.getRegion(), check);
-    return numba::naivelyFuseParallelOps(op.getRegion());
-  };
+  return width / 8;
+}
 
-  if (mlir::failed(applyOptimizations(func, std::move(patterns),
-                                      getAnalysisManager(), additionalOpt)))
-    signalPassFailure();
+static bool isParallelFunc(mlir::func::FuncOp func) {
+  auto mc = func->getAttrOfType<mlir::IntegerAttr>(
+      numba::util::attributes::getMaxConcurrencyName());
+  return mc && mc.getInt() > 1;
 }
 
-struct MoveTrivialIntoRegionPass
-    : public mlir::PassWrapper<MoveTrivialIntoRegionPass,
-                               mlir::OperationPass<void>> {
-  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(MoveTrivialIntoRegionPass)
+/// Array creation ops initialize the fresh allocation with `linalg.fill`.
+/// Zero fills are replaced with `numba_util.zero_init`, so allocator can
+/// return zeroed memory. Large fills in non-parallel functions are done by
+/// the runtime in parallel, parallel functions already run fill loops via
+/// TBB.
+struct LowerInitFillsPass
+    : public mlir::PassWrapper<LowerInitFillsPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(LowerInitFillsPass)
 
   virtual void
   getDependentDialects(mlir::DialectRegistry &registry) const override {
     registry.insert<mlir::arith::ArithDialect>();
-    registry.insert<mlir::math::MathDialect>();
+    registry.insert<mlir::func::FuncDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
     registry.insert<numba::util::NumbaUtilDialect>();
   }
 
   void runOnOperation() override {
-    auto root = getOperation();
+    auto mod = getOperation();
+    bool zeroInit = zeroInitAllocEnabled;
+    int64_t threshold = static_cast<int64_t>(parallelFillThreshold.load());
 
-    auto checkOp = [](mlir::Operation *op) -> bool {
-      if (op->hasTrait<mlir::OpTrait::IsTerminator>() || !mlir::isPure(op) ||
-          !op->getRegions().empty())
-        return false;
+    llvm::SmallVector<mlir::linalg::FillOp> zeroFills;
+    llvm::SmallVector<std::pair<mlir::linalg::FillOp, int64_t>> parallelFills;
+    mod.walk([&](mlir::linalg::FillOp op) {
+      if (!op.hasPureBufferSemantics())
+        return;
 
-      if (op->hasTrait<mlir::OpTrait::ConstantLike>())
-        return false;
+      auto dst = op.getOutputs().front();
+      auto alloc = dst.getDefiningOp<mlir::memref::AllocOp>();
+      if (!alloc || !numba::isCPULoop(op) || !numba::isFirstAllocUse(alloc, op))
+        return;
 
-      if (mlir::isa<mlir::ViewLikeOpInterface>(op))
-        return true;
+      auto type = alloc.getType();
+      if (!type.getLayout().isIdentity() || type.getMemorySpace())
+        return;
 
-      auto dialect = op->getDialect();
-      if (mlir::isa<mlir::arith::ArithDialect, mlir::math::MathDialect,
-                    numba::util::NumbaUtilDialect>(dialect))
-        return true;
+      auto elemSize = getFillElemSize(type.getElementType());
+      if (!elemSize)
+        return;
 
-      return false;
-    };
+      std::optional<int64_t> size;
+      if (type.hasStaticShape())
+        size = type.getNumElements() * *elemSize;
 
-    llvm::SmallVector<mlir::Operation *> opsToCheck;
-    root->walk([&](mlir::Operation *op) {
-      if (checkOp(op))
-        opsToCheck.emplace_back(op);
-    });
+      auto value = op.getInputs().front();
+      if (zeroInit && (mlir::matchPattern(value, mlir::m_Zero()) ||
+                       mlir::matchPattern(value, mlir::m_PosZeroFloat()))) {
+        if (!size || *size >= ZeroInitMinSize)
+          zeroFills.emplace_back(op);
+
+        return;
+      }
+
+      if (threshold == 0 || (size && *size < threshold))
+        return;
+
+      auto func = op->getParentOfType<mlir::func::FuncOp>();
+      if (!func || isParallelFunc(func))
+        return;
+
+      parallelFills.emplace_back(op, *elemSize);
+    });
+
+    if (zeroFills.empty() && parallelFills.empty())
+      return markAllAnalysesPreserved();
+
+    mlir::OpBuilder builder(&getContext());
+    for (auto op : zeroFills) {
+      builder.setInsertionPoint(op);
+      builder.create<numba::util::ZeroInitOp>(op.getLoc(),
+                                              op.getOutputs().front());
+      op->erase();
+    }
+
+    if (parallelFills.empty())
+      return;
+
+    auto indexType = builder.getIndexType();
+    auto i64 = builder.getI64Type();
+    auto fillFunc = [&]() {
+      llvm::StringRef name = "nmrtParallelFill";
+      if (auto func = mod.lookupSymbol<mlir::func::FuncOp>(name))
+        return func;
+
+      // data, count, value, elem size
+      auto type =
+          builder.getFunctionType({indexType, indexType, i64, i64}, {});
+      return numba::addFunction(builder, mod, name, type);
+    }();
+
+    for (auto &&[op, elemSize] : parallelFills) {
+      builder.setInsertionPoint(op);
+      auto loc = op.getLoc();
+      auto dst = op.getOutputs().front();
+      auto rank = static_cast<unsigned>(
+          mlir::cast<mlir::MemRefType>(dst.getType()).getRank());
+      mlir::Value count = builder.create<mlir::arith::ConstantIndexOp>(loc, 1);
+      for (auto i : llvm::seq(0u, rank)) {
+        auto dim = builder.createOrFold<mlir::memref::DimOp>(loc, dst, i);
+        count = builder.createOrFold<mlir::arith::MulIOp>(loc, count, dim);
+      }
+
+      // Runtime stores low `elemSize` bytes of the value.
+      mlir::Value value = op.getInputs().front();
+      auto bits = static_cast<unsigned>(elemSize * 8);
+      auto intType = builder.getIntegerType(bits);
+      if (mlir::isa<mlir::FloatType>(value.getType()))
+        value = builder.create<mlir::arith::BitcastOp>(loc, intType, value);
+
+      if (bits != 64)
+        value = builder.create<mlir::arith::ExtUIOp>(loc, i64, value);
+
+      auto createCall = [&](mlir::OpBuilder &b, mlir::Location l) {
+        mlir::Value data =
+            b.create<mlir::memref::ExtractAlignedPointerAsIndexOp>(l, dst);
+        auto size = b.create<mlir::arith::ConstantIntOp>(l, elemSize, i64);
+        b.create<mlir::func::CallOp>(
+            l, fillFunc, mlir::ValueRange{data, count, value, size});
+      };
+
+      if (mlir::cast<mlir::MemRefType>(dst.getType()).hasStaticShape()) {
+        createCall(builder, loc);
+        op->erase();
+        continue;
+      }
+
+      // Smaller dynamic arrays are filled inline.
+      auto minCount = builder.create<mlir::arith::ConstantIndexOp>(
+          loc, llvm::divideCeil(threshold, elemSize));
+      auto cond = builder.create<mlir::arith::CmpIOp>(
+          loc, mlir::arith::CmpIPredicate::uge, count, minCount);
+      auto thenBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+        createCall(b, l);
+        b.create<mlir::scf::YieldOp>(l);
+      };
+      auto elseBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+        b.clone(*op);
+        b.create<mlir::scf::YieldOp>(l);
+      };
+      builder.create<mlir::scf::IfOp>(loc, cond, thenBuilder, elseBuilder);
+      op->erase();
+    }
+  }
+};
+
+/// Checks if `iv` is used in `expr` of the `map` with `operands`.
+static bool isFunctionOf(mlir::AffineMap map, mlir::ValueRange operands,
+                         mlir::AffineExpr expr, mlir::Value iv) {
+  for (auto &&[i, operand] : llvm::enumerate(operands)) {
+    if (operand != iv)
+      continue;
+
+    auto pos = static_cast<unsigned>(i);
+    auto numDims = map.getNumDims();
+    if (pos < numDims ? expr.isFunctionOfDim(pos)
+                      : expr.isFunctionOfSymbol(pos - numDims))
+      return true;
+  }
+  return false;
+}
+
+/// Returns positive value if more memory accesses in innermost loop are
+/// contiguous over loop induction variable than over outer one.
+static int getInnerContiguityScore(mlir::affine::AffineForOp outer,
+                                   mlir::affine::AffineForOp inner) {
+  auto outerIv = outer.getInductionVar();
+  auto innerIv = inner.getInductionVar();
+  int score = 0;
+  auto visitAccess = [&](mlir::AffineMap map, mlir::ValueRange operands) {
+    if (map.getNumResults() == 0)
+      return;
+
+    auto expr = map.getResults().back();
+    if (isFunctionOf(map, operands, expr, innerIv)) {
+      ++score;
+    } else if (isFunctionOf(map, operands, expr, outerIv)) {
+      --score;
+    }
+  };
+  inner.getBody()->walk([&](mlir::Operation *op) {
+    if (auto read = mlir::dyn_cast<mlir::affine::AffineReadOpInterface>(op))
+      visitAccess(read.getAffineMap(), read.getMapOperands());
+
+    if (auto write = mlir::dyn_cast<mlir::affine::AffineWriteOpInterface>(op))
+      visitAccess(write.getAffineMap(), write.getMapOperands());
+  });
+  return score;
+}
+
+/// Interchange innermost rectangular loop pairs, so innermost loop iterates
+/// over contiguous memory.
+struct AffineLoopInterchangePass
+    : public mlir::PassWrapper<AffineLoopInterchangePass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(AffineLoopInterchangePass)
+
+  void runOnOperation() override {
+    llvm::SmallVector<std::pair<mlir::affine::AffineForOp,
+                                mlir::affine::AffineForOp>>
+        candidates;
+    getOperation()->walk([&](mlir::affine::AffineForOp inner) {
+      auto outer = inner->getParentOfType<mlir::affine::AffineForOp>();
+      if (!outer || inner->getParentOp() != outer ||
+          !llvm::hasNItems(outer.getBody()->getOperations(), 2))
+        return;
+
+      if (outer.getNumIterOperands() != 0 || inner.getNumIterOperands() != 0)
+        return;
+
+      if (inner.getBody()
+              ->walk([](mlir::affine::AffineForOp) {
+                return mlir::WalkResult::interrupt();
+              })
+              .wasInterrupted())
+        return;
+
+      auto outerIv = outer.getInductionVar();
+      if (llvm::is_contained(inner.getLowerBoundOperands(), outerIv) ||
+          llvm::is_contained(inner.getUpperBoundOperands(), outerIv))
+        return;
+
+      candidates.emplace_back(outer, inner);
+    });
+
+    bool changed = false;
+    for (auto &&[outer, inner] : candidates) {
+      if (getInnerContiguityScore(outer, inner) >= 0)
+        continue;
+
+      const unsigned perm[] = {1, 0};
+      if (!mlir::affine::isValidLoopInterchangePermutation({outer, inner},
+                                                           perm))
+        continue;
+
+      mlir::affine::interchangeLoops(outer, inner);
+      changed = true;
+    }
+
+    if (!changed)
+      markAllAnalysesPreserved();
+  }
+};
+
+/// Optional polyhedral stage for the functions marked with affine opt
+/// attribute. Loop nests are raised to affine.for, optimized and lowered back
+/// to scf, with parallel loops recovered by affine-parallelize. Nests, which
+/// can't be raised, are left untouched.
+struct AffineOptPass
+    : public mlir::PassWrapper<AffineOptPass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(AffineOptPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::affine::AffineDialect>();
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    if (!func->hasAttr(numba::util::attributes::getAffineOptName()))
+      return markAllAnalysesPreserved();
+
+    mlir::OpPassManager pm(func->getName());
+    pm.addPass(mlir::createSCFToAffineForPass());
+    pm.addPass(std::make_unique<AffineLoopInterchangePass>());
+    pm.addPass(mlir::affine::createLoopFusionPass());
+    pm.addPass(mlir::affine::createLoopTilingPass());
+    pm.addPass(mlir::affine::createAffineScalarReplacementPass());
+    pm.addPass(mlir::affine::createAffineParallelizePass());
+    pm.addPass(mlir::createLowerAffinePass());
+    pm.addPass(mlir::createCanonicalizerPass());
+    if (mlir::failed(runPipeline(pm, func)))
+      return signalPassFailure();
+  }
+};
+
+/// Software prefetch, enabled by the function attribute.
+struct SoftwarePrefetchPass
+    : public mlir::PassWrapper<SoftwarePrefetchPass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(SoftwarePrefetchPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+  }
+
+  void runOnOperation() override {
+    auto func = getOperation();
+    if (!func->hasAttr(numba::util::attributes::getPrefetchName()))
+      return markAllAnalysesPreserved();
+
+    mlir::OpPassManager pm(func->getName());
+    pm.addPass(numba::createSoftwarePrefetchPass());
+    if (mlir::failed(runPipeline(pm, func)))
+      return signalPassFailure();
+  }
+};
+
+struct PostLinalgOptInnerPass
+    : public mlir::PassWrapper<PostLinalgOptInnerPass,
+                               mlir::OperationPass<mlir::func::FuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(PostLinalgOptInnerPass)
+
+  void runOnOperation() override;
+};
+
+void PostLinalgOptInnerPass::runOnOperation() {
+  auto func = getOperation();
+  auto optLevel = getOptLevel(func);
+  if (0 == optLevel)
+    return;
+
+  auto &context = getContext();
+  mlir::RewritePatternSet patterns(&context);
+
+  numba::populateCommonOptsPatterns(patterns);
+
+  patterns.insert<OptimizeGlobalsConstsLoad, OptimizeSingleElemCopy,
+                  OptimizeIdentityLayoutStrides>(&context);
+
+  auto additionalOpt = [](mlir::func::FuncOp op) {
+    auto check = [](mlir::Operation &op) -> bool {
+      return mlir::isa<mlir::scf::ParallelOp, numba::util::EnvironmentRegionOp>(
+          op);
+    };
+    (void)numba::prepareForFusion(op.getRegion(), check);
+    return numba::naivelyFuseParallelOps(op.getRegion());
+  };
+
+  if (mlir::failed(applyOptimizations(func, std::move(patterns),
+                                      getAnalysisManager(), additionalOpt)))
+    signalPassFailure();
+}
+
+struct MoveTrivialIntoRegionPass
+    : public mlir::PassWrapper<MoveTrivialIntoRegionPass,
+                               mlir::OperationPass<void>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(MoveTrivialIntoRegionPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::math::MathDialect>();
+    registry.insert<numba::util::NumbaUtilDialect>();
+  }
+
+  void runOnOperation() override {
+    auto root = getOperation();
+
+    auto checkOp = [](mlir::Operation *op) -> bool {
+      if (op->hasTrait<mlir::OpTrait::IsTerminator>() || !mlir::isPure(op) ||
+          !op->getRegions().empty())
+        return false;
+
+      if (op->hasTrait<mlir::OpTrait::ConstantLike>())
+        return false;
+
+      if (mlir::isa<mlir::ViewLikeOpInterface>(op))
+        return true;
+
+      auto dialect = op->getDialect();
+      if (mlir::isa<mlir::arith::ArithDialect, mlir::math::MathDialect,
+                    numba::util::NumbaUtilDialect>(dialect))
+        return true;
+
+      return false;
+    };
+
+    llvm::SmallVector<mlir::Operation *> opsToCheck;
+    root->walk([&](mlir::Operation *op) {
+      if (checkOp(op))
+        opsToCheck.emplace_back(op);
+    });
 
     for (auto *op : llvm::reverse(opsToCheck)) {
       assert(op);
@@ -4492,6 +5313,11 @@ struct MoveTrivialIntoRegionPass
   }
 };
 
+/// Outer-axis reduction tiles, reductions are kept outside of the contiguous
+/// parallel loop.
+static const constexpr llvm::StringLiteral
+    kOuterReduction("numba_outer_reduction");
+
 /// Move reduction iterators to the right to help later reduction simplification
 /// passes.
 struct MakeGenericReduceInnermost
@@ -4501,6 +5327,9 @@ struct MakeGenericReduceInnermost
   mlir::LogicalResult
   matchAndRewrite(mlir::linalg::GenericOp op,
                   mlir::PatternRewriter &rewriter) const override {
+    if (op->hasAttr(kOuterReduction))
+      return mlir::failure();
+
     auto iters = op.getIteratorTypesArray();
 
     auto numDims = static_cast<unsigned>(iters.size());
@@ -4562,6 +5391,377 @@ struct MakeGenericReduceInnermostPass
     : public numba::RewriteWrapperPass<MakeGenericReduceInnermostPass, void,
                                        void, MakeGenericReduceInnermost> {};
 
+/// Reorders generic loops, `order[i]` is the old loop, placed at position `i`.
+static void permuteGenericLoops(mlir::linalg::GenericOp op,
+                                llvm::ArrayRef<unsigned> order) {
+  auto ctx = op.getContext();
+  auto iters = op.getIteratorTypesArray();
+  auto numDims = static_cast<unsigned>(iters.size());
+  assert(order.size() == numDims);
+
+  llvm::SmallVector<mlir::Attribute> newIters;
+  llvm::SmallVector<mlir::AffineExpr> remappedDims(numDims);
+  llvm::SmallVector<unsigned> newPos(numDims);
+  for (auto &&[i, dim] : llvm::enumerate(order)) {
+    newIters.emplace_back(mlir::linalg::IteratorTypeAttr::get(ctx, iters[dim]));
+    remappedDims[dim] = mlir::getAffineDimExpr(i, ctx);
+    newPos[dim] = i;
+  }
+
+  llvm::SmallVector<mlir::Attribute> newMaps;
+  for (auto map : op.getIndexingMapsArray()) {
+    auto newMap =
+        map.replaceDimsAndSymbols(remappedDims, std::nullopt, numDims, 0);
+    newMaps.emplace_back(mlir::AffineMapAttr::get(newMap));
+  }
+
+  mlir::Builder builder(ctx);
+  op.setIndexingMapsAttr(builder.getArrayAttr(newMaps));
+  op.setIteratorTypesAttr(builder.getArrayAttr(newIters));
+  op.getRegion().walk([&](mlir::linalg::IndexOp index) {
+    index.setDim(newPos[index.getDim()]);
+  });
+}
+
+/// Returns loop dim, accessed by `expr`, either `d` or `d + const`.
+static std::optional<unsigned> getAccessDim(mlir::AffineExpr expr) {
+  if (auto bin = mlir::dyn_cast<mlir::AffineBinaryOpExpr>(expr)) {
+    if (bin.getKind() != mlir::AffineExprKind::Add ||
+        !mlir::isa<mlir::AffineConstantExpr>(bin.getRHS()))
+      return std::nullopt;
+
+    expr = bin.getLHS();
+  }
+
+  if (auto dim = mlir::dyn_cast<mlir::AffineDimExpr>(expr))
+    return dim.getPosition();
+
+  return std::nullopt;
+}
+
+/// Interchange parallel loops of CPU generics on buffers, so loops with the
+/// smallest memory strides are innermost (e.g. for Fortran-ordered or
+/// transposed arrays). Static strides from layouts, set by
+/// `FinalizeStridedLayoutPass`, are summed over all accesses of each loop.
+/// If any of the strides is dynamic, the generic is versioned on the strides
+/// of its first output: loops are reversed, if its innermost loop has the
+/// larger stride than outermost one. Must run after
+/// `MakeGenericReduceInnermostPass`, reduction loops are not moved.
+struct InterchangeGenericLoopsPass
+    : public mlir::PassWrapper<InterchangeGenericLoopsPass,
+                               mlir::OperationPass<>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(InterchangeGenericLoopsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::math::MathDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<mlir::linalg::GenericOp> ops;
+    getOperation()->walk([&](mlir::linalg::GenericOp op) {
+      if (op.hasPureBufferSemantics() && numba::isCPULoop(op))
+        ops.emplace_back(op);
+    });
+
+    bool changed = false;
+    for (auto op : ops)
+      changed = interchange(op) || changed;
+
+    if (!changed)
+      return markAllAnalysesPreserved();
+  }
+
+private:
+  static bool interchange(mlir::linalg::GenericOp op) {
+    auto iters = op.getIteratorTypesArray();
+    auto numParallel = static_cast<unsigned>(
+        llvm::count(iters, mlir::utils::IteratorType::parallel));
+    if (numParallel < 2)
+      return false;
+
+    // Expect reductions innermost.
+    if (!llvm::all_of(llvm::ArrayRef(iters).take_front(numParallel),
+                      [](auto it) {
+                        return it == mlir::utils::IteratorType::parallel;
+                      }))
+      return false;
+
+    llvm::SmallVector<int64_t> cost(numParallel, 0);
+    bool dynamic = false;
+    for (auto &operand : op->getOpOperands()) {
+      auto type = mlir::dyn_cast<mlir::MemRefType>(operand.get().getType());
+      if (!type)
+        continue;
+
+      llvm::SmallVector<int64_t> strides;
+      int64_t offset;
+      if (mlir::failed(mlir::getStridesAndOffset(type, strides, offset)))
+        return false;
+
+      auto map = op.getMatchingIndexingMap(&operand);
+      for (auto &&[expr, stride] : llvm::zip(map.getResults(), strides)) {
+        auto dim = getAccessDim(expr);
+        if (!dim || *dim >= numParallel)
+          continue;
+
+        if (mlir::ShapedType::isDynamic(stride)) {
+          dynamic = true;
+          continue;
+        }
+
+        cost[*dim] += std::abs(stride);
+      }
+    }
+
+    auto numDims = static_cast<unsigned>(iters.size());
+    auto order = llvm::to_vector(llvm::seq(0u, numDims));
+    if (dynamic)
+      return versionOnStrides(op, order, numParallel);
+
+    // Largest strides outermost, keep original order for equal costs.
+    std::stable_sort(order.begin(), order.begin() + numParallel,
+                     [&](unsigned lhs, unsigned rhs) {
+                       return cost[lhs] > cost[rhs];
+                     });
+    if (llvm::equal(order, llvm::seq(0u, numDims)))
+      return false;
+
+    permuteGenericLoops(op, order);
+    return true;
+  }
+
+  static bool versionOnStrides(mlir::linalg::GenericOp op,
+                               llvm::SmallVectorImpl<unsigned> &order,
+                               unsigned numParallel) {
+    auto output = op.getDpsInitOperand(0);
+    auto map = op.getMatchingIndexingMap(output);
+    auto findTensorDim = [&](unsigned loop) -> std::optional<unsigned> {
+      for (auto &&[i, expr] : llvm::enumerate(map.getResults()))
+        if (getAccessDim(expr) == loop)
+          return i;
+
+      return std::nullopt;
+    };
+
+    auto outer = findTensorDim(0);
+    auto inner = findTensorDim(numParallel - 1);
+    if (!outer || !inner)
+      return false;
+
+    mlir::OpBuilder builder(op);
+    auto loc = op.getLoc();
+    auto metadata = builder.create<mlir::memref::ExtractStridedMetadataOp>(
+        loc, output->get());
+    auto strides = metadata.getStrides();
+
+    // Strides can be negative for reversed views, compare their magnitudes.
+    auto innerStride =
+        builder.create<mlir::math::AbsIOp>(loc, strides[*inner]);
+    auto outerStride =
+        builder.create<mlir::math::AbsIOp>(loc, strides[*outer]);
+    mlir::Value cond = builder.create<mlir::arith::CmpIOp>(
+        loc, mlir::arith::CmpIPredicate::ugt, innerStride, outerStride);
+
+    std::reverse(order.begin(), order.begin() + numParallel);
+    auto thenBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+      auto newOp = mlir::cast<mlir::linalg::GenericOp>(b.clone(*op));
+      permuteGenericLoops(newOp, order);
+      b.create<mlir::scf::YieldOp>(l);
+    };
+    auto elseBuilder = [&](mlir::OpBuilder &b, mlir::Location l) {
+      b.clone(*op);
+      b.create<mlir::scf::YieldOp>(l);
+    };
+    builder.create<mlir::scf::IfOp>(loc, cond, thenBuilder, elseBuilder);
+    op->erase();
+    return true;
+  }
+};
+
+/// Outer-axis reduction tile size in bytes of the output element.
+static constexpr int64_t OuterReductionTileBytes = 8 * 1024;
+
+/// Minimal iteration space size in bytes of the output element for the
+/// outer-axis reduction to be tiled, smaller reductions are cache resident and
+/// don't benefit from tiling.
+static constexpr int64_t OuterReductionMinBytes = 256 * 1024;
+
+/// Specialize host reductions over the outer axes of the contiguous input
+/// (e.g. `np.sum(a, axis=0)` on C-ordered array). Moving reduction innermost
+/// would walk the input with the large stride, so instead the contiguous
+/// output dim is tiled: tiles (and other parallel dims) are processed in
+/// parallel, and each tile accumulates input rows into the output tile with
+/// the contiguous innermost parallel loop, which is later vectorized.
+/// Inner-axis reductions go through `MakeGenericReduceInnermostPass` and
+/// reduction promotion as before.
+struct TileOuterReductionsPass
+    : public mlir::PassWrapper<TileOuterReductionsPass,
+                               mlir::OperationPass<>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(TileOuterReductionsPass)
+
+  virtual void
+  getDependentDialects(mlir::DialectRegistry &registry) const override {
+    registry.insert<mlir::affine::AffineDialect>();
+    registry.insert<mlir::arith::ArithDialect>();
+    registry.insert<mlir::memref::MemRefDialect>();
+    registry.insert<mlir::scf::SCFDialect>();
+  }
+
+  void runOnOperation() override {
+    llvm::SmallVector<std::pair<mlir::linalg::GenericOp, unsigned>> ops;
+    getOperation()->walk([&](mlir::linalg::GenericOp op) {
+      if (auto dim = getContiguousDim(op))
+        ops.emplace_back(op, *dim);
+    });
+
+    if (ops.empty())
+      return markAllAnalysesPreserved();
+
+    auto ctx = &getContext();
+    mlir::IRRewriter rewriter(ctx);
+    for (auto &&[origOp, contDim] : ops) {
+      auto op = origOp;
+      auto elemType =
+          mlir::getElementTypeOrSelf(op.getDpsInitOperand(0)->get());
+      auto elemBytes =
+          std::max<int64_t>(elemType.getIntOrFloatBitWidth() / 8, 1);
+
+      // Small static reductions are skipped, dynamic ones are versioned on
+      // their size, original op is kept for the small ones.
+      rewriter.setInsertionPoint(op);
+      auto cond = getSizeCheck(rewriter, op, elemBytes);
+      if (!cond)
+        continue;
+
+      if (*cond) {
+        auto loc = op.getLoc();
+        auto ifOp = rewriter.create<mlir::scf::IfOp>(loc, *cond,
+                                                     /*withElseRegion*/ true);
+        rewriter.setInsertionPoint(ifOp.thenBlock()->getTerminator());
+        auto newOp = mlir::cast<mlir::linalg::GenericOp>(rewriter.clone(*op));
+        rewriter.moveOpBefore(op, ifOp.elseBlock()->getTerminator());
+        op = newOp;
+      }
+
+      auto iters = op.getIteratorTypesArray();
+      auto numDims = static_cast<unsigned>(iters.size());
+
+      // Outer parallel loops, reductions, contiguous loop.
+      llvm::SmallVector<unsigned> order;
+      for (auto iterType : {mlir::utils::IteratorType::parallel,
+                            mlir::utils::IteratorType::reduction})
+        for (auto i : llvm::seq(0u, numDims))
+          if (i != contDim && iters[i] == iterType)
+            order.emplace_back(i);
+
+      order.emplace_back(contDim);
+      permuteGenericLoops(op, order);
+
+      llvm::SmallVector<int64_t> tileSizes;
+      for (auto i : llvm::ArrayRef(order).drop_back())
+        tileSizes.emplace_back(
+            iters[i] == mlir::utils::IteratorType::parallel ? 1 : 0);
+
+      tileSizes.emplace_back(OuterReductionTileBytes / elemBytes);
+
+      auto options = mlir::linalg::LinalgTilingOptions()
+                         .setTileSizes(tileSizes)
+                         .setLoopType(mlir::linalg::LinalgTilingLoopType::
+                                          ParallelLoops);
+      rewriter.setInsertionPoint(op);
+      auto tiled = mlir::linalg::tileLinalgOp(rewriter, op, options);
+      if (mlir::failed(tiled)) {
+        // Keep permuted op, `MakeGenericReduceInnermostPass` will restore
+        // the default order.
+        continue;
+      }
+
+      tiled->op->setAttr(kOuterReduction, mlir::UnitAttr::get(ctx));
+      rewriter.eraseOp(op);
+    }
+  }
+
+private:
+  /// Returns null value if iteration space is statically known to be large
+  /// enough, runtime check if it is dynamic, or `std::nullopt` if it is
+  /// statically known to be too small.
+  static std::optional<mlir::Value> getSizeCheck(mlir::OpBuilder &builder,
+                                                 mlir::linalg::GenericOp op,
+                                                 int64_t elemBytes) {
+    auto loc = op.getLoc();
+    int64_t staticSize = elemBytes;
+    llvm::SmallVector<mlir::Value> dynamicSizes;
+    for (auto &range : op.createLoopRanges(builder, loc)) {
+      if (auto size = mlir::getConstantIntValue(range.size)) {
+        staticSize *= *size;
+      } else {
+        dynamicSizes.emplace_back(
+            mlir::getValueOrCreateConstantIndexOp(builder, loc, range.size));
+      }
+    }
+
+    if (dynamicSizes.empty()) {
+      if (staticSize < OuterReductionMinBytes)
+        return std::nullopt;
+
+      return mlir::Value();
+    }
+
+    mlir::Value size =
+        builder.create<mlir::arith::ConstantIndexOp>(loc, staticSize);
+    for (auto dynSize : dynamicSizes)
+      size = builder.create<mlir::arith::MulIOp>(loc, size, dynSize);
+
+    mlir::Value minSize = builder.create<mlir::arith::ConstantIndexOp>(
+        loc, OuterReductionMinBytes);
+    return builder
+        .create<mlir::arith::CmpIOp>(loc, mlir::arith::CmpIPredicate::uge,
+                                     size, minSize)
+        .getResult();
+  }
+
+  /// Returns parallel loop, iterating over the contiguous dim of the first
+  /// input, if op also has reductions.
+  static std::optional<unsigned> getContiguousDim(mlir::linalg::GenericOp op) {
+    if (!op.hasPureBufferSemantics() || !numba::isCPULoop(op) ||
+        op.getNumDpsInputs() < 1 || op.getNumDpsInits() != 1 ||
+        op.getNumReductionLoops() == 0 || op->hasAttr(kOuterReduction))
+      return std::nullopt;
+
+    auto elemType =
+        mlir::getElementTypeOrSelf(op.getDpsInitOperand(0)->get());
+    if (!elemType.isIntOrFloat())
+      return std::nullopt;
+
+    auto input = op.getDpsInputOperand(0);
+    auto inputType = mlir::dyn_cast<mlir::MemRefType>(input->get().getType());
+    if (!inputType || inputType.getRank() < 2)
+      return std::nullopt;
+
+    llvm::SmallVector<int64_t> strides;
+    int64_t offset;
+    if (mlir::failed(mlir::getStridesAndOffset(inputType, strides, offset)) ||
+        strides.back() != 1)
+      return std::nullopt;
+
+    auto inputMap = op.getMatchingIndexingMap(input);
+    auto outputMap = op.getMatchingIndexingMap(op.getDpsInitOperand(0));
+    if (!inputMap.isProjectedPermutation() ||
+        !outputMap.isProjectedPermutation())
+      return std::nullopt;
+
+    auto dim = inputMap.getDimPosition(inputMap.getNumResults() - 1);
+    if (op.getIteratorTypesArray()[dim] != mlir::utils::IteratorType::parallel)
+      return std::nullopt;
+
+    return dim;
+  }
+};
+
 /// Later passes (e.g. buffer deallocation) may not know how to handle poison
 /// memrefs. Replace them with dummy zero-size allocations.
 struct ReplaceMemrefPoison : public mlir::OpRewritePattern<mlir::ub::PoisonOp> {
@@ -4592,6 +5792,143 @@ struct ReplaceMemrefPoisonPass
     : public numba::RewriteWrapperPass<ReplaceMemrefPoisonPass, void, void,
                                        ReplaceMemrefPoison> {};
 
+/// Returns nearest parent `scf.for` or `scf.parallel` loop, null if op is not
+/// inside the loop or if there is other loop in between.
+static mlir::Operation *getRandomParentLoop(mlir::Operation *op) {
+  auto parent = op->getParentOp();
+  while (parent && !mlir::isa<mlir::FunctionOpInterface>(parent)) {
+    if (mlir::isa<mlir::scf::ForOp, mlir::scf::ParallelOp>(parent))
+      return parent;
+
+    if (mlir::isa<mlir::LoopLikeOpInterface>(parent))
+      return nullptr;
+
+    parent = parent->getParentOp();
+  }
+  return nullptr;
+}
+
+/// Returns true if loop resets generator state.
+static bool hasRandomSeed(mlir::Operation *loop) {
+  auto isSeed = [](mlir::func::CallOp call) {
+    if (call.getCallee() == "nmrtRandomSeed")
+      return mlir::WalkResult::interrupt();
+
+    return mlir::WalkResult::advance();
+  };
+  return loop->walk(isSeed).wasInterrupted();
+}
+
+/// `numpy.random` functions reserve generator counters by the
+/// `nmrtRandomAdvance` call. Replace calls with the loop invariant count inside
+/// the loop with a single reservation for the entire loop, done before it, and
+/// derive each iteration counter from the linearized loop index, so results
+/// don't depend on the iterations order and loop bodies don't call runtime.
+struct HoistRandomAdvance : public mlir::OpRewritePattern<mlir::func::CallOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::func::CallOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    if (op.getCallee() != "nmrtRandomAdvance" || op->getNumOperands() != 1 ||
+        op->getNumResults() != 1)
+      return mlir::failure();
+
+    mlir::Value count = op.getOperand(0);
+    auto countType = mlir::dyn_cast<mlir::IntegerType>(count.getType());
+    auto resType = mlir::dyn_cast<mlir::IntegerType>(op.getResult(0).getType());
+    if (!countType || !resType)
+      return mlir::failure();
+
+    auto loop = getRandomParentLoop(op);
+    if (!loop || hasRandomSeed(loop) ||
+        !mlir::cast<mlir::LoopLikeOpInterface>(loop).isDefinedOutsideOfLoop(
+            count))
+      return mlir::failure();
+
+    llvm::SmallVector<mlir::Value> lbs, ubs, steps, ivs;
+    if (auto forOp = mlir::dyn_cast<mlir::scf::ForOp>(loop)) {
+      lbs.emplace_back(forOp.getLowerBound());
+      ubs.emplace_back(forOp.getUpperBound());
+      steps.emplace_back(forOp.getStep());
+      ivs.emplace_back(forOp.getInductionVar());
+    } else {
+      auto parallelOp = mlir::cast<mlir::scf::ParallelOp>(loop);
+      llvm::append_range(lbs, parallelOp.getLowerBound());
+      llvm::append_range(ubs, parallelOp.getUpperBound());
+      llvm::append_range(steps, parallelOp.getStep());
+      llvm::append_range(ivs, parallelOp.getInductionVars());
+    }
+
+    auto isIndex = [](mlir::Value iv) { return iv.getType().isIndex(); };
+    if (!llvm::all_of(ivs, isIndex))
+      return mlir::failure();
+
+    auto loc = op.getLoc();
+    auto toCount = [&](mlir::Value val) -> mlir::Value {
+      return rewriter.create<mlir::arith::IndexCastOp>(loc, countType, val);
+    };
+
+    rewriter.setInsertionPoint(loop);
+    mlir::Value zero = rewriter.create<mlir::arith::ConstantIndexOp>(loc, 0);
+    llvm::SmallVector<mlir::Value> tripCounts;
+    mlir::Value total = count;
+    for (auto &&[lb, ub, step] : llvm::zip(lbs, ubs, steps)) {
+      mlir::Value size = rewriter.create<mlir::arith::SubIOp>(loc, ub, lb);
+      size = rewriter.create<mlir::arith::CeilDivSIOp>(loc, size, step);
+      size = rewriter.create<mlir::arith::MaxSIOp>(loc, size, zero);
+      tripCounts.emplace_back(size);
+      total = rewriter.create<mlir::arith::MulIOp>(loc, total, toCount(size));
+    }
+    auto newCall = rewriter.create<mlir::func::CallOp>(
+        loc, op.getCallee(), op.getResultTypes(), total);
+
+    rewriter.setInsertionPoint(op);
+    mlir::Value linear = zero;
+    for (auto &&[iv, lb, step, tripCount] :
+         llvm::zip(ivs, lbs, steps, tripCounts)) {
+      mlir::Value idx = rewriter.create<mlir::arith::SubIOp>(loc, iv, lb);
+      idx = rewriter.create<mlir::arith::DivUIOp>(loc, idx, step);
+      linear = rewriter.create<mlir::arith::MulIOp>(loc, linear, tripCount);
+      linear = rewriter.create<mlir::arith::AddIOp>(loc, linear, idx);
+    }
+
+    mlir::Value offset =
+        rewriter.create<mlir::arith::MulIOp>(loc, toCount(linear), count);
+    if (countType != resType)
+      offset = rewriter.create<mlir::arith::ExtUIOp>(loc, resType, offset);
+
+    mlir::Value res = rewriter.create<mlir::arith::AddIOp>(
+        loc, newCall.getResult(0), offset);
+    rewriter.replaceOp(op, res);
+    return mlir::success();
+  }
+};
+
+/// Generator key only changes by `nmrtRandomSeed`, move key queries out of the
+/// loops, which don't reseed.
+struct HoistRandomKey : public mlir::OpRewritePattern<mlir::func::CallOp> {
+  using OpRewritePattern::OpRewritePattern;
+
+  mlir::LogicalResult
+  matchAndRewrite(mlir::func::CallOp op,
+                  mlir::PatternRewriter &rewriter) const override {
+    if (op.getCallee() != "nmrtRandomKey" || op->getNumOperands() != 0)
+      return mlir::failure();
+
+    auto loop = getRandomParentLoop(op);
+    if (!loop || hasRandomSeed(loop))
+      return mlir::failure();
+
+    rewriter.modifyOpInPlace(op, [&]() { op->moveBefore(loop); });
+    return mlir::success();
+  }
+};
+
+struct HoistRandomCallsPass
+    : public numba::RewriteWrapperPass<HoistRandomCallsPass, void, void,
+                                       HoistRandomAdvance, HoistRandomKey> {};
+
 struct InsertParallelRegionPass
     : public mlir::PassWrapper<InsertParallelRegionPass,
                                mlir::OperationPass<void>> {
@@ -4627,6 +5964,15 @@ struct InsertParallelRegionPass
     if (loops.empty())
       return markAllAnalysesPreserved();
 
+    // Launch hints, passed as sequences, have a value per prange loop in the
+    // source order, they are attached to the loops regions and take precedence
+    // over the function-wide ones.
+    const mlir::StringRef loopHints[] = {
+        numba::util::attributes::getCudaThreadsPerBlockName(),
+        numba::util::attributes::getCudaOccupancyLaunchName(),
+    };
+    llvm::SmallDenseMap<mlir::Operation *, unsigned> loopIndices;
+
     auto *ctx = &getContext();
     auto env = numba::util::ParallelAttr::get(ctx);
     mlir::OpBuilder builder(ctx);
@@ -4635,6 +5981,15 @@ struct InsertParallelRegionPass
       builder.setInsertionPoint(loop);
       auto region = builder.create<numba::util::EnvironmentRegionOp>(
           loc, env, /*args*/ std::nullopt, loop->getResultTypes());
+      if (auto func = loop->getParentOfType<mlir::func::FuncOp>()) {
+        auto index = loopIndices[func]++;
+        for (auto name : loopHints) {
+          auto hints = func->getAttrOfType<mlir::ArrayAttr>(name);
+          if (hints && index < hints.size() &&
+              !mlir::isa<mlir::UnitAttr>(hints[index]))
+            region->setAttr(name, hints[index]);
+        }
+      }
       mlir::Block &body = region.getRegion().front();
       body.getTerminator()->erase();
       loop.getResults().replaceAllUsesWith(region.getResults());
@@ -4707,6 +6062,8 @@ static void populateDeallocationPipeline(mlir::OpPassManager &pm) {
   pm.addNestedPass<mlir::func::FuncOp>(
       std::make_unique<EnforceUniqueResultsOwnershipPass>());
   pm.addNestedPass<mlir::func::FuncOp>(std::make_unique<LowerCloneOpsPass>());
+  pm.addNestedPass<mlir::func::FuncOp>(
+      numba::createOptimizeAllocsPass(stackAllocMaxSize.load()));
   pm.addNestedPass<mlir::func::FuncOp>(std::make_unique<GenerateAllocTokens>());
   pm.addPass(numba::createCompositePass(
       "PostDeallocCleanups", [](mlir::OpPassManager &p) {
@@ -4735,11 +6092,16 @@ static void populatePlierToLinalgGenPipeline(mlir::OpPassManager &pm) {
   pm.addPass(numba::ntensor::createPropagateEnvironmentPass());
   pm.addPass(std::make_unique<ResolveNtensorPass>());
   pm.addPass(numba::createForceInlinePass());
+  pm.addPass(numba::createCostModelInlinePass());
   pm.addPass(mlir::createSymbolDCEPass());
   populateCommonOptPass(pm);
+  pm.addNestedPass<mlir::func::FuncOp>(
+      numba::ntensor::createHoistArrayOpsPass());
   pm.addNestedPass<mlir::func::FuncOp>(
       std::make_unique<WrapParforRegionsPass>());
   pm.addPass(mlir::createCanonicalizerPass());
+  pm.addNestedPass<mlir::func::FuncOp>(
+      numba::ntensor::createFuseElementwisePass());
   pm.addNestedPass<mlir::func::FuncOp>(numba::createNtensorAliasAnalysisPass());
   pm.addNestedPass<mlir::func::FuncOp>(numba::createNtensorToLinalgPass());
   pm.addNestedPass<mlir::func::FuncOp>(
@@ -4747,26 +6109,40 @@ static void populatePlierToLinalgGenPipeline(mlir::OpPassManager &pm) {
   pm.addNestedPass<mlir::func::FuncOp>(numba::createCopyRemovalPass());
   pm.addPass(std::make_unique<MarkInputShapesRanges>());
   pm.addPass(numba::createCompositePass(
-      "PostPlierToLinalgPass", [](mlir::OpPassManager &p) {
-        p.addPass(numba::createShapeIntegerRangePropagationPass());
-        p.addNestedPass<mlir::func::FuncOp>(mlir::createCSEPass());
-        p.addNestedPass<mlir::func::FuncOp>(
-            std::make_unique<PostPlierToLinalgInnerPass>());
+      "PostPlierToLinalgPass",
+      {
+          [](mlir::OpPassManager &p) {
+            p.addPass(numba::createShapeIntegerRangePropagationPass());
+          },
+          [](mlir::OpPassManager &p) {
+            p.addNestedPass<mlir::func::FuncOp>(mlir::createCSEPass());
+            p.addNestedPass<mlir::func::FuncOp>(
+                std::make_unique<PostPlierToLinalgInnerPass>());
+          },
       }));
 }
 
 static void populatePlierToLinalgOptPipeline(mlir::OpPassManager &pm) {
-  pm.addPass(
-      numba::createCompositePass("LinalgOptPass", [](mlir::OpPassManager &p) {
-        p.addPass(numba::createShapeIntegerRangePropagationPass());
-        p.addNestedPass<mlir::func::FuncOp>(mlir::createCSEPass());
-        p.addNestedPass<mlir::func::FuncOp>(
-            std::make_unique<MixedGenericsAliasAnalysis>());
-        p.addNestedPass<mlir::func::FuncOp>(
-            std::make_unique<LinalgOptInnerPass>());
-        p.addNestedPass<mlir::func::FuncOp>(
-            std::make_unique<FuseAdjacentGenericsPass>());
-        p.addPass(numba::createRemoveUnusedArgsPass());
+  pm.addPass(numba::createCompositePass(
+      "LinalgOptPass",
+      {
+          [](mlir::OpPassManager &p) {
+            p.addPass(numba::createShapeIntegerRangePropagationPass());
+          },
+          [](mlir::OpPassManager &p) {
+            p.addNestedPass<mlir::func::FuncOp>(mlir::createCSEPass());
+            p.addNestedPass<mlir::func::FuncOp>(
+                std::make_unique<MixedGenericsAliasAnalysis>());
+            p.addNestedPass<mlir::func::FuncOp>(
+                std::make_unique<LinalgOptInnerPass>());
+          },
+          [](mlir::OpPassManager &p) {
+            p.addNestedPass<mlir::func::FuncOp>(
+                std::make_unique<FuseAdjacentGenericsPass>());
+          },
+          [](mlir::OpPassManager &p) {
+            p.addPass(numba::createRemoveUnusedArgsPass());
+          },
       }));
 
   pm.addPass(numba::createNtensorToMemrefPass());
@@ -4797,11 +6173,6 @@ static void populatePlierToLinalgOptPipeline(mlir::OpPassManager &pm) {
 
   pm.addPass(mlir::createCanonicalizerPass());
 
-  //  pm.addNestedPass<mlir::func::FuncOp>(
-  //      mlir::bufferization::createBufferHoistingPass());
-  //  pm.addNestedPass<mlir::func::FuncOp>(
-  //      mlir::bufferization::createBufferLoopHoistingPass());
-
   pm.addPass(std::make_unique<MakeStridedLayoutPass>());
   pm.addPass(std::make_unique<OptimizeStridedLayoutPass>());
   pm.addNestedPass<mlir::func::FuncOp>(
@@ -4809,24 +6180,31 @@ static void populatePlierToLinalgOptPipeline(mlir::OpPassManager &pm) {
 
   pm.addNestedPass<mlir::func::FuncOp>(mlir::createCanonicalizerPass());
 
-  //  pm.addNestedPass<mlir::func::FuncOp>(
-  //      mlir::bufferization::createPromoteBuffersToStackPass());
-
+  pm.addNestedPass<mlir::func::FuncOp>(
+      std::make_unique<TileOuterReductionsPass>());
   pm.addNestedPass<mlir::func::FuncOp>(
       std::make_unique<MakeGenericReduceInnermostPass>());
+  pm.addNestedPass<mlir::func::FuncOp>(
+      std::make_unique<InterchangeGenericLoopsPass>());
   pm.addNestedPass<mlir::func::FuncOp>(std::make_unique<LowerCopyOpsPass>());
   pm.addNestedPass<mlir::func::FuncOp>(numba::createCopyRemovalPass());
+  pm.addNestedPass<mlir::func::FuncOp>(numba::createReuseBuffersPass());
+  pm.addPass(std::make_unique<LowerInitFillsPass>());
   pm.addNestedPass<mlir::func::FuncOp>(
       mlir::createConvertLinalgToParallelLoopsPass());
   pm.addNestedPass<mlir::func::FuncOp>(
       std::make_unique<ReplaceMemrefPoisonPass>());
   pm.addNestedPass<mlir::func::FuncOp>(mlir::createCanonicalizerPass());
+  pm.addNestedPass<mlir::func::FuncOp>(std::make_unique<AffineOptPass>());
 
   pm.addPass(numba::createForceInlinePass());
+  pm.addPass(numba::createCostModelInlinePass());
   pm.addPass(mlir::createSymbolDCEPass());
 
   pm.addPass(numba::createPromoteBoolMemrefPass());
   pm.addNestedPass<mlir::func::FuncOp>(numba::createUpliftMathPass());
+  pm.addNestedPass<mlir::func::FuncOp>(
+      std::make_unique<HoistRandomCallsPass>());
   pm.addNestedPass<mlir::func::FuncOp>(mlir::createCanonicalizerPass());
   pm.addNestedPass<mlir::func::FuncOp>(
       mlir::createLoopInvariantCodeMotionPass());
@@ -4836,34 +6214,65 @@ static void populatePlierToLinalgOptPipeline(mlir::OpPassManager &pm) {
   pm.addNestedPass<mlir::func::FuncOp>(
       std::make_unique<PropagateFastmathFlags>());
   pm.addPass(numba::createCompositePass(
-      "PostLinalgOptPass", [](mlir::OpPassManager &p) {
-        p.addPass(numba::createNormalizeMemrefArgsPass());
-        p.addNestedPass<mlir::func::FuncOp>(
-            std::make_unique<GenAtomicOpsPass>());
-        p.addNestedPass<mlir::func::FuncOp>(
-            std::make_unique<CleanupRegionsPass>());
-        p.addNestedPass<mlir::func::FuncOp>(
-            std::make_unique<MoveTrivialIntoRegionPass>());
-        p.addNestedPass<mlir::func::FuncOp>(mlir::createCSEPass());
-        p.addNestedPass<mlir::func::FuncOp>(
-            numba::createCanonicalizeReductionsPass());
-        p.addNestedPass<mlir::func::FuncOp>(
-            numba::createPromoteToParallelPass());
-        p.addNestedPass<mlir::func::FuncOp>(
-            numba::createMoveIntoParallelPass());
-        // ToDo: This pass also tries to do some simple fusion, whic should be
-        // split in separate pass
-        p.addPass(mlir::createParallelLoopFusionPass());
-        p.addNestedPass<mlir::func::FuncOp>(
-            std::make_unique<PostLinalgOptInnerPass>());
-        p.addPass(std::make_unique<RemoveConstantStoresPass>());
-        p.addPass(numba::createRemoveUnusedArgsPass());
+      "PostLinalgOptPass",
+      {
+          [](mlir::OpPassManager &p) {
+            p.addPass(numba::createNormalizeMemrefArgsPass());
+          },
+          [](mlir::OpPassManager &p) {
+            p.addNestedPass<mlir::func::FuncOp>(
+                std::make_unique<GenAtomicOpsPass>());
+            p.addNestedPass<mlir::func::FuncOp>(
+                std::make_unique<CleanupRegionsPass>());
+            p.addNestedPass<mlir::func::FuncOp>(
+                std::make_unique<MoveTrivialIntoRegionPass>());
+            p.addNestedPass<mlir::func::FuncOp>(mlir::createCSEPass());
+          },
+          [](mlir::OpPassManager &p) {
+            p.addNestedPass<mlir::func::FuncOp>(
+                numba::createCanonicalizeReductionsPass());
+            p.addNestedPass<mlir::func::FuncOp>(
+                numba::createPromoteToParallelPass());
+            p.addNestedPass<mlir::func::FuncOp>(
+                numba::createMoveIntoParallelPass());
+            // ToDo: This pass also tries to do some simple fusion, whic should
+            // be split in separate pass
+            p.addPass(mlir::createParallelLoopFusionPass());
+            p.addNestedPass<mlir::func::FuncOp>(
+                numba::createFuseParallelLoopsPass());
+          },
+          [](mlir::OpPassManager &p) {
+            p.addNestedPass<mlir::func::FuncOp>(
+                std::make_unique<PostLinalgOptInnerPass>());
+          },
+          [](mlir::OpPassManager &p) {
+            p.addPass(std::make_unique<RemoveConstantStoresPass>());
+            p.addPass(numba::createRemoveUnusedArgsPass());
+          },
       }));
 
   pm.addNestedPass<mlir::func::FuncOp>(
       std::make_unique<RemoveAtomicRegionsPass>());
   pm.addNestedPass<mlir::func::FuncOp>(
       std::make_unique<PropagateFastmathFlags>());
+  pm.addNestedPass<mlir::func::FuncOp>(numba::createBalanceCsrLoopsPass());
+  pm.addPass(numba::createStreamParallelLoopsPass(
+      static_cast<int64_t>(streamChunkSize.load())));
+  // Arguments are assumed restrict, guard parallel loops with runtime overlap
+  // check and fallback to the serial loop. Only races inside the single loop
+  // are guarded, fusion above already assumed restrict arguments.
+  pm.addNestedPass<mlir::func::FuncOp>(
+      numba::createVersionAliasingLoopsPass());
+  // Copy reused strided column views (AoS fields) into contiguous buffers,
+  // remaining strided accesses are handled by loop versioning below.
+  pm.addNestedPass<mlir::func::FuncOp>(numba::createPackStridedMemrefsPass());
+  // Generate contiguous fast path for loops over non-C-layout arrays before
+  // tiling, so both versions are tiled.
+  pm.addNestedPass<mlir::func::FuncOp>(numba::createVersionStridedLoopsPass());
+  pm.addNestedPass<mlir::func::FuncOp>(numba::createTileParallelLoopsPass());
+  pm.addNestedPass<mlir::func::FuncOp>(numba::createHoistMemrefOffsetsPass());
+  pm.addNestedPass<mlir::func::FuncOp>(
+      std::make_unique<SoftwarePrefetchPass>());
   // Uplifting FMAs can interfere with other optimizations, like loop reduction
   // uplifting. Move it after main optimization pass.
   pm.addNestedPass<mlir::func::FuncOp>(mlir::math::createMathUpliftToFMA());
@@ -4902,3 +6311,11 @@ llvm::StringRef plierToLinalgRegionPipelineName() {
 llvm::StringRef plierToLinalgGenPipelineName() { return "plier_to_linalg_gen"; }
 
 llvm::StringRef plierToLinalgOptPipelineName() { return "plier_to_linalg_opt"; }
+
+void setStackAllocMaxSize(uint64_t size) { stackAllocMaxSize = size; }
+
+void setZeroInitAllocEnabled(bool enabled) { zeroInitAllocEnabled = enabled; }
+
+void setParallelFillThreshold(uint64_t size) { parallelFillThreshold = size; }
+
+void setStreamChunkSize(uint64_t size) { streamChunkSize = size; }
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace numba {
 class PipelineRegistry;
 }
@@ -17,3 +19,19 @@ void registerPlierToLinalgPipeline(numba::PipelineRegistry &registry);
 llvm::StringRef plierToLinalgRegionPipelineName();
 llvm::StringRef plierToLinalgGenPipelineName();
 llvm::StringRef plierToLinalgOptPipelineName();
+
+/// Max size in bytes of the static temporary buffer, promoted to the stack,
+/// 0 disables stack promotion.
+void setStackAllocMaxSize(uint64_t size);
+
+/// Replace zero fills of the fresh host allocations with zeroed allocations,
+/// enabled by default.
+void setZeroInitAllocEnabled(bool enabled);
+
+/// Min size in bytes of the fresh allocation, filled by the runtime in
+/// parallel in non-parallel functions, 0 disables.
+void setParallelFillThreshold(uint64_t size);
+
+/// Approximate size in bytes of memory, accessed by the single chunk of the
+/// streamed outer parallel loop, 0 disables streaming.
+void setStreamChunkSize(uint64_t size);
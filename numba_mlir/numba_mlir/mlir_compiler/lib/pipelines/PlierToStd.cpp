@@ -40,6 +40,10 @@
 #include "PyFuncResolver.hpp"
 #include "PyLinalgResolver.hpp"
 
+#include <atomic>
+
+static std::atomic<bool> shareCalleesEnabled = false;
+
 namespace {
 static bool isSupportedType(mlir::Type type) {
   assert(type);
@@ -1298,12 +1302,82 @@ void PlierToStdPass::runOnOperation() {
     signalPassFailure();
 }
 
+/// Prefix of the shared callees symbols, must be kept in sync with
+/// `ExecutionEngine.cpp`.
+static constexpr llvm::StringLiteral SharedCalleePrefix("numba_shared.");
+
+static bool isUsedInsideEnvRegion(mlir::func::FuncOp func,
+                                  mlir::ModuleOp mod) {
+  auto uses = mlir::SymbolTable::getSymbolUses(func, mod);
+  if (!uses)
+    return true;
+
+  for (auto &use : *uses)
+    if (use.getUser()->getParentOfType<numba::util::EnvironmentRegionOp>())
+      return true;
+
+  return false;
+}
+
+/// Makes callees, which survived the inlining, public under their shared
+/// names, so private functions specializations won't touch them and the
+/// execution engine can link them from the module, which compiled them
+/// first. Duplicated copies of the same callee are replaced with the already
+/// exported one. Callees, used inside environment regions, are kept private,
+/// as they must be inlined later.
+struct ExportSharedCalleesPass
+    : public mlir::PassWrapper<ExportSharedCalleesPass,
+                               mlir::OperationPass<mlir::ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(ExportSharedCalleesPass)
+
+  void runOnOperation() override {
+    if (!shareCalleesEnabled)
+      return markAllAnalysesPreserved();
+
+    auto mod = getOperation();
+    auto attrName = numba::util::attributes::getSharedCalleeName();
+    mlir::SymbolTable symbolTable(mod);
+    for (auto func :
+         llvm::make_early_inc_range(mod.getOps<mlir::func::FuncOp>())) {
+      auto shared = func->getAttrOfType<mlir::StringAttr>(attrName);
+      if (!shared || !func.isPrivate() || func.isDeclaration() ||
+          func->hasAttr(numba::util::attributes::getForceInlineName()))
+        continue;
+
+      if (mlir::SymbolTable::symbolKnownUseEmpty(func, mod) ||
+          isUsedInsideEnvRegion(func, mod))
+        continue;
+
+      auto name = mlir::StringAttr::get(
+          &getContext(), SharedCalleePrefix + shared.getValue());
+      if (auto existing = symbolTable.lookup<mlir::func::FuncOp>(name)) {
+        if (existing.getFunctionType() != func.getFunctionType())
+          continue;
+
+        if (mlir::failed(mlir::SymbolTable::replaceAllSymbolUses(
+                func, name, mod)))
+          continue;
+
+        symbolTable.erase(func);
+        continue;
+      }
+
+      if (mlir::failed(symbolTable.rename(func, name)))
+        continue;
+
+      func.setPublic();
+    }
+  }
+};
+
 static void populatePlierToStdPipeline(mlir::OpPassManager &pm) {
   pm.addPass(mlir::createCanonicalizerPass());
   pm.addPass(std::make_unique<PlierToStdPass>());
   pm.addPass(mlir::createCanonicalizerPass());
   pm.addPass(std::make_unique<BuiltinCallsLoweringPass>());
   pm.addPass(numba::createForceInlinePass());
+  pm.addPass(numba::createCostModelInlinePass());
+  pm.addPass(std::make_unique<ExportSharedCalleesPass>());
   pm.addPass(mlir::createSymbolDCEPass());
   pm.addPass(mlir::createCanonicalizerPass());
   pm.addPass(numba::createPromoteWhilePass());
@@ -1320,3 +1394,5 @@ void registerPlierToStdPipeline(numba::PipelineRegistry &registry) {
 }
 
 llvm::StringRef plierToStdPipelineName() { return "plier_to_std"; }
+
+void setShareCalleesEnabled(bool enabled) { shareCalleesEnabled = enabled; }
@@ -15,3 +15,8 @@ class StringRef;
 void registerPlierToStdPipeline(numba::PipelineRegistry &registry);
 
 llvm::StringRef plierToStdPipelineName();
+
+/// Export callees, which weren't inlined, under the process-wide shared name,
+/// so they are compiled once and linked by dependent modules, disabled by
+/// default.
+void setShareCalleesEnabled(bool enabled);
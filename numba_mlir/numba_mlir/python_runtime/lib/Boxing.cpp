@@ -5,6 +5,7 @@
 #include "PythonRt.hpp"
 
 #include <memory>
+#include <optional>
 
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 
@@ -27,6 +28,17 @@ struct arystruct_t {
 struct RefDeleter {
   template <typename T> void operator()(T *obj) const { Py_DECREF(obj); }
 };
+
+/// Subset of dpctl `usm_ndarray` C-API. It is resolved at runtime from the
+/// dpctl module capsules, so dpctl is not a build dependency.
+struct UsmNDArrayApi {
+  PyTypeObject *type = nullptr;
+  char *(*getData)(PyObject *) = nullptr;
+  int (*getNDim)(PyObject *) = nullptr;
+  Py_ssize_t *(*getShape)(PyObject *) = nullptr;
+  Py_ssize_t *(*getStrides)(PyObject *) = nullptr;
+  int (*getElementSize)(PyObject *) = nullptr;
+};
 } // namespace
 
 template <typename T> static std::unique_ptr<T, RefDeleter> makeRef(T *ref) {
@@ -42,42 +54,71 @@ static bool initNumpy() {
   return init;
 }
 
-extern "C" NUMBA_MLIR_PYTHON_RUNTIME_EXPORT int
-nmrtUnboxSyclInterface(PyObject *obj, arystruct_t *arystruct) {
-  if (!initNumpy())
-    return -1;
+static bool loadUsmNDArrayApi(UsmNDArrayApi &api) {
+  auto mod = makeRef(PyImport_ImportModule("dpctl.tensor._usmarray"));
+  if (!mod)
+    return false;
 
-  auto iface = makeRef(PyObject_GetAttrString(obj, SYCL_USM_ARRAY_INTERFACE));
-  if (!iface)
-    return -1;
+  auto capi = makeRef(PyObject_GetAttrString(mod.get(), "__pyx_capi__"));
+  if (!capi || !PyDict_Check(capi.get()))
+    return false;
 
-  auto data = [&]() -> void * {
-    auto dataTuple = PyDict_GetItemString(iface.get(), "data");
-    if (!dataTuple)
+  auto getFunc = [&](const char *name) -> void * {
+    auto capsule = PyDict_GetItemString(capi.get(), name);
+    if (!capsule || !PyCapsule_CheckExact(capsule))
       return nullptr;
 
-    auto item = PyTuple_GetItem(dataTuple, 0);
-    if (!PyLong_Check(item))
-      return nullptr;
+    return PyCapsule_GetPointer(capsule, PyCapsule_GetName(capsule));
+  };
 
-    return PyLong_AsVoidPtr(item);
-  }();
+  using GetDataFunc = decltype(api.getData);
+  using GetIntFunc = decltype(api.getNDim);
+  using GetArrayFunc = decltype(api.getShape);
+  api.getData = reinterpret_cast<GetDataFunc>(getFunc("UsmNDArray_GetData"));
+  api.getNDim = reinterpret_cast<GetIntFunc>(getFunc("UsmNDArray_GetNDim"));
+  api.getShape =
+      reinterpret_cast<GetArrayFunc>(getFunc("UsmNDArray_GetShape"));
+  api.getStrides =
+      reinterpret_cast<GetArrayFunc>(getFunc("UsmNDArray_GetStrides"));
+  api.getElementSize =
+      reinterpret_cast<GetIntFunc>(getFunc("UsmNDArray_GetElementSize"));
+  if (!api.getData || !api.getNDim || !api.getShape || !api.getStrides ||
+      !api.getElementSize)
+    return false;
 
-  if (!data)
-    return -1;
+  auto type = PyObject_GetAttrString(mod.get(), "usm_ndarray");
+  if (!type)
+    return false;
 
-  auto shapeObj = PyDict_GetItemString(iface.get(), "shape");
-  if (!shapeObj)
-    return -1;
+  if (!PyType_Check(type)) {
+    Py_DECREF(type);
+    return false;
+  }
 
-  auto stridesObj = PyDict_GetItemString(iface.get(), "strides");
-  if (!stridesObj)
-    return -1;
+  // Keep type alive for the process lifetime.
+  api.type = reinterpret_cast<PyTypeObject *>(type);
+  return true;
+}
 
-  auto ndim = PyTuple_Size(shapeObj);
-  if (ndim < 0)
-    return -1;
+/// Returns dpctl C-API or null if dpctl is not available.
+static const UsmNDArrayApi *getUsmNDArrayApi() {
+  static const UsmNDArrayApi api = []() {
+    UsmNDArrayApi ret;
+    if (!loadUsmNDArrayApi(ret)) {
+      PyErr_Clear();
+      ret.type = nullptr;
+    }
+    return ret;
+  }();
+  return api.type ? &api : nullptr;
+}
 
+/// Fills array struct, `getStride` returns stride in elements or null if
+/// array is C-contiguous.
+template <typename DimF, typename StrideF>
+static int fillArystruct(PyObject *obj, arystruct_t *arystruct, void *data,
+                         Py_ssize_t ndim, npy_intp itemsize, DimF &&getDim,
+                         StrideF &&getStride) {
   arystruct->data = data;
   arystruct->parent = obj;
   auto *dims = &arystruct->shape_and_strides[0];
@@ -85,14 +126,64 @@ nmrtUnboxSyclInterface(PyObject *obj, arystruct_t *arystruct) {
 
   npy_intp nitems = 1;
   for (decltype(ndim) i = 0; i < ndim; i++) {
-    auto elem = PyTuple_GetItem(shapeObj, i);
-    if (!elem || !PyLong_Check(elem))
+    auto val = getDim(i);
+    if (!val)
       return -1;
 
-    auto val = PyLong_AsLong(elem);
-    nitems *= val;
-    dims[i] = val;
+    nitems *= *val;
+    dims[i] = *val;
   }
+
+  arystruct->itemsize = itemsize;
+  arystruct->nitems = nitems;
+
+  for (decltype(ndim) i = 0; i < ndim; i++) {
+    auto val = getStride(i);
+    if (!val) {
+      // Contiguous array.
+      npy_intp stride = itemsize;
+      for (decltype(ndim) j = 0; j < ndim; j++) {
+        strides[ndim - j - 1] = stride;
+        stride *= dims[ndim - j - 1];
+      }
+      break;
+    }
+
+    strides[i] = *val * itemsize;
+  }
+
+  // TODO: dtor
+  arystruct->meminfo =
+      nmrtAllocMemInfo(data, itemsize * nitems, nullptr, nullptr);
+
+  return 0;
+}
+
+static int unboxUsmNDArray(const UsmNDArrayApi &api, PyObject *obj,
+                           arystruct_t *arystruct) {
+  auto data = api.getData(obj);
+  auto ndim = static_cast<Py_ssize_t>(api.getNDim(obj));
+  auto itemsize = static_cast<npy_intp>(api.getElementSize(obj));
+  auto shape = api.getShape(obj);
+  auto strides = api.getStrides(obj);
+  auto getDim = [&](Py_ssize_t i) -> std::optional<npy_intp> {
+    return shape[i];
+  };
+  auto getStride = [&](Py_ssize_t i) -> std::optional<npy_intp> {
+    if (!strides)
+      return std::nullopt;
+
+    return strides[i];
+  };
+  return fillArystruct(obj, arystruct, data, ndim, itemsize, getDim,
+                       getStride);
+}
+
+static int unboxSyclInterface(PyObject *obj, arystruct_t *arystruct) {
+  auto iface = makeRef(PyObject_GetAttrString(obj, SYCL_USM_ARRAY_INTERFACE));
+  if (!iface)
+    return -1;
+
   auto itemsize = [&]() -> npy_intp {
     auto typestr = PyDict_GetItemString(iface.get(), "typestr");
     if (!typestr)
@@ -109,28 +200,76 @@ nmrtUnboxSyclInterface(PyObject *obj, arystruct_t *arystruct) {
   if (itemsize < 0)
     return -1;
 
-  arystruct->itemsize = itemsize;
-  arystruct->nitems = nitems;
+  auto data = [&]() -> char * {
+    auto dataTuple = PyDict_GetItemString(iface.get(), "data");
+    if (!dataTuple)
+      return nullptr;
 
-  if (stridesObj == Py_None) {
-    npy_intp stride = itemsize;
-    for (decltype(ndim) i = 0; i < ndim; i++) {
-      strides[ndim - i - 1] = stride;
-      stride *= dims[ndim - i - 1];
-    }
-  } else {
-    for (decltype(ndim) i = 0; i < ndim; i++) {
-      auto elem = PyTuple_GetItem(stridesObj, i);
-      if (!elem || !PyLong_Check(elem))
-        return -1;
+    auto item = PyTuple_GetItem(dataTuple, 0);
+    if (!PyLong_Check(item))
+      return nullptr;
 
-      strides[i] = PyLong_AsLong(elem) * itemsize;
-    }
+    return static_cast<char *>(PyLong_AsVoidPtr(item));
+  }();
+
+  if (!data)
+    return -1;
+
+  // Offset to the first element, in elements.
+  if (auto offsetObj = PyDict_GetItemString(iface.get(), "offset")) {
+    if (!PyLong_Check(offsetObj))
+      return -1;
+
+    data += PyLong_AsSsize_t(offsetObj) * itemsize;
   }
 
-  // TODO: dtor
-  arystruct->meminfo =
-      nmrtAllocMemInfo(data, itemsize * nitems, nullptr, nullptr);
+  auto shapeObj = PyDict_GetItemString(iface.get(), "shape");
+  if (!shapeObj)
+    return -1;
 
-  return 0;
+  auto stridesObj = PyDict_GetItemString(iface.get(), "strides");
+  if (!stridesObj)
+    return -1;
+
+  auto ndim = PyTuple_Size(shapeObj);
+  if (ndim < 0)
+    return -1;
+
+  auto getLong = [](PyObject *tuple, Py_ssize_t i) -> std::optional<npy_intp> {
+    auto elem = PyTuple_GetItem(tuple, i);
+    if (!elem || !PyLong_Check(elem))
+      return std::nullopt;
+
+    return PyLong_AsLong(elem);
+  };
+  auto getDim = [&](Py_ssize_t i) { return getLong(shapeObj, i); };
+
+  bool contiguous = (stridesObj == Py_None);
+  if (!contiguous)
+    for (decltype(ndim) i = 0; i < ndim; i++)
+      if (!getLong(stridesObj, i))
+        return -1;
+
+  auto getStride = [&](Py_ssize_t i) -> std::optional<npy_intp> {
+    if (contiguous)
+      return std::nullopt;
+
+    return getLong(stridesObj, i);
+  };
+  return fillArystruct(obj, arystruct, data, ndim, itemsize, getDim,
+                       getStride);
+}
+
+extern "C" NUMBA_MLIR_PYTHON_RUNTIME_EXPORT int
+nmrtUnboxSyclInterface(PyObject *obj, arystruct_t *arystruct) {
+  if (!initNumpy())
+    return -1;
+
+  // Fast path for dpctl arrays, avoids interface dict creation and lookups
+  // on every call.
+  if (auto api = getUsmNDArrayApi())
+    if (PyObject_TypeCheck(obj, api->type))
+      return unboxUsmNDArray(*api, obj, arystruct);
+
+  return unboxSyclInterface(obj, arystruct);
 }
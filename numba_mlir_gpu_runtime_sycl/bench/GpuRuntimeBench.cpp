@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <benchmark/benchmark.h>
+
+#include "GpuCommon.hpp"
+
+extern "C" {
+void *gpuxQueueCreate(const char *deviceName);
+void gpuxQueueDestroy(void *queue);
+void *gpuxModuleLoad(void *queue, const void *data, size_t dataSize);
+void gpuxModuleDestroy(void *module);
+void *gpuxKernelGet(void *module, const char *name);
+void gpuxKernelDestroy(void *kernel);
+void *gpuxLaunchKernel(void *queue, void *kernel, size_t gridX, size_t gridY,
+                       size_t gridZ, size_t blockX, size_t blockY,
+                       size_t blockZ, void *events, void *params);
+void gpuxWait(void *queue, void *event);
+void gpuxDestroyEvent(void *queue, void *event);
+void gpuxAlloc(void *queue, size_t size, size_t alignment, int type,
+               void *events, numba::GPUAllocResult *ret);
+void gpuxDeAlloc(void *queue, void *ptr);
+}
+
+namespace {
+/// SPIR-V module with a single empty OpenCL kernel `empty`.
+static const uint32_t EmptyKernelSpirv[] = {
+    // Header: magic, version 1.0, generator, bound, schema.
+    0x07230203, 0x00010000, 0, 5, 0,
+    // OpCapability Addresses
+    (2 << 16) | 17, 4,
+    // OpCapability Kernel
+    (2 << 16) | 17, 6,
+    // OpMemoryModel Physical64 OpenCL
+    (3 << 16) | 14, 2, 2,
+    // OpEntryPoint Kernel %3 "empty"
+    (5 << 16) | 15, 6, 3, 0x74706d65, 0x00000079,
+    // %1 = OpTypeVoid
+    (2 << 16) | 19, 1,
+    // %2 = OpTypeFunction %1
+    (3 << 16) | 33, 2, 1,
+    // %3 = OpFunction %1 None %2
+    (5 << 16) | 54, 1, 3, 0, 2,
+    // %4 = OpLabel
+    (2 << 16) | 248, 4,
+    // OpReturn
+    (1 << 16) | 253,
+    // OpFunctionEnd
+    (1 << 16) | 56,
+};
+
+/// Queue and empty kernel, shared by all benchmarks. Device is selected by
+/// NUMBA_MLIR_BENCH_DEVICE filter string, runtime default otherwise.
+struct BenchEnv {
+  BenchEnv() {
+    queue = gpuxQueueCreate(std::getenv("NUMBA_MLIR_BENCH_DEVICE"));
+    module = gpuxModuleLoad(queue, EmptyKernelSpirv, sizeof(EmptyKernelSpirv));
+    kernel = gpuxKernelGet(module, "empty");
+  }
+
+  ~BenchEnv() {
+    gpuxKernelDestroy(kernel);
+    gpuxModuleDestroy(module);
+    gpuxQueueDestroy(queue);
+  }
+
+  void *queue = nullptr;
+  void *module = nullptr;
+  void *kernel = nullptr;
+};
+
+static BenchEnv &getEnv() {
+  static BenchEnv env;
+  return env;
+}
+
+// Args: global size, block size.
+static void BM_LaunchKernel(benchmark::State &state) {
+  auto &env = getEnv();
+  auto block = static_cast<size_t>(state.range(1));
+  auto grid = static_cast<size_t>(state.range(0)) / block;
+  void *events[] = {nullptr};
+  numba::GPUParamDesc params[] = {{nullptr, 0, numba::GpuParamType::null}};
+  for (auto _ : state) {
+    auto event = gpuxLaunchKernel(env.queue, env.kernel, grid, 1, 1, block, 1,
+                                  1, events, params);
+    gpuxWait(env.queue, event);
+    gpuxDestroyEvent(env.queue, event);
+  }
+}
+BENCHMARK(BM_LaunchKernel)
+    ->ArgNames({"size", "block"})
+    ->ArgsProduct({{1 << 8, 1 << 16, 1 << 24}, {64, 256}})
+    ->UseRealTime();
+
+// Launches are not waited, only the last one, measures submission cost.
+static void BM_LaunchKernelAsync(benchmark::State &state) {
+  auto &env = getEnv();
+  void *events[] = {nullptr};
+  numba::GPUParamDesc params[] = {{nullptr, 0, numba::GpuParamType::null}};
+  for (auto _ : state) {
+    auto event = gpuxLaunchKernel(env.queue, env.kernel, 1, 1, 1, 64, 1, 1,
+                                  events, params);
+    gpuxDestroyEvent(env.queue, event);
+  }
+  auto event = gpuxLaunchKernel(env.queue, env.kernel, 1, 1, 1, 64, 1, 1,
+                                events, params);
+  gpuxWait(env.queue, event);
+  gpuxDestroyEvent(env.queue, event);
+}
+BENCHMARK(BM_LaunchKernelAsync)->UseRealTime();
+
+// Args: bytes, alloc type (`numba::GpuAllocType`).
+static void BM_Alloc(benchmark::State &state) {
+  auto &env = getEnv();
+  auto size = static_cast<size_t>(state.range(0));
+  auto type = static_cast<int>(state.range(1));
+  void *events[] = {nullptr};
+  for (auto _ : state) {
+    numba::GPUAllocResult res;
+    gpuxAlloc(env.queue, size, 64, type, events, &res);
+    gpuxWait(env.queue, res.event);
+    gpuxDestroyEvent(env.queue, res.event);
+    gpuxDeAlloc(env.queue, res.ptr);
+  }
+}
+BENCHMARK(BM_Alloc)
+    ->ArgNames({"bytes", "type"})
+    ->ArgsProduct({{1 << 10, 1 << 20, 1 << 28},
+                   {static_cast<int64_t>(numba::GpuAllocType::Device),
+                    static_cast<int64_t>(numba::GpuAllocType::Shared),
+                    static_cast<int64_t>(numba::GpuAllocType::Host)}})
+    ->UseRealTime();
+} // namespace
@@ -7,9 +7,23 @@
 #include "Utils.hpp"
 
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <limits>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <string>
+#include <thread>
 #include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #ifdef __linux__
 #include <dlfcn.h>
@@ -105,6 +119,7 @@ struct ZELoader {
   DECL_TYPE(zeModuleBuildLogGetString);
   DECL_TYPE(zeModuleDestroy);
   DECL_TYPE(zeModuleBuildLogDestroy);
+  DECL_TYPE(zeModuleGetNativeBinary);
   DECL_TYPE(zeKernelCreate);
   DECL_TYPE(zeKernelDestroy);
   DECL_TYPE(zeKernelSuggestGroupSize);
@@ -114,6 +129,7 @@ struct ZELoader {
     INIT_FUNC(zeModuleBuildLogGetString);
     INIT_FUNC(zeModuleDestroy);
     INIT_FUNC(zeModuleBuildLogDestroy);
+    INIT_FUNC(zeModuleGetNativeBinary);
     INIT_FUNC(zeKernelCreate);
     INIT_FUNC(zeKernelDestroy);
     INIT_FUNC(zeKernelSuggestGroupSize);
@@ -123,6 +139,7 @@ struct ZELoader {
   DECL_FUNC(zeModuleBuildLogGetString);
   DECL_FUNC(zeModuleDestroy);
   DECL_FUNC(zeModuleBuildLogDestroy);
+  DECL_FUNC(zeModuleGetNativeBinary);
   DECL_FUNC(zeKernelCreate);
   DECL_FUNC(zeKernelDestroy);
   DECL_FUNC(zeKernelSuggestGroupSize);
@@ -306,34 +323,525 @@ using ClKernel =
 
 static constexpr const auto ze_be = sycl::backend::ext_oneapi_level_zero;
 static constexpr const auto cl_be = sycl::backend::opencl;
+
+using KernelBundle = sycl::kernel_bundle<sycl::bundle_state::executable>;
+
+/// Module build options, must be part of the cache key.
+static constexpr const char *buildOptions = "";
+
+static uint64_t hashData(const void *data, size_t size,
+                         uint64_t hash = 0xcbf29ce484222325ULL) {
+  // FNV-1a
+  auto *ptr = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= ptr[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static uint64_t hashString(const std::string &str, uint64_t hash) {
+  return hashData(str.data(), str.size(), hash);
+}
+
+/// Module data with specialization constants. Cache entries are compared by
+/// it on hit, as different modules may have the same hash.
+static std::vector<uint8_t>
+getModuleContent(const void *data, size_t dataSize,
+                 const GPUSpecConstant *specConstants,
+                 size_t numSpecConstants) {
+  auto *ptr = static_cast<const uint8_t *>(data);
+  std::vector<uint8_t> ret(ptr, ptr + dataSize);
+  auto append = [&](const auto &val) {
+    auto *valPtr = reinterpret_cast<const uint8_t *>(&val);
+    ret.insert(ret.end(), valPtr, valPtr + sizeof(val));
+  };
+  for (size_t i = 0; i < numSpecConstants; ++i) {
+    append(specConstants[i].id);
+    append(specConstants[i].value);
+  }
+  return ret;
+}
+
+/// Directory for the native binaries cache, empty if disabled.
+static const std::string &getCacheDir() {
+  static std::string dir = []() -> std::string {
+    auto env = std::getenv("NUMBA_MLIR_GPU_CACHE_DIR");
+    return env ? env : "";
+  }();
+  return dir;
+}
+
+static std::string toHex(uint64_t val) {
+  char buf[17] = {};
+  std::snprintf(buf, sizeof(buf), "%016llx",
+                static_cast<unsigned long long>(val));
+  return buf;
+}
+
+static uint64_t hashDevice(const sycl::device &device, uint64_t hash) {
+  hash = hashString(device.get_info<sycl::info::device::name>(), hash);
+  return hashString(device.get_info<sycl::info::device::driver_version>(),
+                    hash);
+}
+
+/// Native binary is only valid for the same device and driver.
+static std::string getNativeBinaryPath(const sycl::device &device,
+                                       uint64_t moduleHash) {
+  auto &dir = getCacheDir();
+  if (dir.empty())
+    return {};
+
+  auto hash = hashDevice(device, moduleHash);
+  return dir + "/nmgpu-" + toHex(moduleHash) + "-" + toHex(hash) + ".bin";
+}
+
+/// Tuned block sizes, stored per kernel and device.
+static std::string getBlockSizesPath(const sycl::device &device,
+                                     uint64_t moduleHash,
+                                     const std::string &kernelName) {
+  auto &dir = getCacheDir();
+  if (dir.empty())
+    return {};
+
+  auto hash = hashDevice(device, hashString(kernelName, moduleHash));
+  return dir + "/nmgpu-" + toHex(moduleHash) + "-" + toHex(hash) + ".bs";
+}
+
+static std::vector<uint8_t> readFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file)
+    return {};
+
+  auto size = static_cast<size_t>(file.tellg());
+  std::vector<uint8_t> ret(size);
+  file.seekg(0);
+  if (!file.read(reinterpret_cast<char *>(ret.data()),
+                 static_cast<std::streamsize>(size)))
+    return {};
+
+  return ret;
+}
+
+static void writeFile(const std::string &path,
+                      const std::vector<uint8_t> &data);
+
+/// Native binary file starts with the size and content of the module it was
+/// built from, followed by the binary itself.
+static std::vector<uint8_t>
+readNativeBinary(const std::string &path,
+                 const std::vector<uint8_t> &content) {
+  auto file = readFile(path);
+  auto headerSize = sizeof(uint64_t) + content.size();
+  if (file.size() <= headerSize)
+    return {};
+
+  uint64_t size = 0;
+  std::memcpy(&size, file.data(), sizeof(size));
+  if (size != content.size() ||
+      !std::equal(content.begin(), content.end(),
+                  file.begin() + sizeof(uint64_t)))
+    return {};
+
+  file.erase(file.begin(), file.begin() + headerSize);
+  return file;
+}
+
+static void writeNativeBinary(const std::string &path,
+                              const std::vector<uint8_t> &content,
+                              const std::vector<uint8_t> &binary) {
+  uint64_t size = content.size();
+  std::vector<uint8_t> file(sizeof(size));
+  std::memcpy(file.data(), &size, sizeof(size));
+  file.insert(file.end(), content.begin(), content.end());
+  file.insert(file.end(), binary.begin(), binary.end());
+  writeFile(path, file);
+}
+
+static void writeFile(const std::string &path,
+                      const std::vector<uint8_t> &data) {
+  // Write to temp file first, so concurrent readers never see partial file.
+  auto tmpPath =
+      path + ".tmp" +
+      toHex(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!file)
+      return;
+
+    file.write(reinterpret_cast<const char *>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    if (!file)
+      return;
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    std::remove(tmpPath.c_str());
+}
+
+/// Module image, produced by the compiler in AOT mode, must be kept in sync
+/// with `SerializeSPIRVPass`: magic, number of native binaries, then target
+/// name size, binary size, target name and binary data for each of them and
+/// SPIR-V module at the end. Plain SPIR-V is passed as is.
+static constexpr const char aotImageMagic[] = "NMGPUAOT";
+
+struct ModuleImage {
+  const uint8_t *spirv = nullptr;
+  size_t spirvSize = 0;
+  std::vector<std::pair<const uint8_t *, size_t>> nativeBinaries;
+};
+
+static ModuleImage parseModuleImage(const void *data, size_t dataSize) {
+  auto *ptr = static_cast<const uint8_t *>(data);
+  auto *end = ptr + dataSize;
+  const auto magicSize = sizeof(aotImageMagic) - 1;
+  if (dataSize < magicSize || std::memcmp(ptr, aotImageMagic, magicSize) != 0)
+    return ModuleImage{ptr, dataSize, {}};
+
+  auto readU32 = [&]() -> uint32_t {
+    uint32_t val = 0;
+    if (static_cast<size_t>(end - ptr) < sizeof(val))
+      reportError("Invalid AOT module image");
+
+    std::memcpy(&val, ptr, sizeof(val));
+    ptr += sizeof(val);
+    return val;
+  };
+
+  ptr += magicSize;
+  ModuleImage ret;
+  auto count = readU32();
+  for (uint32_t i = 0; i < count; ++i) {
+    size_t nameSize = readU32();
+    size_t binSize = readU32();
+    if (static_cast<size_t>(end - ptr) < nameSize + binSize)
+      reportError("Invalid AOT module image");
+
+    ptr += nameSize;
+    ret.nativeBinaries.emplace_back(ptr, binSize);
+    ptr += binSize;
+  }
+  ret.spirv = ptr;
+  ret.spirvSize = static_cast<size_t>(end - ptr);
+  return ret;
+}
+
+/// Specialization constants, emitted by `GPUToSpirvPass` for kernel arguments,
+/// are named `<prefix><arg index>.<kernel name>`, each argument has value and
+/// flag constants.
+// Must be kept in sync with GpuToGpuRuntime.cpp.
+static constexpr const char specConstantPrefix[] = "__nmspec.";
+static constexpr const char specConstantSetPrefix[] = "__nmspecset.";
+
+struct SpecArg {
+  uint32_t argIndex;
+  uint32_t specId;
+  uint32_t setSpecId;
+};
+
+using SpecArgsMap = std::unordered_map<std::string, std::vector<SpecArg>>;
+
+static SpecArgsMap parseSpecArgs(const uint8_t *spirv, size_t size) {
+  constexpr uint32_t spirvMagic = 0x07230203;
+  constexpr size_t headerWords = 5;
+  constexpr uint32_t opName = 5;
+  constexpr uint32_t opFunction = 54;
+  constexpr uint32_t opDecorate = 71;
+  constexpr uint32_t decorationSpecId = 1;
+
+  std::vector<uint32_t> words(size / sizeof(uint32_t));
+  std::memcpy(words.data(), spirv, words.size() * sizeof(uint32_t));
+  if (words.size() < headerWords || words[0] != spirvMagic)
+    return {};
+
+  // Names and decorations precede all function definitions.
+  std::unordered_map<uint32_t, std::string> names;
+  std::unordered_map<uint32_t, uint32_t> specIds;
+  for (size_t i = headerWords; i < words.size();) {
+    auto opcode = words[i] & 0xffff;
+    auto count = words[i] >> 16;
+    if (count == 0 || i + count > words.size() || opcode == opFunction)
+      break;
+
+    if (opcode == opName && count > 2) {
+      auto str = reinterpret_cast<const char *>(&words[i + 2]);
+      auto len = strnlen(str, (count - 2) * sizeof(uint32_t));
+      names[words[i + 1]] = std::string(str, len);
+    } else if (opcode == opDecorate && count == 4 &&
+               words[i + 2] == decorationSpecId) {
+      specIds[words[i + 1]] = words[i + 3];
+    }
+    i += count;
+  }
+
+  // Value and flag spec ids, keyed by kernel name and arg index.
+  using ArgKey = std::pair<std::string, uint32_t>;
+  std::map<ArgKey, std::pair<uint32_t, uint32_t>> args;
+  constexpr uint32_t noSpecId = std::numeric_limits<uint32_t>::max();
+  for (auto &&[id, name] : names) {
+    auto it = specIds.find(id);
+    if (it == specIds.end())
+      continue;
+
+    bool isFlag = false;
+    size_t prefixSize = 0;
+    if (name.compare(0, sizeof(specConstantPrefix) - 1, specConstantPrefix) ==
+        0) {
+      prefixSize = sizeof(specConstantPrefix) - 1;
+    } else if (name.compare(0, sizeof(specConstantSetPrefix) - 1,
+                            specConstantSetPrefix) == 0) {
+      prefixSize = sizeof(specConstantSetPrefix) - 1;
+      isFlag = true;
+    } else {
+      continue;
+    }
+
+    auto sep = name.find('.', prefixSize);
+    if (sep == std::string::npos)
+      continue;
+
+    auto argIndex = std::strtoul(name.c_str() + prefixSize, nullptr, 10);
+    ArgKey key(name.substr(sep + 1), static_cast<uint32_t>(argIndex));
+    auto &ids = args.try_emplace(key, noSpecId, noSpecId).first->second;
+    (isFlag ? ids.second : ids.first) = it->second;
+  }
+
+  SpecArgsMap ret;
+  for (auto &&[key, ids] : args)
+    if (ids.first != noSpecId && ids.second != noSpecId)
+      ret[key.first].push_back({key.second, ids.first, ids.second});
+
+  return ret;
+}
+
+struct ModuleKey {
+  sycl::context context;
+  sycl::device device;
+  uint64_t hash;
+  size_t size;
+
+  bool operator==(const ModuleKey &rhs) const {
+    return context == rhs.context && device == rhs.device &&
+           hash == rhs.hash && size == rhs.size;
+  }
+};
+
+struct ModuleKeyHash {
+  size_t operator()(const ModuleKey &key) const {
+    return std::hash<sycl::context>{}(key.context) ^
+           (std::hash<sycl::device>{}(key.device) << 1) ^
+           static_cast<size_t>(key.hash);
+  }
+};
+
+struct BlockSizeKey {
+  uint32_t gridSize[3];
+  size_t numDims;
+
+  bool operator==(const BlockSizeKey &rhs) const {
+    return numDims == rhs.numDims &&
+           std::equal(gridSize, gridSize + numDims, rhs.gridSize);
+  }
+};
+
+struct BlockSizeKeyHash {
+  size_t operator()(const BlockSizeKey &key) const {
+    size_t ret = key.numDims;
+    for (size_t i = 0; i < key.numDims; ++i)
+      ret = ret * 31 + key.gridSize[i];
+
+    return ret;
+  }
+};
+
+using BlockSize = std::array<uint32_t, 3>;
+
+/// Block size, suggested for specific grid. When tuning is enabled, each of
+/// `candidates` is tried on subsequent launches and the fastest one is kept.
+struct BlockSizeEntry {
+  BlockSize best = {};
+  std::vector<BlockSize> candidates;
+  size_t next = 0;
+  double bestTime = std::numeric_limits<double>::infinity();
+};
+
+struct CachedKernel {
+  CachedKernel(std::string n, sycl::kernel k, std::string path)
+      : name(std::move(n)), kernel(std::move(k)),
+        blockSizesPath(std::move(path)) {}
+
+  std::string name;
+  sycl::kernel kernel;
+
+  /// Tuned block sizes file, empty if persistent cache is disabled.
+  std::string blockSizesPath;
+
+  std::mutex mutex;
+  std::unordered_map<BlockSizeKey, BlockSizeEntry, BlockSizeKeyHash>
+      blockSizes;
+
+  /// Launch arguments, backed by specialization constants.
+  std::vector<SpecArg> specArgs;
+};
+
+struct CachedModule {
+  KernelBundle bundle;
+  uint64_t hash;
+
+  /// Module data and specialization constants, see `getModuleContent`.
+  std::vector<uint8_t> content;
+  std::unordered_map<std::string, std::unique_ptr<CachedKernel>> kernels;
+
+  /// Specialization constants per kernel and SPIR-V, which specialized
+  /// variants are built from. Empty, if module has none.
+  SpecArgsMap specArgs;
+  std::vector<uint8_t> spirv;
+};
+
+/// Process-wide module and kernel cache. Modules with the same key are
+/// distinguished by their content.
+struct ModuleCache {
+  std::mutex mutex;
+  std::unordered_map<ModuleKey, std::vector<std::unique_ptr<CachedModule>>,
+                     ModuleKeyHash>
+      modules;
+};
+
+static ModuleCache &getModuleCache() {
+  // Intentionally leaked, driver objects must not be released during static
+  // destruction, when driver may be already unloaded.
+  static auto *cache = new ModuleCache;
+  return *cache;
+}
 } // namespace
 
 struct GPUModule {
   sycl::queue *queue = nullptr;
-  sycl::kernel_bundle<sycl::bundle_state::executable> kernelBundle;
+  KernelBundle kernelBundle;
+
+  /// Owned by the module cache.
+  CachedModule *cached = nullptr;
 };
 
 struct GPUKernel {
   sycl::queue *queue = nullptr;
   sycl::kernel syclKernel;
   uint32_t maxWgSize = 0;
+
+  /// Owned by the module cache.
+  CachedKernel *cached = nullptr;
+  CachedModule *module = nullptr;
+
+  /// Variant, specialized for launch argument values, with its module, built
+  /// in background.
+  struct Variant {
+    std::unique_ptr<GPUModule> module;
+    std::unique_ptr<GPUKernel> kernel;
+    bool ready = false;
+
+    /// Destroyed first, waits for the build to finish.
+    std::future<void> build;
+  };
+  std::mutex specializedMutex;
+  std::map<std::vector<uint64_t>, std::unique_ptr<Variant>> specialized;
+
+  /// Packed arguments buffers with the events of the launches, which use
+  /// them. Buffers, currently acquired by the launch, are not in the list.
+  struct ArgsBuffer {
+    void *ptr;
+    size_t size;
+    sycl::event event;
+  };
+  std::mutex argsMutex;
+  std::vector<ArgsBuffer> argsBuffers;
+
+  ~GPUKernel() {
+    for (auto &buffer : argsBuffers) {
+      buffer.event.wait();
+      sycl::free(buffer.ptr, *queue);
+    }
+  }
 };
 
-GPUModule *createGPUModule(sycl::queue &queue, const void *data,
-                           size_t dataSize) {
+static KernelBundle createKernelBundle(sycl::queue &queue, const void *data,
+                                       size_t dataSize, uint64_t hash,
+                                       const std::vector<uint8_t> &content,
+                                       const GPUSpecConstant *specConstants,
+                                       size_t numSpecConstants) {
   auto ctx = queue.get_context();
   auto backend = ctx.get_platform().get_backend();
+  auto image = parseModuleImage(data, dataSize);
 
   if (backend == ze_be) {
     auto &loader = getZeLoader();
+
+    std::vector<uint32_t> constantIds;
+    std::vector<const void *> constantValues;
+    for (size_t i = 0; i < numSpecConstants; ++i) {
+      // Driver reads constant type size, values are little-endian.
+      constantIds.emplace_back(specConstants[i].id);
+      constantValues.emplace_back(&specConstants[i].value);
+    }
+    ze_module_constants_t constants = {};
+    constants.numConstants = static_cast<uint32_t>(numSpecConstants);
+    constants.pConstantIds = constantIds.data();
+    constants.pConstantValues = constantValues.data();
     auto zeDevice = sycl::get_native<ze_be>(queue.get_device());
     auto zeContext = sycl::get_native<ze_be>(queue.get_context());
 
+    // Driver rejects binaries for different devices or driver versions.
+    auto tryNative = [&](const uint8_t *binary,
+                         size_t size) -> ze_module_handle_t {
+      ze_module_desc_t desc = {};
+      desc.stype = ZE_STRUCTURE_TYPE_MODULE_DESC;
+      desc.format = ZE_MODULE_FORMAT_NATIVE;
+      desc.pInputModule = binary;
+      desc.inputSize = size;
+      desc.pBuildFlags = buildOptions;
+
+      ze_module_handle_t moduleHandle = nullptr;
+      if (loader.zeModuleCreate(zeContext, zeDevice, &desc, &moduleHandle,
+                                nullptr) != ZE_RESULT_SUCCESS)
+        return nullptr;
+
+      return moduleHandle;
+    };
+
+    auto binaryPath = getNativeBinaryPath(queue.get_device(), hash);
+    if (!binaryPath.empty()) {
+      // Stale or corrupted binary or binary for the different module with the
+      // same hash, fallback to SPIR-V.
+      auto binary = readNativeBinary(binaryPath, content);
+      if (!binary.empty()) {
+        if (auto moduleHandle = tryNative(binary.data(), binary.size())) {
+          ZeModule zeModule(moduleHandle);
+          return sycl::make_kernel_bundle<ze_be,
+                                          sycl::bundle_state::executable>(
+              {zeModule.release()}, ctx);
+        }
+      }
+    }
+
+    // Binaries compiled ahead of time for the matching device, these are not
+    // specialized.
+    if (numSpecConstants == 0) {
+      for (auto &&[binary, size] : image.nativeBinaries) {
+        if (auto moduleHandle = tryNative(binary, size)) {
+          ZeModule zeModule(moduleHandle);
+          return sycl::make_kernel_bundle<ze_be,
+                                          sycl::bundle_state::executable>(
+              {zeModule.release()}, ctx);
+        }
+      }
+    }
+
     ze_module_desc_t desc = {};
     desc.stype = ZE_STRUCTURE_TYPE_MODULE_DESC;
     desc.format = ZE_MODULE_FORMAT_IL_SPIRV;
-    desc.pInputModule = static_cast<const uint8_t *>(data);
-    desc.inputSize = dataSize;
+    desc.pInputModule = image.spirv;
+    desc.inputSize = image.spirvSize;
+    desc.pBuildFlags = buildOptions;
+    if (numSpecConstants != 0)
+      desc.pConstants = &constants;
 
     ze_module_handle_t moduleHandle = nullptr;
     ze_module_build_log_handle_t logHandle = nullptr;
@@ -359,10 +867,20 @@ GPUModule *createGPUModule(sycl::queue &queue, const void *data,
     ZeBuildLog log(logHandle);
     ZeModule zeModule(moduleHandle);
 
-    auto kernelBundle =
-        sycl::make_kernel_bundle<ze_be, sycl::bundle_state::executable>(
-            {zeModule.release()}, ctx);
-    return new GPUModule{&queue, std::move(kernelBundle)};
+    if (!binaryPath.empty()) {
+      size_t size = 0;
+      std::vector<uint8_t> binary;
+      if (loader.zeModuleGetNativeBinary(zeModule.get(), &size, nullptr) ==
+          ZE_RESULT_SUCCESS) {
+        binary.resize(size);
+        if (loader.zeModuleGetNativeBinary(zeModule.get(), &size,
+                                           binary.data()) == ZE_RESULT_SUCCESS)
+          writeNativeBinary(binaryPath, content, binary);
+      }
+    }
+
+    return sycl::make_kernel_bundle<ze_be, sycl::bundle_state::executable>(
+        {zeModule.release()}, ctx);
   }
   if (backend == cl_be) {
     auto &loader = getClLoader();
@@ -371,13 +889,13 @@ GPUModule *createGPUModule(sycl::queue &queue, const void *data,
     auto clDevice = sycl::get_native<cl_be>(queue.get_device());
 
     cl_int errCode = CL_SUCCESS;
-    ClProgram program(
-        loader.clCreateProgramWithIL(clContext, data, dataSize, &errCode));
+    ClProgram program(loader.clCreateProgramWithIL(
+        clContext, image.spirv, image.spirvSize, &errCode));
     checkClResult("clCreateProgramWithILF", errCode);
 
     try {
-      CHECK_CL_RESULT(loader.clBuildProgram(program.get(), 1, &clDevice, "",
-                                            nullptr, nullptr));
+      CHECK_CL_RESULT(loader.clBuildProgram(program.get(), 1, &clDevice,
+                                            buildOptions, nullptr, nullptr));
     } catch (std::exception &e) {
       size_t len = 0;
       auto ret = loader.clGetProgramBuildInfo(
@@ -396,26 +914,63 @@ GPUModule *createGPUModule(sycl::queue &queue, const void *data,
       throw std::runtime_error(e.what() + std::string("\n") + str);
     }
 
-    auto kernelBundle =
-        sycl::make_kernel_bundle<cl_be, sycl::bundle_state::executable>(
-            program.release(), ctx);
-    return new GPUModule{&queue, std::move(kernelBundle)};
+    return sycl::make_kernel_bundle<cl_be, sycl::bundle_state::executable>(
+        program.release(), ctx);
   }
 
   reportError("Backend is not supported: " +
               std::to_string(static_cast<int>(backend)));
 }
 
+GPUModule *createGPUModule(sycl::queue &queue, const void *data,
+                           size_t dataSize,
+                           const GPUSpecConstant *specConstants,
+                           size_t numSpecConstants) {
+  auto content =
+      getModuleContent(data, dataSize, specConstants, numSpecConstants);
+  auto hash = hashData(content.data(), content.size());
+  hash = hashData(buildOptions, std::char_traits<char>::length(buildOptions),
+                  hash);
+  ModuleKey key{queue.get_context(), queue.get_device(), hash, dataSize};
+
+  auto &cache = getModuleCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  auto &entries = cache.modules[key];
+  auto it = std::find_if(entries.begin(), entries.end(), [&](auto &entry) {
+    return entry->content == content;
+  });
+  CachedModule *cached = nullptr;
+  if (it != entries.end()) {
+    cached = it->get();
+  } else {
+    auto bundle = createKernelBundle(queue, data, dataSize, hash, content,
+                                     specConstants, numSpecConstants);
+    entries.emplace_back(std::make_unique<CachedModule>(
+        CachedModule{std::move(bundle), hash, std::move(content), {}, {}, {}}));
+    cached = entries.back().get();
+
+    // Only Level Zero modules are specialized, OpenCL ones use the generic
+    // kernel, which reads the arguments.
+    auto backend = queue.get_context().get_platform().get_backend();
+    if (numSpecConstants == 0 && backend == ze_be) {
+      auto image = parseModuleImage(data, dataSize);
+      cached->specArgs = parseSpecArgs(image.spirv, image.spirvSize);
+      if (!cached->specArgs.empty())
+        cached->spirv.assign(image.spirv, image.spirv + image.spirvSize);
+    }
+  }
+
+  return new GPUModule{&queue, cached->bundle, cached};
+}
+
 void destoyGPUModule(GPUModule *mod) { delete mod; }
 
-GPUKernel *getGPUKernel(GPUModule *mod, const char *name) {
+static sycl::kernel createSYCLKernel(GPUModule *mod, const char *name) {
   auto queue = mod->queue;
   assert(queue);
   auto ctx = queue->get_context();
   auto backend = ctx.get_platform().get_backend();
 
-  auto maxWgSize = static_cast<uint32_t>(
-      queue->get_device().get_info<sycl::info::device::max_work_group_size>());
   if (backend == ze_be) {
     auto &loader = getZeLoader();
     auto zeModule = sycl::get_native<ze_be>(mod->kernelBundle).front();
@@ -428,9 +983,8 @@ GPUKernel *getGPUKernel(GPUModule *mod, const char *name) {
     CHECK_CL_RESULT(loader.zeKernelCreate(zeModule, &desc, &kernelHandle));
     ZeKernel zeKernel(kernelHandle);
 
-    auto syclKernel =
-        sycl::make_kernel<ze_be>({mod->kernelBundle, zeKernel.release()}, ctx);
-    return new GPUKernel{queue, std::move(syclKernel), maxWgSize};
+    return sycl::make_kernel<ze_be>({mod->kernelBundle, zeKernel.release()},
+                                    ctx);
   }
   if (backend == cl_be) {
     auto &loader = getClLoader();
@@ -440,16 +994,209 @@ GPUKernel *getGPUKernel(GPUModule *mod, const char *name) {
     ClKernel clKernel(loader.clCreateKernel(clProgram, name, &errCode));
     checkClResult("clCreateKernel", errCode);
 
-    auto syclKernel = sycl::make_kernel<cl_be>(clKernel.release(), ctx);
-    return new GPUKernel{queue, std::move(syclKernel), maxWgSize};
+    return sycl::make_kernel<cl_be>(clKernel.release(), ctx);
   }
   reportError("Invalid module");
 }
 
+/// Block sizes file is a sequence of records, each record is `numDims`,
+/// followed by grid and block sizes.
+static constexpr size_t BlockSizeRecordSize = 7;
+
+static void loadBlockSizes(CachedKernel &kernel) {
+  if (kernel.blockSizesPath.empty())
+    return;
+
+  auto data = readFile(kernel.blockSizesPath);
+  auto recordBytes = BlockSizeRecordSize * sizeof(uint32_t);
+  for (size_t offset = 0; offset + recordBytes <= data.size();
+       offset += recordBytes) {
+    uint32_t record[BlockSizeRecordSize];
+    std::memcpy(record, data.data() + offset, recordBytes);
+    auto numDims = record[0];
+    if (numDims == 0 || numDims > 3)
+      return;
+
+    BlockSizeKey key = {};
+    std::copy_n(record + 1, numDims, key.gridSize);
+    key.numDims = numDims;
+
+    BlockSizeEntry entry;
+    entry.best.fill(1);
+    std::copy_n(record + 4, numDims, entry.best.begin());
+    kernel.blockSizes.emplace(key, std::move(entry));
+  }
+}
+
+/// Stores block sizes, which are not being tuned anymore.
+static void saveBlockSizes(const CachedKernel &kernel) {
+  if (kernel.blockSizesPath.empty())
+    return;
+
+  std::vector<uint32_t> records;
+  for (auto &&[key, entry] : kernel.blockSizes) {
+    if (entry.next < entry.candidates.size())
+      continue;
+
+    records.emplace_back(static_cast<uint32_t>(key.numDims));
+    records.insert(records.end(), key.gridSize, key.gridSize + 3);
+    records.insert(records.end(), entry.best.begin(), entry.best.end());
+  }
+
+  auto begin = reinterpret_cast<const uint8_t *>(records.data());
+  std::vector<uint8_t> data(begin, begin + records.size() * sizeof(uint32_t));
+  writeFile(kernel.blockSizesPath, data);
+}
+
+GPUKernel *getGPUKernel(GPUModule *mod, const char *name) {
+  auto queue = mod->queue;
+  assert(queue);
+  assert(mod->cached);
+
+  auto maxWgSize = static_cast<uint32_t>(
+      queue->get_device().get_info<sycl::info::device::max_work_group_size>());
+
+  auto &cache = getModuleCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  auto &kernels = mod->cached->kernels;
+  auto it = kernels.find(name);
+  if (it == kernels.end()) {
+    auto path = getBlockSizesPath(queue->get_device(), mod->cached->hash, name);
+    auto kernel = std::make_unique<CachedKernel>(
+        name, createSYCLKernel(mod, name), std::move(path));
+    loadBlockSizes(*kernel);
+    auto specIt = mod->cached->specArgs.find(name);
+    if (specIt != mod->cached->specArgs.end())
+      kernel->specArgs = specIt->second;
+
+    it = kernels.emplace(name, std::move(kernel)).first;
+  }
+
+  auto cached = it->second.get();
+  return new GPUKernel{queue, cached->kernel, maxWgSize, cached, mod->cached};
+}
+
 void destroyGPUKernel(GPUKernel *kernel) { delete kernel; }
 
+void *acquireGPUKernelArgsBuffer(GPUKernel *kernel, size_t size) {
+  assert(kernel);
+  auto isComplete = [](const sycl::event &event) {
+    return event.get_info<sycl::info::event::command_execution_status>() ==
+           sycl::info::event_command_status::complete;
+  };
+  {
+    std::lock_guard<std::mutex> lock(kernel->argsMutex);
+    auto &buffers = kernel->argsBuffers;
+    auto it = std::find_if(buffers.begin(), buffers.end(),
+                           [&](const GPUKernel::ArgsBuffer &buffer) {
+                             return buffer.size == size &&
+                                    isComplete(buffer.event);
+                           });
+    if (it != buffers.end()) {
+      auto ptr = it->ptr;
+      buffers.erase(it);
+      return ptr;
+    }
+  }
+
+  // All buffers are used by the unfinished launches.
+  assert(kernel->queue);
+  auto ptr = sycl::malloc_host(size, *kernel->queue);
+  if (!ptr)
+    throw std::runtime_error("Failed to allocate kernel arguments buffer");
+
+  return ptr;
+}
+
+void releaseGPUKernelArgsBuffer(GPUKernel *kernel, void *buffer, size_t size,
+                                sycl::event event) {
+  assert(kernel);
+  assert(buffer);
+  std::lock_guard<std::mutex> lock(kernel->argsMutex);
+  kernel->argsBuffers.push_back({buffer, size, std::move(event)});
+}
+
 sycl::kernel getSYCLKernel(GPUKernel *kernel) { return kernel->syclKernel; }
 
+/// Launches with values, not seen among the first variants, use the generic
+/// kernel.
+static constexpr size_t MaxKernelSpecializations = 16;
+
+GPUKernel *specializeGPUKernel(GPUKernel *kernel,
+                               const numba::GPUParamDesc *params,
+                               size_t numParams) {
+  assert(kernel->cached);
+  auto &specArgs = kernel->cached->specArgs;
+  if (specArgs.empty())
+    return kernel;
+
+  std::vector<uint64_t> values(specArgs.size());
+  for (size_t i = 0; i < specArgs.size(); ++i) {
+    auto argIndex = specArgs[i].argIndex;
+    if (argIndex >= numParams)
+      return kernel;
+
+    auto &param = params[argIndex];
+    if (param.size <= 0 ||
+        static_cast<size_t>(param.size) > sizeof(uint64_t))
+      return kernel;
+
+    std::memcpy(&values[i], param.data, static_cast<size_t>(param.size));
+  }
+
+  std::lock_guard<std::mutex> lock(kernel->specializedMutex);
+  auto &specialized = kernel->specialized;
+  auto it = specialized.find(values);
+  if (it == specialized.end()) {
+    if (specialized.size() >= MaxKernelSpecializations)
+      return kernel;
+
+    // Flag constant selects the specialized value over the argument.
+    std::vector<GPUSpecConstant> constants;
+    for (size_t i = 0; i < specArgs.size(); ++i) {
+      constants.push_back({specArgs[i].specId, values[i]});
+      constants.push_back({specArgs[i].setSpecId, 1});
+    }
+
+    // Variant is built in background, launches use the generic kernel until
+    // it's ready.
+    auto variant = std::make_unique<GPUKernel::Variant>();
+    assert(kernel->module);
+    variant->build = std::async(
+        std::launch::async, [variant = variant.get(), queue = kernel->queue,
+                             spirv = &kernel->module->spirv,
+                             name = kernel->cached->name.c_str(),
+                             constants = std::move(constants)]() {
+          variant->module.reset(createGPUModule(*queue, spirv->data(),
+                                                spirv->size(), constants.data(),
+                                                constants.size()));
+          variant->kernel.reset(getGPUKernel(variant->module.get(), name));
+        });
+    specialized.emplace(std::move(values), std::move(variant));
+    return kernel;
+  }
+
+  auto &variant = *it->second;
+  if (!variant.ready && variant.build.valid() &&
+      variant.build.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready) {
+    try {
+      variant.build.get();
+      variant.ready = true;
+    } catch (const std::exception &e) {
+      // Failed variants are never retried.
+      fprintf(stdout, "Failed to specialize kernel: %s\n", e.what());
+      fflush(stdout);
+    }
+  }
+  return variant.ready ? variant.kernel.get() : kernel;
+}
+
+const char *getGPUKernelName(GPUKernel *kernel) {
+  assert(kernel->cached);
+  return kernel->cached->name.c_str();
+}
+
 static uint32_t downPow2(uint32_t x) {
   assert(x > 0);
   x |= (x >> 1);
@@ -472,8 +1219,8 @@ static uint32_t upPow2(uint32_t x) {
   return x;
 }
 
-void suggestGPUBlockSize(GPUKernel *kernel, const uint32_t *gridSize,
-                         uint32_t *blockSize, size_t numDims) {
+static void computeGPUBlockSize(GPUKernel *kernel, const uint32_t *gridSize,
+                                uint32_t *blockSize, size_t numDims) {
   assert(numDims > 0 && numDims <= 3);
 
   auto queue = kernel->queue;
@@ -507,3 +1254,102 @@ void suggestGPUBlockSize(GPUKernel *kernel, const uint32_t *gridSize,
     }
   }
 }
+
+/// Max number of different grids, cached per kernel.
+static constexpr size_t MaxCachedBlockSizes = 64;
+
+/// Tuning candidates: suggested size (first launch is warmup and not
+/// measured) and smaller sizes along innermost dimension. Larger sizes are
+/// not tried as they can exceed kernel-specific limits.
+static std::vector<BlockSize> getTuningCandidates(const BlockSize &base) {
+  std::vector<BlockSize> ret = {base, base};
+  for (uint32_t div : {2, 4, 8}) {
+    if (base[0] / div == 0)
+      break;
+
+    auto candidate = base;
+    candidate[0] = base[0] / div;
+    ret.emplace_back(candidate);
+  }
+  return ret;
+}
+
+namespace {
+struct PendingTrial {
+  CachedKernel *kernel = nullptr;
+  BlockSizeKey key = {};
+  size_t index = 0;
+};
+
+/// Block size trial, suggested for the next launch on the current thread.
+static thread_local PendingTrial pendingTrial;
+} // namespace
+
+void suggestGPUBlockSize(GPUKernel *kernel, const uint32_t *gridSize,
+                         uint32_t *blockSize, size_t numDims,
+                         bool allowTuning) {
+  assert(numDims > 0 && numDims <= 3);
+  assert(kernel->cached);
+
+  BlockSizeKey key = {};
+  std::copy_n(gridSize, numDims, key.gridSize);
+  key.numDims = numDims;
+
+  auto &cached = *kernel->cached;
+  std::lock_guard<std::mutex> lock(cached.mutex);
+  auto &blockSizes = cached.blockSizes;
+  auto it = blockSizes.find(key);
+  if (it == blockSizes.end()) {
+    if (blockSizes.size() >= MaxCachedBlockSizes)
+      blockSizes.clear();
+
+    BlockSizeEntry entry;
+    entry.best.fill(1);
+    computeGPUBlockSize(kernel, gridSize, entry.best.data(), numDims);
+    if (allowTuning)
+      entry.candidates = getTuningCandidates(entry.best);
+
+    it = blockSizes.emplace(key, std::move(entry)).first;
+  }
+
+  auto &entry = it->second;
+  if (!allowTuning || entry.next >= entry.candidates.size()) {
+    std::copy_n(entry.best.begin(), numDims, blockSize);
+    return;
+  }
+
+  std::copy_n(entry.candidates[entry.next].begin(), numDims, blockSize);
+  pendingTrial = {&cached, key, entry.next};
+}
+
+bool needGPULaunchTiming(GPUKernel *kernel) {
+  return pendingTrial.kernel && pendingTrial.kernel == kernel->cached;
+}
+
+void reportGPULaunchTime(GPUKernel *kernel, double seconds) {
+  if (!needGPULaunchTiming(kernel))
+    return;
+
+  auto trial = pendingTrial;
+  pendingTrial = {};
+
+  auto &cached = *kernel->cached;
+  std::lock_guard<std::mutex> lock(cached.mutex);
+  auto it = cached.blockSizes.find(trial.key);
+  if (it == cached.blockSizes.end())
+    return;
+
+  auto &entry = it->second;
+  if (trial.index != entry.next)
+    return;
+
+  if (trial.index > 0 && seconds < entry.bestTime) {
+    entry.bestTime = seconds;
+    entry.best = entry.candidates[trial.index];
+  }
+  ++entry.next;
+
+  // Tuning is finished, so later processes can start with the tuned size.
+  if (entry.next == entry.candidates.size())
+    saveBlockSizes(cached);
+}
@@ -4,11 +4,22 @@
 
 #include <CL/sycl.hpp>
 
+#include "GpuCommon.hpp"
+
 struct GPUModule;
 struct GPUKernel;
 
+/// Value for the SPIR-V specialization constant with SpecId `id`.
+struct GPUSpecConstant {
+  uint32_t id;
+  uint64_t value;
+};
+
+/// Modules are cached per device and specialization constants set.
 GPUModule *createGPUModule(sycl::queue &queue, const void *data,
-                           size_t dataSize);
+                           size_t dataSize,
+                           const GPUSpecConstant *specConstants = nullptr,
+                           size_t numSpecConstants = 0);
 void destoyGPUModule(GPUModule *mod);
 
 GPUKernel *getGPUKernel(GPUModule *mod, const char *name);
@@ -16,5 +27,32 @@ void destroyGPUKernel(GPUKernel *kernel);
 
 sycl::kernel getSYCLKernel(GPUKernel *kernel);
 
+/// Returns host USM buffer of `size` bytes for the packed launch arguments of
+/// `kernel`, which is not used by any unfinished launch. Buffers are cached
+/// per kernel, buffer must be returned with the event of the launch, using it.
+void *acquireGPUKernelArgsBuffer(GPUKernel *kernel, size_t size);
+void releaseGPUKernelArgsBuffer(GPUKernel *kernel, void *buffer, size_t size,
+                                sycl::event event);
+
+/// Returns `kernel` variant, specialized for launch argument values, if its
+/// module declares specialization constants for them, or `kernel` itself.
+/// Returned kernel is owned by `kernel`.
+GPUKernel *specializeGPUKernel(GPUKernel *kernel,
+                               const numba::GPUParamDesc *params,
+                               size_t numParams);
+
+/// Returns kernel function name, valid while the module is alive.
+const char *getGPUKernelName(GPUKernel *kernel);
+
+/// Suggested block sizes are cached per kernel and grid size. If
+/// `allowTuning` is set, first launches with new grid size get different
+/// candidate sizes and the fastest one is used afterwards. Tuned sizes are
+/// persisted in the native binaries cache dir, if enabled.
 void suggestGPUBlockSize(GPUKernel *kernel, const uint32_t *gridSize,
-                         uint32_t *blockSize, size_t numDims);
+                         uint32_t *blockSize, size_t numDims,
+                         bool allowTuning);
+
+/// Returns true if block size, suggested for the next launch of `kernel` on
+/// the current thread, is a tuning trial and launch time must be reported.
+bool needGPULaunchTiming(GPUKernel *kernel);
+void reportGPULaunchTime(GPUKernel *kernel, double seconds);
@@ -13,8 +13,17 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "numba-mlir-gpu-runtime-sycl_export.h"
 
@@ -42,6 +51,190 @@ static bool isKernelDumpEnabled() {
   return enable;
 }
 
+/// Max size of the memory, kept in the queue allocation cache, 0 disables
+/// caching.
+static size_t getAllocCacheSize() {
+  static size_t size = []() -> size_t {
+    auto env = std::getenv("NUMBA_MLIR_GPU_ALLOC_CACHE_SIZE");
+    if (!env)
+      return size_t(1) << 30;
+
+    return static_cast<size_t>(std::strtoull(env, nullptr, 10));
+  }();
+  return size;
+}
+
+/// Size of the pinned host buffers, used for host <-> device copies of the
+/// regular host memory, 0 disables staging.
+static size_t getStagingChunkSize() {
+  static size_t size = []() -> size_t {
+    auto env = std::getenv("NUMBA_MLIR_GPU_STAGING_CHUNK_SIZE");
+    if (!env)
+      return size_t(4) << 20;
+
+    return static_cast<size_t>(std::strtoull(env, nullptr, 10));
+  }();
+  return size;
+}
+
+/// Record consecutive async kernel launches into SYCL graph and submit them
+/// at once, graphs with the same topology are reused.
+static bool isGraphModeEnabled() {
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+  static bool enable = []() -> bool {
+    auto env = std::getenv("NUMBA_MLIR_GPU_GRAPHS");
+    return env && std::atoi(env) != 0;
+  }();
+  return enable;
+#else
+  return false;
+#endif
+}
+
+/// Don't wait for the kernels, which only access device USM memory, at the
+/// end of the call. Such events are kept by the queue and all subsequent
+/// launches depend on them, so results can be consumed by the next jitted
+/// calls without host round-trip. Host must call `gpuxSynchronize` before
+/// reading these results by means other than jitted code.
+static bool isDeferredSyncEnabled() {
+  static bool enable = []() -> bool {
+    auto env = std::getenv("NUMBA_MLIR_GPU_DEFERRED_SYNC");
+    return env && std::atoi(env) != 0;
+  }();
+  return enable;
+}
+
+/// Try a few block sizes on the first launches of the kernel with default
+/// local size and keep the fastest one. Tuning launches are synchronous.
+static bool isBlockSizeTuningEnabled() {
+  static bool enable = []() -> bool {
+    auto env = std::getenv("NUMBA_MLIR_GPU_BLOCK_SIZE_TUNING");
+    return env && std::atoi(env) != 0;
+  }();
+  return enable;
+}
+
+/// Collect per-kernel device time from SYCL event profiling info. Kernel
+/// launches become synchronous.
+static bool isProfilingEnabled() {
+  static bool enable = []() -> bool {
+    auto env = std::getenv("NUMBA_MLIR_GPU_PROFILE");
+    return env && std::atoi(env) != 0;
+  }();
+  return enable;
+}
+
+/// Fixed host share of the co-execution sections (see `gpuxCoexecBegin`),
+/// which disables the adaptation.
+static std::optional<double> getCoexecHostRatio() {
+  static std::optional<double> ratio = []() -> std::optional<double> {
+    auto env = std::getenv("NUMBA_MLIR_GPU_COEXEC_RATIO");
+    if (!env)
+      return std::nullopt;
+
+    return std::clamp(std::strtod(env, nullptr), 0.0, 1.0);
+  }();
+  return ratio;
+}
+
+struct KernelProfile {
+  /// Device execution time of each launch.
+  std::vector<uint64_t> deviceTimesNs;
+
+  /// Total time between submission and execution start.
+  uint64_t queueLatencyNs = 0;
+};
+
+struct ProfileStorage {
+  std::mutex mutex;
+  std::vector<std::pair<std::string, KernelProfile>> kernels;
+  std::unordered_map<std::string, size_t> indices;
+};
+
+static ProfileStorage &getProfileStorage() {
+  static ProfileStorage storage;
+  return storage;
+}
+
+static void addKernelProfile(const char *name, const sycl::event &event) {
+  using namespace sycl::info;
+  auto submit = event.get_profiling_info<event_profiling::command_submit>();
+  auto start = event.get_profiling_info<event_profiling::command_start>();
+  auto end = event.get_profiling_info<event_profiling::command_end>();
+
+  auto &storage = getProfileStorage();
+  std::lock_guard<std::mutex> lock(storage.mutex);
+  auto it = storage.indices.find(name);
+  if (it == storage.indices.end()) {
+    it = storage.indices.emplace(name, storage.kernels.size()).first;
+    storage.kernels.emplace_back(name, KernelProfile{});
+  }
+  auto &profile = storage.kernels[it->second].second;
+  profile.deviceTimesNs.emplace_back(end - start);
+  profile.queueLatencyNs += start - submit;
+}
+
+/// Track live and peak device memory, allocated by compiled code, per device.
+static bool isMemoryProfileEnabled() {
+  static bool enable = []() -> bool {
+    auto env = std::getenv("NUMBA_MLIR_MEMORY_PROFILE");
+    return env && std::atoi(env) != 0;
+  }();
+  return enable;
+}
+
+struct DeviceMemoryProfile {
+  uint64_t allocs = 0;
+  uint64_t allocatedBytes = 0;
+  uint64_t liveBytes = 0;
+  uint64_t peakBytes = 0;
+};
+
+struct MemoryProfileStorage {
+  std::mutex mutex;
+
+  /// Deque, so returned names are not invalidated by new devices.
+  std::deque<std::pair<std::string, DeviceMemoryProfile>> devices;
+  std::unordered_map<std::string, size_t> indices;
+
+  /// Live allocation -> device index and size.
+  std::unordered_map<void *, std::pair<size_t, size_t>> allocs;
+};
+
+static MemoryProfileStorage &getMemoryProfileStorage() {
+  static MemoryProfileStorage storage;
+  return storage;
+}
+
+static void addAllocProfile(const std::string &device, void *ptr,
+                            size_t size) {
+  auto &storage = getMemoryProfileStorage();
+  std::lock_guard<std::mutex> lock(storage.mutex);
+  auto it = storage.indices.find(device);
+  if (it == storage.indices.end()) {
+    it = storage.indices.emplace(device, storage.devices.size()).first;
+    storage.devices.emplace_back(device, DeviceMemoryProfile{});
+  }
+  auto &profile = storage.devices[it->second].second;
+  ++profile.allocs;
+  profile.allocatedBytes += size;
+  profile.liveBytes += size;
+  profile.peakBytes = std::max(profile.peakBytes, profile.liveBytes);
+  storage.allocs[ptr] = {it->second, size};
+}
+
+static void removeAllocProfile(void *ptr) {
+  auto &storage = getMemoryProfileStorage();
+  std::lock_guard<std::mutex> lock(storage.mutex);
+  auto it = storage.allocs.find(ptr);
+  if (it == storage.allocs.end())
+    return;
+
+  auto [index, size] = it->second;
+  storage.devices[index].second.liveBytes -= size;
+  storage.allocs.erase(it);
+}
+
 static void dumpKernelBlob(const void *data, size_t size) {
   assert(data);
   if (!isKernelDumpEnabled())
@@ -78,6 +271,40 @@ private:
   const char *name;
   bool enable;
 };
+
+/// Trace event sink, `nmrtTraceEvent` signature.
+using TraceFunc = void (*)(const char *name, const char *category,
+                           uint64_t beginNs, uint64_t endNs);
+
+/// Set from python when tracing is enabled, null otherwise.
+static std::atomic<TraceFunc> traceFunc{nullptr};
+
+/// Must be kept in sync with `nmrtTraceNow` in `Trace.cpp`.
+static uint64_t getTraceNow() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+/// Records scope host time as a trace event, if tracing is enabled.
+struct TraceScope {
+  TraceScope(const char *name)
+      : name(name), func(traceFunc.load(std::memory_order_relaxed)) {
+    if (func)
+      begin = getTraceNow();
+  }
+  TraceScope(const TraceScope &) = delete;
+  ~TraceScope() {
+    if (func)
+      func(name, "gpu", begin, getTraceNow());
+  }
+
+private:
+  const char *name;
+  TraceFunc func;
+  uint64_t begin = 0;
+};
 } // namespace
 #define LOG_FUNC() FuncScope _scope(__func__)
 
@@ -97,6 +324,16 @@ template <typename T> static size_t countUntil(T *ptr, T &&elem) {
   return static_cast<size_t>(curr - ptr);
 }
 
+/// Params array is terminated by the param with `null` type.
+static size_t countParams(const numba::GPUParamDesc *params) {
+  assert(params);
+  size_t count = 0;
+  while (params[count].type != numba::GpuParamType::null)
+    ++count;
+
+  return count;
+}
+
 template <typename T> static auto countEvents(T **events) {
   assert(events);
   return static_cast<uint32_t>(countUntil(events, static_cast<T *>(nullptr)));
@@ -114,21 +351,438 @@ static void *checkAlloc(void *mem, const char *err) {
 
 struct EventStorage {
   sycl::event event;
-  std::unique_ptr<EventStorage> next;
+
+  /// Pool index + 1 of this event and the next free one, 0 means null.
+  uint32_t index = 0;
+  std::atomic<uint32_t> next = {0};
+
+  /// Event belongs to the kernel launch, only accessing device USM memory,
+  /// its wait can be deferred, see `isDeferredSyncEnabled`.
+  bool deviceOnly = false;
 };
 static_assert(offsetof(EventStorage, event) == 0, "Event must be first");
 
+/// Initial number of events, preallocated per queue.
+static size_t getEventPoolSize() {
+  static size_t size = []() -> size_t {
+    auto env = std::getenv("NUMBA_MLIR_GPU_EVENT_POOL_SIZE");
+    if (!env)
+      return 64;
+
+    return std::max<size_t>(1, std::strtoull(env, nullptr, 10));
+  }();
+  return size;
+}
+
+/// Thread-safe lock-free pool of events.
+///
+/// Events are stored in geometrically growing chunks, which are never freed
+/// until pool destruction, so free list can refer to them by index. Free list
+/// head is a (tag, index) pair to avoid ABA problem. Only pool growth takes a
+/// lock.
+class EventPool {
+public:
+  EventPool(size_t initialSize) {
+    firstChunkSize = std::max<size_t>(1, initialSize);
+    std::lock_guard<std::mutex> lock(growMutex);
+    grow();
+  }
+  EventPool(const EventPool &) = delete;
+
+  ~EventPool() {
+    for (auto &chunk : chunks)
+      delete[] chunk.load(std::memory_order_relaxed);
+  }
+
+  EventStorage *get() {
+    while (true) {
+      auto head = freeHead.load(std::memory_order_acquire);
+      auto index = getIndex(head);
+      if (index == 0) {
+        std::lock_guard<std::mutex> lock(growMutex);
+        if (getIndex(freeHead.load(std::memory_order_acquire)) == 0)
+          grow();
+
+        continue;
+      }
+
+      auto *event = at(index);
+      auto next = event->next.load(std::memory_order_relaxed);
+      if (freeHead.compare_exchange_weak(head, makeHead(getTag(head) + 1, next),
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire)) {
+        event->next.store(0, std::memory_order_relaxed);
+        return event;
+      }
+    }
+  }
+
+  void put(EventStorage *event) {
+    assert(event);
+    assert(event->index != 0);
+    event->event = sycl::event{};
+    auto head = freeHead.load(std::memory_order_relaxed);
+    do {
+      event->next.store(getIndex(head), std::memory_order_relaxed);
+    } while (!freeHead.compare_exchange_weak(
+        head, makeHead(getTag(head) + 1, event->index),
+        std::memory_order_release, std::memory_order_relaxed));
+  }
+
+private:
+  static constexpr size_t MaxChunks = 24;
+
+  std::atomic<EventStorage *> chunks[MaxChunks] = {};
+  std::atomic<size_t> numChunks = {0};
+  size_t firstChunkSize = 0;
+  std::mutex growMutex;
+  std::atomic<uint64_t> freeHead = {0};
+
+  static uint32_t getIndex(uint64_t head) {
+    return static_cast<uint32_t>(head);
+  }
+
+  static uint32_t getTag(uint64_t head) {
+    return static_cast<uint32_t>(head >> 32);
+  }
+
+  static uint64_t makeHead(uint32_t tag, uint32_t index) {
+    return (static_cast<uint64_t>(tag) << 32) | index;
+  }
+
+  size_t getChunkSize(size_t chunk) const { return firstChunkSize << chunk; }
+
+  EventStorage *at(uint32_t index) const {
+    assert(index != 0);
+    size_t i = index - 1;
+    for (size_t chunk = 0;; ++chunk) {
+      auto size = getChunkSize(chunk);
+      if (i < size)
+        return chunks[chunk].load(std::memory_order_acquire) + i;
+
+      i -= size;
+    }
+  }
+
+  /// Adds new chunk to the free list, must be called under `growMutex`.
+  void grow() {
+    auto chunk = numChunks.load(std::memory_order_relaxed);
+    if (chunk >= MaxChunks)
+      throw std::runtime_error("Event pool exhausted");
+
+    size_t offset = 0;
+    for (size_t i = 0; i < chunk; ++i)
+      offset += getChunkSize(i);
+
+    auto size = getChunkSize(chunk);
+    if (offset + size > std::numeric_limits<uint32_t>::max())
+      throw std::runtime_error("Event pool exhausted");
+
+    auto *events = new EventStorage[size];
+    for (size_t i = 0; i < size; ++i) {
+      events[i].index = static_cast<uint32_t>(offset + i + 1);
+      events[i].next.store(i + 1 < size ? static_cast<uint32_t>(offset + i + 2)
+                                        : 0,
+                           std::memory_order_relaxed);
+    }
+    chunks[chunk].store(events, std::memory_order_release);
+    numChunks.store(chunk + 1, std::memory_order_relaxed);
+
+    // Link last chunk element to the current free list.
+    auto &last = events[size - 1];
+    auto head = freeHead.load(std::memory_order_relaxed);
+    do {
+      last.next.store(getIndex(head), std::memory_order_relaxed);
+    } while (!freeHead.compare_exchange_weak(
+        head, makeHead(getTag(head) + 1, events[0].index),
+        std::memory_order_release, std::memory_order_relaxed));
+  }
+};
+
+static bool isComplete(const sycl::event &event) {
+  return event.get_info<sycl::info::event::command_execution_status>() ==
+         sycl::info::event_command_status::complete;
+}
+
+/// Size-class caching allocator for USM memory.
+///
+/// Freed blocks are not returned to the driver, but kept with the event,
+/// signalling completion of all the work submitted before the free. Blocks are
+/// handed out immediately and consumers must depend on the returned
+/// event, so reuse is ordered after all previous users of the block.
+class AllocCache {
+public:
+  AllocCache(sycl::queue &q) : queue(q) {}
+  AllocCache(const AllocCache &) = delete;
+  ~AllocCache() { trim(0); }
+
+  /// Returns pointer and event which must be waited before block can be used.
+  std::tuple<void *, sycl::event> alloc(size_t size, size_t alignment,
+                                        numba::GpuAllocType type) {
+    auto sizeClass = getSizeClass(size);
+    auto maxCached = getAllocCacheSize();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (maxCached != 0) {
+      Key key{sizeClass, type};
+      auto it = freeBlocks.find(key);
+      if (it != freeBlocks.end() && !it->second.empty())
+        if (auto res = takeBlock(key, it->second, alignment))
+          return std::move(*res);
+    }
+
+    auto *mem = allocImpl(sizeClass, alignment, type);
+    if (!mem) {
+      // Return cached memory to the driver and retry.
+      trimImpl(0);
+      mem = allocImpl(sizeClass, alignment, type);
+    }
+    if (!mem)
+      throw std::runtime_error("Failed to allocate memory");
+
+    liveBlocks[mem] = Key{sizeClass, type};
+    return {mem, sycl::event{}};
+  }
+
+  void free(void *ptr) {
+    assert(ptr);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = liveBlocks.find(ptr);
+    assert(it != liveBlocks.end());
+    auto key = it->second;
+    liveBlocks.erase(it);
+
+    auto maxCached = getAllocCacheSize();
+    if (maxCached == 0 || key.size > maxCached) {
+      // Deferred launches can still use the block.
+      if (isDeferredSyncEnabled())
+        queue.ext_oneapi_submit_barrier().wait();
+
+      sycl::free(ptr, queue);
+      return;
+    }
+
+    // Block can be reused after all the work, submitted before this point.
+    auto event = queue.ext_oneapi_submit_barrier();
+    freeBlocks[key].emplace_back(FreeBlock{ptr, std::move(event), ++counter});
+    cachedSize += key.size;
+    if (cachedSize > maxCached)
+      trimImpl(maxCached);
+  }
+
+  /// Release cached blocks until cache size is not bigger than `maxSize`.
+  void trim(size_t maxSize) {
+    std::lock_guard<std::mutex> lock(mutex);
+    trimImpl(maxSize);
+  }
+
+private:
+  struct Key {
+    size_t size;
+    numba::GpuAllocType type;
+
+    bool operator==(const Key &rhs) const {
+      return size == rhs.size && type == rhs.type;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      return std::hash<size_t>{}(key.size) ^
+             (static_cast<size_t>(key.type) << 1);
+    }
+  };
+
+  struct FreeBlock {
+    void *ptr;
+    sycl::event event;
+    uint64_t order;
+  };
+
+  sycl::queue &queue;
+  std::mutex mutex;
+  std::unordered_map<Key, std::vector<FreeBlock>, KeyHash> freeBlocks;
+  std::unordered_map<void *, Key> liveBlocks;
+  size_t cachedSize = 0;
+  uint64_t counter = 0;
+
+  static size_t getSizeClass(size_t size) {
+    // Power of 2 classes up to 64MB, 2MB granularity after.
+    constexpr size_t MinSize = 256;
+    constexpr size_t MaxPow2Size = size_t(64) << 20;
+    constexpr size_t LargeGranularity = size_t(2) << 20;
+    if (size <= MinSize)
+      return MinSize;
+
+    if (size > MaxPow2Size)
+      return (size + LargeGranularity - 1) / LargeGranularity *
+             LargeGranularity;
+
+    size_t ret = MinSize;
+    while (ret < size)
+      ret *= 2;
+
+    return ret;
+  }
+
+  std::optional<std::tuple<void *, sycl::event>>
+  takeBlock(const Key &key, std::vector<FreeBlock> &blocks, size_t alignment) {
+    // Prefer blocks which are already safe to reuse, otherwise take the most
+    // recent one and let consumer depend on its event.
+    auto suitable = [&](const FreeBlock &block) {
+      return alignment == 0 ||
+             reinterpret_cast<uintptr_t>(block.ptr) % alignment == 0;
+    };
+    auto best = blocks.end();
+    for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+      if (!suitable(*it))
+        continue;
+
+      if (isComplete(it->event)) {
+        best = it;
+        break;
+      }
+      best = it;
+    }
+    if (best == blocks.end())
+      return std::nullopt;
+
+    auto block = std::move(*best);
+    blocks.erase(best);
+    liveBlocks[block.ptr] = key;
+    cachedSize -= key.size;
+    if (isComplete(block.event))
+      return std::tuple<void *, sycl::event>(block.ptr, sycl::event{});
+
+    return std::tuple<void *, sycl::event>(block.ptr, std::move(block.event));
+  }
+
+  void *allocImpl(size_t size, size_t alignment, numba::GpuAllocType type) {
+    if (type == numba::GpuAllocType::Device)
+      return sycl::aligned_alloc_device(alignment, size, queue);
+
+    if (type == numba::GpuAllocType::Shared)
+      return sycl::aligned_alloc_shared(alignment, size, queue);
+
+    if (type == numba::GpuAllocType::Host)
+      return sycl::aligned_alloc_host(alignment, size, queue);
+
+    throw std::runtime_error("Invalid allocation type");
+  }
+
+  void trimImpl(size_t maxSize) {
+    // Release oldest blocks first.
+    while (cachedSize > maxSize) {
+      std::vector<FreeBlock> *oldestList = nullptr;
+      size_t oldestSize = 0;
+      for (auto &&[key, list] : freeBlocks) {
+        if (list.empty())
+          continue;
+
+        if (!oldestList || list.front().order < oldestList->front().order) {
+          oldestList = &list;
+          oldestSize = key.size;
+        }
+      }
+      if (!oldestList)
+        break;
+
+      auto block = std::move(oldestList->front());
+      oldestList->erase(oldestList->begin());
+      block.event.wait();
+      sycl::free(block.ptr, queue);
+      cachedSize -= oldestSize;
+    }
+  }
+};
+
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+namespace syclexp = sycl::ext::oneapi::experimental;
+
+/// Launches recorded since the last flush.
+struct GraphRecording {
+  GraphRecording(sycl::queue &queue)
+      : graph(queue.get_context(), queue.get_device()) {}
+
+  syclexp::command_graph<syclexp::graph_state::modifiable> graph;
+
+  /// Events, produced by recorded launches, are only valid inside graph and
+  /// are replaced with graph submission event on flush. Events, destroyed
+  /// before the flush, are set to null, as their storage can be reused.
+  std::vector<EventStorage *> events;
+  std::unordered_map<EventStorage *, size_t> eventIndices;
+
+  /// Dependencies on the work outside of the graph.
+  std::vector<sycl::event> externalDeps;
+
+  /// Prefetches, issued during recording. They are not recorded, as graph
+  /// update only changes kernel args, and are submitted directly to the queue
+  /// on flush.
+  std::vector<std::pair<const void *, size_t>> prefetches;
+
+  /// Graph topology: kernels, ranges, param types and dependencies, but not
+  /// param values.
+  std::string signature;
+
+  template <typename T> void addSignature(const T &val) {
+    signature.append(reinterpret_cast<const char *>(&val), sizeof(val));
+  }
+};
+
+/// Max number of executable graphs, cached per queue.
+static constexpr size_t MaxCachedGraphs = 64;
+#endif
+
+class Queue;
+
+/// Kernel waits on the current thread are deferred while `depth` is non-zero,
+/// `queues` hold the deferred launches. See `gpuxConcurrentBegin`.
+struct ConcurrentSection {
+  int depth = 0;
+  std::vector<Queue *> queues;
+};
+
+static ConcurrentSection &getConcurrentSection() {
+  static thread_local ConcurrentSection section;
+  return section;
+}
+
 class Queue : public numba::GPUQueueInterface {
 public:
   Queue(const char *devName) : deviceName(devName ? devName : "") {
     LOG_FUNC();
-    queue = sycl::queue{sycl::device{getDeviceSelector(deviceName)}};
+    // Out-of-order queue, all the ordering is only defined by the explicit
+    // events, generated by the compiler, so independent launches can already
+    // overlap. There are no explicit host-device copies, as all the device
+    // memory is USM.
+    sycl::device device{getDeviceSelector(deviceName)};
+    if (isProfilingEnabled()) {
+      queue = sycl::queue{device, sycl::property::queue::enable_profiling{}};
+    } else {
+      queue = sycl::queue{device};
+    }
+    init();
+  }
+
+  /// Wraps existing sycl queue, e.g. the one owned by the caller arrays, so
+  /// launches are submitted directly into it.
+  Queue(const char *devName, sycl::queue q)
+      : queue(std::move(q)), deviceName(devName ? devName : "") {
+    LOG_FUNC();
+    init();
   }
   Queue(const Queue &) = delete;
-  ~Queue() { LOG_FUNC(); }
+  ~Queue() {
+    LOG_FUNC();
+    flushGraph();
+    synchronize();
+  }
 
   std::string_view getDeviceName() override { return deviceName; }
 
+  /// Submit deferred work, called when function context releases the queue,
+  /// as cached queue outlives it.
+  void flush() { flushGraph(); }
+
   sycl::queue *getQueue() override { return &queue; }
 
   void retain() { ++refcout; }
@@ -149,6 +803,7 @@ public:
 
   GPUModule *loadModule(const void *data, size_t dataSize) {
     assert(data);
+    flushGraph();
     dumpKernelBlob(data, dataSize);
     return createGPUModule(queue, data, dataSize);
   }
@@ -169,14 +824,16 @@ public:
     destroyGPUKernel(kernel);
   }
 
+  /// If `packed` is set, kernel gets all `params` in the single buffer
+  /// argument, see `packParams`.
   EventStorage *launchKernel(GPUKernel *kernel, size_t gridX, size_t gridY,
                              size_t gridZ, size_t blockX, size_t blockY,
                              size_t blockZ, EventStorage **srcEvents,
-                             numba::GPUParamDesc *params) {
+                             numba::GPUParamDesc *params, bool packed) {
     assert(kernel);
+    TraceScope trace(getGPUKernelName(kernel));
     auto eventsCount = countEvents(srcEvents);
-    auto paramsCount = countUntil(
-        params, numba::GPUParamDesc{nullptr, 0, numba::GpuParamType::null});
+    auto paramsCount = countParams(params);
 
     auto *evStorage = getEvent();
     assert(evStorage);
@@ -185,65 +842,286 @@ public:
         sycl::range<3>(blockZ * gridZ, blockY * gridY, blockX * gridX);
     auto localRange = ::sycl::range<3>(blockZ, blockY, blockX);
     auto ndRange = sycl::nd_range<3>(globalRange, localRange);
-    auto syclKernel = getSYCLKernel(kernel);
+
+    // Block sizes and tuning are tracked for the generic kernel.
+    auto variant = specializeGPUKernel(kernel, params, paramsCount);
+    auto syclKernel = getSYCLKernel(variant);
+
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+    // Packed buffers are reused after the launch event, which is not known
+    // until the graph is submitted, so packed launches are not recorded.
+    if (packed) {
+      flushGraph();
+    } else if (isGraphModeEnabled()) {
+      std::lock_guard<std::mutex> lock(graphMutex);
+      if (!recording) {
+        recording = std::make_unique<GraphRecording>(queue);
+        recording->graph.begin_recording(queue);
+      }
+
+      auto &rec = *recording;
+      rec.addSignature(variant);
+      rec.addSignature(globalRange);
+      rec.addSignature(localRange);
+      for (decltype(paramsCount) i = 0; i < paramsCount; i++) {
+        rec.addSignature(params[i].type);
+        rec.addSignature(params[i].size);
+      }
+
+      std::vector<sycl::event> internalDeps;
+      for (decltype(eventsCount) i = 0; i < eventsCount; ++i) {
+        auto event = srcEvents[i];
+        assert(event);
+        auto it = rec.eventIndices.find(event);
+        if (it != rec.eventIndices.end()) {
+          rec.addSignature(it->second);
+          internalDeps.emplace_back(event->event);
+        } else {
+          rec.addSignature(size_t(-1));
+          rec.externalDeps.emplace_back(event->event);
+        }
+      }
+      rec.addSignature(size_t(-2));
+
+      evStorage->event = queue.submit([&](sycl::handler &cgh) {
+        cgh.depends_on(internalDeps);
+        for (decltype(paramsCount) i = 0; i < paramsCount; i++)
+          setKernelArg(cgh, static_cast<uint32_t>(i), params[i]);
+
+        cgh.parallel_for(ndRange, syclKernel);
+      });
+      rec.eventIndices[evStorage] = rec.events.size();
+      rec.events.emplace_back(evStorage);
+      return evStorage;
+    }
+#endif
+
+    // Block size tuning trial, measure kernel alone.
+    bool timed = needGPULaunchTiming(kernel);
+    if (timed) {
+      for (decltype(eventsCount) i = 0; i < eventsCount; ++i)
+        srcEvents[i]->event.wait();
+
+      synchronize();
+    }
+
+    // Launches from the previous calls, which were not waited, can produce
+    // this launch inputs.
+    std::vector<sycl::event> deferredDeps;
+    bool deferred = isDeferredSyncEnabled();
+    if (deferred || getConcurrentSection().depth > 0) {
+      std::lock_guard<std::mutex> lock(pendingMutex);
+      deferredDeps = pending;
+    }
+    evStorage->deviceOnly =
+        deferred && !timed && isDeviceOnly(params, paramsCount);
+
+    void *packedParams = nullptr;
+    size_t packedSize = 0;
+    if (packed)
+      std::tie(packedParams, packedSize) =
+          packParams(kernel, params, paramsCount);
+
+    auto start = std::chrono::steady_clock::now();
     evStorage->event = queue.submit([&](sycl::handler &cgh) {
       for (decltype(eventsCount) i = 0; i < eventsCount; ++i) {
         auto event = srcEvents[i];
         assert(event);
         cgh.depends_on(event->event);
       }
+      cgh.depends_on(deferredDeps);
 
-      for (decltype(paramsCount) i = 0; i < paramsCount; i++)
-        setKernelArg(cgh, static_cast<uint32_t>(i), params[i]);
+      if (packed) {
+        cgh.set_arg(0, packedParams);
+      } else {
+        for (decltype(paramsCount) i = 0; i < paramsCount; i++)
+          setKernelArg(cgh, static_cast<uint32_t>(i), params[i]);
+      }
 
       cgh.parallel_for(ndRange, syclKernel);
     });
+    if (packed)
+      releaseGPUKernelArgsBuffer(kernel, packedParams, packedSize,
+                                 evStorage->event);
+
+    if (timed) {
+      evStorage->event.wait();
+      std::chrono::duration<double> time =
+          std::chrono::steady_clock::now() - start;
+      reportGPULaunchTime(kernel, time.count());
+    }
+
+    if (isProfilingEnabled()) {
+      evStorage->event.wait();
+      addKernelProfile(getGPUKernelName(kernel), evStorage->event);
+    }
 
     return evStorage;
   }
 
   void waitEvent(EventStorage *event) {
     assert(event);
+    TraceScope trace("wait");
+    flushGraph();
+    auto &section = getConcurrentSection();
+    bool concurrent = section.depth > 0;
+    if ((event->deviceOnly || concurrent) && !isProfilingEnabled()) {
+      {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        prunePending();
+        pending.emplace_back(event->event);
+      }
+      if (concurrent && std::find(section.queues.begin(), section.queues.end(),
+                                  this) == section.queues.end()) {
+        retain();
+        section.queues.emplace_back(this);
+      }
+      return;
+    }
+
     event->event.wait();
   }
 
   void destroyEvent(EventStorage *event) {
     assert(event);
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+    if (isGraphModeEnabled()) {
+      std::lock_guard<std::mutex> lock(graphMutex);
+      if (recording) {
+        auto &rec = *recording;
+        auto it = rec.eventIndices.find(event);
+        if (it != rec.eventIndices.end()) {
+          rec.events[it->second] = nullptr;
+          rec.eventIndices.erase(it);
+        }
+      }
+    }
+#endif
+    event->deviceOnly = false;
     returnEvent(event);
   }
 
+  /// Waits for all the launches, which wait was deferred.
+  void synchronize() {
+    TraceScope trace("synchronize");
+    std::vector<sycl::event> events;
+    {
+      std::lock_guard<std::mutex> lock(pendingMutex);
+      events = std::move(pending);
+      pending.clear();
+    }
+    sycl::event::wait(events);
+  }
+
+  /// Copies `size` bytes between any host and USM memory. Copies of the
+  /// regular (pageable) host memory, larger than a staging chunk, go through
+  /// two pinned host buffers, so the device transfer of one chunk overlaps
+  /// with the host copy of the next.
+  void copy(void *dst, const void *src, size_t size) {
+    TraceScope trace("copy");
+    flushGraph();
+    // Deferred launches can produce `src` or use `dst`.
+    synchronize();
+
+    auto ctx = queue.get_context();
+    auto isPageable = [&](const void *ptr) {
+      return sycl::get_pointer_type(ptr, ctx) == sycl::usm::alloc::unknown;
+    };
+    bool srcPageable = isPageable(src);
+    bool dstPageable = isPageable(dst);
+    auto chunkSize = getStagingChunkSize();
+    if (srcPageable == dstPageable || chunkSize == 0 || size <= chunkSize) {
+      queue.memcpy(dst, src, size).wait();
+      return;
+    }
+
+    // Staging buffers are returned to the allocation cache and reused by the
+    // subsequent copies.
+    struct StagingBuffers {
+      AllocCache &cache;
+      void *data[2] = {};
+      ~StagingBuffers() {
+        for (auto ptr : data)
+          if (ptr)
+            cache.free(ptr);
+      }
+    } staging{*allocCache};
+    auto &buffers = staging.data;
+    sycl::event events[2];
+    for (int i = 0; i < 2; ++i) {
+      std::tie(buffers[i], events[i]) =
+          allocCache->alloc(chunkSize, 0, numba::GpuAllocType::Host);
+      events[i].wait();
+    }
+
+    auto dstData = static_cast<char *>(dst);
+    auto srcData = static_cast<const char *>(src);
+    auto numChunks = (size + chunkSize - 1) / chunkSize;
+    auto getChunk = [&](size_t i) {
+      auto offset = i * chunkSize;
+      return std::pair(offset, std::min(chunkSize, size - offset));
+    };
+    if (srcPageable) {
+      for (size_t i = 0; i < numChunks; ++i) {
+        auto [offset, len] = getChunk(i);
+        auto &event = events[i % 2];
+        // Wait for the previous transfer from this buffer.
+        event.wait();
+        std::memcpy(buffers[i % 2], srcData + offset, len);
+        event = queue.memcpy(dstData + offset, buffers[i % 2], len);
+      }
+      sycl::event::wait({events[0], events[1]});
+    } else {
+      auto submit = [&](size_t i) {
+        auto [offset, len] = getChunk(i);
+        events[i % 2] = queue.memcpy(buffers[i % 2], srcData + offset, len);
+      };
+      submit(0);
+      for (size_t i = 0; i < numChunks; ++i) {
+        if (i + 1 < numChunks)
+          submit(i + 1);
+
+        auto [offset, len] = getChunk(i);
+        events[i % 2].wait();
+        std::memcpy(dstData + offset, buffers[i % 2], len);
+      }
+    }
+  }
+
   std::tuple<void *, EventStorage *> allocBuffer(size_t size, size_t alignment,
                                                  numba::GpuAllocType type,
                                                  EventStorage **srcEvents) {
-    // Alloc is always sync for now, synchronize
+    TraceScope trace("alloc");
+    flushGraph();
     auto eventsCount = countEvents(srcEvents);
+    auto *evStorage = getEvent();
+
+    // Local allocs are handled specially, do not allocate any pointer on host
+    // side.
+    void *mem = nullptr;
+    sycl::event memEvent;
+    if (type != numba::GpuAllocType::Local) {
+      std::tie(mem, memEvent) = allocCache->alloc(size, alignment, type);
+      if (mem && isMemoryProfileEnabled())
+        addAllocProfile(profileDeviceName, mem, size);
+    } else {
+      memEvent = sycl::event{};
+    }
+
+    // Alloc doesn't block, returned event depends on source events and on the
+    // previous users of the reused block.
+    std::vector<sycl::event> deps;
+    deps.reserve(eventsCount + 1);
     for (decltype(eventsCount) i = 0; i < eventsCount; ++i) {
       auto event = srcEvents[i];
       assert(event);
-      event->event.wait();
+      deps.emplace_back(event->event);
     }
+    if (mem && !isComplete(memEvent))
+      deps.emplace_back(std::move(memEvent));
 
-    auto *evStorage = getEvent();
-
-    auto mem = [&]() -> void * {
-      void *ret = nullptr;
-      if (type == numba::GpuAllocType::Device) {
-        ret = CHECK_ALLOC(sycl::aligned_alloc_device(alignment, size, queue),
-                          device);
-      } else if (type == numba::GpuAllocType::Shared) {
-        ret = CHECK_ALLOC(sycl::aligned_alloc_shared(alignment, size, queue),
-                          shared);
-      } else if (type == numba::GpuAllocType::Local) {
-        // Local allocs are handled specially, do not allocate any pointer on
-        // host side.
-      } else if (type == numba::GpuAllocType::Host) {
-        ret = CHECK_ALLOC(sycl::aligned_alloc_host(alignment, size, queue),
-                          shared);
-      } else {
-        throw std::runtime_error("Invalid allocation type");
-      }
-      return ret;
-    }();
+    evStorage->event =
+        deps.empty() ? sycl::event{} : queue.ext_oneapi_submit_barrier(deps);
 
     // Prolong gpu_runtime lifetime until all buffers are released (in case we
     // need to return allocated buffer from function).
@@ -252,36 +1130,160 @@ public:
   }
 
   void deallocBuffer(void *ptr) {
-    if (ptr)
-      sycl::free(ptr, queue);
+    TraceScope trace("dealloc");
+    flushGraph();
+    if (ptr) {
+      if (isMemoryProfileEnabled())
+        removeAllocProfile(ptr);
+
+      allocCache->free(ptr);
+    }
 
     // We are incrementing runtime refcount in alloc.
     release();
   }
 
+  /// Starts migration of the shared USM range to the device. This is only a
+  /// hint, so it doesn't wait and isn't ordered with the subsequent launches.
+  void prefetch(const void *ptr, size_t size) {
+    TraceScope trace("prefetch");
+    if (!ptr || size == 0)
+      return;
+
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+    // Queue is in recording mode, defer prefetch until the graph submission.
+    std::unique_lock<std::mutex> lock(graphMutex, std::defer_lock);
+    if (isGraphModeEnabled())
+      lock.lock();
+
+    if (recording) {
+      auto &prefetches = recording->prefetches;
+      std::pair<const void *, size_t> range(ptr, size);
+      if (std::find(prefetches.begin(), prefetches.end(), range) ==
+          prefetches.end())
+        prefetches.emplace_back(range);
+
+      return;
+    }
+#endif
+    queue.prefetch(ptr, size);
+  }
+
   void suggestBlockSize(GPUKernel *kernel, const uint32_t *gridSize,
                         uint32_t *blockSize, size_t numDims) {
     assert(kernel);
-    suggestGPUBlockSize(kernel, gridSize, blockSize, numDims);
+    // Graph launches are deferred and can't be timed.
+    bool allowTuning = isBlockSizeTuningEnabled() && !isGraphModeEnabled();
+    suggestGPUBlockSize(kernel, gridSize, blockSize, numDims, allowTuning);
   }
 
 private:
   std::atomic<unsigned> refcout = {1};
   sycl::queue queue;
 
-  std::unique_ptr<EventStorage> events;
+  EventPool events{getEventPoolSize()};
   std::string deviceName;
 
-  EventStorage *getEvent() {
-    EventStorage *ret = nullptr;
-    if (!events) {
-      ret = new EventStorage;
-    } else {
-      std::unique_ptr<EventStorage> ev = std::move(events);
-      events = std::move(ev->next);
-      ret = ev.release();
-      ;
+  /// Device info name for the memory profile, as `deviceName` can be empty.
+  std::string profileDeviceName;
+
+  // Must be destroyed before the queue.
+  std::unique_ptr<AllocCache> allocCache;
+
+  /// Events of the launches with deferred wait.
+  std::mutex pendingMutex;
+  std::vector<sycl::event> pending;
+
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+  /// Protects `recording` and `graphCache`, as queue can be shared between
+  /// threads.
+  std::mutex graphMutex;
+  std::unique_ptr<GraphRecording> recording;
+  std::unordered_map<
+      std::string, syclexp::command_graph<syclexp::graph_state::executable>>
+      graphCache;
+#endif
+
+  void init() {
+    allocCache = std::make_unique<AllocCache>(queue);
+    if (isMemoryProfileEnabled())
+      profileDeviceName =
+          queue.get_device().get_info<sycl::info::device::name>();
+  }
+
+  /// Removes completed events from the pending list, must be called under
+  /// `pendingMutex`.
+  void prunePending() {
+    pending.erase(std::remove_if(pending.begin(), pending.end(),
+                                 [](const sycl::event &e) {
+                                   return isComplete(e);
+                                 }),
+                  pending.end());
+  }
+
+  /// Checks if all kernel pointer params point to device USM memory, which
+  /// host cannot access directly.
+  bool isDeviceOnly(const numba::GPUParamDesc *params, size_t count) const {
+    auto ctx = queue.get_context();
+    for (size_t i = 0; i < count; ++i) {
+      auto &param = params[i];
+      if (param.type != numba::GpuParamType::ptr || !param.data)
+        continue;
+
+      auto ptr = *static_cast<void *const *>(param.data);
+      if (ptr && sycl::get_pointer_type(ptr, ctx) != sycl::usm::alloc::device)
+        return false;
     }
+    return true;
+  }
+
+  /// Submit recorded launches, if any, and update their events.
+  void flushGraph() {
+#ifdef SYCL_EXT_ONEAPI_GRAPH
+    if (!isGraphModeEnabled())
+      return;
+
+    std::lock_guard<std::mutex> lock(graphMutex);
+    if (!recording)
+      return;
+
+    auto rec = std::move(recording);
+    rec->graph.end_recording(queue);
+    for (auto &&[ptr, size] : rec->prefetches)
+      queue.prefetch(ptr, size);
+
+    auto getExecGraph = [&]() -> auto & {
+      auto it = graphCache.find(rec->signature);
+      if (it != graphCache.end()) {
+        // Same topology, only update kernel args.
+        try {
+          it->second.update(rec->graph);
+          return it->second;
+        } catch (const sycl::exception &) {
+          graphCache.erase(it);
+        }
+      }
+
+      if (graphCache.size() >= MaxCachedGraphs)
+        graphCache.clear();
+
+      auto exec = rec->graph.finalize(syclexp::property::graph::updatable{});
+      return graphCache.emplace(rec->signature, std::move(exec)).first->second;
+    };
+    auto &exec = getExecGraph();
+
+    auto event = queue.submit([&](sycl::handler &cgh) {
+      cgh.depends_on(rec->externalDeps);
+      cgh.ext_oneapi_graph(exec);
+    });
+    for (auto *ev : rec->events)
+      if (ev)
+        ev->event = event;
+#endif
+  }
+
+  EventStorage *getEvent() {
+    auto *ret = events.get();
     assert(ret);
 
     // Prolong runtime lifetime as long as there are outstanding events.
@@ -291,59 +1293,89 @@ private:
 
   void returnEvent(EventStorage *event) {
     assert(event);
-    assert(!event->next);
-    event->next = std::move(events);
-    events.reset(event);
+    events.put(event);
 
     // We are incrementing runtime refcount in getEvent.
     release();
   }
 
-  template <numba::GpuParamType TypeVal, typename Type>
-  static bool setKernelArgImpl(sycl::handler &cgh, uint32_t index,
-                               const numba::GPUParamDesc &desc) {
-    if (TypeVal == desc.type) {
-      assert(desc.size == sizeof(Type));
-      cgh.set_arg(index, *static_cast<const Type *>(desc.data));
-      return true;
+  /// Copies `params` values into the kernel arguments buffer, each value is
+  /// aligned to its size, matching natural struct layout on the device side.
+  /// Returns buffer and its size.
+  static std::pair<void *, size_t>
+  packParams(GPUKernel *kernel, const numba::GPUParamDesc *params,
+             size_t count) {
+    auto alignUp = [](size_t val, size_t align) {
+      return (val + align - 1) / align * align;
+    };
+    size_t size = 0;
+    size_t maxAlign = 1;
+    for (size_t i = 0; i < count; ++i) {
+      auto &param = params[i];
+      // Local memory is set via accessor and can't be packed.
+      if (!param.data || param.size <= 0)
+        throw std::runtime_error("Invalid packed kernel param");
+
+      auto paramSize = static_cast<size_t>(param.size);
+      size = alignUp(size, paramSize) + paramSize;
+      maxAlign = std::max(maxAlign, paramSize);
     }
-    return false;
+    size = alignUp(std::max<size_t>(size, 1), maxAlign);
+
+    auto buffer = acquireGPUKernelArgsBuffer(kernel, size);
+    auto data = static_cast<char *>(buffer);
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+      auto paramSize = static_cast<size_t>(params[i].size);
+      offset = alignUp(offset, paramSize);
+      std::memcpy(data + offset, params[i].data, paramSize);
+      offset += paramSize;
+    }
+    return {buffer, size};
   }
 
-  template <numba::GpuParamType TypeVal>
-  static bool setKernelArgPtrImpl(sycl::handler &cgh, uint32_t index,
+  template <typename Type>
+  static void setKernelArgImpl(sycl::handler &cgh, uint32_t index,
+                               const numba::GPUParamDesc &desc) {
+    assert(desc.size == sizeof(Type));
+    cgh.set_arg(index, *static_cast<const Type *>(desc.data));
+  }
+
+  static void setKernelArgPtrImpl(sycl::handler &cgh, uint32_t index,
                                   const numba::GPUParamDesc &desc) {
-    if (TypeVal == desc.type) {
+    if (desc.data) {
       assert(desc.size == sizeof(void *));
-      if (desc.data) {
-        cgh.set_arg(index, *(static_cast<void *const *>(desc.data)));
-      } else {
-        // Local mem
-        cgh.set_arg(index, sycl::local_accessor<char>(desc.size, cgh));
-      }
-      return true;
+      cgh.set_arg(index, *(static_cast<void *const *>(desc.data)));
+    } else {
+      // Local mem
+      cgh.set_arg(index, sycl::local_accessor<char>(desc.size, cgh));
     }
-    return false;
   }
 
+  // Called for each param on every launch, dispatch directly on type.
   static void setKernelArg(sycl::handler &cgh, uint32_t index,
                            const numba::GPUParamDesc &desc) {
-    using HandlerPtrT =
-        bool (*)(sycl::handler &, uint32_t, const numba::GPUParamDesc &);
-    const HandlerPtrT handlers[] = {
-        &setKernelArgImpl<numba::GpuParamType::bool_, bool>,
-        &setKernelArgImpl<numba::GpuParamType::int8, int8_t>,
-        &setKernelArgImpl<numba::GpuParamType::int16, int16_t>,
-        &setKernelArgImpl<numba::GpuParamType::int32, int32_t>,
-        &setKernelArgImpl<numba::GpuParamType::int64, int64_t>,
-        &setKernelArgImpl<numba::GpuParamType::float32, float>,
-        &setKernelArgImpl<numba::GpuParamType::float64, double>,
-        &setKernelArgPtrImpl<numba::GpuParamType::ptr>,
-    };
-
-    for (auto handler : handlers)
-      if (handler(cgh, index, desc))
-        return;
+    using T = numba::GpuParamType;
+    switch (desc.type) {
+    case T::bool_:
+      return setKernelArgImpl<bool>(cgh, index, desc);
+    case T::int8:
+      return setKernelArgImpl<int8_t>(cgh, index, desc);
+    case T::int16:
+      return setKernelArgImpl<int16_t>(cgh, index, desc);
+    case T::int32:
+      return setKernelArgImpl<int32_t>(cgh, index, desc);
+    case T::int64:
+      return setKernelArgImpl<int64_t>(cgh, index, desc);
+    case T::float32:
+      return setKernelArgImpl<float>(cgh, index, desc);
+    case T::float64:
+      return setKernelArgImpl<double>(cgh, index, desc);
+    case T::ptr:
+      return setKernelArgPtrImpl(cgh, index, desc);
+    default:
+      break;
+    }
 
     fprintf(stdout, "Unhandled param type: %d\n", static_cast<int>(desc.type));
     fflush(stdout);
@@ -356,18 +1388,289 @@ static Queue *toQueue(void *queue) {
   return static_cast<Queue *>(queue);
 }
 
+/// Sycl queues, registered by the caller for the device names.
+struct ExternalQueues {
+  std::mutex mutex;
+  std::unordered_map<std::string, sycl::queue> queues;
+
+  /// Incremented on every change, so thread caches know when to drop queues.
+  std::atomic<uint64_t> version = {0};
+};
+
+static ExternalQueues &getExternalQueues() {
+  static ExternalQueues queues;
+  return queues;
+}
+
+/// Queues, shared by all function calls on the current thread, keyed by the
+/// device name. Creating sycl queue, event pool and allocation cache for every
+/// call is expensive and it also drops all cached allocations.
+class QueueCache {
+public:
+  QueueCache() = default;
+  QueueCache(const QueueCache &) = delete;
+  ~QueueCache() { clear(); }
+
+  Queue *get(const char *deviceName) {
+    auto &ext = getExternalQueues();
+    auto currentVersion = ext.version.load();
+    if (currentVersion != version) {
+      clear();
+      version = currentVersion;
+    }
+
+    std::string name = deviceName ? deviceName : "";
+    auto it = cache.find(name);
+    if (it == cache.end())
+      it = cache.emplace(name, createQueue(name)).first;
+
+    // Cache holds its own reference.
+    auto queue = it->second;
+    queue->retain();
+    return queue;
+  }
+
+  void clear() {
+    auto queues = std::move(cache);
+    for (auto &&it : queues)
+      it.second->release();
+  }
+
+  void synchronize() {
+    for (auto &&it : cache)
+      it.second->synchronize();
+  }
+
+private:
+  std::unordered_map<std::string, Queue *> cache;
+  uint64_t version = 0;
+
+  static Queue *createQueue(const std::string &name) {
+    // External queues don't have profiling enabled.
+    if (!isProfilingEnabled()) {
+      auto &ext = getExternalQueues();
+      std::lock_guard<std::mutex> lock(ext.mutex);
+      auto it = ext.queues.find(name);
+      if (it != ext.queues.end())
+        return new Queue(name.c_str(), it->second);
+    }
+    return new Queue(name.c_str());
+  }
+};
+
+static QueueCache &getQueueCache() {
+  static thread_local QueueCache cache;
+  return cache;
+}
+
 } // namespace
 
 extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void *
 gpuxQueueCreate(const char *deviceName) {
   LOG_FUNC();
-  return catchAll([&]() { return new Queue(deviceName); });
+  return catchAll([&]() { return getQueueCache().get(deviceName); });
 }
 
 extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void
 gpuxQueueDestroy(void *queue) {
   LOG_FUNC();
-  catchAll([&]() { toQueue(queue)->release(); });
+  catchAll([&]() {
+    auto q = toQueue(queue);
+    q->flush();
+    q->release();
+  });
+}
+
+/// Use `syclQueue` (`sycl::queue *`) for all subsequent launches on the
+/// `deviceName` device, null `syclQueue` removes registration. Queue is
+/// copied, caller pointer is not retained.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void
+gpuxRegisterSyclQueue(const char *deviceName, void *syclQueue) {
+  LOG_FUNC();
+  catchAll([&]() {
+    auto &ext = getExternalQueues();
+    std::string name = deviceName ? deviceName : "";
+    std::lock_guard<std::mutex> lock(ext.mutex);
+    if (syclQueue) {
+      auto &q = *static_cast<sycl::queue *>(syclQueue);
+      auto it = ext.queues.find(name);
+      if (it != ext.queues.end() && it->second == q)
+        return;
+
+      ext.queues.insert_or_assign(name, q);
+    } else if (!ext.queues.erase(name)) {
+      return;
+    }
+    ++ext.version;
+  });
+}
+
+/// Waits for all the launches with deferred waits
+/// (NUMBA_MLIR_GPU_DEFERRED_SYNC=1) on the queues, cached by the current
+/// thread.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void gpuxSynchronize() {
+  LOG_FUNC();
+  catchAll([&]() { getQueueCache().synchronize(); });
+}
+
+/// Starts the section, where kernel waits on the current thread are deferred,
+/// so launches on the different queues (e.g. parts of the loop, split across
+/// multiple devices) can execute concurrently. Sections can be nested.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void gpuxConcurrentBegin() {
+  LOG_FUNC();
+  catchAll([&]() { ++getConcurrentSection().depth; });
+}
+
+/// Returns false if section is nested and its launches are still pending.
+static bool endConcurrentSection() {
+  auto &section = getConcurrentSection();
+  assert(section.depth > 0);
+  if (--section.depth != 0)
+    return false;
+
+  auto queues = std::move(section.queues);
+  section.queues.clear();
+  for (auto queue : queues) {
+    Queue::Releaser releaser(queue);
+    queue->synchronize();
+  }
+  return true;
+}
+
+/// Ends the section, started by `gpuxConcurrentBegin`, outermost section waits
+/// for all the launches, deferred inside it.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void gpuxConcurrentEnd() {
+  LOG_FUNC();
+  catchAll([&]() { (void)endConcurrentSection(); });
+}
+
+namespace {
+/// Host shares of the co-execution sections, keyed by the compiler-generated
+/// global, unique for each section.
+struct CoexecRatios {
+  std::mutex mutex;
+  std::unordered_map<const void *, double> ratios;
+};
+
+static CoexecRatios &getCoexecRatios() {
+  static CoexecRatios ratios;
+  return ratios;
+}
+
+struct CoexecScope {
+  const void *key;
+  double ratio;
+  std::chrono::steady_clock::time_point begin;
+};
+
+/// Co-execution sections, active on the current thread.
+static std::vector<CoexecScope> &getCoexecScopes() {
+  static thread_local std::vector<CoexecScope> scopes;
+  return scopes;
+}
+
+/// Both parts always get some work, so their throughput can be measured.
+static constexpr double MinCoexecRatio = 1.0 / 64;
+static constexpr double MaxCoexecRatio = 1.0 - MinCoexecRatio;
+static constexpr double InitialCoexecRatio = 0.5;
+
+/// Weight of the latest measurement in the host share.
+static constexpr double CoexecSmoothing = 0.5;
+
+/// Returns the host share, which would equalize host and device times with
+/// the measured throughputs. If device finished before host, its time is
+/// only known to be below the host time, so device is assumed to be twice as
+/// fast and the host share goes down until device becomes the bottleneck.
+static double getBalancedRatio(double ratio, double hostTime,
+                               double deviceTime, bool deviceIdle) {
+  constexpr double minTime = 1e-9;
+  if (deviceIdle)
+    deviceTime = hostTime * 0.5;
+
+  auto hostRate = ratio / std::max(hostTime, minTime);
+  auto deviceRate = (1.0 - ratio) / std::max(deviceTime, minTime);
+  return hostRate / (hostRate + deviceRate);
+}
+} // namespace
+
+/// Starts the section, where the loop is split between the host threads and
+/// the devices (see `gpuxConcurrentBegin`). Returns the host share of the
+/// iterations for the section, identified by the `key` address.
+///
+/// Host share is adapted online: `gpuxCoexecEnd` measures host and device
+/// times of the current execution and moves the share towards the balanced
+/// one, so both finish at the same time. NUMBA_MLIR_GPU_COEXEC_RATIO sets
+/// fixed share instead.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT double
+gpuxCoexecBegin(const void *key) {
+  LOG_FUNC();
+  return catchAll([&]() -> double {
+    auto ratio = getCoexecHostRatio();
+    if (!ratio) {
+      auto &ratios = getCoexecRatios();
+      std::lock_guard<std::mutex> lock(ratios.mutex);
+      ratio = ratios.ratios.try_emplace(key, InitialCoexecRatio).first->second;
+    }
+
+    getCoexecScopes().push_back(
+        {key, *ratio, std::chrono::steady_clock::now()});
+    ++getConcurrentSection().depth;
+    return *ratio;
+  });
+}
+
+/// Ends the section, started by `gpuxCoexecBegin`. Must be called right after
+/// the host part is finished. Waits for the device part and updates the host
+/// share.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void gpuxCoexecEnd() {
+  LOG_FUNC();
+  catchAll([&]() {
+    // Section wasn't started, e.g. `gpuxCoexecBegin` failed.
+    auto &scopes = getCoexecScopes();
+    if (scopes.empty())
+      return;
+
+    auto scope = scopes.back();
+    scopes.pop_back();
+
+    auto hostEnd = std::chrono::steady_clock::now();
+    // Nested section doesn't wait for the device, so its time is unknown.
+    if (!endConcurrentSection() || getCoexecHostRatio())
+      return;
+
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double> hostTime = hostEnd - scope.begin;
+    std::chrono::duration<double> waitTime = end - hostEnd;
+    std::chrono::duration<double> deviceTime = end - scope.begin;
+    bool deviceIdle = waitTime.count() < hostTime.count() * 0.01;
+
+    auto balanced = getBalancedRatio(scope.ratio, hostTime.count(),
+                                     deviceTime.count(), deviceIdle);
+    auto &ratios = getCoexecRatios();
+    std::lock_guard<std::mutex> lock(ratios.mutex);
+    auto &ratio = ratios.ratios[scope.key];
+    ratio += (balanced - ratio) * CoexecSmoothing;
+    ratio = std::clamp(ratio, MinCoexecRatio, MaxCoexecRatio);
+  });
+}
+
+/// Copies `size` bytes from `src` to `dst` using `deviceName` device queue,
+/// either pointer can be regular host memory or USM, allocated in the queue
+/// context. Waits for the copy to finish.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void
+gpuxMemcpy(const char *deviceName, void *dst, const void *src, size_t size) {
+  LOG_FUNC();
+  catchAll([&]() {
+    auto queue = getQueueCache().get(deviceName);
+    Queue::Releaser releaser(queue);
+    queue->copy(dst, src, size);
+  });
+}
+
+/// Release queues, cached by the current thread.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void gpuxQueueCacheClear() {
+  LOG_FUNC();
+  catchAll([&]() { getQueueCache().clear(); });
 }
 
 extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void *
@@ -405,7 +1708,21 @@ gpuxLaunchKernel(void *queue, void *kernel, size_t gridX, size_t gridY,
     return toQueue(queue)->launchKernel(
         static_cast<GPUKernel *>(kernel), gridX, gridY, gridZ, blockX, blockY,
         blockZ, static_cast<EventStorage **>(events),
-        static_cast<numba::GPUParamDesc *>(params));
+        static_cast<numba::GPUParamDesc *>(params), /*packed*/ false);
+  });
+}
+
+/// Same as `gpuxLaunchKernel`, for kernels, compiled with packed arguments.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void *
+gpuxLaunchKernelPacked(void *queue, void *kernel, size_t gridX, size_t gridY,
+                       size_t gridZ, size_t blockX, size_t blockY,
+                       size_t blockZ, void *events, void *params) {
+  LOG_FUNC();
+  return catchAll([&]() {
+    return toQueue(queue)->launchKernel(
+        static_cast<GPUKernel *>(kernel), gridX, gridY, gridZ, blockX, blockY,
+        blockZ, static_cast<EventStorage **>(events),
+        static_cast<numba::GPUParamDesc *>(params), /*packed*/ true);
   });
 }
 
@@ -442,6 +1759,12 @@ extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void gpuxDeAlloc(void *queue,
   catchAll([&]() { toQueue(queue)->deallocBuffer(ptr); });
 }
 
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void
+gpuxPrefetch(void *queue, const void *ptr, size_t size) {
+  LOG_FUNC();
+  catchAll([&]() { toQueue(queue)->prefetch(ptr, size); });
+}
+
 extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void
 gpuxSuggestBlockSize(void *queue, void *kernel, const uint32_t *gridSize,
                      uint32_t *blockSize, size_t numDims) {
@@ -452,6 +1775,95 @@ gpuxSuggestBlockSize(void *queue, void *kernel, const uint32_t *gridSize,
   });
 }
 
+/// Returns number of kernels in the profile, collected with
+/// NUMBA_MLIR_GPU_PROFILE=1.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT int gpuxProfileGetNumKernels() {
+  auto &storage = getProfileStorage();
+  std::lock_guard<std::mutex> lock(storage.mutex);
+  return static_cast<int>(storage.kernels.size());
+}
+
+/// Returns kernel name and writes its launch stats into `stats`: launch
+/// count, total, mean and 99th percentile device time and total queue latency
+/// (submit to start), times are in nanoseconds. Returns null if `index` is out
+/// of range. Returned string is valid until the next profile reset.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT const char *
+gpuxProfileGetKernel(int index, uint64_t *stats) {
+  auto &storage = getProfileStorage();
+  std::lock_guard<std::mutex> lock(storage.mutex);
+  if (index < 0 || static_cast<size_t>(index) >= storage.kernels.size())
+    return nullptr;
+
+  auto &[name, profile] = storage.kernels[static_cast<size_t>(index)];
+  auto times = profile.deviceTimesNs;
+  std::sort(times.begin(), times.end());
+  uint64_t total = 0;
+  for (auto t : times)
+    total += t;
+
+  auto count = times.size();
+  auto p99 = count == 0 ? 0 : times[(count * 99 + 99) / 100 - 1];
+  stats[0] = count;
+  stats[1] = total;
+  stats[2] = count == 0 ? 0 : total / count;
+  stats[3] = p99;
+  stats[4] = profile.queueLatencyNs;
+  return name.c_str();
+}
+
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void gpuxProfileReset() {
+  auto &storage = getProfileStorage();
+  std::lock_guard<std::mutex> lock(storage.mutex);
+  storage.kernels.clear();
+  storage.indices.clear();
+}
+
+/// Returns number of devices in the memory profile, collected with
+/// NUMBA_MLIR_MEMORY_PROFILE=1.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT int
+gpuxMemoryProfileGetNumDevices() {
+  auto &storage = getMemoryProfileStorage();
+  std::lock_guard<std::mutex> lock(storage.mutex);
+  return static_cast<int>(storage.devices.size());
+}
+
+/// Returns device name and writes its memory stats into `stats`: number of
+/// allocations, total allocated bytes, currently live bytes and peak live
+/// bytes. Returns null if `index` is out of range.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT const char *
+gpuxMemoryProfileGetDevice(int index, uint64_t *stats) {
+  auto &storage = getMemoryProfileStorage();
+  std::lock_guard<std::mutex> lock(storage.mutex);
+  if (index < 0 || static_cast<size_t>(index) >= storage.devices.size())
+    return nullptr;
+
+  auto &[name, profile] = storage.devices[static_cast<size_t>(index)];
+  stats[0] = profile.allocs;
+  stats[1] = profile.allocatedBytes;
+  stats[2] = profile.liveBytes;
+  stats[3] = profile.peakBytes;
+  return name.c_str();
+}
+
+/// Resets allocation counters and sets peaks to the currently live bytes.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void gpuxMemoryProfileReset() {
+  auto &storage = getMemoryProfileStorage();
+  std::lock_guard<std::mutex> lock(storage.mutex);
+  for (auto &[name, profile] : storage.devices) {
+    profile.allocs = 0;
+    profile.allocatedBytes = 0;
+    profile.peakBytes = profile.liveBytes;
+  }
+}
+
+/// Sets trace events sink with `nmrtTraceEvent` signature, allocations,
+/// launches, waits and copies are recorded with their host time. Null
+/// disables tracing.
+extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void
+gpuxSetTraceFunc(void *func) {
+  traceFunc.store(reinterpret_cast<TraceFunc>(func), std::memory_order_relaxed);
+}
+
 // TODO: not sure it belongs here
 extern "C" NUMBA_MLIR_GPU_RUNTIME_SYCL_EXPORT void *
 gpuxDuplicateQueue(void *queue) {
@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include <mlir/ExecutionEngine/CRunnerUtils.h>
+
+using index_t = std::make_signed_t<std::size_t>;
+
+// Must be kept in sync with `TbbParallel.cpp`.
+struct InputRange {
+  index_t lower;
+  index_t upper;
+  index_t step;
+};
+
+struct Range {
+  index_t lower;
+  index_t upper;
+};
+
+using ParallelForFptr = void (*)(const Range *, size_t, void *);
+
+extern "C" {
+void memrefCopy(int64_t elemSize, UnrankedMemRefType<char> *src,
+                UnrankedMemRefType<char> *dst);
+
+void *nmrtTakeContext(void **ctxHandle, size_t contextSize,
+                      void (*init)(void *), void (*release)(void *));
+void nmrtReleaseContext(void *context);
+void nmrtPurgeContext(void **ctxHandle);
+
+#ifdef NUMBA_MLIR_ENABLE_TBB_SUPPORT
+void nmrtParallelInit(int numThreads);
+void nmrtParallelFinalize();
+int nmrtParallelCreateArena(const char *name, int numThreads);
+void nmrtParallelSetCurrentArena(int id);
+int nmrtParallelGetNumThreads();
+void nmrtParallelFor(const InputRange *inputRanges, size_t numLoops,
+                     ParallelForFptr func, void *ctx);
+void nmrtParallelForSchedule(const InputRange *inputRanges, size_t numLoops,
+                             ParallelForFptr func, void *ctx, int64_t kind,
+                             int64_t grain, void **state, const char *region,
+                             int64_t cost);
+#endif
+}
+
+namespace {
+#ifdef NUMBA_MLIR_ENABLE_TBB_SUPPORT
+static void initParallel() {
+  static bool init = []() {
+    nmrtParallelInit(0);
+    std::atexit(&nmrtParallelFinalize);
+    return true;
+  }();
+  (void)init;
+}
+
+/// Selects arena with `numThreads` threads for the current thread and returns
+/// actual number of threads.
+static int useThreads(int numThreads) {
+  initParallel();
+  auto name = "bench_" + std::to_string(numThreads);
+  auto arena = nmrtParallelCreateArena(name.c_str(), numThreads);
+  nmrtParallelSetCurrentArena(arena);
+  return nmrtParallelGetNumThreads();
+}
+
+/// Loop body, only touches the chunk ranges, so the runtime overhead
+/// dominates.
+static void emptyBody(const Range *ranges, size_t threadIndex, void *ctx) {
+  benchmark::DoNotOptimize(ranges);
+  benchmark::DoNotOptimize(threadIndex);
+  benchmark::DoNotOptimize(ctx);
+}
+
+/// `dims` dimensions loop with `extent` iterations in each.
+static std::vector<InputRange> getRanges(int64_t dims, int64_t extent) {
+  InputRange range{0, static_cast<index_t>(extent), 1};
+  return std::vector<InputRange>(static_cast<size_t>(dims), range);
+}
+
+// Args: dims, extent, threads.
+static void BM_ParallelFor(benchmark::State &state) {
+  auto ranges = getRanges(state.range(0), state.range(1));
+  state.counters["threads"] = useThreads(static_cast<int>(state.range(2)));
+  for (auto _ : state)
+    nmrtParallelFor(ranges.data(), ranges.size(), &emptyBody, nullptr);
+
+  nmrtParallelSetCurrentArena(-1);
+}
+BENCHMARK(BM_ParallelFor)
+    ->ArgNames({"dims", "extent", "threads"})
+    ->ArgsProduct({{1, 2, 3, 4, 5}, {4, 64}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+// Args: schedule kind, dims, threads.
+static void BM_ParallelForSchedule(benchmark::State &state) {
+  auto ranges = getRanges(state.range(1), 64);
+  state.counters["threads"] = useThreads(static_cast<int>(state.range(2)));
+  void *schedState = nullptr;
+  for (auto _ : state)
+    nmrtParallelForSchedule(ranges.data(), ranges.size(), &emptyBody, nullptr,
+                            state.range(0), /*grain*/ 0, &schedState,
+                            /*region*/ nullptr, /*cost*/ 0);
+
+  nmrtParallelSetCurrentArena(-1);
+}
+BENCHMARK(BM_ParallelForSchedule)
+    ->ArgNames({"kind", "dims", "threads"})
+    ->ArgsProduct({{0, 1, 2, 3, 4, 5}, {1, 3}, {1, 8}})
+    ->UseRealTime();
+#endif
+
+template <int N> struct MemrefBuffer {
+  MemrefBuffer(std::array<int64_t, N> sizes, bool transposed)
+      : data(static_cast<size_t>(getCount(sizes))) {
+    desc.basePtr = data.data();
+    desc.data = data.data();
+    desc.offset = 0;
+    int64_t stride = 1;
+    for (int i = N - 1; i >= 0; --i) {
+      auto dim = transposed ? N - 1 - i : i;
+      desc.sizes[i] = sizes[i];
+      desc.strides[dim] = stride;
+      stride *= sizes[dim];
+    }
+    unranked = {N, &desc};
+  }
+
+  static int64_t getCount(const std::array<int64_t, N> &sizes) {
+    int64_t count = 1;
+    for (auto size : sizes)
+      count *= size;
+    return count;
+  }
+
+  std::vector<char> data;
+  StridedMemRefType<char, N> desc;
+  UnrankedMemRefType<char> unranked;
+};
+
+// Args: bytes.
+static void BM_MemrefCopy1D(benchmark::State &state) {
+  auto size = state.range(0);
+  MemrefBuffer<1> src({size}, false);
+  MemrefBuffer<1> dst({size}, false);
+  for (auto _ : state) {
+    memrefCopy(1, &src.unranked, &dst.unranked);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_MemrefCopy1D)->RangeMultiplier(16)->Range(1 << 8, 1 << 26);
+
+// Args: extent, transposed source. Elements are single bytes, each row is
+// `extent * 8` bytes long.
+static void BM_MemrefCopy2D(benchmark::State &state) {
+  auto extent = state.range(0);
+  bool transposed = state.range(1) != 0;
+  MemrefBuffer<2> src({extent, extent * 8}, transposed);
+  MemrefBuffer<2> dst({extent, extent * 8}, false);
+  for (auto _ : state) {
+    memrefCopy(1, &src.unranked, &dst.unranked);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(state.iterations() * extent * extent * 8);
+}
+BENCHMARK(BM_MemrefCopy2D)
+    ->ArgNames({"extent", "transposed"})
+    ->ArgsProduct({{16, 256, 2048}, {0, 1}});
+
+static void initContext(void *ctx) { *static_cast<int64_t *>(ctx) = 0; }
+
+// Hot path, context is already initialized.
+static void BM_TakeContext(benchmark::State &state) {
+  void *handle = nullptr;
+  for (auto _ : state) {
+    auto ctx = nmrtTakeContext(&handle, sizeof(int64_t), &initContext,
+                               /*release*/ nullptr);
+    benchmark::DoNotOptimize(ctx);
+    nmrtReleaseContext(ctx);
+  }
+  nmrtPurgeContext(&handle);
+}
+BENCHMARK(BM_TakeContext)->ThreadRange(1, 8)->UseRealTime();
+
+// Context creation, including purge.
+static void BM_TakeContextCold(benchmark::State &state) {
+  auto size = static_cast<size_t>(state.range(0));
+  for (auto _ : state) {
+    void *handle = nullptr;
+    auto ctx = nmrtTakeContext(&handle, size, /*init*/ nullptr,
+                               /*release*/ nullptr);
+    benchmark::DoNotOptimize(ctx);
+    nmrtReleaseContext(ctx);
+    nmrtPurgeContext(&handle);
+  }
+}
+BENCHMARK(BM_TakeContextCold)->Arg(8)->Arg(4096);
+} // namespace
@@ -0,0 +1,391 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#include "numba-mlir-runtime_export.h"
+
+namespace {
+/// Mirrors Numba NRT_ExternalAllocator layout.
+struct ExternalAllocator {
+  void *(*malloc)(size_t size, void *opaque);
+  void *(*realloc)(void *ptr, size_t size, void *opaque);
+  void (*free)(void *ptr, void *opaque);
+  void *opaqueData;
+};
+
+/// NRT_MemInfo_alloc_safe_aligned_external signature.
+using AllocExternalFunc = void *(*)(size_t, uint32_t, ExternalAllocator *);
+
+/// Mirrors Numba NRT_MemInfo layout.
+struct MemInfo {
+  size_t refcnt;
+  void *dtor;
+  void *dtorInfo;
+  void *data;
+  size_t size;
+  void *externalAllocator;
+};
+
+/// NRT fills this many first data bytes with debug marker.
+static constexpr size_t DebugMarkerSize = 256;
+
+enum class BlockKind : uint32_t {
+  Malloc,
+  Cached,
+  Mapped,
+};
+
+/// Precedes each block, returned to the NRT. NRT places meminfo and aligned
+/// data into the block itself.
+struct BlockHeader {
+  size_t size;
+  BlockKind kind;
+  uint32_t sizeClass;
+};
+
+static constexpr size_t HeaderSize = 64;
+static_assert(sizeof(BlockHeader) <= HeaderSize);
+
+static constexpr size_t PageSize = 4096;
+static constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+/// Blocks up to `MinClassSize << (NumSizeClasses - 1)` bytes are rounded up
+/// to the power of 2 and cached on free.
+static constexpr size_t MinClassSize = 64;
+static constexpr unsigned NumSizeClasses = 15;
+
+struct AllocPolicy {
+  AllocExternalFunc allocFunc = nullptr;
+
+  /// Blocks of this size and larger are mapped with huge pages, 0 disables.
+  size_t hugePageThreshold = 0;
+
+  /// Max total size of the cached free blocks.
+  size_t maxCacheSize = 0;
+
+  /// Use explicit hugetlbfs pages, falling back to transparent huge pages.
+  bool useHugetlb = false;
+
+  /// Touch mapped pages in parallel on allocation.
+  bool firstTouch = false;
+};
+
+struct SizeClassCache {
+  std::mutex mutex;
+  std::array<std::vector<void *>, NumSizeClasses> blocks;
+  size_t cachedBytes = 0;
+
+  ~SizeClassCache() {
+    for (auto &list : blocks)
+      for (auto ptr : list)
+        std::free(ptr);
+  }
+};
+
+static AllocPolicy policy;
+
+static SizeClassCache &getCache() {
+  static SizeClassCache cache;
+  return cache;
+}
+
+static size_t alignUp(size_t val, size_t align) {
+  return (val + align - 1) & ~(align - 1);
+}
+
+static unsigned getSizeClass(size_t size) {
+  unsigned ret = 0;
+  while ((MinClassSize << ret) < size)
+    ++ret;
+
+  return ret;
+}
+
+static void *initBlock(void *base, size_t size, BlockKind kind,
+                       unsigned sizeClass = 0) {
+  auto header = static_cast<BlockHeader *>(base);
+  header->size = size;
+  header->kind = kind;
+  header->sizeClass = sizeClass;
+  return static_cast<char *>(base) + HeaderSize;
+}
+
+static BlockHeader *getHeader(void *ptr) {
+  return reinterpret_cast<BlockHeader *>(static_cast<char *>(ptr) -
+                                         HeaderSize);
+}
+} // namespace
+
+#ifdef NUMBA_MLIR_ENABLE_TBB_SUPPORT
+// Keep in sync with TbbParallel.cpp
+struct ParallelRange {
+  int64_t lower;
+  int64_t upper;
+};
+
+struct ParallelInputRange {
+  int64_t lower;
+  int64_t upper;
+  int64_t step;
+};
+
+using ParallelForFunc = void (*)(const ParallelRange *, size_t, void *);
+
+extern "C" int nmrtParallelIsInitialized();
+extern "C" int nmrtParallelIsInRegion();
+extern "C" void nmrtParallelFor(const ParallelInputRange *inputRanges,
+                                size_t numLoops, ParallelForFunc func,
+                                void *ctx);
+
+/// Pages are touched by this number of huge pages per task.
+static constexpr int64_t FirstTouchChunk = 4;
+
+/// Page faults on the freshly mapped memory are serialized on the calling
+/// thread otherwise, zeroing multi-GB arrays takes noticeable time.
+static void firstTouch(char *data, size_t size) {
+  if (!nmrtParallelIsInitialized() || nmrtParallelIsInRegion())
+    return;
+
+  struct Ctx {
+    char *data;
+    size_t size;
+  } ctx = {data, size};
+  auto body = [](const ParallelRange *range, size_t, void *ptr) {
+    auto &c = *static_cast<const Ctx *>(ptr);
+    auto chunkSize = static_cast<size_t>(FirstTouchChunk) * HugePageSize;
+    auto begin = static_cast<size_t>(range->lower) * chunkSize;
+    auto end = std::min(static_cast<size_t>(range->upper) * chunkSize, c.size);
+    for (auto offset = begin; offset < end; offset += PageSize)
+      *reinterpret_cast<volatile char *>(c.data + offset) = 0;
+  };
+  auto chunkSize = static_cast<size_t>(FirstTouchChunk) * HugePageSize;
+  auto numChunks = static_cast<int64_t>((size + chunkSize - 1) / chunkSize);
+  ParallelInputRange range = {0, numChunks, 1};
+  nmrtParallelFor(&range, 1, body, &ctx);
+}
+#else
+static void firstTouch(char * /*data*/, size_t /*size*/) {}
+#endif
+
+/// Maps huge pages aligned block, returns null if not supported.
+static void *mapHuge(size_t size) {
+#if defined(__linux__)
+  auto mapSize = alignUp(size, HugePageSize);
+  auto prot = PROT_READ | PROT_WRITE;
+  auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+  if (policy.useHugetlb) {
+    auto ptr = mmap(nullptr, mapSize, prot, flags | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED)
+      return initBlock(ptr, mapSize, BlockKind::Mapped);
+  }
+#endif
+
+  // Over-map to align block start to huge page boundary and unmap the tails.
+  auto total = mapSize + HugePageSize;
+  auto raw = mmap(nullptr, total, prot, flags, -1, 0);
+  if (raw == MAP_FAILED)
+    return nullptr;
+
+  auto begin = reinterpret_cast<uintptr_t>(raw);
+  auto aligned = alignUp(begin, HugePageSize);
+  if (aligned != begin)
+    munmap(raw, aligned - begin);
+
+  auto tail = begin + total - (aligned + mapSize);
+  if (tail != 0)
+    munmap(reinterpret_cast<void *>(aligned + mapSize), tail);
+
+  auto ptr = reinterpret_cast<void *>(aligned);
+#ifdef MADV_HUGEPAGE
+  madvise(ptr, mapSize, MADV_HUGEPAGE);
+#endif
+  return initBlock(ptr, mapSize, BlockKind::Mapped);
+#else
+  (void)size;
+  return nullptr;
+#endif
+}
+
+static void unmapHuge(BlockHeader *header) {
+#if defined(__linux__)
+  munmap(header, header->size);
+#else
+  (void)header;
+#endif
+}
+
+static void *allocBlock(size_t size, void * /*opaque*/) {
+  auto total = size + HeaderSize;
+  if (policy.hugePageThreshold != 0 && total >= policy.hugePageThreshold) {
+    if (auto ptr = mapHuge(total)) {
+      if (policy.firstTouch)
+        firstTouch(static_cast<char *>(ptr), total - HeaderSize);
+
+      return ptr;
+    }
+  }
+
+  auto sizeClass = getSizeClass(total);
+  if (sizeClass >= NumSizeClasses) {
+    auto ptr = std::malloc(total);
+    return ptr ? initBlock(ptr, total, BlockKind::Malloc) : nullptr;
+  }
+
+  auto classSize = MinClassSize << sizeClass;
+  {
+    auto &cache = getCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto &list = cache.blocks[sizeClass];
+    if (!list.empty()) {
+      auto ptr = list.back();
+      list.pop_back();
+      cache.cachedBytes -= classSize;
+      return initBlock(ptr, classSize, BlockKind::Cached, sizeClass);
+    }
+  }
+
+  auto ptr = std::malloc(classSize);
+  return ptr ? initBlock(ptr, classSize, BlockKind::Cached, sizeClass)
+             : nullptr;
+}
+
+static void *allocZeroedBlock(size_t size, void *opaque) {
+  auto total = size + HeaderSize;
+  // Fresh mappings are zeroed by the OS.
+  if (policy.hugePageThreshold != 0 && total >= policy.hugePageThreshold) {
+    if (auto ptr = mapHuge(total)) {
+      if (policy.firstTouch)
+        firstTouch(static_cast<char *>(ptr), total - HeaderSize);
+
+      return ptr;
+    }
+  }
+
+  // Cached blocks are reused dirty.
+  if (policy.maxCacheSize != 0 && getSizeClass(total) < NumSizeClasses) {
+    auto ptr = allocBlock(size, opaque);
+    if (ptr)
+      std::memset(ptr, 0, size);
+
+    return ptr;
+  }
+
+  // Large calloc gets lazily zeroed pages from the OS instead of memset.
+  auto ptr = std::calloc(1, total);
+  return ptr ? initBlock(ptr, total, BlockKind::Malloc) : nullptr;
+}
+
+static void freeBlock(void *ptr, void * /*opaque*/) {
+  if (!ptr)
+    return;
+
+  auto header = getHeader(ptr);
+  switch (header->kind) {
+  case BlockKind::Mapped:
+    unmapHuge(header);
+    return;
+  case BlockKind::Cached: {
+    auto size = header->size;
+    auto &cache = getCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (cache.cachedBytes + size <= policy.maxCacheSize) {
+      cache.blocks[header->sizeClass].emplace_back(header);
+      cache.cachedBytes += size;
+      return;
+    }
+    break;
+  }
+  case BlockKind::Malloc:
+    break;
+  }
+  std::free(header);
+}
+
+static void *reallocBlock(void *ptr, size_t size, void *opaque) {
+  auto newPtr = allocBlock(size, opaque);
+  if (!newPtr || !ptr)
+    return newPtr;
+
+  auto oldSize = getHeader(ptr)->size - HeaderSize;
+  std::memcpy(newPtr, ptr, std::min(oldSize, size));
+  freeBlock(ptr, opaque);
+  return newPtr;
+}
+
+static ExternalAllocator externalAllocator = {&allocBlock, &reallocBlock,
+                                              &freeBlock, nullptr};
+
+static ExternalAllocator zeroedAllocator = {&allocZeroedBlock, &reallocBlock,
+                                            &freeBlock, nullptr};
+
+extern "C" {
+/// Sets allocation policy parameters and underlying meminfo allocation
+/// function, must have NRT_MemInfo_alloc_safe_aligned_external signature.
+/// Zero thresholds disable huge pages and caching. Must be called before any
+/// allocation.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtAllocInit(void *allocFunc,
+                                            uint64_t hugePageThreshold,
+                                            uint64_t maxCacheSize,
+                                            int useHugetlb, int touchPages) {
+  policy.allocFunc = reinterpret_cast<AllocExternalFunc>(allocFunc);
+  policy.hugePageThreshold = static_cast<size_t>(hugePageThreshold);
+  policy.maxCacheSize = static_cast<size_t>(maxCacheSize);
+  policy.useHugetlb = useHugetlb != 0;
+  policy.firstTouch = touchPages != 0;
+}
+
+/// Allocates meminfo with data served by the allocation policy: huge pages
+/// mapping for the large arrays and size-class cache for the small ones. Has
+/// NRT_MemInfo_alloc_safe_aligned signature and used instead of it, if
+/// enabled by NUMBA_MLIR_ALLOC_POLICY=1.
+NUMBA_MLIR_RUNTIME_EXPORT void *nmrtAlloc(size_t size, uint32_t alignment) {
+  auto allocFunc = policy.allocFunc;
+  if (!allocFunc)
+    std::abort();
+
+  return allocFunc(size, alignment, &externalAllocator);
+}
+
+/// Allocates meminfo with zeroed data, large blocks are lazily zeroed by the
+/// OS. Has NRT_MemInfo_alloc_safe_aligned signature, used for the
+/// zero-initialized arrays.
+NUMBA_MLIR_RUNTIME_EXPORT void *nmrtAllocZeroed(size_t size,
+                                               uint32_t alignment) {
+  auto allocFunc = policy.allocFunc;
+  if (!allocFunc)
+    std::abort();
+
+  auto meminfo =
+      static_cast<MemInfo *>(allocFunc(size, alignment, &zeroedAllocator));
+  if (meminfo)
+    std::memset(meminfo->data, 0, std::min(size, DebugMarkerSize));
+
+  return meminfo;
+}
+
+/// Releases all cached free blocks.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtAllocPurgeCache() {
+  auto &cache = getCache();
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  for (auto &list : cache.blocks) {
+    for (auto ptr : list)
+      std::free(ptr);
+
+    list.clear();
+  }
+  cache.cachedBytes = 0;
+}
+}
@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "numba-mlir-runtime_export.h"
+
+namespace {
+/// Thread-local bump allocator for the function-scoped temporaries. Functions
+/// save current position on entry and restore it on exit, so allocations are
+/// released in LIFO order. Chunks are reused by subsequent calls, at most one
+/// spare chunk is kept after the current one.
+class Arena {
+public:
+  Arena() = default;
+  Arena(const Arena &) = delete;
+
+  ~Arena() {
+    for (auto &chunk : chunks)
+      std::free(chunk.data);
+  }
+
+  uint64_t save() const { return (uint64_t(current) << OffsetBits) | offset; }
+
+  void restore(uint64_t mark) {
+    current = static_cast<size_t>(mark >> OffsetBits);
+    offset = static_cast<size_t>(mark & ((uint64_t(1) << OffsetBits) - 1));
+    while (chunks.size() > current + 2) {
+      std::free(chunks.back().data);
+      chunks.pop_back();
+    }
+  }
+
+  void *alloc(size_t size, size_t align) {
+    while (true) {
+      if (current < chunks.size()) {
+        auto &chunk = chunks[current];
+        auto begin = reinterpret_cast<uintptr_t>(chunk.data);
+        auto ptr = (begin + offset + align - 1) & ~uintptr_t(align - 1);
+        if (ptr + size <= begin + chunk.size) {
+          offset = ptr + size - begin;
+          return reinterpret_cast<void *>(ptr);
+        }
+
+        if (current + 1 < chunks.size()) {
+          ++current;
+          offset = 0;
+          continue;
+        }
+      }
+
+      auto chunkSize = std::max(MinChunkSize, size + align);
+      if (!chunks.empty())
+        chunkSize = std::max(chunkSize, chunks.back().size * 2);
+
+      auto data = static_cast<char *>(std::malloc(chunkSize));
+      if (!data && chunkSize > size + align) {
+        // Grown chunk is too big, try the exact size.
+        chunkSize = size + align;
+        data = static_cast<char *>(std::malloc(chunkSize));
+      }
+      if (!data)
+        return nullptr;
+
+      chunks.push_back({data, chunkSize});
+      current = chunks.size() - 1;
+      offset = 0;
+    }
+  }
+
+private:
+  static constexpr size_t MinChunkSize = 1 << 20;
+  static constexpr unsigned OffsetBits = 40;
+
+  struct Chunk {
+    char *data;
+    size_t size;
+  };
+
+  std::vector<Chunk> chunks;
+  size_t current = 0;
+  size_t offset = 0;
+};
+
+static thread_local Arena arena;
+} // namespace
+
+extern "C" NUMBA_MLIR_RUNTIME_EXPORT uint64_t nmrtArenaSave() {
+  return arena.save();
+}
+
+extern "C" NUMBA_MLIR_RUNTIME_EXPORT void nmrtArenaRestore(uint64_t mark) {
+  arena.restore(mark);
+}
+
+extern "C" NUMBA_MLIR_RUNTIME_EXPORT void *nmrtArenaAlloc(size_t size,
+                                                          int32_t align) {
+  return arena.alloc(size, static_cast<size_t>(std::max(align, 1)));
+}
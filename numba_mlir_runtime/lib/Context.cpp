@@ -2,8 +2,11 @@
 //
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+#include <atomic>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <thread>
 #include <type_traits>
 
 #include "numba-mlir-runtime_export.h"
@@ -22,39 +25,73 @@ static void *toData(void *ptr) {
   return &(reinterpret_cast<Context *>(ptr)->data);
 }
 
+/// Handle value, indicating that context initialization is in progress in
+/// another thread.
+static void *const InitInProgress =
+    reinterpret_cast<void *>(static_cast<uintptr_t>(1));
+
+/// Context handle is a plain pointer global in the jitted module, access it
+/// atomically, so concurrent first calls initialize context only once.
+static std::atomic<void *> &getHandle(void **ctxHandle) {
+  static_assert(sizeof(std::atomic<void *>) == sizeof(void *));
+  static_assert(std::atomic<void *>::is_always_lock_free);
+  return *reinterpret_cast<std::atomic<void *> *>(ctxHandle);
+}
+
+static void *createContext(size_t contextSize, init_func_t init,
+                           release_func_t release) {
+  auto inlineSize = sizeof(Context::data);
+  auto bytesToAlloc = contextSize <= inlineSize
+                          ? sizeof(Context)
+                          : sizeof(Context) + contextSize - inlineSize;
+  auto &context = *reinterpret_cast<Context *>(new char[bytesToAlloc]);
+  if (init)
+    init(&context.data);
+  context.releaseFunc = release;
+  return &context;
+}
+
 extern "C" NUMBA_MLIR_RUNTIME_EXPORT void *
 nmrtTakeContext(void **ctxHandle, size_t contextSize, init_func_t init,
                 release_func_t release) {
   assert(ctxHandle);
   assert(contextSize > 0);
-  if (!*ctxHandle) {
-    auto inlineSize = sizeof(Context::data);
-    auto bytesToAlloc = contextSize <= inlineSize
-                            ? sizeof(Context)
-                            : sizeof(Context) + contextSize - inlineSize;
-    auto &context = *reinterpret_cast<Context *>(new char[bytesToAlloc]);
-    if (init)
-      init(&context.data);
-    context.releaseFunc = release;
-    *ctxHandle = &context;
+  auto &handle = getHandle(ctxHandle);
+  auto ctx = handle.load(std::memory_order_acquire);
+  if (ctx && ctx != InitInProgress)
+    return toData(ctx);
+
+  void *expected = nullptr;
+  if (handle.compare_exchange_strong(expected, InitInProgress,
+                                     std::memory_order_acquire)) {
+    ctx = createContext(contextSize, init, release);
+    handle.store(ctx, std::memory_order_release);
+    return toData(ctx);
   }
-  return toData(*ctxHandle);
+
+  // Context is being initialized by another thread, wait for it.
+  while ((ctx = handle.load(std::memory_order_acquire)) == InitInProgress)
+    std::this_thread::yield();
+
+  assert(ctx);
+  return toData(ctx);
 }
 
 extern "C" NUMBA_MLIR_RUNTIME_EXPORT void
 nmrtReleaseContext(void * /*context*/) {
-  // Nothing For now
+  // Nothing For now, context is owned by the module and purged on unload.
 }
 
 extern "C" NUMBA_MLIR_RUNTIME_EXPORT void nmrtPurgeContext(void **ctxHandle) {
   assert(ctxHandle);
-  if (*ctxHandle) {
-    auto &context = *reinterpret_cast<Context *>(*ctxHandle);
+  auto ctx = getHandle(ctxHandle).exchange(nullptr, std::memory_order_acq_rel);
+  assert(ctx != InitInProgress);
+  if (ctx) {
+    auto &context = *reinterpret_cast<Context *>(ctx);
     auto release = context.releaseFunc;
     if (release)
       release(&context.data);
 
     delete[] reinterpret_cast<char *>(&context);
-    *ctxHandle = nullptr;
   }
 }
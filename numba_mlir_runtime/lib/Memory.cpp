@@ -2,6 +2,7 @@
 //
 // SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
@@ -9,6 +10,11 @@
 #include <malloc.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 #define mlir_c_runner_utils_EXPORTS 1
 #include <mlir/ExecutionEngine/CRunnerUtils.h>
 
@@ -29,6 +35,158 @@ _mlir_ciface_fillResource1DFloat(MemRefDescriptor<float, 1> *ptr, // NOLINT
   std::fill_n(ptr->allocated, ptr->sizes[0], value);
 }
 
+namespace {
+/// Copy with collapsed dimensions. Dims are stored from outer to inner and
+/// strides are in bytes. Each index of the innermost dim copies contiguous
+/// block of `blockSize` bytes.
+struct CopyDesc {
+  const char *src;
+  char *dst;
+  int64_t rank;
+  int64_t blockSize;
+  const int64_t *sizes;
+  const int64_t *srcStrides;
+  const int64_t *dstStrides;
+};
+} // namespace
+
+template <size_t Size>
+static void copyBlocks(char *dst, const char *src, int64_t count,
+                       int64_t dstStride, int64_t srcStride) {
+  for (int64_t i = 0; i < count; ++i)
+    memcpy(dst + i * dstStride, src + i * srcStride, Size);
+}
+
+static void copyInner(const CopyDesc &desc, char *dst, const char *src,
+                      int64_t count) {
+  auto dstStride = desc.dstStrides[desc.rank - 1];
+  auto srcStride = desc.srcStrides[desc.rank - 1];
+
+  // Constant size memcpy is lowered to plain loads and stores.
+  switch (desc.blockSize) {
+  case 1:
+    return copyBlocks<1>(dst, src, count, dstStride, srcStride);
+  case 2:
+    return copyBlocks<2>(dst, src, count, dstStride, srcStride);
+  case 4:
+    return copyBlocks<4>(dst, src, count, dstStride, srcStride);
+  case 8:
+    return copyBlocks<8>(dst, src, count, dstStride, srcStride);
+  case 16:
+    return copyBlocks<16>(dst, src, count, dstStride, srcStride);
+  default:
+    break;
+  }
+
+  auto size = static_cast<size_t>(desc.blockSize);
+  for (int64_t i = 0; i < count; ++i)
+    memcpy(dst + i * dstStride, src + i * srcStride, size);
+}
+
+/// Copies `[begin, end)` part of the outermost dimension.
+static void copyOuterRange(const CopyDesc &desc, int64_t begin, int64_t end) {
+  auto rank = desc.rank;
+  auto sizes = desc.sizes;
+  auto srcStrides = desc.srcStrides;
+  auto dstStrides = desc.dstStrides;
+  int64_t readIndex = begin * srcStrides[0];
+  int64_t writeIndex = begin * dstStrides[0];
+  if (rank == 1)
+    return copyInner(desc, desc.dst + writeIndex, desc.src + readIndex,
+                     end - begin);
+
+  // Odometer over all dims except innermost, which is handled by copyInner.
+  auto outerRank = rank - 1;
+  int64_t *indices = static_cast<int64_t *>(
+      alloca(sizeof(int64_t) * static_cast<size_t>(outerRank)));
+  indices[0] = begin;
+  for (int64_t axis = 1; axis < outerRank; ++axis)
+    indices[axis] = 0;
+
+  auto innerSize = sizes[rank - 1];
+  for (;;) {
+    copyInner(desc, desc.dst + writeIndex, desc.src + readIndex, innerSize);
+    for (int64_t axis = outerRank - 1; axis >= 0; --axis) {
+      auto newIndex = ++indices[axis];
+      readIndex += srcStrides[axis];
+      writeIndex += dstStrides[axis];
+      if (newIndex != (axis == 0 ? end : sizes[axis]))
+        break;
+
+      if (axis == 0)
+        return;
+
+      indices[axis] = 0;
+      readIndex -= sizes[axis] * srcStrides[axis];
+      writeIndex -= sizes[axis] * dstStrides[axis];
+    }
+  }
+}
+
+#ifdef NUMBA_MLIR_ENABLE_TBB_SUPPORT
+// Keep in sync with TbbParallel.cpp
+struct ParallelRange {
+  int64_t lower;
+  int64_t upper;
+};
+
+struct ParallelInputRange {
+  int64_t lower;
+  int64_t upper;
+  int64_t step;
+};
+
+using ParallelForFunc = void (*)(const ParallelRange *, size_t, void *);
+
+extern "C" int nmrtParallelIsInitialized();
+extern "C" int nmrtParallelIsInRegion();
+extern "C" void nmrtParallelFor(const ParallelInputRange *inputRanges,
+                                size_t numLoops, ParallelForFunc func,
+                                void *ctx);
+
+/// Copies smaller than this (in bytes) are always done on the calling thread.
+static constexpr int64_t ParallelCopyThreshold = 4 * 1024 * 1024;
+
+/// Contiguous copies are split into the chunks of this size.
+static constexpr int64_t ParallelCopyChunk = 256 * 1024;
+
+static bool copyParallel(const CopyDesc &desc, int64_t totalSize) {
+  if (totalSize < ParallelCopyThreshold || !nmrtParallelIsInitialized() ||
+      nmrtParallelIsInRegion())
+    return false;
+
+  if (desc.rank == 0) {
+    struct Ctx {
+      const CopyDesc *desc;
+      int64_t totalSize;
+    } ctx = {&desc, totalSize};
+    auto body = [](const ParallelRange *range, size_t, void *data) {
+      auto &c = *static_cast<const Ctx *>(data);
+      auto begin = range->lower * ParallelCopyChunk;
+      auto end = std::min(range->upper * ParallelCopyChunk, c.totalSize);
+      memcpy(c.desc->dst + begin, c.desc->src + begin,
+             static_cast<size_t>(end - begin));
+    };
+    auto numChunks = (totalSize + ParallelCopyChunk - 1) / ParallelCopyChunk;
+    ParallelInputRange range = {0, numChunks, 1};
+    nmrtParallelFor(&range, 1, body, &ctx);
+    return true;
+  }
+
+  auto body = [](const ParallelRange *range, size_t, void *data) {
+    copyOuterRange(*static_cast<const CopyDesc *>(data), range->lower,
+                   range->upper);
+  };
+  ParallelInputRange range = {0, desc.sizes[0], 1};
+  nmrtParallelFor(&range, 1, body, const_cast<CopyDesc *>(&desc));
+  return true;
+}
+#else
+static bool copyParallel(const CopyDesc & /*desc*/, int64_t /*totalSize*/) {
+  return false;
+}
+#endif
+
 extern "C" NUMBA_MLIR_RUNTIME_EXPORT void
 memrefCopy(int64_t elemSize, UnrankedMemRefType<char> *srcArg,
            UnrankedMemRefType<char> *dstArg) {
@@ -49,42 +207,176 @@ memrefCopy(int64_t elemSize, UnrankedMemRefType<char> *srcArg,
     return;
   }
 
-  int64_t *indices = static_cast<int64_t *>(
+  int64_t *sizes = static_cast<int64_t *>(
       alloca(sizeof(int64_t) * static_cast<size_t>(rank)));
   int64_t *srcStrides = static_cast<int64_t *>(
       alloca(sizeof(int64_t) * static_cast<size_t>(rank)));
   int64_t *dstStrides = static_cast<int64_t *>(
       alloca(sizeof(int64_t) * static_cast<size_t>(rank)));
 
-  // Initialize index and scale strides.
-  for (int rankp = 0; rankp < rank; ++rankp) {
-    indices[rankp] = 0;
-    srcStrides[rankp] = src.strides[rankp] * elemSize;
-    dstStrides[rankp] = dst.strides[rankp] * elemSize;
-  }
+  // Collapse dims from inner to outer: unit dims are dropped, dims contiguous
+  // in both memrefs are folded into the copied block, and dims contiguous
+  // with their inner neighbour are merged into it. Collapsed dims are
+  // collected in reverse order.
+  int64_t blockSize = elemSize;
+  int64_t totalSize = elemSize;
+  int64_t newRank = 0;
+  for (int64_t axis = rank - 1; axis >= 0; --axis) {
+    auto size = src.sizes[axis];
+    totalSize *= size;
+    if (size == 1)
+      continue;
 
-  int64_t readIndex = 0, writeIndex = 0;
-  for (;;) {
-    // Copy over the element, byte by byte.
-    memcpy(dstPtr + writeIndex, srcPtr + readIndex,
-           static_cast<size_t>(elemSize));
-    // Advance index and read position.
-    for (int64_t axis = rank - 1; axis >= 0; --axis) {
-      // Advance at current axis.
-      auto newIndex = ++indices[axis];
-      readIndex += srcStrides[axis];
-      writeIndex += dstStrides[axis];
-      // If this is a valid index, we have our next index, so continue copying.
-      if (src.sizes[axis] != newIndex)
-        break;
-      // We reached the end of this axis. If this is axis 0, we are done.
-      if (axis == 0)
-        return;
-      // Else, reset to 0 and undo the advancement of the linear index that
-      // this axis had. Then continue with the axis one outer.
-      indices[axis] = 0;
-      readIndex -= src.sizes[axis] * srcStrides[axis];
-      writeIndex -= dst.sizes[axis] * dstStrides[axis];
+    auto srcStride = src.strides[axis] * elemSize;
+    auto dstStride = dst.strides[axis] * elemSize;
+    if (newRank == 0 && srcStride == blockSize && dstStride == blockSize) {
+      blockSize *= size;
+      continue;
+    }
+
+    if (newRank > 0) {
+      auto prev = newRank - 1;
+      if (srcStride == srcStrides[prev] * sizes[prev] &&
+          dstStride == dstStrides[prev] * sizes[prev]) {
+        sizes[prev] *= size;
+        continue;
+      }
     }
+
+    sizes[newRank] = size;
+    srcStrides[newRank] = srcStride;
+    dstStrides[newRank] = dstStride;
+    ++newRank;
+  }
+  std::reverse(sizes, sizes + newRank);
+  std::reverse(srcStrides, srcStrides + newRank);
+  std::reverse(dstStrides, dstStrides + newRank);
+
+  CopyDesc desc = {srcPtr,     dstPtr,     newRank,   blockSize,
+                   sizes,      srcStrides, dstStrides};
+  if (copyParallel(desc, totalSize))
+    return;
+
+  if (newRank == 0) {
+    memcpy(dstPtr, srcPtr, static_cast<size_t>(blockSize));
+    return;
+  }
+
+  copyOuterRange(desc, 0, sizes[0]);
+}
+
+/// Fills `[begin, end)` elements of `data` with low `elemSize` bytes of
+/// `value`.
+static void fillRange(char *data, int64_t begin, int64_t end, uint64_t value,
+                      int64_t elemSize) {
+  auto fill = [&](auto val) {
+    using T = decltype(val);
+    auto ptr = reinterpret_cast<T *>(data);
+    std::fill(ptr + begin, ptr + end, val);
+  };
+  switch (elemSize) {
+  case 1:
+    return fill(static_cast<uint8_t>(value));
+  case 2:
+    return fill(static_cast<uint16_t>(value));
+  case 4:
+    return fill(static_cast<uint32_t>(value));
+  case 8:
+    return fill(value);
+  default:
+    abort();
   }
 }
+
+#ifdef NUMBA_MLIR_ENABLE_TBB_SUPPORT
+/// Fills are split into the chunks of this size in bytes.
+static constexpr int64_t ParallelFillChunk = 256 * 1024;
+
+static bool fillParallel(char *data, int64_t count, uint64_t value,
+                         int64_t elemSize) {
+  if (!nmrtParallelIsInitialized() || nmrtParallelIsInRegion())
+    return false;
+
+  struct Ctx {
+    char *data;
+    int64_t count;
+    uint64_t value;
+    int64_t elemSize;
+  } ctx = {data, count, value, elemSize};
+  auto body = [](const ParallelRange *range, size_t, void *ptr) {
+    auto &c = *static_cast<const Ctx *>(ptr);
+    auto chunk = ParallelFillChunk / c.elemSize;
+    auto begin = range->lower * chunk;
+    auto end = std::min(range->upper * chunk, c.count);
+    fillRange(c.data, begin, end, c.value, c.elemSize);
+  };
+  auto chunk = ParallelFillChunk / elemSize;
+  ParallelInputRange range = {0, (count + chunk - 1) / chunk, 1};
+  nmrtParallelFor(&range, 1, body, &ctx);
+  return true;
+}
+#else
+static bool fillParallel(char * /*data*/, int64_t /*count*/,
+                         uint64_t /*value*/, int64_t /*elemSize*/) {
+  return false;
+}
+#endif
+
+/// Fills `count` elements of the contiguous buffer with low `elemSize` bytes
+/// of `value`, in parallel, unless called from the parallel region. Used for
+/// the large arrays initialization in non-parallel functions.
+extern "C" NUMBA_MLIR_RUNTIME_EXPORT void
+nmrtParallelFill(intptr_t data, int64_t count, uint64_t value,
+                 int64_t elemSize) {
+  auto ptr = reinterpret_cast<char *>(data);
+  if (count <= 0 || fillParallel(ptr, count, value, elemSize))
+    return;
+
+  fillRange(ptr, 0, count, value, elemSize);
+}
+
+/// Asks the OS to read ahead memory of `[begin, end)` slices along the
+/// streamed dim with `stride` bytes and base address `data`, for each of the
+/// `numRows` rows, `rowStride` bytes apart, of the dim directly outside it.
+/// Used by the streamed parallel loops to read the next chunk of memory-mapped
+/// inputs while the current one is computed. It's only a hint, errors are
+/// ignored.
+extern "C" NUMBA_MLIR_RUNTIME_EXPORT void
+nmrtStreamPrefetch(intptr_t data, int64_t stride, int64_t begin, int64_t end,
+                   int64_t rowStride, int64_t numRows) {
+#if defined(__linux__)
+  if (end <= begin || stride == 0 || numRows <= 0)
+    return;
+
+  auto first = begin * stride;
+  auto last = (end - 1) * stride;
+  auto lo = std::min(first, last);
+  auto hi = std::max(first, last) + std::abs(stride);
+
+  static const intptr_t pageSize = sysconf(_SC_PAGESIZE);
+  auto advise = [&](intptr_t rangeLo, intptr_t rangeHi) {
+    rangeLo &= ~(pageSize - 1);
+    madvise(reinterpret_cast<void *>(rangeLo),
+            static_cast<size_t>(rangeHi - rangeLo), MADV_WILLNEED);
+  };
+
+  // Rows, which are adjacent or closer than a page, are advised as a single
+  // range, e.g. the streamed dim is the inner dim of the C-contiguous array.
+  auto rowsSpan = (numRows - 1) * rowStride;
+  if (numRows == 1 || std::abs(rowStride) <= hi - lo + pageSize)
+    return advise(data + lo + std::min<int64_t>(rowsSpan, 0),
+                  data + hi + std::max<int64_t>(rowsSpan, 0));
+
+  for (int64_t i = 0; i < numRows; ++i) {
+    auto row = data + i * rowStride;
+    advise(row + lo, row + hi);
+  }
+#else
+  (void)data;
+  (void)stride;
+  (void)begin;
+  (void)end;
+  (void)rowStride;
+  (void)numRows;
+#endif
+}
@@ -0,0 +1,177 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "numba-mlir-runtime_export.h"
+
+namespace {
+using AllocFunc = void *(*)(size_t, uint32_t);
+using DtorFunc = void (*)(void *, size_t, void *);
+
+/// Mirrors Numba NRT_MemInfo layout.
+struct MemInfo {
+  size_t refcnt;
+  DtorFunc dtor;
+  void *dtorInfo;
+  void *data;
+  size_t size;
+  void *externalAllocator;
+};
+
+struct AllocStats {
+  uint64_t allocs = 0;
+  uint64_t allocatedBytes = 0;
+  uint64_t liveBytes = 0;
+  uint64_t peakBytes = 0;
+
+  void alloc(uint64_t size) {
+    ++allocs;
+    allocatedBytes += size;
+    liveBytes += size;
+    if (liveBytes > peakBytes)
+      peakBytes = liveBytes;
+  }
+
+  void free(uint64_t size) { liveBytes -= size; }
+
+  void reset() {
+    allocs = 0;
+    allocatedBytes = 0;
+    peakBytes = liveBytes;
+  }
+};
+
+struct MemoryProfile {
+  std::mutex mutex;
+  AllocFunc allocFunc = nullptr;
+
+  /// Index 0 is for the total process stats, the rest are per function.
+  /// Deque, so names returned to the caller are not invalidated by new
+  /// entries.
+  std::deque<std::pair<std::string, AllocStats>> stats{{"", {}}};
+  std::unordered_map<std::string, size_t> indices;
+};
+
+/// Original meminfo destructor, replaced by the tracking one.
+struct TrackedInfo {
+  DtorFunc dtor;
+  void *dtorInfo;
+  size_t index;
+  size_t size;
+};
+
+static MemoryProfile &getProfile() {
+  static MemoryProfile profile;
+  return profile;
+}
+
+static size_t getFuncIndex(MemoryProfile &profile, const char *name) {
+  auto it = profile.indices.find(name);
+  if (it != profile.indices.end())
+    return it->second;
+
+  auto index = profile.stats.size();
+  profile.stats.emplace_back(name, AllocStats{});
+  profile.indices.emplace(name, index);
+  return index;
+}
+
+static void trackingDtor(void *ptr, size_t size, void *info) {
+  auto tracked = static_cast<TrackedInfo *>(info);
+  {
+    auto &profile = getProfile();
+    std::lock_guard<std::mutex> lock(profile.mutex);
+    profile.stats[0].second.free(tracked->size);
+    profile.stats[tracked->index].second.free(tracked->size);
+  }
+  auto dtor = tracked->dtor;
+  auto dtorInfo = tracked->dtorInfo;
+  std::free(tracked);
+  if (dtor)
+    dtor(ptr, size, dtorInfo);
+}
+} // namespace
+
+extern "C" {
+/// Sets underlying meminfo allocation function, must have the
+/// NRT_MemInfo_alloc_safe_aligned signature.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtMemProfileInit(void *allocFunc) {
+  auto &profile = getProfile();
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  profile.allocFunc = reinterpret_cast<AllocFunc>(allocFunc);
+}
+
+/// Allocates meminfo via underlying allocation function and accounts it
+/// against function `name` until meminfo destructor is called. Used instead
+/// of NRT_MemInfo_alloc_safe_aligned for functions, compiled with
+/// NUMBA_MLIR_MEMORY_PROFILE=1.
+NUMBA_MLIR_RUNTIME_EXPORT void *nmrtMemProfileAlloc(size_t size,
+                                                   uint32_t alignment,
+                                                   const char *name) {
+  auto &profile = getProfile();
+  auto allocFunc = profile.allocFunc;
+  if (!allocFunc)
+    std::abort();
+
+  auto meminfo = static_cast<MemInfo *>(allocFunc(size, alignment));
+  if (!meminfo)
+    return nullptr;
+
+  auto tracked = static_cast<TrackedInfo *>(std::malloc(sizeof(TrackedInfo)));
+  if (!tracked)
+    return meminfo;
+
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  tracked->dtor = meminfo->dtor;
+  tracked->dtorInfo = meminfo->dtorInfo;
+  tracked->index = getFuncIndex(profile, name ? name : "<unknown>");
+  tracked->size = size;
+  meminfo->dtor = &trackingDtor;
+  meminfo->dtorInfo = tracked;
+
+  profile.stats[0].second.alloc(size);
+  profile.stats[tracked->index].second.alloc(size);
+  return meminfo;
+}
+
+/// Returns number of entries in the profile, entry 0 is the process total.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtMemProfileGetNumEntries() {
+  auto &profile = getProfile();
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  return static_cast<int>(profile.stats.size());
+}
+
+/// Returns entry function name and writes its stats into `stats`: number of
+/// allocations, total allocated bytes, currently live bytes and peak live
+/// bytes. Returns null if `index` is out of range.
+NUMBA_MLIR_RUNTIME_EXPORT const char *nmrtMemProfileGetEntry(int index,
+                                                            uint64_t *stats) {
+  auto &profile = getProfile();
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  if (index < 0 || static_cast<size_t>(index) >= profile.stats.size())
+    return nullptr;
+
+  auto &[name, s] = profile.stats[static_cast<size_t>(index)];
+  stats[0] = s.allocs;
+  stats[1] = s.allocatedBytes;
+  stats[2] = s.liveBytes;
+  stats[3] = s.peakBytes;
+  return name.c_str();
+}
+
+/// Resets allocation counters and sets peaks to the currently live bytes, so
+/// reported peaks are high-water marks since the reset.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtMemProfileReset() {
+  auto &profile = getProfile();
+  std::lock_guard<std::mutex> lock(profile.mutex);
+  for (auto &it : profile.stats)
+    it.second.reset();
+}
+}
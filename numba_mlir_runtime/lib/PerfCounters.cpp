@@ -0,0 +1,163 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#endif
+
+#include "numba-mlir-runtime_export.h"
+
+namespace {
+/// Hardware counters session, counters are opened for every thread of the
+/// process, existing at the session start, values are summed over threads.
+/// Threads, created later by the counted threads, are counted via `inherit`.
+struct PerfSession {
+  std::mutex mutex;
+  bool active = false;
+  int numEvents = 0;
+
+  /// Counter fds, numEvents per thread.
+  std::vector<int> fds;
+};
+
+static PerfSession &getSession() {
+  static PerfSession session;
+  return session;
+}
+
+#ifdef __linux__
+static int openCounter(uint32_t type, uint64_t config, pid_t tid) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(
+      syscall(__NR_perf_event_open, &attr, tid, /*cpu*/ -1, /*group_fd*/ -1,
+              /*flags*/ 0));
+}
+
+static std::vector<pid_t> getThreads() {
+  std::vector<pid_t> ret;
+  auto dir = opendir("/proc/self/task");
+  if (!dir)
+    return ret;
+
+  while (auto entry = readdir(dir)) {
+    if (entry->d_name[0] == '.')
+      continue;
+
+    ret.emplace_back(static_cast<pid_t>(std::atoi(entry->d_name)));
+  }
+  closedir(dir);
+  return ret;
+}
+
+static void closeAll(PerfSession &session) {
+  for (auto fd : session.fds)
+    if (fd >= 0)
+      close(fd);
+
+  session.fds.clear();
+  session.active = false;
+}
+#endif
+} // namespace
+
+extern "C" {
+/// Starts counting `count` events, described by perf_event_attr `types` and
+/// `configs`, e.g. PERF_TYPE_HARDWARE/PERF_COUNT_HW_CPU_CYCLES.
+///
+/// Returns 0 on success, -1 if counters are not available on this system or
+/// session is already active. Events, which failed to open on all threads,
+/// will read as 0.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtPerfCountersBegin(int count,
+                                                    const uint32_t *types,
+                                                    const uint64_t *configs) {
+#ifdef __linux__
+  auto &session = getSession();
+  std::lock_guard<std::mutex> lock(session.mutex);
+  if (session.active || count <= 0)
+    return -1;
+
+  bool anyOpened = false;
+  for (auto tid : getThreads()) {
+    for (int i = 0; i < count; ++i) {
+      auto fd = openCounter(types[i], configs[i], tid);
+      anyOpened = anyOpened || fd >= 0;
+      session.fds.emplace_back(fd);
+    }
+  }
+
+  if (!anyOpened) {
+    closeAll(session);
+    return -1;
+  }
+
+  session.numEvents = count;
+  session.active = true;
+  for (auto fd : session.fds) {
+    if (fd < 0)
+      continue;
+
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+  return 0;
+#else
+  (void)count;
+  (void)types;
+  (void)configs;
+  return -1;
+#endif
+}
+
+/// Stops counting and writes summed values for each event, passed to the
+/// `nmrtPerfCountersBegin`, into `values`. Returns 0 on success, -1 if there
+/// is no active session.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtPerfCountersEnd(uint64_t *values) {
+#ifdef __linux__
+  auto &session = getSession();
+  std::lock_guard<std::mutex> lock(session.mutex);
+  if (!session.active)
+    return -1;
+
+  for (auto fd : session.fds)
+    if (fd >= 0)
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+  auto count = session.numEvents;
+  for (int i = 0; i < count; ++i)
+    values[i] = 0;
+
+  for (size_t i = 0; i < session.fds.size(); ++i) {
+    auto fd = session.fds[i];
+    uint64_t val = 0;
+    if (fd >= 0 && read(fd, &val, sizeof(val)) == sizeof(val))
+      values[i % static_cast<size_t>(count)] += val;
+  }
+
+  closeAll(session);
+  return 0;
+#else
+  (void)values;
+  return -1;
+#endif
+}
+}
@@ -0,0 +1,55 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+
+#include "numba-mlir-runtime_export.h"
+
+namespace {
+/// Global stream state for the counter-based generator used by the
+/// `numpy.random` lowering. Values are computed inline by the generated code
+/// as `philox(key, counter)`, runtime only hands out disjoint counter ranges,
+/// so results don't depend on thread count and execution order within a call.
+struct RandomState {
+  RandomState() : key(mix(std::random_device()())), counter(0) {}
+
+  /// Spreads the user seed over all 64 bits of the key (splitmix64).
+  static uint64_t mix(uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+
+  std::atomic<uint64_t> key;
+  std::atomic<uint64_t> counter;
+};
+
+static RandomState &getState() {
+  static RandomState state;
+  return state;
+}
+} // namespace
+
+extern "C" {
+/// Resets generator key from the `seed` and rewinds the counter.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtRandomSeed(uint64_t seed) {
+  auto &state = getState();
+  state.key = RandomState::mix(seed);
+  state.counter = 0;
+}
+
+/// Returns current generator key.
+NUMBA_MLIR_RUNTIME_EXPORT uint64_t nmrtRandomKey() { return getState().key; }
+
+/// Reserves `count` counter values and returns the first one.
+NUMBA_MLIR_RUNTIME_EXPORT uint64_t nmrtRandomAdvance(int64_t count) {
+  if (count < 0)
+    count = 0;
+
+  return getState().counter.fetch_add(static_cast<uint64_t>(count));
+}
+}
@@ -0,0 +1,137 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <type_traits>
+
+#ifdef NUMBA_MLIR_ENABLE_TBB_SUPPORT
+#include <tbb/parallel_sort.h>
+#endif
+
+#include "numba-mlir-runtime_export.h"
+
+#ifdef NUMBA_MLIR_ENABLE_TBB_SUPPORT
+extern "C" int nmrtParallelIsInitialized();
+extern "C" int nmrtParallelIsInRegion();
+extern "C" void nmrtParallelExecute(void (*func)(void *), void *ctx);
+#endif
+
+namespace {
+template <typename T, int N> struct MemRefDescriptor {
+  T *allocated;
+  T *aligned;
+  int64_t offset;
+  int64_t sizes[N];
+  int64_t strides[N];
+};
+
+/// Orders NaNs after all other values, same as numpy.
+template <typename T> struct Less {
+  bool operator()(T a, T b) const {
+    if constexpr (std::is_floating_point_v<T>) {
+      return a < b || (std::isnan(b) && !std::isnan(a));
+    } else {
+      return a < b;
+    }
+  }
+};
+
+/// Arrays smaller than this are always sorted on the calling thread.
+static constexpr int64_t ParallelSortThreshold = 64 * 1024;
+
+#ifdef NUMBA_MLIR_ENABLE_TBB_SUPPORT
+template <typename It, typename Cmp>
+static bool sortParallel(It begin, It end, Cmp cmp) {
+  if ((end - begin) < ParallelSortThreshold || !nmrtParallelIsInitialized() ||
+      nmrtParallelIsInRegion())
+    return false;
+
+  struct Ctx {
+    It begin;
+    It end;
+    Cmp cmp;
+  } ctx = {begin, end, cmp};
+  auto body = [](void *data) {
+    auto &c = *static_cast<Ctx *>(data);
+    tbb::parallel_sort(c.begin, c.end, c.cmp);
+  };
+  // Run in the current runtime arena, so sort doesn't oversubscribe threads
+  // with the parallel loops.
+  nmrtParallelExecute(body, &ctx);
+  return true;
+}
+#else
+template <typename It, typename Cmp>
+static bool sortParallel(It /*begin*/, It /*end*/, Cmp /*cmp*/) {
+  return false;
+}
+#endif
+
+template <typename It, typename Cmp>
+static void sortImpl(It begin, It end, Cmp cmp) {
+  if (!sortParallel(begin, end, cmp))
+    std::sort(begin, end, cmp);
+}
+
+/// Copies strided `src` into contiguous `dst` and sorts it.
+template <typename T>
+static void sort(const MemRefDescriptor<T, 1> *src,
+                 MemRefDescriptor<T, 1> *dst) {
+  auto size = src->sizes[0];
+  auto srcData = src->aligned + src->offset;
+  auto srcStride = src->strides[0];
+  auto dstData = dst->aligned + dst->offset;
+  for (int64_t i = 0; i < size; ++i)
+    dstData[i] = srcData[i * srcStride];
+
+  sortImpl(dstData, dstData + size, Less<T>());
+}
+
+/// Fills `dst` with the indices, which sort `src`. Equal keys are ordered by
+/// index, so result is the same as for the stable sort.
+template <typename T>
+static void argsort(const MemRefDescriptor<T, 1> *src,
+                    MemRefDescriptor<int64_t, 1> *dst) {
+  auto size = src->sizes[0];
+  auto srcData = src->aligned + src->offset;
+  auto srcStride = src->strides[0];
+  auto dstData = dst->aligned + dst->offset;
+  std::iota(dstData, dstData + size, int64_t(0));
+
+  auto cmp = [srcData, srcStride](int64_t a, int64_t b) {
+    auto valA = srcData[a * srcStride];
+    auto valB = srcData[b * srcStride];
+    Less<T> less;
+    if (less(valA, valB))
+      return true;
+    if (less(valB, valA))
+      return false;
+    return a < b;
+  };
+  sortImpl(dstData, dstData + size, cmp);
+}
+} // namespace
+
+#define SORT_VARIANT(T, Suff)                                                  \
+  extern "C" NUMBA_MLIR_RUNTIME_EXPORT void nmrtSort_##Suff(                   \
+      const MemRefDescriptor<T, 1> *src, MemRefDescriptor<T, 1> *dst) {        \
+    sort(src, dst);                                                            \
+  }                                                                            \
+  extern "C" NUMBA_MLIR_RUNTIME_EXPORT void nmrtArgSort_##Suff(                \
+      const MemRefDescriptor<T, 1> *src,                                       \
+      MemRefDescriptor<int64_t, 1> *dst) {                                     \
+    argsort(src, dst);                                                         \
+  }
+
+SORT_VARIANT(int32_t, int32)
+SORT_VARIANT(int64_t, int64)
+SORT_VARIANT(uint32_t, uint32)
+SORT_VARIANT(uint64_t, uint64)
+SORT_VARIANT(float, float32)
+SORT_VARIANT(double, float64)
+
+#undef SORT_VARIANT
@@ -4,19 +4,40 @@
 
 #ifdef NUMBA_MLIR_ENABLE_TBB_SUPPORT
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdio>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #define TBB_PREVIEW_WAITING_FOR_WORKERS 1
 #define TBB_PREVIEW_BLOCKED_RANGE_ND 1
 
 #include <tbb/blocked_rangeNd.h>
 #include <tbb/global_control.h>
+#include <tbb/info.h>
 #include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
 #include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+#include <tbb/task_scheduler_observer.h>
 
+#ifdef __linux__
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "Trace.hpp"
 #include "numba-mlir-runtime_export.h"
 
 #define DEBUG 0
@@ -43,12 +64,221 @@ static void tbbTshRelease(tbb::task_scheduler_handle &tsh) {
 #endif
 }
 
+enum class AffinityPolicy : int {
+  /// Threads are placed by the OS.
+  None = 0,
+
+  /// Consecutive threads are pinned to the consecutive CPUs, SMT siblings
+  /// are adjacent.
+  Compact = 1,
+
+  /// Threads are distributed round-robin between packages, all cores are
+  /// used before SMT siblings.
+  Scatter = 2,
+
+  /// Same as compact, but only first SMT sibling of each core is used.
+  Cores = 3,
+
+  /// Threads are pinned to the explicit CPU list.
+  Explicit = 4,
+};
+
+/// Affinity settings, must be set before runtime initialization.
+static AffinityPolicy affinityPolicy = AffinityPolicy::None;
+static std::vector<int> affinityCpuList;
+
+#ifdef __linux__
+/// Returns CPUs, allowed by the process cpuset.
+static std::vector<int> getAllowedCpus() {
+  std::vector<int> ret;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0)
+    return ret;
+
+  for (int i = 0; i < CPU_SETSIZE; ++i)
+    if (CPU_ISSET(i, &set))
+      ret.emplace_back(i);
+
+  return ret;
+}
+
+static int readCpuTopology(int cpu, const char *name, int defVal) {
+  std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                     "/topology/" + name);
+  int val = defVal;
+  if (!(file >> val))
+    return defVal;
+
+  return val;
+}
+
+/// Returns CPUs for the arena thread indices, according to affinity policy,
+/// empty if threads must not be pinned.
+static std::vector<int> getAffinityCpus() {
+  if (affinityPolicy == AffinityPolicy::None)
+    return {};
+
+  auto allowed = getAllowedCpus();
+  if (affinityPolicy == AffinityPolicy::Explicit) {
+    std::vector<int> ret;
+    for (auto cpu : affinityCpuList)
+      if (std::find(allowed.begin(), allowed.end(), cpu) != allowed.end())
+        ret.emplace_back(cpu);
+
+    return ret;
+  }
+
+  struct CpuInfo {
+    int cpu;
+    int package;
+    int core;
+    int smtRank = 0;
+    int coreRank = 0;
+  };
+  std::vector<CpuInfo> cpus;
+  for (auto cpu : allowed)
+    cpus.push_back({cpu, readCpuTopology(cpu, "physical_package_id", 0),
+                    readCpuTopology(cpu, "core_id", cpu)});
+
+  auto compactOrder = [](const CpuInfo &a, const CpuInfo &b) {
+    return std::make_tuple(a.package, a.core, a.cpu) <
+           std::make_tuple(b.package, b.core, b.cpu);
+  };
+  std::sort(cpus.begin(), cpus.end(), compactOrder);
+
+  // Rank SMT siblings inside the core and cores inside the package.
+  for (size_t i = 1; i < cpus.size(); ++i) {
+    auto &prev = cpus[i - 1];
+    auto &cur = cpus[i];
+    if (cur.package != prev.package)
+      continue;
+
+    if (cur.core == prev.core) {
+      cur.smtRank = prev.smtRank + 1;
+      cur.coreRank = prev.coreRank;
+    } else {
+      cur.coreRank = prev.coreRank + 1;
+    }
+  }
+
+  if (affinityPolicy == AffinityPolicy::Scatter)
+    std::stable_sort(cpus.begin(), cpus.end(),
+                     [](const CpuInfo &a, const CpuInfo &b) {
+                       return std::make_tuple(a.smtRank, a.coreRank,
+                                              a.package) <
+                              std::make_tuple(b.smtRank, b.coreRank, b.package);
+                     });
+
+  std::vector<int> ret;
+  for (auto &info : cpus)
+    if (affinityPolicy != AffinityPolicy::Cores || info.smtRank == 0)
+      ret.emplace_back(info.cpu);
+
+  return ret;
+}
+
+/// CPU, current thread was pinned to, -1 if none.
+static thread_local int pinnedCpu = -1;
+
+static void pinCurrentThread(int cpu) {
+  if (pinnedCpu == cpu)
+    return;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+    pinnedCpu = cpu;
+}
+#else
+static std::vector<int> getAllowedCpus() { return {}; }
+static std::vector<int> getAffinityCpus() { return {}; }
+static void pinCurrentThread(int /*cpu*/) {}
+#endif
+
+/// Pins arena workers to the CPUs by their arena thread index. Threads
+/// joining arena from outside (e.g. Python main thread) are not pinned, so
+/// their affinity isn't changed after they leave.
+class PinningObserver : public tbb::task_scheduler_observer {
+public:
+  PinningObserver(tbb::task_arena &arena, std::vector<int> cpus)
+      : tbb::task_scheduler_observer(arena), cpus(std::move(cpus)) {
+    observe(true);
+  }
+
+  ~PinningObserver() override { observe(false); }
+
+  void on_scheduler_entry(bool worker) override {
+    auto index = tbb::this_task_arena::current_thread_index();
+    if (!worker || index < 0)
+      return;
+
+    pinCurrentThread(cpus[static_cast<size_t>(index) % cpus.size()]);
+  }
+
+private:
+  std::vector<int> cpus;
+};
+
+/// Creates pinning observer for the arena or returns null if threads must not
+/// be pinned.
+static std::unique_ptr<PinningObserver>
+createPinningObserver(tbb::task_arena &arena) {
+  auto cpus = getAffinityCpus();
+  if (cpus.empty())
+    return nullptr;
+
+  return std::make_unique<PinningObserver>(arena, std::move(cpus));
+}
+
+/// Additional arena, which can be selected per thread.
+struct TBBArena {
+  TBBArena(std::string name, int numThreads)
+      : name(std::move(name)), numThreads(numThreads), arena(numThreads),
+        observer(createPinningObserver(arena)) {}
+
+  std::string name;
+  int numThreads;
+  tbb::task_arena arena;
+  std::unique_ptr<PinningObserver> observer;
+};
+
+/// Arena, pinned to the single NUMA node.
+struct NumaNodeArena {
+  NumaNodeArena(tbb::numa_node_id id, int numThreads, int threadOffset)
+      : id(id), numThreads(numThreads), threadOffset(threadOffset),
+        arena(tbb::task_arena::constraints(id, numThreads)) {}
+
+  tbb::numa_node_id id;
+  int numThreads;
+
+  /// Offset added to the arena thread index, so indices are unique across all
+  /// node arenas.
+  int threadOffset;
+  tbb::task_arena arena;
+};
+
 struct TBBContext {
   TBBContext(int numThreads)
       : numThreads(numThreads), schedulerHandle(tbbTshAttach()),
-        arena(numThreads) {}
+        arena(numThreads), observer(createPinningObserver(arena)) {}
 
   ~TBBContext() {
+    // Keep-warm spinners reference the context, wait until they exit.
+    stopWarm.store(true, std::memory_order_relaxed);
+    while (warmSpinners.load(std::memory_order_acquire) > 0)
+      std::this_thread::yield();
+
+    for (auto &nodeArena : numaArenas)
+      nodeArena->arena.terminate();
+
+    for (auto &namedArena : namedArenas) {
+      namedArena->observer.reset();
+      namedArena->arena.terminate();
+    }
+
+    observer.reset();
     arena.terminate();
     if (!tbb::finalize(schedulerHandle, std::nothrow)) {
       if (DEBUG) {
@@ -62,17 +292,127 @@ struct TBBContext {
   int numThreads;
   tbb::task_scheduler_handle schedulerHandle;
   tbb::task_arena arena;
+  std::unique_ptr<PinningObserver> observer;
+
+  /// Keep-warm spinners exit when deadline passes, when any parallel loop is
+  /// started or when context is destroyed.
+  std::atomic<int64_t> warmDeadlineNs{0};
+  std::atomic<int> warmSpinners{0};
+  std::atomic<int> activeLoops{0};
+  std::atomic<bool> stopWarm{false};
+
+  /// Named arenas, indexed by arena id. Entries are never removed until
+  /// context is destroyed, so ids stay valid.
+  std::mutex namedArenasMutex;
+  std::vector<std::unique_ptr<TBBArena>> namedArenas;
+
+  /// Per-node arenas, empty if NUMA mode is disabled. Total concurrency of all
+  /// node arenas is equal to `numThreads`.
+  std::vector<std::unique_ptr<NumaNodeArena>> numaArenas;
+};
+
+// Settings are kept outside of the context, so they can be set before the
+// deferred initialization.
+
+/// Max number of nested parallel loops levels, running in parallel, deeper
+/// loops are executed serially by the calling thread.
+static std::atomic<int> maxDepth{2};
+
+/// Loops with known iteration cost, whose total cost (trip count times
+/// iteration cost) is below this threshold, are executed serially by the
+/// calling thread, as arena entry would cost more than the loop itself.
+static std::atomic<int64_t> serialCostThreshold{20000};
+
+/// Time in nanoseconds, during which default arena workers are kept spinning
+/// after each top-level parallel loop, 0 disables keep-warm mode.
+static std::atomic<int64_t> keepWarmNs{0};
+
+/// Freshly allocated buffers, smaller than this size in bytes, are not
+/// first-touched in NUMA mode, their pages are left to the allocating thread.
+static std::atomic<int64_t> firstTouchThreshold{1024 * 1024};
+
+/// Null until runtime is initialized, either explicitly or on the first use
+/// after `nmrtParallelInitDeferred`.
+static std::atomic<TBBContext *> globalContext{nullptr};
+static std::mutex globalContextMutex;
+
+/// Thread count for the deferred initialization, 0 if it wasn't requested.
+/// Only written under `globalContextMutex`, but read without it.
+static std::atomic<int> deferredNumThreads{0};
+
+/// Named arenas and NUMA mode of the context, destroyed before `fork`, they
+/// are recreated with the context, so arena ids, selected by the threads,
+/// stay valid. Guarded by `globalContextMutex`.
+static std::vector<std::pair<std::string, int>> forkedArenas;
+static bool forkedNuma = false;
+
+/// Arena id selected for the current thread, -1 means default arena.
+static thread_local int currentArenaId = -1;
+
+/// Number of parallel loop bodies, currently executing on this thread.
+static thread_local int currentDepth = 0;
+
+/// Tracks parallel loop body nesting on the current thread.
+struct DepthGuard {
+  DepthGuard() { ++currentDepth; }
+  DepthGuard(const DepthGuard &) = delete;
+  DepthGuard &operator=(const DepthGuard &) = delete;
+  ~DepthGuard() { --currentDepth; }
 };
 
-static std::unique_ptr<TBBContext> globalContext;
+static TBBContext *getContextIfInitialized() {
+  return globalContext.load(std::memory_order_acquire);
+}
+
+static int enableNuma(TBBContext &context);
+
+/// Creates context if it doesn't exist, `globalContextMutex` must be held.
+static TBBContext &initContext(int numThreads) {
+  auto context = globalContext.load(std::memory_order_relaxed);
+  if (!context) {
+    context = new TBBContext(numThreads);
+    for (auto &&[name, arenaThreads] : forkedArenas)
+      context->namedArenas.emplace_back(
+          std::make_unique<TBBArena>(name, arenaThreads));
+
+    if (forkedNuma)
+      enableNuma(*context);
+
+    forkedArenas.clear();
+    forkedNuma = false;
+    globalContext.store(context, std::memory_order_release);
+  }
+  return *context;
+}
 
 static TBBContext &getContext() {
-  if (!globalContext) {
+  if (auto context = getContextIfInitialized())
+    return *context;
+
+  std::lock_guard<std::mutex> lock(globalContextMutex);
+  if (auto context = globalContext.load(std::memory_order_relaxed))
+    return *context;
+
+  auto numThreads = deferredNumThreads.load(std::memory_order_relaxed);
+  if (numThreads < 1) {
     fprintf(stderr, "nmrt: tbb runtime is not initialized\n");
     fflush(stderr);
     abort();
   }
-  return *globalContext;
+  return initContext(numThreads);
+}
+
+/// Returns arena for current thread and its concurrency.
+static std::pair<tbb::task_arena *, int> getCurrentArena(TBBContext &context) {
+  auto id = currentArenaId;
+  if (id >= 0) {
+    std::lock_guard<std::mutex> lock(context.namedArenasMutex);
+    if (static_cast<size_t>(id) < context.namedArenas.size()) {
+      auto &namedArena = *context.namedArenas[static_cast<size_t>(id)];
+      return {&namedArena.arena, namedArena.numThreads};
+    }
+  }
+  return {&context.arena, context.numThreads};
 }
 
 using index_t = std::make_signed_t<std::size_t>;
@@ -95,14 +435,178 @@ struct Dim {
 
 using ParallelForFptr = void (*)(const Range *, size_t, void *);
 
+// Must be kept in sync with the compiler side (`numba.parallel_schedule`).
+enum class ScheduleKind : int64_t {
+  Auto = 0,
+  Static = 1,
+  Simple = 2,
+  Affinity = 3,
+
+  /// Chunks of the outermost dimension are taken from the shared counter,
+  /// chunk size is proportional to the remaining iterations, but not less
+  /// than grain.
+  Guided = 4,
+
+  /// Same as guided, but all chunks have grain size.
+  Dynamic = 5,
+};
+
+/// Per-thread profiling counters, each entry is only updated by the thread
+/// owning it, so no synchronization is needed besides atomicity.
+struct alignas(64) ThreadProfile {
+  std::atomic<uint64_t> busyNs{0};
+  std::atomic<uint64_t> chunks{0};
+};
+
+struct RegionProfile {
+  RegionProfile(std::string name, size_t numThreads)
+      : name(std::move(name)), numThreads(numThreads),
+        threads(new ThreadProfile[numThreads]) {}
+
+  std::string name;
+  std::atomic<uint64_t> calls{0};
+  std::atomic<uint64_t> wallNs{0};
+  size_t numThreads;
+  std::unique_ptr<ThreadProfile[]> threads;
+};
+
+using ProfileClock = std::chrono::steady_clock;
+
+static uint64_t getElapsedNs(ProfileClock::time_point begin) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(ProfileClock::now() -
+                                                           begin)
+          .count());
+}
+
+static void addCounter(std::atomic<uint64_t> &counter, uint64_t val) {
+  counter.fetch_add(val, std::memory_order_relaxed);
+}
+
+static std::atomic<bool> profileEnabled{false};
+
+struct ProfileRegistry {
+  std::mutex mutex;
+
+  /// Profiles are never removed, so pointers to them stay valid.
+  std::vector<std::unique_ptr<RegionProfile>> regions;
+  std::unordered_map<std::string, RegionProfile *> regionsMap;
+};
+
+static ProfileRegistry &getProfileRegistry() {
+  static ProfileRegistry registry;
+  return registry;
+}
+
+static RegionProfile *getRegionProfile(const char *name, size_t numThreads) {
+  if (!name || !profileEnabled.load(std::memory_order_relaxed))
+    return nullptr;
+
+  // Region name is a global in jitted module, cache last lookup.
+  static thread_local const char *cachedName = nullptr;
+  static thread_local RegionProfile *cachedProfile = nullptr;
+  if (cachedName == name && cachedProfile->name == name)
+    return cachedProfile;
+
+  auto &registry = getProfileRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto &profile = registry.regionsMap[name];
+  if (!profile) {
+    registry.regions.emplace_back(
+        std::make_unique<RegionProfile>(name, numThreads));
+    profile = registry.regions.back().get();
+  }
+  cachedName = name;
+  cachedProfile = profile;
+  return profile;
+}
+
+struct Schedule {
+  ScheduleKind kind = ScheduleKind::Auto;
+
+  /// Explicit grain size for each dimension, 0 means default heuristic.
+  index_t grain = 0;
+
+  /// Affinity partitioner state, persistent between calls from the same call
+  /// site.
+  tbb::affinity_partitioner *affinity = nullptr;
+
+  /// Offset added to the arena thread index before passing it to the loop
+  /// body, used when iteration space is split between several arenas.
+  index_t threadOffset = 0;
+
+  /// Region profiling counters, null if profiling is disabled.
+  RegionProfile *profile = nullptr;
+
+  /// Region name, used for trace events.
+  const char *region = "parallel_for";
+
+  /// Record region and per-thread chunks trace events.
+  bool trace = false;
+
+  /// Compiler estimated cost of the single iteration, 0 if unknown.
+  index_t cost = 0;
+};
+
+/// Call site affinity state. Partitioner is not thread-safe, so it is only
+/// used by one caller at a time, concurrent calls from the same call site
+/// (e.g. `nogil` functions called from different Python threads) fall back to
+/// the default partitioner.
+struct AffinityState {
+  tbb::affinity_partitioner partitioner;
+  std::atomic<bool> busy{false};
+};
+
+static AffinityState *getAffinityState(void **state) {
+  assert(state);
+  // States are owned by runtime and never released, as jitted modules, which
+  // hold pointers to them, can outlive the TBB context.
+  static std::mutex mutex;
+  static std::vector<std::unique_ptr<AffinityState>> states;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!*state) {
+    states.emplace_back(std::make_unique<AffinityState>());
+    *state = states.back().get();
+  }
+  return static_cast<AffinityState *>(*state);
+}
+
+/// Holds exclusive access to the call site affinity partitioner, if it is
+/// available.
+class AffinityLock {
+public:
+  AffinityLock(AffinityState *state) {
+    if (state && !state->busy.exchange(true, std::memory_order_acquire))
+      lockedState = state;
+  }
+
+  AffinityLock(const AffinityLock &) = delete;
+  AffinityLock &operator=(const AffinityLock &) = delete;
+
+  ~AffinityLock() {
+    if (lockedState)
+      lockedState->busy.store(false, std::memory_order_release);
+  }
+
+  tbb::affinity_partitioner *get() const {
+    return lockedState ? &lockedState->partitioner : nullptr;
+  }
+
+private:
+  AffinityState *lockedState = nullptr;
+};
+
 static void parallelForNested(const InputRange *inputRanges, size_t depth,
                               size_t numThreads, size_t numLoops, Dim *prevDim,
-                              ParallelForFptr func, void *ctx);
+                              ParallelForFptr func, void *ctx,
+                              const Schedule &sched);
 
 template <unsigned N, bool Term, size_t... Is>
 static void runParallelFor(const InputRange *inputRanges, size_t depth,
                            size_t numThreads, size_t numLoops, Dim *prevDim,
-                           ParallelForFptr func, void *ctx) {
+                           ParallelForFptr func, void *ctx,
+                           const Schedule &sched) {
   std::array<InputRange, N> tempRanges;
   std::copy_n(inputRanges + depth, N, tempRanges.begin());
 
@@ -127,8 +631,11 @@ static void runParallelFor(const InputRange *inputRanges, size_t depth,
     auto upperBound = input.upper;
     auto step = input.step;
     index_t count = (upperBound - lowerBound + step - 1) / step;
-    index_t grain = std::max(
-        index_t(1), std::min(count / index_t(numThreads) / 2, index_t(64)));
+    index_t grain =
+        sched.grain > 0
+            ? sched.grain
+            : std::max(index_t(1),
+                       std::min(count / index_t(numThreads) / 2, index_t(64)));
     return tbb::blocked_range<index_t>(0, count, grain);
   };
 
@@ -138,6 +645,7 @@ static void runParallelFor(const InputRange *inputRanges, size_t depth,
     auto threadIndex =
         static_cast<index_t>(tbb::this_task_arena::current_thread_index());
     assert(threadIndex >= 0);
+    threadIndex += sched.threadOffset;
     std::array<Range, 8> staticRanges;
     std::unique_ptr<Range[]> dynRanges;
     auto *rangePtr = [&]() -> Range * {
@@ -167,7 +675,23 @@ static void runParallelFor(const InputRange *inputRanges, size_t depth,
       }
       fprintf(stderr, "\n");
     }
-    func(rangePtr, threadIndex, ctx);
+    DepthGuard depthGuard;
+    auto traceBegin = sched.trace ? nmrtTraceNow() : 0;
+    if (auto profile = sched.profile) {
+      auto begin = ProfileClock::now();
+      func(rangePtr, threadIndex, ctx);
+      auto index = static_cast<size_t>(threadIndex);
+      if (index < profile->numThreads) {
+        auto &threadProfile = profile->threads[index];
+        addCounter(threadProfile.busyNs, getElapsedNs(begin));
+        addCounter(threadProfile.chunks, 1);
+      }
+    } else {
+      func(rangePtr, threadIndex, ctx);
+    }
+    if (sched.trace)
+      nmrtTraceEvent(sched.region, "parallel_chunk", traceBegin,
+                     nmrtTraceNow());
   };
 
   auto loopBody = [&](const tbb::blocked_rangeNd<index_t, N> &r) {
@@ -189,41 +713,297 @@ static void runParallelFor(const InputRange *inputRanges, size_t depth,
     } else {
       auto next = depth + N;
       parallelForNested(inputRanges, next, numThreads, numLoops, prev, func,
-                        ctx);
+                        ctx, sched);
     }
   };
 
-  tbb::parallel_for(range, loopBody, tbb::auto_partitioner());
+  // Ragged loops, every task takes chunks of the first dimension from the
+  // shared counter until iteration space is exhausted, other dimensions are
+  // processed whole inside the chunk.
+  if (sched.kind == ScheduleKind::Guided ||
+      sched.kind == ScheduleKind::Dynamic) {
+    auto first = getRange(0);
+    auto count = first.end();
+    auto minChunk = static_cast<index_t>(first.grainsize());
+    auto numWorkers = std::max(index_t(1), index_t(numThreads));
+    bool guided = sched.kind == ScheduleKind::Guided;
+    std::atomic<index_t> next{0};
+    auto worker = [&](const tbb::blocked_range<index_t> &) {
+      auto cur = next.load(std::memory_order_relaxed);
+      while (cur < count) {
+        auto chunk =
+            guided ? std::max(minChunk, (count - cur) / (2 * numWorkers))
+                   : minChunk;
+        auto end = std::min(count, cur + chunk);
+        if (!next.compare_exchange_weak(cur, end, std::memory_order_relaxed))
+          continue;
+
+        tbb::blocked_rangeNd<index_t, N> chunkRange(
+            (Is == 0 ? tbb::blocked_range<index_t>(cur, end, end - cur)
+                     : getRange(Is))...);
+        loopBody(chunkRange);
+        cur = next.load(std::memory_order_relaxed);
+      }
+    };
+    tbb::parallel_for(tbb::blocked_range<index_t>(0, numWorkers, 1), worker,
+                      tbb::simple_partitioner());
+    return;
+  }
+
+  switch (sched.kind) {
+  case ScheduleKind::Static:
+    tbb::parallel_for(range, loopBody, tbb::static_partitioner());
+    break;
+  case ScheduleKind::Simple:
+    tbb::parallel_for(range, loopBody, tbb::simple_partitioner());
+    break;
+  case ScheduleKind::Affinity:
+    // Affinity partitioner cannot be shared between concurrent nested loops,
+    // so it is only used for the outermost level.
+    if (sched.affinity && depth == 0) {
+      tbb::parallel_for(range, loopBody, *sched.affinity);
+      break;
+    }
+    [[fallthrough]];
+  default:
+    tbb::parallel_for(range, loopBody, tbb::auto_partitioner());
+    break;
+  }
+}
+
+template <unsigned N, bool Term, size_t... Is>
+static void runParallelForSeq(std::index_sequence<Is...>,
+                              const InputRange *inputRanges, size_t depth,
+                              size_t numThreads, size_t numLoops, Dim *prevDim,
+                              ParallelForFptr func, void *ctx,
+                              const Schedule &sched) {
+  runParallelFor<N, Term, Is...>(inputRanges, depth, numThreads, numLoops,
+                                 prevDim, func, ctx, sched);
+}
+
+template <unsigned N, bool Term>
+static void runParallelForN(const InputRange *inputRanges, size_t depth,
+                            size_t numThreads, size_t numLoops, Dim *prevDim,
+                            ParallelForFptr func, void *ctx,
+                            const Schedule &sched) {
+  runParallelForSeq<N, Term>(std::make_index_sequence<N>(), inputRanges, depth,
+                             numThreads, numLoops, prevDim, func, ctx, sched);
 }
 
+/// Max rank of iteration space handled by single `blocked_rangeNd`, loops with
+/// bigger rank are split into nested `parallel_for`s.
+static constexpr unsigned MaxFlatRank = 8;
+
 static void parallelForNested(const InputRange *inputRanges, size_t depth,
                               size_t numThreads, size_t numLoops, Dim *prevDim,
-                              ParallelForFptr func, void *ctx) {
+                              ParallelForFptr func, void *ctx,
+                              const Schedule &sched) {
   assert(numLoops > depth);
   auto rem = numLoops - depth;
-  if (rem == 1) {
-    runParallelFor<1, true, 0>(inputRanges, depth, numThreads, numLoops,
-                               prevDim, func, ctx);
-  } else if (rem == 2) {
-    runParallelFor<2, true, 0, 1>(inputRanges, depth, numThreads, numLoops,
-                                  prevDim, func, ctx);
-  } else if (rem == 3) {
-    runParallelFor<3, true, 0, 1, 2>(inputRanges, depth, numThreads, numLoops,
-                                     prevDim, func, ctx);
-  } else {
-    runParallelFor<3, false, 0, 1, 2>(inputRanges, depth, numThreads, numLoops,
-                                      prevDim, func, ctx);
+  // Handle entire iteration space with single N-D range if possible, so we
+  // have only one level of work stealing.
+#define RUN_PARALLEL_FOR(N, Term)                                              \
+  runParallelForN<N, Term>(inputRanges, depth, numThreads, numLoops, prevDim,  \
+                           func, ctx, sched)
+  static_assert(MaxFlatRank == 8, "Update the switch below");
+  switch (rem) {
+  case 1:
+    RUN_PARALLEL_FOR(1, true);
+    break;
+  case 2:
+    RUN_PARALLEL_FOR(2, true);
+    break;
+  case 3:
+    RUN_PARALLEL_FOR(3, true);
+    break;
+  case 4:
+    RUN_PARALLEL_FOR(4, true);
+    break;
+  case 5:
+    RUN_PARALLEL_FOR(5, true);
+    break;
+  case 6:
+    RUN_PARALLEL_FOR(6, true);
+    break;
+  case 7:
+    RUN_PARALLEL_FOR(7, true);
+    break;
+  case 8:
+    RUN_PARALLEL_FOR(8, true);
+    break;
+  default:
+    RUN_PARALLEL_FOR(MaxFlatRank, false);
+    break;
   }
+#undef RUN_PARALLEL_FOR
 }
-} // namespace
 
-extern "C" {
-NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelFor(const InputRange *inputRanges,
-                                               size_t numLoops,
-                                               ParallelForFptr func,
-                                               void *ctx) {
+/// Returns start of the `node` part of `count` elements, split between NUMA
+/// nodes proportionally to their concurrency. Array first-touch and parallel
+/// loops must use the same partitioning.
+static index_t getNumaPartBegin(const TBBContext &context, size_t node,
+                                index_t count) {
+  auto &arenas = context.numaArenas;
+  if (node >= arenas.size())
+    return count;
+
+  auto offset = static_cast<index_t>(arenas[node]->threadOffset);
+  auto total = static_cast<index_t>(context.numThreads);
+  return count * offset / total;
+}
+
+/// Splits outermost loop dimension between NUMA node arenas and runs them
+/// concurrently.
+static void parallelForNuma(TBBContext &context, const InputRange *inputRanges,
+                            size_t numLoops, ParallelForFptr func, void *ctx,
+                            const Schedule &sched) {
+  auto &arenas = context.numaArenas;
+  auto numNodes = arenas.size();
+  auto outer = inputRanges[0];
+  index_t count = (outer.upper - outer.lower + outer.step - 1) / outer.step;
+
+  std::vector<InputRange> nodeRanges(numNodes * numLoops);
+  std::unique_ptr<tbb::task_group[]> groups(new tbb::task_group[numNodes]);
+  for (size_t i = 0; i < numNodes; ++i) {
+    auto begin = getNumaPartBegin(context, i, count);
+    auto end = getNumaPartBegin(context, i + 1, count);
+    if (begin >= end)
+      continue;
+
+    auto *ranges = nodeRanges.data() + i * numLoops;
+    std::copy_n(inputRanges, numLoops, ranges);
+    ranges[0].lower = outer.lower + begin * outer.step;
+    ranges[0].upper = std::min(outer.upper, outer.lower + end * outer.step);
+
+    auto *node = arenas[i].get();
+    node->arena.execute([&, node, ranges, i] {
+      groups[i].run([&, node, ranges] {
+        Schedule nodeSched = sched;
+        // Affinity partitioner state cannot be shared between arenas.
+        nodeSched.affinity = nullptr;
+        nodeSched.threadOffset = node->threadOffset;
+        parallelForNested(ranges, 0, static_cast<size_t>(node->numThreads),
+                          numLoops, nullptr, func, ctx, nodeSched);
+      });
+    });
+  }
+
+  for (size_t i = 0; i < numNodes; ++i)
+    arenas[i]->arena.execute([&] { groups[i].wait(); });
+}
+
+/// Runs the whole iteration space on the calling thread, used for nested
+/// loops beyond max depth and small loops.
+static void parallelForSerial(const InputRange *inputRanges, size_t numLoops,
+                              ParallelForFptr func, void *ctx) {
+  std::array<Range, 8> staticRanges;
+  std::unique_ptr<Range[]> dynRanges;
+  auto *ranges = staticRanges.data();
+  if (numLoops > staticRanges.size()) {
+    dynRanges.reset(new Range[numLoops]);
+    ranges = dynRanges.get();
+  }
+
+  for (size_t i = 0; i < numLoops; ++i)
+    ranges[i] = Range{inputRanges[i].lower, inputRanges[i].upper};
+
+  // Caller outside of any arena uses the first thread slot, as loop is not
+  // running concurrently with any other part of this call.
+  auto threadIndex = std::max(tbb::this_task_arena::current_thread_index(), 0);
+  DepthGuard depthGuard;
+  func(ranges, static_cast<size_t>(threadIndex), ctx);
+}
+
+/// Warmup duration used by `nmrtParallelWarmup`, if keep-warm mode is
+/// disabled.
+static constexpr int64_t DefaultWarmupNs = 1000 * 1000;
+
+static int64_t getNowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             ProfileClock::now().time_since_epoch())
+      .count();
+}
+
+/// Occupies default arena workers with spinning tasks for `durationNs`, so
+/// the next parallel loop doesn't pay worker wake-up latency. Spinners yield
+/// to the OS scheduler on each check and exit as soon as any parallel loop is
+/// started, leaving workers awake to pick up its chunks.
+static void keepWorkersWarm(TBBContext &context, int64_t durationNs) {
+  if (durationNs <= 0)
+    return;
+
+  // Deadline is only extended, running spinners will see the new value.
+  auto deadline = getNowNs() + durationNs;
+  auto prev = context.warmDeadlineNs.load(std::memory_order_relaxed);
+  while (prev < deadline && !context.warmDeadlineNs.compare_exchange_weak(
+                                prev, deadline, std::memory_order_relaxed))
+    ;
+
+  // Calling thread joins the arena by itself, spin up all other workers.
+  auto numSpinners = context.numThreads - 1;
+  auto running = context.warmSpinners.load(std::memory_order_relaxed);
+  while (running < numSpinners) {
+    if (!context.warmSpinners.compare_exchange_weak(
+            running, running + 1, std::memory_order_relaxed))
+      continue;
+
+    ++running;
+    context.arena.enqueue([&context] {
+      while (!context.stopWarm.load(std::memory_order_relaxed) &&
+             context.activeLoops.load(std::memory_order_relaxed) == 0 &&
+             getNowNs() < context.warmDeadlineNs.load(std::memory_order_relaxed))
+        std::this_thread::yield();
+
+      context.warmSpinners.fetch_sub(1, std::memory_order_release);
+    });
+  }
+}
+
+/// Tracks running top-level parallel loops, restarts keep-warm spinners when
+/// the last one finishes.
+struct ActiveLoopGuard {
+  ActiveLoopGuard(TBBContext &ctx, bool enabled)
+      : context(enabled ? &ctx : nullptr) {
+    if (context)
+      context->activeLoops.fetch_add(1, std::memory_order_relaxed);
+  }
+  ActiveLoopGuard(const ActiveLoopGuard &) = delete;
+  ActiveLoopGuard &operator=(const ActiveLoopGuard &) = delete;
+  ~ActiveLoopGuard() {
+    if (!context)
+      return;
+
+    if (context->activeLoops.fetch_sub(1, std::memory_order_relaxed) == 1)
+      keepWorkersWarm(*context, keepWarmNs.load(std::memory_order_relaxed));
+  }
+
+  TBBContext *context;
+};
+
+/// Checks if loop total cost is below the serial threshold. Ranges must be
+/// non-empty.
+static bool isSmallLoop(const InputRange *inputRanges, size_t numLoops,
+                        const Schedule &sched) {
+  if (sched.cost <= 0)
+    return false;
+
+  auto threshold = serialCostThreshold.load(std::memory_order_relaxed);
+  auto cost = sched.cost;
+  for (size_t i = 0; i < numLoops && cost < threshold; ++i) {
+    auto &range = inputRanges[i];
+    auto count = (range.upper - range.lower + range.step - 1) / range.step;
+    // Saturate instead of overflowing, we only need comparison result.
+    cost = count > (threshold / cost) ? threshold : cost * count;
+  }
+  return cost < threshold;
+}
+
+static void parallelForRun(const InputRange *inputRanges, size_t numLoops,
+                           ParallelForFptr func, void *ctx,
+                           const Schedule &sched) {
   auto &context = getContext();
-  auto numThreads = static_cast<size_t>(context.numThreads);
+  auto [arena, arenaThreads] = getCurrentArena(context);
+  auto numThreads = static_cast<size_t>(arenaThreads);
   if (DEBUG) {
     std::lock_guard<std::mutex> lock(getDebugMutex());
     fprintf(stderr, "parallel_for num_loops=%d: ", static_cast<int>(numLoops));
@@ -241,26 +1021,469 @@ NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelFor(const InputRange *inputRanges,
       return;
   }
 
-  context.arena.execute([&] {
-    parallelForNested(inputRanges, 0, numThreads, numLoops, nullptr, func, ctx);
+  // Thread indices in NUMA node arenas are offset by the caller schedule,
+  // which nested calls don't have, so they always go through default arena.
+  auto depth = currentDepth;
+  if ((depth == 0 || context.numaArenas.empty()) &&
+      isSmallLoop(inputRanges, numLoops, sched))
+    return parallelForSerial(inputRanges, numLoops, func, ctx);
+
+  if (depth > 0 && context.numaArenas.empty() &&
+      depth >= maxDepth.load(std::memory_order_relaxed))
+    return parallelForSerial(inputRanges, numLoops, func, ctx);
+
+  ActiveLoopGuard activeGuard(context, depth == 0);
+
+  // Only split top-level loops running in default arena, nested calls stay in
+  // the arena of the caller.
+  if (!context.numaArenas.empty() && arena == &context.arena &&
+      tbb::this_task_arena::current_thread_index() ==
+          tbb::task_arena::not_initialized)
+    return parallelForNuma(context, inputRanges, numLoops, func, ctx, sched);
+
+  auto run = [&] {
+    parallelForNested(inputRanges, 0, numThreads, numLoops, nullptr, func, ctx,
+                      sched);
+  };
+
+  // Nested loop body is executed by the worker, which has loaded its
+  // per-thread reduction slot of the outer loop. Isolate nested loop, so the
+  // worker doesn't steal another outer loop chunk while waiting, as it would
+  // use the same slot.
+  arena->execute([&] {
+    if (depth > 0) {
+      tbb::this_task_arena::isolate(run);
+    } else {
+      run();
+    }
   });
 }
 
+static void parallelForImpl(const InputRange *inputRanges, size_t numLoops,
+                            ParallelForFptr func, void *ctx,
+                            const Schedule &sched) {
+  auto profile = sched.profile;
+  if (!profile && !sched.trace)
+    return parallelForRun(inputRanges, numLoops, func, ctx, sched);
+
+  auto traceBegin = sched.trace ? nmrtTraceNow() : 0;
+  auto begin = ProfileClock::now();
+  parallelForRun(inputRanges, numLoops, func, ctx, sched);
+  if (profile) {
+    addCounter(profile->wallNs, getElapsedNs(begin));
+    addCounter(profile->calls, 1);
+  }
+  if (sched.trace)
+    nmrtTraceEvent(sched.region, "parallel", traceBegin, nmrtTraceNow());
+}
+
+/// Creates NUMA node arenas, see `nmrtParallelEnableNuma`.
+static int enableNuma(TBBContext &context) {
+  if (!context.numaArenas.empty())
+    return static_cast<int>(context.numaArenas.size());
+
+  auto nodes = tbb::info::numa_nodes();
+  if (nodes.size() < 2)
+    return 0;
+
+  std::vector<int> nodeThreads;
+  int totalThreads = 0;
+  for (auto node : nodes) {
+    nodeThreads.emplace_back(tbb::info::default_concurrency(node));
+    totalThreads += nodeThreads.back();
+  }
+
+  if (totalThreads <= 0)
+    return 0;
+
+  // Distribute `numThreads` proportionally to node concurrency.
+  int offset = 0;
+  int acc = 0;
+  for (size_t i = 0; i < nodes.size(); ++i) {
+    acc += nodeThreads[i];
+    auto end = static_cast<int>(static_cast<int64_t>(context.numThreads) * acc /
+                                totalThreads);
+    auto count = end - offset;
+    if (count <= 0)
+      continue;
+
+    if (DEBUG)
+      fprintf(stderr, "nmrt_parallel numa node %d: %d threads\n",
+              static_cast<int>(nodes[i]), count);
+
+    context.numaArenas.emplace_back(
+        std::make_unique<NumaNodeArena>(nodes[i], count, offset));
+    offset = end;
+  }
+
+  if (context.numaArenas.size() < 2) {
+    context.numaArenas.clear();
+    return 0;
+  }
+
+  return static_cast<int>(context.numaArenas.size());
+}
+
+} // namespace
+
+extern "C" {
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelFor(const InputRange *inputRanges,
+                                               size_t numLoops,
+                                               ParallelForFptr func,
+                                               void *ctx) {
+  Schedule sched;
+  sched.trace = nmrtTraceIsEnabled() != 0;
+  parallelForImpl(inputRanges, numLoops, func, ctx, sched);
+}
+
+/// Parallel for with explicit per-call-site schedule.
+///
+/// `state` must point to the zero-initialized call site specific storage,
+/// which is used to keep affinity partitioner between calls.
+///
+/// `region` is an optional region name, used to attribute profiling counters
+/// and trace events.
+///
+/// `cost` is the estimated cost of the single iteration, loops with small
+/// total cost are executed on the calling thread, 0 means unknown.
+///
+/// Can be called concurrently from different threads, including from the same
+/// call site, affinity is only used by one of the concurrent callers.
+NUMBA_MLIR_RUNTIME_EXPORT void
+nmrtParallelForSchedule(const InputRange *inputRanges, size_t numLoops,
+                        ParallelForFptr func, void *ctx, int64_t kind,
+                        int64_t grain, void **state, const char *region,
+                        int64_t cost) {
+  Schedule sched;
+  sched.kind = static_cast<ScheduleKind>(kind);
+  sched.grain = static_cast<index_t>(grain);
+  sched.cost = static_cast<index_t>(cost);
+  AffinityLock affinity(sched.kind == ScheduleKind::Affinity && state
+                            ? getAffinityState(state)
+                            : nullptr);
+  sched.affinity = affinity.get();
+
+  if (region) {
+    sched.region = region;
+    sched.profile = getRegionProfile(
+        region, static_cast<size_t>(getContext().numThreads));
+  }
+  sched.trace = nmrtTraceIsEnabled() != 0;
+
+  parallelForImpl(inputRanges, numLoops, func, ctx, sched);
+}
+
+/// Sets worker threads affinity policy (see `AffinityPolicy`), `cpus` is
+/// only used by explicit policy. CPUs outside of the process cpuset are
+/// ignored. Must be called before `nmrtParallelInit`.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelSetAffinity(int policy,
+                                                       const int *cpus,
+                                                       int numCpus) {
+  assert(!getContextIfInitialized() && "Runtime is already initialized");
+  affinityPolicy = static_cast<AffinityPolicy>(policy);
+  affinityCpuList.assign(cpus, cpus + std::max(numCpus, 0));
+}
+
+/// Returns default number of threads: number of CPUs, selected by the
+/// affinity policy, or number of CPUs in the process cpuset.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtParallelGetDefaultNumThreads() {
+  auto cpus = getAffinityCpus();
+  if (cpus.empty())
+    cpus = getAllowedCpus();
+
+  if (cpus.empty())
+    return std::max(tbb::info::default_concurrency(), 1);
+
+  return static_cast<int>(cpus.size());
+}
+
+/// Initializes runtime with `numThreads` threads, values less than 1 select
+/// `nmrtParallelGetDefaultNumThreads()`.
 NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelInit(int numThreads) {
+  if (numThreads < 1)
+    numThreads = nmrtParallelGetDefaultNumThreads();
+
   if (DEBUG)
     fprintf(stderr, "nmrt_parallel_init %d\n", numThreads);
 
-  if (!globalContext)
-    globalContext = std::make_unique<TBBContext>(numThreads);
+  std::lock_guard<std::mutex> lock(globalContextMutex);
+  auto &context = initContext(numThreads);
+  (void)context;
+  assert(context.numThreads == numThreads);
+}
+
+/// Same as `nmrtParallelInit`, but TBB scheduler and workers are only created
+/// on the first runtime use, e.g. the first parallel loop.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelInitDeferred(int numThreads) {
+  if (numThreads < 1)
+    numThreads = nmrtParallelGetDefaultNumThreads();
+
+  std::lock_guard<std::mutex> lock(globalContextMutex);
+  deferredNumThreads.store(numThreads, std::memory_order_relaxed);
+}
+
+/// Creates named arena or returns existing one with the same name, returns
+/// arena id.
+///
+/// Arena concurrency is clamped to the default arena thread count, as jitted
+/// code is compiled with max concurrency equal to it.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtParallelCreateArena(const char *name,
+                                                      int numThreads) {
+  assert(name);
+  auto &context = getContext();
+  numThreads = std::max(1, std::min(numThreads, context.numThreads));
+  if (DEBUG)
+    fprintf(stderr, "nmrt_parallel_create_arena %s %d\n", name, numThreads);
+
+  std::lock_guard<std::mutex> lock(context.namedArenasMutex);
+  auto &arenas = context.namedArenas;
+  for (size_t i = 0, e = arenas.size(); i < e; ++i)
+    if (arenas[i]->name == name)
+      return static_cast<int>(i);
+
+  arenas.emplace_back(std::make_unique<TBBArena>(name, numThreads));
+  return static_cast<int>(arenas.size() - 1);
+}
+
+/// Select arena for the subsequent parallel loops on the current thread, -1
+/// selects default arena.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelSetCurrentArena(int id) {
+  currentArenaId = id;
+}
+
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtParallelGetCurrentArena() {
+  return currentArenaId;
+}
+
+/// Returns non-zero if parallel runtime was initialized or will be
+/// initialized on the first use.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtParallelIsInitialized() {
+  return getContextIfInitialized() != nullptr ||
+         deferredNumThreads.load(std::memory_order_relaxed) > 0;
+}
+
+/// Returns non-zero if called from the parallel loop body.
+///
+/// Arena thread index can't be used for this, as the thread stays attached to
+/// the arena after its first parallel loop.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtParallelIsInRegion() {
+  return currentDepth > 0;
+}
+
+/// Runs `func(ctx)` in the arena, selected for the current thread, so nested
+/// TBB parallelism of external libraries shares the runtime workers.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelExecute(void (*func)(void *),
+                                                   void *ctx) {
+  assert(func);
+  if (!nmrtParallelIsInitialized())
+    return func(ctx);
+
+  auto arena = getCurrentArena(getContext()).first;
+  arena->execute([&] { func(ctx); });
+}
+
+/// Sets max number of nested parallel loop levels, running in parallel,
+/// deeper levels are executed serially. Values less than 1 are clamped to 1.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelSetMaxDepth(int depth) {
+  maxDepth.store(std::max(depth, 1), std::memory_order_relaxed);
+}
+
+/// Sets total loop cost threshold, below which loops with known iteration cost
+/// are executed serially, 0 disables serial cutoff.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelSetSerialCostThreshold(int64_t val) {
+  serialCostThreshold.store(std::max<int64_t>(val, 0),
+                            std::memory_order_relaxed);
+}
+
+/// Sets minimal buffer size in bytes, first-touched in NUMA mode.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelSetFirstTouchThreshold(int64_t val) {
+  firstTouchThreshold.store(std::max<int64_t>(val, 1),
+                            std::memory_order_relaxed);
+}
+
+/// Sets time in microseconds, during which workers are kept spinning after
+/// each top-level parallel loop, trading idle CPU time for the lower latency
+/// of the next loop. 0 disables keep-warm mode.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelSetKeepWarm(int64_t us) {
+  keepWarmNs.store(std::max<int64_t>(us, 0) * 1000, std::memory_order_relaxed);
+}
+
+/// Wakes up workers ahead of the latency critical parallel loops, they are
+/// kept spinning for the keep-warm time (or 1ms if keep-warm is disabled).
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelWarmup() {
+  auto &context = getContext();
+  auto duration = keepWarmNs.load(std::memory_order_relaxed);
+  keepWorkersWarm(context, duration > 0 ? duration : DefaultWarmupNs);
+}
+
+/// Returns concurrency of the arena, selected for the current thread.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtParallelGetNumThreads() {
+  return getCurrentArena(getContext()).second;
+}
+
+/// Enables NUMA mode: creates arena per NUMA node, outermost dimension of
+/// parallel loops is split between them. Returns number of nodes in use, 0 if
+/// system has single node or NUMA topology is not available.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtParallelEnableNuma() {
+  return enableNuma(getContext());
+}
+
+/// Touches pages of the freshly allocated buffer from NUMA node arenas, using
+/// the same partitioning as parallel loops, so pages are placed near the
+/// threads processing them. No-op if NUMA mode is disabled or buffer is below
+/// the first touch threshold.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelFirstTouch(void *data,
+                                                      size_t size) {
+  constexpr size_t PageSize = 4096;
+  auto minSize = static_cast<size_t>(
+      firstTouchThreshold.load(std::memory_order_relaxed));
+  auto contextPtr = getContextIfInitialized();
+  if (!contextPtr || contextPtr->numaArenas.empty() || !data || size < minSize)
+    return;
+
+  auto &context = *contextPtr;
+  if (tbb::this_task_arena::current_thread_index() !=
+      tbb::task_arena::not_initialized)
+    return;
+
+  // First partial page is already touched by allocator.
+  auto begin = reinterpret_cast<uintptr_t>(data);
+  auto end = begin + size;
+  auto firstPage = (begin + PageSize) & ~uintptr_t(PageSize - 1);
+  if (firstPage >= end)
+    return;
+
+  auto numPages = static_cast<index_t>((end - firstPage + PageSize - 1) /
+                                       PageSize);
+  auto &arenas = context.numaArenas;
+  auto numNodes = arenas.size();
+  std::unique_ptr<tbb::task_group[]> groups(new tbb::task_group[numNodes]);
+  for (size_t i = 0; i < numNodes; ++i) {
+    auto pageBegin = getNumaPartBegin(context, i, numPages);
+    auto pageEnd = getNumaPartBegin(context, i + 1, numPages);
+    if (pageBegin >= pageEnd)
+      continue;
+
+    arenas[i]->arena.execute([&, i, pageBegin, pageEnd] {
+      groups[i].run([&, pageBegin, pageEnd] {
+        tbb::parallel_for(
+            tbb::blocked_range<index_t>(pageBegin, pageEnd),
+            [&](const tbb::blocked_range<index_t> &r) {
+              for (auto page = r.begin(); page != r.end(); ++page) {
+                auto ptr = firstPage + static_cast<uintptr_t>(page) * PageSize;
+                *reinterpret_cast<volatile char *>(ptr) = 0;
+              }
+            },
+            tbb::static_partitioner());
+      });
+    });
+  }
+
+  for (size_t i = 0; i < numNodes; ++i)
+    arenas[i]->arena.execute([&] { groups[i].wait(); });
+}
+
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelProfileEnable(int enable) {
+  profileEnabled.store(enable != 0, std::memory_order_relaxed);
+}
+
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelProfileReset() {
+  auto &registry = getProfileRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto &region : registry.regions) {
+    region->calls.store(0, std::memory_order_relaxed);
+    region->wallNs.store(0, std::memory_order_relaxed);
+    for (size_t i = 0; i < region->numThreads; ++i) {
+      region->threads[i].busyNs.store(0, std::memory_order_relaxed);
+      region->threads[i].chunks.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtParallelProfileGetNumRegions() {
+  auto &registry = getProfileRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  return static_cast<int>(registry.regions.size());
+}
+
+NUMBA_MLIR_RUNTIME_EXPORT const char *
+nmrtParallelProfileGetRegionName(int index) {
+  auto &registry = getProfileRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  if (index < 0 || static_cast<size_t>(index) >= registry.regions.size())
+    return nullptr;
+
+  return registry.regions[static_cast<size_t>(index)]->name.c_str();
+}
+
+/// Reads region counters, `busyNs` and `chunks` must have space for
+/// `maxThreads` elements. Returns number of per-thread entries written or -1
+/// if index is invalid.
+NUMBA_MLIR_RUNTIME_EXPORT int
+nmrtParallelProfileGetRegionStats(int index, uint64_t *calls, uint64_t *wallNs,
+                                  uint64_t *busyNs, uint64_t *chunks,
+                                  int maxThreads) {
+  auto &registry = getProfileRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  if (index < 0 || static_cast<size_t>(index) >= registry.regions.size())
+    return -1;
+
+  auto &region = *registry.regions[static_cast<size_t>(index)];
+  *calls = region.calls.load(std::memory_order_relaxed);
+  *wallNs = region.wallNs.load(std::memory_order_relaxed);
+  auto count =
+      std::min(region.numThreads, static_cast<size_t>(std::max(maxThreads, 0)));
+  for (size_t i = 0; i < count; ++i) {
+    busyNs[i] = region.threads[i].busyNs.load(std::memory_order_relaxed);
+    chunks[i] = region.threads[i].chunks.load(std::memory_order_relaxed);
+  }
+  return static_cast<int>(count);
+}
+
+/// Must be called before `fork`. TBB doesn't support `fork` while its worker
+/// threads exist: they are not copied to the child, which then deadlocks on
+/// the first parallel loop. Context, if it was already created, is destroyed
+/// (waiting for the workers to exit) and recreated on the next use, with the
+/// same named arenas and NUMA mode, in both parent and child. Parallel loops
+/// must not run on other threads during `fork`.
+///
+/// Context lock is held until `nmrtParallelAfterFork`, so it is never copied
+/// to the child in the locked state.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelBeforeFork() {
+  globalContextMutex.lock();
+  auto context = globalContext.load(std::memory_order_relaxed);
+  if (!context || currentDepth > 0)
+    return;
+
+  if (DEBUG)
+    fprintf(stderr, "nmrt_parallel_before_fork\n");
+
+  forkedArenas.clear();
+  {
+    std::lock_guard<std::mutex> lock(context->namedArenasMutex);
+    for (auto &namedArena : context->namedArenas)
+      forkedArenas.emplace_back(namedArena->name, namedArena->numThreads);
+  }
+  forkedNuma = !context->numaArenas.empty();
+  deferredNumThreads.store(context->numThreads, std::memory_order_relaxed);
+  globalContext.store(nullptr, std::memory_order_release);
+  delete context;
+}
 
-  assert(globalContext->numThreads == numThreads);
+/// Must be called after `fork` in both parent and child processes.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelAfterFork() {
+  globalContextMutex.unlock();
 }
 
 NUMBA_MLIR_RUNTIME_EXPORT void nmrtParallelFinalize() {
   if (DEBUG)
     fprintf(stderr, "nmrt_parallel_finalize\n");
 
-  globalContext.reset();
+  std::lock_guard<std::mutex> lock(globalContextMutex);
+  delete globalContext.exchange(nullptr, std::memory_order_acq_rel);
+  deferredNumThreads.store(0, std::memory_order_relaxed);
+  forkedArenas.clear();
+  forkedNuma = false;
 }
 }
 #endif // NUMBA_MLIR_ENABLE_TBB_SUPPORT
@@ -0,0 +1,187 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Trace.hpp"
+
+namespace {
+struct TraceEvent {
+  uint64_t beginNs;
+  uint64_t endNs;
+  char name[48];
+  char category[16];
+};
+
+/// Max number of events, kept per thread, older events are overwritten.
+static constexpr size_t TraceBufferSize = 1 << 14;
+
+/// Per-thread events ring buffer, only written by the owning thread, without
+/// locks. Readers validate copied events against `pending`, so events
+/// overwritten during the copy are dropped.
+struct TraceBuffer {
+  TraceBuffer(uint64_t threadId)
+      : threadId(threadId), events(new TraceEvent[TraceBufferSize]) {}
+
+  uint64_t threadId;
+
+  /// Total number of events written, including overwritten ones.
+  std::atomic<uint64_t> count{0};
+
+  /// Number of events, which writing has started.
+  std::atomic<uint64_t> pending{0};
+
+  /// Index of the first event after the last reset.
+  std::atomic<uint64_t> start{0};
+  std::unique_ptr<TraceEvent[]> events;
+};
+
+struct CollectedEvent {
+  TraceEvent event;
+  uint64_t threadId;
+};
+
+struct TraceRegistry {
+  std::mutex mutex;
+
+  /// Buffers are kept after thread exit, so its events are not lost.
+  std::vector<std::shared_ptr<TraceBuffer>> buffers;
+
+  /// Events, collected by the last `nmrtTraceCollect` call.
+  std::vector<CollectedEvent> collected;
+};
+
+static std::atomic<bool> traceEnabled{false};
+
+static TraceRegistry &getRegistry() {
+  static TraceRegistry registry;
+  return registry;
+}
+
+static TraceBuffer &getThreadBuffer() {
+  static thread_local std::shared_ptr<TraceBuffer> buffer = []() {
+    auto &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto ret = std::make_shared<TraceBuffer>(registry.buffers.size());
+    registry.buffers.emplace_back(ret);
+    return ret;
+  }();
+  return *buffer;
+}
+
+static void copyStr(char *dst, const char *src, size_t size) {
+  if (!src)
+    src = "";
+
+  std::strncpy(dst, src, size - 1);
+  dst[size - 1] = '\0';
+}
+} // namespace
+
+extern "C" {
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtTraceEnable(int enable) {
+  traceEnabled.store(enable != 0, std::memory_order_relaxed);
+}
+
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtTraceIsEnabled() {
+  return traceEnabled.load(std::memory_order_relaxed) ? 1 : 0;
+}
+
+NUMBA_MLIR_RUNTIME_EXPORT uint64_t nmrtTraceNow() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtTraceEvent(const char *name,
+                                              const char *category,
+                                              uint64_t beginNs,
+                                              uint64_t endNs) {
+  if (!traceEnabled.load(std::memory_order_relaxed))
+    return;
+
+  auto &buffer = getThreadBuffer();
+  auto index = buffer.count.load(std::memory_order_relaxed);
+  buffer.pending.store(index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  auto &event = buffer.events[index % TraceBufferSize];
+  event.beginNs = beginNs;
+  event.endNs = std::max(beginNs, endNs);
+  copyStr(event.name, name, sizeof(event.name));
+  copyStr(event.category, category, sizeof(event.category));
+  buffer.count.store(index + 1, std::memory_order_release);
+}
+
+/// Drops all recorded events.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtTraceReset() {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  for (auto &buffer : registry.buffers)
+    buffer->start.store(buffer->count.load(std::memory_order_acquire),
+                        std::memory_order_relaxed);
+  registry.collected.clear();
+  registry.collected.shrink_to_fit();
+}
+
+/// Copies recorded events from all threads, sorted by start time, and returns
+/// their count. Events are accessed by `nmrtTraceGetEvent` until the next
+/// collect or reset call.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtTraceCollect() {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto &collected = registry.collected;
+  collected.clear();
+  for (auto &buffer : registry.buffers) {
+    auto end = buffer->count.load(std::memory_order_acquire);
+    auto first = std::max(buffer->start.load(std::memory_order_relaxed),
+                          end - std::min<uint64_t>(end, TraceBufferSize));
+    auto offset = collected.size();
+    for (uint64_t i = first; i < end; ++i)
+      collected.push_back(
+          {buffer->events[i % TraceBufferSize], buffer->threadId});
+
+    // Owning thread may have overwritten the oldest events during the copy.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto pending = buffer->pending.load(std::memory_order_relaxed);
+    if (pending > first + TraceBufferSize) {
+      auto dropped = std::min(end, pending - TraceBufferSize) - first;
+      auto it = collected.begin() + static_cast<ptrdiff_t>(offset);
+      collected.erase(it, it + static_cast<ptrdiff_t>(dropped));
+    }
+  }
+  std::stable_sort(collected.begin(), collected.end(),
+                   [](const CollectedEvent &a, const CollectedEvent &b) {
+                     return a.event.beginNs < b.event.beginNs;
+                   });
+  return static_cast<int>(collected.size());
+}
+
+/// Returns name of the collected event `index` and writes its category into
+/// `category` and begin, end timestamps and thread id into `data`.
+NUMBA_MLIR_RUNTIME_EXPORT const char *
+nmrtTraceGetEvent(int index, const char **category, uint64_t *data) {
+  auto &registry = getRegistry();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  auto &collected = registry.collected;
+  if (index < 0 || static_cast<size_t>(index) >= collected.size())
+    return nullptr;
+
+  auto &entry = collected[static_cast<size_t>(index)];
+  *category = entry.event.category;
+  data[0] = entry.event.beginNs;
+  data[1] = entry.event.endNs;
+  data[2] = entry.threadId;
+  return entry.event.name;
+}
+}
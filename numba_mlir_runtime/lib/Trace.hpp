@@ -0,0 +1,24 @@
+// SPDX-FileCopyrightText: 2023 Intel Corporation
+//
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+
+#pragma once
+
+#include <cstdint>
+
+#include "numba-mlir-runtime_export.h"
+
+extern "C" {
+/// Returns non-zero if trace events are collected.
+NUMBA_MLIR_RUNTIME_EXPORT int nmrtTraceIsEnabled();
+
+/// Returns current trace timestamp, steady clock nanoseconds.
+NUMBA_MLIR_RUNTIME_EXPORT uint64_t nmrtTraceNow();
+
+/// Records complete event on the calling thread, `name` and `category` are
+/// copied (and truncated) into the thread ring buffer. Does nothing if tracing
+/// is disabled.
+NUMBA_MLIR_RUNTIME_EXPORT void nmrtTraceEvent(const char *name,
+                                              const char *category,
+                                              uint64_t beginNs, uint64_t endNs);
+}